@@ -153,6 +153,8 @@ public:
     virtual bool close(void) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     int m_padded_scanline_size;
@@ -173,6 +175,13 @@ private:
     }
 
     bool read_color_table(void);
+
+    // Read file scanlines [fybegin, fyend) (in file order) into buf.
+    bool read_file_scanlines(int fybegin, int fyend, unsigned char* buf);
+
+    // Convert one scanline as stored in the file (which may be modified)
+    // into native pixels in data.
+    void decode_scanline(unsigned char* fscanline, void* data) const;
 };
 
 
@@ -151,31 +151,70 @@ BmpInput::open(const std::string& name, ImageSpec& spec)
 bool
 BmpInput::read_native_scanline(int subimage, int miplevel, int y, int z,
                                void* data)
+{
+    return read_native_scanlines(subimage, miplevel, y, y + 1, z, data);
+}
+
+
+
+bool
+BmpInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
 {
     lock_guard lock(m_mutex);
     if (!seek_subimage(subimage, miplevel))
         return false;
 
-    if (y < 0 || y > m_spec.height)
+    ybegin = std::max(ybegin, 0);
+    yend   = std::min(yend, m_spec.height);
+    if (ybegin >= yend)
+        return true;
+
+    // The requested scanlines are one contiguous block of the file, so
+    // read it in one go. If the height is positive scanlines are stored
+    // bottom-up.
+    bool bottomup = (m_dib_header.width >= 0);
+    int fybegin   = bottomup ? m_spec.height - yend : ybegin;
+    int fyend     = bottomup ? m_spec.height - ybegin : yend;
+    std::vector<unsigned char> fscanlines(size_t(fyend - fybegin)
+                                          * m_padded_scanline_size);
+    if (!read_file_scanlines(fybegin, fyend, fscanlines.data()))
         return false;
 
-    // if the height is positive scanlines are stored bottom-up
-    if (m_dib_header.width >= 0)
-        y = m_spec.height - y - 1;
-    const int scanline_off = y * m_padded_scanline_size;
+    size_t size = m_spec.scanline_bytes();
+    for (int y = ybegin; y < yend; ++y) {
+        int fy = bottomup ? m_spec.height - y - 1 : y;
+        decode_scanline(&fscanlines[size_t(fy - fybegin)
+                                    * m_padded_scanline_size],
+                        (char*)data + size_t(y - ybegin) * size);
+    }
+    return true;
+}
+
+
 
-    std::vector<unsigned char> fscanline(m_padded_scanline_size);
+bool
+BmpInput::read_file_scanlines(int fybegin, int fyend, unsigned char* buf)
+{
+    size_t nbytes = size_t(fyend - fybegin) * m_padded_scanline_size;
     fsetpos(m_fd, &m_image_start);
-    fseek(m_fd, scanline_off, SEEK_CUR);
-    size_t n = fread(&fscanline[0], 1, m_padded_scanline_size, m_fd);
-    if (n != (size_t)m_padded_scanline_size) {
+    fseek(m_fd, long(fybegin) * m_padded_scanline_size, SEEK_CUR);
+    size_t n = fread(buf, 1, nbytes, m_fd);
+    if (n != nbytes) {
         if (feof(m_fd))
             error("Hit end of file unexpectedly");
         else
             error("read error");
         return false;  // Read failed
     }
+    return true;
+}
 
+
+
+void
+BmpInput::decode_scanline(unsigned char* fscanline, void* data) const
+{
     // in each case we process only first m_spec.scanline_bytes () bytes
     // as only they contain information about pixels. The rest are just
     // because scanline size have to be 32-bit boundary
@@ -184,10 +223,11 @@ BmpInput::read_native_scanline(int subimage, int miplevel, int y, int z,
              i += m_spec.nchannels)
             std::swap(fscanline[i], fscanline[i + 2]);
         memcpy(data, &fscanline[0], m_spec.scanline_bytes());
-        return true;
+        return;
     }
 
-    std::vector<unsigned char> mscanline(m_spec.scanline_bytes());
+    unsigned char* mscanline = (unsigned char*)data;
+    memset(mscanline, 0, m_spec.scanline_bytes());
     if (m_dib_header.bpp == 16) {
         const uint16_t RED   = 0x7C00;
         const uint16_t GREEN = 0x03E0;
@@ -222,9 +262,10 @@ BmpInput::read_native_scanline(int subimage, int miplevel, int y, int z,
         }
     }
     if (m_dib_header.bpp == 1) {
-        for (unsigned int i = 0, k = 0; i < fscanline.size(); ++i) {
+        for (unsigned int i = 0, k = 0; i < (unsigned)m_padded_scanline_size;
+             ++i) {
             for (int j = 7; j >= 0; --j, k += 3) {
-                if (k + 2 >= mscanline.size())
+                if (k + 2 >= m_spec.scanline_bytes())
                     break;
                 int index = 0;
                 if (fscanline[i] & (1 << j))
@@ -235,8 +276,6 @@ BmpInput::read_native_scanline(int subimage, int miplevel, int y, int z,
             }
         }
     }
-    memcpy(data, &mscanline[0], m_spec.scanline_bytes());
-    return true;
 }
 
 
@@ -246,6 +246,22 @@ if (NOT USE_SIMD STREQUAL "")
     add_definitions (${SIMD_COMPILE_FLAGS})
 endif ()
 
+# Runtime-dispatched SIMD kernels (see src/libOpenImageIO/simd_kernels.h):
+# a few of the hottest loops are also built for these instruction sets, and
+# the best one that the CPU supports is chosen when the program runs. This
+# needs gcc or clang on x86, and an optimized build (the kernels rely on
+# everything they call being inlined into them).
+set (SIMD_DISPATCH "avx2,avx512" CACHE STRING
+     "Also build the hottest kernels for these, chosen at runtime (avx2, avx512, or 0 for none)")
+if (NOT (CMAKE_COMPILER_IS_GNUCC OR CMAKE_COMPILER_IS_CLANG)
+    OR NOT CMAKE_SYSTEM_PROCESSOR MATCHES "x86_64|AMD64|amd64|i.86"
+    OR DEBUGMODE OR USE_SIMD STREQUAL "0" OR SIMD_DISPATCH STREQUAL "0")
+    set (SIMD_DISPATCH "")
+endif ()
+if (VERBOSE AND NOT SIMD_DISPATCH STREQUAL "")
+    message (STATUS "Runtime-dispatched SIMD kernels for ${SIMD_DISPATCH}")
+endif ()
+
 
 if (USE_fPIC)
     add_definitions ("-fPIC")
@@ -47,6 +47,10 @@ namespace DDS_pvt {
 #define DDS_4CC_DXT3 DDS_MAKE4CC('D', 'X', 'T', '3')
 #define DDS_4CC_DXT4 DDS_MAKE4CC('D', 'X', 'T', '4')
 #define DDS_4CC_DXT5 DDS_MAKE4CC('D', 'X', 'T', '5')
+#define DDS_4CC_ATI1 DDS_MAKE4CC('A', 'T', 'I', '1')
+#define DDS_4CC_ATI2 DDS_MAKE4CC('A', 'T', 'I', '2')
+#define DDS_4CC_BC4U DDS_MAKE4CC('B', 'C', '4', 'U')
+#define DDS_4CC_BC5U DDS_MAKE4CC('B', 'C', '5', 'U')
 
 /// DDS pixel format flags. Channel flags are only applicable for uncompressed
 /// images.
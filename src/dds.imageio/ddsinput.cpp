@@ -37,8 +37,10 @@
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/typedesc.h>
 
+#include "squish/alpha.h"
 #include "squish/squish.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -54,6 +56,8 @@ public:
     virtual ~DDSInput() { close(); }
     virtual const char* format_name(void) const override { return "dds"; }
     virtual bool open(const std::string& name, ImageSpec& newspec) override;
+    virtual bool open(const std::string& name, ImageSpec& newspec,
+                      const ImageSpec& config) override;
     virtual bool close() override;
     virtual int current_subimage(void) const override
     {
@@ -84,6 +88,7 @@ private:
     int m_greenL, m_greenR;  ///< Bit shifts to extract green channel
     int m_blueL, m_blueR;    ///< Bit shifts to extract blue channel
     int m_alphaL, m_alphaR;  ///< Bit shifts to extract alpha channel
+    bool m_raw_blocks;       ///< Return compressed blocks undecoded
 
     dds_header m_dds;  ///< DDS header
 
@@ -93,10 +98,39 @@ private:
     {
         m_file     = NULL;
         m_subimage = -1;
-        m_miplevel = -1;
+        m_miplevel   = -1;
+        m_raw_blocks = false;
         m_buf.clear();
     }
 
+    /// Size in bytes of one 4x4 block of the compressed format.
+    ///
+    int block_bytes() const
+    {
+        return (m_dds.fmt.fourCC == DDS_4CC_DXT1
+                || m_dds.fmt.fourCC == DDS_4CC_ATI1
+                || m_dds.fmt.fourCC == DDS_4CC_BC4U)
+                   ? 8
+                   : 16;
+    }
+
+    /// Size in bytes of a compressed w x h image.
+    ///
+    unsigned int compressed_size(int w, int h) const
+    {
+        return ((w + 3) / 4) * ((h + 3) / 4) * block_bytes();
+    }
+
+    /// Helper function: decompress one block into 16 RGBA pixels.
+    ///
+    void decompress_block(unsigned char rgba[64],
+                          const unsigned char* block) const;
+
+    /// Helper function: decompress a w x h image, in parallel over rows of
+    /// blocks.
+    void decompress_image(unsigned char* dst, int w, int h,
+                          const unsigned char* blocks) const;
+
     /// Helper function: read the image as scanlines (all but cubemaps).
     ///
     bool readimg_scanlines();
@@ -270,8 +304,10 @@ DDSInput::open(const std::string& name, ImageSpec& newspec)
     // TODO: support DXGI and the "wackier" uncompressed formats
     if (m_dds.fmt.flags & DDS_PF_FOURCC && m_dds.fmt.fourCC != DDS_4CC_DXT1
         && m_dds.fmt.fourCC != DDS_4CC_DXT2 && m_dds.fmt.fourCC != DDS_4CC_DXT3
-        && m_dds.fmt.fourCC != DDS_4CC_DXT4
-        && m_dds.fmt.fourCC != DDS_4CC_DXT5) {
+        && m_dds.fmt.fourCC != DDS_4CC_DXT4 && m_dds.fmt.fourCC != DDS_4CC_DXT5
+        && m_dds.fmt.fourCC != DDS_4CC_ATI1 && m_dds.fmt.fourCC != DDS_4CC_BC4U
+        && m_dds.fmt.fourCC != DDS_4CC_ATI2
+        && m_dds.fmt.fourCC != DDS_4CC_BC5U) {
         error("Unsupported compression type");
         return false;
     }
@@ -283,6 +319,13 @@ DDSInput::open(const std::string& name, ImageSpec& newspec)
             m_nchans = 3; // no alpha in DXT1
         else*/
         m_nchans = 4;
+        // BC4 and BC5 hold one and two channels, respectively
+        if (m_dds.fmt.fourCC == DDS_4CC_ATI1
+            || m_dds.fmt.fourCC == DDS_4CC_BC4U)
+            m_nchans = 1;
+        if (m_dds.fmt.fourCC == DDS_4CC_ATI2
+            || m_dds.fmt.fourCC == DDS_4CC_BC5U)
+            m_nchans = 2;
     } else {
         m_nchans = ((m_dds.fmt.flags & DDS_PF_LUMINANCE) ? 1 : 3)
                    + ((m_dds.fmt.flags & DDS_PF_ALPHA) ? 1 : 0);
@@ -321,6 +364,18 @@ DDSInput::open(const std::string& name, ImageSpec& newspec)
 
 
 
+bool
+DDSInput::open(const std::string& name, ImageSpec& newspec,
+               const ImageSpec& config)
+{
+    // "dds:RawBlocks" asks for the compressed blocks themselves rather
+    // than decoded pixels; it has no effect on uncompressed files.
+    m_raw_blocks = config.get_int_attribute("dds:RawBlocks") != 0;
+    return open(name, newspec);
+}
+
+
+
 inline void
 DDSInput::calc_shifts(int mask, int& left, int& right)
 {
@@ -374,13 +429,7 @@ DDSInput::internal_seek_subimage(int cubeface, int miplevel, unsigned int& w,
         if (m_dds.mipmaps < 2) {
             if (j > 0) {
                 if (m_dds.fmt.flags & DDS_PF_FOURCC)
-                    // only check for DXT1 - all other formats have same block
-                    // size
-                    len = squish::GetStorageRequirements(w, h,
-                                                         m_dds.fmt.fourCC
-                                                                 == DDS_4CC_DXT1
-                                                             ? squish::kDxt1
-                                                             : squish::kDxt5);
+                    len = compressed_size(w, h);
                 else
                     len = w * h * d * m_Bpp;
                 ofs += len;
@@ -389,12 +438,7 @@ DDSInput::internal_seek_subimage(int cubeface, int miplevel, unsigned int& w,
         }
         for (int i = 0; i < miplevel; i++) {
             if (m_dds.fmt.flags & DDS_PF_FOURCC)
-                // only check for DXT1 - all other formats have same block size
-                len = squish::GetStorageRequirements(w, h,
-                                                     m_dds.fmt.fourCC
-                                                             == DDS_4CC_DXT1
-                                                         ? squish::kDxt1
-                                                         : squish::kDxt5);
+                len = compressed_size(w, h);
             else
                 len = w * h * d * m_Bpp;
             ofs += len;
@@ -436,6 +480,10 @@ DDSInput::seek_subimage(int subimage, int miplevel)
     // clear buffer so that readimage is called
     m_buf.clear();
 
+    // with raw blocks, each "pixel" is one whole compressed block
+    bool raw_blocks = m_raw_blocks && (m_dds.fmt.flags & DDS_PF_FOURCC);
+    int nchans      = raw_blocks ? block_bytes() : m_nchans;
+
     // for cube maps, the seek will be performed when reading a tile instead
     unsigned int w = 0, h = 0, d = 0;
     if (m_dds.caps.flags2 & DDS_CAPS2_CUBEMAP) {
@@ -454,11 +502,15 @@ DDSInput::seek_subimage(int subimage, int miplevel)
             if (d < 1)
                 d = 1;
         }
+        if (raw_blocks) {
+            w = (w + 3) / 4;
+            h = (h + 3) / 4;
+        }
         // create imagespec for the 3x2 cube map layout
 #ifdef DDS_3X2_CUBE_MAP_LAYOUT
-        m_spec = ImageSpec(w * 3, h * 2, m_nchans, TypeDesc::UINT8);
+        m_spec = ImageSpec(w * 3, h * 2, nchans, TypeDesc::UINT8);
 #else   // 1x6 layout
-        m_spec = ImageSpec(w, h * 6, m_nchans, TypeDesc::UINT8);
+        m_spec = ImageSpec(w, h * 6, nchans, TypeDesc::UINT8);
 #endif  // DDS_3X2_CUBE_MAP_LAYOUT
         m_spec.depth      = d;
         m_spec.tile_width = m_spec.full_width = w;
@@ -466,8 +518,12 @@ DDSInput::seek_subimage(int subimage, int miplevel)
         m_spec.tile_depth = m_spec.full_depth = d;
     } else {
         internal_seek_subimage(0, miplevel, w, h, d);
+        if (raw_blocks) {
+            w = (w + 3) / 4;
+            h = (h + 3) / 4;
+        }
         // create imagespec
-        m_spec       = ImageSpec(w, h, m_nchans, TypeDesc::UINT8);
+        m_spec       = ImageSpec(w, h, nchans, TypeDesc::UINT8);
         m_spec.depth = d;
     }
 
@@ -482,6 +538,8 @@ DDSInput::seek_subimage(int subimage, int miplevel)
     }
     m_spec.attribute("oiio:BitsPerSample", m_dds.fmt.bpp);
     m_spec.default_channel_names();
+    if (raw_blocks)
+        m_spec.attribute("dds:RawBlocks", 1);
 
     // detect texture type
     if (m_dds.caps.flags2 & DDS_CAPS2_VOLUME) {
@@ -537,41 +595,15 @@ DDSInput::internal_readimg(unsigned char* dst, int w, int h, int d)
 {
     if (m_dds.fmt.flags & DDS_PF_FOURCC) {
         // compressed image
-        int flags = 0;
-        switch (m_dds.fmt.fourCC) {
-        case DDS_4CC_DXT1: flags = squish::kDxt1; break;
-        // DXT2 and 3 are the same, only 2 has pre-multiplied alpha
-        case DDS_4CC_DXT2:
-        case DDS_4CC_DXT3: flags = squish::kDxt3; break;
-        // DXT4 and 5 are the same, only 4 has pre-multiplied alpha
-        case DDS_4CC_DXT4:
-        case DDS_4CC_DXT5: flags = squish::kDxt5; break;
+        if (m_raw_blocks) {
+            // w and h are already in blocks, each block one "pixel"
+            return fread(dst, size_t(w) * h * block_bytes(), 1);
         }
-        // create source buffer
-        std::vector<squish::u8> tmp(
-            squish::GetStorageRequirements(w, h, flags));
         // load image into buffer
+        std::vector<unsigned char> tmp(compressed_size(w, h));
         if (!fread(&tmp[0], tmp.size(), 1))
             return false;
-        // decompress image
-        squish::DecompressImage(dst, w, h, &tmp[0], flags);
-        tmp.clear();
-        // correct pre-multiplied alpha, if necessary
-        if (m_dds.fmt.fourCC == DDS_4CC_DXT2
-            || m_dds.fmt.fourCC == DDS_4CC_DXT4) {
-            int k;
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    k          = (y * w + x) * 4;
-                    dst[k + 0] = (unsigned char)((int)dst[k + 0] * 255
-                                                 / (int)dst[k + 3]);
-                    dst[k + 1] = (unsigned char)((int)dst[k + 1] * 255
-                                                 / (int)dst[k + 3]);
-                    dst[k + 2] = (unsigned char)((int)dst[k + 2] * 255
-                                                 / (int)dst[k + 3]);
-                }
-            }
-        }
+        decompress_image(dst, w, h, &tmp[0]);
     } else {
         // uncompressed image
 
@@ -605,6 +637,84 @@ DDSInput::internal_readimg(unsigned char* dst, int w, int h, int d)
 
 
 
+void
+DDSInput::decompress_block(unsigned char rgba[64],
+                           const unsigned char* block) const
+{
+    switch (m_dds.fmt.fourCC) {
+    case DDS_4CC_DXT1: squish::Decompress(rgba, block, squish::kDxt1); break;
+    // DXT2 and 3 are the same, only 2 has pre-multiplied alpha
+    case DDS_4CC_DXT2:
+    case DDS_4CC_DXT3: squish::Decompress(rgba, block, squish::kDxt3); break;
+    // DXT4 and 5 are the same, only 4 has pre-multiplied alpha
+    case DDS_4CC_DXT4:
+    case DDS_4CC_DXT5: squish::Decompress(rgba, block, squish::kDxt5); break;
+    // BC4 is a lone DXT5 alpha block, BC5 is two of them (red, green); the
+    // alpha decoder writes to the fourth byte of each pixel.
+    case DDS_4CC_ATI1:
+    case DDS_4CC_BC4U:
+        squish::DecompressAlphaDxt5(rgba, block);
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i] = rgba[4 * i + 3];
+        break;
+    case DDS_4CC_ATI2:
+    case DDS_4CC_BC5U:
+        squish::DecompressAlphaDxt5(rgba, block + 8);
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i + 1] = rgba[4 * i + 3];
+        squish::DecompressAlphaDxt5(rgba, block);
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i] = rgba[4 * i + 3];
+        break;
+    }
+    // correct pre-multiplied alpha, if necessary
+    if (m_dds.fmt.fourCC == DDS_4CC_DXT2 || m_dds.fmt.fourCC == DDS_4CC_DXT4) {
+        for (int i = 0; i < 64; i += 4) {
+            int a = rgba[i + 3];
+            if (a == 0)
+                continue;
+            for (int c = 0; c < 3; ++c)
+                rgba[i + c] = (unsigned char)std::min(255, rgba[i + c] * 255
+                                                               / a);
+        }
+    }
+}
+
+
+
+void
+DDSInput::decompress_image(unsigned char* dst, int w, int h,
+                           const unsigned char* blocks) const
+{
+    // Blocks are independent of each other, so rows of them can be
+    // decoded in parallel, each straight into its place in dst.
+    const int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    const int bsize = block_bytes(), nchans = m_nchans;
+    parallel_for_chunked(
+        0, bh, 0,
+        [&](int64_t bybegin, int64_t byend) {
+            unsigned char rgba[64];
+            for (int64_t by = bybegin; by < byend; ++by) {
+                for (int bx = 0; bx < bw; ++bx) {
+                    decompress_block(rgba, blocks + (by * bw + bx) * bsize);
+                    int yend = std::min(4, h - int(by) * 4);
+                    int xend = std::min(4, w - bx * 4);
+                    for (int py = 0; py < yend; ++py) {
+                        unsigned char* d
+                            = dst
+                              + ((by * 4 + py) * w + bx * 4) * size_t(nchans);
+                        for (int px = 0; px < xend; ++px, d += nchans)
+                            for (int c = 0; c < nchans; ++c)
+                                d[c] = rgba[4 * (py * 4 + px) + c];
+                    }
+                }
+            }
+        },
+        parallel_options(threads(), Split_Y, 8));
+}
+
+
+
 bool
 DDSInput::readimg_scanlines()
 {
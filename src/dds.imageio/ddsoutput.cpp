@@ -0,0 +1,429 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "dds_pvt.h"
+
+#include <OpenImageIO/dassert.h>
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/typedesc.h>
+
+#include "squish/alpha.h"
+#include "squish/squish.h"
+
+OIIO_PLUGIN_NAMESPACE_BEGIN
+
+using namespace DDS_pvt;
+
+
+class DDSOutput final : public ImageOutput {
+public:
+    DDSOutput() { init(); }
+    virtual ~DDSOutput() { close(); }
+    virtual const char* format_name(void) const override { return "dds"; }
+    virtual int supports(string_view feature) const override
+    {
+        // Tiles are emulated: each MIP level is held whole until it is
+        // complete, because blocks are compressed in parallel.
+        return (feature == "tiles" || feature == "mipmap"
+                || feature == "alpha");
+    }
+    virtual bool open(const std::string& name, const ImageSpec& spec,
+                      OpenMode mode = Create) override;
+    virtual bool close() override;
+    virtual bool write_scanline(int y, int z, TypeDesc format, const void* data,
+                                stride_t xstride) override;
+    virtual bool write_tile(int x, int y, int z, TypeDesc format,
+                            const void* data, stride_t xstride,
+                            stride_t ystride, stride_t zstride) override;
+
+private:
+    std::string m_filename;            ///< Stash the filename
+    FILE* m_file;                      ///< Open image handle
+    std::vector<unsigned char> m_buf;  ///< The current MIP level's pixels
+    uint32_t m_fourCC;                 ///< Compression, or 0 if none
+    int m_squish_flags;                ///< Colour compressor for DXT1-5
+    int m_nmiplevels;                  ///< MIP levels written so far
+    int m_width, m_height;             ///< Resolution of the top level
+    size_t m_toplevel_bytes;           ///< Size of the top level in the file
+
+    void init()
+    {
+        m_file       = NULL;
+        m_fourCC     = 0;
+        m_nmiplevels = 0;
+        m_buf.clear();
+    }
+
+    /// Size in bytes of one 4x4 block of the compressed format.
+    ///
+    int block_bytes() const
+    {
+        return (m_fourCC == DDS_4CC_DXT1 || m_fourCC == DDS_4CC_ATI1) ? 8
+                                                                       : 16;
+    }
+
+    /// Helper function: compress one block of 16 RGBA pixels, of which
+    /// only those whose bits are set in mask are in the image.
+    void compress_block(unsigned char rgba[64], int mask,
+                        unsigned char* block) const;
+
+    /// Helper function: compress (if called for) and write the buffered
+    /// MIP level, in parallel over rows of blocks, then free the buffer.
+    bool write_level();
+
+    /// Helper function: write the file header, for a file of nmiplevels
+    /// MIP levels.
+    bool write_header(int nmiplevels);
+
+    /// Helper: write 32 bit little-endian values, with error detection
+    ///
+    bool fwrite(const uint32_t* buf, size_t nitems)
+    {
+        std::vector<uint32_t> le(buf, buf + nitems);
+        if (bigendian())
+            swap_endian(le.data(), int(nitems));
+        size_t n = ::fwrite(le.data(), sizeof(uint32_t), nitems, m_file);
+        if (n != nitems)
+            error("Write error");
+        return n == nitems;
+    }
+};
+
+
+
+// Obligatory material to make this a recognizeable imageio plugin:
+OIIO_PLUGIN_EXPORTS_BEGIN
+
+OIIO_EXPORT ImageOutput*
+dds_output_imageio_create()
+{
+    return new DDSOutput;
+}
+
+OIIO_EXPORT const char* dds_output_extensions[] = { "dds", nullptr };
+
+OIIO_PLUGIN_EXPORTS_END
+
+
+
+bool
+DDSOutput::open(const std::string& name, const ImageSpec& userspec,
+                OpenMode mode)
+{
+    if (mode == AppendSubimage) {
+        error("%s does not support subimages", format_name());
+        return false;
+    }
+    if (mode == AppendMIPLevel) {
+        if (!m_file) {
+            error("%s: no file is open to append a MIP level to",
+                  format_name());
+            return false;
+        }
+        // Finish the level before, then check that this one is the next
+        // in the chain (which is what a reader of the file will expect).
+        int w = std::max(1, m_spec.width / 2);
+        int h = std::max(1, m_spec.height / 2);
+        if (!write_level())
+            return false;
+        if (userspec.width != w || userspec.height != h
+            || userspec.nchannels != m_spec.nchannels) {
+            error("%s MIP level %d must be %d x %d, not %d x %d",
+                  format_name(), m_nmiplevels, w, h, userspec.width,
+                  userspec.height);
+            return false;
+        }
+        m_spec = userspec;
+        m_spec.set_format(TypeDesc::UINT8);
+        m_buf.assign(m_spec.image_bytes(), 0);
+        return true;
+    }
+
+    close();  // Close any already-opened file
+    m_spec = userspec;
+
+    // Check for things DDS can't support
+    if (m_spec.nchannels < 1 || m_spec.nchannels > 4) {
+        error("%s does not support %d-channel images", format_name(),
+              m_spec.nchannels);
+        return false;
+    }
+    if (m_spec.width < 1 || m_spec.height < 1) {
+        error("Image resolution must be at least 1x1, you asked for %d x %d",
+              m_spec.width, m_spec.height);
+        return false;
+    }
+    if (m_spec.depth < 1)
+        m_spec.depth = 1;
+    if (m_spec.depth > 1) {
+        error("%s does not support volume images (depth > 1)", format_name());
+        return false;
+    }
+    m_spec.set_format(TypeDesc::UINT8);  // DDS is only written as 8 bit
+
+    // "compression" names a block compression, or "none". Anything else
+    // (including no compression named) picks the one that suits the
+    // channels: BC4 for 1, BC5 for 2, DXT1 for 3 and DXT5 for 4.
+    std::string comp = m_spec.get_string_attribute("compression");
+    if (Strutil::iequals(comp, "dxt1") || Strutil::iequals(comp, "bc1"))
+        m_fourCC = DDS_4CC_DXT1;
+    else if (Strutil::iequals(comp, "dxt3") || Strutil::iequals(comp, "bc2"))
+        m_fourCC = DDS_4CC_DXT3;
+    else if (Strutil::iequals(comp, "dxt5") || Strutil::iequals(comp, "bc3"))
+        m_fourCC = DDS_4CC_DXT5;
+    else if (Strutil::iequals(comp, "ati1") || Strutil::iequals(comp, "bc4"))
+        m_fourCC = DDS_4CC_ATI1;
+    else if (Strutil::iequals(comp, "ati2") || Strutil::iequals(comp, "bc5"))
+        m_fourCC = DDS_4CC_ATI2;
+    else if (Strutil::iequals(comp, "none"))
+        m_fourCC = 0;
+    else {
+        static const uint32_t bychannels[] = { DDS_4CC_ATI1, DDS_4CC_ATI2,
+                                               DDS_4CC_DXT1, DDS_4CC_DXT5 };
+        m_fourCC = bychannels[m_spec.nchannels - 1];
+    }
+
+    // "CompressionQuality" trades speed for quality of the DXT colours:
+    // below 40 is the fast range fit, 90 and above the slow iterative
+    // cluster fit, and in between (or unset) the cluster fit.
+    int quality    = m_spec.get_int_attribute("CompressionQuality", 50);
+    m_squish_flags = quality < 40 ? squish::kColourRangeFit
+                                  : (quality < 90
+                                         ? squish::kColourClusterFit
+                                         : squish::kColourIterativeClusterFit);
+    if (m_fourCC == DDS_4CC_DXT1)
+        m_squish_flags |= squish::kDxt1;
+    else if (m_fourCC == DDS_4CC_DXT3)
+        m_squish_flags |= squish::kDxt3;
+    else if (m_fourCC == DDS_4CC_DXT5)
+        m_squish_flags |= squish::kDxt5;
+
+    m_filename = name;
+    m_file     = Filesystem::fopen(name, "wb");
+    if (!m_file) {
+        error("Could not open file \"%s\"", name.c_str());
+        return false;
+    }
+    m_width  = m_spec.width;
+    m_height = m_spec.height;
+    m_toplevel_bytes
+        = m_fourCC ? size_t((m_width + 3) / 4) * ((m_height + 3) / 4)
+                         * block_bytes()
+                   : size_t(m_width) * m_spec.nchannels;
+    // The header is written again by close(), once the number of MIP
+    // levels is known.
+    if (!write_header(1))
+        return false;
+    m_buf.assign(m_spec.image_bytes(), 0);
+    return true;
+}
+
+
+
+bool
+DDSOutput::write_header(int nmiplevels)
+{
+    int nchans = m_spec.nchannels;
+    uint32_t flags = DDS_CAPS | DDS_HEIGHT | DDS_WIDTH | DDS_PIXELFORMAT
+                     | (m_fourCC ? DDS_LINEARSIZE : DDS_PITCH);
+    if (nmiplevels > 1)
+        flags |= DDS_MIPMAPCOUNT;
+    uint32_t pfflags, bpp = 0, masks[4] = { 0, 0, 0, 0 };
+    if (m_fourCC) {
+        pfflags = DDS_PF_FOURCC;
+    } else {
+        // Pixels are stored as their channels' bytes, in order, so the
+        // masks of a little-endian pixel pick out successive bytes.
+        pfflags = (nchans >= 3 ? DDS_PF_RGB : DDS_PF_LUMINANCE)
+                  | ((nchans == 2 || nchans == 4) ? DDS_PF_ALPHA : 0);
+        bpp     = 8 * nchans;
+        int ncolour = nchans >= 3 ? 3 : 1;
+        for (int c = 0; c < ncolour; ++c)
+            masks[c] = 0xffu << (8 * c);
+        if (pfflags & DDS_PF_ALPHA)
+            masks[3] = 0xffu << (8 * ncolour);
+    }
+    uint32_t caps1 = DDS_CAPS1_TEXTURE;
+    if (nmiplevels > 1)
+        caps1 |= DDS_CAPS1_COMPLEX | DDS_CAPS1_MIPMAP;
+
+    uint32_t header[32] = {
+        DDS_MAKE4CC('D', 'D', 'S', ' '), 124, flags, uint32_t(m_height),
+        uint32_t(m_width), uint32_t(m_toplevel_bytes), 0,
+        uint32_t(nmiplevels),
+        // 11 reserved fields (zero) come in here, then the pixel format
+    };
+    uint32_t* pf = header + 19;
+    pf[0]        = 32;
+    pf[1]        = pfflags;
+    pf[2]        = m_fourCC;
+    pf[3]        = bpp;
+    std::copy(masks, masks + 4, pf + 4);
+    header[27] = caps1;  // caps2-4 and the last reserved field are zero
+
+    fseek(m_file, 0, SEEK_SET);
+    return fwrite(header, 32);
+}
+
+
+
+void
+DDSOutput::compress_block(unsigned char rgba[64], int mask,
+                          unsigned char* block) const
+{
+    switch (m_fourCC) {
+    // BC4 is a lone DXT5 alpha block, BC5 is two of them (red, green); the
+    // alpha encoder reads the fourth byte of each pixel.
+    case DDS_4CC_ATI1:
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i + 3] = rgba[4 * i];
+        squish::CompressAlphaDxt5(rgba, mask, block);
+        break;
+    case DDS_4CC_ATI2:
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i + 3] = rgba[4 * i];
+        squish::CompressAlphaDxt5(rgba, mask, block);
+        for (int i = 0; i < 16; ++i)
+            rgba[4 * i + 3] = rgba[4 * i + 1];
+        squish::CompressAlphaDxt5(rgba, mask, block + 8);
+        break;
+    default: squish::CompressMasked(rgba, mask, block, m_squish_flags); break;
+    }
+}
+
+
+
+bool
+DDSOutput::write_level()
+{
+    const int w = m_spec.width, h = m_spec.height, nchans = m_spec.nchannels;
+    ++m_nmiplevels;
+    if (!m_fourCC) {
+        // uncompressed: the buffer is already laid out as the file is
+        bool ok = ::fwrite(m_buf.data(), 1, m_buf.size(), m_file)
+                  == m_buf.size();
+        std::vector<unsigned char>().swap(m_buf);
+        if (!ok)
+            error("Write error");
+        return ok;
+    }
+
+    // Blocks are independent of each other, so rows of them can be
+    // compressed in parallel, each straight into its place in the level.
+    const int bw = (w + 3) / 4, bh = (h + 3) / 4, bsize = block_bytes();
+    std::vector<unsigned char> blocks(size_t(bw) * bh * bsize);
+    parallel_for_chunked(
+        0, bh, 0,
+        [&](int64_t bybegin, int64_t byend) {
+            unsigned char rgba[64];
+            for (int64_t by = bybegin; by < byend; ++by) {
+                for (int bx = 0; bx < bw; ++bx) {
+                    int yend = std::min(4, h - int(by) * 4);
+                    int xend = std::min(4, w - bx * 4);
+                    int mask = 0;
+                    for (int py = 0; py < yend; ++py) {
+                        const unsigned char* s
+                            = &m_buf[((by * 4 + py) * w + bx * 4)
+                                     * size_t(nchans)];
+                        for (int px = 0; px < xend; ++px, s += nchans) {
+                            unsigned char* p = rgba + 4 * (py * 4 + px);
+                            // BC5 takes 2 channels as red and green, the
+                            // others as grey and alpha
+                            bool ga = (nchans == 2
+                                       && m_fourCC != DDS_4CC_ATI2);
+                            p[0] = s[0];
+                            p[1] = (nchans > 1 && !ga) ? s[1] : s[0];
+                            p[2] = nchans > 2 ? s[2] : s[0];
+                            p[3] = nchans > 3 ? s[3] : (ga ? s[1] : 255);
+                            mask |= 1 << (py * 4 + px);
+                        }
+                    }
+                    compress_block(rgba, mask,
+                                   &blocks[(by * bw + bx) * size_t(bsize)]);
+                }
+            }
+        },
+        parallel_options(threads(), Split_Y, 8));
+    std::vector<unsigned char>().swap(m_buf);
+
+    if (::fwrite(blocks.data(), 1, blocks.size(), m_file) != blocks.size()) {
+        error("Write error");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+DDSOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
+                          stride_t xstride)
+{
+    return copy_to_image_buffer(m_spec.x, m_spec.x + m_spec.width, y, y + 1,
+                                z, z + 1, format, data, xstride, AutoStride,
+                                AutoStride, &m_buf[0]);
+}
+
+
+
+bool
+DDSOutput::write_tile(int x, int y, int z, TypeDesc format, const void* data,
+                      stride_t xstride, stride_t ystride, stride_t zstride)
+{
+    return copy_tile_to_image_buffer(x, y, z, format, data, xstride, ystride,
+                                     zstride, &m_buf[0]);
+}
+
+
+
+bool
+DDSOutput::close()
+{
+    if (!m_file) {  // already closed
+        init();
+        return true;
+    }
+
+    bool ok = m_buf.empty() || write_level();
+    ok &= write_header(m_nmiplevels);
+    fclose(m_file);
+    init();
+    return ok;
+}
+
+OIIO_PLUGIN_NAMESPACE_END
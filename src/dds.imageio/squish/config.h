@@ -32,9 +32,15 @@
 #endif
 
 // Set to 1 or 2 when building squish to use SSE or SSE2 instructions.
+// (OIIO: use SSE2 whenever the compiler is generating it anyway.)
 #ifndef SQUISH_USE_SSE
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SQUISH_USE_SSE 2
+#else
 #define SQUISH_USE_SSE 0
 #endif
+#endif
 
 // Internally set SQUISH_USE_SIMD when either Altivec or SSE is available.
 #if SQUISH_USE_ALTIVEC && SQUISH_USE_SSE
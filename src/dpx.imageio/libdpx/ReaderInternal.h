@@ -154,8 +154,7 @@ namespace dpx
 			
 			// get the read count in bytes, round to the 32-bit boundry
 			int readSize = (block.x2 - block.x1 + 1) * numberOfComponents;
-			readSize += readSize % 3;
-			readSize = readSize / 3 * 4;
+			readSize = (readSize + 2) / 3 * 4;
 			
 			// determine buffer offset
 			int bufoff = line * datums;
@@ -173,14 +172,14 @@ namespace dpx
 			for (int count = (block.x2 - block.x1 + 1) * numberOfComponents - 1; count >= 0; count--)
 			{
 				// unpacking the buffer backwords
-				U16 d1 = U16(readBuf[(count + index) / 3] >> ((2 - (count + index) % 3) * 10 + PADDINGBITS) & 0x3ff);
+				// work-around for 1-channel DPX images - the datums within each word are in the opposite order,
+				// otherwise the columns are in the wrong order (and swapping them after the fact would write past
+				// the end of the line when it does not end on a whole word)
+				const int datum = (numberOfComponents == 1 ? (count + index) % 3 : 2 - (count + index) % 3);
+				U16 d1 = U16(readBuf[(count + index) / 3] >> (datum * 10 + PADDINGBITS) & 0x3ff);
 				BaseTypeConvertU10ToU16(d1, d1);
 
 				BaseTypeConverter(d1, obuf[count]);
-
-				// work-around for 1-channel DPX images - to swap the outlying pixels, otherwise the columns are in the wrong order
-				if (numberOfComponents == 1 && count % 3 == 0)
-					std::swap(obuf[count], obuf[count + 2]);
 			}
 #endif		
 		}
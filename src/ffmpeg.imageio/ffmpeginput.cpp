@@ -135,7 +135,9 @@ receive_frame(AVCodecContext* avctx, AVFrame* picture, AVPacket* avpkt)
 
 
 #include <OpenImageIO/imageio.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <mutex>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -167,6 +169,7 @@ public:
     bool seek(int pos);
     double fps() const;
     int64_t time_stamp(int pos) const;
+    int frame_number(int64_t pts) const;
 
 private:
     std::string m_filename;
@@ -191,6 +194,18 @@ private:
     bool m_codec_cap_delay;
     bool m_read_frame;
     int64_t m_start_time;
+    // Keyframes of the video stream as (frame number, pts), sorted by
+    // frame. Built the first time we need to seek; lets us seek straight
+    // to the keyframe starting a frame's GOP, and keep decoding forward
+    // (instead of seeking) when no keyframe lies in between.
+    std::vector<std::pair<int, int64_t>> m_keyframes;
+    bool m_keyframes_indexed;
+    // The last few converted frames, most recent last, so that stepping
+    // back and forth between nearby frames doesn't have to decode again.
+    std::vector<std::pair<int, std::vector<uint8_t>>> m_frame_cache;
+
+    void index_keyframes();
+    bool keyframe_between(int begin, int end) const;
 
     // init to initialize state
     void init(void)
@@ -214,6 +229,9 @@ private:
         m_codec_cap_delay  = false;
         m_subimage         = 0;
         m_start_time       = 0;
+        m_keyframes.clear();
+        m_keyframes_indexed = false;
+        m_frame_cache.clear();
     }
 };
 
@@ -339,6 +357,12 @@ FFmpegInput::open(const std::string& name, ImageSpec& spec)
     }
 #endif
 
+    // Let the decoder use frame and slice threads, as many as our thread
+    // policy allows (0 leaves ffmpeg to pick the count itself).
+    int nthreads = threads() ? threads() : OIIO::get_int_attribute("threads");
+    m_codec_context->thread_count = nthreads;
+    m_codec_context->thread_type  = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     if (avcodec_open2(m_codec_context, m_codec, NULL) < 0) {
         error("\"%s\" could not open codec", file_name);
         return false;
@@ -493,10 +517,37 @@ FFmpegInput::close(void)
 
 
 
+// How many converted frames FFmpegInput keeps around.
+static const size_t frame_cache_size = 4;
+
+static const int64_t min_pts = std::numeric_limits<int64_t>::min();
+static const int64_t max_pts = std::numeric_limits<int64_t>::max();
+
+
+
 void
 FFmpegInput::read_frame(int frame)
 {
-    if (m_last_decoded_pos + 1 != frame) {
+    for (auto& cached : m_frame_cache) {
+        if (cached.first == frame) {
+            m_rgb_buffer = cached.second;
+            avpicture_fill(reinterpret_cast<AVPicture*>(m_rgb_frame),
+                           &m_rgb_buffer[0], m_dst_pix_format,
+                           m_codec_context->width, m_codec_context->height);
+            m_read_frame = true;
+            return;
+        }
+    }
+    // Going backward, or skipping ahead past a keyframe, means seeking to
+    // the keyframe before the frame we want. Otherwise it's cheaper to
+    // just keep decoding from where we are. The keyframe index is only
+    // built once we need it, so reading a movie's first frame or reading
+    // it straight through never pays for it.
+    bool sequential = (m_last_decoded_pos + 1 == frame);
+    if (!sequential && frame > 0 && !m_keyframes_indexed)
+        index_keyframes();
+    if (frame <= m_last_decoded_pos
+        || (!sequential && keyframe_between(m_last_decoded_pos + 1, frame))) {
         seek(frame);
     }
     AVPacket pkt;
@@ -512,15 +563,13 @@ FFmpegInput::read_frame(int frame)
 
             finished = receive_frame(m_codec_context, m_frame, &pkt);
 
-            double pts = 0;
+            int64_t pts = 0;
             if (static_cast<int64_t>(m_frame->pkt_pts)
                 != int64_t(AV_NOPTS_VALUE)) {
-                pts = av_q2d(
-                          m_format_context->streams[m_video_stream]->time_base)
-                      * m_frame->pkt_pts;
+                pts = m_frame->pkt_pts;
             }
 
-            int current_frame = int((pts - m_start_time) * fps() + 0.5f);  //???
+            int current_frame = frame_number(pts);
             //current_frame =   m_frame->display_picture_number;
             m_last_search_pos = current_frame;
 
@@ -533,6 +582,9 @@ FFmpegInput::read_frame(int frame)
                           m_frame->linesize, 0, m_codec_context->height,
                           m_rgb_frame->data, m_rgb_frame->linesize);
                 m_last_decoded_pos = current_frame;
+                if (m_frame_cache.size() >= frame_cache_size)
+                    m_frame_cache.erase(m_frame_cache.begin());
+                m_frame_cache.emplace_back(frame, m_rgb_buffer);
                 av_free_packet(&pkt);
                 break;
             }
@@ -567,6 +619,17 @@ FFmpegInput::has_metadata (const char * key)
 bool
 FFmpegInput::seek(int frame)
 {
+    if (!m_keyframes.empty()) {
+        // Seek the video stream right to the keyframe at or before frame.
+        auto k = std::upper_bound(m_keyframes.begin(), m_keyframes.end(),
+                                  std::make_pair(frame, max_pts));
+        if (k != m_keyframes.begin()) {
+            avcodec_flush_buffers(m_codec_context);
+            av_seek_frame(m_format_context, m_video_stream, (k - 1)->second,
+                          AVSEEK_FLAG_BACKWARD);
+            return true;
+        }
+    }
     int64_t offset = time_stamp(frame);
     int flags      = AVSEEK_FLAG_BACKWARD;
     avcodec_flush_buffers(m_codec_context);
@@ -576,6 +639,51 @@ FFmpegInput::seek(int frame)
 
 
 
+void
+FFmpegInput::index_keyframes()
+{
+    // Only the packet headers are needed, so this is one pass of demuxing
+    // the file, without decoding anything.
+    m_keyframes_indexed = true;
+    seek(0);
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    while (av_read_frame(m_format_context, &pkt) >= 0) {
+        if (pkt.stream_index == m_video_stream && (pkt.flags & AV_PKT_FLAG_KEY)
+            && pkt.pts != int64_t(AV_NOPTS_VALUE))
+            m_keyframes.emplace_back(frame_number(pkt.pts), pkt.pts);
+        av_free_packet(&pkt);
+    }
+    std::sort(m_keyframes.begin(), m_keyframes.end());
+    // Reading the index moved the demuxer; put it back at the start.
+    seek(0);
+    m_last_decoded_pos = -1;
+}
+
+
+
+bool
+FFmpegInput::keyframe_between(int begin, int end) const
+{
+    if (m_keyframes.empty())
+        return true;  // Don't know, so seek
+    auto k = std::lower_bound(m_keyframes.begin(), m_keyframes.end(),
+                              std::make_pair(begin, min_pts));
+    return k != m_keyframes.end() && k->first <= end;
+}
+
+
+
+int
+FFmpegInput::frame_number(int64_t pts) const
+{
+    double t = av_q2d(m_format_context->streams[m_video_stream]->time_base)
+               * pts;
+    return int((t - m_start_time) * fps() + 0.5f);
+}
+
+
+
 int64_t
 FFmpegInput::time_stamp(int frame) const
 {
@@ -41,6 +41,11 @@
 #include <Field3D/MACField.h>
 #include <Field3D/SparseField.h>
 
+#if (100 * FIELD3D_MAJOR_VER + FIELD3D_MINOR_VER) >= 104
+#    include <Field3D/MIPField.h>
+#    define OIIO_FIELD3D_MIP 1
+#endif
+
 #ifndef FIELD3D_NS
 #    define FIELD3D_NS Field3D
 #endif
@@ -69,6 +74,10 @@ struct layerrecord {
     Box3i dataWindow;
     ImageSpec spec;
     FieldRes::Ptr field;
+    // The field and spec of each MIP level, starting with field and spec
+    // themselves. Only a MIP field has more than one.
+    std::vector<FieldRes::Ptr> mipfields;
+    std::vector<ImageSpec> mipspecs;
 
     layerrecord() {}
 };
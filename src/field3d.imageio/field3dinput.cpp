@@ -28,9 +28,11 @@
   (This is the Modified BSD License)
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
@@ -71,12 +73,19 @@ public:
         lock_guard lock(m_mutex);
         return m_subimage;
     }
+    virtual int current_miplevel(void) const override
+    {
+        lock_guard lock(m_mutex);
+        return m_miplevel;
+    }
     virtual bool seek_subimage(int subimage, int miplevel) override;
     virtual bool seek_subimage_nolock(int subimage, int miplevel);
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
     virtual bool read_native_tile(int subimage, int miplevel, int x, int y,
                                   int z, void* data) override;
+    virtual bool native_tile_constant(int subimage, int miplevel, int x,
+                                      int y, int z, void* value) override;
 
     /// Transform a world space position to local coordinates, using the
     /// mapping of the current subimage.
@@ -87,6 +96,7 @@ private:
     std::string m_name;
     std::unique_ptr<Field3DInputFile> m_input;
     int m_subimage;    ///< What subimage/field are we looking at?
+    int m_miplevel;    ///< What MIP level of it?
     int m_nsubimages;  ///< How many fields in the file?
     std::vector<layerrecord> m_layers;
     std::vector<unsigned char> m_scratch;  ///< Scratch space for us to use
@@ -98,11 +108,14 @@ private:
 
     template<typename T> bool readtile(int x, int y, int z, T* data);
 
+    template<typename T> bool emptyblock(int x, int y, int z, T* value);
+
     void init()
     {
         m_name.clear();
         ASSERT(!m_input);
         m_subimage   = -1;
+        m_miplevel   = -1;
         m_nsubimages = 0;
         m_layers.clear();
     }
@@ -158,7 +171,8 @@ blocksize(FieldRes::Ptr& f)
     typename SparseField<T>::Ptr sf(field_dynamic_cast<SparseField<T>>(f));
     if (sf)
         return sf->blockSize();
-    typename SparseField<T>::Ptr vsf(field_dynamic_cast<SparseField<T>>(f));
+    typename SparseField<FIELD3D_VEC3_T<T>>::Ptr vsf(
+        field_dynamic_cast<SparseField<FIELD3D_VEC3_T<T>>>(f));
     if (vsf)
         return vsf->blockSize();
     return 0;
@@ -166,6 +180,83 @@ blocksize(FieldRes::Ptr& f)
 
 
 
+// If the field is a MIP field (of dense or sparse fields), set the layer's
+// field type and record the field of each of its MIP levels, and return
+// true.
+template<typename Data_T>
+static bool
+read_mip_levels(FieldRes::Ptr field, layerrecord& lay)
+{
+#ifdef OIIO_FIELD3D_MIP
+    typename MIPField<DenseField<Data_T>>::Ptr mdf(
+        field_dynamic_cast<MIPField<DenseField<Data_T>>>(field));
+    typename MIPField<SparseField<Data_T>>::Ptr msf(
+        field_dynamic_cast<MIPField<SparseField<Data_T>>>(field));
+    if (mdf) {
+        lay.fieldtype = f3dpvt::Dense;
+        for (size_t m = 0; m < mdf->numLevels(); ++m)
+            lay.mipfields.push_back(mdf->concreteMipLevel(m));
+        return true;
+    }
+    if (msf) {
+        lay.fieldtype = f3dpvt::Sparse;
+        for (size_t m = 0; m < msf->numLevels(); ++m)
+            lay.mipfields.push_back(msf->concreteMipLevel(m));
+        return true;
+    }
+#endif
+    return false;
+}
+
+
+
+// Set the data and display windows and the tile size of a spec from the
+// field (or one MIP level of it).
+static void
+set_field_dims(ImageSpec& spec, FieldRes::Ptr field, TypeDesc datatype,
+               FieldType fieldtype)
+{
+    Box3i extents    = field->extents();
+    Box3i dataWindow = field->dataWindow();
+    spec.x           = dataWindow.min.x;
+    spec.y           = dataWindow.min.y;
+    spec.z           = dataWindow.min.z;
+    spec.width       = dataWindow.max.x - dataWindow.min.x + 1;
+    spec.height      = dataWindow.max.y - dataWindow.min.y + 1;
+    spec.depth       = dataWindow.max.z - dataWindow.min.z + 1;
+    spec.full_x      = extents.min.x;
+    spec.full_y      = extents.min.y;
+    spec.full_z      = extents.min.z;
+    spec.full_width  = extents.max.x - extents.min.x + 1;
+    spec.full_height = extents.max.y - extents.min.y + 1;
+    spec.full_depth  = extents.max.z - extents.min.z + 1;
+
+    // Always appear tiled
+    int b = 0;
+    if (fieldtype == f3dpvt::Sparse) {
+        if (datatype == TypeDesc::FLOAT)
+            b = blocksize<float>(field);
+        else if (datatype == TypeDesc::HALF)
+            b = blocksize<FIELD3D_NS::half>(field);
+        else if (datatype == TypeDesc::DOUBLE)
+            b = blocksize<double>(field);
+    }
+    if (b) {
+        // There was a block size found, so each tile is one block
+        spec.tile_width  = b;
+        spec.tile_height = b;
+        spec.tile_depth  = b;
+    } else {
+        // Make the tiles be the volume size
+        spec.tile_width  = spec.width;
+        spec.tile_height = spec.height;
+        spec.tile_depth  = spec.depth;
+    }
+    ASSERT(spec.tile_width > 0 && spec.tile_height > 0 && spec.tile_depth > 0);
+}
+
+
+
 template<class M>
 static void
 read_metadata(const M& meta, ImageSpec& spec)
@@ -203,12 +294,15 @@ void
 Field3DInput::read_one_layer(FieldRes::Ptr field, layerrecord& lay,
                              TypeDesc datatype, size_t layernum)
 {
+    // The field of a MIP layer is its finest level.
+    if (lay.mipfields.empty())
+        lay.mipfields.push_back(field);
     lay.name       = field->name;
     lay.attribute  = field->attribute;
     lay.datatype   = datatype;
-    lay.extents    = field->extents();
-    lay.dataWindow = field->dataWindow();
-    lay.field      = field;
+    lay.field      = lay.mipfields[0];
+    lay.extents    = lay.field->extents();
+    lay.dataWindow = lay.field->dataWindow();
 
     // Generate a unique name for the layer.  Field3D files can have
     // multiple partitions (aka fields) with the same name, and
@@ -240,48 +334,22 @@ Field3DInput::read_one_layer(FieldRes::Ptr field, layerrecord& lay,
         lay.spec.nchannels = 1;
     }
 
-    lay.spec.x           = lay.dataWindow.min.x;
-    lay.spec.y           = lay.dataWindow.min.y;
-    lay.spec.z           = lay.dataWindow.min.z;
-    lay.spec.width       = lay.dataWindow.max.x - lay.dataWindow.min.x + 1;
-    lay.spec.height      = lay.dataWindow.max.y - lay.dataWindow.min.y + 1;
-    lay.spec.depth       = lay.dataWindow.max.z - lay.dataWindow.min.z + 1;
-    lay.spec.full_x      = lay.extents.min.x;
-    lay.spec.full_y      = lay.extents.min.y;
-    lay.spec.full_z      = lay.extents.min.z;
-    lay.spec.full_width  = lay.extents.max.x - lay.extents.min.x + 1;
-    lay.spec.full_height = lay.extents.max.y - lay.extents.min.y + 1;
-    lay.spec.full_depth  = lay.extents.max.z - lay.extents.min.z + 1;
-
-    // Always appear tiled
-    int b = 0;
-    if (lay.fieldtype == f3dpvt::Sparse) {
-        if (datatype == TypeDesc::FLOAT)
-            b = blocksize<float>(field);
-        else if (datatype == TypeDesc::HALF)
-            b = blocksize<FIELD3D_NS::half>(field);
-        else if (datatype == TypeDesc::DOUBLE)
-            b = blocksize<double>(field);
-    }
-    if (b) {
-        // There was a block size found
-        lay.spec.tile_width  = b;
-        lay.spec.tile_height = b;
-        lay.spec.tile_depth  = b;
-    } else {
-        // Make the tiles be the volume size
-        lay.spec.tile_width  = lay.spec.width;
-        lay.spec.tile_height = lay.spec.height;
-        lay.spec.tile_depth  = lay.spec.depth;
-    }
-    ASSERT(lay.spec.tile_width > 0 && lay.spec.tile_height > 0
-           && lay.spec.tile_depth > 0);
+    set_field_dims(lay.spec, lay.field, datatype, lay.fieldtype);
 
     lay.spec.attribute("ImageDescription", lay.unique_name);
     lay.spec.attribute("oiio:subimagename", lay.unique_name);
     lay.spec.attribute("field3d:partition", lay.name);
     lay.spec.attribute("field3d:layer", lay.attribute);
-    lay.spec.attribute("field3d:fieldtype", field->className());
+    lay.spec.attribute("field3d:fieldtype", lay.field->className());
+    if (lay.fieldtype == f3dpvt::Sparse) {
+        // The value of unallocated blocks, unless the writer gave them
+        // another. The ImageCache asks for the value of each empty block
+        // rather than having it read, and texture3d lookups skip them.
+        std::vector<float> background(lay.spec.nchannels, 0.0f);
+        lay.spec.attribute("oiio:background",
+                           TypeDesc(TypeDesc::FLOAT, lay.spec.nchannels),
+                           background.data());
+    }
 
     FieldMapping::Ptr mapping = field->mapping();
     lay.spec.attribute("field3d:mapping", mapping->className());
@@ -305,6 +373,14 @@ Field3DInput::read_one_layer(FieldRes::Ptr field, layerrecord& lay,
     // Other metadata
     read_metadata(m_input->metadata(), lay.spec);  // global
     read_metadata(field->metadata(), lay.spec);    // specific to this field
+
+    // The coarser MIP levels differ only in their dimensions.
+    lay.mipspecs.assign(1, lay.spec);
+    for (size_t m = 1; m < lay.mipfields.size(); ++m) {
+        lay.mipspecs.push_back(lay.spec);
+        set_field_dims(lay.mipspecs.back(), lay.mipfields[m], datatype,
+                       lay.fieldtype);
+    }
 }
 
 
@@ -327,7 +403,7 @@ Field3DInput::read_layers(TypeDesc datatype)
                 lay.fieldtype = f3dpvt::Dense;
             else if (field_dynamic_cast<SparseField<Data_T>>(*i))
                 lay.fieldtype = f3dpvt::Sparse;
-            else
+            else if (!read_mip_levels<Data_T>(*i, lay))
                 ASSERT(0 && "unknown field type");
             read_one_layer(*i, lay, datatype, layernum);
         }
@@ -349,7 +425,7 @@ Field3DInput::read_layers(TypeDesc datatype)
                 lay.fieldtype = f3dpvt::Sparse;
             else if (field_dynamic_cast<MACField<VecData_T>>(*i))
                 lay.fieldtype = f3dpvt::MAC;
-            else
+            else if (!read_mip_levels<VecData_T>(*i, lay))
                 ASSERT(0 && "unknown field type");
             lay.vecfield = true;
             read_one_layer(*i, lay, datatype, layernum);
@@ -447,13 +523,15 @@ Field3DInput::seek_subimage_nolock(int subimage, int miplevel)
 {
     if (subimage < 0 || subimage >= m_nsubimages)  // out of range
         return false;
-    if (miplevel != 0)
+    const layerrecord& lay(m_layers[subimage]);
+    if (miplevel < 0 || miplevel >= int(lay.mipspecs.size()))
         return false;
-    if (subimage == m_subimage)
+    if (subimage == m_subimage && miplevel == m_miplevel)
         return true;
 
     m_subimage = subimage;
-    m_spec     = m_layers[subimage].spec;
+    m_miplevel = miplevel;
+    m_spec     = lay.mipspecs[miplevel];
     return true;
 }
 
@@ -498,25 +576,23 @@ template<class T>
 bool
 Field3DInput::readtile(int x, int y, int z, T* data)
 {
-    layerrecord& lay(m_layers[m_subimage]);
-    int xend = std::min(x + lay.spec.tile_width, lay.spec.x + lay.spec.width);
-    int yend = std::min(y + lay.spec.tile_height, lay.spec.y + lay.spec.height);
-    int zend = std::min(z + lay.spec.tile_depth, lay.spec.z + lay.spec.depth);
+    const layerrecord& lay(m_layers[m_subimage]);
+    const FieldRes::Ptr& field(lay.mipfields[m_miplevel]);
+    const ImageSpec& spec(m_spec);
+    int xend = std::min(x + spec.tile_width, spec.x + spec.width);
+    int yend = std::min(y + spec.tile_height, spec.y + spec.height);
+    int zend = std::min(z + spec.tile_depth, spec.z + spec.depth);
     {
         typename DenseField<T>::Ptr f = field_dynamic_cast<DenseField<T>>(
-            lay.field);
+            field);
         if (f) {
-            //std::cerr << "readtile dense " << x << '-' << xend << " x "
-            //        <<  y << '-' << yend << " x " << z << '-' << zend << "\n";
+            // Each row of the tile is contiguous in the field's storage.
             for (int k = z; k < zend; ++k) {
                 for (int j = y; j < yend; ++j) {
                     T* d = data
-                           + (k - z)
-                                 * (lay.spec.tile_width * lay.spec.tile_height)
-                           + (j - y) * lay.spec.tile_width;
-                    for (int i = x; i < xend; ++i, ++d) {
-                        *d = f->fastValue(i, j, k);
-                    }
+                           + (k - z) * (spec.tile_width * spec.tile_height)
+                           + (j - y) * spec.tile_width;
+                    memcpy(d, &f->fastValue(x, j, k), (xend - x) * sizeof(T));
                 }
             }
             return true;
@@ -524,21 +600,30 @@ Field3DInput::readtile(int x, int y, int z, T* data)
     }
     {
         typename SparseField<T>::Ptr f = field_dynamic_cast<SparseField<T>>(
-            lay.field);
+            field);
         if (f) {
-            //std::cerr << "readtile sparse " << x << '-' << xend << " x "
-            //        <<  y << '-' << yend << " x " << z << '-' << zend << "\n";
-            for (int k = z; k < zend; ++k) {
-                for (int j = y; j < yend; ++j) {
-                    T* d = data
-                           + (k - z)
-                                 * (lay.spec.tile_width * lay.spec.tile_height)
-                           + (j - y) * lay.spec.tile_width;
-                    for (int i = x; i < xend; ++i, ++d) {
-                        *d = f->fastValue(i, j, k);
+            // Tiles are normally blocks. An unallocated one is all one value;
+            // an allocated one is iterated, which pages it in from the
+            // file (if need be) just once, rather than voxel by voxel.
+            T empty;
+            if (emptyblock(x, y, z, &empty)) {
+                for (int k = z; k < zend; ++k) {
+                    for (int j = y; j < yend; ++j) {
+                        T* d = data
+                               + (k - z) * (spec.tile_width * spec.tile_height)
+                               + (j - y) * spec.tile_width;
+                        std::fill_n(d, xend - x, empty);
                     }
                 }
+                return true;
             }
+            Box3i region(V3i(x, y, z), V3i(xend - 1, yend - 1, zend - 1));
+            for (typename SparseField<T>::const_iterator v = f->cbegin(region),
+                                                          e = f->cend(region);
+                 v != e; ++v)
+                data[(v.z - z) * (spec.tile_width * spec.tile_height)
+                     + (v.y - y) * spec.tile_width + (v.x - x)]
+                    = *v;
             return true;
         }
     }
@@ -547,6 +632,28 @@ Field3DInput::readtile(int x, int y, int z, T* data)
 
 
 
+// If the tile at (x,y,z) of the current sparse field and MIP level is an
+// unallocated block, store the value of all its voxels and return true.
+template<class T>
+bool
+Field3DInput::emptyblock(int x, int y, int z, T* value)
+{
+    const layerrecord& lay(m_layers[m_subimage]);
+    typename SparseField<T>::Ptr f = field_dynamic_cast<SparseField<T>>(
+        lay.mipfields[m_miplevel]);
+    if (!f || m_spec.tile_width != f->blockSize())
+        return false;
+    int bi = (x - m_spec.x) / m_spec.tile_width;
+    int bj = (y - m_spec.y) / m_spec.tile_height;
+    int bk = (z - m_spec.z) / m_spec.tile_depth;
+    if (!f->blockIndexIsValid(bi, bj, bk) || f->blockIsAllocated(bi, bj, bk))
+        return false;
+    *value = f->getBlockEmptyValue(bi, bj, bk);
+    return true;
+}
+
+
+
 bool
 Field3DInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
                                void* data)
@@ -577,6 +684,38 @@ Field3DInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
 
 
 
+bool
+Field3DInput::native_tile_constant(int subimage, int miplevel, int x, int y,
+                                   int z, void* value)
+{
+    spin_lock lock(field3d_mutex());
+    if (!seek_subimage_nolock(subimage, miplevel))
+        return false;
+    layerrecord& lay(m_layers[m_subimage]);
+    if (lay.fieldtype != f3dpvt::Sparse)
+        return false;
+    if (lay.datatype == TypeDesc::FLOAT) {
+        if (lay.vecfield)
+            return emptyblock(x, y, z, (FIELD3D_VEC3_T<float>*)value);
+        else
+            return emptyblock(x, y, z, (float*)value);
+    } else if (lay.datatype == TypeDesc::HALF) {
+        if (lay.vecfield)
+            return emptyblock(x, y, z,
+                              (FIELD3D_VEC3_T<FIELD3D_NS::half>*)value);
+        else
+            return emptyblock(x, y, z, (FIELD3D_NS::half*)value);
+    } else if (lay.datatype == TypeDesc::DOUBLE) {
+        if (lay.vecfield)
+            return emptyblock(x, y, z, (FIELD3D_VEC3_T<double>*)value);
+        else
+            return emptyblock(x, y, z, (double*)value);
+    }
+    return false;
+}
+
+
+
 void
 Field3DInput::worldToLocal(const Imath::V3f& wsP, Imath::V3f& lsP,
                            float time) const
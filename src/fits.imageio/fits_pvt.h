@@ -79,6 +79,8 @@ public:
     virtual bool close(void) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
     virtual bool seek_subimage(int subimage, int miplevel) override;
     virtual int current_subimage() const override { return m_cur_subimage; }
 
@@ -114,6 +116,13 @@ private:
         m_sep = '\n';
     }
 
+    // read nrows scanlines of raw data, starting at the one stored
+    // first_row rows after the start of the image data
+    bool read_rows(long first_row, int nrows, void* data);
+
+    // FITS data is big-endian; swap n values in place if we aren't
+    void to_native_endian(void* data, size_t n) const;
+
     // read keywords from FITS header and add them to the ImageSpec
     // sets some ImageSpec fields: width, height, depth.
     // Return true if all is ok, false if there was a read error.
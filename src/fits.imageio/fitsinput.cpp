@@ -31,6 +31,9 @@
 
 #include <cctype>
 #include <cstdlib>
+#include <memory>
+
+#include <OpenImageIO/parallel.h>
 
 #include "fits_pvt.h"
 
@@ -128,40 +131,98 @@ FitsInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (!m_naxes)
         return true;
 
-    std::vector<unsigned char> data_tmp(m_spec.scanline_bytes());
-    long scanline_off = (m_spec.height - y) * m_spec.scanline_bytes();
-    fseek(m_fd, scanline_off, SEEK_CUR);
-    size_t n = fread(&data_tmp[0], 1, m_spec.scanline_bytes(), m_fd);
-    if (n != m_spec.scanline_bytes()) {
+    if (!read_rows(m_spec.height - y, 1, data))
+        return false;
+    to_native_endian(data, m_spec.width * m_spec.nchannels);
+    return true;
+};
+
+
+
+bool
+FitsInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                 int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+
+    // we return true just to support 0x0 images
+    if (!m_naxes)
+        return true;
+    yend = std::min(yend, m_spec.height);
+    if (ybegin >= yend)
+        return true;
+
+    // Scanline y is stored (height - y) rows into the data, so the
+    // requested scanlines are one contiguous run, just in reverse order.
+    // Read them all at once straight into data, then flip the rows and
+    // swap them to native endianness in parallel.
+    int nrows = yend - ybegin;
+    if (!read_rows(m_spec.height - (yend - 1), nrows, data))
+        return false;
+    size_t rowbytes = m_spec.scanline_bytes();
+    size_t rowvals  = size_t(m_spec.width) * m_spec.nchannels;
+    char* rows      = (char*)data;
+    parallel_for_chunked(
+        0, (nrows + 1) / 2, 0,
+        [&](int64_t b, int64_t e) {
+            std::unique_ptr<char[]> tmp(new char[rowbytes]);
+            for (int64_t i = b; i < e; ++i) {
+                char* top    = rows + i * rowbytes;
+                char* bottom = rows + (nrows - 1 - i) * rowbytes;
+                to_native_endian(top, rowvals);
+                if (bottom != top) {
+                    to_native_endian(bottom, rowvals);
+                    memcpy(tmp.get(), top, rowbytes);
+                    memcpy(top, bottom, rowbytes);
+                    memcpy(bottom, tmp.get(), rowbytes);
+                }
+            }
+        },
+        parallel_options(threads(), Split_Y, 64));
+    return true;
+}
+
+
+
+bool
+FitsInput::read_rows(long first_row, int nrows, void* data)
+{
+    size_t bytes = size_t(nrows) * m_spec.scanline_bytes();
+    fsetpos(m_fd, &m_filepos);
+    fseek(m_fd, first_row * long(m_spec.scanline_bytes()), SEEK_CUR);
+    size_t n = fread(data, 1, bytes, m_fd);
+    // after reading we set file pointer to the start of image data
+    fsetpos(m_fd, &m_filepos);
+    if (n != bytes) {
         if (feof(m_fd))
             error("Hit end of file unexpectedly");
         else
             error("read error");
         return false;  // Read failed
     }
+    return true;
+}
 
+
+
+void
+FitsInput::to_native_endian(void* data, size_t n) const
+{
     // in FITS image data is stored in big-endian so we have to switch to
     // little-endian on little-endian machines
     if (littleendian()) {
         if (m_spec.format == TypeDesc::USHORT)
-            swap_endian((unsigned short*)&data_tmp[0],
-                        data_tmp.size() / sizeof(unsigned short));
+            swap_endian((unsigned short*)data, n);
         else if (m_spec.format == TypeDesc::UINT)
-            swap_endian((unsigned int*)&data_tmp[0],
-                        data_tmp.size() / sizeof(unsigned int));
+            swap_endian((unsigned int*)data, n);
         else if (m_spec.format == TypeDesc::FLOAT)
-            swap_endian((float*)&data_tmp[0], data_tmp.size() / sizeof(float));
+            swap_endian((float*)data, n);
         else if (m_spec.format == TypeDesc::DOUBLE)
-            swap_endian((double*)&data_tmp[0],
-                        data_tmp.size() / sizeof(double));
+            swap_endian((double*)data, n);
     }
-
-    memcpy(data, &data_tmp[0], data_tmp.size());
-
-    // after reading scanline we set file pointer to the start of image data
-    fsetpos(m_fd, &m_filepos);
-    return true;
-};
+}
 
 
 
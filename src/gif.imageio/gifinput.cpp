@@ -28,11 +28,13 @@
   (This is the Modified BSD License)
 */
 
+#include <cstdio>
 #include <memory>
 #include <vector>
 
 #include <gif_lib.h>
 
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/thread.h>
 
@@ -62,6 +64,8 @@ public:
     virtual ~GIFInput() { close(); }
     virtual const char* format_name(void) const override { return "gif"; }
     virtual bool open(const std::string& name, ImageSpec& newspec) override;
+    virtual bool open(const std::string& name, ImageSpec& newspec,
+                      const ImageSpec& config) override;
     virtual bool close(void) override;
     virtual bool seek_subimage(int subimage, int miplevel) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
@@ -79,7 +83,21 @@ public:
     }
 
 private:
+    // What we learn about each frame by skimming the file in open(),
+    // without decoding any pixels.
+    struct FrameInfo {
+        int64_t offset;     ///< File position of the frame's first record
+        int disposal;       ///< Disposal method (applies before next frame)
+        bool opaque_full;   ///< Covers the canvas with no transparency, so
+                            ///  looks the same whatever came before it
+    };
+
+    // Keep a copy of the composited canvas of every this-many-th frame
+    // we draw, so seeking anywhere needs at most this many decodes.
+    static const int keyframe_interval = 8;
+
     std::string m_filename;          ///< Stash the filename
+    FILE* m_file;                    ///< Open file, read by GIFLIB
     GifFileType* m_gif_file;         ///< GIFLIB handle
     int m_transparent_color;         ///< Transparent color index
     int m_subimage;                  ///< Current subimage index
@@ -92,6 +110,9 @@ private:
     std::vector<unsigned char> m_canvas;  ///< Image canvas in output format, on
                                           ///  which subimages are sequentially
                                           ///  drawn.
+    std::vector<FrameInfo> m_frames;      ///< Index of all the frames
+    std::vector<std::vector<unsigned char>> m_keyframes;  ///< Kept canvases
+    bool m_header_only;  ///< Opened with "oiio:HeaderOnly": never draw
 
     /// Reset everything to initial state
     ///
@@ -105,6 +126,19 @@ private:
     ///
     bool read_subimage_data(void);
 
+    /// Skim all the records of the file to fill in m_frames.
+    ///
+    bool build_frame_index(void);
+
+    /// Jump to frame i and read its metadata into m_spec, and if draw is
+    /// true, also draw it on the canvas, which must hold the result of
+    /// all the frames before it.
+    bool read_frame(int i, bool draw);
+
+    /// GIFLIB input callback, reading from our FILE.
+    ///
+    static int read_file(GifFileType* gif, GifByteType* buf, int len);
+
     /// Helper: read gif extension.
     ///
     void read_gif_extension(int ext_code, GifByteType* ext, ImageSpec& spec);
@@ -151,17 +185,31 @@ OIIO_PLUGIN_EXPORTS_END
 void
 GIFInput::init(void)
 {
-    m_gif_file = NULL;
+    m_file        = NULL;
+    m_gif_file    = NULL;
+    m_header_only = false;
 }
 
 
 
 bool
 GIFInput::open(const std::string& name, ImageSpec& newspec)
+{
+    ImageSpec config;
+    return open(name, newspec, config);
+}
+
+
+
+bool
+GIFInput::open(const std::string& name, ImageSpec& newspec,
+               const ImageSpec& config)
 {
     m_filename = name;
     m_subimage = -1;
     m_canvas.clear();
+    // Only the metadata is wanted, so don't decode any frames.
+    m_header_only = config.get_int_attribute("oiio:HeaderOnly") != 0;
 
     bool ok = seek_subimage(0, 0);
     newspec = spec();
@@ -194,6 +242,10 @@ GIFInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (!seek_subimage(subimage, miplevel))
         return false;
 
+    if (m_header_only) {
+        error("\"%s\" was opened for its header only", m_filename.c_str());
+        return false;
+    }
     if (y < 0 || y > m_spec.height || !m_canvas.size())
         return false;
 
@@ -363,6 +415,122 @@ GIFInput::read_subimage_data()
 
 
 
+int
+GIFInput::read_file(GifFileType* gif, GifByteType* buf, int len)
+{
+    return int(fread(buf, 1, len, (FILE*)gif->UserData));
+}
+
+
+
+bool
+GIFInput::build_frame_index()
+{
+    // Every frame record is preceded by optional extension records; the
+    // graphics control one holds the disposal method and the transparent
+    // color.  The image data itself we skip block by block, which costs
+    // no decompression.
+    m_frames.clear();
+    int64_t offset = ftell(m_file);
+    int disposal = DISPOSAL_UNSPECIFIED, transparent = -1;
+    GifRecordType rectype;
+    do {
+        if (DGifGetRecordType(m_gif_file, &rectype) == GIF_ERROR) {
+            report_last_error();
+            return false;
+        }
+        if (rectype == IMAGE_DESC_RECORD_TYPE) {
+            if (DGifGetImageDesc(m_gif_file) == GIF_ERROR) {
+                report_last_error();
+                return false;
+            }
+            const GifImageDesc& image(m_gif_file->Image);
+            FrameInfo frame;
+            frame.offset      = offset;
+            frame.disposal    = disposal;
+            frame.opaque_full = transparent < 0 && image.Left <= 0
+                                && image.Top <= 0
+                                && image.Left + image.Width
+                                       >= m_gif_file->SWidth
+                                && image.Top + image.Height
+                                       >= m_gif_file->SHeight;
+            m_frames.push_back(frame);
+            int codesize;
+            GifByteType* block;
+            if (DGifGetCode(m_gif_file, &codesize, &block) == GIF_ERROR) {
+                report_last_error();
+                return false;
+            }
+            while (block) {
+                if (DGifGetCodeNext(m_gif_file, &block) == GIF_ERROR) {
+                    report_last_error();
+                    return false;
+                }
+            }
+            offset      = ftell(m_file);
+            disposal    = DISPOSAL_UNSPECIFIED;
+            transparent = -1;
+        } else if (rectype == EXTENSION_RECORD_TYPE) {
+            int ext_code;
+            GifByteType* ext;
+            if (DGifGetExtension(m_gif_file, &ext_code, &ext) == GIF_ERROR) {
+                report_last_error();
+                return false;
+            }
+            while (ext != NULL) {
+                if (ext_code == GRAPHICS_EXT_FUNC_CODE && ext[0] >= 4) {
+                    disposal    = (ext[1] & 0x1c) >> 2;
+                    transparent = (ext[1] & 0x01) ? int(ext[4]) : -1;
+                }
+                if (DGifGetExtensionNext(m_gif_file, &ext) == GIF_ERROR) {
+                    report_last_error();
+                    return false;
+                }
+            }
+        }
+    } while (rectype != TERMINATE_RECORD_TYPE);
+    m_keyframes.clear();
+    m_keyframes.resize((m_frames.size() + keyframe_interval - 1)
+                       / keyframe_interval);
+    return true;
+}
+
+
+
+bool
+GIFInput::read_frame(int i, bool draw)
+{
+    if (fseek(m_file, long(m_frames[i].offset), SEEK_SET) != 0) {
+        error("Could not seek to subimage %d", i);
+        return false;
+    }
+    m_disposal_method = i > 0 ? m_frames[i - 1].disposal
+                              : DISPOSAL_UNSPECIFIED;
+    m_subimage = i;
+    if (!read_subimage_metadata(m_spec))
+        return false;
+
+    m_spec.width       = m_gif_file->SWidth;
+    m_spec.height      = m_gif_file->SHeight;
+    m_spec.depth       = 1;
+    m_spec.full_height = m_spec.height;
+    m_spec.full_width  = m_spec.width;
+    m_spec.full_depth  = m_spec.depth;
+
+    if (!draw)
+        return true;
+    if (!read_subimage_data())
+        return false;
+    if (i % keyframe_interval == 0) {
+        auto& keyframe(m_keyframes[i / keyframe_interval]);
+        if (keyframe.empty())
+            keyframe = m_canvas;
+    }
+    return true;
+}
+
+
+
 bool
 GIFInput::seek_subimage(int subimage, int miplevel)
 {
@@ -374,62 +542,67 @@ GIFInput::seek_subimage(int subimage, int miplevel)
         return true;
     }
 
-    if (m_subimage > subimage) {
-        // requested subimage is located before the current one
-        // file needs to be reopened
-        if (m_gif_file && !close()) {
+    if (!m_gif_file) {
+        m_file = Filesystem::fopen(m_filename, "rb");
+        if (!m_file) {
+            error("Could not open file \"%s\"", m_filename.c_str());
             return false;
         }
-    }
-
-    if (!m_gif_file) {
 #if GIFLIB_MAJOR >= 5
         int giflib_error;
-        if (!(m_gif_file = DGifOpenFileName(m_filename.c_str(),
-                                            &giflib_error))) {
+        if (!(m_gif_file = DGifOpen(m_file, read_file, &giflib_error))) {
             error(GifErrorString(giflib_error));
+            close();
             return false;
         }
 #else
-        if (!(m_gif_file = DGifOpenFileName(m_filename.c_str()))) {
+        if (!(m_gif_file = DGifOpen(m_file, read_file))) {
             error("Error trying to open the file.");
+            close();
             return false;
         }
 #endif
 
         m_subimage = -1;
-        m_canvas.resize(m_gif_file->SWidth * m_gif_file->SHeight * 4);
-    }
-
-    // skip subimages preceding the requested one
-    if (m_subimage < subimage) {
-        for (m_subimage += 1; m_subimage < subimage; m_subimage++) {
-            if (!read_subimage_metadata(m_spec) || !read_subimage_data()) {
-                return false;
-            }
+        if (!m_header_only)
+            m_canvas.resize(m_gif_file->SWidth * m_gif_file->SHeight * 4);
+        if (!build_frame_index()) {
+            close();
+            return false;
         }
     }
 
-    // read metadata of current subimage
-    if (!read_subimage_metadata(m_spec)) {
-        return false;
-    }
-
-    m_spec.width       = m_gif_file->SWidth;
-    m_spec.height      = m_gif_file->SHeight;
-    m_spec.depth       = 1;
-    m_spec.full_height = m_spec.height;
-    m_spec.full_width  = m_spec.width;
-    m_spec.full_depth  = m_spec.depth;
-
-    m_subimage = subimage;
-
-    // draw subimage on canvas
-    if (!read_subimage_data()) {
+    if (subimage >= int(m_frames.size()))
         return false;
+    if (m_header_only)
+        return read_frame(subimage, false);
+
+    // Find the latest point at or before the requested frame from which
+    // we can draw it: the canvas we already have, a kept keyframe, or a
+    // frame that doesn't depend on the ones before it at all.
+    int first = 0;  // first frame we'll have to draw
+    if (m_subimage >= 0 && m_subimage < subimage)
+        first = m_subimage + 1;
+    int key = subimage / keyframe_interval;
+    if (key * keyframe_interval >= first && !m_keyframes[key].empty())
+        first = key * keyframe_interval + 1;
+    else
+        key = -1;
+    for (int i = subimage; i > first; --i) {
+        if (m_frames[i - 1].disposal == DISPOSE_BACKGROUND
+            || m_frames[i].opaque_full) {
+            first = i;
+            key   = -1;
+            break;
+        }
     }
+    if (key >= 0)
+        m_canvas = m_keyframes[key];
 
-    return true;
+    for (int i = first; i < subimage; ++i)
+        if (!read_frame(i, true))
+            return false;
+    return read_frame(subimage, first <= subimage);
 }
 
 
@@ -473,7 +646,13 @@ GIFInput::close(void)
         }
         m_gif_file = NULL;
     }
+    if (m_file) {
+        fclose(m_file);
+        m_file = NULL;
+    }
     m_canvas.clear();
+    m_frames.clear();
+    m_keyframes.clear();
 
     return true;
 }
@@ -29,6 +29,7 @@
 */
 
 
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 #include <iostream>
@@ -36,6 +37,7 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 
 #include "rgbe.h"
 
@@ -64,6 +66,8 @@ public:
     virtual bool open(const std::string& name, ImageSpec& spec) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
     virtual bool close() override;
     virtual int current_subimage(void) const override { return m_subimage; }
     virtual bool seek_subimage(int subimage, int miplevel) override;
@@ -73,14 +77,30 @@ private:
     FILE* m_fd;              ///< The open file handle
     int m_subimage;          ///< What subimage are we looking at?
     int m_next_scanline;     ///< Next scanline to read
+    long m_data_offset;      ///< File position of the pixel data
     char rgbe_error[1024];   ///< Buffer for RGBE library error msgs
+    std::vector<unsigned char> m_pixels;  ///< All encoded pixel data
+    std::vector<size_t> m_offsets;        ///< Where each scanline starts
+    int m_num_rle;  ///< How many scanlines (from the top) are RLE
 
     void init()
     {
         m_fd            = NULL;
         m_subimage      = -1;
         m_next_scanline = 0;
+        m_data_offset   = 0;
+        m_num_rle       = 0;
+        std::vector<unsigned char>().swap(m_pixels);
+        std::vector<size_t>().swap(m_offsets);
     }
+
+    // Read all the encoded pixel data into memory and find where each
+    // scanline starts, so that scanlines may be decoded in any order
+    // and in parallel.
+    bool load_pixels();
+
+    // Decode scanline y (relative to the top of the image) from m_pixels.
+    bool decode_scanline(int y, float* out, char* errbuf) const;
 };
 
 
@@ -171,6 +191,7 @@ HdrInput::seek_subimage(int subimage, int miplevel)
     }
     if (h.valid & RGBE_VALID_ORIENTATION)
         m_spec.attribute("Orientation", h.orientation);
+    m_data_offset = ftell(m_fd);
 
     // FIXME -- should we do anything about exposure, software,
     // pixaspect, primaries?  (N.B. rgbe.c doesn't even handle most of them)
@@ -190,17 +211,17 @@ HdrInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (!seek_subimage(subimage, miplevel))
         return false;
 
-    if (m_next_scanline > y) {
+    if (m_next_scanline > y || m_offsets.size()) {
         // User is trying to read an earlier scanline than the one we're
-        // up to.  Easy fix: close the file and re-open.
-        ImageSpec dummyspec;
-        int subimage = current_subimage();
-        int miplevel = current_miplevel();
-        if (!close() || !open(m_filename, dummyspec)
-            || !seek_subimage(subimage, miplevel))
-            return false;  // Somehow, the re-open failed
-        assert(m_next_scanline == 0 && current_subimage() == subimage
-               && current_miplevel() == miplevel);
+        // up to, or we already have all the pixels in memory: decode
+        // straight from the in-memory copy.
+        if (!load_pixels())
+            return false;
+        if (!decode_scanline(y - m_spec.y, (float*)data, rgbe_error)) {
+            error("%s", rgbe_error);
+            return false;
+        }
+        return true;
     }
     while (m_next_scanline <= y) {
         // Keep reading until we're read the scanline we really need
@@ -217,6 +238,97 @@ HdrInput::read_native_scanline(int subimage, int miplevel, int y, int z,
 
 
 
+bool
+HdrInput::load_pixels()
+{
+    if (m_offsets.size())
+        return true;  // Already done
+    long pos = ftell(m_fd);
+    if (pos < 0 || fseek(m_fd, 0, SEEK_END) != 0) {
+        error("Could not read pixels of \"%s\"", m_filename.c_str());
+        return false;
+    }
+    long end = ftell(m_fd);
+    m_pixels.resize(size_t(std::max(end - m_data_offset, 0L)));
+    bool ok = fseek(m_fd, m_data_offset, SEEK_SET) == 0
+              && fread(m_pixels.data(), 1, m_pixels.size(), m_fd)
+                     == m_pixels.size();
+    // Leave the file where the sequential reader expects it
+    ok &= (fseek(m_fd, pos, SEEK_SET) == 0);
+    if (!ok) {
+        error("Could not read pixels of \"%s\"", m_filename.c_str());
+        std::vector<unsigned char>().swap(m_pixels);
+        return false;
+    }
+    std::vector<size_t> offsets(m_spec.height);
+    int r = RGBE_ScanlineOffsets(m_pixels.data(), m_pixels.size(),
+                                 m_spec.width, m_spec.height, offsets.data(),
+                                 &m_num_rle, rgbe_error);
+    if (r != RGBE_RETURN_SUCCESS) {
+        error("%s", rgbe_error);
+        std::vector<unsigned char>().swap(m_pixels);
+        return false;
+    }
+    m_offsets.swap(offsets);
+    return true;
+}
+
+
+
+bool
+HdrInput::decode_scanline(int y, float* out, char* errbuf) const
+{
+    size_t begin = m_offsets[y];
+    size_t end   = y + 1 < m_spec.height ? m_offsets[y + 1] : m_pixels.size();
+    return RGBE_DecodePixels_RLE(&m_pixels[begin], end - begin, y < m_num_rle,
+                                 out, m_spec.width, errbuf)
+           == RGBE_RETURN_SUCCESS;
+}
+
+
+
+bool
+HdrInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    yend = std::min(yend, m_spec.y + m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    if (!load_pixels())
+        return false;
+
+    // Scanlines decode independently of each other once we know where
+    // they start, so do them in parallel, straight into the caller's
+    // buffer.
+    const size_t outbytes = m_spec.scanline_bytes(true);
+    std::atomic<bool> ok(true);
+    std::string err;
+    std::mutex errmutex;
+    parallel_for_chunked(
+        ybegin, yend, 0,
+        [&](int64_t b, int64_t e) {
+            char errbuf[1024];
+            for (int64_t y = b; y < e && ok; ++y) {
+                float* out = (float*)((char*)data + (y - ybegin) * outbytes);
+                if (!decode_scanline(int(y) - m_spec.y, out, errbuf)) {
+                    std::lock_guard<std::mutex> lock(errmutex);
+                    if (ok)
+                        err = errbuf;
+                    ok = false;
+                }
+            }
+        },
+        parallel_options(threads(), Split_Y, 16));
+    if (!ok)
+        error("%s", err);
+    return ok;
+}
+
+
+
 bool
 HdrInput::close()
 {
@@ -37,6 +37,7 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -50,6 +51,9 @@ public:
                       OpenMode mode) override;
     virtual bool write_scanline(int y, int z, TypeDesc format, const void* data,
                                 stride_t xstride) override;
+    virtual bool write_scanlines(int ybegin, int yend, int z, TypeDesc format,
+                                 const void* data, stride_t xstride,
+                                 stride_t ystride) override;
     virtual bool write_tile(int x, int y, int z, TypeDesc format,
                             const void* data, stride_t xstride,
                             stride_t ystride, stride_t zstride) override;
@@ -163,6 +167,45 @@ HdrOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
 
 
 
+bool
+HdrOutput::write_scanlines(int ybegin, int yend, int z, TypeDesc format,
+                           const void* data, stride_t xstride,
+                           stride_t ystride)
+{
+    stride_t native_pixel_bytes = (stride_t)m_spec.pixel_bytes(true);
+    if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+        xstride = native_pixel_bytes;
+    stride_t zstride = AutoStride;
+    m_spec.auto_stride(xstride, ystride, zstride, format, m_spec.nchannels,
+                       m_spec.width, yend - ybegin);
+
+    // Convert and encode each scanline into its own buffer in parallel,
+    // then write them out in order.
+    std::vector<std::vector<unsigned char>> encoded(yend - ybegin);
+    parallel_for_chunked(
+        ybegin, yend, 0,
+        [&](int64_t b, int64_t e) {
+            std::vector<unsigned char> scratch;
+            for (int64_t y = b; y < e; ++y) {
+                const void* d = (const char*)data + (y - ybegin) * ystride;
+                d = to_native_scanline(format, d, xstride, scratch);
+                RGBE_EncodePixels_RLE((const float*)d, m_spec.width,
+                                      encoded[y - ybegin]);
+            }
+        },
+        parallel_options(threads(), Split_Y, 16));
+
+    for (auto& e : encoded) {
+        if (fwrite(e.data(), 1, e.size(), m_fd) != e.size()) {
+            error("Error writing HDR scanlines");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
 bool
 HdrOutput::write_tile(int x, int y, int z, TypeDesc format, const void* data,
                       stride_t xstride, stride_t ystride, stride_t zstride)
@@ -187,7 +230,8 @@ HdrOutput::close()
         // We've been emulating tiles; now dump as scanlines.
         ASSERT(m_tilebuffer.size());
         ok &= write_scanlines(m_spec.y, m_spec.y + m_spec.height, 0,
-                              m_spec.format, &m_tilebuffer[0]);
+                              m_spec.format, &m_tilebuffer[0], AutoStride,
+                              AutoStride);
         std::vector<unsigned char>().swap(m_tilebuffer);
     }
 
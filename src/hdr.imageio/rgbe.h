@@ -13,6 +13,7 @@
 */
 
 #include <cstdio>
+#include <vector>
 
 #include <OpenImageIO/imageio.h>
 
@@ -65,6 +66,19 @@ int RGBE_WritePixels_RLE(FILE *fp, float *data, int scanline_width,
 int RGBE_ReadPixels_RLE(FILE *fp, float *data, int scanline_width,
 			int num_scanlines, char *errbuf=NULL);
 
+/* (LG) decode or encode pixel data held in memory */
+/* find where each scanline starts in the pixel data following the
+   header, and how many of them (from the start) are run length encoded */
+int RGBE_ScanlineOffsets(const unsigned char *data, size_t size,
+                         int scanline_width, int num_scanlines,
+                         size_t *offsets, int *num_rle, char *errbuf=NULL);
+/* decode the one scanline starting at data */
+int RGBE_DecodePixels_RLE(const unsigned char *data, size_t size, int rle,
+                          float *out, int scanline_width, char *errbuf=NULL);
+/* append one run length encoded scanline to out */
+int RGBE_EncodePixels_RLE(const float *data, int scanline_width,
+                          std::vector<unsigned char> &out);
+
 OIIO_PLUGIN_NAMESPACE_END
 
 #endif /* _H_RGBE */
@@ -34,6 +34,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,8 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 
 
@@ -72,6 +75,8 @@ static bool rotcw = false, rotccw = false, rot180 = false;
 static bool sRGB     = false;
 static bool separate = false, contig = false;
 static bool noclobber = false;
+static std::string pairlist;
+static int njobs = 0;
 
 
 
@@ -93,12 +98,15 @@ getargs(int argc, char* argv[])
     // clang-format off
     ap.options ("iconvert -- copy images with format conversions and other alterations\n"
                 OIIO_INTRO_STRING "\n"
-                "Usage:  iconvert [options] inputfile outputfile\n"
+                "Usage:  iconvert [options] inputfile outputfile...\n"
+                "   or:  iconvert [options] --list pairfile\n"
                 "   or:  iconvert --inplace [options] file...\n",
                 "%*", parse_files, "",
                 "--help", &help, "Print help message",
                 "-v", &verbose, "Verbose status messages",
                 "--threads %d", &nthreads, "Number of threads (default 0 = #cores)",
+                "-j %d", &njobs, "Number of files to convert at once (default: 0 = #cores)",
+                "--list %s", &pairlist, "Convert the input and output files named on each line of this file",
                 "-d %s", &dataformatname, "Set the output data format to one of:"
                         "uint8, sint8, uint10, uint12, uint16, sint16, half, float, double",
                 "-g %f", &gammaval, "Set gamma correction (default = 1)",
@@ -135,13 +143,14 @@ getargs(int argc, char* argv[])
         exit(EXIT_FAILURE);
     }
 
-    if (filenames.size() != 2 && !inplace) {
+    if (!inplace
+        && (filenames.size() % 2 || (filenames.empty() && pairlist.empty()))) {
         std::cerr
             << "iconvert: Must have both an input and output filename specified.\n";
         ap.usage();
         exit(EXIT_FAILURE);
     }
-    if (filenames.size() == 0 && inplace) {
+    if (filenames.size() == 0 && pairlist.empty() && inplace) {
         std::cerr << "iconvert: Must have at least one filename\n";
         ap.usage();
         exit(EXIT_FAILURE);
@@ -276,16 +285,16 @@ adjust_spec(ImageInput* in, ImageOutput* out, const ImageSpec& inspec,
     if (orientation >= 1)
         outspec.attribute("Orientation", orientation);
     else {
-        orientation = outspec.get_int_attribute("Orientation", 1);
-        if (orientation >= 1 && orientation <= 8) {
+        int orient = outspec.get_int_attribute("Orientation", 1);
+        if (orient >= 1 && orient <= 8) {
             static int cw[] = { 0, 6, 7, 8, 5, 2, 3, 4, 1 };
             if (rotcw || rotccw || rot180)
-                orientation = cw[orientation];
+                orient = cw[orient];
             if (rotccw || rot180)
-                orientation = cw[orientation];
+                orient = cw[orient];
             if (rotccw)
-                orientation = cw[orientation];
-            outspec.attribute("Orientation", orientation);
+                orient = cw[orient];
+            outspec.attribute("Orientation", orient);
         }
     }
 
@@ -321,18 +330,20 @@ adjust_spec(ImageInput* in, ImageOutput* out, const ImageSpec& inspec,
 
 
 
+// Convert in_filename to out_filename, printing messages to msg (and
+// errors and warnings to errmsg).
 static bool
-convert_file(const std::string& in_filename, const std::string& out_filename)
+convert_file(const std::string& in_filename, const std::string& out_filename,
+             std::ostream& msg, std::ostream& errmsg)
 {
     if (noclobber && Filesystem::exists(out_filename)) {
-        std::cerr << "iconvert ERROR: Output file already exists \""
-                  << out_filename << "\"\n";
+        errmsg << "iconvert ERROR: Output file already exists \""
+               << out_filename << "\"\n";
         return false;
     }
 
     if (verbose)
-        std::cout << "Converting " << in_filename << " to " << out_filename
-                  << "\n";
+        msg << "Converting " << in_filename << " to " << out_filename << "\n";
 
     std::string tempname = out_filename;
     if (tempname == in_filename) {
@@ -343,11 +354,11 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
     auto in = ImageInput::open(in_filename);
     if (!in) {
         std::string err = geterror();
-        std::cerr << "iconvert ERROR: "
-                  << (err.length() ? err
-                                   : Strutil::sprintf("Could not open \"%s\"",
-                                                      in_filename))
-                  << "\n";
+        errmsg << "iconvert ERROR: "
+               << (err.length() ? err
+                                : Strutil::sprintf("Could not open \"%s\"",
+                                                   in_filename))
+               << "\n";
         return false;
     }
     ImageSpec inspec         = in->spec();
@@ -356,9 +367,8 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
     // Find an ImageIO plugin that can open the output file, and open it
     auto out = ImageOutput::create(tempname);
     if (!out) {
-        std::cerr
-            << "iconvert ERROR: Could not find an ImageIO plugin to write \""
-            << out_filename << "\" :" << geterror() << "\n";
+        errmsg << "iconvert ERROR: Could not find an ImageIO plugin to write \""
+               << out_filename << "\" :" << geterror() << "\n";
         return false;
     }
 
@@ -388,9 +398,9 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
     for (int subimage = 0; ok && in->seek_subimage(subimage, 0, inspec);
          ++subimage) {
         if (subimage > 0 && !out->supports("multiimage")) {
-            std::cerr << "iconvert WARNING: " << out->format_name()
-                      << " does not support multiple subimages.\n";
-            std::cerr << "\tOnly the first subimage has been copied.\n";
+            errmsg << "iconvert WARNING: " << out->format_name()
+                   << " does not support multiple subimages.\n";
+            errmsg << "\tOnly the first subimage has been copied.\n";
             break;  // we're done
         }
 
@@ -409,16 +419,15 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
                     mode = ImageOutput::AppendSubimage;  // use if we must
                     if (!mip_to_subimage_warning
                         && strcmp(out->format_name(), "tiff")) {
-                        std::cerr << "iconvert WARNING: " << out->format_name()
-                                  << " does not support MIPmaps.\n";
-                        std::cerr
-                            << "\tStoring the MIPmap levels in subimages.\n";
+                        errmsg << "iconvert WARNING: " << out->format_name()
+                               << " does not support MIPmaps.\n";
+                        errmsg << "\tStoring the MIPmap levels in subimages.\n";
                     }
                     mip_to_subimage_warning = true;
                 } else {
-                    std::cerr << "iconvert WARNING: " << out->format_name()
-                              << " does not support MIPmaps.\n";
-                    std::cerr << "\tOnly the first level has been copied.\n";
+                    errmsg << "iconvert WARNING: " << out->format_name()
+                           << " does not support MIPmaps.\n";
+                    errmsg << "\tOnly the first level has been copied.\n";
                     break;  // on to the next subimage
                 }
                 ok = out->open(tempname.c_str(), outspec, mode);
@@ -437,12 +446,12 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
             }
             if (!ok) {
                 std::string err = out->geterror();
-                std::cerr << "iconvert ERROR: "
-                          << (err.length()
-                                  ? err
-                                  : Strutil::sprintf("Could not open \"%s\"",
-                                                     out_filename))
-                          << "\n";
+                errmsg << "iconvert ERROR: "
+                       << (err.length()
+                               ? err
+                               : Strutil::sprintf("Could not open \"%s\"",
+                                                  out_filename))
+                       << "\n";
                 ok = false;
                 break;
             }
@@ -450,22 +459,22 @@ convert_file(const std::string& in_filename, const std::string& out_filename)
             if (!nocopy) {
                 ok = out->copy_image(in.get());
                 if (!ok)
-                    std::cerr << "iconvert ERROR copying \"" << in_filename
-                              << "\" to \"" << out_filename << "\" :\n\t"
-                              << out->geterror() << "\n";
+                    errmsg << "iconvert ERROR copying \"" << in_filename
+                           << "\" to \"" << out_filename << "\" :\n\t"
+                           << out->geterror() << "\n";
             } else {
                 // Need to do it by hand for some reason.  Future expansion in which
                 // only a subset of channels are copied, or some such.
                 std::vector<char> pixels((size_t)outspec.image_bytes(true));
                 ok = in->read_image(outspec.format, &pixels[0]);
                 if (!ok) {
-                    std::cerr << "iconvert ERROR reading \"" << in_filename
-                              << "\" : " << in->geterror() << "\n";
+                    errmsg << "iconvert ERROR reading \"" << in_filename
+                           << "\" : " << in->geterror() << "\n";
                 } else {
                     ok = out->write_image(outspec.format, &pixels[0]);
                     if (!ok)
-                        std::cerr << "iconvert ERROR writing \"" << out_filename
-                                  << "\" : " << out->geterror() << "\n";
+                        errmsg << "iconvert ERROR writing \"" << out_filename
+                               << "\" : " << out->geterror() << "\n";
                 }
             }
 
@@ -509,13 +518,59 @@ main(int argc, char* argv[])
 
     OIIO::attribute("threads", nthreads);
 
-    bool ok = true;
+    // The files to convert: the pairs on the command line, or on each
+    // line of the --list file (or single files, for --inplace).
+    if (pairlist.size()) {
+        std::string contents;
+        if (!Filesystem::read_text_file(pairlist, contents)) {
+            std::cerr << "iconvert ERROR: Could not read \"" << pairlist
+                      << "\"\n";
+            return EXIT_FAILURE;
+        }
+        for (string_view line : Strutil::splitsv(contents, "\n")) {
+            line = Strutil::strip(line);
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::vector<std::string> names = Strutil::splits(line);
+            if (names.size() != (inplace ? 1 : 2)) {
+                std::cerr << "iconvert ERROR: Expected "
+                          << (inplace ? "one filename" : "two filenames")
+                          << " per line of \"" << pairlist << "\", found \""
+                          << line << "\"\n";
+                return EXIT_FAILURE;
+            }
+            filenames.insert(filenames.end(), names.begin(), names.end());
+        }
+    }
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (size_t i = 0; i < filenames.size(); i += (inplace ? 1 : 2))
+        pairs.emplace_back(filenames[i], filenames[inplace ? i : i + 1]);
 
-    if (inplace) {
-        for (auto&& s : filenames)
-            ok &= convert_file(s, s);
+    bool ok = true;
+    if (pairs.size() == 1) {
+        ok = convert_file(pairs[0].first, pairs[0].second, std::cout,
+                          std::cerr);
     } else {
-        ok = convert_file(filenames[0], filenames[1]);
+        // Convert several files at once -- for formats whose readers and
+        // writers don't use threads themselves, this is the only way to
+        // keep the cores busy -- printing their messages in order.
+        std::vector<std::string> msgs(pairs.size()), errmsgs(pairs.size());
+        std::vector<char> oks(pairs.size());
+        parallel_for_ordered(
+            0, int64_t(pairs.size()),
+            [&](int64_t i) {
+                std::ostringstream msg, errmsg;
+                oks[i]     = convert_file(pairs[i].first, pairs[i].second, msg,
+                                          errmsg);
+                msgs[i]    = msg.str();
+                errmsgs[i] = errmsg.str();
+            },
+            [&](int64_t i) {
+                std::cout << msgs[i] << std::flush;
+                std::cerr << errmsgs[i];
+                ok &= (oks[i] != 0);
+            },
+            njobs);
     }
 
     return ok ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -29,13 +29,22 @@
 */
 
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/dassert.h>
@@ -45,6 +54,8 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
 
 
 using namespace OIIO;
@@ -77,6 +88,8 @@ static float hardfail    = std::numeric_limits<float>::max();
 static std::vector<std::string> filenames;
 //static bool comparemeta = false;
 static bool compareall = false;
+static std::string pairlist;
+static int njobs = 0;
 
 
 
@@ -98,12 +111,16 @@ getargs(int argc, char* argv[])
     ArgParse ap;
     ap.options ("idiff -- compare two images\n"
                 OIIO_INTRO_STRING "\n"
-                "Usage:  idiff [options] image1 image2",
+                "Usage:  idiff [options] image1 image2\n"
+                "        idiff [options] dir1 dir2\n"
+                "        idiff [options] --list pairfile",
                   "%*", parse_files, "",
                   "--help", &help, "Print help message",
                   "-v", &verbose, "Verbose status messages",
                   "-q", &quiet, "Quiet (minimal messages)",
                   "-a", &compareall, "Compare all subimages/miplevels",
+                  "--list %s", &pairlist, "Compare the pairs of images named on each line of this file",
+                  "-j %d", &njobs, "Number of image pairs to compare at once (default: 0 = all cores)",
                   "<SEPARATOR>", "Thresholding and comparison options",
                   "-fail %g", &failthresh, "Failure threshold difference (0.000001)",
                   "-failpercent %g", &failpercent, "Allow this percentage of failures (0)",
@@ -129,8 +146,9 @@ getargs(int argc, char* argv[])
         exit (EXIT_FAILURE);
     }
 
-    if (filenames.size() != 2) {
-        std::cerr << "idiff: Must have two input filenames.\n";
+    if (pairlist.size() ? filenames.size() != 0 : filenames.size() != 2) {
+        std::cerr << "idiff: Must have two input filenames (or directories),\n"
+                  << "       or a --list of pairs of filenames.\n";
         ap.usage();
         exit (EXIT_FAILURE);
     }
@@ -141,7 +159,7 @@ getargs(int argc, char* argv[])
 
 static bool
 read_input(const std::string& filename, ImageBuf& img, ImageCache* cache,
-           int subimage = 0, int miplevel = 0)
+           std::ostream& err, int subimage = 0, int miplevel = 0)
 {
     if (img.subimage() >= 0 && img.subimage() == subimage
         && img.miplevel() == miplevel)
@@ -151,8 +169,8 @@ read_input(const std::string& filename, ImageBuf& img, ImageCache* cache,
     if (img.read(subimage, miplevel, false, TypeFloat))
         return true;
 
-    std::cerr << "idiff ERROR: Could not read " << filename << ":\n\t"
-              << img.geterror() << "\n";
+    err << "idiff ERROR: Could not read " << filename << ":\n\t"
+        << img.geterror() << "\n";
     return false;
 }
 
@@ -162,62 +180,85 @@ read_input(const std::string& filename, ImageBuf& img, ImageCache* cache,
 // Windows (where they are in 1.#INF, 1.#NAN format) and all
 // others platform
 inline void
-safe_double_print(double val)
+safe_double_print(std::ostream& out, double val)
 {
     if (OIIO::isnan(val))
-        std::cout << "nan";
+        out << "nan";
     else if (OIIO::isinf(val))
-        std::cout << "inf";
+        out << "inf";
     else
-        std::cout << val;
-    std::cout << '\n';
+        out << val;
+    out << '\n';
 }
 
 
 
 inline void
-print_subimage(ImageBuf& img0, int subimage, int miplevel)
+print_subimage(std::ostream& out, ImageBuf& img0, int subimage, int miplevel)
 {
     if (img0.nsubimages() > 1)
-        std::cout << "Subimage " << subimage << ' ';
+        out << "Subimage " << subimage << ' ';
     if (img0.nmiplevels() > 1)
-        std::cout << " MIP level " << miplevel << ' ';
+        out << " MIP level " << miplevel << ' ';
     if (img0.nsubimages() > 1 || img0.nmiplevels() > 1)
-        std::cout << ": ";
-    std::cout << img0.spec().width << " x " << img0.spec().height;
+        out << ": ";
+    out << img0.spec().width << " x " << img0.spec().height;
     if (img0.spec().depth > 1)
-        std::cout << " x " << img0.spec().depth;
-    std::cout << ", " << img0.spec().nchannels << " channel\n";
+        out << " x " << img0.spec().depth;
+    out << ", " << img0.spec().nchannels << " channel\n";
 }
 
 
 
-int
-main(int argc, char* argv[])
+// Are the two files byte for byte the same? If so, their images are
+// identical and there is no need to decode them. This stops reading at
+// the first difference, which for differing files is usually early on.
+static bool
+files_identical(const std::string& filename0, const std::string& filename1)
 {
-    Filesystem::convert_native_arguments(argc, (const char**)argv);
-    getargs(argc, argv);
+    if (Filesystem::file_size(filename0) != Filesystem::file_size(filename1))
+        return false;
+    OIIO::ifstream in0, in1;
+    Filesystem::open(in0, filename0, std::ios::in | std::ios::binary);
+    Filesystem::open(in1, filename1, std::ios::in | std::ios::binary);
+    if (!in0 || !in1)
+        return false;
+    const size_t chunk = 1 << 20;
+    std::unique_ptr<char[]> buf0(new char[chunk]), buf1(new char[chunk]);
+    while (in0 && in1) {
+        in0.read(buf0.get(), chunk);
+        in1.read(buf1.get(), chunk);
+        if (in0.gcount() != in1.gcount()
+            || memcmp(buf0.get(), buf1.get(), size_t(in0.gcount())))
+            return false;
+    }
+    return in0.eof() && in1.eof();
+}
+
 
+
+// Compare the images in filename0 and filename1, printing the report to
+// out and errors to err, and return one of the idiffErrors.
+static int
+compare_pair(const std::string& filename0, const std::string& filename1,
+             ImageCache* imagecache, std::ostream& out, std::ostream& err)
+{
     if (!quiet)
-        std::cout << "Comparing \"" << filenames[0] << "\" and \""
-                  << filenames[1] << "\"\n";
+        out << "Comparing \"" << filename0 << "\" and \"" << filename1
+            << "\"\n";
 
-    // Create a private ImageCache so we can customize its cache size
-    // and instruct it store everything internally as floats.
-    ImageCache* imagecache = ImageCache::create(true);
-    imagecache->attribute("forcefloat", 1);
-    if (sizeof(void*) == 4)  // 32 bit or 64?
-        imagecache->attribute("max_memory_MB", 512.0);
-    else
-        imagecache->attribute("max_memory_MB", 2048.0);
-    imagecache->attribute("autotile", 256);
-    // force a full diff, even for files tagged with the same
-    // fingerprint, just in case some mistake has been made.
-    imagecache->attribute("deduplicate", 0);
+    // Identical files need no decoding, unless we have been asked for
+    // statistics or a difference image that only decoding can provide.
+    if (!verbose && (diffimage.empty() || outdiffonly)
+        && files_identical(filename0, filename1)) {
+        if (!quiet)
+            out << "PASS\n";
+        return ErrOK;
+    }
 
     ImageBuf img0, img1;
-    if (!read_input(filenames[0], img0, imagecache)
-        || !read_input(filenames[1], img1, imagecache))
+    if (!read_input(filename0, img0, imagecache, err)
+        || !read_input(filename1, img1, imagecache, err))
         return ErrFile;
     //    ImageSpec spec0 = img0.spec();  // stash it
 
@@ -228,35 +269,32 @@ main(int argc, char* argv[])
         if (subimage >= img1.nsubimages())
             break;
 
-        if (!read_input(filenames[0], img0, imagecache, subimage)
-            || !read_input(filenames[1], img1, imagecache, subimage)) {
-            std::cerr << "Failed to read subimage " << subimage << "\n";
+        if (!read_input(filename0, img0, imagecache, err, subimage)
+            || !read_input(filename1, img1, imagecache, err, subimage)) {
+            err << "Failed to read subimage " << subimage << "\n";
             return ErrFile;
         }
 
         if (img0.nmiplevels() != img1.nmiplevels()) {
             if (!quiet)
-                std::cout
-                    << "Files do not match in their number of MIPmap levels\n";
+                out << "Files do not match in their number of MIPmap levels\n";
         }
 
         for (int m = 0; m < img0.nmiplevels(); ++m) {
             if (m > 0 && !compareall)
                 break;
             if (m > 0 && img0.nmiplevels() != img1.nmiplevels()) {
-                std::cerr
-                    << "Files do not match in their number of MIPmap levels\n";
+                err << "Files do not match in their number of MIPmap levels\n";
                 ret = ErrDifferentSize;
                 break;
             }
 
-            if (!read_input(filenames[0], img0, imagecache, subimage, m)
-                || !read_input(filenames[1], img1, imagecache, subimage, m))
+            if (!read_input(filename0, img0, imagecache, err, subimage, m)
+                || !read_input(filename1, img1, imagecache, err, subimage, m))
                 return ErrFile;
 
             if (img0.deep() != img1.deep()) {
-                std::cerr
-                    << "One image contains deep data, the other does not\n";
+                err << "One image contains deep data, the other does not\n";
                 ret = ErrDifferentSize;
                 break;
             }
@@ -270,7 +308,16 @@ main(int argc, char* argv[])
             // Compare the two images.
             //
             ImageBufAlgo::CompareResults cr;
-            ImageBufAlgo::compare(img0, img1, failthresh, warnthresh, cr);
+            if (quiet && !verbose && diffimage.empty()) {
+                // Nothing will be reported, so stop as soon as we know
+                // the comparison fails. The images are backed by the
+                // ImageCache, so the rest of their tiles are never read.
+                imagesize_t maxfail = imagesize_t(failpercent / 100.0 * npels);
+                cr = ImageBufAlgo::compare(img0, img1, failthresh, warnthresh,
+                                           maxfail, hardfail);
+            } else {
+                ImageBufAlgo::compare(img0, img1, failthresh, warnthresh, cr);
+            }
 
             int yee_failures = 0;
             if (perceptual && !img0.deep()) {
@@ -292,61 +339,57 @@ main(int argc, char* argv[])
             //
             if (verbose || (ret != ErrOK && !quiet)) {
                 if (compareall)
-                    print_subimage(img0, subimage, m);
-                std::cout << "  Mean error = ";
-                safe_double_print(cr.meanerror);
-                std::cout << "  RMS error = ";
-                safe_double_print(cr.rms_error);
-                std::cout << "  Peak SNR = ";
-                safe_double_print(cr.PSNR);
-                std::cout << "  Max error  = " << cr.maxerror;
+                    print_subimage(out, img0, subimage, m);
+                out << "  Mean error = ";
+                safe_double_print(out, cr.meanerror);
+                out << "  RMS error = ";
+                safe_double_print(out, cr.rms_error);
+                out << "  Peak SNR = ";
+                safe_double_print(out, cr.PSNR);
+                out << "  Max error  = " << cr.maxerror;
                 if (cr.maxerror != 0) {
-                    std::cout << " @ (" << cr.maxx << ", " << cr.maxy;
+                    out << " @ (" << cr.maxx << ", " << cr.maxy;
                     if (img0.spec().depth > 1)
-                        std::cout << ", " << cr.maxz;
+                        out << ", " << cr.maxz;
                     if (cr.maxc < (int)img0.spec().channelnames.size())
-                        std::cout << ", " << img0.spec().channelnames[cr.maxc]
-                                  << ')';
+                        out << ", " << img0.spec().channelnames[cr.maxc]
+                            << ')';
                     else if (cr.maxc < (int)img1.spec().channelnames.size())
-                        std::cout << ", " << img1.spec().channelnames[cr.maxc]
-                                  << ')';
+                        out << ", " << img1.spec().channelnames[cr.maxc]
+                            << ')';
                     else
-                        std::cout << ", channel " << cr.maxc << ')';
+                        out << ", channel " << cr.maxc << ')';
                     if (!img0.deep()) {
-                        std::cout << "  values are ";
+                        out << "  values are ";
                         for (int c = 0; c < img0.spec().nchannels; ++c)
-                            std::cout
-                                << (c ? ", " : "")
+                            out << (c ? ", " : "")
                                 << img0.getchannel(cr.maxx, cr.maxy, 0, c);
-                        std::cout << " vs ";
+                        out << " vs ";
                         for (int c = 0; c < img1.spec().nchannels; ++c)
-                            std::cout
-                                << (c ? ", " : "")
+                            out << (c ? ", " : "")
                                 << img1.getchannel(cr.maxx, cr.maxy, 0, c);
                     }
                 }
-                std::cout << "\n";
+                out << "\n";
 #if OIIO_MSVS_BEFORE_2015
                 // When older Visual Studio is used, float values in
                 // scientific foramt are printed with three digit exponent.
                 // We change this behaviour to fit Linux way.
                 _set_output_format(_TWO_DIGIT_EXPONENT);
 #endif
-                std::streamsize precis = std::cout.precision();
-                std::cout << "  " << cr.nwarn << " pixels ("
-                          << std::setprecision(3) << (100.0 * cr.nwarn / npels)
-                          << std::setprecision(precis) << "%) over "
-                          << warnthresh << "\n";
-                std::cout << "  " << cr.nfail << " pixels ("
-                          << std::setprecision(3) << (100.0 * cr.nfail / npels)
-                          << std::setprecision(precis) << "%) over "
-                          << failthresh << "\n";
+                std::streamsize precis = out.precision();
+                out << "  " << cr.nwarn << " pixels (" << std::setprecision(3)
+                    << (100.0 * cr.nwarn / npels) << std::setprecision(precis)
+                    << "%) over " << warnthresh << "\n";
+                out << "  " << cr.nfail << " pixels (" << std::setprecision(3)
+                    << (100.0 * cr.nfail / npels) << std::setprecision(precis)
+                    << "%) over " << failthresh << "\n";
                 if (perceptual)
-                    std::cout << "  " << yee_failures << " pixels ("
-                              << std::setprecision(3)
-                              << (100.0 * yee_failures / npels)
-                              << std::setprecision(precis)
-                              << "%) failed the perceptual test\n";
+                    out << "  " << yee_failures << " pixels ("
+                        << std::setprecision(3)
+                        << (100.0 * yee_failures / npels)
+                        << std::setprecision(precis)
+                        << "%) failed the perceptual test\n";
             }
 
             // If the user requested that a difference image be output,
@@ -372,29 +415,184 @@ main(int argc, char* argv[])
 
     if (compareall && img0.nsubimages() != img1.nsubimages()) {
         if (!quiet)
-            std::cerr << "Images had differing numbers of subimages ("
-                      << img0.nsubimages() << " vs " << img1.nsubimages()
-                      << ")\n";
+            err << "Images had differing numbers of subimages ("
+                << img0.nsubimages() << " vs " << img1.nsubimages() << ")\n";
         ret = ErrFail;
     }
     if (!compareall && (img0.nsubimages() > 1 || img1.nsubimages() > 1)) {
         if (!quiet)
-            std::cout << "Only compared the first subimage (of "
-                      << img0.nsubimages() << " and " << img1.nsubimages()
-                      << ", respectively)\n";
+            out << "Only compared the first subimage (of " << img0.nsubimages()
+                << " and " << img1.nsubimages() << ", respectively)\n";
     }
 
     if (ret == ErrOK) {
         if (!quiet)
-            std::cout << "PASS\n";
+            out << "PASS\n";
     } else if (ret == ErrWarn) {
         if (!quiet)
-            std::cout << "WARNING\n";
+            out << "WARNING\n";
     } else if (ret) {
         if (quiet)
-            std::cerr << "FAILURE\n";
+            err << "FAILURE\n";
         else
-            std::cout << "FAILURE\n";
+            out << "FAILURE\n";
+    }
+    return ret;
+}
+
+
+
+// Figure out which pairs of images to compare: the pairs listed in the
+// --list file, or every image file under the first directory named on the
+// command line with the one of the same relative name under the second,
+// or else just the two files named on the command line.
+static bool
+find_pairs(std::vector<std::pair<std::string, std::string>>& pairs)
+{
+    if (pairlist.size()) {
+        std::string contents;
+        if (!Filesystem::read_text_file(pairlist, contents)) {
+            std::cerr << "idiff: Could not read \"" << pairlist << "\"\n";
+            return false;
+        }
+        for (string_view line : Strutil::splitsv(contents, "\n")) {
+            line = Strutil::strip(line);
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::vector<std::string> names = Strutil::splits(line);
+            if (names.size() != 2) {
+                std::cerr << "idiff: Expected two filenames per line of \""
+                          << pairlist << "\", found \"" << line << "\"\n";
+                return false;
+            }
+            pairs.emplace_back(names[0], names[1]);
+        }
+        return true;
+    }
+
+    if (!Filesystem::is_directory(filenames[0])
+        || !Filesystem::is_directory(filenames[1])) {
+        pairs.emplace_back(filenames[0], filenames[1]);
+        return true;
+    }
+    // Extensions of the formats we can read, from the "extension_list"
+    // of the form "tiff:tif,tiff;jpeg:jpg,jpeg;...".
+    std::set<std::string> extensions;
+    for (string_view format :
+         Strutil::splitsv(OIIO::get_string_attribute("extension_list"), ";")) {
+        size_t colon = format.find(':');
+        if (colon != string_view::npos)
+            for (auto&& e : Strutil::splits(format.substr(colon + 1), ",")) {
+                Strutil::to_lower(e);
+                extensions.insert(e);
+            }
+    }
+    std::vector<std::string> files;
+    if (!Filesystem::get_directory_entries(filenames[0], files, true)) {
+        std::cerr << "idiff: Could not list directory \"" << filenames[0]
+                  << "\"\n";
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    for (auto&& file : files) {
+        std::string ext = Filesystem::extension(file, false);
+        Strutil::to_lower(ext);
+        if (!Filesystem::is_regular(file) || !extensions.count(ext))
+            continue;
+        string_view relname(file);
+        relname.remove_prefix(filenames[0].size());
+        while (relname.size() && (relname[0] == '/' || relname[0] == '\\'))
+            relname.remove_prefix(1);
+        pairs.emplace_back(file, filenames[1] + "/" + std::string(relname));
+    }
+    if (pairs.empty()) {
+        std::cerr << "idiff: No image files found in \"" << filenames[0]
+                  << "\"\n";
+        return false;
+    }
+    return true;
+}
+
+
+
+int
+main(int argc, char* argv[])
+{
+    Filesystem::convert_native_arguments(argc, (const char**)argv);
+    getargs(argc, argv);
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    if (!find_pairs(pairs))
+        return ErrFile;
+    if (pairs.size() > 1 && diffimage.size()) {
+        std::cerr << "idiff: -o may only be used when comparing one pair of "
+                     "images\n";
+        return ErrFile;
+    }
+
+    // Create a private ImageCache so we can customize its cache size
+    // and instruct it store everything internally as floats.
+    ImageCache* imagecache = ImageCache::create(true);
+    imagecache->attribute("forcefloat", 1);
+    if (sizeof(void*) == 4)  // 32 bit or 64?
+        imagecache->attribute("max_memory_MB", 512.0);
+    else
+        imagecache->attribute("max_memory_MB", 2048.0);
+    imagecache->attribute("autotile", 256);
+    // force a full diff, even for files tagged with the same
+    // fingerprint, just in case some mistake has been made.
+    imagecache->attribute("deduplicate", 0);
+
+    int ret = ErrOK;
+    if (pairs.size() == 1) {
+        ret = compare_pair(pairs[0].first, pairs[0].second, imagecache,
+                           std::cout, std::cerr);
+    } else {
+        // Compare several pairs at once, each thread taking the next pair
+        // not yet started. Each pair's report is printed whole, in order.
+        size_t npairs = pairs.size();
+        size_t nthreads = njobs > 0 ? size_t(njobs)
+                                    : Sysutil::hardware_concurrency();
+        nthreads = std::max(size_t(1), std::min(nthreads, npairs));
+        std::vector<std::string> outs(npairs), errs(npairs);
+        std::vector<int> results(npairs, -1);
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<size_t> next_pair(0);
+        auto worker = [&]() {
+            size_t i;
+            while ((i = next_pair++) < npairs) {
+                std::ostringstream out, err;
+                int r = compare_pair(pairs[i].first, pairs[i].second,
+                                     imagecache, out, err);
+                std::lock_guard<std::mutex> lock(mutex);
+                outs[i]    = out.str();
+                errs[i]    = err.str();
+                results[i] = r;
+                cv.notify_all();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nthreads; ++t)
+            threads.emplace_back(worker);
+
+        int counts[ErrLast] = { 0 };
+        for (size_t i = 0; i < npairs; ++i) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return results[i] >= 0; });
+            std::cout << outs[i] << std::flush;
+            std::cerr << errs[i] << std::flush;
+            ++counts[results[i]];
+            ret = std::max(ret, results[i]);
+        }
+        for (auto& t : threads)
+            t.join();
+        if (!quiet)
+            std::cout << "\nCompared " << npairs << " pairs: "
+                      << counts[ErrOK] << " passed, " << counts[ErrWarn]
+                      << " warned, " << counts[ErrFail] << " failed, "
+                      << counts[ErrDifferentSize] << " differed in size, "
+                      << counts[ErrFile] << " could not be read\n";
     }
 
     imagecache->invalidate_all(true);
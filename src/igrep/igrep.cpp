@@ -36,10 +36,12 @@
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <sstream>
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 
 #ifdef USE_BOOST_REGEX
@@ -65,39 +67,60 @@ static bool file_match     = false;
 static bool print_dirs     = false;
 static bool all_subimages  = false;
 static bool extended_regex = false;
+static int njobs           = 0;
 static std::string pattern;
 static std::vector<std::string> filenames;
 
 
 
+// One thing to do, in order: grep a file, or (with -d) print the name of
+// a directory we are about to search.
+struct GrepItem {
+    std::string filename;
+    bool directory;
+    bool ignore_nonimage_files;
+};
+
+
+
+// Add to items what it takes to grep filename: itself, or with -r, all
+// the files under it if it is a directory.
+static void
+find_items(const std::string& filename, std::vector<GrepItem>& items,
+           bool ignore_nonimage_files = false)
+{
+    if (!Filesystem::is_directory(filename)) {
+        items.push_back({ filename, false, ignore_nonimage_files });
+        return;
+    }
+    if (!recursive)
+        return;
+    if (print_dirs)
+        items.push_back({ filename, true, false });
+    std::vector<std::string> directory_entries;
+    Filesystem::get_directory_entries(filename, directory_entries);
+    for (const auto& d : directory_entries)
+        find_items(d, items, true);
+}
+
+
+
 static bool
-grep_file(const std::string& filename, regex& re,
-          bool ignore_nonimage_files = false)
+grep_file(const std::string& filename, regex& re, bool ignore_nonimage_files,
+          std::ostream& out, std::ostream& err)
 {
     if (!Filesystem::exists(filename)) {
-        std::cerr << "igrep: " << filename << ": No such file or directory\n";
+        err << "igrep: " << filename << ": No such file or directory\n";
         return false;
     }
 
-    if (Filesystem::is_directory(filename)) {
-        if (!recursive)
-            return false;
-        if (print_dirs) {
-            std::cout << "(" << filename << "/)\n";
-            std::cout.flush();
-        }
-        bool r = false;
-        std::vector<std::string> directory_entries;
-        Filesystem::get_directory_entries(filename, directory_entries);
-        for (const auto& d : directory_entries)
-            r |= grep_file(d, re, true);
-        return r;
-    }
-
-    auto in = ImageInput::open(filename);
+    // Only metadata is searched, so promise the reader not to read pixels.
+    ImageSpec config;
+    config.attribute("oiio:HeaderOnly", 1);
+    auto in = ImageInput::open(filename, &config);
     if (!in.get()) {
         if (!ignore_nonimage_files)
-            std::cerr << geterror() << "\n";
+            err << geterror() << "\n";
         return false;
     }
     ImageSpec spec = in->spec();
@@ -105,7 +128,7 @@ grep_file(const std::string& filename, regex& re,
     if (file_match) {
         bool match = regex_search(filename, re);
         if (match && !invert_match) {
-            std::cout << filename << "\n";
+            out << filename << "\n";
             return true;
         }
     }
@@ -124,11 +147,11 @@ grep_file(const std::string& filename, regex& re,
                     found |= match;
                     if (match && !invert_match) {
                         if (list_files) {
-                            std::cout << filename << "\n";
+                            out << filename << "\n";
                             return found;
                         }
-                        std::cout << filename << ": " << p.name() << " = "
-                                  << ((const char**)p.data())[i] << "\n";
+                        out << filename << ": " << p.name() << " = "
+                            << ((const char**)p.data())[i] << "\n";
                     }
                 }
             }
@@ -138,7 +161,7 @@ grep_file(const std::string& filename, regex& re,
     if (invert_match) {
         found = !found;
         if (found)
-            std::cout << filename << "\n";
+            out << filename << "\n";
     }
     return found;
 }
@@ -177,6 +200,7 @@ main(int argc, const char* argv[])
                 "-r", &recursive, "Recurse into directories",
                 "-d", &print_dirs, "Print directories (when recursive)",
                 "-a", &all_subimages, "Search all subimages of each file",
+                "-j %d", &njobs, "Number of files to search at once (default: 0 = all cores)",
                 "--help", &help, "Print help message",
                 NULL);
     // clang-format off
@@ -205,8 +229,34 @@ main(int argc, const char* argv[])
         flag |= std::regex_constants::icase;
 #endif
     regex re(pattern, flag);
+
+    // Search several files at a time, printing their results in order.
+    std::vector<GrepItem> items;
     for (auto&& s : filenames)
-        grep_file(s, re);
+        find_items(s, items);
+    std::vector<std::string> outs(items.size()), errs(items.size());
+    parallel_for_ordered(
+        0, int64_t(items.size()),
+        [&](int64_t i) {
+            if (items[i].directory)
+                return;
+            std::ostringstream out, err;
+            grep_file(items[i].filename, re, items[i].ignore_nonimage_files,
+                      out, err);
+            outs[i] = out.str();
+            errs[i] = err.str();
+        },
+        [&](int64_t i) {
+            if (items[i].directory) {
+                std::cout << "(" << items[i].filename << "/)\n";
+                std::cout.flush();
+            }
+            std::cout << outs[i];
+            std::cerr << errs[i];
+            std::string().swap(outs[i]);  // free it now
+            std::string().swap(errs[i]);
+        },
+        njobs);
 
     return 0;
 }
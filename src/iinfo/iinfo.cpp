@@ -29,6 +29,7 @@
 */
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -44,6 +45,7 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 
 #ifdef USE_BOOST_REGEX
@@ -71,6 +73,8 @@ static regex field_re;
 static bool subimages     = false;
 static bool compute_sha1  = false;
 static bool compute_stats = false;
+static bool recursive     = false;
+static int njobs          = 0;
 
 
 
@@ -667,6 +671,8 @@ main(int argc, const char* argv[])
                 "-a", &subimages, "Print info about all subimages",
                 "--hash", &compute_sha1, "Print SHA-1 hash of pixel values",
                 "--stats", &compute_stats, "Print image pixel statistics (data window)",
+                "-r", &recursive, "Recurse into directories",
+                "-j %d", &njobs, "Number of files to open at once (default: 0 = all cores)",
                 NULL);
     // clang-format on
     if (ap.parse(argc, argv) < 0 || filenames.empty()) {
@@ -689,25 +695,71 @@ main(int argc, const char* argv[])
 #endif
     }
 
+    // With -r, replace directories by all the files under them. Those
+    // that turn out not to be images are skipped without complaint.
+    std::vector<bool> found_in_dir;
+    if (recursive) {
+        std::vector<std::string> expanded;
+        for (auto&& s : filenames) {
+            std::vector<std::string> entries;
+            if (!Filesystem::is_directory(s)
+                || !Filesystem::get_directory_entries(s, entries, true)) {
+                expanded.push_back(s);
+                found_in_dir.push_back(false);
+                continue;
+            }
+            std::sort(entries.begin(), entries.end());
+            for (auto&& e : entries) {
+                if (Filesystem::is_directory(e))
+                    continue;
+                expanded.push_back(e);
+                found_in_dir.push_back(true);
+            }
+        }
+        filenames.swap(expanded);
+    }
+    found_in_dir.resize(filenames.size(), false);
+
     // Find the longest filename
     size_t longestname = 0;
     for (auto&& s : filenames)
         longestname = std::max(longestname, s.length());
     longestname = std::min(longestname, (size_t)40);
 
+    // Unless we need the pixels, promise the readers we won't read any.
+    ImageSpec config;
+    if (!compute_sha1 && !compute_stats)
+        config.attribute("oiio:HeaderOnly", 1);
+
+    // Opening the files is most of the work for a big catalog, so open
+    // them several at a time, ahead of printing them in order.
     long long totalsize = 0;
-    for (auto&& s : filenames) {
-        auto in = ImageInput::open(s);
-        if (!in) {
-            std::string err = geterror();
-            if (err.empty())
-                err = Strutil::sprintf("Could not open \"%s\"", s);
-            std::cerr << "iinfo ERROR: " << err << "\n";
-            continue;
-        }
-        ImageSpec spec = in->spec();
-        print_info(s, longestname, in.get(), spec, verbose, sum, totalsize);
-    }
+    std::vector<std::unique_ptr<ImageInput>> inputs(filenames.size());
+    std::vector<std::string> errors(filenames.size());
+    parallel_for_ordered(
+        0, int64_t(filenames.size()),
+        [&](int64_t i) {
+            inputs[i] = ImageInput::open(filenames[i], &config);
+            if (!inputs[i])
+                errors[i] = geterror();
+        },
+        [&](int64_t i) {
+            const std::string& s(filenames[i]);
+            std::unique_ptr<ImageInput> in(std::move(inputs[i]));
+            if (!in) {
+                if (found_in_dir[i])
+                    return;
+                std::string& err(errors[i]);
+                if (err.empty())
+                    err = Strutil::sprintf("Could not open \"%s\"", s);
+                std::cerr << "iinfo ERROR: " << err << "\n";
+                return;
+            }
+            ImageSpec spec = in->spec();
+            print_info(s, longestname, in.get(), spec, verbose, sum,
+                       totalsize);
+        },
+        njobs);
 
     if (sum) {
         double t = (double)totalsize / (1024.0 * 1024.0);
@@ -88,6 +88,8 @@ typedef std::shared_ptr<ColorProcessor> ColorProcessorHandle;
 ///
 /// NOTE: ColorConfig(s) and ColorProcessor(s) are potentially heavy-weight.
 /// Their construction / destruction should be kept to a minimum.
+/// A ColorConfig may be shared by any number of threads: finding a
+/// ColorProcessor it has already made doesn't lock anything.
 
 class OIIO_API ColorConfig {
 public:
@@ -249,6 +251,22 @@ public:
     ColorProcessorHandle createFileTransform(ustring name,
                                              bool inverse = false) const;
 
+    /// Construct a processor that approximates `processor` by table
+    /// lookup, which is much cheaper to apply than an arbitrary OCIO
+    /// transform chain. Each input channel value in [0,maxvalue] is mapped
+    /// through a 1D shaper table of `shapersize` entries (a log2 curve if
+    /// maxvalue > 1, otherwise linear) to a coordinate in a 3D table of
+    /// cubesize^3 RGB values, which is interpolated tetrahedrally. Values
+    /// outside [0,maxvalue] are clamped to it. Only the first three
+    /// channels are transformed; any others are left alone.
+    ///
+    /// Returns an empty handle if `processor` is empty, if cubesize or
+    /// shapersize is less than 2, or if maxvalue is not positive.
+    ColorProcessorHandle
+    createBakedProcessor(const ColorProcessorHandle& processor,
+                         int cubesize = 33, int shapersize = 1024,
+                         float maxvalue = 1.0f) const;
+
     /// Given a string (like a filename), look for the longest, right-most
     /// colorspace substring that appears. Returns "" if no such color space
     /// is found. (This is just a wrapper around OCIO's
@@ -338,4 +356,25 @@ linear_to_Rec709(float x)
 }
 
 
+#ifndef __CUDA_ARCH__
+/// Utility -- convert Rec709 value to linear
+inline simd::vfloat4
+Rec709_to_linear(const simd::vfloat4& x)
+{
+    return simd::select(x < 0.081f, x * (1.0f / 4.5f),
+                        fast_pow_pos(madd(x, (1.0f / 1.099f),
+                                          0.099f * (1.0f / 1.099f)),
+                                     1.0f / 0.45f));
+}
+
+/// Utility -- convert linear value to Rec709
+inline simd::vfloat4
+linear_to_Rec709(const simd::vfloat4& x)
+{
+    return simd::select(x < 0.018f, x * 4.5f,
+                        madd(1.099f, fast_pow_pos(x, 0.45f), -0.099f));
+}
+#endif
+
+
 OIIO_NAMESPACE_END
@@ -107,6 +107,21 @@ public:
     size_t channelsize(int c) const;
     /// The size for all channels of one sample.
     size_t samplesize() const;
+    /// The distance in bytes from one sample of channel c to the next
+    /// within a pixel: samplesize() for interleaved data, channelsize(c)
+    /// for planar data.
+    size_t samplestride(int c) const;
+
+    /// Is the sample data stored planar (each channel's samples contiguous)
+    /// rather than interleaved (all channels of a sample together)?
+    bool planar() const;
+
+    /// Choose planar or interleaved (the default) storage of the sample
+    /// data, rearranging any data already present. This must be called
+    /// after init(). Planar storage keeps each pixel's values of one
+    /// channel, such as Z or alpha, in a contiguous array, which is cheaper
+    /// for operations that only examine a few of the channels.
+    void set_planar(bool planar);
 
     /// Retrieve the number of samples for the given pixel index.
     int samples(int pixel) const;
@@ -127,6 +142,24 @@ public:
     /// pixel index.
     int capacity(int pixel) const;
 
+    /// Set the capacity of samples for all pixels at once. The
+    /// capacity.size() is required to match pixels(). No pixel's capacity
+    /// is set below its current number of samples. Unlike calling
+    /// set_capacity() for each pixel, this moves the data at most once,
+    /// so it is the cheap way to reserve room before filling pixels from
+    /// several threads.
+    void set_all_capacity(cspan<unsigned int> capacity);
+
+    /// Reserve room for at least totalsamples samples, summed over all
+    /// pixels, so that pixels can later grow past their capacity (by
+    /// set_capacity() or insert_samples()) without reallocating.
+    void reserve_total(size_t totalsamples);
+
+    /// Release any space left behind by pixels that outgrew their
+    /// capacity, and any unused reserve, so that the pixels' samples are
+    /// stored back to back again.
+    void compact();
+
     /// Insert n samples at the given pixel, starting at the indexed
     /// position.
     void insert_samples(int pixel, int samplepos, int n = 1);
@@ -155,10 +188,13 @@ public:
 
     cspan<TypeDesc> all_channeltypes() const;
     cspan<unsigned int> all_samples() const;
+    /// All the sample data, laid out according to planar(). This compacts
+    /// the data first, if needed.
     cspan<char> all_data() const;
 
-    /// Fill in the vector with pointers to the start of the first
-    /// channel for each pixel.
+    /// Fill in the vector with pointers to the first sample of each
+    /// channel of each pixel. Successive samples of channel c are
+    /// samplestride(c) bytes apart.
     void get_pointers(std::vector<void*>& pointers) const;
 
     /// Copy the designated sample from a source DeepData into this
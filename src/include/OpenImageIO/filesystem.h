@@ -46,6 +46,9 @@
 #include <cstdio>
 #include <ctime>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -126,10 +129,18 @@ OIIO_API void searchpath_split (const std::string &searchpath,
 /// recursive is true, the directories will be searched recursively,
 /// finding a matching file in any subdirectory of the directories
 /// listed in dirs; otherwise.
+///
+/// If cache_ttl > 0, the file is looked for in the shared cache of
+/// directory listings (see cached_directory_entries()) using listings up
+/// to that many seconds old, rather than by asking the file system about
+/// each candidate path. That turns the lookups of many files in the same
+/// few directories into one listing of each directory, at the price of
+/// not seeing files created more recently than the listing.
 OIIO_API std::string searchpath_find (const std::string &filename,
                                       const std::vector<std::string> &dirs,
                                       bool testcwd = true,
-                                      bool recursive = false);
+                                      bool recursive = false,
+                                      float cache_ttl = 0.0f);
 
 /// Fill a vector-of-strings with the names of all files contained by
 /// directory dirname.  If recursive is true, it will return all files
@@ -143,6 +154,40 @@ OIIO_API bool get_directory_entries (const std::string &dirname,
                                bool recursive = false,
                                const std::string &filter_regex=std::string());
 
+/// Kinds of directory entries, for cached_directory_entries().
+enum DirEntryKind {
+    DirEntryFiles = 1,        ///< Regular files (or links to them)
+    DirEntryDirectories = 2,  ///< Directories (or links to them)
+    DirEntryOther = 4,        ///< Anything else
+    DirEntryAll = 7
+};
+
+/// Fill a vector-of-strings with the names (without the directory) of the
+/// entries of directory dirname of the kinds given by `which` (a bit field
+/// of DirEntryKind), in sorted order, from a process-wide cache of
+/// directory listings. A listing up to `ttl` seconds old may be reused;
+/// otherwise the directory is read again (which with ttl 0 is every time,
+/// though the fresh listing is still left for others to use). Return true
+/// if ok, false if the directory couldn't be read.
+///
+/// A listing is read in one pass over the directory, taking the kinds of
+/// entries from the directory itself where the OS supplies them, which is
+/// much cheaper than examining each file, especially on network file
+/// systems where each of those is a round trip to the server.
+OIIO_API bool cached_directory_entries (const std::string &dirname,
+                                        std::vector<std::string> &filenames,
+                                        float ttl, int which = DirEntryAll);
+
+/// Return true if the file exists and is a regular file, according to the
+/// cached listing of its directory if one is no more than `ttl` seconds
+/// old (see cached_directory_entries()).
+OIIO_API bool cached_is_regular (const std::string &path, float ttl);
+
+/// Discard the cached listing of directory dirname, or of all directories
+/// if dirname is empty, so that any files created or removed since are
+/// seen by the next lookup.
+OIIO_API void clear_directory_cache (const std::string &dirname=std::string());
+
 /// Return true if the path is an "absolute" (not relative) path.
 /// If 'dot_is_absolute' is true, consider "./foo" absolute.
 OIIO_API bool path_is_absolute (const std::string &path,
@@ -357,6 +402,24 @@ public:
     virtual size_t size () const { return 0; }
     virtual void flush () const { }
 
+    // One read of a batch: `size` bytes at `offset` into `buf`. The number
+    // of bytes actually read is stored in `result`.
+    struct ReadRequest {
+        void* buf;
+        size_t size;
+        int64_t offset;
+        size_t result;
+    };
+    // Perform several independent pread()s, which subclasses may merge,
+    // reorder, or overlap. Like pread(), it doesn't alter the current
+    // file position. Return true if every request was filled completely.
+    virtual bool pread_batch (span<ReadRequest> reqs);
+    // Start pread_batch(reqs) on the shared background thread pool (see
+    // background_thread_pool()) and return at once.
+    // The requests (and their buffers) must stay alive until the future
+    // is ready.
+    std::future<bool> pread_batch_async (span<ReadRequest> reqs);
+
     Mode mode () const { return m_mode; }
     const std::string& filename () const { return m_filename; }
     template<class T> size_t read (span<T> buf) {
@@ -397,6 +460,7 @@ public:
     virtual size_t write(const void* buf, size_t size);
     virtual size_t pread(void* buf, size_t size, int64_t offset);
     virtual size_t pwrite(const void* buf, size_t size, int64_t offset);
+    virtual bool pread_batch(span<ReadRequest> reqs);
     virtual size_t size() const;
     virtual void flush() const;
 
@@ -429,6 +493,10 @@ public:
     virtual const char* proxytype() const { return "vecoutput"; }
     virtual size_t write(const void* buf, size_t size);
     virtual size_t pwrite(const void* buf, size_t size, int64_t offset);
+    // Reading back what was already written is allowed, for formats
+    // (such as TIFF) whose writers need to revisit earlier data.
+    virtual size_t read(void* buf, size_t size);
+    virtual size_t pread(void* buf, size_t size, int64_t offset);
     virtual size_t size() const { return m_buf.size(); }
 
     // Access the buffer
@@ -469,6 +537,60 @@ protected:
     cspan<unsigned char> m_buf;
 };
 
+
+
+/// IOProxy subclass for reading a remote (or otherwise slow) source of
+/// known size through a caller-supplied function that fetches a byte
+/// range, such as an HTTP range request. Data is fetched in whole blocks,
+/// which are kept in an LRU cache of at most `maxblocks` blocks. Reads
+/// that continue where the last one ended also fetch the next
+/// `readahead` blocks, and all the missing blocks a read needs are
+/// fetched concurrently. Reads are thread-safe.
+class OIIO_API IORangeReader : public IOProxy {
+public:
+    // Fetch `size` bytes at `offset` into `buf`, returning the number of
+    // bytes actually fetched. May be called from several threads at once.
+    typedef std::function<size_t(void* buf, size_t size, int64_t offset)>
+        Fetcher;
+
+    IORangeReader(string_view name, int64_t size, Fetcher fetch,
+                  size_t blocksize = 1 << 20, size_t maxblocks = 64,
+                  int readahead = 2);
+    virtual ~IORangeReader();
+    virtual const char* proxytype() const { return "rangereader"; }
+    virtual size_t read(void* buf, size_t size);
+    virtual size_t pread(void* buf, size_t size, int64_t offset);
+    virtual size_t size() const;
+
+    // Number of range fetches issued so far.
+    int64_t fetches() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+
+
+/// Function that makes an IOProxy for reading the given URL, or returns
+/// nullptr if it can't. The caller takes ownership of the proxy.
+typedef std::function<IOProxy*(string_view url)> URLOpener;
+
+/// Register the opener for URLs of the given scheme (such as "http",
+/// "https", or "s3"), replacing any previous one. An empty function
+/// removes it. OIIO itself doesn't link with any network library, so
+/// applications supply openers (usually returning an IORangeReader whose
+/// fetcher issues range requests with their HTTP or object store client).
+OIIO_API void register_url_opener(string_view scheme, URLOpener opener);
+
+/// Is `name` of the form "scheme://..." for a registered scheme?
+OIIO_API bool is_url(string_view name);
+
+/// Make a proxy for reading `url` with its scheme's registered opener.
+/// Return nullptr if there is none or it failed. The caller owns the
+/// result.
+OIIO_API IOProxy* open_url(string_view url);
+
 };  // namespace Filesystem
 
 OIIO_NAMESPACE_END
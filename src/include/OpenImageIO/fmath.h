@@ -833,6 +833,113 @@ convert_type<float,half> (const float *src, half *dst, size_t n,
         *dst++ = *src++;
 }
 #endif
+
+
+
+template<>
+inline void convert_type<int16_t,float> (const int16_t *src,
+                                         float *dst, size_t n,
+                                         float _min, float _max)
+{
+    float scale (1.0f/std::numeric_limits<int16_t>::max());
+#if OIIO_SIMD >= 8
+    simd::vfloat8 scale8 (scale);
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8)
+        (simd::vfloat8(src) * scale8).store (dst);
+#endif
+    simd::vfloat4 scale4 (scale);
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4)
+        (simd::vfloat4(src) * scale4).store (dst);
+    while (n--)
+        *dst++ = (*src++) * scale;
+}
+
+
+
+template<>
+inline void
+convert_type<float,int16_t> (const float *src, int16_t *dst, size_t n,
+                             int16_t _min, int16_t _max)
+{
+    float min = std::numeric_limits<int16_t>::min();
+    float max = std::numeric_limits<int16_t>::max();
+    // Round half away from zero and then clamp, just like
+    // scaled_conversion, so every value matches the one-at-a-time result.
+    simd::vfloat4 min_simd (min), max_simd (max), zero_simd (0.0f);
+    simd::vfloat4 half_simd (0.5f), neghalf_simd (-0.5f);
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
+        simd::vfloat4 scaled = simd::vfloat4(src) * max_simd;
+        scaled += blend (half_simd, neghalf_simd, scaled < zero_simd);
+        simd::vint4 i (clamp (scaled, min_simd, max_simd));
+        i.store ((uint16_t *)dst);  // Keeps the low 16 bits of each
+    }
+    while (n--)
+        *dst++ = scaled_conversion<float,int16_t,float> (*src++, max, min, max);
+}
+
+
+
+template<>
+inline void convert_type<uint32_t,float> (const uint32_t *src,
+                                          float *dst, size_t n,
+                                          float _min, float _max)
+{
+    float scale (1.0f/std::numeric_limits<uint32_t>::max());
+    // Only signed ints convert to float directly, so convert the high and
+    // low 16 bits separately. Both of those, and the high part times
+    // 65536, are exact, so the sum is the one rounding of the value.
+    simd::vfloat4 scale_simd (scale), k65536 (65536.0f);
+    simd::vint4 lowmask (0xffff);
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
+        simd::vint4 u ((const int *)src);
+        simd::vfloat4 f = simd::vfloat4(srl (u, 16)) * k65536
+                        + simd::vfloat4(u & lowmask);
+        (f * scale_simd).store (dst);
+    }
+    while (n--)
+        *dst++ = float(*src++) * scale;
+}
+
+
+
+// uint8 <-> uint16 conversions can be done exactly in integer math:
+// 0-255 to 0-65535 is just a multiply by 257, and the other way is
+// rounding to the nearest multiple of 257, which is what the
+// float-based conversion would also get.
+template<>
+inline void
+convert_type<uint8_t,uint16_t> (const uint8_t *src, uint16_t *dst, size_t n,
+                                uint16_t _min, uint16_t _max)
+{
+#if OIIO_SIMD >= 8
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::vint8 u (src);
+        ((u << 8) | u).store (dst);
+    }
+#endif
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
+        simd::vint4 u (src);
+        ((u << 8) | u).store (dst);
+    }
+    while (n--)
+        *dst++ = uint16_t(*src++) * 257;
+}
+
+
+
+template<>
+inline void
+convert_type<uint16_t,uint8_t> (const uint16_t *src, uint8_t *dst, size_t n,
+                                uint8_t _min, uint8_t _max)
+{
+    simd::vint4 k255 (255), bias (32895);
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
+        simd::vint4 u (src);
+        srl (u * k255 + bias, 16).store (dst);
+    }
+    while (n--)
+        *dst++ = uint8_t((uint32_t(*src++) * 255 + 32895) >> 16);
+}
 #endif
 
 
@@ -134,8 +134,19 @@ public:
     /// can't change its resolution or data type.
     ImageBuf(string_view name, const ImageSpec& spec, void* buffer);
 
-    /// Construct a copy of an ImageBuf.
-    ///
+    /// Construct an ImageBuf that "wraps" an application-owned buffer
+    /// whose pixels, scanlines, and z planes are separated by the given
+    /// byte strides (AutoStride means contiguous), for example a window
+    /// or channel subset of a larger image.  The strides must be positive.
+    ImageBuf(const ImageSpec& spec, void* buffer, stride_t xstride,
+             stride_t ystride, stride_t zstride = AutoStride);
+
+    /// Construct a copy of an ImageBuf. If src owns its local pixel
+    /// memory, the copy shares it until either ImageBuf is modified (by
+    /// setpixel, a non-const Iterator, non-const localpixels() or
+    /// pixeladdr(), or anything built on them), at which point the
+    /// writer makes its own private copy.  So copies are cheap when they
+    /// are only read.
     ImageBuf(const ImageBuf& src);
 
     /// Move a copy of an ImageBuf.
@@ -261,6 +272,8 @@ public:
     /// forced data types (you might want to do this if it is critical that
     /// the apparent data type doesn't change, for example if you are
     /// calling make_writeable from within a type-specialized function).
+    /// If the local pixels are shared with a copy of this ImageBuf, a
+    /// private copy is made so that writes are not seen by the other.
     bool make_writeable(bool keep_cache_type = false);
 
     /// Copy all the metadata from src to *this (except for pixel data
@@ -289,12 +302,30 @@ public:
     /// the app-owned buffer is already the correct resolution and
     /// number of channels.  The data type of the pixels will be
     /// converted automatically to the data type of the app buffer.
+    ///
+    /// When no data type conversion is needed and src owns its local
+    /// pixels, the pixel memory is shared copy-on-write rather than
+    /// duplicated (see the copy constructor).
     bool copy(const ImageBuf& src, TypeDesc format = TypeUnknown);
 
     /// Return a full copy of `this` ImageBuf (optionally with an explicit
     /// data format conversion).
     ImageBuf copy(TypeDesc format /*= TypeDesc::UNKNOWN*/) const;
 
+    /// Return an ImageBuf that is a non-owning "view" of the region
+    /// `roi` (pixel window and channel range) of `this`, referring to our
+    /// pixel memory with our strides rather than copying it.  Writes to
+    /// the view modify `this`.  The view keeps our display window and has
+    /// the roi's data window, so IBA functions and write() may be used on
+    /// it directly.  An IMAGECACHE-backed image is first read into local
+    /// memory (see make_writeable()); the const version instead requires
+    /// local pixels.  The view is only valid while `this` exists and its
+    /// pixel memory is not reallocated.  On failure (deep image, roi not
+    /// within the data window, or no local pixels), the result has an
+    /// error set.
+    ImageBuf view(ROI roi = {});
+    const ImageBuf view(ROI roi = {}) const;
+
     /// Swap with another ImageBuf
     void swap(ImageBuf& other) { std::swap(m_impl, other.m_impl); }
 
@@ -568,7 +599,10 @@ public:
 
     /// A raw pointer to "local" pixel memory, if they are fully in RAM
     /// and not backed by an ImageCache, or nullptr otherwise.  You can
-    /// also test it like a bool to find out if pixels are local.
+    /// also test it like a bool to find out if pixels are local.  The
+    /// non-const version first makes a private copy of the pixels if they
+    /// are shared with a copy of this ImageBuf, so don't hold on to the
+    /// pointer across copies if you intend to write through it.
     void* localpixels();
     const void* localpixels() const;
 
@@ -579,6 +613,13 @@ public:
     /// Z plane stride within the localpixels memory.
     stride_t z_stride() const;
 
+    /// Are the local pixels fully contiguous in memory, i.e., channels,
+    /// pixels, scanlines, and planes each immediately follow the previous
+    /// one?  This is always true for pixels ImageBuf allocates itself, but
+    /// not necessarily for a wrapped buffer with explicit strides or a
+    /// view().  Returns false if the pixels are not local.
+    bool contiguous() const;
+
     /// Are the pixels backed by an ImageCache, rather than the whole
     /// image being in RAM somewhere?
     bool cachedpixels() const;
@@ -921,7 +962,8 @@ public:
             m_img_zend    = spec.z + spec.depth;
             m_nchannels   = spec.nchannels;
             //            m_tilewidth = spec.tile_width;
-            m_pixel_bytes = spec.pixel_bytes();
+            m_pixel_bytes = m_localpixels ? size_t(m_ib->pixel_stride())
+                                          : spec.pixel_bytes();
             m_x           = 1 << 31;
             m_y           = 1 << 31;
             m_z           = 1 << 31;
@@ -988,11 +1030,12 @@ public:
             m_z     = m_rng_zend;
         }
 
-        // Make sure it's writeable. Use with caution!
+        // Make sure it's writeable (read in cached pixels, or get a
+        // private copy of shared ones). Use with caution!
         void make_writeable()
         {
+            const_cast<ImageBuf*>(m_ib)->make_writeable(true);
             if (!m_localpixels) {
-                const_cast<ImageBuf*>(m_ib)->make_writeable(true);
                 DASSERT(m_ib->storage() != IMAGECACHE);
                 m_tile      = NULL;
                 m_proxydata = NULL;
@@ -44,6 +44,7 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/color.h>
+#include <OpenImageIO/function_view.h>
 #include <OpenImageIO/parallel.h>
 #include <OpenImageIO/span.h>
 
@@ -316,6 +317,12 @@ bool OIIO_API noise (ImageBuf &dst, string_view noisetype,
 /// (with zero values for added channels) or truncating channels at the end
 /// (but leaving the other channels intact), then you should call this as:
 ///    channels (dst, src, nchannels, {}, {}, {}, true);
+///
+/// When src holds local pixels of a single data type, the channels are
+/// gathered directly without any per-pixel conversion. And if all you need
+/// is to look at a contiguous range of the channels of a local image
+/// without copying at all, src.view(roi) with the roi's channel range set
+/// will do that.
 ImageBuf OIIO_API channels (const ImageBuf &src,
                         int nchannels, cspan<int> channelorder,
                         cspan<float> channelvalues={},
@@ -839,6 +846,72 @@ OIIO_API bool contrast_remap (ImageBuf &dst, const ImageBuf &src,
 
 
 
+/// Expr is a deferred pipeline of pointwise operations on a single source
+/// image. Rather than making a full pass over the pixels (and allocating
+/// an intermediate image) for each operation, the operations are recorded
+/// and then applied all at once, tile by tile, when eval() is called. The
+/// result is identical to calling the corresponding ImageBufAlgo functions
+/// one after another, but with only one read of the source and one write
+/// of the result.
+///
+/// Each recording method returns a reference to the Expr so that calls may
+/// be chained:
+///
+///     ImageBuf dst = ImageBufAlgo::Expr(src).unpremult()
+///                        .colorconvert(processor, false)
+///                        .mul({ 0.5f, 0.5f, 0.5f, 1.0f })
+///                        .clamp(0.0f, 1.0f).premult().eval();
+///
+/// The per-channel arguments follow the same rules as the standalone
+/// functions: a single value is used for all channels, and a short span is
+/// padded by repeating its last value. The source image must remain valid
+/// until eval() is called.
+class OIIO_API Expr {
+public:
+    Expr (const ImageBuf &src);
+    ~Expr ();
+    Expr (Expr &&other);
+    Expr& operator= (Expr &&other);
+
+    /// Record R = R + B.
+    Expr& add (cspan<float> B);
+    /// Record R = R - B.
+    Expr& sub (cspan<float> B);
+    /// Record R = R * B.
+    Expr& mul (cspan<float> B);
+    /// Record R = R * B + C.
+    Expr& mad (cspan<float> B, cspan<float> C);
+    /// Record R = R ^ B.
+    Expr& pow (cspan<float> B);
+    /// Record a clamp of R to [min,max], as with ImageBufAlgo::clamp().
+    Expr& clamp (cspan<float> min=-std::numeric_limits<float>::max(),
+                 cspan<float> max=std::numeric_limits<float>::max(),
+                 bool clampalpha01 = false);
+    /// Record a premult of the color channels by alpha.
+    Expr& premult ();
+    /// Record an unpremult of the color channels by alpha.
+    Expr& unpremult ();
+    /// Record a color transformation of the first (up to) four channels by
+    /// the given processor, as with ImageBufAlgo::colorconvert().
+    Expr& colorconvert (ColorProcessorHandle processor, bool unpremult=true);
+
+    /// Return the number of recorded operations.
+    size_t size () const;
+
+    /// Apply the recorded operations to the source image over the region
+    /// roi, returning the result image or storing it into dst. Return
+    /// false (and set an error message in dst) on failure.
+    ImageBuf eval (ROI roi={}, int nthreads=0) const;
+    bool eval (ImageBuf &dst, ROI roi={}, int nthreads=0) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+
+
+
 
 struct OIIO_API PixelStats {
     std::vector<float> min;
@@ -896,6 +969,18 @@ CompareResults OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
                                  float failthresh, float warnthresh,
                                  ROI roi={}, int nthreads=0);
 
+/// Numerically compare two images as above, but with an "early out":
+/// stop as soon as the comparison is known to fail, because more than
+/// maxfail pixels have exceeded failthresh, or any one value differs by
+/// more than hardfail. The counts and error statistics then describe only
+/// the pixels compared before stopping (which, with multiple threads, are
+/// not one contiguous region), so this is for quick pass/fail checks
+/// rather than for reporting the differences.
+CompareResults OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
+                                 float failthresh, float warnthresh,
+                                 imagesize_t maxfail, float hardfail,
+                                 ROI roi={}, int nthreads=0);
+
 // DEPRECATED(1.9): with C++11 move semantics, there's no reason why
 // result needs to be passed as a parameter instead of returned.
 bool OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
@@ -1027,6 +1112,25 @@ std::string OIIO_API computePixelHashSHA1 (const ImageBuf &src,
                                            ROI roi={},
                                            int blocksize = 0, int nthreads=0);
 
+/// Compute a hash of all the pixels in the specified region of the image,
+/// using the named algorithm: "xxhash64" (the XXH64 hash, 16 hex digits),
+/// "farmhash128" (farmhash's 128 bit fingerprint, 32 hex digits), or
+/// "sha1" (the same result as computePixelHashSHA1). The xxhash64 and
+/// farmhash128 hashes are much faster to compute than SHA-1, but are not
+/// cryptographic.
+///
+/// Except for "sha1" with blocksize 0, the hash is computed as a tree:
+/// each batch of 'blocksize' scanlines (256 if blocksize <= 0) is hashed
+/// separately and in parallel, then the block hashes, in order, and the
+/// 'extrainfo' text are hashed together to give the result. So the result
+/// depends on the blocksize, but never on the number of threads.  If the
+/// algorithm is not recognized, an empty string is returned.
+std::string OIIO_API computePixelHash (const ImageBuf &src,
+                                       string_view algorithm,
+                                       string_view extrainfo = "",
+                                       ROI roi={},
+                                       int blocksize = 0, int nthreads=0);
+
 
 /// Warp the src image using the supplied 3x3 transformation matrix.
 ///
@@ -1647,6 +1751,7 @@ enum OIIO_API MakeTextureMode {
     MakeTxTexture, MakeTxShadow, MakeTxEnvLatl,
     MakeTxEnvLatlFromLightProbe,
     MakeTxBumpWithSlopes,
+    MakeTxEnvLatlFromCubeFaces,
     _MakeTxLast
 };
 
@@ -1657,6 +1762,10 @@ enum OIIO_API MakeTextureMode {
 ///    MakeTxEnvLatl    Latitude-longitude environment map
 ///    MakeTxEnvLatlFromLightProbe   Latitude-longitude environment map
 ///                     constructed from a "light probe" image.
+///    MakeTxEnvLatlFromCubeFaces    Latitude-longitude environment map
+///                     constructed from the six faces of a cube map
+///                     (+x -x +y -y +z -z), stacked vertically or
+///                     side by side in one image.
 ///
 /// If the outstream pointer is not NULL, it should point to a stream
 /// (for example, &std::out, or a pointer to a local std::stringstream
@@ -1783,6 +1892,12 @@ enum OIIO_API MakeTextureMode {
 ///                               the sake of ImageBuf math. (1)
 ///    maketx:hash (int)
 ///                           Compute the sha1 hash of the file in parallel. (1)
+///    maketx:hash_algorithm (string)
+///                           Algorithm for the pixel hash, as accepted by
+///                               computePixelHash(). Hashes other than
+///                               "sha1" are stored as "oiio:PixelHash",
+///                               prefixed by the algorithm name and a
+///                               colon. ("sha1")
 ///    maketx:allow_pixel_shift (int)
 ///                           Allow up to a half pixel shift per mipmap level.
 ///                               The fastest path may result in a slight shift
@@ -1794,6 +1909,29 @@ enum OIIO_API MakeTextureMode {
 ///                               ("height"), a normal map ("normal"), or
 ///                               automatically determine it from the number
 ///                               of channels ("auto", the default).
+///    maketx:pipeline (int)
+///                           If nonzero, each MIP level is compressed and
+///                               written by a background thread while the
+///                               next one is computed. (1)
+///    maketx:stream (int)
+///                           Build a box filtered MIP-map a band of
+///                               scanlines at a time, without a full size
+///                               copy of any level: 0 = never, 1 = when
+///                               the input is too big to be read into
+///                               memory (see maketx:read_local_MB),
+///                               2 = whenever possible. (1)
+///    maketx:incremental (int)
+///                           If nonzero, keep the hash of each top level
+///                               tile in "<outputfilename>.tilehash", and
+///                               when the texture is remade with the same
+///                               settings, recompute only the parts of a
+///                               box filtered MIP-map that depend on
+///                               tiles that have changed. (0)
+///    maketx:constant_tiles (int)
+///                           If nonzero, record in each level's
+///                               "oiio:ConstantTiles" metadata which of
+///                               its tiles are all one value, so that
+///                               the ImageCache need not read them. (0)
 ///
 bool OIIO_API make_texture (MakeTextureMode mode,
                             const ImageBuf &input,
@@ -1817,6 +1955,66 @@ bool OIIO_API make_texture (MakeTextureMode mode,
                             const ImageSpec &config,
                             std::ostream *outstream = nullptr);
 
+/// make_texture_batch(): Convert each of the files inputs[i] to a texture
+/// outputs[i] (or, if outputs is empty or outputs[i] is "", the usual
+/// name derived from the input), all with the same mode and config,
+/// running many conversions at once on the shared thread pool.  Inputs of
+/// at least config's "maketx:batch_big_MB" (int, default 64) megabytes are
+/// converted one at a time, each using all the threads it can; the
+/// smaller ones are converted concurrently, one thread each.  The
+/// messages of each conversion are written to outstream together when it
+/// is done.  Return true if every conversion succeeded; if results is
+/// not null, it is set to the success of each.
+bool OIIO_API make_texture_batch (MakeTextureMode mode,
+                                  const std::vector<std::string> &inputs,
+                                  const std::vector<std::string> &outputs,
+                                  const ImageSpec &config,
+                                  std::ostream *outstream = nullptr,
+                                  std::vector<bool> *results = nullptr);
+
+
+/// stream_to_file(): Compute an image described by spec a band of rows at
+/// a time, writing each band to the file outputfilename as soon as it is
+/// done, so that the whole result is never held in memory at once.
+///
+/// For each band, func(dst, roi) is called with dst already allocated to
+/// cover exactly roi (all channels and the full width of the image, and
+/// bandheight rows), and should fill it, typically by calling ImageBufAlgo
+/// functions with that dst and roi. Inputs read through the ImageCache
+/// (such as an ImageBuf constructed from a filename and not read
+/// explicitly) are only paged in as the bands need them, so peak memory
+/// is about one band plus the cache's own limit, which allows pointwise
+/// and small-stencil operations on images far larger than RAM:
+///
+///     ImageBuf A ("huge.exr");    // cache-backed, not read into memory
+///     ImageBufAlgo::stream_to_file ("out.exr", A.spec(),
+///         [&](ImageBuf &dst, ROI roi) {
+///             return ImageBufAlgo::mul (dst, A, 0.5f, roi);
+///         });
+///
+/// If spec is tiled and the file format supports tiles, each band is
+/// written with write_tiles and bandheight is rounded up to a multiple of
+/// the tile height; otherwise bands are written with write_scanlines. A
+/// bandheight < 1 selects a default of 64 rows. Volume images are not
+/// supported.
+///
+/// Return true on success, or false if func returns false or the file
+/// cannot be written, in which case an error message may be retrieved
+/// with OIIO::geterror().
+bool OIIO_API stream_to_file (string_view outputfilename,
+                              const ImageSpec &spec,
+                              function_view<bool(ImageBuf &dst, ROI roi)> func,
+                              int bandheight = 0);
+
+/// stream_to_output(): Like stream_to_file, but writes the bands to the
+/// current subimage of an ImageOutput that the caller has already opened
+/// (its spec() describes the image to compute), and does not close it.
+/// This lets a caller that manages its own output -- choosing the format,
+/// appending subimages, writing to a temporary file -- still stream.
+bool OIIO_API stream_to_output (ImageOutput *out,
+                        function_view<bool(ImageBuf &dst, ROI roi)> func,
+                        int bandheight = 0);
+
 
 ///////////////////////////////////////////////////////////////////////
 // DEPRECATED(1.9): These are all functions that take raw pointers,
@@ -89,6 +89,32 @@ parallel_image (ROI roi, parallel_image_options opt,
         return;
     }
 
+    if (opt.adaptive) {
+        // Many small tiles, scheduled by work stealing. Default to about
+        // 64x64 pixels, or else whole multiples of the requested tile grid
+        // at least that big, with the grid's partial tiles at the edges.
+        int tw = 64, th = 64, x0 = roi.xbegin, y0 = roi.ybegin;
+        if (opt.tile_width > 0 && opt.tile_height > 0) {
+            tw = opt.tile_width * std::max (1, 64 / opt.tile_width);
+            th = opt.tile_height * std::max (1, 64 / opt.tile_height);
+            x0 = opt.tile_xorigin + ((roi.xbegin - opt.tile_xorigin) / tw) * tw;
+            y0 = opt.tile_yorigin + ((roi.ybegin - opt.tile_yorigin) / th) * th;
+            if (x0 > roi.xbegin)
+                x0 -= tw;
+            if (y0 > roi.ybegin)
+                y0 -= th;
+        }
+        int64_t ntx = (roi.xend - x0 + tw - 1) / tw;
+        int64_t nty = (roi.yend - y0 + th - 1) / th;
+        parallel_for_adaptive (0, ntx * nty, [&](int id, int64_t t) {
+            int xb = x0 + int(t % ntx) * tw, yb = y0 + int(t / ntx) * th;
+            f (ROI (std::max (xb, roi.xbegin), std::min (xb + tw, roi.xend),
+                    std::max (yb, roi.ybegin), std::min (yb + th, roi.yend),
+                    roi.zbegin, roi.zend, roi.chbegin, roi.chend));
+        }, opt);
+        return;
+    }
+
     // If splitdir was not explicit, find the longest edge.
     SplitDir splitdir = opt.splitdir;
     if (splitdir == Split_Biggest)
@@ -137,6 +163,28 @@ parallel_image (Func f, ROI roi, int nthreads=0, SplitDir splitdir=Split_Y)
 
 
 
+/// Return parallel_image_options for adaptive (work stealing) scheduling,
+/// for operations whose cost varies a lot across the image. If src is
+/// given and is ImageCache-backed and tiled, with pixels in the same
+/// coordinates as the region being computed, the tasks are aligned to its
+/// tiles.
+inline parallel_image_options
+adaptive_options (int nthreads, const ImageBuf *src = nullptr)
+{
+    parallel_image_options opt (nthreads);
+    opt.adaptive = true;
+    if (src && src->storage() == ImageBuf::IMAGECACHE
+        && src->spec().tile_width > 0 && src->spec().tile_height > 0) {
+        opt.tile_width   = src->spec().tile_width;
+        opt.tile_height  = src->spec().tile_height;
+        opt.tile_xorigin = src->spec().x;
+        opt.tile_yorigin = src->spec().y;
+    }
+    return opt;
+}
+
+
+
 /// Common preparation for IBA functions: Given an ROI (which may or may not
 /// be the default ROI::All()), destination image (which may or may not yet
 /// be allocated), and optional input images, adjust roi if necessary and
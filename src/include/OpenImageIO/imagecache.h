@@ -93,7 +93,11 @@ public:
     ///     string plugin_searchpath : colon-separated search path for plugins
     ///     int autotile : if >0, tile size to emulate for non-tiled images
     ///     int autoscanline : autotile using full width tiles
+    ///     int autotile_parallel : slice autotiled bands into tiles in
+    ///                          parallel (default=0)
     ///     int automip : if nonzero, emulate mipmap on the fly
+    ///     int automip_sidecar : if nonzero, save automip levels to (and
+    ///                          later read them from) "file.automip.tx"
     ///     int accept_untiled : if nonzero, accept untiled images, but
     ///                          if zero, reject untiled images (default=1)
     ///     int accept_unmipped : if nonzero, accept unmipped images (def=1)
@@ -106,6 +110,58 @@ public:
     ///     int unassociatedalpha : if nonzero, keep unassociated alpha images
     ///     int max_errors_per_file : Limits how many errors to issue for
     ///                               issue for each (default: 100)
+    ///     float max_compressed_memory_MB : if >0, size of a second tier
+    ///                        that keeps evicted tiles zlib-compressed in
+    ///                        memory, so re-reading them skips the file
+    ///     string tile_disk_cache : if not empty, a (local) directory where
+    ///                        tiles read from files are stored, and found
+    ///                        again by this or other processes
+    ///     int tile_disk_cache_MB : size limit of the tile_disk_cache
+    ///                        directory, past which the least recently
+    ///                        used tiles are removed; 0 for no limit
+    ///                        (default: 10240)
+    ///     string shared_tile_memory : if not empty, a file (ideally on a
+    ///                        RAM disk) to map as a tile store shared by
+    ///                        all processes using the same name, whose
+    ///                        tiles are used in place
+    ///     int shared_tile_memory_MB : size of a newly created shared tile
+    ///                        store (default: 1024)
+    ///     int mmap_tiles : if nonzero, use tiles of uncompressed files in
+    ///                        the native data type directly from a memory
+    ///                        mapping of the file (default: 0)
+    ///     int tile_pool : if nonzero, recycle the pixel memory of evicted
+    ///                        tiles through a pool of slabs rather than
+    ///                        the heap (default: 1)
+    ///     int tile_pool_hugepages : if nonzero, back tile pool slabs with
+    ///                        huge pages where possible (default: 0)
+    ///     string record_manifest : if not empty, record which tiles are
+    ///                        read, and write them to this file when the
+    ///                        cache is destroyed or the attribute changes
+    ///                        (see replay_manifest())
+    ///     int numa : if nonzero, on a multi-socket machine, track which
+    ///                        NUMA node holds each tile and give hot tiles
+    ///                        a copy on each node using them (default: 0)
+    ///     int numa_replicate_hits : main cache hits from another node
+    ///                        before a tile is copied there (default: 64)
+    ///     int numa_nodes : (read only) NUMA nodes in use, 1 if not in
+    ///                        numa mode
+    ///     int microcache_size : number of recently used tiles each
+    ///                        thread remembers without consulting the
+    ///                        main cache, 1-16 (default: 2)
+    ///     int max_inputs_per_file : max ImageInputs that may be open for
+    ///                        one file so its tiles can be read by several
+    ///                        threads at once (default: 1)
+    ///     int prefetch_threads : if >0, number of background threads
+    ///                            that service prefetch_tiles() (default: 0)
+    ///     int get_pixels_threads : threads that may share the work of
+    ///                        one get_pixels() call, 0 = as many as the
+    ///                        default thread pool has (default: 1)
+    ///     int autoprefetch : if nonzero (and prefetch_threads > 0), after
+    ///                        a cache miss, queue the neighboring tiles and
+    ///                        the next-coarser MIP level tile for reading
+    ///     string tile_eviction : "clock" (default) or "segmented", the
+    ///                        latter protecting frequently used tiles
+    ///                        from being flushed by single-use ones
     ///
     virtual bool attribute (string_view name, TypeDesc type,
                             const void *val) = 0;
@@ -302,6 +358,28 @@ public:
                              int x, int y, int z,
                              int chbegin = 0, int chend = -1) = 0;
 
+    /// One of the tiles wanted by get_tiles(): the tile of the given
+    /// subimage and MIP level that contains pixel (x,y,z), holding
+    /// channels [chbegin,chend) (all channels if chend < chbegin).
+    struct TileRequest {
+        int subimage = 0, miplevel = 0;
+        int x = 0, y = 0, z = 0;
+        int chbegin = 0, chend = -1;
+    };
+
+    /// Retrieve many tiles of one file at once, as if by a get_tile()
+    /// call for each of requests[i], storing the result (or NULL) in
+    /// tiles[i], which must be at least as long.  Every non-NULL tile
+    /// must be passed to release_tile() when done with it.  This is
+    /// cheaper than calling get_tile() repeatedly: requests falling in
+    /// the same part of the cache share one lock of it, and the tiles
+    /// that need reading are read together, so that neighboring tiles of
+    /// the file may come from a single larger read.  Return the number
+    /// of tiles retrieved.
+    virtual int get_tiles (ImageHandle *file, Perthread *thread_info,
+                           cspan<TileRequest> requests,
+                           span<Tile*> tiles) = 0;
+
     /// After finishing with a tile, release_tile will allow it to
     /// once again be purged from the tile cache if required.
     virtual void release_tile(Tile* tile) const = 0;
@@ -320,6 +398,29 @@ public:
     /// the data type of the pixels in the disk file).
     virtual const void* tile_pixels(Tile* tile, TypeDesc& format) const = 0;
 
+    /// Hint that the tiles of the given image, subimage and MIP level
+    /// covering the pixel region roi (and its channel range) will be
+    /// needed soon.  If roi is not defined, all the tiles of that level are
+    /// requested.  When the "prefetch_threads" attribute is nonzero, tiles
+    /// not already in the cache are queued to be read by a pool of
+    /// background I/O threads and this call returns immediately; otherwise
+    /// they are read by the calling thread before returning.  Return true
+    /// if the request was valid, false (with an error message retrievable
+    /// via geterror()) if the file, subimage or MIP level does not exist.
+    virtual bool prefetch_tiles (ustring filename, int subimage,
+                                 int miplevel, ROI roi = ROI::All()) = 0;
+    virtual bool prefetch_tiles (ImageHandle *file, Perthread *thread_info,
+                                 int subimage, int miplevel,
+                                 ROI roi = ROI::All()) = 0;
+
+    /// Prefetch (as with prefetch_tiles()) every tile listed in a tile
+    /// manifest written by an earlier run with the "record_manifest"
+    /// attribute, in the order that run first needed them.  Tiles of
+    /// files that no longer exist, or no longer have that subimage or MIP
+    /// level, are skipped.  Return true if the manifest could be read,
+    /// false (with an error message retrievable via geterror()) if not.
+    virtual bool replay_manifest (string_view manifest) = 0;
+
     /// The add_file() call causes a file to be opened or added to the
     /// cache. There is no reason to use this method unless you are
     /// supplying a custom creator, or configuration, or both.
@@ -378,6 +479,17 @@ public:
     ///
     virtual std::string getstats(int level = 1) const = 0;
 
+    /// Return a snapshot of the statistics in a form meant for programs
+    /// to read rather than people, cheap enough to call every second or
+    /// so from a long-running service: counters and gauges for tiles,
+    /// evictions, hits and misses in each bin of the tile cache, open
+    /// file churn, and bytes read per file, as well as histograms of tile
+    /// read times and of waits for other threads' reads.  The format may
+    /// be "json" (one object) or "prometheus" (the Prometheus text
+    /// exposition format, with names prefixed "oiio_imagecache_").  For
+    /// any other format, return an empty string and set an error.
+    virtual std::string getmetrics(string_view format = "json") const = 0;
+
     /// Reset most statistics to be as they were with a fresh
     /// ImageCache.  Caveat emptor: this does not flush the cache itelf,
     /// so the resulting statistics from the next set of texture
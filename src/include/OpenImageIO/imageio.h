@@ -67,6 +67,7 @@ OIIO_NAMESPACE_BEGIN
 
 class DeepData;
 struct ROI;
+namespace Filesystem { class IOProxy; }
 
 
 /// Type we use for stride lengths.  This is only used to designate
@@ -489,6 +490,22 @@ public:
     ///
     void from_xml (const char *xml);
 
+    /// Append to blob a compact, versioned binary encoding of the whole
+    /// ImageSpec -- all the fields, channel names and formats, and typed
+    /// metadata (except pointers) -- for caching specs on disk or passing
+    /// them between processes.  It is much faster to write and read than
+    /// the text or XML serializations.
+    void to_binary (std::vector<char> &blob) const;
+
+    /// Restore the ImageSpec from a block that to_binary() wrote at the
+    /// start of data, returning the number of bytes the block occupies,
+    /// or 0 (leaving the spec untouched) if it is malformed, truncated, or
+    /// of an unknown version.  If copy is false and data is 8-byte
+    /// aligned, metadata values too large to store inline are not copied
+    /// but refer directly into data, which then must outlive this spec
+    /// and every copy made of it.
+    size_t from_binary (cspan<char> data, bool copy = true);
+
     /// Helper function to verify that the given pixel range exactly covers
     /// a set of tiles.  Also returns false if the spec indicates that the
     /// image isn't tiled at all.
@@ -678,6 +695,10 @@ public:
     ///    "procedural"     Can this format create images without reading
     ///                        from a disk file?
     ///    "ioproxy"        Does this format reader support IOProxy?
+    ///    "concurrent_scanlines" May several threads read different
+    ///                        scanlines of an open file at once, without
+    ///                        waiting on each other? (If so, read_image
+    ///                        reads scanline images in parallel chunks.)
     ///
     /// Note that main advantage of this approach, versus having
     /// separate individual supports_foo() methods, is that this allows
@@ -707,6 +728,11 @@ public:
     /// instructions.  ImageInput implementations are free to not
     /// respond to any such requests, so the default implementation is
     /// just to ignore config and call regular open(name,newspec).
+    ///
+    /// A request any reader may honor is "oiio:HeaderOnly" (int): if
+    /// nonzero, the caller wants only the specs and metadata, so opening
+    /// and seeking should do no pixel I/O or decoding, and reading pixels
+    /// from this ImageInput may fail.
     virtual bool open (const std::string &name, ImageSpec &newspec,
                        const ImageSpec & /*config*/) { return open(name,newspec); }
 
@@ -1067,6 +1093,41 @@ public:
     virtual bool read_native_deep_image (int subimage, int miplevel,
                                          DeepData &deepdata);
 
+    /// If the native tile of the given subimage and MIP level whose
+    /// origin is (x,y,z) is stored in the file as exactly the
+    /// spec.tile_bytes() bytes that read_native_tile() would deliver
+    /// (uncompressed, all channels interleaved, in the machine's byte
+    /// order, and needing no color or alpha conversion), store its byte
+    /// offset within the file in offset and return true.  Otherwise,
+    /// return false, and the tile must be read the usual way.  This lets
+    /// a caller such as the ImageCache use the tile in place from a
+    /// memory mapping of the file.  The default implementation always
+    /// returns false.
+    virtual bool native_tile_offset (int subimage, int miplevel,
+                                     int x, int y, int z,
+                                     imagesize_t &offset);
+
+    /// If the native tile of the given subimage and MIP level whose
+    /// origin is (x,y,z) holds the same value in every pixel, and the
+    /// format can tell so without decoding the tile (for example, a
+    /// region of a sparse volume with no active voxels), store that one
+    /// pixel in value (spec.pixel_bytes(true) bytes, all channels, native
+    /// data format) and return true.  Otherwise, return false, and the
+    /// tile must be read the usual way.  The default implementation
+    /// always returns false.
+    virtual bool native_tile_constant (int subimage, int miplevel,
+                                       int x, int y, int z, void *value);
+
+    /// Read the whole native image (MIP level 0, all channels) of each of
+    /// the n subimages listed in subimages into data[i], laid out as
+    /// read_image would with format TypeDesc::UNKNOWN and default
+    /// strides.  Formats that can decode several subimages at once, such
+    /// as the parts of a multi-part OpenEXR file, may overlap them.  The
+    /// default implementation reads them one after another.  Deep
+    /// subimages are not supported.
+    virtual bool read_native_subimages (int n, const int *subimages,
+                                        void **data);
+
     // DEPRECATED(1.9), Now just used for back compatibility:
     bool read_native_deep_scanlines (int ybegin, int yend, int z,
                              int chbegin, int chend, DeepData &deepdata) {
@@ -1140,6 +1201,13 @@ public:
     bool try_lock () { return m_mutex.try_lock(); }
     void unlock () { m_mutex.unlock(); }
 
+    /// Take ownership of the IOProxy this ImageInput was opened with (via
+    /// the "oiio:ioproxy" configuration hint), so that the proxy lives
+    /// exactly as long as the ImageInput. ImageInput::open(), create() and
+    /// the ImageCache do this for the proxies they make for URLs (see
+    /// Filesystem::open_url).
+    void adopt_ioproxy (Filesystem::IOProxy *io);
+
     // Custom new and delete to ensure that allocations & frees happen in
     // the OpenImageIO library, not in the app or plugins (because Windows).
     void* operator new (size_t size);
@@ -1156,6 +1224,7 @@ protected:
 private:
     mutable std::string m_errmessage;  // private storage of error message
     int m_threads;    // Thread policy
+    std::unique_ptr<Filesystem::IOProxy> m_owned_io;  // see adopt_ioproxy
     void append_error (const std::string& message) const; // add to m_errmessage
     // Deprecated:
     static unique_ptr create (const std::string &filename, bool do_open,
@@ -1570,6 +1639,79 @@ private:
 
 
 
+/// AsyncImageOutput wraps any other ImageOutput and writes "behind" the
+/// caller: write_scanline(s), write_tile(s) and write_rectangle copy the
+/// caller's pixels into a queue and return, and a background thread hands
+/// the queued blocks, in order, to the wrapped ImageOutput, which does the
+/// conversion, compression and I/O.  At most max_queued_bytes of pixels
+/// are held in the queue; a write that would exceed that waits until
+/// enough of the queue has been written (a single block larger than the
+/// limit is still accepted when the queue is empty).
+///
+/// An error in a background write is reported (through the return value
+/// and geterror()) by the next write, by wait(), or at the latest by
+/// close(), and any writes queued after it are discarded.  Calls that
+/// depend on all earlier writes having been done -- open() of a further
+/// subimage or MIP level, close(), deep writes and copy_image() -- first
+/// wait for the queue to drain.
+class OIIO_API AsyncImageOutput : public ImageOutput {
+public:
+    AsyncImageOutput (ImageOutput::unique_ptr output,
+                      imagesize_t max_queued_bytes = 256*1024*1024);
+    virtual ~AsyncImageOutput ();
+
+    virtual const char *format_name (void) const;
+    virtual int supports (string_view feature) const;
+    virtual bool open (const std::string &name, const ImageSpec &newspec,
+                       OpenMode mode=Create);
+    virtual bool open (const std::string &name, int subimages,
+                       const ImageSpec *specs);
+    virtual bool close ();
+    virtual bool write_scanline (int y, int z, TypeDesc format,
+                                 const void *data, stride_t xstride=AutoStride);
+    virtual bool write_scanlines (int ybegin, int yend, int z,
+                                  TypeDesc format, const void *data,
+                                  stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride);
+    virtual bool write_tile (int x, int y, int z, TypeDesc format,
+                             const void *data, stride_t xstride=AutoStride,
+                             stride_t ystride=AutoStride,
+                             stride_t zstride=AutoStride);
+    virtual bool write_tiles (int xbegin, int xend, int ybegin, int yend,
+                              int zbegin, int zend, TypeDesc format,
+                              const void *data, stride_t xstride=AutoStride,
+                              stride_t ystride=AutoStride,
+                              stride_t zstride=AutoStride);
+    virtual bool write_rectangle (int xbegin, int xend, int ybegin, int yend,
+                                  int zbegin, int zend, TypeDesc format,
+                                  const void *data, stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride,
+                                  stride_t zstride=AutoStride);
+    virtual bool write_deep_scanlines (int ybegin, int yend, int z,
+                                       const DeepData &deepdata);
+    virtual bool write_deep_tiles (int xbegin, int xend, int ybegin, int yend,
+                                   int zbegin, int zend,
+                                   const DeepData &deepdata);
+    virtual bool write_deep_image (const DeepData &deepdata);
+    virtual bool copy_image (ImageInput *in);
+
+    /// Wait until all queued writes have been done. Return true if they
+    /// all succeeded, otherwise set the error message and return false.
+    bool wait ();
+
+    /// The number of bytes of pixels currently queued.
+    imagesize_t queued_bytes () const;
+
+    /// The wrapped ImageOutput.
+    ImageOutput *output () const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+
+
 // Utility functions
 
 /// Retrieve the version of OpenImageIO for the library.  This is so
@@ -1592,6 +1734,10 @@ OIIO_API std::string geterror ();
 ///             How many threads to use for operations that can be sped
 ///             by spawning threads (default=0, meaning to use the full
 ///             available hardware concurrency detected).
+///     int background_threads
+///             How many low-priority threads are in the shared background
+///             pool used for asynchronous I/O (default=0, meaning a
+///             quarter of the hardware concurrency, but at least 2).
 ///     int exr_threads
 ///             The size of the internal OpenEXR thread pool. The default
 ///             is to use the full available hardware concurrency detected.
@@ -1601,6 +1747,14 @@ OIIO_API std::string geterror ();
 ///     string plugin_searchpath
 ///             Colon-separated list of directories to search for 
 ///             dynamically-loaded format plugins.
+///     int plugin_manifest
+///             When nonzero (the default), plugins listed in an up to date
+///             "imageio.manifest" file in their directory are only loaded
+///             when one of their formats is first needed. When 2 or more,
+///             a directory whose plugins had to be loaded to find out
+///             their formats also gets its manifest (re)written, if it's
+///             writeable. When 0, every plugin is loaded when the
+///             searchpath is first scanned.
 ///     int read_chunk
 ///             The number of scanlines that will be attempted to read at
 ///             once for read_image calls (default: 256).
@@ -1619,6 +1773,20 @@ OIIO_API std::string geterror ();
 ///             When nonzero, allows TIFF to write 'half' pixel data.
 ///             N.B. Most apps may not read these correctly, but OIIO will.
 ///             That's why the default is not to support it.
+///     int imagebuf:pool
+///             When nonzero, large ImageBuf local pixel buffers are
+///             returned to a recycling pool when freed, and later
+///             allocations of a similar size reuse them (default: 0).
+///     int imagebuf:pool_budget_MB
+///             Maximum amount of idle memory the pool may hold, in MB
+///             (default: 2048). Larger idle blocks are released first.
+///     int imagebuf:pool_hugepages
+///             When nonzero, new pooled blocks are rounded up to a
+///             multiple of 2MB and advised to use transparent huge pages
+///             where the OS supports it (default: 0).
+///     int imagebuf:pool_zero
+///             When nonzero, recycled blocks are cleared to zero before
+///             being handed out again (default: 1).
 ///
 OIIO_API bool attribute (string_view name, TypeDesc type, const void *val);
 // Shortcuts for common types
@@ -1673,9 +1841,20 @@ inline bool attribute (string_view name, string_view val) {
 ///             Comma-separated list of the SIMD-related capabilities
 ///             detected at runtime at the time of the query (which may not
 ///             match the support compiled into the library).
+///     string "oiio:simd_dispatch"
+///             The instruction set ("avx2", "avx512") of the kernels
+///             chosen at runtime for the hottest loops (such as pixel
+///             type conversions), or "" if none better than those the
+///             library was compiled for were built or are supported.
 ///     int "resident_memory_used_MB"
 ///             Approximate process memory used (resident) by the application,
 ///             in MB. This might be helpful in debugging.
+///     int "imagebuf:pool_hits", "imagebuf:pool_misses",
+///         "imagebuf:pool_evictions", "imagebuf:pool_idle_MB"
+///             Statistics for the ImageBuf pixel pool: allocations satisfied
+///             by a recycled block, allocations that needed fresh memory,
+///             idle blocks released to stay within budget, and the amount
+///             of idle memory currently held, in MB.
 OIIO_API bool getattribute (string_view name, TypeDesc type, void *val);
 // Shortcuts for common types
 inline bool getattribute (string_view name, int &val) {
@@ -72,15 +72,19 @@ public:
     // Fix up all the TBD parameters:
     // * If no pool was specified, use the default pool.
     // * If no max thread count was specified, use the pool size.
-    // * If the calling thread is itself in the pool and the recursive flag
-    //   was not turned on, just use one thread.
+    // * If the calling thread is running a pool task without being one of
+    //   the pool's own threads, and the recursive flag was not turned on,
+    //   just use one thread. (A pool thread's own subtasks go on its deque
+    //   for idle threads to steal, and it runs any that are left itself
+    //   while it waits, so nested loops can use the whole pool.)
     void resolve()
     {
         if (pool == nullptr)
             pool = default_thread_pool();
         if (maxthreads <= 0)
             maxthreads = pool->size() + 1;  // pool size + caller
-        if (!recursive && pool->is_worker())
+        if (!recursive && pool->is_worker()
+            && !pool->this_thread_is_in_pool())
             maxthreads = 1;
     }
 
@@ -90,8 +94,20 @@ public:
     SplitDir splitdir = Split_Y;  // Primary split direction
     bool recursive    = false;    // Allow thread pool recursion
     size_t minitems   = 16384;    // Min items per task
-    thread_pool* pool = nullptr;  // If non-NULL, custom thread pool
+    thread_pool* pool = nullptr;  // If non-NULL, custom (e.g., named) pool
     string_view name;             // For debugging
+
+    // Adaptive scheduling: rather than a few equal chunks, split the work
+    // into many small tiles handed out by work stealing, for loops whose
+    // cost per item varies a lot. If tile_width/tile_height are set,
+    // parallel_image makes its tiles whole multiples of that grid (whose
+    // origin is tile_xorigin, tile_yorigin), such as an ImageCache-backed
+    // source's tiles, so that no two tasks share an image tile.
+    bool adaptive    = false;
+    int tile_width   = 0;
+    int tile_height  = 0;
+    int tile_xorigin = 0;
+    int tile_yorigin = 0;
 };
 
 
@@ -123,6 +139,37 @@ parallel_for_chunked(int64_t start, int64_t end, int64_t chunksize,
 
 
 
+/// Parallel "for" loop with work stealing: run task(threadid, i) for every
+/// i in [start,end). Each thread starts with an equal, contiguous share of
+/// the indices, which it runs in order; a thread that runs out steals the
+/// upper half of the remaining share of the busiest other thread. This
+/// balances loads where the cost per index varies widely, while keeping
+/// each thread's indices mostly adjacent.
+OIIO_API void
+parallel_for_adaptive(int64_t start, int64_t end,
+                      std::function<void(int id, int64_t index)>&& task,
+                      parallel_options opt = parallel_options(0, Split_Y, 1));
+// Implementation is in thread.cpp
+
+
+
+/// Parallel "for" loop whose results are consumed in order: run
+/// task(i) for every i in [start,end) on up to nthreads threads (0 = as
+/// many as there are cores), and done(i) on the calling thread, in order
+/// of i, as soon as task(i) has finished. At most `window` indices (0 =
+/// four per thread) are ever running or finished but not yet done, which
+/// bounds whatever per-index state task() leaves for done(). The tasks
+/// run on threads of their own rather than the thread pool, so they may
+/// block on I/O, and may themselves use the pool.
+OIIO_API void
+parallel_for_ordered(int64_t start, int64_t end,
+                     std::function<void(int64_t index)>&& task,
+                     std::function<void(int64_t index)>&& done,
+                     int nthreads = 0, int64_t window = 0);
+// Implementation is in thread.cpp
+
+
+
 /// Parallel "for" loop, chunked: for a task that takes a [begin,end) range
 /// (but not a thread ID).
 inline void
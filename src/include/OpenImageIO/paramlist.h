@@ -38,6 +38,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include <OpenImageIO/export.h>
@@ -250,15 +251,57 @@ private:
 /// A list of ParamValue entries, that can be iterated over or searched.
 /// It's really just a std::vector<ParamValue>, but with a few more handy
 /// methods.
+///
+/// Searches of a long list (such as the hundreds of metadata items of an
+/// EXR or camera raw file) use an index of the names, built the first
+/// time it's searched. The index keeps up with entries appended to the
+/// list and with changes made by the methods of this class, but not with
+/// entries erased, renamed, or reordered through the std::vector methods,
+/// operator[], or iterators. Call invalidate_index() after doing those.
 class OIIO_API ParamValueList : public std::vector<ParamValue> {
 public:
     ParamValueList() {}
+    ParamValueList(const ParamValueList& p)
+        : std::vector<ParamValue>(p)
+    {
+    }
+    ParamValueList(ParamValueList&& p)
+        : std::vector<ParamValue>(std::move(p))
+    {
+        // The index describes the storage that is now ours
+        m_index = p.m_index.exchange(nullptr);
+    }
+    ~ParamValueList() { invalidate_index(); }
+
+    ParamValueList& operator=(const ParamValueList& p)
+    {
+        invalidate_index();
+        std::vector<ParamValue>::operator=(p);
+        return *this;
+    }
+    ParamValueList& operator=(ParamValueList&& p)
+    {
+        invalidate_index();
+        std::vector<ParamValue>::operator=(std::move(p));
+        m_index = p.m_index.exchange(nullptr);
+        return *this;
+    }
+
+    /// Exchange the contents of two lists.
+    void swap(ParamValueList& p)
+    {
+        std::vector<ParamValue>::swap(p);
+        m_index = p.m_index.exchange(m_index);
+    }
 
     /// Add space for one more ParamValue to the list, and return a
     /// reference to its slot.
     reference grow()
     {
+        const ParamValue* olddata = data();
         resize(size() + 1);
+        if (data() != olddata)
+            rebase_index(olddata);
         return back();
     }
 
@@ -317,6 +360,13 @@ public:
     // before "foo:a").
     void sort(bool casesensitive = true);
 
+    /// Remove all the entries.
+    void clear()
+    {
+        invalidate_index();
+        std::vector<ParamValue>::clear();
+    }
+
     /// Even more radical than clear, free ALL memory associated with the
     /// list itself.
     void free()
@@ -324,6 +374,20 @@ public:
         clear();
         shrink_to_fit();
     }
+
+    /// Discard the index of names used to speed up searches. Needed only
+    /// after renaming entries in place (see the class description); it
+    /// will be rebuilt when next needed.
+    void invalidate_index();
+
+private:
+    struct Index;
+    mutable std::atomic<Index*> m_index { nullptr };
+
+    const Index* index() const;
+    void rebase_index(const ParamValue* olddata);
+    size_t find_pos(string_view name, ustring uname, TypeDesc type,
+                    bool casesensitive) const;
 };
 
 
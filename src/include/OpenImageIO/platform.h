@@ -249,6 +249,14 @@
 #    define OIIO_FORCEINLINE inline
 #endif
 
+// OIIO_FLATTEN is a function attribute that asks the compiler to inline
+// every call within the function (and within what it inlines, and so on).
+#if defined(__GNUC__) || defined(__clang__) || __has_attribute(flatten)
+#    define OIIO_FLATTEN __attribute__((flatten))
+#else
+#    define OIIO_FLATTEN
+#endif
+
 // OIIO_PURE_FUNC is a function attribute that assures the compiler that the
 // function does not write to any non-local memory other than its return
 // value and has no side effects. This can ebable additional compiler
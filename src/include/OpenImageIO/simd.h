@@ -3734,6 +3734,12 @@ OIIO_FORCEINLINE vbool16::vbool16 (const vbool8& a, const vbool8& b) {
     load_bitmask (a.bitmask() | (b.bitmask() << 8));
 }
 
+OIIO_FORCEINLINE vbool16::vbool16 (const vbool4& a, const vbool4& b,
+                                   const vbool4& c, const vbool4& d) {
+    load_bitmask (a.bitmask() | (b.bitmask() << 4) | (c.bitmask() << 8)
+                  | (d.bitmask() << 12));
+}
+
 OIIO_FORCEINLINE vbool16::vbool16 (const bool *a) {
     load (a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
           a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15]);
@@ -3775,7 +3781,12 @@ OIIO_FORCEINLINE const vbool16 vbool16::True () {
 
 
 OIIO_FORCEINLINE void vbool16::store (bool *values) const {
+#if OIIO_SIMD_AVX >= 512 && OIIO_AVX512BW_ENABLED && OIIO_AVX512VL_ENABLED
+    // One byte of 0 or 1 per bool
+    _mm_storeu_si128 ((__m128i *)values, _mm_maskz_set1_epi8 (m_simd, 1));
+#else
     SIMD_DO (values[i] = m_bits & (1<<i));
+#endif
 }
 
 OIIO_FORCEINLINE void vbool16::store (bool *values, int n) const {
@@ -3787,16 +3798,22 @@ OIIO_FORCEINLINE void vbool16::store (bool *values, int n) const {
 
 
 OIIO_FORCEINLINE vbool8 vbool16::lo () const {
-#if OIIO_SIMD_AVX >= 512
+#if OIIO_SIMD_AVX >= 512 && OIIO_AVX512VL_ENABLED
     return _mm256_castsi256_ps (_mm256_maskz_set1_epi32 (bitmask()&0xff, -1));
+#elif OIIO_SIMD_AVX >= 512
+    __m512i ints = _mm512_maskz_set1_epi32 (m_simd, -1);
+    return _mm256_castsi256_ps (_mm512_castsi512_si256 (ints));
 #else
     SIMD_RETURN (vbool8, (*this)[i] ? -1 : 0);
 #endif
 }
 
 OIIO_FORCEINLINE vbool8 vbool16::hi () const {
-#if OIIO_SIMD_AVX >= 512
+#if OIIO_SIMD_AVX >= 512 && OIIO_AVX512VL_ENABLED
     return _mm256_castsi256_ps (_mm256_maskz_set1_epi32 (bitmask()>>8, -1));
+#elif OIIO_SIMD_AVX >= 512
+    __m512i ints = _mm512_maskz_set1_epi32 (m_simd, -1);
+    return _mm256_castsi256_ps (_mm512_extracti64x4_epi64 (ints, 1));
 #else
     SIMD_RETURN (vbool8, (*this)[i+8] ? -1 : 0);
 #endif
@@ -3858,7 +3875,7 @@ OIIO_FORCEINLINE vbool16 operator== (const vbool16 & a, const vbool16 & b) {
 #if OIIO_SIMD_AVX >= 512
     return _mm512_kxnor (a.simd(), b.simd());
 #else
-    return vbool16 (!(a.m_bits ^ a.m_bits));
+    return vbool16 (a.m_bits ^ b.m_bits ^ 0xffff);
 #endif
 }
 
@@ -3866,7 +3883,7 @@ OIIO_FORCEINLINE vbool16 operator!= (const vbool16 & a, const vbool16 & b) {
 #if OIIO_SIMD_AVX >= 512
     return _mm512_kxor (a.simd(), b.simd());
 #else
-    return vbool16 (a.m_bits ^ a.m_bits);
+    return vbool16 (a.m_bits ^ b.m_bits);
 #endif
 }
 
@@ -4138,7 +4155,7 @@ vint4::gather_mask (const bool_t& mask, const value_t *baseptr, const vint_t& vi
 #if OIIO_SIMD_AVX >= 2
     m_simd = _mm_mask_i32gather_epi32 (m_simd, baseptr, vindex, _mm_cvtps_epi32(mask), scale);
 #else
-    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : 0);
+    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : m_val[i]);
 #endif
 }
 
@@ -4926,7 +4943,7 @@ vint8::gather_mask (const bool_t& mask, const value_t *baseptr, const vint_t& vi
 #if OIIO_SIMD_AVX >= 2
     m_simd = _mm256_mask_i32gather_epi32 (m_simd, baseptr, vindex, _mm256_cvtps_epi32(mask), scale);
 #else
-    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : 0);
+    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : m_val[i]);
 #endif
 }
 
@@ -5767,7 +5784,7 @@ OIIO_FORCEINLINE vint8 vint16::hi () const {
 OIIO_FORCEINLINE vint16::vint16 (const vint8& lo, const vint8 &hi) {
 #if OIIO_SIMD_AVX >= 512
     __m512i r = _mm512_castsi256_si512 (lo);
-    m_simd = _mm512_inserti32x8 (r, hi, 1);
+    m_simd = _mm512_inserti64x4 (r, hi, 1);  // AVX512F, unlike inserti32x8
 #else
     m_8[0] = lo;
     m_8[1] = hi;
@@ -5903,9 +5920,7 @@ OIIO_FORCEINLINE vint16 operator~ (const vint16& a) {
 
 OIIO_FORCEINLINE vint16 operator<< (const vint16& a, const unsigned int bits) {
 #if OIIO_SIMD_AVX >= 512
-    return _mm512_sllv_epi32 (a, vint16(int(bits)));
-    // return _mm512_slli_epi32 (a, bits);
-    // FIXME: can this be slli?
+    return _mm512_sll_epi32 (a, _mm_cvtsi32_si128 (int(bits)));
 #else
     return vint16 (a.lo() << bits, a.hi() << bits);
 #endif
@@ -5918,8 +5933,7 @@ OIIO_FORCEINLINE const vint16& operator<<= (vint16& a, const unsigned int bits)
 
 OIIO_FORCEINLINE vint16 operator>> (const vint16& a, const unsigned int bits) {
 #if OIIO_SIMD_AVX >= 512
-    return _mm512_srav_epi32 (a, vint16(int(bits)));
-    // FIXME: can this be srai?
+    return _mm512_sra_epi32 (a, _mm_cvtsi32_si128 (int(bits)));
 #else
     return vint16 (a.lo() >> bits, a.hi() >> bits);
 #endif
@@ -5932,8 +5946,7 @@ OIIO_FORCEINLINE const vint16& operator>>= (vint16& a, const unsigned int bits)
 
 OIIO_FORCEINLINE vint16 srl (const vint16& a, const unsigned int bits) {
 #if OIIO_SIMD_AVX >= 512
-    return _mm512_srlv_epi32 (a, vint16(int(bits)));
-    // FIXME: can this be srli?
+    return _mm512_srl_epi32 (a, _mm_cvtsi32_si128 (int(bits)));
 #else
     return vint16 (srl(a.lo(), bits), srl (a.hi(), bits));
 #endif
@@ -6022,8 +6035,9 @@ OIIO_FORCEINLINE void vint16::store (int *values, int n) const {
 
 
 OIIO_FORCEINLINE void vint16::store (unsigned short *values) const {
-#if OIIO_SIMD_AVX512
-    _mm512_mask_cvtepi32_storeu_epi16 (values, __mmask16(0xff), m_simd);
+#if OIIO_SIMD_AVX >= 512
+    // Keeps the low 16 bits of each
+    _mm256_storeu_si256 ((__m256i *)values, _mm512_cvtepi32_epi16 (m_simd));
 #elif OIIO_SIMD_AVX >= 2
     lo().store (values);
     hi().store (values+8);
@@ -6034,8 +6048,9 @@ OIIO_FORCEINLINE void vint16::store (unsigned short *values) const {
 
 
 OIIO_FORCEINLINE void vint16::store (unsigned char *values) const {
-#if OIIO_SIMD_AVX512
-    _mm512_mask_cvtepi32_storeu_epi8 (values, __mmask16(0xff), m_simd);
+#if OIIO_SIMD_AVX >= 512
+    // Keeps the low 8 bits of each
+    _mm_storeu_si128 ((__m128i *)values, _mm512_cvtepi32_epi8 (m_simd));
 #elif OIIO_SIMD_AVX >= 2
     lo().store (values);
     hi().store (values+8);
@@ -6083,15 +6098,23 @@ template<int i> vint16 shuffle (const vint16& a) {
 
 template<int i>
 OIIO_FORCEINLINE int extract (const vint16& a) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm_extract_epi32 (_mm512_extracti32x4_epi32 (a.simd(), i/4), i&3);
+#else
     return a[i];
+#endif
 }
 
 
 template<int i>
 OIIO_FORCEINLINE vint16 insert (const vint16& a, int val) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_set1_epi32 (a.simd(), __mmask16(1<<i), val);
+#else
     vint16 tmp = a;
     tmp[i] = val;
     return tmp;
+#endif
 }
 
 
@@ -6112,6 +6135,15 @@ OIIO_FORCEINLINE void vint16::set_z (int val) { m_val[2] = val; }
 OIIO_FORCEINLINE void vint16::set_w (int val) { m_val[3] = val; }
 
 
+OIIO_FORCEINLINE vbool16::vbool16 (const vint16& ival) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_test_epi32_mask (ival, ival);
+#else
+    *this = (ival != vint16::Zero());
+#endif
+}
+
+
 OIIO_FORCEINLINE vint16 bitcast_to_int (const vbool16& x)
 {
 #if OIIO_SIMD_AVX >= 512
@@ -6242,7 +6274,11 @@ OIIO_FORCEINLINE vint16 max (const vint16& a, const vint16& b) {
 
 
 OIIO_FORCEINLINE vint16 rotl32 (const vint16& x, const unsigned int k) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_rolv_epi32 (x, vint16(int(k)));
+#else
     return (x<<k) | srl(x,32-k);
+#endif
 }
 
 
@@ -6620,7 +6656,7 @@ vfloat4::gather_mask (const bool_t& mask, const value_t *baseptr, const vint_t&
 #if OIIO_SIMD_AVX >= 2
     m_simd = _mm_mask_i32gather_ps (m_simd, baseptr, vindex, mask, scale);
 #else
-    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : 0);
+    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : m_val[i]);
 #endif
 }
 
@@ -7136,7 +7172,13 @@ OIIO_FORCEINLINE vfloat4 floor (const vfloat4& a)
 OIIO_FORCEINLINE vfloat4 round (const vfloat4& a)
 {
 #if OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return _mm_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    // Not _MM_FROUND_TO_NEAREST_INT, which rounds halves to even. Adding
+    // the float just below 0.5, with the sign of a, and truncating rounds
+    // halves away from 0, like roundf.
+    __m128 half = _mm_or_ps (_mm_and_ps (a, _mm_set1_ps (-0.0f)),
+                             _mm_set1_ps (0.49999997f));
+    return _mm_round_ps (_mm_add_ps (a, half),
+                         (_MM_FROUND_TO_ZERO |_MM_FROUND_NO_EXC));
 #else
     SIMD_RETURN (vfloat4, roundf(a[i]));
 #endif
@@ -8306,7 +8348,7 @@ vfloat8::gather_mask (const bool_t& mask, const value_t *baseptr, const vint_t&
 #if OIIO_SIMD_AVX >= 2
     m_simd = _mm256_mask_i32gather_ps (m_simd, baseptr, vindex, mask, scale);
 #else
-    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : 0);
+    SIMD_CONSTRUCT (mask[i] ? *(const value_t *)((const char *)baseptr + vindex[i]*scale) : m_val[i]);
 #endif
 }
 
@@ -8643,7 +8685,11 @@ OIIO_FORCEINLINE vfloat8 floor (const vfloat8& a)
 OIIO_FORCEINLINE vfloat8 round (const vfloat8& a)
 {
 #if OIIO_SIMD_AVX
-    return _mm256_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    // Halves away from 0 -- see round(vfloat4).
+    __m256 half = _mm256_or_ps (_mm256_and_ps (a, _mm256_set1_ps (-0.0f)),
+                                _mm256_set1_ps (0.49999997f));
+    return _mm256_round_ps (_mm256_add_ps (a, half),
+                            (_MM_FROUND_TO_ZERO |_MM_FROUND_NO_EXC));
 #else
     SIMD_RETURN (vfloat8, roundf(a[i]));
 #endif
@@ -8850,6 +8896,8 @@ OIIO_FORCEINLINE vfloat8 vfloat16::lo () const {
 OIIO_FORCEINLINE vfloat8 vfloat16::hi () const {
 #if OIIO_SIMD_AVX >= 512 && OIIO_AVX512DQ_ENABLED
     return _mm512_extractf32x8_ps (simd(), 1);
+#elif OIIO_SIMD_AVX >= 512
+    return _mm256_castpd_ps (_mm512_extractf64x4_pd (_mm512_castps_pd (simd()), 1));
 #else
     return m_8[1];
 #endif
@@ -8866,8 +8914,8 @@ OIIO_FORCEINLINE vfloat16::vfloat16 (float v0, float v1, float v2, float v3,
 
 OIIO_FORCEINLINE vfloat16::vfloat16 (const vfloat8& lo, const vfloat8 &hi) {
 #if OIIO_SIMD_AVX >= 512
-    __m512 r = _mm512_castps256_ps512 (lo);
-    m_simd = _mm512_insertf32x8 (r, hi, 1);
+    __m512d r = _mm512_castps_pd (_mm512_castps256_ps512 (lo));
+    m_simd = _mm512_castpd_ps (_mm512_insertf64x4 (r, _mm256_castps_pd (hi), 1));
 #else
     m_8[0] = lo;
     m_8[1] = hi;
@@ -9324,15 +9372,25 @@ template<int i> vfloat16 shuffle (const vfloat16& a) {
 
 template<int i>
 OIIO_FORCEINLINE float extract (const vfloat16& a) {
+#if OIIO_SIMD_AVX >= 512
+    __m128 quad = _mm512_extractf32x4_ps (a.simd(), i/4);
+    return _mm_cvtss_f32 (shuffle<i&3> (vfloat4 (quad)));
+#else
     return a[i];
+#endif
 }
 
 
 template<int i>
 OIIO_FORCEINLINE vfloat16 insert (const vfloat16& a, float val) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_broadcastss_ps (a.simd(), __mmask16(1<<i),
+                                       _mm_set_ss (val));
+#else
     vfloat16 tmp = a;
     tmp[i] = val;
     return tmp;
+#endif
 }
 
 
@@ -9487,7 +9545,13 @@ OIIO_FORCEINLINE vfloat16 floor (const vfloat16& a)
 OIIO_FORCEINLINE vfloat16 round (const vfloat16& a)
 {
 #if OIIO_SIMD_AVX >= 512
-    return _mm512_roundscale_ps (a, (1<<4) | 3); // scale=1, round to nearest smaller mag int
+    // Halves away from 0 -- see round(vfloat4).
+    __m512i sign = _mm512_and_si512 (_mm512_castps_si512 (a),
+                                     _mm512_set1_epi32 (0x80000000));
+    __m512 half = _mm512_castsi512_ps (
+        _mm512_or_si512 (sign, _mm512_set1_epi32 (0x3effffff)));
+    return _mm512_roundscale_ps (_mm512_add_ps (a, half),
+                                 (_MM_FROUND_TO_ZERO |_MM_FROUND_NO_EXC));
 #else
     return vfloat16(round(a.lo()), round(a.hi()));
 #endif
@@ -9574,8 +9638,11 @@ OIIO_FORCEINLINE vfloat16 max (const vfloat16& a, const vfloat16& b)
 
 
 OIIO_FORCEINLINE vfloat16 andnot (const vfloat16& a, const vfloat16& b) {
-#if OIIO_SIMD_AVX >= 512 && defined(__AVX512DQ__)
+#if OIIO_SIMD_AVX >= 512 && OIIO_AVX512DQ_ENABLED
     return _mm512_andnot_ps (a, b);
+#elif OIIO_SIMD_AVX >= 512
+    return _mm512_castsi512_ps (_mm512_andnot_si512 (_mm512_castps_si512(a),
+                                                     _mm512_castps_si512(b)));
 #else
     return vfloat16(andnot(a.lo(),b.lo()), andnot(a.hi(),b.hi()));
 #endif
@@ -423,6 +423,12 @@ std::string OIIO_API replace (string_view str, string_view pattern,
 /// '.' as the decimal separator. This should be preferred for I/O and other
 /// situations where you want the same standard formatting regardless of
 /// locale.
+///
+/// The result is always the representable value nearest the decimal text,
+/// so any float written with 9 significant digits (17 for a double) reads
+/// back exactly. Plain decimal numbers of modest length, which are nearly
+/// all of those found in file headers and metadata, are converted directly
+/// without involving the C library.
 float OIIO_API strtof (const char *nptr, char **endptr = nullptr);
 double OIIO_API strtod (const char *nptr, char **endptr = nullptr);
 
@@ -442,7 +448,7 @@ inline unsigned int stoui (string_view s, size_t* pos=0, int base=10) {
 /// stof() returns the float conversion of text from several string types.
 /// No exceptions or errors -- parsing errors just return 0.0. These always
 /// use '.' for the decimal mark (versus atof and std::strtof, which are
-/// locale-dependent).
+/// locale-dependent). Like strtof(), the conversion is correctly rounded.
 OIIO_API float stof (string_view s, size_t* pos=0);
 #define OIIO_STRUTIL_HAS_STOF 1  /* be able to test this */
 
@@ -511,6 +517,10 @@ inline std::string to_string (const char* value) { return value; }
 // do it for floats yet because of the locale-dependence.
 inline std::string to_string (int value) { return ::fmt::to_string(value); }
 inline std::string to_string (size_t value) { return ::fmt::to_string(value); }
+// Floating point values are formatted like "%g", always in the classic "C"
+// locale, without the overhead of a stream.
+OIIO_API std::string to_string (float value);
+OIIO_API std::string to_string (double value);
 
 
 
@@ -41,6 +41,7 @@
 
 #include <ctime>
 #include <string>
+#include <vector>
 
 #ifdef __MINGW32__
 #    include <malloc.h>  // for alloca
@@ -112,6 +113,12 @@ hardware_concurrency();
 OIIO_API unsigned int
 physical_concurrency();
 
+/// The CPUs (as numbered by the OS) that belong to the given NUMA node.
+/// The result is empty if there is no such node, or if this platform
+/// doesn't tell us (at present, only Linux does).
+OIIO_API std::vector<int>
+numa_node_cpus(int node);
+
 /// Get the maximum number of open file handles allowed on this system.
 OIIO_API size_t
 max_open_files();
@@ -120,7 +120,11 @@ enum class MipMode {
     NoMIP,      ///< Just use highest-res image, no MIP mapping
     OneLevel,   ///< Use just one mipmap level
     Trilinear,  ///< Use two MIPmap levels (trilinear)
-    Aniso       ///< Use two MIPmap levels w/ anisotropic
+    Aniso,      ///< Use two MIPmap levels w/ anisotropic
+    EWA,        ///< Elliptical weighted average (2D texture only)
+    StochasticTrilinear,  ///< One level, chosen by rnd (2D texture only)
+    StochasticAniso,      ///< One level and one aniso probe, chosen by rnd
+    SummedArea            ///< Box filter from a summed-area table (2D only)
 };
 
 /// Interp mode determines how we sample within a mipmap level
@@ -203,7 +207,11 @@ public:
         MipModeNoMIP,      ///< Just use highest-res image, no MIP mapping
         MipModeOneLevel,   ///< Use just one mipmap level
         MipModeTrilinear,  ///< Use two MIPmap levels (trilinear)
-        MipModeAniso       ///< Use two MIPmap levels w/ anisotropic
+        MipModeAniso,      ///< Use two MIPmap levels w/ anisotropic
+        MipModeEWA,        ///< Elliptical weighted average (2D only)
+        MipModeStochasticTrilinear,  ///< One level, chosen by rnd (2D only)
+        MipModeStochasticAniso,      ///< One level and aniso probe, by rnd
+        MipModeSummedArea            ///< Summed-area table box (2D only)
     };
 
     /// Interp mode determines how we sample within a mipmap level
@@ -229,7 +237,7 @@ public:
         time(0.0f), bias(0.0f), samples(1),
         rwrap(WrapDefault), rblur(0.0f), rwidth(1.0f), // dresultdr(NULL),
         // actualchannels(0),
-        envlayout(0)
+        rnd(-1.0f), envlayout(0)
     { }
 
     /// Convert a TextureOptions for one index into a TextureOpt.
@@ -258,6 +266,11 @@ public:
     float rblur;   ///< Blur amount in the r direction
     float rwidth;  ///< Multiplier for derivatives in r direction
 
+    /// Random number in [0,1) used by the stochastic MIP modes to pick the
+    /// one probe they make. If it's outside that range, a repeatable value
+    /// is hashed from the texture coordinates instead.
+    float rnd;
+
     /// Utility: Return the Wrap enum corresponding to a wrap name:
     /// "default", "black", "clamp", "periodic", "mirror".
     static Wrap decode_wrapmode(const char* name)
@@ -304,6 +317,9 @@ public:
     alignas(Tex::BatchAlign) float twidth[Tex::BatchWidth];
     alignas(Tex::BatchAlign) float rwidth[Tex::BatchWidth];
     // Note: rblur,rwidth only used for volumetric lookups
+    alignas(Tex::BatchAlign) float rnd[Tex::BatchWidth];  ///< For stochastic modes
+    // Note: rnd is only read (and must only be set) for the stochastic
+    // MIP modes
 
     // Options that must be the same for all points we're texturing at once
     int firstchannel = 0;                 ///< First channel of the lookup
@@ -358,7 +374,11 @@ public:
         MipModeNoMIP,      ///< Just use highest-res image, no MIP mapping
         MipModeOneLevel,   ///< Use just one mipmap level
         MipModeTrilinear,  ///< Use two MIPmap levels (trilinear)
-        MipModeAniso       ///< Use two MIPmap levels w/ anisotropic
+        MipModeAniso,      ///< Use two MIPmap levels w/ anisotropic
+        MipModeEWA,        ///< Elliptical weighted average (2D only)
+        MipModeStochasticTrilinear,  ///< One level, chosen by rnd (2D only)
+        MipModeStochasticAniso,      ///< One level and aniso probe, by rnd
+        MipModeSummedArea            ///< Summed-area table box (2D only)
     };
 
     /// Interp mode determines how we sample within a mipmap level
@@ -613,6 +633,78 @@ public:
                           float *dresultds=nullptr,
                           float *dresultdt=nullptr) = 0;
 
+    /// Retrieve filtered texture lookups for a large set of npoints
+    /// queries of the same texture, in no particular order, all sharing
+    /// the same options. Internally the lookups are grouped by the MIP
+    /// level and tile they are expected to touch and are performed one
+    /// group at a time, which gives far better cache locality than
+    /// issuing incoherent queries one by one. Results, and derivatives if
+    /// requested, are stored in the original order: result[i*nchannels
+    /// .. i*nchannels+nchannels-1] for query i.
+    ///
+    /// Each of s, t, dsdx, dtdx, dsdy, dtdy points to an array of
+    /// npoints values.
+    ///
+    /// Return true if the file is found and could be opened by an
+    /// available ImageIO plugin, otherwise return false.
+    virtual bool texture_coherent (ustring filename, TextureOpt &options,
+                                   int npoints, const float *s,
+                                   const float *t, const float *dsdx,
+                                   const float *dtdx, const float *dsdy,
+                                   const float *dtdy, int nchannels,
+                                   float *result, float *dresultds=nullptr,
+                                   float *dresultdt=nullptr) = 0;
+    virtual bool texture_coherent (TextureHandle *texture_handle,
+                                   Perthread *thread_info,
+                                   TextureOpt &options, int npoints,
+                                   const float *s, const float *t,
+                                   const float *dsdx, const float *dtdx,
+                                   const float *dsdy, const float *dtdy,
+                                   int nchannels, float *result,
+                                   float *dresultds=nullptr,
+                                   float *dresultdt=nullptr) = 0;
+
+    /// Filtered 2D texture lookup for a single point whose footprint is
+    /// given not by derivatives but by its width in texture space: a
+    /// filter of that diameter, in the same s,t units as dsdx etc., as
+    /// from a ray cone's width at the hit point scaled to the surface's
+    /// parameterization. The MIP level(s) are chosen from the width
+    /// directly, skipping the ellipse and anisotropy computations, and
+    /// are blended trilinearly (unless options.mipmode asks for NoMIP,
+    /// OneLevel, or StochasticTrilinear). To look up level L of a
+    /// texture whose level 0 is res texels across, pass width =
+    /// 2^L / res.
+    ///
+    /// Return true if the file is found and could be opened by an
+    /// available ImageIO plugin, otherwise return false.
+    virtual bool texture_lod (ustring filename, TextureOpt &options,
+                              float s, float t, float width,
+                              int nchannels, float *result,
+                              float *dresultds=nullptr,
+                              float *dresultdt=nullptr) = 0;
+    virtual bool texture_lod (TextureHandle *texture_handle,
+                              Perthread *thread_info, TextureOpt &options,
+                              float s, float t, float width,
+                              int nchannels, float *result,
+                              float *dresultds=nullptr,
+                              float *dresultdt=nullptr) = 0;
+
+    /// Batched version of texture_lod(), with one width per lane and
+    /// results laid out as for the batched texture().
+    virtual bool texture_lod (ustring filename, TextureOptBatch &options,
+                              Tex::RunMask mask, const float *s,
+                              const float *t, const float *width,
+                              int nchannels, float *result,
+                              float *dresultds=nullptr,
+                              float *dresultdt=nullptr) = 0;
+    virtual bool texture_lod (TextureHandle *texture_handle,
+                              Perthread *thread_info,
+                              TextureOptBatch &options, Tex::RunMask mask,
+                              const float *s, const float *t,
+                              const float *width, int nchannels,
+                              float *result, float *dresultds=nullptr,
+                              float *dresultdt=nullptr) = 0;
+
     /// Old multi-point API call.
     /// DEPRECATED (1.8)
     virtual bool texture (ustring filename, TextureOptions &options,
@@ -879,6 +971,58 @@ public:
                              int chbegin, int chend,
                              TypeDesc format, void *result) = 0;
 
+    /// When the "feedback" attribute is nonzero, texture lookups record
+    /// every tile they needed, by subimage and MIP level. Retrieve that
+    /// record for one subimage and MIP level of the named file as a
+    /// bitfield with one bit per tile: tile (i,j,k), counting tiles of
+    /// the level in x, y, and z, is bit (n & 63) of tiles[n / 64], where
+    /// n = i + j*nxtiles + k*nxtiles*nytiles. The finest level with any
+    /// bits set is the finest resolution that was actually used. If
+    /// reset is true, the record for that level is cleared as it is read.
+    ///
+    /// Return true if the file, subimage and MIP level exist, otherwise
+    /// return false.
+    virtual bool get_tile_feedback (ustring filename, int subimage,
+                                    int miplevel, std::vector<uint64_t> &tiles,
+                                    bool reset=false) = 0;
+
+    /// Pin every tile of MIP levels [miplevel_begin,miplevel_end) of the
+    /// subimage of the texture (all levels from miplevel_begin on, if
+    /// miplevel_end < 0), reading any that are not yet in the cache, so
+    /// that they stay in memory however full the cache gets. Pinned tiles
+    /// are never evicted, and their memory does not count against
+    /// max_memory_MB. This suits textures that nearly every ray samples,
+    /// such as sky domes. Pins nest, each pin() is undone by a matching
+    /// unpin(), and all pins of a file are dropped if it is invalidated.
+    /// The tiles pinned span all the channels of the file, so a lookup
+    /// only uses them if the file has no more than max_tile_channels.
+    ///
+    /// Return true if the file is found and all the tiles could be read,
+    /// otherwise return false.
+    virtual bool pin (ustring filename, int subimage,
+                      int miplevel_begin=0, int miplevel_end=-1) = 0;
+    virtual bool pin (TextureHandle *texture_handle, Perthread *thread_info,
+                      int subimage, int miplevel_begin=0,
+                      int miplevel_end=-1) = 0;
+
+    /// Give back the pins that pin() took on the tiles of MIP levels
+    /// [miplevel_begin,miplevel_end) of the subimage of the texture.
+    virtual bool unpin (ustring filename, int subimage,
+                        int miplevel_begin=0, int miplevel_end=-1) = 0;
+    virtual bool unpin (TextureHandle *texture_handle, Perthread *thread_info,
+                        int subimage, int miplevel_begin=0,
+                        int miplevel_end=-1) = 0;
+
+    /// Attribute the cost of the texture lookups that this thread makes
+    /// from now on to the given tag, such as the name of a material or
+    /// of a shader call-site, until the next call. An empty tag stops the
+    /// attribution. For each tag, getstats() (at level 2 and above) and
+    /// getmetrics() report the number of lookups, an estimate of the
+    /// texels they read, the tiles they looked up and missed in the
+    /// cache, and the time spent in them. Untagged lookups cost nothing
+    /// extra. The thread_info may be NULL to use the calling thread's.
+    virtual void set_cost_tag (Perthread *thread_info, ustring tag) = 0;
+
     /// If any of the API routines returned false indicating an error,
     /// this routine will return the error string (and clear any error
     /// flags).  If no error has occurred since the last time geterror()
@@ -889,6 +1033,15 @@ public:
     ///
     virtual std::string getstats (int level=1, bool icstats=true) const = 0;
 
+    /// Return a snapshot of the texture statistics (query and
+    /// interpolation counts and the like), and if icstats is true, those
+    /// of the underlying ImageCache, in a form meant for programs to read.
+    /// The format may be "json" (one object, in which the ImageCache
+    /// metrics, if any, are the "imagecache" member) or "prometheus" (with
+    /// names prefixed "oiio_texture_").  See ImageCache::getmetrics().
+    virtual std::string getmetrics (string_view format="json",
+                                    bool icstats=true) const = 0;
+
     /// Invalidate any cached information about the named file. A client
     /// might do this if, for example, they are aware that an image
     /// being held in the cache has been updated on disk.
@@ -47,6 +47,7 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -55,6 +56,7 @@
 #include <OpenImageIO/export.h>
 #include <OpenImageIO/oiioversion.h>
 #include <OpenImageIO/platform.h>
+#include <OpenImageIO/string_view.h>
 
 
 
@@ -611,6 +613,38 @@ private:
 
 
 
+/// Epoch-based reclamation, for lock-free data structures whose readers
+/// may still be looking at something that a writer has just unlinked.
+/// Readers hold an epoch_reclaim::read_guard for the duration of each
+/// lock-free access. A writer that unlinks an object tags it with
+/// retire_epoch() (taken after the unlink) and keeps it aside; it may
+/// free the object once advance() returns a value at least 2 greater
+/// than the tag, by which time no reader can still refer to it. There
+/// is one epoch for the whole process, and read guards may nest.
+class OIIO_API epoch_reclaim {
+public:
+    /// Marks the calling thread as reading, for its lifetime.
+    class OIIO_API read_guard {
+    public:
+        read_guard();
+        ~read_guard();
+
+    private:
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+        void* m_record;
+    };
+
+    /// The epoch with which to tag an object that was just unlinked.
+    static uint64_t retire_epoch();
+
+    /// Move the epoch along if every thread that is reading has seen the
+    /// current one, and return the (possibly new) current epoch.
+    static uint64_t advance();
+};
+
+
+
 /// thread_pool is a persistent set of threads watching a queue to which
 /// tasks can be submitted.
 ///
@@ -735,6 +769,16 @@ public:
     /// subtasks to clog up the pool.
     bool this_thread_is_in_pool() const;
 
+    /// Tasks pushed by one of the pool's own threads go on a deque of that
+    /// thread's, from which idle pool threads steal. task_mark() returns a
+    /// mark for the calling pool thread's later pushes, and
+    /// run_task_since(mark) runs (on the calling thread) one of the tasks
+    /// it has pushed since then that nobody has taken yet, returning
+    /// false if there are none. This lets a pool thread that is waiting
+    /// for its own subtasks help with them, and only them.
+    uint64_t task_mark() const;
+    bool run_task_since(uint64_t mark);
+
     /// Register a thread (not already in the thread pool itself) as working
     /// on tasks in the pool. This is used to avoid recursion.
     void register_worker(std::thread::id id);
@@ -758,6 +802,44 @@ public:
     /// queue.
     bool very_busy() const;
 
+    /// A name for the pool, used only to identify it (for example, in
+    /// named_thread_pool() and in statistics).
+    void set_name(string_view name);
+    std::string name() const;
+
+    /// Mark the pool's threads as doing background work: on platforms
+    /// that support it, they run at a lower scheduling priority than
+    /// ordinary threads, so that they don't compete with latency-critical
+    /// work elsewhere in the application.
+    void set_background(bool background);
+    bool background() const;
+
+    /// Restrict the pool's threads to run only on the given CPUs (as
+    /// numbered by the OS). An empty list lifts the restriction. This is
+    /// only a request -- it's silently ignored on platforms that don't
+    /// support it.
+    void set_affinity(const std::vector<int>& cpus);
+    std::vector<int> affinity() const;
+
+    /// Restrict the pool's threads to the CPUs of one NUMA node (or lift
+    /// the restriction, if node < 0 or the node's CPUs can't be found).
+    ///
+    /// Each thread applies the priority and affinity settings to itself
+    /// the next time it looks for a task, so changes take effect shortly
+    /// after these calls return rather than immediately.
+    void set_numa_node(int node);
+
+    /// Statistics about the work that has gone through the pool.
+    struct Stats {
+        uint64_t tasks_run     = 0;  ///< Queued tasks that have been run
+        uint64_t tasks_stolen  = 0;  ///< ... taken from another's deque
+        size_t queue_depth     = 0;  ///< Tasks waiting right now
+        size_t max_queue_depth = 0;  ///< Most that were ever waiting
+    };
+    Stats stats() const;
+    /// Reset the counts and the maximum depth of the queue.
+    void reset_stats();
+
 private:
     // Disallow copy construction and assignment
     thread_pool(const thread_pool&) = delete;
@@ -781,6 +863,23 @@ private:
 /// could result in hilariously over-threading your application.
 OIIO_API thread_pool* default_thread_pool ();
 
+/// Return a pointer to the shared "background" thread pool, whose threads
+/// run at low priority. It's meant for work that nobody is waiting on
+/// right now, like prefetching or writing files behind the scenes, and is
+/// what OIIO's own asynchronous I/O uses. Its size is set by the
+/// "background_threads" attribute (by default, a quarter of the cores,
+/// but at least 2).
+OIIO_API thread_pool* background_thread_pool ();
+
+/// Return a pointer to the thread pool with the given name, creating it
+/// with nthreads threads (see thread_pool::resize) if there isn't one yet.
+/// nthreads is ignored if the pool already exists. The names "default"
+/// (or the empty string) and "background" refer to default_thread_pool()
+/// and background_thread_pool(). Named pools live until the program
+/// exits. A pool can be handed to the parallel utilities through
+/// parallel_options::pool to keep work isolated from the default pool.
+OIIO_API thread_pool* named_thread_pool (string_view name, int nthreads = -1);
+
 
 
 /// task_set is a group of future<void>'s from a thread_queue that you can
@@ -807,6 +906,7 @@ public:
     task_set(thread_pool* pool = nullptr)
         : m_pool(pool ? pool : default_thread_pool())
         , m_submitter_thread(std::this_thread::get_id())
+        , m_mark(m_pool->task_mark())
     {
     }
     ~task_set() { wait(); }
@@ -838,7 +938,9 @@ public:
     // Wait for all tasks in the set to finish. If block == true, fully
     // block while waiting for the pool threads to all finish. If block is
     // false, then busy wait, and opportunistically run queue tasks yourself
-    // while you are waiting for other tasks to finish.
+    // while you are waiting for other tasks to finish. A thread of the
+    // pool itself always runs those of the set's tasks that no other
+    // thread has taken yet, and then blocks for the rest.
     void wait(bool block = false);
 
     // Debugging sanity check, called after wait(), to ensure that all the
@@ -853,6 +955,7 @@ public:
 private:
     thread_pool* m_pool;
     std::thread::id m_submitter_thread;
+    uint64_t m_mark;  // The pool's task_mark() when we were created
     std::vector<std::future<void>> m_futures;
 };
 
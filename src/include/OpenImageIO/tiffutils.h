@@ -223,6 +223,32 @@ OIIO_API void encode_iptc_iim (const ImageSpec &spec, std::vector<char> &iptc);
 /// functionality within each plugin.
 OIIO_API bool decode_xmp (const std::string &xml, ImageSpec &spec);
 
+/// How a reader treats the Exif, XMP, and IPTC blocks it finds, as
+/// requested by the "oiio:metadata" open() configuration hint: "full" (the
+/// default) decodes them into the spec as it opens the file, "lazy" keeps
+/// each block undecoded in the spec for a later decode_metadata(), and
+/// "none" ignores them.
+enum class MetadataHint { Full, Lazy, None };
+
+/// Return the metadata hint requested by an open() configuration.
+OIIO_API MetadataHint metadata_hint (const ImageSpec &config);
+
+/// Varieties of decode_exif, decode_xmp, and decode_iptc_iim that honor a
+/// metadata hint, for format plugins to call with the hint they were
+/// opened with.
+OIIO_API bool decode_exif (string_view exif, ImageSpec &spec,
+                           MetadataHint hint);
+OIIO_API bool decode_xmp (string_view xml, ImageSpec &spec,
+                          MetadataHint hint);
+OIIO_API bool decode_iptc_iim (const void *iptc, int length, ImageSpec &spec,
+                               MetadataHint hint);
+
+/// Decode into spec any metadata blocks that a reader left undecoded
+/// because it was opened with the "lazy" metadata hint, and remove the
+/// undecoded blocks.  Return true if all is ok (including if there was
+/// nothing to decode), false if a block was somehow malformed.
+OIIO_API bool decode_metadata (ImageSpec &spec);
+
 /// Find all the relavant metadata (IPTC, Exif, etc.) in spec and
 /// assemble it into an XMP XML string.  This is a utility function to
 /// make it easy for multiple format plugins to support embedding XMP
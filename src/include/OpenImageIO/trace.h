@@ -0,0 +1,187 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <OpenImageIO/export.h>
+#include <OpenImageIO/oiioversion.h>
+#include <OpenImageIO/string_view.h>
+#include <OpenImageIO/ustring.h>
+
+
+/// Define OIIO_TRACE_ENABLED to 0 (the OIIO_TRACE=OFF build option does so
+/// for OIIO itself) to make the OIIO_TRACE_* macros expand to nothing.
+#ifndef OIIO_TRACE_ENABLED
+#    define OIIO_TRACE_ENABLED 1
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+
+/// Lightweight tracing of where time goes, thread by thread.
+///
+/// Scoped spans are placed in the expensive parts of OIIO (ImageCache
+/// misses, reads and evictions, ImageInput reads, ImageBufAlgo functions,
+/// maketx stages, oiiotool commands), and can be placed in applications
+/// the same way:
+///
+///     void expensive_thing() {
+///         OIIO_TRACE_SPAN("expensive_thing", "myapp");
+///         ...
+///     }
+///
+/// Nothing is recorded until tracing is started, either with
+/// OIIO::attribute("trace_file", filename) or the OPENIMAGEIO_TRACE_FILE
+/// environment variable. Until then, a span costs one relaxed atomic load.
+/// Once started, each thread appends its spans, without locking, to a ring
+/// buffer of its own that holds the most recent "trace_buffer_size" spans
+/// (default 65536). The trace is written as Chrome trace event JSON, which
+/// can be opened with chrome://tracing or https://ui.perfetto.dev, when
+/// tracing is stopped (by setting "trace_file" to "") or at exit.
+///
+/// Span names and categories are not copied: they must be string literals
+/// or otherwise live as long as the process, such as ustring characters.
+namespace Trace {
+
+/// Nonzero while tracing. Use enabled() rather than this.
+extern OIIO_API std::atomic<int> active;
+
+/// Is tracing on?
+inline bool
+enabled()
+{
+    return active.load(std::memory_order_relaxed) != 0;
+}
+
+/// The trace clock, in nanoseconds.
+inline int64_t
+now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Start tracing, to be written to filename. If tracing to another file
+/// was already under way, that file is written first. Return false if the
+/// file can't be opened for writing.
+OIIO_API bool start(string_view filename);
+
+/// Stop tracing and write the file. Return false if it can't be written.
+OIIO_API bool stop();
+
+/// The file being traced to, or "" if tracing is off.
+OIIO_API std::string filename();
+
+/// Set how many spans each thread's ring buffer holds. Takes effect for
+/// buffers allocated after the call, i.e. at the next start().
+OIIO_API void buffer_size(int nspans);
+OIIO_API int buffer_size();
+
+/// Record a finished span on the calling thread, with begin and end times
+/// from now(). Does nothing if tracing is off.
+OIIO_API void record(const char* name, const char* category, int64_t begin,
+                     int64_t end);
+
+/// Record a span that ends now and lasted the given number of seconds,
+/// for code that already measures its own time.
+inline void
+record_elapsed(const char* name, const char* category, double seconds)
+{
+    int64_t end = now();
+    record(name, category, end - int64_t(seconds * 1.0e9), end);
+}
+
+
+
+/// A Span records the time from its construction (or start()) to its
+/// destruction, if tracing was on when it began.
+class Span {
+public:
+    Span() {}
+    Span(const char* name, const char* category) { start(name, category); }
+    Span(ustring name, const char* category)
+    {
+        start(name.c_str(), category);
+    }
+    Span(const Span&) = delete;
+    const Span& operator=(const Span&) = delete;
+    ~Span()
+    {
+        if (m_name)
+            record(m_name, m_category, m_begin, now());
+    }
+
+    /// Begin timing, if tracing is on.
+    void start(const char* name, const char* category)
+    {
+        if (enabled()) {
+            m_name     = name;
+            m_category = category;
+            m_begin    = now();
+        }
+    }
+
+private:
+    const char* m_name     = nullptr;
+    const char* m_category = nullptr;
+    int64_t m_begin        = 0;
+};
+
+}  // namespace Trace
+
+OIIO_NAMESPACE_END
+
+
+#define OIIO_TRACE_CONCAT2(a, b) a##b
+#define OIIO_TRACE_CONCAT(a, b) OIIO_TRACE_CONCAT2(a, b)
+
+#if OIIO_TRACE_ENABLED
+/// Trace the rest of the enclosing scope.
+#    define OIIO_TRACE_SPAN(name, category)                                   \
+        OIIO::Trace::Span OIIO_TRACE_CONCAT(oiio_trace_span_, __LINE__)(name,  \
+                                                                      category)
+/// Record a span that ends here and lasted `seconds`. The name is only
+/// evaluated if tracing is on, so it may be computed.
+#    define OIIO_TRACE_ELAPSED(name, category, seconds)                       \
+        do {                                                                   \
+            if (OIIO::Trace::enabled())                                        \
+                OIIO::Trace::record_elapsed(name, category, seconds);          \
+        } while (0)
+#else
+#    define OIIO_TRACE_SPAN(name, category) ((void)0)
+#    define OIIO_TRACE_ELAPSED(name, category, seconds) ((void)0)
+#endif
@@ -69,6 +69,17 @@ OIIO_NAMESPACE_BEGIN
 /// the first entry of the next bin, it will also release its current
 /// lock and obtain a lock on the next bin.
 ///
+/// Lookups with retrieve() (when it's asked to do its own locking) don't
+/// lock at all.  Besides its map, each bin keeps an index for lock-free
+/// reads: an open-addressed table of pointers to copies of its entries,
+/// which writers (holding the bin lock) keep up to date, and which
+/// readers probe without writing to any shared cache line.  An entry or
+/// table that a writer removes is freed only once no reader can still be
+/// looking at it (see epoch_reclaim).  When an index fills up, its
+/// entries are moved to a bigger table a few at a time by the writes
+/// that follow, with readers checking both tables in the meantime, so no
+/// single write rehashes the whole index.
+///
 
 template<class KEY, class VALUE, class HASH = std::hash<KEY>,
          class PRED = std::equal_to<KEY>, size_t BINS = 16,
@@ -85,6 +96,23 @@ public:
     {
         //        for (size_t i = 0;  i < BINS;  ++i)
         //            std::cout << "Bin " << i << ": " << m_bins[i].map.size() << "\n";
+        // Nobody can be reading any more, so free everything outright.
+        for (auto& bin : m_bins) {
+            while (bin.old_index.load(std::memory_order_relaxed))
+                migrate(bin, size_t(-1));
+            if (IndexTable* t = bin.index.load(std::memory_order_relaxed)) {
+                for (size_t i = 0; i <= t->mask; ++i) {
+                    IndexEntry* e = t->slots[i].load(std::memory_order_relaxed);
+                    if (e && e != tombstone())
+                        delete e;
+                }
+                delete t;
+            }
+        }
+        for (auto& r : m_retired) {
+            delete r.entry;
+            delete r.table;
+        }
     }
 
     /// An unordered_map_concurrent::iterator points to a specific entry
@@ -311,22 +339,42 @@ public:
 
     /// Search for key. If found, return true and store the value. If not
     /// found, return false and do not alter value. If do_lock is true,
-    /// read-lock the bin while we're searching, and release it before
-    /// returning; however, if do_lock is false, assume that the caller
-    /// already has the bin locked, so do no locking or unlocking.
+    /// search the bin's lock-free index, without locking anything (the
+    /// result is consistent with some moment during the call); however,
+    /// if do_lock is false, assume that the caller already has the bin
+    /// locked, so do no locking or unlocking.
     bool retrieve(const KEY& key, VALUE& value, bool do_lock = true)
     {
-        size_t b = whichbin(key);
-        Bin& bin(m_bins[b]);
-        if (do_lock)
-            bin.lock();
-        typename BinMap_t::iterator it = bin.map.find(key);
-        bool found                     = (it != bin.map.end());
-        if (found)
-            value = it->second;
-        if (do_lock)
-            bin.unlock();
-        return found;
+        size_t hash = m_hash(key);
+        Bin& bin(m_bins[whichbin_hash(hash)]);
+        if (!do_lock) {
+            typename BinMap_t::iterator it = bin.map.find(key);
+            bool found                     = (it != bin.map.end());
+            if (found)
+                value = it->second;
+            return found;
+        }
+        epoch_reclaim::read_guard guard;
+        const IndexEntry* e = nullptr;
+        for (;;) {
+            // In the middle of moving to a bigger table, the entry may not
+            // have been moved yet. Load the old table first: a move that
+            // finishes between the loads then still leaves the entry in
+            // the new one.
+            IndexTable* old = bin.old_index.load(std::memory_order_acquire);
+            IndexTable* t   = bin.index.load(std::memory_order_acquire);
+            e               = index_find(t, key, hash);
+            if (!e)
+                e = index_find(old, key, hash);
+            // If the tables changed while we looked, a miss may just mean
+            // we looked in the wrong places, so look again.
+            if (e || (bin.index.load(std::memory_order_acquire) == t
+                      && bin.old_index.load(std::memory_order_acquire) == old))
+                break;
+        }
+        if (e)
+            value = e->value;
+        return e != nullptr;
     }
 
     /// Insert <key,value> into the hash map if it's not already there.
@@ -344,9 +392,12 @@ public:
         if (result.second) {
             // the insert was succesful!
             ++m_size;
+            index_insert(bin, new IndexEntry(key, value, m_hash(key)));
         }
-        if (do_lock)
+        if (do_lock) {
             bin.unlock();
+            reclaim();
+        }
         return result.second;
     }
 
@@ -360,9 +411,26 @@ public:
         Bin& bin(m_bins[b]);
         if (do_lock)
             bin.lock();
-        bin.map.erase(key);
+        IndexEntry* e = nullptr;
+        if (bin.map.erase(key)) {
+            --m_size;
+            e = index_erase(bin, key, m_hash(key));
+        }
         if (do_lock)
             bin.unlock();
+        if (e)
+            retire({ e });
+    }
+
+    /// Free whatever erased entries (and outgrown index tables) no reader
+    /// can still be looking at. Erasing does this as it goes, but the
+    /// last few erased entries, and the values they hold, wait for a later
+    /// call. insert() makes one whenever any are waiting, and callers may
+    /// too, whenever they want erased values released promptly.
+    void reclaim()
+    {
+        if (m_nretired.load(std::memory_order_relaxed))
+            retire({});
     }
 
     /// Return true if the entire map is empty.
@@ -385,14 +453,103 @@ public:
     /// holds the lock).
     void unlock_bin(size_t bin) { m_bins[bin].unlock(); }
 
+    /// Return the number of bins the map is split into.
+    static constexpr size_t nbins() { return BINS; }
+
+    /// Which bin will this key always appear in?
+    size_t whichbin(const KEY& key) { return whichbin_hash(m_hash(key)); }
+
+    /// Which bin will a key with this hash always appear in?
+    size_t whichbin_hash(size_t hash) const
+    {
+        constexpr int LOG2_BINS = log2(BINS);
+        constexpr int BIN_SHIFT = 32 - LOG2_BINS;
+
+        static_assert(1 << LOG2_BINS == BINS,
+                      "Number of bins must be a power of two");
+        static_assert(~uint32_t(0) >> BIN_SHIFT == (BINS - 1), "Hash overflow");
+
+        // Use the high order bits of the hash to index the bin. We assume that the
+        // low-order bits of the hash will directly be used to index the hash table,
+        // so using those would lead to collisions.
+        // To avoid mixups between size_t among platforms, we always cast to a 32-bit
+        // integer first. Its quite possible the hash function only gave us a uint32_t
+        // even though the API technically wants a size_t.
+        unsigned bin = uint32_t(hash) >> BIN_SHIFT;
+        DASSERT(bin < BINS);
+        return bin;
+    }
+
+    /// Lock the given bin, call func(key, value) for each of its entries,
+    /// and erase the entries for which func returns true. The bin stays
+    /// locked throughout, so func must not try to access the same bin of
+    /// the map. Return the number of entries erased.
+    template<class FUNC> size_t erase_if(size_t bin, FUNC&& func)
+    {
+        DASSERT(bin < BINS);
+        Bin& b(m_bins[bin]);
+        b.lock();
+        size_t nerased = 0;
+        std::vector<IndexEntry*> erased;
+        for (auto it = b.map.begin(); it != b.map.end();) {
+            if (func(it->first, it->second)) {
+                erased.push_back(index_erase(b, it->first, m_hash(it->first)));
+                it = b.map.erase(it);
+                ++nerased;
+            } else {
+                ++it;
+            }
+        }
+        m_size -= int(nerased);
+        b.unlock();
+        if (nerased)
+            retire(erased);
+        return nerased;
+    }
+
 private:
+    // A copy of a map entry, as seen by lock-free readers. Never changed
+    // once it's in an index.
+    struct IndexEntry {
+        IndexEntry(const KEY& k, const VALUE& v, size_t h)
+            : key(k)
+            , value(v)
+            , hash(h)
+        {
+        }
+        KEY key;
+        VALUE value;
+        size_t hash;
+    };
+
+    // Open-addressed table of entries, probed linearly. A slot holds
+    // null if it's never been used, or tombstone() if its entry was
+    // erased.
+    struct IndexTable {
+        explicit IndexTable(size_t size)
+            : mask(size - 1)
+            , slots(new std::atomic<IndexEntry*>[size])
+        {
+            for (size_t i = 0; i < size; ++i)
+                slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+        size_t mask;  // size-1 (the size is a power of 2)
+        std::unique_ptr<std::atomic<IndexEntry*>[]> slots;
+    };
+
     struct Bin {
         OIIO_CACHE_ALIGN               // align bin to cache line
             mutable spin_mutex mutex;  // mutex for this bin
         BinMap_t map;                  // hash map for this bin
+        size_t index_used  = 0;        // Index slots live or tombstoned
+        size_t migrate_pos = 0;        // Next old_index slot to move
 #ifndef NDEBUG
         mutable atomic_int m_nlocks;  // for debugging
 #endif
+        // The index is on a line of its own, which readers share and
+        // which changes only when the index is replaced.
+        OIIO_CACHE_ALIGN std::atomic<IndexTable*> index { nullptr };
+        std::atomic<IndexTable*> old_index { nullptr };  // Being moved
 
         Bin()
         {
@@ -424,35 +581,169 @@ private:
         }
     };
 
-    HASH m_hash;        // hashing function
-    atomic_int m_size;  // total entries in all bins
-    Bin m_bins[BINS];   // the bins
+    // Something removed from an index, waiting until no reader can be
+    // looking at it before it's freed.
+    struct Retired {
+        uint64_t epoch;
+        IndexEntry* entry;
+        IndexTable* table;
+    };
 
-    static constexpr int log2(unsigned n)
+    HASH m_hash;                     // hashing function
+    atomic_int m_size;               // total entries in all bins
+    Bin m_bins[BINS];                // the bins
+    spin_mutex m_retired_mutex;      // protects m_retired
+    std::vector<Retired> m_retired;  // removed, but may still be read
+    std::atomic<size_t> m_nretired { 0 };  // m_retired.size()
+
+    // Old index slots that each write moves to the new index.
+    static constexpr size_t migrate_batch = 16;
+
+    static IndexEntry* tombstone()
     {
-        return n < 2 ? 0 : 1 + log2(n / 2);
+        return reinterpret_cast<IndexEntry*>(uintptr_t(1));
     }
 
-    // Which bin will this key always appear in?
-    size_t whichbin(const KEY& key)
+    // Find key in index table t (which may be null), without locking.
+    // The caller must hold an epoch_reclaim::read_guard or the bin lock.
+    const IndexEntry* index_find(const IndexTable* t, const KEY& key,
+                                 size_t hash) const
     {
-        constexpr int LOG2_BINS = log2(BINS);
-        constexpr int BIN_SHIFT = 32 - LOG2_BINS;
+        if (!t)
+            return nullptr;
+        for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+            const IndexEntry* e = t->slots[i].load(std::memory_order_acquire);
+            if (!e)
+                return nullptr;
+            if (e != tombstone() && e->hash == hash && PRED()(e->key, key))
+                return e;
+        }
+    }
 
-        static_assert(1 << LOG2_BINS == BINS,
-                      "Number of bins must be a power of two");
-        static_assert(~uint32_t(0) >> BIN_SHIFT == (BINS - 1), "Hash overflow");
+    // Put e into the first free slot of t. Bin lock held.
+    static void index_place(IndexTable* t, IndexEntry* e)
+    {
+        size_t i = e->hash & t->mask;
+        while (t->slots[i].load(std::memory_order_relaxed))
+            i = (i + 1) & t->mask;
+        t->slots[i].store(e, std::memory_order_release);
+    }
 
-        // Use the high order bits of the hash to index the bin. We assume that the
-        // low-order bits of the hash will directly be used to index the hash table,
-        // so using those would lead to collisions.
-        // To avoid mixups between size_t among platforms, we always cast to a 32-bit
-        // integer first. Its quite possible the hash function only gave us a uint32_t
-        // even though the API technically wants a size_t.
-        size_t hash  = m_hash(key);
-        unsigned bin = uint32_t(hash) >> BIN_SHIFT;
-        DASSERT(bin < BINS);
-        return bin;
+    // Move up to n entries of the bin's old index to its current one,
+    // retiring the old index when it's all been moved. Bin lock held.
+    void migrate(Bin& bin, size_t n)
+    {
+        IndexTable* old = bin.old_index.load(std::memory_order_relaxed);
+        IndexTable* t   = bin.index.load(std::memory_order_relaxed);
+        for (; n && bin.migrate_pos <= old->mask; --n, ++bin.migrate_pos) {
+            IndexEntry* e = old->slots[bin.migrate_pos].load(
+                std::memory_order_relaxed);
+            if (e && e != tombstone()) {
+                // Leave it in the old table too, for readers who just
+                // missed it in the new one.
+                index_place(t, e);
+                ++bin.index_used;
+            }
+        }
+        if (bin.migrate_pos > old->mask) {
+            bin.old_index.store(nullptr, std::memory_order_release);
+            retire({}, old);
+        }
+    }
+
+    // Add a new entry to the bin's index. Bin lock held.
+    void index_insert(Bin& bin, IndexEntry* e)
+    {
+        if (bin.old_index.load(std::memory_order_relaxed))
+            migrate(bin, migrate_batch);
+        IndexTable* t = bin.index.load(std::memory_order_relaxed);
+        if (!t || 2 * (bin.index_used + 1) > t->mask + 1) {
+            // Start moving to a new table. It's big enough to take all
+            // the live entries plus everything that can be added before
+            // the move finishes, while staying no more than half full.
+            if (t && bin.old_index.load(std::memory_order_relaxed))
+                migrate(bin, size_t(-1));
+            size_t live = bin.map.size();  // includes e
+            size_t size = 16;
+            while (size < 4 * live
+                   || (t && size < (t->mask + 1) / migrate_batch * 4))
+                size *= 2;
+            IndexTable* fresh = new IndexTable(size);
+            bin.index_used    = 0;
+            bin.migrate_pos   = 0;
+            if (t)
+                bin.old_index.store(t, std::memory_order_release);
+            bin.index.store(fresh, std::memory_order_release);
+            t = fresh;
+        }
+        index_place(t, e);
+        ++bin.index_used;
+    }
+
+    // Remove key from the bin's index, and return its entry for the
+    // caller to retire(). Bin lock held.
+    IndexEntry* index_erase(Bin& bin, const KEY& key, size_t hash)
+    {
+        IndexEntry* e         = nullptr;
+        IndexTable* tables[2] = { bin.index.load(std::memory_order_relaxed),
+                                  bin.old_index.load(
+                                      std::memory_order_relaxed) };
+        for (IndexTable* t : tables) {
+            if (!t)
+                continue;
+            for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+                IndexEntry* s = t->slots[i].load(std::memory_order_relaxed);
+                if (!s)
+                    break;
+                if (s != tombstone() && s->hash == hash
+                    && PRED()(s->key, key)) {
+                    t->slots[i].store(tombstone(), std::memory_order_release);
+                    e = s;
+                    break;
+                }
+            }
+        }
+        DASSERT(e);
+        return e;
+    }
+
+    // Set aside unlinked entries (and a table, if not null), and free
+    // whatever set-aside things no reader can still be looking at. That
+    // is usually everything but the latest few, so that values are
+    // released soon after they leave the map.
+    void retire(const std::vector<IndexEntry*>& entries,
+                IndexTable* table = nullptr)
+    {
+        uint64_t epoch = epoch_reclaim::retire_epoch();
+        std::vector<Retired> freeable;
+        {
+            spin_lock lock(m_retired_mutex);
+            for (auto e : entries)
+                m_retired.push_back({ epoch, e, nullptr });
+            if (table)
+                m_retired.push_back({ epoch, nullptr, table });
+            uint64_t now = epoch_reclaim::advance();
+            if (now < epoch + 2)
+                now = epoch_reclaim::advance();
+            auto keep = std::partition(m_retired.begin(), m_retired.end(),
+                                       [=](const Retired& r) {
+                                           return r.epoch + 2 > now;
+                                       });
+            freeable.assign(keep, m_retired.end());
+            m_retired.erase(keep, m_retired.end());
+            m_nretired.store(m_retired.size(), std::memory_order_relaxed);
+        }
+        // Free outside the lock: dropping the last reference to a value
+        // may run arbitrary destructors.
+        for (auto& r : freeable) {
+            delete r.entry;
+            delete r.table;
+        }
+    }
+
+    static constexpr int log2(unsigned n)
+    {
+        return n < 2 ? 0 : 1 + log2(n / 2);
     }
 };
 
@@ -59,6 +59,7 @@
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
+#include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/timer.h>
@@ -126,6 +127,7 @@ ImageViewer::ImageViewer()
     , m_fullscreen(false)
     , m_default_gamma(1)
     , m_darkPalette(false)
+    , m_prefetcher(new thread_pool(2))
 {
     readSettings(false);
 
@@ -168,6 +170,8 @@ ImageViewer::ImageViewer()
 
 ImageViewer::~ImageViewer()
 {
+    cancelPrefetch();
+    m_prefetcher.reset();  // Wait for any read in progress
     for (auto i : m_images)
         delete i;
 }
@@ -449,6 +453,11 @@ ImageViewer::createActions()
     maxMemoryIC->setSingleStep(64);
     maxMemoryIC->setSuffix(" MB");
 
+    prefetchImagesLabel = new QLabel(tr("Read ahead images"));
+    prefetchImages      = new QSpinBox();
+    prefetchImages->setRange(0, 16);
+    prefetchImages->setSingleStep(1);
+
     slideShowDurationLabel = new QLabel(tr("Slide Show delay"));
     slideShowDuration      = new QSpinBox();
     slideShowDuration->setRange(1, 3600);
@@ -644,6 +653,7 @@ ImageViewer::readSettings(bool ui_is_set_up)
         maxMemoryIC->setValue(settings.value("maxMemoryIC", 2048).toInt());
     slideShowDuration->setValue(
         settings.value("slideShowDuration", 10).toInt());
+    prefetchImages->setValue(settings.value("prefetchImages", 2).toInt());
 
     ImageCache* imagecache = ImageCache::create(true);
     imagecache->attribute("automip", autoMipmap->isChecked());
@@ -664,6 +674,7 @@ ImageViewer::writeSettings()
     settings.setValue("autoMipmap", autoMipmap->isChecked());
     settings.setValue("maxMemoryIC", maxMemoryIC->value());
     settings.setValue("slideShowDuration", slideShowDuration->value());
+    settings.setValue("prefetchImages", prefetchImages->value());
     QStringList recent;
     for (auto&& s : m_recent_files)
         recent.push_front(QString(s.c_str()));
@@ -996,16 +1007,9 @@ ImageViewer::loadCurrentImage(int subimage, int miplevel)
                 //std::cerr << "Loading HALF-FLOAT as FLOAT\n";
                 read_format = TypeDesc::FLOAT;
             }
-            if (IsSpecSrgb(image_spec) && !glwin->is_srgb_capable()) {
-                // If the image is in sRGB, but OpenGL can't load sRGB textures then
-                // we'll need to do the transformation on the CPU after loading the
-                // image. We (so far) can only do this with UINT8 images, so make
-                // sure that it gets loaded in this format.
-                //std::cerr << "Loading as UINT8 to do sRGB\n";
-                read_format      = TypeDesc::UINT8;
-                srgb_transform   = true;
-                allow_transforms = true;
-            }
+            // If the image is in sRGB but OpenGL can't load sRGB textures,
+            // the shader decodes it, so the pixels go up as they are, and
+            // changing the view never has to touch them on the CPU.
         } else {
             //std::cerr << "Loading as UINT8\n";
             read_format      = TypeDesc::UINT8;
@@ -1096,6 +1100,110 @@ ImageViewer::displayCurrentImage(bool update)
     //    fitImageToWindowAct->setEnabled(true);
     //    fullScreenAct->setEnabled(true);
     updateActions();
+
+    prefetchNeighbors();
+}
+
+
+
+// Pull the tiles of one MIP level of an image into the ImageCache, a row
+// of tiles at a time, until cancelled or out of budget (in bytes, shared
+// by all the images being read ahead).
+static void
+prefetch_image(ustring filename, int miplevel,
+               std::shared_ptr<std::atomic<bool>> cancel,
+               std::shared_ptr<std::atomic<int64_t>> budget)
+{
+    if (*cancel)
+        return;
+    ImageCache* imagecache = ImageCache::create(true);
+    ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+    ImageCache::ImageHandle* file = imagecache->get_image_handle(filename,
+                                                                 thread_info);
+    int nmiplevels = 1;
+    ImageSpec spec;
+    if (file
+        && imagecache->get_image_info(file, thread_info, 0, 0,
+                                      ustring("miplevels"), TypeDesc::INT,
+                                      &nmiplevels)
+        && imagecache->get_imagespec(file, thread_info, spec, 0,
+                                     std::min(miplevel, nmiplevels - 1))
+        && (*budget -= int64_t(spec.image_bytes())) >= 0) {
+        miplevel = std::min(miplevel, nmiplevels - 1);
+        int tw = std::max(1, spec.tile_width);
+        int th = std::max(1, spec.tile_height);
+        int td = std::max(1, spec.tile_depth);
+        std::vector<ImageCache::TileRequest> requests;
+        std::vector<ImageCache::Tile*> tiles;
+        for (int z = spec.z; z < spec.z + spec.depth; z += td) {
+            for (int y = spec.y; y < spec.y + spec.height; y += th) {
+                if (*cancel)
+                    return;
+                requests.clear();
+                for (int x = spec.x; x < spec.x + spec.width; x += tw) {
+                    ImageCache::TileRequest r;
+                    r.miplevel = miplevel;
+                    r.x        = x;
+                    r.y        = y;
+                    r.z        = z;
+                    requests.push_back(r);
+                }
+                tiles.assign(requests.size(), NULL);
+                imagecache->get_tiles(file, thread_info, requests, tiles);
+                for (auto t : tiles)
+                    if (t)
+                        imagecache->release_tile(t);
+            }
+        }
+    }
+    // Problems with this file will be reported if and when it's viewed.
+    (void)imagecache->geterror();
+}
+
+
+
+void
+ImageViewer::prefetchNeighbors()
+{
+    cancelPrefetch();
+    IvImage* img = cur();
+    int nimages  = (int)m_images.size();
+    int window   = std::min(prefetchImages->value(), nimages / 2);
+    if (!img || window < 1)
+        return;
+
+    // Read the level that will be shown at the current zoom, and leave
+    // at least half the cache for the image being viewed.
+    int miplevel = 0;
+    if (zoom() < 1.0f && img->streamable())
+        miplevel = (int)floorf(log2f(1.0f / zoom()) + 0.5f);
+    auto budget = std::make_shared<std::atomic<int64_t>>(
+        (int64_t(maxMemoryIC->value()) << 20) / 2);
+    m_prefetch_cancel = std::make_shared<std::atomic<bool>>(false);
+    auto cancel       = m_prefetch_cancel;
+    auto prefetch     = [&](int i) {
+        ustring name(m_images[i]->name());
+        m_prefetcher->push([=](int /*id*/) {
+            prefetch_image(name, miplevel, cancel, budget);
+        });
+    };
+    for (int d = 1; d <= window; ++d) {
+        int next = (m_current_image + d) % nimages;
+        int prev = (m_current_image - d + nimages) % nimages;
+        prefetch(next);
+        if (prev != next)
+            prefetch(prev);
+    }
+}
+
+
+
+void
+ImageViewer::cancelPrefetch()
+{
+    if (m_prefetch_cancel)
+        *m_prefetch_cancel = true;
+    m_prefetch_cancel.reset();
 }
 
 
@@ -1321,9 +1429,10 @@ ImageViewer::viewChannel(int c, COLOR_MODE colormode)
                                        && IsSpecSrgb(img->spec()));
                 img->pixel_transform(srgb_transform, (int)colormode, c);
             }
+        } else if (glwin->has_all_channels()) {
+            // The shader picks whichever channels it needs.
+            update = false;
         } else {
-            // FIXME: There are even more chances to avoid updating the textures
-            // if we can keep trac of which channels are in the texture.
             if (m_current_channel == c) {
                 if (m_color_mode == SINGLE_CHANNEL || m_color_mode == HEATMAP) {
                     if (colormode == HEATMAP || colormode == SINGLE_CHANNEL)
@@ -44,6 +44,8 @@
 // included to remove std::min/std::max errors
 #include <OpenImageIO/platform.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include <QAction>
@@ -58,6 +60,7 @@
 
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/thread.h>
 
 using namespace OIIO;
 
@@ -140,6 +143,26 @@ public:
             return ImageBuf::get_pixels(roi, format, result);
     }
 
+    /// The data format the pixels should be handed to OpenGL in, which
+    /// may differ from that of the ImageBuf if it is still backed by the
+    /// ImageCache.
+    TypeDesc display_format() const
+    {
+        if (m_corrected_image.localpixels())
+            return m_corrected_image.spec().format;
+        return m_display_format.basetype != TypeDesc::UNKNOWN
+                   ? m_display_format
+                   : spec().format;
+    }
+
+    /// Can the display read the pixels straight from the ImageCache, a
+    /// patch (and MIP level) at a time, from any thread?
+    bool streamable() const
+    {
+        return storage() == ImageBuf::IMAGECACHE && imagecache()
+               && !m_corrected_image.localpixels();
+    }
+
     bool auto_subimage(void) const { return m_auto_subimage; }
     void auto_subimage(bool v) { m_auto_subimage = v; }
 
@@ -150,6 +173,7 @@ private:
     float m_gamma;               ///< Gamma correction of this image
     float m_exposure;            ///< Exposure gain of this image, in stops
     TypeDesc m_file_dataformat;  ///< TypeDesc of the image on disk (not in ram)
+    TypeDesc m_display_format;   ///< Format requested for display
     mutable std::string m_shortinfo;
     mutable std::string m_longinfo;
     bool m_image_valid;    ///< Image is valid and pixels can be read.
@@ -326,6 +350,11 @@ private:
     void updateRecentFilesMenu();
     bool loadCurrentImage(int subimage = 0, int miplevel = 0);
     void displayCurrentImage(bool update = true);
+    /// Start reading the images around the current one into the
+    /// ImageCache in the background, nearest first, and stop reading
+    /// any that are no longer near.
+    void prefetchNeighbors();
+    void cancelPrefetch();
     void updateTitle();
     void updateStatusBar();
     void keyPressEvent(QKeyEvent* event);
@@ -393,6 +422,8 @@ private:
     QCheckBox* autoMipmap;
     QLabel* maxMemoryICLabel;
     QSpinBox* maxMemoryIC;
+    QLabel* prefetchImagesLabel;
+    QSpinBox* prefetchImages;
     QLabel* slideShowDurationLabel;
     QSpinBox* slideShowDuration;
 
@@ -407,6 +438,8 @@ private:
     float m_default_gamma;                    // Default gamma of the display
     QPalette m_palette;                       // Custom palette
     bool m_darkPalette;                       // Use dark palette?
+    std::unique_ptr<thread_pool> m_prefetcher;  // Reads neighboring images
+    std::shared_ptr<std::atomic<bool>> m_prefetch_cancel;  // Stops them
 
     // The default width and height of the window:
     static const int m_default_width  = 640;
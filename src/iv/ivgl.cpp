@@ -31,6 +31,7 @@
 #include "ivgl.h"
 #include "imageviewer.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <OpenEXR/ImathFun.h>
@@ -43,10 +44,28 @@
 
 #include "ivutils.h"
 #include <OpenImageIO/fmath.h>
+#include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/timer.h>
 
 
+// Size of the tiles the image is read and uploaded in, unless the image
+// is smaller (or GL can't do it).
+static const int streamtilesize = 512;
+
+// How much memory the tile textures may use altogether.
+static const size_t texbuf_memory_budget = size_t(512) << 20;
+
+
+
+static bool
+is_srgb(const ImageSpec& spec)
+{
+    return Strutil::iequals(spec.get_string_attribute("oiio:ColorSpace"),
+                            "sRGB");
+}
+
+
 static const char*
 gl_err_to_string(GLenum err)
 {  // Thanks, Dan Wexler, for this function
@@ -88,7 +107,14 @@ IvGL::IvGL(QWidget* parent, ImageViewer& viewer)
     , m_last_pbo_used(0)
     , m_current_image(NULL)
     , m_pixelview_left_corner(true)
-    , m_last_texbuf_used(0)
+    , m_max_texbufs(4)
+    , m_frame(0)
+    , m_gltype(GL_UNSIGNED_BYTE)
+    , m_glformat(GL_RGB)
+    , m_glinternalformat(GL_RGB)
+    , m_tex_chbegin(0)
+    , m_tex_nchannels(0)
+    , m_tile_reader(new thread_pool(4))
 {
 #if 0
     QGLFormat format;
@@ -102,11 +128,19 @@ IvGL::IvGL(QWidget* parent, ImageViewer& viewer)
     m_mouse_activation = false;
     this->setFocusPolicy(Qt::StrongFocus);
     setMouseTracking(true);
+    // Tiles are read on other threads, but drawn on this one.
+    connect(this, &IvGL::tile_read_done, this, [this]() { parent_t::update(); },
+            Qt::QueuedConnection);
 }
 
 
 
-IvGL::~IvGL() {}
+IvGL::~IvGL()
+{
+    // Wait for the readers, which signal us when they're done.
+    cancel_tile_reads();
+    m_tile_reader.reset();
+}
 
 
 
@@ -188,6 +222,8 @@ IvGL::create_textures(void)
         m_texbufs.back().y          = 0;
         m_texbufs.back().width      = 0;
         m_texbufs.back().height     = 0;
+        m_texbufs.back().miplevel   = -1;
+        m_texbufs.back().last_used  = 0;
     }
 
     // Create another texture for the pixelview.
@@ -235,6 +271,24 @@ IvGL::create_shaders(void)
         "uniform int linearinterp;\n"
         "uniform int width;\n"
         "uniform int height;\n"
+        "uniform int srgb;\n"
+        // Channel c of the texture, or 0 if it has no such channel.
+        "float channel (vec4 C, int c)\n"
+        "{\n"
+        "    if (imgchannels == 2 && c == 1)\n"
+        "        return C.a;\n"
+        "    if (c >= imgchannels && c != 3)\n"
+        "        return 0.0;\n"
+        "    float C2[4];\n"
+        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
+        "    return C2[c];\n"
+        "}\n"
+        "vec3 srgb_to_linear (vec3 C)\n"
+        "{\n"
+        "    vec3 lo = C / 12.92;\n"
+        "    vec3 hi = pow (max ((C + 0.055) / 1.055, vec3 (0.0)), vec3 (2.4));\n"
+        "    return mix (hi, lo, vec3 (lessThanEqual (C, vec3 (0.04045))));\n"
+        "}\n"
         "vec4 rgba_mode (vec4 C)\n"
         "{\n"
         "    if (imgchannels <= 2) {\n"
@@ -242,6 +296,10 @@ IvGL::create_shaders(void)
         "           return vec4(C.aaa, 1.0);\n"
         "        return C.rrra;\n"
         "    }\n"
+        "    if (startchannel > 0)\n"
+        "        return vec4 (channel (C, startchannel),\n"
+        "                     channel (C, startchannel+1),\n"
+        "                     channel (C, startchannel+2), 1.0);\n"
         "    return C;\n"
         "}\n"
         "vec4 rgb_mode (vec4 C)\n"
@@ -251,17 +309,16 @@ IvGL::create_shaders(void)
         "           return vec4(C.aaa, 1.0);\n"
         "        return vec4 (C.rrr, 1.0);\n"
         "    }\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    return vec4 (C2[startchannel], C2[startchannel+1], C2[startchannel+2], 1.0);\n"
+        "    return vec4 (channel (C, startchannel),\n"
+        "                 channel (C, startchannel+1),\n"
+        "                 channel (C, startchannel+2), 1.0);\n"
         "}\n"
         "vec4 singlechannel_mode (vec4 C)\n"
         "{\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    if (startchannel > imgchannels)\n"
+        "    if (startchannel >= imgchannels)\n"
         "        return vec4 (0.0,0.0,0.0,1.0);\n"
-        "    return vec4 (C2[startchannel], C2[startchannel], C2[startchannel], 1.0);\n"
+        "    float c = channel (C, startchannel);\n"
+        "    return vec4 (c, c, c, 1.0);\n"
         "}\n"
         "vec4 luminance_mode (vec4 C)\n"
         "{\n"
@@ -282,12 +339,8 @@ IvGL::create_shaders(void)
         "}\n"
         "vec4 heatmap_mode (vec4 C)\n"
         "{\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    return vec4(heat_red(C2[startchannel]),\n"
-        "                heat_green(C2[startchannel]),\n"
-        "                heat_red(1.0-C2[startchannel]),\n"
-        "                1.0);\n"
+        "    float c = channel (C, startchannel);\n"
+        "    return vec4(heat_red(c), heat_green(c), heat_red(1.0-c), 1.0);\n"
         "}\n"
         "void main ()\n"
         "{\n"
@@ -309,6 +362,8 @@ IvGL::create_shaders(void)
         "        }\n"
         "    }\n"
         "    vec4 C = texture2D (imgtex, st);\n"
+        "    if (srgb != 0)\n"
+        "        C.rgb = srgb_to_linear (C.rgb);\n"
         "    C = mix (C, vec4(0.05,0.05,0.05,1.0), black);\n"
         "    if (startchannel < 0)\n"
         "        C = vec4(0.0,0.0,0.0,1.0);\n"
@@ -571,8 +626,6 @@ IvGL::paintGL()
 
     useshader(m_texture_width, m_texture_height);
 
-    float smin = 0, smax = 1.0;
-    float tmin = 0, tmax = 1.0;
     // Image pixels shown from the center to the edge of the window.
     int wincenterx = (int)ceil(width() / (2 * m_zoom));
     int wincentery = (int)ceil(height() / (2 * m_zoom));
@@ -580,57 +633,86 @@ IvGL::paintGL()
         std::swap(wincenterx, wincentery);
     }
 
-    int xbegin = (int)floor(real_centerx) - wincenterx;
-    xbegin     = std::max(spec.x, xbegin - (xbegin % m_texture_width));
-    int ybegin = (int)floor(real_centery) - wincentery;
-    ybegin     = std::max(spec.y, ybegin - (ybegin % m_texture_height));
-    int xend   = (int)floor(real_centerx) + wincenterx;
-    xend       = std::min(spec.x + spec.width,
-                    xend + m_texture_width - (xend % m_texture_width));
-    int yend   = (int)floor(real_centery) + wincentery;
-    yend       = std::min(spec.y + spec.height,
-                    yend + m_texture_height - (yend % m_texture_height));
+    // The visible part of the image.
+    int xbegin = std::max(spec.x, (int)floor(real_centerx) - wincenterx);
+    int ybegin = std::max(spec.y, (int)floor(real_centery) - wincentery);
+    int xend   = std::min(spec.x + spec.width,
+                        (int)floor(real_centerx) + wincenterx + 1);
+    int yend   = std::min(spec.y + spec.height,
+                        (int)floor(real_centery) + wincentery + 1);
     //std::cerr << "(" << xbegin << ',' << ybegin << ") - (" << xend << ',' << yend << ")\n";
 
-    // Provide some feedback
-    int total_tiles    = (int)(ceilf(float(xend - xbegin) / m_texture_width)
-                            * ceilf(float(yend - ybegin) / m_texture_height));
-    float tile_advance = 1.0f / total_tiles;
-    float percent      = tile_advance;
-    m_viewer.statusViewInfo->hide();
-    m_viewer.statusProgress->show();
-
-    // FIXME: change the code path so we can take full advantage of async DMA
-    // when using PBO.
-    for (int ystart = ybegin; ystart < yend; ystart += m_texture_height) {
-        for (int xstart = xbegin; xstart < xend; xstart += m_texture_width) {
-            int tile_width  = std::min(xend - xstart, m_texture_width);
-            int tile_height = std::min(yend - ystart, m_texture_height);
-            smax            = tile_width / float(m_texture_width);
-            tmax            = tile_height / float(m_texture_height);
-
-            //std::cerr << "xstart: " << xstart << ". ystart: " << ystart << "\n";
-            //std::cerr << "tile_width: " << tile_width << ". tile_height: " << tile_height << "\n";
-
-            // FIXME: This can get too slow. Some ideas: avoid sending the tex
-            // images more than necessary, figure an optimum texture size, use
-            // multiple texture objects.
-            load_texture(xstart, ystart, tile_width, tile_height, percent);
-            gl_rect(xstart, ystart, xstart + tile_width, ystart + tile_height,
-                    0, smin, tmin, smax, tmax);
-            percent += tile_advance;
+    // It's drawn from the tiles of the MIP level best suited to the zoom,
+    // whose pixel (lx,ly) lands on (spec.x + (lx - levelx) * xscale,
+    // spec.y + (ly - levely) * yscale) of the level being viewed.
+    int miplevel = display_miplevel(img);
+    int levelx = spec.x, levely = spec.y;
+    int levelw = spec.width, levelh = spec.height;
+    if (miplevel != img->miplevel()) {
+        const ImageSpec* lspec = img->imagecache()->imagespec(
+            ustring(img->name()), img->subimage(), miplevel);
+        if (lspec) {
+            levelx = lspec->x;
+            levely = lspec->y;
+            levelw = lspec->width;
+            levelh = lspec->height;
+        } else {
+            miplevel = img->miplevel();
+        }
+    }
+    float xscale = float(spec.width) / levelw;
+    float yscale = float(spec.height) / levelh;
+    int lxbegin  = levelx + (int)floorf((xbegin - spec.x) / xscale);
+    int lybegin  = levely + (int)floorf((ybegin - spec.y) / yscale);
+    int lxend    = std::min(levelx + levelw,
+                         levelx + (int)ceilf((xend - spec.x) / xscale));
+    int lyend    = std::min(levely + levelh,
+                         levely + (int)ceilf((yend - spec.y) / yscale));
+    lxbegin -= (lxbegin - levelx) % m_texture_width;
+    lybegin -= (lybegin - levely) % m_texture_height;
+
+    // Tiles that haven't been read yet are requested from background
+    // threads, which trigger another paint as each arrives. Until then,
+    // a tile of another level that covers the same area stands in.
+    ++m_frame;
+    for (int y = lybegin; y < lyend; y += m_texture_height) {
+        for (int x = lxbegin; x < lxend; x += m_texture_width) {
+            int w      = std::min<int>(m_texture_width, levelx + levelw - x);
+            int h      = std::min<int>(m_texture_height, levely + levelh - y);
+            float xmin = spec.x + (x - levelx) * xscale;
+            float ymin = spec.y + (y - levely) * yscale;
+            float xmax = spec.x + (x + w - levelx) * xscale;
+            float ymax = spec.y + (y + h - levely) * yscale;
+            TexBuffer* tb = load_texture(x, y, w, h, miplevel, xmin, ymin,
+                                         xmax, ymax);
+            const float eps = 0.01f;
+            for (size_t i = 0; !tb && i < m_texbufs.size(); ++i) {
+                TexBuffer& t(m_texbufs[i]);
+                if (t.width && t.xmin <= xmin + eps && t.ymin <= ymin + eps
+                    && t.xmax >= xmax - eps && t.ymax >= ymax - eps)
+                    tb = &t;
+            }
+            if (tb)
+                draw_texbuf(*tb, xmin, ymin, xmax, ymax);
         }
     }
 
+    // Tiles that went out of view before they were read needn't be.
+    for (auto&& r : m_tile_reads)
+        if (r->last_wanted != m_frame)
+            r->cancelled = true;
+    m_tile_reads.erase(std::remove_if(m_tile_reads.begin(), m_tile_reads.end(),
+                                      [&](const std::shared_ptr<TileRead>& r) {
+                                          return r->cancelled.load();
+                                      }),
+                       m_tile_reads.end());
+
     glPopMatrix();
 
     if (m_viewer.pixelviewOn()) {
         paint_pixelview();
     }
 
-    // Show the status info again.
-    m_viewer.statusProgress->hide();
-    m_viewer.statusViewInfo->show();
     unsetCursor();
 
 #ifndef NDEBUG
@@ -770,29 +852,26 @@ IvGL::paint_pixelview()
         //std::cerr << "tex (" << smin << "," << tmin << ") - (" << smax << "," << tmax << ")\n";
         //std::cerr << "center mouse (" << xp << "," << yp << "), real (" << real_xp << "," << real_yp << ")\n";
 
-        int nchannels = img->nchannels();
-        // For simplicity, we don't support more than 4 channels without shaders
-        // (yet).
-        if (m_use_shaders) {
-            nchannels = num_channels(m_viewer.current_channel(), nchannels,
-                                     m_viewer.current_color_mode());
-        }
+        // The same channels as the main textures, for the same shader.
+        int nchannels = m_tex_nchannels;
 
+        TypeDesc format  = img->display_format();
         void* zoombuffer = alloca((xend - xbegin) * (yend - ybegin) * nchannels
-                                  * spec.channel_bytes());
+                                  * format.size());
         if (!m_use_shaders) {
             img->get_pixels(ROI(spec.x + xbegin, spec.x + xend, spec.y + ybegin,
                                 spec.y + yend),
-                            spec.format, zoombuffer);
+                            format, zoombuffer);
         } else {
             ROI roi(spec.x + xbegin, spec.x + xend, spec.y + ybegin,
-                    spec.y + yend, 0, 1, m_viewer.current_channel(),
-                    m_viewer.current_channel() + nchannels);
-            img->get_pixels(roi, spec.format, zoombuffer);
+                    spec.y + yend, 0, 1, m_tex_chbegin,
+                    m_tex_chbegin + nchannels);
+            img->get_pixels(roi, format, zoombuffer);
         }
 
         GLenum glformat, gltype, glinternalformat;
-        typespec_to_opengl(spec, nchannels, gltype, glformat, glinternalformat);
+        typespec_to_opengl(spec, format, nchannels, gltype, glformat,
+                           glinternalformat);
         // Use pixelview's own texture, and upload the corresponding image patch.
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
         glBindTexture(GL_TEXTURE_2D, m_pixelview_tex);
@@ -932,7 +1011,7 @@ IvGL::useshader(int tex_width, int tex_height, bool pixelview)
         glUniform1i(loc, -1);
         return;
     }
-    glUniform1i(loc, 0);
+    glUniform1i(loc, m_viewer.current_channel() - m_tex_chbegin);
 
     loc = glGetUniformLocation(m_shader_program, "imgtex");
     // This is the texture unit, not the texture object
@@ -950,7 +1029,11 @@ IvGL::useshader(int tex_width, int tex_height, bool pixelview)
     glUniform1i(loc, m_viewer.current_color_mode());
 
     loc = glGetUniformLocation(m_shader_program, "imgchannels");
-    glUniform1i(loc, spec.nchannels);
+    glUniform1i(loc, m_tex_nchannels);
+
+    // sRGB images are decoded here when GL can't do it for us.
+    loc = glGetUniformLocation(m_shader_program, "srgb");
+    glUniform1i(loc, !m_use_srgb && is_srgb(spec));
 
     loc = glGetUniformLocation(m_shader_program, "pixelview");
     glUniform1i(loc, pixelview);
@@ -968,11 +1051,23 @@ IvGL::useshader(int tex_width, int tex_height, bool pixelview)
 
 
 
+bool
+IvGL::has_all_channels(void) const
+{
+    return m_current_image && m_tex_chbegin == 0
+           && m_tex_nchannels == m_current_image->nchannels();
+}
+
+
+
 void
 IvGL::update()
 {
     //std::cerr << "update image\n";
 
+    // Whatever we had read or uploaded is stale now.
+    cancel_tile_reads();
+
     IvImage* img = m_viewer.cur();
     if (!img) {
         m_current_image = NULL;
@@ -980,12 +1075,18 @@ IvGL::update()
     }
 
     const ImageSpec& spec(img->spec());
+    TypeDesc format = img->display_format();
 
+    // With shaders, images of up to 4 channels are uploaded whole and the
+    // shader picks the channels to show, so that changing the channel or
+    // color mode doesn't need another upload. Otherwise, just the channels
+    // shown are uploaded. For simplicity, we don't support more than 4
+    // channels without shaders (yet).
     int nchannels = img->nchannels();
-    // For simplicity, we don't support more than 4 channels without shaders
-    // (yet).
-    if (m_use_shaders) {
-        nchannels = num_channels(m_viewer.current_channel(), nchannels,
+    int chbegin   = 0;
+    if (m_use_shaders && nchannels > 4) {
+        chbegin   = m_viewer.current_channel();
+        nchannels = num_channels(chbegin, nchannels,
                                  m_viewer.current_color_mode());
     }
 
@@ -995,16 +1096,29 @@ IvGL::update()
     GLenum gltype           = GL_UNSIGNED_BYTE;
     GLenum glformat         = GL_RGB;
     GLenum glinternalformat = GL_RGB;
-    typespec_to_opengl(spec, nchannels, gltype, glformat, glinternalformat);
-
-    m_texture_width  = clamp(pow2roundup(spec.width), 1, m_max_texture_size);
-    m_texture_height = clamp(pow2roundup(spec.height), 1, m_max_texture_size);
+    typespec_to_opengl(spec, format, nchannels, gltype, glformat,
+                       glinternalformat);
+    m_gltype           = gltype;
+    m_glformat         = glformat;
+    m_glinternalformat = glinternalformat;
+    m_tex_format       = format;
+    m_tex_nchannels    = nchannels;
+    m_tex_chbegin      = chbegin;
+
+    // The image is shown as a mosaic of tiles, each in its own texture.
+    int maxtile      = std::min<int>(m_max_texture_size, streamtilesize);
+    m_texture_width  = clamp(pow2roundup(spec.width), 1, maxtile);
+    m_texture_height = clamp(pow2roundup(spec.height), 1, maxtile);
+    size_t texbytes  = size_t(m_texture_width) * m_texture_height * nchannels
+                      * format.size();
+    m_max_texbufs    = clamp(int(texbuf_memory_budget / texbytes), 4, 256);
 
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
     for (auto&& tb : m_texbufs) {
-        tb.width  = 0;
-        tb.height = 0;
+        tb.width    = 0;
+        tb.height   = 0;
+        tb.miplevel = -1;
         glBindTexture(GL_TEXTURE_2D, tb.tex_object);
         glTexImage2D(GL_TEXTURE_2D, 0 /*mip level*/, glinternalformat,
                      m_texture_width, m_texture_height, 0 /*border width*/,
@@ -1018,9 +1132,6 @@ IvGL::update()
                  closeuptexsize, 0, glformat, gltype, NULL);
     GLERRPRINT("Setting up pixelview texture");
 
-    // Resize the buffer at once, rather than create one each drawing.
-    m_tex_buffer.resize(m_texture_width * m_texture_height * nchannels
-                        * spec.channel_bytes());
     m_current_image = img;
 }
 
@@ -1356,10 +1467,11 @@ IvGL::check_gl_extensions(void)
 
 
 void
-IvGL::typespec_to_opengl(const ImageSpec& spec, int nchannels, GLenum& gltype,
-                         GLenum& glformat, GLenum& glinternalformat) const
+IvGL::typespec_to_opengl(const ImageSpec& spec, TypeDesc format,
+                         int nchannels, GLenum& gltype, GLenum& glformat,
+                         GLenum& glinternalformat) const
 {
-    switch (spec.format.basetype) {
+    switch (format.basetype) {
     case TypeDesc::FLOAT: gltype = GL_FLOAT; break;
     case TypeDesc::HALF:
         if (m_use_halffloat) {
@@ -1384,76 +1496,75 @@ IvGL::typespec_to_opengl(const ImageSpec& spec, int nchannels, GLenum& gltype,
         break;
     }
 
-    bool issrgb = Strutil::iequals(spec.get_string_attribute("oiio:ColorSpace"),
-                                   "sRGB");
+    bool issrgb = is_srgb(spec);
 
     glinternalformat = nchannels;
     if (nchannels == 1) {
         glformat = GL_LUMINANCE;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SLUMINANCE8;
             } else {
                 glinternalformat = GL_SLUMINANCE;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_LUMINANCE8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_LUMINANCE16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_LUMINANCE32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_LUMINANCE16F_ARB;
         }
     } else if (nchannels == 2) {
         glformat = GL_LUMINANCE_ALPHA;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SLUMINANCE8_ALPHA8;
             } else {
                 glinternalformat = GL_SLUMINANCE_ALPHA;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_LUMINANCE8_ALPHA8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_LUMINANCE16_ALPHA16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_LUMINANCE_ALPHA32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_LUMINANCE_ALPHA16F_ARB;
         }
     } else if (nchannels == 3) {
         glformat = GL_RGB;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SRGB8;
             } else {
                 glinternalformat = GL_SRGB;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_RGB8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_RGB16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_RGB32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_RGB16F_ARB;
         }
     } else if (nchannels == 4) {
         glformat = GL_RGBA;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SRGB8_ALPHA8;
             } else {
                 glinternalformat = GL_SRGB_ALPHA;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_RGBA8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_RGBA16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_RGBA32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_RGBA16F_ARB;
         }
     } else {
@@ -1464,70 +1575,183 @@ IvGL::typespec_to_opengl(const ImageSpec& spec, int nchannels, GLenum& gltype,
 
 
 
-void
-IvGL::load_texture(int x, int y, int width, int height, float percent)
+int
+IvGL::display_miplevel(IvImage* img) const
+{
+    int miplevel = img->miplevel();
+    if (m_zoom >= 1.0f || !img->streamable())
+        return miplevel;
+    // Each level halves the resolution; take the one whose pixels come
+    // nearest to the size of the window's.
+    int down = (int)floorf(log2f(1.0f / m_zoom) + 0.5f);
+    return std::min(miplevel + down, img->nmiplevels() - 1);
+}
+
+
+
+IvGL::TexBuffer*
+IvGL::load_texture(int x, int y, int width, int height, int miplevel,
+                   float xmin, float ymin, float xmax, float ymax)
 {
-    const ImageSpec& spec = m_current_image->spec();
     // Find if this has already been loaded.
     for (auto&& tb : m_texbufs) {
-        if (tb.x == x && tb.y == y && tb.width >= width
-            && tb.height >= height) {
-            glBindTexture(GL_TEXTURE_2D, tb.tex_object);
-            return;
-        }
+        if (tb.x == x && tb.y == y && tb.miplevel == miplevel
+            && tb.width == width && tb.height == height)
+            return &tb;
     }
 
-    // Disabling progress report. Seems clear after some research that we cannot
-    // update the bar (not even with a signal) within a paint function without
-    // messing up the openGL context
-    //m_viewer.statusProgress->setValue ((int)(percent*100));
-    //m_viewer.statusProgress->update ();
-    setCursor(Qt::WaitCursor);
-
-    int nchannels = spec.nchannels;
-    // For simplicity, we don't support more than 4 channels without shaders
-    // (yet).
-    if (m_use_shaders) {
-        nchannels = num_channels(m_viewer.current_channel(), nchannels,
-                                 m_viewer.current_color_mode());
+    // Find if it has already been asked for, and if not, ask for it.
+    std::shared_ptr<TileRead> read;
+    for (auto&& r : m_tile_reads) {
+        if (r->x == x && r->y == y && r->miplevel == miplevel) {
+            read = r;
+            break;
+        }
     }
-    GLenum gltype, glformat, glinternalformat;
-    typespec_to_opengl(spec, nchannels, gltype, glformat, glinternalformat);
-
-    TexBuffer& tb = m_texbufs[m_last_texbuf_used];
-    tb.x          = x;
-    tb.y          = y;
-    tb.width      = width;
-    tb.height     = height;
-    // Copy the imagebuf pixels we need, that's the only way we can do
-    // it safely since ImageBuf has a cache underneath and the whole image
-    // may not be resident at once.
-    if (!m_use_shaders) {
-        m_current_image->get_pixels(ROI(x, x + width, y, y + height),
-                                    spec.format, &m_tex_buffer[0]);
-    } else {
-        m_current_image->get_pixels(ROI(x, x + width, y, y + height, 0, 1,
-                                        m_viewer.current_channel(),
-                                        m_viewer.current_channel() + nchannels),
-                                    spec.format, &m_tex_buffer[0]);
+    if (!read) {
+        read.reset(new TileRead);
+        read->x        = x;
+        read->y        = y;
+        read->width    = width;
+        read->height   = height;
+        read->miplevel = miplevel;
+        read->pixels.resize(size_t(width) * height * m_tex_nchannels
+                            * m_tex_format.size());
+        m_tile_reads.push_back(read);
+        IvImage* img = m_current_image;
+        ROI roi(x, x + width, y, y + height, 0, 1, m_tex_chbegin,
+                m_tex_chbegin + m_tex_nchannels);
+        if (img->streamable()) {
+            // Read straight from the ImageCache, which is safe from any
+            // thread and doesn't need img to stay around.
+            ImageCache* imagecache = img->imagecache();
+            ustring name(img->name());
+            int subimage    = img->subimage();
+            TypeDesc format = m_tex_format;
+            m_tile_reader->push([=](int /*id*/) {
+                if (read->cancelled)
+                    return;
+                read->ok = imagecache->get_pixels(name, subimage, miplevel,
+                                                  roi.xbegin, roi.xend,
+                                                  roi.ybegin, roi.yend, 0, 1,
+                                                  roi.chbegin, roi.chend,
+                                                  format, &read->pixels[0]);
+                read->done = true;
+                emit tile_read_done();
+            });
+        } else {
+            // Pixels that are already in memory are quick to copy here.
+            read->ok   = img->get_pixels(roi, m_tex_format, &read->pixels[0]);
+            read->done = true;
+        }
     }
+    read->last_wanted = m_frame;
+    if (!read->done || !read->ok)
+        return NULL;
+
+    TexBuffer* tb = recycle_texbuf();
+    if (!tb)
+        return NULL;  // Try again next frame
+    tb->x        = x;
+    tb->y        = y;
+    tb->width    = width;
+    tb->height   = height;
+    tb->miplevel = miplevel;
+    tb->xmin     = xmin;
+    tb->ymin     = ymin;
+    tb->xmax     = xmax;
+    tb->ymax     = ymax;
 
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo_objects[m_last_pbo_used]);
-    glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * spec.pixel_bytes(),
-                 &m_tex_buffer[0], GL_STREAM_DRAW);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, read->pixels.size(),
+                 &read->pixels[0], GL_STREAM_DRAW);
     GLERRPRINT("After buffer data");
     m_last_pbo_used = (m_last_pbo_used + 1) & 1;
 
     // When using PBO this is the offset within the buffer.
     void* data = 0;
 
-    glBindTexture(GL_TEXTURE_2D, tb.tex_object);
+    glBindTexture(GL_TEXTURE_2D, tb->tex_object);
     GLERRPRINT("After bind texture");
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, glformat, gltype,
-                    data);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, m_glformat,
+                    m_gltype, data);
     GLERRPRINT("After loading sub image");
-    m_last_texbuf_used = (m_last_texbuf_used + 1) % m_texbufs.size();
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // The pixels live in the texture now.
+    m_tile_reads.erase(
+        std::find(m_tile_reads.begin(), m_tile_reads.end(), read));
+    return tb;
+}
+
+
+
+IvGL::TexBuffer*
+IvGL::recycle_texbuf()
+{
+    TexBuffer* oldest = NULL;
+    for (auto&& tb : m_texbufs) {
+        if (tb.last_used == m_frame)
+            continue;  // Already drawn this frame, don't clobber it
+        if (!tb.width)
+            return &tb;
+        if (!oldest || tb.last_used < oldest->last_used)
+            oldest = &tb;
+    }
+    if (oldest || int(m_texbufs.size()) >= m_max_texbufs)
+        return oldest;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0 /*mip level*/, m_glinternalformat,
+                 m_texture_width, m_texture_height, 0 /*border width*/,
+                 m_glformat, m_gltype, NULL /*data*/);
+    GLERRPRINT("Setting up texture");
+    GLint filter = (m_use_shaders || m_viewer.linearInterpolation())
+                       ? GL_LINEAR
+                       : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    m_texbufs.emplace_back();
+    TexBuffer& tb(m_texbufs.back());
+    tb.tex_object = texture;
+    tb.x          = 0;
+    tb.y          = 0;
+    tb.width      = 0;
+    tb.height     = 0;
+    tb.miplevel   = -1;
+    tb.last_used  = 0;
+    return &tb;
+}
+
+
+
+void
+IvGL::draw_texbuf(TexBuffer& tb, float xmin, float ymin, float xmax,
+                  float ymax)
+{
+    // Texture coordinates per unit of the viewed level.
+    float sscale = tb.width / (float(m_texture_width) * (tb.xmax - tb.xmin));
+    float tscale = tb.height
+                   / (float(m_texture_height) * (tb.ymax - tb.ymin));
+    glBindTexture(GL_TEXTURE_2D, tb.tex_object);
+    gl_rect(xmin, ymin, xmax, ymax, 0, (xmin - tb.xmin) * sscale,
+            (ymin - tb.ymin) * tscale, (xmax - tb.xmin) * sscale,
+            (ymax - tb.ymin) * tscale);
+    tb.last_used = m_frame;
+}
+
+
+
+void
+IvGL::cancel_tile_reads()
+{
+    for (auto&& r : m_tile_reads)
+        r->cancelled = true;
+    m_tile_reads.clear();
 }
 
 
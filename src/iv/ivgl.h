@@ -44,6 +44,8 @@
 // included to remove std::min/std::max errors
 #include <OpenImageIO/platform.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include <QOpenGLFunctions>
@@ -51,6 +53,7 @@
 
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/thread.h>
 
 using namespace OIIO;
 
@@ -116,14 +119,23 @@ public:
     ///
     bool is_half_capable(void) const { return m_use_halffloat; }
 
+    /// Do the textures hold all the channels of the current image, so
+    /// that the shader can show any of them, in any color mode, without
+    /// uploading the image again?
+    bool has_all_channels(void) const;
+
     /// Returns true if the image is too big to fit within allocated textures
     /// (i.e., it's recommended to use lower resolution versions when zoomed out).
     bool is_too_big(float width, float height);
 
-    void typespec_to_opengl(const ImageSpec& spec, int nchannels,
-                            GLenum& gltype, GLenum& glformat,
+    void typespec_to_opengl(const ImageSpec& spec, TypeDesc format,
+                            int nchannels, GLenum& gltype, GLenum& glformat,
                             GLenum& glinternal) const;
 
+signals:
+    /// Emitted, from a reader thread, when a tile read has finished.
+    void tile_read_done();
+
 protected:
     ImageViewer& m_viewer;          ///< Backpointer to viewer
     bool m_shaders_created;         ///< Have the shaders been created?
@@ -149,21 +161,42 @@ protected:
     IvImage* m_current_image;      ///< Image to show on screen.
     GLuint m_pixelview_tex;        ///< Pixelview's own texture.
     bool m_pixelview_left_corner;  ///< Draw pixelview in upper left or right
-    /// Buffer passed to IvImage::copy_image when not using PBO.
-    ///
-    std::vector<unsigned char> m_tex_buffer;
 
-    /// Represents a texture object being used as a buffer.
-    ///
+    /// Represents a texture object being used as a buffer, holding one
+    /// tile of one MIP level of the image.
     struct TexBuffer {
         GLuint tex_object;
-        int x;
-        int y;
+        int x;             ///< Tile origin and size, in the pixel
+        int y;             ///<   coordinates of its MIP level
         int width;
         int height;
+        int miplevel;      ///< MIP level the pixels came from
+        float xmin, ymin;  ///< Area of the image it covers, in the
+        float xmax, ymax;  ///<   coordinates of the viewed level
+        unsigned int last_used;  ///< Last frame that drew it
     };
     std::vector<TexBuffer> m_texbufs;
-    int m_last_texbuf_used;
+    int m_max_texbufs;         ///< How many texbufs we may create
+    unsigned int m_frame;      ///< Count of painted frames
+    GLenum m_gltype;           ///< Pixel type of the texbufs' data
+    GLenum m_glformat;         ///< Pixel format of the texbufs' data
+    GLenum m_glinternalformat; ///< Internal format of the texbufs
+    TypeDesc m_tex_format;     ///< Data format of the texbufs' pixels
+    int m_tex_chbegin;         ///< First image channel in the texbufs
+    int m_tex_nchannels;       ///< Number of channels in the texbufs
+
+    /// A tile of the image being read by a background thread, which
+    /// paintGL uploads to a texture buffer once it's done.
+    struct TileRead {
+        int x, y, width, height, miplevel;
+        unsigned int last_wanted;  ///< Last frame that needed it
+        std::atomic<bool> cancelled { false };
+        std::atomic<bool> done { false };
+        bool ok = false;
+        std::vector<unsigned char> pixels;
+    };
+    std::vector<std::shared_ptr<TileRead>> m_tile_reads;
+    std::unique_ptr<thread_pool> m_tile_reader;  ///< Background readers
     bool m_mouse_activation;  ///< Can we expect the window to be activated by mouse?
 
 
@@ -214,9 +247,28 @@ private:
     ///
     void print_shader_log(std::ostream& out, const GLuint shader_id);
 
-    /// Loads the given patch of the image, but first figures if it's already
-    /// been loaded.
-    void load_texture(int x, int y, int width, int height, float percent);
+    /// Which MIP level of the current image is the best to draw at the
+    /// current zoom?
+    int display_miplevel(IvImage* img) const;
+
+    /// Find the texbuf holding the given tile of the given MIP level,
+    /// uploading it if it has been read, or else start reading it.
+    /// Return NULL if the tile isn't available yet.
+    TexBuffer* load_texture(int x, int y, int width, int height, int miplevel,
+                            float xmin, float ymin, float xmax, float ymax);
+
+    /// Return a texbuf not yet drawn in this frame (the least recently
+    /// used, or a new one while there are fewer than m_max_texbufs), or
+    /// NULL if there is none.
+    TexBuffer* recycle_texbuf();
+
+    /// Draw the part of texbuf tb covering [xmin,xmax) x [ymin,ymax), in
+    /// the coordinates of the viewed level.
+    void draw_texbuf(TexBuffer& tb, float xmin, float ymin, float xmax,
+                     float ymax);
+
+    /// Cancel all tile reads, and forget those already done.
+    void cancel_tile_reads();
 
     /// Destroys shaders and selects fixed-function pipeline
     void create_shaders_abort(void);
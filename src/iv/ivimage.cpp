@@ -45,6 +45,7 @@ IvImage::IvImage(const std::string& filename)
     , m_gamma(1)
     , m_exposure(0)
     , m_file_dataformat(TypeDesc::UNKNOWN)
+    , m_display_format(TypeDesc::UNKNOWN)
     , m_image_valid(false)
     , m_auto_subimage(false)
 {
@@ -95,6 +96,15 @@ IvImage::read_iv(int subimage, int miplevel, bool force, TypeDesc format,
         && miplevel != this->miplevel())
         return true;
 
+    // Unless the pixels will be transformed on the CPU, leave them in the
+    // ImageCache, from which the display reads just the patches and MIP
+    // levels it shows, converting them to the requested format as it
+    // goes. Reading with a format would convert the whole image into
+    // memory first.
+    m_display_format = format;
+    if (!secondary_data)
+        format = TypeDesc::UNKNOWN;
+
     m_image_valid = init_spec_iv(name(), subimage, miplevel);
     if (m_image_valid)
         m_image_valid = ImageBuf::read(subimage, miplevel, force, format,
@@ -61,11 +61,16 @@ IvPreferenceWindow::IvPreferenceWindow(ImageViewer& viewer)
     inner_layout->addWidget(viewer.maxMemoryICLabel);
     inner_layout->addWidget(viewer.maxMemoryIC);
 
+    QLayout* prefetchLayout = new QHBoxLayout;
+    prefetchLayout->addWidget(viewer.prefetchImagesLabel);
+    prefetchLayout->addWidget(viewer.prefetchImages);
+
     QLayout* slideShowLayout = new QHBoxLayout;
     slideShowLayout->addWidget(viewer.slideShowDurationLabel);
     slideShowLayout->addWidget(viewer.slideShowDuration);
 
     layout->addLayout(inner_layout);
+    layout->addLayout(prefetchLayout);
     layout->addLayout(slideShowLayout);
     layout->addWidget(closeButton);
     setLayout(layout);
@@ -37,6 +37,10 @@
 #pragma once
 
 #include <csetjmp>
+#include <memory>
+
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/tiffutils.h>
 
 #ifdef WIN32
 #    undef FAR
@@ -75,7 +79,8 @@ public:
     virtual const char* format_name(void) const override { return "jpeg"; }
     virtual int supports(string_view feature) const override
     {
-        return (feature == "exif" || feature == "iptc");
+        return (feature == "exif" || feature == "iptc"
+                || feature == "ioproxy");
     }
     virtual bool valid_file(const std::string& filename) const override;
     virtual bool open(const std::string& name, ImageSpec& spec) override;
@@ -83,6 +88,8 @@ public:
                       const ImageSpec& config) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
     virtual bool close() override;
     const std::string& filename() const { return m_filename; }
     void* coeffs() const { return m_coeffs; }
@@ -97,12 +104,16 @@ public:
     void jpegerror(my_error_ptr myerr, bool fatal = false);
 
 private:
-    FILE* m_fd;
+    Filesystem::IOProxy* m_io;  // Where we read from (owned or not)
+    std::unique_ptr<Filesystem::IOProxy> m_local_io;  // Owned, if we opened it
     std::string m_filename;
-    int m_next_scanline;  // Which scanline is the next to read?
-    bool m_raw;           // Read raw coefficients, not scanlines
-    bool m_cmyk;          // The input file is cmyk
-    bool m_fatalerr;      // JPEG reader hit a fatal error
+    int m_next_scanline;      // Which scanline is the next to read?
+    bool m_raw;               // Read raw coefficients, not scanlines
+    int m_scale;              // Decode at 1/m_scale resolution (1, 2, 4, 8)
+    bool m_fastdecode;        // Trade some quality for decode speed
+    MetadataHint m_metadata;  // How to treat Exif/XMP/IPTC blocks
+    bool m_cmyk;              // The input file is cmyk
+    bool m_fatalerr;          // JPEG reader hit a fatal error
     struct jpeg_decompress_struct m_cinfo;
     my_error_mgr m_jerr;
     jvirt_barray_ptr* m_coeffs;
@@ -110,8 +121,11 @@ private:
 
     void init()
     {
-        m_fd            = NULL;
+        m_io            = nullptr;
         m_raw           = false;
+        m_scale         = 1;
+        m_fastdecode    = false;
+        m_metadata      = MetadataHint::Full;
         m_cmyk          = false;
         m_fatalerr      = false;
         m_coeffs        = NULL;
@@ -127,10 +141,13 @@ private:
 
     bool read_icc_profile(j_decompress_ptr cinfo, ImageSpec& spec);
 
+    // Close and re-open the file (with the same decode settings) so that
+    // scanlines can be read from the top again.
+    bool reopen();
+
     void close_file()
     {
-        if (m_fd)
-            fclose(m_fd);  // N.B. the init() will set m_fd to NULL
+        m_local_io.reset();  // N.B. the init() will set m_io to nullptr
         init();
     }
 
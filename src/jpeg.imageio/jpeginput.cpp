@@ -40,6 +40,10 @@
 
 #include "jpeg_pvt.h"
 
+extern "C" {
+#include "jerror.h"
+}
+
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
 
@@ -118,6 +122,91 @@ my_output_message(j_common_ptr cinfo)
 
 
 
+// libjpeg data source that pulls from a Filesystem::IOProxy, so that
+// JPEG files may be read from memory or any other proxy as well as from
+// disk. Modeled on jpeg_stdio_src in the libjpeg distribution.
+struct IOProxySourceMgr {
+    struct jpeg_source_mgr pub;
+    Filesystem::IOProxy* io;
+    JOCTET buffer[4096];
+};
+
+
+
+static void
+proxy_init_source(j_decompress_ptr /*cinfo*/)
+{
+}
+
+
+
+static boolean
+proxy_fill_input_buffer(j_decompress_ptr cinfo)
+{
+    IOProxySourceMgr* src = (IOProxySourceMgr*)cinfo->src;
+    size_t nbytes         = src->io->read(src->buffer, sizeof(src->buffer));
+    if (nbytes == 0) {
+        // Premature end of file: insert a fake EOI marker, as the stdio
+        // source manager does, so that libjpeg emits a warning rather
+        // than hanging or crashing.
+        WARNMS(cinfo, JWRN_JPEG_EOF);
+        src->buffer[0] = (JOCTET)0xFF;
+        src->buffer[1] = (JOCTET)JPEG_EOI;
+        nbytes         = 2;
+    }
+    src->pub.next_input_byte = src->buffer;
+    src->pub.bytes_in_buffer = nbytes;
+    return TRUE;
+}
+
+
+
+static void
+proxy_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
+{
+    IOProxySourceMgr* src = (IOProxySourceMgr*)cinfo->src;
+    if (num_bytes <= 0)
+        return;
+    if (size_t(num_bytes) <= src->pub.bytes_in_buffer) {
+        src->pub.next_input_byte += num_bytes;
+        src->pub.bytes_in_buffer -= num_bytes;
+        return;
+    }
+    // Skip past what's buffered by seeking the proxy directly.
+    num_bytes -= long(src->pub.bytes_in_buffer);
+    src->pub.bytes_in_buffer = 0;
+    src->io->seek(src->io->tell() + num_bytes);
+}
+
+
+
+static void
+proxy_term_source(j_decompress_ptr /*cinfo*/)
+{
+}
+
+
+
+static void
+jpeg_ioproxy_src(j_decompress_ptr cinfo, Filesystem::IOProxy* io)
+{
+    if (!cinfo->src) {
+        cinfo->src = (struct jpeg_source_mgr*)(*cinfo->mem->alloc_small)(
+            (j_common_ptr)cinfo, JPOOL_PERMANENT, sizeof(IOProxySourceMgr));
+    }
+    IOProxySourceMgr* src      = (IOProxySourceMgr*)cinfo->src;
+    src->io                    = io;
+    src->pub.init_source       = proxy_init_source;
+    src->pub.fill_input_buffer = proxy_fill_input_buffer;
+    src->pub.skip_input_data   = proxy_skip_input_data;
+    src->pub.resync_to_restart = jpeg_resync_to_restart;
+    src->pub.term_source       = proxy_term_source;
+    src->pub.bytes_in_buffer   = 0;
+    src->pub.next_input_byte   = nullptr;
+}
+
+
+
 static std::string
 comp_info_to_attr(const jpeg_decompress_struct& cinfo)
 {
@@ -189,6 +278,16 @@ JpgInput::open(const std::string& name, ImageSpec& newspec,
 {
     const ParamValue* p = config.find_attribute("_jpeg:raw", TypeInt);
     m_raw               = p && *(int*)p->data();
+    // libjpeg can decode directly at 1/2, 1/4 or 1/8 size, skipping most
+    // of the IDCT work, for callers who only want a reduced image.
+    int scale = config.get_int_attribute("jpeg:scale", 1);
+    m_scale   = scale >= 8 ? 8 : scale >= 4 ? 4 : scale >= 2 ? 2 : 1;
+    m_fastdecode = config.get_int_attribute("jpeg:fastdecode", 0) != 0;
+    m_metadata   = metadata_hint(config);
+    // A caller-supplied IOProxy lets us read from memory or elsewhere.
+    p = config.find_attribute("oiio:ioproxy", TypeDesc::PTR);
+    if (p)
+        m_io = p->get<Filesystem::IOProxy*>();
     return open(name, newspec);
 }
 
@@ -199,21 +298,27 @@ JpgInput::open(const std::string& name, ImageSpec& newspec)
 {
     // Check that file exists and can be opened
     m_filename = name;
-    m_fd       = Filesystem::fopen(name, "rb");
-    if (m_fd == NULL) {
+    if (!m_io) {
+        m_local_io.reset(
+            new Filesystem::IOFile(name, Filesystem::IOProxy::Read));
+        m_io = m_local_io.get();
+    }
+    if (!m_io->opened()) {
         error("Could not open file \"%s\"", name.c_str());
+        close_file();
         return false;
     }
 
     // Check magic number to assure this is a JPEG file
     uint8_t magic[2] = { 0, 0 };
-    if (fread(magic, sizeof(magic), 1, m_fd) != 1) {
+    m_io->seek(0);
+    if (m_io->read(magic, sizeof(magic)) != sizeof(magic)) {
         error("Empty file \"%s\"", name.c_str());
         close_file();
         return false;
     }
 
-    rewind(m_fd);
+    m_io->seek(0);
     if (magic[0] != JPEG_MAGIC1 || magic[1] != JPEG_MAGIC2) {
         close_file();
         error(
@@ -236,7 +341,7 @@ JpgInput::open(const std::string& name, ImageSpec& newspec)
     }
 
     jpeg_create_decompress(&m_cinfo);  // initialize decompressor
-    jpeg_stdio_src(&m_cinfo, m_fd);    // specify the data source
+    jpeg_ioproxy_src(&m_cinfo, m_io);  // specify the data source
 
     // Request saving of EXIF and other special tags for later spelunking
     for (int mark = 0; mark < 16; ++mark)
@@ -259,10 +364,17 @@ JpgInput::open(const std::string& name, ImageSpec& newspec)
         m_cmyk                  = true;
     }
 
-    if (m_raw)
+    if (m_raw) {
         m_coeffs = jpeg_read_coefficients(&m_cinfo);
-    else
+    } else {
+        m_cinfo.scale_num   = 1;
+        m_cinfo.scale_denom = m_scale;
+        if (m_fastdecode) {
+            m_cinfo.dct_method          = JDCT_IFAST;
+            m_cinfo.do_fancy_upsampling = FALSE;
+        }
         jpeg_start_decompress(&m_cinfo);  // start working
+    }
     if (m_fatalerr)
         return false;
     m_next_scanline = 0;  // next scanline we'll read
@@ -291,15 +403,15 @@ JpgInput::open(const std::string& name, ImageSpec& newspec)
             // The block starts with "Exif\0\0", so skip 6 bytes to get
             // to the start of the actual Exif data TIFF directory
             decode_exif(string_view((char*)m->data + 6, m->data_length - 6),
-                        m_spec);
+                        m_spec, m_metadata);
         } else if (m->marker == (JPEG_APP0 + 1)
                    && !strcmp((const char*)m->data,
                               "http://ns.adobe.com/xap/1.0/")) {
 #ifndef NDEBUG
             std::cerr << "Found APP1 XMP! length " << m->data_length << "\n";
 #endif
-            std::string xml((const char*)m->data, m->data_length);
-            decode_xmp(xml, m_spec);
+            decode_xmp(string_view((const char*)m->data, m->data_length),
+                       m_spec, m_metadata);
         } else if (m->marker == (JPEG_APP0 + 13)
                    && !strcmp((const char*)m->data, "Photoshop 3.0"))
             jpeg_decode_iptc((unsigned char*)m->data);
@@ -438,12 +550,8 @@ JpgInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (m_next_scanline > y) {
         // User is trying to read an earlier scanline than the one we're
         // up to.  Easy fix: close the file and re-open.
-        ImageSpec dummyspec;
-        int subimage = current_subimage();
-        if (!close() || !open(m_filename, dummyspec)
-            || !seek_subimage(subimage, 0))
-            return false;  // Somehow, the re-open failed
-        assert(m_next_scanline == 0 && current_subimage() == subimage);
+        if (!reopen())
+            return false;
     }
 
     // Set up our custom error handler
@@ -479,10 +587,99 @@ JpgInput::read_native_scanline(int subimage, int miplevel, int y, int z,
 
 
 
+bool
+JpgInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    if (m_raw)
+        return false;
+    yend = std::min(yend, (int)m_cinfo.output_height);
+    if (ybegin < 0 || ybegin > yend)  // out of range scanlines
+        return false;
+    if (ybegin == yend)
+        return true;
+    if (m_next_scanline > ybegin && !reopen())
+        return false;
+
+    // Hand libjpeg pointers to all the rows at once, so it can decode as
+    // many as it likes per call rather than one row per call. CMYK files
+    // are read into a 4-channel buffer and converted afterwards.
+    int nrows       = yend - ybegin;
+    size_t rowbytes = size_t(m_spec.width) * (m_cmyk ? 4 : m_spec.nchannels);
+    if (m_cmyk)
+        m_cmyk_buf.resize(nrows * rowbytes);
+    unsigned char* readdata = m_cmyk ? &m_cmyk_buf[0] : (unsigned char*)data;
+    std::vector<JSAMPROW> rows(nrows);
+    for (int i = 0; i < nrows; ++i)
+        rows[i] = readdata + i * rowbytes;
+
+    // Set up our custom error handler
+    if (setjmp(m_jerr.setjmp_buffer)) {
+        // Jump to here if there's a libjpeg internal error
+        return false;
+    }
+
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) \
+    && LIBJPEG_TURBO_VERSION_NUMBER >= 1005000
+    // libjpeg-turbo can skip ahead without color converting or
+    // upsampling the rows in between.
+    if (m_next_scanline < ybegin)
+        m_next_scanline += jpeg_skip_scanlines(&m_cinfo,
+                                               ybegin - m_next_scanline);
+#endif
+    while (m_next_scanline < yend) {
+        // Rows before ybegin are decoded into the first row, which the
+        // real data will overwrite.
+        int first = std::max(m_next_scanline - ybegin, 0);
+        int n     = m_next_scanline < ybegin ? 1 : yend - m_next_scanline;
+        int got   = jpeg_read_scanlines(&m_cinfo, &rows[first], n);
+        if (got <= 0 || m_fatalerr) {
+            error("JPEG failed scanline read (\"%s\")", filename().c_str());
+            return false;
+        }
+        m_next_scanline += got;
+    }
+
+    if (m_cmyk)
+        cmyk_to_rgb(m_spec.width * nrows, readdata, 4, (unsigned char*)data,
+                    3);
+    return true;
+}
+
+
+
+bool
+JpgInput::reopen()
+{
+    ImageSpec dummyspec;
+    int subimage          = current_subimage();
+    int scale             = m_scale;
+    bool fastdecode       = m_fastdecode;
+    MetadataHint metadata = m_metadata;
+    // A caller's proxy outlives us, so keep reading from it; our own
+    // file is simply reopened by name.
+    Filesystem::IOProxy* io = m_local_io ? nullptr : m_io;
+    if (!close())
+        return false;
+    m_scale      = scale;  // close() reset these
+    m_fastdecode = fastdecode;
+    m_metadata   = metadata;
+    m_io         = io;
+    if (!open(m_filename, dummyspec) || !seek_subimage(subimage, 0))
+        return false;  // Somehow, the re-open failed
+    assert(m_next_scanline == 0 && current_subimage() == subimage);
+    return true;
+}
+
+
+
 bool
 JpgInput::close()
 {
-    if (m_fd != NULL) {
+    if (m_io) {
         // unnecessary?  jpeg_abort_decompress (&m_cinfo);
         jpeg_destroy_decompress(&m_cinfo);
         close_file();
@@ -520,7 +717,7 @@ JpgInput::jpeg_decode_iptc(const unsigned char* buf)
     int segmentsize = (buf[0] << 8) + buf[1];
     buf += 2;
 
-    decode_iptc_iim(buf, segmentsize, m_spec);
+    decode_iptc_iim(buf, segmentsize, m_spec, m_metadata);
 }
 
 OIIO_PLUGIN_NAMESPACE_END
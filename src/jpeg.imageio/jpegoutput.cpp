@@ -39,6 +39,10 @@
 
 #include "jpeg_pvt.h"
 
+extern "C" {
+#include "jerror.h"
+}
+
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
 #define DBG if (0)
@@ -52,6 +56,72 @@ OIIO_PLUGIN_NAMESPACE_BEGIN
 
 
 
+// libjpeg data destination that pushes to a Filesystem::IOProxy, so that
+// JPEG files may be written to memory as well as to disk. Modeled on
+// jpeg_stdio_dest in the libjpeg distribution.
+struct IOProxyDestMgr {
+    struct jpeg_destination_mgr pub;
+    Filesystem::IOProxy* io;
+    JOCTET buffer[4096];
+};
+
+
+
+static void
+proxy_init_destination(j_compress_ptr cinfo)
+{
+    IOProxyDestMgr* dest       = (IOProxyDestMgr*)cinfo->dest;
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer   = sizeof(dest->buffer);
+}
+
+
+
+static boolean
+proxy_empty_output_buffer(j_compress_ptr cinfo)
+{
+    // N.B. libjpeg requires the whole buffer be dumped here, regardless of
+    // free_in_buffer.
+    IOProxyDestMgr* dest = (IOProxyDestMgr*)cinfo->dest;
+    if (dest->io->write(dest->buffer, sizeof(dest->buffer))
+        != sizeof(dest->buffer))
+        ERREXIT(cinfo, JERR_FILE_WRITE);
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer   = sizeof(dest->buffer);
+    return TRUE;
+}
+
+
+
+static void
+proxy_term_destination(j_compress_ptr cinfo)
+{
+    IOProxyDestMgr* dest = (IOProxyDestMgr*)cinfo->dest;
+    size_t n             = sizeof(dest->buffer) - dest->pub.free_in_buffer;
+    if (n && dest->io->write(dest->buffer, n) != n)
+        ERREXIT(cinfo, JERR_FILE_WRITE);
+}
+
+
+
+static void
+jpeg_ioproxy_dest(j_compress_ptr cinfo, Filesystem::IOProxy* io)
+{
+    if (!cinfo->dest) {
+        void* mem   = (*cinfo->mem->alloc_small)((j_common_ptr)cinfo,
+                                               JPOOL_PERMANENT,
+                                               sizeof(IOProxyDestMgr));
+        cinfo->dest = (struct jpeg_destination_mgr*)mem;
+    }
+    IOProxyDestMgr* dest          = (IOProxyDestMgr*)cinfo->dest;
+    dest->io                      = io;
+    dest->pub.init_destination    = proxy_init_destination;
+    dest->pub.empty_output_buffer = proxy_empty_output_buffer;
+    dest->pub.term_destination    = proxy_term_destination;
+}
+
+
+
 class JpgOutput final : public ImageOutput {
 public:
     JpgOutput() { init(); }
@@ -59,7 +129,8 @@ public:
     virtual const char* format_name(void) const override { return "jpeg"; }
     virtual int supports(string_view feature) const override
     {
-        return (feature == "exif" || feature == "iptc");
+        return (feature == "exif" || feature == "iptc"
+                || feature == "ioproxy");
     }
     virtual bool open(const std::string& name, const ImageSpec& spec,
                       OpenMode mode = Create) override;
@@ -72,7 +143,8 @@ public:
     virtual bool copy_image(ImageInput* in) override;
 
 private:
-    FILE* m_fd;
+    Filesystem::IOProxy* m_io;  // Where we write to (owned or not)
+    std::unique_ptr<Filesystem::IOProxy> m_local_io;  // Owned, if we opened it
     std::string m_filename;
     unsigned int m_dither;
     int m_next_scanline;  // Which scanline is the next to write?
@@ -85,7 +157,7 @@ private:
 
     void init(void)
     {
-        m_fd                = NULL;
+        m_io                = nullptr;
         m_copy_coeffs       = NULL;
         m_copy_decompressor = NULL;
     }
@@ -149,15 +221,26 @@ JpgOutput::open(const std::string& name, const ImageSpec& newspec,
         return false;
     }
 
-    m_fd = Filesystem::fopen(name, "wb");
-    if (m_fd == NULL) {
+    // See if we were requested to write to a memory buffer or other
+    // proxy, and if not, open the file ourselves.
+    const ParamValue* param = m_spec.find_attribute("oiio:ioproxy",
+                                                    TypeDesc::PTR);
+    m_io = param ? param->get<Filesystem::IOProxy*>() : nullptr;
+    if (!m_io) {
+        m_local_io.reset(
+            new Filesystem::IOFile(name, Filesystem::IOProxy::Write));
+        m_io = m_local_io.get();
+    }
+    if (!m_io->opened()) {
         error("Unable to open file \"%s\"", name.c_str());
+        m_local_io.reset();
+        init();
         return false;
     }
 
     m_cinfo.err = jpeg_std_error(&c_jerr);  // set error handler
     jpeg_create_compress(&m_cinfo);         // create compressor
-    jpeg_stdio_dest(&m_cinfo, m_fd);        // set output stream
+    jpeg_ioproxy_dest(&m_cinfo, m_io);      // set output stream
 
     // Set image and compression parameters
     m_cinfo.image_width  = m_spec.width;
@@ -419,7 +502,7 @@ JpgOutput::write_tile(int x, int y, int z, TypeDesc format, const void* data,
 bool
 JpgOutput::close()
 {
-    if (!m_fd) {  // Already closed
+    if (!m_io) {  // Already closed
         return true;
         init();
     }
@@ -457,8 +540,7 @@ JpgOutput::close()
     }
     DBG std::cout << "out close: about to destroy_compress\n";
     jpeg_destroy_compress(&m_cinfo);
-    fclose(m_fd);
-    m_fd = NULL;
+    m_local_io.reset();
     init();
 
     return ok;
@@ -99,6 +99,16 @@ associateAlpha(T* data, int size, int channels, int alpha_channel, float gamma)
 }  // namespace
 
 
+// OpenJpeg 2.1 added codestream info queries (which tell us how many
+// resolution levels there are), and 2.2 added multithreaded decoding.
+#if defined(OPJ_VERSION_MAJOR)
+#    define OPJ_HAS_CSTR_INFO 1
+#    if OPJ_VERSION_MAJOR > 2 || OPJ_VERSION_MINOR >= 2
+#        define OPJ_HAS_THREADS 1
+#    endif
+#endif
+
+
 class Jpeg2000Input final : public ImageInput {
 public:
     Jpeg2000Input() { init(); }
@@ -113,6 +123,8 @@ public:
     virtual bool open(const std::string& name, ImageSpec& newspec,
                       const ImageSpec& config) override;
     virtual bool close(void) override;
+    virtual int current_miplevel(void) const override { return m_miplevel; }
+    virtual bool seek_subimage(int subimage, int miplevel) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
 
@@ -124,9 +136,20 @@ private:
     opj_codec_t* m_codec;
     opj_stream_t* m_stream;
     bool m_keep_unassociated_alpha;  // Do not convert unassociated alpha
+    // Each of the codestream's resolution levels is presented as a MIP
+    // level. Only one level is decoded at a time, and only when its pixels
+    // are first needed.
+    std::vector<ImageSpec> m_levelspecs;
+    int m_miplevel;
+    int m_decoded_level;  // Level whose pixels m_image holds, or -1
 
     void init(void);
 
+    // Set up m_codec and m_stream and read the header into m_image.
+    bool open_codestream();
+    // Decode the pixels of one resolution level into m_image.
+    bool decode_level(int miplevel);
+
     bool isJp2File(const int* const p_magicTable) const;
 
     opj_codec_t* create_decompressor();
@@ -204,6 +227,9 @@ Jpeg2000Input::init(void)
     m_codec                   = NULL;
     m_stream                  = NULL;
     m_keep_unassociated_alpha = false;
+    m_levelspecs.clear();
+    m_miplevel      = 0;
+    m_decoded_level = -1;
 }
 
 
@@ -216,41 +242,22 @@ Jpeg2000Input::open(const std::string& p_name, ImageSpec& p_spec)
         return false;
     }
 
-    m_codec = create_decompressor();
-    if (!m_codec) {
-        error("Could not create Jpeg2000 stream decompressor");
-        close();
-        return false;
-    }
-
-    setup_event_mgr(m_codec);
-
-    opj_dparameters_t parameters;
-    opj_set_default_decoder_parameters(&parameters);
-    opj_setup_decoder(m_codec, &parameters);
-
-#if defined(OPJ_VERSION_MAJOR)
-    // OpenJpeg >= 2.1
-    m_stream = opj_stream_create_default_file_stream(m_filename.c_str(), true);
-#else
-    // OpenJpeg 2.0: need to open a stream ourselves
-    m_file   = Filesystem::fopen(m_filename, "rb");
-    m_stream = opj_stream_create_default_file_stream(m_file, true);
-#endif
-    if (!m_stream) {
-        error("Could not open Jpeg2000 stream");
-        close();
-        return false;
-    }
-
+    // Just read the header for now; the pixels are decoded when needed,
+    // at whatever resolution level is asked for.
     ASSERT(m_image == NULL);
-    if (!opj_read_header(m_stream, m_codec, &m_image)) {
-        error("Could not read Jpeg2000 header");
+    if (!open_codestream()) {
         close();
         return false;
     }
-    opj_decode(m_codec, m_stream, m_image);
-
+    int nlevels = 1;
+#ifdef OPJ_HAS_CSTR_INFO
+    if (opj_codestream_info_v2_t* info = opj_get_cstr_info(m_codec)) {
+        if (info->m_default_tile_info.tccp_info)
+            nlevels = std::max(
+                1, int(info->m_default_tile_info.tccp_info[0].numresolutions));
+        opj_destroy_cstr_info(&info);
+    }
+#endif
     destroy_decompressor();
     destroy_stream();
 
@@ -311,6 +318,33 @@ Jpeg2000Input::open(const std::string& p_name, ImageSpec& p_spec)
                          m_image->icc_profile_buf);
 #endif
 
+    // Resolution level r halves the reference grid r times, rounding up.
+    m_levelspecs.assign(1, m_spec);
+    for (int r = 1; r < nlevels; ++r) {
+        auto reduce = [=](int v) { return (v + (1 << r) - 1) >> r; };
+        ROI levelwindow;
+        for (int i = 0; i < channelCount; i++) {
+            const opj_image_comp_t& comp(m_image->comps[i]);
+            ROI roichan(reduce(comp.x0), reduce(comp.x0 + comp.w * comp.dx),
+                        reduce(comp.y0), reduce(comp.y0 + comp.h * comp.dy));
+            levelwindow = roi_union(levelwindow, roichan);
+        }
+        // Don't bother with levels that would shrink away to nothing.
+        if (levelwindow.width() < 1 || levelwindow.height() < 1)
+            break;
+        ImageSpec spec   = m_spec;
+        spec.x           = levelwindow.xbegin;
+        spec.y           = levelwindow.ybegin;
+        spec.width       = levelwindow.width();
+        spec.height      = levelwindow.height();
+        spec.full_x      = reduce(m_image->x0);
+        spec.full_y      = reduce(m_image->y0);
+        spec.full_width  = reduce(m_image->x1);
+        spec.full_height = reduce(m_image->y1);
+        m_levelspecs.push_back(spec);
+    }
+    m_miplevel = 0;
+
     p_spec = m_spec;
     return true;
 }
@@ -328,6 +362,92 @@ Jpeg2000Input::open(const std::string& name, ImageSpec& newspec,
 }
 
 
+bool
+Jpeg2000Input::seek_subimage(int subimage, int miplevel)
+{
+    if (subimage != 0 || miplevel < 0 || miplevel >= int(m_levelspecs.size()))
+        return false;
+    if (miplevel != m_miplevel) {
+        m_miplevel = miplevel;
+        m_spec     = m_levelspecs[miplevel];
+    }
+    return true;
+}
+
+
+
+bool
+Jpeg2000Input::open_codestream()
+{
+    m_codec = create_decompressor();
+    if (!m_codec) {
+        error("Could not create Jpeg2000 stream decompressor");
+        return false;
+    }
+
+    setup_event_mgr(m_codec);
+
+    opj_dparameters_t parameters;
+    opj_set_default_decoder_parameters(&parameters);
+    opj_setup_decoder(m_codec, &parameters);
+
+#if defined(OPJ_VERSION_MAJOR)
+    // OpenJpeg >= 2.1
+    m_stream = opj_stream_create_default_file_stream(m_filename.c_str(), true);
+#else
+    // OpenJpeg 2.0: need to open a stream ourselves
+    if (m_file)
+        fclose(m_file);
+    m_file   = Filesystem::fopen(m_filename, "rb");
+    m_stream = opj_stream_create_default_file_stream(m_file, true);
+#endif
+    if (!m_stream) {
+        error("Could not open Jpeg2000 stream");
+        return false;
+    }
+
+    if (!opj_read_header(m_stream, m_codec, &m_image)) {
+        error("Could not read Jpeg2000 header");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+Jpeg2000Input::decode_level(int miplevel)
+{
+    // A codec can only decode once, so start over with a fresh one (and a
+    // fresh header to decode into).
+    if (m_image) {
+        opj_image_destroy(m_image);
+        m_image = NULL;
+    }
+    m_decoded_level = -1;
+    bool ok         = open_codestream();
+    if (ok && miplevel > 0
+        && !opj_set_decoded_resolution_factor(m_codec, miplevel)) {
+        error("Could not decode Jpeg2000 resolution level %d", miplevel);
+        ok = false;
+    }
+    if (ok) {
+#ifdef OPJ_HAS_THREADS
+        int nthreads = threads() ? threads()
+                                 : OIIO::get_int_attribute("threads");
+        if (nthreads > 1)
+            opj_codec_set_threads(m_codec, nthreads);
+#endif
+        opj_decode(m_codec, m_stream, m_image);
+        m_decoded_level = miplevel;
+    }
+    destroy_decompressor();
+    destroy_stream();
+    return ok;
+}
+
+
+
 bool
 Jpeg2000Input::read_native_scanline(int subimage, int miplevel, int y, int z,
                                     void* data)
@@ -336,6 +456,9 @@ Jpeg2000Input::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (!seek_subimage(subimage, miplevel))
         return false;
 
+    if (m_decoded_level != m_miplevel && !decode_level(m_miplevel))
+        return false;
+
     if (m_spec.format == TypeDesc::UINT8)
         read_scanline<uint8_t>(y, z, data);
     else
@@ -371,6 +494,7 @@ Jpeg2000Input::close(void)
         fclose(m_file);
         m_file = NULL;
     }
+    init();
     return true;
 }
 
@@ -29,15 +29,18 @@
 */
 
 #include <cmath>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-#include <boost/container/flat_map.hpp>
 
 #include <OpenEXR/half.h>
 
 #include <OpenImageIO/color.h>
+#include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/strutil.h>
@@ -54,7 +57,10 @@ namespace OCIO = OCIO_NAMESPACE;
 OIIO_NAMESPACE_BEGIN
 
 
-// Class used as the key to index color processors in the cache.
+// Class used as the key to index color processors in the cache. Since
+// ustrings are unique, keys are compared by the addresses of their
+// characters and hashed from their precomputed hashes, never by looking
+// at the strings themselves.
 class ColorProcCacheKey {
 public:
     ColorProcCacheKey(ustring in, ustring out, ustring key = ustring(),
@@ -66,58 +72,28 @@ public:
         , context_key(key)
         , context_value(val)
         , looks(looks)
+        , display(display)
+        , view(view)
         , file(file)
         , inverse(inverse)
     {
-        hash = inputColorSpace.hash() + 14033ul * outputColorSpace.hash()
-               + 823ul * context_key.hash() + 28411ul * context_value.hash()
-               + 1741ul
-                     * (looks.hash() + display.hash() + view.hash()
-                        + file.hash())
-               + (inverse ? 6421 : 0);
-        // N.B. no separate multipliers for looks, display, view, file
-        // because they're never used for the same lookup.
+        hash = size_t(fasthash::fasthash64(
+            { uint64_t(inputColorSpace.hash()),
+              uint64_t(outputColorSpace.hash()), uint64_t(context_key.hash()),
+              uint64_t(context_value.hash()), uint64_t(looks.hash()),
+              uint64_t(display.hash()), uint64_t(view.hash()),
+              uint64_t(file.hash()), uint64_t(inverse) }));
     }
 
-    friend bool operator<(const ColorProcCacheKey& a,
-                          const ColorProcCacheKey& b)
+    friend bool operator==(const ColorProcCacheKey& a,
+                           const ColorProcCacheKey& b)
     {
-        if (a.hash < b.hash)
-            return true;
-        if (b.hash < a.hash)
-            return false;
-        // They hash the same, so now compare for real. Note that we just to
-        // impose an order, any order -- does not need to be alphabetical --
-        // so we just compare the pointers.
-        if (a.inputColorSpace.c_str() < b.inputColorSpace.c_str())
-            return true;
-        if (b.inputColorSpace.c_str() < a.inputColorSpace.c_str())
-            return false;
-        if (a.outputColorSpace.c_str() < b.outputColorSpace.c_str())
-            return true;
-        if (b.outputColorSpace.c_str() < a.outputColorSpace.c_str())
-            return false;
-        if (a.context_key.c_str() < b.context_key.c_str())
-            return true;
-        if (b.context_key.c_str() < a.context_key.c_str())
-            return false;
-        if (a.looks.c_str() < b.looks.c_str())
-            return true;
-        if (b.looks.c_str() < a.looks.c_str())
-            return false;
-        if (a.display.c_str() < b.display.c_str())
-            return true;
-        if (b.display.c_str() < a.display.c_str())
-            return false;
-        if (a.view.c_str() < b.view.c_str())
-            return true;
-        if (b.view.c_str() < a.view.c_str())
-            return false;
-        if (a.file.c_str() < b.view.c_str())
-            return true;
-        if (b.view.c_str() < a.view.c_str())
-            return false;
-        return int(a.inverse) < int(b.inverse);
+        return a.hash == b.hash && a.inputColorSpace == b.inputColorSpace
+               && a.outputColorSpace == b.outputColorSpace
+               && a.context_key == b.context_key
+               && a.context_value == b.context_value && a.looks == b.looks
+               && a.display == b.display && a.view == b.view
+               && a.file == b.file && a.inverse == b.inverse;
     }
 
     ustring inputColorSpace;
@@ -134,8 +110,89 @@ public:
 
 
 
-typedef boost::container::flat_map<ColorProcCacheKey, ColorProcessorHandle>
-    ColorProcessorMap;
+// Cache of ColorProcessors whose lookups don't lock anything: an
+// open-addressed table of pointers to entries that never change once
+// added. Writers (serialized by a mutex) only ever add entries, replacing
+// the table with a copy twice the size when it gets half full. Entries and
+// replaced tables are kept until the cache is destroyed, since readers may
+// still be looking at them -- there are only ever a handful of processors.
+class ColorProcCache {
+public:
+    ColorProcCache()
+    {
+        m_all.emplace_back(new Table(64));
+        m_table = m_all.back().get();
+    }
+
+    // Return the processor for key, or an empty handle if there is none.
+    ColorProcessorHandle find(const ColorProcCacheKey& key) const
+    {
+        const Table* t = m_table.load(std::memory_order_acquire);
+        for (size_t i = key.hash & t->mask;; i = (i + 1) & t->mask) {
+            const Entry* e = t->slots[i].load(std::memory_order_acquire);
+            if (!e)
+                return ColorProcessorHandle();
+            if (e->key == key)
+                return e->handle;
+        }
+    }
+
+    // Add handle for key, unless another thread got there first, and
+    // return whichever one is now in the cache.
+    ColorProcessorHandle insert(const ColorProcCacheKey& key,
+                                const ColorProcessorHandle& handle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ColorProcessorHandle found = find(key))
+            return found;
+        Table* t = m_table.load(std::memory_order_relaxed);
+        if (2 * (t->count + 1) > t->mask + 1) {
+            m_all.emplace_back(new Table(2 * (t->mask + 1)));
+            Table* bigger = m_all.back().get();
+            for (size_t i = 0; i <= t->mask; ++i) {
+                const Entry* e = t->slots[i].load(std::memory_order_relaxed);
+                if (e)
+                    bigger->add(e);
+            }
+            m_table.store(bigger, std::memory_order_release);
+            t = bigger;
+        }
+        m_entries.emplace_back(new Entry { key, handle });
+        t->add(m_entries.back().get());
+        return handle;
+    }
+
+private:
+    struct Entry {
+        ColorProcCacheKey key;
+        ColorProcessorHandle handle;
+    };
+    struct Table {
+        explicit Table(size_t size)
+            : mask(size - 1)
+            , slots(new std::atomic<const Entry*>[size])
+        {
+            for (size_t i = 0; i < size; ++i)
+                slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+        // Only called by writers, with the cache's mutex held.
+        void add(const Entry* e)
+        {
+            size_t i = e->key.hash & mask;
+            while (slots[i].load(std::memory_order_relaxed))
+                i = (i + 1) & mask;
+            slots[i].store(e, std::memory_order_release);
+            ++count;
+        }
+        size_t mask;        // size-1 (the size is a power of 2)
+        size_t count = 0;   // Entries in use
+        std::unique_ptr<std::atomic<const Entry*>[]> slots;
+    };
+    std::atomic<Table*> m_table;
+    std::vector<std::unique_ptr<Table>> m_all;  // Current and replaced
+    std::vector<std::unique_ptr<Entry>> m_entries;
+    std::mutex m_mutex;  // Serializes writers
+};
 
 
 
@@ -160,10 +217,9 @@ public:
     std::vector<std::pair<std::string, int>> colorspaces;
     std::string linear_alias;  // Alias for a scene-linear color space
 private:
-    mutable spin_rw_mutex m_mutex;
+    mutable spin_rw_mutex m_mutex;  // Protects m_error
     mutable std::string m_error;
-    ColorProcessorMap colorprocmap;  // cache of ColorProcessors
-    atomic_int colorprocs_requested;
+    ColorProcCache colorproccache;  // cache of ColorProcessors
     atomic_int colorprocs_created;
     std::string m_configname;
 
@@ -173,11 +229,9 @@ public:
     ~Impl()
     {
 #if 0
-        // Debugging the cache -- make sure we're creating a small number
-        // compared to repeated requests.
-        if (colorprocs_requested)
-            Strutil::printf ("ColorConfig::Impl : color procs requested: %d, created: %d\n",
-                             colorprocs_requested, colorprocs_created);
+        // Debugging the cache -- make sure we're creating a small number.
+        Strutil::printf ("ColorConfig::Impl : color procs created: %d\n",
+                         colorprocs_created);
 #endif
     }
 
@@ -188,14 +242,10 @@ public:
     }
 
     // Search for a matching ColorProcessor, return it if found (otherwise
-    // return an empty handle).
-    ColorProcessorHandle findproc(const ColorProcCacheKey& key)
+    // return an empty handle). This doesn't lock anything.
+    ColorProcessorHandle findproc(const ColorProcCacheKey& key) const
     {
-        ++colorprocs_requested;
-        spin_rw_read_lock lock(m_mutex);
-        auto found = colorprocmap.find(key);
-        return (found == colorprocmap.end()) ? ColorProcessorHandle()
-                                             : found->second;
+        return colorproccache.find(key);
     }
 
     // Add the given color processor. Be careful -- if a matching one is
@@ -207,17 +257,7 @@ public:
         if (!handle)
             return handle;
         ++colorprocs_created;
-        spin_rw_write_lock lock(m_mutex);
-        auto found = colorprocmap.find(key);
-        if (found == colorprocmap.end()) {
-            // No equivalent item in the map. Add this one.
-            colorprocmap[key] = handle;
-        } else {
-            // There's already an equivalent one. Oops. Discard this one and
-            // return the one already in the map.
-            handle = found->second;
-        }
-        return handle;
+        return colorproccache.insert(key, handle);
     }
 
     void error(const std::string& err)
@@ -337,6 +377,19 @@ ColorConfig::reset(string_view filename)
     if (getNumColorSpaces() && !getImpl()->haserror())
         getImpl()->clear_error();
 
+    // Make the processors named by the "color:precompile" attribute now,
+    // so that threads using them later needn't wait for OCIO. Pairs that
+    // can't be made are just skipped.
+    bool haderror = getImpl()->haserror();
+    for (string_view pair : Strutil::splitsv(pvt::color_precompile, ",")) {
+        size_t arrow = pair.find("->");
+        if (arrow != string_view::npos)
+            createColorProcessor(Strutil::strip(pair.substr(0, arrow)),
+                                 Strutil::strip(pair.substr(arrow + 2)));
+    }
+    if (!haderror)
+        getImpl()->clear_error();
+
     return ok;
 }
 
@@ -568,6 +621,50 @@ private:
 
 
 
+// Helper for the built-in transfer function ColorProcessors: apply the
+// function to the first three channels of each pixel, leaving any others
+// alone. With at least three channels, vfunc does a pixel at a time as a
+// vfloat4 (for contiguous RGBA, with whole vfloat4 loads and stores that
+// keep alpha by a blend); with fewer, sfunc does a channel at a time.
+template<typename VFUNC, typename SFUNC>
+static void
+apply_transfer(float* data, int width, int height, int channels,
+               stride_t chanstride, stride_t xstride, stride_t ystride,
+               const VFUNC& vfunc, const SFUNC& sfunc)
+{
+    using namespace simd;
+    if (channels >= 4 && chanstride == sizeof(float)) {
+        const vbool4 rgb(true, true, true, false);
+        for (int y = 0; y < height; ++y) {
+            char* d = (char*)data + y * ystride;
+            for (int x = 0; x < width; ++x, d += xstride) {
+                vfloat4 r((float*)d);
+                r = select(rgb, vfunc(r), r);
+                r.store((float*)d);
+            }
+        }
+    } else if (channels >= 3) {
+        for (int y = 0; y < height; ++y) {
+            char* d = (char*)data + y * ystride;
+            for (int x = 0; x < width; ++x, d += xstride) {
+                vfloat4 r;
+                r.load((float*)d, 3);
+                r = vfunc(r);
+                r.store((float*)d, 3);
+            }
+        }
+    } else {
+        for (int y = 0; y < height; ++y) {
+            char* d = (char*)data + y * ystride;
+            for (int x = 0; x < width; ++x, d += xstride)
+                for (int c = 0; c < channels; ++c)
+                    ((float*)d)[c] = sfunc(((float*)d)[c]);
+        }
+    }
+}
+
+
+
 // ColorProcessor that hard-codes sRGB-to-linear
 class ColorProcessor_sRGB_to_linear : public ColorProcessor {
 public:
@@ -579,26 +676,10 @@ public:
                        stride_t chanstride, stride_t xstride,
                        stride_t ystride) const
     {
-        if (channels > 3)
-            channels = 3;
-        if (channels == 3) {
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride) {
-                    simd::vfloat4 r;
-                    r.load((float*)d, 3);
-                    r = sRGB_to_linear(r);
-                    r.store((float*)d, 3);
-                }
-            }
-        } else {
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride)
-                    for (int c = 0; c < channels; ++c)
-                        ((float*)d)[c] = sRGB_to_linear(((float*)d)[c]);
-            }
-        }
+        apply_transfer(data, width, height, channels, chanstride, xstride,
+                       ystride,
+                       [](const simd::vfloat4& x) { return sRGB_to_linear(x); },
+                       [](float x) { return sRGB_to_linear(x); });
     }
 };
 
@@ -614,26 +695,10 @@ public:
                        stride_t chanstride, stride_t xstride,
                        stride_t ystride) const
     {
-        if (channels > 3)
-            channels = 3;
-        if (channels == 3) {
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride) {
-                    simd::vfloat4 r;
-                    r.load((float*)d, 3);
-                    r = linear_to_sRGB(r);
-                    r.store((float*)d, 3);
-                }
-            }
-        } else {
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride)
-                    for (int c = 0; c < channels; ++c)
-                        ((float*)d)[c] = linear_to_sRGB(((float*)d)[c]);
-            }
-        }
+        apply_transfer(data, width, height, channels, chanstride, xstride,
+                       ystride,
+                       [](const simd::vfloat4& x) { return linear_to_sRGB(x); },
+                       [](float x) { return linear_to_sRGB(x); });
     }
 };
 
@@ -650,14 +715,10 @@ public:
                        stride_t chanstride, stride_t xstride,
                        stride_t ystride) const
     {
-        if (channels > 3)
-            channels = 3;
-        for (int y = 0; y < height; ++y) {
-            char* d = (char*)data + y * ystride;
-            for (int x = 0; x < width; ++x, d += xstride)
-                for (int c = 0; c < channels; ++c)
-                    ((float*)d)[c] = Rec709_to_linear(((float*)d)[c]);
-        }
+        apply_transfer(data, width, height, channels, chanstride, xstride,
+                       ystride,
+                       [](const simd::vfloat4& x) { return Rec709_to_linear(x); },
+                       [](float x) { return Rec709_to_linear(x); });
     }
 };
 
@@ -673,14 +734,10 @@ public:
                        stride_t chanstride, stride_t xstride,
                        stride_t ystride) const
     {
-        if (channels > 3)
-            channels = 3;
-        for (int y = 0; y < height; ++y) {
-            char* d = (char*)data + y * ystride;
-            for (int x = 0; x < width; ++x, d += xstride)
-                for (int c = 0; c < channels; ++c)
-                    ((float*)d)[c] = linear_to_Rec709(((float*)d)[c]);
-        }
+        apply_transfer(data, width, height, channels, chanstride, xstride,
+                       ystride,
+                       [](const simd::vfloat4& x) { return linear_to_Rec709(x); },
+                       [](float x) { return linear_to_Rec709(x); });
     }
 };
 
@@ -698,27 +755,12 @@ public:
                        stride_t chanstride, stride_t xstride,
                        stride_t ystride) const
     {
-        if (channels > 3)
-            channels = 3;
-        if (channels == 3) {
-            simd::vfloat4 g = m_gamma;
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride) {
-                    simd::vfloat4 r;
-                    r.load((float*)d, 3);
-                    r = fast_pow_pos(r, g);
-                    r.store((float*)d, 3);
-                }
-            }
-        } else {
-            for (int y = 0; y < height; ++y) {
-                char* d = (char*)data + y * ystride;
-                for (int x = 0; x < width; ++x, d += xstride)
-                    for (int c = 0; c < channels; ++c)
-                        ((float*)d)[c] = powf(((float*)d)[c], m_gamma);
-            }
-        }
+        float gamma     = m_gamma;
+        simd::vfloat4 g = m_gamma;
+        apply_transfer(
+            data, width, height, channels, chanstride, xstride, ystride,
+            [g](const simd::vfloat4& x) { return fast_pow_pos(x, g); },
+            [gamma](float x) { return powf(x, gamma); });
     }
 
 private:
@@ -741,6 +783,141 @@ public:
 
 
 
+// ColorProcessor that approximates another one by table lookup. Each of
+// the RGB channels is mapped through a 1D shaper table to a coordinate in
+// a cube of RGB values (sampled from the other processor), which is
+// interpolated tetrahedrally.
+class ColorProcessor_LUT3D : public ColorProcessor {
+public:
+    ColorProcessor_LUT3D(const ColorProcessor& processor, int cubesize,
+                         int shapersize, float maxvalue)
+        : ColorProcessor()
+        , m_cubesize(cubesize)
+        , m_maxvalue(maxvalue)
+        , m_shaperscale((shapersize - 1) / maxvalue)
+        , m_shaper(shapersize)
+        , m_cube(size_t(cubesize) * cubesize * cubesize)
+        , m_noop(processor.isNoOp())
+        , m_crosstalk(processor.hasChannelCrosstalk())
+    {
+        // The shaper takes [0,maxvalue] to [0,cubesize-1], by a log2 curve
+        // if maxvalue > 1 (to spread the cube more evenly over scene
+        // linear values), otherwise linearly.
+        bool logshaper = maxvalue > 1.0f;
+        float logmax   = log2f(1.0f + maxvalue);
+        for (int i = 0; i < shapersize; ++i) {
+            float x     = i / m_shaperscale;
+            float t     = logshaper ? log2f(1.0f + x) / logmax : x / maxvalue;
+            m_shaper[i] = t * (cubesize - 1);
+        }
+        // Sample the processor at the input values (the shaper's inverse)
+        // of the cube's nodes, red varying fastest.
+        std::vector<float> node(cubesize);
+        for (int i = 0; i < cubesize; ++i) {
+            float t = float(i) / (cubesize - 1);
+            node[i] = logshaper ? exp2f(t * logmax) - 1.0f : t * maxvalue;
+        }
+        size_t n = m_cube.size();
+        std::vector<float> rgba(4 * n);
+        for (size_t i = 0; i < n; ++i) {
+            rgba[4 * i + 0] = node[i % cubesize];
+            rgba[4 * i + 1] = node[(i / cubesize) % cubesize];
+            rgba[4 * i + 2] = node[i / (size_t(cubesize) * cubesize)];
+            rgba[4 * i + 3] = 1.0f;
+        }
+        processor.apply(rgba.data(), int(n), 1, 4, sizeof(float),
+                        4 * sizeof(float), 4 * sizeof(float) * n);
+        for (size_t i = 0; i < n; ++i)
+            m_cube[i] = simd::vfloat4(rgba[4 * i], rgba[4 * i + 1],
+                                      rgba[4 * i + 2], 0.0f);
+    }
+    ~ColorProcessor_LUT3D() {};
+
+    virtual bool isNoOp() const { return m_noop; }
+    virtual bool hasChannelCrosstalk() const { return m_crosstalk; }
+
+    virtual void apply(float* data, int width, int height, int channels,
+                       stride_t chanstride, stride_t xstride,
+                       stride_t ystride) const
+    {
+        int nc = std::min(channels, 3);
+        for (int y = 0; y < height; ++y) {
+            char* d = (char*)data + y * ystride;
+            for (int x = 0; x < width; ++x, d += xstride) {
+                simd::vfloat4 v(0.0f);
+                for (int c = 0; c < nc; ++c)
+                    v[c] = *(float*)(d + c * chanstride);
+                v = lookup(v);
+                for (int c = 0; c < nc; ++c)
+                    *(float*)(d + c * chanstride) = v[c];
+            }
+        }
+    }
+
+private:
+    // Look up the RGB in the first three components of v.
+    simd::vfloat4 lookup(const simd::vfloat4& v) const
+    {
+        using namespace simd;
+        // Shaper: linearly interpolate the table, for all channels at once
+        // except for fetching the table entries.
+        const int slast = int(m_shaper.size()) - 2;
+        vfloat4 s = min(max(v, vfloat4::Zero()), vfloat4(m_maxvalue))
+                    * m_shaperscale;
+        vint4 si  = min(max(vint4(s), vint4::Zero()), vint4(slast));
+        s -= vfloat4(si);
+        const float* sh = m_shaper.data();
+        vfloat4 s0(sh[si[0]], sh[si[1]], sh[si[2]], 0.0f);
+        vfloat4 s1(sh[si[0] + 1], sh[si[1] + 1], sh[si[2] + 1], 0.0f);
+        vfloat4 t = madd(s, s1 - s0, s0);
+
+        // Cube: split into integer node and fraction, and pick the
+        // tetrahedron by the order of the fractions. The path from the
+        // node's corner to the opposite corner steps along the axes in
+        // decreasing order of fraction.
+        const int n = m_cubesize;
+        vint4 ti    = min(max(vint4(t), vint4::Zero()), vint4(n - 2));
+        vfloat4 f   = t - vfloat4(ti);
+        size_t base = ti[0] + n * (ti[1] + size_t(n) * ti[2]);
+        const size_t step[3] = { 1, size_t(n), size_t(n) * n };
+        float fr = f[0], fg = f[1], fb = f[2];
+        int a0, a1, a2;  // axes, by decreasing fraction
+        if (fr > fg) {
+            if (fg > fb) {
+                a0 = 0, a1 = 1, a2 = 2;
+            } else if (fr > fb) {
+                a0 = 0, a1 = 2, a2 = 1;
+            } else {
+                a0 = 2, a1 = 0, a2 = 1;
+            }
+        } else {
+            if (fb > fg) {
+                a0 = 2, a1 = 1, a2 = 0;
+            } else if (fb > fr) {
+                a0 = 1, a1 = 2, a2 = 0;
+            } else {
+                a0 = 1, a1 = 0, a2 = 2;
+            }
+        }
+        const vfloat4* c = &m_cube[base];
+        size_t o1 = step[a0], o2 = o1 + step[a1];
+        size_t o3 = step[0] + step[1] + step[2];
+        vfloat4 r = madd(vfloat4(f[a0]), c[o1] - c[0], c[0]);
+        r         = madd(vfloat4(f[a1]), c[o2] - c[o1], r);
+        return madd(vfloat4(f[a2]), c[o3] - c[o2], r);
+    }
+
+    int m_cubesize;
+    float m_maxvalue;
+    float m_shaperscale;  // shaper table entries per unit of input
+    std::vector<float> m_shaper;
+    std::vector<simd::vfloat4> m_cube;
+    bool m_noop;
+    bool m_crosstalk;
+};
+
+
+
 ColorProcessorHandle
 ColorConfig::createColorProcessor(string_view inputColorSpace,
                                   string_view outputColorSpace,
@@ -1103,6 +1280,19 @@ ColorConfig::createFileTransform(ustring name, bool inverse) const
 
 
 
+ColorProcessorHandle
+ColorConfig::createBakedProcessor(const ColorProcessorHandle& processor,
+                                  int cubesize, int shapersize,
+                                  float maxvalue) const
+{
+    if (!processor || cubesize < 2 || shapersize < 2 || !(maxvalue > 0.0f))
+        return ColorProcessorHandle();
+    return ColorProcessorHandle(
+        new ColorProcessor_LUT3D(*processor, cubesize, shapersize, maxvalue));
+}
+
+
+
 string_view
 ColorConfig::parseColorSpaceFromString(string_view str) const
 {
@@ -1122,7 +1312,46 @@ ColorConfig::parseColorSpaceFromString(string_view str) const
 
 
 static std::shared_ptr<ColorConfig> default_colorconfig;  // default color config
-static spin_mutex colorconfig_mutex;
+static std::once_flag default_colorconfig_once;
+
+
+
+// Return colorconfig, or if it's NULL, the default one (made on first
+// use). Only making the default config is serialized; a ColorConfig may be
+// asked for processors by any number of threads at once.
+static ColorConfig*
+default_colorconfig_if_null(ColorConfig* colorconfig)
+{
+    if (colorconfig)
+        return colorconfig;
+    std::call_once(default_colorconfig_once,
+                   []() { default_colorconfig.reset(new ColorConfig); });
+    return default_colorconfig.get();
+}
+
+
+
+ColorProcessorHandle
+pvt::read_colorprocessor(const ImageSpec* config, const ImageSpec& filespec,
+                         ustring& target)
+{
+    target = ustring();
+    string_view to = config ? config->get_string_attribute(
+                                  "oiio:TargetColorSpace")
+                            : string_view();
+    string_view from = filespec.get_string_attribute("oiio:ColorSpace",
+                                                     "Linear");
+    if (to.empty() || Strutil::iequals(from, to))
+        return ColorProcessorHandle();
+    target = ustring(to);
+    ColorProcessorHandle processor
+        = default_colorconfig_if_null(nullptr)->createColorProcessor(from, to);
+    if (processor && processor->isNoOp()) {
+        target = ustring();
+        processor.reset();
+    }
+    return processor;
+}
 
 
 
@@ -1141,22 +1370,16 @@ ImageBufAlgo::colorconvert(ImageBuf& dst, const ImageBuf& src, string_view from,
         return false;
     }
     ColorProcessorHandle processor;
-    {
-        spin_lock lock(colorconfig_mutex);
-        if (!colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (!colorconfig)
-            default_colorconfig.reset(colorconfig = new ColorConfig);
-        processor = colorconfig->createColorProcessor(from, to, context_key,
-                                                      context_value);
-        if (!processor) {
-            if (colorconfig->error())
-                dst.error("%s", colorconfig->geterror());
-            else
-                dst.error("Could not construct the color transform %s -> %s",
-                          from, to);
-            return false;
-        }
+    colorconfig = default_colorconfig_if_null(colorconfig);
+    processor = colorconfig->createColorProcessor(from, to, context_key,
+                                                  context_value);
+    if (!processor) {
+        if (colorconfig->error())
+            dst.error("%s", colorconfig->geterror());
+        else
+            dst.error("Could not construct the color transform %s -> %s",
+                      from, to);
+        return false;
     }
 
     logtime.stop();  // transition to other colorconvert
@@ -1184,6 +1407,37 @@ ImageBufAlgo::colorconvert(const ImageBuf& src, string_view from,
 
 
 
+// Version for 8 and 16 bit sources and a processor with no channel
+// crosstalk: every channel of every pixel is looked up in a table of the
+// processor's result for each possible code value.
+template<class Rtype, class Atype>
+static bool
+colorconvert_lut_impl(ImageBuf& R, const ImageBuf& A,
+                      const ColorProcessor* processor, ROI roi, int nthreads)
+{
+    using namespace ImageBufAlgo;
+    int channelsToCopy = std::min(4, roi.nchannels());
+    // Since each channel is transformed independently, one run of the
+    // processor over a gray ramp of all the code values makes the table.
+    const size_t ncodes = size_t(1) << (8 * sizeof(Atype));
+    std::vector<float> lut(4 * ncodes);
+    for (size_t i = 0; i < ncodes; ++i)
+        for (int c = 0; c < 4; ++c)
+            lut[4 * i + c] = convert_type<Atype, float>(Atype(i));
+    processor->apply(lut.data(), int(ncodes), 1, 4, sizeof(float),
+                     4 * sizeof(float), 4 * sizeof(float) * ncodes);
+    parallel_image(roi, parallel_image_options(nthreads), [&](ROI roi) {
+        ImageBuf::ConstIterator<Atype, Atype> a(A, roi);
+        ImageBuf::Iterator<Rtype> r(R, roi);
+        for (; !r.done(); ++r, ++a)
+            for (int c = 0; c < channelsToCopy; ++c)
+                r[c] = lut[4 * size_t(a[c]) + c];
+    });
+    return true;
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 colorconvert_impl(ImageBuf& R, const ImageBuf& A,
@@ -1198,6 +1452,12 @@ colorconvert_impl(ImageBuf& R, const ImageBuf& A,
     int channelsToCopy = std::min(4, roi.nchannels());
     if (channelsToCopy < 4)
         unpremult = false;
+    if ((std::is_same<Atype, unsigned char>::value
+         || std::is_same<Atype, unsigned short>::value)
+        && !unpremult && !processor->hasChannelCrosstalk()
+        && roi.npixels() >= (imagesize_t(1) << (8 * sizeof(Atype))))
+        return colorconvert_lut_impl<Rtype, Atype>(R, A, processor, roi,
+                                                   nthreads);
     parallel_image(
         roi, parallel_image_options(nthreads),
         [&, unpremult, channelsToCopy, processor](ROI roi) {
@@ -1347,7 +1607,7 @@ ImageBufAlgo::colorconvert(ImageBuf& dst, const ImageBuf& src,
         unpremult = false;
     }
 
-    if (dst.localpixels() && src.localpixels() && dst.spec().format == TypeFloat
+    if (dst.contiguous() && src.contiguous() && dst.spec().format == TypeFloat
         && src.spec().format == TypeFloat && dst.nchannels() == 4
         && src.nchannels() == 4) {
         return colorconvert_impl_float_rgba(dst, src, processor, unpremult, roi,
@@ -1394,21 +1654,15 @@ ImageBufAlgo::ociolook(ImageBuf& dst, const ImageBuf& src, string_view looks,
         return false;
     }
     ColorProcessorHandle processor;
-    {
-        spin_lock lock(colorconfig_mutex);
-        if (!colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (!colorconfig)
-            default_colorconfig.reset(colorconfig = new ColorConfig);
-        processor = colorconfig->createLookTransform(looks, from, to, inverse,
-                                                     key, value);
-        if (!processor) {
-            if (colorconfig->error())
-                dst.error("%s", colorconfig->geterror());
-            else
-                dst.error("Could not construct the color transform");
-            return false;
-        }
+    colorconfig = default_colorconfig_if_null(colorconfig);
+    processor = colorconfig->createLookTransform(looks, from, to, inverse,
+                                                 key, value);
+    if (!processor) {
+        if (colorconfig->error())
+            dst.error("%s", colorconfig->geterror());
+        else
+            dst.error("Could not construct the color transform");
+        return false;
     }
 
     logtime.stop();  // transition to colorconvert
@@ -1445,30 +1699,24 @@ ImageBufAlgo::ociodisplay(ImageBuf& dst, const ImageBuf& src,
 {
     pvt::LoggedTimer logtime("IBA::ociodisplay");
     ColorProcessorHandle processor;
-    {
-        spin_lock lock(colorconfig_mutex);
-        if (!colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (!colorconfig)
-            default_colorconfig.reset(colorconfig = new ColorConfig);
-        if (from.empty() || from == "current") {
-            auto linearspace = colorconfig->getColorSpaceNameByRole("linear");
-            from = src.spec().get_string_attribute("oiio:Colorspace",
-                                                   linearspace);
-        }
-        if (from.empty()) {
-            dst.error("Unknown color space name");
-            return false;
-        }
-        processor = colorconfig->createDisplayTransform(display, view, from,
-                                                        looks, key, value);
-        if (!processor) {
-            if (colorconfig->error())
-                dst.error("%s", colorconfig->geterror());
-            else
-                dst.error("Could not construct the color transform");
-            return false;
-        }
+    colorconfig = default_colorconfig_if_null(colorconfig);
+    if (from.empty() || from == "current") {
+        auto linearspace = colorconfig->getColorSpaceNameByRole("linear");
+        from = src.spec().get_string_attribute("oiio:Colorspace",
+                                               linearspace);
+    }
+    if (from.empty()) {
+        dst.error("Unknown color space name");
+        return false;
+    }
+    processor = colorconfig->createDisplayTransform(display, view, from,
+                                                    looks, key, value);
+    if (!processor) {
+        if (colorconfig->error())
+            dst.error("%s", colorconfig->geterror());
+        else
+            dst.error("Could not construct the color transform");
+        return false;
     }
 
     logtime.stop();  // transition to colorconvert
@@ -1505,20 +1753,14 @@ ImageBufAlgo::ociofiletransform(ImageBuf& dst, const ImageBuf& src,
         return false;
     }
     ColorProcessorHandle processor;
-    {
-        spin_lock lock(colorconfig_mutex);
-        if (!colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (!colorconfig)
-            default_colorconfig.reset(colorconfig = new ColorConfig);
-        processor = colorconfig->createFileTransform(name, inverse);
-        if (!processor) {
-            if (colorconfig->error())
-                dst.error("%s", colorconfig->geterror());
-            else
-                dst.error("Could not construct the color transform");
-            return false;
-        }
+    colorconfig = default_colorconfig_if_null(colorconfig);
+    processor = colorconfig->createFileTransform(name, inverse);
+    if (!processor) {
+        if (colorconfig->error())
+            dst.error("%s", colorconfig->geterror());
+        else
+            dst.error("Could not construct the color transform");
+        return false;
     }
 
     logtime.stop();  // transition to colorconvert
@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <numeric>
 
 #include <OpenEXR/half.h>
@@ -38,6 +39,7 @@
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/deepdata.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/thread.h>
 
@@ -53,6 +55,59 @@ OIIO_NAMESPACE_BEGIN
 // need to lock the mutex. As long as capacity is not changing, threads may
 // change number of samples (inserting or deleting) as well as altering
 // data, simultaneously, as long as they are working on separate pixels.
+//
+// The sample storage is an arena of "slots" (one sample each). Freshly
+// allocated or compacted data has the pixels' slots back to back, in pixel
+// order. A pixel that outgrows its capacity is moved to fresh slots at the
+// end of the arena (or just extended, if it is already the last one there),
+// leaving a hole behind, so growing one pixel never moves the others. When
+// the arena runs out of slots, it is compacted into a new one with room to
+// spare, so that growth costs amortized O(1) per sample.
+//
+// The samples are normally interleaved, [pixel][sample][channel]. In the
+// optional planar layout, each channel instead has its own plane holding
+// that channel for every sample of every pixel, [channel][pixel][sample],
+// using the same cumulative capacity index, so that a pixel's Z (say) is
+// a contiguous array.
+
+
+
+// Exclusive prefix sum: cum[i] = sum(count[0..i-1]), returning the grand
+// total. Large arrays are summed in blocks in parallel, then each block is
+// offset by the running total of the blocks before it.
+static size_t
+prefix_sum(const unsigned int* count, unsigned int* cum, size_t n)
+{
+    const size_t blocksize = 65536;
+    size_t nblocks         = (n + blocksize - 1) / blocksize;
+    if (nblocks <= 1) {
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) {
+            cum[i] = total;
+            total += count[i];
+        }
+        return total;
+    }
+    std::vector<size_t> blocktotal(nblocks + 1, 0);
+    parallel_for(0, int64_t(nblocks), [&](int64_t b) {
+        size_t total = 0;
+        for (size_t i = b * blocksize, e = std::min(n, i + blocksize); i < e;
+             ++i)
+            total += count[i];
+        blocktotal[b + 1] = total;
+    });
+    for (size_t b = 0; b < nblocks; ++b)
+        blocktotal[b + 1] += blocktotal[b];
+    parallel_for(0, int64_t(nblocks), [&](int64_t b) {
+        size_t total = blocktotal[b];
+        for (size_t i = b * blocksize, e = std::min(n, i + blocksize); i < e;
+             ++i) {
+            cum[i] = total;
+            total += count[i];
+        }
+    });
+    return blocktotal[nblocks];
+}
 
 
 
@@ -65,9 +120,13 @@ public:
     std::vector<size_t> m_channeloffsets;  // for each channel [c]
     std::vector<unsigned int> m_nsamples;  // for each pixel [p]
     std::vector<unsigned int> m_capacity;  // for each pixel [p]
-    std::vector<unsigned int>
-        m_cumcapacity;         // cumulative capacity before pixel [p]
-    std::vector<char> m_data;  // for each sample [p][s][c]
+    std::vector<unsigned int> m_offset;  // first slot of pixel [p]
+    std::vector<char> m_data;  // for each slot [slot][c] (or [c][slot])
+    std::vector<size_t> m_planeoffsets;  // planar: start of channel [c]
+    size_t m_nslots;   // Number of sample slots m_data holds
+    size_t m_used;     // Slots handed out to pixels (the rest are spare)
+    size_t m_waste;    // Slots abandoned by pixels that moved
+    size_t m_reserve;  // Minimum slots to allocate (reserve_total)
     std::vector<std::string> m_channelnames;  // For each channel[c]
     std::vector<int> m_myalphachannel;        // For each channel[c], its alpha
         // myalphachannel[c] gives the alpha channel corresponding to channel
@@ -80,6 +139,7 @@ public:
     int m_AG_channel;
     int m_AB_channel;
     bool m_allocated;
+    bool m_planar;  // Channel-planar rather than interleaved samples
     spin_mutex m_mutex;
 
     Impl()
@@ -95,8 +155,13 @@ public:
         m_channeloffsets.clear();
         m_nsamples.clear();
         m_capacity.clear();
-        m_cumcapacity.clear();
+        m_offset.clear();
         m_data.clear();
+        m_planeoffsets.clear();
+        m_nslots        = 0;
+        m_used          = 0;
+        m_waste         = 0;
+        m_reserve       = 0;
         m_channelnames.clear();
         m_myalphachannel.clear();
         m_samplesize    = 0;
@@ -107,32 +172,162 @@ public:
         m_AG_channel    = -1;
         m_AB_channel    = -1;
         m_allocated     = false;
+        m_planar        = false;
     }
 
-    // If not already done, allocate data and cumcapacity
+    // If not already done, allocate data and offsets
     void alloc(size_t npixels)
     {
         if (!m_allocated) {
             spin_lock lock(m_mutex);
             if (!m_allocated) {
-                // m_cumcapacity.resize (npixels);
-                size_t totalcapacity = 0;
-                for (size_t i = 0; i < npixels; ++i) {
-                    m_cumcapacity[i] = totalcapacity;
-                    totalcapacity += m_capacity[i];
-                }
-                m_data.resize(totalcapacity * m_samplesize);
+                m_used   = prefix_sum(m_capacity.data(), m_offset.data(),
+                                    npixels);
+                m_nslots = std::max(m_used, m_reserve);
+                m_waste  = 0;
+                m_data.resize(m_nslots * m_samplesize);
+                if (m_planar)
+                    m_planeoffsets = plane_offsets(m_nslots);
                 m_allocated = true;
             }
         }
     }
 
-    size_t data_offset(int pixel, int channel, int sample)
+    // Where each channel's plane starts, in the planar layout, for the
+    // given number of slots.
+    std::vector<size_t> plane_offsets(size_t nslots) const
     {
-        DASSERT(int(m_cumcapacity.size()) > pixel);
+        std::vector<size_t> offsets(m_channelsizes.size());
+        size_t offset = 0;
+        for (size_t c = 0; c < m_channelsizes.size(); ++c) {
+            offsets[c] = offset;
+            offset += nslots * m_channelsizes[c];
+        }
+        return offsets;
+    }
+
+    size_t data_offset(int pixel, int channel, int sample) const
+    {
+        DASSERT(int(m_offset.size()) > pixel);
         DASSERT(m_capacity[pixel] >= m_nsamples[pixel]);
-        return (m_cumcapacity[pixel] + sample) * m_samplesize
-               + m_channeloffsets[channel];
+        return slot_offset(m_offset[pixel] + sample, channel);
+    }
+
+    // Byte offset of the given channel of the given slot
+    size_t slot_offset(size_t slot, int channel) const
+    {
+        if (m_planar)
+            return m_planeoffsets[channel] + slot * m_channelsizes[channel];
+        return slot * m_samplesize + m_channeloffsets[channel];
+    }
+
+    // Bytes from one sample of the channel to the next.
+    size_t sample_stride(int channel) const
+    {
+        return m_planar ? m_channelsizes[channel] : m_samplesize;
+    }
+
+    // Move n samples of the pixel from sample position 'from' to 'to'. The
+    // ranges may overlap but must lie within the pixel's capacity.
+    void move_samples(int pixel, int from, int to, int n)
+    {
+        if (n <= 0 || from == to)
+            return;
+        if (m_planar) {
+            for (int c = 0, nc = int(m_channelsizes.size()); c < nc; ++c)
+                memmove(&m_data[data_offset(pixel, c, to)],
+                        &m_data[data_offset(pixel, c, from)],
+                        n * m_channelsizes[c]);
+        } else {
+            memmove(&m_data[data_offset(pixel, 0, to)],
+                    &m_data[data_offset(pixel, 0, from)], n * m_samplesize);
+        }
+    }
+
+    // Lay out allocated storage anew, compacted, with the given capacity
+    // for each pixel (none less than its number of samples) and in the
+    // given layout, plus 'spare' extra slots at the end, moving every
+    // pixel's samples into place. This is a single pass over the data,
+    // however many pixels change.
+    void relayout(std::vector<unsigned int>& capacity, bool planar,
+                  size_t spare = 0)
+    {
+        DASSERT(m_allocated);
+        size_t npixels = m_capacity.size();
+        size_t nchans  = m_channelsizes.size();
+        std::vector<unsigned int> offset(npixels);
+        size_t used   = prefix_sum(capacity.data(), offset.data(), npixels);
+        size_t nslots = std::max(used + spare, m_reserve);
+        std::vector<char> data(nslots * m_samplesize);
+        std::vector<size_t> planes;
+        if (planar)
+            planes = plane_offsets(nslots);
+        parallel_for(0, int64_t(npixels), [&](int64_t p) {
+            size_t n = m_nsamples[p];
+            if (!n)
+                return;
+            if (!planar && !m_planar) {
+                memcpy(&data[offset[p] * m_samplesize],
+                       &m_data[m_offset[p] * m_samplesize], n * m_samplesize);
+                return;
+            }
+            for (size_t c = 0; c < nchans; ++c) {
+                size_t size      = m_channelsizes[c];
+                const char* src  = &m_data[data_offset(p, c, 0)];
+                size_t srcstride = sample_stride(c);
+                char* dst = &data[planar ? planes[c] + offset[p] * size
+                                         : offset[p] * m_samplesize
+                                               + m_channeloffsets[c]];
+                size_t dststride = planar ? size : m_samplesize;
+                if (srcstride == size && dststride == size)
+                    memcpy(dst, src, n * size);
+                else
+                    for (size_t i = 0; i < n; ++i)
+                        memcpy(dst + i * dststride, src + i * srcstride, size);
+            }
+        });
+        m_capacity.swap(capacity);
+        m_offset.swap(offset);
+        m_data.swap(data);
+        m_planeoffsets.swap(planes);
+        m_planar = planar;
+        m_nslots = nslots;
+        m_used   = used;
+        m_waste  = 0;
+    }
+
+    // Give an allocated pixel a larger capacity. This moves at most that
+    // pixel's samples, unless the arena is full and must be compacted.
+    void grow(int pixel, size_t newcap)
+    {
+        DASSERT(m_allocated && newcap > m_capacity[pixel]);
+        size_t oldcap = m_capacity[pixel];
+        size_t extra  = newcap - oldcap;
+        if (m_offset[pixel] + oldcap == m_used
+            && m_used + extra <= m_nslots) {
+            // Already the last pixel in the arena -- extend it in place
+            m_used += extra;
+        } else if (m_used + newcap <= m_nslots) {
+            // Move the pixel to fresh slots at the end of the arena
+            size_t n = m_nsamples[pixel];
+            for (int c = 0, nc = m_planar ? int(m_channelsizes.size()) : 1;
+                 c < nc && n; ++c)
+                memcpy(&m_data[slot_offset(m_used, c)],
+                       &m_data[data_offset(pixel, c, 0)],
+                       n * (m_planar ? m_channelsizes[c] : m_samplesize));
+            m_waste += oldcap;
+            m_offset[pixel] = (unsigned int)m_used;
+            m_used += newcap;
+        } else {
+            // Out of room: compact into a new arena with as much again to
+            // spare, so that it takes as much growth again to fill it.
+            std::vector<unsigned int> capacity(m_capacity);
+            capacity[pixel] = newcap;
+            size_t live     = m_used - m_waste + extra;
+            relayout(capacity, m_planar, live);
+            return;
+        }
+        m_capacity[pixel] = newcap;
     }
 
     void* data_ptr(int pixel, int channel, int sample)
@@ -142,10 +337,8 @@ public:
         return &m_data[offset];
     }
 
-    size_t total_capacity() const
-    {
-        return m_cumcapacity.back() + m_capacity.back();
-    }
+    // Are the pixels' slots back to back, with nothing spare?
+    bool compacted() const { return m_waste == 0 && m_used == m_nslots; }
 
     inline void sanity() const
     {
@@ -154,15 +347,18 @@ public:
         ASSERT(m_channeltypes.size() == m_channeloffsets.size());
         int npixels = int(m_capacity.size());
         ASSERT(m_nsamples.size() == m_capacity.size());
-        ASSERT(m_cumcapacity.size() == m_capacity.size());
+        ASSERT(m_offset.size() == m_capacity.size());
         if (m_allocated) {
             size_t totalcapacity = 0;
             for (int p = 0; p < npixels; ++p) {
-                ASSERT(m_cumcapacity[p] == totalcapacity);
+                ASSERT(m_offset[p] + m_capacity[p] <= m_used);
                 totalcapacity += m_capacity[p];
                 ASSERT(m_capacity[p] >= m_nsamples[p]);
             }
-            ASSERT(totalcapacity * m_samplesize == m_data.size());
+            ASSERT(totalcapacity + m_waste == m_used);
+            ASSERT(m_used <= m_nslots);
+            ASSERT(m_nslots * m_samplesize == m_data.size());
+            ASSERT(!m_planar || m_planeoffsets.size() == m_channelsizes.size());
         }
     }
 };
@@ -360,7 +556,7 @@ DeepData::init(int npix, int nchan, cspan<TypeDesc> channeltypes,
     m_impl->m_samplesize = 0;
     m_impl->m_nsamples.resize(m_npixels, 0);
     m_impl->m_capacity.resize(m_npixels, 0);
-    m_impl->m_cumcapacity.resize(m_npixels, 0);
+    m_impl->m_offset.resize(m_npixels, 0);
 
     // Channel name hunt
     // First, find Z, Zback, A
@@ -500,22 +696,8 @@ DeepData::set_capacity(int pixel, int samps)
     if (m_impl->m_allocated) {
         // Data already allocated. Expand capacity if necessary, don't
         // contract. (FIXME?)
-        int n = (int)capacity(pixel);
-        if (samps > n) {
-            int toadd = samps - n;
-            if (m_impl->m_data.empty()) {
-                size_t newtotal = (m_impl->total_capacity() + toadd);
-                m_impl->m_data.resize(newtotal * samplesize());
-            } else {
-                size_t offset = m_impl->data_offset(pixel, 0, n);
-                m_impl->m_data.insert(m_impl->m_data.begin() + offset,
-                                      toadd * samplesize(), 0);
-            }
-            // Adjust the cumulative prefix sum of samples for subsequent pixels
-            for (int p = pixel + 1; p < m_npixels; ++p)
-                m_impl->m_cumcapacity[p] += toadd;
-            m_impl->m_capacity[pixel] = samps;
-        }
+        if (samps > (int)capacity(pixel))
+            m_impl->grow(pixel, samps);
     } else {
         m_impl->m_capacity[pixel] = samps;
     }
@@ -563,9 +745,19 @@ DeepData::set_all_samples(cspan<unsigned int> samples)
         return;
     ASSERT(m_impl);
     if (m_impl->m_allocated) {
-        // Data already allocated: set pixels individually
-        for (int p = 0; p < m_npixels; ++p)
-            set_samples(p, int(samples[p]));
+        // Data already allocated: grow whichever pixels need more room all
+        // at once, after which setting the counts moves no data.
+        std::vector<unsigned int> newcap(m_impl->m_capacity);
+        bool grow = false;
+        for (int p = 0; p < m_npixels; ++p) {
+            if (samples[p] > newcap[p]) {
+                newcap[p] = samples[p];
+                grow      = true;
+            }
+        }
+        if (grow)
+            set_all_capacity(newcap);
+        m_impl->m_nsamples.assign(&samples[0], &samples[m_npixels]);
     } else {
         // Data not yet allocated: copy in one shot
         m_impl->m_nsamples.assign(&samples[0], &samples[m_npixels]);
@@ -575,25 +767,107 @@ DeepData::set_all_samples(cspan<unsigned int> samples)
 
 
 
+void
+DeepData::set_all_capacity(cspan<unsigned int> capacity)
+{
+    if (capacity.size() != m_npixels)
+        return;
+    ASSERT(m_impl);
+    spin_lock lock(m_impl->m_mutex);
+    // Capacity never drops below the samples already in use.
+    std::vector<unsigned int> newcap(m_npixels);
+    parallel_for(0, int64_t(m_npixels), [&](int64_t p) {
+        newcap[p] = std::max(capacity[p], m_impl->m_nsamples[p]);
+    });
+    if (m_impl->m_allocated)
+        m_impl->relayout(newcap, m_impl->m_planar);
+    else
+        m_impl->m_capacity.swap(newcap);
+}
+
+
+
+void
+DeepData::reserve_total(size_t totalsamples)
+{
+    ASSERT(m_impl);
+    spin_lock lock(m_impl->m_mutex);
+    m_impl->m_reserve = totalsamples;
+    if (m_impl->m_allocated && totalsamples > m_impl->m_nslots) {
+        std::vector<unsigned int> capacity(m_impl->m_capacity);
+        m_impl->relayout(capacity, m_impl->m_planar);
+    }
+}
+
+
+
+void
+DeepData::compact()
+{
+    ASSERT(m_impl);
+    spin_lock lock(m_impl->m_mutex);
+    m_impl->m_reserve = 0;
+    if (m_impl->m_allocated && !m_impl->compacted()) {
+        std::vector<unsigned int> capacity(m_impl->m_capacity);
+        m_impl->relayout(capacity, m_impl->m_planar);
+    }
+}
+
+
+
+bool
+DeepData::planar() const
+{
+    return m_impl && m_impl->m_planar;
+}
+
+
+
+void
+DeepData::set_planar(bool planar)
+{
+    ASSERT(m_impl);
+    spin_lock lock(m_impl->m_mutex);
+    if (planar == m_impl->m_planar)
+        return;
+    if (m_impl->m_allocated) {
+        std::vector<unsigned int> capacity(m_impl->m_capacity);
+        m_impl->relayout(capacity, planar);
+    } else {
+        m_impl->m_planar = planar;
+    }
+}
+
+
+
+size_t
+DeepData::samplestride(int c) const
+{
+    DASSERT(m_impl);
+    return (c >= 0 && c < m_nchannels) ? m_impl->sample_stride(c) : 0;
+}
+
+
+
 void
 DeepData::insert_samples(int pixel, int samplepos, int n)
 {
     int oldsamps = samples(pixel);
-    if (oldsamps + n > int(m_impl->m_capacity[pixel]))
-        set_capacity(pixel, oldsamps + n);
+    int cap      = int(m_impl->m_capacity[pixel]);
+    if (oldsamps + n > cap) {
+        // Grow geometrically, so that adding samples one at a time to a
+        // pixel doesn't move it every time.
+        set_capacity(pixel, std::max(oldsamps + n, cap + cap / 2));
+    }
     // set_capacity is thread-safe, it locks internally. Once the capacity
     // is adjusted, we can alter nsamples or copy the data around within
     // the pixel without a lock, we presume that if multiple threads are
     // in play, they are working on separate pixels.
     if (m_impl->m_allocated) {
         // Move the data
-        if (samplepos < oldsamps) {
-            size_t offset = m_impl->data_offset(pixel, 0, samplepos);
-            size_t end    = m_impl->data_offset(pixel, 0, oldsamps);
-            std::copy_backward(m_impl->m_data.begin() + offset,
-                               m_impl->m_data.begin() + end,
-                               m_impl->m_data.begin() + end + n * samplesize());
-        }
+        if (samplepos < oldsamps)
+            m_impl->move_samples(pixel, samplepos, samplepos + n,
+                                 oldsamps - samplepos);
     }
     // Add to this pixel's sample count
     m_impl->m_nsamples[pixel] += n;
@@ -610,12 +884,9 @@ DeepData::erase_samples(int pixel, int samplepos, int n)
     n = std::min(n, int(m_impl->m_nsamples[pixel]));
     if (m_impl->m_allocated) {
         // Move the data
-        int oldsamps  = samples(pixel);
-        size_t offset = m_impl->data_offset(pixel, 0, samplepos);
-        size_t end    = m_impl->data_offset(pixel, 0, oldsamps);
-        std::copy(m_impl->m_data.begin() + offset + n * samplesize(),
-                  m_impl->m_data.begin() + end,
-                  m_impl->m_data.begin() + offset);
+        int oldsamps = samples(pixel);
+        m_impl->move_samples(pixel, samplepos + n, samplepos,
+                             oldsamps - samplepos - n);
     }
     m_impl->m_nsamples[pixel] -= n;
 }
@@ -835,6 +1106,8 @@ DeepData::all_data() const
 {
     ASSERT(m_impl);
     m_impl->alloc(m_npixels);
+    if (!m_impl->compacted())
+        const_cast<DeepData*>(this)->compact();
     return m_impl->m_data;
 }
 
@@ -846,15 +1119,22 @@ DeepData::get_pointers(std::vector<void*>& pointers) const
     ASSERT(m_impl);
     m_impl->alloc(m_npixels);
     pointers.resize(pixels() * channels());
-    for (int i = 0; i < m_npixels; ++i) {
-        if (m_impl->m_nsamples[i])
-            for (int c = 0; c < m_nchannels; ++c)
-                pointers[i * m_nchannels + c] = (void*)m_impl->data_ptr(i, c,
-                                                                        0);
-        else
-            for (int c = 0; c < m_nchannels; ++c)
-                pointers[i * m_nchannels + c] = NULL;
-    }
+    // A deep image may have many millions of pixels, so fill in the
+    // pointers for blocks of them in parallel.
+    const Impl& impl(*m_impl);
+    char* data = const_cast<char*>(impl.m_data.data());
+    int nchans = m_nchannels;
+    parallel_for_chunked(0, m_npixels, 0, [&](int64_t b, int64_t e) {
+        for (int64_t p = b; p < e; ++p) {
+            void** ptr = &pointers[p * nchans];
+            if (impl.m_nsamples[p])
+                for (int c = 0; c < nchans; ++c)
+                    ptr[c] = data + impl.slot_offset(impl.m_offset[p], c);
+            else
+                for (int c = 0; c < nchans; ++c)
+                    ptr[c] = NULL;
+        }
+    });
 }
 
 
@@ -910,10 +1190,14 @@ DeepData::copy_deep_pixel(int pixel, const DeepData& src, int srcpixel)
     if (sametypes)
         for (int c = 0; c < nchans; ++c)
             sametypes &= (channeltype(c) == src.channeltype(c));
-    if (sametypes)
+    if (sametypes && !planar() && !src.planar())
         memcpy(data_ptr(pixel, 0, 0), src.data_ptr(srcpixel, 0, 0),
                samplesize() * nsamples);
-    else {
+    else if (sametypes && planar() && src.planar()) {
+        for (int c = 0; c < nchans; ++c)
+            memcpy(data_ptr(pixel, c, 0), src.data_ptr(srcpixel, c, 0),
+                   channelsize(c) * nsamples);
+    } else {
         for (int c = 0; c < nchans; ++c) {
             if (channeltype(c) == TypeDesc::UINT32
                 && src.channeltype(c) == TypeDesc::UINT32)
@@ -1007,35 +1291,28 @@ DeepData::split(int pixel, float depth)
 
 namespace {
 
-// Comparitor functor for depth sorting sample indices of a deep pixel.
+// Comparitor functor for depth sorting sample indices of a deep pixel,
+// given the pixel's z and zback values gathered into arrays.
 class SampleComparator {
 public:
-    SampleComparator(const DeepData& dd, int pixel, int zchan, int zbackchan)
-        : deepdata(dd)
-        , pixel(pixel)
-        , zchan(zchan)
-        , zbackchan(zbackchan)
+    SampleComparator(const float* z, const float* zback)
+        : z(z)
+        , zback(zback)
     {
     }
     bool operator()(int i, int j) const
     {
         // If either has a lower z, that's the lower
-        float iz = deepdata.deep_value(pixel, zchan, i);
-        float jz = deepdata.deep_value(pixel, zchan, j);
-        if (iz < jz)
+        if (z[i] < z[j])
             return true;
-        if (iz > jz)
+        if (z[i] > z[j])
             return false;
         // If both z's are equal, sort based on zback
-        float izb = deepdata.deep_value(pixel, zbackchan, i);
-        float jzb = deepdata.deep_value(pixel, zbackchan, j);
-        return izb < jzb;
+        return zback[i] < zback[j];
     }
 
 private:
-    const DeepData& deepdata;
-    int pixel;
-    int zchan, zbackchan;
+    const float *z, *zback;
 };
 
 }  // namespace
@@ -1057,15 +1334,34 @@ DeepData::sort(int pixel)
 
     // Ick, std::sort and friends take a custom comparator, but not a custom
     // swapper, so there's no way to std::sort a data type whose size is not
-    // known at compile time. So we just sort the indices!
+    // known at compile time. So we just sort the indices! Gather the depths
+    // up front so the comparisons don't each go through deep_value().
+    float* z     = OIIO_ALLOCA(float, 2 * nsamples);
+    float* zback = z + nsamples;
+    for (int i = 0; i < nsamples; ++i) {
+        z[i]     = deep_value(pixel, zchan, i);
+        zback[i] = deep_value(pixel, zbackchan, i);
+    }
     int* sample_indices = OIIO_ALLOCA(int, nsamples);
     std::iota(sample_indices, sample_indices + nsamples, 0);
     std::stable_sort(sample_indices, sample_indices + nsamples,
-                     SampleComparator(*this, pixel, zchan, zbackchan));
+                     SampleComparator(z, zback));
 
     // Now copy around using a temp buffer
     size_t samplebytes = samplesize();
     char* tmppixel     = OIIO_ALLOCA(char, samplebytes* nsamples);
+    if (planar()) {
+        // One channel at a time, each a contiguous run of values
+        for (int c = 0; c < m_nchannels; ++c) {
+            size_t size = channelsize(c);
+            char* chan  = (char*)data_ptr(pixel, c, 0);
+            memcpy(tmppixel, chan, size * nsamples);
+            for (int i = 0; i < nsamples; ++i)
+                memcpy(chan + size * i, tmppixel + size * sample_indices[i],
+                       size);
+        }
+        return;
+    }
     memcpy(tmppixel, data_ptr(pixel, 0, 0), samplebytes * nsamples);
     for (int i = 0; i < nsamples; ++i)
         memcpy(data_ptr(pixel, 0, i),
@@ -1174,6 +1174,105 @@ decode_exif(const void* exif, int length, ImageSpec& spec)
 
 
 
+MetadataHint
+metadata_hint(const ImageSpec& config)
+{
+    string_view hint = config.get_string_attribute("oiio:metadata", "full");
+    if (Strutil::iequals(hint, "lazy"))
+        return MetadataHint::Lazy;
+    if (Strutil::iequals(hint, "none"))
+        return MetadataHint::None;
+    return MetadataHint::Full;
+}
+
+
+
+// Names of the attributes that hold undecoded metadata blocks for
+// decode_metadata().
+static const char* exif_blob_name = "oiio:ExifBlob";
+static const char* xmp_blob_name  = "oiio:XMPBlob";
+static const char* iptc_blob_name = "oiio:IPTCBlob";
+
+
+
+// Stash a raw metadata block in spec to be decoded later, returning false
+// (and storing nothing) if an earlier block of the same kind is already
+// waiting, in which case the caller should just decode this one now.
+static bool
+stash_blob(ImageSpec& spec, const char* name, cspan<uint8_t> blob)
+{
+    if (spec.find_attribute(name))
+        return false;
+    spec.attribute(name, TypeDesc(TypeDesc::UINT8, blob.size()), blob.data());
+    return true;
+}
+
+
+
+bool
+decode_exif(string_view exif, ImageSpec& spec, MetadataHint hint)
+{
+    cspan<uint8_t> blob((const uint8_t*)exif.data(), exif.size());
+    if (hint == MetadataHint::None)
+        return true;
+    if (hint == MetadataHint::Lazy && stash_blob(spec, exif_blob_name, blob))
+        return true;
+    return decode_exif(blob, spec);
+}
+
+
+
+bool
+decode_xmp(string_view xml, ImageSpec& spec, MetadataHint hint)
+{
+    cspan<uint8_t> blob((const uint8_t*)xml.data(), xml.size());
+    if (hint == MetadataHint::None)
+        return true;
+    if (hint == MetadataHint::Lazy && stash_blob(spec, xmp_blob_name, blob))
+        return true;
+    return decode_xmp(std::string(xml), spec);
+}
+
+
+
+bool
+decode_iptc_iim(const void* iptc, int length, ImageSpec& spec,
+                MetadataHint hint)
+{
+    cspan<uint8_t> blob((const uint8_t*)iptc, length);
+    if (hint == MetadataHint::None)
+        return true;
+    if (hint == MetadataHint::Lazy && stash_blob(spec, iptc_blob_name, blob))
+        return true;
+    return decode_iptc_iim(iptc, length, spec);
+}
+
+
+
+bool
+decode_metadata(ImageSpec& spec)
+{
+    // Each block is copied out and erased before it's decoded, since
+    // decoding adds attributes and may move the one we're looking at.
+    bool ok = true;
+    for (const char* name : { exif_blob_name, iptc_blob_name, xmp_blob_name }) {
+        const ParamValue* p = spec.find_attribute(name);
+        if (!p)
+            continue;
+        std::string blob((const char*)p->data(), p->type().size());
+        spec.erase_attribute(name);
+        if (name == exif_blob_name)
+            ok &= decode_exif(string_view(blob), spec);
+        else if (name == iptc_blob_name)
+            ok &= decode_iptc_iim(blob.data(), int(blob.size()), spec);
+        else
+            ok &= decode_xmp(blob, spec);
+    }
+    return ok;
+}
+
+
+
 template<class T>
 inline void
 append(std::vector<char>& blob, const T& v)
@@ -355,10 +355,8 @@ ImageSpec::attribute(string_view name, TypeDesc type, const void* value)
         return;
     // Don't allow duplicates
     ParamValue* f = find_attribute(name);
-    if (!f) {
-        extra_attribs.resize(extra_attribs.size() + 1);
-        f = &extra_attribs.back();
-    }
+    if (!f)
+        f = &extra_attribs.grow();
     f->init(name, type, 1, value);
 }
 
@@ -374,7 +372,7 @@ ImageSpec::attribute(string_view name, TypeDesc type, string_view value)
     if (f) {
         *f = ParamValue(name, type, value);
     } else {
-        extra_attribs.emplace_back(name, type, value);
+        extra_attribs.grow() = ParamValue(name, type, value);
     }
 }
 
@@ -405,6 +403,7 @@ ImageSpec::erase_attribute(string_view name, TypeDesc searchtype,
         auto del = std::remove_if(extra_attribs.begin(), extra_attribs.end(),
                                   matcher);
         extra_attribs.erase(del, extra_attribs.end());
+        extra_attribs.invalidate_index();
     } catch (...) {
         return;
     }
@@ -1117,6 +1116,276 @@ ImageSpec::from_xml(const char* xml)
 
 
 
+namespace {  // Helpers for the to_binary() and from_binary() methods.
+
+// The binary encoding starts with the magic number and version, then the
+// total length of the block, all as little-endian integers, as is every
+// number that follows. Metadata values are padded to start on 8-byte
+// boundaries (relative to the start of the block) so that from_binary can
+// point right at them.
+static const uint32_t binary_magic   = 0x4253494f;  // "OISB"
+static const uint32_t binary_version = 1;
+static const size_t binary_header_size = 16;
+
+// Byte-swap n values of basetype size bytes each, in place.
+inline void
+swap_values(void* data, size_t basesize, size_t n)
+{
+    if (basesize == 2)
+        swap_endian((uint16_t*)data, int(n));
+    else if (basesize == 4)
+        swap_endian((uint32_t*)data, int(n));
+    else if (basesize == 8)
+        swap_endian((uint64_t*)data, int(n));
+}
+
+
+
+class BinaryWriter {
+public:
+    BinaryWriter(std::vector<char>& blob)
+        : m_blob(blob)
+        , m_start(blob.size())
+    {
+    }
+    size_t size() const { return m_blob.size() - m_start; }
+    void bytes(const void* data, size_t len)
+    {
+        m_blob.insert(m_blob.end(), (const char*)data,
+                      (const char*)data + len);
+    }
+    template<typename T> void number(T val)
+    {
+        if (bigendian())
+            swap_endian(&val);
+        bytes(&val, sizeof(T));
+    }
+    void string(string_view s)
+    {
+        number(uint32_t(s.size()));
+        bytes(s.data(), s.size());
+    }
+    void type(TypeDesc t)
+    {
+        unsigned char b[4] = { t.basetype, t.aggregate, t.vecsemantics,
+                               t.reserved };
+        bytes(b, 4);
+        number(int32_t(t.arraylen));
+    }
+    void align8() { m_blob.resize(m_start + ((size() + 7) & ~size_t(7))); }
+    // Fill in the total length in the header.
+    void finish()
+    {
+        uint64_t len = size();
+        if (bigendian())
+            swap_endian(&len);
+        memcpy(&m_blob[m_start + 8], &len, sizeof(len));
+    }
+
+private:
+    std::vector<char>& m_blob;
+    size_t m_start;
+};
+
+
+
+class BinaryReader {
+public:
+    BinaryReader(cspan<char> data)
+        : m_data(data)
+    {
+    }
+    bool ok() const { return m_ok; }
+    size_t pos() const { return m_pos; }
+    // Return a pointer to the next len bytes and skip past them, or
+    // nullptr if there aren't that many left.
+    const char* bytes(size_t len)
+    {
+        if (!m_ok || len > size_t(m_data.size()) - m_pos) {
+            m_ok = false;
+            return nullptr;
+        }
+        const char* p = m_data.data() + m_pos;
+        m_pos += len;
+        return p;
+    }
+    template<typename T> T number()
+    {
+        T val         = T(0);
+        const char* p = bytes(sizeof(T));
+        if (p) {
+            memcpy(&val, p, sizeof(T));
+            if (bigendian())
+                swap_endian(&val);
+        }
+        return val;
+    }
+    string_view string()
+    {
+        uint32_t len  = number<uint32_t>();
+        const char* p = bytes(len);
+        return p ? string_view(p, len) : string_view();
+    }
+    TypeDesc type()
+    {
+        TypeDesc t;
+        const unsigned char* b = (const unsigned char*)bytes(4);
+        int arraylen           = number<int32_t>();
+        if (b) {
+            t.basetype     = b[0];
+            t.aggregate    = b[1];
+            t.vecsemantics = b[2];
+            t.reserved     = b[3];
+            t.arraylen     = arraylen;
+            if (t.basetype >= TypeDesc::PTR || arraylen < 0)
+                m_ok = false;
+        }
+        return t;
+    }
+    void align8() { bytes(((m_pos + 7) & ~size_t(7)) - m_pos); }
+
+private:
+    cspan<char> m_data;
+    size_t m_pos = 0;
+    bool m_ok    = true;
+};
+
+}  // namespace
+
+
+
+void
+ImageSpec::to_binary(std::vector<char>& blob) const
+{
+    BinaryWriter w(blob);
+    w.number(binary_magic);
+    w.number(binary_version);
+    w.number(uint64_t(0));  // total length, filled in by finish()
+    for (int v : { x, y, z, width, height, depth, full_x, full_y, full_z,
+                   full_width, full_height, full_depth, tile_width,
+                   tile_height, tile_depth, nchannels, alpha_channel,
+                   z_channel, int(deep) })
+        w.number(int32_t(v));
+    w.type(format);
+    w.number(uint32_t(channelformats.size()));
+    for (TypeDesc t : channelformats)
+        w.type(t);
+    w.number(uint32_t(channelnames.size()));
+    for (const std::string& name : channelnames)
+        w.string(name);
+    // Pointers mean nothing outside this process, so they are left out.
+    uint32_t nattribs = 0;
+    for (const ParamValue& p : extra_attribs)
+        nattribs += (p.type().basetype != TypeDesc::PTR);
+    w.number(nattribs);
+    for (const ParamValue& p : extra_attribs) {
+        if (p.type().basetype == TypeDesc::PTR)
+            continue;
+        w.string(p.name());
+        w.type(p.type());
+        w.number(int32_t(p.nvalues()));
+        w.number(uint8_t(p.interp()));
+        size_t n = size_t(p.nvalues()) * p.type().basevalues();
+        if (p.type().basetype == TypeDesc::STRING) {
+            for (size_t i = 0; i < n; ++i)
+                w.string(((const ustring*)p.data())[i]);
+        } else {
+            w.align8();
+            size_t start = blob.size();
+            w.bytes(p.data(), size_t(p.datasize()));
+            if (bigendian())
+                swap_values(&blob[start], p.type().basesize(), n);
+        }
+    }
+    w.align8();  // so that blocks written back to back stay aligned
+    w.finish();
+}
+
+
+
+size_t
+ImageSpec::from_binary(cspan<char> data, bool copy)
+{
+    BinaryReader r(data);
+    uint32_t magic   = r.number<uint32_t>();
+    uint32_t version = r.number<uint32_t>();
+    uint64_t length  = r.number<uint64_t>();
+    if (!r.ok() || magic != binary_magic || version != binary_version
+        || length < binary_header_size || length > uint64_t(data.size()))
+        return 0;
+    r = BinaryReader(cspan<char>(data.data(), length));
+    r.bytes(binary_header_size);
+    // Values can only be referenced in place if they are in our byte
+    // order and suitably aligned.
+    if (bigendian() || (uintptr_t(data.data()) & 7))
+        copy = true;
+
+    ImageSpec spec;
+    int32_t* fields[] = { &spec.x,           &spec.y,
+                          &spec.z,           &spec.width,
+                          &spec.height,      &spec.depth,
+                          &spec.full_x,      &spec.full_y,
+                          &spec.full_z,      &spec.full_width,
+                          &spec.full_height, &spec.full_depth,
+                          &spec.tile_width,  &spec.tile_height,
+                          &spec.tile_depth,  &spec.nchannels,
+                          &spec.alpha_channel, &spec.z_channel };
+    for (int32_t* f : fields)
+        *f = r.number<int32_t>();
+    spec.deep   = r.number<int32_t>() != 0;
+    spec.format = r.type();
+    uint32_t nformats = r.number<uint32_t>();
+    for (uint32_t i = 0; i < nformats && r.ok(); ++i)
+        spec.channelformats.push_back(r.type());
+    uint32_t nnames = r.number<uint32_t>();
+    for (uint32_t i = 0; i < nnames && r.ok(); ++i)
+        spec.channelnames.emplace_back(r.string());
+    uint32_t nattribs = r.number<uint32_t>();
+    if (r.ok())
+        spec.extra_attribs.reserve(std::min(size_t(nattribs), length / 16));
+    std::vector<ustring> strings;
+    for (uint32_t a = 0; a < nattribs && r.ok(); ++a) {
+        ustring name(r.string());
+        TypeDesc type = r.type();
+        int nvalues   = r.number<int32_t>();
+        auto interp   = ParamValue::Interp(r.number<uint8_t>());
+        if (nvalues < 0)
+            return 0;
+        size_t n = size_t(nvalues) * type.basevalues();
+        if (!r.ok() || n > length)
+            return 0;
+        if (type.basetype == TypeDesc::STRING) {
+            strings.clear();
+            for (size_t i = 0; i < n && r.ok(); ++i)
+                strings.emplace_back(r.string());
+            if (!r.ok())
+                return 0;
+            spec.extra_attribs.emplace_back(name, type, nvalues, interp,
+                                            strings.data());
+        } else {
+            r.align8();
+            const char* values = r.bytes(n * type.basesize());
+            if (!values)
+                return 0;
+            if (bigendian()) {
+                std::vector<char> swapped(values, values + n * type.basesize());
+                swap_values(swapped.data(), type.basesize(), n);
+                spec.extra_attribs.emplace_back(name, type, nvalues, interp,
+                                                swapped.data());
+            } else {
+                spec.extra_attribs.emplace_back(name, type, nvalues, interp,
+                                                values, copy);
+            }
+        }
+    }
+    if (!r.ok())
+        return 0;
+    *this = std::move(spec);
+    return size_t(length);
+}
+
+
+
 bool
 pvt::check_texture_metadata_sanity(ImageSpec& spec)
 {
@@ -59,6 +59,23 @@ OIIO_NAMESPACE_BEGIN
 static atomic_ll IB_local_mem_current;
 
 
+// Releases local pixels to wherever pvt::pixelpool_alloc got them. Local
+// pixel memory may be shared by several ImageBufs (copy-on-write), so the
+// accounting is done when the last reference goes away, not per ImageBuf.
+struct PixelDeleter {
+    size_t size     = 0;
+    size_t capacity = 0;
+    void operator()(char* p) const
+    {
+        IB_local_mem_current -= size;
+        if (size && pvt::oiio_print_debug > 1)
+            OIIO::debug("IB freed %d MB, global IB memory now %d MB\n",
+                        size >> 20, IB_local_mem_current >> 20);
+        pvt::pixelpool_free(p, capacity);
+    }
+};
+
+
 
 ROI
 get_roi(const ImageSpec& spec)
@@ -111,7 +128,9 @@ class ImageBufImpl {
 public:
     ImageBufImpl(string_view filename, int subimage, int miplevel,
                  ImageCache* imagecache = NULL, const ImageSpec* spec = NULL,
-                 void* buffer = NULL, const ImageSpec* config = NULL);
+                 void* buffer = NULL, const ImageSpec* config = NULL,
+                 stride_t xstride = AutoStride, stride_t ystride = AutoStride,
+                 stride_t zstride = AutoStride);
     ImageBufImpl(const ImageBufImpl& src);
     ~ImageBufImpl();
 
@@ -130,6 +149,12 @@ public:
               bool force = false, TypeDesc convert = TypeDesc::UNKNOWN,
               ProgressCallback progress_callback = nullptr,
               void* progress_callback_data       = nullptr);
+    // Read the pixels from in (channels [chbegin,chend) of the given
+    // subimage and miplevel, as type convert) into the local pixels,
+    // applying processor to each band of scanlines as it's read.
+    bool read_colorconverted(ImageInput* in, int subimage, int miplevel,
+                             int chbegin, int chend, TypeDesc convert,
+                             const ColorProcessor* processor);
     void copy_metadata(const ImageBufImpl& src);
 
     template<typename... Args>
@@ -271,8 +296,8 @@ private:
     mutable int m_threads;          ///< thread policy for this image
     ImageSpec m_spec;               ///< Describes the image (size, etc)
     ImageSpec m_nativespec;         ///< Describes the true native image
-    std::unique_ptr<char[]> m_pixels;  ///< Pixel data, if local and we own it
-    char* m_localpixels;               ///< Pointer to local pixels
+    std::shared_ptr<char> m_pixels;  ///< Owned local pixels (maybe shared)
+    char* m_localpixels;             ///< Pointer to local pixels
     mutable spin_mutex m_valid_mutex;
     mutable bool m_spec_valid;    ///< Is the spec valid
     mutable bool m_pixels_valid;  ///< Image is valid
@@ -299,6 +324,12 @@ private:
     char* new_pixels(size_t size, const void* data = nullptr);
     // Private release of m_pixels.
     void free_pixels();
+    // Make *this refer to the same local pixel memory as src, which must
+    // own its pixels. The pixels are shared until either one writes.
+    void share_pixels(const ImageBufImpl& src);
+    // If the local pixels are shared with another ImageBuf, make a private
+    // copy of them so that they may be safely modified.
+    void unshare_pixels();
 
     const ImageBufImpl operator=(const ImageBufImpl& src);  // unimplemented
     friend class ImageBuf;
@@ -308,7 +339,8 @@ private:
 
 ImageBufImpl::ImageBufImpl(string_view filename, int subimage, int miplevel,
                            ImageCache* imagecache, const ImageSpec* spec,
-                           void* buffer, const ImageSpec* config)
+                           void* buffer, const ImageSpec* config,
+                           stride_t xstride, stride_t ystride, stride_t zstride)
     : m_storage(ImageBuf::UNINITIALIZED)
     , m_name(filename)
     , m_nsubimages(0)
@@ -345,9 +377,16 @@ ImageBufImpl::ImageBufImpl(string_view filename, int subimage, int miplevel,
                             0);
         // NB make it big enough for SSE
         if (buffer) {
-            m_localpixels  = (char*)buffer;
-            m_storage      = ImageBuf::APPBUFFER;
-            m_pixels_valid = true;
+            // App buffers may have arbitrary (positive) strides.
+            ImageSpec::auto_stride(xstride, ystride, zstride, spec->format,
+                                   spec->nchannels, spec->width,
+                                   spec->height);
+            m_pixel_bytes    = size_t(xstride);
+            m_scanline_bytes = size_t(ystride);
+            m_plane_bytes    = size_t(zstride);
+            m_localpixels    = (char*)buffer;
+            m_storage        = ImageBuf::APPBUFFER;
+            m_pixels_valid   = true;
         } else {
             m_storage = ImageBuf::LOCALBUFFER;
         }
@@ -405,8 +444,11 @@ ImageBufImpl::ImageBufImpl(const ImageBufImpl& src)
             // Source just wrapped the client app's pixels, we do the same
             m_localpixels = src.m_localpixels;
         } else {
-            // We own our pixels -- copy from source
-            new_pixels(src.m_spec.image_bytes(), src.m_pixels.get());
+            // We own our pixels -- share them with the source until one
+            // of us writes to them.
+            m_pixels         = src.m_pixels;
+            m_localpixels    = src.m_localpixels;
+            m_allocated_size = src.m_allocated_size;
         }
     } else {
         // Source was cache-based or deep
@@ -483,6 +525,15 @@ ImageBuf::ImageBuf(const ImageSpec& spec, void* buffer)
 
 
 
+ImageBuf::ImageBuf(const ImageSpec& spec, void* buffer, stride_t xstride,
+                   stride_t ystride, stride_t zstride)
+    : m_impl(new ImageBufImpl("", 0, 0, NULL, &spec, buffer, NULL, xstride,
+                              ystride, zstride))
+{
+}
+
+
+
 ImageBuf::ImageBuf(const ImageBuf& src)
     : m_impl(new ImageBufImpl(*src.impl()))
 {
@@ -525,7 +576,11 @@ ImageBufImpl::new_pixels(size_t size, const void* data)
     if (m_allocated_size)
         free_pixels();
     m_allocated_size = size;
-    m_pixels.reset(size ? new char[size] : nullptr);
+    if (size) {
+        PixelDeleter deleter;
+        deleter.size = size;
+        m_pixels.reset(pvt::pixelpool_alloc(size, deleter.capacity), deleter);
+    }
     IB_local_mem_current += m_allocated_size;
     if (data && size)
         memcpy(m_pixels.get(), data, size);
@@ -541,17 +596,56 @@ ImageBufImpl::new_pixels(size_t size, const void* data)
 void
 ImageBufImpl::free_pixels()
 {
-    IB_local_mem_current -= m_allocated_size;
     m_pixels.reset();
-    if (m_allocated_size && pvt::oiio_print_debug > 1)
-        OIIO::debug("IB freed %d MB, global IB memory now %d MB\n",
-                    m_allocated_size >> 20, IB_local_mem_current >> 20);
+    m_localpixels    = nullptr;
     m_allocated_size = 0;
     m_storage        = ImageBuf::UNINITIALIZED;
 }
 
 
 
+void
+ImageBufImpl::share_pixels(const ImageBufImpl& src)
+{
+    DASSERT(src.m_storage == ImageBuf::LOCALBUFFER && src.m_pixels);
+    clear();
+    m_name             = src.m_name;
+    m_current_subimage = 0;
+    m_current_miplevel = 0;
+    m_spec             = src.m_spec;
+    m_nativespec       = src.m_nativespec;
+    m_pixel_bytes      = src.m_pixel_bytes;
+    m_scanline_bytes   = src.m_scanline_bytes;
+    m_plane_bytes      = src.m_plane_bytes;
+    m_channel_bytes    = src.m_channel_bytes;
+    m_blackpixel       = src.m_blackpixel;
+    m_pixels           = src.m_pixels;
+    m_localpixels      = src.m_localpixels;
+    m_allocated_size   = src.m_allocated_size;
+    m_storage          = ImageBuf::LOCALBUFFER;
+    m_spec_valid       = true;
+    m_pixels_valid     = true;
+}
+
+
+
+void
+ImageBufImpl::unshare_pixels()
+{
+    // Several threads may be about to write the same ImageBuf (e.g.,
+    // Iterators constructed within a parallel_image), so only one of them
+    // does the copy.
+    spin_lock lock(m_valid_mutex);
+    if (m_pixels && m_pixels.use_count() > 1) {
+        // Hold a reference so the shared memory can't disappear mid-copy
+        // if the other owners let go of it.
+        std::shared_ptr<char> shared = m_pixels;
+        new_pixels(m_allocated_size, shared.get());
+    }
+}
+
+
+
 static spin_mutex err_mutex;  ///< Protect m_err fields
 
 
@@ -615,8 +709,7 @@ ImageBufImpl::clear()
     m_current_miplevel = -1;
     m_spec             = ImageSpec();
     m_nativespec       = ImageSpec();
-    m_pixels.reset();
-    m_localpixels    = NULL;
+    free_pixels();
     m_spec_valid     = false;
     m_pixels_valid   = false;
     m_badfile        = false;
@@ -885,6 +978,27 @@ ImageBufImpl::read(int subimage, int miplevel, int chbegin, int chend,
 
     m_pixelaspect = m_spec.get_float_attribute("pixelaspectratio", 1.0f);
 
+    // The "oiio:TargetColorSpace" hint asks for float pixels converted to
+    // that color space as they're read. The ImageCache does that itself if
+    // it got the hint (it may have already had the file without it);
+    // otherwise we read directly, converting a band at a time.
+    ustring target;
+    ColorProcessorHandle processor
+        = pvt::read_colorprocessor(m_configspec.get(), m_nativespec, target);
+    if (target.size() && !processor) {
+        error("Could not construct the color transform %s -> %s",
+              m_nativespec.get_string_attribute("oiio:ColorSpace", "Linear"),
+              target);
+        return false;
+    }
+    if (processor) {
+        if (convert == TypeDesc::UNKNOWN)
+            convert = TypeDesc::FLOAT;
+        if (!Strutil::iequals(m_spec.get_string_attribute("oiio:ColorSpace"),
+                              target))
+            force = true;
+    }
+
     // If we don't already have "local" pixels, and we aren't asking to
     // convert the pixels to a specific (and different) type, then take an
     // early out by relying on the cache.
@@ -964,11 +1078,17 @@ ImageBufImpl::read(int subimage, int miplevel, int chbegin, int chend,
                 ImageSpec newspec;
                 ok &= in->seek_subimage(subimage, miplevel, newspec);
             }
-            if (ok)
+            if (ok && processor)
+                ok &= read_colorconverted(in.get(), subimage, miplevel,
+                                          chbegin, chend, convert,
+                                          processor.get());
+            else if (ok)
                 ok &= in->read_image(chbegin, chend, convert, m_localpixels);
             in->close();
             if (ok) {
                 m_pixels_valid = true;
+                if (processor)
+                    m_spec.attribute("oiio:ColorSpace", target);
             } else {
                 m_pixels_valid = false;
                 error("%s", in->geterror());
@@ -998,6 +1118,63 @@ ImageBufImpl::read(int subimage, int miplevel, int chbegin, int chend,
 
 
 
+bool
+ImageBufImpl::read_colorconverted(ImageInput* in, int subimage, int miplevel,
+                                  int chbegin, int chend, TypeDesc convert,
+                                  const ColorProcessor* processor)
+{
+    // Bands of about 1 MB (whole rows of tiles, for a tiled file) are
+    // converted while they are still in cache, rather than in another pass
+    // over the whole image. Volumes are just read whole, then converted.
+    const ImageSpec& spec(m_spec);
+    int rows = spec.height;
+    if (spec.depth == 1) {
+        rows = std::max(1, int((1 << 20) / std::max(m_scanline_bytes,
+                                                     size_t(1))));
+        if (spec.tile_width)
+            rows = round_to_multiple(rows, spec.tile_height);
+        rows = std::min(rows, spec.height);
+    }
+    int alpha = m_nativespec.alpha_channel;
+    ImageSpec bandspec(spec.width, rows, spec.nchannels, spec.format);
+    bandspec.depth         = spec.depth;
+    bandspec.alpha_channel = (alpha >= chbegin && alpha < chend)
+                                 ? alpha - chbegin
+                                 : -1;
+    if (m_configspec
+        && m_configspec->get_int_attribute("oiio:UnassociatedAlpha"))
+        bandspec.attribute("oiio:UnassociatedAlpha", 1);
+    for (int y = 0; y < spec.height; y += rows) {
+        int n      = std::min(rows, spec.height - y);
+        char* data = (char*)m_localpixels + y * m_scanline_bytes;
+        bool ok;
+        if (spec.depth > 1)
+            ok = in->read_image(subimage, miplevel, chbegin, chend, convert,
+                                data);
+        else if (spec.tile_width)
+            ok = in->read_tiles(subimage, miplevel, spec.x,
+                                spec.x + spec.width, spec.y + y,
+                                spec.y + y + n, spec.z, spec.z + 1, chbegin,
+                                chend, convert, data);
+        else
+            ok = in->read_scanlines(subimage, miplevel, spec.y + y,
+                                    spec.y + y + n, spec.z, chbegin, chend,
+                                    convert, data);
+        if (!ok)
+            return false;
+        bandspec.height = n;
+        ImageBuf band(bandspec, data);
+        if (!ImageBufAlgo::colorconvert(band, band, processor, true, ROI(),
+                                        threads())) {
+            error("%s", band.geterror());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
 bool
 ImageBuf::read(int subimage, int miplevel, bool force, TypeDesc convert,
                ProgressCallback progress_callback, void* progress_callback_data)
@@ -1048,8 +1225,10 @@ ImageBuf::write(ImageOutput* out, ProgressCallback progress_callback,
     const ImageSpec& outspec(out->spec());
     TypeDesc bufformat = spec().format;
     if (impl->m_localpixels) {
-        // In-core pixel buffer for the whole image
-        ok = out->write_image(bufformat, impl->m_localpixels, as, as, as,
+        // In-core pixel buffer for the whole image (which may be a
+        // non-contiguous view, so pass our strides)
+        ok = out->write_image(bufformat, impl->m_localpixels,
+                              pixel_stride(), scanline_stride(), z_stride(),
                               progress_callback, progress_callback_data);
     } else if (deep()) {
         // Deep image record
@@ -1218,6 +1397,7 @@ ImageBuf::make_writeable(bool keep_cache_type)
         return read(subimage(), miplevel(), 0, -1, true /*force*/,
                     keep_cache_type ? impl()->m_cachedpixeltype : TypeDesc());
     }
+    impl()->unshare_pixels();
     return true;
 }
 
@@ -1374,6 +1554,7 @@ void*
 ImageBuf::localpixels()
 {
     impl()->validate_pixels();
+    impl()->unshare_pixels();
     return impl()->m_localpixels;
 }
 
@@ -1412,6 +1593,20 @@ ImageBuf::z_stride() const
 
 
 
+bool
+ImageBuf::contiguous() const
+{
+    const ImageBufImpl* impl = this->impl();
+    if (!localpixels() || deep())
+        return false;
+    const ImageSpec& spec(impl->m_spec);
+    return impl->m_pixel_bytes == spec.pixel_bytes()
+           && impl->m_scanline_bytes == impl->m_pixel_bytes * spec.width
+           && impl->m_plane_bytes == impl->m_scanline_bytes * spec.height;
+}
+
+
+
 bool
 ImageBuf::cachedpixels() const
 {
@@ -1485,7 +1680,7 @@ copy_pixels_impl(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads = 0)
         int nchannels = roi.nchannels();
         if (is_same<D, S>::value) {
             // If both bufs are the same type, just directly copy the values
-            if (src.localpixels() && roi.chbegin == 0
+            if (src.contiguous() && dst.contiguous() && roi.chbegin == 0
                 && roi.chend == dst.nchannels()
                 && roi.chend == src.nchannels()) {
                 // Extra shortcut -- totally local pixels for src, copying all
@@ -1571,6 +1766,14 @@ ImageBuf::copy(const ImageBuf& src, TypeDesc format)
         impl()->m_deepdata = src.impl()->m_deepdata;
         return true;
     }
+    if (src.storage() == LOCALBUFFER && storage() != APPBUFFER
+        && (format.basetype == TypeDesc::UNKNOWN
+            || (format == src.spec().format
+                && src.spec().channelformats.empty()))) {
+        // Copy-on-write: share the pixel memory until one of us writes.
+        impl()->share_pixels(*src.impl());
+        return true;
+    }
     if (format.basetype == TypeDesc::UNKNOWN || src.deep())
         impl()->reset(src.name(), src.spec(), &src.nativespec());
     else {
@@ -1594,6 +1797,74 @@ ImageBuf::copy(TypeDesc format) const
 
 
 
+// Make result wrap the roi of src's local pixels.
+static void
+make_view(ImageBuf& result, const ImageBuf& src, ROI roi)
+{
+    if (!roi.defined())
+        roi = src.roi();
+    roi.chend = std::min(roi.chend, src.nchannels());
+    if (src.deep()) {
+        result.error("view() is not supported for deep images");
+        return;
+    }
+    if (!src.localpixels()) {
+        result.error("view() requires local pixels");
+        return;
+    }
+    if (!src.roi().contains(roi) || roi.nchannels() < 1) {
+        result.error("view() roi %s is not within the data window %s", roi,
+                     src.roi());
+        return;
+    }
+    ImageSpec spec = src.spec();
+    set_roi(spec, roi);
+    spec.nchannels = roi.nchannels();
+    spec.channelformats.clear();
+    spec.channelnames.erase(spec.channelnames.begin(),
+                            spec.channelnames.begin() + roi.chbegin);
+    spec.channelnames.resize(spec.nchannels);
+    if (spec.alpha_channel >= roi.chbegin && spec.alpha_channel < roi.chend)
+        spec.alpha_channel -= roi.chbegin;
+    else
+        spec.alpha_channel = -1;
+    if (spec.z_channel >= roi.chbegin && spec.z_channel < roi.chend)
+        spec.z_channel -= roi.chbegin;
+    else
+        spec.z_channel = -1;
+    void* base = const_cast<void*>(
+        src.pixeladdr(roi.xbegin, roi.ybegin, roi.zbegin, roi.chbegin));
+    result = ImageBuf(spec, base, src.pixel_stride(), src.scanline_stride(),
+                      src.z_stride());
+}
+
+
+
+ImageBuf
+ImageBuf::view(ROI roi)
+{
+    ImageBuf result;
+    // Read cached pixels, and make sure our pixels aren't shared with a
+    // copy, which would otherwise also see writes through the view.
+    if (make_writeable(true))
+        make_view(result, *this, roi);
+    else
+        result.error("%s", geterror());
+    return result;
+}
+
+
+
+const ImageBuf
+ImageBuf::view(ROI roi) const
+{
+    ImageBuf result;
+    make_view(result, *this, roi);
+    return result;
+}
+
+
+
 template<typename T>
 static inline float
 getchannel_(const ImageBuf& buf, int x, int y, int z, int c,
@@ -2313,6 +2584,7 @@ ImageBufImpl::pixeladdr(int x, int y, int z, int ch)
     validate_pixels();
     if (cachedpixels())
         return nullptr;
+    unshare_pixels();
     x -= m_spec.x;
     y -= m_spec.y;
     z -= m_spec.z;
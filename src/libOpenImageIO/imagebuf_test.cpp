@@ -463,6 +463,84 @@ test_write_exr_to_memory()
 
 
 
+// Round trip a small image through memory for each of the formats whose
+// readers and writers both accept an IOProxy.
+void
+test_ioproxy_roundtrip()
+{
+    std::cout << "\nTesting IOProxy write and read back for several formats\n";
+
+    ImageSpec spec(64, 48, 3, TypeUInt8);
+    ImageBuf src(spec);
+    float top[3] = { 0.25f, 0.5f, 0.75f }, bottom[3] = { 1.0f, 0.0f, 0.5f };
+    ImageBufAlgo::fill(src, top, bottom);
+
+    const char* names[] = { "test.png", "test.jpg", "test.tif" };
+    for (const char* name : names) {
+        std::vector<unsigned char> file_buffer;
+        Filesystem::IOVecOutput memout(file_buffer);
+        void* ptr = &memout;
+        ImageBuf buf;
+        buf.copy(src);
+        buf.specmod().attribute("oiio:ioproxy", TypeDesc::PTR, &ptr);
+        OIIO_CHECK_ASSERT(buf.write(name));
+        OIIO_CHECK_ASSERT(file_buffer.size() > 0);
+
+        Filesystem::IOMemReader memreader(file_buffer);
+        ImageSpec configspec;
+        ptr = &memreader;
+        configspec.attribute("oiio:ioproxy", TypeDesc::PTR, &ptr);
+        ImageBuf readbuf(name, 0, 0, nullptr, &configspec);
+        OIIO_CHECK_ASSERT(readbuf.read());
+        OIIO_CHECK_EQUAL(readbuf.spec().width, spec.width);
+        OIIO_CHECK_EQUAL(readbuf.spec().height, spec.height);
+        // JPEG is lossy, the others should be exact.
+        float tol = Strutil::ends_with(name, ".jpg") ? 0.05f : 0.0f;
+        auto comp = ImageBufAlgo::compare(readbuf, src, tol, tol);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// Read an image named by a URL, through a registered opener that serves
+// byte ranges out of memory, as an object store client would.
+void
+test_read_url()
+{
+    std::cout << "\nTesting reading images from URLs\n";
+
+    ImageSpec spec(32, 32, 3, TypeUInt8);
+    ImageBuf src(spec);
+    float top[3] = { 0.0f, 0.5f, 1.0f }, bottom[3] = { 1.0f, 0.5f, 0.0f };
+    ImageBufAlgo::fill(src, top, bottom);
+    std::vector<unsigned char> file_buffer;
+    Filesystem::IOVecOutput memout(file_buffer);
+    void* ptr = &memout;
+    src.specmod().attribute("oiio:ioproxy", TypeDesc::PTR, &ptr);
+    OIIO_CHECK_ASSERT(src.write("test.tif"));
+
+    Filesystem::register_url_opener("mem", [&](string_view) {
+        auto fetch = [&](void* buf, size_t size, int64_t offset) {
+            size = std::min(size, file_buffer.size() - size_t(offset));
+            memcpy(buf, &file_buffer[offset], size);
+            return size;
+        };
+        return new Filesystem::IORangeReader("", int64_t(file_buffer.size()),
+                                             fetch, 256);
+    });
+    auto in = ImageInput::open("mem://bucket/test.tif");
+    OIIO_CHECK_ASSERT(in && in->spec().width == spec.width);
+    in.reset();
+    ImageBuf url("mem://bucket/test.tif");
+    OIIO_CHECK_ASSERT(url.read());
+    auto comp = ImageBufAlgo::compare(url, src, 0.0f, 0.0f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+    Filesystem::register_url_opener("mem", nullptr);
+}
+
+
+
 void
 test_roi()
 {
@@ -500,6 +578,168 @@ test_roi()
 
 
 
+void
+test_copy_on_write()
+{
+    std::cout << "Testing ImageBuf copy-on-write\n";
+    const float gray[3] = { 0.5f, 0.5f, 0.5f };
+    const float red[3]  = { 1.0f, 0.0f, 0.0f };
+    ImageBuf A(ImageSpec(64, 64, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::fill(A, gray);
+    const ImageBuf& cA(A);
+
+    // Copy construction shares the pixels...
+    ImageBuf B(A);
+    const ImageBuf& cB(B);
+    OIIO_CHECK_ASSERT(cB.localpixels() == cA.localpixels());
+    // ...until one of them writes.
+    B.setpixel(3, 4, red);
+    OIIO_CHECK_ASSERT(cB.localpixels() != cA.localpixels());
+    float pixel[3];
+    A.getpixel(3, 4, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 0.5f);
+    B.getpixel(3, 4, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 1.0f);
+    B.getpixel(5, 5, pixel);
+    OIIO_CHECK_EQUAL(pixel[1], 0.5f);
+
+    // Assignment and full-window crop share too, and writing through an
+    // Iterator or IBA function must not disturb the original.
+    ImageBuf C;
+    C = A;
+    const ImageBuf& cC(C);
+    OIIO_CHECK_ASSERT(cC.localpixels() == cA.localpixels());
+    ImageBufAlgo::fill(C, red);
+    OIIO_CHECK_ASSERT(cC.localpixels() != cA.localpixels());
+    A.getpixel(10, 10, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 0.5f);
+    OIIO_CHECK_EQUAL(pixel[1], 0.5f);
+
+    ImageBuf D = ImageBufAlgo::crop(A);
+    const ImageBuf& cD(D);
+    OIIO_CHECK_ASSERT(cD.localpixels() == cA.localpixels());
+    for (ImageBuf::Iterator<float> p(D); !p.done(); ++p)
+        p[2] = 0.0f;
+    A.getpixel(10, 10, pixel);
+    OIIO_CHECK_EQUAL(pixel[2], 0.5f);
+    D.getpixel(10, 10, pixel);
+    OIIO_CHECK_EQUAL(pixel[2], 0.0f);
+
+    // A conversion can't share.
+    ImageBuf E;
+    E.copy(A, TypeDesc::HALF);
+    OIIO_CHECK_EQUAL(E.spec().format, TypeDesc::HALF);
+    E.getpixel(10, 10, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 0.5f);
+}
+
+
+
+void
+test_view()
+{
+    std::cout << "Testing ImageBuf views\n";
+    ImageBuf A(ImageSpec(8, 6, 4, TypeDesc::FLOAT));
+    for (ImageBuf::Iterator<float> p(A); !p.done(); ++p)
+        for (int c = 0; c < 4; ++c)
+            p[c] = p.x() + 10 * p.y() + 100 * c;
+
+    // Window x=[2,6), y=[1,4) of channels 1 and 2
+    ImageBuf V = A.view(ROI(2, 6, 1, 4, 0, 1, 1, 3));
+    OIIO_CHECK_ASSERT(!V.has_error());
+    OIIO_CHECK_EQUAL(V.storage(), ImageBuf::APPBUFFER);
+    OIIO_CHECK_EQUAL(V.roi(), ROI(2, 6, 1, 4, 0, 1, 0, 2));
+    OIIO_CHECK_EQUAL(V.roi_full(), A.roi_full());
+    OIIO_CHECK_ASSERT(!V.contiguous());
+    OIIO_CHECK_ASSERT(A.contiguous());
+    OIIO_CHECK_EQUAL(V.pixel_stride(), A.pixel_stride());
+    float pixel[4];
+    V.getpixel(3, 2, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 123.0f);
+    OIIO_CHECK_EQUAL(pixel[1], 223.0f);
+
+    // Writing through the view writes the parent, and only in the window
+    const float val[2] = { -1.0f, -2.0f };
+    ImageBufAlgo::fill(V, val);
+    A.getpixel(3, 2, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 23.0f);
+    OIIO_CHECK_EQUAL(pixel[1], -1.0f);
+    OIIO_CHECK_EQUAL(pixel[2], -2.0f);
+    OIIO_CHECK_EQUAL(pixel[3], 323.0f);
+    A.getpixel(1, 2, pixel);
+    OIIO_CHECK_EQUAL(pixel[1], 121.0f);
+
+    // Write the view to a file and read it back
+    const ImageBuf& cA(A);
+    const ImageBuf W = cA.view(ROI(4, 8, 2, 5));
+    OIIO_CHECK_ASSERT(W.write("view_imagebuf_test.tif"));
+    ImageBuf R("view_imagebuf_test.tif");
+    OIIO_CHECK_EQUAL(R.spec().width, 4);
+    OIIO_CHECK_EQUAL(R.spec().height, 3);
+    OIIO_CHECK_EQUAL(R.nchannels(), 4);
+    for (int y = 0; y < 3; ++y)
+        for (int x = 0; x < 4; ++x) {
+            float rpixel[4], wpixel[4];
+            R.getpixel(R.xbegin() + x, R.ybegin() + y, rpixel);
+            W.getpixel(W.xbegin() + x, W.ybegin() + y, wpixel);
+            for (int c = 0; c < 4; ++c)
+                OIIO_CHECK_EQUAL(rpixel[c], wpixel[c]);
+        }
+    Filesystem::remove("view_imagebuf_test.tif");
+
+    // A roi outside the data window is an error
+    ImageBuf bad = A.view(ROI(4, 10, 0, 2));
+    OIIO_CHECK_ASSERT(bad.has_error());
+    bad.geterror();
+}
+
+
+
+void
+test_pixel_pool()
+{
+    std::cout << "Testing ImageBuf pixel pool\n";
+    OIIO::attribute("imagebuf:pool", 1);
+    OIIO::attribute("imagebuf:pool_zero", 1);
+    int hits0 = 0, hits1 = 0, misses = 0, idle = 0;
+    OIIO::getattribute("imagebuf:pool_hits", hits0);
+
+    // 1024x512 RGBA float is 8MB, well above the pooling threshold.
+    ImageSpec spec(1024, 512, 4, TypeDesc::FLOAT);
+    {
+        ImageBuf A(spec);
+        const float red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+        ImageBufAlgo::fill(A, red);
+    }
+    OIIO::getattribute("imagebuf:pool_idle_MB", idle);
+    OIIO_CHECK_ASSERT(idle >= 8);
+    {
+        // Same size again should be satisfied from the pool, and the
+        // recycled block must not leak the previous image's contents.
+        ImageBuf B(spec);
+        OIIO::getattribute("imagebuf:pool_hits", hits1);
+        OIIO_CHECK_EQUAL(hits1, hits0 + 1);
+        float pixel[4];
+        B.getpixel(512, 256, pixel);
+        OIIO_CHECK_EQUAL(pixel[0], 0.0f);
+        OIIO_CHECK_EQUAL(pixel[3], 0.0f);
+    }
+    OIIO::getattribute("imagebuf:pool_misses", misses);
+    OIIO_CHECK_ASSERT(misses >= 1);
+
+    // A zero budget releases everything that is idle.
+    OIIO::attribute("imagebuf:pool_budget_MB", 0);
+    {
+        ImageBuf C(spec);
+    }
+    OIIO::getattribute("imagebuf:pool_idle_MB", idle);
+    OIIO_CHECK_EQUAL(idle, 0);
+    OIIO::attribute("imagebuf:pool_budget_MB", 2048);
+    OIIO::attribute("imagebuf:pool", 0);
+}
+
+
+
 int
 main(int argc, char** argv)
 {
@@ -529,6 +769,11 @@ main(int argc, char** argv)
 
     test_write_png_to_memory();
     test_write_exr_to_memory();
+    test_ioproxy_roundtrip();
+    test_read_url();
+    test_copy_on_write();
+    test_view();
+    test_pixel_pool();
 
     Filesystem::remove("A_imagebuf_test.tif");
     return unit_test_failures;
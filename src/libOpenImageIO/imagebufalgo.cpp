@@ -28,8 +28,11 @@
   (This is the Modified BSD License)
 */
 
+#include <algorithm>
 #include <cmath>
+#include <map>
 #include <memory>
+#include <mutex>
 
 #include <OpenEXR/half.h>
 
@@ -39,6 +42,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/platform.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 
 #include "imageio_pvt.h"
@@ -254,6 +258,7 @@ ImageBufAlgo::IBAprep(ROI& roi, ImageBuf* dst, const ImageBuf* A,
             // Since we're altering pixels, be sure that any existing SHA
             // hash of dst's pixel values is erased.
             spec.erase_attribute("oiio:SHA-1");
+            spec.erase_attribute("oiio:PixelHash");
             std::string desc = spec.get_string_attribute("ImageDescription");
             if (desc.size()) {
 #ifdef USE_BOOST_REGEX
@@ -439,6 +444,465 @@ convolve_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
 
 
 
+// Kernels at least this many pixels in area that are not separable are
+// convolved by FFT rather than directly.
+static const int convolve_fft_min_area = 15 * 15;
+
+
+
+// Fetch the pixels of src covering the region want as type T, clamping
+// the region to src's data window first. The region actually fetched is
+// returned in got; any pixel of want may then be found by clamping its
+// coordinates to got, which matches WrapClamp when the data and display
+// windows coincide.
+template<typename T>
+static void
+fetch_clamped_(const ImageBuf& src, const ROI& want, std::vector<T>& buf,
+               ROI& got)
+{
+    ROI sroi   = src.roi();
+    got        = want;
+    got.xbegin = OIIO::clamp(want.xbegin, sroi.xbegin, sroi.xend - 1);
+    got.xend   = OIIO::clamp(want.xend - 1, sroi.xbegin, sroi.xend - 1) + 1;
+    got.ybegin = OIIO::clamp(want.ybegin, sroi.ybegin, sroi.yend - 1);
+    got.yend   = OIIO::clamp(want.yend - 1, sroi.ybegin, sroi.yend - 1) + 1;
+    got.zbegin = OIIO::clamp(want.zbegin, sroi.zbegin, sroi.zend - 1);
+    got.zend   = OIIO::clamp(want.zend - 1, sroi.zbegin, sroi.zend - 1) + 1;
+    buf.resize(size_t(got.npixels()) * got.nchannels());
+    src.get_pixels(got, BaseTypeFromC<T>::value, buf.data());
+}
+
+
+
+// Compute roi a 2D tile of at most 64x64 pixels at a time, in parallel,
+// calling f(tile, in, got) for each with the source pixels its windows
+// need -- the tile grown by the window extent win -- fetched as one
+// compact float block (see fetch_clamped_). Every window then reads from
+// that small block instead of rows spanning the whole image, so large
+// stencils stay in cache however wide the image, and the adaptive
+// scheduling balances tiles of uneven cost.
+template<class FUNC>
+static void
+parallel_tiles_(const ImageBuf& src, ROI roi, ROI win, int nthreads,
+                FUNC f)
+{
+    const int tilesize = 64;
+    auto opt           = ImageBufAlgo::adaptive_options(nthreads, &src);
+    ImageBufAlgo::parallel_image(roi, opt, [&](ROI roi) {
+        std::vector<float> in;
+        for (int ty = roi.ybegin; ty < roi.yend; ty += tilesize) {
+            for (int tx = roi.xbegin; tx < roi.xend; tx += tilesize) {
+                ROI tile(tx, std::min(tx + tilesize, roi.xend), ty,
+                         std::min(ty + tilesize, roi.yend), roi.zbegin,
+                         roi.zend, roi.chbegin, roi.chend);
+                ROI want(tile.xbegin + win.xbegin, tile.xend + win.xend - 1,
+                         tile.ybegin + win.ybegin, tile.yend + win.yend - 1,
+                         tile.zbegin + win.zbegin, tile.zend + win.zend - 1,
+                         tile.chbegin, tile.chend);
+                ROI got;
+                fetch_clamped_(src, want, in, got);
+                f(tile, in, got);
+            }
+        }
+    });
+}
+
+
+
+// Direct convolution, a tile at a time (see parallel_tiles_). Lookups
+// clamp to the data window, which matches WrapClamp only when it is also
+// the display window.
+static bool
+convolve_tiled_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& K,
+                float scale, ROI roi, int nthreads)
+{
+    ROI kroi        = K.roi();
+    int kchans      = K.nchannels();
+    const float* kp = (const float*)K.localpixels();
+    parallel_tiles_(src, roi, kroi, nthreads, [&](ROI tile,
+                                                  const std::vector<float>& in,
+                                                  ROI got) {
+        int nch = tile.nchannels();
+        int gw = got.width(), gh = got.height();
+        std::vector<float> out(size_t(tile.npixels()) * nch, 0.0f);
+        float* o = out.data();
+        for (int z = tile.zbegin; z < tile.zend; ++z)
+            for (int y = tile.ybegin; y < tile.yend; ++y)
+                for (int x = tile.xbegin; x < tile.xend; ++x, o += nch) {
+                    const float* k = kp;
+                    for (int kz = kroi.zbegin; kz < kroi.zend; ++kz) {
+                        int sz = OIIO::clamp(z + kz, got.zbegin, got.zend - 1)
+                                 - got.zbegin;
+                        for (int ky = kroi.ybegin; ky < kroi.yend; ++ky) {
+                            int sy = OIIO::clamp(y + ky, got.ybegin,
+                                                 got.yend - 1)
+                                     - got.ybegin;
+                            const float* row
+                                = &in[(size_t(sz) * gh + sy) * gw * nch];
+                            for (int kx = kroi.xbegin; kx < kroi.xend;
+                                 ++kx, k += kchans) {
+                                int sx = OIIO::clamp(x + kx, got.xbegin,
+                                                     got.xend - 1)
+                                         - got.xbegin;
+                                const float* s = row + size_t(sx) * nch;
+                                for (int c = 0; c < nch; ++c)
+                                    o[c] += k[0] * s[c];
+                            }
+                        }
+                    }
+                    for (int c = 0; c < nch; ++c)
+                        o[c] *= scale;
+                }
+        dst.set_pixels(tile, TypeDesc::FLOAT, out.data());
+    });
+    return true;
+}
+
+
+
+// If the 2D kernel K is (to float precision) the outer product of a
+// vertical and a horizontal 1D kernel, return true and store them in v
+// and h, respectively.
+static bool
+kernel_separable_(const ImageBuf& K, std::vector<float>& h,
+                  std::vector<float>& v)
+{
+    ROI kroi       = K.roi();
+    int kw         = kroi.width();
+    int kh         = kroi.height();
+    int kchans     = K.nchannels();
+    const float* k = (const float*)K.localpixels();
+    auto kval      = [&](int x, int y) { return k[(y * kw + x) * kchans]; };
+
+    // Factor around the largest magnitude element.
+    int px = 0, py = 0;
+    float maxabs = 0.0f;
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            if (fabsf(kval(x, y)) > maxabs) {
+                maxabs = fabsf(kval(x, y));
+                px     = x;
+                py     = y;
+            }
+    if (maxabs == 0.0f)
+        return false;
+    h.resize(kw);
+    v.resize(kh);
+    for (int x = 0; x < kw; ++x)
+        h[x] = kval(x, py);
+    for (int y = 0; y < kh; ++y)
+        v[y] = kval(px, y) / kval(px, py);
+    const float eps = 1.0e-5f * maxabs;
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            if (fabsf(kval(x, y) - v[y] * h[x]) > eps)
+                return false;
+    return true;
+}
+
+
+
+// Optional sharpening step folded into convolve_separable_: instead of
+// the blur b of a source value s, it outputs s + contrast * (s - b),
+// treating differences smaller than threshold as zero (unsharp masking).
+struct UnsharpParams {
+    float contrast;
+    float threshold;
+};
+
+
+
+// Return true if all the taps of the 1D kernel k are equal, so that it
+// can be applied as a running sum.
+inline bool
+kernel_is_box_(const std::vector<float>& k)
+{
+    return std::all_of(k.begin(), k.end(),
+                       [&](float w) { return w == k[0]; });
+}
+
+
+
+// Convolve with a separable kernel as a horizontal pass over every source
+// row a chunk needs, then a vertical pass over those intermediate rows.
+// Box kernels are applied as running sums, at a cost per pixel that does
+// not depend on the kernel size. If sharpen is not null, the blurred
+// result is turned into an unsharp mask on the way out, so no full-size
+// intermediate image is needed; that requires roi to lie within src's
+// data window.
+static bool
+convolve_separable_(ImageBuf& dst, const ImageBuf& src, ROI kroi,
+                    const std::vector<float>& h, const std::vector<float>& v,
+                    float scale, ROI roi, int nthreads,
+                    const UnsharpParams* sharpen = nullptr)
+{
+    bool hbox = kernel_is_box_(h), vbox = kernel_is_box_(v);
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nch   = roi.nchannels();
+        int width = roi.width();
+        int kw = kroi.width(), kh = kroi.height();
+        ROI want(roi.xbegin + kroi.xbegin, roi.xend + kroi.xend - 1,
+                 roi.ybegin + kroi.ybegin, roi.yend + kroi.yend - 1, 0, 1,
+                 roi.chbegin, roi.chend);
+        std::vector<float> in, hpass, out(size_t(width) * nch);
+        std::vector<float> vsum(vbox ? size_t(width) * nch : 0);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            want.zbegin = z;
+            want.zend   = z + 1;
+            ROI got;
+            fetch_clamped_(src, want, in, got);
+            int gw = got.width();
+            auto srcx = [&](int x) {
+                return OIIO::clamp(x, got.xbegin, got.xend - 1) - got.xbegin;
+            };
+            auto srcy = [&](int y) {
+                return OIIO::clamp(y, got.ybegin, got.yend - 1) - got.ybegin;
+            };
+
+            // Horizontal pass, for each source row that was fetched.
+            hpass.assign(size_t(width) * got.height() * nch, 0.0f);
+            for (int y = 0; y < got.height(); ++y) {
+                const float* srow = &in[size_t(y) * gw * nch];
+                float* hrow       = &hpass[size_t(y) * width * nch];
+                if (hbox) {
+                    // Running sum: slide the window one pixel at a time.
+                    int x0 = roi.xbegin + kroi.xbegin;
+                    for (int i = 0; i < kw; ++i) {
+                        const float* s = srow + srcx(x0 + i) * nch;
+                        for (int c = 0; c < nch; ++c)
+                            hrow[c] += s[c];
+                    }
+                    for (int x = 1; x < width; ++x) {
+                        const float* add = srow + srcx(x0 + x + kw - 1) * nch;
+                        const float* sub = srow + srcx(x0 + x - 1) * nch;
+                        for (int c = 0; c < nch; ++c)
+                            hrow[x * nch + c] = hrow[(x - 1) * nch + c]
+                                                + add[c] - sub[c];
+                    }
+                    for (int i = 0, e = width * nch; i < e; ++i)
+                        hrow[i] *= h[0];
+                    continue;
+                }
+                for (int x = 0; x < width; ++x, hrow += nch) {
+                    for (int i = 0; i < kw; ++i) {
+                        const float* s
+                            = srow + srcx(roi.xbegin + x + kroi.xbegin + i)
+                                         * nch;
+                        for (int c = 0; c < nch; ++c)
+                            hrow[c] += h[i] * s[c];
+                    }
+                }
+            }
+
+            // Vertical pass, one output row at a time.
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                if (vbox) {
+                    // Running sum over the window of intermediate rows.
+                    size_t n = vsum.size();
+                    if (y == roi.ybegin) {
+                        std::fill(vsum.begin(), vsum.end(), 0.0f);
+                        for (int j = 0; j < kh; ++j) {
+                            const float* hrow
+                                = &hpass[srcy(y + kroi.ybegin + j) * n];
+                            for (size_t i = 0; i < n; ++i)
+                                vsum[i] += hrow[i];
+                        }
+                    } else {
+                        const float* add
+                            = &hpass[srcy(y + kroi.yend - 1) * n];
+                        const float* sub
+                            = &hpass[srcy(y + kroi.ybegin - 1) * n];
+                        for (size_t i = 0; i < n; ++i)
+                            vsum[i] += add[i] - sub[i];
+                    }
+                    float w = scale * v[0];
+                    for (size_t i = 0; i < n; ++i)
+                        out[i] = w * vsum[i];
+                } else {
+                    std::fill(out.begin(), out.end(), 0.0f);
+                    for (int j = 0; j < kh; ++j) {
+                        const float* hrow
+                            = &hpass[size_t(srcy(y + kroi.ybegin + j)) * width
+                                     * nch];
+                        float w = scale * v[j];
+                        for (int i = 0, e = width * nch; i < e; ++i)
+                            out[i] += w * hrow[i];
+                    }
+                }
+                if (sharpen) {
+                    const float* s = &in[(size_t(y - got.ybegin) * gw
+                                          + (roi.xbegin - got.xbegin))
+                                         * nch];
+                    for (int i = 0, e = width * nch; i < e; ++i) {
+                        float d = s[i] - out[i];
+                        if (fabsf(d) < sharpen->threshold)
+                            d = 0.0f;
+                        out[i] = s[i] + sharpen->contrast * d;
+                    }
+                }
+                ROI row(roi.xbegin, roi.xend, y, y + 1, z, z + 1, roi.chbegin,
+                        roi.chend);
+                dst.set_pixels(row, TypeDesc::FLOAT, out.data());
+            }
+        }
+    });
+    return true;
+}
+
+
+
+// Return an FFT plan for n points. Setting one up takes a sin and cos per
+// point, but copying one is cheap, and each thread doing transforms needs
+// its own (a plan has scratch space). So keep one set-up plan for each
+// size and direction, and hand out copies of it.
+static kissfft<float>
+fft_plan(int n, bool inverse)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, bool>, std::unique_ptr<kissfft<float>>>
+        plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (plans.size() > 64)
+        plans.clear();  // Don't pile up plans for every size ever used
+    std::unique_ptr<kissfft<float>>& plan(plans[std::make_pair(n, inverse)]);
+    if (!plan)
+        plan.reset(new kissfft<float>(n, inverse));
+    return *plan;
+}
+
+
+
+// The columns of a 2D FFT are gathered this many at a time, so that each
+// pass down the array uses whole cache lines.
+static const int fft2d_cols = 8;
+
+// Size of the scratch space needed by fft2d_.
+inline size_t
+fft2d_tmpsize(int nx, int ny)
+{
+    return size_t(fft2d_cols + 1) * std::max(nx, ny);
+}
+
+
+
+// In-place 2D FFT of an nx by ny row-major complex array.
+static void
+fft2d_(std::complex<float>* data, int nx, int ny, kissfft<float>& Fx,
+       kissfft<float>& Fy, std::complex<float>* tmp)
+{
+    for (int y = 0; y < ny; ++y) {
+        Fx.transform(data + size_t(y) * nx, tmp);
+        std::copy(tmp, tmp + nx, data + size_t(y) * nx);
+    }
+    std::complex<float>* cols = tmp + std::max(nx, ny);
+    for (int x0 = 0; x0 < nx; x0 += fft2d_cols) {
+        int n = std::min(fft2d_cols, nx - x0);
+        for (int y = 0; y < ny; ++y)
+            for (int i = 0; i < n; ++i)
+                cols[size_t(i) * ny + y] = data[size_t(y) * nx + x0 + i];
+        for (int i = 0; i < n; ++i) {
+            Fy.transform(cols + size_t(i) * ny, tmp);
+            std::copy(tmp, tmp + ny, cols + size_t(i) * ny);
+        }
+        for (int y = 0; y < ny; ++y)
+            for (int i = 0; i < n; ++i)
+                data[size_t(y) * nx + x0 + i] = cols[size_t(i) * ny + y];
+    }
+}
+
+
+
+// Convolve with a large kernel by FFT, using overlap-save: the output is
+// divided into blocks, and each block is computed from the transform of
+// the source tile it depends on multiplied by the transform of the
+// kernel, keeping only the part unaffected by circular wraparound.
+static bool
+convolve_fft_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& K,
+              float scale, ROI roi, int nthreads)
+{
+    typedef std::complex<float> cpx;
+    ROI kroi       = K.roi();
+    int kw         = kroi.width();
+    int kh         = kroi.height();
+    int kchans     = K.nchannels();
+    const float* k = (const float*)K.localpixels();
+
+    // Transform size: a power of 2 at least twice the kernel, but no
+    // bigger than needed to cover the whole ROI at once.
+    int nx = std::min(std::max(64, pow2roundup(2 * kw)), roi.width() + kw - 1);
+    int ny = std::min(std::max(64, pow2roundup(2 * kh)),
+                      roi.height() + kh - 1);
+    int bw      = nx - kw + 1;  // valid outputs per block
+    int bh      = ny - kh + 1;
+    int nbx     = (roi.width() + bw - 1) / bw;
+    int nby     = (roi.height() + bh - 1) / bh;
+    size_t npix = size_t(nx) * ny;
+
+    // Spectrum of the kernel, flipped so that the circular convolution
+    // computes the same correlation as convolve_, with the normalization
+    // and the inverse transform's 1/N folded in.
+    std::vector<cpx> kspec(npix, cpx(0.0f));
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            kspec[size_t(kh - 1 - y) * nx + (kw - 1 - x)]
+                = k[(y * kw + x) * kchans] * scale / float(npix);
+    {
+        kissfft<float> Fx = fft_plan(nx, false), Fy = fft_plan(ny, false);
+        std::vector<cpx> tmp(fft2d_tmpsize(nx, ny));
+        fft2d_(kspec.data(), nx, ny, Fx, Fy, tmp.data());
+    }
+
+    int64_t nblocks = int64_t(nbx) * nby * roi.depth();
+    parallel_for(0, nblocks, [&](int64_t b) {
+        int bx  = roi.xbegin + int(b % nbx) * bw;
+        int by  = roi.ybegin + int((b / nbx) % nby) * bh;
+        int z   = roi.zbegin + int(b / (int64_t(nbx) * nby));
+        int bxe = std::min(bx + bw, roi.xend);
+        int bye = std::min(by + bh, roi.yend);
+        int nch = roi.nchannels();
+        ROI want(bx + kroi.xbegin, bxe + kroi.xend - 1, by + kroi.ybegin,
+                 bye + kroi.yend - 1, z, z + 1, roi.chbegin, roi.chend);
+        std::vector<float> in;
+        ROI got;
+        fetch_clamped_(src, want, in, got);
+        int gw = got.width();
+
+        kissfft<float> Fx = fft_plan(nx, false), Fy = fft_plan(ny, false);
+        kissfft<float> Ix = fft_plan(nx, true), Iy = fft_plan(ny, true);
+        std::vector<cpx> data(npix), tmp(fft2d_tmpsize(nx, ny));
+        int ow = bxe - bx, oh = bye - by;
+        std::vector<float> out(size_t(ow) * oh * nch);
+        for (int c = 0; c < nch; ++c) {
+            // Source tile, clamped at the image edges; anything past the
+            // needed extent is only ever wrapped into discarded outputs.
+            for (int y = 0; y < ny; ++y) {
+                int sy = OIIO::clamp(want.ybegin + y, got.ybegin, got.yend - 1)
+                         - got.ybegin;
+                for (int x = 0; x < nx; ++x) {
+                    int sx = OIIO::clamp(want.xbegin + x, got.xbegin,
+                                         got.xend - 1)
+                             - got.xbegin;
+                    data[size_t(y) * nx + x] = in[(size_t(sy) * gw + sx) * nch
+                                                  + c];
+                }
+            }
+            fft2d_(data.data(), nx, ny, Fx, Fy, tmp.data());
+            for (size_t i = 0; i < npix; ++i)
+                data[i] *= kspec[i];
+            fft2d_(data.data(), nx, ny, Ix, Iy, tmp.data());
+            for (int y = 0; y < oh; ++y)
+                for (int x = 0; x < ow; ++x)
+                    out[(size_t(y) * ow + x) * nch + c]
+                        = data[size_t(y + kh - 1) * nx + x + kw - 1].real();
+        }
+        dst.set_pixels(ROI(bx, bxe, by, bye, z, z + 1, roi.chbegin, roi.chend),
+                       TypeDesc::FLOAT, out.data());
+    }, parallel_options(nthreads, Split_Y, 1));
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::convolve(ImageBuf& dst, const ImageBuf& src,
                        const ImageBuf& kernel, bool normalize, ROI roi,
@@ -451,10 +915,37 @@ ImageBufAlgo::convolve(ImageBuf& dst, const ImageBuf& src,
     // Ensure that the kernel is float and in local memory
     const ImageBuf* K = &kernel;
     ImageBuf Ktmp;
-    if (kernel.spec().format != TypeDesc::FLOAT || !kernel.localpixels()) {
+    if (kernel.spec().format != TypeDesc::FLOAT || !kernel.contiguous()) {
         Ktmp.copy(kernel, TypeDesc::FLOAT);
         K = &Ktmp;
     }
+
+    // Large 2D kernels get a faster path, chosen by kernel shape and
+    // size: two 1D passes if the kernel is separable, or FFT if it's big.
+    // Any others are convolved directly, a tile at a time. All of these
+    // clamp to the data window, so they're used only when that is also
+    // the display window, as WrapClamp would then do the same.
+    ROI kroi = K->roi();
+    if (src.roi() == src.roi_full() && !src.deep()) {
+        float scale = 1.0f;
+        if (normalize) {
+            scale = 0.0f;
+            for (ImageBuf::ConstIterator<float> k(*K); !k.done(); ++k)
+                scale += k[0];
+            scale = 1.0f / scale;
+        }
+        if (kroi.depth() == 1 && kroi.zbegin == 0 && kroi.width() > 1
+            && kroi.height() > 1) {
+            std::vector<float> h, v;
+            if (kernel_separable_(*K, h, v))
+                return convolve_separable_(dst, src, kroi, h, v, scale, roi,
+                                           nthreads);
+            if (kroi.npixels() >= convolve_fft_min_area)
+                return convolve_fft_(dst, src, *K, scale, roi, nthreads);
+        }
+        return convolve_tiled_(dst, src, *K, scale, roi, nthreads);
+    }
+
     OIIO_DISPATCH_COMMON_TYPES2(ok, "convolve", convolve_, dst.spec().format,
                                 src.spec().format, dst, src, *K, normalize, roi,
                                 nthreads);
@@ -587,6 +1078,30 @@ ImageBufAlgo::unsharp_mask(ImageBuf& dst, const ImageBuf& src,
                  IBAprep_REQUIRE_SAME_NCHANNELS | IBAprep_NO_SUPPORT_VOLUME))
         return false;
 
+    ImageBuf K;
+    if (kernel != "median") {
+        if (!make_kernel(K, kernel, width, width)) {
+            dst.error("%s", K.geterror());
+            return false;
+        }
+        // Separable kernels (such as gaussian and box) blur and sharpen
+        // in a single pass, with no Blurry image, as long as the blur
+        // would clamp at the data window, needs no pixels outside it,
+        // and isn't overwriting its own source.
+        std::vector<float> h, v;
+        if (&dst != &src && src.roi() == src.roi_full() && !src.deep()
+            && roi_intersection(roi, src.roi()) == roi
+            && kernel_separable_(K, h, v)) {
+            pvt::LoggedTimer logtime("IBA::unsharp_mask");
+            float sum = 0.0f;
+            for (ImageBuf::ConstIterator<float> k(K); !k.done(); ++k)
+                sum += k[0];
+            UnsharpParams sharpen { contrast, threshold };
+            return convolve_separable_(dst, src, K.roi(), h, v, 1.0f / sum,
+                                       roi, nthreads, &sharpen);
+        }
+    }
+
     // Blur the source image, store in Blurry
     ImageSpec BlurrySpec = src.spec();
     BlurrySpec.set_format(TypeDesc::FLOAT);  // force float
@@ -595,11 +1110,6 @@ ImageBufAlgo::unsharp_mask(ImageBuf& dst, const ImageBuf& src,
     if (kernel == "median") {
         median_filter(Blurry, src, ceilf(width), 0, roi, nthreads);
     } else {
-        ImageBuf K;
-        if (!make_kernel(K, kernel, width, width)) {
-            dst.error("%s", K.geterror());
-            return false;
-        }
         if (!convolve(Blurry, src, K, true, roi, nthreads)) {
             dst.error("%s", Blurry.geterror());
             return false;
@@ -711,9 +1221,11 @@ median_filter_impl(ImageBuf& R, const ImageBuf& A, int width, int height,
                 }
             }
             if (n) {
+                // Only the middle element's rank matters, so a selection
+                // is enough -- no need to fully sort.
                 int mid = n / 2;
                 for (int c = 0; c < nchannels; ++c) {
-                    std::sort(chans[c] + 0, chans[c] + n);
+                    std::nth_element(chans[c], chans[c] + mid, chans[c] + n);
                     r[c] = chans[c][mid];
                 }
             } else {
@@ -726,6 +1238,172 @@ median_filter_impl(ImageBuf& R, const ImageBuf& A, int width, int height,
 }
 
 
+// Median filter of any pixel type, a tile at a time (see
+// parallel_tiles_). As in median_filter_impl, window pixels outside the
+// data window are skipped rather than clamped.
+static bool
+median_filter_tiled_(ImageBuf& R, const ImageBuf& A, int width, int height,
+                     ROI roi, int nthreads)
+{
+    int w_2        = std::max(1, width / 2);
+    int h_2        = std::max(1, height / 2);
+    int windowsize = width * height;
+    roi.chbegin    = 0;
+    roi.chend      = R.nchannels();
+    ROI win(-w_2, width - w_2, -h_2, height - h_2);
+    parallel_tiles_(A, roi, win, nthreads, [&](ROI tile,
+                                               const std::vector<float>& in,
+                                               ROI got) {
+        int nch = tile.nchannels(), gw = got.width();
+        std::vector<float> window(size_t(windowsize) * nch);
+        std::vector<float> out(size_t(tile.npixels()) * nch);
+        float* o = out.data();
+        for (int y = tile.ybegin; y < tile.yend; ++y) {
+            int y0 = std::max(y - h_2, got.ybegin);
+            int y1 = std::min(y - h_2 + height, got.yend);
+            for (int x = tile.xbegin; x < tile.xend; ++x, o += nch) {
+                int x0 = std::max(x - w_2, got.xbegin);
+                int x1 = std::min(x - w_2 + width, got.xend);
+                int n  = 0;
+                for (int yy = y0; yy < y1; ++yy) {
+                    const float* s = &in[(size_t(yy - got.ybegin) * gw
+                                          + (x0 - got.xbegin))
+                                         * nch];
+                    for (int xx = x0; xx < x1; ++xx, s += nch, ++n)
+                        for (int c = 0; c < nch; ++c)
+                            window[c * windowsize + n] = s[c];
+                }
+                // Only the middle element's rank matters, so a selection
+                // is enough -- no need to fully sort.
+                int mid = n / 2;
+                for (int c = 0; c < nch; ++c) {
+                    float* w = &window[c * windowsize];
+                    if (n) {
+                        std::nth_element(w, w + mid, w + n);
+                        o[c] = w[mid];
+                    } else {
+                        o[c] = 0.0f;
+                    }
+                }
+            }
+        }
+        R.set_pixels(tile, TypeDesc::FLOAT, out.data());
+    });
+    return true;
+}
+
+
+
+
+// Windows at least this many pixels in area on 8 or 16 bit images use
+// the sliding histogram median rather than selecting on each window.
+static const int median_histogram_min_window = 7 * 7;
+
+
+
+// Median filter of 8 or 16 bit data by sliding histograms (Perreault &
+// Hebert, "Median Filtering in Constant Time"). Each column keeps a
+// histogram of its pixels within the window rows, updated by one pixel
+// per column as the window moves down, and the window's histogram is
+// updated by adding the entering column's histogram and subtracting the
+// leaving one as the window moves across. For 16 bit data the histograms
+// hold the 256 coarse bins of the high byte, and a full resolution window
+// histogram, updated a column of pixels at a time, locates the median
+// within its coarse bin.
+template<typename T>
+static bool
+median_filter_hist_(ImageBuf& R, const ImageBuf& A, int width, int height,
+                    ROI roi, int nthreads)
+{
+    const bool twolevel = sizeof(T) > 1;
+    const int shift     = twolevel ? 8 : 0;
+    const float scale   = 1.0f / float(std::numeric_limits<T>::max());
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int w_2   = std::max(1, width / 2);
+        int h_2   = std::max(1, height / 2);
+        int nch   = roi.nchannels();
+        int ncols = roi.width() + width - 1;
+        int mid   = width * height / 2;
+        ROI want(roi.xbegin - w_2, roi.xend - w_2 + width - 1,
+                 roi.ybegin - h_2, roi.yend - h_2 + height - 1, roi.zbegin,
+                 roi.zbegin + 1, roi.chbegin, roi.chend);
+        std::vector<T> in;
+        ROI got;
+        fetch_clamped_(A, want, in, got);
+        int gw  = got.width();
+        auto at = [&](int x, int y, int c) -> int {
+            x = OIIO::clamp(x, got.xbegin, got.xend - 1) - got.xbegin;
+            y = OIIO::clamp(y, got.ybegin, got.yend - 1) - got.ybegin;
+            return in[(size_t(y) * gw + x) * nch + c];
+        };
+
+        std::vector<int> colhist(size_t(ncols) * 256), hist(256);
+        std::vector<int> fine(twolevel ? 65536 : 0);
+        std::vector<float> out(size_t(roi.npixels()) * nch);
+        for (int c = 0; c < nch; ++c) {
+            std::fill(colhist.begin(), colhist.end(), 0);
+            for (int i = 0; i < ncols; ++i)
+                for (int j = 0; j < height; ++j)
+                    ++colhist[i * 256
+                              + (at(want.xbegin + i, want.ybegin + j, c)
+                                 >> shift)];
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                int ytop = y - h_2;  // first row of the window
+                if (y > roi.ybegin) {
+                    for (int i = 0; i < ncols; ++i) {
+                        int x = want.xbegin + i;
+                        --colhist[i * 256 + (at(x, ytop - 1, c) >> shift)];
+                        ++colhist[i * 256
+                                  + (at(x, ytop + height - 1, c) >> shift)];
+                    }
+                }
+                std::fill(hist.begin(), hist.end(), 0);
+                for (int i = 0; i < width; ++i)
+                    for (int b = 0; b < 256; ++b)
+                        hist[b] += colhist[i * 256 + b];
+                if (twolevel) {
+                    std::fill(fine.begin(), fine.end(), 0);
+                    for (int i = 0; i < width; ++i)
+                        for (int j = 0; j < height; ++j)
+                            ++fine[at(want.xbegin + i, ytop + j, c)];
+                }
+                float* o = &out[size_t(y - roi.ybegin) * roi.width() * nch];
+                for (int i = 0; i < roi.width(); ++i, o += nch) {
+                    // The window covers columns i .. i+width-1
+                    if (i > 0) {
+                        const int* add = &colhist[(i + width - 1) * 256];
+                        const int* sub = &colhist[(i - 1) * 256];
+                        for (int b = 0; b < 256; ++b)
+                            hist[b] += add[b] - sub[b];
+                        if (twolevel) {
+                            for (int j = 0; j < height; ++j) {
+                                --fine[at(want.xbegin + i - 1, ytop + j, c)];
+                                ++fine[at(want.xbegin + i + width - 1,
+                                          ytop + j, c)];
+                            }
+                        }
+                    }
+                    // The median is the value of rank mid.
+                    int v = 0, count = 0;
+                    while (count + hist[v] <= mid)
+                        count += hist[v++];
+                    if (twolevel) {
+                        v <<= 8;
+                        while (count + fine[v] <= mid)
+                            count += fine[v++];
+                    }
+                    o[c] = v * scale;
+                }
+            }
+        }
+        R.set_pixels(ROI(roi.xbegin, roi.xend, roi.ybegin, roi.yend,
+                         roi.zbegin, roi.zbegin + 1, roi.chbegin, roi.chend),
+                     TypeDesc::FLOAT, out.data());
+    });
+    return true;
+}
+
+
 
 bool
 ImageBufAlgo::median_filter(ImageBuf& dst, const ImageBuf& src, int width,
@@ -736,6 +1414,27 @@ ImageBufAlgo::median_filter(ImageBuf& dst, const ImageBuf& src, int width,
                  IBAprep_REQUIRE_SAME_NCHANNELS | IBAprep_NO_SUPPORT_VOLUME))
         return false;
 
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    // Big windows on 8 and 16 bit images use sliding histograms. Those
+    // clamp to the data window, which matches WrapClamp only when it is
+    // also the display window.
+    TypeDesc srcformat = src.spec().format;
+    if (width * height >= median_histogram_min_window
+        && src.roi() == src.roi_full() && src.spec().channelformats.empty()
+        && !src.deep()) {
+        if (srcformat == TypeDesc::UINT8)
+            return median_filter_hist_<unsigned char>(dst, src, width, height,
+                                                      roi, nthreads);
+        if (srcformat == TypeDesc::UINT16)
+            return median_filter_hist_<unsigned short>(dst, src, width,
+                                                       height, roi, nthreads);
+    }
+    if (!src.deep())
+        return median_filter_tiled_(dst, src, width, height, roi, nthreads);
+
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "median_filter", median_filter_impl,
                                 dst.spec().format, src.spec().format, dst, src,
@@ -808,6 +1507,167 @@ morph_impl(ImageBuf& R, const ImageBuf& A, int width, int height, MorphOp op,
 }
 
 
+// Dilate or erode any pixel type, a tile at a time (see parallel_tiles_).
+// As in morph_impl, window pixels outside the data window are skipped
+// rather than clamped.
+template<MorphOp op>
+static bool
+morph_tiled_(ImageBuf& R, const ImageBuf& A, int width, int height, ROI roi,
+             int nthreads)
+{
+    int w_2     = std::max(1, width / 2);
+    int h_2     = std::max(1, height / 2);
+    float init  = op == MorphDilate ? -std::numeric_limits<float>::max()
+                                    : std::numeric_limits<float>::max();
+    roi.chbegin = 0;
+    roi.chend   = R.nchannels();
+    ROI win(-w_2, width - w_2, -h_2, height - h_2);
+    parallel_tiles_(A, roi, win, nthreads, [&](ROI tile,
+                                               const std::vector<float>& in,
+                                               ROI got) {
+        int nch = tile.nchannels(), gw = got.width();
+        std::vector<float> out(size_t(tile.npixels()) * nch, init);
+        float* o = out.data();
+        for (int y = tile.ybegin; y < tile.yend; ++y) {
+            int y0 = std::max(y - h_2, got.ybegin);
+            int y1 = std::min(y - h_2 + height, got.yend);
+            for (int x = tile.xbegin; x < tile.xend; ++x, o += nch) {
+                int x0 = std::max(x - w_2, got.xbegin);
+                int x1 = std::min(x - w_2 + width, got.xend);
+                for (int yy = y0; yy < y1; ++yy) {
+                    const float* s = &in[(size_t(yy - got.ybegin) * gw
+                                          + (x0 - got.xbegin))
+                                         * nch];
+                    for (int xx = x0; xx < x1; ++xx, s += nch)
+                        for (int c = 0; c < nch; ++c)
+                            o[c] = op == MorphDilate ? std::max(o[c], s[c])
+                                                     : std::min(o[c], s[c]);
+                }
+            }
+        }
+        R.set_pixels(tile, TypeDesc::FLOAT, out.data());
+    });
+    return true;
+}
+
+
+
+
+template<MorphOp op>
+inline simd::vfloat4
+morph_combine_(const simd::vfloat4& a, const simd::vfloat4& b)
+{
+    return op == MorphDilate ? simd::max(a, b) : simd::min(a, b);
+}
+
+
+
+// van Herk / Gil-Werman running max (or min) over a window of k elements
+// of a sequence of n, where each element is len contiguous vfloat4 found
+// at elem(j), storing the n-k+1 results at out(i). Splitting the
+// sequence into blocks of k, every window spans the end of one block and
+// the start of the next, so it's the combination of one suffix and one
+// prefix within blocks -- three operations per element, regardless of k.
+template<MorphOp op, class ELEM, class OUT>
+static void
+vhgw_(int n, int k, int len, ELEM elem, OUT out,
+      std::vector<simd::vfloat4>& pre, std::vector<simd::vfloat4>& suf)
+{
+    pre.resize(size_t(n) * len);
+    suf.resize(size_t(n) * len);
+    for (int j = 0; j < n; ++j) {
+        const simd::vfloat4* f = elem(j);
+        simd::vfloat4* p       = &pre[size_t(j) * len];
+        for (int l = 0; l < len; ++l)
+            p[l] = (j % k) ? morph_combine_<op>(p[l - len], f[l]) : f[l];
+    }
+    for (int j = n - 1; j >= 0; --j) {
+        const simd::vfloat4* f = elem(j);
+        simd::vfloat4* s       = &suf[size_t(j) * len];
+        bool blockend          = (j % k == k - 1 || j == n - 1);
+        for (int l = 0; l < len; ++l)
+            s[l] = blockend ? f[l] : morph_combine_<op>(s[l + len], f[l]);
+    }
+    for (int i = 0; i + k <= n; ++i) {
+        simd::vfloat4* o       = out(i);
+        const simd::vfloat4* s = &suf[size_t(i) * len];
+        const simd::vfloat4* p = &pre[size_t(i + k - 1) * len];
+        for (int l = 0; l < len; ++l)
+            o[l] = morph_combine_<op>(s[l], p[l]);
+    }
+}
+
+
+
+// Separable dilate or erode: a van Herk / Gil-Werman pass along the rows
+// and then along the columns, with the channels of each pixel packed into
+// vfloat4 so that each max or min handles four channels at once.
+template<MorphOp op>
+static bool
+morph_vhgw_(ImageBuf& R, const ImageBuf& A, int width, int height, ROI roi,
+            int nthreads)
+{
+    using simd::vfloat4;
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int w_2   = std::max(1, width / 2);
+        int h_2   = std::max(1, height / 2);
+        int nch   = roi.nchannels();
+        int ng    = (nch + 3) / 4;  // vfloat4 groups per pixel
+        int rw    = roi.width();
+        int ncols = rw + width - 1;
+        int nrows = roi.height() + height - 1;
+        ROI want(roi.xbegin - w_2, roi.xend - w_2 + width - 1,
+                 roi.ybegin - h_2, roi.yend - h_2 + height - 1, roi.zbegin,
+                 roi.zbegin + 1, roi.chbegin, roi.chend);
+        std::vector<float> in;
+        ROI got;
+        fetch_clamped_(A, want, in, got);
+        int gw = got.width(), gh = got.height();
+
+        // Pack into whole vfloat4 groups, padding the last with zeroes.
+        std::vector<vfloat4> src(size_t(gw) * gh * ng, vfloat4::Zero());
+        for (size_t p = 0, e = size_t(gw) * gh; p < e; ++p)
+            for (int c = 0; c < nch; ++c)
+                src[p * ng + c / 4][c % 4] = in[p * nch + c];
+
+        // Horizontal pass over each fetched row.
+        std::vector<vfloat4> hpass(size_t(gh) * rw * ng), pre, suf;
+        for (int y = 0; y < gh; ++y) {
+            const vfloat4* srow = &src[size_t(y) * gw * ng];
+            vfloat4* hrow       = &hpass[size_t(y) * rw * ng];
+            vhgw_<op>(
+                ncols, width, ng,
+                [&](int j) {
+                    int x = OIIO::clamp(want.xbegin + j, got.xbegin,
+                                        got.xend - 1);
+                    return srow + (x - got.xbegin) * ng;
+                },
+                [&](int i) { return hrow + i * ng; }, pre, suf);
+        }
+
+        // Vertical pass, treating each whole row as one element.
+        int len = rw * ng;
+        std::vector<vfloat4> vpass(size_t(roi.height()) * len);
+        vhgw_<op>(
+            nrows, height, len,
+            [&](int j) {
+                int y = OIIO::clamp(want.ybegin + j, got.ybegin, got.yend - 1);
+                return (const vfloat4*)&hpass[size_t(y - got.ybegin) * len];
+            },
+            [&](int i) { return &vpass[size_t(i) * len]; }, pre, suf);
+
+        std::vector<float> out(size_t(roi.npixels()) * nch);
+        for (size_t p = 0, e = out.size() / nch; p < e; ++p)
+            for (int c = 0; c < nch; ++c)
+                out[p * nch + c] = vpass[p * ng + c / 4][c % 4];
+        R.set_pixels(ROI(roi.xbegin, roi.xend, roi.ybegin, roi.yend,
+                         roi.zbegin, roi.zbegin + 1, roi.chbegin, roi.chend),
+                     TypeDesc::FLOAT, out.data());
+    });
+    return true;
+}
+
+
 
 bool
 ImageBufAlgo::dilate(ImageBuf& dst, const ImageBuf& src, int width, int height,
@@ -818,6 +1678,18 @@ ImageBufAlgo::dilate(ImageBuf& dst, const ImageBuf& src, int width, int height,
                  IBAprep_REQUIRE_SAME_NCHANNELS | IBAprep_NO_SUPPORT_VOLUME))
         return false;
 
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    // The separable path clamps to the data window, which matches
+    // WrapClamp only when it is also the display window.
+    if (src.roi() == src.roi_full() && !src.deep())
+        return morph_vhgw_<MorphDilate>(dst, src, width, height, roi, nthreads);
+    if (!src.deep())
+        return morph_tiled_<MorphDilate>(dst, src, width, height, roi,
+                                         nthreads);
+
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "dilate", morph_impl, dst.spec().format,
                                 src.spec().format, dst, src, width, height,
@@ -849,6 +1721,17 @@ ImageBufAlgo::erode(ImageBuf& dst, const ImageBuf& src, int width, int height,
                  IBAprep_REQUIRE_SAME_NCHANNELS | IBAprep_NO_SUPPORT_VOLUME))
         return false;
 
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    // The separable path clamps to the data window, which matches
+    // WrapClamp only when it is also the display window.
+    if (src.roi() == src.roi_full() && !src.deep())
+        return morph_vhgw_<MorphErode>(dst, src, width, height, roi, nthreads);
+    if (!src.deep())
+        return morph_tiled_<MorphErode>(dst, src, width, height, roi, nthreads);
+
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "erode", morph_impl, dst.spec().format,
                                 src.spec().format, dst, src, width, height,
@@ -888,7 +1771,7 @@ hfft_(ImageBuf& dst, const ImageBuf& src, bool inverse, bool unitary, ROI roi,
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         int width     = roi.width();
         float rescale = sqrtf(1.0f / width);
-        kissfft<float> F(width, inverse);
+        kissfft<float> F = fft_plan(width, inverse);
         for (int z = roi.zbegin; z < roi.zend; ++z) {
             for (int y = roi.ybegin; y < roi.yend; ++y) {
                 std::complex<float>*s, *d;
@@ -989,6 +1872,10 @@ ImageBufAlgo::ifft(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
         dst.error("ImageBufAlgo::ifft does not support volume images");
         return false;
     }
+    if (src.localpixels() && !src.contiguous()) {
+        // The row transforms need packed pixels, so copy a strided view.
+        return ifft(dst, src.copy(TypeUnknown), roi, nthreads);
+    }
 
     if (!roi.defined())
         roi = roi_union(get_roi(src.spec()), get_roi_full(src.spec()));
@@ -1177,20 +2064,67 @@ ImageBufAlgo::complex_to_polar(const ImageBuf& src, ROI roi, int nthreads)
 
 
 // Helper for fillholes_pp: for any nonzero alpha pixels in dst, divide
-// all components by alpha.
+// all components by alpha. The pyramid levels are contiguous float
+// buffers, so just walk each row's pixels directly.
 static bool
 divide_by_alpha(ImageBuf& dst, ROI roi, int nthreads)
 {
+    const ImageSpec& spec(dst.spec());
+    ASSERT(spec.format == TypeDesc::FLOAT && dst.localpixels());
+    int nc      = spec.nchannels;
+    int ac      = spec.alpha_channel;
+    float* base = (float*)dst.pixeladdr(dst.xbegin(), dst.ybegin());
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        const ImageSpec& spec(dst.spec());
-        ASSERT(spec.format == TypeDesc::FLOAT);
-        int nc = spec.nchannels;
-        int ac = spec.alpha_channel;
-        for (ImageBuf::Iterator<float> d(dst, roi); !d.done(); ++d) {
-            float alpha = d[ac];
-            if (alpha != 0.0f) {
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            float* d = base + (imagesize_t(y - dst.ybegin()) * spec.width
+                               + (roi.xbegin - dst.xbegin()))
+                                  * nc;
+            for (int x = roi.xbegin; x < roi.xend; ++x, d += nc) {
+                float alpha = d[ac];
+                if (alpha != 0.0f) {
+                    for (int c = 0; c < nc; ++c)
+                        d[c] = d[c] / alpha;
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
+
+// Helper for fillholes_pp: composite big over its blown-up next-coarser
+// level, in place, as over() would. Pixels that are already opaque are
+// left untouched, which is most of them near the top of the pyramid.
+static bool
+pull_over(ImageBuf& big, const ImageBuf& blowup, int nthreads)
+{
+    const ImageSpec& spec(big.spec());
+    ASSERT(spec.format == TypeDesc::FLOAT && big.localpixels()
+           && blowup.localpixels());
+    int nc             = spec.nchannels;
+    int ac             = spec.alpha_channel;
+    int zc             = spec.z_channel;
+    float* base        = (float*)big.pixeladdr(big.xbegin(), big.ybegin());
+    const float* bbase = (const float*)blowup.pixeladdr(big.xbegin(),
+                                                        big.ybegin());
+    ImageBufAlgo::parallel_image(big.roi(), nthreads, [&](ROI roi) {
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            imagesize_t offset = (imagesize_t(y - big.ybegin()) * spec.width
+                                  + (roi.xbegin - big.xbegin()))
+                                 * nc;
+            float* a       = base + offset;
+            const float* b = bbase + offset;
+            for (int x = roi.xbegin; x < roi.xend; ++x, a += nc, b += nc) {
+                float alpha = clamp(a[ac], 0.0f, 1.0f);
+                if (alpha == 1.0f)
+                    continue;
+                float one_minus_alpha = 1.0f - alpha;
                 for (int c = 0; c < nc; ++c)
-                    d[c] = d[c] / alpha;
+                    if (c != zc)
+                        a[c] = a[c] + one_minus_alpha * b[c];
+                if (zc >= 0 && alpha == 0.0f)
+                    a[zc] = b[zc];
             }
         }
     });
@@ -1208,32 +2142,50 @@ ImageBufAlgo::fillholes_pushpull(ImageBuf& dst, const ImageBuf& src, ROI roi,
                      | IBAprep_NO_SUPPORT_VOLUME);
     if (!IBAprep(roi, &dst, &src, req))
         return false;
-    // We generate a bunch of temp images to form an image pyramid.
-    // These give us a place to stash them and make sure they are
-    // auto-deleted when the function exits.
-    std::vector<std::shared_ptr<ImageBuf>> pyramid;
-
-    // First, make a writeable copy of the original image (converting
-    // to float as a convenience) as the top level of the pyramid.
+    // The levels of the image pyramid, and one scratch level the size of
+    // the top for blowing up the coarser levels on the way back down,
+    // are all carved out of a single float allocation that is freed when
+    // the function exits.
     ImageSpec topspec = src.spec();
     topspec.set_format(TypeDesc::FLOAT);
-    ImageBuf* top = new ImageBuf(topspec);
-    paste(*top, topspec.x, topspec.y, topspec.z, 0, src);
-    pyramid.emplace_back(top);
-
-    // Construct the rest of the pyramid by successive x/2 resizing and
-    // then dividing nonzero alpha pixels by their alpha (this "spreads
-    // out" the defined part of the image).
+    std::vector<ImageSpec> levelspecs(1, topspec);
     int w = src.spec().width, h = src.spec().height;
     while (w > 1 || h > 1) {
         w = std::max(1, w / 2);
         h = std::max(1, h / 2);
         ImageSpec smallspec(w, h, src.nchannels(), TypeDesc::FLOAT);
-        ImageBuf* small = new ImageBuf(smallspec);
-        ImageBufAlgo::resize(*small, *pyramid.back(), "triangle");
-        divide_by_alpha(*small, get_roi(smallspec), nthreads);
-        pyramid.emplace_back(small);
-        //debug small->save();
+        smallspec.channelnames  = topspec.channelnames;
+        smallspec.alpha_channel = topspec.alpha_channel;
+        smallspec.z_channel     = topspec.z_channel;
+        levelspecs.push_back(smallspec);
+    }
+    imagesize_t arenasize = topspec.image_pixels() * topspec.nchannels;
+    for (auto& spec : levelspecs)
+        arenasize += spec.image_pixels() * spec.nchannels;
+    std::unique_ptr<float[]> arena(new float[arenasize]);
+    std::vector<ImageBuf> pyramid;
+    pyramid.reserve(levelspecs.size());
+    float* next = arena.get();
+    for (auto& spec : levelspecs) {
+        pyramid.emplace_back(spec, next);
+        next += spec.image_pixels() * spec.nchannels;
+    }
+    float* scratch = next;
+
+    // First, make a writeable copy of the original image (converting
+    // to float as a convenience) as the top level of the pyramid.
+    paste(pyramid[0], topspec.x, topspec.y, topspec.z, 0, src, ROI(),
+          nthreads);
+
+    // Construct the rest of the pyramid by successive x/2 resizing and
+    // then dividing nonzero alpha pixels by their alpha (this "spreads
+    // out" the defined part of the image).
+    for (size_t i = 1; i < pyramid.size(); ++i) {
+        ImageBuf& small(pyramid[i]);
+        ImageBufAlgo::resize(small, pyramid[i - 1], "triangle", 0.0f, ROI(),
+                             nthreads);
+        divide_by_alpha(small, small.roi(), nthreads);
+        //debug small.save();
     }
 
     // Now pull back up the pyramid by doing an alpha composite of level
@@ -1242,16 +2194,18 @@ ImageBufAlgo::fillholes_pushpull(ImageBuf& dst, const ImageBuf& src, ROI roi,
     // unchanged, those with alpha < 1 are replaced by the blended
     // colors of the higher pyramid levels.
     for (int i = (int)pyramid.size() - 2; i >= 0; --i) {
-        ImageBuf &big(*pyramid[i]), &small(*pyramid[i + 1]);
-        ImageBuf blowup(big.spec());
-        ImageBufAlgo::resize(blowup, small, "triangle");
-        ImageBufAlgo::over(big, big, blowup);
+        ImageBuf &big(pyramid[i]), &small(pyramid[i + 1]);
+        ImageBuf blowup(big.spec(), scratch);
+        ImageBufAlgo::resize(blowup, small, "triangle", 0.0f, ROI(),
+                             nthreads);
+        pull_over(big, blowup, nthreads);
         //debug big.save (Strutil::sprintf("after%d.exr", i));
     }
 
     // Now copy the completed base layer of the pyramid back to the
     // original requested output.
-    paste(dst, src.spec().x, src.spec().y, src.spec().z, 0, *pyramid[0]);
+    paste(dst, src.spec().x, src.spec().y, src.spec().z, 0, pyramid[0],
+          ROI(), nthreads);
 
     return true;
 }
@@ -1269,4 +2223,103 @@ ImageBufAlgo::fillholes_pushpull(const ImageBuf& src, ROI roi, int nthreads)
 }
 
 
+
+bool
+ImageBufAlgo::stream_to_output(ImageOutput* out,
+                               function_view<bool(ImageBuf& dst, ROI roi)> func,
+                               int bandheight)
+{
+    pvt::LoggedTimer logtime("IBA::stream_to_output");
+    if (!out) {
+        pvt::errorf("stream_to_output: no open output");
+        return false;
+    }
+    const ImageSpec& outspec(out->spec());
+    if (outspec.depth > 1) {
+        pvt::errorf("stream_to_output does not support volume images");
+        return false;
+    }
+    bool tiled = outspec.tile_width > 0;
+    if (bandheight < 1)
+        bandheight = 64;
+    if (tiled)
+        bandheight = round_to_multiple(bandheight, outspec.tile_height);
+
+    // Each band is a local buffer in the file's data type, covering whole
+    // rows, so it can be handed straight to write_tiles/write_scanlines.
+    ImageSpec bandspec  = outspec;
+    bandspec.tile_width = bandspec.tile_height = bandspec.tile_depth = 0;
+    bandspec.channelformats.clear();
+    ImageBuf band;
+    bool ok  = true;
+    int yend = outspec.y + outspec.height;
+    for (int y = outspec.y; ok && y < yend; y += bandheight) {
+        ROI roi(outspec.x, outspec.x + outspec.width, y,
+                std::min(y + bandheight, yend), outspec.z, outspec.z + 1, 0,
+                outspec.nchannels);
+        bandspec.y      = roi.ybegin;
+        bandspec.height = roi.height();
+        band.reset(bandspec);
+        if (!func(band, roi)) {
+            pvt::errorf("%s", band.has_error() ? band.geterror()
+                                               : std::string("band failed"));
+            ok = false;
+            break;
+        }
+        if (band.roi() != roi || !band.localpixels()) {
+            pvt::errorf("stream_to_output: band was not filled in place");
+            ok = false;
+            break;
+        }
+        TypeDesc format = band.spec().format;
+        if (tiled)
+            ok = out->write_tiles(roi.xbegin, roi.xend, roi.ybegin, roi.yend,
+                                  roi.zbegin, roi.zend, format,
+                                  band.localpixels());
+        else
+            ok = out->write_scanlines(roi.ybegin, roi.yend, roi.zbegin, format,
+                                      band.localpixels());
+        if (!ok)
+            pvt::errorf("%s", out->geterror());
+    }
+    return ok;
+}
+
+
+
+bool
+ImageBufAlgo::stream_to_file(string_view outputfilename, const ImageSpec& spec,
+                             function_view<bool(ImageBuf& dst, ROI roi)> func,
+                             int bandheight)
+{
+    pvt::LoggedTimer logtime("IBA::stream_to_file");
+    if (spec.depth > 1) {
+        pvt::errorf("stream_to_file does not support volume images");
+        return false;
+    }
+    auto out = ImageOutput::create(outputfilename);
+    if (!out) {
+        pvt::errorf("Could not create output \"%s\": %s", outputfilename,
+                    OIIO::geterror());
+        return false;
+    }
+    ImageSpec outspec = spec;
+    if (outspec.tile_width && !out->supports("tiles")) {
+        outspec.tile_width  = 0;
+        outspec.tile_height = 0;
+        outspec.tile_depth  = 0;
+    }
+    if (!out->open(outputfilename, outspec)) {
+        pvt::errorf("%s", out->geterror());
+        return false;
+    }
+    bool ok = stream_to_output(out.get(), func, bandheight);
+    if (!out->close() && ok) {
+        pvt::errorf("%s", out->geterror());
+        ok = false;
+    }
+    return ok;
+}
+
+
 OIIO_NAMESPACE_END
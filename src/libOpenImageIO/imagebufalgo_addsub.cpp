@@ -44,6 +44,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 
+#include "imagebufalgo_simdrows.h"
 #include "imageio_pvt.h"
 
 
@@ -55,6 +56,13 @@ static bool
 add_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype, Btype>()
+        && pvt::simd_rows_ok(roi, R, A, B)) {
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdAdd(), A, B);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -72,6 +80,13 @@ template<class Rtype, class Atype>
 static bool
 add_impl(ImageBuf& R, const ImageBuf& A, cspan<float> b, ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype>() && pvt::simd_rows_ok(roi, R, A)) {
+        pvt::SimdRowsConst bk(b, R.nchannels());
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdAdd(), A, bk);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -184,6 +199,13 @@ static bool
 sub_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype, Btype>()
+        && pvt::simd_rows_ok(roi, R, A, B)) {
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdSub(), A, B);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -0,0 +1,560 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+// Benchmarks of ImageBufAlgo: every kind of operation (pointwise math,
+// resize and warp with each filter, convolution by kernel size, median
+// and morphology by window size, color conversion, compositing, deep
+// operations, statistics), across data types, channel counts, image sizes
+// and thread counts.
+//
+// Each result is named "op[/variant] type channels res threads", and
+// times are always printed in microseconds, so that the output of two
+// builds can be diffed line by line. "--json file" also writes them in
+// the same schema as imagecachespeed_test, with "type", "channels" and
+// "res" added to each result.
+
+
+#include <OpenImageIO/argparse.h>
+#include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/filter.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/ustring.h>
+
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace OIIO;
+
+static bool verbose = false;
+static bool list    = false;
+static int ntrials  = 5;
+static std::string typelist    = "float,half,uint8";
+static std::string channellist = "4";
+static std::string reslist     = "1024";
+static std::string threadlist;
+static std::string oplist;
+static std::string json_filename;
+
+
+
+// What an op takes as input: flat images, flat images with a Z channel,
+// or deep images.
+enum class Input { Flat, FlatZ, Deep };
+
+typedef std::function<bool(ImageBuf& dst, const ImageBuf& A,
+                           const ImageBuf& B, int nthreads)>
+    OpFunc;
+
+struct Op {
+    std::string name;
+    OpFunc func;
+    int minchannels = 1;
+    bool floatonly  = false;
+    Input input     = Input::Flat;
+};
+
+
+
+// All the operations, with their variants.
+static std::vector<Op>
+all_ops()
+{
+    namespace IBA = ImageBufAlgo;
+    std::vector<Op> ops;
+    auto add = [&](const std::string& name, OpFunc func, int minchannels = 1,
+                   bool floatonly = false, Input input = Input::Flat) {
+        Op op;
+        op.name        = name;
+        op.func        = func;
+        op.minchannels = minchannels;
+        op.floatonly   = floatonly;
+        op.input       = input;
+        ops.push_back(op);
+    };
+    typedef const ImageBuf& CIB;
+
+    // Patterns
+    add("zero", [](ImageBuf& R, CIB A, CIB, int nt) {
+        if (!R.initialized())
+            R.reset(A.spec());
+        return IBA::zero(R, {}, nt);
+    });
+    add("fill", [](ImageBuf& R, CIB A, CIB, int nt) {
+        if (!R.initialized())
+            R.reset(A.spec());
+        return IBA::fill(R, { 0.25f, 0.5f, 0.75f, 1.0f }, {}, nt);
+    });
+    add("checker", [](ImageBuf& R, CIB A, CIB, int nt) {
+        if (!R.initialized())
+            R.reset(A.spec());
+        return IBA::checker(R, 16, 16, 1, { 0.0f, 0.0f, 0.0f, 1.0f },
+                            { 1.0f, 1.0f, 1.0f, 1.0f }, 0, 0, 0, {}, nt);
+    });
+    add("noise", [](ImageBuf& R, CIB A, CIB, int nt) {
+        if (!R.initialized())
+            R.reset(A.spec());
+        return IBA::noise(R, "gaussian", 0.0f, 0.1f, false, 0, {}, nt);
+    });
+
+    // Copies and channel shuffles
+    add("copy", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::copy(R, A, TypeUnknown, {}, nt);
+    });
+    add("copy_to_float", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::copy(R, A, TypeFloat, {}, nt);
+    });
+    add("channels_reverse", [](ImageBuf& R, CIB A, CIB, int nt) {
+        int n = A.nchannels();
+        std::vector<int> order(n);
+        for (int c = 0; c < n; ++c)
+            order[c] = n - 1 - c;
+        return IBA::channels(R, A, n, order, {}, {}, false, nt);
+    });
+    add("channel_sum", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::channel_sum(R, A, 1.0f, {}, nt);
+    });
+
+    // Pointwise math
+    add("add", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::add(R, A, B, {}, nt);
+    });
+    add("add_const", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::add(R, A, 0.125f, {}, nt);
+    });
+    add("sub", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::sub(R, A, B, {}, nt);
+    });
+    add("mul", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::mul(R, A, B, {}, nt);
+    });
+    add("mul_const", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::mul(R, A, 0.5f, {}, nt);
+    });
+    add("div", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::div(R, A, B, {}, nt);
+    });
+    add("mad", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::mad(R, A, B, A, {}, nt);
+    });
+    add("absdiff", [](ImageBuf& R, CIB A, CIB B, int nt) {
+        return IBA::absdiff(R, A, B, {}, nt);
+    });
+    add("abs", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::abs(R, A, {}, nt);
+    });
+    add("pow", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::pow(R, A, 2.2f, {}, nt);
+    });
+    add("clamp", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::clamp(R, A, 0.25f, 0.75f, false, {}, nt);
+    });
+    add("invert", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::invert(R, A, {}, nt);
+    });
+    add("rangecompress", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::rangecompress(R, A, false, {}, nt);
+    });
+    add("rangeexpand", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::rangeexpand(R, A, false, {}, nt);
+    });
+
+    // Alpha and compositing
+    add("premult",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            return IBA::premult(R, A, {}, nt);
+        },
+        4);
+    add("unpremult",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            return IBA::unpremult(R, A, {}, nt);
+        },
+        4);
+    add("over",
+        [](ImageBuf& R, CIB A, CIB B, int nt) {
+            return IBA::over(R, A, B, {}, nt);
+        },
+        4);
+
+    // Color
+    add("colorconvert",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            return IBA::colorconvert(R, A, "linear", "sRGB", true, "", "",
+                                     nullptr, {}, nt);
+        },
+        3);
+
+    // Orientation
+    add("flip", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::flip(R, A, {}, nt);
+    });
+    add("flop", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::flop(R, A, {}, nt);
+    });
+    add("transpose", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::transpose(R, A, {}, nt);
+    });
+    add("rotate90", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::rotate90(R, A, {}, nt);
+    });
+    add("circular_shift", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::circular_shift(R, A, 17, 31, 0, {}, nt);
+    });
+
+    // Resizing and warping, with each 2D filter
+    add("resample", [](ImageBuf& R, CIB A, CIB, int nt) {
+        ROI roi = A.roi();
+        roi.xend /= 2;
+        roi.yend /= 2;
+        return IBA::resample(R, A, true, roi, nt);
+    });
+    for (int i = 0, e = Filter2D::num_filters(); i < e; ++i) {
+        FilterDesc fd;
+        Filter2D::get_filterdesc(i, &fd);
+        if (fd.dim != 2)
+            continue;
+        std::string filtername = fd.name;
+        add(Strutil::sprintf("resize/%s", filtername),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                ROI roi = A.roi();
+                roi.xend /= 2;
+                roi.yend /= 2;
+                return IBA::resize(R, A, filtername, 0.0f, roi, nt);
+            });
+        add(Strutil::sprintf("warp/%s", filtername),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                Imath::M33f M;
+                M.setRotation(0.25f);
+                return IBA::warp(R, A, M, filtername, 0.0f, false,
+                                 ImageBuf::WrapDefault, {}, nt);
+            });
+    }
+
+    // Filtering, by window size
+    for (int w : { 3, 7, 15 }) {
+        auto K = std::make_shared<ImageBuf>(
+            IBA::make_kernel("gaussian", w, w));
+        add(Strutil::sprintf("convolve/%d", w),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                return IBA::convolve(R, A, *K, true, {}, nt);
+            });
+    }
+    for (int w : { 3, 5, 7 }) {
+        add(Strutil::sprintf("median/%d", w),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                return IBA::median_filter(R, A, w, w, {}, nt);
+            });
+        add(Strutil::sprintf("dilate/%d", w),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                return IBA::dilate(R, A, w, w, {}, nt);
+            });
+        add(Strutil::sprintf("erode/%d", w),
+            [=](ImageBuf& R, CIB A, CIB, int nt) {
+                return IBA::erode(R, A, w, w, {}, nt);
+            });
+    }
+    add("unsharp_mask", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::unsharp_mask(R, A, "gaussian", 3.0f, 1.0f, 0.0f, {}, nt);
+    });
+    add("laplacian", [](ImageBuf& R, CIB A, CIB, int nt) {
+        return IBA::laplacian(R, A, {}, nt);
+    });
+    add("fft",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            ROI roi = A.roi();
+            roi.chend = 1;
+            return IBA::fft(R, A, roi, nt);
+        },
+        1, true);
+
+    // Statistics
+    add("computePixelStats", [](ImageBuf&, CIB A, CIB, int nt) {
+        return IBA::computePixelStats(A, {}, nt).min.size() > 0;
+    });
+    add("compare", [](ImageBuf&, CIB A, CIB B, int nt) {
+        return IBA::compare(A, B, 1.0f, 1.0f, ROI(), nt).nfail >= 0;
+    });
+
+    // Deep
+    add("deepen",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            R.clear();
+            return IBA::deepen(R, A, 1.0f, {}, nt);
+        },
+        1, true, Input::FlatZ);
+    add("flatten",
+        [](ImageBuf& R, CIB A, CIB, int nt) {
+            return IBA::flatten(R, A, {}, nt);
+        },
+        1, true, Input::Deep);
+    add("deep_merge",
+        [](ImageBuf& R, CIB A, CIB B, int nt) {
+            R.clear();
+            return IBA::deep_merge(R, A, B, true, {}, nt);
+        },
+        1, true, Input::Deep);
+    add("deep_holdout",
+        [](ImageBuf& R, CIB A, CIB B, int nt) {
+            R.clear();
+            return IBA::deep_holdout(R, A, B, {}, nt);
+        },
+        1, true, Input::Deep);
+    return ops;
+}
+
+
+
+struct BenchResult {
+    std::string name;
+    std::string type;
+    int channels, res, threads;
+    size_t work, trials, iterations;
+    double mean, stddev, median, range;
+};
+
+static std::vector<BenchResult> results;
+
+
+
+static void
+getargs(int argc, char* argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    // clang-format off
+    ap.options(
+        "imagebufalgo_bench\n" OIIO_INTRO_STRING "\n"
+        "Usage:  imagebufalgo_bench [options]",
+        "--help", &help, "Print help message",
+        "-v", &verbose, "Verbose mode",
+        "--list", &list, "List the operations and exit",
+        "--ops %s", &oplist,
+            "Comma-separated operations (or prefixes, like \"resize\") to run (default: all)",
+        "--types %s", &typelist,
+            ustring::sprintf("Comma-separated data types (default: %s)", typelist).c_str(),
+        "--channels %s", &channellist,
+            ustring::sprintf("Comma-separated channel counts (default: %s)", channellist).c_str(),
+        "--res %s", &reslist,
+            ustring::sprintf("Comma-separated image resolutions (default: %s)", reslist).c_str(),
+        "--threads %s", &threadlist,
+            "Comma-separated thread counts (default: 1 and all cores)",
+        "--trials %d", &ntrials,
+            ustring::sprintf("Number of trials (default: %d)", ntrials).c_str(),
+        "--json %s", &json_filename, "Also write the results to this JSON file",
+        nullptr);
+    // clang-format on
+    if (ap.parse(argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static std::vector<int>
+int_list(string_view list)
+{
+    std::vector<int> vals;
+    for (auto v : Strutil::splits(list, ","))
+        vals.push_back(Strutil::stoi(v));
+    return vals;
+}
+
+
+
+static bool
+selected(const std::string& name, const std::vector<std::string>& wanted)
+{
+    if (wanted.empty())
+        return true;
+    for (auto& w : wanted)
+        if (name == w || Strutil::starts_with(name, w + "/"))
+            return true;
+    return false;
+}
+
+
+
+// The input images for one combination of type, channels and size.
+struct Inputs {
+    ImageBuf A, B;            // smooth, with some noise
+    ImageBuf AZ, BZ;          // the same with a Z channel
+    ImageBuf Adeep, Bdeep;    // deepened
+};
+
+static void
+make_inputs(Inputs& in, TypeDesc type, int nchannels, int res, bool deep)
+{
+    namespace IBA = ImageBufAlgo;
+    ImageSpec spec(res, res, nchannels, type);
+    spec.alpha_channel = nchannels >= 4 ? 3 : -1;
+    in.A.reset(spec);
+    in.B.reset(spec);
+    IBA::fill(in.A, { 0.1f, 0.2f, 0.3f, 0.5f }, { 0.9f, 0.8f, 0.7f, 1.0f },
+              { 0.3f, 0.9f, 0.1f, 0.75f }, { 0.6f, 0.1f, 0.8f, 0.25f });
+    IBA::fill(in.B, { 0.5f, 0.5f, 0.5f, 1.0f }, { 0.25f, 0.75f, 0.5f, 0.5f },
+              ROI());
+    IBA::noise(in.A, "uniform", 0.0f, 0.1f, false, 1);
+    IBA::noise(in.B, "uniform", 0.0f, 0.1f, false, 2);
+    if (!deep)
+        return;
+    ImageBuf Z(ImageSpec(res, res, 1, TypeDesc::FLOAT));
+    Z.specmod().channelnames = { "Z" };
+    IBA::fill(Z, { 1.0f }, { 2.0f }, ROI());
+    in.AZ = IBA::channel_append(in.A, Z);
+    IBA::fill(Z, { 2.0f }, { 1.0f }, ROI());
+    in.BZ = IBA::channel_append(in.B, Z);
+    in.AZ.specmod().z_channel = nchannels;
+    in.BZ.specmod().z_channel = nchannels;
+    IBA::deepen(in.Adeep, in.AZ);
+    IBA::deepen(in.Bdeep, in.BZ);
+}
+
+
+
+static void
+write_json(const std::string& filename)
+{
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Could not open " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    out << "{\n"
+        << "  \"schema\": \"oiio-imagebufalgo-benchmark\",\n"
+        << "  \"schema_version\": 1,\n"
+        << "  \"oiio_version\": \"" << OIIO_VERSION_STRING << "\",\n"
+        << "  \"hardware_threads\": " << Sysutil::hardware_concurrency()
+        << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r(results[i]);
+        double opsec = r.mean > 0.0 ? r.work / r.mean : 0.0;
+        out << Strutil::sprintf(
+            "    { \"name\": \"%s\", \"type\": \"%s\", \"channels\": %d,\n"
+            "      \"res\": %d, \"threads\": %d, \"work\": %d,\n"
+            "      \"trials\": %d, \"iterations\": %d,\n"
+            "      \"seconds\": { \"mean\": %.6g, \"stddev\": %.6g,\n"
+            "                   \"median\": %.6g, \"range\": %.6g },\n"
+            "      \"ns_per_op\": %.6g, \"ops_per_second\": %.6g }%s\n",
+            r.name, r.type, r.channels, r.res, r.threads, r.work, r.trials,
+            r.iterations, r.mean, r.stddev, r.median, r.range,
+            1.0e9 * r.mean / r.work, opsec,
+            i + 1 < results.size() ? "," : "");
+    }
+    out << "  ]\n}\n";
+}
+
+
+
+int
+main(int argc, char** argv)
+{
+    getargs(argc, argv);
+    std::vector<Op> ops = all_ops();
+    if (list) {
+        for (auto& op : ops)
+            std::cout << op.name << "\n";
+        return 0;
+    }
+
+    std::vector<std::string> wanted = Strutil::splits(oplist, ",");
+    std::vector<int> threadcounts   = int_list(threadlist);
+    if (threadcounts.empty()) {
+        threadcounts.push_back(1);
+        if (Sysutil::hardware_concurrency() > 1)
+            threadcounts.push_back(Sysutil::hardware_concurrency());
+    }
+    bool anydeep = false;
+    for (auto& op : ops)
+        anydeep |= (op.input != Input::Flat && selected(op.name, wanted));
+
+    Benchmarker bench;
+    bench.trials(ntrials)
+        .units(Benchmarker::Unit::us)
+        .indent(2)
+        .verbose(verbose ? 2 : 1);
+    for (int res : int_list(reslist)) {
+        for (int nchannels : int_list(channellist)) {
+            for (auto&& typename_ : Strutil::splits(typelist, ",")) {
+                TypeDesc type(typename_);
+                Inputs in;
+                make_inputs(in, type, nchannels, res,
+                            anydeep && type == TypeDesc::FLOAT);
+                std::cout << Strutil::sprintf("%s, %d channels, %d x %d:\n",
+                                              typename_, nchannels, res, res);
+                for (auto& op : ops) {
+                    if (!selected(op.name, wanted) || nchannels < op.minchannels
+                        || (op.floatonly && type != TypeDesc::FLOAT))
+                        continue;
+                    const ImageBuf& A(op.input == Input::Deep
+                                          ? in.Adeep
+                                          : op.input == Input::FlatZ ? in.AZ
+                                                                     : in.A);
+                    const ImageBuf& B(op.input == Input::Deep
+                                          ? in.Bdeep
+                                          : op.input == Input::FlatZ ? in.BZ
+                                                                     : in.B);
+                    for (int nt : threadcounts) {
+                        ImageBuf R;
+                        bool ok = true;
+                        bench.work(size_t(res) * res);
+                        bench(Strutil::sprintf("%-24s %-6s %dch %5d t%-3d",
+                                               op.name, typename_, nchannels,
+                                               res, nt),
+                              [&]() { ok &= op.func(R, A, B, nt); });
+                        if (!ok)
+                            std::cout << "    " << op.name
+                                      << " failed: " << R.geterror() << "\n";
+                        results.push_back({ op.name, typename_, nchannels,
+                                            res, nt, bench.work(),
+                                            bench.trials(), bench.iterations(),
+                                            bench.avg(), bench.stddev(),
+                                            bench.median(), bench.range() });
+                    }
+                }
+            }
+        }
+    }
+
+    if (json_filename.size())
+        write_json(json_filename);
+    return 0;
+}
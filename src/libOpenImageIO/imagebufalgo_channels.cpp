@@ -36,6 +36,8 @@
 #include <OpenEXR/half.h>
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #include <OpenImageIO/deepdata.h>
@@ -74,6 +76,100 @@ channels_(ImageBuf& dst, const ImageBuf& src, cspan<int> channelorder,
 
 
 
+// Can the channels of src be moved into dst by copying the raw pixel
+// values, with no iterators or conversions? Both must be local and share
+// a single data type over the same data window.
+static bool
+channels_local_ok(const ImageBuf& dst, const ImageBuf& src)
+{
+    return dst.localpixels() && src.localpixels() && !src.deep()
+           && dst.spec().format == src.spec().format
+           && src.spec().channelformats.empty()
+           && dst.spec().channelformats.empty() && dst.roi() == src.roi()
+           && dst.pixel_stride() % dst.spec().format.size() == 0
+           && src.pixel_stride() % src.spec().format.size() == 0;
+}
+
+
+
+// Gather channels between local images of one data type. Dst channel c
+// is copied from src channel chanmap[c], or set to fill[c] (already
+// in the pixel data type) if chanmap[c] < 0. Only bit patterns are moved,
+// so T need merely be an unsigned integer of the pixel data type's size.
+template<typename T>
+static bool
+channels_local_(ImageBuf& dst, const ImageBuf& src, cspan<int> chanmap,
+                const T* fill, int nthreads)
+{
+    int dnc = dst.nchannels(), snc = src.nchannels();
+    bool identity = (dnc == snc);
+    for (int c = 0; c < dnc; ++c)
+        identity &= (chanmap[c] == c);
+    // Only ask for a writeable address once, rather than for every row.
+    char* dbase = (char*)dst.pixeladdr(dst.xbegin(), dst.ybegin(),
+                                       dst.zbegin());
+    stride_t dxs = dst.pixel_stride(), sxs = src.pixel_stride();
+    bool rowcopy = identity && dxs == sxs
+                   && dxs == stride_t(dnc * sizeof(T));
+    ImageBufAlgo::parallel_image(dst.roi(), nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                char* d = dbase + (z - dst.zbegin()) * dst.z_stride()
+                          + (y - dst.ybegin()) * dst.scanline_stride()
+                          + (roi.xbegin - dst.xbegin()) * dxs;
+                const char* s = (const char*)src.pixeladdr(roi.xbegin, y, z);
+                if (rowcopy) {
+                    memcpy(d, s, roi.width() * dxs);
+                    continue;
+                }
+                for (int x = roi.xbegin; x < roi.xend;
+                     ++x, d += dxs, s += sxs) {
+                    T* dp       = (T*)d;
+                    const T* sp = (const T*)s;
+                    for (int c = 0; c < dnc; ++c)
+                        dp[c] = chanmap[c] >= 0 ? sp[chanmap[c]] : fill[c];
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
+
+// Dispatch channels_local_ on the size of the pixel data type, converting
+// the fill values to that type just once.
+static bool
+channels_local(ImageBuf& dst, const ImageBuf& src, cspan<int> channelorder,
+               cspan<float> channelvalues, int nthreads)
+{
+    TypeDesc format = dst.spec().format;
+    int dnc = dst.nchannels(), snc = src.nchannels();
+    int* chanmap = ALLOCA(int, dnc);
+    float* fvals = ALLOCA(float, dnc);
+    for (int c = 0; c < dnc; ++c) {
+        int cc     = channelorder[c];
+        chanmap[c] = (cc >= 0 && cc < snc) ? cc : -1;
+        fvals[c]   = channelvalues.size() > c ? channelvalues[c] : 0.0f;
+    }
+    char* fill = ALLOCA(char, dnc * format.size());
+    convert_types(TypeFloat, fvals, format, fill, dnc);
+    cspan<int> map(chanmap, dnc);
+    switch (format.size()) {
+    case 1:
+        return channels_local_(dst, src, map, (const uint8_t*)fill, nthreads);
+    case 2:
+        return channels_local_(dst, src, map, (const uint16_t*)fill, nthreads);
+    case 4:
+        return channels_local_(dst, src, map, (const uint32_t*)fill, nthreads);
+    case 8:
+        return channels_local_(dst, src, map, (const uint64_t*)fill, nthreads);
+    }
+    return false;
+}
+
+
+
 bool
 ImageBufAlgo::channels(ImageBuf& dst, const ImageBuf& src, int nchannels,
                        cspan<int> channelorder, cspan<float> channelvalues,
@@ -200,6 +296,12 @@ ImageBufAlgo::channels(ImageBuf& dst, const ImageBuf& src, int nchannels,
     }
     // Below is the non-deep case
 
+    // Same-typed local images (e.g., picking RGB out of a many-channel
+    // EXR that was read into memory) just gather the raw channel values.
+    if (channels_local_ok(dst, src)
+        && channels_local(dst, src, channelorder, channelvalues, nthreads))
+        return true;
+
     bool ok;
     OIIO_DISPATCH_TYPES(ok, "channels", channels_, dst.spec().format, dst, src,
                         channelorder, channelvalues, dst.roi(), nthreads);
@@ -248,6 +350,57 @@ channel_append_impl(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B,
 }
 
 
+
+// Append the channels of same-typed local images by copying each pixel's
+// raw values of A and then of B, no iterators or conversions.
+static bool
+channel_append_local_ok(const ImageBuf& dst, const ImageBuf& A,
+                        const ImageBuf& B, ROI roi)
+{
+    TypeDesc format = dst.spec().format;
+    return dst.localpixels() && A.localpixels() && B.localpixels()
+           && !A.deep() && !B.deep() && A.spec().format == format
+           && B.spec().format == format && dst.spec().channelformats.empty()
+           && A.spec().channelformats.empty()
+           && B.spec().channelformats.empty()
+           && dst.nchannels() == A.nchannels() + B.nchannels()
+           && dst.roi().contains(roi) && A.roi().contains(roi)
+           && B.roi().contains(roi) && roi.npixels() > 0;
+}
+
+
+
+static bool
+channel_append_local(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B,
+                     ROI roi, int nthreads)
+{
+    size_t abytes = A.nchannels() * A.spec().format.size();
+    size_t bbytes = B.nchannels() * B.spec().format.size();
+    // Only ask for a writeable address once, rather than for every row.
+    char* dbase = (char*)dst.pixeladdr(dst.xbegin(), dst.ybegin(),
+                                       dst.zbegin());
+    stride_t dxs = dst.pixel_stride(), axs = A.pixel_stride();
+    stride_t bxs = B.pixel_stride();
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                char* d = dbase + (z - dst.zbegin()) * dst.z_stride()
+                          + (y - dst.ybegin()) * dst.scanline_stride()
+                          + (roi.xbegin - dst.xbegin()) * dxs;
+                const char* a = (const char*)A.pixeladdr(roi.xbegin, y, z);
+                const char* b = (const char*)B.pixeladdr(roi.xbegin, y, z);
+                for (int x = roi.xbegin; x < roi.xend;
+                     ++x, d += dxs, a += axs, b += bxs) {
+                    memcpy(d, a, abytes);
+                    memcpy(d + abytes, b, bbytes);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
 bool
 ImageBufAlgo::channel_append(ImageBuf& dst, const ImageBuf& A,
                              const ImageBuf& B, ROI roi, int nthreads)
@@ -296,6 +449,9 @@ ImageBufAlgo::channel_append(ImageBuf& dst, const ImageBuf& A,
         dst.reset(dstspec);
     }
 
+    if (channel_append_local_ok(dst, A, B, roi))
+        return channel_append_local(dst, A, B, roi, nthreads);
+
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3(ok, "channel_append", channel_append_impl,
                                 dst.spec().format, A.spec().format,
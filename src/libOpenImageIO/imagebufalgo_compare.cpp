@@ -34,17 +34,24 @@
 
 #include <OpenEXR/half.h>
 
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
 
 #include <OpenImageIO/SHA1.h>
 #include <OpenImageIO/dassert.h>
+#include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/thread.h>
 
+#include "imagebufalgo_simdrows.h"
 #include "imageio_pvt.h"
 
 OIIO_NAMESPACE_BEGIN
@@ -144,6 +151,70 @@ finalize(ImageBufAlgo::PixelStats& p)
 
 
 
+// Accumulate the stats of whole rows of contiguous local pixels that span
+// all channels, 8 values at a time. The lanes of the nchannels 8-wide
+// blocks that cover each pixel-aligned run of 8 pixels map to channel
+// (8*block+lane) % nchannels. Blocks that are entirely finite (the usual
+// case) skip the per-value NaN/Inf checks; min and max are vectorized and
+// the sums are still accumulated in double, per lane.
+template<class T>
+static void
+pixel_stats_rows(const ImageBuf& src, ROI roi, ImageBufAlgo::PixelStats& p)
+{
+    using namespace simd;
+    const int nc     = src.nchannels();
+    const int nlanes = 8 * nc;
+    const float inf  = std::numeric_limits<float>::infinity();
+    std::vector<vfloat8> vmin(nc, vfloat8(inf)), vmax(nc, vfloat8(-inf));
+    std::vector<double> sum(nlanes, 0.0), sum2(nlanes, 0.0);
+    std::vector<imagesize_t> nfinite(nc, 0);
+    size_t n = size_t(roi.width()) * nc;
+    for (int z = roi.zbegin; z < roi.zend; ++z) {
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            const T* s = (const T*)src.pixeladdr(roi.xbegin, y, z);
+            size_t i   = 0;
+            for (; i + nlanes <= n; i += nlanes) {
+                for (int b = 0; b < nc; ++b) {
+                    vfloat8 v = pvt::simd_load8(s + i + 8 * b);
+                    // v-v is 0 for finite values, NaN for NaN and Inf.
+                    if (all((v - v) == vfloat8::Zero())) {
+                        vmin[b] = min(vmin[b], v);
+                        vmax[b] = max(vmax[b], v);
+                        float f[8];
+                        v.store(f);
+                        double* bsum  = &sum[8 * b];
+                        double* bsum2 = &sum2[8 * b];
+                        for (int l = 0; l < 8; ++l) {
+                            bsum[l] += f[l];
+                            bsum2[l] += f[l] * f[l];
+                        }
+                        ++nfinite[b];
+                    } else {
+                        for (int l = 0; l < 8; ++l)
+                            val(p, (8 * b + l) % nc, v[l]);
+                    }
+                }
+            }
+            for (; i < n; ++i)
+                val(p, int(i % nc), convert_type<T, float>(s[i]));
+        }
+    }
+    for (int b = 0; b < nc; ++b) {
+        for (int l = 0; l < 8; ++l) {
+            int c = (8 * b + l) % nc;
+            p.finitecount[c] += nfinite[b];
+            p.sum[c] += sum[8 * b + l];
+            p.sum2[c] += sum2[8 * b + l];
+            if (nfinite[b]) {
+                p.min[c] = std::min(p.min[c], vmin[b][l]);
+                p.max[c] = std::max(p.max[c], vmax[b][l]);
+            }
+        }
+    }
+}
+
+
+
 template<class T>
 static bool
 computePixelStats_(const ImageBuf& src, ImageBufAlgo::PixelStats& stats,
@@ -159,6 +230,7 @@ computePixelStats_(const ImageBuf& src, ImageBufAlgo::PixelStats& stats,
 
     stats.reset(nchannels);
     OIIO::spin_mutex mutex;  // protect the shared stats when merging
+    parallel_options opt(nthreads, Split_Y, 1);
 
     if (src.deep()) {
         parallel_for_chunked(roi.ybegin, roi.yend, 64,
@@ -180,7 +252,21 @@ computePixelStats_(const ImageBuf& src, ImageBufAlgo::PixelStats& stats,
             }
             std::lock_guard<OIIO::spin_mutex> lock(mutex);
             stats.merge(tmp);
-        });
+        }, opt);
+
+    } else if (pvt::simd_rows_types<T>() && pvt::simd_rows_ok(roi, src)) {
+        parallel_for_chunked(roi.ybegin, roi.yend, 64,
+                             [&](int id, int64_t ybegin, int64_t yend) {
+            ROI subroi(roi.xbegin, roi.xend, ybegin, yend, roi.zbegin,
+                       roi.zend, roi.chbegin, roi.chend);
+            ImageBufAlgo::PixelStats tmp(nchannels);
+            // (Only instantiate for types simd_rows supports.)
+            using RowT = typename std::conditional<
+                pvt::simd_rows_type<T>::value, T, float>::type;
+            pixel_stats_rows<RowT>(src, subroi, tmp);
+            std::lock_guard<OIIO::spin_mutex> lock(mutex);
+            stats.merge(tmp);
+        }, opt);
 
     } else {  // Non-deep case
         parallel_for_chunked(roi.ybegin, roi.yend, 64,
@@ -197,7 +283,7 @@ computePixelStats_(const ImageBuf& src, ImageBufAlgo::PixelStats& stats,
             }
             std::lock_guard<OIIO::spin_mutex> lock(mutex);
             stats.merge(tmp);
-        });
+        }, opt);
     }
 
     // Compute final results
@@ -245,10 +331,9 @@ ImageBufAlgo::computePixelStats(PixelStats& stats, const ImageBuf& src, ROI roi,
 
 
 
-template<class BUFT>
 inline void
-compare_value(ImageBuf::ConstIterator<BUFT, float>& a, int chan, float aval,
-              float bval, ImageBufAlgo::CompareResults& result, float& maxval,
+compare_value(int x, int y, int z, int chan, float aval, float bval,
+              ImageBufAlgo::CompareResults& result, float& maxval,
               double& batcherror, double& batch_sqrerror, bool& failed,
               bool& warned, float failthresh, float warnthresh)
 {
@@ -258,9 +343,9 @@ compare_value(ImageBuf::ConstIterator<BUFT, float>& a, int chan, float aval,
         if (isfinite(result.maxerror)) {
             // non-finite errors trump finite ones
             result.maxerror = std::numeric_limits<float>::infinity();
-            result.maxx     = a.x();
-            result.maxy     = a.y();
-            result.maxz     = a.z();
+            result.maxx     = x;
+            result.maxy     = y;
+            result.maxz     = z;
             result.maxc     = chan;
             return;
         }
@@ -274,9 +359,9 @@ compare_value(ImageBuf::ConstIterator<BUFT, float>& a, int chan, float aval,
     // return false).
     if (!(f <= result.maxerror)) {
         result.maxerror = f;
-        result.maxx     = a.x();
-        result.maxy     = a.y();
-        result.maxz     = a.z();
+        result.maxx     = x;
+        result.maxy     = y;
+        result.maxz     = z;
         result.maxc     = chan;
     }
     if (!warned && !(f <= warnthresh)) {
@@ -291,11 +376,69 @@ compare_value(ImageBuf::ConstIterator<BUFT, float>& a, int chan, float aval,
 
 
 
+// Compare one row of contiguous local pixels spanning all channels of A
+// and B (which have the same data type), 8 values at a time. Blocks whose
+// values are all finite and within both thresholds and the max error so
+// far only need their errors summed; the rest go through compare_value.
+template<class T>
+static void
+compare_row(const ImageBuf& A, const ImageBuf& B, int y, int z, ROI roi,
+            ImageBufAlgo::CompareResults& result, simd::vfloat8& vmaxval,
+            float& maxval, double& batcherror, double& batch_sqrerror,
+            float failthresh, float warnthresh)
+{
+    using namespace simd;
+    const int nc = A.nchannels();
+    size_t n     = size_t(roi.width()) * nc;
+    const T* a   = (const T*)A.pixeladdr(roi.xbegin, y, z);
+    const T* b   = (const T*)B.pixeladdr(roi.xbegin, y, z);
+    // A pixel may straddle two blocks, so remember which pixel last
+    // warned or failed rather than keeping per-pixel flags.
+    size_t failpixel = size_t(-1), warnpixel = size_t(-1);
+    auto scalar = [&](size_t i, float aval, float bval) {
+        size_t px   = i / nc;
+        bool failed = (px == failpixel), warned = (px == warnpixel);
+        compare_value(roi.xbegin + int(px), y, z, int(i % nc), aval, bval,
+                      result, maxval, batcherror, batch_sqrerror, failed,
+                      warned, failthresh, warnthresh);
+        if (failed)
+            failpixel = px;
+        if (warned)
+            warnpixel = px;
+    };
+    vfloat8 thresh(std::min(failthresh, warnthresh));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vfloat8 va = pvt::simd_load8(a + i);
+        vfloat8 vb = pvt::simd_load8(b + i);
+        vfloat8 f  = abs(va - vb);
+        // v-v is 0 for finite values, NaN for NaN and Inf.
+        vbool8 finite = ((va - va) + (vb - vb)) == vfloat8::Zero();
+        vfloat8 limit = min(thresh, vfloat8(float(result.maxerror)));
+        if (all(finite & (f <= limit))) {
+            vmaxval = max(vmaxval, max(va, vb));
+            float fl[8];
+            f.store(fl);
+            for (int l = 0; l < 8; ++l) {
+                batcherror += fl[l];
+                batch_sqrerror += double(fl[l]) * fl[l];
+            }
+        } else {
+            for (int l = 0; l < 8; ++l)
+                scalar(i + l, va[l], vb[l]);
+        }
+    }
+    for (; i < n; ++i)
+        scalar(i, convert_type<T, float>(a[i]), convert_type<T, float>(b[i]));
+}
+
+
+
 template<class Atype, class Btype>
 static bool
 compare_(const ImageBuf& A, const ImageBuf& B, float failthresh,
-         float warnthresh, ImageBufAlgo::CompareResults& result, ROI roi,
-         int nthreads)
+         float warnthresh, imagesize_t maxfail, float hardfail,
+         ImageBufAlgo::CompareResults& result, ROI roi, int nthreads)
 {
     imagesize_t npels = roi.npixels();
     imagesize_t nvals = npels * roi.nchannels();
@@ -310,39 +453,107 @@ compare_(const ImageBuf& A, const ImageBuf& B, float failthresh,
     result.nfail = 0, result.nwarn = 0;
     float maxval = 1.0;  // max possible value
 
-    ImageBuf::ConstIterator<Atype> a(A, roi, ImageBuf::WrapBlack);
-    ImageBuf::ConstIterator<Btype> b(B, roi, ImageBuf::WrapBlack);
     bool deep = A.deep();
-    // Break up into batches to reduce cancelation errors as the error
-    // sums become too much larger than the error for individual pixels.
-    const int batchsize = 4096;  // As good a guess as any
-    for (; !a.done();) {
-        double batcherror     = 0;
-        double batch_sqrerror = 0;
-        if (deep) {
-            for (int i = 0; i < batchsize && !a.done(); ++i, ++a, ++b) {
-                bool warned = false, failed = false;  // For this pixel
-                for (int c = roi.chbegin; c < roi.chend; ++c)
-                    for (int s = 0, e = a.deep_samples(); s < e; ++s) {
-                        compare_value(a, c, a.deep_value(c, s),
-                                      b.deep_value(c, s), result, maxval,
-                                      batcherror, batch_sqrerror, failed,
-                                      warned, failthresh, warnthresh);
-                    }
+    bool rows = !deep && pvt::simd_rows_types<Atype, Btype>()
+                && pvt::simd_rows_ok(roi, A, B);
+    bool early_out = (maxfail < std::numeric_limits<imagesize_t>::max()
+                      || hardfail < std::numeric_limits<float>::infinity());
+    std::atomic<imagesize_t> failures(0);  // only tallied for early_out
+    std::atomic<bool> stop(false);
+    OIIO::spin_mutex mutex;  // protect the shared results when merging
+
+    // Each task compares a band of scanlines into its own partial results,
+    // which are merged at the end.
+    parallel_options opt(nthreads, Split_Y, 1);
+    parallel_for_chunked(roi.ybegin, roi.yend, 64,
+                         [&](int id, int64_t ybegin, int64_t yend) {
+        ROI subroi(roi.xbegin, roi.xend, ybegin, yend, roi.zbegin, roi.zend,
+                   roi.chbegin, roi.chend);
+        ImageBufAlgo::CompareResults r;
+        r.maxerror = 0;
+        r.maxx = 0, r.maxy = 0, r.maxz = 0, r.maxc = 0;
+        r.nfail = 0, r.nwarn = 0;
+        float rmaxval = 1.0f;
+        double error = 0, sqrerror = 0;
+        // Break up into batches to reduce cancelation errors as the error
+        // sums become too much larger than the error for individual
+        // pixels. In early-out mode, check for failure after each batch.
+        auto end_batch = [&](double batcherror, double batch_sqrerror,
+                             imagesize_t prevfail) {
+            error += batcherror;
+            sqrerror += batch_sqrerror;
+            if (early_out) {
+                failures += r.nfail - prevfail;
+                if (failures > maxfail || r.maxerror > hardfail)
+                    stop = true;
             }
-        } else {  // non-deep
-            for (int i = 0; i < batchsize && !a.done(); ++i, ++a, ++b) {
-                bool warned = false, failed = false;  // For this pixel
-                for (int c = roi.chbegin; c < roi.chend; ++c)
-                    compare_value(a, c, c < Achannels ? a[c] : 0.0f,
-                                  c < Bchannels ? b[c] : 0.0f, result, maxval,
-                                  batcherror, batch_sqrerror, failed, warned,
-                                  failthresh, warnthresh);
+        };
+        if (rows) {
+            simd::vfloat8 vmaxval(rmaxval);
+            for (int z = subroi.zbegin; z < subroi.zend && !stop; ++z)
+                for (int y = subroi.ybegin; y < subroi.yend && !stop; ++y) {
+                    double batcherror = 0, batch_sqrerror = 0;
+                    imagesize_t prevfail = r.nfail;
+                    compare_row<Atype>(A, B, y, z, subroi, r, vmaxval,
+                                       rmaxval, batcherror, batch_sqrerror,
+                                       failthresh, warnthresh);
+                    end_batch(batcherror, batch_sqrerror, prevfail);
+                }
+            for (int l = 0; l < 8; ++l)
+                rmaxval = std::max(rmaxval, vmaxval[l]);
+        } else {
+            ImageBuf::ConstIterator<Atype> a(A, subroi, ImageBuf::WrapBlack);
+            ImageBuf::ConstIterator<Btype> b(B, subroi, ImageBuf::WrapBlack);
+            const int batchsize = 4096;  // As good a guess as any
+            while (!a.done() && !stop) {
+                double batcherror = 0, batch_sqrerror = 0;
+                imagesize_t prevfail = r.nfail;
+                for (int i = 0; i < batchsize && !a.done(); ++i, ++a, ++b) {
+                    bool warned = false, failed = false;  // For this pixel
+                    for (int c = roi.chbegin; c < roi.chend; ++c) {
+                        if (deep) {
+                            for (int s = 0, e = a.deep_samples(); s < e; ++s)
+                                compare_value(a.x(), a.y(), a.z(), c,
+                                              a.deep_value(c, s),
+                                              b.deep_value(c, s), r, rmaxval,
+                                              batcherror, batch_sqrerror,
+                                              failed, warned, failthresh,
+                                              warnthresh);
+                        } else {
+                            compare_value(a.x(), a.y(), a.z(), c,
+                                          c < Achannels ? a[c] : 0.0f,
+                                          c < Bchannels ? b[c] : 0.0f, r,
+                                          rmaxval, batcherror, batch_sqrerror,
+                                          failed, warned, failthresh,
+                                          warnthresh);
+                        }
+                    }
+                }
+                end_batch(batcherror, batch_sqrerror, prevfail);
             }
         }
-        totalerror += batcherror;
-        totalsqrerror += batch_sqrerror;
-    }
+
+        std::lock_guard<OIIO::spin_mutex> lock(mutex);
+        totalerror += error;
+        totalsqrerror += sqrerror;
+        maxval = std::max(maxval, rmaxval);
+        result.nwarn += r.nwarn;
+        result.nfail += r.nfail;
+        // Of equal max errors, report the first in scanline order, as a
+        // single-threaded comparison would.
+        if (!(r.maxerror <= result.maxerror)
+            || (r.maxerror == result.maxerror && r.maxerror != 0
+                && std::tie(r.maxz, r.maxy, r.maxx, r.maxc)
+                       < std::tie(result.maxz, result.maxy, result.maxx,
+                                  result.maxc))) {
+            result.maxerror = r.maxerror;
+            result.maxx     = r.maxx;
+            result.maxy     = r.maxy;
+            result.maxz     = r.maxz;
+            result.maxc     = r.maxc;
+        }
+    }, opt);
+
     result.meanerror = totalerror / nvals;
     result.rms_error = sqrt(totalsqrerror / nvals);
     result.PSNR      = 20.0 * log10(maxval / result.rms_error);
@@ -354,6 +565,18 @@ compare_(const ImageBuf& A, const ImageBuf& B, float failthresh,
 ImageBufAlgo::CompareResults
 ImageBufAlgo::compare(const ImageBuf& A, const ImageBuf& B, float failthresh,
                       float warnthresh, ROI roi, int nthreads)
+{
+    return compare(A, B, failthresh, warnthresh,
+                   std::numeric_limits<imagesize_t>::max(),
+                   std::numeric_limits<float>::infinity(), roi, nthreads);
+}
+
+
+
+ImageBufAlgo::CompareResults
+ImageBufAlgo::compare(const ImageBuf& A, const ImageBuf& B, float failthresh,
+                      float warnthresh, imagesize_t maxfail, float hardfail,
+                      ROI roi, int nthreads)
 {
     pvt::LoggedTimer logtimer("IBA::compare");
     ImageBufAlgo::CompareResults result;
@@ -374,10 +597,8 @@ ImageBufAlgo::compare(const ImageBuf& A, const ImageBuf& B, float failthresh,
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2_CONST(ok, "compare", compare_, A.spec().format,
                                       B.spec().format, A, B, failthresh,
-                                      warnthresh, result, roi, nthreads);
-    // FIXME - The nthreads argument is for symmetry with the rest of
-    // ImageBufAlgo and for future expansion. But for right now, we
-    // don't actually split by threads.  Maybe later.
+                                      warnthresh, maxfail, hardfail, result,
+                                      roi, nthreads);
     result.error = !ok;
     return result;
 }
@@ -589,27 +810,155 @@ ImageBufAlgo::isMonochrome(const ImageBuf& src, float threshold, ROI roi,
 
 
 
+// Lists of colors to match, looked up by a hash of the grid cell that a
+// pixel's channel values fall in. Along each channel the cells are 4*eps
+// wide, so a color's match region of +/- eps (widened by eps, to be safe
+// from rounding) lands in at most a few cells, and the color is listed in
+// each of them. With eps = 0 the cell is just the value itself, and
+// channels with a huge eps (i.e., ignored) are left out of the cell. A
+// pixel then only needs to be tested against the colors listed for its
+// cell, by the same test as the linear search, so hash collisions merely
+// add candidates.
+class ColorCells {
+public:
+    ColorCells(int ncolors, int nchannels, const float* color,
+               const float* eps, ROI roi)
+        : m_roi(roi)
+        , m_inv(roi.chend)
+    {
+        for (int c = roi.chbegin; c < roi.chend; ++c) {
+            if (!(eps[c] >= 0.0f)) {
+                m_ok = false;  // Negative or NaN eps never matches
+                return;
+            }
+            m_inv[c] = eps[c] > 1.0e30f ? -1.0
+                                        : (eps[c] > 0.0f ? 0.25 / eps[c] : 0.0);
+        }
+        std::vector<double> lo(roi.chend), n(roi.chend), k(roi.chend),
+            q(roi.chend);
+        for (int col = 0; col < ncolors && m_ok; ++col) {
+            const float* x = color + col * nchannels;
+            double ncells  = 1.0;
+            for (int c = roi.chbegin; c < roi.chend; ++c) {
+                if (keyed(c) && !isfinite(x[c])) {
+                    m_ok = false;
+                    return;
+                }
+                lo[c] = cell(c, double(x[c]) - 2.0 * eps[c]);
+                n[c]  = cell(c, double(x[c]) + 2.0 * eps[c]) - lo[c] + 1.0;
+                k[c]  = 0.0;
+                ncells *= n[c];
+            }
+            if (ncells > 256.0) {
+                m_ok = false;
+                return;
+            }
+            // Visit every cell of the color's box, odometer style.
+            int c;
+            do {
+                for (c = roi.chbegin; c < roi.chend; ++c)
+                    q[c] = lo[c] + k[c];
+                std::vector<int>& list(m_cells[hash(q.data())]);
+                if (list.empty() || list.back() != col)
+                    list.push_back(col);
+                for (c = roi.chbegin; c < roi.chend; ++c) {
+                    if (++k[c] < n[c])
+                        break;
+                    k[c] = 0.0;
+                }
+            } while (c < roi.chend);
+        }
+    }
+
+    // Could every color be listed in a few cells?
+    bool ok() const { return m_ok; }
+
+    // Find the colors listed for the cell containing pixel value p, which
+    // may be none. Return false if p has a NaN or Inf in a channel that
+    // the cells are keyed on, which only the linear search can handle.
+    template<typename T>
+    bool find(const T& p, const std::vector<int>*& list) const
+    {
+        double* q = ALLOCA(double, m_roi.chend);
+        for (int c = m_roi.chbegin; c < m_roi.chend; ++c) {
+            float v = p[c];
+            if (keyed(c) && !isfinite(v))
+                return false;
+            q[c] = cell(c, v);
+        }
+        auto found = m_cells.find(hash(q));
+        list       = found == m_cells.end() ? nullptr : &found->second;
+        return true;
+    }
+
+private:
+    bool keyed(int c) const { return m_inv[c] >= 0.0; }
+
+    double cell(int c, double v) const
+    {
+        if (!keyed(c))
+            return 0.0;
+        // (Adding 0 turns -0 into +0.)
+        return (m_inv[c] > 0.0 ? std::floor(v * m_inv[c]) : v) + 0.0;
+    }
+
+    uint64_t hash(const double* q) const
+    {
+        uint64_t h = 0;
+        for (int c = m_roi.chbegin; c < m_roi.chend; ++c) {
+            uint64_t bits;
+            memcpy(&bits, &q[c], sizeof(bits));
+            h = (h ^ bits) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    ROI m_roi;
+    bool m_ok = true;
+    std::vector<double> m_inv;  // 1/cell width, 0 for eps=0, -1 if ignored
+    std::unordered_map<uint64_t, std::vector<int>> m_cells;
+};
+
+
+
+// Lists of more colors than this are looked up through ColorCells.
+static const int color_count_min_cells = 8;
+
+
+
 template<typename T>
 static bool
 color_count_(const ImageBuf& src, atomic_ll* count, int ncolors,
              const float* color, const float* eps, ROI roi, int nthreads)
 {
+    int nchannels = src.nchannels();
+    std::unique_ptr<ColorCells> cells;
+    if (ncolors > color_count_min_cells) {
+        cells.reset(new ColorCells(ncolors, nchannels, color, eps, roi));
+        if (!cells->ok())
+            cells.reset();
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        int nchannels = src.nchannels();
-        long long* n  = ALLOCA(long long, ncolors);
+        long long* n = ALLOCA(long long, ncolors);
         for (int col = 0; col < ncolors; ++col)
             n[col] = 0;
+        auto matches = [&](const ImageBuf::ConstIterator<T>& p, int col) {
+            int coloffset = col * nchannels;
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                if (fabsf(p[c] - color[coloffset + c]) > eps[c])
+                    return 0;
+            return 1;
+        };
         for (ImageBuf::ConstIterator<T> p(src, roi); !p.done(); ++p) {
-            int coloffset = 0;
-            for (int col = 0; col < ncolors; ++col, coloffset += nchannels) {
-                int match = 1;
-                for (int c = roi.chbegin; c < roi.chend; ++c) {
-                    if (fabsf(p[c] - color[coloffset + c]) > eps[c]) {
-                        match = 0;
-                        break;
-                    }
-                }
-                n[col] += match;
+            const std::vector<int>* list = nullptr;
+            if (cells && cells->find(p, list)) {
+                if (list)
+                    for (int col : *list)
+                        n[col] += matches(p, col);
+            } else {
+                for (int col = 0; col < ncolors; ++col)
+                    n[col] += matches(p, col);
             }
         }
         for (int col = 0; col < ncolors; ++col)
@@ -814,7 +1163,7 @@ simplePixelHashSHA1(const ImageBuf& src, string_view extrainfo, ROI roi)
     if (!roi.defined())
         roi = get_roi(src.spec());
 
-    bool localpixels           = src.localpixels();
+    bool localpixels           = src.contiguous();
     imagesize_t scanline_bytes = roi.width() * src.spec().pixel_bytes();
     ASSERT(scanline_bytes < std::numeric_limits<unsigned int>::max());
     // Do it a few scanlines at a time
@@ -874,7 +1223,7 @@ ImageBufAlgo::computePixelHashSHA1(const ImageBuf& src, string_view extrainfo,
     std::vector<std::string> results(nblocks);
     parallel_for_chunked(roi.ybegin, roi.yend, blocksize,
                          [&](int64_t ybegin, int64_t yend) {
-        int64_t b   = (ybegin - src.ybegin()) / blocksize;  // block number
+        int64_t b   = (ybegin - roi.ybegin) / blocksize;  // block number
         ROI broi    = roi;
         broi.ybegin = ybegin;
         broi.yend   = yend;
@@ -899,6 +1248,180 @@ ImageBufAlgo::computePixelHashSHA1(const ImageBuf& src, string_view extrainfo,
 
 
 
+// Hash n bytes with the fast hash named by alg (1 = xxhash64, 2 =
+// farmhash128), storing the 64 bit words of the result in h, and return
+// the number of words.
+static int
+fast_hash(int alg, const void* data, size_t n, uint64_t h[2])
+{
+    if (alg == 1) {
+        h[0] = xxhash::XXH64(data, n, 0);
+        return 1;
+    }
+    farmhash::uint128_t f = farmhash::Fingerprint128((const char*)data, n);
+    h[0]                  = farmhash::Uint128High64(f);
+    h[1]                  = farmhash::Uint128Low64(f);
+    return 2;
+}
+
+
+
+// Append the fast hash of n bytes to digest, as little-endian bytes, so
+// that hashes of digests are the same on every platform.
+static void
+fast_hash_append(int alg, const void* data, size_t n, std::string& digest)
+{
+    uint64_t h[2];
+    for (int i = 0, e = fast_hash(alg, data, n, h); i < e; ++i)
+        for (int byte = 0; byte < 8; ++byte)
+            digest += char((h[i] >> (8 * byte)) & 0xff);
+}
+
+
+
+std::string
+ImageBufAlgo::computePixelHash(const ImageBuf& src, string_view algorithm,
+                               string_view extrainfo, ROI roi, int blocksize,
+                               int nthreads)
+{
+    if (Strutil::iequals(algorithm, "sha1")
+        || Strutil::iequals(algorithm, "sha-1"))
+        return computePixelHashSHA1(src, extrainfo, roi, blocksize, nthreads);
+    int alg = Strutil::iequals(algorithm, "xxhash64")      ? 1
+              : Strutil::iequals(algorithm, "farmhash128") ? 2
+                                                           : 0;
+    if (!alg)
+        return std::string();
+    pvt::LoggedTimer logtimer("IBA::computePixelHash");
+    if (!roi.defined())
+        roi = get_roi(src.spec());
+    roi.chend = std::min(roi.chend, src.nchannels());
+    if (blocksize <= 0)
+        blocksize = 256;
+
+    // Blocks are hashed straight from the image's memory if they are
+    // contiguous there, otherwise from a copy.
+    bool inplace = src.contiguous() && roi.xbegin == src.xbegin()
+                   && roi.xend == src.xend() && roi.chbegin == 0
+                   && roi.chend == src.nchannels();
+    size_t digestsize = alg == 1 ? 8 : 16;
+    int nyblocks      = (roi.height() + blocksize - 1) / blocksize;
+    int64_t nblocks   = int64_t(nyblocks) * roi.depth();
+    std::vector<std::string> results(nblocks);
+    parallel_for(0, nblocks, [&](int64_t b) {
+        ROI broi    = roi;
+        broi.zbegin = roi.zbegin + int(b / nyblocks);
+        broi.zend   = broi.zbegin + 1;
+        broi.ybegin = roi.ybegin + int(b % nyblocks) * blocksize;
+        broi.yend   = std::min(broi.ybegin + blocksize, roi.yend);
+        results[b].reserve(digestsize);
+        if (inplace) {
+            fast_hash_append(alg,
+                             src.pixeladdr(broi.xbegin, broi.ybegin,
+                                           broi.zbegin),
+                             broi.height() * size_t(src.scanline_stride()),
+                             results[b]);
+        } else {
+            TypeDesc format = src.spec().format;
+            std::vector<char> tmp(broi.npixels() * broi.nchannels()
+                                  * format.size());
+            src.get_pixels(broi, format, tmp.data());
+            fast_hash_append(alg, tmp.data(), tmp.size(), results[b]);
+        }
+    }, parallel_options(nthreads, Split_Y, 1));
+
+    // Hash the block digests, in order, and the extra info.
+    std::string all;
+    all.reserve(nblocks * digestsize + extrainfo.size());
+    for (auto& r : results)
+        all += r;
+    all.append(extrainfo.data(), extrainfo.size());
+    uint64_t h[2];
+    std::string hex;
+    for (int i = 0, e = fast_hash(alg, all.data(), all.size(), h); i < e; ++i)
+        hex += Strutil::sprintf("%016llx", (unsigned long long)h[i]);
+    return hex;
+}
+
+
+
+// The histogram bin of value val.
+inline int
+histogram_bin(float val, float min, float max, float ratio, int bins_minus_1)
+{
+    val = clamp(val, min, max);
+    return clamp(int((val - min) * ratio), 0, bins_minus_1);
+}
+
+
+
+// Accumulate the histogram of rows of contiguous local pixels. The bin
+// indices of each row are computed first: by table lookup for 8 and 16 bit
+// data (lut, which has a bin for every possible value), otherwise 8 values
+// at a time. Only then are the bins incremented, skipping empty pixels if
+// asked to.
+template<class T>
+static void
+histogram_rows(const ImageBuf& src, int channel, imagesize_t* h, int bins,
+               float min, float max, bool ignore_empty, const int* lut,
+               ROI roi)
+{
+    using namespace simd;
+    const int nc           = src.nchannels();
+    const int chend        = std::min(roi.chend, nc);
+    const int w            = roi.width();
+    const float ratio      = bins / (max - min);
+    const int bins_minus_1 = bins - 1;
+    const vfloat8 vmin(min), vratio(ratio), vlast((float)bins_minus_1);
+    std::vector<int> idx(w);
+    for (int z = roi.zbegin; z < roi.zend; ++z) {
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            const T* s = (const T*)src.pixeladdr(roi.xbegin, y, z);
+            int x      = 0;
+            if (lut) {
+                for (; x < w; ++x)
+                    idx[x] = lut[int(s[x * nc + channel])];
+            } else {
+                for (; x + 8 <= w; x += 8) {
+                    vfloat8 v;
+                    if (nc == 1) {
+                        v = pvt::simd_load8(s + x);
+                    } else {
+                        float vals[8];
+                        for (int l = 0; l < 8; ++l)
+                            vals[l] = convert_type<T, float>(
+                                s[(x + l) * nc + channel]);
+                        v.load(vals);
+                    }
+                    // max() before min() sends NaN to bin 0, as the
+                    // int conversion in histogram_bin does.
+                    vfloat8 f = simd::min(
+                        simd::max((v - vmin) * vratio, vfloat8::Zero()), vlast);
+                    vint8 i = simd::min(simd::max(vint8(f), vint8::Zero()),
+                                        vint8(bins_minus_1));
+                    i.store(&idx[x]);
+                }
+                for (; x < w; ++x)
+                    idx[x] = histogram_bin(convert_type<T, float>(
+                                               s[x * nc + channel]),
+                                           min, max, ratio, bins_minus_1);
+            }
+            for (x = 0; x < w; ++x, s += nc) {
+                if (ignore_empty) {
+                    bool allblack = true;
+                    for (int c = roi.chbegin; c < chend; ++c)
+                        allblack &= (convert_type<T, float>(s[c]) == 0.0f);
+                    if (allblack)
+                        continue;
+                }
+                h[idx[x]] += 1;
+            }
+        }
+    }
+}
+
+
+
 template<class Atype>
 static bool
 histogram_impl(const ImageBuf& src, int channel, std::vector<imagesize_t>& hist,
@@ -911,33 +1434,57 @@ histogram_impl(const ImageBuf& src, int channel, std::vector<imagesize_t>& hist,
         return false;
     }
 
-    std::mutex mutex;  // thread safety for the histogram result
+    float ratio      = bins / (max - min);
+    int bins_minus_1 = bins - 1;
 
-    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        float ratio      = bins / (max - min);
-        int bins_minus_1 = bins - 1;
+    // Contiguous local pixels of the types simd_rows supports are binned
+    // a row at a time, straight from memory.
+    // (Only instantiate for types simd_rows supports.)
+    using RowT = typename std::conditional<pvt::simd_rows_type<Atype>::value,
+                                           Atype, float>::type;
+    bool rows = pvt::simd_rows_types<Atype>() && src.contiguous()
+                && src.roi().contains(roi);
+    std::vector<int> lut;
+    if (rows && std::is_integral<RowT>::value) {
+        lut.resize(size_t(std::numeric_limits<RowT>::max()) + 1);
+        for (size_t v = 0; v < lut.size(); ++v)
+            lut[v] = histogram_bin(convert_type<RowT, float>(RowT(v)), min,
+                                   max, ratio, bins_minus_1);
+    }
 
-        // Compute histogram to thread-local h.
-        std::vector<imagesize_t> h(bins, 0);
-        for (ImageBuf::ConstIterator<Atype> a(src, roi); !a.done(); a++) {
+    // Each band of scanlines is binned into its own private histogram,
+    // and these are summed at the end, so no task waits on another.
+    parallel_options opt(nthreads, Split_Y, 1);
+    opt.resolve();
+    int nbands = std::max(1, std::min(opt.maxthreads, roi.height()));
+    std::vector<std::vector<imagesize_t>> bandhist(nbands);
+    parallel_for(0, nbands, [&](int64_t b) {
+        ROI band(roi);
+        band.ybegin = roi.ybegin + int(roi.height() * b / nbands);
+        band.yend   = roi.ybegin + int(roi.height() * (b + 1) / nbands);
+        std::vector<imagesize_t>& h(bandhist[b]);
+        h.assign(bins, 0);
+        if (rows) {
+            histogram_rows<RowT>(src, channel, h.data(), bins, min, max,
+                                 ignore_empty, lut.size() ? lut.data() : nullptr,
+                                 band);
+            return;
+        }
+        for (ImageBuf::ConstIterator<Atype> a(src, band); !a.done(); a++) {
             if (ignore_empty) {
                 bool allblack = true;
-                for (int c = roi.chbegin; c < roi.chend; ++c)
+                for (int c = band.chbegin; c < band.chend; ++c)
                     allblack &= (a[c] == 0.0f);
                 if (allblack)
                     continue;
             }
-            float val = a[channel];
-            val       = clamp(val, min, max);
-            int i     = clamp(int((val - min) * ratio), 0, bins_minus_1);
-            h[i] += 1;
+            h[histogram_bin(a[channel], min, max, ratio, bins_minus_1)] += 1;
         }
+    }, opt);
 
-        // Safely update the master histogram
-        lock_guard lock(mutex);
+    for (auto& h : bandhist)
         for (int i = 0; i < bins; ++i)
             hist[i] += h[i];
-    });
     return true;
 }
 
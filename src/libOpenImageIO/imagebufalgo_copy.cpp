@@ -227,6 +227,12 @@ ImageBufAlgo::crop(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
     pvt::LoggedTimer logtime("IBA::crop");
     dst.clear();
     roi.chend = std::min(roi.chend, src.nchannels());
+    if (src.storage() == ImageBuf::LOCALBUFFER && !src.deep()
+        && (!roi.defined() || roi == src.roi())) {
+        // Cropping to the whole data window is just a copy, which can
+        // share src's pixel memory until one of them is modified.
+        return dst.copy(src);
+    }
     if (!IBAprep(roi, &dst, &src, IBAprep_SUPPORT_DEEP))
         return false;
 
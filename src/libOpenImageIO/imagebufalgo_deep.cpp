@@ -31,15 +31,18 @@
 
 #include <OpenEXR/half.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/deepdata.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 #include <OpenImageIO/timer.h>
 
@@ -51,14 +54,22 @@ OIIO_NAMESPACE_BEGIN
 
 // FIXME -- NOT CORRECT!  This code assumes sorted, non-overlapping samples.
 // That is not a valid assumption in general. We will come back to fix this.
+//
+// Each pixel's samples are read straight from the DeepData (by pointer and
+// stride, for float and half channels) and composited into the running sum
+// four channels at a time: the weight of every channel depends only on the
+// alphas accumulated before the sample, so all channels update at once as
+// val = val * mul + weight * sample.
 template<class DSTTYPE>
 static bool
 flatten_(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
 {
+    using namespace simd;
     ImageBufAlgo::parallel_image(roi, nthreads, [=, &dst, &src](ROI roi) {
         const ImageSpec& srcspec(src.spec());
         const DeepData* dd = src.deepdata();
         int nc             = srcspec.nchannels;
+        int nc4            = (nc + 3) & ~3;  // padded to whole vfloat4's
         int AR_channel     = dd->AR_channel();
         int AG_channel     = dd->AG_channel();
         int AB_channel     = dd->AB_channel();
@@ -67,39 +78,76 @@ flatten_(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
         int R_channel      = srcspec.channelindex("R");
         int G_channel      = srcspec.channelindex("G");
         int B_channel      = srcspec.channelindex("B");
-        float* val         = ALLOCA(float, nc);
-        float& ARval(val[AR_channel]);
-        float& AGval(val[AG_channel]);
-        float& ABval(val[AB_channel]);
+        // Accumulated value, this sample's value, weight, and multiplier
+        // for each channel, with the padding set so it stays 0.
+        float* val    = OIIO_ALLOCA(float, 4 * nc4);
+        float* sample = val + nc4;
+        float* weight = sample + nc4;
+        float* mul    = weight + nc4;
+        memset(val, 0, 4 * nc4 * sizeof(float));
+        std::fill(mul, mul + nc4, 1.0f);
+        // Which accumulated alpha weights each channel: AR, AG, AB, or
+        // their average.
+        int* whichalpha = OIIO_ALLOCA(int, nc);
+        bool* isZ       = OIIO_ALLOCA(bool, nc);
+        for (int c = 0; c < nc; ++c) {
+            if (c == R_channel)
+                whichalpha[c] = 0;
+            else if (c == G_channel)
+                whichalpha[c] = 1;
+            else if (c == B_channel)
+                whichalpha[c] = 2;
+            else
+                whichalpha[c] = 3;
+            isZ[c] = (c == Z_channel || c == Zback_channel);
+        }
+        TypeDesc::BASETYPE* chantype = OIIO_ALLOCA(TypeDesc::BASETYPE, nc);
+        size_t* stride               = OIIO_ALLOCA(size_t, nc);
+        for (int c = 0; c < nc; ++c) {
+            chantype[c] = TypeDesc::BASETYPE(dd->channeltype(c).basetype);
+            stride[c]   = dd->samplestride(c);
+        }
+        const char** base = OIIO_ALLOCA(const char*, nc);
+        float zero        = 0.0f;
+        float& ARval(AR_channel >= 0 ? val[AR_channel] : zero);
+        float& AGval(AG_channel >= 0 ? val[AG_channel] : zero);
+        float& ABval(AB_channel >= 0 ? val[AB_channel] : zero);
 
         for (ImageBuf::Iterator<DSTTYPE> r(dst, roi); !r.done(); ++r) {
             int x = r.x(), y = r.y(), z = r.z();
-            int samps = src.deep_samples(x, y, z);
+            int pixel = src.pixelindex(x, y, z, true);
+            int samps = dd->samples(pixel);
             // Clear accumulated values for this pixel (0 for colors, big for Z)
             memset(val, 0, nc * sizeof(float));
             if (Z_channel >= 0 && samps == 0)
                 val[Z_channel] = 1.0e30;
             if (Zback_channel >= 0 && samps == 0)
                 val[Zback_channel] = 1.0e30;
+            for (int c = 0; c < nc && samps; ++c)
+                base[c] = (const char*)dd->data_ptr(pixel, c, 0);
             for (int s = 0; s < samps; ++s) {
                 float AR = ARval, AG = AGval, AB = ABval;  // make copies
                 float alpha = (AR + AG + AB) / 3.0f;
                 if (alpha >= 1.0f)
                     break;
+                const float onemalpha[4] = { 1.0f - AR, 1.0f - AG, 1.0f - AB,
+                                             1.0f - alpha };
                 for (int c = 0; c < nc; ++c) {
-                    float v = src.deep_value(x, y, z, c, s);
-                    if (c == Z_channel || c == Zback_channel)
-                        val[c] *= alpha;  // because Z are not premultiplied
-                    float a;
-                    if (c == R_channel)
-                        a = AR;
-                    else if (c == G_channel)
-                        a = AG;
-                    else if (c == B_channel)
-                        a = AB;
+                    const char* ptr = base[c] + s * stride[c];
+                    if (chantype[c] == TypeDesc::FLOAT)
+                        sample[c] = *(const float*)ptr;
+                    else if (chantype[c] == TypeDesc::HALF)
+                        sample[c] = *(const half*)ptr;
                     else
-                        a = alpha;
-                    val[c] += (1.0f - a) * v;
+                        sample[c] = dd->deep_value(pixel, c, s);
+                    weight[c] = onemalpha[whichalpha[c]];
+                    // Z is not premultiplied, so scale what's behind it
+                    mul[c] = isZ[c] ? alpha : 1.0f;
+                }
+                for (int c = 0; c < nc4; c += 4) {
+                    vfloat4 v = vfloat4(val + c) * vfloat4(mul + c)
+                                + vfloat4(weight + c) * vfloat4(sample + c);
+                    v.store(val + c);
                 }
             }
 
@@ -264,6 +312,72 @@ ImageBufAlgo::deepen(const ImageBuf& src, float zvalue, ROI roi, int nthreads)
 
 
 
+// Number of samples that merging A's pixel Apixel with B's pixel Bpixel
+// may need, counting every split that can happen where their segments
+// overlap each other (or themselves).
+static int
+merge_capacity(const DeepData& Add, int Apixel, const DeepData& Bdd,
+               int Bpixel)
+{
+    int Azchan              = Add.Z_channel();
+    int Azbackchan          = Add.Zback_channel();
+    int Bzchan              = Bdd.Z_channel();
+    int Bzbackchan          = Bdd.Zback_channel();
+    int Asamps              = Add.samples(Apixel);
+    int Bsamps              = Bdd.samples(Bpixel);
+    int nsplits             = 0;
+    int self_overlap_splits = 0;
+    for (int s = 0; s < Asamps; ++s) {
+        float src_z     = Add.deep_value(Apixel, Azchan, s);
+        float src_zback = Add.deep_value(Apixel, Azbackchan, s);
+        for (int d = 0; d < Bsamps; ++d) {
+            float dst_z     = Bdd.deep_value(Bpixel, Bzchan, d);
+            float dst_zback = Bdd.deep_value(Bpixel, Bzbackchan, d);
+            if (src_z > dst_z && src_z < dst_zback)
+                ++nsplits;
+            if (src_zback > dst_z && src_zback < dst_zback)
+                ++nsplits;
+            if (dst_z > src_z && dst_z < src_zback)
+                ++nsplits;
+            if (dst_zback > src_z && dst_zback < src_zback)
+                ++nsplits;
+        }
+        // Check for splits src vs src -- in case they overlap!
+        for (int ss = s; ss < Asamps; ++ss) {
+            float src_z2     = Add.deep_value(Apixel, Azchan, ss);
+            float src_zback2 = Add.deep_value(Apixel, Azbackchan, ss);
+            if (src_z2 > src_z && src_z2 < src_zback)
+                ++self_overlap_splits;
+            if (src_zback2 > src_z && src_zback2 < src_zback)
+                ++self_overlap_splits;
+            if (src_z > src_z2 && src_z < src_zback2)
+                ++self_overlap_splits;
+            if (src_zback > src_z2 && src_zback < src_zback2)
+                ++self_overlap_splits;
+        }
+    }
+    // Check for splits dst vs dst -- in case they overlap!
+    for (int d = 0; d < Bsamps; ++d) {
+        float dst_z     = Bdd.deep_value(Bpixel, Bzchan, d);
+        float dst_zback = Bdd.deep_value(Bpixel, Bzbackchan, d);
+        for (int dd = d; dd < Bsamps; ++dd) {
+            float dst_z2     = Bdd.deep_value(Bpixel, Bzchan, dd);
+            float dst_zback2 = Bdd.deep_value(Bpixel, Bzbackchan, dd);
+            if (dst_z2 > dst_z && dst_z2 < dst_zback)
+                ++self_overlap_splits;
+            if (dst_zback2 > dst_z && dst_zback2 < dst_zback)
+                ++self_overlap_splits;
+            if (dst_z > dst_z2 && dst_z < dst_zback2)
+                ++self_overlap_splits;
+            if (dst_zback > dst_z2 && dst_zback < dst_zback2)
+                ++self_overlap_splits;
+        }
+    }
+    return Asamps + Bsamps + nsplits + self_overlap_splits;
+}
+
+
+
 bool
 ImageBufAlgo::deep_merge(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B,
                          bool occlusion_cull, ROI roi, int nthreads)
@@ -284,92 +398,44 @@ ImageBufAlgo::deep_merge(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B,
 
     // First, set the capacity of the dst image to reserve enough space for
     // the segments of both source images, including any splits that may
-    // occur.
+    // occur. The whole image is resized at once, so the merge below never
+    // has to grow (and lock) the dst storage and may run in parallel.
     DeepData& dstdd(*dst.deepdata());
     const DeepData& Add(*A.deepdata());
     const DeepData& Bdd(*B.deepdata());
-    int Azchan     = Add.Z_channel();
-    int Azbackchan = Add.Zback_channel();
-    int Bzchan     = Bdd.Z_channel();
-    int Bzbackchan = Bdd.Zback_channel();
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-        for (int y = roi.ybegin; y < roi.yend; ++y)
-            for (int x = roi.xbegin; x < roi.xend; ++x) {
-                int dstpixel            = dst.pixelindex(x, y, z, true);
-                int Apixel              = A.pixelindex(x, y, z, true);
-                int Bpixel              = B.pixelindex(x, y, z, true);
-                int Asamps              = Add.samples(Apixel);
-                int Bsamps              = Bdd.samples(Bpixel);
-                int nsplits             = 0;
-                int self_overlap_splits = 0;
-                for (int s = 0; s < Asamps; ++s) {
-                    float src_z     = Add.deep_value(Apixel, Azchan, s);
-                    float src_zback = Add.deep_value(Apixel, Azbackchan, s);
-                    for (int d = 0; d < Bsamps; ++d) {
-                        float dst_z     = Bdd.deep_value(Bpixel, Bzchan, d);
-                        float dst_zback = Bdd.deep_value(Bpixel, Bzbackchan, d);
-                        if (src_z > dst_z && src_z < dst_zback)
-                            ++nsplits;
-                        if (src_zback > dst_z && src_zback < dst_zback)
-                            ++nsplits;
-                        if (dst_z > src_z && dst_z < src_zback)
-                            ++nsplits;
-                        if (dst_zback > src_z && dst_zback < src_zback)
-                            ++nsplits;
-                    }
-                    // Check for splits src vs src -- in case they overlap!
-                    for (int ss = s; ss < Asamps; ++ss) {
-                        float src_z2     = Add.deep_value(Apixel, Azchan, ss);
-                        float src_zback2 = Add.deep_value(Apixel, Azbackchan,
-                                                          ss);
-                        if (src_z2 > src_z && src_z2 < src_zback)
-                            ++self_overlap_splits;
-                        if (src_zback2 > src_z && src_zback2 < src_zback)
-                            ++self_overlap_splits;
-                        if (src_z > src_z2 && src_z < src_zback2)
-                            ++self_overlap_splits;
-                        if (src_zback > src_z2 && src_zback < src_zback2)
-                            ++self_overlap_splits;
-                    }
+    std::vector<unsigned int> capacity(dstdd.pixels());
+    for (int p = 0, n = dstdd.pixels(); p < n; ++p)
+        capacity[p] = dstdd.capacity(p);
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z)
+            for (int y = roi.ybegin; y < roi.yend; ++y)
+                for (int x = roi.xbegin; x < roi.xend; ++x) {
+                    int dstpixel = dst.pixelindex(x, y, z, true);
+                    int Apixel   = A.pixelindex(x, y, z, true);
+                    int Bpixel   = B.pixelindex(x, y, z, true);
+                    capacity[dstpixel] = merge_capacity(Add, Apixel, Bdd,
+                                                        Bpixel);
                 }
-                // Check for splits dst vs dst -- in case they overlap!
-                for (int d = 0; d < Bsamps; ++d) {
-                    float dst_z     = Bdd.deep_value(Bpixel, Bzchan, d);
-                    float dst_zback = Bdd.deep_value(Bpixel, Bzbackchan, d);
-                    for (int dd = d; dd < Bsamps; ++dd) {
-                        float dst_z2     = Bdd.deep_value(Bpixel, Bzchan, dd);
-                        float dst_zback2 = Bdd.deep_value(Bpixel, Bzbackchan,
-                                                          dd);
-                        if (dst_z2 > dst_z && dst_z2 < dst_zback)
-                            ++self_overlap_splits;
-                        if (dst_zback2 > dst_z && dst_zback2 < dst_zback)
-                            ++self_overlap_splits;
-                        if (dst_z > dst_z2 && dst_z < dst_zback2)
-                            ++self_overlap_splits;
-                        if (dst_zback > dst_z2 && dst_zback < dst_zback2)
-                            ++self_overlap_splits;
-                    }
-                }
-
-                dstdd.set_capacity(dstpixel, Asamps + Bsamps + nsplits
-                                                 + self_overlap_splits);
-            }
+    });
+    dstdd.set_all_capacity(capacity);
 
     bool ok = ImageBufAlgo::copy(dst, A, TypeDesc::UNKNOWN, roi, nthreads);
 
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-        for (int y = roi.ybegin; y < roi.yend; ++y)
-            for (int x = roi.xbegin; x < roi.xend; ++x) {
-                int dstpixel = dst.pixelindex(x, y, z, true);
-                int Bpixel   = B.pixelindex(x, y, z, true);
-                DASSERT(dstpixel >= 0);
-                // OIIO_UNUSED_OK int oldcap = dstdd.capacity (dstpixel);
-                dstdd.merge_deep_pixels(dstpixel, Bdd, Bpixel);
-                // DASSERT (oldcap == dstdd.capacity(dstpixel) &&
-                //          "Broken: we did not preallocate enough capacity");
-                if (occlusion_cull)
-                    dstdd.occlusion_cull(dstpixel);
-            }
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z)
+            for (int y = roi.ybegin; y < roi.yend; ++y)
+                for (int x = roi.xbegin; x < roi.xend; ++x) {
+                    int dstpixel = dst.pixelindex(x, y, z, true);
+                    int Bpixel   = B.pixelindex(x, y, z, true);
+                    DASSERT(dstpixel >= 0);
+                    OIIO_UNUSED_OK int oldcap = dstdd.capacity(dstpixel);
+                    dstdd.merge_deep_pixels(dstpixel, Bdd, Bpixel);
+                    DASSERT(oldcap == dstdd.capacity(dstpixel)
+                            && "we did not preallocate enough capacity");
+                    if (occlusion_cull)
+                        dstdd.occlusion_cull(dstpixel);
+                }
+    });
     return ok;
 }
 
@@ -388,6 +454,30 @@ ImageBufAlgo::deep_merge(const ImageBuf& A, const ImageBuf& B,
 
 
 
+// Number of samples deep_holdout may need for src pixel srcpixel: the
+// samples it has, plus one for each sample straddling the opaque depth of
+// the threshold pixel, which will be split in two.
+static int
+holdout_capacity(const DeepData& srcdd, int srcpixel, const DeepData& threshdd,
+                 int threshpixel)
+{
+    int n         = srcdd.samples(srcpixel);
+    int Zchan     = srcdd.Z_channel();
+    int Zbackchan = srcdd.Zback_channel();
+    int capacity  = std::max(n, srcdd.capacity(srcpixel));
+    if (threshpixel < 0 || Zchan < 0)
+        return capacity;
+    float zthresh = threshdd.opaque_z(threshpixel);
+    int nsplits   = 0;
+    for (int s = 0; s < n; ++s)
+        if (srcdd.deep_value(srcpixel, Zchan, s) < zthresh
+            && srcdd.deep_value(srcpixel, Zbackchan, s) > zthresh)
+            ++nsplits;
+    return std::max(capacity, n + nsplits);
+}
+
+
+
 bool
 ImageBufAlgo::deep_holdout(ImageBuf& dst, const ImageBuf& src,
                            const ImageBuf& thresh, ROI roi, int nthreads)
@@ -406,53 +496,70 @@ ImageBufAlgo::deep_holdout(ImageBuf& dst, const ImageBuf& src,
 
     DeepData& dstdd(*dst.deepdata());
     const DeepData& srcdd(*src.deepdata());
-    // First, reserve enough space in dst, to reduce the number of
-    // allocations we'll do later.
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-        for (int y = roi.ybegin; y < roi.yend; ++y)
-            for (int x = roi.xbegin; x < roi.xend; ++x) {
-                int dstpixel = dst.pixelindex(x, y, z, true);
-                int srcpixel = src.pixelindex(x, y, z, true);
-                if (dstpixel >= 0 && srcpixel >= 0)
-                    dstdd.set_capacity(dstpixel, srcdd.capacity(srcpixel));
-            }
+    const DeepData& threshdd(*thresh.deepdata());
+    // First, reserve enough space in dst for each pixel's samples plus the
+    // splits at the threshold. With the capacity all set up front, the
+    // pixels never reallocate below and can be computed in parallel.
+    std::vector<unsigned int> capacity(dstdd.pixels());
+    for (int p = 0, n = dstdd.pixels(); p < n; ++p)
+        capacity[p] = dstdd.capacity(p);
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z)
+            for (int y = roi.ybegin; y < roi.yend; ++y)
+                for (int x = roi.xbegin; x < roi.xend; ++x) {
+                    int dstpixel    = dst.pixelindex(x, y, z, true);
+                    int srcpixel    = src.pixelindex(x, y, z, true);
+                    int threshpixel = thresh.pixelindex(x, y, z, true);
+                    if (dstpixel >= 0 && srcpixel >= 0)
+                        capacity[dstpixel] = holdout_capacity(srcdd, srcpixel,
+                                                              threshdd,
+                                                              threshpixel);
+                }
+    });
+    dstdd.set_all_capacity(capacity);
+
     // Now we compute each pixel: We copy the src pixel to dst, then split
     // any samples that span the opaque threshold, and then delete any
     // samples that lie beyond the threshold.
     int Zchan     = dstdd.Z_channel();
     int Zbackchan = dstdd.Zback_channel();
-    const DeepData& threshdd(*thresh.deepdata());
-    for (ImageBuf::Iterator<float> r(dst, roi); !r.done(); ++r) {
-        int x = r.x(), y = r.y(), z = r.z();
-        int srcpixel = src.pixelindex(x, y, z, true);
-        if (srcpixel < 1)
-            continue;  // Nothing in this pixel
-        int dstpixel = dst.pixelindex(x, y, z, true);
-        dstdd.copy_deep_pixel(dstpixel, srcdd, srcpixel);
-        int threshpixel = thresh.pixelindex(x, y, z, true);
-        if (threshpixel < 0)
-            continue;  // No threshold mask for this pixel
-        float zthresh = threshdd.opaque_z(threshpixel);
-        // Eliminate the samples that are entirely beyond the depth
-        // threshold. Do this before the split; that makes it less
-        // likely that the split will force a re-allocation.
-        for (int s = 0, n = dstdd.samples(dstpixel); s < n; ++s) {
-            if (dstdd.deep_value(dstpixel, Zchan, s) > zthresh) {
-                dstdd.set_samples(dstpixel, s);
-                break;
-            }
-        }
-        // Now split any samples that straddle the z.
-        if (dstdd.split(dstpixel, zthresh)) {
-            // If a split did occur, do anohter discard pass.
-            for (int s = 0, n = dstdd.samples(dstpixel); s < n; ++s) {
-                if (dstdd.deep_value(dstpixel, Zbackchan, s) > zthresh) {
-                    dstdd.set_samples(dstpixel, s);
-                    break;
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z)
+            for (int y = roi.ybegin; y < roi.yend; ++y)
+                for (int x = roi.xbegin; x < roi.xend; ++x) {
+                    int srcpixel = src.pixelindex(x, y, z, true);
+                    if (srcpixel < 1)
+                        continue;  // Nothing in this pixel
+                    int dstpixel = dst.pixelindex(x, y, z, true);
+                    dstdd.copy_deep_pixel(dstpixel, srcdd, srcpixel);
+                    int threshpixel = thresh.pixelindex(x, y, z, true);
+                    if (threshpixel < 0)
+                        continue;  // No threshold mask for this pixel
+                    float zthresh = threshdd.opaque_z(threshpixel);
+                    // Eliminate the samples that are entirely beyond the
+                    // depth threshold. Do this before the split; that makes
+                    // less work for the split.
+                    int n = dstdd.samples(dstpixel);
+                    for (int s = 0; s < n; ++s) {
+                        if (dstdd.deep_value(dstpixel, Zchan, s) > zthresh) {
+                            dstdd.set_samples(dstpixel, s);
+                            break;
+                        }
+                    }
+                    // Now split any samples that straddle the z.
+                    if (!dstdd.split(dstpixel, zthresh))
+                        continue;
+                    // If a split did occur, do another discard pass.
+                    n = dstdd.samples(dstpixel);
+                    for (int s = 0; s < n; ++s) {
+                        if (dstdd.deep_value(dstpixel, Zbackchan, s)
+                            > zthresh) {
+                            dstdd.set_samples(dstpixel, s);
+                            break;
+                        }
+                    }
                 }
-            }
-        }
-    }
+    });
     return true;
 }
 
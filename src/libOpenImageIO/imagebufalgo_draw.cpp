@@ -33,6 +33,9 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
@@ -41,8 +44,10 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
+#include <OpenImageIO/ustring.h>
 
 #include "imageio_pvt.h"
 
@@ -541,95 +546,135 @@ ImageBufAlgo::checker(int width, int height, int depth, cspan<float> color1,
 
 
 
-// Return a repeatable hash-based pseudo-random value uniform on [0,1).
-// It's a hash, so it's completely deterministic, based on x,y,z,c,seed.
-// But it can be used in similar ways to a PRNG.
-OIIO_FORCEINLINE float
-hashrand(int x, int y, int z, int c, int seed)
+// Bob Jenkins' bjfinal (see hash.h), computed in every lane of a SIMD int.
+// The lane arithmetic wraps exactly like uint32_t, so each lane gives the
+// same bits as the scalar bjhash::bjfinal.
+template<typename VINT>
+OIIO_FORCEINLINE VINT
+bjfinal_simd(VINT a, VINT b, VINT c)
 {
-    const uint32_t magic = 0xfffff;
-    uint32_t xu(x), yu(y), zu(z), cu(c), seedu(seed);
-    using bjhash::bjfinal;
-    uint32_t h = bjfinal(bjfinal(xu, yu, zu), cu, seedu) & magic;
-    return h * (1.0f / (magic + 1));
+    using simd::rotl32;
+    c ^= b;
+    c -= rotl32(b, 14);
+    a ^= c;
+    a -= rotl32(c, 11);
+    b ^= a;
+    b -= rotl32(a, 25);
+    c ^= b;
+    c -= rotl32(b, 16);
+    a ^= c;
+    a -= rotl32(c, 4);
+    b ^= a;
+    b -= rotl32(a, 14);
+    c ^= b;
+    c -= rotl32(b, 24);
+    return c;
 }
 
 
-// Return a hash-based normal-distributed pseudorandom value.
-// We use the Marsaglia polar method, and hashrand to
-OIIO_FORCEINLINE float
-hashnormal(int x, int y, int z, int c, int seed)
+
+// Return repeatable hash-based pseudo-random values uniform on [0,1) for
+// the four pixels x..x+3 of row (y,z). It's a counter-based hash, so it's
+// completely deterministic, based on x,y,z,c,seed -- no matter how the
+// image is split up among threads -- but it can be used in similar ways
+// to a PRNG.
+OIIO_FORCEINLINE simd::vfloat4
+hashrand4(int x, int y, int z, int c, int seed)
 {
-    float xr, yr, r2;
-    int s = seed - 1;
-    do {
-        s += 1;
-        xr = 2.0 * hashrand(x, y, z, c, s) - 1.0;
-        yr = 2.0 * hashrand(x, y, z, c, s + 139) - 1.0;
-        r2 = xr * xr + yr * yr;
-    } while (r2 > 1.0 || r2 == 0.0);
-    float M = sqrt(-2.0 * log(r2) / r2);
-    return xr * M;
+    using simd::vint4;
+    const int magic = 0xfffff;
+    vint4 h = bjfinal_simd(bjfinal_simd(vint4::Iota(x), vint4(y), vint4(z)),
+                           vint4(c), vint4(seed))
+              & vint4(magic);
+    return simd::vfloat4(h) * (1.0f / (magic + 1));
 }
 
 
 
-template<typename T>
-static bool
-noise_uniform_(ImageBuf& dst, float min, float max, bool mono, int seed,
-               ROI roi, int nthreads)
+// Return hash-based normal-distributed pseudorandom values for the four
+// pixels x..x+3 of row (y,z), using the Marsaglia polar method. A lane
+// whose point falls outside the unit circle retries with the next seed,
+// just as the one-pixel-at-a-time loop did, so every lane gets the same
+// value it always has; only the final log/sqrt is done per lane, in
+// double as before.
+OIIO_FORCEINLINE simd::vfloat4
+hashnormal4(int x, int y, int z, int c, int seed)
 {
-    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        for (ImageBuf::Iterator<T> p(dst, roi); !p.done(); ++p) {
-            int x = p.x(), y = p.y(), z = p.z();
-            float n = 0.0;
-            for (int c = roi.chbegin; c < roi.chend; ++c) {
-                if (c == roi.chbegin || !mono)
-                    n = lerp(min, max, hashrand(x, y, z, c, seed));
-                p[c] = p[c] + n;
-            }
-        }
-    });
-    return true;
+    using simd::vbool4;
+    using simd::vfloat4;
+    vfloat4 xr = 0.0f, r2 = 0.0f;
+    vbool4 todo(true);
+    for (int s = seed; any(todo); ++s) {
+        vfloat4 xs = hashrand4(x, y, z, c, s) * 2.0f - 1.0f;
+        vfloat4 ys = hashrand4(x, y, z, c, s + 139) * 2.0f - 1.0f;
+        vfloat4 rs = xs * xs + ys * ys;
+        xr         = blend(xr, xs, todo);
+        r2         = blend(r2, rs, todo);
+        todo       = todo & ((rs > 1.0f) | (rs == 0.0f));
+    }
+    vfloat4 r;
+    for (int i = 0; i < 4; ++i)
+        r[i] = xr[i] * float(sqrt(-2.0 * log(r2[i]) / r2[i]));
+    return r;
 }
 
 
 
-template<typename T>
-static bool
-noise_gaussian_(ImageBuf& dst, float mean, float stddev, bool mono, int seed,
-                ROI roi, int nthreads)
+enum class NoiseType { Uniform, Gaussian, Salt };
+
+// Fill n[0..nx) (rounded up to a multiple of 4) with noise values for
+// channel c of the pixels starting at (xbegin,y,z). Uniform noise is
+// lerp(A,B,u); gaussian noise has mean A and standard deviation B; salt
+// returns the raw uniform value for the caller to compare against its
+// threshold.
+static void
+noise_row(NoiseType type, float* n, int xbegin, int nx, int y, int z, int c,
+          int seed, float A, float B)
 {
-    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        for (ImageBuf::Iterator<T> p(dst, roi); !p.done(); ++p) {
-            int x = p.x(), y = p.y(), z = p.z();
-            float n = 0.0;
-            for (int c = roi.chbegin; c < roi.chend; ++c) {
-                if (c == roi.chbegin || !mono)
-                    n = mean + stddev * hashnormal(x, y, z, c, seed);
-                p[c] = p[c] + n;
-            }
+    using simd::vfloat4;
+    for (int i = 0; i < nx; i += 4) {
+        int x     = xbegin + i;
+        vfloat4 r;
+        if (type == NoiseType::Gaussian) {
+            r = A + B * hashnormal4(x, y, z, c, seed);
+        } else {
+            vfloat4 u = hashrand4(x, y, z, c, seed);
+            r = (type == NoiseType::Uniform) ? A * (1.0f - u) + B * u : u;
         }
-    });
-    return true;
+        r.store(n + i);
+    }
 }
 
 
 
-template<typename T>
 static bool
-noise_salt_(ImageBuf& dst, float saltval, float saltportion, bool mono,
-            int seed, ROI roi, int nthreads)
+noise_(ImageBuf& dst, NoiseType type, float A, float B, bool mono, int seed,
+       ROI roi, int nthreads)
 {
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        for (ImageBuf::Iterator<T> p(dst, roi); !p.done(); ++p) {
-            int x = p.x(), y = p.y(), z = p.z();
-            float n = 0.0;
-            for (int c = roi.chbegin; c < roi.chend; ++c) {
-                if (c == roi.chbegin || !mono)
-                    n = hashrand(x, y, z, c, seed);
-                if (n < saltportion)
-                    p[c] = saltval;
+        int nx = roi.width(), nc = roi.nchannels();
+        int nxpad = (nx + 3) & ~3;
+        std::vector<float> buf(nx * nc + nxpad * nc);
+        float *pix = buf.data(), *noise = pix + nx * nc;
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                ROI row(roi.xbegin, roi.xend, y, y + 1, z, z + 1, roi.chbegin,
+                        roi.chend);
+                dst.get_pixels(row, TypeDesc::FLOAT, pix);
+                for (int c = 0; c < (mono ? 1 : nc); ++c)
+                    noise_row(type, noise + c * nxpad, roi.xbegin, nx, y, z,
+                              roi.chbegin + c, seed, A, B);
+                for (int x = 0; x < nx; ++x) {
+                    float* p = pix + x * nc;
+                    for (int c = 0; c < nc; ++c) {
+                        float n = noise[(mono ? 0 : c) * nxpad + x];
+                        if (type != NoiseType::Salt)
+                            p[c] += n;
+                        else if (n < B)
+                            p[c] = A;
+                    }
+                }
+                dst.set_pixels(row, TypeDesc::FLOAT, pix);
             }
         }
     });
@@ -645,24 +690,18 @@ ImageBufAlgo::noise(ImageBuf& dst, string_view noisetype, float A, float B,
     pvt::LoggedTimer logtime("IBA::noise");
     if (!IBAprep(roi, &dst))
         return false;
-    bool ok;
+    NoiseType type;
     if (noisetype == "gaussian" || noisetype == "normal") {
-        OIIO_DISPATCH_COMMON_TYPES(ok, "noise_gaussian", noise_gaussian_,
-                                   dst.spec().format, dst, A, B, mono, seed,
-                                   roi, nthreads);
+        type = NoiseType::Gaussian;
     } else if (noisetype == "uniform") {
-        OIIO_DISPATCH_COMMON_TYPES(ok, "noise_uniform", noise_uniform_,
-                                   dst.spec().format, dst, A, B, mono, seed,
-                                   roi, nthreads);
+        type = NoiseType::Uniform;
     } else if (noisetype == "salt") {
-        OIIO_DISPATCH_COMMON_TYPES(ok, "noise_salt", noise_salt_,
-                                   dst.spec().format, dst, A, B, mono, seed,
-                                   roi, nthreads);
+        type = NoiseType::Salt;
     } else {
-        ok = false;
         dst.error("noise", "unknown noise type \"%s\"", noisetype);
+        return false;
     }
-    return ok;
+    return noise_(dst, type, A, B, mono, seed, roi, nthreads);
 }
 
 
@@ -690,29 +729,150 @@ static std::vector<std::string> font_search_dirs;
 static const char* default_font_name[] = { "DroidSans", "cour", "Courier New",
                                            "FreeMono", nullptr };
 
-// Helper: given unicode and a font face, compute its size
+// A glyph rendered by FreeType: its coverage bitmap (0-1) and where that
+// goes relative to the pen position.
+struct Glyph {
+    int left    = 0;  // bitmap offset right of the pen
+    int top     = 0;  // bitmap offset above the pen
+    int width   = 0;
+    int rows    = 0;
+    int advance = 0;              // pen advance, in pixels
+    std::vector<float> coverage;  // rows x width
+};
+typedef std::shared_ptr<const Glyph> GlyphRef;
+
+// Rendered glyphs are cached by font file, pixel size, and character, so
+// text drawn over and over (slates, timecode burn-ins) is only rasterized
+// once. The cache has its own mutex, so that cached text can be measured
+// and drawn by many threads at once; ft_mutex is only needed to render
+// new glyphs.
+struct GlyphKey {
+    ustring font;
+    int size;
+    uint32_t ch;
+    bool operator==(const GlyphKey& k) const
+    {
+        return font == k.font && size == k.size && ch == k.ch;
+    }
+};
+
+struct GlyphKeyHash {
+    size_t operator()(const GlyphKey& k) const
+    {
+        return k.font.hash() ^ (size_t(k.size) * 0x9e3779b97f4a7c15ULL)
+               ^ (size_t(k.ch) << 20);
+    }
+};
+
+static mutex glyph_mutex;
+static std::unordered_map<GlyphKey, GlyphRef, GlyphKeyHash> glyph_cache;
+static const size_t glyph_cache_max = 65536;  // flush when it gets this big
+static std::unordered_map<ustring, FT_Face, ustringHash> ft_faces;
+
+
+
+// Have FreeType render one character of the face into a new Glyph, or
+// return null if it can't. The caller must hold ft_mutex.
+static GlyphRef
+render_glyph(FT_Face face, uint32_t ch)
+{
+    if (FT_Load_Char(face, ch, FT_LOAD_RENDER))
+        return GlyphRef();
+    FT_GlyphSlot slot = face->glyph;
+    auto g            = std::make_shared<Glyph>();
+    g->left           = slot->bitmap_left;
+    g->top            = slot->bitmap_top;
+    g->width          = int(slot->bitmap.width);
+    g->rows           = int(slot->bitmap.rows);
+    g->advance        = int(slot->advance.x >> 6);
+    g->coverage.resize(size_t(g->width) * g->rows);
+    for (int j = 0; j < g->rows; ++j)
+        for (int i = 0; i < g->width; ++i)
+            g->coverage[j * g->width + i]
+                = slot->bitmap.buffer[slot->bitmap.pitch * j + i] / 255.0f;
+    return g;
+}
+
+
+
+// Retrieve the glyphs for utext in the given font file and pixel size,
+// rendering and caching any not seen before. Characters that can't be
+// rendered get a null entry. If the font can't be used at all, return
+// false with an error message in err.
+static bool
+get_glyphs(ustring font, int fontsize, const std::vector<uint32_t>& utext,
+           std::vector<GlyphRef>& glyphs, std::string& err)
+{
+    glyphs.assign(utext.size(), GlyphRef());
+    bool missing = false;
+    {
+        lock_guard lock(glyph_mutex);
+        for (size_t i = 0; i < utext.size(); ++i) {
+            GlyphKey key { font, fontsize, utext[i] };
+            auto found = glyph_cache.find(key);
+            if (found != glyph_cache.end())
+                glyphs[i] = found->second;
+            else
+                missing = true;
+        }
+    }
+    if (!missing)
+        return true;
+
+    // Render the glyphs we don't have yet
+    lock_guard ft_lock(ft_mutex);
+    FT_Face& face(ft_faces[font]);
+    if (!face
+        && FT_New_Face(ft_library, font.c_str(), 0 /* face index */, &face)) {
+        ft_faces.erase(font);
+        err = Strutil::sprintf("Could not set font face to \"%s\"", font);
+        return false;  // couldn't open the face
+    }
+    if (FT_Set_Pixel_Sizes(face /*handle*/, 0 /*width*/,
+                           fontsize /*height*/)) {
+        err = Strutil::sprintf("Could not set font size to %d", fontsize);
+        return false;  // couldn't set the character size
+    }
+    std::map<uint32_t, GlyphRef> rendered;
+    for (size_t i = 0; i < utext.size(); ++i) {
+        if (glyphs[i])
+            continue;
+        auto found = rendered.find(utext[i]);
+        if (found == rendered.end())
+            found = rendered.emplace(utext[i], render_glyph(face, utext[i]))
+                        .first;
+        glyphs[i] = found->second;
+    }
+    lock_guard lock(glyph_mutex);
+    if (glyph_cache.size() + rendered.size() > glyph_cache_max)
+        glyph_cache.clear();
+    for (auto& r : rendered)
+        if (r.second)
+            glyph_cache[GlyphKey { font, fontsize, r.first }] = r.second;
+    return true;
+}
+
+
+
+// Helper: given the glyphs of some text, compute its size
 static ROI
-text_size_from_unicode(std::vector<uint32_t>& utext, FT_Face face)
+text_size_from_glyphs(const std::vector<GlyphRef>& glyphs)
 {
     ROI size;
     size.xbegin = size.ybegin = std::numeric_limits<int>::max();
     size.xend = size.yend = std::numeric_limits<int>::min();
-    FT_GlyphSlot slot     = face->glyph;
     int x                 = 0;
-    for (auto ch : utext) {
-        int error = FT_Load_Char(face, ch, FT_LOAD_RENDER);
-        if (error)
+    for (auto& g : glyphs) {
+        if (!g)
             continue;  // ignore errors
-        size.ybegin = std::min(size.ybegin, -slot->bitmap_top);
-        size.yend   = std::max(size.yend, int(slot->bitmap.rows)
-                                            - int(slot->bitmap_top) + 1);
-        size.xbegin = std::min(size.xbegin, x + int(slot->bitmap_left));
-        size.xend   = std::max(size.xend, x + int(slot->bitmap.width)
-                                            + int(slot->bitmap_left) + 1);
+        size.ybegin = std::min(size.ybegin, -g->top);
+        size.yend   = std::max(size.yend, g->rows - g->top + 1);
+        size.xbegin = std::min(size.xbegin, x + g->left);
+        size.xend   = std::max(size.xend, x + g->width + g->left + 1);
         // increment pen position
-        x += slot->advance.x >> 6;
+        x += g->advance;
     }
-    return size;  // Font rendering not supported
+    return size;
 }
 
 
@@ -722,7 +882,7 @@ text_size_from_unicode(std::vector<uint32_t>& utext, FT_Face face)
 // If not found, return false and put an error message in result.
 // Not thread-safe! The caller must use the mutex.
 static bool
-resolve_font(int fontsize, string_view font_, std::string& result)
+resolve_font_uncached(int fontsize, string_view font_, std::string& result)
 {
     result.clear();
 
@@ -830,6 +990,27 @@ resolve_font(int fontsize, string_view font_, std::string& result)
     return true;
 }
 
+
+
+// Like resolve_font_uncached, but remembering the names already found, so
+// that repeated text doesn't search the font directories every time.
+// Thread-safe.
+static bool
+resolve_font(int fontsize, string_view font_, std::string& result)
+{
+    static std::unordered_map<std::string, std::string> resolved;
+    lock_guard ft_lock(ft_mutex);
+    auto found = resolved.find(std::string(font_));
+    if (found != resolved.end()) {
+        result = found->second;
+        return true;
+    }
+    if (!resolve_font_uncached(fontsize, font_, result))
+        return false;
+    resolved[std::string(font_)] = result;
+    return true;
+}
+
 }  // namespace
 #endif
 
@@ -841,54 +1022,22 @@ ImageBufAlgo::text_size(string_view text, int fontsize, string_view font_)
     pvt::LoggedTimer logtime("IBA::text_size");
     ROI size;
 #ifdef USE_FREETYPE
-    // Thread safety
-    lock_guard ft_lock(ft_mutex);
-
     std::string font;
     bool ok = resolve_font(fontsize, font_, font);
     if (!ok) {
         return size;
     }
 
-    int error = 0;
-    FT_Face face;  // handle to face object
-    error = FT_New_Face(ft_library, font.c_str(), 0 /* face index */, &face);
-    if (error) {
-        return size;  // couldn't open the face
-    }
-
-    error = FT_Set_Pixel_Sizes(face /*handle*/, 0 /*width*/,
-                               fontsize /*height*/);
-    if (error) {
-        FT_Done_Face(face);
-        return size;  // couldn't set the character size
-    }
-
-    FT_GlyphSlot slot = face->glyph;  // a small shortcut
-
     std::vector<uint32_t> utext;
     utext.reserve(
         text.size());  //Possible overcommit, but most text will be ascii
     Strutil::utf8_to_unicode(text, utext);
 
-    size.xbegin = size.ybegin = std::numeric_limits<int>::max();
-    size.xend = size.yend = std::numeric_limits<int>::min();
-    int x                 = 0;
-    for (auto ch : utext) {
-        error = FT_Load_Char(face, ch, FT_LOAD_RENDER);
-        if (error)
-            continue;  // ignore errors
-        size.ybegin = std::min(size.ybegin, -slot->bitmap_top);
-        size.yend   = std::max(size.yend, int(slot->bitmap.rows)
-                                            - int(slot->bitmap_top) + 1);
-        size.xbegin = std::min(size.xbegin, x + int(slot->bitmap_left));
-        size.xend   = std::max(size.xend, x + int(slot->bitmap.width)
-                                            + int(slot->bitmap_left) + 1);
-        // increment pen position
-        x += slot->advance.x >> 6;
-    }
-
-    FT_Done_Face(face);
+    std::vector<GlyphRef> glyphs;
+    std::string err;
+    if (!get_glyphs(ustring(font), fontsize, utext, glyphs, err))
+        return size;
+    size = text_size_from_glyphs(glyphs);
 #endif
 
     return size;  // Font rendering not supported
@@ -909,9 +1058,6 @@ ImageBufAlgo::render_text(ImageBuf& R, int x, int y, string_view text,
     }
 
 #ifdef USE_FREETYPE
-    // Thread safety
-    lock_guard ft_lock(ft_mutex);
-
     std::string font;
     bool ok = resolve_font(fontsize, font_, font);
     if (!ok) {
@@ -920,23 +1066,6 @@ ImageBufAlgo::render_text(ImageBuf& R, int x, int y, string_view text,
         return false;
     }
 
-    int error = 0;
-    FT_Face face;  // handle to face object
-    error = FT_New_Face(ft_library, font.c_str(), 0 /* face index */, &face);
-    if (error) {
-        R.error("Could not set font face to \"%s\"", font);
-        return false;  // couldn't open the face
-    }
-
-    error = FT_Set_Pixel_Sizes(face /*handle*/, 0 /*width*/,
-                               fontsize /*height*/);
-    if (error) {
-        FT_Done_Face(face);
-        R.error("Could not set font size to %d", fontsize);
-        return false;  // couldn't set the character size
-    }
-
-    FT_GlyphSlot slot = face->glyph;  // a small shortcut
     int nchannels(R.nchannels());
     IBA_FIX_PERCHAN_LEN_DEF(textcolor, nchannels);
 
@@ -946,8 +1075,15 @@ ImageBufAlgo::render_text(ImageBuf& R, int x, int y, string_view text,
         text.size());  //Possible overcommit, but most text will be ascii
     Strutil::utf8_to_unicode(text, utext);
 
-    // Compute the size that the text will render as, into an ROI
-    ROI textroi     = text_size_from_unicode(utext, face);
+    // Get the rendered glyphs, and the size that the text will render as,
+    // into an ROI
+    std::vector<GlyphRef> glyphs;
+    std::string err;
+    if (!get_glyphs(ustring(font), fontsize, utext, glyphs, err)) {
+        R.error("%s", err);
+        return false;
+    }
+    ROI textroi     = text_size_from_glyphs(glyphs);
     textroi.zbegin  = 0;
     textroi.zend    = 1;
     textroi.chbegin = 0;
@@ -975,23 +1111,23 @@ ImageBufAlgo::render_text(ImageBuf& R, int x, int y, string_view text,
     ImageBuf textimg(ImageSpec(textroi, TypeDesc::FLOAT));
     ImageBufAlgo::zero(textimg);
 
-    // Glyph by glyph, fill in our txtimg buffer
-    for (auto ch : utext) {
-        int error = FT_Load_Char(face, ch, FT_LOAD_RENDER);
-        if (error)
+    // Glyph by glyph, fill in our txtimg buffer, a row at a time
+    for (auto& g : glyphs) {
+        if (!g)
             continue;  // ignore errors
         // now, draw to our target surface
-        for (int j = 0; j < static_cast<int>(slot->bitmap.rows); ++j) {
-            int ry = y + j - slot->bitmap_top;
-            for (int i = 0; i < static_cast<int>(slot->bitmap.width); ++i) {
-                int rx  = x + i + slot->bitmap_left;
-                float b = slot->bitmap.buffer[slot->bitmap.pitch * j + i]
-                          / 255.0f;
-                textimg.setpixel(rx, ry, &b, 1);
-            }
+        int x0 = std::max(x + g->left, textroi.xbegin);
+        int x1 = std::min(x + g->left + g->width, textroi.xend);
+        for (int j = 0; j < g->rows && x0 < x1; ++j) {
+            int ry = y + j - g->top;
+            if (ry < textroi.ybegin || ry >= textroi.yend)
+                continue;
+            memcpy(textimg.pixeladdr(x0, ry),
+                   &g->coverage[j * g->width + x0 - (x + g->left)],
+                   (x1 - x0) * sizeof(float));
         }
         // increment pen position
-        x += slot->advance.x >> 6;
+        x += g->advance;
     }
 
     // Generate the alpha image -- if drop shadow is requested, dilate,
@@ -1007,22 +1143,41 @@ ImageBufAlgo::render_text(ImageBuf& R, int x, int y, string_view text,
     if (!IBAprep(roi, &R))
         return false;
     roi = roi_intersection(textroi, R.roi());
-
-    // Now fill in the pixels of our destination image
-    float* pixelcolor = ALLOCA(float, nchannels);
-    ImageBuf::ConstIterator<float> t(textimg, roi, ImageBuf::WrapBlack);
-    ImageBuf::ConstIterator<float> a(alphaimg, roi, ImageBuf::WrapBlack);
-    ImageBuf::Iterator<float> r(R, roi);
-    for (; !r.done(); ++r, ++t, ++a) {
-        float val   = t[0];
-        float alpha = a[0];
-        R.getpixel(r.x(), r.y(), pixelcolor);
-        for (int c = 0; c < nchannels; ++c)
-            pixelcolor[c] = val * textcolor[c] + (1.0f - alpha) * pixelcolor[c];
-        R.setpixel(r.x(), r.y(), pixelcolor);
-    }
-
-    FT_Done_Face(face);
+    if (roi.width() <= 0 || roi.height() <= 0)
+        return true;  // Text is entirely outside the image
+
+    // Now fill in the pixels of our destination image, a row at a time:
+    // R = text * textcolor + (1 - alpha) * R, with the text and alpha
+    // spread out to one value per channel so that the blend can be done
+    // four channel values at a time.
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        int n = roi.width() * nchannels;
+        std::vector<float> buf(3 * n);
+        float *pix = buf.data(), *textval = pix + n, *transp = textval + n;
+        ROI row(roi.xbegin, roi.xend, 0, 1, roi.zbegin, roi.zend, 0, nchannels);
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            row.ybegin = y;
+            row.yend   = y + 1;
+            R.get_pixels(row, TypeDesc::FLOAT, pix);
+            const float* t = (const float*)textimg.pixeladdr(roi.xbegin, y);
+            const float* a = (const float*)alphaimg.pixeladdr(roi.xbegin, y);
+            for (int i = 0, k = 0; i < roi.width(); ++i)
+                for (int c = 0; c < nchannels; ++c, ++k) {
+                    textval[k] = t[i] * textcolor[c];
+                    transp[k]  = 1.0f - a[i];
+                }
+            int k = 0;
+            for (; k + 4 <= n; k += 4) {
+                simd::vfloat4 p = simd::vfloat4(textval + k)
+                                  + simd::vfloat4(transp + k)
+                                        * simd::vfloat4(pix + k);
+                p.store(pix + k);
+            }
+            for (; k < n; ++k)
+                pix[k] = textval[k] + transp[k] * pix[k];
+            R.set_pixels(row, TypeDesc::FLOAT, pix);
+        }
+    });
     return true;
 
 #else
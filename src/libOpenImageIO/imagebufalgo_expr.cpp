@@ -0,0 +1,402 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// Implementation of ImageBufAlgo::Expr, which records a chain of
+/// pointwise operations and applies them all in a single pass.
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <OpenImageIO/color.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
+
+#include "imageio_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+
+namespace {
+
+enum class ExprOpcode { Add, Mul, Mad, Pow, Clamp, Premult, Unpremult,
+                        ColorConvert };
+
+struct ExprOp {
+    ExprOpcode opcode;
+    std::vector<float> a, b;  // per-channel arguments, full length
+    bool flag = false;        // clampalpha01, or colorconvert's unpremult
+    ColorProcessorHandle processor;
+};
+
+}  // namespace
+
+
+
+struct ImageBufAlgo::Expr::Impl {
+    const ImageBuf* src;
+    std::vector<ExprOp> ops;
+
+    Impl(const ImageBuf& src)
+        : src(&src)
+    {
+    }
+
+    // Expand a per-channel argument to one value per channel of the
+    // source, following the same rules as IBA_FIX_PERCHAN_LEN.
+    std::vector<float> perchan(cspan<float> v, float missing,
+                               float zdef) const
+    {
+        int nc = std::max(src->nchannels(), int(v.size()));
+        std::vector<float> vals(nc);
+        for (int i = 0; i < nc; ++i)
+            vals[i] = i < v.size() ? v[i] : (i ? missing : zdef);
+        return vals;
+    }
+    std::vector<float> perchan(cspan<float> v) const
+    {
+        float last = v.size() ? v.back() : 0.0f;
+        return perchan(v, last, last);
+    }
+
+    void append(ExprOpcode opcode, std::vector<float> a = {},
+                std::vector<float> b = {}, bool flag = false,
+                ColorProcessorHandle processor = {})
+    {
+        ExprOp op;
+        op.opcode    = opcode;
+        op.a         = std::move(a);
+        op.b         = std::move(b);
+        op.flag      = flag;
+        op.processor = std::move(processor);
+        ops.push_back(std::move(op));
+    }
+};
+
+
+
+ImageBufAlgo::Expr::Expr(const ImageBuf& src)
+    : m_impl(new Impl(src))
+{
+}
+
+
+ImageBufAlgo::Expr::~Expr() {}
+
+ImageBufAlgo::Expr::Expr(Expr&& other) = default;
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::operator=(Expr&& other) = default;
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::add(cspan<float> B)
+{
+    m_impl->append(ExprOpcode::Add, m_impl->perchan(B));
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::sub(cspan<float> B)
+{
+    std::vector<float> b = m_impl->perchan(B);
+    for (auto& v : b)
+        v = -v;
+    m_impl->append(ExprOpcode::Add, std::move(b));
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::mul(cspan<float> B)
+{
+    m_impl->append(ExprOpcode::Mul, m_impl->perchan(B));
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::mad(cspan<float> B, cspan<float> C)
+{
+    m_impl->append(ExprOpcode::Mad, m_impl->perchan(B), m_impl->perchan(C));
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::pow(cspan<float> B)
+{
+    m_impl->append(ExprOpcode::Pow, m_impl->perchan(B));
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::clamp(cspan<float> min, cspan<float> max,
+                          bool clampalpha01)
+{
+    const float big = std::numeric_limits<float>::max();
+    m_impl->append(ExprOpcode::Clamp,
+                   m_impl->perchan(min, min.size() ? min.back() : -big, -big),
+                   m_impl->perchan(max, max.size() ? max.back() : big, big),
+                   clampalpha01);
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::premult()
+{
+    m_impl->append(ExprOpcode::Premult);
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::unpremult()
+{
+    m_impl->append(ExprOpcode::Unpremult);
+    return *this;
+}
+
+
+
+ImageBufAlgo::Expr&
+ImageBufAlgo::Expr::colorconvert(ColorProcessorHandle processor,
+                                 bool unpremult)
+{
+    m_impl->append(ExprOpcode::ColorConvert, {}, {}, unpremult,
+                   std::move(processor));
+    return *this;
+}
+
+
+
+size_t
+ImageBufAlgo::Expr::size() const
+{
+    return m_impl->ops.size();
+}
+
+
+
+// Apply one recorded op to a run of npixels float pixels, each with nch
+// channels starting at channel chbegin. The ROI channel range is
+// [chbegin, chend). The colorconvert case needs a 4-channel scratch
+// buffer of npixels entries.
+static void
+expr_apply_op(const ExprOp& op, float* pixels, int npixels, int nch,
+              int chbegin, int alpha_channel, int z_channel,
+              simd::vfloat4* scratch, simd::vfloat4* alphas)
+{
+    using namespace simd;
+    int chend = chbegin + nch;
+    switch (op.opcode) {
+    case ExprOpcode::Add:
+        for (int i = 0; i < npixels; ++i, pixels += nch)
+            for (int c = 0; c < nch; ++c)
+                pixels[c] += op.a[chbegin + c];
+        break;
+    case ExprOpcode::Mul:
+        for (int i = 0; i < npixels; ++i, pixels += nch)
+            for (int c = 0; c < nch; ++c)
+                pixels[c] *= op.a[chbegin + c];
+        break;
+    case ExprOpcode::Mad:
+        for (int i = 0; i < npixels; ++i, pixels += nch)
+            for (int c = 0; c < nch; ++c)
+                pixels[c] = pixels[c] * op.a[chbegin + c] + op.b[chbegin + c];
+        break;
+    case ExprOpcode::Pow:
+        for (int i = 0; i < npixels; ++i, pixels += nch)
+            for (int c = 0; c < nch; ++c)
+                pixels[c] = std::pow(pixels[c], op.a[chbegin + c]);
+        break;
+    case ExprOpcode::Clamp: {
+        int a = (op.flag && alpha_channel >= chbegin && alpha_channel < chend)
+                    ? alpha_channel - chbegin
+                    : -1;
+        for (int i = 0; i < npixels; ++i, pixels += nch) {
+            for (int c = 0; c < nch; ++c)
+                pixels[c] = OIIO::clamp<float>(pixels[c], op.a[chbegin + c],
+                                               op.b[chbegin + c]);
+            if (a >= 0)
+                pixels[a] = OIIO::clamp<float>(pixels[a], 0.0f, 1.0f);
+        }
+        break;
+    }
+    case ExprOpcode::Premult:
+    case ExprOpcode::Unpremult: {
+        // Alpha must be among the channels being processed.
+        if (alpha_channel < chbegin || alpha_channel >= chend)
+            break;
+        bool pre = (op.opcode == ExprOpcode::Premult);
+        for (int i = 0; i < npixels; ++i, pixels += nch) {
+            float alpha = pixels[alpha_channel - chbegin];
+            if (alpha == 1.0f || (!pre && alpha == 0.0f))
+                continue;
+            for (int c = chbegin; c < chend; ++c)
+                if (c != alpha_channel && c != z_channel)
+                    pixels[c - chbegin] = pre ? pixels[c - chbegin] * alpha
+                                              : pixels[c - chbegin] / alpha;
+        }
+        break;
+    }
+    case ExprOpcode::ColorConvert: {
+        // Like IBA::colorconvert, transform only the first (up to) four
+        // channels, and unpremult around the transform only for RGBA.
+        int nc             = std::min(4, nch);
+        bool unpremult     = op.flag && nc == 4;
+        const float fltmin = std::numeric_limits<float>::min();
+        for (int i = 0; i < npixels; ++i) {
+            vfloat4 v(0.0f);
+            for (int c = 0; c < nc; ++c)
+                v[c] = pixels[i * nch + c];
+            if (unpremult) {
+                vfloat4 a = shuffle<3>(v);
+                a         = select(a >= fltmin, a, vfloat4::One());
+                alphas[i] = a;
+                v *= rcp_fast(a);
+            }
+            scratch[i] = v;
+        }
+        op.processor->apply((float*)scratch, npixels, 1, 4, sizeof(float),
+                            4 * sizeof(float), npixels * 4 * sizeof(float));
+        for (int i = 0; i < npixels; ++i) {
+            vfloat4 v = unpremult ? scratch[i] * alphas[i] : scratch[i];
+            for (int c = 0; c < nc; ++c)
+                pixels[i * nch + c] = v[c];
+        }
+        break;
+    }
+    }
+}
+
+
+
+bool
+ImageBufAlgo::Expr::eval(ImageBuf& dst, ROI roi, int nthreads) const
+{
+    using namespace simd;
+    pvt::LoggedTimer logtime("IBA::Expr::eval");
+    const ImageBuf& src(*m_impl->src);
+    if (!IBAprep(roi, &dst, &src, IBAprep_CLAMP_MUTUAL_NCHANNELS))
+        return false;
+
+    // Resolve, before any pixels are touched, which colorconvert steps
+    // really unpremult: as with IBA::colorconvert, an image already
+    // marked as having unassociated alpha is not unpremulted again.
+    // Track that marking through the chain so dst ends up labeled as
+    // the equivalent sequence of IBA calls would leave it.
+    int alpha_channel = src.spec().alpha_channel;
+    bool unassociated = src.spec().get_int_attribute("oiio:UnassociatedAlpha")
+                        != 0;
+    std::vector<ExprOp> ops;
+    ops.reserve(m_impl->ops.size());
+    for (auto& op : m_impl->ops) {
+        if (op.opcode == ExprOpcode::ColorConvert) {
+            if (!op.processor) {
+                dst.error("Passed NULL ColorProcessor to Expr::colorconvert() "
+                          "[probable application bug]");
+                return false;
+            }
+            if (op.processor->isNoOp())
+                continue;
+            ops.push_back(op);
+            if (alpha_channel >= 0 && unassociated)
+                ops.back().flag = false;
+            continue;
+        }
+        if (op.opcode == ExprOpcode::Premult && alpha_channel >= 0)
+            unassociated = false;
+        if (op.opcode == ExprOpcode::Unpremult && alpha_channel >= 0)
+            unassociated = true;
+        ops.push_back(op);
+    }
+
+    int z_channel = src.spec().z_channel;
+    parallel_image(roi, nthreads, [&](ROI roi) {
+        // Process the region a scanline at a time: fetch it into a float
+        // buffer, apply every op in turn while it's hot in cache, then
+        // write the result to dst.
+        int width = roi.width();
+        int nch   = roi.nchannels();
+        std::vector<float> buf(size_t(width) * nch);
+        std::vector<vfloat4> scratch(width), alphas(width);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                ROI row(roi.xbegin, roi.xend, y, y + 1, z, z + 1, roi.chbegin,
+                        roi.chend);
+                src.get_pixels(row, TypeFloat, buf.data());
+                for (auto& op : ops)
+                    expr_apply_op(op, buf.data(), width, nch, roi.chbegin,
+                                  alpha_channel, z_channel, scratch.data(),
+                                  alphas.data());
+                dst.set_pixels(row, TypeFloat, buf.data());
+            }
+        }
+    });
+
+    if (alpha_channel >= 0) {
+        if (unassociated)
+            dst.specmod().attribute("oiio:UnassociatedAlpha", 1);
+        else
+            dst.specmod().erase_attribute("oiio:UnassociatedAlpha");
+    }
+    return true;
+}
+
+
+
+ImageBuf
+ImageBufAlgo::Expr::eval(ROI roi, int nthreads) const
+{
+    ImageBuf result;
+    bool ok = eval(result, roi, nthreads);
+    if (!ok && !result.has_error())
+        result.error("ImageBufAlgo::Expr::eval() error");
+    return result;
+}
+
+
+OIIO_NAMESPACE_END
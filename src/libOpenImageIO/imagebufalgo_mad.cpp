@@ -43,6 +43,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 
+#include "imagebufalgo_simdrows.h"
 #include "imageio_pvt.h"
 
 
@@ -55,57 +56,24 @@ static bool
 mad_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, const ImageBuf& C,
          ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, ABCtype>()
+        && pvt::simd_rows_ok(roi, R, A, B, C)) {
+        // Special case when all the buffers are the same type, local and
+        // contiguous, and we're operating on the full channel range: skip
+        // the iterators and run over whole rows of raw memory with SIMD.
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMad(), A, B, C);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if ((is_same<Rtype, float>::value || is_same<Rtype, half>::value)
-            && (is_same<ABCtype, float>::value || is_same<ABCtype, half>::value)
-            // && R.localpixels() // has to be, because it's writeable
-            && A.localpixels() && B.localpixels()
-            && C.localpixels()
-            // && R.contains_roi(roi)  // has to be, because IBAPrep
-            && A.contains_roi(roi) && B.contains_roi(roi) && C.contains_roi(roi)
-            && roi.chbegin == 0 && roi.chend == R.nchannels()
-            && roi.chend == A.nchannels() && roi.chend == B.nchannels()
-            && roi.chend == C.nchannels()) {
-            // Special case when all inputs are either float or half, with in-
-            // memory contiguous data and we're operating on the full channel
-            // range: skip iterators: For these circumstances, we can operate on
-            // the raw memory very efficiently. Otherwise, we will need the
-            // magic of the the Iterators (and pay the price).
-            int nxvalues = roi.width() * R.nchannels();
-            for (int z = roi.zbegin; z < roi.zend; ++z)
-                for (int y = roi.ybegin; y < roi.yend; ++y) {
-                    Rtype* rraw = (Rtype*)R.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* araw
-                        = (const ABCtype*)A.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* braw
-                        = (const ABCtype*)B.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* craw
-                        = (const ABCtype*)C.pixeladdr(roi.xbegin, y, z);
-                    DASSERT(araw && braw && craw);
-                    // The straightforward loop auto-vectorizes very well,
-                    // there's no benefit to using explicit SIMD here.
-                    for (int x = 0; x < nxvalues; ++x)
-                        rraw[x] = araw[x] * braw[x] + craw[x];
-                    // But if you did want to explicitly vectorize, this is
-                    // how it would look:
-                    // int simdend = nxvalues & (~3); // how many float4's?
-                    // for (int x = 0; x < simdend; x += 4) {
-                    //     simd::float4 a_simd(araw+x), b_simd(braw+x), c_simd(craw+x);
-                    //     simd::float4 r_simd = a_simd * b_simd + c_simd;
-                    //     r_simd.store (rraw+x);
-                    // }
-                    // for (int x = simdend; x < nxvalues; ++x)
-                    //     rraw[x] = araw[x] * braw[x] + craw[x];
-                }
-        } else {
-            ImageBuf::Iterator<Rtype> r(R, roi);
-            ImageBuf::ConstIterator<ABCtype> a(A, roi);
-            ImageBuf::ConstIterator<ABCtype> b(B, roi);
-            ImageBuf::ConstIterator<ABCtype> c(C, roi);
-            for (; !r.done(); ++r, ++a, ++b, ++c) {
-                for (int ch = roi.chbegin; ch < roi.chend; ++ch)
-                    r[ch] = a[ch] * b[ch] + c[ch];
-            }
+        ImageBuf::Iterator<Rtype> r(R, roi);
+        ImageBuf::ConstIterator<ABCtype> a(A, roi);
+        ImageBuf::ConstIterator<ABCtype> b(B, roi);
+        ImageBuf::ConstIterator<ABCtype> c(C, roi);
+        for (; !r.done(); ++r, ++a, ++b, ++c) {
+            for (int ch = roi.chbegin; ch < roi.chend; ++ch)
+                r[ch] = a[ch] * b[ch] + c[ch];
         }
     });
     return true;
@@ -118,6 +86,14 @@ static bool
 mad_impl_ici(ImageBuf& R, const ImageBuf& A, cspan<float> b, const ImageBuf& C,
              ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, ABCtype>()
+        && pvt::simd_rows_ok(roi, R, A, C)) {
+        pvt::SimdRowsConst bk(b, R.nchannels());
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMad(), A, bk, C);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<ABCtype> a(A, roi);
@@ -137,6 +113,13 @@ static bool
 mad_impl_icc(ImageBuf& R, const ImageBuf& A, cspan<float> b, cspan<float> c,
              ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype>() && pvt::simd_rows_ok(roi, R, A)) {
+        pvt::SimdRowsConst bk(b, R.nchannels()), ck(c, R.nchannels());
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMad(), A, bk, ck);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -154,6 +137,14 @@ static bool
 mad_impl_iic(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, cspan<float> c,
              ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype>()
+        && pvt::simd_rows_ok(roi, R, A, B)) {
+        pvt::SimdRowsConst ck(c, R.nchannels());
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMad(), A, B, ck);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -45,6 +45,7 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/simd.h>
 
+#include "imagebufalgo_simdrows.h"
 #include "imageio_pvt.h"
 
 
@@ -56,6 +57,13 @@ static bool
 mul_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype, Btype>()
+        && pvt::simd_rows_ok(roi, R, A, B)) {
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMul(), A, B);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -73,6 +81,13 @@ template<class Rtype, class Atype>
 static bool
 mul_impl(ImageBuf& R, const ImageBuf& A, cspan<float> b, ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype>() && pvt::simd_rows_ok(roi, R, A)) {
+        pvt::SimdRowsConst bk(b, R.nchannels());
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdMul(), A, bk);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::ConstIterator<Atype> a(A, roi);
         for (ImageBuf::Iterator<Rtype> r(R, roi); !r.done(); ++r, ++a)
@@ -168,6 +183,13 @@ static bool
 div_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::simd_rows_types<Rtype, Atype, Btype>()
+        && pvt::simd_rows_ok(roi, R, A, B)) {
+        ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+            pvt::simd_rows<Rtype>(R, roi, pvt::SimdDiv(), A, B);
+        });
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
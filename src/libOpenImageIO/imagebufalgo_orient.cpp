@@ -35,7 +35,9 @@
 
 #include <OpenEXR/half.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include <OpenImageIO/deepdata.h>
@@ -50,20 +52,124 @@
 OIIO_NAMESPACE_BEGIN
 
 
+// The flips, flops, rotations by multiples of 90 degrees, and transpose
+// all take dst pixel (x,y) from src pixel (sx(x,y), sy(x,y)).
+struct OrientMap {
+    int x0, xx, xy;  // sx = x0 + xx * x + xy * y
+    int y0, yx, yy;  // sy = y0 + yx * x + yy * y
+    int sx(int x, int y) const { return x0 + xx * x + xy * y; }
+    int sy(int x, int y) const { return y0 + yx * x + yy * y; }
+};
+
+
+
+// Copy n pixels of N bytes each (or of nbytes, if N is 0), stepping by the
+// given strides. A constant N lets memcpy compile to a few moves.
+template<size_t N>
+static void
+copy_strided(char* d, stride_t dstep, const char* s, stride_t sstep, int n,
+             size_t nbytes)
+{
+    for (int i = 0; i < n; ++i, d += dstep, s += sstep)
+        memcpy(d, s, N ? N : nbytes);
+}
+
+
+
+// Can orient_blocked_ handle this case? Both images must be in memory,
+// with the same data type, and every pixel of dst_roi must come from
+// within src's pixels (outside them, the iterators supply black).
+static bool
+orient_blocked_ok(const ImageBuf& dst, const ImageBuf& src, ROI dst_roi,
+                  const OrientMap& m)
+{
+    if (!dst.localpixels() || !src.localpixels() || src.deep()
+        || dst.spec().format != src.spec().format
+        || !src.spec().channelformats.empty()
+        || !dst.spec().channelformats.empty() || !dst.roi().contains(dst_roi)
+        || dst_roi.chend > src.nchannels() || dst_roi.npixels() == 0
+        || dst_roi.zbegin < src.zbegin() || dst_roi.zend > src.zend())
+        return false;
+    // The map is a rotation or reflection, so it's enough to check that
+    // the corners of dst_roi come from within src.
+    ROI sroi = src.roi();
+    for (int x : { dst_roi.xbegin, dst_roi.xend - 1 })
+        for (int y : { dst_roi.ybegin, dst_roi.yend - 1 })
+            if (!sroi.contains(m.sx(x, y), m.sy(x, y), sroi.zbegin))
+                return false;
+    return true;
+}
+
+
+
+// Reorient in square blocks of pixels. Each destination row of a block is
+// written contiguously, and the source pixels it reads (possibly down a
+// column) are reused by the block's other rows while still in cache.
+static bool
+orient_blocked_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi,
+                const OrientMap& m, int nthreads)
+{
+    const int blocksize = 32;
+    size_t elsize       = src.spec().format.size();
+    size_t choffset     = elsize * dst_roi.chbegin;
+    size_t nbytes       = elsize * dst_roi.nchannels();
+    stride_t sstep = m.xx * src.pixel_stride() + m.yx * src.scanline_stride();
+    auto copy = copy_strided<0>;
+    switch (nbytes) {
+    case 1: copy = copy_strided<1>; break;
+    case 2: copy = copy_strided<2>; break;
+    case 3: copy = copy_strided<3>; break;
+    case 4: copy = copy_strided<4>; break;
+    case 6: copy = copy_strided<6>; break;
+    case 8: copy = copy_strided<8>; break;
+    case 12: copy = copy_strided<12>; break;
+    case 16: copy = copy_strided<16>; break;
+    }
+    // Only ask for a writeable address once, rather than for every row.
+    char* dbase = (char*)dst.pixeladdr(dst.xbegin(), dst.ybegin(),
+                                       dst.zbegin());
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int yb = roi.ybegin; yb < roi.yend; yb += blocksize) {
+                int ye = std::min(yb + blocksize, roi.yend);
+                for (int xb = roi.xbegin; xb < roi.xend; xb += blocksize) {
+                    int xe = std::min(xb + blocksize, roi.xend);
+                    for (int y = yb; y < ye; ++y) {
+                        char* d = dbase + (z - dst.zbegin()) * dst.z_stride()
+                                  + (y - dst.ybegin()) * dst.scanline_stride()
+                                  + (xb - dst.xbegin()) * dst.pixel_stride()
+                                  + choffset;
+                        const char* s = (const char*)src.pixeladdr(
+                                            m.sx(xb, y), m.sy(xb, y), z)
+                                        + choffset;
+                        copy(d, dst.pixel_stride(), s, sstep, xe - xb,
+                             nbytes);
+                    }
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
+
 template<class D, class S = D>
 static bool
 flip_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi, int nthreads)
 {
     ROI src_roi_full = src.roi_full();
     ROI dst_roi_full = dst.roi_full();
-    ImageBuf::ConstIterator<S, D> s(src);
-    ImageBuf::Iterator<D, D> d(dst, dst_roi);
-    for (; !d.done(); ++d) {
-        int yy = d.y() - dst_roi_full.ybegin;
-        s.pos(d.x(), src_roi_full.yend - 1 - yy, d.z());
-        for (int c = dst_roi.chbegin; c < dst_roi.chend; ++c)
-            d[c] = s[c];
-    }
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        ImageBuf::ConstIterator<S, D> s(src);
+        ImageBuf::Iterator<D, D> d(dst, roi);
+        for (; !d.done(); ++d) {
+            int yy = d.y() - dst_roi_full.ybegin;
+            s.pos(d.x(), src_roi_full.yend - 1 - yy, d.z());
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = s[c];
+        }
+    });
     return true;
 }
 
@@ -91,6 +197,10 @@ ImageBufAlgo::flip(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
     // the midline of the display window.
     if (!IBAprep(dst_roi, &dst, &src))
         return false;
+    OrientMap m { 0, 1, 0, src_roi_full.yend - 1 + dst.roi_full().ybegin, 0,
+                  -1 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "flip", flip_, dst.spec().format,
                                 src.spec().format, dst, src, dst_roi, nthreads);
@@ -105,14 +215,16 @@ flop_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi, int nthreads)
 {
     ROI src_roi_full = src.roi_full();
     ROI dst_roi_full = dst.roi_full();
-    ImageBuf::ConstIterator<S, D> s(src);
-    ImageBuf::Iterator<D, D> d(dst, dst_roi);
-    for (; !d.done(); ++d) {
-        int xx = d.x() - dst_roi_full.xbegin;
-        s.pos(src_roi_full.xend - 1 - xx, d.y(), d.z());
-        for (int c = dst_roi.chbegin; c < dst_roi.chend; ++c)
-            d[c] = s[c];
-    }
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        ImageBuf::ConstIterator<S, D> s(src);
+        ImageBuf::Iterator<D, D> d(dst, roi);
+        for (; !d.done(); ++d) {
+            int xx = d.x() - dst_roi_full.xbegin;
+            s.pos(src_roi_full.xend - 1 - xx, d.y(), d.z());
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = s[c];
+        }
+    });
     return true;
 }
 
@@ -140,6 +252,10 @@ ImageBufAlgo::flop(ImageBuf& dst, const ImageBuf& src, ROI roi, int nthreads)
     // the midline of the display window.
     if (!IBAprep(dst_roi, &dst, &src))
         return false;
+    OrientMap m { src_roi_full.xend - 1 + dst.roi_full().xbegin, -1, 0, 0, 0,
+                  1 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "flop", flop_, dst.spec().format,
                                 src.spec().format, dst, src, dst_roi, nthreads);
@@ -177,13 +293,15 @@ static bool
 rotate90_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi, int nthreads)
 {
     ROI dst_roi_full = dst.roi_full();
-    ImageBuf::ConstIterator<S, D> s(src);
-    ImageBuf::Iterator<D, D> d(dst, dst_roi);
-    for (; !d.done(); ++d) {
-        s.pos(d.y(), dst_roi_full.xend - d.x() - 1, d.z());
-        for (int c = dst_roi.chbegin; c < dst_roi.chend; ++c)
-            d[c] = s[c];
-    }
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        ImageBuf::ConstIterator<S, D> s(src);
+        ImageBuf::Iterator<D, D> d(dst, roi);
+        for (; !d.done(); ++d) {
+            s.pos(d.y(), dst_roi_full.xend - d.x() - 1, d.z());
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = s[c];
+        }
+    });
     return true;
 }
 
@@ -224,6 +342,9 @@ ImageBufAlgo::rotate90(ImageBuf& dst, const ImageBuf& src, ROI roi,
     if (!dst_initialized)
         dst.set_roi_full(dst_roi_full);
 
+    OrientMap m { 0, 0, 1, dst.roi_full().xend - 1, -1, 0 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "rotate90", rotate90_, dst.spec().format,
                                 src.spec().format, dst, src, dst_roi, nthreads);
@@ -238,15 +359,18 @@ rotate180_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi, int nthreads)
 {
     ROI src_roi_full = src.roi_full();
     ROI dst_roi_full = dst.roi_full();
-    ImageBuf::ConstIterator<S, D> s(src);
-    ImageBuf::Iterator<D, D> d(dst, dst_roi);
-    for (; !d.done(); ++d) {
-        int xx = d.x() - dst_roi_full.xbegin;
-        int yy = d.y() - dst_roi_full.ybegin;
-        s.pos(src_roi_full.xend - 1 - xx, src_roi_full.yend - 1 - yy, d.z());
-        for (int c = dst_roi.chbegin; c < dst_roi.chend; ++c)
-            d[c] = s[c];
-    }
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        ImageBuf::ConstIterator<S, D> s(src);
+        ImageBuf::Iterator<D, D> d(dst, roi);
+        for (; !d.done(); ++d) {
+            int xx = d.x() - dst_roi_full.xbegin;
+            int yy = d.y() - dst_roi_full.ybegin;
+            s.pos(src_roi_full.xend - 1 - xx, src_roi_full.yend - 1 - yy,
+                  d.z());
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = s[c];
+        }
+    });
     return true;
 }
 
@@ -278,6 +402,11 @@ ImageBufAlgo::rotate180(ImageBuf& dst, const ImageBuf& src, ROI roi,
     // the midline of the display window.
     if (!IBAprep(dst_roi, &dst, &src))
         return false;
+    ROI dst_roi_full = dst.roi_full();
+    OrientMap m { src_roi_full.xend - 1 + dst_roi_full.xbegin, -1, 0,
+                  src_roi_full.yend - 1 + dst_roi_full.ybegin, 0, -1 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "rotate180", rotate180_, dst.spec().format,
                                 src.spec().format, dst, src, dst_roi, nthreads);
@@ -291,13 +420,15 @@ static bool
 rotate270_(ImageBuf& dst, const ImageBuf& src, ROI dst_roi, int nthreads)
 {
     ROI dst_roi_full = dst.roi_full();
-    ImageBuf::ConstIterator<S, D> s(src);
-    ImageBuf::Iterator<D, D> d(dst, dst_roi);
-    for (; !d.done(); ++d) {
-        s.pos(dst_roi_full.yend - d.y() - 1, d.x(), d.z());
-        for (int c = dst_roi.chbegin; c < dst_roi.chend; ++c)
-            d[c] = s[c];
-    }
+    ImageBufAlgo::parallel_image(dst_roi, nthreads, [&](ROI roi) {
+        ImageBuf::ConstIterator<S, D> s(src);
+        ImageBuf::Iterator<D, D> d(dst, roi);
+        for (; !d.done(); ++d) {
+            s.pos(dst_roi_full.yend - d.y() - 1, d.x(), d.z());
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = s[c];
+        }
+    });
     return true;
 }
 
@@ -338,6 +469,9 @@ ImageBufAlgo::rotate270(ImageBuf& dst, const ImageBuf& src, ROI roi,
     if (!dst_initialized)
         dst.set_roi_full(dst_roi_full);
 
+    OrientMap m { dst.roi_full().yend - 1, 0, -1, 0, 1, 0 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "rotate270", rotate270_, dst.spec().format,
                                 src.spec().format, dst, src, dst_roi, nthreads);
@@ -466,6 +600,9 @@ ImageBufAlgo::transpose(ImageBuf& dst, const ImageBuf& src, ROI roi,
                          r.chbegin, r.chend);
         dst.set_roi_full(dst_roi_full);
     }
+    OrientMap m { 0, 0, 1, 0, 1, 0 };
+    if (orient_blocked_ok(dst, src, dst_roi, m))
+        return orient_blocked_(dst, src, dst_roi, m, nthreads);
     bool ok;
     if (dst.spec().format == src.spec().format) {
         OIIO_DISPATCH_TYPES(ok, "transpose", transpose_, dst.spec().format, dst,
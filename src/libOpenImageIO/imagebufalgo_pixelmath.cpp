@@ -34,7 +34,9 @@
 
 #include <OpenEXR/half.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <limits>
 
@@ -46,6 +48,7 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/simd.h>
 
+#include "imagebufalgo_simdrows.h"
 #include "imageio_pvt.h"
 
 
@@ -57,6 +60,30 @@ static bool
 clamp_(ImageBuf& dst, const ImageBuf& src, const float* min, const float* max,
        bool clampalpha01, ROI roi, int nthreads)
 {
+    if (pvt::simd_rows_types<D, S>() && pvt::simd_rows_ok(roi, dst, src)) {
+        int nc = dst.nchannels();
+        pvt::SimdRowsConst lo(cspan<float>(min, nc), nc);
+        pvt::SimdRowsConst hi(cspan<float>(max, nc), nc);
+        int a = src.spec().alpha_channel;
+        if (clampalpha01 && a >= 0 && a < nc) {
+            // Fold the alpha clamp into a second clamp of every channel
+            // that only restricts alpha.
+            const float inf = std::numeric_limits<float>::infinity();
+            std::vector<float> lo2(nc, -inf), hi2(nc, inf);
+            lo2[a] = 0.0f;
+            hi2[a] = 1.0f;
+            pvt::SimdRowsConst alo(lo2, nc), ahi(hi2, nc);
+            ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+                pvt::simd_rows<D>(dst, roi, pvt::SimdClamp2(), src, lo, hi,
+                                  alo, ahi);
+            });
+        } else {
+            ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+                pvt::simd_rows<D>(dst, roi, pvt::SimdClamp(), src, lo, hi);
+            });
+        }
+        return true;
+    }
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::ConstIterator<S> s(src, roi);
         for (ImageBuf::Iterator<D> d(dst, roi); !d.done(); ++d, ++s) {
@@ -1271,7 +1298,9 @@ over_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, bool zcomp,
                          ncolor_channels);
     bool has_z = (z_channel >= 0);
 
-    ImageBufAlgo::parallel_image(roi, nthreads, [=, &R, &A, &B](ROI roi) {
+    // Cost varies with the foreground's coverage, and with cache misses.
+    auto opt = ImageBufAlgo::adaptive_options(nthreads, &A);
+    ImageBufAlgo::parallel_image(roi, opt, [=, &R, &A, &B](ROI roi) {
         ImageBuf::ConstIterator<Atype> a(A, roi);
         ImageBuf::ConstIterator<Btype> b(B, roi);
         ImageBuf::Iterator<Rtype> r(R, roi);
@@ -1351,6 +1380,122 @@ over_impl_rgbafloat(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
 
 
 
+// Can over_impl_rows handle this case?
+static bool
+over_rows_ok(const ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi)
+{
+    TypeDesc t = A.spec().format;
+    return (t == TypeFloat || t == TypeHalf) && B.spec().format == t
+           && R.spec().format == t && pvt::simd_rows_ok(roi, R, A, B);
+}
+
+
+
+// a[i] + one_minus_alpha[i] * b[i]
+struct SimdOver {
+    template<typename V>
+    V operator()(const V& a, const V& oma, const V& b) const
+    {
+        return a + oma * b;
+    }
+};
+
+
+
+// Special case -- any number of float or half channels, all images in
+// contiguous in-memory buffers of the same type, not a channel subset.
+// Each scanline is broken into runs of pixels whose front layer is fully
+// opaque (just copied), fully clear (summed), or partially transparent
+// (composited 8 values at a time, regardless of the channel layout).
+template<class T>
+static bool
+over_impl_rows(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, bool zcomp,
+               bool z_zeroisinf, ROI roi, int nthreads)
+{
+    int nchannels = 0, alpha_channel = 0, z_channel = 0, ncolor_channels = 0;
+    decode_over_channels(R, nchannels, alpha_channel, z_channel,
+                         ncolor_channels);
+    bool has_z = (z_channel >= 0);
+    enum { Clear, Opaque, Partial };
+
+    auto opt = ImageBufAlgo::adaptive_options(nthreads, &A);
+    ImageBufAlgo::parallel_image(roi, opt, [=, &R, &A, &B](ROI roi) {
+        const int nc = nchannels;
+        int w        = roi.width();
+        std::vector<float> oma;
+        char* rbase = (char*)R.pixeladdr(roi.xbegin, roi.ybegin, roi.zbegin);
+
+        // Classify pixel x of rows a and b, also deciding which of them is
+        // in front if we're doing a Z composite.
+        auto classify = [=](const T* a, const T* b, int x, bool& a_front) {
+            a = a + x * nc;
+            b = b + x * nc;
+            a_front = true;
+            if (zcomp && has_z) {
+                float az = a[z_channel], bz = b[z_channel];
+                if (z_zeroisinf) {
+                    if (az == 0.0f)
+                        az = std::numeric_limits<float>::max();
+                    if (bz == 0.0f)
+                        bz = std::numeric_limits<float>::max();
+                }
+                a_front = (az <= bz);
+            }
+            float alpha = float(a_front ? a[alpha_channel] : b[alpha_channel]);
+            alpha       = clamp(alpha, 0.0f, 1.0f);
+            return alpha == 0.0f ? Clear : (alpha == 1.0f ? Opaque : Partial);
+        };
+
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                T* r = (T*)(rbase + (z - roi.zbegin) * R.z_stride()
+                            + (y - roi.ybegin) * R.scanline_stride());
+                const T* a = (const T*)A.pixeladdr(roi.xbegin, y, z);
+                const T* b = (const T*)B.pixeladdr(roi.xbegin, y, z);
+                for (int x = 0; x < w;) {
+                    bool a_front, next_front;
+                    int kind = classify(a, b, x, a_front);
+                    int xend = x + 1;
+                    while (xend < w && classify(a, b, xend, next_front) == kind
+                           && next_front == a_front)
+                        ++xend;
+                    const T* f = (a_front ? a : b) + x * nc;  // front
+                    const T* k = (a_front ? b : a) + x * nc;  // back
+                    T* rr      = r + x * nc;
+                    size_t n   = size_t(xend - x) * nc;
+                    if (kind == Opaque) {
+                        memcpy(rr, f, n * sizeof(T));
+                    } else if (kind == Clear) {
+                        pvt::simd_row(rr, n, nc, pvt::SimdAdd(),
+                                      pvt::SimdRowImage<T> { f },
+                                      pvt::SimdRowImage<T> { k });
+                    } else {
+                        oma.resize(n);
+                        for (size_t p = 0; p < n; p += nc) {
+                            float alpha = float(f[p + alpha_channel]);
+                            float o     = 1.0f - clamp(alpha, 0.0f, 1.0f);
+                            std::fill_n(oma.begin() + p, nc, o);
+                        }
+                        pvt::simd_row(rr, n, nc, SimdOver(),
+                                      pvt::SimdRowImage<T> { f },
+                                      pvt::SimdRowImage<float> { oma.data() },
+                                      pvt::SimdRowImage<T> { k });
+                    }
+                    if (has_z && kind != Opaque)
+                        for (size_t p = 0; p < n; p += nc)
+                            rr[p + z_channel] = (kind == Clear)
+                                                    ? k[p + z_channel]
+                                                    : f[p + z_channel];
+                    x = xend;
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::over(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B, ROI roi,
                    int nthreads)
@@ -1360,7 +1505,8 @@ ImageBufAlgo::over(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B, ROI roi,
                  IBAprep_REQUIRE_ALPHA | IBAprep_REQUIRE_SAME_NCHANNELS))
         return false;
 
-    if (A.localpixels() && B.localpixels() && A.spec().format == TypeFloat
+    if (A.contiguous() && B.contiguous() && dst.contiguous()
+        && A.spec().format == TypeFloat
         && A.nchannels() == 4 && B.spec().format == TypeFloat
         && B.nchannels() == 4 && A.spec().alpha_channel == 3
         && A.spec().z_channel < 0 && B.spec().alpha_channel == 3
@@ -1372,6 +1518,12 @@ ImageBufAlgo::over(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B, ROI roi,
         // handle without iterators and taking advantage of SIMD.
         return over_impl_rgbafloat(dst, A, B, roi, nthreads);
     }
+    if (over_rows_ok(dst, A, B, roi)) {
+        if (A.spec().format == TypeFloat)
+            return over_impl_rows<float>(dst, A, B, false, false, roi,
+                                         nthreads);
+        return over_impl_rows<half>(dst, A, B, false, false, roi, nthreads);
+    }
 
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3(ok, "over", over_impl, dst.spec().format,
@@ -1403,6 +1555,13 @@ ImageBufAlgo::zover(ImageBuf& dst, const ImageBuf& A, const ImageBuf& B,
                  IBAprep_REQUIRE_ALPHA | IBAprep_REQUIRE_Z
                      | IBAprep_REQUIRE_SAME_NCHANNELS))
         return false;
+    if (over_rows_ok(dst, A, B, roi)) {
+        if (A.spec().format == TypeFloat)
+            return over_impl_rows<float>(dst, A, B, true, z_zeroisinf, roi,
+                                         nthreads);
+        return over_impl_rows<half>(dst, A, B, true, z_zeroisinf, roi,
+                                    nthreads);
+    }
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3(ok, "zover", over_impl, dst.spec().format,
                                 A.spec().format, B.spec().format, dst, A, B,
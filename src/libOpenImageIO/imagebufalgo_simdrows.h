@@ -0,0 +1,308 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// Internal helpers that let pointwise ImageBufAlgo functions (add, sub,
+/// mul, div, mad, clamp, ...) skip the ImageBuf iterators and work
+/// directly on whole rows of contiguous local pixels, 8 values at a time.
+///
+/// The values are converted to float exactly as the iterators would do it
+/// (convert_type), so the results match the iterator path: integer types
+/// are scaled to [0,1] and rounded and clamped on the way back out, and
+/// half uses the F16C conversion instructions when simd.h enables them.
+
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include <OpenEXR/half.h>
+
+#include <OpenImageIO/dassert.h>
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/simd.h>
+#include <OpenImageIO/span.h>
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+
+// Is T a pixel data type that simd_rows can handle?
+template<typename T> struct simd_rows_type : std::false_type {};
+template<> struct simd_rows_type<float> : std::true_type {};
+template<> struct simd_rows_type<half> : std::true_type {};
+template<> struct simd_rows_type<unsigned char> : std::true_type {};
+template<> struct simd_rows_type<unsigned short> : std::true_type {};
+
+
+// Are all the types the same, and one that simd_rows can handle?
+template<typename T>
+inline bool
+simd_rows_types()
+{
+    return simd_rows_type<T>::value;
+}
+
+template<typename T, typename U, typename... MORE>
+inline bool
+simd_rows_types()
+{
+    return std::is_same<T, U>::value && simd_rows_types<T, MORE...>();
+}
+
+
+// Can img be processed by raw rows over roi? It must have contiguous local
+// pixels covering roi, which must span all of its channels.
+inline bool
+simd_rows_ok(ROI /*roi*/)
+{
+    return true;
+}
+
+template<typename... MORE>
+inline bool
+simd_rows_ok(ROI roi, const ImageBuf& img, const MORE&... more)
+{
+    return img.contiguous() && roi.chbegin == 0
+           && roi.chend == img.nchannels() && img.roi().contains(roi)
+           && simd_rows_ok(roi, more...);
+}
+
+
+
+inline simd::vfloat8
+simd_load8(const float* p)
+{
+    return simd::vfloat8(p);
+}
+
+inline simd::vfloat8
+simd_load8(const half* p)
+{
+    return simd::vfloat8(p);
+}
+
+inline simd::vfloat8
+simd_load8(const unsigned char* p)
+{
+    return simd::vfloat8(p) * simd::vfloat8(1.0f / 255.0f);
+}
+
+inline simd::vfloat8
+simd_load8(const unsigned short* p)
+{
+    return simd::vfloat8(p) * simd::vfloat8(1.0f / 65535.0f);
+}
+
+inline void
+simd_store8(float* p, const simd::vfloat8& v)
+{
+    v.store(p);
+}
+
+inline void
+simd_store8(half* p, const simd::vfloat8& v)
+{
+    v.store(p);
+}
+
+// Same rounding as scaled_conversion: add 0.5, clamp, then truncate.
+inline void
+simd_store8(unsigned char* p, const simd::vfloat8& v)
+{
+    simd::vfloat8 s = v * simd::vfloat8(255.0f) + simd::vfloat8(0.5f);
+    simd::vint8 i(clamp(s, simd::vfloat8::Zero(), simd::vfloat8(255.0f)));
+    i.store(p);
+}
+
+inline void
+simd_store8(unsigned short* p, const simd::vfloat8& v)
+{
+    simd::vfloat8 s = v * simd::vfloat8(65535.0f) + simd::vfloat8(0.5f);
+    simd::vint8 i(clamp(s, simd::vfloat8::Zero(), simd::vfloat8(65535.0f)));
+    i.store(p);
+}
+
+
+
+// Per-channel constant operand. Laid out as the channel values repeated
+// across nchannels 8-wide blocks, after which the interleaved channel
+// pattern (which starts at a pixel boundary on each row) repeats.
+struct SimdRowsConst {
+    SimdRowsConst(cspan<float> v, int nchannels)
+        : vals(v.begin(), v.begin() + nchannels)
+        , pattern(8 * nchannels)
+    {
+        DASSERT(v.size() >= nchannels);
+        for (int i = 0; i < 8 * nchannels; ++i)
+            pattern[i] = v[i % nchannels];
+    }
+    std::vector<float> vals, pattern;
+};
+
+
+// The operands of one row: an image row, or a constant's cursor.
+template<typename T> struct SimdRowImage {
+    const T* p;
+    simd::vfloat8 load8(size_t i) { return simd_load8(p + i); }
+    float load1(size_t i, int /*c*/) { return convert_type<T, float>(p[i]); }
+};
+
+struct SimdRowConst {
+    const SimdRowsConst* k;
+    int block, nblocks;
+    simd::vfloat8 load8(size_t /*i*/)
+    {
+        simd::vfloat8 v(&k->pattern[8 * block]);
+        if (++block == nblocks)
+            block = 0;
+        return v;
+    }
+    float load1(size_t /*i*/, int c) { return k->vals[c]; }
+};
+
+template<typename T>
+inline SimdRowImage<T>
+simd_row_operand(const ImageBuf& img, int x, int y, int z)
+{
+    return SimdRowImage<T> { (const T*)img.pixeladdr(x, y, z) };
+}
+
+template<typename T>
+inline SimdRowConst
+simd_row_operand(const SimdRowsConst& k, int /*x*/, int /*y*/, int /*z*/)
+{
+    return SimdRowConst { &k, 0, int(k.vals.size()) };
+}
+
+
+
+template<typename T, typename OP, typename... ARGS>
+inline void
+simd_row(T* r, size_t n, int nchannels, const OP& op, ARGS... args)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        simd_store8(r + i, op(args.load8(i)...));
+    for (; i < n; ++i)
+        r[i] = convert_type<float, T>(op(args.load1(i, int(i % nchannels))...));
+}
+
+
+/// Compute R = op(srcs...) over roi, where each of srcs is an ImageBuf
+/// (each of whose pixel data type is T) or an SimdRowsConst, and op takes
+/// and returns either float or vfloat8. The caller must first check
+/// simd_rows_types and simd_rows_ok, and call this from within a
+/// parallel_image.
+template<typename T, typename OP, typename... SRCS>
+inline void
+simd_rows(ImageBuf& R, ROI roi, const OP& op, const SRCS&... srcs)
+{
+    int nchannels = R.nchannels();
+    size_t n      = size_t(roi.width()) * nchannels;
+    // Only ask for a writeable address once, rather than for every row.
+    char* rbase = (char*)R.pixeladdr(roi.xbegin, roi.ybegin, roi.zbegin);
+    for (int z = roi.zbegin; z < roi.zend; ++z)
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            T* r = (T*)(rbase + (z - roi.zbegin) * R.z_stride()
+                        + (y - roi.ybegin) * R.scanline_stride());
+            simd_row(r, n, nchannels, op,
+                     simd_row_operand<T>(srcs, roi.xbegin, y, z)...);
+        }
+}
+
+
+
+// The pointwise operations
+struct SimdAdd {
+    template<typename V> V operator()(const V& a, const V& b) const
+    {
+        return a + b;
+    }
+};
+
+struct SimdSub {
+    template<typename V> V operator()(const V& a, const V& b) const
+    {
+        return a - b;
+    }
+};
+
+struct SimdMul {
+    template<typename V> V operator()(const V& a, const V& b) const
+    {
+        return a * b;
+    }
+};
+
+// Division by zero yields zero.
+struct SimdDiv {
+    float operator()(float a, float b) const
+    {
+        return (b == 0.0f) ? 0.0f : (a / b);
+    }
+    simd::vfloat8 operator()(const simd::vfloat8& a,
+                             const simd::vfloat8& b) const
+    {
+        simd::vfloat8 zero = simd::vfloat8::Zero();
+        return select(b == zero, zero, a / b);
+    }
+};
+
+struct SimdMad {
+    template<typename V> V operator()(const V& a, const V& b, const V& c) const
+    {
+        return a * b + c;
+    }
+};
+
+struct SimdClamp {
+    template<typename V>
+    V operator()(const V& a, const V& lo, const V& hi) const
+    {
+        return OIIO::clamp(a, lo, hi);
+    }
+};
+
+// Clamp, then clamp again (e.g., the alpha channel to [0,1]).
+struct SimdClamp2 {
+    template<typename V>
+    V operator()(const V& a, const V& lo, const V& hi, const V& lo2,
+                 const V& hi2) const
+    {
+        return OIIO::clamp(OIIO::clamp(a, lo, hi), lo2, hi2);
+    }
+};
+
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
@@ -30,16 +30,21 @@
 
 
 #include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/deepdata.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/timer.h>
 #include <OpenImageIO/unittest.h>
 
@@ -375,6 +380,63 @@ test_channel_append()
         OIIO_CHECK_EQUAL(r[0], Acolor);
         OIIO_CHECK_EQUAL(r[1], Bcolor);
     }
+
+    // Same-typed local images take a direct copy; check it against the
+    // iterator path taken by images backed by the ImageCache.
+    ImageSpec hspec(37, 19, 3, TypeDesc::HALF);
+    ImageBuf HA(hspec), HB(ImageSpec(37, 19, 2, TypeDesc::HALF));
+    ImageBufAlgo::noise(HA, "uniform", 0.0f, 1.0f, false, 1);
+    ImageBufAlgo::noise(HB, "uniform", 0.0f, 1.0f, false, 2);
+    HB.write("channel_append_b.exr");
+    ImageBuf HBc("channel_append_b.exr");  // not read, so cached
+    ImageBuf L(ImageSpec(37, 19, 5, TypeDesc::HALF));
+    ImageBuf C(ImageSpec(37, 19, 5, TypeDesc::HALF));
+    ImageBufAlgo::channel_append(L, HA, HB);
+    ImageBufAlgo::channel_append(C, HA, HBc);
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(L, C, 0.0f, 0.0f).nfail, 0);
+    OIIO_CHECK_EQUAL(L.getchannel(4, 7, 0, 1), HA.getchannel(4, 7, 0, 1));
+    OIIO_CHECK_EQUAL(L.getchannel(4, 7, 0, 4), HB.getchannel(4, 7, 0, 1));
+}
+
+
+
+// Tests ImageBufAlgo::channels
+void
+test_channels()
+{
+    std::cout << "test channels\n";
+    for (TypeDesc t : { TypeDesc::HALF, TypeDesc::FLOAT }) {
+        ImageSpec spec(41, 23, 10, t);
+        spec.x = 2;
+        spec.y = -3;
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, 1);
+        std::string filename = Strutil::sprintf("channels_src_%s.exr", t);
+        A.write(filename);
+        ImageBuf B(filename);  // not read, so cached, not local
+        const int order[]  = { 7, -1, 2, 9 };
+        const float vals[] = { 0.0f, 0.5f, 0.0f, 0.0f };
+        const int prefix[] = { 0, 1, 2 };
+        cspan<int> corder(order), cprefix(prefix);
+        cspan<float> cvals(vals);
+        ImageBuf Ra = ImageBufAlgo::channels(A, 4, corder, cvals);
+        ImageBuf Rb = ImageBufAlgo::channels(B, 4, corder, cvals);
+        OIIO_CHECK_EQUAL(Ra.nchannels(), 4);
+        OIIO_CHECK_EQUAL(Ra.spec().format, t);
+        OIIO_CHECK_ASSERT(Ra.roi() == Rb.roi());
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(Ra, Rb, 0.0f, 0.0f).nfail, 0);
+        OIIO_CHECK_EQUAL(Ra.getchannel(5, 4, 0, 0), A.getchannel(5, 4, 0, 7));
+        OIIO_CHECK_EQUAL(Ra.getchannel(5, 4, 0, 1), 0.5f);
+        // A prefix of the channels, and the zero-copy view of the same.
+        ImageBuf Pa = ImageBufAlgo::channels(A, 3, cprefix);
+        ImageBuf Pb = ImageBufAlgo::channels(B, 3, cprefix);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(Pa, Pb, 0.0f, 0.0f).nfail, 0);
+        ROI vroi   = A.roi();
+        vroi.chend = 3;
+        const ImageBuf& Aconst(A);
+        OIIO_CHECK_EQUAL(
+            ImageBufAlgo::compare(Pa, Aconst.view(vroi), 0.0f, 0.0f).nfail, 0);
+    }
 }
 
 
@@ -519,6 +581,74 @@ test_mad()
 
 
 
+// Tests that the SIMD row fast paths of the pointwise arithmetic functions
+// match the general iterator paths. Views into larger images are not
+// contiguous, so operations on them must take the iterator path.
+void
+test_simd_rows()
+{
+    std::cout << "test simd rows\n";
+    const TypeDesc types[] = { TypeDesc::FLOAT, TypeDesc::HALF,
+                               TypeDesc::UINT8, TypeDesc::UINT16 };
+    const float kvals[] = { 0.25f, -0.5f, 0.75f };
+    const float lo[]    = { 0.1f, 0.2f, 0.3f };
+    const float hi[]    = { 0.6f, 0.7f, 0.8f };
+    cspan<float> kval(kvals);
+    for (TypeDesc t : types) {
+        ImageSpec spec(37, 5, 3, t);
+        spec.alpha_channel = 2;
+        ImageBuf A(spec), B(spec), C(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, 1);
+        ImageBufAlgo::noise(B, "uniform", 0.0f, 1.0f, false, 2);
+        ImageBufAlgo::noise(C, "uniform", 0.0f, 1.0f, false, 3);
+
+        ImageSpec bigspec(45, 9, 3, t);
+        bigspec.x = -4;
+        bigspec.y = -2;
+        ImageBuf Abig(bigspec), Bbig(bigspec), Cbig(bigspec);
+        ImageBufAlgo::zero(Abig);
+        ImageBufAlgo::zero(Bbig);
+        ImageBufAlgo::zero(Cbig);
+        ImageBufAlgo::paste(Abig, 0, 0, 0, 0, A);
+        ImageBufAlgo::paste(Bbig, 0, 0, 0, 0, B);
+        ImageBufAlgo::paste(Cbig, 0, 0, 0, 0, C);
+        ImageBuf Av = Abig.view(A.roi());
+        ImageBuf Bv = Bbig.view(B.roi());
+        ImageBuf Cv = Cbig.view(C.roi());
+        OIIO_CHECK_ASSERT(A.contiguous() && !Av.contiguous());
+
+        auto check = [&](const ImageBuf& fast, const ImageBuf& slow,
+                         float tol) {
+            ImageBufAlgo::CompareResults comp;
+            ImageBufAlgo::compare(fast, slow, tol, tol, comp);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+            if (comp.nfail)
+                std::cout << "  failed for " << t << "\n";
+        };
+        check(ImageBufAlgo::add(A, B), ImageBufAlgo::add(Av, Bv), 0.0f);
+        check(ImageBufAlgo::sub(A, B), ImageBufAlgo::sub(Av, Bv), 0.0f);
+        check(ImageBufAlgo::mul(A, B), ImageBufAlgo::mul(Av, Bv), 0.0f);
+        check(ImageBufAlgo::div(A, B), ImageBufAlgo::div(Av, Bv), 0.0f);
+        check(ImageBufAlgo::add(A, kval), ImageBufAlgo::add(Av, kval), 0.0f);
+        check(ImageBufAlgo::mul(A, kval), ImageBufAlgo::mul(Av, kval), 0.0f);
+        check(ImageBufAlgo::mad(A, B, C), ImageBufAlgo::mad(Av, Bv, Cv),
+              0.004f);
+        check(ImageBufAlgo::mad(A, kval, C), ImageBufAlgo::mad(Av, kval, Cv),
+              0.004f);
+        check(ImageBufAlgo::clamp(A, lo, hi), ImageBufAlgo::clamp(Av, lo, hi),
+              0.0f);
+        ImageBuf S = ImageBufAlgo::mul(A, kval);
+        ImageBuf Sbig(bigspec);
+        ImageBufAlgo::zero(Sbig);
+        ImageBufAlgo::paste(Sbig, 0, 0, 0, 0, S);
+        check(ImageBufAlgo::clamp(S, -1.0f, 1.0f, true),
+              ImageBufAlgo::clamp(Sbig.view(S.roi()), -1.0f, 1.0f, true),
+              0.0f);
+    }
+}
+
+
+
 // Test ImageBuf::over
 void
 test_over()
@@ -568,6 +698,126 @@ test_over()
 
 
 
+// Tests that the scanline fast path of over and zover for many-channel
+// float and half images matches the general iterator path (taken for
+// non-contiguous views), including runs of clear and opaque pixels.
+void
+test_over_rows()
+{
+    std::cout << "test over rows\n";
+    const int CHANNELS = 20;
+    std::vector<float> zeros(CHANNELS, 0.0f), ones(CHANNELS, 1.0f);
+    for (TypeDesc t : { TypeDesc::FLOAT, TypeDesc::HALF }) {
+        ImageSpec spec(40, 6, CHANNELS, t);
+        spec.alpha_channel = 3;
+        spec.z_channel     = 4;
+        ImageBuf A(spec), B(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, 1);
+        ImageBufAlgo::noise(B, "uniform", 0.0f, 1.0f, false, 2);
+        ImageBufAlgo::fill(A, zeros, ROI(0, 10, 0, 6, 0, 1, 3, 4));
+        ImageBufAlgo::fill(A, ones, ROI(10, 20, 0, 6, 0, 1, 3, 4));
+        ImageBufAlgo::fill(B, zeros, ROI(15, 25, 0, 3, 0, 1, 4, 5));
+
+        ImageSpec bigspec = spec;
+        bigspec.width += 6;
+        bigspec.x = -3;
+        ImageBuf Abig(bigspec), Bbig(bigspec);
+        ImageBufAlgo::zero(Abig);
+        ImageBufAlgo::zero(Bbig);
+        ImageBufAlgo::paste(Abig, 0, 0, 0, 0, A);
+        ImageBufAlgo::paste(Bbig, 0, 0, 0, 0, B);
+        ImageBuf Av = Abig.view(A.roi());
+        ImageBuf Bv = Bbig.view(B.roi());
+
+        auto check = [&](const ImageBuf& fast, const ImageBuf& slow) {
+            ImageBufAlgo::CompareResults comp;
+            ImageBufAlgo::compare(fast, slow, 0.0f, 0.0f, comp);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        };
+        check(ImageBufAlgo::over(A, B), ImageBufAlgo::over(Av, Bv));
+        check(ImageBufAlgo::zover(A, B, false), ImageBufAlgo::zover(Av, Bv));
+        check(ImageBufAlgo::zover(A, B, true),
+              ImageBufAlgo::zover(Av, Bv, true));
+    }
+}
+
+
+
+// Tests that the blocked in-memory flip, flop, rotations and transpose
+// match the iterator versions (used for an ImageCache-backed source).
+void
+test_orient()
+{
+    std::cout << "test orient\n";
+    for (TypeDesc t : { TypeDesc::HALF, TypeDesc::FLOAT }) {
+        ImageSpec spec(77, 45, 3, t);
+        spec.x = 3;
+        spec.y = -2;
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, 1);
+        std::string filename = Strutil::sprintf("orient_src_%s.exr", t);
+        A.write(filename);
+        ImageBuf B(filename);  // not read, so cached, not local
+        for (ROI roi : { ROI(), ROI(10, 50, 0, 30, 0, 1, 1, 3) }) {
+            auto check = [&](const ImageBuf& Ra, const ImageBuf& Rb) {
+                OIIO_CHECK_ASSERT(Ra.roi() == Rb.roi());
+                auto comp = ImageBufAlgo::compare(Ra, Rb, 0.0f, 0.0f);
+                OIIO_CHECK_EQUAL(comp.nfail, 0);
+            };
+            check(ImageBufAlgo::flip(A, roi), ImageBufAlgo::flip(B, roi));
+            check(ImageBufAlgo::flop(A, roi), ImageBufAlgo::flop(B, roi));
+            check(ImageBufAlgo::rotate90(A, roi),
+                  ImageBufAlgo::rotate90(B, roi));
+            check(ImageBufAlgo::rotate180(A, roi),
+                  ImageBufAlgo::rotate180(B, roi));
+            check(ImageBufAlgo::rotate270(A, roi),
+                  ImageBufAlgo::rotate270(B, roi));
+            check(ImageBufAlgo::transpose(A, roi),
+                  ImageBufAlgo::transpose(B, roi));
+        }
+    }
+}
+
+
+
+// Tests ImageBufAlgo::transpose, and an fft/ifft round trip (which also
+// exercises the in-memory transposes).
+void
+test_transpose_fft()
+{
+    std::cout << "test transpose and fft\n";
+    ImageSpec spec(75, 41, 3, TypeDesc::HALF);
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, 1);
+    ImageBuf T(ImageSpec(41, 75, 3, TypeDesc::HALF));
+    ImageBufAlgo::transpose(T, A);
+    OIIO_CHECK_EQUAL(T.spec().width, 41);
+    OIIO_CHECK_EQUAL(T.spec().height, 75);
+    bool ok = true;
+    for (int y = 0; y < 41; ++y)
+        for (int x = 0; x < 75; ++x)
+            for (int c = 0; c < 3; ++c)
+                ok &= (T.getchannel(y, x, 0, c) == A.getchannel(x, y, 0, c));
+    OIIO_CHECK_ASSERT(ok);
+    ImageBuf T1(ImageSpec(41, 75, 2, TypeDesc::HALF));
+    ImageBufAlgo::transpose(T1, A, ROI(0, 75, 0, 41, 0, 1, 1, 2));
+    ok = true;
+    for (int y = 0; y < 41; ++y)
+        for (int x = 0; x < 75; ++x)
+            ok &= (T1.getchannel(y, x, 0, 1) == A.getchannel(x, y, 0, 1));
+    OIIO_CHECK_ASSERT(ok);
+
+    ImageSpec fspec(37, 23, 1, TypeDesc::FLOAT);
+    ImageBuf F(fspec);
+    ImageBufAlgo::noise(F, "uniform", 0.0f, 1.0f, false, 2);
+    ImageBuf R = ImageBufAlgo::ifft(ImageBufAlgo::fft(F));
+    ImageBufAlgo::CompareResults comp;
+    ImageBufAlgo::compare(F, R, 1.0e-5f, 1.0e-5f, comp);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+}
+
+
+
 // Tests ImageBufAlgo::compare
 void
 test_compare()
@@ -611,10 +861,1874 @@ test_compare()
     OIIO_CHECK_EQUAL(comp.maxx, 9);
     OIIO_CHECK_EQUAL(comp.maxy, 0);
     OIIO_CHECK_EQUAL_THRESH(comp.meanerror, 0.0045, 1.0e-8);
+
+    // Early out: only ever more failures than allowed are found, and we
+    // still know that the comparison failed.
+    comp = ImageBufAlgo::compare(A, B, failthresh, warnthresh, 2,
+                                 std::numeric_limits<float>::max());
+    OIIO_CHECK_ASSERT(comp.nfail > 2 && comp.nfail <= 5);
+    comp = ImageBufAlgo::compare(A, B, failthresh, warnthresh, 100, 0.065f);
+    OIIO_CHECK_ASSERT(comp.maxerror > 0.065f);
+
+    // A larger, multi-band comparison (taking the scanline path) must give
+    // the same results as one through a non-contiguous view, which uses
+    // the iterators.
+    ImageSpec bigspec(300, 200, 5, TypeDesc::HALF);
+    ImageBuf C(bigspec), D(bigspec);
+    ImageBufAlgo::noise(C, "uniform", 0.0f, 1.0f, false, 1);
+    ImageBufAlgo::noise(D, "uniform", 0.0f, 1.0f, false, 2);
+    ImageBufAlgo::CompareResults cfast = ImageBufAlgo::compare(C, D, 0.5f,
+                                                               0.25f);
+    bigspec.width += 4;
+    ImageBuf Cbig(bigspec), Dbig(bigspec);
+    ImageBufAlgo::paste(Cbig, 0, 0, 0, 0, C);
+    ImageBufAlgo::paste(Dbig, 0, 0, 0, 0, D);
+    ImageBufAlgo::CompareResults cslow
+        = ImageBufAlgo::compare(Cbig.view(C.roi()), Dbig.view(D.roi()), 0.5f,
+                                0.25f);
+    OIIO_CHECK_EQUAL(cfast.nfail, cslow.nfail);
+    OIIO_CHECK_EQUAL(cfast.nwarn, cslow.nwarn);
+    OIIO_CHECK_EQUAL(cfast.maxerror, cslow.maxerror);
+    OIIO_CHECK_EQUAL(cfast.maxx, cslow.maxx);
+    OIIO_CHECK_EQUAL(cfast.maxy, cslow.maxy);
+    OIIO_CHECK_EQUAL(cfast.maxc, cslow.maxc);
+    OIIO_CHECK_EQUAL_THRESH(cfast.meanerror, cslow.meanerror, 1.0e-9);
+    OIIO_CHECK_EQUAL_THRESH(cfast.rms_error, cslow.rms_error, 1.0e-9);
+}
+
+
+
+// Tests that ImageBufAlgo::resize gives the same results for images in
+// local memory (the two-pass fast path) and backed by the ImageCache (the
+// general one), for both enlarging and shrinking.
+void
+test_resize()
+{
+    std::cout << "test resize\n";
+    for (int nchannels : { 3, 6 }) {
+        ImageSpec spec(64, 48, nchannels, TypeDesc::FLOAT);
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write("resize_src.exr");
+        ImageBuf B("resize_src.exr");  // not read, so cached, not local
+        for (ROI roi : { ROI(0, 150, 0, 100), ROI(0, 23, 0, 17) }) {
+            ImageBuf Ra = ImageBufAlgo::resize(A, "lanczos3", 0.0f, roi);
+            ImageBuf Rb = ImageBufAlgo::resize(B, "lanczos3", 0.0f, roi);
+            OIIO_CHECK_ASSERT(Ra.localpixels() && !B.localpixels());
+            auto comp = ImageBufAlgo::compare(Ra, Rb, 1.0e-5f, 1.0e-5f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+}
+
+
+
+// Tests that warp/rotate from local pixels (which reads the separable
+// filter's footprint directly) matches warp from an ImageCache-backed
+// copy of the same image (which goes through iterators).
+void
+test_warp()
+{
+    std::cout << "test warp\n";
+    ImageSpec spec(80, 60, 3, TypeDesc::FLOAT);
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    A.write("warp_src.exr");
+    ImageBuf B("warp_src.exr");  // not read, so cached, not local
+    for (const char* filtername : { "lanczos3", "triangle", "gaussian" }) {
+        ImageBuf Ra = ImageBufAlgo::rotate(A, 0.3f, filtername);
+        ImageBuf Rb = ImageBufAlgo::rotate(B, 0.3f, filtername);
+        OIIO_CHECK_ASSERT(Ra.localpixels() && !B.localpixels());
+        auto comp = ImageBufAlgo::compare(Ra, Rb, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+        // A shrinking warp, with a wider footprint.
+        Imath::M33f M(0.4f, 0.1f, 0.0f, -0.1f, 0.45f, 0.0f, 3.0f, 2.0f, 1.0f);
+        Ra   = ImageBufAlgo::warp(A, M, filtername);
+        Rb   = ImageBufAlgo::warp(B, M, filtername);
+        comp = ImageBufAlgo::compare(Ra, Rb, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// Tests that ImageBufAlgo::convolve's separable and FFT paths match a
+// direct evaluation of the convolution with clamped edges.
+void
+test_convolve()
+{
+    std::cout << "test convolve\n";
+    ImageSpec spec(48, 36, 3, TypeDesc::FLOAT);
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    // gaussian is separable; a wide disk is not, and is big enough for FFT
+    for (const char* kname : { "gaussian", "disk" }) {
+        ImageBuf K = ImageBufAlgo::make_kernel(kname, 17.0f, 15.0f);
+        ImageBuf R = ImageBufAlgo::convolve(A, K);
+        OIIO_CHECK_ASSERT(!R.has_error());
+        ImageBuf ref(spec);
+        for (ImageBuf::Iterator<float> r(ref); !r.done(); ++r) {
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            for (ImageBuf::ConstIterator<float> k(K); !k.done(); ++k) {
+                float s[3];
+                A.getpixel(r.x() + k.x(), r.y() + k.y(), 0, s, 3,
+                           ImageBuf::WrapClamp);
+                for (int c = 0; c < 3; ++c)
+                    sum[c] += k[0] * s[c];
+            }
+            for (int c = 0; c < 3; ++c)
+                r[c] = sum[c];
+        }
+        auto comp = ImageBufAlgo::compare(R, ref, 1.0e-4f, 1.0e-4f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// Tests that ImageBufAlgo::median_filter's sliding histogram path for 8
+// and 16 bit images matches the general path used for float.
+void
+test_median_filter()
+{
+    std::cout << "test median_filter\n";
+    for (TypeDesc format : { TypeDesc::UINT8, TypeDesc::UINT16 }) {
+        ImageBuf A(ImageSpec(37, 29, 2, format));
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        ImageBuf Afloat;
+        Afloat.copy(A, TypeDesc::FLOAT);
+        for (int w : { 3, 9, 12 }) {
+            ImageBuf M      = ImageBufAlgo::median_filter(A, w, w + 2);
+            ImageBuf Mfloat = ImageBufAlgo::median_filter(Afloat, w, w + 2);
+            auto comp = ImageBufAlgo::compare(M, Mfloat, 1.0e-6f, 1.0e-6f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+}
+
+
+
+// Tests that ImageBufAlgo::dilate and erode match the max and min over
+// the clamped window, including for more than four channels.
+void
+test_dilate_erode()
+{
+    std::cout << "test dilate/erode\n";
+    const int nc = 5, w = 7, h = 4;
+    ImageBuf A(ImageSpec(31, 23, nc, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    ImageBuf D = ImageBufAlgo::dilate(A, w, h);
+    ImageBuf E = ImageBufAlgo::erode(A, w, h);
+    ImageBuf Dref(A.spec()), Eref(A.spec());
+    ImageBuf::Iterator<float> e(Eref);
+    for (ImageBuf::Iterator<float> d(Dref); !d.done(); ++d, ++e) {
+        float dval[nc], eval[nc], p[nc];
+        std::fill(dval, dval + nc, -1.0f);
+        std::fill(eval, eval + nc, 2.0f);
+        for (int y = d.y() - h / 2; y < d.y() - h / 2 + h; ++y)
+            for (int x = d.x() - w / 2; x < d.x() - w / 2 + w; ++x) {
+                A.getpixel(x, y, 0, p, nc, ImageBuf::WrapClamp);
+                for (int c = 0; c < nc; ++c) {
+                    dval[c] = std::max(dval[c], p[c]);
+                    eval[c] = std::min(eval[c], p[c]);
+                }
+            }
+        for (int c = 0; c < nc; ++c) {
+            d[c] = dval[c];
+            e[c] = eval[c];
+        }
+    }
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(D, Dref, 0.0f, 0.0f).nfail, 0);
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(E, Eref, 0.0f, 0.0f).nfail, 0);
+}
+
+
+
+// Tests ImageBufAlgo::fillholes_pushpull: opaque pixels are kept as they
+// were, and a hole in a constant color image is filled with that color.
+void
+test_fillholes_pushpull()
+{
+    std::cout << "test fillholes_pushpull\n";
+    ImageSpec spec(67, 45, 4, TypeDesc::FLOAT);
+    spec.x = 5;
+    spec.y = 3;
+    ImageBuf A(spec);
+    const float color[] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    ImageBufAlgo::fill(A, color);
+    ImageBufAlgo::zero(A, ROI(20, 41, 10, 30));
+    ImageBuf R = ImageBufAlgo::fillholes_pushpull(A);
+    OIIO_CHECK_ASSERT(R.roi() == A.roi());
+    for (ImageBuf::ConstIterator<float> r(R); !r.done(); ++r)
+        for (int c = 0; c < 4; ++c)
+            OIIO_CHECK_EQUAL_THRESH(r[c], color[c], 1.0e-5f);
+}
+
+
+// Make a small deep image of R, A, Z, Zback whose sample counts and depths
+// vary from pixel to pixel, so that merges and holdouts split some of them.
+static ImageBuf
+make_deep_test_image(int seed)
+{
+    ImageSpec spec(40, 30, 4, TypeDesc::FLOAT);
+    spec.channelnames = { "R", "A", "Z", "Zback" };
+    spec.deep         = true;
+    ImageBuf buf(spec);
+    for (int y = 0; y < spec.height; ++y)
+        for (int x = 0; x < spec.width; ++x)
+            buf.set_deep_samples(x, y, 0, (x + y * seed) % 4);
+    for (int y = 0; y < spec.height; ++y)
+        for (int x = 0; x < spec.width; ++x)
+            for (int s = 0, n = buf.deep_samples(x, y); s < n; ++s) {
+                float z = 0.5f * seed + 1.3f * s + 0.01f * (x + y);
+                buf.set_deep_value(x, y, 0, 0, s, 0.25f * seed);
+                buf.set_deep_value(x, y, 0, 1, s, s == 2 ? 1.0f : 0.4f);
+                buf.set_deep_value(x, y, 0, 2, s, z);
+                buf.set_deep_value(x, y, 0, 3, s, z + 0.9f);
+            }
+    return buf;
+}
+
+
+
+static bool
+deep_images_equal(const ImageBuf& A, const ImageBuf& B)
+{
+    for (int y = A.ybegin(); y < A.yend(); ++y)
+        for (int x = A.xbegin(); x < A.xend(); ++x) {
+            int n = A.deep_samples(x, y);
+            if (n != B.deep_samples(x, y))
+                return false;
+            for (int c = 0; c < A.nchannels(); ++c)
+                for (int s = 0; s < n; ++s)
+                    if (A.deep_value(x, y, 0, c, s)
+                        != B.deep_value(x, y, 0, c, s))
+                        return false;
+        }
+    return true;
+}
+
+
+
+// Tests the threaded deep_merge and deep_holdout against their
+// single-threaded results, and DeepData::set_all_capacity.
+void
+test_deep_merge_holdout()
+{
+    std::cout << "test deep_merge, deep_holdout\n";
+    ImageBuf A = make_deep_test_image(1);
+    ImageBuf B = make_deep_test_image(2);
+
+    ImageBuf M1 = ImageBufAlgo::deep_merge(A, B, true, ROI(), 1);
+    ImageBuf M  = ImageBufAlgo::deep_merge(A, B, true, ROI(), 0);
+    OIIO_CHECK_ASSERT(deep_images_equal(M, M1));
+    OIIO_CHECK_ASSERT(M.deep_samples(5, 5) > 0);
+
+    ImageBuf H1 = ImageBufAlgo::deep_holdout(A, B, ROI(), 1);
+    ImageBuf H  = ImageBufAlgo::deep_holdout(A, B, ROI(), 0);
+    OIIO_CHECK_ASSERT(deep_images_equal(H, H1));
+    // Nothing may remain behind the opaque depth of the holdout mask.
+    for (int y = 0; y < H.yend(); ++y)
+        for (int x = 0; x < H.xend(); ++x) {
+            float zthresh = B.deepdata()->opaque_z(B.pixelindex(x, y, 0));
+            for (int s = 0, n = H.deep_samples(x, y); s < n; ++s)
+                OIIO_CHECK_ASSERT(H.deep_value(x, y, 0, 3, s) <= zthresh);
+        }
+
+    // Growing every pixel's capacity at once must keep the samples.
+    DeepData dd(*A.deepdata());
+    std::vector<unsigned int> cap(dd.pixels());
+    for (int p = 0; p < dd.pixels(); ++p)
+        cap[p] = dd.samples(p) + p % 3;
+    dd.set_all_capacity(cap);
+    for (int p = 0; p < dd.pixels(); ++p) {
+        OIIO_CHECK_EQUAL(dd.capacity(p), int(cap[p]));
+        for (int s = 0; s < dd.samples(p); ++s)
+            OIIO_CHECK_EQUAL(dd.deep_value(p, 2, s),
+                             A.deepdata()->deep_value(p, 2, s));
+    }
+}
+
+
+// Tests that DeepData behaves the same whether its samples are stored
+// interleaved or planar.
+void
+test_deepdata_planar()
+{
+    std::cout << "test DeepData planar\n";
+    ImageBuf A = make_deep_test_image(1);
+    const DeepData& ref(*A.deepdata());
+    DeepData dd(ref);
+    dd.set_planar(true);
+    OIIO_CHECK_ASSERT(dd.planar() && !ref.planar());
+    OIIO_CHECK_EQUAL(dd.samplestride(2), sizeof(float));
+    OIIO_CHECK_EQUAL(ref.samplestride(2), ref.samplesize());
+    DeepData il(ref);
+    for (int p = 0; p < dd.pixels(); ++p) {
+        dd.insert_samples(p, 0);
+        il.insert_samples(p, 0);
+        for (int c = 0; c < dd.channels(); ++c) {
+            dd.set_deep_value(p, c, 0, 5.0f - 0.1f * c);
+            il.set_deep_value(p, c, 0, 5.0f - 0.1f * c);
+        }
+        dd.sort(p);
+        il.sort(p);
+        dd.split(p, 1.7f);
+        il.split(p, 1.7f);
+    }
+    dd.set_planar(false);
+    for (int p = 0; p < dd.pixels(); ++p) {
+        OIIO_CHECK_EQUAL(dd.samples(p), il.samples(p));
+        for (int c = 0; c < dd.channels(); ++c)
+            for (int s = 0; s < dd.samples(p); ++s)
+                OIIO_CHECK_EQUAL(dd.deep_value(p, c, s),
+                                 il.deep_value(p, c, s));
+    }
+}
+
+
+// Tests growing DeepData pixels one sample at a time, which moves only the
+// pixel that grows, and that all_data() is compacted afterwards.
+void
+test_deepdata_growth()
+{
+    std::cout << "test DeepData growth\n";
+    ImageBuf A = make_deep_test_image(1);
+    const DeepData& ref(*A.deepdata());
+    DeepData dd(ref);
+    dd.reserve_total(4 * dd.pixels());
+    for (int round = 0; round < 10; ++round)
+        for (int p = round % 3; p < dd.pixels(); p += 3) {
+            dd.insert_samples(p, 0);
+            dd.set_deep_value(p, 2, 0, float(-round));
+        }
+    size_t total = 0;
+    for (int p = 0; p < dd.pixels(); ++p) {
+        int added = (12 - p % 3) / 3;  // rounds p%3, p%3+3, ... < 10
+        int last  = p % 3 + 3 * (added - 1);
+        OIIO_CHECK_EQUAL(dd.samples(p), ref.samples(p) + added);
+        OIIO_CHECK_EQUAL(dd.deep_value(p, 2, 0), float(-last));
+        for (int s = 0; s < ref.samples(p); ++s)
+            OIIO_CHECK_EQUAL(dd.deep_value(p, 2, s + added),
+                             ref.deep_value(p, 2, s));
+        total += dd.capacity(p);
+    }
+    OIIO_CHECK_EQUAL(size_t(dd.all_data().size()), total * dd.samplesize());
+}
+
+
+// Tests ImageBufAlgo::flatten against compositing the samples one at a
+// time, front to back.
+void
+test_flatten()
+{
+    std::cout << "test flatten\n";
+    ImageBuf A = make_deep_test_image(1);
+    ImageBuf F = ImageBufAlgo::flatten(A);
+    OIIO_CHECK_ASSERT(!F.deep() && F.roi() == A.roi());
+    for (ImageBuf::ConstIterator<float> f(F); !f.done(); ++f) {
+        int n = A.deep_samples(f.x(), f.y());
+        float R = 0.0f, alpha = 0.0f, Z = n ? 0.0f : 1.0e30f;
+        for (int s = 0; s < n && alpha < 1.0f; ++s) {
+            R += (1.0f - alpha) * A.deep_value(f.x(), f.y(), 0, 0, s);
+            Z = Z * alpha
+                + (1.0f - alpha) * A.deep_value(f.x(), f.y(), 0, 2, s);
+            alpha += (1.0f - alpha) * A.deep_value(f.x(), f.y(), 0, 1, s);
+        }
+        OIIO_CHECK_EQUAL_THRESH(f[0], R, 1.0e-6f);
+        OIIO_CHECK_EQUAL_THRESH(f[1], alpha, 1.0e-6f);
+        OIIO_CHECK_EQUAL_THRESH(f[2], Z, 1.0e-5f * Z);
+    }
+}
+
+
+// Tests that render_text gives the same result drawing the same text
+// again (from its glyph cache), and from several threads at once.
+void
+test_render_text()
+{
+    std::cout << "test render_text\n";
+    if (!ImageBufAlgo::text_size("Hello, 123").defined()) {
+        std::cout << "  (skipped, no font available)\n";
+        return;
+    }
+    const float white[] = { 1.0f, 1.0f, 1.0f };
+    ImageSpec spec(128, 32, 3, TypeDesc::FLOAT);
+    ImageBuf first(spec);
+    ImageBufAlgo::zero(first);
+    OIIO_CHECK_ASSERT(
+        ImageBufAlgo::render_text(first, 4, 24, "Hello, 123", 16, "", white));
+    std::vector<ImageBuf> bufs(8, ImageBuf(spec));
+    parallel_for(0, int64_t(bufs.size()), [&](int64_t i) {
+        ImageBufAlgo::zero(bufs[i]);
+        ImageBufAlgo::render_text(bufs[i], 4, 24, "Hello, 123", 16, "", white,
+                                  ImageBufAlgo::TextAlignX::Left,
+                                  ImageBufAlgo::TextAlignY::Baseline, 0, ROI(),
+                                  1);
+    });
+    for (auto& b : bufs) {
+        auto comp = ImageBufAlgo::compare(first, b, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+    OIIO_CHECK_NE(ImageBufAlgo::computePixelStats(first).max[0], 0.0f);
+}
+
+
+// Tests ImageBufAlgo::noise: results must not depend on the thread count,
+// and the gaussian distribution must have the requested mean and stddev.
+void
+test_noise()
+{
+    std::cout << "test noise\n";
+    ImageSpec spec(301, 203, 3, TypeDesc::FLOAT);
+    for (auto type : { "uniform", "gaussian", "salt" }) {
+        ImageBuf A(spec), B(spec);
+        ImageBufAlgo::zero(A);
+        ImageBufAlgo::zero(B);
+        ImageBufAlgo::noise(A, type, 0.25f, 0.5f, false, 7, ROI(), 1);
+        ImageBufAlgo::noise(B, type, 0.25f, 0.5f, false, 7, ROI(), 0);
+        auto comp = ImageBufAlgo::compare(A, B, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+
+    ImageBuf G(spec);
+    ImageBufAlgo::zero(G);
+    ImageBufAlgo::noise(G, "gaussian", 0.5f, 0.1f, false, 3);
+    auto stats = ImageBufAlgo::computePixelStats(G);
+    for (int c = 0; c < 3; ++c) {
+        OIIO_CHECK_ASSERT(fabsf(stats.avg[c] - 0.5f) < 0.005f);
+        OIIO_CHECK_ASSERT(fabsf(stats.stddev[c] - 0.1f) < 0.005f);
+    }
+
+    // mono noise is the same in every channel
+    ImageBuf M(spec);
+    ImageBufAlgo::zero(M);
+    ImageBufAlgo::noise(M, "uniform", 0.0f, 1.0f, true, 5);
+    stats = ImageBufAlgo::computePixelStats(M);
+    OIIO_CHECK_EQUAL(stats.avg[0], stats.avg[1]);
+    OIIO_CHECK_EQUAL(stats.avg[0], stats.avg[2]);
+}
+
+
+// Tests ImageBufAlgo::unsharp_mask: the single-pass separable path must
+// match blurring with convolve and sharpening with the arithmetic ops.
+void
+test_unsharp_mask()
+{
+    std::cout << "test unsharp_mask\n";
+    ImageBuf src = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 11,
+                                       ROI(0, 97, 0, 61, 0, 1, 0, 3));
+    for (auto kernel : { "gaussian", "box" }) {
+        for (float width : { 3.0f, 7.0f, 21.0f }) {
+            ImageBuf K = ImageBufAlgo::make_kernel(kernel, width, width);
+            ImageBuf blurry = ImageBufAlgo::convolve(src, K);
+            ImageBuf diff   = ImageBufAlgo::sub(src, blurry);
+            ImageBuf expected = ImageBufAlgo::mad(diff, 1.5f, src);
+            ImageBuf sharp = ImageBufAlgo::unsharp_mask(src, kernel, width,
+                                                        1.5f);
+            auto comp = ImageBufAlgo::compare(sharp, expected, 1.0e-4f,
+                                              1.0e-4f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+}
+
+
+// Tests resample and resize by integer ratios, which take fast paths.
+void
+test_resample_integer_ratio()
+{
+    std::cout << "test resample/resize integer ratios\n";
+    ImageBuf src = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 5,
+                                       ROI(0, 64, 0, 48, 0, 1, 0, 3));
+    for (int k : { 1, 2, 3, 4 }) {
+        ImageSpec spec(64 / k, 48 / k, 3, TypeDesc::FLOAT);
+        for (bool interp : { false, true }) {
+            ImageBuf R(spec);
+            ImageBufAlgo::resample(R, src, interp);
+            // Nearest, and bilinear at an odd ratio, copy the center
+            // pixel; bilinear at an even ratio averages the middle 2x2.
+            int off = (interp && !(k & 1)) ? 1 : 0;
+            int nfail = 0;
+            for (ImageBuf::ConstIterator<float> r(R); !r.done(); ++r) {
+                int sx = r.x() * k + k / 2, sy = r.y() * k + k / 2;
+                for (int c = 0; c < 3; ++c) {
+                    float v = 0.25f
+                              * (src.getchannel(sx - off, sy - off, 0, c)
+                                 + src.getchannel(sx, sy - off, 0, c)
+                                 + src.getchannel(sx - off, sy, 0, c)
+                                 + src.getchannel(sx, sy, 0, c));
+                    nfail += fabsf(r[c] - v) > 1.0e-6f;
+                }
+            }
+            OIIO_CHECK_EQUAL(nfail, 0);
+        }
+        // A box filter one output pixel wide averages each k x k block.
+        ImageBuf B(spec);
+        ImageBufAlgo::resize(B, src, "box", 1.0f);
+        ImageBuf expected(spec);
+        for (ImageBuf::Iterator<float> e(expected); !e.done(); ++e)
+            for (int c = 0; c < 3; ++c) {
+                float sum = 0.0f;
+                for (int j = 0; j < k; ++j)
+                    for (int i = 0; i < k; ++i)
+                        sum += src.getchannel(e.x() * k + i, e.y() * k + j, 0,
+                                              c);
+                e[c] = sum / (k * k);
+            }
+        auto comp = ImageBufAlgo::compare(B, expected, 1.0e-5f, 1.0e-5f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+
+    // 8 bit to 8 bit stays in fixed point, and rounds to nearest.
+    ImageBuf src8(ImageSpec(8, 8, 1, TypeDesc::UINT8));
+    for (ImageBuf::Iterator<unsigned char> p(src8); !p.done(); ++p)
+        p[0] = (p.x() * 30 + p.y()) / 255.0f;
+    ImageBuf R8(ImageSpec(4, 4, 1, TypeDesc::UINT8));
+    ImageBufAlgo::resample(R8, src8, true);
+    // pixels (2,2),(3,2),(2,3),(3,3) = 62, 92, 63, 93: average 77.5
+    OIIO_CHECK_EQUAL(int(R8.getchannel(1, 1, 0, 0) * 255.0f + 0.5f), 78);
+}
+
+
+// Tests ImageBufAlgo::computePixelHash: tree hashes must not depend on the
+// thread count or on whether the pixels are hashed in place.
+void
+test_computePixelHash()
+{
+    std::cout << "test computePixelHash\n";
+    ImageBuf A = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 3,
+                                     ROI(0, 100, 0, 1000, 0, 1, 0, 3));
+    for (auto alg : { "xxhash64", "farmhash128" }) {
+        std::string h1 = ImageBufAlgo::computePixelHash(A, alg, "", {}, 64, 1);
+        std::string h8 = ImageBufAlgo::computePixelHash(A, alg, "", {}, 64, 8);
+        OIIO_CHECK_EQUAL(h1, h8);
+        OIIO_CHECK_EQUAL(h1.size(), size_t(alg[0] == 'x' ? 16 : 32));
+        // Hashing a region of rows from a copy matches hashing it in place
+        ROI roi(10, 90, 100, 300, 0, 1, 0, 3);
+        ImageBuf B = ImageBufAlgo::cut(A, roi);
+        B.set_origin(10, 100);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::computePixelHash(B, alg, "x", roi, 64),
+                         ImageBufAlgo::computePixelHash(A, alg, "x", roi, 64));
+        // Different extra info, or different pixels, change the hash
+        OIIO_CHECK_NE(ImageBufAlgo::computePixelHash(A, alg, "x"),
+                      ImageBufAlgo::computePixelHash(A, alg, "y"));
+        ImageBuf C;
+        C.copy(A);
+        const float val[] = { 2.0f, 2.0f, 2.0f };
+        C.setpixel(50, 500, val);
+        OIIO_CHECK_NE(ImageBufAlgo::computePixelHash(A, alg, "x"),
+                      ImageBufAlgo::computePixelHash(C, alg, "x"));
+    }
+    OIIO_CHECK_EQUAL(ImageBufAlgo::computePixelHash(A, "sha1"),
+                     ImageBufAlgo::computePixelHashSHA1(A));
+    OIIO_CHECK_EQUAL(ImageBufAlgo::computePixelHash(A, "bogus"), "");
+}
+
+
+
+// Tests the tiled paths of ImageBufAlgo::convolve (small kernels that are
+// not separable) and dilate (data window smaller than the display window)
+// on an image spanning several tiles.
+void
+test_stencil_tiles()
+{
+    std::cout << "test stencil tiles\n";
+    ImageBuf A = ImageBufAlgo::noise("uniform", 0.0f, 1.0f, false, 3,
+                                     ROI(0, 300, 0, 70, 0, 1, 0, 2));
+    ImageBuf K(ImageSpec(3, 3, 1, TypeDesc::FLOAT));
+    K.set_origin(-1, -1);
+    const float kvals[9] = { 0, 1, 0, 1, -4, 1, 0, 1, 0 };
+    K.set_pixels(K.roi(), TypeDesc::FLOAT, kvals);
+    ImageBuf R = ImageBufAlgo::convolve(A, K, false);
+    ImageBuf Rref(A.spec());
+    for (ImageBuf::Iterator<float> r(Rref); !r.done(); ++r) {
+        float sum[2] = { 0.0f, 0.0f }, s[2];
+        for (ImageBuf::ConstIterator<float> k(K); !k.done(); ++k) {
+            A.getpixel(r.x() + k.x(), r.y() + k.y(), 0, s, 2,
+                       ImageBuf::WrapClamp);
+            for (int c = 0; c < 2; ++c)
+                sum[c] += k[0] * s[c];
+        }
+        r[0] = sum[0];
+        r[1] = sum[1];
+    }
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, Rref, 1.0e-6f, 1.0e-6f).nfail,
+                     0);
+
+    // Window pixels outside the data window are skipped, not clamped.
+    ImageSpec spec(200, 50, 2, TypeDesc::FLOAT);
+    spec.x           = 5;
+    spec.y           = 3;
+    spec.full_width  = 210;
+    spec.full_height = 60;
+    ImageBuf B(spec);
+    ImageBufAlgo::noise(B, "uniform", 0.0f, 1.0f);
+    const int w = 5, h = 4;
+    ImageBuf D = ImageBufAlgo::dilate(B, w, h);
+    ImageBuf Dref(spec);
+    ROI broi = B.roi();
+    for (ImageBuf::Iterator<float> d(Dref); !d.done(); ++d) {
+        float dval[2] = { -1.0f, -1.0f }, p[2];
+        for (int y = d.y() - h / 2; y < d.y() - h / 2 + h; ++y)
+            for (int x = d.x() - w / 2; x < d.x() - w / 2 + w; ++x) {
+                if (!broi.contains(x, y))
+                    continue;
+                B.getpixel(x, y, p, 2);
+                dval[0] = std::max(dval[0], p[0]);
+                dval[1] = std::max(dval[1], p[1]);
+            }
+        d[0] = dval[0];
+        d[1] = dval[1];
+    }
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(D, Dref, 0.0f, 0.0f).nfail, 0);
+}
+
+
+
+// Tests reading whole tiled zip TIFF files, whose tiles are decompressed
+// in parallel, including partial tiles at the right and bottom edges.
+void
+test_tiff_parallel_tiles()
+{
+    std::cout << "test tiff parallel tiles\n";
+    for (TypeDesc format : { TypeDesc::UINT8, TypeDesc::UINT16,
+                             TypeDesc::UINT32 }) {
+        ImageSpec spec(100, 70, 3, format);
+        spec.tile_width  = 32;
+        spec.tile_height = 32;
+        spec.attribute("compression", "zip");
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write("partiles.tif");
+        ImageBuf R("partiles.tif");
+        R.read(0, 0, true, format);
+        OIIO_CHECK_ASSERT(!R.has_error());
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+// Tests reading whole LZW and PackBits TIFF files, tiled or in strips,
+// whose strips or tiles are decompressed in parallel.
+void
+test_tiff_lzw_packbits()
+{
+    std::cout << "test tiff lzw/packbits\n";
+    for (const char* compression : { "lzw", "packbits" }) {
+        for (int tile : { 0, 32 }) {
+            ImageSpec spec(100, 70, 3, TypeDesc::UINT16);
+            spec.tile_width = spec.tile_height = tile;
+            spec.attribute("compression", compression);
+            ImageBuf A(spec);
+            ImageBufAlgo::noise(A, "uniform", 0.0f, 0.1f);
+            A.write("lzwpackbits.tif");
+            ImageBuf R("lzwpackbits.tif");
+            R.read(0, 0, true, TypeDesc::UINT16);
+            OIIO_CHECK_ASSERT(!R.has_error());
+            OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail,
+                             0);
+        }
+    }
+}
+
+
+
+// Tests ImageInput::read_native_subimages on a multi-part OpenEXR file:
+// reading several parts at once matches reading each one in turn.
+void
+test_read_native_subimages()
+{
+    std::cout << "test read_native_subimages\n";
+    const int nparts = 3;
+    ImageSpec specs[nparts];
+    for (int p = 0; p < nparts; ++p) {
+        specs[p] = ImageSpec(64 + 16 * p, 48, 2 + p, TypeDesc::HALF);
+        if (p == 1)
+            specs[p].tile_width = specs[p].tile_height = 32;
+    }
+    auto out = ImageOutput::create("multipart.exr");
+    OIIO_CHECK_ASSERT(out && out->open("multipart.exr", nparts, specs));
+    for (int p = 0; p < nparts; ++p) {
+        if (p)
+            out->open("multipart.exr", specs[p], ImageOutput::AppendSubimage);
+        ImageBuf A(specs[p]);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, p);
+        A.write(out.get());
+    }
+    out->close();
+
+    auto in = ImageInput::open("multipart.exr");
+    OIIO_CHECK_ASSERT(in);
+    int subimages[nparts] = { 2, 0, 1 };
+    std::vector<char> bufs[nparts];
+    void* data[nparts];
+    for (int i = 0; i < nparts; ++i) {
+        bufs[i].resize(specs[subimages[i]].image_bytes(true));
+        data[i] = bufs[i].data();
+    }
+    OIIO_CHECK_ASSERT(in->read_native_subimages(nparts, subimages, data));
+    for (int i = 0; i < nparts; ++i) {
+        std::vector<char> ref(bufs[i].size());
+        in->read_image(subimages[i], 0, 0, -1, TypeDesc::UNKNOWN, ref.data());
+        OIIO_CHECK_ASSERT(ref == bufs[i]);
+    }
+}
+
+
+
+// Tests OpenEXR reads converting to float with caller strides, from
+// scanline and tiled files (with partial tiles at the edges).
+void
+test_exr_strided_read()
+{
+    std::cout << "test exr strided read\n";
+    for (int tile : { 0, 32 }) {
+        ImageSpec spec(100, 70, 3, TypeDesc::HALF);
+        spec.tile_width = spec.tile_height = tile;
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write("strided.exr");
+        auto in = ImageInput::open("strided.exr");
+        OIIO_CHECK_ASSERT(in);
+        // Channels 1-2 of each pixel, into every other group of 4 floats
+        const int w = spec.width, h = spec.height;
+        std::vector<float> buf(w * h * 8, -1.0f);
+        stride_t xstride = 8 * sizeof(float);
+        OIIO_CHECK_ASSERT(in->read_image(0, 0, 1, 3, TypeDesc::FLOAT,
+                                         buf.data(), xstride));
+        int nfail = 0;
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x) {
+                const float* p = &buf[(y * w + x) * 8];
+                nfail += p[0] != A.getchannel(x, y, 0, 1)
+                         || p[1] != A.getchannel(x, y, 0, 2) || p[2] != -1.0f;
+            }
+        OIIO_CHECK_EQUAL(nfail, 0);
+    }
+}
+
+
+
+// Tests ImageOutput::copy_image between files of the same format, both
+// when the layouts match (raw chunks can be copied) and when they don't.
+void
+test_copy_image_raw()
+{
+    std::cout << "test copy_image raw\n";
+    for (const char* ext : { "tif", "exr" }) {
+        for (int tile : { 0, 32 }) {
+            for (const char* outcomp : { "", "none" }) {
+                ImageSpec spec(100, 70, 3, TypeDesc::HALF);
+                spec.tile_width = spec.tile_height = tile;
+                spec.attribute("compression", "zip");
+                ImageBuf A(spec);
+                ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+                std::string src = std::string("copysrc.") + ext;
+                std::string dst = std::string("copydst.") + ext;
+                A.write(src);
+                auto in = ImageInput::open(src);
+                OIIO_CHECK_ASSERT(in);
+                ImageSpec outspec = in->spec();
+                if (outcomp[0])
+                    outspec.attribute("compression", outcomp);
+                auto out = ImageOutput::create(dst);
+                OIIO_CHECK_ASSERT(out && out->open(dst, outspec));
+                OIIO_CHECK_ASSERT(out->copy_image(in.get()));
+                out->close();
+                ImageBuf R(dst);
+                OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail,
+                                 0);
+            }
+        }
+    }
+}
+
+
+
+// Tests reading a JPEG at reduced resolution with the "jpeg:scale" hint.
+void
+test_jpeg_scale()
+{
+    std::cout << "test jpeg scale\n";
+    ImageBuf A(ImageSpec(100, 70, 3, TypeDesc::UINT8));
+    ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f });
+    A.write("scale.jpg");
+    for (int scale : { 1, 2, 4, 8 }) {
+        ImageSpec config;
+        config.attribute("jpeg:scale", scale);
+        ImageBuf R("scale.jpg", 0, 0, nullptr, &config);
+        OIIO_CHECK_ASSERT(R.read());
+        OIIO_CHECK_EQUAL(R.spec().width, (100 + scale - 1) / scale);
+        OIIO_CHECK_EQUAL(R.spec().height, (70 + scale - 1) / scale);
+        auto stats = ImageBufAlgo::computePixelStats(R);
+        OIIO_CHECK_EQUAL_THRESH(stats.avg[1], 0.5f, 0.02f);
+    }
+}
+
+
+
+// Tests batched JPEG scanline reads against row-at-a-time reads, including
+// a range that requires rewinding, and the "jpeg:fastdecode" hint.
+void
+test_jpeg_scanlines()
+{
+    std::cout << "test jpeg scanlines\n";
+    ImageBuf A(ImageSpec(64, 50, 3, TypeDesc::UINT8));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    A.write("scanlines.jpg");
+    auto in = ImageInput::open("scanlines.jpg");
+    OIIO_CHECK_ASSERT(in);
+    const size_t rowbytes = 64 * 3;
+    std::vector<unsigned char> rows(50 * rowbytes), batch(50 * rowbytes);
+    for (int y = 0; y < 50; ++y)
+        OIIO_CHECK_ASSERT(
+            in->read_scanline(y, 0, TypeDesc::UINT8, &rows[y * rowbytes]));
+    OIIO_CHECK_ASSERT(in->read_scanlines(0, 0, 10, 30, 0, 0, 3,
+                                         TypeDesc::UINT8, &batch[0]));
+    OIIO_CHECK_ASSERT(
+        !memcmp(&batch[0], &rows[10 * rowbytes], 20 * rowbytes));
+    OIIO_CHECK_ASSERT(in->read_image(TypeDesc::UINT8, &batch[0]));
+    OIIO_CHECK_ASSERT(batch == rows);
+
+    ImageSpec config;
+    config.attribute("jpeg:fastdecode", 1);
+    ImageBuf R("scanlines.jpg", 0, 0, nullptr, &config);
+    ImageBuf F("scanlines.jpg");
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, F, 0.1f, 0.1f).nfail, 0);
+}
+
+
+
+// Tests multithreaded PNG compression: big images written with and
+// without it, and with the "fast" preset, all read back losslessly.
+void
+test_png_multithread()
+{
+    std::cout << "test png multithread\n";
+    for (TypeDesc type : { TypeDesc::UINT8, TypeDesc::UINT16 }) {
+        ImageBuf A(ImageSpec(600, 400, 3, type));
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 0.25f);
+        for (const char* compression : { "", "fast" }) {
+            for (int multithread : { 0, 1 }) {
+                A.specmod().attribute("compression", compression);
+                A.specmod().attribute("png:multithread", multithread);
+                A.write("multithread.png");
+                ImageBuf R("multithread.png");
+                OIIO_CHECK_EQUAL(
+                    ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+            }
+        }
+    }
+}
+
+
+
+// Tests the bulk 10-bit DPX read against row-at-a-time reads and against
+// the source pixels, for 1- and 3-channel images whose rows don't end on a
+// whole 32 bit word.
+void
+test_dpx_10bit_read()
+{
+    std::cout << "test dpx 10 bit read\n";
+    for (int nchans : { 1, 3 }) {
+        ImageSpec spec(37, 20, nchans, TypeDesc::UINT16);
+        spec.attribute("oiio:BitsPerSample", 10);
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write("tenbit.dpx");
+        auto in = ImageInput::open("tenbit.dpx");
+        OIIO_CHECK_ASSERT(in);
+        const size_t rowbytes = 37 * nchans * sizeof(uint16_t);
+        std::vector<char> rows(20 * rowbytes), batch(20 * rowbytes);
+        for (int y = 0; y < 20; ++y)
+            OIIO_CHECK_ASSERT(in->read_scanline(y, 0, TypeDesc::UINT16,
+                                                &rows[y * rowbytes]));
+        OIIO_CHECK_ASSERT(in->read_scanlines(0, 0, 5, 17, 0, 0, nchans,
+                                             TypeDesc::UINT16, &batch[0]));
+        OIIO_CHECK_ASSERT(
+            !memcmp(&batch[0], &rows[5 * rowbytes], 12 * rowbytes));
+        OIIO_CHECK_ASSERT(in->read_image(TypeDesc::UINT16, &batch[0]));
+        OIIO_CHECK_ASSERT(batch == rows);
+        in.reset();
+        ImageBuf R("tenbit.dpx");
+        OIIO_CHECK_EQUAL(
+            ImageBufAlgo::compare(R, A, 1.0f / 1023, 1.0f / 1023).nfail, 0);
+    }
+}
+
+
+
+// Tests that JPEG 2000 resolution levels read back as MIP levels.
+void
+test_jpeg2000_levels()
+{
+    std::cout << "test jpeg2000 levels\n";
+    if (!ImageOutput::create("levels.jp2"))
+        return;  // Not built with OpenJpeg
+    ImageBuf A(ImageSpec(128, 96, 3, TypeDesc::UINT8));
+    ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f });
+    A.write("levels.jp2");
+    auto in = ImageInput::open("levels.jp2");
+    OIIO_CHECK_ASSERT(in);
+    OIIO_CHECK_ASSERT(in->seek_subimage(0, 1));
+    OIIO_CHECK_EQUAL(in->current_miplevel(), 1);
+    OIIO_CHECK_EQUAL(in->spec().width, 64);
+    OIIO_CHECK_EQUAL(in->spec().height, 48);
+    std::vector<unsigned char> pixels(64 * 48 * 3);
+    OIIO_CHECK_ASSERT(in->read_image(TypeDesc::UINT8, &pixels[0]));
+    OIIO_CHECK_ASSERT(std::abs(int(pixels[1]) - 128) <= 2);
+    OIIO_CHECK_ASSERT(in->seek_subimage(0, 0));
+    OIIO_CHECK_EQUAL(in->spec().width, 128);
+}
+
+
+
+// Tests that WebP files read back as RGBA by default, or with their own
+// channel count given the "webp:rgb" hint, decoding incrementally as
+// scanlines are requested.
+void
+test_webp_channels()
+{
+    std::cout << "test webp channels\n";
+    if (!ImageOutput::create("channels.webp"))
+        return;  // Not built with WebP
+    for (int nchans : { 3, 4 }) {
+        ImageBuf A(ImageSpec(64, 40, nchans, TypeDesc::UINT8));
+        ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f, 1.0f });
+        A.write("channels.webp");
+        auto in = ImageInput::open("channels.webp");
+        OIIO_CHECK_ASSERT(in);
+        OIIO_CHECK_EQUAL(in->spec().nchannels, 4);
+        in.reset();
+        ImageSpec config;
+        config.attribute("webp:rgb", 1);
+        in = ImageInput::open("channels.webp", &config);
+        OIIO_CHECK_ASSERT(in);
+        OIIO_CHECK_EQUAL(in->spec().nchannels, nchans);
+        std::vector<unsigned char> row(64 * nchans);
+        OIIO_CHECK_ASSERT(in->read_scanline(20, 0, TypeDesc::UINT8, &row[0]));
+        OIIO_CHECK_ASSERT(std::abs(int(row[1]) - 128) <= 3);
+        in.reset();
+        ImageBuf R("channels.webp", 0, 0, nullptr, &config);
+        OIIO_CHECK_EQUAL(
+            ImageBufAlgo::compare(R, A, 4.0f / 255, 4.0f / 255).nfail, 0);
+    }
+}
+
+
+
+// Tests that HDR files decoded all at once (in parallel) match decoding
+// one scanline at a time, in any order, and the original pixels within
+// RGBE precision.
+void
+test_hdr_rle()
+{
+    std::cout << "test hdr rle\n";
+    ImageBuf A(ImageSpec(300, 40, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 4.0f);
+    ImageBufAlgo::fill(A, { 0.5f, 0.25f, 0.125f }, ROI(0, 300, 10, 20));
+    OIIO_CHECK_ASSERT(A.write("rle.hdr"));
+    auto in = ImageInput::open("rle.hdr");
+    OIIO_CHECK_ASSERT(in);
+    std::vector<float> all(300 * 40 * 3), row(300 * 3);
+    OIIO_CHECK_ASSERT(in->read_image(TypeDesc::FLOAT, &all[0]));
+    bool same = true;
+    for (int y : { 39, 3, 15, 0 }) {
+        OIIO_CHECK_ASSERT(in->read_scanline(y, 0, TypeDesc::FLOAT, &row[0]));
+        same &= std::equal(row.begin(), row.end(), all.begin() + y * 900);
+    }
+    OIIO_CHECK_ASSERT(same);
+    in.reset();
+    ImageBuf R("rle.hdr");
+    OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.04f, 0.04f).nfail, 0);
+}
+
+
+
+// Write a minimal block-compressed DDS file (there is no DDS writer).
+static void
+write_dds(const char* name, int w, int h, const char* fourcc,
+          const std::vector<unsigned char>& blocks)
+{
+    uint32_t header[32] = { 0 };
+    memcpy(&header[0], "DDS ", 4);
+    header[1]  = 124;                       // header size
+    header[2]  = 0x1 | 0x2 | 0x4 | 0x1000;  // caps|height|width|pixfmt
+    header[3]  = h;
+    header[4]  = w;
+    header[19] = 32;   // pixel format size
+    header[20] = 0x4;  // fourcc
+    memcpy(&header[21], fourcc, 4);
+    header[27] = 0x1000;  // texture
+    FILE* f = fopen(name, "wb");
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(blocks.data(), blocks.size(), 1, f);
+    fclose(f);
+}
+
+
+
+// Tests parallel DXT1 and BC4 decoding of DDS files, and reading the raw
+// compressed blocks.
+void
+test_dds_blocks()
+{
+    std::cout << "test dds blocks\n";
+    // 6x6 pixels is 2x2 blocks, each one solid red (DXT1) or 200 (BC4)
+    std::vector<unsigned char> dxt1, bc4;
+    for (int b = 0; b < 4; ++b) {
+        for (unsigned char c : { 0x00, 0xF8, 0, 0, 0, 0, 0, 0 })
+            dxt1.push_back(c);
+        for (unsigned char c : { 200, 10, 0, 0, 0, 0, 0, 0 })
+            bc4.push_back(c);
+    }
+    write_dds("blocks_dxt1.dds", 6, 6, "DXT1", dxt1);
+    write_dds("blocks_bc4.dds", 6, 6, "ATI1", bc4);
+
+    ImageBuf A("blocks_dxt1.dds");
+    OIIO_CHECK_EQUAL(A.spec().nchannels, 4);
+    float pixel[4];
+    A.getpixel(5, 5, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 1.0f);
+    OIIO_CHECK_EQUAL(pixel[1], 0.0f);
+    OIIO_CHECK_EQUAL(pixel[3], 1.0f);
+
+    ImageBuf B("blocks_bc4.dds");
+    OIIO_CHECK_EQUAL(B.spec().nchannels, 1);
+    B.getpixel(4, 1, pixel);
+    OIIO_CHECK_EQUAL(pixel[0], 200.0f / 255.0f);
+
+    ImageSpec config;
+    config.attribute("dds:RawBlocks", 1);
+    auto in = ImageInput::open("blocks_dxt1.dds", &config);
+    OIIO_CHECK_ASSERT(in);
+    OIIO_CHECK_EQUAL(in->spec().width, 2);
+    OIIO_CHECK_EQUAL(in->spec().nchannels, 8);
+    std::vector<unsigned char> raw(dxt1.size());
+    OIIO_CHECK_ASSERT(in->read_image(TypeDesc::UINT8, &raw[0]));
+    OIIO_CHECK_ASSERT(raw == dxt1);
+}
+
+
+
+// Tests that reading a whole FITS image at once (flipped and byte swapped
+// in parallel) matches the source and per-scanline reads.
+void
+test_fits_read()
+{
+    std::cout << "test fits read\n";
+    for (TypeDesc type : { TypeDesc::UINT16, TypeDesc::FLOAT }) {
+        ImageBuf A(ImageSpec(37, 23, 1, type));
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        OIIO_CHECK_ASSERT(A.write("read.fits"));
+        ImageBuf R("read.fits");
+        R.read(0, 0, true);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+        auto in = ImageInput::open("read.fits");
+        OIIO_CHECK_ASSERT(in);
+        std::vector<float> all(37 * 23), row(37);
+        OIIO_CHECK_ASSERT(in->read_scanlines(0, 0, 5, 22, 0, 0, 1,
+                                             TypeDesc::FLOAT, &all[0]));
+        OIIO_CHECK_ASSERT(in->read_scanline(9, 0, TypeDesc::FLOAT, &row[0]));
+        OIIO_CHECK_ASSERT(std::equal(row.begin(), row.end(), &all[4 * 37]));
+    }
+}
+
+
+
+// Tests that files with a misleading or missing extension are opened by
+// the right plugin, found from their signature.
+void
+test_format_by_signature()
+{
+    std::cout << "test format by signature\n";
+    ImageBuf A(ImageSpec(8, 8, 3, TypeDesc::UINT8));
+    ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f });
+    const char* formats[][2] = { { "png", "png" },
+                                 { "tif", "tiff" },
+                                 { "exr", "openexr" },
+                                 { "jpg", "jpeg" } };
+    for (auto fmt : formats) {
+        std::string good = Strutil::sprintf("sig.%s", fmt[0]);
+        OIIO_CHECK_ASSERT(A.write(good));
+        for (const char* bad : { "sig_noext", "sig_wrong.dpx" }) {
+            Filesystem::remove(bad);
+            OIIO_CHECK_ASSERT(Filesystem::copy(good, bad));
+            auto in = ImageInput::open(bad);
+            OIIO_CHECK_ASSERT(in);
+            if (in)
+                OIIO_CHECK_EQUAL(std::string(in->format_name()), fmt[1]);
+        }
+    }
+}
+
+
+
+// Tests that looking up unknown formats repeatedly doesn't catalog the
+// plugins again, listing their formats more than once.
+void
+test_plugin_catalog()
+{
+    std::cout << "test plugin catalog\n";
+    for (int i = 0; i < 3; ++i) {
+        OIIO_CHECK_ASSERT(!ImageOutput::create("plugin.nosuchformat"));
+        OIIO::geterror();
+    }
+    std::vector<std::string> formats
+        = Strutil::splits(OIIO::get_string_attribute("format_list"), ",");
+    OIIO_CHECK_ASSERT(formats.size() > 1);
+    std::sort(formats.begin(), formats.end());
+    OIIO_CHECK_ASSERT(std::adjacent_find(formats.begin(), formats.end())
+                      == formats.end());
+    OIIO_CHECK_EQUAL(OIIO::get_int_attribute("plugin_manifest"), 1);
+    auto out = ImageOutput::create("plugin.tif");
+    OIIO_CHECK_ASSERT(out && out->format_name() == std::string("tiff"));
+}
+
+
+
+// Tests that writing through an AsyncImageOutput, with a queue small
+// enough to make writes wait for it, gives the same scanline and tiled
+// files as writing directly.
+void
+test_async_output()
+{
+    std::cout << "test async output\n";
+    ImageBuf A(ImageSpec(97, 61, 3, TypeDesc::UINT16));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    for (int tiled = 0; tiled < 2; ++tiled) {
+        AsyncImageOutput out(ImageOutput::create("async.tif"), 4096);
+        ImageSpec spec = A.spec();
+        if (tiled) {
+            spec.tile_width  = 16;
+            spec.tile_height = 16;
+        }
+        OIIO_CHECK_ASSERT(out.open("async.tif", spec));
+        OIIO_CHECK_ASSERT(A.write(&out));
+        OIIO_CHECK_ASSERT(out.close());
+        OIIO_CHECK_EQUAL(out.queued_bytes(), 0);
+        ImageBuf R("async.tif");
+        R.read(0, 0, true);
+        OIIO_CHECK_EQUAL(R.spec().tile_width, spec.tile_width);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+// Tests that OpenEXR output gathers scanlines and tiles written one at a
+// time, including tiles out of order, into the right places.
+void
+test_exr_batched_output()
+{
+    std::cout << "test exr batched output\n";
+    ImageBuf A(ImageSpec(97, 61, 3, TypeDesc::HALF));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    const char* orders[] = { "increasingY", "randomY" };
+    for (int tiled = 0; tiled < 3; ++tiled) {
+        ImageSpec spec = A.spec();
+        spec.attribute("compression", "zip");
+        if (tiled) {
+            spec.tile_width  = 16;
+            spec.tile_height = 16;
+            spec.attribute("openexr:lineOrder", orders[tiled - 1]);
+        }
+        auto out = ImageOutput::create("batched.exr");
+        OIIO_CHECK_ASSERT(out && out->open("batched.exr", spec));
+        size_t pixelbytes = spec.pixel_bytes();
+        if (!tiled) {
+            for (int y = 0; y < spec.height; ++y)
+                out->write_scanline(y, 0, TypeDesc::UNKNOWN,
+                                    (const char*)A.localpixels()
+                                        + y * spec.width * pixelbytes);
+        } else {
+            // Bottom row first, each row right to left
+            for (int y = (spec.height - 1) / 16 * 16; y >= 0; y -= 16) {
+                for (int x = (spec.width - 1) / 16 * 16; x >= 0; x -= 16) {
+                    ROI roi(x, std::min(x + 16, spec.width), y,
+                            std::min(y + 16, spec.height));
+                    std::vector<char> tile(roi.npixels() * pixelbytes);
+                    A.get_pixels(roi, spec.format, tile.data());
+                    out->write_tile(x, y, 0, TypeDesc::UNKNOWN, tile.data(),
+                                    AutoStride, roi.width() * pixelbytes);
+                }
+            }
+        }
+        OIIO_CHECK_ASSERT(out->close());
+        ImageBuf R("batched.exr");
+        R.read(0, 0, true);
+        OIIO_CHECK_EQUAL(R.spec().tile_width, spec.tile_width);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+// Tests that compressed zfiles, written as many gzip members, read back
+// the same as uncompressed ones.
+void
+test_zfile_compression()
+{
+    std::cout << "test zfile compression\n";
+    ImageBuf A(ImageSpec(300, 500, 1, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    for (const char* compression : { "none", "zip" }) {
+        A.specmod().attribute("compression", compression);
+        OIIO_CHECK_ASSERT(A.write("compressed.zfile"));
+        ImageBuf R("compressed.zfile");
+        R.read(0, 0, true);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+// Tests that the bulk read_native_scanlines of the simple scanline
+// formats reads the same pixels as one scanline at a time, in any order.
+void
+test_legacy_scanline_reads()
+{
+    std::cout << "test legacy format scanline reads\n";
+    ImageBuf A(ImageSpec(37, 29, 3, TypeDesc::UINT8));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    for (const char* ext : { "sgi", "rla", "bmp", "tga", "ppm", "pfm" }) {
+        std::string name = Strutil::sprintf("legacy_scanlines.%s", ext);
+        OIIO_CHECK_ASSERT(A.write(name));
+        ImageBuf R(name);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, A, 0.0f, 0.0f).nfail, 0);
+        // The ppm reader can only go forward, so stop there
+        if (!strcmp(ext, "ppm"))
+            continue;
+        auto in = ImageInput::open(name);
+        OIIO_CHECK_ASSERT(in);
+        if (!in)
+            continue;
+        const ImageSpec& spec(in->spec());
+        std::vector<float> whole(spec.image_pixels() * 3);
+        std::vector<float> rows(whole.size());
+        OIIO_CHECK_ASSERT(in->read_image(TypeDesc::FLOAT, whole.data()));
+        for (int y = spec.height - 1; y >= 0; --y)
+            OIIO_CHECK_ASSERT(in->read_scanline(y, 0, TypeDesc::FLOAT,
+                                                &rows[y * spec.width * 3]));
+        OIIO_CHECK_ASSERT(whole == rows);
+    }
+}
+
+
+
+// Tests that the frames of an animated GIF, which are composited on top
+// of the ones before, read the same whether we seek to them in order or
+// jump around.
+void
+test_gif_frame_seek()
+{
+    std::cout << "test gif frame seeking\n";
+    const int nframes = 21;
+    ImageSpec spec(32, 24, 4, TypeDesc::UINT8);
+    int fps[2] = { 10, 1 };
+    spec.attribute("FramesPerSecond", TypeRational, fps);
+    ImageBuf base(spec);
+    ImageBufAlgo::noise(base, "uniform", 0.0f, 1.0f);
+    // Make it all opaque
+    ImageBufAlgo::fill(base, { 0.0f, 0.0f, 0.0f, 1.0f },
+                       ROI(0, 32, 0, 24, 0, 1, 3, 4));
+    auto out = ImageOutput::create("animated.gif");
+    OIIO_CHECK_ASSERT(out && out->open("animated.gif", spec));
+    for (int f = 0; f < nframes; ++f) {
+        if (f)
+            out->open("animated.gif", spec, ImageOutput::AppendSubimage);
+        // A square wandering over the background, so that most of each
+        // frame is left as it was by the ones before it.
+        ImageBuf A = base;
+        ImageBufAlgo::fill(A, { 1.0f, 0.0f, 0.0f, 1.0f },
+                           ROI(f, f + 6, f / 2, f / 2 + 6));
+        A.write(out.get());
+    }
+    out->close();
+
+    auto in = ImageInput::open("animated.gif");
+    OIIO_CHECK_ASSERT(in);
+    if (!in)
+        return;
+    std::vector<std::vector<unsigned char>> frames(nframes);
+    for (int f = 0; f < nframes; ++f) {
+        frames[f].resize(spec.image_bytes());
+        OIIO_CHECK_ASSERT(in->read_image(f, 0, 0, 4, TypeDesc::UINT8,
+                                         frames[f].data()));
+    }
+    std::vector<unsigned char> buf(spec.image_bytes());
+    for (int f : { 20, 3, 17, 0, 9, 8, 16, 15, 1, 20 }) {
+        OIIO_CHECK_ASSERT(in->read_image(f, 0, 0, 4, TypeDesc::UINT8,
+                                         buf.data()));
+        OIIO_CHECK_ASSERT(buf == frames[f]);
+    }
+    OIIO_CHECK_ASSERT(!in->seek_subimage(nframes, 0));
+}
+
+
+
+// Tests that make_texture writes the same MIP levels whether or not it
+// writes them behind computing the next ones.
+void
+test_maketx_pipeline()
+{
+    std::cout << "test make_texture pipelined writes\n";
+    ImageBuf A(ImageSpec(100, 60, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    for (int pipeline : { 0, 1 }) {
+        ImageSpec configspec;
+        configspec.attribute("maketx:pipeline", pipeline);
+        configspec.attribute("maketx:filtername", "lanczos3");
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, A,
+            pipeline ? "pipelined.tx" : "unpipelined.tx", configspec));
+    }
+    for (int m = 0; m < 7; ++m) {  // 100x60 down to 1x1
+        ImageBuf P("pipelined.tx", 0, m), U("unpipelined.tx", 0, m);
+        OIIO_CHECK_ASSERT(P.read(0, m) && U.read(0, m));
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(P, U, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+// Tests that make_texture gives the same MIP levels when it streams the
+// image through a band at a time as when it makes each level in memory.
+void
+test_maketx_streaming()
+{
+    std::cout << "test make_texture streaming\n";
+    ImageBuf A(ImageSpec(150, 77, 3, TypeDesc::UINT8));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    A.write("maketx_stream_src.tif");
+    ImageBuf B("maketx_stream_src.tif");  // not read, so cached
+    for (int stream : { 0, 2 }) {
+        ImageSpec configspec;
+        configspec.attribute("maketx:stream", stream);
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, B,
+            stream ? "streamed.tx" : "unstreamed.tx", configspec));
+    }
+    for (int m = 0; m < 8; ++m) {  // 150x77 down to 1x1
+        ImageBuf S("streamed.tx", 0, m), U("unstreamed.tx", 0, m);
+        OIIO_CHECK_ASSERT(S.read(0, m) && U.read(0, m));
+        OIIO_CHECK_EQUAL(S.spec().width, U.spec().width);
+        OIIO_CHECK_EQUAL(S.spec().height, U.spec().height);
+        // Allow for the odd 8 bit value to round the other way
+        auto comp = ImageBufAlgo::compare(S, U, 1.5f / 255.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+
+// Tests that the in-memory resize make_texture uses for a lat-long
+// environment map gives the same pixels as resampling through the cache.
+void
+test_maketx_envlatl_resize()
+{
+    std::cout << "test make_texture envlatl resize\n";
+    ImageBuf A(ImageSpec(63, 31, 4, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    A.write("envlatl_src.exr");
+    ImageBuf B("envlatl_src.exr");  // not read, so cached
+    ImageSpec configspec;
+    configspec.attribute("maketx:stream", 0);
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxEnvLatl, A, "envlatl_local.exr", configspec));
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxEnvLatl, B, "envlatl_cached.exr", configspec));
+    for (int m = 0; m < 6; ++m) {
+        ImageBuf L("envlatl_local.exr", 0, m), C("envlatl_cached.exr", 0, m);
+        OIIO_CHECK_ASSERT(L.read(0, m) && C.read(0, m));
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(L, C, 0.0f, 0.0f).nfail, 0);
+    }
+}
+
+
+
+
+// Tests that make_texture_batch makes the same textures as separate
+// make_texture calls, and reports which conversions failed.
+void
+test_maketx_batch()
+{
+    std::cout << "test make_texture_batch\n";
+    std::vector<std::string> inputs, outputs;
+    for (int i = 0; i < 6; ++i) {
+        ImageBuf A(ImageSpec(40 + 7 * i, 30, 3, TypeDesc::UINT8));
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f, false, i);
+        inputs.push_back(Strutil::sprintf("batch_src%d.tif", i));
+        outputs.push_back(Strutil::sprintf("batch_out%d.tx", i));
+        A.write(inputs.back());
+    }
+    inputs.push_back("batch_missing.tif");
+    outputs.push_back("batch_missing.tx");
+    ImageSpec configspec;
+    configspec.attribute("maketx:batch_big_MB", 0);  // all one at a time
+    std::vector<bool> results;
+    std::ostringstream log;
+    OIIO_CHECK_ASSERT(!ImageBufAlgo::make_texture_batch(
+        ImageBufAlgo::MakeTxTexture, inputs, outputs, ImageSpec(), &log,
+        &results));
+    OIIO_CHECK_EQUAL(results.size(), inputs.size());
+    OIIO_CHECK_ASSERT(!results.back());
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture_batch(
+        ImageBufAlgo::MakeTxTexture,
+        std::vector<std::string>(inputs.begin(), inputs.end() - 1),
+        std::vector<std::string>(), configspec));
+    for (size_t i = 0; i + 1 < inputs.size(); ++i) {
+        OIIO_CHECK_ASSERT(results[i]);
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, inputs[i], "batch_single.tx",
+            ImageSpec()));
+        // Concurrent, sequential and default-named results all match
+        ImageBuf B(outputs[i]), S("batch_single.tx");
+        ImageBuf D(Filesystem::replace_extension(inputs[i], ".tx"));
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(B, S, 0.0f, 0.0f).nfail, 0);
+        OIIO_CHECK_EQUAL(ImageBufAlgo::compare(D, S, 0.0f, 0.0f).nfail, 0);
+    }
 }
 
 
 
+
+// Tests the decisions make_texture takes from its single analysis pass
+// over the source: opaque and monochrome detection, the average color,
+// and finding and fixing NaNs.
+void
+test_maketx_analysis()
+{
+    std::cout << "test make_texture source analysis\n";
+    ImageBuf A(ImageSpec(64, 40, 4, TypeDesc::FLOAT));
+    float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    ImageBufAlgo::fill(A, black, white, black, white);
+    ImageSpec configspec;
+    configspec.attribute("maketx:opaque_detect", 1);
+    configspec.attribute("maketx:monochrome_detect", 1);
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, A, "analysis_mono.exr", configspec));
+    ImageBuf M("analysis_mono.exr");
+    OIIO_CHECK_EQUAL(M.nchannels(), 1);
+    float avg = ImageBufAlgo::computePixelStats(A).avg[0];
+    OIIO_CHECK_EQUAL(M.spec().get_string_attribute("oiio:AverageColor"),
+                     Strutil::sprintf("%g", avg));
+
+    // A NaN fails --checknan, and is fixed by --fixnan
+    ImageBuf B(ImageSpec(64, 40, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::fill(B, { 0.5f, 0.25f, 0.125f });
+    float nanpixel[3] = { 0.5f, std::numeric_limits<float>::quiet_NaN(),
+                          0.125f };
+    B.setpixel(7, 9, nanpixel);
+    ImageSpec checkspec;
+    checkspec.attribute("maketx:checknan", 1);
+    std::ostringstream log;
+    OIIO_CHECK_ASSERT(!ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, B, "analysis_nan.exr", checkspec, &log));
+    ImageSpec fixspec;
+    fixspec.attribute("maketx:fixnan", "black");
+    fixspec.attribute("maketx:checknan", 1);
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, B, "analysis_fixed.exr", fixspec));
+    ImageBuf F("analysis_fixed.exr");
+    auto stats = ImageBufAlgo::computePixelStats(F);
+    OIIO_CHECK_EQUAL(stats.nancount[1], 0);
+    float pixel[3];
+    F.getpixel(7, 9, pixel);
+    OIIO_CHECK_EQUAL(pixel[1], 0.0f);
+}
+
+
+
+
+// Tests that make_texture records the constant tiles of each level, and
+// that the ImageCache gives the same pixels for them without reading them.
+void
+test_maketx_constant_tiles()
+{
+    std::cout << "test make_texture constant tiles\n";
+    ImageBuf A(ImageSpec(128, 96, 3, TypeDesc::UINT8));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f }, ROI(64, 128, 0, 96));
+    for (int constant_tiles : { 0, 1 }) {
+        ImageSpec configspec;
+        configspec.tile_width  = 32;
+        configspec.tile_height = 32;
+        configspec.attribute("maketx:constant_tiles", constant_tiles);
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, A,
+            constant_tiles ? "constant_tiles.tx" : "no_constant_tiles.tx",
+            configspec));
+    }
+    // The right two of each row of 4 tiles
+    ImageBuf C("constant_tiles.tx"), N("no_constant_tiles.tx");
+    OIIO_CHECK_ASSERT(Strutil::starts_with(
+        C.spec().get_string_attribute("oiio:ConstantTiles"), "128x96:2-3="));
+    OIIO_CHECK_EQUAL(N.spec().get_string_attribute("oiio:ConstantTiles"), "");
+    auto comp = ImageBufAlgo::compare(C, A, 0.0f, 0.0f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+    for (int m = 1; m < 8; ++m) {  // 64x48 down to 1x1
+        ImageBuf CM("constant_tiles.tx", 0, m);
+        ImageBuf NM("no_constant_tiles.tx", 0, m);
+        comp = ImageBufAlgo::compare(CM, NM, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// Tests make_texture writing block compressed DDS MIP chains.
+void
+test_maketx_dds()
+{
+    std::cout << "test make_texture to DDS\n";
+    ImageBuf A(ImageSpec(64, 48, 4, TypeDesc::UINT8));
+    float tl[4] = { 0.0f, 0.25f, 1.0f, 1.0f };
+    float tr[4] = { 1.0f, 0.0f, 0.5f, 1.0f };
+    float bl[4] = { 0.5f, 1.0f, 0.0f, 0.5f };
+    float br[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+    ImageBufAlgo::fill(A, tl, tr, bl, br);
+    ImageBuf G = ImageBufAlgo::channels(A, 1, { 0 });
+    for (int quality : { 10, 50, 95 }) {
+        ImageSpec configspec;
+        configspec.attribute("compression", "dxt5");
+        configspec.attribute("CompressionQuality", quality);
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, A, "maketx_bc3.dds", configspec));
+        ImageBuf D("maketx_bc3.dds");
+        OIIO_CHECK_EQUAL(D.nmiplevels(), 7);  // 64x48 down to 1x1
+        OIIO_CHECK_EQUAL(D.spec().get_string_attribute("compression"),
+                         "DXT5");
+        // A smooth gradient is about the best case for the compression
+        auto comp = ImageBufAlgo::compare(D, A, 0.05f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+    // One channel is BC4 unless asked otherwise
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, G, "maketx_bc4.dds", ImageSpec()));
+    ImageBuf D("maketx_bc4.dds");
+    OIIO_CHECK_EQUAL(D.nchannels(), 1);
+    OIIO_CHECK_EQUAL(D.spec().get_string_attribute("compression"), "ATI1");
+    auto comp = ImageBufAlgo::compare(D, G, 0.02f, 0.0f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+}
+
+
+
+// Tests that an incremental make_texture recomputes only the MIP levels'
+// tiles that depend on what changed, and gives the same texture as making
+// it in full.
+void
+test_maketx_incremental()
+{
+    std::cout << "test make_texture incremental\n";
+    ImageBuf A(ImageSpec(128, 128, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    ImageSpec configspec;
+    configspec.tile_width  = 32;
+    configspec.tile_height = 32;
+    configspec.attribute("maketx:incremental", 1);
+    configspec.attribute("maketx:verbose", 1);
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, A, "incremental.exr", configspec));
+    OIIO_CHECK_ASSERT(Filesystem::exists("incremental.exr.tilehash"));
+
+    // Change a patch within one tile, and make the texture again
+    ImageBufAlgo::fill(A, { 1.0f, 0.5f, 0.0f }, ROI(40, 50, 70, 80));
+    std::ostringstream log;
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, A, "incremental.exr", configspec, &log));
+    OIIO_CHECK_ASSERT(Strutil::contains(
+        log.str(), "Incremental update: 1 of 16 top level tiles changed"));
+    configspec.attribute("maketx:incremental", 0);
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+        ImageBufAlgo::MakeTxTexture, A, "incremental_full.exr", configspec));
+    for (int m = 0; m < 8; ++m) {  // 128x128 down to 1x1
+        ImageBuf I("incremental.exr", 0, m), F("incremental_full.exr", 0, m);
+        auto comp = ImageBufAlgo::compare(I, F, 1.0e-6f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+}
+
+
+
+// Tests make_texture's lat-long environment maps made from cube faces and
+// from a light probe.
+void
+test_maketx_envmaps()
+{
+    std::cout << "test make_texture environment maps\n";
+    // Six 16x16 faces, stacked vertically, each filled with its index
+    ImageBuf cube(ImageSpec(16, 96, 1, TypeDesc::FLOAT));
+    for (int f = 0; f < 6; ++f)
+        ImageBufAlgo::fill(cube, { float(f) }, ROI(0, 16, f * 16, f * 16 + 16));
+    ImageSpec configspec;
+    OIIO_CHECK_ASSERT(
+        ImageBufAlgo::make_texture(ImageBufAlgo::MakeTxEnvLatlFromCubeFaces,
+                                   cube, "cubefaces.exr", configspec));
+    ImageBuf L("cubefaces.exr");
+    OIIO_CHECK_EQUAL(L.spec().width, 64);
+    OIIO_CHECK_EQUAL(L.spec().height, 32);
+    OIIO_CHECK_EQUAL(L.getchannel(32, 0, 0, 0), 2.0f);   // up: +y
+    OIIO_CHECK_EQUAL(L.getchannel(32, 31, 0, 0), 3.0f);  // down: -y
+    OIIO_CHECK_EQUAL(L.getchannel(32, 16, 0, 0), 4.0f);  // center: +z
+    OIIO_CHECK_EQUAL(L.getchannel(16, 16, 0, 0), 0.0f);  // s=1/4: +x
+    OIIO_CHECK_EQUAL(L.getchannel(48, 16, 0, 0), 1.0f);  // s=3/4: -x
+
+    // A constant light probe unwraps to the same constant
+    ImageBuf probe(ImageSpec(32, 32, 3, TypeDesc::HALF));
+    ImageBufAlgo::fill(probe, { 0.25f, 0.5f, 0.75f });
+    OIIO_CHECK_ASSERT(
+        ImageBufAlgo::make_texture(ImageBufAlgo::MakeTxEnvLatlFromLightProbe,
+                                   probe, "lightprobe.exr", configspec));
+    ImageBuf P("lightprobe.exr");
+    auto stats = ImageBufAlgo::computePixelStats(P);
+    for (int c = 0; c < 3; ++c) {
+        OIIO_CHECK_EQUAL_THRESH(stats.min[c], 0.25f * (c + 1), 1.0e-6f);
+        OIIO_CHECK_EQUAL_THRESH(stats.max[c], 0.25f * (c + 1), 1.0e-6f);
+    }
+}
+
+
+
+// Tests that make_texture's MIP levels made with a named filter are those
+// that resizing each level to the next with that filter makes.
+void
+test_maketx_filtered_mips()
+{
+    std::cout << "test make_texture filtered MIP levels\n";
+    for (int nchannels : { 3, 4 }) {
+        ImageBuf A(ImageSpec(64, 32, nchannels, TypeDesc::FLOAT));
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        ImageSpec configspec;
+        configspec.attribute("maketx:filtername", "lanczos3");
+        OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(
+            ImageBufAlgo::MakeTxTexture, A, "filtered_mips.exr", configspec));
+        ImageBuf prev("filtered_mips.exr", 0, 0);
+        for (int m = 1; m < 7; ++m) {  // 32x16 down to 1x1
+            ImageBuf level("filtered_mips.exr", 0, m);
+            // Each level's own pixels are its display window
+            prev.set_full(prev.xbegin(), prev.xend(), prev.ybegin(),
+                          prev.yend(), 0, 1);
+            ImageBuf ref(ImageSpec(level.spec().width, level.spec().height,
+                                   nchannels, TypeDesc::FLOAT));
+            ImageBufAlgo::resize(ref, prev, "lanczos3");
+            auto comp = ImageBufAlgo::compare(level, ref, 1.0e-5f, 0.0f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+            prev.reset("filtered_mips.exr", 0, m);
+        }
+    }
+}
+
+
+
+// Tests ImageBufAlgo::stream_to_file, from a cache-backed input, to both
+// tiled and scanline output, and stream_to_output to a later subimage.
+void
+test_stream_to_file()
+{
+    std::cout << "test stream_to_file\n";
+    ImageSpec spec(50, 70, 3, TypeDesc::FLOAT);
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    A.write("stream_src.exr");
+    ImageBuf B("stream_src.exr");  // not read, so cached, not local
+    ImageBuf ref = ImageBufAlgo::mul(A, 0.5f);
+    for (int tile : { 0, 16 }) {
+        ImageSpec outspec = spec;
+        outspec.tile_width = outspec.tile_height = tile;
+        const char* outname = tile ? "stream_tiled.exr" : "stream_scan.exr";
+        int nbands          = 0;
+        bool ok             = ImageBufAlgo::stream_to_file(
+            outname, outspec,
+            [&](ImageBuf& dst, ROI roi) {
+                ++nbands;
+                return ImageBufAlgo::mul(dst, B, 0.5f, roi);
+            },
+            20);
+        OIIO_CHECK_ASSERT(ok);
+        OIIO_CHECK_EQUAL(nbands, tile ? 3 : 4);  // 32 or 20 row bands
+        ImageBuf R(outname);
+        auto comp = ImageBufAlgo::compare(R, ref, 0.0f, 0.0f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+    }
+
+    // stream_to_output into the second subimage of an output we manage
+    auto out = ImageOutput::create("stream_multi.exr");
+    ImageSpec specs[2] = { spec, spec };
+    OIIO_CHECK_ASSERT(out && out->open("stream_multi.exr", 2, specs));
+    OIIO_CHECK_ASSERT(A.write(out.get()));
+    OIIO_CHECK_ASSERT(out->open("stream_multi.exr", spec,
+                                ImageOutput::AppendSubimage));
+    OIIO_CHECK_ASSERT(ImageBufAlgo::stream_to_output(
+        out.get(), [&](ImageBuf& dst, ROI roi) {
+            return ImageBufAlgo::mul(dst, B, 0.5f, roi);
+        }));
+    OIIO_CHECK_ASSERT(out->close());
+    ImageBuf R("stream_multi.exr", 1, 0);
+    auto comp = ImageBufAlgo::compare(R, ref, 0.0f, 0.0f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+}
+
+
+
+// Tests that ImageBufAlgo::Expr gives the same results as the equivalent
+// sequence of individual ImageBufAlgo calls.
+void
+test_expr()
+{
+    std::cout << "test Expr\n";
+    ImageSpec spec(40, 30, 4, TypeDesc::FLOAT);
+    spec.alpha_channel = 3;
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    ColorConfig config;
+    ColorProcessorHandle cp = config.createColorProcessor("linear", "sRGB");
+    OIIO_CHECK_ASSERT(cp);
+    const float scalevals[] = { 1.5f, 1.2f, 0.8f, 1.0f };
+    const float gainvals[]  = { 2.0f, 0.5f, 1.0f, 1.0f };
+    cspan<float> scale(scalevals), gain(gainvals);
+
+    ImageBuf seq = ImageBufAlgo::unpremult(A);
+    seq = ImageBufAlgo::colorconvert(seq, cp.get(), false);
+    seq = ImageBufAlgo::mad(seq, scale, 0.05f);
+    seq = ImageBufAlgo::pow(seq, 0.9f);
+    seq = ImageBufAlgo::clamp(seq, 0.0f, 1.0f, true);
+    seq = ImageBufAlgo::premult(seq);
+
+    ImageBufAlgo::Expr expr(A);
+    expr.unpremult()
+        .colorconvert(cp, false)
+        .mad(scale, 0.05f)
+        .pow(0.9f)
+        .clamp(0.0f, 1.0f, true)
+        .premult();
+    OIIO_CHECK_EQUAL(expr.size(), 6);
+    ImageBuf fused = expr.eval();
+    OIIO_CHECK_ASSERT(!fused.has_error());
+    auto comp = ImageBufAlgo::compare(fused, seq, 1.0e-6f, 1.0e-6f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+    OIIO_CHECK_EQUAL(fused.spec().get_int_attribute("oiio:UnassociatedAlpha"),
+                     0);
+
+    // And over a sub-region, with add/sub/mul
+    ROI roi(5, 25, 3, 20, 0, 1, 0, 4);
+    seq   = ImageBufAlgo::add(A, 0.25f, roi);
+    seq   = ImageBufAlgo::mul(seq, gain);
+    seq   = ImageBufAlgo::sub(seq, 0.1f);
+    fused = ImageBufAlgo::Expr(A).add(0.25f).mul(gain).sub(0.1f).eval(roi);
+    OIIO_CHECK_EQUAL(fused.roi(), roi);
+    comp = ImageBufAlgo::compare(fused, seq, 1.0e-6f, 1.0e-6f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+}
+
+
+
+// Tests that a baked color processor approximates the one it was baked
+// from, and that 8 bit sources (which go through a table of every code
+// value) convert just as their float equivalents do.
+void
+test_colorconvert_tables()
+{
+    std::cout << "test colorconvert tables\n";
+    ImageSpec spec(64, 48, 4, TypeDesc::FLOAT);
+    spec.alpha_channel = 3;
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+    ColorConfig config;
+    ColorProcessorHandle cp = config.createColorProcessor("sRGB", "linear");
+    OIIO_CHECK_ASSERT(cp);
+    ColorProcessorHandle baked = config.createBakedProcessor(cp);
+    OIIO_CHECK_ASSERT(baked);
+    OIIO_CHECK_ASSERT(!config.createBakedProcessor(cp, 1));
+    ImageBuf exact  = ImageBufAlgo::colorconvert(A, cp.get(), false);
+    ImageBuf approx = ImageBufAlgo::colorconvert(A, baked.get(), false);
+    auto comp       = ImageBufAlgo::compare(approx, exact, 1.0e-3f, 1.0e-3f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+
+    ImageBuf A8;
+    A8.copy(A, TypeDesc::UINT8);
+    ImageBuf F;
+    F.copy(A8, TypeDesc::FLOAT);
+    ImageBuf R8(ImageSpec(64, 48, 4, TypeDesc::FLOAT));
+    ImageBuf RF(ImageSpec(64, 48, 4, TypeDesc::FLOAT));
+    ImageBufAlgo::colorconvert(R8, A8, cp.get(), false);
+    ImageBufAlgo::colorconvert(RF, F, cp.get(), false);
+    comp = ImageBufAlgo::compare(R8, RF, 1.0e-6f, 1.0e-6f);
+    OIIO_CHECK_EQUAL(comp.nfail, 0);
+}
+
+
+// Test that ColorProcessors are made once and shared, even when many
+// threads ask for them at once.
+void
+test_colorprocessor_cache()
+{
+    std::cout << "test ColorProcessor cache\n";
+    ColorConfig config;
+    ColorProcessorHandle cp = config.createColorProcessor("sRGB", "linear");
+    OIIO_CHECK_ASSERT(cp);
+    OIIO_CHECK_ASSERT(config.createColorProcessor("sRGB", "linear") == cp);
+    OIIO_CHECK_ASSERT(config.createColorProcessor("linear", "sRGB") != cp);
+
+    // Enough distinct context values to make the cache grow a few times.
+    const int nkeys = 200;
+    std::vector<ColorProcessorHandle> procs(4 * nkeys);
+    parallel_for(0, int64_t(procs.size()), [&](int64_t i) {
+        procs[i] = config.createColorProcessor("sRGB", "linear", "SHOT",
+                                               Strutil::sprintf("%d",
+                                                                i % nkeys));
+    });
+    for (size_t i = 0; i < procs.size(); ++i) {
+        OIIO_CHECK_ASSERT(procs[i]);
+        OIIO_CHECK_ASSERT(procs[i] == procs[i % nkeys]);
+        OIIO_CHECK_ASSERT(
+            procs[i]
+            == config.createColorProcessor("sRGB", "linear", "SHOT",
+                                           Strutil::sprintf("%d", i % nkeys)));
+    }
+}
+
+
+
+// Tests the "oiio:TargetColorSpace" hint, which converts the pixels as
+// they're read, both directly and through the ImageCache.
+void
+test_read_colorconvert()
+{
+    std::cout << "test read with color conversion\n";
+    for (int tile : { 0, 16 }) {
+        ImageSpec spec(64, 48, 4, TypeDesc::FLOAT);
+        spec.tile_width = spec.tile_height = tile;
+        spec.attribute("oiio:ColorSpace", "sRGB");
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write("readcolor.tif");
+        ImageBuf ref = ImageBufAlgo::colorconvert(A, "sRGB", "linear");
+
+        ImageSpec config;
+        config.attribute("oiio:TargetColorSpace", "linear");
+        for (bool force : { true, false }) {
+            ImageCache* ic = ImageCache::create(false);
+            ImageBuf R("readcolor.tif", 0, 0, ic, &config);
+            R.read(0, 0, force, TypeDesc::UNKNOWN);
+            OIIO_CHECK_ASSERT(!R.has_error());
+            OIIO_CHECK_EQUAL(R.spec().get_string_attribute("oiio:ColorSpace"),
+                             "linear");
+            OIIO_CHECK_EQUAL(ImageBufAlgo::compare(R, ref, 1.0e-6f, 1.0e-6f)
+                                 .nfail,
+                             0);
+            R.clear();
+            ImageCache::destroy(ic);
+        }
+    }
+}
+
+
 // Tests ImageBufAlgo::isConstantColor
 void
 test_isConstantColor()
@@ -732,6 +2846,36 @@ test_computePixelStats()
         OIIO_CHECK_EQUAL(stats.infcount[c], 0);
         OIIO_CHECK_EQUAL(stats.finitecount[c], 4);
     }
+
+    // A larger image with a few non-finite values, comparing the scanline
+    // path against the iterators (taken for a non-contiguous view).
+    ImageSpec spec(123, 70, 3, TypeDesc::FLOAT);
+    ImageBuf A(spec);
+    ImageBufAlgo::noise(A, "uniform", -1.0f, 1.0f, false, 1);
+    float pixel[3];
+    A.getpixel(5, 3, pixel);
+    pixel[1] = std::numeric_limits<float>::quiet_NaN();
+    A.setpixel(5, 3, pixel);
+    A.getpixel(100, 60, pixel);
+    pixel[2] = std::numeric_limits<float>::infinity();
+    A.setpixel(100, 60, pixel);
+    spec.width += 5;
+    ImageBuf Abig(spec);
+    ImageBufAlgo::paste(Abig, 0, 0, 0, 0, A);
+    ImageBufAlgo::PixelStats fast = ImageBufAlgo::computePixelStats(A);
+    ImageBufAlgo::PixelStats slow
+        = ImageBufAlgo::computePixelStats(Abig.view(A.roi()));
+    for (int c = 0; c < 3; ++c) {
+        OIIO_CHECK_EQUAL(fast.min[c], slow.min[c]);
+        OIIO_CHECK_EQUAL(fast.max[c], slow.max[c]);
+        OIIO_CHECK_EQUAL_THRESH(fast.avg[c], slow.avg[c], 1.0e-6);
+        OIIO_CHECK_EQUAL_THRESH(fast.stddev[c], slow.stddev[c], 1.0e-6);
+        OIIO_CHECK_EQUAL(fast.nancount[c], slow.nancount[c]);
+        OIIO_CHECK_EQUAL(fast.infcount[c], slow.infcount[c]);
+        OIIO_CHECK_EQUAL(fast.finitecount[c], slow.finitecount[c]);
+    }
+    OIIO_CHECK_EQUAL(fast.nancount[1], 1);
+    OIIO_CHECK_EQUAL(fast.infcount[2], 1);
 }
 
 
@@ -785,6 +2929,52 @@ histogram_computation_test()
 
 
 
+// Tests that histogram gives the same counts from 8 bit and float pixels
+// with several channels, skipping empty pixels, as counting them directly
+// does; and that color_count with a long list of colors agrees with
+// testing each pixel against each color.
+void
+test_histogram_color_count()
+{
+    std::cout << "test histogram and color_count\n";
+    ImageSpec spec(71, 53, 3, TypeDesc::UINT8);
+    ImageBuf A(spec);
+    for (ImageBuf::Iterator<unsigned char> a(A); !a.done(); ++a) {
+        a[0] = ((a.x() * 7 + a.y() * 3) % 13) / 12.0f;
+        a[1] = (a.y() % 4) / 3.0f;
+        a[2] = 0.0f;
+    }
+    ImageBuf F;
+    F.copy(A, TypeDesc::FLOAT);
+    std::vector<imagesize_t> expected(10, 0);
+    for (ImageBuf::ConstIterator<float> a(F); !a.done(); ++a)
+        if (a[0] != 0.0f || a[1] != 0.0f)
+            ++expected[std::min(int(a[0] * 10.0f), 9)];
+    auto histA = ImageBufAlgo::histogram(A, 0, 10, 0.0f, 1.0f, true);
+    auto histF = ImageBufAlgo::histogram(F, 0, 10, 0.0f, 1.0f, true);
+    for (int i = 0; i < 10; ++i) {
+        OIIO_CHECK_EQUAL(histA[i], expected[i]);
+        OIIO_CHECK_EQUAL(histF[i], expected[i]);
+    }
+
+    const int ncolors = 52;
+    std::vector<float> colors;
+    for (int i = 0; i < 13; ++i)
+        for (int j = 0; j < 4; ++j)
+            colors.insert(colors.end(), { i / 12.0f, j / 3.0f, 0.0f });
+    std::vector<imagesize_t> count(ncolors);
+    OIIO_CHECK_ASSERT(
+        ImageBufAlgo::color_count(F, count.data(), ncolors, colors));
+    for (int col = 0; col < ncolors; ++col) {
+        imagesize_t n = 0;
+        for (ImageBuf::ConstIterator<float> a(F); !a.done(); ++a)
+            n += (fabsf(a[0] - colors[3 * col]) <= 0.001f
+                  && fabsf(a[1] - colors[3 * col + 1]) <= 0.001f);
+        OIIO_CHECK_EQUAL(count[col], n);
+    }
+}
+
+
 // Test ability to do a maketx directly from an ImageBuf
 void
 test_maketx_from_imagebuf()
@@ -901,6 +3091,38 @@ test_IBAprep()
 
 
 
+// Tests that adaptive parallel_image covers every pixel exactly once, and
+// that its tasks don't straddle the requested tile grid.
+void
+test_parallel_image_adaptive()
+{
+    std::cout << "test adaptive parallel_image\n";
+    ROI roi(3, 203, -5, 95);
+    ImageBufAlgo::parallel_image_options opt(0, Split_Y, 1);
+    opt.adaptive    = true;
+    opt.tile_width  = 16;
+    opt.tile_height = 16;
+    std::vector<std::atomic<int>> visits(roi.npixels());
+    for (auto& v : visits)
+        v = 0;
+    std::atomic<int> straddles(0);
+    ImageBufAlgo::parallel_image(roi, opt, [&](ROI r) {
+        if ((r.xbegin >> 6) != ((r.xend - 1) >> 6)
+            || (r.ybegin >> 6) != ((r.yend - 1) >> 6))
+            ++straddles;
+        for (int y = r.ybegin; y < r.yend; ++y)
+            for (int x = r.xbegin; x < r.xend; ++x)
+                visits[(y - roi.ybegin) * roi.width() + x - roi.xbegin] += 1;
+    });
+    OIIO_CHECK_EQUAL(straddles, 0);
+    OIIO_CHECK_ASSERT(std::all_of(visits.begin(), visits.end(),
+                                  [](const std::atomic<int>& v) {
+                                      return v == 1;
+                                  }));
+}
+
+
+
 void
 benchmark_parallel_image(int res, int iters)
 {
@@ -979,19 +3201,78 @@ main(int argc, char** argv)
     test_crop();
     test_paste();
     test_channel_append();
+    test_channels();
     test_add();
     test_sub();
     test_mul();
     test_mad();
+    test_simd_rows();
     test_over();
+    test_over_rows();
+    test_orient();
+    test_transpose_fft();
     test_compare();
+    test_resize();
+    test_warp();
+    test_convolve();
+    test_median_filter();
+    test_dilate_erode();
+    test_fillholes_pushpull();
+    test_deep_merge_holdout();
+    test_deepdata_planar();
+    test_deepdata_growth();
+    test_flatten();
+    test_render_text();
+    test_noise();
+    test_unsharp_mask();
+    test_resample_integer_ratio();
+    test_computePixelHash();
+    test_stencil_tiles();
+    test_tiff_parallel_tiles();
+    test_tiff_lzw_packbits();
+    test_read_native_subimages();
+    test_exr_strided_read();
+    test_copy_image_raw();
+    test_jpeg_scale();
+    test_jpeg_scanlines();
+    test_png_multithread();
+    test_dpx_10bit_read();
+    test_jpeg2000_levels();
+    test_webp_channels();
+    test_hdr_rle();
+    test_dds_blocks();
+    test_fits_read();
+    test_format_by_signature();
+    test_plugin_catalog();
+    test_async_output();
+    test_exr_batched_output();
+    test_zfile_compression();
+    test_legacy_scanline_reads();
+    test_gif_frame_seek();
+    test_maketx_pipeline();
+    test_maketx_streaming();
+    test_maketx_envlatl_resize();
+    test_maketx_batch();
+    test_maketx_analysis();
+    test_maketx_constant_tiles();
+    test_maketx_dds();
+    test_maketx_incremental();
+    test_maketx_envmaps();
+    test_maketx_filtered_mips();
+    test_stream_to_file();
+    test_expr();
+    test_colorconvert_tables();
+    test_colorprocessor_cache();
+    test_read_colorconvert();
     test_isConstantColor();
     test_isConstantChannel();
     test_isMonochrome();
     test_computePixelStats();
     histogram_computation_test();
+    test_histogram_color_count();
     test_maketx_from_imagebuf();
     test_IBAprep();
+    test_parallel_image_adaptive();
 
     benchmark_parallel_image(64, iterations * 64);
     benchmark_parallel_image(512, iterations * 16);
@@ -36,8 +36,11 @@
 #include <OpenEXR/ImathMatrix.h>
 #include <OpenEXR/half.h>
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "imageio_pvt.h"
 #include <OpenImageIO/dassert.h>
@@ -45,6 +48,7 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 
 OIIO_NAMESPACE_BEGIN
@@ -162,7 +166,7 @@ transform(const Imath::M33f& M, ROI roi)
 template<typename SRCTYPE>
 inline void
 filtered_sample(const ImageBuf& src, float s, float t, float dsdx, float dtdx,
-                float dsdy, float dtdy, const Filter2D* filter,
+                float dsdy, float dtdy, const FilterTable* filter,
                 ImageBuf::WrapMode wrap, float* result)
 {
     DASSERT(filter);
@@ -197,13 +201,76 @@ filtered_sample(const ImageBuf& src, float s, float t, float dsdx, float dtdx,
             result[c] = 0.0f;
 }
 
+
+
+// Like filtered_sample, for a separable filter and a source whose local
+// pixels cover the whole filter footprint. The filter is evaluated once per
+// column and once per row of taps rather than once per tap, and the pixels
+// are read directly rather than through an iterator. The weights and sums
+// are formed in the same order as filtered_sample, so the results are
+// identical. Return false (and do nothing) if the footprint isn't entirely
+// within the source's local pixels.
+template<typename SRCTYPE>
+inline bool
+filtered_sample_separable(const ImageBuf& src, float s, float t, float dsdx,
+                          float dtdx, float dsdy, float dtdy,
+                          const FilterTable* filter, std::vector<float>& xw,
+                          std::vector<float>& yw, float* result)
+{
+    DASSERT(filter && filter->separable() && src.localpixels());
+    float ds          = std::max(1.0f, std::max(fabsf(dsdx), fabsf(dsdy)));
+    float dt          = std::max(1.0f, std::max(fabsf(dtdx), fabsf(dtdy)));
+    float ds_inv      = 1.0f / ds;
+    float dt_inv      = 1.0f / dt;
+    float filterrad_s = 0.5f * ds * filter->width();
+    float filterrad_t = 0.5f * dt * filter->width();
+    int xbegin        = (int)floorf(s - filterrad_s);
+    int xend          = (int)ceilf(s + filterrad_s);
+    int ybegin        = (int)floorf(t - filterrad_t);
+    int yend          = (int)ceilf(t + filterrad_t);
+    if (xbegin < src.xbegin() || xend > src.xend() || ybegin < src.ybegin()
+        || yend > src.yend() || src.zbegin() > 0 || src.zend() < 1)
+        return false;
+
+    int nx = xend - xbegin, ny = yend - ybegin;
+    xw.resize(std::max(nx, 0));
+    yw.resize(std::max(ny, 0));
+    for (int i = 0; i < nx; ++i)
+        xw[i] = filter->xfilt(ds_inv * ((xbegin + i) + 0.5f - s));
+    for (int j = 0; j < ny; ++j)
+        yw[j] = filter->yfilt(dt_inv * ((ybegin + j) + 0.5f - t));
+
+    int nc     = src.nchannels();
+    float* sum = ALLOCA(float, nc);
+    memset(sum, 0, nc * sizeof(float));
+    float total_w    = 0.0f;
+    stride_t xstride = src.pixel_stride();
+    for (int j = 0; j < ny; ++j) {
+        const char* p = (const char*)src.pixeladdr(xbegin, ybegin + j, 0);
+        for (int i = 0; i < nx; ++i, p += xstride) {
+            float w          = xw[i] * yw[j];
+            const SRCTYPE* v = (const SRCTYPE*)p;
+            for (int c = 0; c < nc; ++c)
+                sum[c] += w * convert_type<SRCTYPE, float>(v[c]);
+            total_w += w;
+        }
+    }
+    if (total_w != 0.0f)
+        for (int c = 0; c < nc; ++c)
+            result[c] = sum[c] / total_w;
+    else
+        for (int c = 0; c < nc; ++c)
+            result[c] = 0.0f;
+    return true;
+}
+
 }  // namespace
 
 
 
 template<typename DSTTYPE, typename SRCTYPE>
 static bool
-resize_(ImageBuf& dst, const ImageBuf& src, Filter2D* filter, ROI roi,
+resize_(ImageBuf& dst, const ImageBuf& src, const FilterTable* filter, ROI roi,
         int nthreads)
 {
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
@@ -276,28 +343,183 @@ resize_(ImageBuf& dst, const ImageBuf& src, Filter2D* filter, ROI roi,
     std::cerr << "Resizing " << srcspec.full_width << "x" << srcspec.full_height
               << " to " << dstspec.full_width << "x" << dstspec.full_height << "\n";
     std::cerr << "ratios = " << xratio << ", " << yratio << "\n";
-    std::cerr << "examining src filter " << filter->name()
+    std::cerr << "examining src filter " << filter->filter()->name()
               << " support radius of " << radi << " x " << radj << " pixels\n";
     std::cout << "  " << xtaps << "x" << ytaps << " filter taps\n";
     std::cerr << "dst range " << roi << "\n";
     std::cerr << "separable filter\n";
 #endif
 
-#define USE_SPECIAL 0
-#if USE_SPECIAL
-        // Special case: src and dst are local memory, float buffers, and we're
-        // operating on all channels, <= 4.
-        bool special
-            = ((is_same<DSTTYPE, float>::value || is_same<DSTTYPE, half>::value)
-               && (is_same<SRCTYPE, float>::value
-                   || is_same<SRCTYPE, half>::value)
-               // && dst.localpixels() // has to be, because it's writeable
-               && src.localpixels()
-               // && R.contains_roi(roi)  // has to be, because IBAPrep
-               && src.contains_roi(roi) && roi.chbegin == 0
-               && roi.chend == dst.nchannels() && roi.chend == src.nchannels()
-               && roi.chend <= 4 && separable);
-#endif
+        // Special case: src and dst are local memory, the filter is
+        // separable, we're operating on all channels, and the image is 2D.
+        // Then we resize in two passes over contiguous rows: each source
+        // row that is needed is filtered horizontally just once, into a
+        // ring of ytaps rows, and each output row is the weighted sum of
+        // the ring's rows. For up to 4 channels, each pixel is one vfloat4.
+        bool special = (separable && src.localpixels() && dst.localpixels()
+                        && roi.chbegin == 0 && roi.chend == nchannels
+                        && src.nchannels() == nchannels && roi.zbegin == 0
+                        && roi.zend == 1 && srcspec.depth == 1);
+        if (special) {
+            using simd::vfloat4;
+            const bool vec    = (nchannels <= 4);
+            const int pstride = vec ? 4 : nchannels;  // floats per pixel
+            const int width   = roi.width();
+            // When the source is an exact integer multiple of the output
+            // size in a direction, every output pixel in it sits at the
+            // same offset within its source pixel, k/2 pixels into its
+            // k-pixel block, so one set of fixed taps serves all columns
+            // (or rows), and the source positions are exact integers.
+            int kx = srcspec.full_width / dstspec.full_width;
+            int ky = srcspec.full_height / dstspec.full_height;
+            bool xfixed = (kx >= 1 && kx * dstspec.full_width == srcfw);
+            bool yfixed = (ky >= 1 && ky * dstspec.full_height == srcfh);
+            // Set up the fixed taps for an output pixel whose sample
+            // position has fractional part frac, returning false if all
+            // its weights are zero.
+            auto fixed_taps = [&](float frac, float ratio, int rad, int taps,
+                                  float* w, bool y) {
+                float total = 0.0f;
+                for (int i = 0; i < taps; ++i) {
+                    float d = ratio * (i - rad - (frac - 0.5f));
+                    w[i]    = y ? filter->yfilt(d) : filter->xfilt(d);
+                    total += w[i];
+                }
+                if (total != 0.0f)
+                    for (int i = 0; i < taps; ++i)
+                        w[i] /= total;
+                return total != 0.0f;
+            };
+            if (xfixed)
+                fixed_taps((kx & 1) * 0.5f, xratio, radi, xtaps, xfiltval_all,
+                           false);
+            const int xwstride = xfixed ? 0 : xtaps;
+            bool yfixed_nonzero = yfixed
+                                  && fixed_taps((ky & 1) * 0.5f, yratio, radj,
+                                                ytaps, yfiltval, true);
+
+            // First (unclamped) source x under the taps of each output
+            // column, then turned into its offset in srcrow.
+            int* xfirst = ALLOCA(int, width);
+            for (int x = roi.xbegin; x < roi.xend; ++x) {
+                float s = (x - dstfx + 0.5f) * dstpixelwidth;
+                xfirst[x - roi.xbegin]
+                    = (xfixed ? srcspec.full_x + (x - dstspec.full_x) * kx
+                                    + kx / 2
+                              : ifloor(srcfx + s * srcfw))
+                      - radi;
+            }
+            const int x0    = xfirst[0];
+            const int nsrcx = xfirst[width - 1] + xtaps - x0;
+            for (int i = 0; i < width; ++i)
+                xfirst[i] = (xfirst[i] - x0) * pstride;
+            std::unique_ptr<float[]> srcrow(new float[size_t(nsrcx) * pstride]);
+            std::unique_ptr<float[]> ring(
+                new float[size_t(ytaps) * width * pstride]);
+            // Unclamped source row held in each ring slot
+            int* ringrow = ALLOCA(int, ytaps);
+            for (int j = 0; j < ytaps; ++j)
+                ringrow[j] = std::numeric_limits<int>::min();
+            const float** hrows = ALLOCA(const float*, ytaps);
+            const int srcxlast  = srcspec.x + srcspec.width - 1;
+            const int srcylast  = srcspec.y + srcspec.height - 1;
+            const stride_t srcpixstride = src.pixel_stride();
+            const stride_t dstpixstride = dst.pixel_stride();
+
+            // Filter source row r (clamped to the data window, like
+            // WrapClamp) horizontally into the given ring row.
+            auto filter_row = [&](int r, float* hrow) {
+                const char* srcline = (const char*)src.pixeladdr(
+                    srcspec.x, clamp(r, srcspec.y, srcylast));
+                for (int i = 0; i < nsrcx; ++i) {
+                    int rx           = clamp(x0 + i, srcspec.x, srcxlast);
+                    const SRCTYPE* p = (const SRCTYPE*)(
+                        srcline + (rx - srcspec.x) * srcpixstride);
+                    float* f = srcrow.get() + size_t(i) * pstride;
+                    for (int c = 0; c < nchannels; ++c)
+                        f[c] = convert_type<SRCTYPE, float>(p[c]);
+                    for (int c = nchannels; c < pstride; ++c)
+                        f[c] = 0.0f;
+                }
+                for (int x = 0; x < width; ++x) {
+                    const float* xw = xfiltval_all + x * xwstride;
+                    const float* sp = srcrow.get() + xfirst[x];
+                    float* h        = hrow + size_t(x) * pstride;
+                    if (vec) {
+                        vfloat4 sum = vfloat4::Zero();
+                        for (int i = 0; i < xtaps; ++i, sp += 4)
+                            sum += xw[i] * vfloat4(sp);
+                        sum.store(h);
+                    } else {
+                        for (int c = 0; c < nchannels; ++c)
+                            h[c] = 0.0f;
+                        for (int i = 0; i < xtaps; ++i, sp += pstride)
+                            for (int c = 0; c < nchannels; ++c)
+                                h[c] += xw[i] * sp[c];
+                    }
+                }
+            };
+
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                int src_y;
+                float totalweight_y = 0.0f;
+                if (yfixed) {
+                    src_y = srcspec.full_y + (y - dstspec.full_y) * ky + ky / 2;
+                    totalweight_y = yfixed_nonzero ? 1.0f : 0.0f;
+                } else {
+                    float t      = (y - dstfy + 0.5f) * dstpixelheight;
+                    float src_yf = srcfy + t * srcfh;
+                    float src_yf_frac = floorfrac(src_yf, &src_y);
+                    for (int j = 0; j < ytaps; ++j) {
+                        float w = filter->yfilt(
+                            yratio * (j - radj - (src_yf_frac - 0.5f)));
+                        yfiltval[j] = w;
+                        totalweight_y += w;
+                    }
+                    if (totalweight_y != 0.0f)
+                        for (int j = 0; j < ytaps; ++j)
+                            yfiltval[j] /= totalweight_y;
+                }
+                // Make sure the ring holds the rows of all the nonzero taps
+                for (int j = 0; j < ytaps; ++j) {
+                    int r    = src_y - radj + j;
+                    int slot = ((r % ytaps) + ytaps) % ytaps;
+                    float* h = ring.get() + size_t(slot) * width * pstride;
+                    if (yfiltval[j] != 0.0f && ringrow[slot] != r) {
+                        filter_row(r, h);
+                        ringrow[slot] = r;
+                    }
+                    hrows[j] = h;
+                }
+                char* dstline = (char*)dst.pixeladdr(roi.xbegin, y);
+                for (int x = 0; x < width; ++x) {
+                    DSTTYPE* d = (DSTTYPE*)(dstline + x * dstpixstride);
+                    size_t off = size_t(x) * pstride;
+                    OIIO_SIMD4_ALIGN float sum4[4] = { 0, 0, 0, 0 };
+                    float* sum = vec ? sum4 : pel;
+                    if (totalweight_y == 0.0f) {
+                        for (int c = 0; c < nchannels; ++c)
+                            sum[c] = 0.0f;  // zero it out
+                    } else if (vec) {
+                        vfloat4 s4 = vfloat4::Zero();
+                        for (int j = 0; j < ytaps; ++j)
+                            if (yfiltval[j] != 0.0f)
+                                s4 += yfiltval[j] * vfloat4(hrows[j] + off);
+                        s4.store(sum4);
+                    } else {
+                        for (int c = 0; c < nchannels; ++c)
+                            sum[c] = 0.0f;
+                        for (int j = 0; j < ytaps; ++j)
+                            if (yfiltval[j] != 0.0f)
+                                for (int c = 0; c < nchannels; ++c)
+                                    sum[c] += yfiltval[j] * hrows[j][off + c];
+                    }
+                    for (int c = 0; c < nchannels; ++c)
+                        d[c] = convert_type<float, DSTTYPE>(sum[c]);
+                }
+            }
+            return;
+        }
 
         // We're going to loop over all output pixels we're interested in.
         //
@@ -492,9 +714,12 @@ ImageBufAlgo::resize(ImageBuf& dst, const ImageBuf& src, Filter2D* filter,
         filterptr.reset(filter);
     }
 
+    // Look the weights up in tables, rather than calling the filter for
+    // each tap.
+    FilterTable table(*filter);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "resize", resize_, dst.spec().format,
-                                src.spec().format, dst, src, filter, roi,
+                                src.spec().format, dst, src, &table, roi,
                                 nthreads);
     return ok;
 }
@@ -781,6 +1006,101 @@ resample_(ImageBuf& dst, const ImageBuf& src, bool interpolate, ROI roi,
 
 
 
+// If src's full window is exactly kx by ky times the size of dst's, and
+// the source pixels that resample_ would read for roi all lie in src's
+// data window, return true and store the ratios in kx, ky.
+static bool
+resample_integer_ratio(const ImageBuf& dst, const ImageBuf& src,
+                       bool interpolate, ROI roi, int& kx, int& ky)
+{
+    const ImageSpec& srcspec(src.spec());
+    const ImageSpec& dstspec(dst.spec());
+    if (dstspec.full_width < 1 || dstspec.full_height < 1
+        || srcspec.full_width % dstspec.full_width
+        || srcspec.full_height % dstspec.full_height)
+        return false;
+    kx     = srcspec.full_width / dstspec.full_width;
+    ky     = srcspec.full_height / dstspec.full_height;
+    int nx = (interpolate && !(kx & 1)) ? 2 : 1;
+    int ny = (interpolate && !(ky & 1)) ? 2 : 1;
+    int x0 = srcspec.full_x + (roi.xbegin - dstspec.full_x) * kx + kx / 2;
+    int y0 = srcspec.full_y + (roi.ybegin - dstspec.full_y) * ky + ky / 2;
+    ROI need(x0 - nx + 1, x0 + (roi.width() - 1) * kx + 1, y0 - ny + 1,
+             y0 + (roi.height() - 1) * ky + 1, 0, 1, 0, src.nchannels());
+    return roi_intersection(need, src.roi()) == need;
+}
+
+
+
+// Resample by the integer ratios kx, ky. Each output pixel is the source
+// pixel at its center or, when interpolating across an even ratio, the
+// bilinear blend of the 2 (or 2x2) pixels around its center, which is an
+// equal-weight average. So each output row is computed by adding its
+// source row pair over the whole row span (one row added to itself when
+// there's no pair), then adding pixel pairs within that sum and
+// dividing by four. Float sources do the row pass four values at a time;
+// 8-bit to 8-bit stays in integers, rounding to nearest.
+template<typename DSTTYPE, typename SRCTYPE>
+static bool
+resample_int_(ImageBuf& dst, const ImageBuf& src, bool interpolate, int kx,
+              int ky, ROI roi, int nthreads)
+{
+    using simd::vfloat4;
+    const bool fixed8 = std::is_same<SRCTYPE, unsigned char>::value
+                        && std::is_same<DSTTYPE, unsigned char>::value;
+    const ImageSpec& srcspec(src.spec());
+    const ImageSpec& dstspec(dst.spec());
+    int nx = (interpolate && !(kx & 1)) ? 2 : 1;
+    int ny = (interpolate && !(ky & 1)) ? 2 : 1;
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nc   = srcspec.nchannels;
+        int w    = roi.width();
+        size_t n = size_t((w - 1) * kx + nx) * nc;  // values in a row span
+        std::vector<float> line(fixed8 ? 0 : n);
+        std::vector<int> iline(fixed8 ? n : 0);
+        int sx = srcspec.full_x + (roi.xbegin - dstspec.full_x) * kx + kx / 2
+                 - (nx - 1);
+        stride_t dstride = dst.pixel_stride();
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            int sy = srcspec.full_y + (y - dstspec.full_y) * ky + ky / 2
+                     - (ny - 1);
+            const SRCTYPE* r0 = (const SRCTYPE*)src.pixeladdr(sx, sy);
+            const SRCTYPE* r1 = (const SRCTYPE*)src.pixeladdr(sx,
+                                                              sy + ny - 1);
+            size_t i = 0;
+            if (fixed8) {
+                for (; i < n; ++i)
+                    iline[i] = int(r0[i]) + int(r1[i]);
+            } else if (std::is_same<SRCTYPE, float>::value) {
+                const float *f0 = (const float*)r0, *f1 = (const float*)r1;
+                for (; i + 4 <= n; i += 4)
+                    (vfloat4(f0 + i) + vfloat4(f1 + i)).store(&line[i]);
+            }
+            for (; i < n; ++i)
+                line[i] = convert_type<SRCTYPE, float>(r0[i])
+                          + convert_type<SRCTYPE, float>(r1[i]);
+
+            char* d = (char*)dst.pixeladdr(roi.xbegin, y);
+            for (int x = 0; x < w; ++x, d += dstride) {
+                DSTTYPE* out = (DSTTYPE*)d;
+                size_t a = size_t(x) * kx * nc, b = a + (nx - 1) * nc;
+                if (fixed8) {
+                    for (int c = roi.chbegin; c < roi.chend; ++c)
+                        out[c] = DSTTYPE((iline[a + c] + iline[b + c] + 2)
+                                         >> 2);
+                } else {
+                    for (int c = roi.chbegin; c < roi.chend; ++c)
+                        out[c] = convert_type<float, DSTTYPE>(
+                            0.25f * (line[a + c] + line[b + c]));
+                }
+            }
+        }
+    });
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::resample(ImageBuf& dst, const ImageBuf& src, bool interpolate,
                        ROI roi, int nthreads)
@@ -816,6 +1136,14 @@ ImageBufAlgo::resample(ImageBuf& dst, const ImageBuf& src, bool interpolate,
     }
 
     bool ok;
+    int kx, ky;
+    if (!dst.deep() && src.contiguous() && dst.localpixels()
+        && resample_integer_ratio(dst, src, interpolate, roi, kx, ky)) {
+        OIIO_DISPATCH_COMMON_TYPES2(ok, "resample", resample_int_,
+                                    dst.spec().format, src.spec().format, dst,
+                                    src, interpolate, kx, ky, roi, nthreads);
+        return ok;
+    }
     OIIO_DISPATCH_COMMON_TYPES2(ok, "resample", resample_, dst.spec().format,
                                 src.spec().format, dst, src, interpolate, roi,
                                 nthreads);
@@ -863,22 +1191,43 @@ affine_resample_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &Minv,
 template<typename DSTTYPE, typename SRCTYPE>
 static bool
 warp_(ImageBuf& dst, const ImageBuf& src, const Imath::M33f& M,
-      const Filter2D* filter, ImageBuf::WrapMode wrap, ROI roi, int nthreads)
+      const FilterTable* filter, ImageBuf::WrapMode wrap, ROI roi,
+      int nthreads)
 {
-    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        int nc     = dst.nchannels();
+    // The filter footprint, and so the cost, varies across the image.
+    auto opt = ImageBufAlgo::adaptive_options(nthreads);
+    bool direct = filter->separable() && src.localpixels();
+    ImageBufAlgo::parallel_image(roi, opt, [&](ROI roi) {
+        int nc     = src.nchannels();
         float* pel = ALLOCA(float, nc);
         memset(pel, 0, nc * sizeof(float));
         Imath::M33f Minv = M.inverse();
-        ImageBuf::Iterator<DSTTYPE> out(dst, roi);
-        for (; !out.done(); ++out) {
-            Dual2 x(out.x() + 0.5f, 1.0f, 0.0f);
-            Dual2 y(out.y() + 0.5f, 0.0f, 1.0f);
-            robust_multVecMatrix(Minv, x, y, x, y);
-            filtered_sample<SRCTYPE>(src, x.val(), y.val(), x.dx(), y.dx(),
-                                     x.dy(), y.dy(), filter, wrap, pel);
-            for (int c = roi.chbegin; c < roi.chend; ++c)
-                out[c] = pel[c];
+        std::vector<float> xw, yw;
+        // Visit the destination in small tiles rather than whole scanlines.
+        // For a rotation, the source footprint of a tile is then a compact
+        // region that stays in cache, instead of a long diagonal band.
+        const int tilesize = 32;
+        for (int ty = roi.ybegin; ty < roi.yend; ty += tilesize) {
+            for (int tx = roi.xbegin; tx < roi.xend; tx += tilesize) {
+                ROI tile(tx, std::min(tx + tilesize, roi.xend), ty,
+                         std::min(ty + tilesize, roi.yend), roi.zbegin,
+                         roi.zend, roi.chbegin, roi.chend);
+                ImageBuf::Iterator<DSTTYPE> out(dst, tile);
+                for (; !out.done(); ++out) {
+                    Dual2 x(out.x() + 0.5f, 1.0f, 0.0f);
+                    Dual2 y(out.y() + 0.5f, 0.0f, 1.0f);
+                    robust_multVecMatrix(Minv, x, y, x, y);
+                    if (!direct
+                        || !filtered_sample_separable<SRCTYPE>(
+                               src, x.val(), y.val(), x.dx(), y.dx(), x.dy(),
+                               y.dy(), filter, xw, yw, pel))
+                        filtered_sample<SRCTYPE>(src, x.val(), y.val(),
+                                                 x.dx(), y.dx(), x.dy(),
+                                                 y.dy(), filter, wrap, pel);
+                    for (int c = roi.chbegin; c < roi.chend; ++c)
+                        out[c] = pel[c];
+                }
+            }
         }
     });
     return true;
@@ -918,9 +1267,10 @@ ImageBufAlgo::warp(ImageBuf& dst, const ImageBuf& src, const Imath::M33f& M,
         filter = filterptr.get();
     }
 
+    FilterTable table(*filter);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2(ok, "warp", warp_, dst.spec().format,
-                                src.spec().format, dst, src, M, filter, wrap,
+                                src.spec().format, dst, src, M, &table, wrap,
                                 dst_roi, nthreads);
     return ok;
 }
@@ -29,13 +29,18 @@
 */
 
 
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/texture.h>
 #include <OpenImageIO/unittest.h>
 
 #include <iostream>
+#include <set>
 
 using namespace OIIO;
 
@@ -160,6 +165,1194 @@ test_app_buffer()
 
 
 
+// Test that prefetch_tiles() brings tiles into the cache, both
+// synchronously and through the background prefetch threads.
+void
+test_prefetch(int prefetch_threads)
+{
+    std::cout << "\nTesting IC prefetch_tiles with " << prefetch_threads
+              << " prefetch threads\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("prefetch_threads", prefetch_threads);
+
+    // Create a 128x128 file with 64x64 tiles
+    ustring filename("prefetch.tif");
+    ImageSpec spec(128, 128, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    const float pixelvalue[3] = { 0.25f, 0.5f, 0.75f };
+    ImageBufAlgo::fill(A, pixelvalue);
+    A.write(filename);
+
+    // Prefetch the top two tiles, then the whole image
+    OIIO_CHECK_ASSERT(imagecache->prefetch_tiles(filename, 0, 0,
+                                                 ROI(0, 128, 0, 10)));
+    OIIO_CHECK_ASSERT(imagecache->prefetch_tiles(filename, 0, 0));
+    // Asking for a nonexistant MIP level is an error
+    OIIO_CHECK_ASSERT(!imagecache->prefetch_tiles(filename, 0, 1));
+    OIIO_CHECK_ASSERT(imagecache->geterror().size());
+
+    // Invalidation waits for in-flight prefetches, so afterwards the
+    // prefetch stats are final. With background threads, a tile still
+    // being read by the first request may be queued again by the second.
+    imagecache->invalidate(filename);
+    long long requests = 0, tiles = 0;
+    imagecache->getattribute("stat:prefetch_requests", TypeDesc::INT64,
+                             &requests);
+    imagecache->getattribute("stat:prefetch_tiles", TypeDesc::INT64, &tiles);
+    OIIO_CHECK_EQUAL(tiles, 4);
+    OIIO_CHECK_ASSERT(requests >= tiles);
+
+    // After prefetching again, the pixels are in the cache and correct
+    OIIO_CHECK_ASSERT(imagecache->prefetch_tiles(filename, 0, 0));
+    float p[3] = { -1, -1, -1 };
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 100, 101, 100,
+                                             101, 0, 1, 0, 3, TypeDesc::FLOAT,
+                                             p));
+    for (int c = 0; c < 3; ++c)
+        OIIO_CHECK_EQUAL(p[c], pixelvalue[c]);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Read an image bigger than the cache through the "segmented" eviction
+// policy and make sure the memory limit holds and the pixels survive.
+void
+test_tile_eviction()
+{
+    std::cout << "\nTesting IC segmented tile eviction\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    OIIO_CHECK_ASSERT(!imagecache->attribute("tile_eviction", "bogus"));
+    OIIO_CHECK_ASSERT(imagecache->geterror().size());
+    OIIO_CHECK_ASSERT(imagecache->attribute("tile_eviction", "segmented"));
+    std::string policy;
+    imagecache->getattribute("tile_eviction", policy);
+    OIIO_CHECK_EQUAL(policy, "segmented");
+    imagecache->attribute("max_memory_MB", 10.0f);
+
+    // A 12 MB float image in 64x64 tiles
+    ustring filename("eviction.tif");
+    ImageSpec spec(1024, 1024, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f },
+                       { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    std::vector<float> pixels(1024 * 1024 * 3);
+    for (int pass = 0; pass < 2; ++pass) {
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 1024, 0,
+                                                 1024, 0, 1, TypeDesc::FLOAT,
+                                                 pixels.data()));
+        long long mem = 0;
+        imagecache->getattribute("stat:cache_memory_used", TypeDesc::INT64,
+                                 &mem);
+        // Allow for the tiles still held by the microcache
+        OIIO_CHECK_ASSERT(mem <= 11 * 1024 * 1024);
+    }
+    float p[3];
+    A.getpixel(1000, 1000, p);
+    OIIO_CHECK_EQUAL(pixels[(1000 * 1024 + 1000) * 3 + 0], p[0]);
+    OIIO_CHECK_EQUAL(pixels[(1000 * 1024 + 1000) * 3 + 1], p[1]);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Read tiles of one file from several threads with a pool of
+// ImageInputs, and check that the pixels are right and the pool stays
+// within bounds.
+void
+test_input_pool()
+{
+    std::cout << "\nTesting IC pool of ImageInputs per file\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_inputs_per_file", 3);
+
+    ustring filename("inputpool.tif");
+    ImageSpec spec(256, 256, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 0.0f }, { 1.0f });
+    A.write(filename);
+
+    atomic_int nbad(0);
+    parallel_for(0, 16, [&](int64_t row) {
+        int y = int(row) * 16;
+        std::vector<float> p(256 * 16);
+        if (!imagecache->get_pixels(filename, 0, 0, 0, 256, y, y + 16, 0, 1,
+                                    TypeDesc::FLOAT, p.data()))
+            ++nbad;
+        for (int x = 0; x < 256; x += 37)
+            if (p[x] != A.getchannel(x, y, 0, 0))
+                ++nbad;
+    });
+    OIIO_CHECK_EQUAL(nbad, 0);
+    int peak = 0;
+    imagecache->getattribute("stat:open_files_peak", peak);
+    OIIO_CHECK_ASSERT(peak >= 1 && peak <= 3);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+
+void
+test_compressed_tier()
+{
+    std::cout << "\nTesting IC compressed tile tier\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 1.0f);
+    imagecache->attribute("max_compressed_memory_MB", 64.0f);
+
+    // A smooth image that is several times the size of the main cache
+    ustring filename("compressedtier.tif");
+    ImageSpec spec(1024, 1024, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.5f }, { 1.0f, 0.0f, 0.5f },
+                       { 0.0f, 1.0f, 0.5f }, { 1.0f, 1.0f, 0.5f });
+    A.write(filename);
+
+    // Read it all twice. The second pass should find most of the tiles
+    // in the compressed tier, and get the very same pixels.
+    std::vector<float> p(1024 * 1024 * 3);
+    for (int pass = 0; pass < 2; ++pass) {
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 1024, 0,
+                                                 1024, 0, 1, TypeDesc::FLOAT,
+                                                 p.data()));
+        int nbad = 0;
+        for (int y = 0; y < 1024; y += 31)
+            for (int x = 0; x < 1024; x += 29)
+                for (int c = 0; c < 3; ++c)
+                    if (p[(y * 1024 + x) * 3 + c] != A.getchannel(x, y, 0, c))
+                        ++nbad;
+        OIIO_CHECK_EQUAL(nbad, 0);
+    }
+    long long stored = 0, hits = 0, cmem = 0;
+    imagecache->getattribute("stat:compressed_tiles_stored", TypeDesc::INT64,
+                             &stored);
+    imagecache->getattribute("stat:compressed_tile_hits", TypeDesc::INT64,
+                             &hits);
+    imagecache->getattribute("stat:compressed_memory_used", TypeDesc::INT64,
+                             &cmem);
+    OIIO_CHECK_ASSERT(stored > 0);
+    OIIO_CHECK_ASSERT(hits > 0);
+    OIIO_CHECK_ASSERT(cmem > 0 && cmem <= 64 * 1024 * 1024);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+
+void
+test_tile_disk_cache()
+{
+    std::cout << "\nTesting IC tile disk cache\n";
+    std::string dir("tilediskcache");
+    Filesystem::remove_all(dir);
+    Filesystem::create_directory(dir);
+
+    ustring filename("tilediskcache.tif");
+    ImageSpec spec(64, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 0.0f }, { 1.0f });
+    A.write(filename);
+
+    // The first cache reads all 16 tiles from the file, and writes them
+    // to the disk cache in the background.
+    std::vector<float> p(64 * 64);
+    ImageCache* ic1 = ImageCache::create(false /*not shared*/);
+    ic1->attribute("tile_disk_cache", dir);
+    OIIO_CHECK_ASSERT(ic1->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0, 1,
+                                      TypeDesc::FLOAT, p.data()));
+    long long writes = 0;
+    ic1->getattribute("stat:disk_cache_writes", TypeDesc::INT64, &writes);
+    OIIO_CHECK_EQUAL(writes, 16);
+    ImageCache::destroy(ic1);
+    int ntiles = 0;
+    for (int tries = 0; tries < 500 && ntiles < 16; ++tries) {
+        std::vector<std::string> entries;
+        Filesystem::get_directory_entries(dir, entries, true);
+        ntiles = 0;
+        for (auto& e : entries)
+            ntiles += Strutil::ends_with(e, ".tile");
+        if (ntiles < 16)
+            Sysutil::usleep(10000);
+    }
+    OIIO_CHECK_EQUAL(ntiles, 16);
+
+    // A second cache, as if in another process, finds them all there.
+    std::fill(p.begin(), p.end(), -1.0f);
+    ImageCache* ic2 = ImageCache::create(false /*not shared*/);
+    ic2->attribute("tile_disk_cache", dir);
+    OIIO_CHECK_ASSERT(ic2->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0, 1,
+                                      TypeDesc::FLOAT, p.data()));
+    long long hits = 0;
+    ic2->getattribute("stat:disk_cache_hits", TypeDesc::INT64, &hits);
+    OIIO_CHECK_EQUAL(hits, 16);
+    int nbad = 0;
+    for (int y = 0; y < 64; ++y)
+        for (int x = 0; x < 64; ++x)
+            nbad += (p[y * 64 + x] != A.getchannel(x, y, 0, 0));
+    OIIO_CHECK_EQUAL(nbad, 0);
+    ImageCache::destroy(ic2);
+
+    // A cache that decodes files differently must not use those tiles.
+    // Give it a size limit that the stale files below put the directory
+    // over, so that its first write prunes them (oldest first).
+    std::vector<char> junk(1024 * 1024);
+    for (int i = 0; i < 2; ++i) {
+        std::string stale = Strutil::sprintf("%s/stale%d.tile", dir, i);
+        FILE* f = Filesystem::fopen(stale, "wb");
+        fwrite(junk.data(), 1, junk.size(), f);
+        fclose(f);
+        Filesystem::last_write_time(stale, std::time(nullptr) - 3600);
+    }
+    ImageCache* ic3 = ImageCache::create(false /*not shared*/);
+    ic3->attribute("unassociatedalpha", 1);
+    ic3->attribute("tile_disk_cache_MB", 1);
+    ic3->attribute("tile_disk_cache", dir);
+    OIIO_CHECK_ASSERT(ic3->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0, 1,
+                                      TypeDesc::FLOAT, p.data()));
+    hits = 0;
+    ic3->getattribute("stat:disk_cache_hits", TypeDesc::INT64, &hits);
+    OIIO_CHECK_EQUAL(hits, 0);
+    ImageCache::destroy(ic3);
+    bool pruned = false;
+    for (int tries = 0; tries < 500 && !pruned; ++tries) {
+        pruned = !Filesystem::exists(dir + "/stale0.tile");
+        if (!pruned)
+            Sysutil::usleep(10000);
+    }
+    OIIO_CHECK_ASSERT(pruned);
+    Filesystem::remove_all(dir);
+}
+
+
+
+
+void
+test_shared_tile_memory()
+{
+    std::cout << "\nTesting IC shared tile memory\n";
+    std::string shm("sharedtiles.shm");
+    Filesystem::remove(shm);
+
+    ustring filename("sharedtiles.tif");
+    ImageSpec spec(64, 64, 2, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f },
+                       { 1.0f, 0.5f });
+    A.write(filename);
+
+    // Two caches with their own mappings of the store stand in for two
+    // processes: the second should find every tile the first one read.
+    std::vector<float> p(64 * 64 * 2);
+    long long stores = 0, hits = 0;
+    ImageCache* ic1 = ImageCache::create(false /*not shared*/);
+    ic1->attribute("shared_tile_memory_MB", 16);
+    ic1->attribute("shared_tile_memory", shm);
+    OIIO_CHECK_ASSERT(ic1->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0, 1,
+                                      TypeDesc::FLOAT, p.data()));
+    ic1->getattribute("stat:shared_tile_stores", TypeDesc::INT64, &stores);
+    OIIO_CHECK_EQUAL(stores, 16);
+
+    std::fill(p.begin(), p.end(), -1.0f);
+    ImageCache* ic2 = ImageCache::create(false /*not shared*/);
+    ic2->attribute("shared_tile_memory", shm);
+    OIIO_CHECK_ASSERT(ic2->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0, 1,
+                                      TypeDesc::FLOAT, p.data()));
+    ic2->getattribute("stat:shared_tile_hits", TypeDesc::INT64, &hits);
+    OIIO_CHECK_EQUAL(hits, 16);
+    // Its tiles use the shared pixels in place, but still count against
+    // its own memory limit.
+    long long mem = 0;
+    ic2->getattribute("stat:cache_memory_used", TypeDesc::INT64, &mem);
+    OIIO_CHECK_ASSERT(mem >= 16 * 16 * 16 * 2 * (long long)sizeof(float));
+    int nbad = 0;
+    for (int y = 0; y < 64; ++y)
+        for (int x = 0; x < 64; ++x)
+            for (int c = 0; c < 2; ++c)
+                nbad += (p[(y * 64 + x) * 2 + c] != A.getchannel(x, y, 0, c));
+    OIIO_CHECK_EQUAL(nbad, 0);
+
+    ImageCache::destroy(ic1);
+    ImageCache::destroy(ic2);
+    Filesystem::remove(shm);
+}
+
+
+
+
+void
+test_mmap_tiles()
+{
+    std::cout << "\nTesting IC memory-mapped tiles\n";
+    ustring filename("mmaptiles.tif");
+    ImageSpec spec(128, 128, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 32;
+    spec.tile_height = 32;
+    spec.attribute("compression", "none");
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f },
+                       { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f });
+    A.write(filename);
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("mmap_tiles", 1);
+    std::vector<float> p(128 * 128 * 3);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 128, 0, 128,
+                                             0, 1, TypeDesc::FLOAT,
+                                             p.data()));
+    int nbad = 0;
+    for (int y = 0; y < 128; ++y)
+        for (int x = 0; x < 128; ++x)
+            for (int c = 0; c < 3; ++c)
+                nbad += (p[(y * 128 + x) * 3 + c] != A.getchannel(x, y, 0, c));
+    OIIO_CHECK_EQUAL(nbad, 0);
+    // All but perhaps the last tile in the file (whose SIMD padding could
+    // run past the end of the file) should have been used in place.
+    long long mapped = 0;
+    imagecache->getattribute("stat:mapped_tiles", TypeDesc::INT64, &mapped);
+    OIIO_CHECK_ASSERT(mapped >= 15);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+
+void
+test_get_tiles()
+{
+    std::cout << "\nTesting IC get_tiles\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    ustring filename("gettiles.tif");
+    ImageSpec spec(128, 64, 2, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 1.0f }, { 1.0f, 1.0f }, { 0.0f, 0.0f },
+                       { 1.0f, 0.0f });
+    A.write(filename);
+
+    // Every tile (named by a pixel somewhere inside it), plus a repeat
+    // and a request for a MIP level that doesn't exist.
+    std::vector<ImageCache::TileRequest> requests;
+    for (int y = 0; y < 64; y += 16)
+        for (int x = 0; x < 128; x += 16) {
+            ImageCache::TileRequest r;
+            r.x = x + 5;
+            r.y = y + 3;
+            requests.push_back(r);
+        }
+    requests.push_back(requests[9]);
+    ImageCache::TileRequest bad;
+    bad.miplevel = 3;
+    requests.push_back(bad);
+
+    ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+    ImageCache::ImageHandle* handle = imagecache->get_image_handle(filename);
+    std::vector<ImageCache::Tile*> tiles(requests.size());
+    int n = imagecache->get_tiles(handle, thread_info, requests, tiles);
+    OIIO_CHECK_EQUAL(n, 33);
+    OIIO_CHECK_ASSERT(tiles[32] == tiles[9]);
+    OIIO_CHECK_ASSERT(tiles[33] == nullptr);
+    int nbad = 0;
+    for (int i = 0; i < 32; ++i) {
+        if (!tiles[i]) {
+            ++nbad;
+            continue;
+        }
+        ROI roi = imagecache->tile_roi(tiles[i]);
+        TypeDesc format;
+        const float* p = (const float*)imagecache->tile_pixels(tiles[i],
+                                                               format);
+        OIIO_CHECK_EQUAL(format, TypeDesc::FLOAT);
+        nbad += (roi.xbegin != requests[i].x - 5);
+        nbad += (roi.ybegin != requests[i].y - 3);
+        for (int y = 0; y < 16; y += 5)
+            for (int x = 0; x < 16; x += 5)
+                for (int c = 0; c < 2; ++c)
+                    nbad += (p[(y * 16 + x) * 2 + c]
+                             != A.getchannel(roi.xbegin + x, roi.ybegin + y,
+                                             0, c));
+    }
+    OIIO_CHECK_EQUAL(nbad, 0);
+    for (auto t : tiles)
+        imagecache->release_tile(t);
+
+    // All in the cache now, so asking again should read nothing more.
+    int misses1 = 0, misses2 = 0;
+    imagecache->getattribute("stat:find_tile_cache_misses", misses1);
+    n = imagecache->get_tiles(handle, thread_info, requests, tiles);
+    OIIO_CHECK_EQUAL(n, 33);
+    imagecache->getattribute("stat:find_tile_cache_misses", misses2);
+    OIIO_CHECK_EQUAL(misses1, misses2);
+    for (auto t : tiles)
+        imagecache->release_tile(t);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+
+void
+test_coalesced_misses()
+{
+    std::cout << "\nTesting IC coalescing of simultaneous tile misses\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    ustring filename("coalesce.tif");
+    ImageSpec spec(256, 256, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 1.0f }, { 0.0f });
+    A.write(filename);
+
+    // Many threads all ask for the same few tiles at once. Whichever ones
+    // don't get to read a tile must wait for the one that does, and all
+    // must see the right pixels.
+    atomic_int nbad(0);
+    parallel_for(0, 64, [&](int64_t i) {
+        int x = int(i % 4) * 64 + 7, y = int(i / 16) * 64 + 9;
+        float p = -1.0f;
+        if (!imagecache->get_pixels(filename, 0, 0, x, x + 1, y, y + 1, 0, 1,
+                                    TypeDesc::FLOAT, &p)
+            || p != A.getchannel(x, y, 0, 0))
+            ++nbad;
+    });
+    OIIO_CHECK_EQUAL(nbad, 0);
+    long long coalesced = -1;
+    imagecache->getattribute("stat:tile_coalesced_misses", TypeDesc::INT64,
+                             &coalesced);
+    OIIO_CHECK_ASSERT(coalesced >= 0 && coalesced <= 64);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Count the micro-cache misses while cycling through ntiles tiles
+static long long
+microcache_misses(int microcache_size, int ntiles)
+{
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("microcache_size", microcache_size);
+    ustring filename("microcache.tif");
+    for (int pass = 0; pass < 10; ++pass) {
+        for (int t = 0; t < ntiles; ++t) {
+            float p;
+            imagecache->get_pixels(filename, 0, 0, t * 64, t * 64 + 1, 0, 1, 0,
+                                   1, TypeDesc::FLOAT, &p);
+        }
+    }
+    long long misses = -1;
+    imagecache->getattribute("stat:find_tile_microcache_misses",
+                             TypeDesc::INT64, &misses);
+    ImageCache::destroy(imagecache);
+    return misses;
+}
+
+
+
+void
+test_microcache_size()
+{
+    std::cout << "\nTesting IC microcache_size\n";
+    ImageSpec spec(256, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.5f });
+    A.write("microcache.tif");
+
+    // Cycling through 3 tiles thrashes the default 2-entry microcache,
+    // but a 4-entry one misses only the first time it sees each tile.
+    OIIO_CHECK_ASSERT(microcache_misses(2, 3) > 3);
+    OIIO_CHECK_EQUAL(microcache_misses(4, 3), 3);
+
+    // Out of range sizes are clamped
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    int size = -1;
+    imagecache->getattribute("microcache_size", size);
+    OIIO_CHECK_EQUAL(size, 2);
+    imagecache->attribute("microcache_size", 1000);
+    imagecache->getattribute("microcache_size", size);
+    OIIO_CHECK_EQUAL(size, 16);
+    imagecache->attribute("microcache_size", 0);
+    imagecache->getattribute("microcache_size", size);
+    OIIO_CHECK_EQUAL(size, 1);
+    ImageCache::destroy(imagecache);
+}
+
+
+void
+test_numa()
+{
+    std::cout << "\nTesting IC numa mode\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("numa", 1);
+    imagecache->attribute("numa_replicate_hits", 1);
+    int nodes = 0;
+    imagecache->getattribute("numa_nodes", nodes);
+    OIIO_CHECK_ASSERT(nodes >= 1 && nodes <= 8);
+    std::cout << "  " << nodes << " NUMA nodes\n";
+
+    ustring filename("numa.tif");
+    ImageSpec spec(256, 256, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 1.0f }, { 0.0f });
+    A.write(filename);
+
+    // Whichever node's copy of the tiles they get, all threads must see
+    // the right pixels.
+    atomic_int nbad(0);
+    parallel_for(0, 1024, [&](int64_t i) {
+        int x = int(i * 37 % 256), y = int(i * 101 % 256);
+        float p = -1.0f;
+        if (!imagecache->get_pixels(filename, 0, 0, x, x + 1, y, y + 1, 0, 1,
+                                    TypeDesc::FLOAT, &p)
+            || p != A.getchannel(x, y, 0, 0))
+            ++nbad;
+    });
+    OIIO_CHECK_EQUAL(nbad, 0);
+    long long local = -1, replicas = -1;
+    imagecache->getattribute("stat:numa_local_hits", TypeDesc::INT64, &local);
+    imagecache->getattribute("stat:numa_replicas", TypeDesc::INT64,
+                             &replicas);
+    OIIO_CHECK_ASSERT(local >= 0 && replicas >= 0);
+    if (nodes == 1)
+        OIIO_CHECK_EQUAL(local + replicas, 0);  // nothing to keep track of
+    ImageCache::destroy(imagecache);
+}
+
+
+void
+test_tile_pool()
+{
+    std::cout << "\nTesting IC tile pool\n";
+    ustring filename("tilepool.tif");
+    ImageSpec spec(2048, 1024, 4, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f, 1.0f },
+                       { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f },
+                       { 1.0f, 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    for (int pool = 0; pool <= 1; ++pool) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("tile_pool", pool);
+        // 32MB image through a 10MB cache, so evicted tiles' memory gets
+        // reused by later ones.
+        imagecache->attribute("max_memory_MB", 10.0f);
+        bool ok = true;
+        for (int pass = 0; pass < 2; ++pass)
+            for (int y = 0; y < 1024; y += 64)
+                for (int x = 0; x < 2048; x += 64) {
+                    float p[4];
+                    ok &= imagecache->get_pixels(filename, 0, 0, x + 3,
+                                                 x + 4, y + 5, y + 6, 0, 1,
+                                                 TypeDesc::FLOAT, p);
+                    float q[4];
+                    A.getpixel(x + 3, y + 5, q);
+                    ok &= (p[0] == q[0] && p[1] == q[1] && p[3] == q[3]);
+                }
+        OIIO_CHECK_ASSERT(ok);
+        long long poolmem = -1, poolfree = -1, used = -1;
+        imagecache->getattribute("stat:tile_pool_memory", TypeDesc::INT64,
+                                 &poolmem);
+        imagecache->getattribute("stat:tile_pool_free", TypeDesc::INT64,
+                                 &poolfree);
+        imagecache->getattribute("stat:cache_memory_used", TypeDesc::INT64,
+                                 &used);
+        if (pool) {
+            // Recycling keeps the pool near the cache size, far from the
+            // 32MB we'd need if nothing were reused.
+            OIIO_CHECK_ASSERT(poolmem >= used && poolmem < 20 * 1024 * 1024);
+            OIIO_CHECK_ASSERT(poolfree >= 0 && poolfree <= poolmem);
+        } else {
+            OIIO_CHECK_EQUAL(poolmem, 0);
+        }
+        ImageCache::destroy(imagecache);
+    }
+}
+
+
+void
+test_manifest()
+{
+    std::cout << "\nTesting IC tile manifest record and replay\n";
+    ustring filename("manifest.tif");
+    ImageSpec spec(256, 256, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 1.0f }, { 0.0f });
+    A.write(filename);
+    std::string manifest = "manifest.txt";
+    Filesystem::remove(manifest);
+
+    // Record a run that touches 3 of the 16 tiles, one of them twice
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("record_manifest", manifest);
+    float p;
+    imagecache->get_pixels(filename, 0, 0, 10, 11, 10, 11, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    imagecache->get_pixels(filename, 0, 0, 130, 131, 70, 71, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    imagecache->get_pixels(filename, 0, 0, 200, 201, 250, 251, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    imagecache->invalidate(filename);
+    imagecache->get_pixels(filename, 0, 0, 10, 11, 10, 11, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    ImageCache::destroy(imagecache);
+    std::string text;
+    OIIO_CHECK_ASSERT(Filesystem::read_text_file(manifest, text));
+    int ntiles = 0;
+    for (auto line : Strutil::splitsv(text, "\n"))
+        if (line.size() && line[0] != '#')
+            ++ntiles;
+    OIIO_CHECK_EQUAL(ntiles, 3);
+
+    // Replaying it in a new cache reads exactly those tiles, so the same
+    // lookups then find them all in the cache.
+    imagecache = ImageCache::create(false /*not shared*/);
+    OIIO_CHECK_ASSERT(imagecache->replay_manifest(manifest));
+    int misses = -1;
+    imagecache->getattribute("stat:find_tile_cache_misses", misses);
+    OIIO_CHECK_EQUAL(misses, 0);
+    imagecache->get_pixels(filename, 0, 0, 130, 131, 70, 71, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    OIIO_CHECK_EQUAL(p, A.getchannel(130, 70, 0, 0));
+    imagecache->get_pixels(filename, 0, 0, 200, 201, 250, 251, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    imagecache->getattribute("stat:find_tile_cache_misses", misses);
+    OIIO_CHECK_EQUAL(misses, 0);
+    int created = -1;
+    imagecache->getattribute("stat:tiles_created", created);
+    OIIO_CHECK_EQUAL(created, 3);
+
+    OIIO_CHECK_ASSERT(!imagecache->replay_manifest("no_such_manifest.txt"));
+    OIIO_CHECK_ASSERT(imagecache->geterror().size());
+    ImageCache::destroy(imagecache);
+}
+
+
+void
+test_getmetrics()
+{
+    std::cout << "\nTesting IC getmetrics\n";
+    ustring filename("metrics.tif");
+    ImageSpec spec(64, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.5f });
+    A.write(filename);
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    // One miss, then one microcache hit
+    float p;
+    imagecache->get_pixels(filename, 0, 0, 0, 1, 0, 1, 0, 1,
+                           TypeDesc::FLOAT, &p);
+    imagecache->get_pixels(filename, 0, 0, 0, 1, 0, 1, 0, 1,
+                           TypeDesc::FLOAT, &p);
+
+    std::string json = imagecache->getmetrics("json");
+    OIIO_CHECK_ASSERT(Strutil::starts_with(json, "{"));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"tiles_created\": 1"));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"shard_hits\": {\"0\": "));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"tile_read_us_count\": 1"));
+    OIIO_CHECK_ASSERT(
+        Strutil::contains(json, "\"file_bytes_read\": {\"metrics.tif\": "));
+
+    std::string prom = imagecache->getmetrics("prometheus");
+    OIIO_CHECK_ASSERT(Strutil::contains(
+        prom, "# TYPE oiio_imagecache_tile_read_us histogram\n"));
+    OIIO_CHECK_ASSERT(Strutil::contains(
+        prom, "oiio_imagecache_tile_read_us_bucket{le=\"+Inf\"} 1\n"));
+    OIIO_CHECK_ASSERT(
+        Strutil::contains(prom, "\noiio_imagecache_tiles_evicted 0\n"));
+
+    OIIO_CHECK_ASSERT(imagecache->getmetrics("xml").empty());
+    OIIO_CHECK_ASSERT(imagecache->geterror().size());
+    ImageCache::destroy(imagecache);
+}
+
+
+
+void
+test_read_time_hist()
+{
+    std::cout << "\nTesting IC per-file read time histograms\n";
+    ustring filename("readtimes.tif");
+    ImageSpec spec(128, 128, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.25f });
+    A.write(filename);
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    std::vector<float> pixels(128 * 128);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 128, 0, 128, 0,
+                                             1, TypeDesc::FLOAT, &pixels[0]));
+
+    // Every read of the file lands in exactly one bucket. Adjacent tiles
+    // may be read together, so there are between 1 and 4 reads.
+    long long hist[24];
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filename, 0, 0,
+                                                 ustring("stat:read_time_hist"),
+                                                 TypeDesc(TypeDesc::INT64, 24),
+                                                 hist));
+    long long total = 0;
+    for (auto h : hist)
+        total += h;
+    OIIO_CHECK_ASSERT(total >= 1 && total <= 4);
+    float maxtime = -1.0f;
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filename, 0, 0,
+                                                 ustring("stat:max_read_time"),
+                                                 TypeDesc::FLOAT, &maxtime));
+    OIIO_CHECK_ASSERT(maxtime >= 0.0f);
+
+    // reset_stats forgets them
+    imagecache->reset_stats();
+    imagecache->get_image_info(filename, 0, 0, ustring("stat:read_time_hist"),
+                               TypeDesc(TypeDesc::INT64, 24), hist);
+    total = 0;
+    for (auto h : hist)
+        total += h;
+    OIIO_CHECK_EQUAL(total, 0);
+    ImageCache::destroy(imagecache);
+}
+
+
+
+void
+test_untiled_bands()
+{
+    std::cout << "\nTesting IC autotile bands of untiled files\n";
+    ustring filename("untiledbands.tif");
+    ImageSpec spec(512, 128, 1, TypeDesc::FLOAT);  // scanline file
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 0.5f }, { 0.25f });
+    A.write(filename);
+
+    for (int parallel = 0; parallel <= 1; ++parallel) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("autotile", 64);
+        imagecache->attribute("autotile_parallel", parallel);
+        // Asking for any one tile reads and slices its whole band, after
+        // which all 8 tiles of the band are in the cache.
+        bool ok = true;
+        for (int i = 0; i < 8; ++i) {
+            int x = ((i + 3) % 8) * 64 + 7;
+            float p, q;
+            ok &= imagecache->get_pixels(filename, 0, 0, x, x + 1, 9, 10, 0,
+                                         1, TypeDesc::FLOAT, &p);
+            A.getpixel(x, 9, &q, 1);
+            ok &= (p == q);
+        }
+        OIIO_CHECK_ASSERT(ok);
+        int tiles = 0;
+        long long bytes = 0;
+        imagecache->getattribute("stat:tiles_created", TypeDesc::INT, &tiles);
+        imagecache->getattribute("stat:bytes_read", TypeDesc::INT64, &bytes);
+        OIIO_CHECK_EQUAL(tiles, 8);
+        OIIO_CHECK_EQUAL(bytes, 512LL * 64 * 4);
+        ImageCache::destroy(imagecache);
+    }
+}
+
+
+
+void
+test_automip_levels()
+{
+    std::cout << "\nTesting IC automip levels built in the background\n";
+    ustring filename("automip.tif");
+    std::string sidecar = filename.string() + ".automip.tx";
+    Filesystem::remove(sidecar);
+    ImageSpec spec(256, 256, 1, TypeDesc::FLOAT);  // scanline, no MIP
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 0.5f }, { 0.25f });
+    A.write(filename);
+    // What MIP level 1 pixel (74,20) should be: the average of the 2x2
+    // block it covers.
+    float block[4];
+    A.get_pixels(ROI(148, 150, 40, 42), TypeDesc::FLOAT, block);
+    float expected = 0.25f * (block[0] + block[1] + block[2] + block[3]);
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("autotile", 32);
+    imagecache->attribute("automip", 1);
+    imagecache->attribute("automip_sidecar", 1);
+    float p = -1.0f;
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 1, 0, 1, 0, 1, 0,
+                                             1, TypeDesc::FLOAT, &p));
+    long long builds = 0;
+    for (int i = 0; i < 1000 && !builds; ++i) {
+        imagecache->getattribute("stat:automip_builds", TypeDesc::INT64,
+                                 &builds);
+        if (!builds)
+            Sysutil::usleep(10000);
+    }
+    OIIO_CHECK_EQUAL(builds, 1);
+    // Now the level's other tiles are copied from the built level.
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 1, 74, 75, 20, 21,
+                                             0, 1, TypeDesc::FLOAT, &p));
+    OIIO_CHECK_EQUAL_THRESH(p, expected, 1.0e-5);
+    long long copied = 0;
+    imagecache->getattribute("stat:automip_tiles", TypeDesc::INT64, &copied);
+    OIIO_CHECK_EQUAL(copied, 1);
+    ImageCache::destroy(imagecache);
+    OIIO_CHECK_ASSERT(Filesystem::exists(sidecar));
+
+    // Another cache reads the sidecar (in 64x64 tiles, unlike the
+    // emulated ones of the original) rather than building the levels.
+    imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("autotile", 32);
+    imagecache->attribute("automip", 1);
+    imagecache->attribute("automip_sidecar", 1);
+    ImageSpec s;
+    OIIO_CHECK_ASSERT(imagecache->get_imagespec(filename, s));
+    OIIO_CHECK_EQUAL(s.tile_width, 64);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 1, 74, 75, 20, 21,
+                                             0, 1, TypeDesc::FLOAT, &p));
+    OIIO_CHECK_EQUAL_THRESH(p, expected, 1.0e-5);
+    builds = -1;
+    imagecache->getattribute("stat:automip_builds", TypeDesc::INT64, &builds);
+    OIIO_CHECK_EQUAL(builds, 0);
+    ImageCache::destroy(imagecache);
+}
+
+
+
+void
+test_file_index()
+{
+    std::cout << "\nTesting IC lock-free file lookups\n";
+    // Far more files than the per-thread filename cache holds, and enough
+    // to make the file index grow several times.
+    const int nfiles = 2000;
+    std::vector<ustring> names;
+    for (int i = 0; i < nfiles; ++i)
+        names.emplace_back(Strutil::sprintf("fileindex_%04d.tif", i));
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    std::vector<ImageCache::ImageHandle*> handles(nfiles, nullptr);
+    parallel_for(0, nfiles, [&](int64_t i) {
+        handles[i] = imagecache->get_image_handle(names[i]);
+    });
+    std::set<ImageCache::ImageHandle*> distinct(handles.begin(),
+                                                handles.end());
+    OIIO_CHECK_EQUAL(distinct.size(), size_t(nfiles));
+    // Looking them up again, in any order and from any thread, finds the
+    // very same files.
+    std::atomic<int> mismatches(0);
+    parallel_for(0, 4 * nfiles, [&](int64_t i) {
+        int f = int((i * 7919) % nfiles);
+        if (imagecache->get_image_handle(names[f]) != handles[f])
+            ++mismatches;
+    });
+    OIIO_CHECK_EQUAL(mismatches, 0);
+    (void)imagecache->geterror();  // None of them exist
+    ImageCache::destroy(imagecache);
+}
+
+
+
+void
+test_get_pixels_threads()
+{
+    std::cout << "\nTesting IC get_pixels with several threads\n";
+    ustring filename("getpixelsthreads.tif");
+    ImageSpec spec(512, 512, 3, TypeDesc::UINT16);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.5f, 1.0f }, { 1.0f, 0.0f, 0.5f },
+                       { 0.5f, 1.0f, 0.0f }, { 0.25f, 0.75f, 0.5f });
+    A.write(filename);
+
+    // A region that doesn't line up with the tiles, and hangs off the
+    // bottom of the image.
+    const int xb = 37, xe = 301, yb = 13, ye = 530;
+    const size_t npixels = size_t(xe - xb) * (ye - yb);
+    std::vector<float> serial(2 * npixels), parallel(2 * npixels, -1.0f);
+    for (int nthreads = 1; nthreads >= 0; --nthreads) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("get_pixels_threads", nthreads);
+        std::vector<float>& result(nthreads ? serial : parallel);
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, xb, xe, yb,
+                                                 ye, 0, 1, 1, 3,
+                                                 TypeDesc::FLOAT,
+                                                 &result[0]));
+        ImageCache::destroy(imagecache);
+    }
+    OIIO_CHECK_ASSERT(serial == parallel);
+    // Spot check against the source
+    float p[3];
+    A.getpixel(200, 400, p);
+    size_t i = 2 * (size_t(400 - yb) * (xe - xb) + (200 - xb));
+    OIIO_CHECK_EQUAL(parallel[i], p[1]);
+    OIIO_CHECK_EQUAL(parallel[i + 1], p[2]);
+    OIIO_CHECK_EQUAL(parallel[2 * npixels - 1], 0.0f);  // off the image
+}
+
+
+
+// Pin all the tiles of a texture, then read a bigger image through a
+// small cache, and make sure the pinned tiles stay put until unpinned.
+void
+test_pin_levels()
+{
+    std::cout << "\nTesting TS pin/unpin\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 1.0f);
+    TextureSystem* texsys = TextureSystem::create(false, imagecache);
+
+    ustring hero("pinhero.tif"), other("pinother.tif");
+    ImageSpec spec(256, 256, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.25f, 0.5f, 0.75f });
+    A.write(hero);
+    spec.width  = 512;
+    spec.height = 512;
+    ImageBuf B(spec);
+    ImageBufAlgo::fill(B, { 1.0f, 0.0f, 0.0f });
+    B.write(other);
+
+    OIIO_CHECK_ASSERT(!texsys->pin(hero, 1));  // no such subimage
+    (void)texsys->geterror();
+    OIIO_CHECK_ASSERT(texsys->pin(hero, 0));
+    const long long heromem = 16 * 64 * 64 * 3 * sizeof(float);
+    long long pinned        = 0;
+    imagecache->getattribute("stat:pinned_memory_used", TypeDesc::INT64,
+                             &pinned);
+    OIIO_CHECK_EQUAL(pinned, heromem);
+
+    std::vector<float> pixels(512 * 512 * 3);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(other, 0, 0, 0, 512, 0, 512, 0,
+                                             1, TypeDesc::FLOAT,
+                                             pixels.data()));
+    imagecache->getattribute("stat:pinned_memory_used", TypeDesc::INT64,
+                             &pinned);
+    OIIO_CHECK_EQUAL(pinned, heromem);
+    int created = 0, created_after = 0;
+    imagecache->getattribute("stat:tiles_created", created);
+    std::vector<float> heropixels(256 * 256 * 3);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(hero, 0, 0, 0, 256, 0, 256, 0,
+                                             1, TypeDesc::FLOAT,
+                                             heropixels.data()));
+    imagecache->getattribute("stat:tiles_created", created_after);
+    OIIO_CHECK_EQUAL(created_after, created);  // all still in the cache
+    OIIO_CHECK_EQUAL(heropixels[3 * 1000 + 2], 0.75f);
+
+    OIIO_CHECK_ASSERT(texsys->unpin(hero, 0));
+    imagecache->getattribute("stat:pinned_memory_used", TypeDesc::INT64,
+                             &pinned);
+    OIIO_CHECK_EQUAL(pinned, 0);
+
+    TextureSystem::destroy(texsys);
+    ImageCache::destroy(imagecache);
+}
+
+
+
+
+// Look up a 1x6 cubeface environment map whose faces are each a solid
+// value, at the face centers and right on the edge between two faces.
+void
+test_cubeface_environment()
+{
+    std::cout << "\nTesting TS cubeface environment lookups\n";
+    ustring filename("cubeface.tif");
+    const int res = 16;
+    ImageSpec spec(res, 6 * res, 1, TypeDesc::FLOAT);
+    spec.tile_width  = res;
+    spec.tile_height = res;
+    spec.full_width  = res;
+    spec.full_height = res;
+    spec.attribute("textureformat", "CubeFace Environment");
+    ImageBuf A(spec);
+    for (int face = 0; face < 6; ++face) {
+        float val = 0.1f * (face + 1);
+        ImageBufAlgo::fill(A, { val },
+                           ROI(0, res, face * res, (face + 1) * res));
+    }
+    A.write(filename);
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    TextureSystem* texsys  = TextureSystem::create(false, imagecache);
+    TextureOpt opt;
+    Imath::V3f zero(0.0f, 0.0f, 0.0f);
+    // In the order px, nx, py, ny, pz, nz
+    Imath::V3f dirs[6] = { { 1, 0, 0 },  { -1, 0, 0 }, { 0, 1, 0 },
+                           { 0, -1, 0 }, { 0, 0, 1 },  { 0, 0, -1 } };
+    for (int face = 0; face < 6; ++face) {
+        float r = -1.0f;
+        OIIO_CHECK_ASSERT(texsys->environment(filename, opt, dirs[face], zero,
+                                              zero, 1, &r));
+        OIIO_CHECK_EQUAL_THRESH(r, 0.1f * (face + 1), 1.0e-5f);
+    }
+    // On the px/pz edge, half from each face rather than px clamped.
+    float r = -1.0f;
+    OIIO_CHECK_ASSERT(texsys->environment(filename, opt,
+                                          Imath::V3f(1.0f, 0.0f, 1.0f), zero,
+                                          zero, 1, &r));
+    OIIO_CHECK_EQUAL_THRESH(r, 0.5f * (0.1f + 0.5f), 1.0e-5f);
+
+    TextureSystem::destroy(texsys);
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Lookups are totaled by the thread's cost tag, and not at all without.
+static void
+test_cost_tags()
+{
+    std::cout << "\nTesting TS cost tags\n";
+    ustring filename("costtags.tif");
+    ImageSpec spec(64, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.5f });
+    A.write(filename);
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    TextureSystem* texsys  = TextureSystem::create(false, imagecache);
+    TextureOpt opt;
+    float r;
+    texsys->set_cost_tag(nullptr, ustring("wood"));
+    // Three lookups, each of whose texels lie within one tile
+    for (int i = 0; i < 3; ++i)
+        OIIO_CHECK_ASSERT(texsys->texture(filename, opt, 0.1f + 0.3f * i,
+                                          0.4f, 0, 0, 0, 0, 1, &r));
+    texsys->set_cost_tag(nullptr, ustring("metal"));
+    OIIO_CHECK_ASSERT(texsys->texture(filename, opt, 0.5f, 0.5f, 0, 0, 0, 0,
+                                      1, &r));
+    texsys->set_cost_tag(nullptr, ustring());
+    OIIO_CHECK_ASSERT(texsys->texture(filename, opt, 0.5f, 0.5f, 0, 0, 0, 0,
+                                      1, &r));
+    std::string json = texsys->getmetrics("json", false);
+    OIIO_CHECK_ASSERT(Strutil::contains(
+        json, "\"tag_lookups\": {\"wood\": 3, \"metal\": 1}"));
+    OIIO_CHECK_ASSERT(
+        Strutil::contains(json, "\"tag_tile_misses\": {\"wood\": 3, "));
+    OIIO_CHECK_ASSERT(
+        Strutil::contains(texsys->getstats(2, false), "Cost by tag"));
+
+    TextureSystem::destroy(texsys);
+    ImageCache::destroy(imagecache);
+}
+
+
+// Files whose handles were closed to stay within max_open_files are
+// reopened for later tile reads, keeping the specs from the first open.
+static void
+test_file_reopen()
+{
+    std::cout << "\nTesting IC reopening files\n";
+    const int nfiles = 12;
+    ImageSpec spec(64, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 16;
+    spec.tile_height = 16;
+    std::vector<ustring> filenames;
+    for (int i = 0; i < nfiles; ++i) {
+        filenames.emplace_back(Strutil::sprintf("reopen%d.tif", i));
+        spec.attribute("Artist", Strutil::sprintf("artist %d", i));
+        ImageBuf A(spec);
+        ImageBufAlgo::fill(A, { float(i) });
+        A.write(filenames.back());
+    }
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_open_files", 10);
+    float p[16 * 16];
+    // Read the top row of tiles of each file, then the next row, which
+    // needs the files closed along the way to be opened again.
+    for (int y = 0; y < 32; y += 16) {
+        for (int i = 0; i < nfiles; ++i) {
+            OIIO_CHECK_ASSERT(imagecache->get_pixels(filenames[i], 0, 0, 0,
+                                                     16, y, y + 16, 0, 1,
+                                                     TypeFloat, p));
+            OIIO_CHECK_EQUAL(p[17], float(i));
+        }
+    }
+    long long reopens = 0;
+    imagecache->getattribute("stat:file_reopens", TypeDesc::INT64, &reopens);
+    OIIO_CHECK_ASSERT(reopens >= nfiles - 10);
+    ustring artist;
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filenames[0], 0, 0,
+                                                 ustring("Artist"),
+                                                 TypeString, &artist));
+    OIIO_CHECK_EQUAL(artist, "artist 0");
+    OIIO_CHECK_ASSERT(
+        Strutil::contains(imagecache->getstats(), "Files reopened"));
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Tests that errors about a broken file stop at max_errors_per_file, even
+// when many threads look it up at once, and that a thread's errors not
+// yet retrieved are bounded.
+void
+test_error_limits()
+{
+    std::cout << "\nTesting IC error limits\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_errors_per_file", 3);
+    ustring missing("missing_error_limits.tif");
+    std::atomic<int> nerrors(0);
+    parallel_for(0, 1000, [&](int64_t) {
+        float p[1];
+        OIIO_CHECK_ASSERT(!imagecache->get_pixels(missing, 0, 0, 0, 1, 0, 1, 0,
+                                                  1, TypeFloat, p));
+        std::string err = imagecache->geterror();
+        if (err.size())
+            nerrors += int(Strutil::splits(err, "\n").size());
+    });
+    OIIO_CHECK_ASSERT(nerrors >= 1 && nerrors <= 3);
+
+    // Errors never retrieved: only the first ones are kept in full.
+    imagecache->attribute("max_errors_per_file", 100000);
+    for (int i = 0; i < 1500; ++i) {
+        float p[1];
+        imagecache->get_pixels(ustring(Strutil::sprintf("missing%d.tif", i)),
+                               0, 0, 0, 1, 0, 1, 0, 1, TypeFloat, p);
+    }
+    std::vector<std::string> lines = Strutil::splits(imagecache->geterror(),
+                                                     "\n");
+    OIIO_CHECK_EQUAL(lines.size(), 1001);
+    OIIO_CHECK_ASSERT(
+        Strutil::ends_with(lines.back(), "more errors not recorded)"));
+    OIIO_CHECK_EQUAL(imagecache->geterror(), "");
+    ImageCache::destroy(imagecache);
+}
 int
 main(int argc, char** argv)
 {
@@ -172,5 +1365,34 @@ main(int argc, char** argv)
 
     test_app_buffer();
 
+    test_prefetch(0);
+    test_prefetch(2);
+
+    test_tile_eviction();
+    test_input_pool();
+    test_compressed_tier();
+    test_tile_disk_cache();
+    test_get_tiles();
+    test_coalesced_misses();
+    test_microcache_size();
+    test_numa();
+    test_tile_pool();
+    test_manifest();
+    test_getmetrics();
+    test_read_time_hist();
+    test_untiled_bands();
+    test_automip_levels();
+    test_file_index();
+    test_get_pixels_threads();
+    test_pin_levels();
+    test_cubeface_environment();
+    test_cost_tags();
+    test_file_reopen();
+    test_error_limits();
+#ifndef _WIN32
+    test_shared_tile_memory();
+    test_mmap_tiles();
+#endif
+
     return unit_test_failures;
 }
@@ -0,0 +1,471 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+// Benchmarks of the ImageCache and TextureSystem: cold and warm tile
+// lookups, contention as threads are added, eviction churn under memory
+// pressure, file handle thrash, and UDIM resolution.
+//
+// Besides the usual Benchmarker printout, "--json file" writes all the
+// results in a stable schema, for tracking performance across releases:
+//
+//   {
+//     "schema": "oiio-imagecache-benchmark",
+//     "schema_version": 1,
+//     "oiio_version": "2.1.0",
+//     "hardware_threads": 16,
+//     "results": [
+//       { "name": "tile_lookup_warm", "threads": 1, "work": 256,
+//         "trials": 10, "iterations": 1024,
+//         "seconds": { "mean": 1.2e-05, "stddev": 1e-07,
+//                      "median": 1.2e-05, "range": 3e-07 },
+//         "ns_per_op": 46.9, "ops_per_second": 21300000 },
+//       ...
+//     ]
+//   }
+//
+// "seconds" are per iteration, each iteration doing "work" operations
+// (lookups, texture calls) spread over "threads" threads. Names and fields
+// are only ever added to, never changed in meaning.
+
+
+#include <OpenImageIO/argparse.h>
+#include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagecache.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/texture.h>
+#include <OpenImageIO/thread.h>
+#include <OpenImageIO/ustring.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace OIIO;
+
+static bool verbose   = false;
+static int ntrials    = 10;
+static int maxthreads = 256;
+static int res        = 1024;
+static std::string json_filename;
+static std::string scratchdir = "imagecachespeed_files";
+
+
+
+// One benchmark result, as it will be written to the JSON file.
+struct BenchResult {
+    std::string name;
+    int threads;
+    size_t work, trials, iterations;
+    double mean, stddev, median, range;
+};
+
+static std::vector<BenchResult> results;
+
+
+
+static void
+getargs(int argc, char* argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    // clang-format off
+    ap.options(
+        "imagecachespeed_test\n" OIIO_INTRO_STRING "\n"
+        "Usage:  imagecachespeed_test [options]",
+        "--help", &help, "Print help message",
+        "-v", &verbose, "Verbose mode",
+        "--trials %d", &ntrials,
+            ustring::sprintf("Number of trials (default: %d)", ntrials).c_str(),
+        "--maxthreads %d", &maxthreads,
+            ustring::sprintf("Most threads for the contention test (default: %d)", maxthreads).c_str(),
+        "--res %d", &res,
+            ustring::sprintf("Resolution of the test images (default: %d)", res).c_str(),
+        "--dir %s", &scratchdir, "Directory for the test images",
+        "--json %s", &json_filename, "Also write the results to this JSON file",
+        nullptr);
+    // clang-format on
+    if (ap.parse(argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+// Run the benchmark, and remember its results.
+template<typename FUNC>
+static void
+bench(string_view name, int threads, size_t work, FUNC func)
+{
+    Benchmarker b;
+    b.trials(ntrials).work(work).indent(2).verbose(verbose ? 2 : 1);
+    std::string fullname = threads > 1
+                               ? Strutil::sprintf("%s/%d", name, threads)
+                               : std::string(name);
+    b(fullname, func);
+    results.push_back({ name, threads, work, b.trials(), b.iterations(),
+                        b.avg(), b.stddev(), b.median(), b.range() });
+}
+
+
+
+// Write a tiled float RGB image.
+static ustring
+make_image(string_view name, int xres, int yres, int tilesize)
+{
+    std::string filename = scratchdir + "/" + std::string(name);
+    ImageSpec spec(xres, yres, 3, TypeDesc::FLOAT);
+    spec.tile_width  = tilesize;
+    spec.tile_height = tilesize;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.5f }, { 1.0f, 0.0f, 0.5f },
+                       { 0.0f, 1.0f, 0.5f }, { 1.0f, 1.0f, 0.5f });
+    if (!A.write(filename)) {
+        std::cerr << "Could not write " << filename << ": " << A.geterror()
+                  << "\n";
+        exit(EXIT_FAILURE);
+    }
+    return ustring(filename);
+}
+
+
+
+// Read every tile of one image, through a handle.
+static void
+read_all_tiles(ImageCache* ic, ImageCache::ImageHandle* file,
+               ImageCache::Perthread* thread_info, int xres, int yres,
+               int tilesize)
+{
+    for (int y = 0; y < yres; y += tilesize) {
+        for (int x = 0; x < xres; x += tilesize) {
+            ImageCache::Tile* tile = ic->get_tile(file, thread_info, 0, 0, x,
+                                                  y, 0);
+            if (tile)
+                ic->release_tile(tile);
+        }
+    }
+}
+
+
+
+static void
+bench_tile_lookups()
+{
+    const int tilesize = 64;
+    ustring filename   = make_image("lookup.tif", res, res, tilesize);
+    size_t ntiles      = size_t(res / tilesize) * size_t(res / tilesize);
+    ImageCache* ic     = ImageCache::create(false /*not shared*/);
+    ic->attribute("max_memory_MB", 4096.0f);
+    ImageCache::Perthread* thread_info = ic->get_perthread_info();
+
+    // Cold: every tile comes from the file, which is opened again.
+    bench("tile_lookup_cold", 1, ntiles, [&]() {
+        ic->invalidate(filename);
+        ImageCache::ImageHandle* file = ic->get_image_handle(filename,
+                                                             thread_info);
+        read_all_tiles(ic, file, thread_info, res, res, tilesize);
+    });
+
+    // Warm: every tile is already resident.
+    ImageCache::ImageHandle* file = ic->get_image_handle(filename,
+                                                         thread_info);
+    read_all_tiles(ic, file, thread_info, res, res, tilesize);
+    bench("tile_lookup_warm", 1, ntiles, [&]() {
+        for (int y = 0; y < res; y += tilesize) {
+            for (int x = 0; x < res; x += tilesize) {
+                ImageCache::Tile* tile = ic->get_tile(filename, 0, 0, x, y, 0);
+                if (tile)
+                    ic->release_tile(tile);
+            }
+        }
+    });
+    bench("tile_lookup_warm_handle", 1, ntiles, [&]() {
+        read_all_tiles(ic, file, thread_info, res, res, tilesize);
+    });
+
+    ImageCache::destroy(ic);
+}
+
+
+
+// A fixed set of threads that run the same task in lock step, one round
+// per call to run(), so that thread creation isn't part of the timing.
+class ThreadRounds {
+public:
+    ThreadRounds(int nthreads, std::function<void(int)> task)
+        : m_task(task)
+        , m_nthreads(nthreads)
+    {
+        for (int i = 0; i < nthreads; ++i)
+            m_threads.create_thread([this, i]() { worker(i); });
+    }
+    ~ThreadRounds()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_start.notify_all();
+        m_threads.join_all();
+    }
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ndone = 0;
+        ++m_round;
+        m_start.notify_all();
+        m_done.wait(lock, [&]() { return m_ndone == m_nthreads; });
+    }
+
+private:
+    void worker(int id)
+    {
+        int round = 0;
+        while (1) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock,
+                             [&]() { return m_quit || m_round != round; });
+                if (m_quit)
+                    return;
+                round = m_round;
+            }
+            m_task(id);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (++m_ndone == m_nthreads)
+                m_done.notify_one();
+        }
+    }
+
+    std::function<void(int)> m_task;
+    int m_nthreads;
+    int m_ndone = 0, m_round = 0;
+    bool m_quit = false;
+    std::mutex m_mutex;
+    std::condition_variable m_start, m_done;
+    thread_group m_threads;
+};
+
+
+
+static void
+bench_contention()
+{
+    const int tilesize        = 64;
+    const int lookups         = 10000;  // per thread per round
+    ustring filename          = make_image("contention.tif", res, res,
+                                  tilesize);
+    int ntx                   = res / tilesize;
+    int nty                   = res / tilesize;
+    ImageCache* ic            = ImageCache::create(false /*not shared*/);
+    ImageCache::Perthread* pt = ic->get_perthread_info();
+    read_all_tiles(ic, ic->get_image_handle(filename, pt), pt, res, res,
+                   tilesize);
+
+    for (int nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        ThreadRounds rounds(nthreads, [&](int id) {
+            // Each thread walks the tiles from its own starting point
+            ImageCache::Perthread* thread_info = ic->get_perthread_info();
+            ImageCache::ImageHandle* file = ic->get_image_handle(filename,
+                                                                 thread_info);
+            int t = id * 7919;
+            for (int i = 0; i < lookups; ++i, t += 13) {
+                int x = (t % ntx) * tilesize;
+                int y = ((t / ntx) % nty) * tilesize;
+                ImageCache::Tile* tile = ic->get_tile(file, thread_info, 0, 0,
+                                                      x, y, 0);
+                if (tile)
+                    ic->release_tile(tile);
+            }
+        });
+        bench("contention", nthreads, size_t(nthreads) * lookups,
+              [&]() { rounds.run(); });
+    }
+
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+bench_eviction_churn()
+{
+    // Read an image four times the size of the cache, start to finish, so
+    // that nearly every lookup reads a tile and evicts another.
+    const int tilesize = 64;
+    int xres           = std::max(res, 1024);
+    ustring filename   = make_image("churn.tif", xres, xres, tilesize);
+    float imagemb      = float(xres) * xres * 3 * sizeof(float) / (1 << 20);
+    ImageCache* ic     = ImageCache::create(false /*not shared*/);
+    ic->attribute("max_memory_MB", imagemb / 4);
+    ImageCache::Perthread* thread_info = ic->get_perthread_info();
+    ImageCache::ImageHandle* file = ic->get_image_handle(filename,
+                                                         thread_info);
+    size_t ntiles = size_t(xres / tilesize) * size_t(xres / tilesize);
+    bench("eviction_churn", 1, ntiles, [&]() {
+        read_all_tiles(ic, file, thread_info, xres, xres, tilesize);
+    });
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+bench_file_thrash()
+{
+    // Many small files and few file handles: reading a tile from each file
+    // in turn closes one file and opens another nearly every time. The
+    // cache is kept small too, so that the tiles have to be read again.
+    const int nfiles = 64, tilesize = 64, xres = 256;
+    std::vector<ustring> filenames;
+    for (int i = 0; i < nfiles; ++i)
+        filenames.push_back(
+            make_image(Strutil::sprintf("thrash%02d.tif", i), xres, xres,
+                       tilesize));
+    ImageCache* ic = ImageCache::create(false /*not shared*/);
+    ic->attribute("max_open_files", 8);
+    ic->attribute("max_memory_MB", 4.0f);
+    ImageCache::Perthread* thread_info = ic->get_perthread_info();
+    std::vector<ImageCache::ImageHandle*> files;
+    for (auto f : filenames)
+        files.push_back(ic->get_image_handle(f, thread_info));
+    const int ntiles = (xres / tilesize) * (xres / tilesize);
+    bench("file_handle_thrash", 1, size_t(nfiles) * ntiles, [&]() {
+        for (int t = 0; t < ntiles; ++t) {
+            int x = (t % (xres / tilesize)) * tilesize;
+            int y = (t / (xres / tilesize)) * tilesize;
+            for (auto file : files) {
+                ImageCache::Tile* tile = ic->get_tile(file, thread_info, 0, 0,
+                                                      x, y, 0);
+                if (tile)
+                    ic->release_tile(tile);
+            }
+        }
+    });
+    ImageCache::destroy(ic);
+}
+
+
+
+static void
+bench_udim()
+{
+    // A 4x2 set of UDIM tiles, looked up all over their range.
+    for (int v = 0; v < 2; ++v)
+        for (int u = 0; u < 4; ++u)
+            make_image(Strutil::sprintf("udim.%d.tif", 1001 + 10 * v + u), 64,
+                       64, 64);
+    ustring filename(scratchdir + "/udim.<UDIM>.tif");
+    TextureSystem* ts = TextureSystem::create(false /*not shared*/);
+    TextureOpt opt;
+    const int n = 1024;
+    std::vector<float> s(n), t(n);
+    for (int i = 0; i < n; ++i) {
+        s[i] = 4.0f * ((i * 37) % n + 0.5f) / n;
+        t[i] = 2.0f * ((i * 101) % n + 0.5f) / n;
+    }
+    float result[3];
+    bench("udim_resolve", 1, n, [&]() {
+        for (int i = 0; i < n; ++i)
+            ts->texture(filename, opt, s[i], t[i], 0.0f, 0.0f, 0.0f, 0.0f, 3,
+                        result);
+        DoNotOptimize(result[0]);
+    });
+    TextureSystem::destroy(ts);
+}
+
+
+
+static void
+write_json(const std::string& filename)
+{
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Could not open " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    out << "{\n"
+        << "  \"schema\": \"oiio-imagecache-benchmark\",\n"
+        << "  \"schema_version\": 1,\n"
+        << "  \"oiio_version\": \"" << OIIO_VERSION_STRING << "\",\n"
+        << "  \"hardware_threads\": " << Sysutil::hardware_concurrency()
+        << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r(results[i]);
+        double opsec = r.mean > 0.0 ? r.work / r.mean : 0.0;
+        out << Strutil::sprintf(
+            "    { \"name\": \"%s\", \"threads\": %d, \"work\": %d,\n"
+            "      \"trials\": %d, \"iterations\": %d,\n"
+            "      \"seconds\": { \"mean\": %.6g, \"stddev\": %.6g,\n"
+            "                   \"median\": %.6g, \"range\": %.6g },\n"
+            "      \"ns_per_op\": %.6g, \"ops_per_second\": %.6g }%s\n",
+            r.name, r.threads, r.work, r.trials, r.iterations, r.mean,
+            r.stddev, r.median, r.range, 1.0e9 * r.mean / r.work, opsec,
+            i + 1 < results.size() ? "," : "");
+    }
+    out << "  ]\n}\n";
+}
+
+
+
+int
+main(int argc, char** argv)
+{
+    getargs(argc, argv);
+    Filesystem::remove_all(scratchdir);
+    Filesystem::create_directory(scratchdir);
+
+    std::cout << "Tile lookups:\n";
+    bench_tile_lookups();
+    std::cout << "Contention:\n";
+    bench_contention();
+    std::cout << "Eviction churn:\n";
+    bench_eviction_churn();
+    std::cout << "File handle thrash:\n";
+    bench_file_thrash();
+    std::cout << "UDIM resolution:\n";
+    bench_udim();
+
+    if (json_filename.size())
+        write_json(json_filename);
+    Filesystem::remove_all(scratchdir);
+    return 0;
+}
@@ -36,10 +36,13 @@
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/deepdata.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/trace.h>
 #include <OpenImageIO/typedesc.h>
 
 #include "imageio_pvt.h"
@@ -81,6 +84,42 @@ ImageInput::~ImageInput() {}
 
 
 
+void
+ImageInput::adopt_ioproxy(Filesystem::IOProxy* io)
+{
+    m_owned_io.reset(io);
+}
+
+
+
+bool
+pvt::wants_url_ioproxy(const std::string& filename, const ImageSpec* config)
+{
+    if (!Filesystem::is_url(filename))
+        return false;
+    return !(config && config->find_attribute("oiio:ioproxy", TypeDesc::PTR));
+}
+
+
+
+std::unique_ptr<Filesystem::IOProxy>
+pvt::open_url_ioproxy(const std::string& filename, const ImageSpec* config,
+                      ImageSpec& newconfig)
+{
+    std::unique_ptr<Filesystem::IOProxy> io(Filesystem::open_url(filename));
+    if (!io) {
+        errorf("Could not open \"%s\"", filename);
+        return io;
+    }
+    if (config)
+        newconfig = *config;
+    void* ptr = io.get();
+    newconfig.attribute("oiio:ioproxy", TypeDesc::PTR, &ptr);
+    return io;
+}
+
+
+
 // Default implementation of valid_file: try to do a full open.  If it
 // succeeds, it's the right kind of file.  We assume that most plugins
 // will override this with something smarter and much less expensive,
@@ -101,6 +140,18 @@ ImageInput::valid_file(const std::string& filename) const
 std::unique_ptr<ImageInput>
 ImageInput::open(const std::string& filename, const ImageSpec* config)
 {
+    if (wants_url_ioproxy(filename, config)) {
+        // Read the URL through a proxy that the ImageInput will own.
+        ImageSpec urlconfig;
+        auto io = open_url_ioproxy(filename, config, urlconfig);
+        if (!io)
+            return unique_ptr();
+        auto in = open(filename, &urlconfig);
+        if (in)
+            in->adopt_ioproxy(io.release());
+        return in;
+    }
+
     if (!config) {
         // Without config, this is really just a call to create-with-open.
         return ImageInput::create(filename, true, nullptr, std::string());
@@ -257,6 +308,7 @@ ImageInput::read_scanlines(int subimage, int miplevel, int ybegin, int yend,
                            int z, int chbegin, int chend, TypeDesc format,
                            void* data, stride_t xstride, stride_t ystride)
 {
+    OIIO_TRACE_SPAN("ImageInput::read_scanlines", format_name());
     ImageSpec spec = spec_dimensions(subimage, miplevel);  // thread-safe
     if (spec.undefined())
         return false;
@@ -543,6 +595,7 @@ ImageInput::read_tiles(int subimage, int miplevel, int xbegin, int xend,
                        int chend, TypeDesc format, void* data, stride_t xstride,
                        stride_t ystride, stride_t zstride)
 {
+    OIIO_TRACE_SPAN("ImageInput::read_tiles", format_name());
     ImageSpec spec = spec_dimensions(subimage, miplevel);  // thread-safe
     if (spec.undefined())
         return false;
@@ -865,6 +918,7 @@ ImageInput::read_image(int subimage, int miplevel, int chbegin, int chend,
                        ProgressCallback progress_callback,
                        void* progress_callback_data)
 {
+    OIIO_TRACE_SPAN("ImageInput::read_image", format_name());
     ImageSpec spec;
     int rps = 0;
     {
@@ -925,17 +979,61 @@ ImageInput::read_image(int subimage, int miplevel, int chbegin, int chend,
         int chunk = std::max(1, (1 << 26) / int(spec.scanline_bytes(true)));
         chunk     = std::max(chunk, int(oiio_read_chunk));
         chunk     = round_to_multiple(chunk, rps);
-        for (int z = 0; z < spec.depth; ++z) {
-            for (int y = 0; y < spec.height && ok; y += chunk) {
-                int yend = std::min(y + spec.y + chunk, spec.y + spec.height);
-                ok &= read_scanlines(y + spec.y, yend, z + spec.z, chbegin,
-                                     chend, format,
-                                     (char*)data + z * zstride + y * ystride,
-                                     xstride, ystride);
-                if (progress_callback)
-                    if (progress_callback(progress_callback_data,
-                                          (float)y / spec.height))
-                        return ok;
+        // A reader that can read several ranges of scanlines at once gets
+        // its chunks read and converted in parallel. Make enough of them to
+        // keep the threads busy, and still make the progress callbacks in
+        // order, from this thread.
+        int nthreads = threads() ? threads() : int(oiio_threads);
+        if (nthreads <= 0)
+            nthreads = int(Sysutil::hardware_concurrency());
+        if (nthreads > 1 && spec.height > rps
+            && supports("concurrent_scanlines")) {
+            int perthread = (spec.height + 2 * nthreads - 1) / (2 * nthreads);
+            chunk = std::min(chunk, round_to_multiple(perthread, rps));
+            int nychunks = (spec.height + chunk - 1) / chunk;
+            std::atomic<bool> allok(true), cancel(false);
+            parallel_for_ordered(
+                0, int64_t(nychunks) * spec.depth,
+                [&](int64_t i) {
+                    if (cancel || !allok)
+                        return;
+                    int z    = int(i / nychunks);
+                    int y    = int(i % nychunks) * chunk;
+                    int yend = std::min(y + spec.y + chunk,
+                                        spec.y + spec.height);
+                    if (!read_scanlines(subimage, miplevel, y + spec.y, yend,
+                                        z + spec.z, chbegin, chend, format,
+                                        (char*)data + z * zstride
+                                            + y * ystride,
+                                        xstride, ystride))
+                        allok = false;
+                },
+                [&](int64_t i) {
+                    if (progress_callback && !cancel && allok
+                        && progress_callback(progress_callback_data,
+                                             float(i % nychunks * chunk)
+                                                 / spec.height))
+                        cancel = true;
+                },
+                nthreads);
+            if (cancel)
+                return true;
+            ok = allok;
+        } else {
+            for (int z = 0; z < spec.depth; ++z) {
+                for (int y = 0; y < spec.height && ok; y += chunk) {
+                    int yend = std::min(y + spec.y + chunk,
+                                        spec.y + spec.height);
+                    ok &= read_scanlines(y + spec.y, yend, z + spec.z,
+                                         chbegin, chend, format,
+                                         (char*)data + z * zstride
+                                             + y * ystride,
+                                         xstride, ystride);
+                    if (progress_callback)
+                        if (progress_callback(progress_callback_data,
+                                              (float)y / spec.height))
+                            return ok;
+                }
             }
         }
     }
@@ -1000,6 +1098,36 @@ ImageInput::read_native_deep_image(int subimage, int miplevel,
 
 
 
+bool
+ImageInput::native_tile_offset(int /*subimage*/, int /*miplevel*/, int /*x*/,
+                               int /*y*/, int /*z*/, imagesize_t& /*offset*/)
+{
+    return false;
+}
+
+
+
+bool
+ImageInput::native_tile_constant(int /*subimage*/, int /*miplevel*/,
+                                 int /*x*/, int /*y*/, int /*z*/,
+                                 void* /*value*/)
+{
+    return false;
+}
+
+
+
+bool
+ImageInput::read_native_subimages(int n, const int* subimages, void** data)
+{
+    for (int i = 0; i < n; ++i)
+        if (!read_image(subimages[i], 0, 0, -1, TypeDesc::UNKNOWN, data[i]))
+            return false;
+    return true;
+}
+
+
+
 int
 ImageInput::send_to_input(const char* format, ...)
 {
@@ -45,9 +45,11 @@
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
 #include <OpenImageIO/timer.h>
+#include <OpenImageIO/trace.h>
 #include <OpenImageIO/typedesc.h>
 
 #include "imageio_pvt.h"
+#include "simd_kernels.h"
 
 OIIO_NAMESPACE_BEGIN
 
@@ -68,7 +70,10 @@ atomic_int oiio_exr_threads(threads_default());
 atomic_int oiio_read_chunk(256);
 int tiff_half(0);
 int tiff_multithread(1);
+int png_multithread(1);
 ustring plugin_searchpath(OIIO_DEFAULT_PLUGIN_SEARCHPATH);
+int oiio_plugin_manifest(1);
+ustring color_precompile;
 std::string format_list;         // comma-separated list of all formats
 std::string input_format_list;   // comma-separated list of readable formats
 std::string output_format_list;  // comma-separated list of writeable formats
@@ -291,6 +296,13 @@ attribute(string_view name, TypeDesc type, const void* val)
         default_thread_pool()->resize(ot - 1);
         return true;
     }
+    if (name == "background_threads" && type == TypeInt) {
+        int bt = Imath::clamp(*(const int*)val, 0, maxthreads);
+        if (bt == 0)
+            bt = std::max(2, threads_default() / 4);
+        background_thread_pool()->resize(bt);
+        return true;
+    }
     spin_lock lock(attrib_mutex);
     if (name == "read_chunk" && type == TypeInt) {
         oiio_read_chunk = *(const int*)val;
@@ -300,6 +312,14 @@ attribute(string_view name, TypeDesc type, const void* val)
         plugin_searchpath = ustring(*(const char**)val);
         return true;
     }
+    if (name == "plugin_manifest" && type == TypeInt) {
+        oiio_plugin_manifest = *(const int*)val;
+        return true;
+    }
+    if (name == "color:precompile" && type == TypeString) {
+        color_precompile = ustring(*(const char**)val);
+        return true;
+    }
     if (name == "exr_threads" && type == TypeInt) {
         oiio_exr_threads = Imath::clamp(*(const int*)val, -1, maxthreads);
         return true;
@@ -312,6 +332,10 @@ attribute(string_view name, TypeDesc type, const void* val)
         tiff_multithread = *(const int*)val;
         return true;
     }
+    if (name == "png:multithread" && type == TypeInt) {
+        png_multithread = *(const int*)val;
+        return true;
+    }
     if (name == "debug" && type == TypeInt) {
         oiio_print_debug = *(const int*)val;
         return true;
@@ -320,6 +344,17 @@ attribute(string_view name, TypeDesc type, const void* val)
         oiio_log_times = *(const int*)val;
         return true;
     }
+    if (name == "trace_file" && type == TypeString) {
+        const char* filename = *(const char**)val;
+        return filename && filename[0] ? Trace::start(filename)
+                                       : Trace::stop();
+    }
+    if (name == "trace_buffer_size" && type == TypeInt) {
+        Trace::buffer_size(*(const int*)val);
+        return true;
+    }
+    if (Strutil::starts_with(name, "imagebuf:pool"))
+        return pvt::pixelpool_attribute(name, type, val);
     return false;
 }
 
@@ -332,6 +367,10 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(int*)val = oiio_threads;
         return true;
     }
+    if (name == "background_threads" && type == TypeInt) {
+        *(int*)val = background_thread_pool()->size();
+        return true;
+    }
     spin_lock lock(attrib_mutex);
     if (name == "read_chunk" && type == TypeInt) {
         *(int*)val = oiio_read_chunk;
@@ -341,6 +380,14 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(ustring*)val = plugin_searchpath;
         return true;
     }
+    if (name == "plugin_manifest" && type == TypeInt) {
+        *(int*)val = oiio_plugin_manifest;
+        return true;
+    }
+    if (name == "color:precompile" && type == TypeString) {
+        *(ustring*)val = color_precompile;
+        return true;
+    }
     if (name == "format_list" && type == TypeString) {
         if (format_list.empty())
             pvt::catalog_all_plugins(plugin_searchpath.string());
@@ -383,6 +430,10 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(int*)val = tiff_multithread;
         return true;
     }
+    if (name == "png:multithread" && type == TypeInt) {
+        *(int*)val = png_multithread;
+        return true;
+    }
     if (name == "debug" && type == TypeInt) {
         *(int*)val = oiio_print_debug;
         return true;
@@ -391,6 +442,14 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(int*)val = oiio_log_times;
         return true;
     }
+    if (name == "trace_file" && type == TypeString) {
+        *(ustring*)val = ustring(Trace::filename());
+        return true;
+    }
+    if (name == "trace_buffer_size" && type == TypeInt) {
+        *(int*)val = Trace::buffer_size();
+        return true;
+    }
     if (name == "timing_report" && type == TypeString) {
         *(ustring*)val = ustring(timing_log.report());
         return true;
@@ -403,10 +462,16 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(ustring*)val = ustring(oiio_simd_caps());
         return true;
     }
+    if (name == "oiio:simd_dispatch" && type == TypeString) {
+        *(ustring*)val = ustring(pvt::simd_kernels().isa);
+        return true;
+    }
     if (name == "resident_memory_used_MB" && type == TypeInt) {
         *(int*)val = int(Sysutil::memory_used(true) >> 20);
         return true;
     }
+    if (Strutil::starts_with(name, "imagebuf:pool"))
+        return pvt::pixelpool_getattribute(name, type, val);
     return false;
 }
 
@@ -509,17 +574,21 @@ pvt::convert_to_float(const void* src, float* dst, int nvals, TypeDesc format)
     switch (format.basetype) {
     case TypeDesc::FLOAT: return (float*)src;
     case TypeDesc::UINT8:
-        convert_type((const unsigned char*)src, dst, nvals);
+        simd_kernels().uint8_to_float((const uint8_t*)src, dst, nvals);
+        break;
+    case TypeDesc::HALF:
+        simd_kernels().half_to_float((const half*)src, dst, nvals);
         break;
-    case TypeDesc::HALF: convert_type((const half*)src, dst, nvals); break;
     case TypeDesc::UINT16:
-        convert_type((const unsigned short*)src, dst, nvals);
+        simd_kernels().uint16_to_float((const uint16_t*)src, dst, nvals);
         break;
     case TypeDesc::INT8: convert_type((const char*)src, dst, nvals); break;
-    case TypeDesc::INT16: convert_type((const short*)src, dst, nvals); break;
+    case TypeDesc::INT16:
+        simd_kernels().int16_to_float((const int16_t*)src, dst, nvals);
+        break;
     case TypeDesc::INT: convert_type((const int*)src, dst, nvals); break;
     case TypeDesc::UINT:
-        convert_type((const unsigned int*)src, dst, nvals);
+        simd_kernels().uint32_to_float((const uint32_t*)src, dst, nvals);
         break;
     case TypeDesc::INT64:
         convert_type((const long long*)src, dst, nvals);
@@ -621,36 +690,51 @@ convert_types(TypeDesc src_type, const void* src, TypeDesc dst_type, void* dst,
         return true;
     }
 
-    // Conversion is to a non-float type
+    // uint8 <-> uint16 needn't go through float at all
+    const pvt::SimdKernels& kernels(pvt::simd_kernels());
+    if (src_type.basetype == TypeDesc::UINT8
+        && dst_type.basetype == TypeDesc::UINT16) {
+        kernels.uint8_to_uint16((const uint8_t*)src, (uint16_t*)dst, n);
+        return true;
+    }
+    if (src_type.basetype == TypeDesc::UINT16
+        && dst_type.basetype == TypeDesc::UINT8) {
+        kernels.uint16_to_uint8((const uint16_t*)src, (uint8_t*)dst, n);
+        return true;
+    }
 
-    std::unique_ptr<float[]> tmp;  // In case we need a lot of temp space
-    float* buf = (float*)src;
-    if (src_type != TypeFloat) {
-        // If src is also not float, convert through an intermediate buffer
-        if (n <= 4096)  // If < 16k, use the stack
-            buf = ALLOCA(float, n);
-        else {
-            tmp.reset(new float[n]);  // Freed when tmp exists its scope
-            buf = tmp.get();
+    // Conversion is to a non-float type. If src is also not float, convert
+    // through float a chunk at a time, small enough that the intermediate
+    // values are still in cache when they're converted again.
+    const int chunk = 1024;
+    float buf[chunk];
+    size_t src_size = src_type.basesize(), dst_size = dst_type.basesize();
+    for (int b = 0; b < n; b += chunk) {
+        int nb = std::min(chunk, n - b);
+        const float* f
+            = src_type.basetype == TypeDesc::FLOAT
+                  ? (const float*)src + b
+                  : pvt::convert_to_float((const char*)src + b * src_size,
+                                          buf, nb, src_type);
+        void* d = (char*)dst + b * dst_size;
+        // Convert float to 'dst_type'
+        switch (dst_type.basetype) {
+        case TypeDesc::UINT8: kernels.float_to_uint8(f, (uint8_t*)d, nb); break;
+        case TypeDesc::UINT16:
+            kernels.float_to_uint16(f, (uint16_t*)d, nb);
+            break;
+        case TypeDesc::HALF: kernels.float_to_half(f, (half*)d, nb); break;
+        case TypeDesc::INT8: convert_type(f, (char*)d, nb); break;
+        case TypeDesc::INT16: kernels.float_to_int16(f, (int16_t*)d, nb); break;
+        case TypeDesc::INT: convert_type(f, (int*)d, nb); break;
+        case TypeDesc::UINT: convert_type(f, (unsigned int*)d, nb); break;
+        case TypeDesc::INT64: convert_type(f, (long long*)d, nb); break;
+        case TypeDesc::UINT64:
+            convert_type(f, (unsigned long long*)d, nb);
+            break;
+        case TypeDesc::DOUBLE: convert_type(f, (double*)d, nb); break;
+        default: return false;  // unknown format
         }
-        pvt::convert_to_float(src, buf, n, src_type);
-    }
-
-    // Convert float to 'dst_type'
-    switch (dst_type.basetype) {
-    case TypeDesc::UINT8: convert_type(buf, (unsigned char*)dst, n); break;
-    case TypeDesc::UINT16: convert_type(buf, (unsigned short*)dst, n); break;
-    case TypeDesc::HALF: convert_type(buf, (half*)dst, n); break;
-    case TypeDesc::INT8: convert_type(buf, (char*)dst, n); break;
-    case TypeDesc::INT16: convert_type(buf, (short*)dst, n); break;
-    case TypeDesc::INT: convert_type(buf, (int*)dst, n); break;
-    case TypeDesc::UINT: convert_type(buf, (unsigned int*)dst, n); break;
-    case TypeDesc::INT64: convert_type(buf, (long long*)dst, n); break;
-    case TypeDesc::UINT64:
-        convert_type(buf, (unsigned long long*)dst, n);
-        break;
-    case TypeDesc::DOUBLE: convert_type(buf, (double*)dst, n); break;
-    default: return false;  // unknown format
     }
 
     return true;
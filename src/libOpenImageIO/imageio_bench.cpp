@@ -0,0 +1,330 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+// Measure how fast each available file format plugin encodes and decodes,
+// and how well it compresses, for each of its compression modes and a
+// range of thread counts, on a synthetic image or on images supplied on
+// the command line. Files are written and read the way ImageBuf does it,
+// with whole-image write_scanlines/write_tiles and read_scanlines/
+// read_tiles calls.
+
+
+#include <OpenImageIO/argparse.h>
+#include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/ustring.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace OIIO;
+
+static bool verbose   = false;
+static int ntrials    = 3;
+static int res        = 2048;
+static int autotile   = 0;
+static std::string threadlist;
+static std::string formatlist;
+static std::string conversionname;
+static TypeDesc conversion = TypeDesc::UNKNOWN;  // native by default
+static std::vector<std::string> input_filename;
+static std::string scratchdir = "imageio_bench_files";
+
+
+
+// One way of writing a file: a format, its data type, and the attributes
+// that select the compression mode.
+struct Codec {
+    const char* format;     // file extension
+    const char* datatype;   // data format to write
+    const char* name;       // for the report
+    const char* attrname;   // attribute that sets the mode, if any
+    const char* attrvalue;  // as a string; ints are converted
+};
+
+// clang-format off
+static const Codec codecs[] = {
+    { "exr", "half",   "none",  "compression", "none" },
+    { "exr", "half",   "zip",   "compression", "zip" },
+    { "exr", "half",   "zips",  "compression", "zips" },
+    { "exr", "half",   "piz",   "compression", "piz" },
+    { "exr", "half",   "dwaa",  "compression", "dwaa" },
+    { "exr", "float",  "zip",   "compression", "zip" },
+    { "tif", "uint16", "none",  "compression", "none" },
+    { "tif", "uint16", "zip",   "compression", "zip" },
+    { "tif", "uint16", "lzw",   "compression", "lzw" },
+    { "tif", "uint8",  "zip",   "compression", "zip" },
+    { "png", "uint8",  "z1",    "png:compressionLevel", "1" },
+    { "png", "uint8",  "z6",    "png:compressionLevel", "6" },
+    { "png", "uint8",  "z9",    "png:compressionLevel", "9" },
+    { "png", "uint16", "z6",    "png:compressionLevel", "6" },
+    { "jpg", "uint8",  "q50",   "CompressionQuality", "50" },
+    { "jpg", "uint8",  "q90",   "CompressionQuality", "90" },
+    { "jpg", "uint8",  "q98",   "CompressionQuality", "98" },
+    { "dpx", "uint16", "-",     nullptr, nullptr },
+    { "sgi", "uint8",  "rle",   "compression", "rle" },
+    { "tga", "uint8",  "rle",   "compression", "rle" },
+    { "webp", "uint8", "q90",   "CompressionQuality", "90" },
+    { "jp2", "uint16", "-",     nullptr, nullptr },
+};
+// clang-format on
+
+
+
+static int
+parse_files(int argc, const char* argv[])
+{
+    input_filename.emplace_back(argv[0]);
+    return 0;
+}
+
+
+
+static void
+getargs(int argc, char* argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    // clang-format off
+    ap.options(
+        "imageio_bench\n" OIIO_INTRO_STRING "\n"
+        "Usage:  imageio_bench [options] [filename...]",
+        "%*", parse_files, "",
+        "--help", &help, "Print help message",
+        "-v", &verbose, "Verbose mode (also keeps the files written)",
+        "--threads %s", &threadlist,
+            "Comma-separated thread counts to try (default: 1 and all cores)",
+        "--formats %s", &formatlist,
+            "Comma-separated formats to test (default: all available)",
+        "--trials %d", &ntrials,
+            ustring::sprintf("Number of trials (default: %d)", ntrials).c_str(),
+        "--res %d", &res,
+            ustring::sprintf("Resolution of the synthetic image (default: %d)", res).c_str(),
+        "--autotile %d", &autotile,
+            "Write tiles of this size, where the format can (default: scanlines)",
+        "--convert %s", &conversionname,
+            "Convert to named type upon read (default: native)",
+        "--dir %s", &scratchdir, "Directory for the files written",
+        nullptr);
+    // clang-format on
+    if (ap.parse(argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage();
+        exit(EXIT_FAILURE);
+    }
+    if (conversionname.size())
+        conversion = TypeDesc(conversionname);
+}
+
+
+
+// Smooth gradients with a little grain: neither as kind to the
+// compressors as a flat image, nor as hard as pure noise.
+static ImageBuf
+synthetic_image()
+{
+    ImageBuf img(ImageSpec(res, res, 4, TypeDesc::FLOAT));
+    ImageBufAlgo::fill(img, { 0.1f, 0.2f, 0.8f, 1.0f },
+                       { 0.9f, 0.3f, 0.2f, 1.0f }, { 0.2f, 0.8f, 0.1f, 1.0f },
+                       { 0.7f, 0.7f, 0.7f, 1.0f });
+    ImageBufAlgo::noise(img, "gaussian", 0.0f, 0.02f, false, 0,
+                        ROI(0, res, 0, res, 0, 1, 0, 3));
+    ImageBufAlgo::clamp(img, img, 0.0f, 1.0f);
+    img.specmod().channelnames = { "R", "G", "B", "A" };
+    return img;
+}
+
+
+
+// Time the encoding and decoding of img with this codec, and print the
+// results for each thread count.
+static void
+bench_codec(const ImageBuf& img, string_view imgname, const Codec& codec,
+            const std::vector<int>& threadcounts)
+{
+    std::string filename = Strutil::sprintf("%s/%s_%s_%s.%s", scratchdir,
+                                            imgname, codec.datatype,
+                                            codec.name, codec.format);
+    auto probe = ImageOutput::create(filename);
+    if (!probe)
+        return;  // Plugin not available in this build
+    ImageSpec spec = img.spec();
+    spec.set_format(TypeDesc(codec.datatype));
+    if (codec.attrname) {
+        if (Strutil::string_is_int(codec.attrvalue))
+            spec.attribute(codec.attrname, Strutil::stoi(codec.attrvalue));
+        else
+            spec.attribute(codec.attrname, codec.attrvalue);
+    }
+    if (!probe->supports("alpha") && spec.nchannels > 3)
+        spec.nchannels = 3;  // JPEG and the like
+    spec.channelnames.resize(spec.nchannels);
+    bool tiled = autotile > 0 && probe->supports("tiles");
+    if (tiled) {
+        spec.tile_width  = autotile;
+        spec.tile_height = autotile;
+        spec.tile_depth  = 1;
+    }
+    probe.reset();
+
+    // The source pixels, as float, for the channels being written
+    std::vector<float> pixels(spec.image_pixels() * spec.nchannels);
+    img.get_pixels(ROI(spec.x, spec.x + spec.width, spec.y,
+                       spec.y + spec.height, 0, 1, 0, spec.nchannels),
+                   TypeDesc::FLOAT, pixels.data());
+    double rawmb = spec.image_bytes() / double(1 << 20);
+    std::vector<char> readbuf;
+    bool ok = true;
+
+    auto encode = [&]() {
+        auto out = ImageOutput::create(filename);
+        if (!out || !out->open(filename, spec)) {
+            ok = false;
+            return;
+        }
+        if (tiled)
+            ok &= out->write_tiles(spec.x, spec.x + spec.width, spec.y,
+                                   spec.y + spec.height, 0, 1, TypeDesc::FLOAT,
+                                   pixels.data());
+        else
+            ok &= out->write_scanlines(spec.y, spec.y + spec.height, 0,
+                                       TypeDesc::FLOAT, pixels.data());
+        ok &= out->close();
+    };
+    auto decode = [&]() {
+        auto in = ImageInput::open(filename);
+        if (!in) {
+            ok = false;
+            return;
+        }
+        const ImageSpec& s(in->spec());
+        TypeDesc format = conversion.basetype == TypeDesc::UNKNOWN
+                              ? s.format
+                              : conversion;
+        readbuf.resize(s.image_pixels() * s.nchannels * format.size());
+        if (s.tile_width)
+            ok &= in->read_tiles(0, 0, s.x, s.x + s.width, s.y,
+                                 s.y + s.height, s.z, s.z + s.depth, 0,
+                                 s.nchannels, format, readbuf.data());
+        else
+            ok &= in->read_scanlines(0, 0, s.y, s.y + s.height, s.z, 0,
+                                     s.nchannels, format, readbuf.data());
+        in->close();
+    };
+
+    Benchmarker bench;
+    bench.iterations(1).trials(ntrials).verbose(0);
+    for (int nthreads : threadcounts) {
+        OIIO::attribute("threads", nthreads);
+        OIIO::attribute("exr_threads", nthreads);
+        ok           = true;
+        double enc   = bench("encode", encode);
+        double dec   = bench("decode", decode);
+        double ratio = rawmb * (1 << 20) / Filesystem::file_size(filename);
+        if (!ok) {
+            std::cout << Strutil::sprintf("  %-5s %-6s %-5s  failed\n",
+                                          codec.format, codec.datatype,
+                                          codec.name);
+            return;
+        }
+        std::cout << Strutil::sprintf(
+            "  %-5s %-6s %-5s %s %3d threads: encode %7.1f MB/s, "
+            "decode %7.1f MB/s, ratio %5.2f\n",
+            codec.format, codec.datatype, codec.name, tiled ? "tiled" : "     ",
+            nthreads, rawmb / enc, rawmb / dec, ratio);
+    }
+}
+
+
+
+int
+main(int argc, char** argv)
+{
+    getargs(argc, argv);
+
+    std::vector<int> threadcounts;
+    for (auto t : Strutil::splits(threadlist, ","))
+        threadcounts.push_back(std::max(1, Strutil::stoi(t)));
+    if (threadcounts.empty()) {
+        threadcounts.push_back(1);
+        if (Sysutil::hardware_concurrency() > 1)
+            threadcounts.push_back(Sysutil::hardware_concurrency());
+    }
+    std::vector<std::string> formats = Strutil::splits(formatlist, ",");
+
+    Filesystem::remove_all(scratchdir);
+    Filesystem::create_directory(scratchdir);
+
+    // The images to test: the ones given, or else a synthetic one
+    std::vector<std::pair<std::string, ImageBuf>> images;
+    for (auto& f : input_filename) {
+        ImageBuf img(f);
+        if (!img.read(0, 0, true, TypeDesc::FLOAT)) {
+            std::cerr << "Could not read " << f << ": " << img.geterror()
+                      << "\n";
+            continue;
+        }
+        images.emplace_back(Filesystem::filename(f), img);
+    }
+    if (input_filename.empty())
+        images.emplace_back("synthetic", synthetic_image());
+
+    int saved_threads = 0, saved_exr_threads = 0;
+    OIIO::getattribute("threads", saved_threads);
+    OIIO::getattribute("exr_threads", saved_exr_threads);
+    for (auto& image : images) {
+        const ImageSpec& spec(image.second.spec());
+        std::cout << image.first << ": " << spec.width << " x " << spec.height
+                  << ", " << spec.nchannels << " channels\n";
+        for (const Codec& codec : codecs) {
+            if (formats.size()
+                && std::find(formats.begin(), formats.end(), codec.format)
+                       == formats.end())
+                continue;
+            bench_codec(image.second, image.first, codec, threadcounts);
+        }
+    }
+    OIIO::attribute("threads", saved_threads);
+    OIIO::attribute("exr_threads", saved_exr_threads);
+
+    if (!verbose)
+        Filesystem::remove_all(scratchdir);
+    return 0;
+}
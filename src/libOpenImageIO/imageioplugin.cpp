@@ -28,9 +28,13 @@
   (This is the Modified BSD License)
 */
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -66,6 +70,41 @@ static std::map<std::string, Plugin::Handle> plugin_handles;
 static std::map<std::string, std::string> plugin_filepaths;
 // Map format name to underlying implementation library
 static std::map<std::string, std::string> format_library_versions;
+// Map format name to full path, for plugins listed in a manifest that
+// haven't been loaded yet
+static std::map<std::string, std::string> deferred_plugins;
+// Map file extension to format name, for the deferred plugins
+static std::map<std::string, std::string> deferred_input_extensions;
+static std::map<std::string, std::string> deferred_output_extensions;
+// Formats already added to format_list et al.
+static std::vector<std::string> listed_formats;
+// Searchpaths that catalog_all_plugins has already scanned
+static std::vector<std::string> cataloged_searchpaths;
+static bool builtins_cataloged = false;
+
+// An immutable copy of input_formats and output_formats, republished
+// after they change, so that looking up an extension that's already known
+// (the usual case) takes no lock. Superseded copies are kept, since a
+// reader may still hold one; there are only ever a handful.
+struct FormatTable {
+    InputPluginMap input;
+    OutputPluginMap output;
+};
+static std::atomic<const FormatTable*> format_table(nullptr);
+static std::vector<std::unique_ptr<FormatTable>> format_tables;
+static bool format_table_dirty = true;
+
+// A plugin's line in the manifest of its directory.
+struct ManifestEntry {
+    std::string format, filename;
+    bool has_input = false, has_output = false;
+    std::vector<std::string> input_extensions, output_extensions;
+    std::string lib_version;
+};
+
+static const char* manifest_name = "imageio.manifest";
+static std::string manifest_header
+    = Strutil::sprintf("# OpenImageIO plugin manifest %d", OIIO_PLUGIN_VERSION);
 
 
 
@@ -80,10 +119,168 @@ add_if_missing(std::vector<std::string>& vec, const std::string& val)
         vec.push_back(val);
 }
 
+
+
+// Signatures ("magic numbers") of the formats that have them: the bytes
+// found at a given offset from the start of the file, and an extension
+// that the format's reader is registered under. Used to guess the format
+// of a file whose extension is missing or wrong, from one small read,
+// rather than asking every plugin to try opening it.
+struct FormatSignature {
+    const char* ext;
+    int offset;
+    const char* magic;
+    int len;
+};
+
+// clang-format off
+static const FormatSignature format_signatures[] = {
+    { "exr",   0,   "\x76\x2f\x31\x01", 4 },
+    { "tif",   0,   "II*\x00", 4 },
+    { "tif",   0,   "MM\x00*", 4 },
+    { "tif",   0,   "II+\x00", 4 },   // BigTIFF
+    { "tif",   0,   "MM\x00+", 4 },
+    { "png",   0,   "\x89PNG\r\n\x1a\n", 8 },
+    { "jpg",   0,   "\xff\xd8\xff", 3 },
+    { "jp2",   0,   "\x00\x00\x00\x0cjP  \r\n\x87\n", 12 },
+    { "j2k",   0,   "\xff\x4f\xff\x51", 4 },
+    { "dpx",   0,   "SDPX", 4 },
+    { "dpx",   0,   "XPDS", 4 },
+    { "cin",   0,   "\x80\x2a\x5f\xd7", 4 },
+    { "cin",   0,   "\xd7\x5f\x2a\x80", 4 },
+    { "gif",   0,   "GIF8", 4 },
+    { "rgbe",  0,   "#?RADIANCE", 10 },
+    { "rgbe",  0,   "#?RGBE", 6 },
+    { "psd",   0,   "8BPS", 4 },
+    { "dds",   0,   "DDS ", 4 },
+    { "fits",  0,   "SIMPLE", 6 },
+    { "webp",  8,   "WEBP", 4 },
+    { "iff",   8,   "CIMG", 4 },
+    { "sgi",   0,   "\x01\xda", 2 },
+    { "pic",   0,   "\x53\x80\xf6\x34", 4 },
+    { "zfile", 0,   "\x2f\x08\x67\xab", 4 },
+    { "zfile", 0,   "\xab\x67\x08\x2f", 4 },
+    { "ptex",  0,   "Ptex", 4 },
+    { "vdb",   0,   " BDV", 4 },
+    { "f3d",   0,   "\x89HDF\r\n\x1a\n", 8 },
+    { "dcm",   128, "DICM", 4 },
+    { "bmp",   0,   "BM", 2 },
+    { "ico",   0,   "\x00\x00\x01\x00", 4 },
+    { "pnm",   0,   "P1", 2 },
+    { "pnm",   0,   "P2", 2 },
+    { "pnm",   0,   "P3", 2 },
+    { "pnm",   0,   "P4", 2 },
+    { "pnm",   0,   "P5", 2 },
+    { "pnm",   0,   "P6", 2 },
+    { "pnm",   0,   "PF", 2 },
+    { "pnm",   0,   "Pf", 2 },
+};
+// clang-format on
+
+static const size_t signature_bytes = 132;  // enough for all of the above
+
+
+
+// Read the first few bytes of the file (or of the IOProxy given by the
+// config, if any) into header, returning how many were read.
+static size_t
+read_header(const std::string& filename, const ImageSpec* config,
+            unsigned char* header)
+{
+    const ParamValue* p = config ? config->find_attribute("oiio:ioproxy",
+                                                          TypeDesc::PTR)
+                                 : nullptr;
+    if (p) {
+        Filesystem::IOProxy* io = p->get<Filesystem::IOProxy*>();
+        return io ? io->pread(header, signature_bytes, 0) : 0;
+    }
+    return Filesystem::read_bytes(filename, header, signature_bytes);
+}
+
+
+
+// Order all the known input plugins for trying to open a file, given the
+// first bytes of it: those whose signature matches come first, then the
+// ones for formats without signatures, and last the ones whose signature
+// is known not to match (in case of an unusual variant). Should only be
+// called while imageio_mutex is held.
+static std::vector<ImageInput::Creator>
+plugins_by_signature(const unsigned char* header, size_t len)
+{
+    std::vector<ImageInput::Creator> matched, unsigned_fmts, mismatched;
+    std::vector<ImageInput::Creator> signed_fmts;
+    for (auto&& sig : format_signatures) {
+        auto found = input_formats.find(sig.ext);
+        if (found == input_formats.end())
+            continue;  // that plugin isn't available
+        signed_fmts.push_back(found->second);
+        if (size_t(sig.offset + sig.len) <= len
+            && !memcmp(header + sig.offset, sig.magic, sig.len)
+            && std::find(matched.begin(), matched.end(), found->second)
+                   == matched.end())
+            matched.push_back(found->second);
+    }
+    for (auto&& plugin : input_formats) {
+        auto& list = std::find(signed_fmts.begin(), signed_fmts.end(),
+                               plugin.second)
+                             == signed_fmts.end()
+                         ? unsigned_fmts
+                         : mismatched;
+        if (std::find(matched.begin(), matched.end(), plugin.second)
+                == matched.end()
+            && std::find(list.begin(), list.end(), plugin.second)
+                   == list.end())
+            list.push_back(plugin.second);
+    }
+    matched.insert(matched.end(), unsigned_fmts.begin(), unsigned_fmts.end());
+    matched.insert(matched.end(), mismatched.begin(), mismatched.end());
+    return matched;
+}
+
 }  // namespace
 
 
 
+// Add a format to the master lists of format names, extensions, and
+// libraries, if it isn't already there. Should only be called while
+// imageio_mutex is held.
+static void
+add_to_format_lists(const std::string& format_name, bool input, bool output,
+                    const std::vector<std::string>& all_extensions,
+                    const char* lib_version)
+{
+    if (std::find(listed_formats.begin(), listed_formats.end(), format_name)
+        != listed_formats.end())
+        return;
+    listed_formats.push_back(format_name);
+    if (format_list.length())
+        format_list += std::string(",");
+    format_list += format_name;
+    if (input) {
+        if (input_format_list.length())
+            input_format_list += std::string(",");
+        input_format_list += format_name;
+    }
+    if (output) {
+        if (output_format_list.length())
+            output_format_list += std::string(",");
+        output_format_list += format_name;
+    }
+    if (extension_list.length())
+        extension_list += std::string(";");
+    extension_list += format_name + std::string(":");
+    extension_list += Strutil::join(all_extensions, ",");
+    if (lib_version && *lib_version) {
+        format_library_versions[format_name] = lib_version;
+        if (library_list.length())
+            library_list += std::string(";");
+        library_list += Strutil::sprintf("%s:%s", format_name, lib_version);
+        // std::cout << format_name << ": " << lib_version << "\n";
+    }
+}
+
+
+
 /// Register the input and output 'create' routine and list of file
 /// extensions for a particular format.
 void
@@ -93,13 +290,13 @@ declare_imageio_format(const std::string& format_name,
                        ImageOutput::Creator output_creator,
                        const char** output_extensions, const char* lib_version)
 {
+    recursive_lock_guard lock(pvt::imageio_mutex);
     std::vector<std::string> all_extensions;
     // Look for input creator and list of supported extensions
     if (input_creator) {
         if (input_formats.find(format_name) != input_formats.end()) {
             input_formats[format_name] = input_creator;
         }
-        std::string extsym = format_name + "_input_extensions";
         for (const char** e = input_extensions; e && *e; ++e) {
             std::string ext(*e);
             Strutil::to_lower(ext);
@@ -124,60 +321,48 @@ declare_imageio_format(const std::string& format_name,
             }
         }
     }
+    format_table_dirty = true;
 
     // Add the name to the master list of format_names, and extensions to
     // their master list.
-    recursive_lock_guard lock(pvt::imageio_mutex);
-    if (format_list.length())
-        format_list += std::string(",");
-    format_list += format_name;
-    if (input_creator) {
-        if (input_format_list.length())
-            input_format_list += std::string(",");
-        input_format_list += format_name;
-    }
-    if (output_creator) {
-        if (output_format_list.length())
-            output_format_list += std::string(",");
-        output_format_list += format_name;
-    }
-    if (extension_list.length())
-        extension_list += std::string(";");
-    extension_list += format_name + std::string(":");
-    extension_list += Strutil::join(all_extensions, ",");
-    if (lib_version) {
-        format_library_versions[format_name] = lib_version;
-        if (library_list.length())
-            library_list += std::string(";");
-        library_list += Strutil::sprintf("%s:%s", format_name, lib_version);
-        // std::cout << format_name << ": " << lib_version << "\n";
-    }
+    add_to_format_lists(format_name, input_creator != nullptr,
+                        output_creator != nullptr, all_extensions,
+                        lib_version);
 }
 
 
-static void
+/// Load a plugin and declare its formats, returning true if it was a new
+/// and usable one, in which case the details of it are also stored in
+/// *entry (if not null).  Should only be called while imageio_mutex is held.
+static bool
 catalog_plugin(const std::string& format_name,
-               const std::string& plugin_fullpath)
+               const std::string& plugin_fullpath,
+               ManifestEntry* entry = nullptr)
 {
-    // Remember the plugin
-    std::map<std::string, std::string>::const_iterator found_path;
-    found_path = plugin_filepaths.find(format_name);
-    if (found_path != plugin_filepaths.end()) {
+    // Remember the plugin (whether loaded or still deferred)
+    const std::string* found_path = nullptr;
+    auto loaded                   = plugin_filepaths.find(format_name);
+    auto deferred                 = deferred_plugins.find(format_name);
+    if (loaded != plugin_filepaths.end())
+        found_path = &loaded->second;
+    else if (deferred != deferred_plugins.end())
+        found_path = &deferred->second;
+    if (found_path) {
         // Hey, we already have an entry for this format
-        if (found_path->second == plugin_fullpath) {
+        if (*found_path == plugin_fullpath) {
             // It's ok if they're both the same file; just skip it.
-            return;
+            return false;
         }
         OIIO::debug("OpenImageIO WARNING: %s had multiple plugins:\n"
                     "\t\"%s\"\n    as well as\n\t\"%s\"\n"
                     "    Ignoring all but the first one.\n",
-                    format_name, found_path->second, plugin_fullpath);
-        return;
+                    format_name, *found_path, plugin_fullpath);
+        return false;
     }
 
     Plugin::Handle handle = Plugin::open(plugin_fullpath);
     if (!handle) {
-        return;
+        return false;
     }
 
     std::string version_function = format_name + "_imageio_version";
@@ -185,7 +370,7 @@ catalog_plugin(const std::string& format_name,
                                                version_function.c_str());
     if (!plugin_version || *plugin_version != OIIO_PLUGIN_VERSION) {
         Plugin::close(handle);
-        return;
+        return false;
     }
 
     std::string lib_version_function = format_name + "_imageio_library_version";
@@ -208,13 +393,222 @@ catalog_plugin(const std::string& format_name,
         = (const char**)Plugin::getsym(handle,
                                        format_name + "_output_extensions");
 
-    if (input_creator || output_creator)
-        declare_imageio_format(format_name, input_creator, input_extensions,
-                               output_creator, output_extensions,
-                               plugin_lib_version ? plugin_lib_version()
-                                                  : NULL);
-    else
+    if (!input_creator && !output_creator) {
         Plugin::close(handle);  // not useful
+        return false;
+    }
+    const char* lib_version = plugin_lib_version ? plugin_lib_version()
+                                                 : NULL;
+    declare_imageio_format(format_name, input_creator, input_extensions,
+                           output_creator, output_extensions, lib_version);
+    if (entry) {
+        entry->format     = format_name;
+        entry->filename   = Filesystem::filename(plugin_fullpath);
+        entry->has_input  = input_creator != nullptr;
+        entry->has_output = output_creator != nullptr;
+        for (const char** e = input_extensions; e && *e; ++e) {
+            entry->input_extensions.emplace_back(*e);
+            Strutil::to_lower(entry->input_extensions.back());
+        }
+        for (const char** e = output_extensions; e && *e; ++e) {
+            entry->output_extensions.emplace_back(*e);
+            Strutil::to_lower(entry->output_extensions.back());
+        }
+        entry->lib_version = lib_version ? lib_version : "";
+    }
+    return true;
+}
+
+
+
+/// Load the deferred plugin for the named format, if there is one.  Return
+/// true if it was loaded.  Should only be called while imageio_mutex is
+/// held.
+static bool
+load_deferred_plugin(const std::string& format_name)
+{
+    auto found = deferred_plugins.find(format_name);
+    if (found == deferred_plugins.end())
+        return false;
+    std::string fullpath = found->second;
+    deferred_plugins.erase(found);
+    for (auto* exts : { &deferred_input_extensions,
+                        &deferred_output_extensions }) {
+        for (auto e = exts->begin(); e != exts->end();) {
+            if (e->second == format_name)
+                e = exts->erase(e);
+            else
+                ++e;
+        }
+    }
+    return catalog_plugin(format_name, fullpath);
+}
+
+
+
+/// Load the deferred plugin, if any, that handles the given extension.
+/// Should only be called while imageio_mutex is held.
+static bool
+load_deferred_extension(const std::map<std::string, std::string>& exts,
+                        const std::string& ext)
+{
+    auto found = exts.find(ext);
+    if (found == exts.end())
+        return false;
+    std::string format_name = found->second;  // copy: exts will change
+    return load_deferred_plugin(format_name);
+}
+
+
+
+/// Load all the deferred plugins.  Should only be called while
+/// imageio_mutex is held.
+static void
+load_all_deferred_plugins()
+{
+    while (!deferred_plugins.empty()) {
+        std::string format_name = deferred_plugins.begin()->first;
+        load_deferred_plugin(format_name);
+    }
+}
+
+
+
+/// Read the plugin manifest of a directory, if it has a current one, and
+/// note the plugins it lists as deferred: their formats and extensions
+/// become known, but they won't be loaded until they are needed.  Entries
+/// for plugins that are missing or newer than the manifest are ignored.
+/// Return the entries that were used.  Should only be called while
+/// imageio_mutex is held.
+static std::vector<ManifestEntry>
+read_plugin_manifest(const std::string& dir)
+{
+    std::vector<ManifestEntry> entries;
+    std::string manifest = dir + "/" + manifest_name;
+    std::string text;
+    if (!Filesystem::exists(manifest)
+        || !Filesystem::read_text_file(manifest, text))
+        return entries;
+    std::time_t manifest_time = Filesystem::last_write_time(manifest);
+    std::vector<std::string> lines = Strutil::splits(text, "\n");
+    if (lines.empty() || Strutil::strip(lines[0]) != manifest_header)
+        return entries;  // written for a different plugin version
+    for (size_t i = 1; i < lines.size(); ++i) {
+        // format <tab> filename <tab> inputexts <tab> outputexts <tab> lib
+        std::vector<std::string> fields = Strutil::splits(lines[i], "\t");
+        if (fields.size() != 5 || fields[0].empty() || fields[1].empty())
+            continue;
+        std::string fullpath = dir + "/" + fields[1];
+        if (!Filesystem::exists(fullpath)
+            || Filesystem::last_write_time(fullpath) > manifest_time)
+            continue;  // stale, so it will be loaded the usual way
+        ManifestEntry entry;
+        entry.format      = fields[0];
+        entry.filename    = fields[1];
+        entry.has_input   = fields[2] != "-";
+        entry.has_output  = fields[3] != "-";
+        entry.lib_version = Strutil::strip(fields[4]);
+        if (entry.has_input)
+            Strutil::split(fields[2], entry.input_extensions, ",");
+        if (entry.has_output)
+            Strutil::split(fields[3], entry.output_extensions, ",");
+        entries.push_back(entry);
+        if (plugin_filepaths.count(entry.format)
+            || deferred_plugins.count(entry.format))
+            continue;  // Already have one; the first one found wins
+        deferred_plugins[entry.format] = fullpath;
+        std::vector<std::string> all_extensions;
+        for (auto&& ext : entry.input_extensions) {
+            deferred_input_extensions.emplace(ext, entry.format);
+            add_if_missing(all_extensions, ext);
+        }
+        for (auto&& ext : entry.output_extensions) {
+            deferred_output_extensions.emplace(ext, entry.format);
+            add_if_missing(all_extensions, ext);
+        }
+        add_to_format_lists(entry.format, entry.has_input, entry.has_output,
+                            all_extensions, entry.lib_version.c_str());
+    }
+    return entries;
+}
+
+
+
+/// Write the manifest for a directory of plugins.  It's written to a
+/// temporary file and renamed, so that nobody reads a partial one, and
+/// it's fine for this to fail (for example, if the directory isn't
+/// writeable).
+static void
+write_plugin_manifest(const std::string& dir,
+                      const std::vector<ManifestEntry>& entries)
+{
+    std::string text = manifest_header + "\n";
+    for (auto&& e : entries)
+        text += Strutil::sprintf(
+            "%s\t%s\t%s\t%s\t%s\n", e.format, e.filename,
+            e.has_input ? Strutil::join(e.input_extensions, ",") : "-",
+            e.has_output ? Strutil::join(e.output_extensions, ",") : "-",
+            e.lib_version);
+    std::string tmpname = dir + "/"
+                          + Filesystem::unique_path(".imageio-%%%%%%%%.tmp");
+    FILE* file = Filesystem::fopen(tmpname, "wb");
+    if (!file)
+        return;
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok &= (fclose(file) == 0);
+    if (!ok || !Filesystem::rename(tmpname, dir + "/" + manifest_name))
+        Filesystem::remove(tmpname);
+}
+
+
+
+/// If the formats have changed since format_table was last published,
+/// publish a fresh copy.  Should only be called while imageio_mutex is
+/// held.
+static void
+publish_format_table()
+{
+    if (!format_table_dirty)
+        return;
+    std::unique_ptr<FormatTable> table(new FormatTable);
+    table->input  = input_formats;
+    table->output = output_formats;
+    format_table.store(table.get(), std::memory_order_release);
+    format_tables.push_back(std::move(table));
+    format_table_dirty = false;
+}
+
+
+
+/// Find the creation routine for a format name or extension: without
+/// locking, from the published format_table, if it's there, and otherwise
+/// by loading the deferred plugin for it, or failing that, cataloging all
+/// the plugins in the searchpath.
+template<typename Creator>
+static Creator
+find_creator(const std::string& format, const std::string& searchpath,
+             std::map<std::string, Creator> FormatTable::*table_formats,
+             const std::map<std::string, Creator>& formats,
+             const std::map<std::string, std::string>& deferred_extensions)
+{
+    if (const FormatTable* table = format_table.load(
+            std::memory_order_acquire)) {
+        auto& published = table->*table_formats;
+        auto found      = published.find(format);
+        if (found != published.end())
+            return found->second;
+    }
+    recursive_lock_guard lock(imageio_mutex);  // Ensure thread safety
+    auto found = formats.find(format);
+    if (found == formats.end()) {
+        if (!load_deferred_extension(deferred_extensions, format)) {
+            catalog_all_plugins(searchpath);
+            load_deferred_extension(deferred_extensions, format);
+        }
+        found = formats.find(format);
+    }
+    publish_format_table();
+    return found != formats.end() ? found->second : nullptr;
 }
 
 
@@ -297,7 +691,7 @@ catalog_builtin_plugins()
 
     DECLAREPLUG (bmp);
     DECLAREPLUG_RO (cineon);
-    DECLAREPLUG_RO (dds);
+    DECLAREPLUG (dds);
 #ifdef USE_DCMTK
     DECLAREPLUG_RO (dicom);
 #endif
@@ -373,12 +767,17 @@ append_if_env_exists(std::string& searchpath, const char* env,
 
 
 /// Look at ALL imageio plugins in the searchpath and add them to the
-/// catalog.  This routine is not reentrant and should only be called
+/// catalog.  Plugins listed in a current manifest in their directory are
+/// only noted, and loaded when first needed.  Each searchpath is only
+/// scanned once.  This routine is not reentrant and should only be called
 /// by a routine that is holding a lock on imageio_mutex.
 void
 pvt::catalog_all_plugins(std::string searchpath)
 {
-    catalog_builtin_plugins();
+    if (!builtins_cataloged) {
+        catalog_builtin_plugins();
+        builtins_cataloged = true;
+    }
 
     append_if_env_exists(searchpath, "OIIO_LIBRARY_PATH", true);
 #ifdef __APPLE__
@@ -388,10 +787,20 @@ pvt::catalog_all_plugins(std::string searchpath)
     append_if_env_exists(searchpath, "LD_LIBRARY_PATH");
 #endif
 
+    if (std::find(cataloged_searchpaths.begin(), cataloged_searchpaths.end(),
+                  searchpath)
+        != cataloged_searchpaths.end())
+        return;
+    cataloged_searchpaths.push_back(searchpath);
+
     size_t patlen = pattern.length();
     std::vector<std::string> dirs;
     Filesystem::searchpath_split(searchpath, dirs, true);
     for (const auto& dir : dirs) {
+        std::vector<ManifestEntry> manifest;
+        if (oiio_plugin_manifest)
+            manifest = read_plugin_manifest(dir);
+        size_t nlisted = manifest.size();
         std::vector<std::string> dir_entries;
         Filesystem::get_directory_entries(dir, dir_entries);
         for (const auto& full_filename : dir_entries) {
@@ -399,11 +808,22 @@ pvt::catalog_all_plugins(std::string searchpath)
             size_t found     = leaf.find(pattern);
             if (found != std::string::npos
                 && (found == leaf.length() - patlen)) {
+                auto listed = std::find_if(manifest.begin(),
+                                           manifest.begin() + nlisted,
+                                           [&](const ManifestEntry& e) {
+                                               return e.filename == leaf;
+                                           });
+                if (listed != manifest.begin() + nlisted)
+                    continue;  // deferred by the manifest
                 std::string pluginname(leaf.begin(),
                                        leaf.begin() + leaf.length() - patlen);
-                catalog_plugin(pluginname, full_filename);
+                ManifestEntry entry;
+                if (catalog_plugin(pluginname, full_filename, &entry))
+                    manifest.push_back(entry);
             }
         }
+        if (oiio_plugin_manifest >= 2 && manifest.size() > nlisted)
+            write_plugin_manifest(dir, manifest);
     }
 }
 
@@ -426,37 +846,31 @@ ImageOutput::create(const std::string& filename,
         format = filename;
     }
 
-    ImageOutput::Creator create_function = nullptr;
-    {                                              // scope the lock:
+    // See if it's already in the table.  If not, load or scan the plugins
+    // we can find to populate the table.
+    Strutil::to_lower(format);
+    ImageOutput::Creator create_function
+        = find_creator(format,
+                       plugin_searchpath.size()
+                           ? plugin_searchpath
+                           : pvt::plugin_searchpath.string(),
+                       &FormatTable::output, output_formats,
+                       deferred_output_extensions);
+    if (!create_function) {
         recursive_lock_guard lock(imageio_mutex);  // Ensure thread safety
-
-        // See if it's already in the table.  If not, scan all plugins we can
-        // find to populate the table.
-        Strutil::to_lower(format);
-        OutputPluginMap::const_iterator found = output_formats.find(format);
-        if (found == output_formats.end()) {
-            catalog_all_plugins(plugin_searchpath.size()
-                                    ? plugin_searchpath
-                                    : pvt::plugin_searchpath.string());
-            found = output_formats.find(format);
-        }
-        if (found != output_formats.end()) {
-            create_function = found->second;
-        } else {
-            if (output_formats.empty()) {
-                // This error is so fundamental, we echo it to stderr in
-                // case the app is too dumb to do so.
-                const char* msg
-                    = "ImageOutput::create() could not find any ImageOutput plugins!  Perhaps you need to set OIIO_LIBRARY_PATH.\n";
-                fprintf(stderr, "%s", msg);
-                OIIO::pvt::errorf("%s", msg);
-            } else
-                OIIO::pvt::errorf(
-                    "OpenImageIO could not find a format writer for \"%s\". "
-                    "Is it a file format that OpenImageIO doesn't know about?\n",
-                    filename);
-            return out;
-        }
+        if (output_formats.empty()) {
+            // This error is so fundamental, we echo it to stderr in
+            // case the app is too dumb to do so.
+            const char* msg
+                = "ImageOutput::create() could not find any ImageOutput plugins!  Perhaps you need to set OIIO_LIBRARY_PATH.\n";
+            fprintf(stderr, "%s", msg);
+            OIIO::pvt::errorf("%s", msg);
+        } else
+            OIIO::pvt::errorf(
+                "OpenImageIO could not find a format writer for \"%s\". "
+                "Is it a file format that OpenImageIO doesn't know about?\n",
+                filename);
+        return out;
     }
 
     ASSERT(create_function != nullptr);
@@ -501,6 +915,20 @@ std::unique_ptr<ImageInput>
 ImageInput::create(const std::string& filename, bool do_open,
                    const ImageSpec* config, string_view plugin_searchpath)
 {
+    if (pvt::wants_url_ioproxy(filename, config)) {
+        // Read the URL through a proxy, owned by the ImageInput if it's
+        // returned open. (If not, the caller must supply its own proxy
+        // when it opens it.)
+        ImageSpec urlconfig;
+        auto io = pvt::open_url_ioproxy(filename, config, urlconfig);
+        if (!io)
+            return std::unique_ptr<ImageInput>();
+        auto in = create(filename, do_open, &urlconfig, plugin_searchpath);
+        if (in && do_open)
+            in->adopt_ioproxy(io.release());
+        return in;
+    }
+
     // In case the 'filename' was really a REST-ful URI with query/config
     // details tacked on to the end, strip them off so we can correctly
     // extract the file extension.
@@ -528,23 +956,14 @@ ImageInput::create(const std::string& filename, bool do_open,
         format = filename;
     }
 
-    ImageInput::Creator create_function = nullptr;
-    {                                              // scope the lock:
-        recursive_lock_guard lock(imageio_mutex);  // Ensure thread safety
-
-        // See if it's already in the table.  If not, scan all plugins we can
-        // find to populate the table.
-        Strutil::to_lower(format);
-        InputPluginMap::const_iterator found = input_formats.find(format);
-        if (found == input_formats.end()) {
-            if (plugin_searchpath.empty())
-                plugin_searchpath = pvt::plugin_searchpath;
-            catalog_all_plugins(plugin_searchpath);
-            found = input_formats.find(format);
-        }
-        if (found != input_formats.end())
-            create_function = found->second;
-    }
+    // See if it's already in the table.  If not, load or scan the plugins
+    // we can find to populate the table.
+    Strutil::to_lower(format);
+    if (plugin_searchpath.empty())
+        plugin_searchpath = pvt::plugin_searchpath;
+    ImageInput::Creator create_function
+        = find_creator(format, plugin_searchpath, &FormatTable::input,
+                       input_formats, deferred_input_extensions);
 
     // Remember which prototypes we've already tried, so we don't double dip.
     std::vector<ImageInput::Creator> formats_tried;
@@ -596,19 +1015,23 @@ ImageInput::create(const std::string& filename, bool do_open,
         if (config)
             myconfig = *config;
         myconfig.attribute("nowait", (int)1);
+        // Read the file header once (before taking the lock) and try the
+        // plugins whose signature matches it first, which usually makes
+        // the first attempt the right one.
+        unsigned char header[signature_bytes];
+        size_t headerlen = read_header(filename, config, header);
         recursive_lock_guard lock(imageio_mutex);  // Ensure thread safety
-        for (auto&& plugin : input_formats) {
+        load_all_deferred_plugins();
+        for (auto plugin : plugins_by_signature(header, headerlen)) {
             // If we already tried this create function, don't do it again
-            if (std::find(formats_tried.begin(), formats_tried.end(),
-                          plugin.second)
+            if (std::find(formats_tried.begin(), formats_tried.end(), plugin)
                 != formats_tried.end())
                 continue;
-            formats_tried.push_back(plugin.second);  // remember
+            formats_tried.push_back(plugin);  // remember
 
             ImageSpec tmpspec;
             try {
-                ImageInput::Creator create_function = plugin.second;
-                in = std::unique_ptr<ImageInput>(create_function());
+                in = std::unique_ptr<ImageInput>(plugin());
             } catch (...) {
                 // Safety in case the ctr throws an exception
             }
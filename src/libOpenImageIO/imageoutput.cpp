@@ -29,10 +29,15 @@
 */
 
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <OpenImageIO/dassert.h>
@@ -658,4 +663,437 @@ ImageOutput::copy_tile_to_image_buffer(int x, int y, int z, TypeDesc format,
 
 
 
+class AsyncImageOutput::Impl {
+public:
+    // A queued write: a copy of the caller's pixels, and the call to make
+    // on the wrapped ImageOutput with them.
+    struct Job {
+        std::unique_ptr<char[]> data;
+        imagesize_t bytes = 0;
+        std::function<bool(ImageOutput*, const char*)> write;
+    };
+
+    Impl(ImageOutput::unique_ptr output, imagesize_t max_queued_bytes)
+        : m_out(std::move(output))
+        , m_max_queued_bytes(std::max(max_queued_bytes, imagesize_t(1)))
+        , m_thread(&Impl::run, this)
+    {
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_work.notify_all();
+        m_thread.join();
+    }
+
+    // Wait for room in the queue for a block of the given size, returning
+    // a buffer for it, or nullptr if an earlier write failed.
+    std::unique_ptr<char[]> reserve(imagesize_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_room.wait(lock, [&]() {
+            return m_failed || m_queued_bytes == 0
+                   || m_queued_bytes + bytes <= m_max_queued_bytes;
+        });
+        if (m_failed)
+            return std::unique_ptr<char[]>();
+        m_queued_bytes += bytes;  // count it now, so others wait for it too
+        return std::unique_ptr<char[]>(new char[bytes]);
+    }
+
+    void push(Job&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(job));
+        }
+        m_work.notify_one();
+    }
+
+    // Give back a reserved block that won't be queued after all.
+    void unreserve(imagesize_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queued_bytes -= bytes;
+        }
+        m_room.notify_all();
+    }
+
+    // Wait for the queue to drain. Return false and the error message if
+    // any write failed since the last time this was called.
+    bool wait(std::string& err)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_room.wait(lock, [&]() { return m_queue.empty() && !m_busy; });
+        if (!m_failed)
+            return true;
+        err = m_error;
+        m_error.clear();
+        return false;
+    }
+
+    bool failed()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_failed;
+    }
+
+    // Clear the failure state (for a new file).
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed = false;
+        m_error.clear();
+    }
+
+    imagesize_t queued_bytes()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queued_bytes;
+    }
+
+    ImageOutput* out() const { return m_out.get(); }
+
+private:
+    void run()
+    {
+        for (;;) {
+            Job job;
+            bool skip;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_work.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;  // stopping, and nothing left to write
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_busy = true;
+                skip   = m_failed;
+            }
+            bool ok = skip || job.write(m_out.get(), job.data.get());
+            std::string err = ok ? std::string() : m_out->geterror();
+            job.data.reset();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queued_bytes -= job.bytes;
+                m_busy = false;
+                if (!ok) {
+                    m_failed = true;
+                    m_error  = err.size() ? err : std::string("write failed");
+                }
+            }
+            m_room.notify_all();
+        }
+    }
+
+    ImageOutput::unique_ptr m_out;
+    imagesize_t m_max_queued_bytes;
+    std::mutex m_mutex;
+    std::condition_variable m_work;  // signaled when a job is queued
+    std::condition_variable m_room;  // signaled when a job is done
+    std::deque<Job> m_queue;
+    imagesize_t m_queued_bytes = 0;
+    bool m_busy                = false;
+    bool m_failed              = false;
+    bool m_stop                = false;
+    std::string m_error;
+    std::thread m_thread;  // last, so it starts after everything else
+};
+
+
+
+AsyncImageOutput::AsyncImageOutput(ImageOutput::unique_ptr output,
+                                   imagesize_t max_queued_bytes)
+    : m_impl(new Impl(std::move(output), max_queued_bytes))
+{
+}
+
+
+
+AsyncImageOutput::~AsyncImageOutput()
+{
+    // Let the queue drain, and close the file if it's still open, before
+    // the Impl stops its thread and destroys the wrapped ImageOutput.
+    close();
+}
+
+
+
+const char*
+AsyncImageOutput::format_name(void) const
+{
+    return m_impl->out()->format_name();
+}
+
+
+
+int
+AsyncImageOutput::supports(string_view feature) const
+{
+    return m_impl->out()->supports(feature);
+}
+
+
+
+bool
+AsyncImageOutput::wait()
+{
+    std::string err;
+    if (m_impl->wait(err))
+        return true;
+    errorf("%s", err);
+    return false;
+}
+
+
+
+imagesize_t
+AsyncImageOutput::queued_bytes() const
+{
+    return m_impl->queued_bytes();
+}
+
+
+
+ImageOutput*
+AsyncImageOutput::output() const
+{
+    return m_impl->out();
+}
+
+
+
+bool
+AsyncImageOutput::open(const std::string& name, const ImageSpec& newspec,
+                       OpenMode mode)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    out->threads(threads());
+    if (!out->open(name, newspec, mode)) {
+        errorf("%s", out->geterror());
+        return false;
+    }
+    m_spec = out->spec();
+    return true;
+}
+
+
+
+bool
+AsyncImageOutput::open(const std::string& name, int subimages,
+                       const ImageSpec* specs)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    out->threads(threads());
+    if (!out->open(name, subimages, specs)) {
+        errorf("%s", out->geterror());
+        return false;
+    }
+    m_spec = out->spec();
+    return true;
+}
+
+
+
+bool
+AsyncImageOutput::close()
+{
+    bool ok          = wait();
+    ImageOutput* out = m_impl->out();
+    if (!out->close()) {
+        errorf("%s", out->geterror());
+        ok = false;
+    }
+    m_impl->reset();
+    return ok;
+}
+
+
+
+bool
+AsyncImageOutput::write_scanline(int y, int z, TypeDesc format,
+                                 const void* data, stride_t xstride)
+{
+    return write_scanlines(y, y + 1, z, format, data, xstride, AutoStride);
+}
+
+
+
+bool
+AsyncImageOutput::write_scanlines(int ybegin, int yend, int z,
+                                  TypeDesc format, const void* data,
+                                  stride_t xstride, stride_t ystride)
+{
+    return write_rectangle(m_spec.x, m_spec.x + m_spec.width, ybegin, yend, z,
+                           z + 1, format, data, xstride, ystride, AutoStride);
+}
+
+
+
+bool
+AsyncImageOutput::write_tile(int x, int y, int z, TypeDesc format,
+                             const void* data, stride_t xstride,
+                             stride_t ystride, stride_t zstride)
+{
+    // Queue a whole tile's worth of pixels, even for a partial tile at the
+    // edge of the image, since that's the layout write_tile expects.
+    if (!m_spec.tile_width || !m_spec.tile_height) {
+        errorf("Called write_tile for non-tiled image.");
+        return false;
+    }
+    return write_rectangle(x, x + m_spec.tile_width, y, y + m_spec.tile_height,
+                           z, z + std::max(1, m_spec.tile_depth), format, data,
+                           xstride, ystride, zstride);
+}
+
+
+
+bool
+AsyncImageOutput::write_tiles(int xbegin, int xend, int ybegin, int yend,
+                              int zbegin, int zend, TypeDesc format,
+                              const void* data, stride_t xstride,
+                              stride_t ystride, stride_t zstride)
+{
+    return write_rectangle(xbegin, xend, ybegin, yend, zbegin, zend, format,
+                           data, xstride, ystride, zstride);
+}
+
+
+
+bool
+AsyncImageOutput::write_rectangle(int xbegin, int xend, int ybegin, int yend,
+                                  int zbegin, int zend, TypeDesc format,
+                                  const void* data, stride_t xstride,
+                                  stride_t ystride, stride_t zstride)
+{
+    // All the write calls come through here (with the region they cover),
+    // to copy the pixels, contiguously, into a block for the queue.
+    // write_scanline(s), write_tile(s) and write_rectangle are told apart
+    // by the caller's region and the file's tiling.
+    if (m_impl->failed())
+        return wait();
+    bool native          = (format == TypeDesc::UNKNOWN);
+    stride_t pixel_bytes = native ? (stride_t)m_spec.pixel_bytes(true)
+                                  : stride_t(format.size() * m_spec.nchannels);
+    int width = xend - xbegin, height = yend - ybegin, depth = zend - zbegin;
+    if (xstride == AutoStride)
+        xstride = pixel_bytes;
+    ImageSpec::auto_stride(xstride, ystride, zstride, pixel_bytes, 1, width,
+                           height);
+    imagesize_t bytes = imagesize_t(pixel_bytes) * width * height * depth;
+    Impl::Job job;
+    job.bytes = bytes;
+    job.data  = m_impl->reserve(bytes);
+    if (!job.data)
+        return wait();
+    if (!OIIO::copy_image(m_spec.nchannels, width, height, depth, data,
+                          pixel_bytes, xstride, ystride, zstride,
+                          job.data.get(), pixel_bytes, pixel_bytes * width,
+                          pixel_bytes * width * height)) {
+        m_impl->unreserve(bytes);
+        errorf("Could not copy pixels to write");
+        return false;
+    }
+    bool is_tiled       = m_spec.tile_width && m_spec.tile_height;
+    bool full_scanlines = (xbegin == m_spec.x && width == m_spec.width
+                           && depth == 1);
+    bool one_tile       = is_tiled && width == m_spec.tile_width
+                    && height == m_spec.tile_height
+                    && depth == std::max(1, m_spec.tile_depth)
+                    && (xbegin - m_spec.x) % m_spec.tile_width == 0
+                    && (ybegin - m_spec.y) % m_spec.tile_height == 0;
+    if (!is_tiled && full_scanlines) {
+        job.write = [=](ImageOutput* out, const char* d) {
+            return out->write_scanlines(ybegin, yend, zbegin, format, d);
+        };
+    } else if (one_tile) {
+        job.write = [=](ImageOutput* out, const char* d) {
+            return out->write_tile(xbegin, ybegin, zbegin, format, d);
+        };
+    } else if (is_tiled) {
+        job.write = [=](ImageOutput* out, const char* d) {
+            return out->write_tiles(xbegin, xend, ybegin, yend, zbegin, zend,
+                                    format, d);
+        };
+    } else {
+        job.write = [=](ImageOutput* out, const char* d) {
+            return out->write_rectangle(xbegin, xend, ybegin, yend, zbegin,
+                                        zend, format, d);
+        };
+    }
+    m_impl->push(std::move(job));
+    return true;
+}
+
+
+
+bool
+AsyncImageOutput::write_deep_scanlines(int ybegin, int yend, int z,
+                                       const DeepData& deepdata)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    bool ok          = out->write_deep_scanlines(ybegin, yend, z, deepdata);
+    if (!ok)
+        errorf("%s", out->geterror());
+    return ok;
+}
+
+
+
+bool
+AsyncImageOutput::write_deep_tiles(int xbegin, int xend, int ybegin, int yend,
+                                   int zbegin, int zend,
+                                   const DeepData& deepdata)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    bool ok = out->write_deep_tiles(xbegin, xend, ybegin, yend, zbegin, zend,
+                                    deepdata);
+    if (!ok)
+        errorf("%s", out->geterror());
+    return ok;
+}
+
+
+
+bool
+AsyncImageOutput::write_deep_image(const DeepData& deepdata)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    bool ok          = out->write_deep_image(deepdata);
+    if (!ok)
+        errorf("%s", out->geterror());
+    return ok;
+}
+
+
+
+bool
+AsyncImageOutput::copy_image(ImageInput* in)
+{
+    if (!wait())
+        return false;
+    ImageOutput* out = m_impl->out();
+    bool ok          = out->copy_image(in);
+    if (!ok)
+        errorf("%s", out->geterror());
+    return ok;
+}
+
+
+
 OIIO_NAMESPACE_END
@@ -275,6 +275,76 @@ test_imagespec_from_ROI()
 
 
 
+static void
+test_imagespec_binary()
+{
+    std::cout << "test_imagespec_binary\n";
+    ImageSpec spec(640, 480, 3, TypeDesc::HALF);
+    spec.x           = -3;
+    spec.full_width  = 1024;
+    spec.tile_width  = 64;
+    spec.tile_height = 32;
+    spec.channelformats.assign({ TypeHalf, TypeHalf, TypeFloat });
+    spec.channelnames[2] = "Z";
+    spec.z_channel       = 2;
+    spec.deep            = true;
+    spec.attribute("foo", int(42));
+    spec.attribute("bar", "barbarbar?");
+    float matrix[16] = { 1, 2,  3,  4,  5,  6,  7,  8,
+                         9, 10, 11, 12, 13, 14, 15, 16 };
+    spec.attribute("worldtocamera", TypeMatrix, matrix);
+    const char* names[] = { "a", "bb", "" };
+    spec.attribute("names", TypeDesc(TypeDesc::STRING, 3), names);
+    spec.attribute("ptr", TypeDesc::PTR, &spec);
+
+    // Two blocks back to back, the second at an 8-byte aligned offset
+    std::vector<char> blob;
+    spec.to_binary(blob);
+    size_t first = blob.size();
+    OIIO_CHECK_EQUAL(first % 8, 0);
+    spec.to_binary(blob);
+    OIIO_CHECK_EQUAL(blob.size(), 2 * first);
+
+    for (int copy = 0; copy < 2; ++copy) {
+        ImageSpec s;
+        size_t n = s.from_binary(cspan<char>(blob.data() + first, first),
+                                 bool(copy));
+        OIIO_CHECK_EQUAL(n, first);
+        OIIO_CHECK_EQUAL(s.x, -3);
+        OIIO_CHECK_EQUAL(s.width, 640);
+        OIIO_CHECK_EQUAL(s.full_width, 1024);
+        OIIO_CHECK_EQUAL(s.tile_height, 32);
+        OIIO_CHECK_EQUAL(s.format, TypeHalf);
+        OIIO_CHECK_EQUAL(s.channelformats.size(), 3);
+        OIIO_CHECK_EQUAL(s.channelformats[2], TypeFloat);
+        OIIO_CHECK_EQUAL(s.channel_name(2), "Z");
+        OIIO_CHECK_EQUAL(s.z_channel, 2);
+        OIIO_CHECK_EQUAL(s.alpha_channel, -1);
+        OIIO_CHECK_ASSERT(s.deep);
+        OIIO_CHECK_EQUAL(s.get_int_attribute("foo"), 42);
+        OIIO_CHECK_EQUAL(s.get_string_attribute("bar"), "barbarbar?");
+        const ParamValue* p = s.find_attribute("worldtocamera", TypeMatrix);
+        OIIO_CHECK_ASSERT(p && p->get<float>(15) == 16.0f);
+        // Without copying, the matrix refers into the second block
+        bool inblob = p && p->data() > (const void*)(blob.data() + first)
+                      && p->data() < (const void*)(blob.data() + 2 * first);
+        OIIO_CHECK_EQUAL(inblob, !copy);
+        p = s.find_attribute("names");
+        OIIO_CHECK_ASSERT(p && p->get<ustring>(1) == "bb");
+        OIIO_CHECK_ASSERT(s.find_attribute("ptr") == nullptr);
+    }
+
+    // Damaged or truncated blocks are rejected, leaving the spec alone
+    ImageSpec s(8, 8, 1, TypeUInt8);
+    OIIO_CHECK_EQUAL(s.from_binary(cspan<char>(blob.data(), first - 1)), 0);
+    std::vector<char> bad(blob.begin(), blob.begin() + first);
+    bad[4] = 99;  // unknown version
+    OIIO_CHECK_EQUAL(s.from_binary(bad), 0);
+    OIIO_CHECK_EQUAL(s.width, 8);
+}
+
+
+
 int
 main(int argc, char* argv[])
 {
@@ -283,6 +353,7 @@ main(int argc, char* argv[])
     test_imagespec_attribute_from_string();
     test_get_attribute();
     test_imagespec_from_ROI();
+    test_imagespec_binary();
 
     return unit_test_failures;
 }
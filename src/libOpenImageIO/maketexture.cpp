@@ -28,13 +28,18 @@
   (This is the Modified BSD License)
 */
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 #include <boost/version.hpp>
@@ -47,14 +52,17 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/filter.h>
 #include <OpenImageIO/fmath.h>
+#include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
 #include <OpenImageIO/timer.h>
+#include <OpenImageIO/trace.h>
 
 #include "imageio_pvt.h"
 
@@ -107,6 +115,133 @@ setup_filter(const ImageSpec& dstspec, const ImageSpec& srcspec,
 
 
 
+// Separable filtering for MIP levels.  Each MIP level halves each axis of
+// the one before it (or keeps it, once it is down to one pixel), so all
+// the output pixels of an axis sit at the same place relative to their
+// source pixels: one set of taps, found once for the whole MIP chain,
+// serves every pixel of every level.  This filters as ImageBufAlgo::resize
+// does for such a level, but vertically first, one whole row at a time.
+class MipFilter {
+public:
+    MipFilter(const Filter2D& filter)
+    {
+        for (int k = 1; k <= 2; ++k) {
+            m_x[k - 1] = taps(filter, k, false);
+            m_y[k - 1] = taps(filter, k, true);
+        }
+    }
+
+    // Filter src into dst, if both are contiguous local float images and
+    // dst halves or keeps each axis of src; return false (having done
+    // nothing) if not.
+    bool filter(ImageBuf& dst, const ImageBuf& src) const
+    {
+        const ImageSpec& srcspec(src.spec());
+        const ImageSpec& dstspec(dst.spec());
+        int kx = srcspec.width / std::max(dstspec.width, 1);
+        int ky = srcspec.height / std::max(dstspec.height, 1);
+        if (!src.localpixels() || !src.contiguous() || !dst.localpixels()
+            || !dst.contiguous() || srcspec.format != TypeFloat
+            || dstspec.format != TypeFloat || srcspec.depth != 1
+            || dstspec.depth != 1 || srcspec.nchannels != dstspec.nchannels
+            || kx < 1 || kx > 2 || kx * dstspec.width != srcspec.width
+            || ky < 1 || ky > 2 || ky * dstspec.height != srcspec.height)
+            return false;
+
+        const Taps& xt(m_x[kx - 1]);
+        const Taps& yt(m_y[ky - 1]);
+        const int n        = srcspec.nchannels;
+        const size_t srcrow = size_t(srcspec.width) * n;
+        const size_t dstrow = size_t(dstspec.width) * n;
+        const float* srcpixels = (const float*)src.localpixels();
+        float* dstpixels       = (float*)dst.localpixels();
+        parallel_for_chunked(0, dstspec.height, 0, [&](int64_t yb,
+                                                       int64_t ye) {
+            using simd::vfloat4;
+            std::unique_ptr<float[]> vrow(new float[srcrow]);
+            float* v = vrow.get();
+            for (int y = int(yb); y < int(ye); ++y) {
+                // Vertically: the weighted sum of the source rows under
+                // the taps, four floats at a time whatever the channels.
+                std::fill(v, v + srcrow, 0.0f);
+                for (int j = 0, e = int(yt.w.size()); j < e; ++j) {
+                    int r = clamp(y * ky + yt.first + j, 0,
+                                  srcspec.height - 1);
+                    const float* s = srcpixels + r * srcrow;
+                    vfloat4 w(yt.w[j]);
+                    size_t i = 0;
+                    for (; i + 4 <= srcrow; i += 4)
+                        (vfloat4(v + i) + w * vfloat4(s + i)).store(v + i);
+                    for (; i < srcrow; ++i)
+                        v[i] += yt.w[j] * s[i];
+                }
+                // Horizontally, from that row into the output row
+                float* d = dstpixels + y * dstrow;
+                for (int x = 0; x < dstspec.width; ++x, d += n) {
+                    int x0 = x * kx + xt.first;
+                    if (n == 4) {
+                        vfloat4 sum = vfloat4::Zero();
+                        for (int i = 0, e = int(xt.w.size()); i < e; ++i) {
+                            int sx = clamp(x0 + i, 0, srcspec.width - 1);
+                            sum += xt.w[i] * vfloat4(v + 4 * sx);
+                        }
+                        sum.store(d);
+                    } else {
+                        for (int c = 0; c < n; ++c)
+                            d[c] = 0.0f;
+                        for (int i = 0, e = int(xt.w.size()); i < e; ++i) {
+                            const float* p
+                                = v + clamp(x0 + i, 0, srcspec.width - 1) * n;
+                            for (int c = 0; c < n; ++c)
+                                d[c] += xt.w[i] * p[c];
+                        }
+                    }
+                }
+            }
+        });
+        return true;
+    }
+
+private:
+    // The nonzero normalized weights of an axis, and the offset of the
+    // first one's source pixel from k times the output pixel.
+    struct Taps {
+        int first = 0;
+        std::vector<float> w;
+    };
+    Taps m_x[2], m_y[2];  // for keeping and halving the axis
+
+    // The taps for shrinking an axis k times, as resize finds them.
+    static Taps taps(const Filter2D& filter, int k, bool y)
+    {
+        float ratio = 1.0f / k;
+        float frac  = (k & 1) * 0.5f;
+        int rad     = (int)ceilf((y ? filter.height() : filter.width()) / 2.0f
+                             / ratio);
+        std::vector<float> w(2 * rad + 1);
+        float total = 0.0f;
+        for (int i = 0; i < 2 * rad + 1; ++i) {
+            float d = ratio * (i - rad - (frac - 0.5f));
+            w[i]    = y ? filter.yfilt(d) : filter.xfilt(d);
+            total += w[i];
+        }
+        Taps t;
+        if (total == 0.0f)
+            return t;  // no taps: all zero, as resize makes it
+        int b = 0, e = int(w.size());
+        while (w[b] == 0.0f)
+            ++b;
+        while (w[e - 1] == 0.0f)
+            --e;
+        t.first = k / 2 - rad + b;
+        for (int i = b; i < e; ++i)
+            t.w.push_back(w[i] / total);
+        return t;
+    }
+};
+
+
+
 static TypeDesc
 set_prman_options(TypeDesc out_dataformat, ImageSpec& configspec)
 {
@@ -232,6 +367,83 @@ interppixel_NDC_clamped(const ImageBuf& buf, float x, float y, float* pixel,
 
 
 
+// The same sampling as interppixel_NDC_clamped, for every pixel of roi
+// of dst, but straight from the memory of a contiguous src: the clamped
+// source columns and weights are found once for the whole block, and the
+// (at most) two source scanlines a row needs are converted to float once
+// for all its pixels.
+template<class SRCTYPE>
+static void
+resize_block_contig(ImageBuf& dst, const ImageBuf& src, ROI roi,
+                    bool envlatlmode)
+{
+    const ImageSpec& srcspec(src.spec());
+    const ImageSpec& dstspec(dst.spec());
+    const int n  = srcspec.nchannels;
+    float xscale = 1.0f / (float)dstspec.full_width;
+    float yscale = 1.0f / (float)dstspec.full_height;
+
+    std::vector<size_t> xoff0(roi.width()), xoff1(roi.width());
+    std::vector<float> xfrac(roi.width());
+    for (int x = roi.xbegin; x < roi.xend; ++x) {
+        float s = (x + 0.5f) * xscale + (float)dstspec.full_x;
+        s = (float)srcspec.full_x + s * (float)srcspec.full_width - 0.5f;
+        int xtexel;
+        xfrac[x - roi.xbegin] = floorfrac(s, &xtexel);
+        int x0 = Imath::clamp(xtexel, src.xmin(), src.xmax());
+        int x1 = Imath::clamp(xtexel + 1, src.xmin(), src.xmax());
+        xoff0[x - roi.xbegin] = size_t(x0 - src.xbegin()) * n;
+        xoff1[x - roi.xbegin] = size_t(x1 - src.xbegin()) * n;
+    }
+
+    // Source scanlines as float, and which scanline each one holds
+    size_t rowsize = size_t(srcspec.width) * n;
+    std::unique_ptr<float[]> rows(new float[2 * rowsize]);
+    float* row[2] = { rows.get(), rows.get() + rowsize };
+    int rowy[2]   = { std::numeric_limits<int>::min(),
+                    std::numeric_limits<int>::min() };
+    auto load     = [&](int y, int i) {
+        if (rowy[i] == y)
+            return;
+        if (i == 0 && rowy[1] == y) {  // last row's second is our first
+            std::swap(row[0], row[1]);
+            std::swap(rowy[0], rowy[1]);
+            return;
+        }
+        convert_type((const SRCTYPE*)src.pixeladdr(src.xbegin(), y), row[i],
+                     rowsize);
+        rowy[i] = y;
+    };
+
+    float fh = (float)srcspec.full_height;
+    for (int y = roi.ybegin; y < roi.yend; ++y) {
+        float t = (y + 0.5f) * yscale + (float)dstspec.full_y;
+        t       = (float)srcspec.full_y + t * fh - 0.5f;
+        int ytexel;
+        float yfrac = floorfrac(t, &ytexel);
+        int ynext   = Imath::clamp(ytexel + 1, src.ymin(), src.ymax());
+        ytexel      = Imath::clamp(ytexel, src.ymin(), src.ymax());
+        if (envlatlmode) {
+            // Area weighting, as in interppixel_NDC_clamped
+            float w0 = (1.0f - yfrac)
+                       * sinf((float)M_PI * (ytexel + 0.5f) / fh);
+            float w1 = yfrac * sinf((float)M_PI * (ynext + 0.5f) / fh);
+            yfrac    = w1 / (w0 + w1);
+        }
+        load(ytexel, 0);
+        if (ynext != ytexel)
+            load(ynext, 1);
+        const float* r0 = row[0];
+        const float* r1 = ynext != ytexel ? row[1] : row[0];
+        float* d = (float*)dst.pixeladdr(roi.xbegin, y, roi.zbegin);
+        for (int i = 0, w = roi.width(); i < w; ++i, d += n)
+            bilerp(r0 + xoff0[i], r0 + xoff1[i], r1 + xoff0[i],
+                   r1 + xoff1[i], xfrac[i], yfrac, n, d);
+    }
+}
+
+
+
 // Resize src into dst, relying on the linear interpolation of
 // interppixel_NDC_full or interppixel_NDC_clamped, for the pixel range.
 template<class SRCTYPE>
@@ -255,6 +467,11 @@ resize_block_(ImageBuf& dst, const ImageBuf& src, ROI roi, bool envlatlmode)
     float yscale  = 1.0f / (float)dstspec.full_height;
     int nchannels = dst.nchannels();
     ASSERT(dst.spec().format == TypeFloat);
+    if (!src_is_crop && src.contiguous() && dst.contiguous()
+        && !srcspec.deep) {
+        resize_block_contig<SRCTYPE>(dst, src, roi, envlatlmode);
+        return true;
+    }
     ImageBuf::Iterator<float> d(dst, roi);
     for (int y = y0; y < y1; ++y) {
         float t = (y + 0.5f) * yscale + yoffset;
@@ -272,14 +489,50 @@ resize_block_(ImageBuf& dst, const ImageBuf& src, ROI roi, bool envlatlmode)
 }
 
 
-// Helper function to compute the first bilerp pass into a scanline buffer
+// Helper function to widen a scanline of n values to float, unscaled.
+// A float scanline is used where it is, without a copy.
 template<class SRCTYPE>
+static const float*
+widen_scanline(const SRCTYPE* s, size_t n, float* buf)
+{
+    for (size_t i = 0; i < n; ++i)
+        buf[i] = (float)s[i];
+    return buf;
+}
+
+template<>
+const float*
+widen_scanline(const float* s, size_t /*n*/, float* /*buf*/)
+{
+    return s;
+}
+
+
+
+// Helper function to average each 2x2 block of pixels of scanlines s0 and
+// s1 (2*dw pixels wide) into the dw pixels of dst: each pair of pixels is
+// averaged horizontally, and the two results vertically, four channels at
+// a time where there are four.
 static void
-halve_scanline(const SRCTYPE* s, const int nchannels, size_t sw, float* dst)
+halve_scanlines(const float* s0, const float* s1, int nchannels, size_t dw,
+                float* dst)
 {
-    for (size_t i = 0; i < sw; i += 2, s += nchannels) {
-        for (int j = 0; j < nchannels; ++j, ++dst, ++s)
-            *dst = 0.5f * (float)(*s + *(s + nchannels));
+    if (nchannels == 4) {
+        simd::vfloat4 onehalf(0.5f);
+        for (size_t x = 0; x < dw; ++x, s0 += 8, s1 += 8, dst += 4) {
+            simd::vfloat4 a = onehalf
+                              * (simd::vfloat4(s0) + simd::vfloat4(s0 + 4));
+            simd::vfloat4 b = onehalf
+                              * (simd::vfloat4(s1) + simd::vfloat4(s1 + 4));
+            (onehalf * (a + b)).store(dst);
+        }
+        return;
+    }
+    const size_t n = nchannels;
+    for (size_t x = 0; x < dw; ++x, s0 += 2 * n, s1 += 2 * n, dst += n) {
+        for (size_t c = 0; c < n; ++c)
+            dst[c] = 0.5f * (0.5f * (s0[c] + s0[c + n])
+                             + 0.5f * (s1[c] + s1[c + n]));
     }
 }
 
@@ -299,11 +552,13 @@ resize_block_2pass(ImageBuf& dst, const ImageBuf& src, ROI roi,
 
     DASSERT(roi.ybegin + roi.height() <= dst.spec().height);
 
-    // Allocate two scanline buffers to hold the result of the first pass
+    // Allocate scanline buffers for the two source rows, widened to
+    // float, and the filtered result
     const int nchannels   = dst.nchannels();
     const size_t row_elem = roi.width() * nchannels;  // # floats in scanline
-    std::unique_ptr<float[]> S0(new float[row_elem]);
-    std::unique_ptr<float[]> S1(new float[row_elem]);
+    std::unique_ptr<float[]> S0(new float[2 * row_elem]);
+    std::unique_ptr<float[]> S1(new float[2 * row_elem]);
+    std::unique_ptr<float[]> D(new float[row_elem]);
 
     // We know that the buffers created for mipmapping are all contiguous,
     // so we can skip the iterators for a bilerp resize entirely along with
@@ -319,15 +574,13 @@ resize_block_2pass(ImageBuf& dst, const ImageBuf& src, ROI roi,
     const size_t dw = roi.width(), dh = roi.height();  // Loop invariants
     const size_t sw = dw * 2;                          // Handle odd res
     for (size_t y = 0; y < dh; ++y) {                  // For each dst ROI row
-        halve_scanline<SRCTYPE>(s, nchannels, sw, &S0[0]);
+        const float* s0 = widen_scanline(s, sw * nchannels, &S0[0]);
         s += ystride;
-        halve_scanline<SRCTYPE>(s, nchannels, sw, &S1[0]);
+        const float* s1 = widen_scanline(s, sw * nchannels, &S1[0]);
         s += ystride;
-        const float *s0 = &S0[0], *s1 = &S1[0];
-        for (size_t x = 0; x < dw; ++x) {  // For each dst ROI col
-            for (int i = 0; i < nchannels; ++i, ++s0, ++s1, ++d)
-                *d = (SRCTYPE)(0.5f * (*s0 + *s1));  // Average vertically
-        }
+        halve_scanlines(s0, s1, nchannels, dw, &D[0]);
+        for (size_t i = 0; i < row_elem; ++i, ++d)
+            *d = (SRCTYPE)D[i];
     }
 
     return true;
@@ -344,7 +597,7 @@ resize_block(ImageBuf& dst, const ImageBuf& src, ROI roi, bool envlatlmode,
     DASSERT(dstspec.nchannels == srcspec.nchannels);
     DASSERT(dst.localpixels());
     bool ok;
-    if (src.localpixels() &&                     // Not a cached image
+    if (src.contiguous() &&                      // Not cached, not a view
         !envlatlmode &&                          // not latlong wrap mode
         roi.xbegin == 0 &&                       // Region x at origin
         dstspec.width == roi.width() &&          // Full width ROI
@@ -392,17 +645,114 @@ check_nan_block(const ImageBuf& src, ROI roi, int& found_nonfinite)
 
 
 
-inline Imath::V3f
-latlong_to_dir(float s, float t, bool y_is_up = true)
+// What make_texture needs to know about the source pixels: the per
+// channel statistics (including the counts of NaN and Inf values), and
+// whether the first three channels are equal everywhere.
+struct SourceAnalysis {
+    ImageBufAlgo::PixelStats stats;
+    bool monochrome = false;
+};
+
+
+
+// Gather everything in a SourceAnalysis in one parallel sweep over src:
+// each band of scanlines gets all its analyses while it is in cache,
+// rather than each analysis making its own pass over the whole image.
+// The monochrome test is only made if check_monochrome is true (and src
+// has at least three channels).
+static SourceAnalysis
+analyze_source(const ImageBuf& src, bool check_monochrome)
 {
-    float theta = 2.0f * M_PI * s;
-    float phi   = t * M_PI;
-    float sinphi, cosphi;
-    sincos(phi, &sinphi, &cosphi);
-    if (y_is_up)
-        return Imath::V3f(sinphi * sinf(theta), cosphi, -sinphi * cosf(theta));
-    else
-        return Imath::V3f(-sinphi * cosf(theta), -sinphi * sinf(theta), cosphi);
+    SourceAnalysis result;
+    const int nchannels = src.nchannels();
+    ROI roi             = get_roi(src.spec());
+    result.stats.reset(nchannels);
+    check_monochrome &= (nchannels >= 3);
+    std::atomic<bool> monochrome(check_monochrome);
+    spin_mutex mutex;
+    parallel_for_chunked(roi.ybegin, roi.yend, 64,
+                         [&](int64_t ybegin, int64_t yend) {
+        ROI band(roi.xbegin, roi.xend, ybegin, yend, roi.zbegin, roi.zend,
+                 0, nchannels);
+        ImageBufAlgo::PixelStats stats = ImageBufAlgo::computePixelStats(
+            src, band, 1);
+        if (monochrome) {
+            band.chend = 3;
+            if (!ImageBufAlgo::isMonochrome(src, 0.0f, band, 1))
+                monochrome = false;
+        }
+        // A band's stats are final: undo the zero min and max it is given
+        // for a channel with no finite values, so the merge ignores them.
+        for (int c = 0; c < int(stats.min.size()); ++c) {
+            if (!stats.finitecount[c]) {
+                stats.min[c] = std::numeric_limits<float>::infinity();
+                stats.max[c] = -std::numeric_limits<float>::infinity();
+            }
+        }
+        spin_lock lock(mutex);
+        if (stats.min.size() == size_t(nchannels))
+            result.stats.merge(stats);
+    }, parallel_options(0, Split_Y, 1));
+    result.monochrome = monochrome;
+
+    // Finish the statistics as computePixelStats does
+    ImageBufAlgo::PixelStats& p(result.stats);
+    for (int c = 0; c < nchannels; ++c) {
+        if (p.finitecount[c] == 0) {
+            p.min[c] = p.max[c] = p.avg[c] = p.stddev[c] = 0.0f;
+        } else {
+            double count = static_cast<double>(p.finitecount[c]);
+            double davg  = p.sum[c] / count;
+            p.avg[c]     = static_cast<float>(davg);
+            p.stddev[c]  = static_cast<float>(
+                safe_sqrt(p.sum2[c] / count - davg * davg));
+        }
+    }
+    return result;
+}
+
+
+
+// Bilinear, edge clamped sampling, in NDC space, of a rectangle of float
+// pixels in memory -- the same sampling as interppixel_NDC_clamped, but
+// without an iterator (or the cache) in the way of each lookup.
+struct FloatSampler {
+    const float* pixels;  // first pixel of the rectangle
+    stride_t ystride;     // in floats
+    int width, height, nchannels;
+    float xoffset, yoffset;  // rectangle origin relative to NDC 0
+    float xscale, yscale;    // NDC 1 in pixels
+
+    void sample(float x, float y, float* pixel) const
+    {
+        x = xoffset + x * xscale - 0.5f;
+        y = yoffset + y * yscale - 0.5f;
+        int xtexel, ytexel;
+        float xfrac = floorfrac(x, &xtexel);
+        float yfrac = floorfrac(y, &ytexel);
+        int x0 = Imath::clamp(xtexel, 0, width - 1) * nchannels;
+        int x1 = Imath::clamp(xtexel + 1, 0, width - 1) * nchannels;
+        const float* r0 = pixels
+                          + Imath::clamp(ytexel, 0, height - 1) * ystride;
+        const float* r1 = pixels
+                          + Imath::clamp(ytexel + 1, 0, height - 1) * ystride;
+        bilerp(r0 + x0, r0 + x1, r1 + x0, r1 + x1, xfrac, yfrac, nchannels,
+               pixel);
+    }
+};
+
+
+
+// The pixels of src as contiguous float, in src itself if they already
+// are, else in a copy made in tmp.
+static const ImageBuf&
+float_pixels(const ImageBuf& src, ImageBuf& tmp)
+{
+    if (src.localpixels() && src.contiguous() && !src.deep()
+        && src.spec().format == TypeFloat)
+        return src;
+    ImageBufAlgo::copy(tmp, src, TypeFloat);
+    return tmp;
 }
 
 
@@ -416,22 +766,135 @@ lightprobe_to_envlatl(ImageBuf& dst, const ImageBuf& src, bool y_is_up,
         roi = get_roi(dst.spec());
     roi.chend = std::min(roi.chend, dst.nchannels());
 
+    ImageBuf tmp;
+    const ImageBuf& fsrc(float_pixels(src, tmp));
+    const ImageSpec& srcspec(fsrc.spec());
+    FloatSampler probe { (const float*)fsrc.localpixels(),
+                         stride_t(srcspec.width) * srcspec.nchannels,
+                         srcspec.width,
+                         srcspec.height,
+                         srcspec.nchannels,
+                         float(srcspec.full_x - srcspec.x),
+                         float(srcspec.full_y - srcspec.y),
+                         float(srcspec.full_width),
+                         float(srcspec.full_height) };
+
+    // The direction of a lat-long pixel is a product of functions of its
+    // column and of its row, so their sines and cosines are found once
+    // for each column and row rather than per pixel.
+    const ImageSpec& dstspec(dst.spec());
+    ASSERT(dstspec.format == TypeDesc::FLOAT);
+    int nchannels = dstspec.nchannels;
+    float dw = dstspec.width, dh = dstspec.height;
+    std::vector<float> sintheta(dstspec.width), costheta(dstspec.width);
+    std::vector<float> sinphi(dstspec.height), cosphi(dstspec.height);
+    for (int x = 0; x < dstspec.width; ++x) {
+        float theta = 2.0f * M_PI * ((x + 0.5f) / dw);
+        sintheta[x] = sinf(theta);
+        costheta[x] = cosf(theta);
+    }
+    for (int y = 0; y < dstspec.height; ++y)
+        sincos(((dh - 1.0f - y + 0.5f) / dh) * M_PI, &sinphi[y], &cosphi[y]);
+
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        const ImageSpec& dstspec(dst.spec());
-        int nchannels = dstspec.nchannels;
-        ASSERT(dstspec.format == TypeDesc::FLOAT);
+        float* pixel = ALLOCA(float, nchannels);
+        for (ImageBuf::Iterator<float> d(dst, roi); !d.done(); ++d) {
+            int x = d.x() - dst.xbegin(), y = d.y() - dst.ybegin();
+            Imath::V3f V;
+            if (y_is_up)
+                V = Imath::V3f(sinphi[y] * sintheta[x], cosphi[y],
+                               -sinphi[y] * costheta[x]);
+            else
+                V = Imath::V3f(-sinphi[y] * costheta[x],
+                               -sinphi[y] * sintheta[x], cosphi[y]);
+            float r = M_1_PI * acosf(V[2]) / hypotf(V[0], V[1]);
+            float u = (V[0] * r + 1.0f) * 0.5f;
+            float v = (V[1] * r + 1.0f) * 0.5f;
+            probe.sample(u, v, pixel);
+            for (int c = roi.chbegin; c < roi.chend; ++c)
+                d[c] = pixel[c];
+        }
+    });
+
+    return true;
+}
+
+
+
+// Remap a cube map -- six square faces, in the order +x -x +y -y +z -z,
+// stacked vertically or side by side -- to the lat-long environment map
+// dst (y up), sampling each face bilinearly.  Faces are oriented as for
+// OpenGL and DirectX cube maps.
+static bool
+cubemap_to_envlatl(ImageBuf& dst, const ImageBuf& src, ROI roi = ROI::All(),
+                   int nthreads = 0)
+{
+    ASSERT(dst.initialized() && src.nchannels() == dst.nchannels());
+    if (!roi.defined())
+        roi = get_roi(dst.spec());
+    roi.chend = std::min(roi.chend, dst.nchannels());
+
+    ImageBuf tmp;
+    const ImageBuf& fsrc(float_pixels(src, tmp));
+    const ImageSpec& srcspec(fsrc.spec());
+    bool vertical = (srcspec.height == 6 * srcspec.width);
+    int facesize  = vertical ? srcspec.width : srcspec.height;
+    int nchannels = srcspec.nchannels;
+    stride_t ystride = stride_t(srcspec.width) * nchannels;
+    FloatSampler face[6];
+    for (int f = 0; f < 6; ++f) {
+        const float* origin = (const float*)fsrc.localpixels()
+                              + (vertical ? f * facesize * ystride
+                                          : stride_t(f) * facesize
+                                                * nchannels);
+        face[f] = FloatSampler { origin,    ystride,         facesize,
+                                 facesize,  nchannels,       0.0f,
+                                 0.0f,      float(facesize), float(facesize) };
+    }
 
+    const ImageSpec& dstspec(dst.spec());
+    ASSERT(dstspec.format == TypeDesc::FLOAT);
+    float dw = dstspec.width, dh = dstspec.height;
+    // Directions as the texture system's environment lookups map them
+    // (the inverse of vector_to_latlong, y up): azimuth from each column,
+    // elevation from each row, with top row looking up.
+    std::vector<float> sinaz(dstspec.width), cosaz(dstspec.width);
+    std::vector<float> sinel(dstspec.height), cosel(dstspec.height);
+    for (int x = 0; x < dstspec.width; ++x)
+        sincos(2.0f * float(M_PI) * ((x + 0.5f) / dw - 0.5f), &sinaz[x],
+               &cosaz[x]);
+    for (int y = 0; y < dstspec.height; ++y)
+        sincos(float(M_PI) * (0.5f - (y + 0.5f) / dh), &sinel[y], &cosel[y]);
+
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         float* pixel = ALLOCA(float, nchannels);
-        float dw = dstspec.width, dh = dstspec.height;
         for (ImageBuf::Iterator<float> d(dst, roi); !d.done(); ++d) {
-            Imath::V3f V = latlong_to_dir((d.x() + 0.5f) / dw,
-                                          (dh - 1.0f - d.y() + 0.5f) / dh,
-                                          y_is_up);
-            float r      = M_1_PI * acosf(V[2]) / hypotf(V[0], V[1]);
-            float u      = (V[0] * r + 1.0f) * 0.5f;
-            float v      = (V[1] * r + 1.0f) * 0.5f;
-            interppixel_NDC_clamped<float>(src, float(u), float(v), pixel,
-                                           false);
+            int x = d.x() - dst.xbegin(), y = d.y() - dst.ybegin();
+            float vx = -cosel[y] * sinaz[x], vy = sinel[y];
+            float vz = cosel[y] * cosaz[x];
+            float ax = fabsf(vx), ay = fabsf(vy), az = fabsf(vz);
+            // The face is the major axis of the direction; sc and tc are
+            // the face's right and down directions.
+            int f;
+            float sc, tc, ma;
+            if (ax >= ay && ax >= az) {
+                f  = vx > 0.0f ? 0 : 1;
+                sc = vx > 0.0f ? -vz : vz;
+                tc = -vy;
+                ma = ax;
+            } else if (ay >= az) {
+                f  = vy > 0.0f ? 2 : 3;
+                sc = vx;
+                tc = vy > 0.0f ? vz : -vz;
+                ma = ay;
+            } else {
+                f  = vz > 0.0f ? 4 : 5;
+                sc = vz > 0.0f ? vx : -vx;
+                tc = -vy;
+                ma = az;
+            }
+            face[f].sample((sc / ma + 1.0f) * 0.5f, (tc / ma + 1.0f) * 0.5f,
+                           pixel);
             for (int c = roi.chbegin; c < roi.chend; ++c)
                 d[c] = pixel[c];
         }
@@ -577,14 +1040,16 @@ fix_latl_edges(ImageBuf& buf)
 
     // Make the left and right match, since they are both right on the
     // prime meridian.
-    for (int y = buf.ybegin(); y < buf.yend(); ++y) {
-        buf.getpixel(buf.xbegin(), y, left);
-        buf.getpixel(buf.xend() - 1, y, right);
+    parallel_for(buf.ybegin(), buf.yend(), [&](int64_t y) {
+        float* left  = ALLOCA(float, n);
+        float* right = ALLOCA(float, n);
+        buf.getpixel(buf.xbegin(), int(y), left);
+        buf.getpixel(buf.xend() - 1, int(y), right);
         for (int c = 0; c < n; ++c)
             left[c] = 0.5f * left[c] + 0.5f * right[c];
-        buf.setpixel(buf.xbegin(), y, left);
-        buf.setpixel(buf.xend() - 1, y, left);
-    }
+        buf.setpixel(buf.xbegin(), int(y), left);
+        buf.setpixel(buf.xend() - 1, int(y), left);
+    });
 }
 
 
@@ -628,13 +1093,541 @@ maketx_merge_spec(ImageSpec& dstspec, const ImageSpec& srcspec)
 
 
 
+// Computes the MIP levels below a top level whose scanlines are fed to it
+// in order, a band at a time, keeping only the few scanlines of each level
+// that the next coarser one still needs.  Scanlines are filtered exactly
+// as resize_block_ does for the box filter (bilinear, clamped at the
+// edges).  A texture file must hold all of one level before the next is
+// appended, so each coarser level is spilled, as float scanlines, to a
+// temporary file until its turn comes.
+class MipCascade {
+public:
+    MipCascade(int width, int height, int nchannels)
+        : m_nchannels(nchannels)
+    {
+        while (width > 1 || height > 1) {
+            Level L;
+            L.srcwidth  = width;
+            L.srcheight = height;
+            L.width = width = std::max(1, width / 2);
+            L.height = height = std::max(1, height / 2);
+            // Horizontal sample positions, the same for every scanline
+            float xscale = 1.0f / (float)L.width;
+            for (int x = 0; x < L.width; ++x) {
+                float sx = (x + 0.5f) * xscale * (float)L.srcwidth - 0.5f;
+                int xt;
+                L.xfrac.push_back(floorfrac(sx, &xt));
+                L.x0.push_back(Imath::clamp(xt, 0, L.srcwidth - 1));
+                L.x1.push_back(Imath::clamp(xt + 1, 0, L.srcwidth - 1));
+            }
+            m_levels.push_back(std::move(L));
+        }
+    }
+
+    ~MipCascade()
+    {
+        for (auto& L : m_levels) {
+            if (L.file)
+                fclose(L.file);
+            if (L.filename.size())
+                Filesystem::remove(L.filename);
+        }
+    }
+
+    /// Number of levels below the top one.
+    int nlevels() const { return int(m_levels.size()); }
+
+    /// Resolution of level l (1 being the first one below the top).
+    int width(int l) const { return m_levels[l - 1].width; }
+    int height(int l) const { return m_levels[l - 1].height; }
+
+    /// Feed the next n scanlines of the top level.
+    bool add(const float* scanlines, int n) { return add(0, scanlines, n); }
+
+    /// Read the next n scanlines of level l, once all of the top level
+    /// has been added.
+    bool read(int l, float* scanlines, int n)
+    {
+        Level& L(m_levels[l - 1]);
+        if (!L.file || L.y != L.height)
+            return false;
+        if (!L.reading) {
+            if (fseek(L.file, 0, SEEK_SET) != 0)
+                return false;
+            L.reading = true;
+        }
+        size_t count = size_t(n) * L.width * m_nchannels;
+        return fread(scanlines, sizeof(float), count, L.file) == count;
+    }
+
+private:
+    struct Level {
+        int width, height;         // resolution of this level
+        int srcwidth, srcheight;   // ... and of the one above it
+        std::vector<int> x0, x1;   // source columns for each column
+        std::vector<float> xfrac;  // ... and the weight between them
+        std::deque<std::vector<float>> src;  // source scanlines still needed
+        int srcfirst = 0;          // source scanline held in src.front()
+        int y        = 0;          // next scanline of this level to compute
+        FILE* file   = nullptr;    // spilled scanlines
+        std::string filename;
+        bool reading = false;
+    };
+    std::vector<Level> m_levels;
+    int m_nchannels;
+
+    // The source scanlines that scanline y of level L interpolates,
+    // and the weight between them.
+    static float source_rows(const Level& L, int y, int& ya, int& yb)
+    {
+        float sy = (y + 0.5f) * (1.0f / (float)L.height) * (float)L.srcheight
+                   - 0.5f;
+        int yt;
+        float yfrac = floorfrac(sy, &yt);
+        ya          = Imath::clamp(yt, 0, L.srcheight - 1);
+        yb          = Imath::clamp(yt + 1, 0, L.srcheight - 1);
+        return yfrac;
+    }
+
+    bool add(int l, const float* scanlines, int n)
+    {
+        if (l >= nlevels())
+            return true;
+        Level& L(m_levels[l]);
+        size_t srcsize = size_t(L.srcwidth) * m_nchannels;
+        for (int i = 0; i < n; ++i)
+            L.src.emplace_back(scanlines + i * srcsize,
+                               scanlines + (i + 1) * srcsize);
+        int srcend = L.srcfirst + int(L.src.size());
+
+        // Compute all the scanlines whose sources we now have
+        int ybegin = L.y, yend = L.y, ya, yb;
+        while (yend < L.height && (source_rows(L, yend, ya, yb), yb < srcend))
+            ++yend;
+        if (yend == ybegin)
+            return true;
+        size_t size = size_t(L.width) * m_nchannels;
+        std::vector<float> result((yend - ybegin) * size);
+        parallel_for(ybegin, yend, [&](int64_t y) {
+            int ya, yb;
+            float yfrac  = source_rows(L, int(y), ya, yb);
+            const float* a = L.src[ya - L.srcfirst].data();
+            const float* b = L.src[yb - L.srcfirst].data();
+            float* d       = &result[(y - ybegin) * size];
+            for (int x = 0; x < L.width; ++x, d += m_nchannels) {
+                size_t x0 = size_t(L.x0[x]) * m_nchannels;
+                size_t x1 = size_t(L.x1[x]) * m_nchannels;
+                bilerp(a + x0, a + x1, b + x0, b + x1, L.xfrac[x], yfrac,
+                       m_nchannels, d);
+            }
+        });
+        L.y = yend;
+
+        // Drop the source scanlines that no later scanline needs
+        int keep = srcend;
+        if (L.y < L.height)
+            source_rows(L, L.y, keep, yb);
+        while (L.srcfirst < keep && L.src.size()) {
+            L.src.pop_front();
+            ++L.srcfirst;
+        }
+
+        // Spill these, and pass them down to the next level
+        if (!L.file) {
+            L.filename = Filesystem::temp_directory_path() + "/"
+                         + Filesystem::unique_path("maketx-%%%%-%%%%-%%%%");
+            L.file     = Filesystem::fopen(L.filename, "w+b");
+            if (!L.file)
+                return false;
+        }
+        if (fwrite(result.data(), sizeof(float), result.size(), L.file)
+            != result.size())
+            return false;
+        return add(l + 1, result.data(), yend - ybegin);
+    }
+};
+
+
+
+// Write img, and if mipmap is true all its MIP levels below, a band of
+// tiles at a time: the top level is read a band at a time from img (which
+// may be backed by the ImageCache), and the MipCascade makes the other
+// levels, so the memory used is proportional to the width of the image
+// rather than its area.  Only for the box filter, with no overscan.  The
+// top level has already been opened in out.
+static bool
+write_mipmap_bands(const ImageBuf& img, ImageSpec outspec,
+                   const std::string& outputfilename, ImageOutput* out,
+                   TypeDesc outputdatatype, bool mipmap, bool verbose,
+                   std::ostream& outstream, double& stat_miptime,
+                   size_t& peak_mem)
+{
+    const int width = img.spec().width, height = img.spec().height;
+    const int nchannels = img.nchannels();
+    const int bandheight = outspec.tile_width ? outspec.tile_height : 64;
+    std::unique_ptr<MipCascade> cascade;
+    if (mipmap)
+        cascade.reset(new MipCascade(width, height, nchannels));
+    auto write_band = [&](const ImageSpec& spec, int ybegin, int yend,
+                          const float* data) {
+        bool ok = spec.tile_width
+                      ? out->write_tiles(spec.x, spec.x + spec.width, ybegin,
+                                         yend, spec.z, spec.z + 1, TypeFloat,
+                                         data)
+                      : out->write_scanlines(ybegin, yend, spec.z, TypeFloat,
+                                             data);
+        if (!ok)
+            outstream << "maketx ERROR writing \"" << outputfilename
+                      << "\" : " << out->geterror() << "\n";
+        return ok;
+    };
+
+    std::vector<float> band(size_t(width) * bandheight * nchannels);
+    for (int y = 0; y < height; y += bandheight) {
+        int yend = std::min(y + bandheight, height);
+        ROI roi(img.xbegin(), img.xend(), img.ybegin() + y,
+                img.ybegin() + yend, 0, 1, 0, nchannels);
+        if (!img.get_pixels(roi, TypeFloat, band.data())) {
+            outstream << "maketx ERROR: Could not read \"" << img.name()
+                      << "\" : " << img.geterror() << "\n";
+            return false;
+        }
+        if (!write_band(outspec, outspec.y + y, outspec.y + yend, band.data()))
+            return false;
+        Timer miptimer;
+        if (cascade && !cascade->add(band.data(), yend - y)) {
+            outstream << "maketx ERROR: Could not write temporary MIP "
+                      << "level file\n";
+            return false;
+        }
+        stat_miptime += miptimer();
+    }
+
+    for (int l = 1; cascade && l <= cascade->nlevels(); ++l) {
+        outspec.width = outspec.full_width = cascade->width(l);
+        outspec.height = outspec.full_height = cascade->height(l);
+        outspec.x = outspec.y = outspec.full_x = outspec.full_y = 0;
+        outspec.set_format(outputdatatype);
+        ImageOutput::OpenMode mode = out->supports("mipmap")
+                                         ? ImageOutput::AppendMIPLevel
+                                         : ImageOutput::AppendSubimage;
+        if (!out->open(outputfilename.c_str(), outspec, mode)) {
+            outstream << "maketx ERROR: Could not append \"" << outputfilename
+                      << "\" : " << out->geterror() << "\n";
+            return false;
+        }
+        band.resize(size_t(outspec.width) * bandheight * nchannels);
+        for (int y = 0; y < outspec.height; y += bandheight) {
+            int yend = std::min(y + bandheight, outspec.height);
+            if (!cascade->read(l, band.data(), yend - y)) {
+                outstream << "maketx ERROR: Could not read temporary MIP "
+                          << "level file\n";
+                return false;
+            }
+            if (!write_band(outspec, y, yend, band.data()))
+                return false;
+        }
+        if (verbose) {
+            size_t mem = Sysutil::memory_used(true);
+            peak_mem   = std::max(peak_mem, mem);
+            outstream << Strutil::sprintf("    %-15s (%s)", formatres(outspec),
+                                          Strutil::memformat(mem))
+                      << std::endl;
+        }
+    }
+    return true;
+}
+
+
+
+// Describe the whole tiles of img, cut as spec's tiles, whose pixels are
+// all one value, as the "oiio:ConstantTiles" metadata for the level:
+// "WIDTHxHEIGHT:FIRST[-LAST]=V0,V1,...;..." giving runs of tiles (numbered
+// across then down) that hold the value V. Return "" if there are none.
+// Only as many runs as fit in maxlen characters are listed, so that a
+// texture with many scattered constant tiles doesn't get an enormous
+// header; the tiles left out are simply read as usual.
+static std::string
+constant_tiles_desc(const ImageBuf& img, const ImageSpec& spec,
+                    size_t maxlen = 65536)
+{
+    int tw = spec.tile_width, th = spec.tile_height, nc = spec.nchannels;
+    if (!tw || !th || spec.depth > 1 || img.deep())
+        return std::string();
+    int nxtiles = (spec.width + tw - 1) / tw;
+    int nytiles = (spec.height + th - 1) / th;
+    // The value of each constant tile, or empty if it isn't constant.
+    // Partial tiles at the right and bottom edges are never counted.
+    std::vector<std::vector<float>> value(size_t(nxtiles) * nytiles);
+    parallel_for(0, spec.height / th, [&](int64_t ty) {
+        std::vector<float> pixels(size_t(tw) * th * nc);
+        size_t pixelbytes = nc * sizeof(float);
+        for (int tx = 0; tx < spec.width / tw; ++tx) {
+            ROI roi(img.xbegin() + tx * tw, img.xbegin() + (tx + 1) * tw,
+                    img.ybegin() + int(ty) * th,
+                    img.ybegin() + int(ty + 1) * th, img.zbegin(),
+                    img.zend(), 0, nc);
+            if (!img.get_pixels(roi, TypeFloat, pixels.data()))
+                return;
+            bool constant = true;
+            for (int c = 0; c < nc; ++c)
+                constant &= std::isfinite(pixels[c]);
+            for (size_t p = 1; constant && p < size_t(tw) * th; ++p)
+                constant = !memcmp(&pixels[0], &pixels[p * nc], pixelbytes);
+            if (constant)
+                value[ty * nxtiles + tx].assign(&pixels[0], &pixels[nc]);
+        }
+    });
+
+    std::ostringstream desc;
+    desc.imbue(std::locale::classic());  // Force "C" locale with '.' decimal
+    desc.precision(9);                   // enough to round trip a float
+    desc << spec.width << 'x' << spec.height << ':';
+    size_t len = size_t(desc.tellp());
+    bool any   = false;
+    for (int t = 0, n = int(value.size()); t < n; ++t) {
+        if (value[t].empty())
+            continue;
+        int first = t;
+        while (t + 1 < n && value[t + 1] == value[first])
+            ++t;
+        std::ostringstream run;
+        run.imbue(std::locale::classic());
+        run.precision(9);
+        run << (any ? ";" : "") << first;
+        if (t > first)
+            run << '-' << t;
+        run << '=';
+        for (int c = 0; c < nc; ++c)
+            run << (c ? "," : "") << value[first][c];
+        std::string r = run.str();
+        if (len + r.size() > maxlen)
+            break;
+        desc << r;
+        len += r.size();
+        any = true;
+    }
+    return any ? desc.str() : std::string();
+}
+
+
+
+// Record in spec which tiles of the level img are constant (or that none
+// are), as metadata if the format takes it, or else as a hint in the
+// ImageDescription, like the other hints maketx leaves there.
+static void
+set_constant_tiles(ImageSpec& spec, const ImageBuf& img, ImageOutput* out,
+                   bool enabled)
+{
+    std::string tiles = enabled ? constant_tiles_desc(img, spec)
+                                : std::string();
+    if (out->supports("arbitrary_metadata")) {
+        if (tiles.size())
+            spec.attribute("oiio:ConstantTiles", tiles);
+        else
+            spec.erase_attribute("oiio:ConstantTiles");
+        return;
+    }
+    std::string desc = spec.get_string_attribute("ImageDescription");
+    size_t found     = desc.find("oiio:ConstantTiles=");
+    if (found != std::string::npos) {
+        size_t end = std::min(desc.find_first_of(' ', found), desc.size());
+        end        = std::min(desc.find_first_not_of(' ', end), desc.size());
+        desc.erase(found, end - found);
+    }
+    if (tiles.size()) {
+        if (desc.length() && desc[desc.length() - 1] != ' ')
+            desc += " ";
+        desc += "oiio:ConstantTiles=" + tiles;
+    }
+    if (desc.size())
+        spec.attribute("ImageDescription", desc);
+    else
+        spec.erase_attribute("ImageDescription");
+}
+
+
+
+// A hash of the pixels of each tile of img, cut as spec's tiles (across
+// then down), from which a later run can tell which tiles have changed.
+static std::vector<uint64_t>
+tile_hashes(const ImageBuf& img, const ImageSpec& spec)
+{
+    int tw = spec.tile_width, th = spec.tile_height, nc = spec.nchannels;
+    int nxtiles = (spec.width + tw - 1) / tw;
+    int nytiles = (spec.height + th - 1) / th;
+    std::vector<uint64_t> hashes(size_t(nxtiles) * nytiles);
+    parallel_for(0, nytiles, [&](int64_t ty) {
+        std::vector<float> pixels(size_t(tw) * th * nc);
+        for (int tx = 0; tx < nxtiles; ++tx) {
+            ROI roi(tx * tw, std::min((tx + 1) * tw, spec.width),
+                    int(ty) * th, std::min(int(ty + 1) * th, spec.height), 0,
+                    1, 0, nc);
+            img.get_pixels(roi, TypeFloat, pixels.data());
+            hashes[ty * nxtiles + tx]
+                = xxhash::XXH64(pixels.data(),
+                                roi.npixels() * nc * sizeof(float), 0);
+        }
+    });
+    return hashes;
+}
+
+
+
+// The "tile hash" file kept beside a texture made in incremental mode
+// (maketx:incremental), describing the texture and the source it was made
+// from: a key for the settings, the texture file's time stamp and size
+// (so that a texture made again since, without updating this, is noticed),
+// its resolution and tile size, and the hash of each tile of the top level.
+struct TileHashFile {
+    uint64_t key = 0;
+    std::time_t time = 0;
+    uint64_t size = 0;
+    int width = 0, height = 0, tile_width = 0, tile_height = 0;
+    std::vector<uint64_t> hashes;
+
+    bool read(const std::string& filename)
+    {
+        std::string text;
+        if (!Filesystem::read_text_file(filename, text))
+            return false;
+        std::istringstream in(text);
+        in.imbue(std::locale::classic());
+        std::string magic;
+        long long t;
+        size_t n;
+        in >> magic >> std::hex >> key >> std::dec >> t >> size >> width
+            >> height >> tile_width >> tile_height >> n;
+        if (!in || magic != "maketx-tilehash-1")
+            return false;
+        time = std::time_t(t);
+        hashes.resize(n);
+        in >> std::hex;
+        for (auto& h : hashes)
+            in >> h;
+        return bool(in);
+    }
+
+    bool write(const std::string& filename) const
+    {
+        OIIO::ofstream out;
+        Filesystem::open(out, filename);
+        out.imbue(std::locale::classic());
+        out << "maketx-tilehash-1\n"
+            << std::hex << key << std::dec << "\n"
+            << (long long)time << ' ' << size << "\n"
+            << width << ' ' << height << ' ' << tile_width << ' '
+            << tile_height << ' ' << hashes.size() << "\n"
+            << std::hex;
+        for (auto h : hashes)
+            out << h << "\n";
+        return bool(out);
+    }
+};
+
+
+
+// Remakes the MIP levels of a texture made before, from a top level that
+// differs from the old one in only some of its tiles: each level starts
+// as the old texture's and only the tiles whose box filter footprint
+// touches a changed tile of the level above are computed again. If the
+// old texture lets it down at any level, that level and the rest are
+// computed in full.
+class IncrementalMip {
+public:
+    // Start from the old texture file, whose top level's tiles marked in
+    // changed (laid out as spec's tiles) are the ones to compute again.
+    IncrementalMip(const std::string& oldfile, const ImageSpec& spec,
+                   std::vector<char>&& changed)
+        : m_in(ImageInput::open(oldfile))
+        , m_tile_width(spec.tile_width)
+        , m_tile_height(spec.tile_height)
+        , m_changed(std::move(changed))
+    {
+    }
+
+    bool valid() const { return m_in != nullptr; }
+
+    // Fill small, the MIP level below big, from the old texture and by
+    // resizing big where it changed. Return false, having done nothing
+    // to small, if the old texture has no such level.
+    bool next_level(ImageBuf& small, const ImageBuf& big, bool envlatlmode,
+                    bool allow_shift)
+    {
+        if (!m_in)
+            return false;
+        ++m_level;
+        const ImageSpec& bspec(big.spec());
+        const ImageSpec& sspec(small.spec());
+        ImageSpec oldspec;
+        if (!m_in->seek_subimage(0, m_level, oldspec)
+            || oldspec.width != sspec.width || oldspec.height != sspec.height
+            || oldspec.nchannels != sspec.nchannels
+            || !m_in->read_image(sspec.format, small.localpixels())) {
+            m_in.reset();
+            return false;
+        }
+
+        // A changed pixel of big may change the pixels of small whose
+        // bilinear footprint reaches it; allow one pixel more each way.
+        int tw = m_tile_width, th = m_tile_height;
+        int bnx = (bspec.width + tw - 1) / tw;
+        int bny = (bspec.height + th - 1) / th;
+        int snx = (sspec.width + tw - 1) / tw;
+        int sny = (sspec.height + th - 1) / th;
+        double rx = double(sspec.width) / bspec.width;
+        double ry = double(sspec.height) / bspec.height;
+        std::vector<char> changed(size_t(snx) * sny, 0);
+        for (int ty = 0; ty < bny; ++ty) {
+            for (int tx = 0; tx < bnx; ++tx) {
+                if (!m_changed[ty * bnx + tx])
+                    continue;
+                int x0 = clamp(ifloor((tx * tw - 1) * rx) - 1, 0,
+                               sspec.width - 1);
+                int x1 = clamp(int(ceil(((tx + 1) * tw + 1) * rx)) + 1, 1,
+                               sspec.width);
+                int y0 = clamp(ifloor((ty * th - 1) * ry) - 1, 0,
+                               sspec.height - 1);
+                int y1 = clamp(int(ceil(((ty + 1) * th + 1) * ry)) + 1, 1,
+                               sspec.height);
+                for (int y = y0 / th; y <= (y1 - 1) / th; ++y)
+                    for (int x = x0 / tw; x <= (x1 - 1) / tw; ++x)
+                        changed[y * snx + x] = 1;
+            }
+        }
+        std::vector<ROI> rois;
+        for (int ty = 0; ty < sny; ++ty)
+            for (int tx = 0; tx < snx; ++tx)
+                if (changed[ty * snx + tx])
+                    rois.emplace_back(tx * tw,
+                                      std::min((tx + 1) * tw, sspec.width),
+                                      ty * th,
+                                      std::min((ty + 1) * th, sspec.height),
+                                      0, 1, 0, sspec.nchannels);
+        parallel_for(0, int64_t(rois.size()), [&](int64_t i) {
+            resize_block(small, big, rois[i], envlatlmode, allow_shift);
+        });
+        m_changed.swap(changed);
+        return true;
+    }
+
+private:
+    std::unique_ptr<ImageInput> m_in;
+    int m_level = 0;
+    int m_tile_width, m_tile_height;
+    std::vector<char> m_changed;  // Changed tiles of the last level made
+};
+
+
+
 static bool
 write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
              const ImageSpec& outspec_template, std::string outputfilename,
              ImageOutput* out, TypeDesc outputdatatype, bool mipmap,
-             string_view filtername, const ImageSpec& configspec,
-             std::ostream& outstream, double& stat_writetime,
-             double& stat_miptime, size_t& peak_mem)
+             bool streaming, IncrementalMip* incremental,
+             string_view filtername,
+             const ImageSpec& configspec, std::ostream& outstream,
+             double& stat_writetime, double& stat_miptime, size_t& peak_mem)
 {
     bool envlatlmode       = (mode == ImageBufAlgo::MakeTxEnvLatl);
     bool orig_was_overscan = (img->spec().x || img->spec().y || img->spec().z
@@ -683,6 +1676,14 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         filtername  = "lanczos3";
     }
 
+    // Which tiles of each level are all one value, so that a reader may
+    // skip reading them. (Not while streaming, which never has a whole
+    // level in hand.)
+    bool constant_tiles
+        = configspec.get_int_attribute("maketx:constant_tiles", 0) != 0
+          && !streaming;
+    set_constant_tiles(outspec, *img, out, constant_tiles);
+
     Timer writetimer;
     if (!out->open(outputfilename.c_str(), outspec)) {
         outstream << "maketx ERROR: Could not open \"" << outputfilename
@@ -698,7 +1699,14 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         outstream << "  Top level is " << formatres(outspec) << std::endl;
     }
 
-    if (!img->write(out)) {
+    if (streaming) {
+        if (!write_mipmap_bands(*img, outspec, outputfilename, out,
+                                outputdatatype, mipmap, verbose, outstream,
+                                stat_miptime, peak_mem)) {
+            out->close();
+            return false;
+        }
+    } else if (!img->write(out)) {
         // ImageBuf::write transfers any errors from the ImageOutput to
         // the ImageBuf.
         outstream << "maketx ERROR: Write failed \" : " << img->geterror()
@@ -709,7 +1717,7 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
 
     stat_writetime += writetimer();
 
-    if (mipmap) {  // Mipmap levels:
+    if (mipmap && !streaming) {  // Mipmap levels:
         if (verbose)
             outstream << "  Mipmapping...\n" << std::flush;
         std::vector<std::string> mipimages;
@@ -720,6 +1728,12 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         bool allow_shift
             = configspec.get_int_attribute("maketx:allow_pixel_shift") != 0;
 
+        // The filter (for anything but box) is the same for every level,
+        // so it and its taps are found at the first level that needs them.
+        std::shared_ptr<Filter2D> filter((Filter2D*)nullptr,
+                                         Filter2D::destroy);
+        std::unique_ptr<MipFilter> mipfilter;
+
         std::shared_ptr<ImageBuf> small(new ImageBuf);
         while (outspec.width > 1 || outspec.height > 1) {
             Timer miptimer;
@@ -777,15 +1791,21 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
 
                 if (filtername == "box" && !orig_was_overscan
                     && sharpen <= 0.0f) {
-                    ImageBufAlgo::parallel_image(get_roi(small->spec()),
-                                                 std::bind(resize_block,
-                                                           std::ref(*small),
-                                                           std::cref(*img), _1,
-                                                           envlatlmode,
-                                                           allow_shift));
+                    if (!incremental
+                        || !incremental->next_level(*small, *img,
+                                                    envlatlmode, allow_shift))
+                        ImageBufAlgo::parallel_image(
+                            get_roi(small->spec()),
+                            std::bind(resize_block, std::ref(*small),
+                                      std::cref(*img), _1, envlatlmode,
+                                      allow_shift));
                 } else {
-                    Filter2D* filter = setup_filter(small->spec(), img->spec(),
-                                                    filtername);
+                    if (!filter) {
+                        filter.reset(setup_filter(small->spec(), img->spec(),
+                                                  filtername));
+                        if (filter && filter->separable())
+                            mipfilter.reset(new MipFilter(*filter));
+                    }
                     if (!filter) {
                         outstream << "maketx ERROR: could not make filter \""
                                   << filtername << "\"\n";
@@ -815,7 +1835,8 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
                                       << "\n";
                         std::swap(img, sharp);
                     }
-                    ImageBufAlgo::resize(*small, *img, filter);
+                    if (!mipfilter || !mipfilter->filter(*small, *img))
+                        ImageBufAlgo::resize(*small, *img, filter.get());
                     if (sharpen > 0.0f && !sharpen_first) {
                         std::shared_ptr<ImageBuf> sharp(new ImageBuf);
                         bool uok = ImageBufAlgo::unsharp_mask(*sharp, *small,
@@ -832,16 +1853,18 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
                                             std::numeric_limits<float>::max(),
                                             true);
                     }
-                    Filter2D::destroy(filter);
                 }
             }
 
             stat_miptime += miptimer();
+            OIIO_TRACE_ELAPSED("mip level", "maketx", miptimer());
             outspec = smallspec;
             outspec.set_format(outputdatatype);
             if (envlatlmode && src_samples_border)
                 fix_latl_edges(*small);
 
+            set_constant_tiles(outspec, *small, out, constant_tiles);
+
             Timer writetimer;
             // If the format explicitly supports MIP-maps, use that,
             // otherwise try to simulate MIP-mapping with multi-image.
@@ -863,6 +1886,7 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
                 return false;
             }
             stat_writetime += writetimer();
+            OIIO_TRACE_ELAPSED("write mip level", "maketx", writetimer());
             if (verbose) {
                 size_t mem = Sysutil::memory_used(true);
                 peak_mem   = std::max(peak_mem, mem);
@@ -891,6 +1915,26 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
 
 
 
+// Loading a color configuration is slow, so one ColorConfig for each
+// config name is shared by all the make_texture calls of the process
+// (which ColorConfig allows, and which lets them share its processors).
+static std::shared_ptr<ColorConfig>
+shared_colorconfig(const std::string& name)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<ColorConfig>> configs;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = configs.find(name);
+    if (found != configs.end())
+        return found->second;
+    auto config = std::make_shared<ColorConfig>(name);
+    if (!config->error())  // don't keep one that failed to load
+        configs[name] = config;
+    return config;
+}
+
+
+
 static bool
 make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
                   std::string filename, std::string outputfilename,
@@ -907,6 +1951,7 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
 
 #define STATUS(task, timer)                                                    \
     {                                                                          \
+        OIIO_TRACE_ELAPSED(ustring(task).c_str(), "maketx", timer);            \
         size_t mem = Sysutil::memory_used(true);                               \
         peak_mem   = std::max(peak_mem, mem);                                  \
         if (verbose)                                                           \
@@ -998,7 +2043,8 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
 
     bool shadowmode  = (mode == ImageBufAlgo::MakeTxShadow);
     bool envlatlmode = (mode == ImageBufAlgo::MakeTxEnvLatl
-                        || mode == ImageBufAlgo::MakeTxEnvLatlFromLightProbe);
+                        || mode == ImageBufAlgo::MakeTxEnvLatlFromLightProbe
+                        || mode == ImageBufAlgo::MakeTxEnvLatlFromCubeFaces);
 
     // Find an ImageIO plugin that can open the output file, and open it
     std::string outformat
@@ -1068,6 +2114,31 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
         src  = latlong;
     }
 
+    if (mode == ImageBufAlgo::MakeTxEnvLatlFromCubeFaces) {
+        const ImageSpec& cubespec(src->spec());
+        int facesize = cubespec.width;
+        if (cubespec.height != 6 * cubespec.width) {
+            facesize = cubespec.height;
+            if (cubespec.width != 6 * cubespec.height) {
+                outstream << "maketx ERROR: \"" << src->name()
+                          << "\" is not six square cube faces ("
+                          << cubespec.width << "x" << cubespec.height
+                          << ")\n";
+                return false;
+            }
+        }
+        ImageSpec newspec = cubespec;
+        newspec.x = newspec.y = newspec.full_x = newspec.full_y = 0;
+        newspec.width = newspec.full_width = 4 * facesize;
+        newspec.height = newspec.full_height = 2 * facesize;
+        newspec.tile_width = newspec.tile_height = 0;
+        newspec.format                           = TypeDesc::FLOAT;
+        std::shared_ptr<ImageBuf> latlong(new ImageBuf(newspec));
+        cubemap_to_envlatl(*latlong, *src);
+        mode = ImageBufAlgo::MakeTxEnvLatl;
+        src  = latlong;
+    }
+
     if (mode == ImageBufAlgo::MakeTxBumpWithSlopes) {
         ImageSpec newspec  = src->spec();
         newspec.tile_width = newspec.tile_height = 0;
@@ -1100,12 +2171,25 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     bool opaque_detect = configspec.get_int_attribute("maketx:opaque_detect");
     bool compute_average_color
         = configspec.get_int_attribute("maketx:compute_average", 1);
-    ImageBufAlgo::PixelStats pixel_stats;
+    bool monochrome_detect = configspec.get_int_attribute(
+        "maketx:monochrome_detect");
+    std::string fixnan = configspec.get_string_attribute("maketx:fixnan");
+    bool checknan      = configspec.get_int_attribute("maketx:checknan");
     bool compute_stats = (constant_color_detect || opaque_detect
                           || compute_average_color);
-    if (compute_stats) {
-        ImageBufAlgo::computePixelStats(pixel_stats, *src);
-    }
+    // All the analyses of the source pixels are made in one pass; the
+    // NaN/Inf counts spare the later nan checking and fixing passes when
+    // there are none.
+    SourceAnalysis analysis;
+    bool analyzed = compute_stats || monochrome_detect || checknan
+                    || (fixnan.size() && fixnan != "none");
+    if (analyzed)
+        analysis = analyze_source(*src, monochrome_detect);
+    ImageBufAlgo::PixelStats& pixel_stats(analysis.stats);
+    bool has_nonfinite = !analyzed;  // unknown, so must check
+    for (size_t c = 0; c < pixel_stats.nancount.size(); ++c)
+        has_nonfinite |= (pixel_stats.nancount[c] + pixel_stats.infcount[c]
+                          != 0);
     double stat_pixelstatstime = alltime.lap();
     STATUS("pixelstats", stat_pixelstatstime);
 
@@ -1161,10 +2245,9 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     }
 
     // If requested - and we're a monochrome image - drop the extra channels
-    if (configspec.get_int_attribute("maketx:monochrome_detect")
-        && nchannels <= 0 && src->nchannels() == 3
-        && src->spec().alpha_channel < 0 &&  // RGB only
-        ImageBufAlgo::isMonochrome(*src)) {
+    if (monochrome_detect && analysis.monochrome && nchannels <= 0
+        && src->nchannels() == 3
+        && src->spec().alpha_channel < 0) {  // RGB only
         if (verbose)
             outstream
                 << "  Monochrome image detected. Converting to single channel texture.\n";
@@ -1348,7 +2431,6 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     // size more constant?
 
     // Fix nans/infs (if requested)
-    std::string fixnan = configspec.get_string_attribute("maketx:fixnan");
     ImageBufAlgo::NonFiniteFixMode fixmode = ImageBufAlgo::NONFINITE_NONE;
     if (fixnan.empty() || fixnan == "none") {
     } else if (fixnan == "black") {
@@ -1361,7 +2443,7 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
         return false;
     }
     int pixelsFixed = 0;
-    if (fixmode != ImageBufAlgo::NONFINITE_NONE
+    if (fixmode != ImageBufAlgo::NONFINITE_NONE && has_nonfinite
         && (srcspec.format.basetype == TypeDesc::FLOAT
             || srcspec.format.basetype == TypeDesc::HALF
             || srcspec.format.basetype == TypeDesc::DOUBLE)
@@ -1374,7 +2456,7 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
 
     // If --checknan was used and it's a floating point image, check for
     // nonfinite (NaN or Inf) values and abort if they are found.
-    if (configspec.get_int_attribute("maketx:checknan")
+    if (checknan && has_nonfinite
         && (srcspec.format.basetype == TypeDesc::FLOAT
             || srcspec.format.basetype == TypeDesc::HALF
             || srcspec.format.basetype == TypeDesc::DOUBLE)) {
@@ -1421,18 +2503,19 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
             ccSrc.reset(new ImageBuf(floatSpec));
         }
 
-        ColorConfig colorconfig(colorconfigname);
-        if (colorconfig.error()) {
+        std::shared_ptr<ColorConfig> colorconfig = shared_colorconfig(
+            colorconfigname);
+        if (colorconfig->error()) {
             outstream << "Error Creating ColorConfig\n";
-            outstream << colorconfig.geterror() << std::endl;
+            outstream << colorconfig->geterror() << std::endl;
             return false;
         }
 
         ColorProcessorHandle processor
-            = colorconfig.createColorProcessor(incolorspace, outcolorspace);
-        if (!processor || colorconfig.error()) {
+            = colorconfig->createColorProcessor(incolorspace, outcolorspace);
+        if (!processor) {
             outstream << "Error Creating Color Processor." << std::endl;
-            outstream << colorconfig.geterror() << std::endl;
+            outstream << colorconfig->geterror() << std::endl;
             return false;
         }
 
@@ -1519,8 +2602,26 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     double misc_time_4 = alltime.lap();
     STATUS("misc3", misc_time_4);
 
+    // For an image too big to read into memory, and a plain box filtered
+    // MIP-map, stream the pixels through a band at a time rather than
+    // making a full size float copy of each level.
+    // maketx:stream: 0 = never, 1 = when not read locally, 2 = always.
+    int stream = configspec.get_int_attribute("maketx:stream", 1);
+    bool streaming
+        = (stream == 2 || (stream == 1 && !read_local)) && !do_resize
+          && !envlatlmode && !orig_was_overscan && filtername == "box"
+          && srcspec.depth == 1 && !srcspec.x && !srcspec.y && !srcspec.full_x
+          && !srcspec.full_y && !allow_shift
+          && configspec.get_float_attribute("maketx:sharpen") <= 0.0f
+          && !configspec.get_int_attribute("maketx:highlightcomp")
+          && configspec.get_string_attribute("maketx:mipimages").empty();
+
     std::shared_ptr<ImageBuf> toplevel;  // Ptr to top level of mipmap
-    if (!do_resize && dstspec.format == src->spec().format) {
+    if (streaming) {
+        // Leave the pixels where they are; they are converted to float a
+        // band at a time as they are written.
+        toplevel = src;
+    } else if (!do_resize && dstspec.format == src->spec().format) {
         // No resize needed, no format conversion needed -- just stick to
         // the image we've already got
         toplevel = src;
@@ -1571,6 +2672,10 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     // Eliminate any SHA-1 or ConstantColor hints in the ImageDescription.
     if (desc.size()) {
         desc = regex_replace(desc, regex("SHA-1=[[:xdigit:]]*[ ]*"), "");
+        desc = regex_replace(desc,
+                             regex("(oiio:)?PixelHash=[[:alnum:]]*:"
+                                   "[[:xdigit:]]*[ ]*"),
+                             "");
         static const char* fp_number_pattern
             = "([+-]?((?:(?:[[:digit:]]*\\.)?[[:digit:]]+(?:[eE][+-]?[[:digit:]]+)?)))";
         const std::string constcolor_pattern
@@ -1600,25 +2705,36 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     if (configspec.get_int_attribute("maketx:highlightcomp", 0))
         addlHashData << "highlightcomp=1 ";
 
+    // SHA-1 hashes are stored as "oiio:SHA-1"; hashes by any other
+    // algorithm as "oiio:PixelHash", prefixed by the algorithm name.
     const int sha1_blocksize = 256;
+    std::string hashalg
+        = configspec.get_string_attribute("maketx:hash_algorithm", "sha1");
+    bool sha1 = Strutil::iequals(hashalg, "sha1")
+                || Strutil::iequals(hashalg, "sha-1");
     std::string hash_digest
         = configspec.get_int_attribute("maketx:hash", 1)
-              ? ImageBufAlgo::computePixelHashSHA1(*toplevel,
-                                                   addlHashData.str(),
-                                                   ROI::All(), sha1_blocksize)
+              ? ImageBufAlgo::computePixelHash(*toplevel, hashalg,
+                                               addlHashData.str(), ROI::All(),
+                                               sha1_blocksize)
               : "";
+    if (hash_digest.length() && !sha1)
+        hash_digest = hashalg + ":" + hash_digest;
+    const char* hashattr = sha1 ? "oiio:SHA-1" : "oiio:PixelHash";
     if (hash_digest.length()) {
         if (out->supports("arbitrary_metadata")) {
-            dstspec.attribute("oiio:SHA-1", hash_digest);
+            dstspec.attribute(hashattr, hash_digest);
         } else {
             if (desc.length())
                 desc += " ";
-            desc += "oiio:SHA-1=";
+            desc += hashattr;
+            desc += "=";
             desc += hash_digest;
             updatedDesc = true;
         }
         if (verbose)
-            outstream << "  SHA-1: " << hash_digest << std::endl;
+            outstream << "  " << (sha1 ? "SHA-1" : "Pixel hash") << ": "
+                      << hash_digest << std::endl;
     }
     double stat_hashtime = alltime.lap();
     STATUS("SHA-1 hash", stat_hashtime);
@@ -1681,13 +2797,74 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     double misc_time_5 = alltime.lap();
     STATUS("misc4", misc_time_5);
 
-    // Write out, and compute, the mipmap levels for the speicifed image
+    // Incremental mode: keep a hash of each top level tile beside the
+    // texture, and if the texture was made before with the same settings,
+    // compute again only the parts of its MIP levels that depend on tiles
+    // that have changed since. Only for a plain box filtered MIP-map
+    // (whose pixels depend only on nearby ones of the level above).
     bool nomipmap = configspec.get_int_attribute("maketx:nomipmap") != 0;
+    bool want_incremental = configspec.get_int_attribute("maketx:incremental")
+                            != 0;
+    std::string hashfilename = outputfilename + ".tilehash";
+    TileHashFile newhashes;
+    std::unique_ptr<IncrementalMip> incremental;
+    if (want_incremental) {
+        Timer hashtimer;
+        std::string settings = configspec.serialize(ImageSpec::SerialText);
+        newhashes.key    = xxhash::XXH64(settings.data(), settings.size(), 0);
+        newhashes.width  = dstspec.width;
+        newhashes.height = dstspec.height;
+        newhashes.tile_width  = dstspec.tile_width;
+        newhashes.tile_height = dstspec.tile_height;
+        newhashes.hashes      = tile_hashes(*toplevel, dstspec);
+        stat_hashtime += hashtimer();
+
+        TileHashFile old;
+        bool eligible
+            = !streaming && !shadowmode && !nomipmap && !envlatlmode
+              && !orig_was_overscan && filtername == "box"
+              && dstspec.depth == 1 && !toplevel->spec().x
+              && !toplevel->spec().y
+              && configspec.get_float_attribute("maketx:sharpen") <= 0.0f
+              && !configspec.get_int_attribute("maketx:highlightcomp")
+              && configspec.get_string_attribute("maketx:mipimages").empty();
+        if (eligible && old.read(hashfilename) && old.key == newhashes.key
+            && Filesystem::exists(outputfilename)
+            && old.time == Filesystem::last_write_time(outputfilename)
+            && old.size == Filesystem::file_size(outputfilename)
+            && old.width == newhashes.width && old.height == newhashes.height
+            && old.tile_width == newhashes.tile_width
+            && old.tile_height == newhashes.tile_height
+            && old.hashes.size() == newhashes.hashes.size()) {
+            std::vector<char> changed(old.hashes.size());
+            size_t nchanged = 0;
+            for (size_t i = 0; i < changed.size(); ++i) {
+                changed[i] = (old.hashes[i] != newhashes.hashes[i]);
+                nchanged += changed[i];
+            }
+            incremental.reset(new IncrementalMip(outputfilename, dstspec,
+                                                 std::move(changed)));
+            if (!incremental->valid())
+                incremental.reset();
+            else if (verbose)
+                outstream << "  Incremental update: " << nchanged << " of "
+                          << newhashes.hashes.size()
+                          << " top level tiles changed\n";
+        }
+    }
+
+    // Write behind: each MIP level is queued, and compressed and written
+    // to the file by another thread while we compute the next one.
+    if (configspec.get_int_attribute("maketx:pipeline", 1))
+        out.reset(new AsyncImageOutput(std::move(out)));
+
+    // Write out, and compute, the mipmap levels for the speicifed image
     bool ok = write_mipmap(mode, toplevel, dstspec, tmpfilename, out.get(),
-                           out_dataformat, !shadowmode && !nomipmap, filtername,
-                           configspec, outstream, stat_writetime, stat_miptime,
-                           peak_mem);
+                           out_dataformat, !shadowmode && !nomipmap, streaming,
+                           incremental.get(), filtername, configspec,
+                           outstream, stat_writetime, stat_miptime, peak_mem);
     out.reset();  // don't need it any more
+    incremental.reset();
 
     // If using update mode, stamp the output file with a modification time
     // matching that of the input file.
@@ -1704,6 +2881,13 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     }
     if (!ok)
         Filesystem::remove(tmpfilename);
+    if (ok && want_incremental) {
+        newhashes.time = Filesystem::last_write_time(outputfilename);
+        newhashes.size = Filesystem::file_size(outputfilename);
+        if (!newhashes.write(hashfilename))
+            outstream << "maketx WARNING: could not write \"" << hashfilename
+                      << "\"\n";
+    }
 
     if (verbose || configspec.get_int_attribute("maketx:runstats")
         || configspec.get_int_attribute("maketx:stats")) {
@@ -1773,3 +2957,76 @@ ImageBufAlgo::make_texture(ImageBufAlgo::MakeTextureMode mode,
     return make_texture_impl(mode, &input, "", outputfilename, configspec,
                              outstream);
 }
+
+
+
+bool
+ImageBufAlgo::make_texture_batch(ImageBufAlgo::MakeTextureMode mode,
+                                 const std::vector<std::string>& inputs,
+                                 const std::vector<std::string>& outputs,
+                                 const ImageSpec& configspec,
+                                 std::ostream* outstream,
+                                 std::vector<bool>* results)
+{
+    pvt::LoggedTimer logtime("IBA::make_texture_batch");
+    ASSERT(outputs.empty() || outputs.size() == inputs.size());
+    size_t njobs = inputs.size();
+
+    // Sort the jobs, biggest input file first, into those big enough to
+    // be worth all the threads, and the rest.
+    uint64_t bigsize
+        = uint64_t(configspec.get_int_attribute("maketx:batch_big_MB", 64))
+          * 1024 * 1024;
+    std::vector<uint64_t> filesize(njobs);
+    std::vector<size_t> order(njobs);
+    for (size_t i = 0; i < njobs; ++i) {
+        filesize[i] = Filesystem::file_size(inputs[i]);
+        if (filesize[i] == uint64_t(-1))
+            filesize[i] = 0;  // missing; it fails quickly
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return filesize[a] > filesize[b];
+    });
+    size_t nbig = 0;
+    while (nbig < njobs && filesize[order[nbig]] >= bigsize)
+        ++nbig;
+
+    // Each job's messages are collected and written out whole when it is
+    // done, so that those of concurrent jobs don't interleave.
+    std::vector<int> ok(njobs, 0);
+    std::mutex outmutex;
+    auto run = [&](size_t i) {
+        std::ostringstream log;
+        ok[i] = make_texture_impl(mode, NULL, inputs[i],
+                                  outputs.size() ? outputs[i] : "",
+                                  configspec, &log);
+        if (outstream) {
+            std::lock_guard<std::mutex> lock(outmutex);
+            *outstream << log.str() << std::flush;
+        }
+    };
+
+    // Every pool thread converts small files, one at a time each; a
+    // conversion run by a pool thread is itself single threaded. The
+    // calling thread meanwhile converts the big files, whose parallel
+    // loops get the whole pool as the small files run out, and then helps
+    // with whatever small files remain.
+    std::atomic<size_t> nextsmall(nbig);
+    auto run_small = [&](int /*id*/) {
+        for (size_t j; (j = nextsmall++) < njobs;)
+            run(order[j]);
+    };
+    thread_pool* pool = default_thread_pool();
+    task_set tasks(pool);
+    for (int t = 0, n = pool->size(); t < n && nbig + t < njobs; ++t)
+        tasks.push(pool->push(run_small));
+    for (size_t j = 0; j < nbig; ++j)
+        run(order[j]);
+    run_small(-1);
+    tasks.wait();
+
+    if (results)
+        results->assign(ok.begin(), ok.end());
+    return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
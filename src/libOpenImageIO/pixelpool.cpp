@@ -0,0 +1,250 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// Recycling allocator for ImageBuf local pixel memory.
+///
+/// Applications that repeatedly create and destroy big ImageBufs (such as
+/// frame loops) pay for the page faults of fresh memory every time. When
+/// enabled with the "imagebuf:pool" attribute, freed pixel buffers are
+/// instead kept, up to a budget, and handed back out to later ImageBufs
+/// needing the same size class.
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#ifndef _WIN32
+#    include <sys/mman.h>
+#endif
+
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/platform.h>
+#include <OpenImageIO/thread.h>
+
+#include "imageio_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+namespace {
+
+// Buffers smaller than this aren't worth pooling.
+const size_t min_pooled_bytes = size_t(1) << 20;
+const size_t hugepage_bytes   = size_t(2) << 20;
+
+struct PixelPool {
+    spin_mutex mutex;
+    std::map<size_t, std::vector<char*>> idle;  // keyed by capacity
+    size_t idle_bytes = 0;
+    atomic_ll hits { 0 }, misses { 0 }, evictions { 0 };
+    atomic_int enabled { 0 };
+    atomic_int budget_MB { 2048 };
+    atomic_int hugepages { 0 };
+    atomic_int zero { 1 };
+
+    ~PixelPool() { trim(0); }
+
+    // Free idle buffers, largest first, until no more than maxbytes remain.
+    void trim(size_t maxbytes)
+    {
+        std::vector<char*> doomed;
+        {
+            spin_lock lock(mutex);
+            while (idle_bytes > maxbytes && !idle.empty()) {
+                auto last = std::prev(idle.end());
+                doomed.push_back(last->second.back());
+                last->second.pop_back();
+                idle_bytes -= last->first;
+                if (last->second.empty())
+                    idle.erase(last);
+            }
+        }
+        evictions += doomed.size();
+        for (char* p : doomed)
+            aligned_free(p);
+    }
+};
+
+PixelPool&
+pool()
+{
+    static PixelPool p;
+    return p;
+}
+
+
+// Size classes are 4 steps per power of 2, so at most 25% is wasted.
+size_t
+size_class(size_t size, bool huge)
+{
+    size_t base = 1;  // largest power of 2 <= size
+    while (base <= size / 2)
+        base <<= 1;
+    size_t cap = round_to_multiple(size, std::max(base / 4, size_t(1)));
+    return huge ? round_to_multiple(cap, hugepage_bytes) : cap;
+}
+
+}  // namespace
+
+
+
+char*
+pixelpool_alloc(size_t size, size_t& capacity)
+{
+    capacity       = 0;
+    PixelPool& ppl = pool();
+    if (!ppl.enabled || size < min_pooled_bytes)
+        return new char[size];
+    bool huge  = ppl.hugepages;
+    size_t cap = size_class(size, huge);
+    char* p    = nullptr;
+    {
+        spin_lock lock(ppl.mutex);
+        auto found = ppl.idle.find(cap);
+        if (found != ppl.idle.end()) {
+            p = found->second.back();
+            found->second.pop_back();
+            if (found->second.empty())
+                ppl.idle.erase(found);
+            ppl.idle_bytes -= cap;
+        }
+    }
+    if (p) {
+        ++ppl.hits;
+        // Recycled memory holds the old image; unless asked not to, clear
+        // it so it looks like fresh memory from the system would.
+        if (ppl.zero)
+            memset(p, 0, size);
+    } else {
+        ++ppl.misses;
+        p = (char*)aligned_malloc(cap, huge ? hugepage_bytes : 4096);
+        if (!p)
+            return new char[size];
+#ifdef MADV_HUGEPAGE
+        if (huge)
+            madvise(p, cap, MADV_HUGEPAGE);
+#endif
+    }
+    capacity = cap;
+    return p;
+}
+
+
+
+void
+pixelpool_free(char* p, size_t capacity)
+{
+    if (!p)
+        return;
+    if (!capacity) {
+        delete[] p;  // Wasn't from the pool
+        return;
+    }
+    PixelPool& ppl = pool();
+    size_t budget  = size_t(std::max(0, int(ppl.budget_MB))) << 20;
+    if (!ppl.enabled || capacity > budget) {
+        aligned_free(p);
+        return;
+    }
+    ppl.trim(budget - capacity);
+    spin_lock lock(ppl.mutex);
+    ppl.idle[capacity].push_back(p);
+    ppl.idle_bytes += capacity;
+}
+
+
+
+bool
+pixelpool_attribute(string_view name, TypeDesc type, const void* val)
+{
+    if (type != TypeInt)
+        return false;
+    PixelPool& ppl = pool();
+    int v          = *(const int*)val;
+    if (name == "imagebuf:pool") {
+        ppl.enabled = v;
+        if (!v)
+            ppl.trim(0);
+        return true;
+    }
+    if (name == "imagebuf:pool_budget_MB") {
+        ppl.budget_MB = std::max(0, v);
+        ppl.trim(size_t(ppl.budget_MB) << 20);
+        return true;
+    }
+    if (name == "imagebuf:pool_hugepages") {
+        ppl.hugepages = v;
+        return true;
+    }
+    if (name == "imagebuf:pool_zero") {
+        ppl.zero = v;
+        return true;
+    }
+    return false;
+}
+
+
+
+bool
+pixelpool_getattribute(string_view name, TypeDesc type, void* val)
+{
+    if (type != TypeInt)
+        return false;
+    PixelPool& ppl = pool();
+    int& v         = *(int*)val;
+    if (name == "imagebuf:pool")
+        v = ppl.enabled;
+    else if (name == "imagebuf:pool_budget_MB")
+        v = ppl.budget_MB;
+    else if (name == "imagebuf:pool_hugepages")
+        v = ppl.hugepages;
+    else if (name == "imagebuf:pool_zero")
+        v = ppl.zero;
+    else if (name == "imagebuf:pool_hits")
+        v = int(ppl.hits);
+    else if (name == "imagebuf:pool_misses")
+        v = int(ppl.misses);
+    else if (name == "imagebuf:pool_evictions")
+        v = int(ppl.evictions);
+    else if (name == "imagebuf:pool_idle_MB") {
+        spin_lock lock(ppl.mutex);
+        v = int(ppl.idle_bytes >> 20);
+    } else
+        return false;
+    return true;
+}
+
+
+}  // end namespace pvt
+
+OIIO_NAMESPACE_END
@@ -0,0 +1,104 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// The baseline kernels of simd_kernels.h, built with the same flags as
+/// the rest of the library, and the choice among the tables at runtime.
+
+// First, so that fmath.h sees half.h
+#define SIMD_KERNELS_TABLE simd_kernels_base
+#define SIMD_KERNELS_ISA ""
+#include "simd_kernels_impl.h"
+
+#include <OpenImageIO/platform.h>
+#include <OpenImageIO/string_view.h>
+#include <OpenImageIO/sysutil.h>
+
+#if defined(_MSC_VER) && (OIIO_SIMD_DISPATCH_AVX2 || OIIO_SIMD_DISPATCH_AVX512)
+#    include <immintrin.h>
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+
+#if OIIO_SIMD_DISPATCH_AVX2 || OIIO_SIMD_DISPATCH_AVX512
+// Has the OS enabled the AVX registers (and, if avx512 is true, the
+// AVX-512 ones), so that they survive context switches? The CPU having
+// the instructions isn't enough.
+static bool
+os_saves_avx_state(bool avx512)
+{
+    int info[4];
+    cpuid(info, 1, 0);
+    if (!(info[2] & (1 << 27)))  // OSXSAVE: xgetbv is available
+        return false;
+#    ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#    else
+    unsigned int lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#    endif
+    // SSE and AVX state, plus the opmask and upper ZMM state for AVX-512
+    unsigned long long needed = avx512 ? 0xe6 : 0x06;
+    return (xcr0 & needed) == needed;
+}
+#endif
+
+
+
+const pvt::SimdKernels&
+pvt::simd_kernels()
+{
+    // The OPENIMAGEIO_SIMD_DISPATCH environment variable may name an
+    // instruction set to use at most ("avx2", or "base" for none of
+    // them), which is handy for testing and for comparing speeds.
+    static const SimdKernels* kernels = []() {
+        string_view limit = Sysutil::getenv("OPENIMAGEIO_SIMD_DISPATCH");
+        (void)limit;
+#if OIIO_SIMD_DISPATCH_AVX512
+        if ((limit.empty() || limit == "avx512") && cpu_has_avx512f()
+            && cpu_has_avx512dq() && cpu_has_avx512bw() && cpu_has_avx512vl()
+            && cpu_has_avx2() && cpu_has_f16c() && cpu_has_fma()
+            && os_saves_avx_state(true))
+            return simd_kernels_avx512();
+#endif
+#if OIIO_SIMD_DISPATCH_AVX2
+        if ((limit.empty() || limit == "avx512" || limit == "avx2")
+            && cpu_has_avx2() && cpu_has_f16c() && cpu_has_fma()
+            && os_saves_avx_state(false))
+            return simd_kernels_avx2();
+#endif
+        return simd_kernels_base();
+    }();
+    return *kernels;
+}
+
+OIIO_NAMESPACE_END
@@ -0,0 +1,88 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// Kernels for the hottest inner loops, built for several instruction
+/// sets, with the best one the running CPU supports chosen at runtime.
+///
+/// simd.h picks its SIMD instructions when OIIO is compiled, so a build
+/// meant to run anywhere only gets the baseline ones. For the kernels
+/// here, the build (see SIMD_DISPATCH in compiler.cmake) also compiles
+/// simd_kernels_impl.h with the flags of newer instruction sets, each
+/// into a table of function pointers, and simd_kernels() returns the best
+/// table for this machine. The kernels of every table give exactly the
+/// same results.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <OpenEXR/half.h>
+
+#include <OpenImageIO/oiioversion.h>
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+struct SimdKernels {
+    // The instruction set the kernels were built for, or "" for those
+    // that the whole library was compiled for.
+    const char* isa;
+    // Convert n values, as convert_type(src, dst, n) does.
+    void (*uint8_to_float)(const uint8_t* src, float* dst, size_t n);
+    void (*uint16_to_float)(const uint16_t* src, float* dst, size_t n);
+    void (*int16_to_float)(const int16_t* src, float* dst, size_t n);
+    void (*uint32_to_float)(const uint32_t* src, float* dst, size_t n);
+    void (*half_to_float)(const half* src, float* dst, size_t n);
+    void (*float_to_uint8)(const float* src, uint8_t* dst, size_t n);
+    void (*float_to_uint16)(const float* src, uint16_t* dst, size_t n);
+    void (*float_to_int16)(const float* src, int16_t* dst, size_t n);
+    void (*float_to_half)(const float* src, half* dst, size_t n);
+    void (*uint8_to_uint16)(const uint8_t* src, uint16_t* dst, size_t n);
+    void (*uint16_to_uint8)(const uint16_t* src, uint8_t* dst, size_t n);
+};
+
+// The kernels to use on this machine.
+const SimdKernels&
+simd_kernels();
+
+// The tables for each instruction set. Only those that the build
+// included exist (see simd_kernels.cpp).
+const SimdKernels*
+simd_kernels_base();
+const SimdKernels*
+simd_kernels_avx2();
+const SimdKernels*
+simd_kernels_avx512();
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
@@ -0,0 +1,92 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// The bodies of the kernels of simd_kernels.h. This is included by each
+/// of the files that build them for one instruction set, after defining
+/// SIMD_KERNELS_TABLE (the name of the function returning the table) and
+/// SIMD_KERNELS_ISA (the name of the instruction set).
+///
+/// Everything a kernel calls must be inlined into it, hence OIIO_FLATTEN:
+/// if an out-of-line copy of some inline function were compiled here, for
+/// this instruction set, the linker could pick it as the one copy that
+/// the whole library uses. For the same reason, the kernels themselves
+/// have internal linkage, and nothing here may need dynamic
+/// initialization.
+
+#include <OpenEXR/half.h>
+
+#include <OpenImageIO/fmath.h>
+
+#include "simd_kernels.h"
+
+#if !defined(SIMD_KERNELS_TABLE) || !defined(SIMD_KERNELS_ISA)
+#    error "Define SIMD_KERNELS_TABLE and SIMD_KERNELS_ISA first"
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+namespace pvt {
+
+namespace {
+
+template<typename S, typename D>
+OIIO_FLATTEN void
+convert_kernel(const S* src, D* dst, size_t n)
+{
+    convert_type(src, dst, n);
+}
+
+}  // namespace
+
+
+
+const SimdKernels*
+SIMD_KERNELS_TABLE()
+{
+    static const SimdKernels kernels = {
+        SIMD_KERNELS_ISA,
+        convert_kernel<uint8_t, float>,
+        convert_kernel<uint16_t, float>,
+        convert_kernel<int16_t, float>,
+        convert_kernel<uint32_t, float>,
+        convert_kernel<half, float>,
+        convert_kernel<float, uint8_t>,
+        convert_kernel<float, uint16_t>,
+        convert_kernel<float, int16_t>,
+        convert_kernel<float, half>,
+        convert_kernel<uint8_t, uint16_t>,
+        convert_kernel<uint16_t, uint8_t>,
+    };
+    return &kernels;
+}
+
+}  // namespace pvt
+OIIO_NAMESPACE_END
@@ -29,6 +29,7 @@
 */
 
 
+#include <algorithm>
 #include <cmath>
 #include <list>
 #include <sstream>
@@ -234,12 +235,196 @@ namespace {  // anonymous
 
 static EightBitConverter<float> uchar2float;
 
+
+
+// The orientation of each cube face, in the order px, nx, py, ny, pz, nz:
+// the axis and sign of the direction it faces, and of its +s and +t
+// directions, as in the table at the top of this file.
+struct CubeFaceAxes {
+    int major, saxis, taxis;
+    float msign, ssign, tsign;
+};
+
+static const CubeFaceAxes cube_faces[6] = {
+    { 0, 2, 1, 1.0f, -1.0f, -1.0f },   // px
+    { 0, 2, 1, -1.0f, 1.0f, -1.0f },   // nx
+    { 1, 0, 2, 1.0f, 1.0f, 1.0f },     // py
+    { 1, 0, 2, -1.0f, 1.0f, -1.0f },   // ny
+    { 2, 0, 1, 1.0f, 1.0f, -1.0f },    // pz
+    { 2, 0, 1, -1.0f, -1.0f, -1.0f },  // nz
+};
+
+
+
+// Which cube face the direction R points at, and the face-local (fs,ft),
+// running 0-1 across the face, where it goes through it.
+inline int
+vector_to_cubeface(const Imath::V3f& R, float& fs, float& ft)
+{
+    float ax = fabsf(R[0]), ay = fabsf(R[1]), az = fabsf(R[2]);
+    int face;
+    if (ax >= ay && ax >= az)
+        face = R[0] < 0.0f ? 1 : 0;
+    else if (ay >= az)
+        face = R[1] < 0.0f ? 3 : 2;
+    else
+        face = R[2] < 0.0f ? 5 : 4;
+    const CubeFaceAxes& f(cube_faces[face]);
+    float ma = std::max(fabsf(R[f.major]), 1.0e-30f);
+    fs       = 0.5f * (f.ssign * R[f.saxis] / ma + 1.0f);
+    ft       = 0.5f * (f.tsign * R[f.taxis] / ma + 1.0f);
+    // learned from experience, beware NaNs
+    if (isnan(fs))
+        fs = 0.0f;
+    if (isnan(ft))
+        ft = 0.0f;
+    return face;
+}
+
+
+
+// The faces are laid out for y up; for a z-up map, turn R so that the
+// same directions land in the same places as for a z-up latlong map.
+inline Imath::V3f
+cubeface_direction(const Imath::V3f& R, bool y_is_up)
+{
+    return y_is_up ? R : Imath::V3f(-R[1], R[2], R[0]);
+}
+
+
+
+// Where the faces of one MIP level of a cubeface map lie in its image.
+struct CubeLevel {
+    int faceres;       // valid texels across each face
+    int slotw, sloth;  // size of the (tile padded) area of each face
+    bool threebytwo;   // LayoutCubeThreeByTwo, else LayoutCubeOneBySix
+
+    CubeLevel(const ImageSpec& spec, int layout)
+        : threebytwo(layout == LayoutCubeThreeByTwo)
+    {
+        if (threebytwo) {
+            slotw   = spec.width / 3;
+            sloth   = spec.height / 2;
+            faceres = spec.full_width > 0 ? std::min(spec.full_width, slotw)
+                                          : slotw;
+        } else {
+            slotw   = spec.width;
+            sloth   = spec.height / 6;
+            faceres = std::min(slotw, sloth);
+        }
+        faceres = std::max(faceres, 1);
+    }
+    // Pixel offset, relative to the data window origin, of each face
+    int face_x(int face) const { return threebytwo ? (face / 2) * slotw : 0; }
+    int face_y(int face) const
+    {
+        return threebytwo ? (face % 2) * sloth : face * sloth;
+    }
+};
+
 }  // end anonymous namespace
 
 namespace pvt {  // namespace pvt
 
 
 
+bool
+TextureSystemImpl::sample_cubeface(int face, float fs, float ft, int level,
+                                   TextureFile& texturefile,
+                                   PerThreadInfo* thread_info,
+                                   TextureOpt& options,
+                                   sampler_prototype sampler,
+                                   int nchannels_result, int actualchannels,
+                                   float weight, vfloat4* accum,
+                                   vfloat4* daccumds, vfloat4* daccumdt)
+{
+    const ImageSpec& spec(texturefile.spec(options.subimage, level));
+    CubeLevel cube(spec, texturefile.m_envlayout);
+    bool border = texturefile.sample_border();
+    float res   = float(cube.faceres);
+    // Image st of the center of texel (x,y) of a face, as st_to_texel
+    // would invert it.
+    auto image_st = [&](int f, float x, float y, float& s, float& t) {
+        x += float(cube.face_x(f));
+        y += float(cube.face_y(f));
+        if (border) {
+            s = x / float(std::max(spec.width - 1, 1));
+            t = y / float(std::max(spec.height - 1, 1));
+        } else {
+            s = (x + 0.5f) / float(spec.width);
+            t = (y + 0.5f) / float(spec.height);
+        }
+    };
+
+    // Face-local texel coordinates of the lookup, with texel i centered
+    // at i.
+    float fx = border ? fs * (res - 1.0f) : fs * res - 0.5f;
+    float fy = border ? ft * (res - 1.0f) : ft * res - 0.5f;
+    bool closest = (sampler == &TextureSystemImpl::sample_closest);
+    float margin = (sampler == &TextureSystemImpl::sample_bicubic) ? 1.0f
+                                                                   : 0.0f;
+    if (closest) {
+        fx = Imath::clamp(fx, 0.0f, res - 1.0f);
+        fy = Imath::clamp(fy, 0.0f, res - 1.0f);
+    }
+    if (closest
+        || (fx >= margin && fx < res - 1.0f - margin && fy >= margin
+            && fy < res - 1.0f - margin)) {
+        // The whole footprint is on this face; this is the common case.
+        OIIO_SIMD4_ALIGN float sval[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float tval[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float wval[4] = { weight, 0.0f, 0.0f, 0.0f };
+        image_st(face, fx, fy, sval[0], tval[0]);
+        return (this->*sampler)(1, sval, tval, level, texturefile,
+                                thread_info, options, nchannels_result,
+                                actualchannels, wval, accum, daccumds,
+                                daccumdt);
+    }
+
+    // The footprint straddles an edge of the face. Filter bilinearly
+    // from the four nearest texel centers, each looked up on the face it
+    // really lies on: a center beyond the edge is turned back into a
+    // direction, which lands on a neighboring face. All four go to one
+    // sample_closest() call. (Bicubic lookups near the edges make do
+    // with this too.)
+    const CubeFaceAxes& axes(cube_faces[face]);
+    int x0 = ifloor(fx), y0 = ifloor(fy);
+    float xfrac = fx - float(x0), yfrac = fy - float(y0);
+    OIIO_SIMD4_ALIGN float sval[4], tval[4], wval[4];
+    for (int k = 0; k < 4; ++k) {
+        int x = x0 + (k & 1), y = y0 + (k >> 1);
+        int f = face;
+        if (x < 0 || x >= cube.faceres || y < 0 || y >= cube.faceres) {
+            float span = std::max(res - 1.0f, 1.0f);
+            float u    = border ? float(x) / span : (x + 0.5f) / res;
+            float v    = border ? float(y) / span : (y + 0.5f) / res;
+            Imath::V3f dir;
+            dir[axes.major] = axes.msign;
+            dir[axes.saxis] = axes.ssign * (2.0f * u - 1.0f);
+            dir[axes.taxis] = axes.tsign * (2.0f * v - 1.0f);
+            float nfs, nft;
+            f = vector_to_cubeface(dir, nfs, nft);
+            if (border) {
+                x = int(nfs * (res - 1.0f) + 0.5f);
+                y = int(nft * (res - 1.0f) + 0.5f);
+            } else {
+                x = ifloor(nfs * res);
+                y = ifloor(nft * res);
+            }
+            x = Imath::clamp(x, 0, cube.faceres - 1);
+            y = Imath::clamp(y, 0, cube.faceres - 1);
+        }
+        image_st(f, float(x), float(y), sval[k], tval[k]);
+        wval[k] = weight * ((k & 1) ? xfrac : 1.0f - xfrac)
+                  * ((k >> 1) ? yfrac : 1.0f - yfrac);
+    }
+    return sample_closest(4, sval, tval, level, texturefile, thread_info,
+                          options, nchannels_result, actualchannels, wval,
+                          accum, daccumds, daccumdt);
+}
+
+
+
 bool
 TextureSystemImpl::environment(ustring filename, TextureOptions& options,
                                Runflag* runflags, int beginactive,
@@ -362,6 +547,7 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
 
     PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
         (PerThreadInfo*)thread_info_);
+    CostTagScope costscope(thread_info, 1);
     TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle_,
                                                   thread_info);
     ImageCacheStatistics& stats(thread_info->m_stats);
@@ -374,16 +560,45 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
 
     const ImageSpec& spec(texturefile->spec(options.subimage, 0));
 
-    // Environment maps dictate particular wrap modes
-    options.swrap = texturefile->m_sample_border
-                        ? TextureOpt::WrapPeriodicSharedBorder
-                        : TextureOpt::WrapPeriodic;
-    options.twrap = TextureOpt::WrapClamp;
-
-    options.envlayout  = LayoutLatLong;
+    // Environment maps dictate particular wrap modes. Cubeface lookups
+    // never reach past the face they're on, so clamp suits them.
+    bool cube = (texturefile->m_envlayout == LayoutCubeThreeByTwo
+                 || texturefile->m_envlayout == LayoutCubeOneBySix);
+    if (cube) {
+        options.swrap     = TextureOpt::WrapClamp;
+        options.twrap     = TextureOpt::WrapClamp;
+        options.envlayout = texturefile->m_envlayout;
+    } else {
+        options.swrap     = texturefile->m_sample_border
+                                ? TextureOpt::WrapPeriodicSharedBorder
+                                : TextureOpt::WrapPeriodic;
+        options.twrap     = TextureOpt::WrapClamp;
+        options.envlayout = LayoutLatLong;
+    }
     int actualchannels = Imath::clamp(spec.nchannels - options.firstchannel, 0,
                                       nchannels);
 
+    ImageCacheFile::SubimageInfo& subinfo(
+        texturefile->subimageinfo(options.subimage));
+    if (subinfo.is_constant_image) {
+        // Constant color environment (its wrap modes never reach black)
+        // -- every direction gets the same answer.
+        for (int c = 0; c < actualchannels; ++c)
+            result[c] = subinfo.average_color[c + options.firstchannel];
+        for (int c = actualchannels; c < nchannels; ++c)
+            result[c] = options.fill;
+        if (dresultds && dresultdt) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c] = 0.0f;
+                dresultdt[c] = 0.0f;
+            }
+        }
+        if (actualchannels < nchannels && options.firstchannel == 0
+            && m_gray_to_rgb)
+            fill_gray_channels(spec, nchannels, result, dresultds, dresultdt);
+        return true;
+    }
+
     // Initialize results to 0.  We'll add from here on as we sample.
     for (int c = 0; c < nchannels; ++c)
         result[c] = 0;
@@ -475,16 +690,28 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
         invsamples = 1.0f;
     }
 
-    ImageCacheFile::SubimageInfo& subinfo(
-        texturefile->subimageinfo(options.subimage));
+    // Texels per radian of MIP level m: the vertical resolution of a
+    // latlong map is PI radians, and a cube face spans PI/2 on average.
+    auto texels_per_radian = [&](int m) -> float {
+        const ImageSpec& mspec(subinfo.spec(m));
+        if (cube)
+            return float(CubeLevel(mspec, options.envlayout).faceres)
+                   * float(M_2_PI);
+        return float(mspec.full_height) * float(M_1_PI);
+    };
 
-    // FIXME -- assuming latlong
     bool ok   = true;
     float pos = -0.5f + 0.5f * invsamples;
     for (int sample = 0; sample < nsamples; ++sample, pos += invsamples) {
         Imath::V3f Rsamp = R + pos * Rmajor;
-        float s, t;
-        vector_to_latlong(Rsamp, texturefile->m_y_up, s, t);
+        float s = 0.0f, t = 0.0f;
+        int face = 0;
+        if (cube)
+            face = vector_to_cubeface(cubeface_direction(Rsamp,
+                                                         texturefile->m_y_up),
+                                      s, t);
+        else
+            vector_to_latlong(Rsamp, texturefile->m_y_up, s, t);
 
         // Determine the MIP-map level(s) we need: we will blend
         //  data(miplevel[0]) * (1-levelblend) + data(miplevel[1]) * levelblend
@@ -494,11 +721,9 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
         int nmiplevels = (int)subinfo.levels.size();
         for (int m = 0; m < nmiplevels; ++m) {
             // Compute the filter size in raster space at this MIP level.
-            // Filters are in radians, and the vertical resolution of a
-            // latlong map is PI radians.  So to compute the raster size of
+            // Filters are in radians, so to compute the raster size of
             // our filter width...
-            float filtwidth_ras = subinfo.spec(m).full_height * filtwidth
-                                  * M_1_PI;
+            float filtwidth_ras = texels_per_radian(m) * filtwidth;
             // Once the filter width is smaller than one texel at this level,
             // we've gone too far, so we know that we want to interpolate the
             // previous level and the current level.  Note that filtwidth_ras
@@ -545,7 +770,7 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
             int lev = miplevel[level];
             if (options.interpmode == TextureOpt::InterpSmartBicubic) {
                 if (lev == 0
-                    || (texturefile->spec(options.subimage, lev).full_height
+                    || (texels_per_radian(lev) * float(M_PI)
                         < naturalres / 2)) {
                     sampler = &TextureSystemImpl::sample_bicubic;
                     ++stats.cubic_interps;
@@ -557,16 +782,25 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
                 *probecount += 1;
             }
 
-            OIIO_SIMD4_ALIGN float sval[4] = { s, 0.0f, 0.0f, 0.0f };
-            OIIO_SIMD4_ALIGN float tval[4] = { t, 0.0f, 0.0f, 0.0f };
-            OIIO_SIMD4_ALIGN float weight[4]
-                = { levelweight[level] * invsamples, 0.0f, 0.0f, 0.0f };
             vfloat4 r, drds, drdt;
-            ok &= (this->*sampler)(1, sval, tval, miplevel[level], *texturefile,
-                                   thread_info, options, nchannels,
-                                   actualchannels, weight, &r,
-                                   dresultds ? &drds : NULL,
-                                   dresultds ? &drdt : NULL);
+            if (cube) {
+                ok &= sample_cubeface(face, s, t, lev, *texturefile,
+                                      thread_info, options, sampler, nchannels,
+                                      actualchannels,
+                                      levelweight[level] * invsamples, &r,
+                                      dresultds ? &drds : NULL,
+                                      dresultds ? &drdt : NULL);
+            } else {
+                OIIO_SIMD4_ALIGN float sval[4] = { s, 0.0f, 0.0f, 0.0f };
+                OIIO_SIMD4_ALIGN float tval[4] = { t, 0.0f, 0.0f, 0.0f };
+                OIIO_SIMD4_ALIGN float weight[4]
+                    = { levelweight[level] * invsamples, 0.0f, 0.0f, 0.0f };
+                ok &= (this->*sampler)(1, sval, tval, lev, *texturefile,
+                                       thread_info, options, nchannels,
+                                       actualchannels, weight, &r,
+                                       dresultds ? &drds : NULL,
+                                       dresultds ? &drdt : NULL);
+            }
             for (int c = 0; c < nchannels; ++c)
                 result[c] += r[c];
             if (dresultds) {
@@ -590,14 +824,429 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
 
 
 bool
-TextureSystemImpl::environment(TextureHandle* texture_handle,
-                               Perthread* thread_info, TextureOptBatch& options,
-                               Tex::RunMask mask, const float* R,
-                               const float* dRdx, const float* dRdy,
-                               int nchannels, float* result, float* dresultds,
+TextureSystemImpl::environment(TextureHandle* texture_handle_,
+                               Perthread* thread_info_,
+                               TextureOptBatch& options, Tex::RunMask mask,
+                               const float* R_, const float* dRdx_,
+                               const float* dRdy_, int nchannels,
+                               float* result, float* dresultds,
                                float* dresultdt)
 {
-    // (FIXME) CHEAT! Texture points individually
+    typedef Tex::FloatWide FloatWide;
+    typedef FloatWide::vint_t IntWide;
+    typedef FloatWide::vbool_t BoolWide;
+
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    mask &= Tex::RunMaskOn;
+
+    // >4 channel lookups are split by recursion in the single-point
+    // environment(), and it is the single-point call that defines what a
+    // subimage name means for an environment map, so those cases (and
+    // UDIM, which has no meaning here) just go lane by lane.
+    if (!texturefile || texturefile->is_udim() || nchannels > 4
+        || !options.subimagename.empty())
+        return environment_batch_per_lane(texture_handle_, thread_info_,
+                                          options, mask, R_, dRdx_, dRdy_,
+                                          nchannels, result, dresultds,
+                                          dresultdt);
+
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    texturefile = verify_texturefile(texturefile, thread_info);
+
+    int nlanes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        nlanes += (mask >> i) & 1;
+    CostTagScope costscope(thread_info, nlanes);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.environment_batches;
+    stats.environment_queries += nlanes;
+
+    TextureOpt opt;
+    opt.firstchannel        = options.firstchannel;
+    opt.subimage            = options.subimage;
+    opt.swrap               = (TextureOpt::Wrap)options.swrap;
+    opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
+    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
+    opt.anisotropic         = options.anisotropic;
+    opt.conservative_filter = options.conservative_filter;
+    opt.fill                = options.fill;
+    opt.missingcolor        = options.missingcolor;
+
+    // Scatter one lane's (vfloat4-padded) results into the SOA outputs.
+    auto store_lane = [&](int lane, const float* r, const float* drds,
+                          const float* drdt) {
+        for (int c = 0; c < nchannels; ++c)
+            result[c * Tex::BatchWidth + lane] = r[c];
+        if (dresultds) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c * Tex::BatchWidth + lane] = drds[c];
+                dresultdt[c * Tex::BatchWidth + lane] = drdt[c];
+            }
+        }
+    };
+
+    if (!texturefile || texturefile->broken()) {
+        bool ok = true;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (mask & (Tex::RunMask(1) << i)) {
+                float r[4], drds[4], drdt[4];
+                ok &= missing_texture(opt, nchannels, r, drds, drdt);
+                store_lane(i, r, drds, drdt);
+            }
+        }
+        return ok;
+    }
+
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+    const ImageCacheFile::SubimageInfo& subinfo(
+        texturefile->subimageinfo(opt.subimage));
+
+    // Environment maps dictate particular wrap modes
+    bool cube = (texturefile->m_envlayout == LayoutCubeThreeByTwo
+                 || texturefile->m_envlayout == LayoutCubeOneBySix);
+    if (cube) {
+        opt.swrap     = TextureOpt::WrapClamp;
+        opt.twrap     = TextureOpt::WrapClamp;
+        opt.envlayout = texturefile->m_envlayout;
+    } else {
+        opt.swrap     = texturefile->m_sample_border
+                            ? TextureOpt::WrapPeriodicSharedBorder
+                            : TextureOpt::WrapPeriodic;
+        opt.twrap     = TextureOpt::WrapClamp;
+        opt.envlayout = LayoutLatLong;
+    }
+    int actualchannels = Imath::clamp(spec.nchannels - opt.firstchannel, 0,
+                                      nchannels);
+    bool gray_fill = (actualchannels < nchannels && opt.firstchannel == 0
+                      && m_gray_to_rgb);
+    // If the user only provided us with one pointer, don't compute either.
+    bool derivs = (dresultds && dresultdt);
+
+    if (subinfo.is_constant_image) {
+        // Constant color environment -- every lane gets the same answer.
+        OIIO_SIMD4_ALIGN float r[4]    = { 0.0f, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int c = 0; c < actualchannels; ++c)
+            r[c] = subinfo.average_color[c + opt.firstchannel];
+        for (int c = actualchannels; c < nchannels; ++c)
+            r[c] = opt.fill;
+        if (gray_fill)
+            fill_gray_channels(spec, nchannels, r, nullptr, nullptr);
+        for (int i = 0; i < Tex::BatchWidth; ++i)
+            if (mask & (Tex::RunMask(1) << i))
+                store_lane(i, r, zero, zero);
+        return true;
+    }
+
+    // Unit-length vectors in the direction of R, R+dRdx, R+dRdy, for all
+    // lanes at once.  These define the ellipse we're filtering over.
+    FloatWide R[3], Rx[3], Ry[3];
+    for (int k = 0; k < 3; ++k) {
+        R[k]  = FloatWide(R_ + k * Tex::BatchWidth);
+        Rx[k] = R[k] + FloatWide(dRdx_ + k * Tex::BatchWidth);
+        Ry[k] = R[k] + FloatWide(dRdy_ + k * Tex::BatchWidth);
+    }
+    auto normalize = [](FloatWide* v) {
+        FloatWide len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        BoolWide nonzero = (len != 0.0f);
+        for (int k = 0; k < 3; ++k)
+            v[k] = blend(v[k], v[k] / len, nonzero);
+    };
+    normalize(R);
+    normalize(Rx);
+    normalize(Ry);
+    FloatWide Xdot = R[0] * Rx[0] + R[1] * Rx[1] + R[2] * Rx[2];
+    FloatWide Ydot = R[0] * Ry[0] + R[1] * Ry[1] + R[2] * Ry[2];
+
+    // Angles formed by the ellipse axes (see the single-point version for
+    // the FIXMEs about naturalres).
+    FloatWide Xfilt_noblur, Yfilt_noblur;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        Xfilt_noblur[i] = safe_acos(Xdot[i]);
+        Yfilt_noblur[i] = safe_acos(Ydot[i]);
+    }
+    Xfilt_noblur = max(Xfilt_noblur, 1e-8f);
+    Yfilt_noblur = max(Yfilt_noblur, 1e-8f);
+    IntWide Naturalres(float(M_PI) / min(Xfilt_noblur, Yfilt_noblur));
+
+    // Account for width and blur, figure out major versus minor axis
+    FloatWide Xfilt = Xfilt_noblur * FloatWide(options.swidth)
+                      + FloatWide(options.sblur);
+    FloatWide Yfilt = Yfilt_noblur * FloatWide(options.twidth)
+                      + FloatWide(options.tblur);
+    BoolWide x_is_majoraxis = (Xfilt >= Yfilt);
+    FloatWide Rmajor[3];
+    for (int k = 0; k < 3; ++k)
+        Rmajor[k] = blend(Ry[k], Rx[k], x_is_majoraxis);
+    FloatWide Majorlength = blend(Yfilt, Xfilt, x_is_majoraxis);
+    FloatWide Minorlength = blend(Xfilt, Yfilt, x_is_majoraxis);
+
+    bool aniso = (opt.mipmode == TextureOpt::MipModeDefault
+                  || opt.mipmode == TextureOpt::MipModeAniso);
+    FloatWide Filtwidth;
+    IntWide Nsamples(1);
+    if (aniso) {
+        // anisotropic_aspect may adjust the axis lengths, lane by lane
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (!(mask & (Tex::RunMask(1) << i)))
+                continue;
+            float majorlength = Majorlength[i], minorlength = Minorlength[i];
+            float trueaspect;
+            float aspect = anisotropic_aspect(majorlength, minorlength, opt,
+                                              trueaspect);
+            Filtwidth[i] = minorlength;
+            Nsamples[i]  = std::max(1, (int)ceilf(aspect - 0.25f));
+            if (trueaspect > stats.max_aniso)
+                stats.max_aniso = trueaspect;
+        }
+    } else {
+        Filtwidth = opt.conservative_filter ? Majorlength : Minorlength;
+    }
+    FloatWide Invsamples = 1.0f / FloatWide(Nsamples);
+    int maxsamples       = 1;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        if (mask & (Tex::RunMask(1) << i))
+            maxsamples = std::max(maxsamples, int(Nsamples[i]));
+
+    // Texels per radian of MIP level m: the vertical resolution of a
+    // latlong map is PI radians, and a cube face spans PI/2 on average.
+    auto texels_per_radian = [&](int m) -> float {
+        const ImageSpec& mspec(subinfo.spec(m));
+        if (cube)
+            return float(CubeLevel(mspec, opt.envlayout).faceres)
+                   * float(M_2_PI);
+        return float(mspec.full_height) * float(M_1_PI);
+    };
+
+    // The MIP level choice only depends on the filter width, not on where
+    // each sample lands, so it's the same for every sample of a lane.
+    int nmiplevels = (int)subinfo.levels.size();
+    IntWide Level0(-1), Level1(-1);
+    FloatWide Levelblend(0.0f);
+    for (int m = 0; m < nmiplevels; ++m) {
+        // Filters are in radians.
+        FloatWide filtwidth_ras = texels_per_radian(m) * Filtwidth;
+        BoolWide found = (filtwidth_ras <= 1.0f) & (Level1 < 0);
+        Level0         = blend(Level0, IntWide(m - 1), found);
+        Level1         = blend(Level1, IntWide(m), found);
+        Levelblend = blend(Levelblend,
+                           min(max(2.0f * filtwidth_ras - 1.0f, 0.0f), 1.0f),
+                           found);
+        if (all(Level1 >= 0))
+            break;
+    }
+    BoolWide coarsest = (Level1 < 0);  // want blurrier than we have
+    Level0            = blend(Level0, IntWide(nmiplevels - 1), coarsest);
+    Level1            = blend(Level1, IntWide(nmiplevels - 1), coarsest);
+    BoolWide finest   = (Level0 < 0);  // want sharper than we have
+    Level0            = blend(Level0, IntWide(0), finest);
+    Level1            = blend(Level1, IntWide(0), finest);
+    Levelblend        = blend0not(Levelblend, coarsest | finest);
+    if (opt.mipmode == TextureOpt::MipModeOneLevel) {
+        Level1     = Level0;
+        Levelblend = 0.0f;
+    } else if (opt.mipmode == TextureOpt::MipModeNoMIP) {
+        Level0     = 0;
+        Level1     = 0;
+        Levelblend = 0.0f;
+    }
+
+    static const sampler_prototype sample_functions[] = {
+        // Must be in the same order as InterpMode enum
+        &TextureSystemImpl::sample_closest,
+        &TextureSystemImpl::sample_bilinear,
+        &TextureSystemImpl::sample_bicubic,
+        &TextureSystemImpl::sample_bilinear,
+    };
+    sampler_prototype sampler = sample_functions[(int)opt.interpmode];
+    bool smart_bicubic = (opt.interpmode == TextureOpt::InterpSmartBicubic);
+
+    vfloat4 accum[Tex::BatchWidth], daccumds[Tex::BatchWidth],
+        daccumdt[Tex::BatchWidth];
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        accum[i].clear();
+        daccumds[i].clear();
+        daccumdt[i].clear();
+    }
+
+    // Sample positions along the major axis, converted to latlong, or to
+    // a cube face and the st within it, for all lanes at once.  Lanes that
+    // need fewer samples than the widest one just sit out the later passes.
+    bool ok       = true;
+    int npointson = 0, nbicubic = 0, nbilinear = 0;
+    FloatWide Pos = -0.5f + 0.5f * Invsamples;
+    for (int sample = 0; sample < maxsamples; ++sample, Pos += Invsamples) {
+        FloatWide Rsamp[3];
+        for (int k = 0; k < 3; ++k)
+            Rsamp[k] = R[k] + Pos * Rmajor[k];
+        FloatWide S, T;
+        IntWide Face(0);
+        if (cube) {
+            // The same as vector_to_cubeface, after cubeface_direction.
+            FloatWide X = Rsamp[0], Y = Rsamp[1], Z = Rsamp[2];
+            if (!texturefile->m_y_up) {
+                X = -Rsamp[1];
+                Y = Rsamp[2];
+                Z = Rsamp[0];
+            }
+            FloatWide AX = abs(X), AY = abs(Y), AZ = abs(Z);
+            BoolWide xmajor = (AX >= AY) & (AX >= AZ);
+            BoolWide ymajor = (!xmajor) & (AY >= AZ);
+            FloatWide Ma = max(blend(blend(AZ, AY, ymajor), AX, xmajor),
+                               1.0e-30f);
+            FloatWide Sc = blend(blend(blend(-X, X, Z >= 0.0f), X, ymajor),
+                                 blend(Z, -Z, X >= 0.0f), xmajor);
+            FloatWide Tc = blend(-Y, blend(-Z, Z, Y >= 0.0f), ymajor);
+            Face = blend(blend(blend(IntWide(5), IntWide(4), Z >= 0.0f),
+                               blend(IntWide(3), IntWide(2), Y >= 0.0f),
+                               ymajor),
+                         blend(IntWide(1), IntWide(0), X >= 0.0f), xmajor);
+            S = 0.5f * (Sc / Ma + 1.0f);
+            T = 0.5f * (Tc / Ma + 1.0f);
+        } else {
+            // s = atan2(a, b) / 2pi + 0.5,
+            // t = 0.5 - atan2(c, hypot(b, a)) / pi
+            FloatWide A, B, C;
+            if (texturefile->m_y_up) {
+                A = -Rsamp[0];
+                B = Rsamp[2];
+                C = Rsamp[1];
+            } else {
+                A = Rsamp[1];
+                B = Rsamp[0];
+                C = Rsamp[2];
+            }
+            for (int i = 0; i < Tex::BatchWidth; ++i) {
+                S[i] = atan2f(A[i], B[i]);
+                T[i] = atan2f(C[i], hypotf(B[i], A[i]));
+            }
+            S = S / (2.0f * float(M_PI)) + 0.5f;
+            T = 0.5f - T / float(M_PI);
+        }
+        // learned from experience, beware NaNs
+        S = blend0not(S, S != S);
+        T = blend0not(T, T != T);
+
+        // Group together the lanes that land on the same tile of the same
+        // MIP level, so consecutive lookups hit the tile microcache.
+        int lanes[Tex::BatchWidth];
+        uint64_t lanekey[Tex::BatchWidth];
+        int nactive = 0;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (!(mask & (Tex::RunMask(1) << i)) || sample >= Nsamples[i])
+                continue;
+            int lev                = Level0[i];
+            const ImageSpec& lspec = subinfo.spec(lev);
+            int tx, ty;
+            if (cube) {
+                CubeLevel cl(lspec, opt.envlayout);
+                tx = (cl.face_x(Face[i]) + ifloor(S[i] * cl.faceres))
+                     / std::max(lspec.tile_width, 1);
+                ty = (cl.face_y(Face[i]) + ifloor(T[i] * cl.faceres))
+                     / std::max(lspec.tile_height, 1);
+            } else {
+                tx = ifloor(S[i] * lspec.width)
+                     / std::max(lspec.tile_width, 1);
+                ty = ifloor(T[i] * lspec.height)
+                     / std::max(lspec.tile_height, 1);
+            }
+            lanekey[i] = (uint64_t(lev) << 48)
+                         | (uint64_t(uint32_t(ty) & 0xffffff) << 24)
+                         | uint64_t(uint32_t(tx) & 0xffffff);
+            lanes[nactive++] = i;
+        }
+        std::stable_sort(lanes, lanes + nactive,
+                         [&](int a, int b) { return lanekey[a] < lanekey[b]; });
+
+        for (int l = 0; l < nactive; ++l) {
+            int i                          = lanes[l];
+            OIIO_SIMD4_ALIGN float sval[4] = { S[i], 0.0f, 0.0f, 0.0f };
+            OIIO_SIMD4_ALIGN float tval[4] = { T[i], 0.0f, 0.0f, 0.0f };
+            float lblend                   = Levelblend[i];
+            int miplevel[2]                = { Level0[i], Level1[i] };
+            float levelweight[2]           = { 1.0f - lblend, lblend };
+            for (int level = 0; level < 2; ++level) {
+                if (!levelweight[level])
+                    continue;
+                ++npointson;
+                int lev = miplevel[level];
+                if (smart_bicubic) {
+                    if (lev == 0
+                        || (texels_per_radian(lev) * float(M_PI)
+                            < Naturalres[i] / 2)) {
+                        sampler = &TextureSystemImpl::sample_bicubic;
+                        ++nbicubic;
+                    } else {
+                        sampler = &TextureSystemImpl::sample_bilinear;
+                        ++nbilinear;
+                    }
+                }
+                OIIO_SIMD4_ALIGN float weight[4]
+                    = { levelweight[level] * Invsamples[i], 0.0f, 0.0f, 0.0f };
+                vfloat4 r, drds, drdt;
+                if (cube)
+                    ok &= sample_cubeface(Face[i], S[i], T[i], lev,
+                                          *texturefile, thread_info, opt,
+                                          sampler, nchannels, actualchannels,
+                                          weight[0], &r,
+                                          derivs ? &drds : nullptr,
+                                          derivs ? &drdt : nullptr);
+                else
+                    ok &= (this->*sampler)(1, sval, tval, lev, *texturefile,
+                                           thread_info, opt, nchannels,
+                                           actualchannels, weight, &r,
+                                           derivs ? &drds : nullptr,
+                                           derivs ? &drdt : nullptr);
+                accum[i] += r;
+                if (derivs) {
+                    daccumds[i] += drds;
+                    daccumdt[i] += drdt;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        float* drds = derivs ? (float*)&daccumds[i] : nullptr;
+        float* drdt = derivs ? (float*)&daccumdt[i] : nullptr;
+        if (gray_fill)
+            fill_gray_channels(spec, nchannels, (float*)&accum[i], drds, drdt);
+        store_lane(i, (const float*)&accum[i], (const float*)&daccumds[i],
+                   (const float*)&daccumdt[i]);
+    }
+
+    // Update stats
+    stats.aniso_queries += nlanes;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        if (mask & (Tex::RunMask(1) << i))
+            stats.aniso_probes += Nsamples[i];
+    switch (opt.interpmode) {
+    case TextureOpt::InterpClosest: stats.closest_interps += npointson; break;
+    case TextureOpt::InterpBilinear:
+        stats.bilinear_interps += npointson;
+        break;
+    case TextureOpt::InterpBicubic: stats.cubic_interps += npointson; break;
+    case TextureOpt::InterpSmartBicubic:
+        stats.cubic_interps += nbicubic;
+        stats.bilinear_interps += nbilinear;
+        break;
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::environment_batch_per_lane(
+    TextureHandle* texture_handle, Perthread* thread_info,
+    TextureOptBatch& options, Tex::RunMask mask, const float* R,
+    const float* dRdx, const float* dRdy, int nchannels, float* result,
+    float* dresultds, float* dresultdt)
+{
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
@@ -611,10 +1260,14 @@ TextureSystemImpl::environment(TextureHandle* texture_handle,
     opt.fill                = options.fill;
     opt.missingcolor        = options.missingcolor;
 
+    // temp results for one lane
+    float* r    = OIIO_ALLOCA(float, nchannels);
+    float* drds = OIIO_ALLOCA(float, nchannels);
+    float* drdt = OIIO_ALLOCA(float, nchannels);
+
     bool ok          = true;
     Tex::RunMask bit = 1;
     for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4];  // temp result
         if (mask & bit) {
             opt.sblur  = options.sblur[i];
             opt.tblur  = options.tblur[i];
@@ -29,27 +29,41 @@
 */
 
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <OpenEXR/ImathMatrix.h>
 
+#include <zlib.h>
+
+#ifdef __linux__
+#    include <sched.h>
+#endif
+
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/optparser.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/texture.h>
 #include <OpenImageIO/thread.h>
+#include <OpenImageIO/tiffutils.h>
 #include <OpenImageIO/timer.h>
+#include <OpenImageIO/trace.h>
 #include <OpenImageIO/typedesc.h>
 #include <OpenImageIO/ustring.h>
 #include <OpenImageIO/varyingref.h>
@@ -127,6 +141,14 @@ iorate_compare(const ImageCacheFileRef& a, const ImageCacheFileRef& b)
 }
 
 
+// Functor to compare the longest single read, sort in descending order
+static bool
+maxreadtime_compare(const ImageCacheFileRef& a, const ImageCacheFileRef& b)
+{
+    return a->max_read_time() > b->max_read_time();
+}
+
+
 // Functor to compare amount of redundant reading, sort in descending order
 static bool
 redundantbytes_compare(const ImageCacheFileRef& a, const ImageCacheFileRef& b)
@@ -135,6 +157,79 @@ redundantbytes_compare(const ImageCacheFileRef& a, const ImageCacheFileRef& b)
 }
 
 
+
+// Describe the upper limit of bucket b of the ImageCacheStatistics time
+// histograms, 2^b microseconds.
+static std::string
+time_hist_limit(int b)
+{
+    double us = double(1 << b);
+    if (us < 1000.0)
+        return Strutil::sprintf("%gus", us);
+    if (us < 1.0e6)
+        return Strutil::sprintf("%.3gms", us * 1.0e-3);
+    return Strutil::sprintf("%.3gs", us * 1.0e-6);
+}
+
+
+
+// The NUMA node of each CPU, read once from sysfs. Empty if unknown
+// (including on anything but Linux).
+static const std::vector<int>&
+numa_cpu_nodes()
+{
+    static std::vector<int> cpu_nodes = []() {
+        std::vector<int> nodes;
+        for (int n = 0; n < MAX_NUMA_NODES; ++n) {
+            for (int cpu : Sysutil::numa_node_cpus(n)) {
+                if (int(nodes.size()) <= cpu)
+                    nodes.resize(cpu + 1, 0);
+                nodes[cpu] = n;
+            }
+        }
+        return nodes;
+    }();
+    return cpu_nodes;
+}
+
+
+
+// How many NUMA nodes does this machine have?
+static int
+numa_node_count()
+{
+    int count = 1;
+    for (int n : numa_cpu_nodes())
+        count = std::max(count, n + 1);
+    return count;
+}
+
+
+
+// The NUMA node that the calling thread is running on right now.
+static int
+current_numa_node()
+{
+#ifdef __linux__
+    const std::vector<int>& nodes(numa_cpu_nodes());
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < int(nodes.size()))
+        return nodes[cpu];
+#endif
+    return 0;
+}
+
+
+
+// The sidecar file where the automip levels of an unmipped file are
+// saved for later processes ("automip_sidecar" option).
+static std::string
+automip_sidecar_name(ustring filename)
+{
+    return filename.string() + ".automip.tx";
+}
+
+
 };  // end anonymous namespace
 
 
@@ -148,6 +243,7 @@ ImageCacheStatistics::init()
     // ImageCache stats:
     find_tile_calls             = 0;
     find_tile_microcache_misses = 0;
+    find_tile_pinned_hits       = 0;
     find_tile_cache_misses      = 0;
     //    tiles_created = 0;
     //    tiles_current = 0;
@@ -155,16 +251,47 @@ ImageCacheStatistics::init()
     files_totalsize        = 0;
     files_totalsize_ondisk = 0;
     bytes_read             = 0;
+    prefetch_requests       = 0;
+    prefetch_tiles          = 0;
+    compressed_tiles_stored = 0;
+    compressed_tile_hits    = 0;
+    disk_cache_hits         = 0;
+    disk_cache_writes       = 0;
+    shared_tile_hits        = 0;
+    shared_tile_stores      = 0;
+    mapped_tiles            = 0;
+    untiled_band_reuses     = 0;
+    automip_builds          = 0;
+    automip_tiles           = 0;
+    for (int n = 0; n < MAX_NUMA_NODES; ++n) {
+        numa_local_hits[n]   = 0;
+        numa_remote_hits[n]  = 0;
+        numa_replica_hits[n] = 0;
+    }
+    numa_replicas = 0;
+    tiles_evicted = 0;
+    for (int b = 0; b < TILE_CACHE_SHARDS; ++b) {
+        shard_hits[b]   = 0;
+        shard_misses[b] = 0;
+    }
+    for (int b = 0; b < time_hist_buckets; ++b) {
+        read_time_hist[b] = 0;
+        wait_time_hist[b] = 0;
+    }
     //    open_files_created = 0;
     //    open_files_current = 0;
     //    open_files_peak = 0;
-    unique_files      = 0;
-    fileio_time       = 0;
-    fileopen_time     = 0;
-    file_locking_time = 0;
-    tile_locking_time = 0;
-    find_file_time    = 0;
-    find_tile_time    = 0;
+    unique_files          = 0;
+    fileio_time           = 0;
+    fileopen_time         = 0;
+    file_reopens          = 0;
+    file_reopen_time      = 0;
+    file_locking_time     = 0;
+    tile_locking_time     = 0;
+    tile_wait_time        = 0;
+    tile_coalesced_misses = 0;
+    find_file_time        = 0;
+    find_tile_time        = 0;
 
     // TextureSystem stats:
     texture_queries     = 0;
@@ -178,6 +305,9 @@ ImageCacheStatistics::init()
     aniso_queries       = 0;
     aniso_probes        = 0;
     max_aniso           = 1;
+    ewa_texels          = 0;
+    sat_queries         = 0;
+    empty_tile_skips    = 0;
     closest_interps     = 0;
     bilinear_interps    = 0;
     cubic_interps       = 0;
@@ -193,6 +323,7 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     // ImageCache stats:
     find_tile_calls += s.find_tile_calls;
     find_tile_microcache_misses += s.find_tile_microcache_misses;
+    find_tile_pinned_hits += s.find_tile_pinned_hits;
     find_tile_cache_misses += s.find_tile_cache_misses;
     //    tiles_created += s.tiles_created;
     //    tiles_current += s.tiles_current;
@@ -200,14 +331,45 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     files_totalsize += s.files_totalsize;
     files_totalsize_ondisk += s.files_totalsize_ondisk;
     bytes_read += s.bytes_read;
+    prefetch_requests += s.prefetch_requests;
+    prefetch_tiles += s.prefetch_tiles;
+    compressed_tiles_stored += s.compressed_tiles_stored;
+    compressed_tile_hits += s.compressed_tile_hits;
+    disk_cache_hits += s.disk_cache_hits;
+    disk_cache_writes += s.disk_cache_writes;
+    shared_tile_hits += s.shared_tile_hits;
+    shared_tile_stores += s.shared_tile_stores;
+    mapped_tiles += s.mapped_tiles;
+    untiled_band_reuses += s.untiled_band_reuses;
+    automip_builds += s.automip_builds;
+    automip_tiles += s.automip_tiles;
+    for (int n = 0; n < MAX_NUMA_NODES; ++n) {
+        numa_local_hits[n] += s.numa_local_hits[n];
+        numa_remote_hits[n] += s.numa_remote_hits[n];
+        numa_replica_hits[n] += s.numa_replica_hits[n];
+    }
+    numa_replicas += s.numa_replicas;
+    tiles_evicted += s.tiles_evicted;
+    for (int b = 0; b < TILE_CACHE_SHARDS; ++b) {
+        shard_hits[b] += s.shard_hits[b];
+        shard_misses[b] += s.shard_misses[b];
+    }
+    for (int b = 0; b < time_hist_buckets; ++b) {
+        read_time_hist[b] += s.read_time_hist[b];
+        wait_time_hist[b] += s.wait_time_hist[b];
+    }
     //    open_files_created += s.open_files_created;
     //    open_files_current += s.open_files_current;
     //    open_files_peak += s.open_files_peak;
     unique_files += s.unique_files;
     fileio_time += s.fileio_time;
     fileopen_time += s.fileopen_time;
+    file_reopens += s.file_reopens;
+    file_reopen_time += s.file_reopen_time;
     file_locking_time += s.file_locking_time;
     tile_locking_time += s.tile_locking_time;
+    tile_wait_time += s.tile_wait_time;
+    tile_coalesced_misses += s.tile_coalesced_misses;
     find_file_time += s.find_file_time;
     find_tile_time += s.find_tile_time;
 
@@ -223,6 +385,9 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     aniso_queries += s.aniso_queries;
     aniso_probes += s.aniso_probes;
     max_aniso = std::max(max_aniso, s.max_aniso);
+    ewa_texels += s.ewa_texels;
+    sat_queries += s.sat_queries;
+    empty_tile_skips += s.empty_tile_skips;
     closest_interps += s.closest_interps;
     bilinear_interps += s.bilinear_interps;
     cubic_interps += s.cubic_interps;
@@ -232,6 +397,50 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
 
 
 
+// Parse the "oiio:ConstantTiles" metadata that maketx writes for a level
+// of a tiled texture, "WIDTHxHEIGHT:FIRST[-LAST]=V0,V1,...;...", runs of
+// tiles (numbered across then down) that all hold the pixel value V. It is
+// ignored unless it describes a level of this resolution (a format whose
+// MIP levels share one header gives them all the top level's), and
+// entirely if any of it is malformed.
+static void
+parse_constant_tiles(string_view desc, const ImageSpec& spec, int ntiles,
+                     std::vector<int>& tile, std::vector<float>& values)
+{
+    int w, h;
+    if (!Strutil::parse_int(desc, w) || !Strutil::parse_char(desc, 'x')
+        || !Strutil::parse_int(desc, h) || !Strutil::parse_char(desc, ':')
+        || w != spec.width || h != spec.height)
+        return;
+    tile.assign(ntiles, -1);
+    while (desc.size()) {
+        int first, last;
+        bool ok = Strutil::parse_int(desc, first);
+        last    = first;
+        if (ok && Strutil::parse_char(desc, '-'))
+            ok = Strutil::parse_int(desc, last);
+        ok &= Strutil::parse_char(desc, '=') && first >= 0 && last >= first
+              && last < ntiles;
+        int index = int(values.size());
+        for (int c = 0; ok && c < spec.nchannels; ++c) {
+            float v;
+            ok = Strutil::parse_float(desc, v)
+                 && (c == spec.nchannels - 1 || Strutil::parse_char(desc, ','));
+            values.push_back(v);
+        }
+        if (!ok) {
+            tile.clear();
+            values.clear();
+            return;
+        }
+        for (int t = first; t <= last; ++t)
+            tile[t] = index;
+        Strutil::parse_char(desc, ';');
+    }
+}
+
+
+
 ImageCacheFile::LevelInfo::LevelInfo(const ImageSpec& spec_,
                                      const ImageSpec& nativespec_)
     : spec(spec_)
@@ -244,6 +453,7 @@ ImageCacheFile::LevelInfo::LevelInfo(const ImageSpec& spec_,
     onetile = (spec.width <= spec.tile_width && spec.height <= spec.tile_height
                && spec.depth <= spec.tile_depth);
     polecolorcomputed = false;
+    pinned_tile       = nullptr;
 
     // Allocate bit field for which tiles have been read at least once.
     if (onetile) {
@@ -257,10 +467,20 @@ ImageCacheFile::LevelInfo::LevelInfo(const ImageSpec& spec_,
     }
     int total_tiles = nxtiles * nytiles * nztiles;
     ASSERT(total_tiles >= 1);
-    const int sz = round_to_multiple(total_tiles, 64) / 64;
+    const int sz = tilebits_words();
     tiles_read   = new atomic_ll[sz];
-    for (int i = 0; i < sz; i++)
-        tiles_read[i] = 0;
+    tiles_needed = new atomic_ll[sz];
+    tiles_empty  = new atomic_ll[sz];
+    for (int i = 0; i < sz; i++) {
+        tiles_read[i]   = 0;
+        tiles_needed[i] = 0;
+        tiles_empty[i]  = 0;
+    }
+    string_view constant_tiles = nativespec.get_string_attribute(
+        "oiio:ConstantTiles");
+    if (constant_tiles.size() && spec.tile_width && !onetile)
+        parse_constant_tiles(constant_tiles, nativespec, total_tiles,
+                             constant_tile, constant_values);
 }
 
 
@@ -275,11 +495,19 @@ ImageCacheFile::LevelInfo::LevelInfo(const LevelInfo& src)
     , nxtiles(src.nxtiles)
     , nytiles(src.nytiles)
     , nztiles(src.nztiles)
+    , pinned_tile(nullptr)  // the copy does not hold a reference
+    , constant_tile(src.constant_tile)
+    , constant_values(src.constant_values)
 {
-    int nwords = round_to_multiple(nxtiles * nytiles * nztiles, 64) / 64;
-    tiles_read = new atomic_ll[nwords];
-    for (int i = 0; i < nwords; ++i)
-        tiles_read[i] = src.tiles_read[i].load();
+    int nwords   = tilebits_words();
+    tiles_read   = new atomic_ll[nwords];
+    tiles_needed = new atomic_ll[nwords];
+    tiles_empty  = new atomic_ll[nwords];
+    for (int i = 0; i < nwords; ++i) {
+        tiles_read[i]   = src.tiles_read[i].load();
+        tiles_needed[i] = src.tiles_needed[i].load();
+        tiles_empty[i]  = src.tiles_empty[i].load();
+    }
 }
 
 
@@ -305,6 +533,7 @@ ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
     , m_redundant_bytesread(0)
     , m_timesopened(0)
     , m_iotime(0)
+    , m_max_read_time_us(0)
     , m_mutex_wait_time(0)
     , m_mipused(false)
     , m_validspec(false)
@@ -320,6 +549,8 @@ ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
     m_filename = imagecache.resolve_filename(m_filename_original.string());
     // N.B. the file is not opened, the ImageInput is NULL.  This is
     // reflected by the fact that m_validspec is false.
+    for (auto& h : m_read_time_hist)
+        h = 0;
 
     // Figure out if it's a UDIM-like virtual texture
     if (!Filesystem::exists(m_filename.string())
@@ -334,7 +565,11 @@ ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
 
 
 
-ImageCacheFile::~ImageCacheFile() { close(); }
+ImageCacheFile::~ImageCacheFile()
+{
+    close();
+    delete m_udim_table.load();
+}
 
 
 
@@ -420,6 +655,16 @@ ImageCacheFile::SubimageInfo::init(ImageCacheFile& icfile,
     channelsize = datatype.size();
     pixelsize   = channelsize * spec.nchannels;
 
+    // Sparse volumes (e.g., OpenVDB grids) may tell us the value held
+    // everywhere outside their active regions.
+    const ParamValue* bg = spec.find_attribute("oiio:background");
+    if (bg && bg->type().basetype == TypeDesc::FLOAT
+        && bg->type().basevalues() * bg->nvalues() == size_t(spec.nchannels)) {
+        background.resize(pixelsize);
+        convert_types(TypeDesc::FLOAT, bg->data(), datatype, background.data(),
+                      spec.nchannels);
+    }
+
     // See if there's a constant color tag
     string_view software = spec.get_string_attribute("Software");
     bool from_maketx     = Strutil::istarts_with(software, "OpenImageIO")
@@ -481,6 +726,7 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
         return inp;
 
     // The file wasn't already opened and in a good state.
+    OIIO_TRACE_SPAN("ImageCache::open", "ImageCache");
 
     // Enforce limits on maximum number of open files.
     imagecache().check_max_files(thread_info);
@@ -504,22 +750,63 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
         return inp;
     ASSERT(inp.get() == nullptr);
 
+    // A file whose ImageInput was closed to stay within max_open_files
+    // still has all its specs, so reopening it only needs a working
+    // ImageInput: skip the metadata, and go straight to the plugin that
+    // read it before rather than having create() probe the file.
+    Timer reopen_timer;
+    bool reopen = validspec() && !m_fileformat.empty();
+
     ImageSpec configspec;
     if (m_configspec)
         configspec = *m_configspec;
     if (imagecache().unassociatedalpha())
         configspec.attribute("oiio:UnassociatedAlpha", 1);
+    if (reopen)
+        configspec.attribute("oiio:metadata", "none");
+    else if (!configspec.find_attribute("oiio:metadata"))
+        configspec.attribute("oiio:metadata", imagecache().metadata());
+
+    // An unmipped file whose automip levels were saved by an earlier
+    // process is read from that sidecar instead, unless it's stale.
+    if (!validspec() && !m_inputcreator && imagecache().automip()
+        && imagecache().automip_sidecar()) {
+        std::string sidecar = automip_sidecar_name(m_filename);
+        if (Filesystem::exists(sidecar)
+            && Filesystem::last_write_time(sidecar)
+                   >= Filesystem::last_write_time(m_filename.string()))
+            m_filename = ustring(sidecar);
+    }
+
+    // URLs are read through a proxy that the ImageInput will own.
+    std::unique_ptr<Filesystem::IOProxy> urlio;
+    if (!m_inputcreator
+        && pvt::wants_url_ioproxy(m_filename.string(), &configspec)) {
+        ImageSpec urlconfig;
+        urlio = pvt::open_url_ioproxy(m_filename.string(), &configspec,
+                                      urlconfig);
+        if (!urlio) {
+            mark_broken(OIIO::geterror());
+            invalidate_spec();
+            return {};
+        }
+        configspec = urlconfig;
+    }
 
     if (m_inputcreator)
         inp.reset(m_inputcreator());
     else
-        inp = ImageInput::create(m_filename.string(), false, &configspec,
+        inp = ImageInput::create(reopen ? m_fileformat.string()
+                                        : m_filename.string(),
+                                 false, &configspec,
                                  m_imagecache.plugin_searchpath());
     if (!inp) {
         mark_broken(OIIO::geterror());
         invalidate_spec();
         return {};
     }
+    if (urlio)
+        inp->adopt_ioproxy(urlio.release());
 
     ImageSpec nativespec, tempspec;
     mark_not_broken();
@@ -551,6 +838,8 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     // valid, we're done, no need to reread the subimage and mip headers.
     if (validspec()) {
         set_imageinput(inp);
+        ++thread_info->m_stats.file_reopens;
+        thread_info->m_stats.file_reopen_time += reopen_timer();
         return inp;
     }
 
@@ -558,8 +847,24 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     // first time.  So read all the subimages, fill out all the fields
     // of the ImageCacheFile.
     m_subimages.clear();
+    m_metadata_decoded = false;
     int nsubimages = 0;
 
+    // A "oiio:TargetColorSpace" hint asks for the pixels to be converted
+    // as they're read, so that what's cached is already in that space.
+    ustring targetcolorspace;
+    m_colorprocessor = pvt::read_colorprocessor(&configspec, nativespec,
+                                                targetcolorspace);
+    if (targetcolorspace.size() && !m_colorprocessor) {
+        inp.reset();
+        mark_broken(Strutil::sprintf("Could not convert \"%s\" to \"%s\"",
+                                     nativespec.get_string_attribute(
+                                         "oiio:ColorSpace", "Linear"),
+                                     targetcolorspace));
+        invalidate_spec();
+        return {};
+    }
+
     // Since each subimage can potentially have its own mipmap levels,
     // keep track of the highest level discovered
     imagesize_t old_total_imagesize        = m_total_imagesize;
@@ -573,7 +878,8 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
             tempspec = nativespec;
             if (nmip == 0) {
                 // Things to do on MIP level 0, i.e. once per subimage
-                si.init(*this, tempspec, imagecache().forcefloat());
+                si.init(*this, tempspec,
+                        imagecache().forcefloat() || m_colorprocessor);
             }
             if (tempspec.tile_width == 0 || tempspec.tile_height == 0) {
                 si.untiled   = true;
@@ -614,6 +920,8 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
             }
             // ImageCache can't store differing formats per channel
             tempspec.channelformats.clear();
+            if (m_colorprocessor)
+                tempspec.attribute("oiio:ColorSpace", targetcolorspace);
             LevelInfo levelinfo(tempspec, nativespec);
             si.levels.push_back(levelinfo);
             ++nmip;
@@ -675,6 +983,10 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
             inp.reset();
             return {};
         }
+        si.minres.clear();
+        for (const LevelInfo& lev : si.levels)
+            si.minres.push_back(
+                float(std::min(lev.spec.width, lev.spec.height)));
 
         ++nsubimages;
     } while (inp->seek_subimage(nsubimages, 0, nativespec));
@@ -698,6 +1010,93 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
 
 
 
+std::shared_ptr<ImageInput>
+ImageCacheFile::acquire_input(ImageCachePerThreadInfo* thread_info,
+                              const std::shared_ptr<ImageInput>& inp)
+{
+    if (inp->try_lock())
+        return inp;
+    // Custom ImageInputs (procedural, app buffers) may not tolerate
+    // multiple instances, so only pool inputs made by ImageInput::create.
+    int maxinputs = imagecache().max_inputs_per_file();
+    if (maxinputs > 1 && !m_inputcreator) {
+        bool cangrow = false;
+        {
+            spin_lock lock(m_input_pool_mutex);
+            for (auto& p : m_input_pool)
+                if (p->try_lock())
+                    return p;
+            cangrow = (int(m_input_pool.size()) + 1 < maxinputs);
+        }
+        // Everybody is busy. Open another, if we're allowed to.
+        if (cangrow && imagecache().open_files_below_limit()) {
+            std::shared_ptr<ImageInput> extra = open_pooled_input();
+            if (extra) {
+                extra->lock();
+                spin_lock lock(m_input_pool_mutex);
+                // Another thread may have grown the pool at the same time.
+                // If it's full now, our input is used for this one read and
+                // then closed.
+                if (int(m_input_pool.size()) + 1 < maxinputs)
+                    m_input_pool.push_back(extra);
+                return extra;
+            }
+        }
+    }
+    Timer input_mutex_timer;
+    inp->lock();
+    thread_info->m_stats.file_locking_time += input_mutex_timer();
+    return inp;
+}
+
+
+
+std::shared_ptr<ImageInput>
+ImageCacheFile::open_pooled_input()
+{
+    ImageSpec configspec;
+    if (m_configspec)
+        configspec = *m_configspec;
+    if (imagecache().unassociatedalpha())
+        configspec.attribute("oiio:UnassociatedAlpha", 1);
+    if (!configspec.find_attribute("oiio:metadata"))
+        configspec.attribute("oiio:metadata", imagecache().metadata());
+    // Each pooled input needs its own proxy for a URL, since a proxy has
+    // a single file position.
+    std::unique_ptr<Filesystem::IOProxy> urlio;
+    if (pvt::wants_url_ioproxy(m_filename.string(), &configspec)) {
+        ImageSpec urlconfig;
+        urlio = pvt::open_url_ioproxy(m_filename.string(), &configspec,
+                                      urlconfig);
+        if (!urlio) {
+            (void)OIIO::geterror();
+            return {};
+        }
+        configspec = urlconfig;
+    }
+    auto newinp = ImageInput::create(m_filename.string(), false, &configspec,
+                                     m_imagecache.plugin_searchpath());
+    if (newinp && urlio)
+        newinp->adopt_ioproxy(urlio.release());
+    ImageSpec nativespec;
+    if (!newinp || !newinp->open(m_filename.c_str(), nativespec, configspec)) {
+        // Not fatal, the caller just waits for the primary ImageInput.
+        if (newinp)
+            (void)newinp->geterror();  // Eat the errors
+        (void)OIIO::geterror();
+        return {};
+    }
+    // Count it among the open files for as long as it lives.
+    ImageCacheImpl* ic = &imagecache();
+    ic->incr_open_files();
+    return std::shared_ptr<ImageInput>(newinp.release(), [=](ImageInput* p) {
+        delete p;
+        ic->decr_open_files();
+    });
+}
+
+
+
 void
 ImageCacheFile::init_from_spec()
 {
@@ -769,8 +1168,12 @@ ImageCacheFile::init_from_spec()
     // Squash some problematic texture metadata if we suspect it's wrong
     pvt::check_texture_metadata_sanity(spec);
 
-    // See if there's a SHA-1 hash in the image description
+    // See if there's a SHA-1 hash in the image description, or failing
+    // that, a pixel hash by another algorithm (which is prefixed by the
+    // algorithm name, so it can't match a SHA-1 by accident).
     string_view fing = spec.get_string_attribute("oiio:SHA-1");
+    if (fing.empty())
+        fing = spec.get_string_attribute("oiio:PixelHash");
     if (fing.length())
         m_fingerprint = ustring(fing);
 
@@ -795,9 +1198,11 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
                           int chend, TypeDesc format, void* data)
 {
     ASSERT(chend > chbegin);
+    OIIO_TRACE_SPAN("ImageCache::read_tile", "ImageCache");
     std::shared_ptr<ImageInput> inp = open(thread_info);
     if (!inp)
         return false;
+    Timer timer;
 
     // Mark if we ever use a mip level that's not the first
     if (miplevel > 0)
@@ -809,26 +1214,35 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
     SubimageInfo& subinfo(subimageinfo(subimage));
 
     // Special case for un-MIP-mapped
-    if (subinfo.unmipped && miplevel != 0)
-        return read_unmipped(thread_info, inp.get(), subimage, miplevel, x, y,
-                             z, chbegin, chend, format, data);
+    if (subinfo.unmipped && miplevel != 0) {
+        bool ok = read_unmipped(thread_info, inp.get(), subimage, miplevel, x,
+                                y, z, chbegin, chend, format, data);
+        note_read_time(thread_info, timer());
+        return ok;
+    }
 
     // Special case for untiled images -- need to do tile emulation
-    if (subinfo.untiled)
-        return read_untiled(thread_info, inp.get(), subimage, miplevel, x, y, z,
-                            chbegin, chend, format, data);
+    if (subinfo.untiled) {
+        bool ok = read_untiled(thread_info, inp.get(), subimage, miplevel, x,
+                               y, z, chbegin, chend, format, data);
+        note_read_time(thread_info, timer());
+        return ok;
+    }
 
-    // Ordinary tiled
+    // Ordinary tiled. Read through whichever of the file's ImageInputs
+    // is free, so that concurrent misses on one file can decode in
+    // parallel.
     bool ok = true;
     const ImageSpec& spec(this->spec(subimage, miplevel));
+    std::shared_ptr<ImageInput> reader = acquire_input(thread_info, inp);
     for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
-        ok = inp->read_tiles(subimage, miplevel, x, x + spec.tile_width, y,
-                             y + spec.tile_height, z, z + spec.tile_depth,
-                             chbegin, chend, format, data);
+        ok = reader->read_tiles(subimage, miplevel, x, x + spec.tile_width, y,
+                                y + spec.tile_height, z, z + spec.tile_depth,
+                                chbegin, chend, format, data);
         if (ok) {
             if (tries)  // succeeded, but only after a failure!
                 ++thread_info->m_stats.tile_retry_success;
-            (void)inp->geterror();  // Eat the errors
+            (void)reader->geterror();  // Eat the errors
             break;
         }
         if (tries < imagecache().failure_retries()) {
@@ -838,10 +1252,16 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
         }
     }
     if (!ok) {
-        std::string err = inp->geterror();
+        std::string err = reader->geterror();
         if (!err.empty() && errors_should_issue())
             imagecache().errorf("%s", err);
     }
+    reader->unlock();
+    if (ok && m_colorprocessor)
+        convert_color(subimage, chbegin, chend, format, data, spec.tile_width,
+                      spec.tile_height, spec.tile_depth, AutoStride,
+                      AutoStride, AutoStride);
+    note_read_time(thread_info, timer());
 
     if (ok) {
         size_t b = spec.tile_bytes();
@@ -854,6 +1274,212 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
 
 
 
+bool
+ImageCacheFile::read_tiles(ImageCachePerThreadInfo* thread_info, int subimage,
+                           int miplevel, int xbegin, int xend, int y, int z,
+                           int chbegin, int chend, TypeDesc format, void* data)
+{
+    ASSERT(chend > chbegin);
+    OIIO_TRACE_SPAN("ImageCache::read_tiles", "ImageCache");
+    std::shared_ptr<ImageInput> inp = open(thread_info);
+    if (!inp)
+        return false;
+    if (miplevel > 0)
+        m_mipused = true;
+    const ImageSpec& spec(this->spec(subimage, miplevel));
+    int ntiles = (xend - xbegin + spec.tile_width - 1) / spec.tile_width;
+    m_mipreadcount[miplevel] += ntiles;
+
+    bool ok = true;
+    Timer timer;
+    std::shared_ptr<ImageInput> reader = acquire_input(thread_info, inp);
+    for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
+        ok = reader->read_tiles(subimage, miplevel, xbegin, xend, y,
+                                y + spec.tile_height, z, z + spec.tile_depth,
+                                chbegin, chend, format, data);
+        if (ok) {
+            if (tries)  // succeeded, but only after a failure!
+                ++thread_info->m_stats.tile_retry_success;
+            (void)reader->geterror();  // Eat the errors
+            break;
+        }
+        if (tries < imagecache().failure_retries())
+            Sysutil::usleep(1000 * 100);  // 100 ms
+    }
+    if (!ok) {
+        std::string err = reader->geterror();
+        if (!err.empty() && errors_should_issue())
+            imagecache().errorf("%s", err);
+    }
+    reader->unlock();
+    if (ok && m_colorprocessor)
+        convert_color(subimage, chbegin, chend, format, data, xend - xbegin,
+                      spec.tile_height, spec.tile_depth, AutoStride,
+                      AutoStride, AutoStride);
+    note_read_time(thread_info, timer());
+
+    if (ok) {
+        size_t b = spec.tile_bytes() * ntiles;
+        thread_info->m_stats.bytes_read += b;
+        m_bytesread += b;
+        m_tilesread += ntiles;
+    }
+    return ok;
+}
+
+
+
+void
+ImageCacheFile::note_read_time(ImageCachePerThreadInfo* thread_info,
+                               double seconds)
+{
+    int b = ImageCacheStatistics::time_hist_bucket(seconds);
+    ++m_read_time_hist[b];
+    ++thread_info->m_stats.read_time_hist[b];
+    atomic_max(m_max_read_time_us, (long long)(seconds * 1.0e6));
+}
+
+
+
+void
+ImageCacheFile::convert_color(int subimage, int chbegin, int chend,
+                              TypeDesc format, void* data, int width,
+                              int height, int depth, stride_t xstride,
+                              stride_t ystride, stride_t zstride)
+{
+    // Wrap the pixels in an ImageBuf so colorconvert can work on them in
+    // place. The alpha channel (if it was read) is located relative to
+    // the channels we have.
+    const ImageSpec& nspec(levelinfo(subimage, 0).nativespec);
+    ImageSpec bufspec(width, height, chend - chbegin, format);
+    bufspec.depth         = depth;
+    bufspec.alpha_channel = (nspec.alpha_channel >= chbegin
+                             && nspec.alpha_channel < chend)
+                                ? nspec.alpha_channel - chbegin
+                                : -1;
+    ImageBuf buf(bufspec, data, xstride, ystride, zstride);
+    bool unpremult = !(m_configspec
+                       && m_configspec->get_int_attribute(
+                           "oiio:UnassociatedAlpha"));
+    ImageBufAlgo::colorconvert(buf, buf, m_colorprocessor.get(), unpremult,
+                               ROI(), 1);
+}
+
+
+
+const char*
+ImageCacheFile::mapped_tile(ImageCachePerThreadInfo* thread_info,
+                            const TileID& id,
+                            std::shared_ptr<MappedImageFile>& mapping)
+{
+    int subimage = id.subimage(), miplevel = id.miplevel();
+    if (!imagecache().mmap_tiles() || is_udim() || broken()
+        || m_colorprocessor)
+        return nullptr;
+    const SubimageInfo& subinfo(subimageinfo(subimage));
+    const LevelInfo& lev(levelinfo(subimage, miplevel));
+    const ImageSpec& nspec(lev.nativespec);
+    // The cached tile must be exactly the file's native tile: all the
+    // channels, in the file's own data type.
+    if (subinfo.untiled || (subinfo.unmipped && miplevel != 0)
+        || id.chbegin() != 0 || id.chend() != nspec.nchannels
+        || subinfo.datatype != nspec.format || !nspec.channelformats.empty()
+        || lev.spec.tile_width != nspec.tile_width
+        || lev.spec.tile_height != nspec.tile_height
+        || lev.spec.tile_depth != nspec.tile_depth)
+        return nullptr;
+    {
+        spin_lock lock(m_mapped_mutex);
+        if (!m_mapped && !m_map_failed) {
+            m_mapped     = MappedImageFile::map(m_filename.string());
+            m_map_failed = !m_mapped;
+        }
+        mapping = m_mapped;
+    }
+    if (!mapping)
+        return nullptr;
+
+    std::shared_ptr<ImageInput> inp = open(thread_info);
+    if (!inp)
+        return nullptr;
+    std::shared_ptr<ImageInput> reader = acquire_input(thread_info, inp);
+    imagesize_t offset = 0;
+    bool ok = reader->native_tile_offset(subimage, miplevel, id.x(), id.y(),
+                                         id.z(), offset);
+    (void)reader->geterror();  // Eat the errors, we'll just read instead
+    reader->unlock();
+    // The tile's SIMD padding has to be in the mapping, too.
+    if (!ok
+        || offset + nspec.tile_bytes() + OIIO_SIMD_MAX_SIZE_BYTES
+               > mapping->size()) {
+        mapping.reset();
+        return nullptr;
+    }
+    ++thread_info->m_stats.mapped_tiles;
+    return mapping->data() + offset;
+}
+
+
+
+bool
+ImageCacheFile::constant_tile(ImageCachePerThreadInfo* thread_info,
+                              const TileID& id, void* pixel)
+{
+    int subimage = id.subimage(), miplevel = id.miplevel();
+    const SubimageInfo& subinfo(subimageinfo(subimage));
+    const LevelInfo& lev(levelinfo(subimage, miplevel));
+    const ImageSpec& nspec(lev.nativespec);
+    bool recorded = !lev.constant_tile.empty();
+    if ((subinfo.background.empty() && !recorded) || is_udim() || broken()
+        || m_colorprocessor)
+        return false;
+    // Only when our tile is exactly one of the file's native tiles.
+    if (subinfo.untiled || (subinfo.unmipped && miplevel != 0)
+        || !nspec.channelformats.empty()
+        || lev.spec.tile_width != nspec.tile_width
+        || lev.spec.tile_height != nspec.tile_height
+        || lev.spec.tile_depth != nspec.tile_depth)
+        return false;
+
+    if (recorded) {
+        // The file's metadata gives the value. Quantize it to the file's
+        // data type, as it was when written, then convert that just as a
+        // read of the tile would.
+        int index = lev.constant_tile[lev.tile_index(id.x(), id.y(), id.z())];
+        if (index < 0)
+            return false;
+        std::vector<char> native(nspec.pixel_bytes(true));
+        convert_types(TypeFloat, &lev.constant_values[index], nspec.format,
+                      native.data(), nspec.nchannels);
+        convert_types(nspec.format,
+                      native.data() + id.chbegin() * nspec.format.size(),
+                      subinfo.datatype, pixel, id.nchannels());
+        return true;
+    }
+
+    // Otherwise ask the reader, which must give our own data type.
+    if (subinfo.datatype != nspec.format)
+        return false;
+
+    std::shared_ptr<ImageInput> inp = open(thread_info);
+    if (!inp)
+        return false;
+    std::shared_ptr<ImageInput> reader = acquire_input(thread_info, inp);
+    std::vector<char> value(nspec.pixel_bytes(true));
+    bool ok = reader->native_tile_constant(subimage, miplevel, id.x(), id.y(),
+                                           id.z(), value.data());
+    (void)reader->geterror();  // Eat the errors, we'll just read instead
+    reader->unlock();
+    if (ok) {
+        size_t channelsize = nspec.format.size();
+        memcpy(pixel, value.data() + id.chbegin() * channelsize,
+               id.nchannels() * channelsize);
+    }
+    return ok;
+}
+
+
+
 bool
 ImageCacheFile::read_unmipped(ImageCachePerThreadInfo* thread_info,
                               ImageInput* inp, int subimage, int miplevel,
@@ -900,8 +1526,11 @@ ImageCacheFile::read_unmipped(ImageCachePerThreadInfo* thread_info,
     // tile after the pixels are read.  Well, except that below our call
     // to get_pixels may recursively trigger more tiles to be read, and
     // totally change the microcache.  Simple solution: save & restore it.
-    ImageCacheTileRef oldtile     = thread_info->tile;
-    ImageCacheTileRef oldlasttile = thread_info->lasttile;
+    ImageCacheTileRef oldtile = thread_info->tile;
+    ImageCacheTileRef oldlasttile[ImageCachePerThreadInfo::max_microcache - 1];
+    std::copy(std::begin(thread_info->lasttile),
+              std::end(thread_info->lasttile), std::begin(oldlasttile));
+    int oldnextlasttile = thread_info->next_lasttile;
 
     // Auto-mipping will totally thrash the cache if the user unwisely
     // sets it to be too small compared to the image file that needs to
@@ -910,44 +1539,181 @@ ImageCacheFile::read_unmipped(ImageCachePerThreadInfo* thread_info,
     imagecache().set_min_cache_size(
         2 * (long long)this->spec(subimage, 0).image_bytes());
 
-    // Texel by texel, generate the values by interpolating filtered
-    // lookups form the next finer subimage.
-    const ImageSpec& upspec(
-        this->spec(subimage, miplevel - 1));  // next higher level
-    float* bilerppels = (float*)alloca(4 * nchans * sizeof(float));
-    float* resultpel  = (float*)alloca(nchans * sizeof(float));
-    bool ok           = true;
-    // FIXME(volume) -- loop over z, too
-    for (int j = y0; j <= y1; ++j) {
-        float yf = (j + 0.5f) / spec.full_height;
-        int ylow;
-        float yfrac = floorfrac(yf * upspec.full_height - 0.5, &ylow);
-        for (int i = x0; i <= x1; ++i) {
-            float xf = (i + 0.5f) / spec.full_width;
-            int xlow;
-            float xfrac = floorfrac(xf * upspec.full_width - 0.5, &xlow);
-            ok &= imagecache().get_pixels(this, thread_info, subimage,
-                                          miplevel - 1, xlow, xlow + 2, ylow,
-                                          ylow + 2, 0, 1, chbegin, chend,
-                                          TypeDesc::FLOAT, bilerppels);
-            bilerp(bilerppels + 0, bilerppels + nchans, bilerppels + 2 * nchans,
-                   bilerppels + 3 * nchans, xfrac, yfrac, nchans, resultpel);
-            lores.setpixel(i - x0, j - y0, resultpel);
-        }
-    }
-
-    // Now convert and copy those values out to the caller's buffer
-    lores.get_pixels(ROI(0, tw, 0, th, 0, 1, chbegin, chend), format, data);
+    // The first time, start building all the levels at once. Once they're
+    // built, tiles are simply copied out of them; until then, do it the
+    // slow way below.
+    SubimageInfo& si(subimageinfo(subimage));
+    std::shared_ptr<const std::vector<ImageBuf>> levels;
+    bool queue = false;
+    {
+        spin_lock lock(si.automip_mutex);
+        levels = si.automip_levels;
+        if (!levels && !si.automip_queued)
+            queue = si.automip_queued = true;
+    }
+    if (queue) {
+        imagecache().queue_automip(this, subimage);
+        // With no pool threads, the build has already run right here.
+        spin_lock lock(si.automip_mutex);
+        levels = si.automip_levels;
+    }
+
+    bool ok = true;
+    if (levels) {
+        const ImageBuf& level((*levels)[miplevel - 1]);
+        ROI tileroi(spec.x + x0, spec.x + x0 + tw, spec.y + y0,
+                    spec.y + y0 + th, 0, 1, chbegin, chend);
+        ok = level.get_pixels(tileroi, format, data);
+        ++thread_info->m_stats.automip_tiles;
+    } else {
+        // Texel by texel, generate the values by interpolating filtered
+        // lookups form the next finer subimage.
+        const ImageSpec& upspec(
+            this->spec(subimage, miplevel - 1));  // next higher level
+        float* bilerppels = (float*)alloca(4 * nchans * sizeof(float));
+        float* resultpel  = (float*)alloca(nchans * sizeof(float));
+        // FIXME(volume) -- loop over z, too
+        for (int j = y0; j <= y1; ++j) {
+            float yf = (j + 0.5f) / spec.full_height;
+            int ylow;
+            float yfrac = floorfrac(yf * upspec.full_height - 0.5, &ylow);
+            for (int i = x0; i <= x1; ++i) {
+                float xf = (i + 0.5f) / spec.full_width;
+                int xlow;
+                float xfrac = floorfrac(xf * upspec.full_width - 0.5, &xlow);
+                ok &= imagecache().get_pixels(this, thread_info, subimage,
+                                              miplevel - 1, xlow, xlow + 2,
+                                              ylow, ylow + 2, 0, 1, chbegin,
+                                              chend, TypeDesc::FLOAT,
+                                              bilerppels);
+                bilerp(bilerppels + 0, bilerppels + nchans,
+                       bilerppels + 2 * nchans, bilerppels + 3 * nchans,
+                       xfrac, yfrac, nchans, resultpel);
+                lores.setpixel(i - x0, j - y0, resultpel);
+            }
+        }
+
+        // Now convert and copy those values out to the caller's buffer
+        lores.get_pixels(ROI(0, tw, 0, th, 0, 1, chbegin, chend), format,
+                         data);
+    }
 
     // Restore the microcache to the way it was before.
-    thread_info->tile     = oldtile;
-    thread_info->lasttile = oldlasttile;
+    thread_info->tile = oldtile;
+    std::copy(std::begin(oldlasttile), std::end(oldlasttile),
+              std::begin(thread_info->lasttile));
+    thread_info->next_lasttile = oldnextlasttile;
 
     return ok;
 }
 
 
 
+void
+ImageCacheFile::build_automip_levels(ImageCachePerThreadInfo* thread_info,
+                                     int subimage)
+{
+    SubimageInfo& si(subimageinfo(subimage));
+    const ImageSpec& spec0(si.spec(0));
+    int nchans = spec0.nchannels;
+
+    // Pull the whole full-res level through the cache (read_unmipped has
+    // already made sure there is room for it).
+    ImageSpec fspec(spec0.width, spec0.height, nchans, TypeDesc::FLOAT);
+    fspec.x = spec0.x;
+    fspec.y = spec0.y;
+    ImageBuf finer(fspec);
+    if (!imagecache().get_pixels(this, thread_info, subimage, 0, spec0.x,
+                                 spec0.x + spec0.width, spec0.y,
+                                 spec0.y + spec0.height, spec0.z, spec0.z + 1,
+                                 0, nchans, TypeDesc::FLOAT,
+                                 finer.localpixels()))
+        return;  // Leave it to read_unmipped's slow path
+    // Pixels converted as they were read mustn't be saved for processes
+    // that may not want them converted.
+    bool save_sidecar = imagecache().automip_sidecar() && !m_colorprocessor;
+    ImageBuf level0;
+    if (save_sidecar)
+        level0.copy(finer, si.datatype);
+
+    // Each level samples the next finer one at its pixel centers, just
+    // as read_unmipped does a tile at a time (but clamping at the edges).
+    auto shared = std::make_shared<std::vector<ImageBuf>>();
+    shared->reserve(si.miplevels() - 1);
+    for (int m = 1; m < si.miplevels(); ++m) {
+        const ImageSpec& spec(si.spec(m));
+        const ImageSpec& upspec(finer.spec());
+        ImageSpec cspec(spec.width, spec.height, nchans, TypeDesc::FLOAT);
+        cspec.x = spec.x;
+        cspec.y = spec.y;
+        ImageBuf coarser(cspec);
+        auto pel = [&](int i, int j) {
+            i = clamp(i, 0, upspec.width - 1) + upspec.x;
+            j = clamp(j, 0, upspec.height - 1) + upspec.y;
+            return (const float*)finer.pixeladdr(i, j);
+        };
+        for (int j = 0; j < spec.height; ++j) {
+            float yf = (j + 0.5f) / spec.height;
+            int ylow;
+            float yfrac = floorfrac(yf * upspec.height - 0.5, &ylow);
+            for (int i = 0; i < spec.width; ++i) {
+                float xf = (i + 0.5f) / spec.width;
+                int xlow;
+                float xfrac = floorfrac(xf * upspec.width - 0.5, &xlow);
+                bilerp(pel(xlow, ylow), pel(xlow + 1, ylow),
+                       pel(xlow, ylow + 1), pel(xlow + 1, ylow + 1), xfrac,
+                       yfrac, nchans,
+                       (float*)coarser.pixeladdr(i + spec.x, j + spec.y));
+            }
+        }
+        // Keep it in the same data type as the cache's tiles
+        ImageBuf stored;
+        stored.copy(coarser, si.datatype);
+        shared->push_back(std::move(stored));
+        finer = std::move(coarser);
+    }
+    std::shared_ptr<const std::vector<ImageBuf>> levels(shared);
+    {
+        spin_lock lock(si.automip_mutex);
+        si.automip_levels = levels;
+    }
+
+    if (save_sidecar) {
+        // Save the whole pyramid as a tiled, MIP-mapped TIFF, writing to
+        // a temporary name and renaming it into place so that no other
+        // process ever sees a partial file.
+        // The sidecar will stand in for the file, so it needs all of the
+        // file's metadata, decoded.
+        decode_metadata();
+        std::string sidecar = automip_sidecar_name(m_filename);
+        std::string tmp = sidecar + "." + Filesystem::unique_path() + ".tmp";
+        auto out        = ImageOutput::create("tiff");
+        bool ok         = out && out->supports("mipmap");
+        for (int m = 0; ok && m < si.miplevels(); ++m) {
+            const ImageBuf& buf(m ? (*levels)[m - 1] : level0);
+            ImageSpec outspec = buf.spec();
+            outspec.extra_attribs = si.nativespec(0).extra_attribs;
+            outspec.set_format(si.datatype);
+            outspec.tile_width  = 64;
+            outspec.tile_height = 64;
+            outspec.tile_depth  = 1;
+            ok = out->open(tmp, outspec,
+                           m ? ImageOutput::AppendMIPLevel
+                             : ImageOutput::Create)
+                 && buf.write(out.get());
+        }
+        if (out)
+            ok &= out->close();
+        if (!ok || !Filesystem::rename(tmp, sidecar))
+            Filesystem::remove(tmp);
+        if (out)
+            (void)out->geterror();  // Not worth reporting, just eat it
+    }
+    ++thread_info->m_stats.automip_builds;
+}
+
+
+
 // Helper routine for read_tile that handles the rare (but tricky) case
 // of reading a "tile" from a file that's scanline-oriented.
 bool
@@ -979,55 +1745,114 @@ ImageCacheFile::read_untiled(ImageCachePerThreadInfo* thread_info,
         // buffer to be an even multiple of the tile width, so round up.
         stride_t scanlinesize = tw * ((spec.width + tw - 1) / tw);
         scanlinesize *= pixelsize;
-        std::unique_ptr<char[]> buf(
-            new char[scanlinesize * th]);  // a whole tile-row size
-        int yy = y - spec.y;               // counting from top scanline
+        int yy = y - spec.y;  // counting from top scanline
         // [y0,y1] is the range of scanlines to read for a tile-row
         int y0 = yy - (yy % th);
         int y1 = std::min(y0 + th - 1, spec.height - 1);
         y0 += spec.y;
         y1 += spec.y;
-        // Read the whole tile-row worth of scanlines
-        ok = inp->read_scanlines(subimage, miplevel, y0, y1 + 1, z, chbegin,
-                                 chend, format, (void*)&buf[0], pixelsize,
-                                 scanlinesize);
-        if (!ok) {
-            std::string err = inp->geterror();
-            if (!err.empty() && errors_should_issue())
-                imagecache().errorf("%s", err);
+
+        // Other threads asking for tiles of the same band (or this one
+        // again, once those tiles are evicted) should slice them from the
+        // band we already decoded, not read it all over again. So only
+        // one thread at a time reads a band of this file, and the last
+        // one read is kept until the file is closed.
+        std::shared_ptr<char> band;
+        {
+            std::lock_guard<std::mutex> readlock(m_band_read_mutex);
+            {
+                spin_lock lock(m_band_mutex);
+                if (m_band.subimage == subimage && m_band.miplevel == miplevel
+                    && m_band.ybegin == y0 && m_band.z == z
+                    && m_band.chbegin == chbegin && m_band.chend == chend
+                    && m_band.format == format)
+                    band = m_band.pixels;
+            }
+            if (band) {
+                ++thread_info->m_stats.untiled_band_reuses;
+            } else {
+                // a whole tile-row size
+                band.reset(new char[scanlinesize * th],
+                           std::default_delete<char[]>());
+                // Read the whole tile-row worth of scanlines
+                ok = inp->read_scanlines(subimage, miplevel, y0, y1 + 1, z,
+                                         chbegin, chend, format, band.get(),
+                                         pixelsize, scanlinesize);
+                if (!ok) {
+                    std::string err = inp->geterror();
+                    if (!err.empty() && errors_should_issue())
+                        imagecache().errorf("%s", err);
+                } else if (m_colorprocessor) {
+                    convert_color(subimage, chbegin, chend, format,
+                                  band.get(), spec.width, y1 - y0 + 1, 1,
+                                  pixelsize, scanlinesize, AutoStride);
+                }
+                size_t b = (y1 - y0 + 1) * spec.scanline_bytes();
+                thread_info->m_stats.bytes_read += b;
+                m_bytesread += b;
+                ++m_tilesread;
+                if (ok) {
+                    spin_lock lock(m_band_mutex);
+                    m_band.subimage = subimage;
+                    m_band.miplevel = miplevel;
+                    m_band.ybegin   = y0;
+                    m_band.z        = z;
+                    m_band.chbegin  = chbegin;
+                    m_band.chend    = chend;
+                    m_band.format   = format;
+                    m_band.pixels   = band;
+                }
+            }
         }
-        size_t b = (y1 - y0 + 1) * spec.scanline_bytes();
-        thread_info->m_stats.bytes_read += b;
-        m_bytesread += b;
-        ++m_tilesread;
+        const char* buf = band.get();
 
-        // For all tiles in the tile-row, enter them into the cache if not
-        // already there.  Special case for the tile we're actually being
-        // asked for -- save it in 'data' rather than adding a tile.
+        // This is the tile we've been asked for -- save it in 'data'
+        // rather than adding a tile.
         int xx = x - spec.x;      // counting from left row
         int x0 = xx - (xx % tw);  // start of the tile we are retrieving
+        convert_image(nchans, tw, th, 1, &buf[x0 * pixelsize], format,
+                      pixelsize, scanlinesize, scanlinesize * th, data, format,
+                      xstride, ystride, zstride);
+
+        // The others aren't the tile we asked for, but they're in the same
+        // tile-row, so let's put them in the cache (if not already there)
+        // so they'll be there when asked for.
+        std::vector<int> others;
         for (int i = 0; i < spec.width; i += tw) {
-            if (i == xx) {
-                // This is the tile we've been asked for
-                convert_image(nchans, tw, th, 1, &buf[x0 * pixelsize], format,
-                              pixelsize, scanlinesize, scanlinesize * th, data,
-                              format, xstride, ystride, zstride);
-            } else {
-                // Not the tile we asked for, but it's in the same
-                // tile-row, so let's put it in the cache anyway so
-                // it'll be there when asked for.
-                TileID id(*this, subimage, miplevel, i + spec.x, y0, z, chbegin,
-                          chend);
-                if (!imagecache().tile_in_cache(id, thread_info)) {
-                    ImageCacheTileRef tile;
-                    tile = new ImageCacheTile(id, &buf[i * pixelsize], format,
-                                              pixelsize, scanlinesize,
-                                              scanlinesize * th);
-                    ok &= tile->valid();
-                    imagecache().add_tile_to_cache(tile, thread_info);
-                }
-            }
+            if (i == x0)
+                continue;
+            TileID id(*this, subimage, miplevel, i + spec.x, y0, z, chbegin,
+                      chend);
+            if (!imagecache().tile_in_cache(id, thread_info))
+                others.push_back(i);
         }
+        std::atomic<bool> allvalid(true);
+        auto add_tile = [&](int i, ImageCachePerThreadInfo* tinfo) {
+            TileID id(*this, subimage, miplevel, i + spec.x, y0, z, chbegin,
+                      chend);
+            ImageCacheTileRef tile;
+            tile = new ImageCacheTile(id, &buf[i * pixelsize], format,
+                                      pixelsize, scanlinesize,
+                                      scanlinesize * th);
+            if (!tile->valid())
+                allvalid = false;
+            imagecache().add_tile_to_cache(tile, tinfo);
+        };
+        if (imagecache().autotile_parallel() && others.size() > 1) {
+            // Converting and copying the tiles out of a wide band is a
+            // lot of memory traffic; split it among the default pool.
+            // Each job counts its tiles in its own thread's stats.
+            parallel_for(0, int64_t(others.size()),
+                         [&](int64_t t) {
+                             add_tile(others[t],
+                                      imagecache().get_perthread_info());
+                         },
+                         parallel_options(0, Split_Y, 1));
+        } else {
+            for (int i : others)
+                add_tile(i, thread_info);
+        }
+        ok &= allvalid;
     } else {
         // No auto-tile -- the tile is the whole image
         ok = inp->read_image(subimage, miplevel, chbegin, chend, format, data,
@@ -1036,6 +1861,10 @@ ImageCacheFile::read_untiled(ImageCachePerThreadInfo* thread_info,
             std::string err = inp->geterror();
             if (!err.empty() && errors_should_issue())
                 imagecache().errorf("%s", err);
+        } else if (m_colorprocessor) {
+            convert_color(subimage, chbegin, chend, format, data, spec.width,
+                          spec.height, std::max(spec.depth, 1), xstride,
+                          ystride, zstride);
         }
         size_t b = spec.image_bytes();
         thread_info->m_stats.bytes_read += b;
@@ -1059,6 +1888,20 @@ ImageCacheFile::close()
     // are still hanging onto it.
     std::shared_ptr<ImageInput> empty;
     set_imageinput(empty);
+    // Same for the pooled inputs (each decrements the open file count
+    // when it is finally destroyed).
+    std::vector<std::shared_ptr<ImageInput>> pool;
+    {
+        spin_lock lock(m_input_pool_mutex);
+        pool.swap(m_input_pool);
+    }
+    // The band of an untiled file goes with the open file.
+    std::shared_ptr<char> band;
+    {
+        spin_lock lock(m_band_mutex);
+        band.swap(m_band.pixels);
+        m_band.subimage = -1;
+    }
 }
 
 
@@ -1088,6 +1931,12 @@ ImageCacheFile::invalidate()
     mark_not_broken();
     m_fingerprint.clear();
     duplicate(NULL);
+    {
+        // Tiles still using the old mapping keep it alive themselves
+        spin_lock lock(m_mapped_mutex);
+        m_mapped.reset();
+        m_map_failed = false;
+    }
 
     m_filename = m_imagecache.resolve_filename(m_filename_original.string());
 
@@ -1099,6 +1948,63 @@ ImageCacheFile::invalidate()
 
 
 
+void
+ImageCacheFile::unpin_tiles()
+{
+    for (auto& si : m_subimages) {
+        for (auto& lev : si.levels) {
+            ImageCacheTile* tile = lev.pinned_tile.exchange(nullptr);
+            if (tile) {
+                m_imagecache.unpin_mem(*tile, true);
+                intrusive_ptr_release(tile);
+            }
+        }
+    }
+    std::vector<PinnedTile> pins;
+    {
+        spin_lock lock(m_pinned_tiles_mutex);
+        pins.swap(m_pinned_tiles);
+    }
+    for (auto& p : pins)
+        m_imagecache.unpin_mem(*p.tile, p.automatic);
+    // N.B. the tile references are dropped outside the lock
+}
+
+
+
+void
+ImageCacheFile::add_pinned_tile(const ImageCacheTileRef& tile, bool automatic)
+{
+    spin_lock lock(m_pinned_tiles_mutex);
+    m_pinned_tiles.push_back({ tile, automatic });
+}
+
+
+
+void
+ImageCacheFile::unpin_levels(int subimage, int miplevel_begin,
+                             int miplevel_end)
+{
+    std::vector<PinnedTile> unpinned;
+    {
+        spin_lock lock(m_pinned_tiles_mutex);
+        auto keep = std::partition(m_pinned_tiles.begin(),
+                                   m_pinned_tiles.end(),
+                                   [&](const PinnedTile& p) {
+                                       const TileID& id(p.tile->id());
+                                       return id.subimage() != subimage
+                                              || id.miplevel() < miplevel_begin
+                                              || id.miplevel() >= miplevel_end;
+                                   });
+        unpinned.assign(keep, m_pinned_tiles.end());
+        m_pinned_tiles.erase(keep, m_pinned_tiles.end());
+    }
+    for (auto& p : unpinned)
+        m_imagecache.unpin_mem(*p.tile, p.automatic);
+}
+
+
+
 bool
 ImageCacheFile::get_average_color(float* avg, int subimage, int chbegin,
                                   int chend)
@@ -1138,10 +2044,35 @@ ImageCacheFile::get_average_color(float* avg, int subimage, int chbegin,
 
 
 
+void
+ImageCacheFile::decode_metadata()
+{
+    if (m_metadata_decoded.load(std::memory_order_acquire))
+        return;
+    spin_lock lock(m_metadata_mutex);
+    if (m_metadata_decoded.load(std::memory_order_relaxed))
+        return;
+    for (SubimageInfo& si : m_subimages) {
+        for (LevelInfo& level : si.levels) {
+            OIIO::decode_metadata(level.spec);
+            OIIO::decode_metadata(level.nativespec);
+        }
+    }
+    m_metadata_decoded.store(true, std::memory_order_release);
+}
+
+
+
 int
 ImageCacheFile::errors_should_issue() const
 {
-    return (++m_errors_issued <= imagecache().max_errors_per_file());
+    // Once past the limit, stop counting, so that a storm of lookups of a
+    // broken file doesn't have every thread writing the same counter (nor
+    // ever wrap it around to issue errors again).
+    int limit = imagecache().max_errors_per_file();
+    if (m_errors_issued.load(std::memory_order_relaxed) >= limit)
+        return false;
+    return ++m_errors_issued <= limit;
 }
 
 
@@ -1168,7 +2099,88 @@ ImageCacheFile::mark_broken(string_view error)
 
 
 
-ImageCacheFile*
+FileIndex::Table::Table(size_t size)
+    : mask(size - 1)
+    , count(0)
+    , keys(new std::atomic<const char*>[size])
+    , files(new std::atomic<ImageCacheFile*>[size])
+{
+    for (size_t i = 0; i < size; ++i) {
+        keys[i].store(nullptr, std::memory_order_relaxed);
+        files[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+
+
+FileIndex::FileIndex()
+{
+    m_all.emplace_back(new Table(256));
+    m_table = m_all.back().get();
+}
+
+
+
+FileIndex::~FileIndex() {}
+
+
+
+ImageCacheFile*
+FileIndex::find(ustring filename) const
+{
+    const char* key = filename.c_str();
+    if (!key)
+        return nullptr;
+    const Table* t = m_table.load(std::memory_order_acquire);
+    for (size_t i = filename.hash() & t->mask;; i = (i + 1) & t->mask) {
+        const char* k = t->keys[i].load(std::memory_order_acquire);
+        if (k == key)
+            return t->files[i].load(std::memory_order_relaxed);
+        if (!k)
+            return nullptr;
+    }
+}
+
+
+
+void
+FileIndex::insert(ustring filename, ImageCacheFile* file)
+{
+    const char* key = filename.c_str();
+    if (!key)
+        return;
+    auto place = [](Table* t, const char* key, size_t hash,
+                    ImageCacheFile* file) {
+        size_t i = hash & t->mask;
+        for (const char* k; (k = t->keys[i].load(std::memory_order_relaxed));
+             i = (i + 1) & t->mask)
+            if (k == key)
+                return;  // already there
+        // Publish the file before its key, so that any reader who finds
+        // the key also sees the file.
+        t->files[i].store(file, std::memory_order_relaxed);
+        t->keys[i].store(key, std::memory_order_release);
+        ++t->count;
+    };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Table* t = m_table.load(std::memory_order_relaxed);
+    if (2 * (t->count + 1) > t->mask + 1) {
+        // Copy everything into a table twice the size, then swap it in.
+        std::unique_ptr<Table> bigger(new Table(2 * (t->mask + 1)));
+        for (size_t i = 0; i <= t->mask; ++i)
+            if (const char* k = t->keys[i].load(std::memory_order_relaxed))
+                place(bigger.get(), k, ustring::from_unique(k).hash(),
+                      t->files[i].load(std::memory_order_relaxed));
+        t = bigger.get();
+        m_all.push_back(std::move(bigger));
+        m_table.store(t, std::memory_order_release);
+    }
+    place(t, key, filename.hash(), file);
+}
+
+
+
+ImageCacheFile*
 ImageCacheImpl::find_file(ustring filename,
                           ImageCachePerThreadInfo* thread_info,
                           ImageInput::Creator creator, bool header_only,
@@ -1179,14 +2191,20 @@ ImageCacheImpl::find_file(ustring filename,
     if (!m_substitute_image.empty())
         filename = m_substitute_image;
 
-    // Shortcut - check the per-thread microcache before grabbing a more
-    // expensive lock on the shared file cache.
+    // Shortcut - check the per-thread microcache, and failing that the
+    // lock-free index of the file cache, before grabbing a more expensive
+    // lock on the shared file cache.
     ImageCacheFile* tf = replace ? nullptr : thread_info->find_file(filename);
+    if (!tf && !replace) {
+        tf = m_file_index.find(filename);
+        if (tf)
+            thread_info->filename(filename, tf);  // add to the microcache
+    }
 
     // Make sure the ImageCacheFile entry exists and is in the
     // file cache.  For this part, we need to lock the file cache.
     bool newfile = false;
-    if (!tf) {  // was not found in microcache
+    if (!tf) {  // was not found in microcache or index
 #if IMAGECACHE_TIME_STATS
         Timer timer;
 #endif
@@ -1199,6 +2217,7 @@ ImageCacheImpl::find_file(ustring filename,
             tf = new ImageCacheFile(*this, thread_info, filename, creator,
                                     config);
             m_files.insert(filename, tf, false);
+            m_file_index.insert(filename, tf);
             newfile = true;
         }
         m_files.unlock_bin(bin);
@@ -1446,8 +2465,7 @@ ImageCacheTile::ImageCacheTile(const TileID& id, const void* pels,
         size_t size = memsize_needed();
         ASSERT_MSG(size > 0 && memsize() == 0, "size was %llu, memsize = %llu",
                    (unsigned long long)size, (unsigned long long)memsize());
-        m_pixels_size = size;
-        m_pixels.reset(new char[m_pixels_size]);
+        alloc_pixels(size);
         m_valid
             = convert_image(id.nchannels(), spec.tile_width, spec.tile_height,
                             spec.tile_depth, pels, format, xstride, ystride,
@@ -1461,7 +2479,7 @@ ImageCacheTile::ImageCacheTile(const TileID& id, const void* pels,
         m_valid = true;
     }
     id.file().imagecache().incr_tiles(m_pixels_size);
-    m_pixels_ready = true;  // Caller sent us the pixels, no read necessary
+    mark_pixels_ready();  // Caller sent us the pixels, no read necessary
     // FIXME -- for shadow, fill in mindepth, maxdepth
 }
 
@@ -1469,9 +2487,93 @@ ImageCacheTile::ImageCacheTile(const TileID& id, const void* pels,
 
 ImageCacheTile::~ImageCacheTile()
 {
-    m_id.file().imagecache().decr_tiles(memsize());
+    ImageCacheImpl& ic(m_id.file().imagecache());
+    ic.decr_tiles(memsize());
+    if (m_shared)
+        m_shared->release(m_pixels.get());
     if (m_nofree)
         m_pixels.release();  // release without freeing
+    else if (m_pooled)
+        ic.tile_pool_free(m_pixels.release(), m_pixels_size);
+}
+
+
+
+bool
+ImageCacheTile::use_shared(const std::shared_ptr<SharedTileStore>& store,
+                           string_view key, size_t size)
+{
+    const char* pixels = store->acquire(key, size - OIIO_SIMD_MAX_SIZE_BYTES);
+    if (!pixels)
+        return false;
+    m_pixels.reset((char*)pixels);
+    m_shared      = store;
+    m_nofree      = true;
+    m_pooled      = false;
+    m_pixels_size = size;
+    return true;
+}
+
+
+
+void
+ImageCacheTile::alloc_pixels(size_t size)
+{
+    char* p       = m_id.file().imagecache().tile_pool_alloc(size);
+    m_pooled      = (p != nullptr);
+    m_pixels_size = size;
+    m_pixels.reset(p ? p : new char[size]);
+}
+
+
+
+std::shared_ptr<char>
+ImageCacheImpl::constant_tile_pixels(const void* pixel, int pixelsize,
+                                     size_t npixels)
+{
+    std::string key((const char*)pixel, pixelsize);
+    key.append((const char*)&npixels, sizeof(npixels));
+    spin_lock lock(m_constant_tiles_mutex);
+    std::weak_ptr<char>& entry(m_constant_tiles[key]);
+    std::shared_ptr<char> pixels = entry.lock();
+    if (!pixels) {
+        size_t size = npixels * pixelsize;
+        pixels.reset(new char[size + OIIO_SIMD_MAX_SIZE_BYTES],
+                     std::default_delete<char[]>());
+        for (size_t i = 0; i < size; i += pixelsize)
+            memcpy(pixels.get() + i, pixel, pixelsize);
+        memset(pixels.get() + size, 0, OIIO_SIMD_MAX_SIZE_BYTES);
+        entry = pixels;
+        // Forget the values no tile holds any more, now and then
+        if (m_constant_tiles.size() > 4096) {
+            for (auto i = m_constant_tiles.begin();
+                 i != m_constant_tiles.end();)
+                i = i->second.expired() ? m_constant_tiles.erase(i) : ++i;
+        }
+    }
+    return pixels;
+}
+
+
+
+ImageCacheTileRef
+ImageCacheTile::replica(int node)
+{
+    spin_lock lock(m_replicas_mutex);
+    return m_replicas ? m_replicas[node] : ImageCacheTileRef();
+}
+
+
+
+ImageCacheTileRef
+ImageCacheTile::add_replica(int node, const ImageCacheTileRef& r)
+{
+    spin_lock lock(m_replicas_mutex);
+    if (!m_replicas)
+        m_replicas.reset(new ImageCacheTileRef[MAX_NUMA_NODES]);
+    if (!m_replicas[node])
+        m_replicas[node] = r;
+    return m_replicas[node];
 }
 
 
@@ -1495,26 +2597,104 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
     ImageCacheFile& file(m_id.file());
     m_channelsize = file.datatype(id().subimage()).size();
     m_pixelsize   = m_id.nchannels() * m_channelsize;
-    size_t size   = memsize_needed();
+    // We're about to allocate and fill the pixels, so under the OS's usual
+    // first-touch policy, they will live on this thread's NUMA node.
+    m_numa_node = (signed char)thread_info->numa_node;
+    // A tile stored in the file exactly as we'd hold it can be used right
+    // where it sits in a memory mapping of the file. That costs neither
+    // an allocation nor a copy, and it isn't counted against the cache
+    // memory (memsize() stays 0), since the OS pages it in and out.
+    if (const char* mapped = file.mapped_tile(thread_info, m_id, m_mapping)) {
+        m_pixels.reset((char*)mapped);
+        m_nofree       = true;
+        m_valid        = true;
+        mark_pixels_ready();
+        return;
+    }
+    size_t size = memsize_needed();
     ASSERT(memsize() == 0 && size > OIIO_SIMD_MAX_SIZE_BYTES);
-    m_pixels.reset(new char[m_pixels_size = size]);
+    // A sparse volume's reader may know that a tile is all one value
+    // (usually the background) just from the volume's structure, and a
+    // texture made by maketx lists its constant tiles; either is far
+    // cheaper than producing the tile through the usual read. All the
+    // tiles of the same size and value share one copy of their pixels,
+    // which (like mapped pixels) isn't counted against the cache memory.
+    std::vector<char> constant(m_pixelsize);
+    if (file.constant_tile(thread_info, m_id, constant.data())) {
+        m_constant = file.imagecache().constant_tile_pixels(
+            constant.data(), m_pixelsize,
+            (size - OIIO_SIMD_MAX_SIZE_BYTES) / m_pixelsize);
+        m_pixels.reset(m_constant.get());
+        m_nofree = true;
+        m_valid  = true;
+        mark_pixels_ready();
+        return;
+    }
+    // Another process on this machine (or this one) may have put the tile
+    // in shared memory, where we can use it in place, like a mapped tile.
+    // Unlike those, it counts against the cache memory, so that our own
+    // eviction decides how many slots of the store we keep pinned. The
+    // shared store and the disk cache are keyed by the file alone, so
+    // they're skipped for a file whose pixels are color converted as
+    // they're read.
+    ImageCacheImpl& ic(file.imagecache());
+    size_t rawsize = size - OIIO_SIMD_MAX_SIZE_BYTES;
+    bool converted = file.colorprocessor() != nullptr;
+    std::shared_ptr<SharedTileStore> shared;
+    if (!converted)
+        shared = ic.shared_tiles();
+    std::string key = shared ? ic.tile_key(m_id) : std::string();
+    if (shared && use_shared(shared, key, size)) {
+        ++thread_info->m_stats.shared_tile_hits;
+        ic.incr_mem(size);
+        m_valid = true;
+        mark_pixels_ready();
+        return;
+    }
+    alloc_pixels(size);
     // Clear the end pad values so there aren't NaNs sucked up by simd loads
     memset(m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES, 0,
            OIIO_SIMD_MAX_SIZE_BYTES);
-    m_valid = file.read_tile(thread_info, m_id.subimage(), m_id.miplevel(),
-                             m_id.x(), m_id.y(), m_id.z(), m_id.chbegin(),
-                             m_id.chend(), file.datatype(m_id.subimage()),
-                             &m_pixels[0]);
+    // If the tile was recently evicted and kept in the compressed tier,
+    // expanding it is much cheaper than reading it from the file again.
+    // Failing that, a local disk copy is still cheaper than the source
+    // file, which may be across the network.
+    bool fromcompressed = ic.uncompress_tile(m_id, &m_pixels[0], rawsize,
+                                             thread_info);
+    bool fromdisk       = !fromcompressed && !converted
+                    && ic.read_disk_tile(m_id, &m_pixels[0], rawsize,
+                                         thread_info);
+    bool uncompressed = fromcompressed || fromdisk;
+    m_valid = uncompressed
+              || file.read_tile(thread_info, m_id.subimage(), m_id.miplevel(),
+                                m_id.x(), m_id.y(), m_id.z(), m_id.chbegin(),
+                                m_id.chend(), file.datatype(m_id.subimage()),
+                                &m_pixels[0]);
     m_id.file().imagecache().incr_mem(size);
-    if (m_valid) {
+    if (m_valid && !uncompressed && !converted && ic.tile_disk_cache().size())
+        ic.write_disk_tile(m_id, &m_pixels[0], rawsize, thread_info);
+    if (m_valid && shared && shared->insert(key, &m_pixels[0], rawsize)) {
+        ++thread_info->m_stats.shared_tile_stores;
+        // Use the shared copy from now on, and free our own, so that the
+        // machine holds just the one.
+        char* own   = m_pixels.release();
+        bool pooled = m_pooled;
+        if (use_shared(shared, key, size)) {
+            if (pooled)
+                ic.tile_pool_free(own, size);
+            else
+                delete[] own;
+        } else {
+            m_pixels.reset(own);
+        }
+    }
+    if (m_valid && uncompressed) {
+        // Not a read from the file, so not a redundant read either
+    } else if (m_valid) {
         // Figure out if
         ImageCacheFile::LevelInfo& lev(
             file.levelinfo(m_id.subimage(), m_id.miplevel()));
-        int whichtile = ((m_id.x() - lev.spec.x) / lev.spec.tile_width)
-                        + ((m_id.y() - lev.spec.y) / lev.spec.tile_height)
-                              * lev.nxtiles
-                        + ((m_id.z() - lev.spec.z) / lev.spec.tile_depth)
-                              * (lev.nxtiles * lev.nytiles);
+        int whichtile   = lev.tile_index(m_id.x(), m_id.y(), m_id.z());
         int index       = whichtile / 64;
         int64_t bitmask = int64_t(1ULL << (whichtile & 63));
         int64_t oldval  = lev.tiles_read[index].fetch_or(bitmask);
@@ -1531,18 +2711,129 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
                   << " from " << file.filename() << "\n";
 #endif
     }
-    m_pixels_ready = true;
+    mark_pixels_ready();
     // FIXME -- for shadow, fill in mindepth, maxdepth
 }
 
 
 
 void
-ImageCacheTile::wait_pixels_ready() const
+ImageCacheTile::read_from(const void* pels, stride_t ystride, stride_t zstride,
+                          bool ok)
+{
+    ImageCacheFile& file(m_id.file());
+    const ImageSpec& spec(file.spec(m_id.subimage(), m_id.miplevel()));
+    m_channelsize = file.datatype(id().subimage()).size();
+    m_pixelsize   = m_id.nchannels() * m_channelsize;
+    size_t size   = memsize_needed();
+    ASSERT(memsize() == 0 && size > OIIO_SIMD_MAX_SIZE_BYTES);
+    alloc_pixels(size);
+    memset(m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES, 0,
+           OIIO_SIMD_MAX_SIZE_BYTES);
+    if (ok) {
+        stride_t tileystride = stride_t(m_pixelsize) * spec.tile_width;
+        copy_image(m_id.nchannels(), spec.tile_width, spec.tile_height,
+                   spec.tile_depth, pels, m_pixelsize, m_pixelsize, ystride,
+                   zstride, &m_pixels[0], m_pixelsize, tileystride,
+                   tileystride * spec.tile_height);
+    }
+    file.imagecache().incr_mem(size);
+    m_valid = ok;
+    if (!ok)
+        m_used = false;  // Don't let it hold mem if invalid
+    mark_pixels_ready();
+}
+
+
+
+// Threads waiting for tile pixels that another thread is reading sleep
+// on one of these, picked by the tile's address. The waiter count lets
+// the reading thread skip the mutex and notify when nobody is waiting,
+// which is nearly always.
+namespace {
+struct TileWaitSlot {
+    std::mutex mutex;
+    std::condition_variable cv;
+    atomic_int waiters { 0 };
+};
+static const int ntile_wait_slots = 64;
+static TileWaitSlot tile_wait_slots[ntile_wait_slots];
+
+inline TileWaitSlot&
+tile_wait_slot(const ImageCacheTile* tile)
+{
+    return tile_wait_slots[(uintptr_t(tile) / sizeof(ImageCacheTile))
+                           % ntile_wait_slots];
+}
+}  // namespace
+
+
+
+void
+ImageCacheTile::check_empty()
+{
+    ImageCacheFile& file(m_id.file());
+    const ImageCacheFile::SubimageInfo& si(file.subimageinfo(m_id.subimage()));
+    if (si.background.empty())
+        return;
+    const char* bg = si.background.data() + m_id.chbegin() * m_channelsize;
+    const char* p  = m_pixels.get();
+    const ImageSpec& spec(file.spec(m_id.subimage(), m_id.miplevel()));
+    for (imagesize_t i = 0, n = spec.tile_pixels(); i < n;
+         ++i, p += m_pixelsize)
+        if (memcmp(p, bg, m_pixelsize))
+            return;
+    file.levelinfo(m_id.subimage(), m_id.miplevel())
+        .mark_empty(m_id.x(), m_id.y(), m_id.z());
+    // Lookups won't come back for it, so let it be the first to go.
+    m_used = false;
+}
+
+
+
+void
+ImageCacheTile::mark_pixels_ready()
 {
+    if (m_valid)
+        check_empty();
+    m_pixels_ready = true;
+    TileWaitSlot& slot(tile_wait_slot(this));
+    if (slot.waiters) {
+        // Taking the mutex ensures that any waiter that saw the pixels
+        // as not ready is already waiting on the cv, so it gets the news.
+        { std::lock_guard<std::mutex> lock(slot.mutex); }
+        slot.cv.notify_all();
+    }
+}
+
+
+
+void
+ImageCacheTile::wait_pixels_ready(ImageCachePerThreadInfo* thread_info) const
+{
+    if (m_pixels_ready)
+        return;
+    OIIO_TRACE_SPAN("ImageCache::wait_tile", "ImageCache");
+    Timer timer;
+    // Another thread should be done soon if the tile was in the OS file
+    // cache, so spin a bit before resorting to sleeping.
     atomic_backoff backoff;
-    while (!m_pixels_ready) {
+    for (int i = 0; i < 8 && !m_pixels_ready; ++i)
         backoff();
+    if (!m_pixels_ready) {
+        TileWaitSlot& slot(tile_wait_slot(this));
+        std::unique_lock<std::mutex> lock(slot.mutex);
+        ++slot.waiters;
+        while (!m_pixels_ready)
+            slot.cv.wait(lock);
+        --slot.waiters;
+    }
+    if (thread_info) {
+        ImageCacheStatistics& stats(thread_info->m_stats);
+        double wait = timer();
+        stats.tile_wait_time += wait;
+        ++stats.tile_coalesced_misses;
+        ++stats.wait_time_hist[ImageCacheStatistics::time_hist_bucket(wait)];
     }
 }
 
@@ -1596,18 +2887,48 @@ ImageCacheImpl::init()
 {
     set_max_open_files(100);
     m_max_memory_bytes     = 256 * 1024 * 1024;  // 256 MB default cache size
+    m_searchpath_ttl       = 0.0f;
     m_autotile             = 0;
     m_autoscanline         = false;
+    m_autotile_parallel    = false;
     m_automip              = false;
+    m_automip_sidecar      = false;
     m_forcefloat           = false;
     m_accept_untiled       = true;
     m_accept_unmipped      = true;
     m_deduplicate          = true;
     m_unassociatedalpha    = false;
+    m_metadata             = ustring("lazy");
     m_failure_retries      = 0;
+    m_max_inputs_per_file  = 1;
+    m_microcache_size      = 2;
+    m_shared_tile_memory_MB = 1024;
+    m_tile_disk_cache_MB    = 10240;
+    // Far over any limit, so that the first tile written checks the size
+    // of whatever an earlier process left in the directory.
+    m_disk_tile_bytes_written = std::numeric_limits<long long>::max() / 2;
+    m_mmap_tiles            = false;
+    m_numa                  = false;
+    m_numa_nodes            = 1;
+    m_numa_replicate_hits   = 64;
+    m_use_tile_pool         = true;
+    m_recording_manifest    = false;
     m_latlong_y_up_default = true;
+    m_prefetch_threads     = 0;
+    m_get_pixels_threads   = 1;
+    m_autoprefetch         = false;
+    m_prefetch_pending     = 0;
+    m_automip_pending      = 0;
+    m_tile_eviction        = EvictClock;
+    m_tile_sweep_bin       = 0;
+    m_max_compressed_bytes = 0;
+    m_ctiles_seq           = 0;
+    m_ctiles_mem           = 0;
     m_Mw2c.makeIdentity();
     m_mem_used                = 0;
+    m_pinned_mem              = 0;
+    m_auto_pinned_mem         = 0;
+    m_pin_mip_tail            = 0;
     m_statslevel              = 0;
     m_max_errors_per_file     = 100;
     m_stat_tiles_created      = 0;
@@ -1627,7 +2948,18 @@ ImageCacheImpl::init()
 
 ImageCacheImpl::~ImageCacheImpl()
 {
+    // Let any in-flight prefetch reads finish before tearing down the
+    // caches and the per-thread data they use.
+    m_prefetch_pool.reset();
+    // Same for automip builds, which run in the default pool.
+    while (m_automip_pending > 0)
+        yield();
+    write_manifest();
     printstats();
+    // Pinned tiles must go while the cache they account to still exists.
+    for (FilenameMap::iterator fileit = m_files.begin(), e = m_files.end();
+         fileit != e; ++fileit)
+        fileit->second->unpin_tiles();
     erase_perthread_info();
 }
 
@@ -1644,6 +2976,30 @@ ImageCacheImpl::mergestats(ImageCacheStatistics& stats) const
 
 
 
+void
+ImageCacheImpl::merge_cost_tags(TextureCostTags& merged) const
+{
+    merged.clear();
+    spin_lock lock(m_perthread_info_mutex);
+    for (const ImageCachePerThreadInfo* p : m_all_perthread_info) {
+        if (!p)
+            continue;
+        spin_lock tags_lock(p->cost_tags_mutex);
+        for (const auto& tag : p->cost_tags) {
+            auto m = std::find_if(merged.begin(), merged.end(),
+                                  [&](const TextureCostTags::value_type& v) {
+                                      return v.first == tag.first;
+                                  });
+            if (m == merged.end())
+                merged.push_back(tag);
+            else
+                m->second.merge(tag.second);
+        }
+    }
+}
+
+
+
 std::string
 ImageCacheImpl::onefile_stat_line(const ImageCacheFileRef& file, int i,
                                   bool includestats) const
@@ -1802,16 +3158,38 @@ ImageCacheImpl::getstats(int level) const
     opt += Strutil::sprintf(#name "=\"%s\" ", m_##name)
         opt += Strutil::sprintf("max_memory_MB=%0.1f ",
                                 m_max_memory_bytes / (1024.0 * 1024.0));
+        if (m_max_compressed_bytes)
+            opt += Strutil::sprintf("max_compressed_memory_MB=%0.1f ",
+                                    m_max_compressed_bytes
+                                        / (1024.0 * 1024.0));
         INTOPT(max_open_files);
         INTOPT(autotile);
         INTOPT(autoscanline);
+        INTOPT(autotile_parallel);
         INTOPT(automip);
+        INTOPT(automip_sidecar);
         INTOPT(forcefloat);
         INTOPT(accept_untiled);
         INTOPT(accept_unmipped);
         INTOPT(deduplicate);
         INTOPT(unassociatedalpha);
         INTOPT(failure_retries);
+        INTOPT(max_inputs_per_file);
+        INTOPT(microcache_size);
+        INTOPT(prefetch_threads);
+        INTOPT(get_pixels_threads);
+        INTOPT(autoprefetch);
+        INTOPT(pin_mip_tail);
+        BOOLOPT(mmap_tiles);
+        BOOLOPT(numa);
+        if (!m_use_tile_pool)
+            opt += "tile_pool=0 ";
+        if (m_numa)
+            INTOPT(numa_replicate_hits);
+        if (m_tile_eviction == EvictSegmented)
+            opt += "tile_eviction=\"segmented\" ";
+        if (m_metadata != "lazy")
+            opt += Strutil::sprintf("metadata=\"%s\" ", m_metadata);
 #undef BOOLOPT
 #undef INTOPT
 #undef STROPT
@@ -1851,6 +3229,10 @@ ImageCacheImpl::getstats(int level) const
             out << "    File open time only : "
                 << Strutil::timeintervalformat(stats.fileopen_time) << "\n";
         }
+        if (stats.file_reopens)
+            out << "    Files reopened : " << stats.file_reopens
+                << " times, taking "
+                << Strutil::timeintervalformat(stats.file_reopen_time) << "\n";
         if (stats.file_locking_time > 0.001)
             out << "    File mutex locking time : "
                 << Strutil::timeintervalformat(stats.file_locking_time) << "\n";
@@ -1869,6 +3251,32 @@ ImageCacheImpl::getstats(int level) const
                 << 100.0 * (double)stats.find_tile_microcache_misses
                        / (double)stats.find_tile_calls
                 << "%)\n";
+            if (level >= 2) {
+                // Spread of the per-thread micro-cache hit rates
+                double minrate = 1.0, maxrate = 0.0;
+                int nthreads = 0;
+                spin_lock lock(m_perthread_info_mutex);
+                for (auto p : m_all_perthread_info) {
+                    if (!p || !p->m_stats.find_tile_calls)
+                        continue;
+                    double rate
+                        = 1.0
+                          - (double)p->m_stats.find_tile_microcache_misses
+                                / (double)p->m_stats.find_tile_calls;
+                    minrate = std::min(minrate, rate);
+                    maxrate = std::max(maxrate, rate);
+                    ++nthreads;
+                }
+                if (nthreads > 1)
+                    out << "    micro-cache hit rate per thread : "
+                        << Strutil::sprintf("%.1f%% - %.1f%%, over %d threads",
+                                            100.0 * minrate, 100.0 * maxrate,
+                                            nthreads)
+                        << "\n";
+            }
+            if (stats.find_tile_pinned_hits)
+                out << "    pinned one-tile level hits : "
+                    << stats.find_tile_pinned_hits << "\n";
             out << "    main cache misses : " << stats.find_tile_cache_misses
                 << " ("
                 << 100.0 * (double)stats.find_tile_cache_misses
@@ -1877,12 +3285,81 @@ ImageCacheImpl::getstats(int level) const
             out << "    redundant reads: "
                 << (unsigned long long)total_redundant_tiles << " tiles, "
                 << Strutil::memformat(total_redundant_bytes) << "\n";
+            if (stats.prefetch_requests)
+                out << "    prefetch : " << stats.prefetch_requests
+                    << " tiles queued, " << stats.prefetch_tiles
+                    << " read in the background\n";
+            if (stats.compressed_tiles_stored)
+                out << "    compressed tier : "
+                    << stats.compressed_tiles_stored << " tiles stored, "
+                    << stats.compressed_tile_hits << " hits, "
+                    << Strutil::memformat(m_ctiles_mem) << " current\n";
+            if (stats.disk_cache_hits || stats.disk_cache_writes)
+                out << "    disk cache : " << stats.disk_cache_hits
+                    << " tiles read, " << stats.disk_cache_writes
+                    << " tiles written\n";
+            if (stats.shared_tile_hits || stats.shared_tile_stores)
+                out << "    shared tile memory : " << stats.shared_tile_hits
+                    << " tiles found, " << stats.shared_tile_stores
+                    << " tiles stored\n";
+            if (stats.mapped_tiles)
+                out << "    memory-mapped : " << stats.mapped_tiles
+                    << " tiles used in place\n";
+            if (stats.untiled_band_reuses)
+                out << "    untiled bands reused : "
+                    << stats.untiled_band_reuses << "\n";
+            if (stats.automip_builds)
+                out << "    automip : " << stats.automip_builds
+                    << " subimages' levels built, " << stats.automip_tiles
+                    << " tiles copied from them\n";
+            if (m_numa_nodes > 1) {
+                for (int n = 0; n < m_numa_nodes; ++n)
+                    out << "    NUMA node " << n << " hits : "
+                        << stats.numa_local_hits[n] << " local, "
+                        << stats.numa_remote_hits[n] << " remote, "
+                        << stats.numa_replica_hits[n] << " replica\n";
+                out << "    NUMA replicas made : " << stats.numa_replicas
+                    << "\n";
+            }
         }
         out << "    Peak cache memory : " << Strutil::memformat(m_mem_used)
             << "\n";
+        if (m_pinned_mem)
+            out << "    Pinned tile memory : "
+                << Strutil::memformat(m_pinned_mem) << "\n";
+        if (m_tile_pool.memory())
+            out << "    Tile pool memory : "
+                << Strutil::memformat(m_tile_pool.memory()) << " ("
+                << Strutil::memformat(m_tile_pool.free_memory())
+                << " free)\n";
         if (stats.tile_locking_time > 0.001)
             out << "    Tile mutex locking time : "
                 << Strutil::timeintervalformat(stats.tile_locking_time) << "\n";
+        if (stats.tile_coalesced_misses)
+            out << "    Waited for other threads' tile reads : "
+                << stats.tile_coalesced_misses << " times, "
+                << Strutil::timeintervalformat(stats.tile_wait_time) << "\n";
+        if (level >= 2) {
+            long long nreads = 0;
+            for (auto n : stats.read_time_hist)
+                nreads += n;
+            if (nreads) {
+                out << "    Tile read times :\n";
+                for (int b = 0; b < ImageCacheStatistics::time_hist_buckets;
+                     ++b) {
+                    if (!stats.read_time_hist[b])
+                        continue;
+                    std::string limit
+                        = (b == ImageCacheStatistics::time_hist_buckets - 1)
+                              ? std::string("longer")
+                              : ("< " + time_hist_limit(b));
+                    out << Strutil::sprintf(
+                        "      %10s : %lld (%.1f%%)\n", limit,
+                        stats.read_time_hist[b],
+                        100.0 * stats.read_time_hist[b] / nreads);
+                }
+            }
+        }
         if (stats.find_tile_time > 0.001)
             out << "    Find tile time : "
                 << Strutil::timeintervalformat(stats.find_tile_time) << "\n";
@@ -2011,6 +3488,32 @@ ImageCacheImpl::getstats(int level) const
                 }
             }
         }
+        // Single reads that took seconds point at pathological files
+        // (untiled, unmipped, or on a struggling server), which may dominate
+        // the I/O time even when there are few of them.
+        const double slowread = 0.1;
+        std::vector<ImageCacheFileRef> slowest(files);
+        std::sort(slowest.begin(), slowest.end(), maxreadtime_compare);
+        if (slowest.size() && slowest[0]->max_read_time() >= slowread) {
+            const int topN = 5;
+            // Count the reads in the buckets entirely above slowread
+            int slowbucket = ImageCacheStatistics::time_hist_bucket(slowread);
+            out << "  Files with the slowest single reads:\n";
+            int nprinted = 0;
+            for (const ImageCacheFileRef& file : slowest) {
+                if (file->max_read_time() < slowread || nprinted++ >= topN)
+                    break;
+                long long slow = 0;
+                for (int b = slowbucket + 1;
+                     b < ImageCacheStatistics::time_hist_buckets; ++b)
+                    slow += file->read_time_hist(b);
+                out << Strutil::sprintf(
+                    "    %d   %9s max, %lld over %s   ", nprinted,
+                    Strutil::timeintervalformat(file->max_read_time()), slow,
+                    time_hist_limit(slowbucket));
+                out << onefile_stat_line(file, -1, false) << "\n";
+            }
+        }
         int nbroken = 0;
         for (const ImageCacheFileRef& file : files) {
             if (file->broken())
@@ -2035,6 +3538,185 @@ ImageCacheImpl::getstats(int level) const
 
 
 
+MetricsWriter::MetricsWriter(string_view format, string_view prefix)
+    : m_format(format == "json"
+                   ? JSON
+                   : (format == "prometheus" ? Prometheus : Unknown))
+    , m_prefix(prefix)
+{
+}
+
+
+
+void
+MetricsWriter::add(string_view name, Kind kind, double value,
+                   string_view label, string_view labelvalue)
+{
+    m_metrics.push_back({ name, label, labelvalue,
+                          kind == Counter ? "counter" : "gauge", value });
+}
+
+
+
+void
+MetricsWriter::add_time_histogram(string_view name, const long long* counts,
+                                  double sum)
+{
+    // Prometheus histogram buckets are cumulative
+    std::string bucket = Strutil::sprintf("%s_bucket", name);
+    long long total    = 0;
+    for (int b = 0; b < ImageCacheStatistics::time_hist_buckets; ++b) {
+        total += counts[b];
+        std::string le = (b < ImageCacheStatistics::time_hist_buckets - 1)
+                             ? Strutil::sprintf("%d", 1 << b)
+                             : std::string("+Inf");
+        m_metrics.push_back({ bucket, "le", le, "histogram", double(total) });
+    }
+    m_metrics.push_back({ Strutil::sprintf("%s_sum", name), "", "",
+                          "histogram", sum * 1.0e6 });
+    m_metrics.push_back({ Strutil::sprintf("%s_count", name), "", "",
+                          "histogram", double(total) });
+}
+
+
+
+// Escape a string for use inside double quotes, in either JSON or a
+// Prometheus label value.
+static std::string
+metrics_quote(string_view s)
+{
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            (r += '\\') += c;
+        else if (c == '\n')
+            r += "\\n";
+        else if ((unsigned char)c < 0x20)
+            r += Strutil::sprintf("\\u%04x", int(c));
+        else
+            r += c;
+    }
+    return r;
+}
+
+
+
+std::string
+MetricsWriter::str() const
+{
+    std::ostringstream out;
+    out.imbue(std::locale::classic());  // Force "C" locale with '.' decimal
+    out.precision(15);
+    if (m_format == Prometheus) {
+        std::string lasttype;
+        for (auto& m : m_metrics) {
+            // A histogram's TYPE line names it without the _bucket etc.
+            std::string family = m.name;
+            if (!strcmp(m.type, "histogram"))
+                family = family.substr(0, family.rfind('_'));
+            if (family != lasttype) {
+                out << "# TYPE " << m_prefix << family << ' ' << m.type
+                    << '\n';
+                lasttype = family;
+            }
+            out << m_prefix << m.name;
+            if (m.label.size())
+                out << '{' << m.label << "=\"" << metrics_quote(m.labelvalue)
+                    << "\"}";
+            out << ' ' << m.value << '\n';
+        }
+    } else if (m_format == JSON) {
+        out << "{";
+        for (size_t i = 0; i < m_metrics.size(); ++i) {
+            const Metric& m(m_metrics[i]);
+            out << (i ? ",\n  \"" : "\n  \"") << metrics_quote(m.name)
+                << "\": ";
+            if (m.label.empty()) {
+                out << m.value;
+                continue;
+            }
+            // Gather the run of entries of this name into one object
+            out << "{";
+            for (size_t j = i; j < m_metrics.size()
+                               && m_metrics[j].name == m.name;
+                 i = j++)
+                out << (j > i ? ", \"" : "\"")
+                    << metrics_quote(m_metrics[j].labelvalue)
+                    << "\": " << m_metrics[j].value;
+            out << "}";
+        }
+        out << "\n}\n";
+    }
+    return out.str();
+}
+
+
+
+std::string
+ImageCacheImpl::getmetrics(string_view format) const
+{
+    MetricsWriter metrics(format, "oiio_imagecache_");
+    if (!metrics.ok()) {
+        errorf("Unknown metrics format \"%s\"", format);
+        return std::string();
+    }
+    // Merge all the threads
+    ImageCacheStatistics stats;
+    mergestats(stats);
+
+    const MetricsWriter::Kind Counter = MetricsWriter::Counter;
+    const MetricsWriter::Kind Gauge   = MetricsWriter::Gauge;
+    metrics.add("uptime_seconds", Gauge, m_lifetime());
+    metrics.add("memory_used_bytes", Gauge, double(m_mem_used));
+    metrics.add("pinned_memory_bytes", Gauge, double(m_pinned_mem));
+    metrics.add("max_memory_bytes", Gauge, double(m_max_memory_bytes));
+    metrics.add("tiles_created", Counter, m_stat_tiles_created);
+    metrics.add("tiles_current", Gauge, m_stat_tiles_current);
+    metrics.add("tiles_peak", Gauge, m_stat_tiles_peak);
+    metrics.add("tiles_evicted", Counter, double(stats.tiles_evicted));
+    metrics.add("find_tile_calls", Counter, double(stats.find_tile_calls));
+    metrics.add("find_tile_microcache_misses", Counter,
+                double(stats.find_tile_microcache_misses));
+    metrics.add("find_tile_pinned_hits", Counter,
+                double(stats.find_tile_pinned_hits));
+    metrics.add("find_tile_cache_misses", Counter,
+                stats.find_tile_cache_misses);
+    for (int b = 0; b < TILE_CACHE_SHARDS; ++b)
+        metrics.add("shard_hits", Counter, double(stats.shard_hits[b]),
+                    "shard", Strutil::sprintf("%d", b));
+    for (int b = 0; b < TILE_CACHE_SHARDS; ++b)
+        metrics.add("shard_misses", Counter, double(stats.shard_misses[b]),
+                    "shard", Strutil::sprintf("%d", b));
+    metrics.add_time_histogram("tile_read_us", stats.read_time_hist,
+                               stats.fileio_time);
+    metrics.add_time_histogram("tile_wait_us", stats.wait_time_hist,
+                               stats.tile_wait_time);
+    metrics.add("unique_files", Gauge, stats.unique_files);
+    metrics.add("open_files_created", Counter, m_stat_open_files_created);
+    metrics.add("open_files_closed", Counter,
+                m_stat_open_files_created - m_stat_open_files_current);
+    metrics.add("open_files_current", Gauge, m_stat_open_files_current);
+    metrics.add("open_files_peak", Gauge, m_stat_open_files_peak);
+    metrics.add("bytes_read", Counter, double(stats.bytes_read));
+    metrics.add("file_reopens", Counter, double(stats.file_reopens));
+    metrics.add("file_reopen_seconds", Counter, stats.file_reopen_time);
+    for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f) {
+        const ImageCacheFileRef& file(f->second);
+        if (file->bytesread())
+            metrics.add("file_bytes_read", Counter, double(file->bytesread()),
+                        "file", file->filename());
+    }
+    for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f) {
+        const ImageCacheFileRef& file(f->second);
+        if (file->bytesread())
+            metrics.add("file_max_read_seconds", Gauge, file->max_read_time(),
+                        "file", file->filename());
+    }
+    return metrics.str();
+}
+
+
+
 void
 ImageCacheImpl::printstats() const
 {
@@ -2050,8 +3732,15 @@ ImageCacheImpl::reset_stats()
 {
     {
         spin_lock lock(m_perthread_info_mutex);
-        for (size_t i = 0; i < m_all_perthread_info.size(); ++i)
-            m_all_perthread_info[i]->m_stats.init();
+        for (size_t i = 0; i < m_all_perthread_info.size(); ++i) {
+            ImageCachePerThreadInfo* p = m_all_perthread_info[i];
+            if (!p)
+                continue;
+            p->m_stats.init();
+            spin_lock tags_lock(p->cost_tags_mutex);
+            for (auto& tag : p->cost_tags)
+                tag.second = TextureCostStats();
+        }
     }
 
     {
@@ -2062,6 +3751,9 @@ ImageCacheImpl::reset_stats()
             file->m_tilesread   = 0;
             file->m_bytesread   = 0;
             file->m_iotime      = 0;
+            for (auto& h : file->m_read_time_hist)
+                h = 0;
+            file->m_max_read_time_us = 0;
         }
     }
 }
@@ -2104,6 +3796,11 @@ ImageCacheImpl::attribute(string_view name, TypeDesc type, const void* val)
             do_invalidate    = true;  // in case file can be found with new path
             force_invalidate = true;
         }
+    } else if (name == "searchpath_ttl"
+               && (type == TypeDesc::FLOAT || type == TypeDesc::INT)) {
+        float ttl = (type == TypeDesc::FLOAT) ? *(const float*)val
+                                              : float(*(const int*)val);
+        m_searchpath_ttl = std::max(ttl, 0.0f);
     } else if (name == "plugin_searchpath" && type == TypeDesc::STRING) {
         m_plugin_searchpath = std::string(*(const char**)val);
     } else if (name == "statistics:level" && type == TypeDesc::INT) {
@@ -2129,12 +3826,20 @@ ImageCacheImpl::attribute(string_view name, TypeDesc type, const void* val)
             m_autoscanline = a;
             do_invalidate  = true;
         }
+    } else if (name == "autotile_parallel" && type == TypeDesc::INT) {
+        m_autotile_parallel = (*(const int*)val != 0);
     } else if (name == "automip" && type == TypeDesc::INT) {
         bool a = (*(const int*)val != 0);
         if (a != m_automip) {
             m_automip     = a;
             do_invalidate = true;
         }
+    } else if (name == "automip_sidecar" && type == TypeDesc::INT) {
+        bool a = (*(const int*)val != 0);
+        if (a != m_automip_sidecar) {
+            m_automip_sidecar = a;
+            do_invalidate     = true;
+        }
     } else if (name == "forcefloat" && type == TypeDesc::INT) {
         bool a = (*(const int*)val != 0);
         if (a != m_forcefloat) {
@@ -2167,6 +3872,85 @@ ImageCacheImpl::attribute(string_view name, TypeDesc type, const void* val)
         }
     } else if (name == "failure_retries" && type == TypeDesc::INT) {
         m_failure_retries = *(const int*)val;
+    } else if (name == "max_compressed_memory_MB"
+               && (type == TypeDesc::FLOAT || type == TypeDesc::INT)) {
+        float size = (type == TypeDesc::FLOAT) ? *(const float*)val
+                                               : float(*(const int*)val);
+        m_max_compressed_bytes = (long long)(std::max(size, 0.0f) * 1024
+                                             * 1024);
+        if (!m_max_compressed_bytes)
+            clear_compressed_tiles(nullptr);
+    } else if (name == "shared_tile_memory" && type == TypeDesc::STRING) {
+        std::string s = std::string(*(const char**)val);
+        if (s != m_shared_tile_memory) {
+            m_shared_tile_memory = s;
+            open_shared_tiles();
+        }
+    } else if (name == "shared_tile_memory_MB" && type == TypeDesc::INT) {
+        m_shared_tile_memory_MB = std::max(1, *(const int*)val);
+    } else if (name == "mmap_tiles" && type == TypeDesc::INT) {
+        m_mmap_tiles = *(const int*)val;
+    } else if (name == "tile_pool" && type == TypeDesc::INT) {
+        m_use_tile_pool = *(const int*)val;
+    } else if (name == "tile_pool_hugepages" && type == TypeDesc::INT) {
+        m_tile_pool.hugepages(*(const int*)val);
+    } else if (name == "numa" && type == TypeDesc::INT) {
+        m_numa       = *(const int*)val;
+        m_numa_nodes = m_numa ? numa_node_count() : 1;
+    } else if (name == "numa_replicate_hits" && type == TypeDesc::INT) {
+        m_numa_replicate_hits = std::max(1, *(const int*)val);
+    } else if (name == "tile_disk_cache" && type == TypeDesc::STRING) {
+        m_tile_disk_cache = std::string(*(const char**)val);
+        m_disk_tile_bytes_written = std::numeric_limits<long long>::max() / 2;
+    } else if (name == "tile_disk_cache_MB" && type == TypeDesc::INT) {
+        m_tile_disk_cache_MB = std::max(0, *(const int*)val);
+    } else if (name == "record_manifest" && type == TypeDesc::STRING) {
+        std::string path(*(const char**)val);
+        if (path != m_manifest_path) {
+            write_manifest();  // Finish any previous recording
+            std::lock_guard<std::mutex> lock(m_manifest_mutex);
+            m_manifest_path = path;
+            m_manifest_timer.reset();
+            m_manifest_timer.start();
+            m_recording_manifest = !path.empty();
+        }
+    } else if (name == "microcache_size" && type == TypeDesc::INT) {
+        int size = clamp(*(const int*)val, 1,
+                         ImageCachePerThreadInfo::max_microcache);
+        if (size != m_microcache_size) {
+            m_microcache_size = size;
+            purge_perthread_microcaches();
+        }
+    } else if (name == "max_inputs_per_file" && type == TypeDesc::INT) {
+        m_max_inputs_per_file = std::max(1, *(const int*)val);
+    } else if (name == "prefetch_threads" && type == TypeDesc::INT) {
+        set_prefetch_threads(*(const int*)val);
+    } else if (name == "get_pixels_threads" && type == TypeDesc::INT) {
+        m_get_pixels_threads = std::max(0, *(const int*)val);
+    } else if (name == "autoprefetch" && type == TypeDesc::INT) {
+        m_autoprefetch = (*(const int*)val != 0);
+    } else if (name == "pin_mip_tail" && type == TypeDesc::INT) {
+        m_pin_mip_tail = std::max(0, *(const int*)val);
+    } else if (name == "metadata" && type == TypeDesc::STRING) {
+        ustring m(*(const char**)val);
+        if (m != "full" && m != "lazy" && m != "none") {
+            errorf("Unknown metadata mode \"%s\"", m);
+            return false;
+        }
+        if (m != m_metadata) {
+            m_metadata    = m;
+            do_invalidate = true;
+        }
+    } else if (name == "tile_eviction" && type == TypeDesc::STRING) {
+        string_view policy(*(const char**)val);
+        if (policy == "clock")
+            m_tile_eviction = EvictClock;
+        else if (policy == "segmented")
+            m_tile_eviction = EvictSegmented;
+        else {
+            errorf("Unknown tile_eviction policy \"%s\"", policy);
+            return false;
+        }
     } else if (name == "latlong_up" && type == TypeDesc::STRING) {
         bool y_up = !strcmp("y", *(const char**)val);
         if (y_up != m_latlong_y_up_default) {
@@ -2204,13 +3988,34 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
     ATTR_DECODE("max_errors_per_file", int, m_max_errors_per_file);
     ATTR_DECODE("autotile", int, m_autotile);
     ATTR_DECODE("autoscanline", int, m_autoscanline);
+    ATTR_DECODE("autotile_parallel", int, m_autotile_parallel);
     ATTR_DECODE("automip", int, m_automip);
+    ATTR_DECODE("automip_sidecar", int, m_automip_sidecar);
     ATTR_DECODE("forcefloat", int, m_forcefloat);
     ATTR_DECODE("accept_untiled", int, m_accept_untiled);
     ATTR_DECODE("accept_unmipped", int, m_accept_unmipped);
     ATTR_DECODE("deduplicate", int, m_deduplicate);
     ATTR_DECODE("unassociatedalpha", int, m_unassociatedalpha);
     ATTR_DECODE("failure_retries", int, m_failure_retries);
+    ATTR_DECODE("searchpath_ttl", float, m_searchpath_ttl);
+    ATTR_DECODE("max_compressed_memory_MB", float,
+                m_max_compressed_bytes / (1024.0 * 1024.0));
+    ATTR_DECODE("max_compressed_memory_MB", int,
+                m_max_compressed_bytes / (1024 * 1024));
+    ATTR_DECODE("max_inputs_per_file", int, m_max_inputs_per_file);
+    ATTR_DECODE("microcache_size", int, m_microcache_size);
+    ATTR_DECODE("shared_tile_memory_MB", int, m_shared_tile_memory_MB);
+    ATTR_DECODE("tile_disk_cache_MB", int, m_tile_disk_cache_MB);
+    ATTR_DECODE("mmap_tiles", int, m_mmap_tiles);
+    ATTR_DECODE("tile_pool", int, m_use_tile_pool);
+    ATTR_DECODE("tile_pool_hugepages", int, m_tile_pool.hugepages());
+    ATTR_DECODE("numa", int, m_numa);
+    ATTR_DECODE("numa_nodes", int, m_numa_nodes);
+    ATTR_DECODE("numa_replicate_hits", int, m_numa_replicate_hits);
+    ATTR_DECODE("prefetch_threads", int, m_prefetch_threads);
+    ATTR_DECODE("get_pixels_threads", int, m_get_pixels_threads);
+    ATTR_DECODE("autoprefetch", int, m_autoprefetch);
+    ATTR_DECODE("pin_mip_tail", int, m_pin_mip_tail);
     ATTR_DECODE("total_files", int, m_files.size());
 
     // The cases that don't fit in the simple ATTR_DECODE scheme
@@ -2222,6 +4027,19 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         *(ustring*)val = m_plugin_searchpath;
         return true;
     }
+    if (name == "tile_disk_cache" && type == TypeDesc::STRING) {
+        *(ustring*)val = m_tile_disk_cache;
+        return true;
+    }
+    if (name == "record_manifest" && type == TypeDesc::STRING) {
+        std::lock_guard<std::mutex> lock(m_manifest_mutex);
+        *(ustring*)val = m_manifest_path;
+        return true;
+    }
+    if (name == "shared_tile_memory" && type == TypeDesc::STRING) {
+        *(ustring*)val = m_shared_tile_memory;
+        return true;
+    }
     if (name == "worldtocommon"
         && (type == TypeMatrix || type == TypeDesc(TypeDesc::FLOAT, 16))) {
         *(Imath::M44f*)val = m_Mw2c;
@@ -2240,6 +4058,17 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         *(const char**)val = m_substitute_image.c_str();
         return true;
     }
+    if (name == "metadata" && type == TypeDesc::STRING) {
+        *(const char**)val = m_metadata.c_str();
+        return true;
+    }
+    if (name == "tile_eviction" && type == TypeDesc::STRING) {
+        *(const char**)val
+            = ustring(m_tile_eviction == EvictSegmented ? "segmented"
+                                                        : "clock")
+                  .c_str();
+        return true;
+    }
     if (name == "all_filenames" && type.basetype == TypeDesc::STRING
         && type.is_sized_array()) {
         ustring* names = (ustring*)val;
@@ -2254,6 +4083,11 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
     if (Strutil::starts_with(name, "stat:")) {
         // Stats we can just grab
         ATTR_DECODE("stat:cache_memory_used", long long, m_mem_used);
+        ATTR_DECODE("stat:pinned_memory_used", long long, m_pinned_mem);
+        ATTR_DECODE("stat:compressed_memory_used", long long, m_ctiles_mem);
+        ATTR_DECODE("stat:tile_pool_memory", long long, m_tile_pool.memory());
+        ATTR_DECODE("stat:tile_pool_free", long long,
+                    m_tile_pool.free_memory());
         ATTR_DECODE("stat:tiles_created", int, m_stat_tiles_created);
         ATTR_DECODE("stat:tiles_current", int, m_stat_tiles_current);
         ATTR_DECODE("stat:tiles_peak", int, m_stat_tiles_peak);
@@ -2275,11 +4109,45 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         ATTR_DECODE("stat:image_size", long long, stats.files_totalsize);
         ATTR_DECODE("stat:file_size", long long, stats.files_totalsize_ondisk);
         ATTR_DECODE("stat:bytes_read", long long, stats.bytes_read);
+        ATTR_DECODE("stat:prefetch_requests", long long,
+                    stats.prefetch_requests);
+        ATTR_DECODE("stat:prefetch_tiles", long long, stats.prefetch_tiles);
+        ATTR_DECODE("stat:compressed_tiles_stored", long long,
+                    stats.compressed_tiles_stored);
+        ATTR_DECODE("stat:compressed_tile_hits", long long,
+                    stats.compressed_tile_hits);
+        ATTR_DECODE("stat:disk_cache_hits", long long, stats.disk_cache_hits);
+        ATTR_DECODE("stat:disk_cache_writes", long long,
+                    stats.disk_cache_writes);
+        ATTR_DECODE("stat:shared_tile_hits", long long,
+                    stats.shared_tile_hits);
+        ATTR_DECODE("stat:shared_tile_stores", long long,
+                    stats.shared_tile_stores);
+        ATTR_DECODE("stat:mapped_tiles", long long, stats.mapped_tiles);
+        ATTR_DECODE("stat:untiled_band_reuses", long long,
+                    stats.untiled_band_reuses);
+        ATTR_DECODE("stat:automip_builds", long long, stats.automip_builds);
+        ATTR_DECODE("stat:automip_tiles", long long, stats.automip_tiles);
+        long long numa_local = 0, numa_remote = 0, numa_replica = 0;
+        for (int n = 0; n < MAX_NUMA_NODES; ++n) {
+            numa_local += stats.numa_local_hits[n];
+            numa_remote += stats.numa_remote_hits[n];
+            numa_replica += stats.numa_replica_hits[n];
+        }
+        ATTR_DECODE("stat:numa_local_hits", long long, numa_local);
+        ATTR_DECODE("stat:numa_remote_hits", long long, numa_remote);
+        ATTR_DECODE("stat:numa_replica_hits", long long, numa_replica);
+        ATTR_DECODE("stat:numa_replicas", long long, stats.numa_replicas);
         ATTR_DECODE("stat:unique_files", int, stats.unique_files);
         ATTR_DECODE("stat:fileio_time", float, stats.fileio_time);
         ATTR_DECODE("stat:fileopen_time", float, stats.fileopen_time);
+        ATTR_DECODE("stat:file_reopens", long long, stats.file_reopens);
+        ATTR_DECODE("stat:file_reopen_time", float, stats.file_reopen_time);
         ATTR_DECODE("stat:file_locking_time", float, stats.file_locking_time);
         ATTR_DECODE("stat:tile_locking_time", float, stats.tile_locking_time);
+        ATTR_DECODE("stat:tile_wait_time", float, stats.tile_wait_time);
+        ATTR_DECODE("stat:tile_coalesced_misses", long long,
+                    stats.tile_coalesced_misses);
         ATTR_DECODE("stat:find_file_time", float, stats.find_file_time);
         ATTR_DECODE("stat:find_tile_time", float, stats.find_tile_time);
     }
@@ -2298,34 +4166,42 @@ ImageCacheImpl::find_tile_main_cache(const TileID& id, ImageCacheTileRef& tile,
     ImageCacheStatistics& stats(thread_info->m_stats);
 
     ++stats.find_tile_microcache_misses;
+    if (m_numa_nodes > 1)
+        thread_info->numa_node = current_numa_node();
+    size_t bin = m_tilecache.whichbin(id);
 
     {
 #if IMAGECACHE_TIME_STATS
         Timer timer1;
 #endif
-        TileCache::iterator found = m_tilecache.find(id);
+        // This lookup doesn't lock the bin (see unordered_map_concurrent).
+        bool found = m_tilecache.retrieve(id, tile);
 #if IMAGECACHE_TIME_STATS
         stats.find_tile_time += timer1();
 #endif
         if (found) {
-            tile = (*found).second;
-            found.unlock();  // release the lock
+            ++stats.shard_hits[bin];
             // We found the tile in the cache, but we need to make sure we
-            // wait until the pixels are ready to read.  We purposely have
-            // released the lock (above) before calling wait_pixels_ready,
-            // otherwise we could deadlock if another thread reading the
-            // pixels needs to lock the cache because it's doing automip.
-            tile->wait_pixels_ready();
+            // wait until the pixels are ready to read.  We hold no lock on
+            // the cache while calling wait_pixels_ready, otherwise we
+            // could deadlock if another thread reading the pixels needs
+            // to lock the cache because it's doing automip.
+            tile->wait_pixels_ready(thread_info);
             tile->use();
+            if (m_numa_nodes > 1)
+                numa_local_tile(tile, thread_info);
             DASSERT(id == tile->id());
             DASSERT(tile);
+            pin_tile(tile);
             return true;
         }
     }
 
     // The tile was not found in cache.
+    OIIO_TRACE_SPAN("ImageCache::tile_miss", "ImageCache");
 
     ++stats.find_tile_cache_misses;
+    ++stats.shard_misses[bin];
 
     // Yes, we're creating and reading a tile with no lock -- this is to
     // prevent all the other threads from blocking because of our
@@ -2333,17 +4209,182 @@ ImageCacheImpl::find_tile_main_cache(const TileID& id, ImageCacheTileRef& tile,
     // the ImageCacheFile will lock itself for the read_tile and there are
     // no other non-threadsafe side effects.
     tile = new ImageCacheTile(id);
-    // N.B. the ImageCacheTile ctr starts the tile out as 'used'
+    // N.B. the ImageCacheTile ctr starts the tile out as 'used' (except
+    // that add_tile_to_cache clears it for the segmented policy)
     DASSERT(tile);
     DASSERT(id == tile->id());
 
     add_tile_to_cache(tile, thread_info);
     DASSERT(id == tile->id());
+    if (m_autoprefetch && m_prefetch_pool && tile->valid()
+        && !m_prefetch_pool->this_thread_is_in_pool())
+        autoprefetch_tiles(id, thread_info);
+    pin_tile(tile);
+    return tile->valid();
+}
+
+
+
+bool
+ImageCacheImpl::find_tile_nocache(const TileID& id, ImageCacheTileRef& tile,
+                                  ImageCachePerThreadInfo* thread_info)
+{
+    ++thread_info->m_stats.find_tile_calls;
+    ++thread_info->m_stats.find_tile_microcache_misses;
+    {
+        if (m_tilecache.retrieve(id, tile)) {
+            tile->wait_pixels_ready(thread_info);
+            tile->use();
+            return tile->valid();
+        }
+    }
+    ++thread_info->m_stats.find_tile_cache_misses;
+    tile = new ImageCacheTile(id);
+    Timer timer;
+    tile->read(thread_info);
+    double readtime = timer();
+    thread_info->m_stats.fileio_time += readtime;
+    id.file().iotime() += readtime;
     return tile->valid();
 }
 
 
 
+void
+ImageCacheImpl::pin_tile(const ImageCacheTileRef& tile)
+{
+    const TileID& id(tile->id());
+    ImageCacheFile::LevelInfo& lev(
+        id.file().levelinfo(id.subimage(), id.miplevel()));
+    if (!tile->valid() || !tile->pixels_ready())
+        return;
+    // A pinned tile is never evicted, so keep the total modest.
+    long long size = (long long)tile->memsize();
+    if (lev.onetile && !lev.pinned_tile.load(std::memory_order_relaxed)
+        && m_auto_pinned_mem + size <= m_max_memory_bytes / 16) {
+        ImageCacheTile* expected = nullptr;
+        if (lev.pinned_tile.compare_exchange_strong(expected, tile.get())) {
+            intrusive_ptr_add_ref(tile.get());
+            pin_mem(*tile, true);
+            return;
+        }
+    }
+    // With pin_mip_tail, the tiles of the MIP tail levels that every
+    // lookup of a blurry enough footprint hits are pinned as they are
+    // first used.
+    if (m_pin_mip_tail && !tile->pinned()
+        && lev.nxtiles * lev.nytiles * lev.nztiles < m_pin_mip_tail
+        && m_auto_pinned_mem + size <= m_max_memory_bytes / 4
+        && tile->pin_if_unpinned()) {
+        m_pinned_mem += size;
+        m_auto_pinned_mem += size;
+        id.file().add_pinned_tile(tile, true);
+    }
+}
+
+
+
+bool
+ImageCacheImpl::pin_levels(ImageCacheFile* file,
+                           ImageCachePerThreadInfo* thread_info, int subimage,
+                           int miplevel_begin, int miplevel_end, bool pin)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info);
+    if (!file)
+        return false;
+    if (file->broken()) {
+        if (file->errors_should_issue())
+            errorf("Invalid image file \"%s\": %s", file->filename(),
+                   file->broken_error_message());
+        return false;
+    }
+    if (file->is_udim()) {
+        error("Cannot pin the tiles of a UDIM-like virtual file");
+        return false;
+    }
+    if (subimage < 0 || subimage >= file->subimages()) {
+        if (file->errors_should_issue())
+            errorf("pin asked for nonexistant subimage %d of \"%s\"",
+                   subimage, file->filename());
+        return false;
+    }
+    int nmip       = file->miplevels(subimage);
+    miplevel_begin = std::max(miplevel_begin, 0);
+    miplevel_end   = miplevel_end < 0 ? nmip : std::min(miplevel_end, nmip);
+    if (!pin) {
+        file->unpin_levels(subimage, miplevel_begin, miplevel_end);
+        return true;
+    }
+
+    bool ok = true;
+    for (int m = miplevel_begin; m < miplevel_end; ++m) {
+        const ImageSpec& spec(file->spec(subimage, m));
+        int tw = spec.tile_width;
+        int th = spec.tile_height;
+        int td = std::max(1, spec.tile_depth);
+        for (int z = spec.z; z < spec.z + std::max(1, spec.depth); z += td)
+            for (int y = spec.y; y < spec.y + spec.height; y += th)
+                for (int x = spec.x; x < spec.x + spec.width; x += tw) {
+                    TileID id(*file, subimage, m, x, y, z, 0, spec.nchannels);
+                    if (!find_tile(id, thread_info)) {
+                        ok = false;
+                        continue;
+                    }
+                    ImageCacheTileRef tile(thread_info->tile);
+                    pin_mem(*tile, false);
+                    file->add_pinned_tile(tile, false);
+                }
+    }
+    return ok;
+}
+
+
+
+void
+ImageCacheImpl::numa_local_tile(ImageCacheTileRef& tile,
+                                ImageCachePerThreadInfo* thread_info)
+{
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    int node = thread_info->numa_node;
+    if (node < 0 || node >= MAX_NUMA_NODES)
+        return;
+    // Tiles of unknown origin (such as app buffers), and mapped or shared
+    // tiles (whose pages the OS places) count as local.
+    if (tile->numa_node() == node || tile->numa_node() < 0 || tile->mapped()
+        || tile->shared() || !tile->valid()) {
+        ++stats.numa_local_hits[node];
+        return;
+    }
+    if (ImageCacheTileRef replica = tile->replica(node)) {
+        ++stats.numa_replica_hits[node];
+        tile = replica;
+        return;
+    }
+    ++stats.numa_remote_hits[node];
+    if (tile->remote_hit() < m_numa_replicate_hits)
+        return;
+
+    // The tile is hot on this node but its pixels live on another, so
+    // make a copy here. We allocate and fill it from this thread, so the
+    // OS will place it in this node's memory. The replica lives exactly
+    // as long as the tile itself, and counts against max_memory_MB.
+    const TileID& id(tile->id());
+    ImageCacheFile& file(id.file());
+    const ImageSpec& spec(file.spec(id.subimage(), id.miplevel()));
+    stride_t xstride = tile->pixelsize();
+    stride_t ystride = xstride * spec.tile_width;
+    ImageCacheTileRef replica
+        = new ImageCacheTile(id, tile->data(), file.datatype(id.subimage()),
+                             xstride, ystride, ystride * spec.tile_height);
+    replica->numa_node(node);
+    tile = tile->add_replica(node, replica);
+    ++stats.numa_replicas;
+}
+
+
+
 void
 ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
                                   ImageCachePerThreadInfo* thread_info)
@@ -2362,7 +4403,12 @@ ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
             // Still not in cache, add ours to the cache.
             // N.B. at this time, we do not hold any locks.
             check_max_mem(thread_info);
+            // The segmented policy counts only references after the one
+            // that loaded the tile, so that single-use tiles stay Fresh.
+            if (m_tile_eviction == EvictSegmented)
+                tile->clear_used();
             m_tilecache.insert(tile->id(), tile);
+            record_manifest(tile->id());
         }
     }
 
@@ -2380,7 +4426,7 @@ ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
             tile->id().file().iotime() += readtime;
         }
     } else {
-        tile->wait_pixels_ready();
+        tile->wait_pixels_ready(thread_info);
     }
 }
 
@@ -2395,90 +4441,654 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* thread_info)
     if (! (n++ % 64) || m_mem_used >= (long long)m_max_memory_bytes)
         std::cerr << "mem used: " << m_mem_used << ", max = " << m_max_memory_bytes << "\n";
 #endif
+    // Tiles erased from the cache are only freed (and their memory given
+    // back) once no lock-free reader can still be looking at them. Free
+    // any that are waiting before deciding whether more must go.
+    m_tilecache.reclaim();
     // Early out if the cache is empty
     if (m_tilecache.empty())
         return;
-    // Early out if we aren't exceeding the tile memory limit
-    if (m_mem_used < (long long)m_max_memory_bytes)
+    // Early out if we aren't exceeding the tile memory limit. Pinned
+    // tiles can't be evicted, so they don't count against it.
+    if (m_mem_used - m_pinned_mem < (long long)m_max_memory_bytes)
+        return;
+    OIIO_TRACE_SPAN("ImageCache::evict", "ImageCache");
+
+    if (m_tile_eviction == EvictSegmented) {
+        check_max_mem_segmented(thread_info);
         return;
+    }
+
+    // Try to grab the tile_sweep_mutex lock. If somebody else holds it,
+    // just return -- leave the memory limit enforcement to whomever is
+    // already in this function, no need for two threads to do it at
+    // once.  If this means we may ephemerally be over the memory limit
+    // (because another thread adds a tile before we have freed enough
+    // here), so be it.
+    if (!m_tile_sweep_mutex.try_lock())
+        return;
+
+    // Now, what we want to do is have a "clock hand" that sweeps across
+    // the cache, releasing tiles that haven't been used for a long
+    // time.  Because of multi-thread, rather than keep an iterator
+    // around for this (which could be invalidated since the last time
+    // we used it), we just remember the tileID of the next tile to
+    // check, then look it up fresh.  That is m_tile_sweep_id.
+
+    // Get a (locked) iterator for the next tile to be examined.
+    TileCache::iterator sweep;
+    if (m_tile_sweep_id) {
+        // We saved the sweep_id. Find the iterator corresponding to it.
+        sweep = m_tilecache.find(m_tile_sweep_id);
+        // Note: if the sweep_id is no longer in the table, sweep will be an
+        // empty iterator. That's ok, it will be fixed early in the main
+        // loop below.
+    }
+
+    // Loop while we still use too much tile memory.  Also, be careful
+    // of looping for too long, exit the loop if we just keep spinning
+    // uncontrollably.
+    int full_loops = 0;
+    while (m_mem_used - m_pinned_mem >= (long long)m_max_memory_bytes
+           && full_loops < 100) {
+        // If we have fallen off the end of the cache, loop back to the
+        // beginning and increment our full_loops count.
+        if (!sweep) {
+            sweep = m_tilecache.begin();
+            ++full_loops;
+        }
+        // If we're STILL at the end, it must be that somehow the entire
+        // cache is empty.  So just declare ourselves done.
+        if (!sweep)
+            break;
+        DASSERT(sweep->second);
+
+        if (!sweep->second->release()) {
+            // This is a tile we should delete.  To keep iterating
+            // safely, we have a good trick:
+            // 1. remember the TileID of the tile to delete
+            // If there's a compressed tier, also hang on to the tile
+            // long enough to compress it into there.
+            TileID todelete = sweep->first;
+            size_t size     = sweep->second->memsize();
+            ASSERT(m_mem_used >= (long long)size);
+            ImageCacheTileRef victim;
+            if (m_max_compressed_bytes)
+                victim = sweep->second;
+            // 2. Find the TileID of the NEXT item. We do this by
+            // incrementing the sweep iterator and grabbing its id.
+            ++sweep;
+            m_tile_sweep_id = (sweep ? sweep->first : TileID());
+            // 3. Release the bin lock and erase the tile we wish to delete.
+            sweep.unlock();
+            m_tilecache.erase(todelete);
+            ++thread_info->m_stats.tiles_evicted;
+            if (victim) {
+                compress_tile(*victim, thread_info);
+                victim.reset();
+            }
+            // 4. Re-establish a locked iterator for the next item, since
+            // the old iterator may have been invalidated by the erasure.
+            if (m_tile_sweep_id)
+                sweep = m_tilecache.find(m_tile_sweep_id);
+        } else {
+            ++sweep;
+        }
+    }
+
+    // OK, by this point we have either freed enough tiles to be below
+    // the limit again, or the cache is empty, or we've looped over the
+    // cache too many times and are giving up.
+
+    // Now we must save the tileid for next time.  Just set it to an
+    // empty ID if we don't have a valid iterator at this point.
+    m_tile_sweep_id = (sweep ? sweep->first : TileID());
+    m_tile_sweep_mutex.unlock();
+
+    // N.B. As we exit, the iterators will go out of scope and we will
+    // retain no locks on the cache.
+}
+
+
+
+void
+ImageCacheImpl::check_max_mem_segmented(ImageCachePerThreadInfo* thread_info)
+{
+    // This is a segmented variant of the clock sweep above, which keeps
+    // single-use tiles (such as those of one big sequential read) from pushing
+    // out the tiles that are in steady use. Tiles enter as Fresh and unused, a
+    // sweep that finds a Fresh tile referenced since then moves it to
+    // Probation, and a sweep that finds a Probation tile referenced again
+    // promotes it to Protected. Only Fresh and Probation tiles that were not
+    // used since the previous sweep are evicted. Protected tiles are limited
+    // to 3/4 of each bin; when there are too many, the unused ones are demoted
+    // to Probation.
+    //
+    // Instead of one clock hand guarded by m_tile_sweep_mutex, each
+    // thread that finds the cache too full sweeps whole bins, taking them
+    // round-robin and holding only the bin's own lock, so several threads
+    // may evict in parallel from different bins.
+    const long long max_mem = (long long)m_max_memory_bytes;
+    const int nbins         = int(TileCache::nbins());
+    std::vector<ImageCacheTileRef> victims;
+    for (int i = 0; i < 100 * nbins && m_mem_used - m_pinned_mem >= max_mem;
+         ++i) {
+        int b = int((unsigned int)(m_tile_sweep_bin++) % nbins);
+        TileSweepBin& sweepbin(m_tile_sweep_bins[b]);
+        int maxprotected = (sweepbin.ntiles * 3) / 4;
+        int nprotected   = sweepbin.nprotected;
+        int ntiles = 0, nprotected_seen = 0;
+        // Tiles headed for the compressed tier are compressed after we
+        // release the bin lock, so count their memory as already freed.
+        long long pending = 0;
+        m_tilecache.erase_if(b, [&](const TileID& /*id*/,
+                                    const ImageCacheTileRef& tile) {
+            ++ntiles;
+            if (!tile->pixels_ready() || !tile->valid() || tile->pinned())
+                return false;  // Don't release invalid, unready or pinned
+            // release() clears the used bit and returns its old value.
+            bool used = tile->release();
+            int seg   = tile->segment();
+            if (seg == ImageCacheTile::Protected) {
+                if (!used && nprotected > maxprotected) {
+                    tile->segment(ImageCacheTile::Probation);
+                    --nprotected;
+                }
+            } else if (used) {
+                if (seg == ImageCacheTile::Fresh) {
+                    tile->segment(ImageCacheTile::Probation);
+                } else if (nprotected < maxprotected) {
+                    tile->segment(ImageCacheTile::Protected);
+                    ++nprotected;
+                }
+            } else if (m_mem_used - m_pinned_mem - pending >= max_mem) {
+                --ntiles;
+                ++thread_info->m_stats.tiles_evicted;
+                if (m_max_compressed_bytes) {
+                    victims.push_back(tile);
+                    pending += tile->memsize();
+                }
+                return true;  // evict
+            }
+            if (tile->segment() == ImageCacheTile::Protected)
+                ++nprotected_seen;
+            return false;
+        });
+        sweepbin.ntiles     = ntiles;
+        sweepbin.nprotected = nprotected_seen;
+        for (auto& victim : victims)
+            compress_tile(*victim, thread_info);
+        victims.clear();
+        if (m_tilecache.empty())
+            break;
+    }
+}
+
+
+
+// The compressed tier stores tiles with zlib at its fastest setting,
+// after "shuffling" the bytes so that the Nth byte of every channel value
+// is stored contiguously. For half and float pixels, the exponent and high
+// mantissa bytes of neighboring values are very similar, so this gives
+// deflate long runs to work with, much like the EXR/TIFF predictors.
+static void
+shuffle_bytes(const char* src, char* dst, size_t size, int elemsize)
+{
+    size_t n = size / elemsize;
+    for (int b = 0; b < elemsize; ++b)
+        for (size_t i = 0; i < n; ++i)
+            dst[b * n + i] = src[i * elemsize + b];
+    memcpy(dst + n * elemsize, src + n * elemsize, size - n * elemsize);
+}
+
+
+
+static void
+unshuffle_bytes(const char* src, char* dst, size_t size, int elemsize)
+{
+    size_t n = size / elemsize;
+    for (int b = 0; b < elemsize; ++b)
+        for (size_t i = 0; i < n; ++i)
+            dst[i * elemsize + b] = src[b * n + i];
+    memcpy(dst + n * elemsize, src + n * elemsize, size - n * elemsize);
+}
+
+
+
+void
+ImageCacheImpl::compress_tile(const ImageCacheTile& tile,
+                              ImageCachePerThreadInfo* thread_info)
+{
+    // Only tiles that own a good set of pixels are worth keeping. (Those
+    // in the shared store stay there after we let go of them.)
+    if (!m_max_compressed_bytes || !tile.valid() || !tile.pixels_ready()
+        || tile.memsize() <= OIIO_SIMD_MAX_SIZE_BYTES || tile.shared())
+        return;
+    CompressedTile ct;
+    ct.rawsize  = tile.memsize() - OIIO_SIMD_MAX_SIZE_BYTES;
+    ct.elemsize = std::max(1, tile.channelsize());
+    std::unique_ptr<char[]> shuffled(new char[ct.rawsize]);
+    shuffle_bytes((const char*)tile.data(), shuffled.get(), ct.rawsize,
+                  ct.elemsize);
+    uLongf csize = compressBound(uLong(ct.rawsize));
+    std::unique_ptr<char[]> cbuf(new char[csize]);
+    if (compress2((Bytef*)cbuf.get(), &csize, (const Bytef*)shuffled.get(),
+                  uLong(ct.rawsize), Z_BEST_SPEED)
+            != Z_OK
+        || csize >= ct.rawsize)
+        return;  // Failed, or not worth it
+    ct.size = csize;
+    ct.data.reset(new char[csize]);
+    memcpy(ct.data.get(), cbuf.get(), csize);
+
+    spin_lock lock(m_ctiles_mutex);
+    ct.seq = m_ctiles_seq++;
+    m_ctiles_fifo.emplace_back(tile.id(), ct.seq);
+    m_ctiles_mem += ct.size;
+    auto found = m_ctiles.find(tile.id());
+    if (found != m_ctiles.end()) {
+        m_ctiles_mem -= found->second.size;
+        found->second = std::move(ct);
+    } else {
+        m_ctiles.emplace(tile.id(), std::move(ct));
+    }
+    // Enforce the budget by discarding the oldest compressed tiles. FIFO
+    // entries whose tile has since been restored (or replaced by a newer
+    // copy) are simply skipped.
+    while (m_ctiles_mem > m_max_compressed_bytes && m_ctiles_fifo.size()) {
+        auto oldest = m_ctiles_fifo.front();
+        m_ctiles_fifo.pop_front();
+        auto f = m_ctiles.find(oldest.first);
+        if (f != m_ctiles.end() && f->second.seq == oldest.second) {
+            m_ctiles_mem -= f->second.size;
+            m_ctiles.erase(f);
+        }
+    }
+    if (thread_info)
+        ++thread_info->m_stats.compressed_tiles_stored;
+}
+
+
+
+bool
+ImageCacheImpl::uncompress_tile(const TileID& id, void* data, size_t size,
+                                ImageCachePerThreadInfo* thread_info)
+{
+    if (!m_max_compressed_bytes)
+        return false;
+    CompressedTile ct;
+    {
+        spin_lock lock(m_ctiles_mutex);
+        auto found = m_ctiles.find(id);
+        if (found == m_ctiles.end())
+            return false;
+        // It's going back into the main cache, so take it out of here.
+        ct = std::move(found->second);
+        m_ctiles.erase(found);
+        m_ctiles_mem -= ct.size;
+    }
+    if (ct.rawsize != size)
+        return false;
+    std::unique_ptr<char[]> shuffled(new char[ct.rawsize]);
+    uLongf rawsize = uLongf(ct.rawsize);
+    if (uncompress((Bytef*)shuffled.get(), &rawsize,
+                   (const Bytef*)ct.data.get(), uLong(ct.size))
+            != Z_OK
+        || rawsize != ct.rawsize)
+        return false;
+    unshuffle_bytes(shuffled.get(), (char*)data, ct.rawsize, ct.elemsize);
+    ++thread_info->m_stats.compressed_tile_hits;
+    return true;
+}
+
+
+
+// Each tile in the disk cache is a small header followed by the raw
+// pixels, exactly as they are laid out in an ImageCacheTile.
+static const char disk_tile_magic[8] = { 'O', 'I', 'I', 'O',
+                                         'T', 'I', 'L', '1' };
+
+
+
+std::string
+ImageCacheImpl::tile_key(const TileID& id) const
+{
+    const ImageCacheFile& file(id.file());
+    std::string filekey = Strutil::sprintf("%s:%lld", file.filename(),
+                                           (long long)file.mod_time());
+    // Fold in everything else that changes the pixels a tile decodes to,
+    // so that caches (or processes) set up differently never share tiles:
+    // how alpha is treated, the file's own open configuration, and the
+    // tile size (which for untiled files is the cache's autotile size).
+    const ImageSpec& spec(file.spec(id.subimage(), id.miplevel()));
+    filekey += Strutil::sprintf(":ua%d:%dx%dx%d", int(m_unassociatedalpha),
+                                spec.tile_width, spec.tile_height,
+                                spec.tile_depth);
+    if (file.m_configspec)
+        for (const ParamValue& p : file.m_configspec->extra_attribs)
+            filekey += Strutil::sprintf(":%s=%s", p.name(),
+                                        ImageSpec::metadata_val(p));
+    return Strutil::sprintf("%016llx/s%d_m%d_%d_%d_%d_c%d-%d_%s",
+                            (unsigned long long)farmhash::Hash64(filekey),
+                            id.subimage(), id.miplevel(), id.x(), id.y(),
+                            id.z(), id.chbegin(), id.chend(),
+                            file.datatype(id.subimage()));
+}
+
+
+
+std::string
+ImageCacheImpl::disk_tile_path(const TileID& id) const
+{
+    return Strutil::sprintf("%s/%s.tile", m_tile_disk_cache, tile_key(id));
+}
+
+
+
+void
+ImageCacheImpl::open_shared_tiles()
+{
+    std::shared_ptr<SharedTileStore> store;
+    if (m_shared_tile_memory.size()) {
+        store.reset(new SharedTileStore);
+        std::string err;
+        if (!store->open(m_shared_tile_memory,
+                         size_t(m_shared_tile_memory_MB) * 1024 * 1024, err)) {
+            errorf("Could not use shared tile memory: %s", err);
+            store.reset();
+        }
+    }
+    // Threads that are reading tiles keep using the old store (if any)
+    // until they're done with it.
+    spin_lock lock(m_shared_tiles_mutex);
+    m_shared_tiles = store;
+}
+
+
+
+bool
+ImageCacheImpl::read_disk_tile(const TileID& id, void* data, size_t size,
+                               ImageCachePerThreadInfo* thread_info)
+{
+    if (m_tile_disk_cache.empty())
+        return false;
+    FILE* f = Filesystem::fopen(disk_tile_path(id), "rb");
+    if (!f)
+        return false;
+    char magic[8];
+    uint64_t nbytes = 0;
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1
+              && !memcmp(magic, disk_tile_magic, sizeof(magic))
+              && fread(&nbytes, sizeof(nbytes), 1, f) == 1 && nbytes == size
+              && fread(data, 1, size, f) == size;
+    fclose(f);
+    if (ok) {
+        ++thread_info->m_stats.disk_cache_hits;
+        // Pruning removes the least recently written tiles first, so
+        // freshen the ones in use.
+        Filesystem::last_write_time(disk_tile_path(id), std::time(nullptr));
+    }
+    return ok;
+}
+
+
+
+// Trim the disk tile cache in directory dir to at most maxbytes. The
+// tiles least recently written (or read, see read_disk_tile) go first,
+// down to 90% of the limit, so that it isn't pruned again right away.
+// Temporary files left by writers that died are removed once they're an
+// hour old. Other processes may be adding and removing files meanwhile,
+// so anything that vanishes under us is simply skipped.
+static void
+prune_disk_tiles(const std::string& dir, long long maxbytes)
+{
+    static std::atomic<bool> pruning(false);
+    if (pruning.exchange(true))
+        return;  // Somebody else is at it already
+    std::vector<std::string> files;
+    try {
+        Filesystem::get_directory_entries(dir, files, true /*recursive*/);
+    } catch (...) {
+    }
+    struct DiskTile {
+        std::time_t time;
+        long long size;
+        const std::string* path;
+    };
+    std::vector<DiskTile> tiles;
+    long long total = 0;
+    std::time_t now = std::time(nullptr);
+    for (const std::string& f : files) {
+        if (Strutil::ends_with(f, ".tile")) {
+            long long size = (long long)Filesystem::file_size(f);
+            tiles.push_back({ Filesystem::last_write_time(f), size, &f });
+            total += size;
+        } else if (Strutil::ends_with(f, ".tmp")
+                   && now - Filesystem::last_write_time(f) > 3600) {
+            Filesystem::remove(f);
+        }
+    }
+    if (total > maxbytes) {
+        std::sort(tiles.begin(), tiles.end(),
+                  [](const DiskTile& a, const DiskTile& b) {
+                      return a.time < b.time;
+                  });
+        for (const DiskTile& t : tiles) {
+            if (total <= maxbytes - maxbytes / 10)
+                break;
+            if (Filesystem::remove(*t.path))
+                total -= t.size;
+        }
+    }
+    pruning = false;
+}
+
+
+
+void
+ImageCacheImpl::write_disk_tile(const TileID& id, const void* data,
+                                size_t size,
+                                ImageCachePerThreadInfo* thread_info)
+{
+    std::string path = disk_tile_path(id);
+    std::shared_ptr<std::vector<char>> pixels(
+        new std::vector<char>((const char*)data, (const char*)data + size));
+    ++thread_info->m_stats.disk_cache_writes;
+    // Every so often (each 1/16 of the size limit written), check the size
+    // of the whole directory, which other processes may be adding to.
+    long long maxbytes = (long long)m_tile_disk_cache_MB * 1024 * 1024;
+    bool prune         = false;
+    if (maxbytes && (m_disk_tile_bytes_written += size) >= maxbytes / 16) {
+        m_disk_tile_bytes_written = 0;
+        prune                     = true;
+    }
+    std::string dir = m_tile_disk_cache;
+    // The writing itself only touches copies, so it can outlive anything
+    // in the cache. Write to a unique temporary name and rename it into
+    // place, so that no process (including others sharing the directory)
+    // can ever see a partially written tile. Nobody waits for it, so it
+    // goes to the low priority pool.
+    background_thread_pool()->push([=](int /*thread_id*/) {
+        std::string dir = Filesystem::parent_path(path);
+        if (!Filesystem::is_directory(dir)) {
+            Filesystem::create_directory(Filesystem::parent_path(dir));
+            Filesystem::create_directory(dir);
+        }
+        std::string tmp = path + "." + Filesystem::unique_path() + ".tmp";
+        FILE* f         = Filesystem::fopen(tmp, "wb");
+        if (!f)
+            return;
+        uint64_t nbytes = pixels->size();
+        bool ok = fwrite(disk_tile_magic, sizeof(disk_tile_magic), 1, f) == 1
+                  && fwrite(&nbytes, sizeof(nbytes), 1, f) == 1
+                  && fwrite(pixels->data(), 1, nbytes, f) == nbytes;
+        ok &= (fclose(f) == 0);
+        if (!ok || !Filesystem::rename(tmp, path))
+            Filesystem::remove(tmp);
+        if (prune)
+            prune_disk_tiles(dir, maxbytes);
+    });
+}
+
+
+
+void
+ImageCacheImpl::clear_compressed_tiles(const ImageCacheFile* file)
+{
+    spin_lock lock(m_ctiles_mutex);
+    if (!file) {
+        m_ctiles.clear();
+        m_ctiles_fifo.clear();
+        m_ctiles_mem = 0;
+        return;
+    }
+    for (auto it = m_ctiles.begin(); it != m_ctiles.end();) {
+        if (it->first.file_ptr() == file) {
+            m_ctiles_mem -= it->second.size;
+            it = m_ctiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // Stale FIFO entries are harmless, they'll be skipped when reached.
+}
+
+
+
+void
+ImageCacheImpl::set_prefetch_threads(int nthreads)
+{
+    nthreads = std::max(nthreads, 0);
+    if (nthreads == m_prefetch_threads)
+        return;
+    // Drain and destroy the old pool (if any) before making a new one,
+    // since a thread_pool must not be resized while jobs are running.
+    wait_for_prefetch();
+    m_prefetch_pool.reset();
+    m_prefetch_threads = nthreads;
+    if (nthreads > 0) {
+        m_prefetch_pool.reset(new thread_pool(nthreads));
+        m_prefetch_pool->set_name("prefetch");
+        m_prefetch_pool->set_background(true);
+    }
+}
+
+
+
+void
+ImageCacheImpl::queue_prefetch(const TileID& id,
+                               ImageCachePerThreadInfo* thread_info,
+                               bool speculative)
+{
+    // Speculative (autoprefetch) requests are dropped rather than let
+    // the queue grow without bound behind a slow file server.
+    const int max_speculative_pending = 64 * std::max(m_prefetch_threads, 1);
+    if (speculative && m_prefetch_pending >= max_speculative_pending)
+        return;
+    // Nothing to do if the tile is already resident (or being read).
+    if (tile_in_cache(id, thread_info))
+        return;
+    ++thread_info->m_stats.prefetch_requests;
+    if (!m_prefetch_pool) {
+        prefetch_tile(id);
+        return;
+    }
+    ++m_prefetch_pending;
+    m_prefetch_pool->push([this, id](int /*thread_id*/) {
+        prefetch_tile(id);
+        --m_prefetch_pending;
+    });
+}
+
 
-    // Try to grab the tile_sweep_mutex lock. If somebody else holds it,
-    // just return -- leave the memory limit enforcement to whomever is
-    // already in this function, no need for two threads to do it at
-    // once.  If this means we may ephemerally be over the memory limit
-    // (because another thread adds a tile before we have freed enough
-    // here), so be it.
-    if (!m_tile_sweep_mutex.try_lock())
+
+void
+ImageCacheImpl::prefetch_tile(const TileID& id)
+{
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    // Another thread may have asked for it since it was queued.
+    if (tile_in_cache(id, thread_info))
         return;
+    ImageCacheTile* ours   = new ImageCacheTile(id);
+    ImageCacheTileRef tile = ours;
+    add_tile_to_cache(tile, thread_info);
+    // add_tile_to_cache substitutes the resident tile if we lost a race
+    if (tile.get() == ours)
+        ++thread_info->m_stats.prefetch_tiles;
+}
 
-    // Now, what we want to do is have a "clock hand" that sweeps across
-    // the cache, releasing tiles that haven't been used for a long
-    // time.  Because of multi-thread, rather than keep an iterator
-    // around for this (which could be invalidated since the last time
-    // we used it), we just remember the tileID of the next tile to
-    // check, then look it up fresh.  That is m_tile_sweep_id.
 
-    // Get a (locked) iterator for the next tile to be examined.
-    TileCache::iterator sweep;
-    if (m_tile_sweep_id) {
-        // We saved the sweep_id. Find the iterator corresponding to it.
-        sweep = m_tilecache.find(m_tile_sweep_id);
-        // Note: if the sweep_id is no longer in the table, sweep will be an
-        // empty iterator. That's ok, it will be fixed early in the main
-        // loop below.
+
+void
+ImageCacheImpl::autoprefetch_tiles(const TileID& id,
+                                   ImageCachePerThreadInfo* thread_info)
+{
+    ImageCacheFile& file(id.file());
+    int subimage = id.subimage();
+    int miplevel = id.miplevel();
+    const ImageSpec& spec(file.spec(subimage, miplevel));
+    int tw = spec.tile_width, th = spec.tile_height;
+
+    // The four neighbors in the same level that are inside the data window
+    static const int neighbors[4][2] = {
+        { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }
+    };
+    for (auto& n : neighbors) {
+        int x = id.x() + n[0] * tw;
+        int y = id.y() + n[1] * th;
+        if (x < spec.x || x >= spec.x + spec.width || y < spec.y
+            || y >= spec.y + spec.height)
+            continue;
+        queue_prefetch(TileID(file, subimage, miplevel, x, y, id.z(),
+                              id.chbegin(), id.chend()),
+                       thread_info, true);
+    }
+
+    // The tile of the next-coarser MIP level that covers the center of
+    // this one, which is what a trilinear lookup will want next.
+    if (miplevel + 1 < file.miplevels(subimage)) {
+        const ImageSpec& cspec(file.spec(subimage, miplevel + 1));
+        auto coarser = [](int v, int tilesize, int origin, int res,
+                          int corigin, int cres, int ctilesize) {
+            int c = int((int64_t(v - origin) + tilesize / 2) * cres / res);
+            c     = clamp(c, 0, cres - 1);
+            return corigin + (c / ctilesize) * ctilesize;
+        };
+        int x = coarser(id.x(), tw, spec.x, spec.width, cspec.x, cspec.width,
+                        cspec.tile_width);
+        int y = coarser(id.y(), th, spec.y, spec.height, cspec.y,
+                        cspec.height, cspec.tile_height);
+        int z = coarser(id.z(), spec.tile_depth, spec.z, spec.depth, cspec.z,
+                        cspec.depth, cspec.tile_depth);
+        queue_prefetch(TileID(file, subimage, miplevel + 1, x, y, z,
+                              id.chbegin(), id.chend()),
+                       thread_info, true);
     }
+}
 
-    // Loop while we still use too much tile memory.  Also, be careful
-    // of looping for too long, exit the loop if we just keep spinning
-    // uncontrollably.
-    int full_loops = 0;
-    while (m_mem_used >= (long long)m_max_memory_bytes && full_loops < 100) {
-        // If we have fallen off the end of the cache, loop back to the
-        // beginning and increment our full_loops count.
-        if (!sweep) {
-            sweep = m_tilecache.begin();
-            ++full_loops;
-        }
-        // If we're STILL at the end, it must be that somehow the entire
-        // cache is empty.  So just declare ourselves done.
-        if (!sweep)
-            break;
-        DASSERT(sweep->second);
 
-        if (!sweep->second->release()) {
-            // This is a tile we should delete.  To keep iterating
-            // safely, we have a good trick:
-            // 1. remember the TileID of the tile to delete
-            TileID todelete = sweep->first;
-            size_t size     = sweep->second->memsize();
-            ASSERT(m_mem_used >= (long long)size);
-            // 2. Find the TileID of the NEXT item. We do this by
-            // incrementing the sweep iterator and grabbing its id.
-            ++sweep;
-            m_tile_sweep_id = (sweep ? sweep->first : TileID());
-            // 3. Release the bin lock and erase the tile we wish to delete.
-            sweep.unlock();
-            m_tilecache.erase(todelete);
-            // 4. Re-establish a locked iterator for the next item, since
-            // the old iterator may have been invalidated by the erasure.
-            if (m_tile_sweep_id)
-                sweep = m_tilecache.find(m_tile_sweep_id);
-        } else {
-            ++sweep;
-        }
-    }
 
-    // OK, by this point we have either freed enough tiles to be below
-    // the limit again, or the cache is empty, or we've looped over the
-    // cache too many times and are giving up.
+void
+ImageCacheImpl::queue_automip(ImageCacheFile* file, int subimage)
+{
+    // The file can't go away while we build, since invalidating it (or
+    // destroying the cache) waits for the build to finish. Lookups use the
+    // levels that already exist meanwhile, so it can be done at low
+    // priority.
+    ++m_automip_pending;
+    background_thread_pool()->push([this, file, subimage](int /*thread_id*/) {
+        file->build_automip_levels(get_perthread_info(), subimage);
+        --m_automip_pending;
+    });
+}
 
-    // Now we must save the tileid for next time.  Just set it to an
-    // empty ID if we don't have a valid iterator at this point.
-    m_tile_sweep_id = (sweep ? sweep->first : TileID());
-    m_tile_sweep_mutex.unlock();
 
-    // N.B. As we exit, the iterators will go out of scope and we will
-    // retain no locks on the cache.
+
+void
+ImageCacheImpl::wait_for_prefetch()
+{
+    while (m_prefetch_pending > 0 || m_automip_pending > 0)
+        yield();
 }
 
 
@@ -2486,6 +5096,10 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* thread_info)
 std::string
 ImageCacheImpl::resolve_filename(const std::string& filename) const
 {
+    // URLs aren't looked for on the searchpath.
+    if (Filesystem::is_url(filename))
+        return filename;
+
     // Ask if the format can generate imagery procedurally. If so, don't
     // go looking for a file.
     auto input      = ImageInput::create(filename);
@@ -2493,7 +5107,8 @@ ImageCacheImpl::resolve_filename(const std::string& filename) const
     if (procedural)
         return filename;
 
-    std::string s = Filesystem::searchpath_find(filename, m_searchdirs, true);
+    std::string s = Filesystem::searchpath_find(filename, m_searchdirs, true,
+                                                false, m_searchpath_ttl);
     return s.empty() ? filename : s;
 }
 
@@ -2549,6 +5164,14 @@ ImageCacheImpl::get_image_info(ImageCacheFile* file,
                     file->m_redundant_bytesread);
         ATTR_DECODE("stat:timesopened", int, file->m_timesopened);
         ATTR_DECODE("stat:iotime", float, file->m_iotime);
+        ATTR_DECODE("stat:max_read_time", float, file->max_read_time());
+        if (dataname == "stat:read_time_hist"
+            && datatype == TypeDesc(TypeDesc::INT64,
+                                    ImageCacheStatistics::time_hist_buckets)) {
+            for (int b = 0; b < ImageCacheStatistics::time_hist_buckets; ++b)
+                ((long long*)data)[b] = file->read_time_hist(b);
+            return true;
+        }
         ATTR_DECODE("stat:mipused", int, file->m_mipused);
         ATTR_DECODE("stat:is_duplicate", int, bool(file->duplicate()));
         ATTR_DECODE("stat:image_size", long long, file->m_total_imagesize);
@@ -2730,6 +5353,7 @@ ImageCacheImpl::get_image_info(ImageCacheFile* file,
 
     // general case -- handle anything else that's able to be found by
     // spec.find_attribute().
+    file->decode_metadata();
     const ParamValue* p = spec.find_attribute(dataname);
     if (p && p->type().basevalues() == datatype.basevalues()) {
         // First test for exact base type match
@@ -2835,6 +5459,7 @@ ImageCacheImpl::imagespec(ImageCacheFile* file,
                    file->miplevels(subimage));
         return NULL;
     }
+    file->decode_metadata();
     const ImageSpec* spec = native ? &file->nativespec(subimage, miplevel)
                                    : &file->spec(subimage, miplevel);
     return spec;
@@ -2956,6 +5581,33 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
     ImageSpec::auto_stride(xstride, ystride, zstride, format, result_nchans,
                            xend - xbegin, yend - ybegin);
 
+    // A region spanning several rows of tiles may be split into one job
+    // per tile row, so that the tiles that miss are read and decoded
+    // concurrently. Each row is done by the serial code below (as a tile
+    // row or less, it won't be split again), with the per-thread info of
+    // whichever thread runs it.
+    if (m_get_pixels_threads != 1 && yend - ybegin > spec.tile_height) {
+        int th      = spec.tile_height;
+        int ty      = ybegin - ((ybegin - spec.y) % th);
+        int64_t nty = (yend - ty + th - 1) / th;
+        std::atomic<bool> allok(true);
+        parallel_for(
+            0, nty,
+            [&](int64_t r) {
+                int y0 = std::max(ybegin, ty + int(r) * th);
+                int y1 = std::min(yend, ty + int(r + 1) * th);
+                if (!get_pixels(file, get_perthread_info(), subimage,
+                                miplevel, xbegin, xend, y0, y1, zbegin, zend,
+                                chbegin, chend, format,
+                                (char*)result + (y0 - ybegin) * ystride,
+                                xstride, ystride, zstride, cache_chbegin,
+                                cache_chend))
+                    allok = false;
+            },
+            parallel_options(m_get_pixels_threads, Split_Y, 1));
+        return allok;
+    }
+
     // result_pixelsize, scanlinesize, and zplanesize assume contiguous
     // layout.  This may or may not be the same as the strides passed by
     // the caller.
@@ -3107,6 +5759,164 @@ ImageCacheImpl::get_tile(ImageHandle* file, Perthread* thread_info,
 
 
 
+int
+ImageCacheImpl::get_tiles(ImageHandle* file, Perthread* thread_info,
+                          cspan<TileRequest> requests, span<Tile*> tiles)
+{
+    ASSERT(tiles.size() >= requests.size());
+    for (auto& t : tiles)
+        t = nullptr;
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info);
+    if (!file || file->broken() || file->is_udim())
+        return 0;
+
+    // Snap each request to its tile, and sort them so that those in the
+    // same bin of the tile cache are together and, within each bin, in
+    // file order.
+    struct Request {
+        TileID id;
+        size_t bin;
+        int index;
+    };
+    std::vector<Request> reqs;
+    reqs.reserve(requests.size());
+    for (int i = 0, n = int(requests.size()); i < n; ++i) {
+        const TileRequest& r(requests[i]);
+        if (r.subimage < 0 || r.subimage >= file->subimages() || r.miplevel < 0
+            || r.miplevel >= file->miplevels(r.subimage))
+            continue;
+        const ImageSpec& spec(file->spec(r.subimage, r.miplevel));
+        int x = spec.x + ((r.x - spec.x) / spec.tile_width) * spec.tile_width;
+        int y = spec.y
+                + ((r.y - spec.y) / spec.tile_height) * spec.tile_height;
+        int z = spec.z + ((r.z - spec.z) / spec.tile_depth) * spec.tile_depth;
+        int chend = r.chend < r.chbegin ? spec.nchannels : r.chend;
+        TileID id(*file, r.subimage, r.miplevel, x, y, z, r.chbegin, chend);
+        reqs.push_back({ id, m_tilecache.whichbin(id), i });
+    }
+    auto fileorder = [](const TileID& a, const TileID& b) {
+        return std::make_tuple(a.subimage(), a.miplevel(), a.chbegin(),
+                               a.chend(), a.z(), a.y(), a.x())
+               < std::make_tuple(b.subimage(), b.miplevel(), b.chbegin(),
+                                 b.chend(), b.z(), b.y(), b.x());
+    };
+    std::sort(reqs.begin(), reqs.end(),
+              [&](const Request& a, const Request& b) {
+                  return a.bin != b.bin ? a.bin < b.bin
+                                        : fileorder(a.id, b.id);
+              });
+
+    // Look up each bin's requests while locking the bin only once. Tiles
+    // that aren't there are inserted (not yet read) under the same lock,
+    // which claims them: other threads wanting them will wait for us.
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    std::vector<ImageCacheTileRef> found(requests.size());
+    std::vector<ImageCacheTileRef> claimed;
+    for (size_t b = 0; b < reqs.size();) {
+        size_t e = b;
+        while (e < reqs.size() && reqs[e].bin == reqs[b].bin)
+            ++e;
+        check_max_mem(thread_info);
+        m_tilecache.lock_bin(reqs[b].id);
+        for (size_t r = b; r < e; ++r) {
+            ImageCacheTileRef& tile(found[reqs[r].index]);
+            if (!m_tilecache.retrieve(reqs[r].id, tile, false)) {
+                tile = new ImageCacheTile(reqs[r].id);
+                m_tilecache.insert(reqs[r].id, tile, false);
+                claimed.push_back(tile);
+                record_manifest(reqs[r].id);
+                ++stats.find_tile_cache_misses;
+                ++stats.shard_misses[reqs[r].bin];
+            } else {
+                ++stats.shard_hits[reqs[r].bin];
+            }
+        }
+        m_tilecache.unlock_bin(reqs[b].bin);
+        b = e;
+    }
+    stats.find_tile_calls += reqs.size();
+    stats.find_tile_microcache_misses += reqs.size();
+
+    // Read the tiles we claimed, in file order. Runs of horizontally
+    // adjacent tiles are read with a single read_tiles call, unless we're
+    // using any of the other tile stores, which work one tile at a time.
+    std::sort(claimed.begin(), claimed.end(),
+              [&](const ImageCacheTileRef& a, const ImageCacheTileRef& b) {
+                  return fileorder(a->id(), b->id());
+              });
+    bool batch = !m_mmap_tiles && !m_max_compressed_bytes
+                 && m_tile_disk_cache.empty() && !shared_tiles();
+    const int max_run = 16;
+    std::vector<char> runbuf;
+    Timer timer;
+    for (size_t b = 0; b < claimed.size();) {
+        const TileID& first(claimed[b]->id());
+        const ImageCacheFile::SubimageInfo& subinfo(
+            file->subimageinfo(first.subimage()));
+        const ImageSpec& spec(file->spec(first.subimage(), first.miplevel()));
+        size_t e = b + 1;
+        if (batch && !subinfo.untiled
+            && !(subinfo.unmipped && first.miplevel() > 0)) {
+            while (e < claimed.size() && int(e - b) < max_run) {
+                const TileID& next(claimed[e]->id());
+                if (next.subimage() != first.subimage()
+                    || next.miplevel() != first.miplevel()
+                    || next.chbegin() != first.chbegin()
+                    || next.chend() != first.chend() || next.z() != first.z()
+                    || next.y() != first.y()
+                    || next.x() != first.x() + int(e - b) * spec.tile_width)
+                    break;
+                ++e;
+            }
+        }
+        if (e - b == 1) {
+            claimed[b]->read(thread_info);
+        } else {
+            int ntiles        = int(e - b);
+            TypeDesc format   = file->datatype(first.subimage());
+            stride_t pixsize  = stride_t(format.size()) * first.nchannels();
+            stride_t ystride  = pixsize * spec.tile_width * ntiles;
+            stride_t zstride  = ystride * spec.tile_height;
+            runbuf.resize(size_t(zstride) * spec.tile_depth);
+            bool ok = file->read_tiles(thread_info, first.subimage(),
+                                       first.miplevel(), first.x(),
+                                       first.x() + ntiles * spec.tile_width,
+                                       first.y(), first.z(), first.chbegin(),
+                                       first.chend(), format, runbuf.data());
+            for (int t = 0; t < ntiles; ++t)
+                claimed[b + t]->read_from(runbuf.data()
+                                              + t * pixsize * spec.tile_width,
+                                          ystride, zstride, ok);
+        }
+        b = e;
+    }
+    if (claimed.size()) {
+        double readtime = timer();
+        stats.fileio_time += readtime;
+        file->iotime() += readtime;
+    }
+
+    // Hand out the tiles, waiting for any that other threads are reading.
+    int nfound = 0;
+    for (size_t i = 0; i < found.size(); ++i) {
+        ImageCacheTileRef& tile(found[i]);
+        if (!tile)
+            continue;
+        tile->wait_pixels_ready(thread_info);
+        tile->use();
+        if (tile->valid()) {
+            tile->_incref();  // Fake an extra reference count
+            tiles[i] = (ImageCache::Tile*)tile.get();
+            ++nfound;
+        }
+    }
+    return nfound;
+}
+
+
+
 void
 ImageCacheImpl::release_tile(ImageCache::Tile* tile) const
 {
@@ -3154,6 +5964,184 @@ ImageCacheImpl::tile_pixels(ImageCache::Tile* tile, TypeDesc& format) const
 
 
 
+bool
+ImageCacheImpl::prefetch_tiles(ustring filename, int subimage, int miplevel,
+                               ROI roi)
+{
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    ImageCacheFile* file                 = find_file(filename, thread_info);
+    if (!file) {
+        errorf("Image file \"%s\" not found", filename);
+        return false;
+    }
+    return prefetch_tiles(file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+bool
+ImageCacheImpl::prefetch_tiles(ImageHandle* file, Perthread* thread_info,
+                               int subimage, int miplevel, ROI roi)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info);
+    if (!file)
+        return false;
+    if (file->broken()) {
+        if (file->errors_should_issue())
+            errorf("Invalid image file \"%s\": %s", file->filename(),
+                   file->broken_error_message());
+        return false;
+    }
+    if (file->is_udim()) {
+        error("Cannot prefetch_tiles() of a UDIM-like virtual file");
+        return false;
+    }
+    if (subimage < 0 || subimage >= file->subimages()) {
+        if (file->errors_should_issue())
+            errorf(
+                "prefetch_tiles asked for nonexistant subimage %d of \"%s\"",
+                subimage, file->filename());
+        return false;
+    }
+    if (miplevel < 0 || miplevel >= file->miplevels(subimage)) {
+        if (file->errors_should_issue())
+            errorf(
+                "prefetch_tiles asked for nonexistant MIP level %d of \"%s\"",
+                miplevel, file->filename());
+        return false;
+    }
+
+    const ImageSpec& spec(file->spec(subimage, miplevel));
+    ROI dataroi = get_roi(spec);
+    roi         = roi.defined() ? roi_intersection(roi, dataroi) : dataroi;
+    if (roi.npixels() == 0)
+        return true;
+
+    // Snap the region to tile boundaries and queue every tile it touches
+    int tw     = spec.tile_width;
+    int th     = spec.tile_height;
+    int td     = std::max(1, spec.tile_depth);
+    int xbegin = spec.x + ((roi.xbegin - spec.x) / tw) * tw;
+    int ybegin = spec.y + ((roi.ybegin - spec.y) / th) * th;
+    int zbegin = spec.z + ((roi.zbegin - spec.z) / td) * td;
+    for (int z = zbegin; z < roi.zend; z += td)
+        for (int y = ybegin; y < roi.yend; y += th)
+            for (int x = xbegin; x < roi.xend; x += tw)
+                queue_prefetch(TileID(*file, subimage, miplevel, x, y, z,
+                                      roi.chbegin, roi.chend),
+                               thread_info, false);
+    return true;
+}
+
+
+
+void
+ImageCacheImpl::record_manifest_tile(const TileID& id)
+{
+    std::lock_guard<std::mutex> lock(m_manifest_mutex);
+    if (!m_recording_manifest)
+        return;
+    m_manifest.push_back({ m_manifest_timer(), id.file().filename(),
+                           id.subimage(), id.miplevel(), id.x(), id.y(),
+                           id.z(), id.chbegin(), id.chend() });
+}
+
+
+
+bool
+ImageCacheImpl::write_manifest()
+{
+    std::vector<ManifestEntry> manifest;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_manifest_mutex);
+        if (!m_recording_manifest)
+            return true;
+        m_recording_manifest = false;
+        std::swap(manifest, m_manifest);
+        path = m_manifest_path;
+    }
+    FILE* f = Filesystem::fopen(path, "w");
+    if (!f) {
+        errorf("Could not open tile manifest \"%s\" for writing", path);
+        return false;
+    }
+    // The entries are already in the order the tiles were read, but a
+    // tile that was evicted and read again is only listed the first time.
+    fprintf(f, "# OpenImageIO tile manifest 1\n");
+    fprintf(f, "# time subimage miplevel x y z chbegin chend filename\n");
+    std::set<std::tuple<const char*, int, int, int, int, int, int, int>> seen;
+    for (auto& e : manifest) {
+        if (!seen.emplace(e.filename.c_str(), e.subimage, e.miplevel, e.x,
+                          e.y, e.z, e.chbegin, e.chend)
+                 .second)
+            continue;
+        fprintf(f, "%.6f %d %d %d %d %d %d %d %s\n", e.time, e.subimage,
+                e.miplevel, e.x, e.y, e.z, e.chbegin, e.chend,
+                e.filename.c_str());
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok) {
+        errorf("Error writing tile manifest \"%s\"", path);
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+ImageCacheImpl::replay_manifest(string_view manifest)
+{
+    std::string text;
+    if (!Filesystem::read_text_file(manifest, text)) {
+        errorf("Could not read tile manifest \"%s\"", manifest);
+        return false;
+    }
+    std::vector<ManifestEntry> entries;
+    for (string_view line : Strutil::splitsv(text, "\n")) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::string s(line);
+        ManifestEntry e;
+        int pos = 0;
+        if (sscanf(s.c_str(), "%lf %d %d %d %d %d %d %d %n", &e.time,
+                   &e.subimage, &e.miplevel, &e.x, &e.y, &e.z, &e.chbegin,
+                   &e.chend, &pos)
+                < 8
+            || !pos || !s[pos]) {
+            errorf("Malformed tile manifest \"%s\": %s", manifest, line);
+            return false;
+        }
+        e.filename = ustring(Strutil::strip(string_view(s).substr(pos)));
+        entries.push_back(e);
+    }
+    // Prefetch in order of when they were first needed, in case the
+    // manifest was assembled from several recordings.
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const ManifestEntry& a, const ManifestEntry& b) {
+                         return a.time < b.time;
+                     });
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    for (auto& e : entries) {
+        // Quietly skip files that aren't there (or aren't the same) any
+        // more. The render will report them if it needs them.
+        ImageCacheFile* file = find_file(e.filename, thread_info);
+        if (!file || file->broken() || file->is_udim() || e.subimage < 0
+            || e.subimage >= file->subimages() || e.miplevel < 0
+            || e.miplevel >= file->miplevels(e.subimage))
+            continue;
+        ROI roi(e.x, e.x + 1, e.y, e.y + 1, e.z, e.z + 1, e.chbegin,
+                e.chend);
+        prefetch_tiles(file, thread_info, e.subimage, e.miplevel, roi);
+    }
+    return true;
+}
+
+
+
 bool
 ImageCacheImpl::add_file(ustring filename, ImageInput::Creator creator,
                          const ImageSpec* config, bool replace)
@@ -3207,6 +6195,10 @@ ImageCacheImpl::add_tile(ustring filename, int subimage, int miplevel, int x,
 void
 ImageCacheImpl::invalidate(ustring filename)
 {
+    // Don't let a prefetch that is still in flight re-insert stale tiles
+    // after we've cleared them.
+    wait_for_prefetch();
+
     ImageCacheFile* file = NULL;
     {
         FilenameMap::iterator fileit = m_files.find(filename);
@@ -3229,6 +6221,7 @@ ImageCacheImpl::invalidate(ustring filename)
     // Safely erase all the tiles we found
     for (const TileID& id : tiles_to_delete)
         m_tilecache.erase(id);
+    clear_compressed_tiles(file);
 
     const ustring fingerprint = file->fingerprint();
 
@@ -3249,6 +6242,12 @@ ImageCacheImpl::invalidate(ustring filename)
 void
 ImageCacheImpl::invalidate_all(bool force)
 {
+    wait_for_prefetch();
+
+    // Files may have come and gone since the directories were listed.
+    if (m_searchpath_ttl > 0.0f)
+        Filesystem::clear_directory_cache();
+
     // Special case: invalidate EVERYTHING -- we can take some shortcuts
     // to do it all in one shot.
     if (force) {
@@ -3260,6 +6259,7 @@ ImageCacheImpl::invalidate_all(bool force)
         }
         for (const TileID& id : tiles_to_delete)
             m_tilecache.erase(id);
+        clear_compressed_tiles(nullptr);
         // Invalidate (close and clear spec) all individual files
         for (FilenameMap::iterator fileit = m_files.begin(), e = m_files.end();
              fileit != e; ++fileit) {
@@ -3358,10 +6358,170 @@ namespace {
     static mutex_pool<spin_rw_mutex, ustring, ustringHash, 8>
         udim_lookup_mutex_pool;
     // static spin_rw_mutex udim_lookup_mutex;
+
+    // Substitute the tile into all the UDIM-like patterns we support.
+    std::string udim_tile_name(string_view pattern, int utile, int vtile)
+    {
+        int udim_tile        = 1001 + utile + 10 * vtile;
+        std::string realname = Strutil::replace(
+            pattern, "<UDIM>", Strutil::sprintf("%04d", udim_tile), true);
+        realname = Strutil::replace(realname, "<u>",
+                                    Strutil::sprintf("u%d", utile), true);
+        realname = Strutil::replace(realname, "<v>",
+                                    Strutil::sprintf("v%d", vtile), true);
+        realname = Strutil::replace(realname, "<U>",
+                                    Strutil::sprintf("u%d", utile + 1), true);
+        realname = Strutil::replace(realname, "<V>",
+                                    Strutil::sprintf("v%d", vtile + 1), true);
+        return realname;
+    }
+
+    // If str starts with prefix, remove it and return true.
+    bool udim_eat(string_view& str, string_view prefix)
+    {
+        if (!Strutil::starts_with(str, prefix))
+            return false;
+        str.remove_prefix(prefix.size());
+        return true;
+    }
+
+    // Parse a non-negative decimal number of exactly ndigits digits, or of
+    // any length if ndigits is 0.
+    bool udim_parse_int(string_view& str, int ndigits, int& val)
+    {
+        size_t n = 0, maxn = ndigits ? size_t(ndigits) : size_t(6);
+        val      = 0;
+        while (n < str.size() && n < maxn && isdigit(str[n]))
+            val = val * 10 + (str[n++] - '0');
+        str.remove_prefix(n);
+        return n > 0 && (!ndigits || n == size_t(ndigits));
+    }
+
+    // If directory entry name matches the UDIM-like pattern, set the tile
+    // coordinates it names and return true.
+    bool udim_match(string_view pattern, string_view name, int& utile,
+                    int& vtile)
+    {
+        utile = vtile = -1;
+        while (pattern.size()) {
+            int u = -1, v = -1, val;
+            if (udim_eat(pattern, "<UDIM>")) {
+                if (!udim_parse_int(name, 4, val) || val < 1001)
+                    return false;
+                u = (val - 1001) % 10;
+                v = (val - 1001) / 10;
+            } else if (udim_eat(pattern, "<u>")) {
+                if (!udim_eat(name, "u") || !udim_parse_int(name, 0, u))
+                    return false;
+            } else if (udim_eat(pattern, "<U>")) {
+                if (!udim_eat(name, "u") || !udim_parse_int(name, 0, u)
+                    || --u < 0)
+                    return false;
+            } else if (udim_eat(pattern, "<v>")) {
+                if (!udim_eat(name, "v") || !udim_parse_int(name, 0, v))
+                    return false;
+            } else if (udim_eat(pattern, "<V>")) {
+                if (!udim_eat(name, "v") || !udim_parse_int(name, 0, v)
+                    || --v < 0)
+                    return false;
+            } else {
+                if (!name.size() || name[0] != pattern[0])
+                    return false;
+                pattern.remove_prefix(1);
+                name.remove_prefix(1);
+                continue;
+            }
+            // Repeated patterns must all name the same tile
+            if ((u >= 0 && utile >= 0 && u != utile)
+                || (v >= 0 && vtile >= 0 && v != vtile))
+                return false;
+            if (u >= 0)
+                utile = u;
+            if (v >= 0)
+                vtile = v;
+        }
+        return name.empty() && utile >= 0 && vtile >= 0;
+    }
 }  // namespace
 
 
 
+const ImageCacheFile::UdimTable*
+ImageCacheImpl::udim_table(ImageCacheFile* udimfile)
+{
+    const ImageCacheFile::UdimTable* table = udimfile->m_udim_table.load(
+        std::memory_order_acquire);
+    if (table)
+        return table;
+
+    // Build it only once, holding the write lock so that other threads
+    // asking for the same file wait for it rather than scanning too.
+    spin_rw_mutex::write_lock_guard wlock(
+        udim_lookup_mutex_pool[udimfile->filename()]);
+    table = udimfile->m_udim_table.load(std::memory_order_acquire);
+    if (table)
+        return table;
+
+    // Gather the tiles, either from the config hint or from the files
+    // matching the pattern in its directory (tried as given, then in each
+    // searchpath directory if it's relative). Tiles that can't go in the
+    // dense table are left to the lazy lookup in resolve_udim.
+    std::vector<std::pair<int, int>> tiles;
+    const ImageSpec* config = udimfile->m_configspec.get();
+    const ParamValue* list  = config ? config->find_attribute("oiio:UDIMTiles")
+                                     : nullptr;
+    const std::string& pattern(udimfile->filename().string());
+    std::string dir  = Filesystem::parent_path(pattern);
+    std::string base = Filesystem::filename(pattern);
+    if (list && list->type().basetype == TypeDesc::INT) {
+        const int* t = (const int*)list->data();
+        for (int i = 0, n = list->nvalues() * list->type().numelements(); i < n;
+             ++i)
+            if (t[i] >= 1001)
+                tiles.emplace_back((t[i] - 1001) % 10, (t[i] - 1001) / 10);
+    } else if (dir.find('<') == std::string::npos) {
+        std::vector<std::string> dirs;
+        dirs.push_back(dir.size() ? dir : std::string("."));
+        if (!Filesystem::path_is_absolute(pattern))
+            for (auto& d : m_searchdirs)
+                dirs.push_back(dir.size() ? d + "/" + dir : d);
+        for (auto& d : dirs) {
+            std::vector<std::string> entries;
+            if (!Filesystem::cached_directory_entries(
+                    d, entries, m_searchpath_ttl, Filesystem::DirEntryFiles))
+                continue;
+            for (auto& e : entries) {
+                int u, v;
+                if (udim_match(base, e, u, v))
+                    tiles.emplace_back(u, v);
+            }
+            break;
+        }
+    }
+
+    std::unique_ptr<ImageCacheFile::UdimTable> newtable(
+        new ImageCacheFile::UdimTable);
+    for (auto& tile : tiles)
+        if (tile.first < 10 && tile.second < 1000)
+            newtable->nvtiles = std::max(newtable->nvtiles, tile.second + 1);
+    newtable->files.resize(10 * newtable->nvtiles, nullptr);
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    for (auto& tile : tiles) {
+        if (tile.first >= 10 || tile.second >= 1000)
+            continue;
+        ImageCacheFile*& f(newtable->files[tile.first + 10 * tile.second]);
+        if (!f)
+            f = find_file(ustring(udim_tile_name(pattern, tile.first,
+                                                 tile.second)),
+                          thread_info);
+    }
+    table = newtable.release();
+    udimfile->m_udim_table.store(table, std::memory_order_release);
+    return table;
+}
+
+
+
 ImageCacheFile*
 ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, float& s, float& t)
 {
@@ -3371,6 +6531,14 @@ ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, float& s, float& t)
     s         = s - utile;
     t         = t - vtile;
 
+    // The common case: the tile is in the dense table, no lock needed.
+    const ImageCacheFile::UdimTable* table = udim_table(udimfile);
+    if (utile < 10 && vtile < table->nvtiles) {
+        ImageCacheFile* realfile = table->files[utile + 10 * vtile];
+        if (realfile)
+            return realfile;
+    }
+
     // Synthesized a single combined ID that we'll use as an index.
     uint64_t id = (uint64_t(vtile) << 32) + uint64_t(utile);
 
@@ -3390,21 +6558,11 @@ ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, float& s, float& t)
     // the first time.
     if (!realfile) {
         // Here's the one spot where we do string manipulation -- only the
-        // first time a particular tiled region is needed. Just go ahead and
-        // do all possible substitutions we support!
-        ustring realname = udimfile->filename();
-        int udim_tile    = 1001 + utile + 10 * vtile;
-        realname         = Strutil::replace(realname, "<UDIM>",
-                                    Strutil::sprintf("%04d", udim_tile), true);
-        realname         = Strutil::replace(realname, "<u>",
-                                    Strutil::sprintf("u%d", utile), true);
-        realname         = Strutil::replace(realname, "<v>",
-                                    Strutil::sprintf("v%d", vtile), true);
-        realname         = Strutil::replace(realname, "<U>",
-                                    Strutil::sprintf("u%d", utile + 1), true);
-        realname         = Strutil::replace(realname, "<V>",
-                                    Strutil::sprintf("v%d", vtile + 1), true);
-        realfile         = find_file(realname, get_perthread_info());
+        // first time a particular tiled region, that the directory scan
+        // didn't find, is needed.
+        ustring realname(
+            udim_tile_name(udimfile->filename(), utile, vtile));
+        realfile = find_file(realname, get_perthread_info());
         // Now grab the actual write lock, and double check that it hasn't
         // been added by another thread during the brief time when we
         // weren't holding any lock.
@@ -3462,9 +6620,8 @@ ImageCacheImpl::get_perthread_info(ImageCachePerThreadInfo* p)
     if (p->purge) {  // has somebody requested a tile purge?
         // This is safe, because it's our thread.
         spin_lock lock(m_perthread_info_mutex);
-        p->tile     = NULL;
-        p->lasttile = NULL;
-        p->purge    = 0;
+        p->clear_microcache();
+        p->purge = 0;
         for (int i = 0; i < ImageCachePerThreadInfo::nlastfile; ++i) {
             p->last_filename[i] = ustring();
             p->last_file[i]     = NULL;
@@ -3483,8 +6640,7 @@ ImageCacheImpl::erase_perthread_info()
         ImageCachePerThreadInfo* p = m_all_perthread_info[i];
         if (p) {
             // Clear the microcache.
-            p->tile     = NULL;
-            p->lasttile = NULL;
+            p->clear_microcache();
             if (p->shared) {
                 // Pointed to by both thread-specific-ptr and our list.
                 // Just remove from out list, then ownership is only
@@ -3507,8 +6663,7 @@ ImageCacheImpl::cleanup_perthread_info(ImageCachePerThreadInfo* p)
     spin_lock lock(m_perthread_info_mutex);
     if (p) {
         // Clear the microcache.
-        p->tile     = NULL;
-        p->lasttile = NULL;
+        p->clear_microcache();
         if (!p->shared)  // If we own it, delete it
             delete p;
         else
@@ -3530,34 +6685,48 @@ ImageCacheImpl::purge_perthread_microcaches()
 
 
 
+void
+ErrorRecord::append(std::string message)
+{
+    if (m_messages.size() < max_messages)
+        m_messages.push_back(std::move(message));
+    else
+        ++m_dropped;
+}
+
+
+
 std::string
-ImageCacheImpl::geterror() const
+ErrorRecord::get()
 {
-    std::string e;
-    std::string* errptr = m_errormessage.get();
-    if (errptr) {
-        e = *errptr;
-        errptr->clear();
-    }
+    std::string e = Strutil::join(m_messages, "\n");
+    if (m_dropped)
+        e += Strutil::sprintf("\n(%d more errors not recorded)", m_dropped);
+    m_messages.clear();
+    m_dropped = 0;
     return e;
 }
 
 
 
+std::string
+ImageCacheImpl::geterror() const
+{
+    ErrorRecord* errors = m_errors.get();
+    return errors ? errors->get() : std::string();
+}
+
+
+
 void
 ImageCacheImpl::append_error(const std::string& message) const
 {
-    std::string* errptr = m_errormessage.get();
-    if (!errptr) {
-        errptr = new std::string;
-        m_errormessage.reset(errptr);
-    }
-    ASSERT(errptr != NULL);
-    ASSERT(errptr->size() < 1024 * 1024 * 16
-           && "Accumulated error messages > 16MB. Try checking return codes!");
-    if (errptr->size())
-        *errptr += '\n';
-    *errptr += message;
+    ErrorRecord* errors = m_errors.get();
+    if (!errors) {
+        errors = new ErrorRecord;
+        m_errors.reset(errors);
+    }
+    errors->append(message);
 }
 
 
@@ -36,6 +36,8 @@
 #ifndef OPENIMAGEIO_IMAGECACHE_PVT_H
 #define OPENIMAGEIO_IMAGECACHE_PVT_H
 
+#include <deque>
+
 #include <tsl/robin_map.h>
 
 #include <boost/container/flat_map.hpp>
@@ -44,6 +46,7 @@
 
 #include <OpenEXR/half.h>
 
+#include <OpenImageIO/color.h>
 #include <OpenImageIO/export.h>
 #include <OpenImageIO/hash.h>
 #include <OpenImageIO/imagebuf.h>
@@ -69,11 +72,45 @@ namespace pvt {
 
 #define FILE_CACHE_SHARDS 64
 #define TILE_CACHE_SHARDS 128
+#define MAX_NUMA_NODES 8
 
 using boost::thread_specific_ptr;
 
 class ImageCacheImpl;
 class ImageCachePerThreadInfo;
+class ImageCacheTile;
+class SharedTileStore;
+
+/// Reference-counted pointer to a ImageCacheTile
+///
+typedef intrusive_ptr<ImageCacheTile> ImageCacheTileRef;
+
+
+
+/// Summed-area table of one MIP level of a subimage, which lets
+/// MipModeSummedArea average any axis-aligned box of texels in constant
+/// time. sums[(y*(width+1)+x)*nchannels+c] is the sum of channel c over
+/// the texels [0,x) x [0,y) of the level's data window, so the first row
+/// and column are zero. Sums are kept in double so that differences of
+/// nearby entries stay accurate even for large levels.
+struct SummedAreaTable {
+    int miplevel  = 0;
+    int width     = 0;
+    int height    = 0;
+    int nchannels = 0;
+    std::vector<double> sums;
+
+    const double* at(int x, int y) const
+    {
+        return &sums[(size_t(y) * (width + 1) + x) * nchannels];
+    }
+    double* at(int x, int y)
+    {
+        return &sums[(size_t(y) * (width + 1) + x) * nchannels];
+    }
+};
+class MappedImageFile;
+class TileID;
 
 const char*
 texture_format_name(TexFormat f);
@@ -97,10 +134,46 @@ struct ImageCacheStatistics {
     // First, the ImageCache-specific fields:
     long long find_tile_calls;
     long long find_tile_microcache_misses;
+    long long find_tile_pinned_hits;  // microcache misses on a pinned tile
     int find_tile_cache_misses;
     long long files_totalsize;
     long long files_totalsize_ondisk;
     long long bytes_read;
+    long long prefetch_requests;  // tiles queued for background reading
+    long long prefetch_tiles;     // tiles read by the prefetch threads
+    long long compressed_tiles_stored;  // evicted tiles kept compressed
+    long long compressed_tile_hits;     // tiles restored from compressed
+    long long disk_cache_hits;          // tiles read from the disk cache
+    long long disk_cache_writes;        // tiles queued for the disk cache
+    long long shared_tile_hits;         // tiles found in shared memory
+    long long shared_tile_stores;       // tiles put in shared memory
+    long long mapped_tiles;             // tiles used in place from mmap
+    long long untiled_band_reuses;      // untiled bands sliced, not re-read
+    long long automip_builds;           // automip pyramids built at once
+    long long automip_tiles;            // automip tiles copied from them
+    // Main cache hits in "numa" mode, by the NUMA node of the thread:
+    long long numa_local_hits[MAX_NUMA_NODES];    // tile on the same node
+    long long numa_remote_hits[MAX_NUMA_NODES];   // tile on another node
+    long long numa_replica_hits[MAX_NUMA_NODES];  // used a local replica
+    long long numa_replicas;                      // replicas made
+    long long tiles_evicted;  // tiles evicted from the main cache
+    // Main cache lookups (those that got past the microcache), by bin
+    long long shard_hits[TILE_CACHE_SHARDS];
+    long long shard_misses[TILE_CACHE_SHARDS];
+    // Histograms of tile read times, and of waits for other threads'
+    // tile reads: bucket i counts the times under 2^i microseconds, and
+    // the last bucket all the longer ones.
+    static const int time_hist_buckets = 24;
+    long long read_time_hist[time_hist_buckets];
+    long long wait_time_hist[time_hist_buckets];
+    static int time_hist_bucket(double seconds)
+    {
+        double us = seconds * 1.0e6;
+        int b     = 0;
+        while (b < time_hist_buckets - 1 && us >= double(1 << b))
+            ++b;
+        return b;
+    }
     // These stats are hard to deal with on a per-thread basis, so for
     // now, they are still atomics shared by the whole IC.
     // int tiles_created;
@@ -112,8 +185,12 @@ struct ImageCacheStatistics {
     int unique_files;
     double fileio_time;
     double fileopen_time;
+    long long file_reopens;   // files reopened after their handle closed
+    double file_reopen_time;  // time spent reopening them
     double file_locking_time;
     double tile_locking_time;
+    double tile_wait_time;  // waiting for other threads' tile reads
+    long long tile_coalesced_misses;  // misses that waited for such a read
     double find_file_time;
     double find_tile_time;
 
@@ -129,6 +206,9 @@ struct ImageCacheStatistics {
     long long aniso_queries;
     long long aniso_probes;
     float max_aniso;
+    long long ewa_texels;
+    long long sat_queries;
+    long long empty_tile_skips;
     long long closest_interps;
     long long bilinear_interps;
     long long cubic_interps;
@@ -142,6 +222,29 @@ struct ImageCacheStatistics {
 
 
 
+/// The cost of the texture lookups attributed to one tag (see
+/// TextureSystem::set_cost_tag).
+struct TextureCostStats {
+    long long lookups      = 0;  ///< Lookups (active lanes, for batches)
+    long long texels       = 0;  ///< Estimate of the texels fetched
+    long long tile_lookups = 0;  ///< Tiles looked up (find_tile calls)
+    long long tile_misses  = 0;  ///< Tiles not found in the main cache
+    double seconds         = 0;  ///< Time spent in the lookups
+
+    void merge(const TextureCostStats& s)
+    {
+        lookups += s.lookups;
+        texels += s.texels;
+        tile_lookups += s.tile_lookups;
+        tile_misses += s.tile_misses;
+        seconds += s.seconds;
+    }
+};
+
+typedef std::vector<std::pair<ustring, TextureCostStats>> TextureCostTags;
+
+
+
 /// Unique in-memory record for each image file on disk.  Note that
 /// this class is not in and of itself thread-safe.  It's critical that
 /// any calling routine use a mutex any time a ImageCacheFile's methods are
@@ -233,6 +336,15 @@ public:
     size_t tilesread() const { return m_tilesread; }
     imagesize_t bytesread() const { return m_bytesread; }
     double& iotime() { return m_iotime; }
+
+    /// Count one read_tile or read_tiles call on this file that took the
+    /// given time, in its histogram of read times and in the thread's.
+    void note_read_time(ImageCachePerThreadInfo* thread_info,
+                        double seconds);
+    /// Number of reads in bucket b of ImageCacheStatistics::
+    /// time_hist_bucket, and the longest any one read took.
+    long long read_time_hist(int b) const { return m_read_time_hist[b]; }
+    double max_read_time() const { return m_max_read_time_us * 1.0e-6; }
     size_t redundant_tiles() const { return (size_t)m_redundant_tiles.load(); }
     imagesize_t redundant_bytesread() const
     {
@@ -253,6 +365,13 @@ public:
     // success, false on failure.
     bool get_average_color(float* avg, int subimage, int chbegin, int chend);
 
+    // Decode, into the specs of every subimage and level, any Exif, XMP,
+    // and IPTC blocks that the reader left undecoded because the file was
+    // opened with the "lazy" metadata hint. It's cheap after the first
+    // call, so it's done before any spec is handed out or searched for
+    // arbitrary metadata.
+    void decode_metadata();
+
     /// Info for each MIP level that isn't in the ImageSpec, or that we
     /// precompute.
     struct LevelInfo {
@@ -264,16 +383,75 @@ public:
         mutable std::vector<float> polecolor;  ///< Pole colors
         int nxtiles, nytiles, nztiles;  ///< Number of tiles in each dimension
         atomic_ll* tiles_read;  ///< Bitfield for tiles read at least once
+        atomic_ll* tiles_needed;  ///< Bitfield for tiles texture lookups
+                                  ///<   needed (in "feedback" mode)
+        atomic_ll* tiles_empty;   ///< Bitfield for tiles found to hold
+                                  ///<   nothing but the background value
+        /// For onetile levels, the tile (holding a reference and a pin),
+        /// once it has been read, so lookups can skip the main cache. Set
+        /// at most once, released by ImageCacheFile::unpin_tiles().
+        std::atomic<ImageCacheTile*> pinned_tile;
+        /// The tiles that the file's "oiio:ConstantTiles" metadata says
+        /// hold a single value: for each tile, the index in
+        /// constant_values of the first channel of its value, or -1.
+        /// Empty if the file doesn't say.
+        std::vector<int> constant_tile;
+        std::vector<float> constant_values;
         LevelInfo(const ImageSpec& spec,
                   const ImageSpec& nativespec);  ///< Initialize based on spec
         LevelInfo(const LevelInfo& src);         // needed for vector<LevelInfo>
-        ~LevelInfo() { delete[] tiles_read; }
+        ~LevelInfo()
+        {
+            delete[] tiles_read;
+            delete[] tiles_needed;
+            delete[] tiles_empty;
+        }
+        /// Number of 64-bit words in each of the tile bitfields
+        int tilebits_words() const
+        {
+            return round_to_multiple(nxtiles * nytiles * nztiles, 64) / 64;
+        }
+        /// Index (into the bitfields) of the tile whose origin is (x,y,z)
+        int tile_index(int x, int y, int z) const
+        {
+            return ((x - spec.x) / spec.tile_width)
+                   + ((y - spec.y) / spec.tile_height) * nxtiles
+                   + ((z - spec.z) / spec.tile_depth) * (nxtiles * nytiles);
+        }
+        /// Record that a lookup needed the tile whose origin is (x,y,z).
+        /// Only the first time pays for the atomic update.
+        void mark_needed(int x, int y, int z)
+        {
+            int whichtile   = tile_index(x, y, z);
+            int64_t bitmask = int64_t(1ULL << (whichtile & 63));
+            atomic_ll& word(tiles_needed[whichtile / 64]);
+            if (!(word.load(std::memory_order_relaxed) & bitmask))
+                word.fetch_or(bitmask);
+        }
+        /// Record that the tile whose origin is (x,y,z) holds only the
+        /// subimage's background value.
+        void mark_empty(int x, int y, int z)
+        {
+            int whichtile = tile_index(x, y, z);
+            tiles_empty[whichtile / 64].fetch_or(
+                int64_t(1ULL << (whichtile & 63)));
+        }
+        /// Is the tile whose origin is (x,y,z) known to be empty?
+        bool tile_empty(int x, int y, int z) const
+        {
+            int whichtile = tile_index(x, y, z);
+            return tiles_empty[whichtile / 64].load(std::memory_order_relaxed)
+                   & int64_t(1ULL << (whichtile & 63));
+        }
     };
 
     /// Info for each subimage
     ///
     struct SubimageInfo {
         std::vector<LevelInfo> levels;  ///< Extra per-level info
+        /// min(width,height) of each level, compactly, for choosing the
+        /// MIP levels of a lookup without touching the level specs.
+        std::vector<float> minres;
         TypeDesc datatype;              ///< Type of pixels we store internally
         unsigned int channelsize = 0;   ///< Channel size, in bytes
         unsigned int pixelsize   = 0;   ///< Pixel size, in bytes
@@ -286,6 +464,10 @@ public:
         bool has_average_color = false;    ///< We have an average color
         std::vector<float> average_color;  ///< Average color
         spin_mutex average_color_mutex;    ///< protect average_color
+        /// One pixel (in datatype) of the value that sparse volumes hold
+        /// outside their active regions, from the "oiio:background"
+        /// metadata, or empty if the file doesn't declare one.
+        std::vector<char> background;
         std::unique_ptr<Imath::M44f> Mlocal;  ///< shadows/volumes: world-to-local
         // The scale/offset accounts for crops or overscans, converting
         // 0-1 texture space relative to the "display/full window" into
@@ -293,6 +475,15 @@ public:
         float sscale = 1.0f, soffset = 0.0f;
         float tscale = 1.0f, toffset = 0.0f;
         ustring subimagename;
+        // automip: all of the coarser levels (MIP level m at [m-1]), once
+        // they have been built in the background.
+        std::shared_ptr<const std::vector<ImageBuf>> automip_levels;
+        bool automip_queued = false;  ///< Build has been started
+        spin_mutex automip_mutex;     ///< protect automip_levels/queued
+        // Summed-area table for MipModeSummedArea, built on first use.
+        std::shared_ptr<const SummedAreaTable> sat;
+        bool sat_building = false;  ///< Build started (or has failed)
+        spin_mutex sat_mutex;       ///< protect sat/sat_building
 
         SubimageInfo() {}
         void init(ImageCacheFile& icfile, const ImageSpec& spec,
@@ -326,6 +517,13 @@ public:
         return m_subimages[subimage].levels[miplevel];
     }
 
+    /// The ColorProcessor applied to the pixels as they're read from the
+    /// file, if its "oiio:TargetColorSpace" hint asked for one, else NULL.
+    const ColorProcessor* colorprocessor() const
+    {
+        return m_colorprocessor.get();
+    }
+
     /// Do we currently have a valid spec?
     bool validspec() const
     {
@@ -338,9 +536,23 @@ public:
     void invalidate_spec()
     {
         m_validspec = false;
+        unpin_tiles();
         m_subimages.clear();
     }
 
+    /// Release the pinned tiles of all the onetile levels, and all the
+    /// pins recorded by add_pinned_tile().
+    void unpin_tiles();
+
+    /// Record a pin just taken on tile (by ImageCacheImpl::pin_levels, or
+    /// by the pin_mip_tail policy if automatic), holding a reference until
+    /// unpin_levels() or unpin_tiles() gives the pin back.
+    void add_pinned_tile(const ImageCacheTileRef& tile, bool automatic);
+
+    /// Give back the recorded pins on tiles of MIP levels
+    /// [miplevel_begin,miplevel_end) of the subimage.
+    void unpin_levels(int subimage, int miplevel_begin, int miplevel_end);
+
     /// Should we print an error message? Keeps track of whether the
     /// number of errors so far, including this one, is a above the limit
     /// set for errors to print for each file.
@@ -367,6 +579,11 @@ private:
         // access directly. ALWAYS retrieve its value with get_imageinput
         // (it's thread-safe to use that result) and set its value with
         // get_imageinput -- those are guaranteed thread-safe.
+    std::vector<std::shared_ptr<ImageInput>> m_input_pool;
+        ///< Extra ImageInputs so that tile reads of a hot file need not
+        // all serialize on m_input's internal mutex. Guarded by
+        // m_input_pool_mutex; never includes m_input itself.
+    spin_mutex m_input_pool_mutex;  ///< Protects m_input_pool
     std::vector<SubimageInfo> m_subimages;  ///< Info on each subimage
     TexFormat m_texformat;                  ///< Which texture format
     TextureOpt::Wrap m_swrap;               ///< Default wrap modes
@@ -383,10 +600,12 @@ private:
     atomic_ll m_redundant_bytesread;     ///< Redundant bytes read
     size_t m_timesopened;                ///< Separate times we opened this file
     double m_iotime;                     ///< I/O time for this file
+    atomic_ll m_read_time_hist[ImageCacheStatistics::time_hist_buckets];
+    atomic_ll m_max_read_time_us;        ///< Longest single read
     double m_mutex_wait_time;            ///< Wait time for m_input_mutex
     bool m_mipused;                      ///< MIP level >0 accessed
     volatile bool m_validspec;           ///< If false, reread spec upon open
-    mutable int m_errors_issued;         ///< Errors issued for this file
+    mutable atomic_int m_errors_issued;  ///< Errors issued for this file
     std::vector<size_t> m_mipreadcount;  ///< Tile reads per mip level
     ImageCacheImpl& m_imagecache;        ///< Back pointer for ImageCache
     mutable recursive_mutex m_input_mutex;  ///< Mutex protecting the ImageInput
@@ -397,8 +616,47 @@ private:
     imagesize_t m_total_imagesize_ondisk;  ///< Total size, compressed on disk
     ImageInput::Creator m_inputcreator;    ///< Custom ImageInput-creator
     std::unique_ptr<ImageSpec> m_configspec;  // Optional configuration hints
+    ColorProcessorHandle m_colorprocessor;  ///< Converts pixels as read
+    std::atomic<bool> m_metadata_decoded { false };  ///< Lazy blocks decoded?
+    spin_mutex m_metadata_mutex;  ///< Protects decode_metadata()
     UdimLookupMap m_udim_lookup;              ///< Used for decoding udim tiles
                                               // protected by mutex elsewhere!
+    /// Dense table of the UDIM tiles found by scanning the directory once
+    /// (or listed in the "oiio:UDIMTiles" config hint): files[u+10*v] is
+    /// the concrete file of tile (u,v), or NULL if it wasn't found. It is
+    /// never changed once published, so it is read without any lock;
+    /// tiles it doesn't have fall back to m_udim_lookup.
+    struct UdimTable {
+        int nvtiles = 0;
+        std::vector<ImageCacheFile*> files;
+    };
+    std::atomic<const UdimTable*> m_udim_table { nullptr };
+
+    /// Pins taken by pin_levels() or the pin_mip_tail policy (one entry
+    /// per pin, so a tile may appear more than once).
+    struct PinnedTile {
+        ImageCacheTileRef tile;
+        bool automatic;
+    };
+    std::vector<PinnedTile> m_pinned_tiles;
+    spin_mutex m_pinned_tiles_mutex;  ///< Protects m_pinned_tiles
+    std::shared_ptr<MappedImageFile> m_mapped;  ///< Mapping for mmap_tiles
+    bool m_map_failed { false };  ///< Don't try to map it again
+    spin_mutex m_mapped_mutex;    ///< Protects m_mapped, m_map_failed
+
+    /// The most recent band of scanlines read from this (untiled,
+    /// auto-tiled) file, kept until the file is closed so that the other
+    /// tiles of the band can be sliced from it rather than re-read and
+    /// re-decoded.
+    struct UntiledBand {
+        int subimage = -1, miplevel = -1, ybegin = 0, z = 0;
+        int chbegin = 0, chend = 0;
+        TypeDesc format;
+        std::shared_ptr<char> pixels;
+    };
+    UntiledBand m_band;
+    spin_mutex m_band_mutex;       ///< Protects m_band
+    std::mutex m_band_read_mutex;  ///< Held while reading a band
 
     /// Thread-safe retrieve a shared pointer to the ImageInput. The one
     /// returned is safe to use as long as the caller is holding the
@@ -417,6 +675,39 @@ private:
     /// requires no external lock.
     std::shared_ptr<ImageInput> open(ImageCachePerThreadInfo* thread_info);
 
+    /// Return one of the file's ImageInputs, locked for the caller's
+    /// exclusive use (the caller must unlock() it when done). Prefer inp
+    /// (the primary, from open()) if it's free, then an idle one from the
+    /// pool, then a newly opened one if the pool may still grow (per the
+    /// "max_inputs_per_file" and "max_open_files" attributes); only if
+    /// none of that works, wait for inp.
+    std::shared_ptr<ImageInput>
+    acquire_input(ImageCachePerThreadInfo* thread_info,
+                  const std::shared_ptr<ImageInput>& inp);
+
+    /// Open an additional ImageInput for this already-opened file, for
+    /// the input pool. Return an empty pointer on failure.
+    std::shared_ptr<ImageInput> open_pooled_input();
+
+public:
+    /// If "mmap_tiles" is enabled and the tile id is stored in the file
+    /// exactly as the cache would hold it, return a pointer to its pixels
+    /// within a memory mapping of the file, and set mapping to keep that
+    /// mapping alive for as long as the pixels are used. Otherwise return
+    /// NULL.
+    const char* mapped_tile(ImageCachePerThreadInfo* thread_info,
+                            const TileID& id,
+                            std::shared_ptr<MappedImageFile>& mapping);
+
+    /// If the file is a sparse volume (it declares a background value)
+    /// and its reader can tell, without decoding, that tile id holds one
+    /// value throughout, store that pixel (channels id.chbegin() to
+    /// id.chend(), in the subimage's datatype) in pixel and return true.
+    bool constant_tile(ImageCachePerThreadInfo* thread_info, const TileID& id,
+                       void* pixel);
+
+private:
+
     /// Release the ImageInput, if currently open. It will close and destroy
     /// when the last thread holding it is done with its shared ptr. This
     /// is thread-safe, no need to hold a lock to call it. It will close the
@@ -424,6 +715,14 @@ private:
     /// is a valid descriptor of the image file.
     void close(void);
 
+public:
+    /// Read a horizontal run of ordinary (not emulated) tiles of the file,
+    /// from x=xbegin (a tile origin) to xend, in one call, into data.
+    bool read_tiles(ImageCachePerThreadInfo* thread_info, int subimage,
+                    int miplevel, int xbegin, int xend, int y, int z,
+                    int chbegin, int chend, TypeDesc format, void* data);
+
+private:
     /// Load the requested tile, from a file that's not really tiled.
     /// Preconditions: the ImageInput is already opened, and we already did
     /// a seek_subimage to the right subimage and MIP level.
@@ -431,6 +730,13 @@ private:
                       int subimage, int miplevel, int x, int y, int z,
                       int chbegin, int chend, TypeDesc format, void* data);
 
+    /// Apply colorprocessor() to pixels just read from the file (channels
+    /// chbegin..chend-1 of the subimage, in format, with the given size
+    /// and strides), while they're still in cache.
+    void convert_color(int subimage, int chbegin, int chend, TypeDesc format,
+                       void* data, int width, int height, int depth,
+                       stride_t xstride, stride_t ystride, stride_t zstride);
+
     /// Load the requested tile, from a file that's not really MIPmapped.
     /// Preconditions: the ImageInput is already opened, and we already did
     /// a seek_subimage to the right subimage.
@@ -438,6 +744,14 @@ private:
                        int subimage, int miplevel, int x, int y, int z,
                        int chbegin, int chend, TypeDesc format, void* data);
 
+    /// Build all the emulated MIP levels of an unmipped subimage at once
+    /// from its full-resolution pixels, so that read_unmipped can copy
+    /// their tiles rather than resample the finer levels tile by tile.
+    /// If the "automip_sidecar" option is on, also save them to the
+    /// sidecar file.
+    void build_automip_levels(ImageCachePerThreadInfo* thread_info,
+                              int subimage);
+
     // Initialize a bunch of fields based on the ImageSpec.
     // FIXME -- this is actually deeply flawed, many of these things only
     // make sense if they are per subimage, not one value for the whole
@@ -621,6 +935,13 @@ public:
     /// that constructed the tile.
     void read(ImageCachePerThreadInfo* thread_info);
 
+    /// Instead of read(), take the pixels from pels (with the given
+    /// scanline and plane strides), where they were put by a read of
+    /// several tiles at once, or mark the tile invalid if !ok. Like read(),
+    /// only for the thread that constructed the tile.
+    void read_from(const void* pels, stride_t ystride, stride_t zstride,
+                   bool ok);
+
     /// Return pointer to the raw pixel data
     const void* data(void) const { return &m_pixels[0]; }
 
@@ -664,12 +985,16 @@ public:
     ///
     void use() { m_used = 1; }
 
+    /// Mark the tile as not yet used, so that only a later reference
+    /// counts as a use (the segmented policy's starting state).
+    void clear_used() { m_used = 0; }
+
     /// Mark the tile as not recently used, return its previous value.
     ///
     bool release()
     {
-        if (!pixels_ready() || !valid())
-            return true;  // Don't really release invalid or unready tiles
+        if (!pixels_ready() || !valid() || pinned())
+            return true;  // Don't release invalid, unready or pinned tiles
         // If m_used is 1, set it to zero and return true.  If it was already
         // zero, it's fine and return false.
         int one = 1;
@@ -680,38 +1005,114 @@ public:
     ///
     int used(void) const { return m_used; }
 
+    /// Pin the tile, so that eviction passes it by.  Pins nest.  Return
+    /// true if the tile was not pinned before.
+    bool pin() { return m_pins++ == 0; }
+
+    /// Pin the tile only if nobody has yet; return true if we did.
+    bool pin_if_unpinned()
+    {
+        int zero = 0;
+        return m_pins.compare_exchange_strong(zero, 1);
+    }
+
+    /// Give back one pin, return true if it was the last one.
+    bool unpin() { return --m_pins == 0; }
+
+    /// Is the tile pinned?
+    bool pinned() const { return m_pins > 0; }
+
+    /// Segments of the "segmented" tile eviction policy. New tiles start
+    /// out Fresh and unused; the first sweep that sees them referenced
+    /// since they were added moves them to Probation, and being referenced
+    /// again after that earns a place in Protected. Only Fresh and
+    /// Probation tiles are evicted.
+    enum Segment { Fresh = 0, Probation, Protected };
+
+    /// Retrieve or set the eviction segment. These are only called by the
+    /// sweep, while it holds the lock on the tile cache bin of this tile.
+    int segment() const { return m_segment; }
+    void segment(int s) { m_segment = (unsigned char)s; }
+
     bool valid(void) const { return m_valid; }
 
     /// Are the pixels ready for use?  If false, they're still being
     /// read from disk.
     bool pixels_ready() const { return m_pixels_ready; }
 
-    /// Spin until the pixels have been read and are ready for use.
-    ///
-    void wait_pixels_ready() const;
+    /// Wait until the pixels have been read and are ready for use,
+    /// spinning briefly but then sleeping until whoever is reading them
+    /// is done. If thread_info is supplied, a wait gets counted in its
+    /// tile_wait_time and tile_coalesced_misses stats.
+    void wait_pixels_ready(ImageCachePerThreadInfo* thread_info = NULL) const;
 
     int channelsize() const { return m_channelsize; }
     int pixelsize() const { return m_pixelsize; }
 
+    /// Are the pixels used in place from a memory-mapped file?
+    bool mapped() const { return m_mapping != nullptr; }
+
+    /// Are the pixels used in place from the shared tile store?
+    bool shared() const { return m_shared != nullptr; }
+
+    /// The NUMA node of the thread that read (and thus first touched)
+    /// the pixels, or -1 if not known.
+    int numa_node() const { return m_numa_node; }
+    void numa_node(int node) { m_numa_node = (signed char)node; }
+
+    /// Count a main cache hit on this tile by a thread on another NUMA
+    /// node, and return how many there have been.
+    int remote_hit() { return ++m_remote_hits; }
+
+    /// Return the copy of this tile local to the given NUMA node, or
+    /// NULL if there isn't one.
+    intrusive_ptr<ImageCacheTile> replica(int node);
+
+    /// Keep r as the copy of this tile local to the node, unless another
+    /// thread beat us to it. Return the one that is kept.
+    intrusive_ptr<ImageCacheTile>
+    add_replica(int node, const intrusive_ptr<ImageCacheTile>& r);
+
 private:
     TileID m_id;                       ///< ID of this tile
     std::unique_ptr<char[]> m_pixels;  ///< The pixel data
+    std::shared_ptr<MappedImageFile> m_mapping;  ///< Keeps mapped pixels valid
+    std::shared_ptr<char> m_constant;  ///< Keeps shared constant pixels valid
+    std::shared_ptr<SharedTileStore> m_shared;  ///< Store pinned for pixels
     size_t m_pixels_size { 0 };        ///< How much m_pixels has allocated
     int m_channelsize { 0 };           ///< How big is each channel (bytes)
     int m_pixelsize { 0 };             ///< How big is each pixel (bytes)
     bool m_valid { false };            ///< Valid pixels
     bool m_nofree { false };  ///< We do NOT own the pixels, do not free!
-    volatile bool m_pixels_ready {
+    std::atomic<bool> m_pixels_ready {
         false
     };                        ///< The pixels have been read from disk
-    atomic_int m_used { 1 };  ///< Used recently
-};
 
-
-
-/// Reference-counted pointer to a ImageCacheTile
-///
-typedef intrusive_ptr<ImageCacheTile> ImageCacheTileRef;
+    /// Set m_pixels_ready, and wake any threads sleeping in
+    /// wait_pixels_ready for it.
+    void mark_pixels_ready();
+
+    /// If the subimage declares a background value and every pixel of
+    /// this (valid) tile holds it, mark the tile empty in its LevelInfo.
+    void check_empty();
+
+    /// Allocate m_pixels to hold size bytes, from the IC's tile pool if
+    /// we can.
+    void alloc_pixels(size_t size);
+
+    /// If the store has this tile (whose pixels, padding included, take
+    /// size bytes), pin it and use its pixels in place, and return true.
+    bool use_shared(const std::shared_ptr<SharedTileStore>& store,
+                    string_view key, size_t size);
+    bool m_pooled { false };  ///< m_pixels came from the tile pool
+    atomic_int m_used { 1 };            ///< Used recently
+    atomic_int m_pins { 0 };            ///< Number of pins held
+    unsigned char m_segment { Fresh };  ///< Eviction segment
+    signed char m_numa_node { -1 };     ///< NUMA node holding the pixels
+    atomic_int m_remote_hits { 0 };     ///< Hits from other NUMA nodes
+    std::unique_ptr<intrusive_ptr<ImageCacheTile>[]> m_replicas;  ///< By node
+    spin_mutex m_replicas_mutex;  ///< Protects m_replicas
+};
 
 
 
@@ -730,19 +1131,36 @@ typedef unordered_map_concurrent<
 /// even if you are using only ImageCache but not TextureSystem.
 class ImageCachePerThreadInfo {
 public:
-    // Store just a few filename/fileptr pairs
-    static const int nlastfile = 4;
+    // Store a few dozen filename/fileptr pairs, direct-mapped by the
+    // filename's hash, so that a shader that uses a lot of textures by
+    // name rarely has to look at the shared file table.
+    static const int nlastfile = 64;
     ustring last_filename[nlastfile];
     ImageCacheFile* last_file[nlastfile];
-    int next_last_file;
-    // We have a two-tile "microcache", storing the last two tiles needed.
-    ImageCacheTileRef tile, lasttile;
+    // We have a small "microcache", storing the last few tiles needed
+    // (as many as the "microcache_size" attribute says): tile is the one
+    // most recently found, lasttile[] holds the others.
+    static const int max_microcache = 16;
+    ImageCacheTileRef tile;
+    ImageCacheTileRef lasttile[max_microcache - 1];
+    int next_lasttile;  // Which lasttile to replace next
+    int numa_node;      // NUMA node we last ran on, in "numa" mode
     atomic_int purge;  // If set, tile ptrs need purging!
     ImageCacheStatistics m_stats;
     bool shared;  // Pointed to both by the IC and the thread_specific_ptr
+    // Cost attribution (TextureSystem::set_cost_tag): this thread's
+    // totals per tag, the index of the current tag among them (-1 for
+    // none), and whether a tagged lookup is under way (so the lookups it
+    // makes on its own behalf aren't counted twice). Tags are only added
+    // while holding cost_tags_mutex, which merging also takes.
+    TextureCostTags cost_tags;
+    int cost_tag          = -1;
+    bool in_tagged_lookup = false;
+    mutable spin_mutex cost_tags_mutex;
 
     ImageCachePerThreadInfo()
-        : next_last_file(0)
+        : next_lasttile(0)
+        , numa_node(-1)
         , shared(false)
     {
         // std::cout << "Creating PerThreadInfo " << (void*)this << "\n";
@@ -756,23 +1174,265 @@ public:
         // std::cout << "Destroying PerThreadInfo " << (void*)this << "\n";
     }
 
+    // Release all the tiles held by the tile microcache
+    void clear_microcache()
+    {
+        tile = NULL;
+        for (auto& t : lasttile)
+            t = NULL;
+        next_lasttile = 0;
+    }
+
     // Add a new filename/fileptr pair to our microcache
     void filename(ustring n, ImageCacheFile* f)
     {
-        last_filename[next_last_file] = n;
-        last_file[next_last_file]     = f;
-        ++next_last_file;
-        next_last_file %= nlastfile;
+        int i            = int(n.hash() & (nlastfile - 1));
+        last_filename[i] = n;
+        last_file[i]     = f;
     }
 
     // See if a filename has a fileptr in the microcache
     ImageCacheFile* find_file(ustring n) const
     {
-        for (int i = 0; i < nlastfile; ++i)
-            if (last_filename[i] == n)
-                return last_file[i];
-        return NULL;
+        int i = int(n.hash() & (nlastfile - 1));
+        return last_filename[i] == n ? last_file[i] : NULL;
+    }
+};
+
+
+
+/// Index of the ImageCache's file table that can be searched without any
+/// locking, keyed on the filename ustring's characters (which are unique
+/// for each distinct string). It relies on files never being removed
+/// from the file table, only added to it. It's an open-addressed hash
+/// table that writers (serialized among themselves) fill in place, and
+/// replace with a copy twice the size when it gets half full; replaced
+/// tables are kept until the index is destroyed, since readers may still
+/// be looking at them, and together never take more than the last one.
+class FileIndex {
+public:
+    FileIndex();
+    ~FileIndex();
+
+    /// Find the named file, or return NULL if it isn't in the index.
+    ImageCacheFile* find(ustring filename) const;
+    /// Add a file (if not already present).
+    void insert(ustring filename, ImageCacheFile* file);
+
+private:
+    struct Table {
+        explicit Table(size_t size);
+        size_t mask;   ///< size-1 (the size is a power of 2)
+        size_t count;  ///< Entries in use (only touched by writers)
+        std::unique_ptr<std::atomic<const char*>[]> keys;
+        std::unique_ptr<std::atomic<ImageCacheFile*>[]> files;
+    };
+    std::atomic<Table*> m_table;                 ///< Current table
+    std::vector<std::unique_ptr<Table>> m_all;   ///< Current and replaced
+    std::mutex m_mutex;                          ///< Serializes writers
+};
+
+
+
+/// A read-only memory mapping of a whole image file, for tiles whose
+/// pixels may be used in place.  It's unmapped when the last tile (or
+/// ImageCacheFile) holding it lets go.
+class MappedImageFile {
+public:
+    /// Map the named file, or return an empty pointer on failure.
+    static std::shared_ptr<MappedImageFile> map(const std::string& filename);
+    ~MappedImageFile();
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedImageFile(const char* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
     }
+    const char* m_data;
+    size_t m_size;
+};
+
+
+
+/// A fixed-size store of tile pixels that lives in a memory-mapped file
+/// (typically on a RAM disk such as /dev/shm), so that a tile decoded by
+/// any process on the machine may be used by all of them.  It's an 8-way
+/// set associative table of equal-sized slots, each guarded by a sequence
+/// lock made of an atomic in the mapping itself, so neither insertion nor
+/// lookup takes any lock that spans processes.  When a set is full, its
+/// least recently used slot is recycled, so the store never grows beyond
+/// the size it was created with.  Tiles are identified by a string key,
+/// which must include everything that tells them apart (see
+/// ImageCacheImpl::tile_key).
+///
+/// The caches of every process use the pixels right where they sit in
+/// the store. A slot in use by any tile is pinned by a count in the slot,
+/// and is not recycled until every tile using it has been released (by
+/// its cache's usual eviction). A process that dies holding pins leaves
+/// those slots pinned until the store file is removed.
+class SharedTileStore {
+public:
+    SharedTileStore() {}
+    ~SharedTileStore() { close(); }
+
+    /// Map the store at path, creating it with a capacity of size bytes
+    /// if it doesn't yet exist (an existing store keeps its own size).
+    /// Return true for success, or false and set err for failure.
+    bool open(const std::string& path, size_t size, std::string& err);
+    void close();
+
+    /// If the store has the tile named by key and it is exactly size
+    /// bytes, pin its slot and return a pointer to its pixels, which are
+    /// followed by pad_bytes of zeroes and stay put until release().
+    /// Return NULL if it isn't there.
+    const char* acquire(string_view key, size_t size);
+
+    /// Unpin the slot whose pixels acquire() returned.
+    void release(const char* pixels);
+
+    /// Copy size bytes of pixels into the store under the given key,
+    /// replacing the least recently used slot of its set that isn't
+    /// pinned. Return false if the tile is too big for a slot, or if its
+    /// set is busy.
+    bool insert(string_view key, const void* data, size_t size);
+
+    /// Total bytes of the mapping.
+    size_t mapsize() const { return m_mapsize; }
+
+    /// Size of a slot. The largest tile that fits is pad_bytes smaller.
+    static const size_t slot_bytes = 64 * 1024;
+
+    /// Zero bytes after the pixels of each slot, for SIMD loads of the
+    /// last pixel, just as an ImageCacheTile pads its own pixels.
+    static const size_t pad_bytes = OIIO_SIMD_MAX_SIZE_BYTES;
+
+private:
+    struct Header;
+    struct Slot;
+    Header* m_header = nullptr;
+    Slot* m_slots    = nullptr;
+    char* m_data     = nullptr;
+    size_t m_mapsize = 0;
+    uint64_t m_nsets = 0;
+
+    Slot* set(uint64_t hash) const;
+    char* slotdata(const Slot* s) const;
+};
+
+
+
+/// Pool that recycles tile pixel memory. Buffers are grouped by their
+/// exact size (a set of texture files has only a handful of different
+/// tile sizes), and new ones are carved out of large slabs, optionally
+/// backed by huge pages. So an eviction followed by a miss for a tile of
+/// the same size reuses the memory right away, without going through the
+/// heap. Slabs are only freed when the pool is destroyed, so the pool
+/// holds as much memory as the cache's peak use of pooled tiles.
+class TilePool {
+public:
+    TilePool() {}
+    ~TilePool();
+
+    /// Return a buffer of size bytes, or NULL if this size isn't pooled
+    /// (too big, or there are already too many size classes).
+    char* alloc(size_t size);
+
+    /// Give back a buffer from alloc(size).
+    void free(char* p, size_t size);
+
+    /// Ask for new slabs to be backed by huge pages, where available.
+    void hugepages(bool on) { m_hugepages = on; }
+    bool hugepages() const { return m_hugepages; }
+
+    /// Total bytes of slabs, and how much of that is in free buffers.
+    size_t memory() const { return m_memory; }
+    size_t free_memory() const { return m_free_memory; }
+
+    static const size_t slab_bytes       = 2 * 1024 * 1024;
+    static const size_t max_pooled_bytes = slab_bytes / 8;
+    static const int max_classes         = 16;
+
+private:
+    struct SizeClass {
+        std::atomic<size_t> size { 0 };  ///< Buffer size, 0 if unused
+        spin_mutex mutex;                ///< Protects all below
+        std::vector<char*> freelist;     ///< Buffers given back
+        char* slab { nullptr };          ///< Unused part of current slab
+        size_t slab_left { 0 };          ///< Bytes left in current slab
+    };
+    SizeClass m_classes[max_classes];
+    std::vector<char*> m_slabs;  ///< All slabs, to free at the end
+    spin_mutex m_slabs_mutex;    ///< Protects m_slabs
+    std::atomic<size_t> m_memory { 0 };
+    std::atomic<size_t> m_free_memory { 0 };
+    std::atomic<bool> m_hugepages { false };
+
+    SizeClass* sizeclass(size_t size);
+    char* new_slab();
+};
+
+
+
+/// Collects a flat list of named numeric metrics, each optionally with
+/// one label, and formats them for the getmetrics() methods of the
+/// ImageCache and TextureSystem: either in the Prometheus text format
+/// (with every name given the prefix), or as a JSON object in which a
+/// labeled metric becomes an object mapping its label values to values.
+class MetricsWriter {
+public:
+    enum Kind { Counter, Gauge };
+
+    /// The format is "json" or "prometheus"; ok() is false for others.
+    MetricsWriter(string_view format, string_view prefix);
+    bool ok() const { return m_format != Unknown; }
+
+    void add(string_view name, Kind kind, double value,
+             string_view label = string_view(),
+             string_view labelvalue = string_view());
+
+    /// Add a histogram from counts[] in the buckets of
+    /// ImageCacheStatistics::time_hist_bucket, and the total seconds.
+    void add_time_histogram(string_view name, const long long* counts,
+                            double sum);
+
+    std::string str() const;
+
+private:
+    enum Format { Unknown, JSON, Prometheus };
+    struct Metric {
+        std::string name, label, labelvalue;
+        const char* type;
+        double value;
+    };
+    Format m_format;
+    std::string m_prefix;
+    std::vector<Metric> m_metrics;
+};
+
+
+
+/// The errors that a thread has incurred with an ImageCache or
+/// TextureSystem but not yet retrieved. The messages are only joined into
+/// one string when they're asked for, and only the first max_messages are
+/// kept (the rest are just counted), so that a thread that never asks,
+/// perhaps under a storm of lookups of missing files, can't make them
+/// grow without bound.
+class ErrorRecord {
+public:
+    void append(std::string message);
+
+    /// All the messages, one per line, and clear them.
+    std::string get();
+
+    static const size_t max_messages = 1000;
+
+private:
+    std::vector<std::string> m_messages;
+    size_t m_dropped = 0;  ///< Messages not kept
 };
 
 
@@ -844,12 +1504,39 @@ public:
     const std::string& plugin_searchpath() const { return m_plugin_searchpath; }
     int autotile() const { return m_autotile; }
     bool autoscanline() const { return m_autoscanline; }
+    bool autotile_parallel() const { return m_autotile_parallel; }
     bool automip() const { return m_automip; }
+    bool automip_sidecar() const { return m_automip_sidecar; }
     bool forcefloat() const { return m_forcefloat; }
     bool accept_untiled() const { return m_accept_untiled; }
     bool accept_unmipped() const { return m_accept_unmipped; }
     bool unassociatedalpha() const { return m_unassociatedalpha; }
+    ustring metadata() const { return m_metadata; }
     int failure_retries() const { return m_failure_retries; }
+    int max_inputs_per_file() const { return m_max_inputs_per_file; }
+    const std::string& tile_disk_cache() const { return m_tile_disk_cache; }
+    bool mmap_tiles() const { return m_mmap_tiles; }
+
+    /// Pixel memory for a new tile of size bytes from the tile pool, or
+    /// NULL if the pool is off or doesn't handle that size.
+    char* tile_pool_alloc(size_t size)
+    {
+        return m_use_tile_pool ? m_tile_pool.alloc(size) : nullptr;
+    }
+    void tile_pool_free(char* p, size_t size) { m_tile_pool.free(p, size); }
+
+    /// Pixels for a tile of npixels pixels that all hold the value pixel
+    /// (pixelsize bytes), plus the usual SIMD padding. Tiles with the
+    /// same contents share one copy, for as long as any of them holds it.
+    std::shared_ptr<char> constant_tile_pixels(const void* pixel,
+                                               int pixelsize, size_t npixels);
+
+    /// The current shared tile store, or NULL if there isn't one.
+    std::shared_ptr<SharedTileStore> shared_tiles()
+    {
+        spin_lock lock(m_shared_tiles_mutex);
+        return m_shared_tiles;
+    }
     bool latlong_y_up_default() const { return m_latlong_y_up_default; }
     void get_commontoworld(Imath::M44f& result) const { result = m_Mc2w; }
     int max_errors_per_file() const { return m_max_errors_per_file; }
@@ -954,8 +1641,8 @@ public:
     /// Is the tile specified by the TileID already in the cache?
     bool tile_in_cache(const TileID& id, ImageCachePerThreadInfo* thread_info)
     {
-        TileCache::iterator found = m_tilecache.find(id);
-        return (found != m_tilecache.end());
+        ImageCacheTileRef tile;
+        return m_tilecache.retrieve(id, tile);
     }
 
     /// Add the tile to the cache.  This will also enforce cache memory
@@ -978,11 +1665,37 @@ public:
                 tile->use();
                 return true;  // already have the tile we want
             }
-            // Tile didn't match, maybe lasttile will?  Swap tile
-            // and last tile.  Then the new one will either match,
-            // or we'll fall through and replace tile.
-            tile.swap(thread_info->lasttile);
-            if (tile && tile->id() == id) {
+            // Tile didn't match, maybe one of the other microcache
+            // entries will?  If so, swap it with tile.
+            int nlast = m_microcache_size - 1;
+            for (int i = 0; i < nlast; ++i) {
+                ImageCacheTileRef& last(thread_info->lasttile[i]);
+                if (last && last->id() == id) {
+                    tile.swap(last);
+                    tile->use();
+                    return true;
+                }
+            }
+            // No luck. Keep tile in the microcache in place of the next
+            // lasttile in turn, and we'll fall through and replace tile.
+            if (nlast > 0) {
+                int& next(thread_info->next_lasttile);
+                if (next >= nlast)
+                    next = 0;
+                tile.swap(thread_info->lasttile[next++]);
+            }
+        }
+        // A level that fits on one tile may have it pinned, which saves
+        // the hash lookup and bin lock of the main cache.
+        const ImageCacheFile::LevelInfo& lev(
+            id.file().levelinfo(id.subimage(), id.miplevel()));
+        if (lev.onetile) {
+            ImageCacheTile* pinned = lev.pinned_tile.load(
+                std::memory_order_acquire);
+            if (pinned && pinned->id() == id) {
+                ++thread_info->m_stats.find_tile_microcache_misses;
+                ++thread_info->m_stats.find_tile_pinned_hits;
+                tile = pinned;
                 tile->use();
                 return true;
             }
@@ -996,10 +1709,18 @@ public:
     virtual Tile* get_tile(ImageHandle* file, Perthread* thread_info,
                            int subimage, int miplevel, int x, int y, int z,
                            int chbegin, int chend);
+    virtual int get_tiles(ImageHandle* file, Perthread* thread_info,
+                          cspan<TileRequest> requests, span<Tile*> tiles);
     virtual void release_tile(Tile* tile) const;
     virtual TypeDesc tile_format(const Tile* tile) const;
     virtual ROI tile_roi(const Tile* tile) const;
     virtual const void* tile_pixels(Tile* tile, TypeDesc& format) const;
+    virtual bool prefetch_tiles(ustring filename, int subimage, int miplevel,
+                                ROI roi);
+    virtual bool replay_manifest(string_view manifest);
+    virtual std::string getmetrics(string_view format = "json") const;
+    virtual bool prefetch_tiles(ImageHandle* file, Perthread* thread_info,
+                                int subimage, int miplevel, ROI roi);
     virtual bool add_file(ustring filename, ImageInput::Creator creator,
                           const ImageSpec* config, bool replace);
     virtual bool add_tile(ustring filename, int subimage, int miplevel, int x,
@@ -1024,6 +1745,9 @@ public:
     ///
     void mergestats(ImageCacheStatistics& merged) const;
 
+    /// Merge all the per-thread texture lookup costs, by tag.
+    void merge_cost_tags(TextureCostTags& merged) const;
+
     void operator delete(void* todel) { ::delete ((char*)todel); }
 
     /// Called when a new file is opened, so that the system can track
@@ -1038,6 +1762,12 @@ public:
     /// the number of simultyaneously-opened files.
     void decr_open_files(void) { --m_stat_open_files_current; }
 
+    /// Is the number of open ImageInputs below max_open_files?
+    bool open_files_below_limit() const
+    {
+        return m_stat_open_files_current < m_max_open_files;
+    }
+
     /// Called when a new tile is created, to update all the stats.
     ///
     void incr_tiles(size_t size)
@@ -1060,6 +1790,48 @@ public:
         DASSERT(m_mem_used >= 0);
     }
 
+    /// If the tile is the (valid) tile of a onetile level, pin it in the
+    /// level's LevelInfo, as long as pinned tiles don't already use more
+    /// than a small share of max_memory_MB.  Also pin it if its level has
+    /// fewer than pin_mip_tail tiles, within a larger share.
+    void pin_tile(const ImageCacheTileRef& tile);
+
+    /// Pin (or, if !pin, unpin) every tile, across all channels, of MIP
+    /// levels [miplevel_begin,miplevel_end) of the subimage of the file,
+    /// reading the tiles that aren't in the cache yet.  Return false if
+    /// the file or subimage is bad or a tile could not be read.
+    bool pin_levels(ImageCacheFile* file, ImageCachePerThreadInfo* thread_info,
+                    int subimage, int miplevel_begin, int miplevel_end,
+                    bool pin);
+
+    /// Find the tile in the main cache, or if it isn't there, read it into
+    /// a tile of its own that is NOT added to the cache, so a bulk read
+    /// doesn't evict anything. Return true if the tile is valid.
+    bool find_tile_nocache(const TileID& id, ImageCacheTileRef& tile,
+                           ImageCachePerThreadInfo* thread_info);
+
+    /// Take one pin on the tile, accounting for its memory if it was not
+    /// pinned before.  Automatic pins also count toward the share of
+    /// memory that pin_tile() is allowed.
+    void pin_mem(ImageCacheTile& tile, bool automatic)
+    {
+        long long size = (long long)tile.memsize();
+        if (tile.pin())
+            m_pinned_mem += size;
+        if (automatic)
+            m_auto_pinned_mem += size;
+    }
+
+    /// Give back one pin taken by pin_mem().
+    void unpin_mem(ImageCacheTile& tile, bool automatic)
+    {
+        long long size = (long long)tile.memsize();
+        if (tile.unpin())
+            m_pinned_mem -= size;
+        if (automatic)
+            m_auto_pinned_mem -= size;
+    }
+
     /// Internal error reporting routine, with printf-like arguments.
     template<typename... Args>
     void errorf(const char* fmt, const Args&... args) const
@@ -1092,6 +1864,10 @@ public:
     /// Override the previous value if necessary, with thread-safety.
     void set_min_cache_size(long long newsize);
 
+    /// Build the automip levels of a subimage of the file in the
+    /// background.
+    void queue_automip(ImageCacheFile* file, int subimage);
+
     /// Enforce the max number of open files.
     void check_max_files(ImageCachePerThreadInfo* thread_info);
 
@@ -1099,6 +1875,10 @@ public:
     // ImageCacheFile pointer for the tile it's on.
     ImageCacheFile* resolve_udim(ImageCacheFile* file, float& s, float& t);
 
+    /// Return the dense UDIM tile table of a UDIM-like virtual file,
+    /// building it the first time it is needed.
+    const ImageCacheFile::UdimTable* udim_table(ImageCacheFile* file);
+
 private:
     void init();
 
@@ -1111,6 +1891,96 @@ private:
     /// Enforce the max memory for tile data.
     void check_max_mem(ImageCachePerThreadInfo* thread_info);
 
+    /// In "numa" mode, having found tile in the main cache, count the hit
+    /// by NUMA node, and substitute the copy local to this thread's node
+    /// if there is one (making it, if the tile has been hit from other
+    /// nodes often enough).
+    void numa_local_tile(ImageCacheTileRef& tile,
+                         ImageCachePerThreadInfo* thread_info);
+
+    /// check_max_mem using the "segmented" policy: sweep tile cache bins
+    /// round-robin, each under its own lock only.
+    void check_max_mem_segmented(ImageCachePerThreadInfo* thread_info);
+
+    /// (Re)create the prefetch thread pool with m_prefetch_threads
+    /// workers, or tear it down if that is zero.
+    void set_prefetch_threads(int nthreads);
+
+    /// Queue the tile for reading by the prefetch pool (or read it right
+    /// away if there is no pool), unless it is already in the cache.
+    /// Speculative requests are dropped if the queue is already long.
+    void queue_prefetch(const TileID& id, ImageCachePerThreadInfo* thread_info,
+                        bool speculative);
+
+    /// Read one tile into the cache on behalf of a prefetch request.
+    void prefetch_tile(const TileID& id);
+
+    /// After a main cache miss on id, queue its same-level neighbors and
+    /// the tile covering the same area in the next-coarser MIP level.
+    void autoprefetch_tiles(const TileID& id,
+                            ImageCachePerThreadInfo* thread_info);
+
+    /// Block until all queued prefetch reads (and automip builds) have
+    /// finished.
+    void wait_for_prefetch();
+
+    /// If a manifest is being recorded, add a tile that was just put in
+    /// the cache to it.
+    void record_manifest(const TileID& id)
+    {
+        if (m_recording_manifest)
+            record_manifest_tile(id);
+    }
+    void record_manifest_tile(const TileID& id);
+
+    /// Stop recording, and write whatever manifest has been recorded to
+    /// m_manifest_path, keeping just the first time each tile was read.
+    bool write_manifest();
+
+    /// If the compressed tier is enabled, compress the pixels of a tile
+    /// that is being evicted from the main cache and keep them, subject
+    /// to max_compressed_memory_MB.
+    void compress_tile(const ImageCacheTile& tile,
+                       ImageCachePerThreadInfo* thread_info);
+
+    /// Discard the compressed tiles of the given file, or of all files
+    /// if file is NULL.
+    void clear_compressed_tiles(const ImageCacheFile* file);
+
+    /// The name of the file in the "tile_disk_cache" directory that holds
+    /// the tile id.
+    std::string disk_tile_path(const TileID& id) const;
+
+    /// Map (creating if need be) the shared tile store named by the
+    /// "shared_tile_memory" attribute, replacing any previous one.
+    void open_shared_tiles();
+
+public:
+    /// A string that identifies the tile id across processes. It depends
+    /// on the source file's name and modification time, so files that
+    /// change on disk are never confused with their stale tiles, and on
+    /// the settings that change how the file decodes (the cache's
+    /// unassociatedalpha, the file's configuration hints, the tile size).
+    std::string tile_key(const TileID& id) const;
+
+    /// If the tile id is in the compressed tier, expand its pixels into
+    /// data (which has room for size bytes), remove it from that tier,
+    /// and return true. Return false if it isn't there.
+    bool uncompress_tile(const TileID& id, void* data, size_t size,
+                         ImageCachePerThreadInfo* thread_info);
+
+    /// If the "tile_disk_cache" directory holds a copy of the tile id,
+    /// read its size bytes of pixels into data and return true.
+    bool read_disk_tile(const TileID& id, void* data, size_t size,
+                        ImageCachePerThreadInfo* thread_info);
+
+    /// Queue the tile's pixels to be written to the "tile_disk_cache"
+    /// directory, in the background.
+    void write_disk_tile(const TileID& id, const void* data, size_t size,
+                         ImageCachePerThreadInfo* thread_info);
+
+private:
+
     /// Internal statistics printing routine
     ///
     void printstats() const;
@@ -1141,22 +2011,62 @@ private:
     atomic_ll m_max_memory_bytes;
     std::string m_searchpath;  ///< Colon-separated image directory list
     std::vector<std::string> m_searchdirs;  ///< Searchpath split into dirs
+    float m_searchpath_ttl;  ///< Reuse searchpath dir listings (seconds)
     std::string m_plugin_searchpath;  ///< Colon-separated plugin directory list
     int m_autotile;            ///< if nonzero, pretend tiles of this size
     bool m_autoscanline;       ///< autotile using full width tiles
+    bool m_autotile_parallel;  ///< Slice autotiled bands in parallel?
     bool m_automip;            ///< auto-mipmap on demand?
+    bool m_automip_sidecar;    ///< Save/reuse automip levels in a sidecar
     bool m_forcefloat;         ///< force all cache tiles to be float
     bool m_accept_untiled;     ///< Accept untiled images?
     bool m_accept_unmipped;    ///< Accept unmipped images?
     bool m_deduplicate;        ///< Detect duplicate files?
     bool m_unassociatedalpha;  ///< Keep unassociated alpha files as they are?
+    ustring m_metadata;        ///< "oiio:metadata" hint for opening files
     int m_failure_retries;     ///< Times to re-try disk failures
+    int m_max_inputs_per_file;  ///< Max concurrent ImageInputs per file
+    int m_microcache_size;      ///< Tiles in each per-thread microcache
+    std::string m_tile_disk_cache;  ///< Directory of the local tile store
+    int m_tile_disk_cache_MB;       ///< Size limit of that directory
+    atomic_ll m_disk_tile_bytes_written;  ///< Since we last checked its size
+    bool m_mmap_tiles;  ///< Use uncompressed native tiles in place?
+    bool m_numa;        ///< Keep tiles local to NUMA nodes?
+    int m_numa_nodes;   ///< NUMA nodes we manage (1 if not in numa mode)
+    int m_numa_replicate_hits;  ///< Remote hits before replicating a tile
+    std::string m_shared_tile_memory;  ///< File backing the shared tiles
+    int m_shared_tile_memory_MB;       ///< Size of a new shared store
+    std::shared_ptr<SharedTileStore> m_shared_tiles;
+    spin_mutex m_shared_tiles_mutex;  ///< Protects m_shared_tiles
+    unordered_map<std::string, std::weak_ptr<char>>
+        m_constant_tiles;  ///< Shared pixels of constant tiles, by value
+    spin_mutex m_constant_tiles_mutex;  ///< Protects m_constant_tiles
     bool m_latlong_y_up_default;  ///< Is +y the default "up" for latlong?
     Imath::M44f m_Mw2c;           ///< world-to-"common" matrix
     Imath::M44f m_Mc2w;           ///< common-to-world matrix
     ustring m_substitute_image;   ///< Substitute this image for all others
 
+    /// One tile read, as recorded for the "record_manifest" attribute
+    struct ManifestEntry {
+        double time;  ///< When, in seconds since recording started
+        ustring filename;
+        int subimage, miplevel, x, y, z, chbegin, chend;
+    };
+    Timer m_lifetime;  ///< Time since the IC was created
+
+    std::string m_manifest_path;             ///< Where to write manifest
+    std::atomic<bool> m_recording_manifest;  ///< Recording tiles read?
+    std::vector<ManifestEntry> m_manifest;   ///< Tiles read, in order
+    Timer m_manifest_timer;                  ///< Started with the recording
+    mutable std::mutex m_manifest_mutex;     ///< Protects the above
+
+    // N.B. The tile pool must outlive (so be declared before) all the
+    // structures that hold tiles.
+    TilePool m_tile_pool;  ///< Recycled tile pixel memory
+    bool m_use_tile_pool;  ///< Allocate tiles from m_tile_pool?
+
     mutable FilenameMap m_files;    ///< Map file names to ImageCacheFile's
+    FileIndex m_file_index;         ///< Lock-free index of m_files
     ustring m_file_sweep_name;      ///< Sweeper for "clock" paging algorithm
     spin_mutex m_file_sweep_mutex;  ///< Ensure only one in check_max_files
 
@@ -1167,13 +2077,52 @@ private:
     TileID m_tile_sweep_id;         ///< Sweeper for "clock" paging algorithm
     spin_mutex m_tile_sweep_mutex;  ///< Ensure only one in check_max_mem
 
+    /// Tile eviction policies
+    enum TileEviction { EvictClock = 0, EvictSegmented };
+    int m_tile_eviction;  ///< Which TileEviction policy
+    /// Per-bin bookkeeping for the segmented policy, as of the bin's most
+    /// recent sweep.
+    struct TileSweepBin {
+        atomic_int ntiles { 0 };      ///< Tiles in the bin
+        atomic_int nprotected { 0 };  ///< Tiles in the Protected segment
+    };
+    TileSweepBin m_tile_sweep_bins[TILE_CACHE_SHARDS];
+    atomic_int m_tile_sweep_bin;  ///< Next bin to sweep (segmented policy)
+
+    int m_prefetch_threads;  ///< Number of background prefetch threads
+    int m_get_pixels_threads;  ///< Threads for one get_pixels (0 = all)
+    bool m_autoprefetch;     ///< Prefetch around tiles that miss?
+    std::unique_ptr<thread_pool> m_prefetch_pool;  ///< Prefetch I/O threads
+    atomic_int m_prefetch_pending;  ///< Prefetch reads queued, not finished
+    atomic_int m_automip_pending;   ///< Automip builds queued, not finished
+
+    /// A tile evicted from the main cache, held in compressed form.
+    struct CompressedTile {
+        std::unique_ptr<char[]> data;  ///< Compressed pixels
+        size_t size { 0 };             ///< Compressed size (bytes)
+        size_t rawsize { 0 };          ///< Uncompressed size (bytes)
+        int elemsize { 1 };            ///< Byte-shuffle stride
+        long long seq { 0 };           ///< Insertion order, for eviction
+    };
+    typedef unordered_map<TileID, CompressedTile, TileID::Hasher>
+        CompressedTileMap;
+    long long m_max_compressed_bytes;  ///< Compressed tier budget (0 = off)
+    spin_mutex m_ctiles_mutex;         ///< Protects the following fields
+    CompressedTileMap m_ctiles;        ///< The compressed tier
+    std::deque<std::pair<TileID, long long>> m_ctiles_fifo;  ///< Oldest first
+    long long m_ctiles_seq;            ///< Next insertion sequence number
+    long long m_ctiles_mem;            ///< Bytes held by m_ctiles
+
     atomic_ll m_mem_used;       ///< Memory being used for tiles
+    atomic_ll m_pinned_mem;     ///< ... of which, by pinned tiles
+    atomic_ll m_auto_pinned_mem;  ///< Automatic pins (onetile, MIP tail)
+    int m_pin_mip_tail;           ///< Pin levels with fewer tiles than this
     int m_statslevel;           ///< Statistics level
     int m_max_errors_per_file;  ///< Max errors to print for each file.
 
-    /// Saved error string, per-thread
+    /// Errors not yet retrieved, per-thread
     ///
-    mutable thread_specific_ptr<std::string> m_errormessage;
+    mutable thread_specific_ptr<ErrorRecord> m_errors;
 
     // For debugging -- keep track of who holds the tile and file mutex
 
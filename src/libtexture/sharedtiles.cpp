@@ -0,0 +1,327 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <sys/file.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <OpenImageIO/hash.h>
+#include <OpenImageIO/strutil.h>
+
+#include "imagecache_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+// Everything in the mapping is plain data or lock-free atomics, which work
+// across processes because they are address-free. On all the platforms we
+// care about, 32 and 64 bit atomics are lock-free.
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "SharedTileStore needs address-free 64 bit atomics");
+
+static const char shared_tile_magic[8] = { 'O', 'I', 'I', 'O',
+                                           'S', 'H', 'T', '2' };
+static const int shared_tile_ways      = 8;
+
+
+
+// The header and each slot take a whole cache line, so that the pixels,
+// which tiles use in place, are aligned as well as the mapping is.
+struct SharedTileStore::Header {
+    char magic[8];
+    uint64_t nsets;
+    uint64_t slot_bytes;
+    std::atomic<uint64_t> clock;  // Advances with every use, for LRU
+    char pad_[32];
+};
+
+
+
+struct SharedTileStore::Slot {
+    std::atomic<uint32_t> seq;   // Odd while being written
+    std::atomic<uint32_t> refs;  // Tiles (of any process) using the pixels
+    std::atomic<uint32_t> size;  // Bytes of pixels
+    uint32_t pad1_;
+    std::atomic<uint64_t> key;    // Hash of the key string
+    std::atomic<uint64_t> check;  // A second, independent hash of the key
+    std::atomic<uint64_t> stamp;  // Header::clock as of the last use
+    char pad2_[24];
+};
+
+
+
+std::shared_ptr<MappedImageFile>
+MappedImageFile::map(const std::string& filename)
+{
+    std::shared_ptr<MappedImageFile> mapped;
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return mapped;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* base = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED,
+                          fd, 0);
+        if (base != MAP_FAILED)
+            mapped.reset(
+                new MappedImageFile((const char*)base, size_t(st.st_size)));
+    }
+    ::close(fd);  // The mapping stays valid
+#endif
+    return mapped;
+}
+
+
+
+MappedImageFile::~MappedImageFile()
+{
+#ifndef _WIN32
+    munmap((void*)m_data, m_size);
+#endif
+}
+
+
+
+SharedTileStore::Slot*
+SharedTileStore::set(uint64_t hash) const
+{
+    return m_slots + (hash % m_nsets) * shared_tile_ways;
+}
+
+
+
+char*
+SharedTileStore::slotdata(const Slot* s) const
+{
+    return m_data + size_t(s - m_slots) * slot_bytes;
+}
+
+
+
+bool
+SharedTileStore::open(const std::string& path, size_t size, std::string& err)
+{
+    static_assert(sizeof(Header) == 64 && sizeof(Slot) == 64,
+                  "SharedTileStore header and slots should be a cache line");
+    close();
+#ifdef _WIN32
+    err = "shared tile memory is not supported on this platform";
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        err = Strutil::sprintf("could not open \"%s\": %s", path,
+                               strerror(errno));
+        return false;
+    }
+    // Hold an exclusive lock while we look at (and maybe initialize) the
+    // header, so that processes starting at the same time agree on it.
+    flock(fd, LOCK_EX);
+    struct stat st;
+    bool ok     = (fstat(fd, &st) == 0);
+    bool create = ok && st.st_size == 0;
+    if (create) {
+        uint64_t nsets = std::max(size / (slot_bytes + sizeof(Slot))
+                                      / shared_tile_ways,
+                                  size_t(1));
+        m_mapsize = sizeof(Header)
+                    + nsets * shared_tile_ways * (sizeof(Slot) + slot_bytes);
+        ok        = (ftruncate(fd, off_t(m_mapsize)) == 0);
+    } else {
+        m_mapsize = size_t(st.st_size);
+    }
+    void* base = MAP_FAILED;
+    if (ok && m_mapsize >= sizeof(Header))
+        base = mmap(nullptr, m_mapsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+    if (base == MAP_FAILED) {
+        err = Strutil::sprintf("could not map \"%s\": %s", path,
+                               strerror(errno));
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        m_mapsize = 0;
+        return false;
+    }
+    m_header = (Header*)base;
+    if (create) {
+        // A freshly extended file reads as zeroes, which is a valid empty
+        // table. Just fill in the header.
+        m_header->nsets      = (m_mapsize - sizeof(Header)) / shared_tile_ways
+                          / (sizeof(Slot) + slot_bytes);
+        m_header->slot_bytes = slot_bytes;
+        memcpy(m_header->magic, shared_tile_magic, sizeof(shared_tile_magic));
+    }
+    flock(fd, LOCK_UN);
+    ::close(fd);  // The mapping stays valid
+
+    if (memcmp(m_header->magic, shared_tile_magic, sizeof(shared_tile_magic))
+        || m_header->slot_bytes != slot_bytes
+        || sizeof(Header)
+                   + m_header->nsets * shared_tile_ways
+                         * (sizeof(Slot) + slot_bytes)
+               > m_mapsize) {
+        err = Strutil::sprintf("\"%s\" is not a compatible shared tile store",
+                               path);
+        close();
+        return false;
+    }
+    m_nsets = m_header->nsets;
+    m_slots = (Slot*)(m_header + 1);
+    m_data  = (char*)(m_slots + m_nsets * shared_tile_ways);
+    return true;
+#endif
+}
+
+
+
+void
+SharedTileStore::close()
+{
+#ifndef _WIN32
+    if (m_header)
+        munmap(m_header, m_mapsize);
+#endif
+    m_header  = nullptr;
+    m_slots   = nullptr;
+    m_data    = nullptr;
+    m_mapsize = 0;
+    m_nsets   = 0;
+}
+
+
+
+const char*
+SharedTileStore::acquire(string_view key, size_t size)
+{
+    if (!m_header || size + pad_bytes > slot_bytes)
+        return nullptr;
+    uint64_t hash  = farmhash::Hash64(key);
+    uint64_t check = farmhash::Hash64WithSeed(key, size);
+    Slot* ways     = set(hash);
+    for (int w = 0; w < shared_tile_ways; ++w) {
+        Slot& s(ways[w]);
+        uint32_t seq = s.seq.load(std::memory_order_acquire);
+        if ((seq & 1) || s.key.load(std::memory_order_relaxed) != hash
+            || s.check.load(std::memory_order_relaxed) != check
+            || s.size.load(std::memory_order_relaxed) != size)
+            continue;
+        // Pin it, then make sure no writer claimed it before the pin could
+        // stop it. Both sides are seq_cst, so either the writer sees our
+        // pin and backs off, or we see its odd (or new) seq.
+        s.refs.fetch_add(1, std::memory_order_seq_cst);
+        if (s.seq.load(std::memory_order_seq_cst) != seq) {
+            s.refs.fetch_sub(1, std::memory_order_release);
+            return nullptr;
+        }
+        s.stamp.store(++m_header->clock, std::memory_order_relaxed);
+        return slotdata(&s);
+    }
+    return nullptr;
+}
+
+
+
+void
+SharedTileStore::release(const char* pixels)
+{
+    Slot& s(m_slots[size_t(pixels - m_data) / slot_bytes]);
+    s.refs.fetch_sub(1, std::memory_order_release);
+}
+
+
+
+bool
+SharedTileStore::insert(string_view key, const void* data, size_t size)
+{
+    if (!m_header || size + pad_bytes > slot_bytes)
+        return false;
+    uint64_t hash  = farmhash::Hash64(key);
+    uint64_t check = farmhash::Hash64WithSeed(key, size);
+    Slot* ways     = set(hash);
+    // Pick the least recently used way that isn't being written or used,
+    // unless another process already stored this very tile.
+    Slot* victim    = nullptr;
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (int w = 0; w < shared_tile_ways; ++w) {
+        Slot& s(ways[w]);
+        if (s.seq.load(std::memory_order_acquire) & 1)
+            continue;
+        if (s.key.load(std::memory_order_relaxed) == hash
+            && s.check.load(std::memory_order_relaxed) == check)
+            return true;
+        if (s.refs.load(std::memory_order_relaxed))
+            continue;
+        uint64_t stamp = s.stamp.load(std::memory_order_relaxed);
+        if (stamp < oldest) {
+            oldest = stamp;
+            victim = &s;
+        }
+    }
+    if (!victim)
+        return false;
+    uint32_t seq = victim->seq.load(std::memory_order_relaxed);
+    if ((seq & 1)
+        || !victim->seq.compare_exchange_strong(seq, seq + 1,
+                                                std::memory_order_seq_cst))
+        return false;  // Somebody else is writing it -- let them
+    if (victim->refs.load(std::memory_order_seq_cst)) {
+        // Somebody pinned it since we looked, so leave it be.
+        victim->seq.store(seq, std::memory_order_release);
+        return false;
+    }
+    // Keep the stores below from becoming visible before the odd seq, or
+    // a reader could pin half-written data and still see the old seq.
+    std::atomic_thread_fence(std::memory_order_release);
+    victim->key.store(hash, std::memory_order_relaxed);
+    victim->check.store(check, std::memory_order_relaxed);
+    victim->size.store(uint32_t(size), std::memory_order_relaxed);
+    memcpy(slotdata(victim), data, size);
+    memset(slotdata(victim) + size, 0, pad_bytes);
+    victim->stamp.store(++m_header->clock, std::memory_order_relaxed);
+    victim->seq.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+
+}  // end namespace pvt
+
+OIIO_NAMESPACE_END
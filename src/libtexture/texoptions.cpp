@@ -144,6 +144,7 @@ TextureOpt::TextureOpt(const TextureOptions& opt, int index)
     , rwrap((Wrap)opt.rwrap)
     , rblur(opt.rblur[index])
     , rwidth(opt.rwidth[index])
+    , rnd(-1.0f)
     , envlayout(0)
 {
 }
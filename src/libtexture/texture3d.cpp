@@ -142,6 +142,11 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
         &TextureSystemImpl::texture3d_lookup_nomip,
         &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
         &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture3d_lookup,
+        // The 2D-only modes fall back to the default lookup
+        &TextureSystemImpl::texture3d_lookup,
+        &TextureSystemImpl::texture3d_lookup,
+        &TextureSystemImpl::texture3d_lookup,
         &TextureSystemImpl::texture3d_lookup
     };
     texture3d_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
@@ -152,6 +157,7 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
 
     PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
         (PerThreadInfo*)thread_info_);
+    CostTagScope costscope(thread_info, 1);
     TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle_,
                                                   thread_info);
     ImageCacheStatistics& stats(thread_info->m_stats);
@@ -390,34 +396,48 @@ TextureSystemImpl::accum3d_sample_closest(
     int tile_s = (stex - spec.x) % spec.tile_width;
     int tile_t = (ttex - spec.y) % spec.tile_height;
     int tile_r = (rtex - spec.z) % spec.tile_depth;
-    TileID id(texturefile, options.subimage, miplevel, stex - tile_s,
-              ttex - tile_t, rtex - tile_r, tile_chbegin, tile_chend);
-    bool ok = find_tile(id, thread_info);
-    if (!ok)
-        errorf("%s", m_imagecache->geterror());
-    TileRef& tile(thread_info->tile);
-    if (!tile || !ok)
-        return false;
-    int tilepel = (tile_r * spec.tile_height + tile_t) * spec.tile_width
-                  + tile_s;
-    int startchan_in_tile = options.firstchannel - id.chbegin();
-    int offset            = spec.nchannels * tilepel + startchan_in_tile;
-    DASSERT((size_t)offset < spec.nchannels * spec.tile_pixels());
+    const ImageCacheFile::SubimageInfo& si(
+        texturefile.subimageinfo(options.subimage));
+    size_t channelsize = texturefile.channelsize(options.subimage);
+    const unsigned char* texelbytes;
+    if (!si.background.empty()
+        && levelinfo.tile_empty(stex - tile_s, ttex - tile_t, rtex - tile_r)) {
+        // A tile of a sparse volume that held only the background value
+        // when we last read it: no need to fetch it (again).
+        texelbytes = (const unsigned char*)si.background.data()
+                     + options.firstchannel * channelsize;
+        ++thread_info->m_stats.empty_tile_skips;
+    } else {
+        TileID id(texturefile, options.subimage, miplevel, stex - tile_s,
+                  ttex - tile_t, rtex - tile_r, tile_chbegin, tile_chend);
+        bool ok = find_tile(id, thread_info);
+        if (!ok)
+            errorf("%s", m_imagecache->geterror());
+        TileRef& tile(thread_info->tile);
+        if (!tile || !ok)
+            return false;
+        int tilepel = (tile_r * spec.tile_height + tile_t) * spec.tile_width
+                      + tile_s;
+        int startchan_in_tile = options.firstchannel - id.chbegin();
+        int offset            = spec.nchannels * tilepel + startchan_in_tile;
+        DASSERT((size_t)offset < spec.nchannels * spec.tile_pixels());
+        texelbytes = tile->bytedata() + offset * channelsize;
+    }
     if (pixeltype == TypeDesc::UINT8) {
-        const unsigned char* texel = tile->bytedata() + offset;
+        const unsigned char* texel = texelbytes;
         for (int c = 0; c < actualchannels; ++c)
             accum[c] += weight * uchar2float(texel[c]);
     } else if (pixeltype == TypeDesc::UINT16) {
-        const unsigned short* texel = tile->ushortdata() + offset;
+        const unsigned short* texel = (const unsigned short*)texelbytes;
         for (int c = 0; c < actualchannels; ++c)
             accum[c] += weight * ushort2float(texel[c]);
     } else if (pixeltype == TypeDesc::HALF) {
-        const half* texel = tile->halfdata() + offset;
+        const half* texel = (const half*)texelbytes;
         for (int c = 0; c < actualchannels; ++c)
             accum[c] += weight * half2float(texel[c]);
     } else {
         DASSERT(pixeltype == TypeDesc::FLOAT);
-        const float* texel = tile->floatdata() + offset;
+        const float* texel = (const float*)texelbytes;
         for (int c = 0; c < actualchannels; ++c)
             accum[c] += weight * texel[c];
     }
@@ -529,7 +549,23 @@ TextureSystemImpl::accum3d_sample_bilinear(
     TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
               tile_chend);
     int startchan_in_tile = options.firstchannel - id.chbegin();
-    if (onetile && valid_storage.ivalid == all_valid) {
+    // For sparse volumes, tiles we already found to hold nothing but the
+    // background value stand in for themselves with that one pixel.
+    const ImageCacheFile::SubimageInfo& si(
+        texturefile.subimageinfo(options.subimage));
+    const unsigned char* bgtexel = nullptr;
+    if (!si.background.empty())
+        bgtexel = (const unsigned char*)si.background.data()
+                  + options.firstchannel * channelsize;
+    if (onetile && valid_storage.ivalid == all_valid && bgtexel
+        && levelinfo.tile_empty(stex[0] - tile_s, ttex[0] - tile_t,
+                                rtex[0] - tile_r)) {
+        for (int k = 0; k < 2; ++k)
+            for (int j = 0; j < 2; ++j)
+                for (int i = 0; i < 2; ++i)
+                    texel[k][j][i] = bgtexel;
+        ++thread_info->m_stats.empty_tile_skips;
+    } else if (onetile && valid_storage.ivalid == all_valid) {
         // Shortcut if all the texels we need are on the same tile
         id.xyz(stex[0] - tile_s, ttex[0] - tile_t, rtex[0] - tile_r);
         bool ok = find_tile(id, thread_info);
@@ -566,6 +602,14 @@ TextureSystemImpl::accum3d_sample_bilinear(
                     tile_s = (stex[i] - spec.x) % spec.tile_width;
                     tile_t = (ttex[j] - spec.y) % spec.tile_height;
                     tile_r = (rtex[k] - spec.z) % spec.tile_depth;
+                    if (bgtexel
+                        && levelinfo.tile_empty(stex[i] - tile_s,
+                                                ttex[j] - tile_t,
+                                                rtex[k] - tile_r)) {
+                        texel[k][j][i] = bgtexel;
+                        ++thread_info->m_stats.empty_tile_skips;
+                        continue;
+                    }
                     id.xyz(stex[i] - tile_s, ttex[j] - tile_t,
                            rtex[k] - tile_r);
                     bool ok = find_tile(id, thread_info);
@@ -829,15 +873,39 @@ TextureSystemImpl::accum3d_sample_bilinear(
 
 
 bool
-TextureSystemImpl::texture3d(TextureHandle* texture_handle,
-                             Perthread* thread_info, TextureOptBatch& options,
-                             Tex::RunMask mask, const float* P,
-                             const float* dPdx, const float* dPdy,
-                             const float* dPdz, int nchannels, float* result,
+TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
+                             Perthread* thread_info_, TextureOptBatch& options,
+                             Tex::RunMask mask, const float* P_,
+                             const float* dPdx_, const float* dPdy_,
+                             const float* dPdz_, int nchannels, float* result,
                              float* dresultds, float* dresultdt,
                              float* dresultdr)
 {
-    // (FIXME) CHEAT! Texture points individually
+    typedef Tex::FloatWide FloatWide;
+
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    mask &= Tex::RunMaskOn;
+
+    // >4 channel lookups are split by recursion in the single-point
+    // texture3d(), so those just go lane by lane.
+    if (!texturefile || nchannels > 4)
+        return texture3d_batch_per_lane(texture_handle_, thread_info_, options,
+                                        mask, P_, dPdx_, dPdy_, dPdz_,
+                                        nchannels, result, dresultds,
+                                        dresultdt, dresultdr);
+
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    texturefile = verify_texturefile(texturefile, thread_info);
+
+    int nlanes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        nlanes += (mask >> i) & 1;
+    CostTagScope costscope(thread_info, nlanes);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture3d_batches;
+    stats.texture3d_queries += nlanes;
+
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
@@ -852,10 +920,174 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle,
     opt.missingcolor        = options.missingcolor;
     opt.rwrap               = (TextureOpt::Wrap)options.rwrap;
 
+    // Scatter one lane's results into the SOA outputs.
+    auto store_lane = [&](int lane, const float* r, const float* drds,
+                          const float* drdt, const float* drdr) {
+        for (int c = 0; c < nchannels; ++c)
+            result[c * Tex::BatchWidth + lane] = r[c];
+        if (dresultds) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c * Tex::BatchWidth + lane] = drds[c];
+                dresultdt[c * Tex::BatchWidth + lane] = drdt[c];
+            }
+            if (dresultdr)
+                for (int c = 0; c < nchannels; ++c)
+                    dresultdr[c * Tex::BatchWidth + lane] = drdr[c];
+        }
+    };
+    auto missing_all = [&]() -> bool {
+        bool ok = true;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (mask & (Tex::RunMask(1) << i)) {
+                float r[4], drds[4], drdt[4], drdr[4];
+                ok &= missing_texture(opt, nchannels, r, drds, drdt, drdr);
+                store_lane(i, r, drds, drdt, drdr);
+            }
+        }
+        return ok;
+    };
+
+    if (!texturefile || texturefile->broken())
+        return missing_all();
+
+    if (!opt.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int sub = m_imagecache->subimage_from_name(texturefile,
+                                                   opt.subimagename);
+        if (sub < 0) {
+            errorf("Unknown subimage \"%s\" in texture \"%s\"",
+                   opt.subimagename, texturefile->filename());
+            return missing_all();
+        }
+        opt.subimage = sub;
+        opt.subimagename.clear();
+    }
+    if (opt.subimage < 0 || opt.subimage >= texturefile->subimages()) {
+        errorf("Unknown subimage \"%s\" in texture \"%s\"", opt.subimagename,
+               texturefile->filename());
+        return missing_all();
+    }
+
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.rwrap == TextureOpt::WrapDefault)
+        opt.rwrap = (TextureOpt::Wrap)texturefile->rwrap();
+    if (opt.rwrap == TextureOpt::WrapPeriodic && ispow2(spec.depth))
+        opt.rwrap = TextureOpt::WrapPeriodicPow2;
+
+    int actualchannels = Imath::clamp(spec.nchannels - opt.firstchannel, 0,
+                                      nchannels);
+    bool gray_fill = (actualchannels < nchannels && opt.firstchannel == 0
+                      && m_gray_to_rgb);
+
+    // Transform the lookup points of all lanes into local space at once.
+    FloatWide Px(P_), Py(P_ + Tex::BatchWidth), Pz(P_ + 2 * Tex::BatchWidth);
+    const auto& si(texturefile->subimageinfo(opt.subimage));
+    if (si.Mlocal) {
+        // Same arithmetic as Imath's multVecMatrix, for 16 points
+        const Imath::M44f& M(*si.Mlocal);
+        FloatWide X = Px * M[0][0] + Py * M[1][0] + Pz * M[2][0] + M[3][0];
+        FloatWide Y = Px * M[0][1] + Py * M[1][1] + Pz * M[2][1] + M[3][1];
+        FloatWide Z = Px * M[0][2] + Py * M[1][2] + Pz * M[2][2] + M[3][2];
+        FloatWide W = Px * M[0][3] + Py * M[1][3] + Pz * M[2][3] + M[3][3];
+        Px          = X / W;
+        Py          = Y / W;
+        Pz          = Z / W;
+    } else if (texturefile->fileformat() == s_field3d) {
+        // Field3d's procedural transforms go through the back door, but we
+        // only need to open the file once for all the lanes.
+        auto input                   = texturefile->open(thread_info);
+        Field3DInput_Interface* f3di = (Field3DInput_Interface*)input.get();
+        ASSERT(f3di);
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (!(mask & (Tex::RunMask(1) << i)))
+                continue;
+            Imath::V3f Plocal;
+            f3di->worldToLocal(Imath::V3f(Px[i], Py[i], Pz[i]), Plocal,
+                               opt.time);
+            Px[i] = Plocal[0];
+            Py[i] = Plocal[1];
+            Pz[i] = Plocal[2];
+        }
+    }
+
+    // As in the single-point case, the derivatives are not transformed
+    // because volume lookups are not filtered.
+    bool ok = true;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        opt.sblur  = options.sblur[i];
+        opt.tblur  = options.tblur[i];
+        opt.rblur  = options.rblur[i];
+        opt.swidth = options.swidth[i];
+        opt.twidth = options.twidth[i];
+        opt.rwidth = options.rwidth[i];
+        Imath::V3f Plocal(Px[i], Py[i], Pz[i]);
+        Imath::V3f dPdx(dPdx_[i], dPdx_[i + Tex::BatchWidth],
+                        dPdx_[i + 2 * Tex::BatchWidth]);
+        Imath::V3f dPdy(dPdy_[i], dPdy_[i + Tex::BatchWidth],
+                        dPdy_[i + 2 * Tex::BatchWidth]);
+        Imath::V3f dPdz(dPdz_[i], dPdz_[i + Tex::BatchWidth],
+                        dPdz_[i + 2 * Tex::BatchWidth]);
+        float r[4], drds[4], drdt[4], drdr[4];
+        bool derivs = (dresultds && dresultdt && dresultdr);
+        ok &= texture3d_lookup_nomip(*texturefile, thread_info, opt, nchannels,
+                                     actualchannels, Plocal, dPdx, dPdy, dPdz,
+                                     r, derivs ? drds : nullptr,
+                                     derivs ? drdt : nullptr,
+                                     derivs ? drdr : nullptr);
+        if (!derivs)
+            for (int c = 0; c < nchannels; ++c)
+                drds[c] = drdt[c] = drdr[c] = 0.0f;
+        if (gray_fill)
+            fill_gray_channels(spec, nchannels, r, drds, drdt, drdr);
+        store_lane(i, r, drds, drdt, drdr);
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture3d_batch_per_lane(
+    TextureHandle* texture_handle, Perthread* thread_info,
+    TextureOptBatch& options, Tex::RunMask mask, const float* P,
+    const float* dPdx, const float* dPdy, const float* dPdz, int nchannels,
+    float* result, float* dresultds, float* dresultdt, float* dresultdr)
+{
+    TextureOpt opt;
+    opt.firstchannel        = options.firstchannel;
+    opt.subimage            = options.subimage;
+    opt.subimagename        = options.subimagename;
+    opt.swrap               = (TextureOpt::Wrap)options.swrap;
+    opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
+    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
+    opt.anisotropic         = options.anisotropic;
+    opt.conservative_filter = options.conservative_filter;
+    opt.fill                = options.fill;
+    opt.missingcolor        = options.missingcolor;
+    opt.rwrap               = (TextureOpt::Wrap)options.rwrap;
+
+    // temp results for one lane
+    float* r    = OIIO_ALLOCA(float, nchannels);
+    float* drds = OIIO_ALLOCA(float, nchannels);
+    float* drdt = OIIO_ALLOCA(float, nchannels);
+    float* drdr = OIIO_ALLOCA(float, nchannels);
+
     bool ok          = true;
     Tex::RunMask bit = 1;
     for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4];  // temp result
         if (mask & bit) {
             opt.sblur  = options.sblur[i];
             opt.tblur  = options.tblur[i];
@@ -873,12 +1105,16 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle,
                              dPdz[i + 2 * Tex::BatchWidth]);
             if (dresultds) {
                 ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
-                                dPdy_, dPdz_, nchannels, r, drds, drdt);
+                                dPdy_, dPdz_, nchannels, r, drds, drdt,
+                                dresultdr ? drdr : nullptr);
                 for (int c = 0; c < nchannels; ++c) {
                     result[c * Tex::BatchWidth + i]    = r[c];
                     dresultds[c * Tex::BatchWidth + i] = drds[c];
                     dresultdt[c * Tex::BatchWidth + i] = drdt[c];
                 }
+                if (dresultdr)
+                    for (int c = 0; c < nchannels; ++c)
+                        dresultdr[c * Tex::BatchWidth + i] = drdr[c];
             } else {
                 ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
                                 dPdy_, dPdz_, nchannels, r);
@@ -172,6 +172,43 @@ public:
                          const float* dtdy, int nchannels, float* result,
                          float* dresultds = nullptr,
                          float* dresultdt = nullptr);
+    virtual bool texture_coherent(ustring filename, TextureOpt& options,
+                                  int npoints, const float* s, const float* t,
+                                  const float* dsdx, const float* dtdx,
+                                  const float* dsdy, const float* dtdy,
+                                  int nchannels, float* result,
+                                  float* dresultds = nullptr,
+                                  float* dresultdt = nullptr);
+    virtual bool texture_coherent(TextureHandle* texture_handle,
+                                  Perthread* thread_info, TextureOpt& options,
+                                  int npoints, const float* s, const float* t,
+                                  const float* dsdx, const float* dtdx,
+                                  const float* dsdy, const float* dtdy,
+                                  int nchannels, float* result,
+                                  float* dresultds = nullptr,
+                                  float* dresultdt = nullptr);
+    virtual bool texture_lod(ustring filename, TextureOpt& options, float s,
+                             float t, float width, int nchannels,
+                             float* result, float* dresultds = nullptr,
+                             float* dresultdt = nullptr);
+    virtual bool texture_lod(TextureHandle* texture_handle,
+                             Perthread* thread_info, TextureOpt& options,
+                             float s, float t, float width, int nchannels,
+                             float* result, float* dresultds = nullptr,
+                             float* dresultdt = nullptr);
+    virtual bool texture_lod(ustring filename, TextureOptBatch& options,
+                             Tex::RunMask mask, const float* s,
+                             const float* t, const float* width,
+                             int nchannels, float* result,
+                             float* dresultds = nullptr,
+                             float* dresultdt = nullptr);
+    virtual bool texture_lod(TextureHandle* texture_handle,
+                             Perthread* thread_info, TextureOptBatch& options,
+                             Tex::RunMask mask, const float* s,
+                             const float* t, const float* width,
+                             int nchannels, float* result,
+                             float* dresultds = nullptr,
+                             float* dresultdt = nullptr);
     virtual bool texture(ustring filename, TextureOptions& options,
                          Runflag* runflags, int beginactive, int endactive,
                          VaryingRef<float> s, VaryingRef<float> t,
@@ -350,8 +387,27 @@ public:
                             int yend, int zbegin, int zend, int chbegin,
                             int chend, TypeDesc format, void* result);
 
+    virtual bool get_tile_feedback(ustring filename, int subimage,
+                                   int miplevel, std::vector<uint64_t>& tiles,
+                                   bool reset = false);
+
+    virtual bool pin(ustring filename, int subimage, int miplevel_begin = 0,
+                     int miplevel_end = -1);
+    virtual bool pin(TextureHandle* texture_handle, Perthread* thread_info,
+                     int subimage, int miplevel_begin = 0,
+                     int miplevel_end = -1);
+    virtual bool unpin(ustring filename, int subimage, int miplevel_begin = 0,
+                       int miplevel_end = -1);
+    virtual bool unpin(TextureHandle* texture_handle, Perthread* thread_info,
+                       int subimage, int miplevel_begin = 0,
+                       int miplevel_end = -1);
+
+    virtual void set_cost_tag(Perthread* thread_info, ustring tag);
+
     virtual std::string geterror() const;
     virtual std::string getstats(int level = 1, bool icstats = true) const;
+    virtual std::string getmetrics(string_view format = "json",
+                                   bool icstats = true) const;
     virtual void reset_stats();
 
     virtual void invalidate(ustring filename);
@@ -373,6 +429,40 @@ private:
 
     void init();
 
+    /// While in scope, attribute the cost of a texture lookup to the
+    /// thread's current cost tag, if it has one. The lookups that a
+    /// tagged lookup makes on its own behalf aren't counted again.
+    class CostTagScope {
+    public:
+        CostTagScope(PerThreadInfo* thread_info, int lookups)
+        {
+            if (thread_info->cost_tag >= 0 && !thread_info->in_tagged_lookup)
+                begin(thread_info, lookups);
+        }
+        ~CostTagScope()
+        {
+            if (m_thread_info)
+                end();
+        }
+
+    private:
+        PerThreadInfo* m_thread_info = nullptr;
+        int m_tag                    = -1;
+        int m_lookups                = 0;
+        long long m_texels           = 0;
+        long long m_tile_lookups     = 0;
+        long long m_tile_misses      = 0;
+        Timer m_timer { false };
+        void begin(PerThreadInfo* thread_info, int lookups);
+        void end();
+        static long long texels(const ImageCacheStatistics& stats);
+    };
+
+    /// Shared guts of pin() and unpin().
+    bool pin_levels(TextureHandle* texture_handle, Perthread* thread_info,
+                    int subimage, int miplevel_begin, int miplevel_end,
+                    bool pin);
+
     /// Find the TextureFile record for the named texture, or NULL if no
     /// such file can be found.
     TextureFile* find_texturefile(ustring filename, PerThreadInfo* thread_info)
@@ -409,6 +499,10 @@ private:
     /// Inlined for speed.
     bool find_tile(const TileID& id, PerThreadInfo* thread_info)
     {
+        if (m_feedback)
+            id.file()
+                .levelinfo(id.subimage(), id.miplevel())
+                .mark_needed(id.x(), id.y(), id.z());
         return m_imagecache->find_tile(id, thread_info);
     }
 
@@ -425,6 +519,40 @@ private:
         float _dsdx, float _dtdx, float _dsdy, float _dtdy, float* result,
         float* dresultds, float* resultdt);
 
+    /// Batched texture lookup, one lane at a time via the single-point
+    /// texture(). Used for the cases the vectorized batch path does not
+    /// handle (UDIM, more than 4 channels).
+    bool texture_batch_per_lane(TextureHandle* texture_handle,
+                                Perthread* thread_info,
+                                TextureOptBatch& options, Tex::RunMask mask,
+                                const float* s, const float* t,
+                                const float* dsdx, const float* dtdx,
+                                const float* dsdy, const float* dtdy,
+                                int nchannels, float* result,
+                                float* dresultds, float* dresultdt);
+
+    /// Batched environment lookup, one lane at a time via the single-point
+    /// environment(). Used for the cases the vectorized batch path does
+    /// not handle (more than 4 channels, subimage by name).
+    bool environment_batch_per_lane(TextureHandle* texture_handle,
+                                    Perthread* thread_info,
+                                    TextureOptBatch& options,
+                                    Tex::RunMask mask, const float* R,
+                                    const float* dRdx, const float* dRdy,
+                                    int nchannels, float* result,
+                                    float* dresultds, float* dresultdt);
+
+    /// Batched volume lookup, one lane at a time via the single-point
+    /// texture3d(). Used for more than 4 channels.
+    bool texture3d_batch_per_lane(TextureHandle* texture_handle,
+                                  Perthread* thread_info,
+                                  TextureOptBatch& options, Tex::RunMask mask,
+                                  const float* P, const float* dPdx,
+                                  const float* dPdy, const float* dPdz,
+                                  int nchannels, float* result,
+                                  float* dresultds, float* dresultdt,
+                                  float* dresultdr);
+
     /// Look up texture from just ONE point
     ///
     bool texture_lookup(TextureFile& texfile, PerThreadInfo* thread_info,
@@ -433,6 +561,44 @@ private:
                         float _dtdx, float _dsdy, float _dtdy, float* result,
                         float* dresultds, float* resultdt);
 
+    /// Look up texture from just ONE point, filtering with an elliptical
+    /// weighted average of the texels under the footprint.
+    bool texture_lookup_ewa(TextureFile& texfile, PerThreadInfo* thread_info,
+                            TextureOpt& options, int nchannels_result,
+                            int actualchannels, float _s, float _t,
+                            float _dsdx, float _dtdx, float _dsdy,
+                            float _dtdy, float* result, float* dresultds,
+                            float* resultdt);
+
+    /// Look up texture from just ONE point, averaging the texels under the
+    /// axis-aligned box that bounds the footprint in constant time, using
+    /// a summed-area table of one MIP level (see summed_area_table()).
+    bool texture_lookup_sat(TextureFile& texfile, PerThreadInfo* thread_info,
+                            TextureOpt& options, int nchannels_result,
+                            int actualchannels, float _s, float _t,
+                            float _dsdx, float _dtdx, float _dsdy,
+                            float _dtdy, float* result, float* dresultds,
+                            float* resultdt);
+
+    /// Return the summed-area table for the subimage, building it on first
+    /// use from the finest MIP level no larger than m_sat_maxres. Returns
+    /// an empty pointer if the subimage can't have one, or while another
+    /// thread is still building it.
+    std::shared_ptr<const SummedAreaTable>
+    summed_area_table(TextureFile& texturefile, PerThreadInfo* thread_info,
+                      int subimage);
+
+    /// Look up texture from just ONE point, with a single probe of one
+    /// MIP level (and for StochasticAniso, one position along the major
+    /// axis) chosen at random in proportion to its filter weight.
+    bool texture_lookup_stochastic(TextureFile& texfile,
+                                   PerThreadInfo* thread_info,
+                                   TextureOpt& options, int nchannels_result,
+                                   int actualchannels, float _s, float _t,
+                                   float _dsdx, float _dtdx, float _dsdy,
+                                   float _dtdy, float* result,
+                                   float* dresultds, float* resultdt);
+
     bool texture_lookup_nomip(TextureFile& texfile, PerThreadInfo* thread_info,
                               TextureOpt& options, int nchannels_result,
                               int actualchannels, float _s, float _t,
@@ -469,6 +635,18 @@ private:
                          int nchannels_result, int actualchannels,
                          const float* weight, simd::vfloat4* accum,
                          simd::vfloat4* daccumds, simd::vfloat4* daccumdt);
+    /// sample_bilinear compiled for one tile data type T, one wrap mode
+    /// shared by s and t (clamp or periodic), and Nchan channels read.
+    /// sample_bilinear hands lookups to it when it applies, which is
+    /// only when there is no crop window and no pole to fade to.
+    template<typename T, int Wrap, int Nchan>
+    bool sample_bilinear_fast(int nsamples, const float* s, const float* t,
+                              int level, TextureFile& texturefile,
+                              PerThreadInfo* thread_info, TextureOpt& options,
+                              int nchannels_result, int actualchannels,
+                              const float* weight, simd::vfloat4* accum,
+                              simd::vfloat4* daccumds,
+                              simd::vfloat4* daccumdt);
     bool sample_bicubic(int nsamples, const float* s, const float* t, int level,
                         TextureFile& texturefile, PerThreadInfo* thread_info,
                         TextureOpt& options, int nchannels_result,
@@ -476,6 +654,51 @@ private:
                         simd::vfloat4* accum, simd::vfloat4* daccumds,
                         simd::vfloat4* daccumdt);
 
+    /// The default and anisotropic lookups of a batch, whose footprints
+    /// were already computed for all the lanes at once: lane i takes
+    /// nsamples[i] probes spread along (s,t) +/- (smajor,tmajor), probe k
+    /// weighted by lineweight[k*BatchWidth+i], of MIP levels miplevel0 and
+    /// miplevel1 blended by levelblend. The texel coordinates and filter
+    /// weights of each probe are computed for all lanes at once, and the
+    /// lanes are visited in the order given, grouped by tile, so that a
+    /// tile is found just once for the run of lanes reading it. Probes
+    /// that need wrapping or straddle tiles go to the samplers. Stores the
+    /// (vfloat4-padded) results of lane i in result[i], etc.
+    bool sample_aniso_batch(TextureFile& texturefile,
+                            PerThreadInfo* thread_info, TextureOpt& options,
+                            int nchannels_result, int actualchannels,
+                            const int* lanes, int nlanes, const float* s,
+                            const float* t, const float* smajor,
+                            const float* tmajor, const int* nsamples,
+                            const float* lineweight, const int* miplevel0,
+                            const int* miplevel1, const float* levelblend,
+                            const int* naturalsres, const int* naturaltres,
+                            simd::vfloat4* result, simd::vfloat4* dresultds,
+                            simd::vfloat4* dresultdt);
+
+    /// Gaussian-weighted average of the texels of one MIP level that lie
+    /// within the ellipse centered at (s,t) with semi-axes of st length
+    /// `major` along the unit direction (smajor,tmajor) and `minor`
+    /// perpendicular to it. Adds the number of texels read to ntexels.
+    bool sample_ewa(float s, float t, float major, float minor, float smajor,
+                    float tmajor, int level, TextureFile& texturefile,
+                    PerThreadInfo* thread_info, TextureOpt& options,
+                    int nchannels_result, int actualchannels,
+                    simd::vfloat4* accum, simd::vfloat4* daccumds,
+                    simd::vfloat4* daccumdt, long long& ntexels);
+
+    /// Sample MIP level `level` of a cubeface environment map at (fs,ft),
+    /// running 0-1 across face number `face` (0-5 for px, nx, py, ny, pz,
+    /// nz), and store weight times the result in *accum. A footprint
+    /// inside the face is passed to sampler; one that straddles an edge is
+    /// filtered bilinearly from the texels of both faces, with no seam.
+    bool sample_cubeface(int face, float fs, float ft, int level,
+                         TextureFile& texturefile, PerThreadInfo* thread_info,
+                         TextureOpt& options, sampler_prototype sampler,
+                         int nchannels_result, int actualchannels,
+                         float weight, simd::vfloat4* accum,
+                         simd::vfloat4* daccumds, simd::vfloat4* daccumdt);
+
     // Define a prototype of a member function pointer for texture3d
     // lookups.
     typedef bool (TextureSystemImpl::*texture3d_lookup_prototype)(
@@ -586,9 +809,13 @@ private:
     bool m_flip_t;            ///< Flip direction of t coord?
     int m_max_tile_channels;  ///< narrow tile ID channel range when
                               ///<   the file has more channels
-    /// Saved error string, per-thread
+    bool m_feedback;          ///< Record the tiles lookups need?
+    int m_get_texels_threads;   ///< Threads for one get_texels (0 = all)
+    bool m_get_texels_nocache;  ///< get_texels misses bypass the cache?
+    int m_sat_maxres;           ///< Max res of a summed-area table level
+    /// Errors not yet retrieved, per-thread
     ///
-    mutable thread_specific_ptr<std::string> m_errormessage;
+    mutable thread_specific_ptr<ErrorRecord> m_errors;
     Filter1D* hq_filter;  ///< Better filter for magnification
     int m_statslevel;
     friend class TextureSystem;
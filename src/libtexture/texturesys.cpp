@@ -29,6 +29,7 @@
 */
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <list>
@@ -48,6 +49,7 @@
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/optparser.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
@@ -105,6 +107,62 @@ half2float4(const half* h)
 }
 
 
+OIIO_FORCEINLINE vfloat4
+texel2float4(const unsigned char* p, TypeDesc::BASETYPE pixeltype)
+{
+    if (pixeltype == TypeDesc::UINT8)
+        return uchar2float4(p);
+    if (pixeltype == TypeDesc::UINT16)
+        return ushort2float4((const unsigned short*)p);
+    if (pixeltype == TypeDesc::HALF)
+        return half2float4((const half*)p);
+    DASSERT(pixeltype == TypeDesc::FLOAT);
+    return vfloat4((const float*)p);
+}
+
+
+// Compile-time texel conversion for the specialized samplers: all four
+// channels of the texel at p, or just its first channel. Each matches
+// the arithmetic of the runtime-typed conversions above.
+template<typename T> struct TexelConvert {
+};
+
+template<> struct TexelConvert<unsigned char> {
+    static vfloat4 load4(const unsigned char* p) { return uchar2float4(p); }
+    static float load1(const unsigned char* p)
+    {
+        return float(p[0]) * (1.0f / 255.0f);
+    }
+};
+
+template<> struct TexelConvert<unsigned short> {
+    static vfloat4 load4(const unsigned char* p)
+    {
+        return ushort2float4((const unsigned short*)p);
+    }
+    static float load1(const unsigned char* p)
+    {
+        return float(*(const unsigned short*)p) * (1.0f / 65535.0f);
+    }
+};
+
+template<> struct TexelConvert<half> {
+    static vfloat4 load4(const unsigned char* p)
+    {
+        return half2float4((const half*)p);
+    }
+    static float load1(const unsigned char* p) { return *(const half*)p; }
+};
+
+template<> struct TexelConvert<float> {
+    static vfloat4 load4(const unsigned char* p)
+    {
+        return vfloat4((const float*)p);
+    }
+    static float load1(const unsigned char* p) { return *(const float*)p; }
+};
+
+
 static const OIIO_SIMD4_ALIGN vbool4 channel_masks[5] = {
     vbool4(false, false, false, false), vbool4(true, false, false, false),
     vbool4(true, true, false, false),   vbool4(true, true, true, false),
@@ -368,6 +426,10 @@ TextureSystemImpl::init()
     m_gray_to_rgb       = false;
     m_flip_t            = false;
     m_max_tile_channels = 6;
+    m_feedback          = false;
+    m_get_texels_threads = 1;
+    m_get_texels_nocache = false;
+    m_sat_maxres         = 1024;
     delete hq_filter;
     hq_filter    = Filter1D::create("b-spline", 4);
     m_statslevel = 0;
@@ -442,6 +504,33 @@ TextureSystemImpl::getstats(int level, bool icstats) const
             out << Strutil::sprintf("  Average anisotropic probes : 0\n");
         out << Strutil::sprintf("  Max anisotropy in the wild : %.3g\n",
                                 stats.max_aniso);
+        if (stats.ewa_texels)
+            out << "  EWA filtered texels : " << stats.ewa_texels << "\n";
+        if (stats.sat_queries)
+            out << "  Summed-area table lookups : " << stats.sat_queries
+                << "\n";
+        if (stats.empty_tile_skips)
+            out << "  Empty volume tiles skipped : " << stats.empty_tile_skips
+                << "\n";
+        TextureCostTags tags;
+        if (level >= 2)
+            m_imagecache->merge_cost_tags(tags);
+        if (tags.size()) {
+            // Most expensive first
+            std::sort(tags.begin(), tags.end(),
+                      [](const TextureCostTags::value_type& a,
+                         const TextureCostTags::value_type& b) {
+                          return a.second.seconds > b.second.seconds;
+                      });
+            out << "  Cost by tag (lookups, texels, tile lookups / misses, "
+                   "time):\n";
+            for (const auto& tag : tags)
+                out << Strutil::sprintf(
+                    "    %-24s %10lld %12lld %10lld %8lld  %s\n", tag.first,
+                    tag.second.lookups, tag.second.texels,
+                    tag.second.tile_lookups, tag.second.tile_misses,
+                    Strutil::timeintervalformat(tag.second.seconds, 2));
+        }
         if (icstats)
             out << "\n";
     }
@@ -452,6 +541,84 @@ TextureSystemImpl::getstats(int level, bool icstats) const
 
 
 
+std::string
+TextureSystemImpl::getmetrics(string_view format, bool icstats) const
+{
+    MetricsWriter metrics(format, "oiio_texture_");
+    if (!metrics.ok()) {
+        errorf("Unknown metrics format \"%s\"", format);
+        return std::string();
+    }
+    // Merge all the threads
+    ImageCacheStatistics stats;
+    m_imagecache->mergestats(stats);
+
+    const MetricsWriter::Kind Counter = MetricsWriter::Counter;
+    metrics.add("queries", Counter, double(stats.texture_queries), "type",
+                "texture");
+    metrics.add("queries", Counter, double(stats.texture3d_queries), "type",
+                "texture3d");
+    metrics.add("queries", Counter, double(stats.shadow_queries), "type",
+                "shadow");
+    metrics.add("queries", Counter, double(stats.environment_queries),
+                "type", "environment");
+    metrics.add("batches", Counter, double(stats.texture_batches), "type",
+                "texture");
+    metrics.add("batches", Counter, double(stats.texture3d_batches), "type",
+                "texture3d");
+    metrics.add("batches", Counter, double(stats.shadow_batches), "type",
+                "shadow");
+    metrics.add("batches", Counter, double(stats.environment_batches),
+                "type", "environment");
+    metrics.add("interps", Counter, double(stats.closest_interps), "interp",
+                "closest");
+    metrics.add("interps", Counter, double(stats.bilinear_interps), "interp",
+                "bilinear");
+    metrics.add("interps", Counter, double(stats.cubic_interps), "interp",
+                "bicubic");
+    metrics.add("aniso_queries", Counter, double(stats.aniso_queries));
+    metrics.add("aniso_probes", Counter, double(stats.aniso_probes));
+    metrics.add("max_aniso", MetricsWriter::Gauge, stats.max_aniso);
+    metrics.add("ewa_texels", Counter, double(stats.ewa_texels));
+    metrics.add("sat_queries", Counter, double(stats.sat_queries));
+    metrics.add("empty_tile_skips", Counter, double(stats.empty_tile_skips));
+    metrics.add("file_retry_success", Counter, stats.file_retry_success);
+    metrics.add("tile_retry_success", Counter, stats.tile_retry_success);
+    TextureCostTags tags;
+    m_imagecache->merge_cost_tags(tags);
+    // Each metric's tags must be consecutive, to make one JSON object.
+    for (const auto& tag : tags)
+        metrics.add("tag_lookups", Counter, double(tag.second.lookups), "tag",
+                    tag.first);
+    for (const auto& tag : tags)
+        metrics.add("tag_texels", Counter, double(tag.second.texels), "tag",
+                    tag.first);
+    for (const auto& tag : tags)
+        metrics.add("tag_tile_lookups", Counter,
+                    double(tag.second.tile_lookups), "tag", tag.first);
+    for (const auto& tag : tags)
+        metrics.add("tag_tile_misses", Counter, double(tag.second.tile_misses),
+                    "tag", tag.first);
+    for (const auto& tag : tags)
+        metrics.add("tag_seconds", Counter, tag.second.seconds, "tag",
+                    tag.first);
+    std::string result = metrics.str();
+    if (icstats) {
+        std::string ic = m_imagecache->getmetrics(format);
+        if (format == "json") {
+            // Nest the ImageCache's object inside ours
+            result = Strutil::sprintf("%s,\n  \"imagecache\": %s}\n",
+                                      Strutil::strip(result, "}\n"),
+                                      Strutil::strip(ic, "\n"));
+        } else {
+            result += ic;
+        }
+    }
+    return result;
+}
+
+
+
 void
 TextureSystemImpl::printstats() const
 {
@@ -462,6 +629,77 @@ TextureSystemImpl::printstats() const
 
 
 
+void
+TextureSystemImpl::set_cost_tag(Perthread* thread_info_, ustring tag)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    if (tag.empty()) {
+        thread_info->cost_tag = -1;
+        return;
+    }
+    TextureCostTags& tags(thread_info->cost_tags);
+    int n = int(tags.size());
+    if (thread_info->cost_tag >= 0 && tags[thread_info->cost_tag].first == tag)
+        return;
+    for (int i = 0; i < n; ++i) {
+        if (tags[i].first == tag) {
+            thread_info->cost_tag = i;
+            return;
+        }
+    }
+    // Only this thread adds to its tags, but merging may be reading them.
+    spin_lock lock(thread_info->cost_tags_mutex);
+    tags.emplace_back(tag, TextureCostStats());
+    thread_info->cost_tag = n;
+}
+
+
+
+long long
+TextureSystemImpl::CostTagScope::texels(const ImageCacheStatistics& stats)
+{
+    // Each bilinear probe reads 4 texels and each bicubic one 16.
+    return stats.closest_interps + 4 * stats.bilinear_interps
+           + 16 * stats.cubic_interps + stats.ewa_texels;
+}
+
+
+
+void
+TextureSystemImpl::CostTagScope::begin(PerThreadInfo* thread_info,
+                                       int lookups)
+{
+    const ImageCacheStatistics& stats(thread_info->m_stats);
+    m_thread_info                 = thread_info;
+    m_tag                         = thread_info->cost_tag;
+    m_lookups                     = lookups;
+    m_texels                      = texels(stats);
+    m_tile_lookups                = stats.find_tile_calls;
+    m_tile_misses                 = stats.find_tile_cache_misses;
+    thread_info->in_tagged_lookup = true;
+    m_timer.start();
+}
+
+
+
+void
+TextureSystemImpl::CostTagScope::end()
+{
+    double seconds = m_timer.stop();
+    const ImageCacheStatistics& stats(m_thread_info->m_stats);
+    // Tags are never removed, so the index is still good.
+    TextureCostStats& cost(m_thread_info->cost_tags[m_tag].second);
+    cost.lookups += m_lookups;
+    cost.texels += texels(stats) - m_texels;
+    cost.tile_lookups += stats.find_tile_calls - m_tile_lookups;
+    cost.tile_misses += stats.find_tile_cache_misses - m_tile_misses;
+    cost.seconds += seconds;
+    m_thread_info->in_tagged_lookup = false;
+}
+
+
+
 void
 TextureSystemImpl::reset_stats()
 {
@@ -501,6 +739,22 @@ TextureSystemImpl::attribute(string_view name, TypeDesc type, const void* val)
         m_max_tile_channels = *(const int*)val;
         return true;
     }
+    if (name == "feedback" && type == TypeInt) {
+        m_feedback = *(const int*)val;
+        return true;
+    }
+    if (name == "get_texels_threads" && type == TypeInt) {
+        m_get_texels_threads = std::max(0, *(const int*)val);
+        return true;
+    }
+    if (name == "get_texels_nocache" && type == TypeInt) {
+        m_get_texels_nocache = *(const int*)val;
+        return true;
+    }
+    if (name == "sat_maxres" && type == TypeInt) {
+        m_sat_maxres = std::max(1, *(const int*)val);
+        return true;
+    }
     if (name == "statistics:level" && type == TypeInt) {
         m_statslevel = *(const int*)val;
         // DO NOT RETURN! pass the same message to the image cache
@@ -546,6 +800,22 @@ TextureSystemImpl::getattribute(string_view name, TypeDesc type,
         *(int*)val = m_max_tile_channels;
         return true;
     }
+    if (name == "feedback" && type == TypeInt) {
+        *(int*)val = m_feedback;
+        return true;
+    }
+    if (name == "get_texels_threads" && type == TypeInt) {
+        *(int*)val = m_get_texels_threads;
+        return true;
+    }
+    if (name == "get_texels_nocache" && type == TypeInt) {
+        *(int*)val = m_get_texels_nocache;
+        return true;
+    }
+    if (name == "sat_maxres" && type == TypeInt) {
+        *(int*)val = m_sat_maxres;
+        return true;
+    }
 
     // If not one of these, maybe it's an attribute meant for the image cache?
     return m_imagecache->getattribute(name, type, val);
@@ -717,11 +987,6 @@ TextureSystemImpl::get_texels(TextureHandle* texture_handle_,
     }
     const ImageSpec& spec(texfile->spec(subimage, miplevel));
 
-    // FIXME -- this could be WAY more efficient than starting from
-    // scratch for each pixel within the rectangle.  Instead, we should
-    // grab a whole tile at a time and memcpy it rapidly.  But no point
-    // doing anything more complicated (not to mention bug-prone) until
-    // somebody reports this routine as being a bottleneck.
     int nchannels      = chend - chbegin;
     int actualchannels = Imath::clamp(spec.nchannels - chbegin, 0, nchannels);
     int tile_chbegin = 0, tile_chend = spec.nchannels;
@@ -730,53 +995,119 @@ TextureSystemImpl::get_texels(TextureHandle* texture_handle_,
         tile_chbegin = chbegin;
         tile_chend   = chbegin + actualchannels;
     }
-    TileID tileid(*texfile, subimage, miplevel, 0, 0, 0, tile_chbegin,
-                  tile_chend);
     size_t formatchannelsize = format.size();
-    size_t formatpixelsize   = nchannels * formatchannelsize;
-    size_t scanlinesize      = (xend - xbegin) * formatpixelsize;
-    size_t zplanesize        = (yend - ybegin) * scanlinesize;
-    bool ok                  = true;
-    for (int z = zbegin; z < zend; ++z) {
-        if (z < spec.z || z >= (spec.z + std::max(spec.depth, 1))) {
-            // nonexistant planes
-            memset(result, 0, zplanesize);
-            result = (void*)((char*)result + zplanesize);
-            continue;
-        }
-        tileid.z(z - ((z - spec.z) % std::max(1, spec.tile_depth)));
-        for (int y = ybegin; y < yend; ++y) {
-            if (y < spec.y || y >= (spec.y + spec.height)) {
-                // nonexistant scanlines
-                memset(result, 0, scanlinesize);
-                result = (void*)((char*)result + scanlinesize);
+    stride_t formatpixelsize = nchannels * formatchannelsize;
+    stride_t scanlinesize    = (xend - xbegin) * formatpixelsize;
+    stride_t zplanesize      = (yend - ybegin) * scanlinesize;
+
+    // Anything outside the data window is zero, so if the region isn't
+    // all inside, start from zero and fill in just the part that is.
+    int depth = std::max(spec.depth, 1);
+    int x0 = std::max(xbegin, spec.x), x1 = std::min(xend, spec.x + spec.width);
+    int y0 = std::max(ybegin, spec.y);
+    int y1 = std::min(yend, spec.y + spec.height);
+    int z0 = std::max(zbegin, spec.z), z1 = std::min(zend, spec.z + depth);
+    if (x0 != xbegin || x1 != xend || y0 != ybegin || y1 != yend || z0 != zbegin
+        || z1 != zend)
+        memset(result, 0, std::max(zend - zbegin, 0) * zplanesize);
+    if (x0 >= x1 || y0 >= y1 || z0 >= z1)
+        return true;
+
+    // Channels the file doesn't have get the fill value, in the
+    // requested format.
+    std::vector<char> fillpixel;
+    if (actualchannels < nchannels) {
+        fillpixel.resize(formatpixelsize);
+        for (int c = actualchannels; c < nchannels; ++c)
+            convert_types(TypeDesc::FLOAT, &options.fill, format,
+                          &fillpixel[c * formatchannelsize], 1);
+    }
+
+    // Work a whole tile at a time: each tile is found once, and its part
+    // of the region is converted by convert_image, which handles the
+    // strides and is SIMD for the common type pairs. Rows of tiles are
+    // independent, so a big region may be split across threads.
+    int tw = spec.tile_width, th = spec.tile_height;
+    int td      = std::max(spec.tile_depth, 1);
+    int tx0     = x0 - ((x0 - spec.x) % tw);
+    int ty0     = y0 - ((y0 - spec.y) % th);
+    int tz0     = z0 - ((z0 - spec.z) % td);
+    int ntrows  = (y1 - ty0 + th - 1) / th;
+    int ntplane = (z1 - tz0 + td - 1) / td;
+    TypeDesc datatype = texfile->datatype(subimage);
+    bool nocache      = m_get_texels_nocache;
+    auto tile_row     = [&](int64_t r, PerThreadInfo* thread_info) -> bool {
+        int tz = tz0 + int(r / ntrows) * td;
+        int ty = ty0 + int(r % ntrows) * th;
+        int za = std::max(z0, tz), zb = std::min(z1, tz + td);
+        int ya = std::max(y0, ty), yb = std::min(y1, ty + th);
+        TileID tileid(*texfile, subimage, miplevel, 0, ty, tz, tile_chbegin,
+                      tile_chend);
+        bool ok = true;
+        for (int tx = tx0; tx < x1; tx += tw) {
+            int xa = std::max(x0, tx), xb = std::min(x1, tx + tw);
+            char* dst = (char*)result + (za - zbegin) * zplanesize
+                        + (ya - ybegin) * scanlinesize
+                        + (xa - xbegin) * formatpixelsize;
+            tileid.x(tx);
+            TileRef tile;
+            if (nocache) {
+                ok &= m_imagecache->find_tile_nocache(tileid, tile,
+                                                      thread_info);
+            } else {
+                ok &= find_tile(tileid, thread_info);
+                tile = thread_info->tile;
+            }
+            const char* src = (tile && tile->valid())
+                                  ? (const char*)tile->data(xa, ya, za,
+                                                            chbegin)
+                                  : nullptr;
+            if (!src) {
+                for (int z = za; z < zb; ++z)
+                    for (int y = ya; y < yb; ++y)
+                        memset(dst + (z - za) * zplanesize
+                                   + (y - ya) * scanlinesize,
+                               0, (xb - xa) * formatpixelsize);
                 continue;
             }
-            tileid.y(y - ((y - spec.y) % spec.tile_height));
-            for (int x = xbegin; x < xend; ++x) {
-                if (x < spec.x || x >= (spec.x + spec.width)) {
-                    // nonexistant columns
-                    memset(result, 0, formatpixelsize);
-                    result = (void*)((char*)result + formatpixelsize);
-                    continue;
-                }
-                tileid.x(x - ((x - spec.x) % spec.tile_width));
-                ok &= find_tile(tileid, thread_info);
-                TileRef& tile(thread_info->tile);
-                const char* data;
-                if (tile
-                    && (data = (const char*)tile->data(x, y, z, chbegin))) {
-                    convert_types(texfile->datatype(subimage), data, format,
-                                  result, actualchannels);
-                    for (int c = actualchannels; c < nchannels; ++c)
-                        convert_types(TypeDesc::FLOAT, &options.fill, format,
-                                      (char*)result + c * formatchannelsize, 1);
-                } else {
-                    memset(result, 0, formatpixelsize);
-                }
-                result = (void*)((char*)result + formatpixelsize);
+            stride_t pixelsize = tile->pixelsize();
+            if (actualchannels)
+                ok &= convert_image(actualchannels, xb - xa, yb - ya, zb - za,
+                                    src, datatype, pixelsize, pixelsize * tw,
+                                    pixelsize * tw * th, dst, format,
+                                    formatpixelsize, scanlinesize, zplanesize);
+            if (fillpixel.size()) {
+                size_t fillbytes = (nchannels - actualchannels)
+                                   * formatchannelsize;
+                size_t filloffset = actualchannels * formatchannelsize;
+                for (int z = za; z < zb; ++z)
+                    for (int y = ya; y < yb; ++y) {
+                        char* d = dst + (z - za) * zplanesize
+                                  + (y - ya) * scanlinesize;
+                        for (int x = xa; x < xb; ++x, d += formatpixelsize)
+                            memcpy(d + filloffset, &fillpixel[filloffset],
+                                   fillbytes);
+                    }
             }
         }
+        return ok;
+    };
+
+    bool ok = true;
+    int64_t nrows = int64_t(ntrows) * ntplane;
+    if (m_get_texels_threads != 1 && nrows > 1) {
+        std::atomic<bool> allok(true);
+        parallel_for(
+            0, nrows,
+            [&](int64_t r) {
+                if (!tile_row(r, m_imagecache->get_perthread_info()))
+                    allok = false;
+            },
+            parallel_options(m_get_texels_threads, Split_Y, 1));
+        ok = allok;
+    } else {
+        for (int64_t r = 0; r < nrows; ++r)
+            ok &= tile_row(r, thread_info);
     }
     if (!ok) {
         std::string err = m_imagecache->geterror();
@@ -788,16 +1119,126 @@ TextureSystemImpl::get_texels(TextureHandle* texture_handle_,
 
 
 
+bool
+TextureSystemImpl::get_tile_feedback(ustring filename, int subimage,
+                                     int miplevel, std::vector<uint64_t>& tiles,
+                                     bool reset)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info();
+    TextureFile* texfile       = find_texturefile(filename, thread_info);
+    if (!texfile) {
+        errorf("Texture file \"%s\" not found", filename);
+        return false;
+    }
+    if (texfile->broken()) {
+        if (texfile->errors_should_issue())
+            errorf("Invalid texture file \"%s\"", texfile->filename());
+        return false;
+    }
+    if (subimage < 0 || subimage >= texfile->subimages()) {
+        errorf("get_tile_feedback asked for nonexistant subimage %d of \"%s\"",
+               subimage, texfile->filename());
+        return false;
+    }
+    if (miplevel < 0 || miplevel >= texfile->miplevels(subimage)) {
+        errorf(
+            "get_tile_feedback asked for nonexistant MIP level %d of \"%s\"",
+            miplevel, texfile->filename());
+        return false;
+    }
+    ImageCacheFile::LevelInfo& lev(texfile->levelinfo(subimage, miplevel));
+    int nwords = lev.tilebits_words();
+    tiles.resize(nwords);
+    for (int i = 0; i < nwords; ++i)
+        tiles[i] = uint64_t(reset ? lev.tiles_needed[i].exchange(0)
+                                  : lev.tiles_needed[i].load());
+    return true;
+}
+
+
+
+bool
+TextureSystemImpl::pin_levels(TextureHandle* texture_handle_,
+                              Perthread* thread_info_, int subimage,
+                              int miplevel_begin, int miplevel_end, bool pin)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texfile = verify_texturefile((TextureFile*)texture_handle_,
+                                              thread_info);
+    if (!texfile) {
+        errorf("Invalid texture handle NULL");
+        return false;
+    }
+    if (!m_imagecache->pin_levels(texfile, thread_info, subimage,
+                                  miplevel_begin, miplevel_end, pin)) {
+        std::string err = m_imagecache->geterror();
+        if (err.size())
+            errorf("%s", err);
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+TextureSystemImpl::pin(ustring filename, int subimage, int miplevel_begin,
+                       int miplevel_end)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info();
+    TextureFile* texfile       = find_texturefile(filename, thread_info);
+    if (!texfile) {
+        errorf("Texture file \"%s\" not found", filename);
+        return false;
+    }
+    return pin_levels((TextureHandle*)texfile, (Perthread*)thread_info,
+                      subimage, miplevel_begin, miplevel_end, true);
+}
+
+
+
+bool
+TextureSystemImpl::pin(TextureHandle* texture_handle, Perthread* thread_info,
+                       int subimage, int miplevel_begin, int miplevel_end)
+{
+    return pin_levels(texture_handle, thread_info, subimage, miplevel_begin,
+                      miplevel_end, true);
+}
+
+
+
+bool
+TextureSystemImpl::unpin(ustring filename, int subimage, int miplevel_begin,
+                         int miplevel_end)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info();
+    TextureFile* texfile       = find_texturefile(filename, thread_info);
+    if (!texfile) {
+        errorf("Texture file \"%s\" not found", filename);
+        return false;
+    }
+    return pin_levels((TextureHandle*)texfile, (Perthread*)thread_info,
+                      subimage, miplevel_begin, miplevel_end, false);
+}
+
+
+
+bool
+TextureSystemImpl::unpin(TextureHandle* texture_handle, Perthread* thread_info,
+                         int subimage, int miplevel_begin, int miplevel_end)
+{
+    return pin_levels(texture_handle, thread_info, subimage, miplevel_begin,
+                      miplevel_end, false);
+}
+
+
+
 std::string
 TextureSystemImpl::geterror() const
 {
-    std::string e;
-    std::string* errptr = m_errormessage.get();
-    if (errptr) {
-        e = *errptr;
-        errptr->clear();
-    }
-    return e;
+    ErrorRecord* errors = m_errors.get();
+    return errors ? errors->get() : std::string();
 }
 
 
@@ -805,17 +1246,12 @@ TextureSystemImpl::geterror() const
 void
 TextureSystemImpl::append_error(const std::string& message) const
 {
-    std::string* errptr = m_errormessage.get();
-    if (!errptr) {
-        errptr = new std::string;
-        m_errormessage.reset(errptr);
+    ErrorRecord* errors = m_errors.get();
+    if (!errors) {
+        errors = new ErrorRecord;
+        m_errors.reset(errors);
     }
-    ASSERT(errptr != NULL);
-    ASSERT(errptr->size() < 1024 * 1024 * 16
-           && "Accumulated error messages > 16MB. Try checking return codes!");
-    if (errptr->size())
-        *errptr += '\n';
-    *errptr += message;
+    errors->append(message);
 }
 
 
@@ -1025,12 +1461,17 @@ TextureSystemImpl::texture(TextureHandle* texture_handle_,
         &TextureSystemImpl::texture_lookup_nomip,
         &TextureSystemImpl::texture_lookup_trilinear_mipmap,
         &TextureSystemImpl::texture_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture_lookup
+        &TextureSystemImpl::texture_lookup,
+        &TextureSystemImpl::texture_lookup_ewa,
+        &TextureSystemImpl::texture_lookup_stochastic,
+        &TextureSystemImpl::texture_lookup_stochastic,
+        &TextureSystemImpl::texture_lookup_sat
     };
     texture_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
 
     PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
         (PerThreadInfo*)thread_info_);
+    CostTagScope costscope(thread_info, 1);
     TextureFile* texturefile = (TextureFile*)texture_handle_;
     if (texturefile->is_udim())
         texturefile = m_imagecache->resolve_udim(texturefile, s, t);
@@ -1076,10 +1517,28 @@ TextureSystemImpl::texture(TextureHandle* texture_handle_,
     if (options.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
         options.twrap = TextureOpt::WrapPeriodicPow2;
 
-    if (subinfo.is_constant_image && options.swrap != TextureOpt::WrapBlack
-        && options.twrap != TextureOpt::WrapBlack) {
-        // Lookup of constant color texture, non-black wrap -- skip all the
-        // hard stuff.
+    // With black wrap, a constant texture still looks constant wherever
+    // the whole filter footprint is inside the image. The margin allows
+    // for bicubic support on the next-coarser MIP level than the filter
+    // width calls for, which is the widest any of the mip modes reach.
+    auto footprint_inside = [&]() {
+        if (!subinfo.full_pixel_range)
+            return false;
+        float ms = 4.0f * ((fabsf(dsdx) + fabsf(dsdy)) * options.swidth
+                           + options.sblur)
+                   + 2.0f / spec.width;
+        float mt = 4.0f * ((fabsf(dtdx) + fabsf(dtdy)) * options.twidth
+                           + options.tblur)
+                   + 2.0f / spec.height;
+        return s - ms >= 0.0f && s + ms <= 1.0f && t - mt >= 0.0f
+               && t + mt <= 1.0f;
+    };
+    if (subinfo.is_constant_image
+        && ((options.swrap != TextureOpt::WrapBlack
+             && options.twrap != TextureOpt::WrapBlack)
+            || footprint_inside())) {
+        // Lookup of constant color texture that can't see the black wrap
+        // region -- skip all the hard stuff.
         for (int c = 0; c < actualchannels; ++c)
             result[c] = subinfo.average_color[c + options.firstchannel];
         for (int c = actualchannels; c < nchannels; ++c)
@@ -1162,6 +1621,96 @@ TextureSystemImpl::texture(TextureHandle* texture_handle_,
 
 
 
+// The filter footprint math of texture_lookup -- adjust_width,
+// ellipse_axes, adjust_blur and anisotropic_aspect -- for all the lanes
+// of a batch at once. Instead of the angle of the major axis, its
+// direction (costheta, sintheta) is found with the half-angle identities,
+// so no trig is needed, and the minor axis comes from the determinant of
+// the derivatives, which keeps its precision in float where ellipse_axes
+// needs doubles.
+template<typename VFLOAT>
+inline void
+aniso_footprint_simd(VFLOAT dsdx, VFLOAT dtdx, VFLOAT dsdy, VFLOAT dtdy,
+                     const VFLOAT& swidth, const VFLOAT& twidth,
+                     const VFLOAT& sblur, const VFLOAT& tblur,
+                     const TextureOpt& options, VFLOAT& majorlength,
+                     VFLOAT& minorlength, VFLOAT& costheta, VFLOAT& sintheta,
+                     VFLOAT& aspect, VFLOAT& trueaspect)
+{
+    typedef typename VFLOAT::vbool_t VBOOL;
+
+    // adjust_width: scale by width, then replace degenerate derivatives
+    // by tiny ones, orthogonal to the other derivative if it is sane.
+    static const float eps = 1.0e-8f, eps2 = eps * eps;
+    dsdx *= swidth;
+    dtdx *= twidth;
+    dsdy *= swidth;
+    dtdy *= twidth;
+    VFLOAT dxlen2 = dsdx * dsdx + dtdx * dtdx;
+    VFLOAT dylen2 = dsdy * dsdy + dtdy * dtdy;
+    VBOOL tinyx = (dxlen2 < eps2), tinyy = (dylen2 < eps2);
+    VBOOL xonly = tinyx & !tinyy, yonly = tinyy & !tinyx, both = tinyx & tinyy;
+    VFLOAT xscale = eps / sqrt(max(dxlen2, VFLOAT(eps2)));
+    VFLOAT yscale = eps / sqrt(max(dylen2, VFLOAT(eps2)));
+    VFLOAT sdx = select(xonly, dtdy * yscale, dsdx);
+    VFLOAT tdx = select(xonly, -dsdy * yscale, dtdx);
+    VFLOAT sdy = select(yonly, -dtdx * xscale, dsdy);
+    VFLOAT tdy = select(yonly, dsdx * xscale, dtdy);
+    sdx        = select(both, VFLOAT(eps), sdx);
+    tdx        = select(both, VFLOAT::Zero(), tdx);
+    sdy        = select(both, VFLOAT::Zero(), sdy);
+    tdy        = select(both, VFLOAT(eps), tdy);
+
+    // ellipse_axes. A*C - B*B/4 is the squared determinant, and it is the
+    // product of the two eigenvalues, so minor = |det| / major.
+    VFLOAT A     = tdx * tdx + tdy * tdy;
+    VFLOAT B     = -2.0f * (sdx * tdx + sdy * tdy);
+    VFLOAT C     = sdx * sdx + sdy * sdy;
+    VFLOAT AmC   = A - C;
+    VFLOAT root  = sqrt(AmC * AmC + B * B);
+    VFLOAT major = sqrt(0.5f * (A + C + root));
+    VFLOAT det   = sdx * tdy - sdy * tdx;
+    majorlength  = min(major, VFLOAT(1000.0f));
+    minorlength  = min(abs(det) / major, VFLOAT(1000.0f));
+    // theta = atan2(B, A-C)/2 + pi/2, so cos(theta) = -sin(phi/2) and
+    // sin(theta) = cos(phi/2), where cos(phi) = (A-C)/root.
+    VFLOAT cosphi = select(root > 0.0f, AmC / root, VFLOAT(1.0f));
+    VFLOAT c2     = sqrt(max(0.5f * (1.0f + cosphi), VFLOAT::Zero()));
+    VFLOAT s2     = sqrt(max(0.5f * (1.0f - cosphi), VFLOAT::Zero()));
+    costheta      = select(B < 0.0f, s2, -s2);
+    sintheta      = c2;
+
+    // adjust_blur, swapping the axes (and turning theta by pi/2) where
+    // the blur made the minor axis the longer one.
+    majorlength += sblur * abs(costheta) + tblur * abs(sintheta);
+    minorlength += sblur * abs(sintheta) + tblur * abs(costheta);
+    VBOOL swap      = (minorlength > majorlength);
+    VFLOAT oldmajor = majorlength, oldcos = costheta;
+    majorlength     = select(swap, minorlength, majorlength);
+    minorlength     = select(swap, oldmajor, minorlength);
+    costheta        = select(swap, -sintheta, costheta);
+    sintheta        = select(swap, oldcos, sintheta);
+
+    // anisotropic_aspect
+    float aniso = float(options.anisotropic);
+    trueaspect  = min(max(majorlength / minorlength, VFLOAT(1.0f)),
+                      VFLOAT(1.0e6f));
+    VBOOL over  = (trueaspect > aniso);
+    aspect      = min(trueaspect, VFLOAT(aniso));
+    VFLOAT clampedmajor, clampedminor;
+    if (options.conservative_filter) {
+        clampedmajor = 0.5f * (majorlength + minorlength * aniso);
+        clampedminor = clampedmajor / aniso;
+    } else {
+        clampedmajor = minorlength * aniso;
+        clampedminor = minorlength;
+    }
+    majorlength = select(over, clampedmajor, majorlength);
+    minorlength = select(over, clampedminor, minorlength);
+}
+
+
+
 bool
 TextureSystemImpl::texture(ustring filename, TextureOptBatch& options,
                            Tex::RunMask mask, const float* s, const float* t,
@@ -1177,14 +1726,91 @@ TextureSystemImpl::texture(ustring filename, TextureOptBatch& options,
 
 
 bool
-TextureSystemImpl::texture(TextureHandle* texture_handle,
-                           Perthread* thread_info, TextureOptBatch& options,
-                           Tex::RunMask mask, const float* s, const float* t,
-                           const float* dsdx, const float* dtdx,
-                           const float* dsdy, const float* dtdy, int nchannels,
-                           float* result, float* dresultds, float* dresultdt)
+TextureSystemImpl::texture(TextureHandle* texture_handle_,
+                           Perthread* thread_info_, TextureOptBatch& options,
+                           Tex::RunMask mask, const float* s_, const float* t_,
+                           const float* dsdx_, const float* dtdx_,
+                           const float* dsdy_, const float* dtdy_,
+                           int nchannels, float* result, float* dresultds,
+                           float* dresultdt)
 {
-    // (FIXME) CHEAT! Texture points individually
+    typedef Tex::FloatWide FloatWide;
+    typedef FloatWide::vint_t IntWide;
+    typedef FloatWide::vbool_t BoolWide;
+
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    mask &= Tex::RunMaskOn;
+
+    // UDIM files resolve to a concrete file per tile. The active lanes are
+    // partitioned by UDIM tile (a batch usually touches only one to
+    // three), each distinct tile is resolved just once, and its lanes are
+    // looked up together as a batch of that concrete file. Lanes whose
+    // tile has no file go lane by lane, which handles the missing texture.
+    if (texturefile && texturefile->is_udim() && nchannels <= 4) {
+        OIIO_SIMD4_ALIGN float s[Tex::BatchWidth], t[Tex::BatchWidth];
+        uint64_t tile[Tex::BatchWidth];
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            // Same tile numbering and in-tile offsets as resolve_udim()
+            int utile = std::max(0, int(s_[i]));
+            int vtile = std::max(0, int(t_[i]));
+            s[i]      = s_[i] - utile;
+            t[i]      = t_[i] - vtile;
+            tile[i]   = (uint64_t(uint32_t(vtile)) << 32) | uint32_t(utile);
+        }
+        bool ok              = true;
+        Tex::RunMask pending = mask, missing = 0;
+        for (int first = 0; pending; ++first) {
+            Tex::RunMask bit = Tex::RunMask(1) << first;
+            if (!(pending & bit))
+                continue;
+            Tex::RunMask group = 0;
+            for (int i = first; i < Tex::BatchWidth; ++i)
+                if (tile[i] == tile[first])
+                    group |= Tex::RunMask(1) << i;
+            group &= pending;
+            pending &= ~group;
+            float ss = s_[first], tt = t_[first];
+            TextureFile* file = m_imagecache->resolve_udim(texturefile, ss,
+                                                           tt);
+            if (!file) {
+                missing |= group;
+                continue;
+            }
+            ok &= texture((TextureHandle*)file, thread_info_, options, group,
+                          s, t, dsdx_, dtdx_, dsdy_, dtdy_, nchannels, result,
+                          dresultds, dresultdt);
+        }
+        if (missing)
+            ok &= texture_batch_per_lane(texture_handle_, thread_info_,
+                                         options, missing, s_, t_, dsdx_,
+                                         dtdx_, dsdy_, dtdy_, nchannels,
+                                         result, dresultds, dresultdt);
+        return ok;
+    }
+
+    // >4 channel lookups are split by recursion in the single-point
+    // texture(), so those simply go lane by lane.
+    if (!texturefile || texturefile->is_udim() || nchannels > 4)
+        return texture_batch_per_lane(texture_handle_, thread_info_, options,
+                                      mask, s_, t_, dsdx_, dtdx_, dsdy_,
+                                      dtdy_, nchannels, result, dresultds,
+                                      dresultdt);
+
+    // Everything that is uniform across the batch -- finding the file,
+    // resolving subimage names and wrap modes, the constant-image check --
+    // is done just once for all the lanes.
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    texturefile = verify_texturefile(texturefile, thread_info);
+
+    int nlanes = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        nlanes += (mask >> i) & 1;
+    CostTagScope costscope(thread_info, nlanes);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture_batches;
+    stats.texture_queries += nlanes;
+
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
@@ -1197,34 +1823,628 @@ TextureSystemImpl::texture(TextureHandle* texture_handle,
     opt.conservative_filter = options.conservative_filter;
     opt.fill                = options.fill;
     opt.missingcolor        = options.missingcolor;
-    // rwrap not needed for 2D texture
 
-    bool ok          = true;
-    Tex::RunMask bit = 1;
-    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4];  // temp result
-        if (mask & bit) {
-            opt.sblur  = options.sblur[i];
-            opt.tblur  = options.tblur[i];
-            opt.swidth = options.swidth[i];
-            opt.twidth = options.twidth[i];
-            // rblur, rwidth not needed for 2D texture
-            if (dresultds) {
-                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
-                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r,
-                              drds, drdt);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i]    = r[c];
-                    dresultds[c * Tex::BatchWidth + i] = drds[c];
-                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
-                }
-            } else {
-                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
-                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i] = r[c];
-                }
-            }
+    // Scatter one lane's (vfloat4-padded) results into the SOA outputs.
+    auto store_lane = [&](int lane, const float* r, const float* drds,
+                          const float* drdt) {
+        for (int c = 0; c < nchannels; ++c)
+            result[c * Tex::BatchWidth + lane] = r[c];
+        if (dresultds) {
+            for (int c = 0; c < nchannels; ++c) {
+                dresultds[c * Tex::BatchWidth + lane] = drds[c];
+                dresultdt[c * Tex::BatchWidth + lane] = drdt[c];
+            }
+        }
+    };
+    auto missing_all = [&]() -> bool {
+        bool ok = true;
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (mask & (Tex::RunMask(1) << i)) {
+                float r[4], drds[4], drdt[4];
+                ok &= missing_texture(opt, nchannels, r, drds, drdt);
+                store_lane(i, r, drds, drdt);
+            }
+        }
+        return ok;
+    };
+
+    if (!texturefile || texturefile->broken())
+        return missing_all();
+
+    if (!opt.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int sub = m_imagecache->subimage_from_name(texturefile,
+                                                   opt.subimagename);
+        if (sub < 0) {
+            errorf("Unknown subimage \"%s\" in texture \"%s\"",
+                   opt.subimagename, texturefile->filename());
+            return missing_all();
+        }
+        opt.subimage = sub;
+        opt.subimagename.clear();
+    }
+
+    const ImageCacheFile::SubimageInfo& subinfo(
+        texturefile->subimageinfo(opt.subimage));
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+    int actualchannels = Imath::clamp(spec.nchannels - opt.firstchannel, 0,
+                                      nchannels);
+    bool gray_fill = (actualchannels < nchannels && opt.firstchannel == 0
+                      && m_gray_to_rgb);
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+
+    if (subinfo.is_constant_image && opt.swrap != TextureOpt::WrapBlack
+        && opt.twrap != TextureOpt::WrapBlack) {
+        // Lookup of constant color texture, non-black wrap -- skip all the
+        // hard stuff, every lane gets the same answer.
+        OIIO_SIMD4_ALIGN float r[4]    = { 0.0f, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int c = 0; c < actualchannels; ++c)
+            r[c] = subinfo.average_color[c + opt.firstchannel];
+        for (int c = actualchannels; c < nchannels; ++c)
+            r[c] = opt.fill;
+        if (gray_fill)
+            fill_gray_channels(spec, nchannels, r, nullptr, nullptr);
+        for (int i = 0; i < Tex::BatchWidth; ++i)
+            if (mask & (Tex::RunMask(1) << i))
+                store_lane(i, r, zero, zero);
+        return true;
+    }
+
+    // Transform the coordinates and derivatives of all lanes at once.
+    FloatWide S(s_), T(t_);
+    FloatWide Dsdx(dsdx_), Dtdx(dtdx_), Dsdy(dsdy_), Dtdy(dtdy_);
+    if (m_flip_t) {
+        T    = 1.0f - T;
+        Dtdx = -Dtdx;
+        Dtdy = -Dtdy;
+    }
+    if (!subinfo.full_pixel_range) {  // remap st for overscan or crop
+        S    = S * subinfo.sscale + subinfo.soffset;
+        Dsdx = Dsdx * subinfo.sscale;
+        Dsdy = Dsdy * subinfo.sscale;
+        T    = T * subinfo.tscale + subinfo.toffset;
+        Dtdx = Dtdx * subinfo.tscale;
+        Dtdy = Dtdy * subinfo.tscale;
+    }
+
+    // Filter footprint and MIP level selection for all lanes at once.
+    // For the default and anisotropic modes this is all of the footprint
+    // math of texture_lookup. For the others it is exactly the trilinear
+    // level choice (see compute_miplevels), which for EWA, SAT and the
+    // stochastic modes serves as the estimate of which level each lane
+    // will touch, used to order the lanes below.
+    bool vaniso = (opt.mipmode == TextureOpt::MipModeDefault
+                   || opt.mipmode == TextureOpt::MipModeAniso);
+    FloatWide SWidth(options.swidth), TWidth(options.twidth);
+    FloatWide Filtwidth, Major, Minor, Costheta, Sintheta, Aspect, Trueaspect;
+    IntWide Naturalsres, Naturaltres;
+    if (vaniso) {
+        // Natural resolution of the bare derivs, to know when we're
+        // maxifying (and therefore want cubic interpolation).
+        Naturalsres = IntWide(1.0f / max(max(abs(Dsdx), abs(Dsdy)), 1e-8f));
+        Naturaltres = IntWide(1.0f / max(max(abs(Dtdx), abs(Dtdy)), 1e-8f));
+        aniso_footprint_simd(Dsdx, Dtdx, Dsdy, Dtdy, SWidth, TWidth,
+                             FloatWide(options.sblur),
+                             FloatWide(options.tblur), opt, Major, Minor,
+                             Costheta, Sintheta, Aspect, Trueaspect);
+        Filtwidth = Minor;
+    } else {
+        FloatWide Sfilt = max(abs(Dsdx * SWidth), abs(Dsdy * SWidth));
+        FloatWide Tfilt = max(abs(Dtdx * TWidth), abs(Dtdy * TWidth));
+        Filtwidth = opt.conservative_filter ? max(Sfilt, Tfilt)
+                                            : min(Sfilt, Tfilt);
+        Filtwidth += max(FloatWide(options.sblur), FloatWide(options.tblur));
+    }
+
+    const float* minres = subinfo.minres.data();
+    int nmiplevels      = (int)subinfo.minres.size();
+    // No lane wants a level finer than the one for the narrowest filter,
+    // found as in compute_miplevels, so the scan can start there.
+    float minfilt = std::numeric_limits<float>::max();
+    for (int i = 0; i < Tex::BatchWidth; ++i)
+        if (mask & (Tex::RunMask(1) << i))
+            minfilt = std::min(minfilt, Filtwidth[i]);
+    int mstart = 0;
+    if (minfilt * minres[0] > 1.0f)
+        mstart = std::min(int(ceilf(fast_log2(minfilt * minres[0]))),
+                          nmiplevels);
+    while (mstart > 0 && minfilt * minres[mstart - 1] <= 1.0f)
+        --mstart;
+    IntWide Level0(-1), Level1(-1);
+    FloatWide Levelblend(0.0f);
+    for (int m = mstart; m < nmiplevels; ++m) {
+        FloatWide filtwidth_ras = Filtwidth * minres[m];
+        BoolWide found          = (filtwidth_ras <= 1.0f) & (Level1 < 0);
+        Level0                  = blend(Level0, IntWide(m - 1), found);
+        Level1                  = blend(Level1, IntWide(m), found);
+        Levelblend = blend(Levelblend,
+                           min(max(2.0f * filtwidth_ras - 1.0f, 0.0f), 1.0f),
+                           found);
+        if (all(Level1 >= 0))
+            break;
+    }
+    BoolWide coarsest = (Level1 < 0);  // want blurrier than we have
+    Level0            = blend(Level0, IntWide(nmiplevels - 1), coarsest);
+    Level1            = blend(Level1, IntWide(nmiplevels - 1), coarsest);
+    BoolWide finest   = (Level0 < 0);  // want sharper than we have
+    Level0            = blend(Level0, IntWide(0), finest);
+    Level1            = blend(Level1, IntWide(0), finest);
+    Levelblend        = blend0not(Levelblend, coarsest | finest);
+    if (opt.mipmode == TextureOpt::MipModeOneLevel) {
+        Level0     = Level1;
+        Levelblend = 0.0f;
+    } else if (opt.mipmode == TextureOpt::MipModeNoMIP) {
+        Level0     = 0;
+        Level1     = 0;
+        Levelblend = 0.0f;
+    }
+
+    // The anisotropic probes: how many along the major axis of each lane,
+    // how far apart, and their weights, as in compute_ellipse_sampling.
+    int nsamples[Tex::BatchWidth];
+    int maxsamples    = 0;
+    float* lineweight = nullptr;
+    FloatWide Smajor, Tmajor;
+    if (vaniso) {
+        // As in compute_miplevels: where even the finest level is too
+        // coarse for the minor axis, don't bother with probes closer
+        // together than half a texel.
+        const ImageSpec& spec0(subinfo.spec(0));
+        float res = float(std::max(spec0.full_width, spec0.full_height));
+        Aspect    = select(finest & (Minor * res < 0.5f),
+                           min(max(Major * (2.0f * res), FloatWide(1.0f)),
+                               FloatWide(float(opt.anisotropic))),
+                           Aspect);
+        IntWide Nsamples = max(IntWide(1), IntWide(2.0f * Aspect - 1.0f));
+        FloatWide L      = 2.0f * (Major - Minor);
+        // The derivs are pixel-to-pixel, so the axes are semi-axes.
+        Smajor = Costheta * L * 0.5f;
+        Tmajor = Sintheta * L * 0.5f;
+        Nsamples.store(nsamples);
+        for (int i = 0; i < Tex::BatchWidth; ++i) {
+            if (!(mask & (Tex::RunMask(1) << i)))
+                nsamples[i] = 0;
+            maxsamples = std::max(maxsamples, nsamples[i]);
+        }
+        // Gaussian weights along the line, all lanes at once. With one or
+        // two probes they are all equal.
+        lineweight = OIIO_ALLOCA(float, maxsamples * Tex::BatchWidth);
+        FloatWide Invsamples = 1.0f / FloatWide(Nsamples);
+        FloatWide Scale      = select(Nsamples > 2, Major / L,
+                                      FloatWide::Zero());
+        FloatWide Sumw       = FloatWide::Zero();
+        for (int k = 0; k < maxsamples; ++k) {
+            FloatWide x = (2.0f * (k + 0.5f) * Invsamples - 1.0f) * Scale;
+#ifdef TEX_FAST_MATH
+            FloatWide w = fast_exp(-2.0f * x * x);
+#else
+            FloatWide w = exp(-2.0f * x * x);
+#endif
+            w = select(IntWide(k) < Nsamples, w, FloatWide::Zero());
+            w.store(lineweight + k * Tex::BatchWidth);
+            Sumw += w;
+        }
+        FloatWide Invsumw = 1.0f / Sumw;
+        for (int k = 0; k < maxsamples; ++k) {
+            float* w = lineweight + k * Tex::BatchWidth;
+            (FloatWide(w) * Invsumw).store(w);
+        }
+        float maxaniso = 0.0f;
+        for (int i = 0; i < Tex::BatchWidth; ++i)
+            if (nsamples[i])
+                maxaniso = std::max(maxaniso, Trueaspect[i]);
+        if (maxaniso > stats.max_aniso)
+            stats.max_aniso = maxaniso;  // FIXME?
+    }
+
+    // Visit the lanes in an order that groups together those that land on
+    // the same tile of the same MIP level, so that consecutive lookups are
+    // served by the per-thread tile microcache rather than the main cache.
+    int lanes[Tex::BatchWidth];
+    uint64_t lanekey[Tex::BatchWidth];
+    int nactive = 0;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        if (!(mask & (Tex::RunMask(1) << i)))
+            continue;
+        int lev                = Level0[i];
+        const ImageSpec& lspec = subinfo.spec(lev);
+        int tx = ifloor(S[i] * lspec.width) / std::max(lspec.tile_width, 1);
+        int ty = ifloor(T[i] * lspec.height) / std::max(lspec.tile_height, 1);
+        lanekey[i] = (uint64_t(lev) << 48)
+                     | (uint64_t(uint32_t(ty) & 0xffffff) << 24)
+                     | uint64_t(uint32_t(tx) & 0xffffff);
+        lanes[nactive++] = i;
+    }
+    std::stable_sort(lanes, lanes + nactive,
+                     [&](int a, int b) { return lanekey[a] < lanekey[b]; });
+
+    static const sampler_prototype sample_functions[] = {
+        // Must be in the same order as InterpMode enum
+        &TextureSystemImpl::sample_closest,
+        &TextureSystemImpl::sample_bilinear,
+        &TextureSystemImpl::sample_bicubic,
+        &TextureSystemImpl::sample_bilinear,
+    };
+    sampler_prototype sampler = sample_functions[(int)opt.interpmode];
+    bool stochastic = (opt.mipmode == TextureOpt::MipModeStochasticTrilinear
+                       || opt.mipmode == TextureOpt::MipModeStochasticAniso);
+    bool aniso      = (opt.mipmode == TextureOpt::MipModeDefault
+                  || opt.mipmode == TextureOpt::MipModeAniso
+                  || opt.mipmode == TextureOpt::MipModeEWA
+                  || opt.mipmode == TextureOpt::MipModeSummedArea
+                  || stochastic);
+    texture_lookup_prototype lookup = &TextureSystemImpl::texture_lookup;
+    if (opt.mipmode == TextureOpt::MipModeEWA)
+        lookup = &TextureSystemImpl::texture_lookup_ewa;
+    else if (opt.mipmode == TextureOpt::MipModeSummedArea)
+        lookup = &TextureSystemImpl::texture_lookup_sat;
+    else if (stochastic)
+        lookup = &TextureSystemImpl::texture_lookup_stochastic;
+
+    bool ok       = true;
+    int npointson = 0;
+    vfloat4 aniso_r[Tex::BatchWidth], aniso_drds[Tex::BatchWidth],
+        aniso_drdt[Tex::BatchWidth];
+    if (vaniso) {
+        float sval[Tex::BatchWidth], tval[Tex::BatchWidth];
+        float smajor[Tex::BatchWidth], tmajor[Tex::BatchWidth];
+        float lblend[Tex::BatchWidth];
+        int miplevel[2][Tex::BatchWidth], naturalres[2][Tex::BatchWidth];
+        S.store(sval);
+        T.store(tval);
+        Smajor.store(smajor);
+        Tmajor.store(tmajor);
+        Levelblend.store(lblend);
+        Level0.store(miplevel[0]);
+        Level1.store(miplevel[1]);
+        Naturalsres.store(naturalres[0]);
+        Naturaltres.store(naturalres[1]);
+        ok &= sample_aniso_batch(*texturefile, thread_info, opt, nchannels,
+                                 actualchannels, lanes, nactive, sval, tval,
+                                 smajor, tmajor, nsamples, lineweight,
+                                 miplevel[0], miplevel[1], lblend,
+                                 naturalres[0], naturalres[1], aniso_r,
+                                 dresultds ? aniso_drds : nullptr,
+                                 dresultds ? aniso_drdt : nullptr);
+    }
+    for (int l = 0; l < nactive; ++l) {
+        int i = lanes[l];
+        vfloat4 r, drds, drdt;
+        float* drds_ptr = dresultds ? (float*)&drds : nullptr;
+        float* drdt_ptr = dresultds ? (float*)&drdt : nullptr;
+        if (vaniso) {
+            r = aniso_r[i];
+            if (dresultds) {
+                drds = aniso_drds[i];
+                drdt = aniso_drdt[i];
+            }
+        } else if (aniso) {
+            opt.sblur  = options.sblur[i];
+            opt.tblur  = options.tblur[i];
+            opt.swidth = options.swidth[i];
+            opt.twidth = options.twidth[i];
+            if (stochastic)
+                opt.rnd = options.rnd[i];
+            ok &= (this->*lookup)(*texturefile, thread_info, opt, nchannels,
+                                  actualchannels, S[i], T[i], Dsdx[i],
+                                  Dtdx[i], Dsdy[i], Dtdy[i], (float*)&r,
+                                  drds_ptr, drdt_ptr);
+        } else {
+            // Point, one-level and trilinear lookups: the levels and weights
+            // were already computed above, go straight to the sampler.
+            OIIO_SIMD4_ALIGN float sval[4]   = { S[i], 0.0f, 0.0f, 0.0f };
+            OIIO_SIMD4_ALIGN float tval[4]   = { T[i], 0.0f, 0.0f, 0.0f };
+            OIIO_SIMD4_ALIGN float weight[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+            float lblend                     = Levelblend[i];
+            int miplevel[2]                  = { Level0[i], Level1[i] };
+            float levelweight[2]             = { 1.0f - lblend, lblend };
+            r.clear();
+            if (dresultds) {
+                drds.clear();
+                drdt.clear();
+            }
+            for (int level = 0; level < 2; ++level) {
+                if (!levelweight[level])
+                    continue;
+                vfloat4 lr, ldrds, ldrdt;
+                ok &= (this->*sampler)(1, sval, tval, miplevel[level],
+                                       *texturefile, thread_info, opt,
+                                       nchannels, actualchannels, weight, &lr,
+                                       dresultds ? &ldrds : nullptr,
+                                       dresultds ? &ldrdt : nullptr);
+                ++npointson;
+                vfloat4 lw = levelweight[level];
+                r += lw * lr;
+                if (dresultds) {
+                    drds += lw * ldrds;
+                    drdt += lw * ldrdt;
+                }
+            }
+        }
+        if (gray_fill)
+            fill_gray_channels(spec, nchannels, (float*)&r, drds_ptr,
+                               drdt_ptr);
+        if (m_flip_t && dresultds)
+            drdt = -drdt;
+        store_lane(i, (const float*)&r, drds_ptr, drdt_ptr);
+    }
+
+    if (!aniso) {
+        // Update stats (texture_lookup does its own for the aniso case)
+        stats.aniso_queries += npointson;
+        stats.aniso_probes += npointson;
+        switch (opt.interpmode) {
+        case TextureOpt::InterpClosest:
+            stats.closest_interps += npointson;
+            break;
+        case TextureOpt::InterpBilinear:
+            stats.bilinear_interps += npointson;
+            break;
+        case TextureOpt::InterpBicubic: stats.cubic_interps += npointson; break;
+        case TextureOpt::InterpSmartBicubic:
+            stats.bilinear_interps += npointson;
+            break;
+        }
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_coherent(ustring filename, TextureOpt& options,
+                                    int npoints, const float* s,
+                                    const float* t, const float* dsdx,
+                                    const float* dtdx, const float* dsdy,
+                                    const float* dtdy, int nchannels,
+                                    float* result, float* dresultds,
+                                    float* dresultdt)
+{
+    Perthread* thread_info        = get_perthread_info();
+    TextureHandle* texture_handle = get_texture_handle(filename, thread_info);
+    return texture_coherent(texture_handle, thread_info, options, npoints, s,
+                            t, dsdx, dtdx, dsdy, dtdy, nchannels, result,
+                            dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::texture_coherent(TextureHandle* texture_handle_,
+                                    Perthread* thread_info_,
+                                    TextureOpt& options, int npoints,
+                                    const float* s, const float* t,
+                                    const float* dsdx, const float* dtdx,
+                                    const float* dsdy, const float* dtdy,
+                                    int nchannels, float* result,
+                                    float* dresultds, float* dresultdt)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    bool udim                = texturefile && texturefile->is_udim();
+    if (texturefile && !udim)
+        texturefile = verify_texturefile(texturefile, thread_info);
+
+    // Order the queries by a key made of the UDIM tile (if any), the MIP
+    // level the lookup will favor, and the tile of that level containing
+    // (s,t). It's only a guess of what the filter will touch, but it is
+    // enough to make consecutive lookups hit the same few tiles. Small
+    // sets aren't worth sorting.
+    std::vector<std::pair<uint64_t, int>> order(npoints);
+    for (int i = 0; i < npoints; ++i)
+        order[i] = std::make_pair(uint64_t(0), i);
+    if (npoints > Tex::BatchWidth && texturefile && !texturefile->broken()) {
+        int subimage = options.subimage;
+        if (!udim && !options.subimagename.empty())
+            subimage = std::max(0, m_imagecache->subimage_from_name(
+                                       texturefile, options.subimagename));
+        int nlevels = udim ? 0 : texturefile->miplevels(subimage);
+        bool minor = (options.mipmode == TextureOpt::MipModeDefault
+                      || options.mipmode == TextureOpt::MipModeAniso
+                      || options.mipmode == TextureOpt::MipModeEWA
+                      || options.mipmode
+                             == TextureOpt::MipModeStochasticAniso);
+        for (int i = 0; i < npoints; ++i) {
+            uint64_t key = 0;
+            float ss = s[i], tt = t[i];
+            if (udim) {
+                int u = clamp(ifloor(ss), 0, 255);
+                int v = clamp(ifloor(tt), 0, 255);
+                key   = uint64_t(v * 256 + u) << 48;
+            }
+            if (nlevels) {
+                const ImageSpec& spec0(texturefile->spec(subimage, 0));
+                float xlen  = hypotf(dsdx[i] * spec0.width,
+                                    dtdx[i] * spec0.height);
+                float ylen  = hypotf(dsdy[i] * spec0.width,
+                                    dtdy[i] * spec0.height);
+                float width = minor ? std::min(xlen, ylen)
+                                    : std::max(xlen, ylen);
+                int level   = 0;
+                if (width > 1.0f)  // NaN falls through to level 0
+                    level = std::min(int(log2f(width)), nlevels - 1);
+                const ImageSpec& spec(texturefile->spec(subimage, level));
+                ss -= floorf(ss);
+                tt -= floorf(tt);
+                int tx = clamp(int(ss * spec.width), 0, spec.width - 1)
+                         / std::max(spec.tile_width, 1);
+                int ty = clamp(int(tt * spec.height), 0, spec.height - 1)
+                         / std::max(spec.tile_height, 1);
+                key |= (uint64_t(level) << 40) | (uint64_t(ty & 0xfffff) << 20)
+                       | uint64_t(tx & 0xfffff);
+            }
+            order[i].first = key;
+        }
+        std::sort(order.begin(), order.end());
+    }
+
+    bool ok = true;
+    for (auto& o : order) {
+        int i = o.second;
+        ok &= texture(texture_handle_, (Perthread*)thread_info, options, s[i],
+                      t[i], dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels,
+                      result + i * nchannels,
+                      dresultds ? dresultds + i * nchannels : nullptr,
+                      dresultdt ? dresultdt + i * nchannels : nullptr);
+    }
+    return ok;
+}
+
+
+
+// The MIP modes texture_lod honors as given; all the others, which only
+// differ in how they use the derivatives, become trilinear.
+static TextureOpt::MipMode
+lod_mipmode(TextureOpt::MipMode mode)
+{
+    if (mode == TextureOpt::MipModeNoMIP || mode == TextureOpt::MipModeOneLevel
+        || mode == TextureOpt::MipModeStochasticTrilinear)
+        return mode;
+    return TextureOpt::MipModeTrilinear;
+}
+
+
+
+bool
+TextureSystemImpl::texture_lod(ustring filename, TextureOpt& options, float s,
+                               float t, float width, int nchannels,
+                               float* result, float* dresultds,
+                               float* dresultdt)
+{
+    Perthread* thread_info        = get_perthread_info();
+    TextureHandle* texture_handle = get_texture_handle(filename, thread_info);
+    return texture_lod(texture_handle, thread_info, options, s, t, width,
+                       nchannels, result, dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::texture_lod(TextureHandle* texture_handle,
+                               Perthread* thread_info, TextureOpt& options,
+                               float s, float t, float width, int nchannels,
+                               float* result, float* dresultds,
+                               float* dresultdt)
+{
+    // An isotropic footprint of the given width makes the trilinear
+    // lookup pick its levels straight from the width.
+    TextureOpt::MipMode save_mipmode = options.mipmode;
+    options.mipmode                  = lod_mipmode(options.mipmode);
+    width                            = fabsf(width);
+    bool ok = texture(texture_handle, thread_info, options, s, t, width, 0.0f,
+                      0.0f, width, nchannels, result, dresultds, dresultdt);
+    options.mipmode = save_mipmode;  // restore what we changed
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_lod(ustring filename, TextureOptBatch& options,
+                               Tex::RunMask mask, const float* s,
+                               const float* t, const float* width,
+                               int nchannels, float* result, float* dresultds,
+                               float* dresultdt)
+{
+    Perthread* thread_info        = get_perthread_info();
+    TextureHandle* texture_handle = get_texture_handle(filename, thread_info);
+    return texture_lod(texture_handle, thread_info, options, mask, s, t, width,
+                       nchannels, result, dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::texture_lod(TextureHandle* texture_handle,
+                               Perthread* thread_info,
+                               TextureOptBatch& options, Tex::RunMask mask,
+                               const float* s, const float* t,
+                               const float* width, int nchannels,
+                               float* result, float* dresultds,
+                               float* dresultdt)
+{
+    OIIO_SIMD4_ALIGN float w[Tex::BatchWidth], zero[Tex::BatchWidth];
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        w[i]    = fabsf(width[i]);
+        zero[i] = 0.0f;
+    }
+    Tex::MipMode save_mipmode = options.mipmode;
+    options.mipmode           = (Tex::MipMode)lod_mipmode(
+        (TextureOpt::MipMode)options.mipmode);
+    bool ok = texture(texture_handle, thread_info, options, mask, s, t, w,
+                      zero, zero, w, nchannels, result, dresultds, dresultdt);
+    options.mipmode = save_mipmode;  // restore what we changed
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_batch_per_lane(
+    TextureHandle* texture_handle, Perthread* thread_info,
+    TextureOptBatch& options, Tex::RunMask mask, const float* s,
+    const float* t, const float* dsdx, const float* dtdx, const float* dsdy,
+    const float* dtdy, int nchannels, float* result, float* dresultds,
+    float* dresultdt)
+{
+    TextureOpt opt;
+    opt.firstchannel        = options.firstchannel;
+    opt.subimage            = options.subimage;
+    opt.subimagename        = options.subimagename;
+    opt.swrap               = (TextureOpt::Wrap)options.swrap;
+    opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
+    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
+    opt.anisotropic         = options.anisotropic;
+    opt.conservative_filter = options.conservative_filter;
+    opt.fill                = options.fill;
+    opt.missingcolor        = options.missingcolor;
+    // rwrap not needed for 2D texture
+
+    // temp results for one lane
+    float* r    = OIIO_ALLOCA(float, nchannels);
+    float* drds = OIIO_ALLOCA(float, nchannels);
+    float* drdt = OIIO_ALLOCA(float, nchannels);
+
+    bool ok          = true;
+    Tex::RunMask bit = 1;
+    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
+        if (mask & bit) {
+            opt.sblur  = options.sblur[i];
+            opt.tblur  = options.tblur[i];
+            opt.swidth = options.swidth[i];
+            opt.twidth = options.twidth[i];
+            // rblur, rwidth not needed for 2D texture
+            if (opt.mipmode == TextureOpt::MipModeStochasticTrilinear
+                || opt.mipmode == TextureOpt::MipModeStochasticAniso)
+                opt.rnd = options.rnd[i];
+            if (dresultds) {
+                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
+                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r,
+                              drds, drdt);
+                for (int c = 0; c < nchannels; ++c) {
+                    result[c * Tex::BatchWidth + i]    = r[c];
+                    dresultds[c * Tex::BatchWidth + i] = drds[c];
+                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
+                }
+            } else {
+                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
+                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r);
+                for (int c = 0; c < nchannels; ++c) {
+                    result[c * Tex::BatchWidth + i] = r[c];
+                }
+            }
         }
     }
     return ok;
@@ -1403,26 +2623,34 @@ compute_miplevels(TextureSystemImpl::TextureFile& texturefile,
 {
     ImageCacheFile::SubimageInfo& subinfo(
         texturefile.subimageinfo(options.subimage));
-    float levelblend = 0.0f;
-    int nmiplevels   = (int)subinfo.levels.size();
-    for (int m = 0; m < nmiplevels; ++m) {
-        // Compute the filter size (minor axis) in raster space at this
-        // MIP level.  We use the smaller of the two texture resolutions,
-        // which is better than just using one, but a more principled
-        // approach is desired but remains elusive.  FIXME.
-        float filtwidth_ras = minorlength
-                              * std::min(subinfo.spec(m).width,
-                                         subinfo.spec(m).height);
-        // Once the filter width is smaller than one texel at this level,
-        // we've gone too far, so we know that we want to interpolate the
-        // previous level and the current level.  Note that filtwidth_ras
-        // is expected to be >= 0.5, or would have stopped one level ago.
-        if (filtwidth_ras <= 1.0f) {
-            miplevel[0] = m - 1;
-            miplevel[1] = m;
-            levelblend  = Imath::clamp(2.0f * filtwidth_ras - 1.0f, 0.0f, 1.0f);
-            break;
-        }
+    float levelblend    = 0.0f;
+    const float* minres = subinfo.minres.data();
+    int nmiplevels      = (int)subinfo.minres.size();
+    // The filter size (minor axis) in raster space at MIP level m is
+    // minorlength * minres[m].  We use the smaller of the two texture
+    // resolutions, which is better than just using one, but a more
+    // principled approach is desired but remains elusive.  FIXME.
+    //
+    // We want the first level at which the filter is no wider than one
+    // texel, to interpolate it and the previous level.  Each level halves
+    // the resolution, so log2 of the filter width at the finest level
+    // says which one that is, give or take rounding of odd resolutions,
+    // which the neighboring levels are checked for.
+    int m            = 0;
+    float filtwidth0 = minorlength * minres[0];
+    if (filtwidth0 > 1.0f)
+        m = std::min(int(ceilf(fast_log2(filtwidth0))), nmiplevels);
+    while (m > 0 && minorlength * minres[m - 1] <= 1.0f)
+        --m;
+    while (m < nmiplevels && !(minorlength * minres[m] <= 1.0f))
+        ++m;
+    if (m < nmiplevels) {
+        // Note that the filter width is expected to be >= 0.5 here, or
+        // we would have stopped one level sooner.
+        float filtwidth_ras = minorlength * minres[m];
+        miplevel[0]         = m - 1;
+        miplevel[1]         = m;
+        levelblend = Imath::clamp(2.0f * filtwidth_ras - 1.0f, 0.0f, 1.0f);
     }
 
     if (miplevel[1] < 0) {
@@ -1642,13 +2870,26 @@ compute_ellipse_sampling(float aspect, float theta, float majorlength,
             weights[1] = 0.5f;
         } else {
             float scale = majorlength / L;  // 1/(L/major)
-            for (int i = 0, e = (nsamples + 1) / 2; i < e; ++i) {
-                float x = (2.0f * (i + 0.5f) * invsamples - 1.0f) * scale;
 #ifdef TEX_FAST_MATH
-                float w = fast_exp(-2.0f * x * x);
+            // Four weights at a time. The caller's weights are padded to
+            // a multiple of 4, and the padding is given zero weight.
+            vfloat4 iota(0.5f, 1.5f, 2.5f, 3.5f);
+            vfloat4 sumw = vfloat4::Zero();
+            for (int i = 0; i < nsamples; i += 4) {
+                vfloat4 x = (2.0f * iota * invsamples - 1.0f) * scale;
+                vfloat4 w = select(iota < float(nsamples),
+                                   fast_exp(-2.0f * x * x), vfloat4::Zero());
+                sumw += w;
+                w.store(weights + i);
+                iota += 4.0f;
+            }
+            vfloat4 invsumw = 1.0f / vfloat4(reduce_add(sumw));
+            for (int i = 0; i < nsamples; i += 4)
+                (vfloat4(weights + i) * invsumw).store(weights + i);
 #else
+            for (int i = 0, e = (nsamples + 1) / 2; i < e; ++i) {
+                float x = (2.0f * (i + 0.5f) * invsamples - 1.0f) * scale;
                 float w = expf(-2.0f * x * x);
-#endif
                 weights[nsamples - i - 1] = weights[i] = w;
             }
             float sumw = 0.0f;
@@ -1656,6 +2897,7 @@ compute_ellipse_sampling(float aspect, float theta, float majorlength,
                 sumw += weights[i];
             for (int i = 0; i < nsamples; ++i)
                 weights[i] /= sumw;
+#endif
         }
     }
     return nsamples;
@@ -1816,23 +3058,682 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
         }
     }
 
-    *(simd::vfloat4*)(result) = r_sum;
+    *(simd::vfloat4*)(result) = r_sum;
+    if (dresultds) {
+        *(simd::vfloat4*)(dresultds) = drds_sum;
+        *(simd::vfloat4*)(dresultdt) = drdt_sum;
+    }
+
+    // Update stats
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    stats.aniso_queries += npointson;
+    stats.aniso_probes += npointson * nsamples;
+    if (trueaspect > stats.max_aniso)
+        stats.max_aniso = trueaspect;  // FIXME?
+    stats.closest_interps += closestprobes * nsamples;
+    stats.bilinear_interps += bilinearprobes * nsamples;
+    stats.cubic_interps += bicubicprobes * nsamples;
+
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_lookup_stochastic(
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    int nchannels_result, int actualchannels, float s, float t, float dsdx,
+    float dtdx, float dsdy, float dtdy, float* result, float* dresultds,
+    float* dresultdt)
+{
+    DASSERT((dresultds == NULL) == (dresultdt == NULL));
+
+    // A lookup that wasn't handed a random number gets a repeatable one
+    // hashed from its coordinates.
+    float rnd = options.rnd;
+    if (!(rnd >= 0.0f && rnd < 1.0f)) {
+        uint32_t h = bjhash::bjfinal(bit_cast<float, uint32_t>(s),
+                                     bit_cast<float, uint32_t>(t));
+        rnd        = (h >> 8) * (1.0f / (1 << 24));
+    }
+
+    // Natural resolution of the bare derivs, to know when we're maxifying
+    // (and therefore want cubic interpolation), as in texture_lookup.
+    float sfilt_noblur = std::max(std::max(fabsf(dsdx), fabsf(dsdy)), 1e-8f);
+    float tfilt_noblur = std::max(std::max(fabsf(dtdx), fabsf(dtdy)), 1e-8f);
+    int naturalsres    = (int)(1.0f / sfilt_noblur);
+    int naturaltres    = (int)(1.0f / tfilt_noblur);
+
+    adjust_width(dsdx, dtdx, dsdy, dtdy, options.swidth, options.twidth);
+
+    // The same filter footprints and MIP levels as the deterministic
+    // trilinear and anisotropic lookups...
+    bool aniso_mode = (options.mipmode == TextureOpt::MipModeStochasticAniso);
+    int miplevel[2]      = { -1, -1 };
+    float levelweight[2] = { 0, 0 };
+    float majorlength, minorlength, theta, aspect = 1.0f, trueaspect = 1.0f;
+    if (aniso_mode) {
+        ellipse_axes(dsdx, dtdx, dsdy, dtdy, majorlength, minorlength, theta);
+        adjust_blur(majorlength, minorlength, theta, options.sblur,
+                    options.tblur);
+        aspect = anisotropic_aspect(majorlength, minorlength, options,
+                                    trueaspect);
+    } else {
+        float sfilt = std::max(fabsf(dsdx), fabsf(dsdy));
+        float tfilt = std::max(fabsf(dtdx), fabsf(dtdy));
+        majorlength = options.conservative_filter ? std::max(sfilt, tfilt)
+                                                  : std::min(sfilt, tfilt);
+        majorlength += std::max(options.sblur, options.tblur);
+        minorlength = majorlength;
+    }
+    compute_miplevels(texturefile, options, majorlength, minorlength, aspect,
+                      miplevel, levelweight);
+
+    // ...but rather than blend the two levels, pick one with probability
+    // equal to its weight, then rescale rnd to [0,1) so it can be reused
+    // for the choice along the major axis.
+    int lev;
+    if (rnd < levelweight[1]) {
+        lev = miplevel[1];
+        rnd = rnd / levelweight[1];
+    } else {
+        lev = miplevel[0];
+        rnd = (rnd - levelweight[1]) / levelweight[0];
+    }
+    rnd = std::min(rnd, 1.0f - std::numeric_limits<float>::epsilon());
+
+    OIIO_SIMD4_ALIGN float sval[4]   = { s, 0.0f, 0.0f, 0.0f };
+    OIIO_SIMD4_ALIGN float tval[4]   = { t, 0.0f, 0.0f, 0.0f };
+    OIIO_SIMD4_ALIGN float weight[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    if (aniso_mode) {
+        // Likewise pick one of the probes the anisotropic filter would
+        // have made, with probability equal to its line weight.
+        float* lineweight = ALLOCA(float, round_to_multiple_of_pow2(
+                                              2 * options.anisotropic, 4));
+        float smajor, tmajor, invsamples;
+        int nsamples = compute_ellipse_sampling(aspect, theta, majorlength,
+                                                minorlength, smajor, tmajor,
+                                                invsamples, lineweight);
+        int sample   = 0;
+        for (float cdf = lineweight[0]; sample < nsamples - 1 && rnd >= cdf;
+             cdf += lineweight[sample])
+            ++sample;
+        // See texture_lookup for the factor of 1/2
+        float pos = 2.0f * ((sample + 0.5f) * invsamples - 0.5f);
+        sval[0]   = s + pos * 0.5f * smajor;
+        tval[0]   = t + pos * 0.5f * tmajor;
+    }
+
+    sampler_prototype sampler;
+    long long* probecount;
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    switch (options.interpmode) {
+    case TextureOpt::InterpClosest:
+        sampler    = &TextureSystemImpl::sample_closest;
+        probecount = &stats.closest_interps;
+        break;
+    case TextureOpt::InterpBilinear:
+        sampler    = &TextureSystemImpl::sample_bilinear;
+        probecount = &stats.bilinear_interps;
+        break;
+    case TextureOpt::InterpBicubic:
+        sampler    = &TextureSystemImpl::sample_bicubic;
+        probecount = &stats.cubic_interps;
+        break;
+    default:
+        if (lev == 0
+            || (texturefile.spec(options.subimage, lev).width
+                < naturalsres / 2)
+            || (texturefile.spec(options.subimage, lev).height
+                < naturaltres / 2)) {
+            sampler    = &TextureSystemImpl::sample_bicubic;
+            probecount = &stats.cubic_interps;
+        } else {
+            sampler    = &TextureSystemImpl::sample_bilinear;
+            probecount = &stats.bilinear_interps;
+        }
+        break;
+    }
+    bool ok = (this->*sampler)(1, sval, tval, lev, texturefile, thread_info,
+                               options, nchannels_result, actualchannels,
+                               weight, (vfloat4*)result,
+                               (vfloat4*)dresultds, (vfloat4*)dresultdt);
+
+    // Update stats
+    ++stats.aniso_queries;
+    ++stats.aniso_probes;
+    ++*probecount;
+    if (trueaspect > stats.max_aniso)
+        stats.max_aniso = trueaspect;
+    return ok;
+}
+
+
+
+// Weights of the EWA Gaussian as a function of the squared elliptical
+// radius r^2 = Q(x) on [0,1), with the value at the ellipse boundary
+// subtracted so the filter falls smoothly to zero there (Greene & Heckbert).
+static const int ewa_lut_size  = 128;
+static const float ewa_alpha   = 2.0f;
+static const float ewa_falloff = expf(-ewa_alpha);
+
+static const float*
+ewa_weights()
+{
+    static const struct EWATable {
+        float w[ewa_lut_size];
+        EWATable()
+        {
+            for (int i = 0; i < ewa_lut_size; ++i) {
+                float r2 = (i + 0.5f) / ewa_lut_size;
+                w[i]     = (expf(-ewa_alpha * r2) - ewa_falloff)
+                       / (1.0f - ewa_falloff);
+            }
+        }
+    } table;
+    return table.w;
+}
+
+
+
+bool
+TextureSystemImpl::texture_lookup_ewa(TextureFile& texturefile,
+                                      PerThreadInfo* thread_info,
+                                      TextureOpt& options, int nchannels_result,
+                                      int actualchannels, float s, float t,
+                                      float dsdx, float dtdx, float dsdy,
+                                      float dtdy, float* result,
+                                      float* dresultds, float* dresultdt)
+{
+    DASSERT((dresultds == NULL) == (dresultdt == NULL));
+
+    // The footprint and MIP level choice are the same as for the
+    // anisotropic lookup; only the way the level is filtered differs.
+    adjust_width(dsdx, dtdx, dsdy, dtdy, options.swidth, options.twidth);
+    float majorlength, minorlength, theta;
+    ellipse_axes(dsdx, dtdx, dsdy, dtdy, majorlength, minorlength, theta);
+    adjust_blur(majorlength, minorlength, theta, options.sblur, options.tblur);
+    // Clamping the aspect ratio also bounds the number of texels the
+    // ellipse can cover at the level we pick, even at grazing angles.
+    float aspect, trueaspect;
+    aspect = anisotropic_aspect(majorlength, minorlength, options, trueaspect);
+
+    int miplevel[2]      = { -1, -1 };
+    float levelweight[2] = { 0, 0 };
+    compute_miplevels(texturefile, options, majorlength, minorlength, aspect,
+                      miplevel, levelweight);
+    float smajor, tmajor;
+    sincos(theta, &tmajor, &smajor);
+
+    bool ok           = true;
+    int npointson     = 0;
+    long long ntexels = 0;
+    vfloat4 r_sum, drds_sum, drdt_sum;
+    r_sum.clear();
+    if (dresultds) {
+        drds_sum.clear();
+        drdt_sum.clear();
+    }
+    for (int level = 0; level < 2; ++level) {
+        if (!levelweight[level])  // No contribution from this level, skip it
+            continue;
+        ++npointson;
+        vfloat4 r, drds, drdt;
+        // majorlength and minorlength are diameters (see ellipse_axes)
+        ok &= sample_ewa(s, t, 0.5f * majorlength, 0.5f * minorlength, smajor,
+                         tmajor, miplevel[level], texturefile, thread_info,
+                         options, nchannels_result, actualchannels, &r,
+                         dresultds ? &drds : NULL, dresultds ? &drdt : NULL,
+                         ntexels);
+        vfloat4 lw = levelweight[level];
+        r_sum += lw * r;
+        if (dresultds) {
+            drds_sum += lw * drds;
+            drdt_sum += lw * drdt;
+        }
+    }
+
+    *(simd::vfloat4*)(result) = r_sum;
+    if (dresultds) {
+        *(simd::vfloat4*)(dresultds) = drds_sum;
+        *(simd::vfloat4*)(dresultdt) = drdt_sum;
+    }
+
+    // Update stats
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    stats.aniso_queries += npointson;
+    stats.aniso_probes += npointson;
+    if (trueaspect > stats.max_aniso)
+        stats.max_aniso = trueaspect;
+    stats.ewa_texels += ntexels;
+    return ok;
+}
+
+
+
+std::shared_ptr<const SummedAreaTable>
+TextureSystemImpl::summed_area_table(TextureFile& texturefile,
+                                     PerThreadInfo* thread_info, int subimage)
+{
+    ImageCacheFile::SubimageInfo& subinfo(texturefile.subimageinfo(subimage));
+    {
+        spin_lock lock(subinfo.sat_mutex);
+        if (subinfo.sat || subinfo.sat_building)
+            return subinfo.sat;
+        subinfo.sat_building = true;
+    }
+
+    // This thread builds the table. Lookups in other threads fall back to
+    // the usual MIP filtering until it is published, rather than waiting.
+    std::shared_ptr<SummedAreaTable> sat;
+    int level = -1;
+    for (int m = 0, nlevels = subinfo.miplevels(); m < nlevels; ++m) {
+        const ImageSpec& spec(subinfo.spec(m));
+        if (std::max(spec.width, spec.height) <= m_sat_maxres) {
+            level = m;
+            break;
+        }
+    }
+    if (level >= 0 && !subinfo.volume) {
+        const ImageSpec& spec(subinfo.spec(level));
+        int w = spec.width, h = spec.height, nc = spec.nchannels;
+        std::vector<float> pixels(size_t(w) * size_t(h) * size_t(nc));
+        if (m_imagecache->get_pixels(&texturefile, thread_info, subimage,
+                                     level, spec.x, spec.x + w, spec.y,
+                                     spec.y + h, spec.z, spec.z + 1,
+                                     TypeDesc::FLOAT, pixels.data())) {
+            sat.reset(new SummedAreaTable);
+            sat->miplevel  = level;
+            sat->width     = w;
+            sat->height    = h;
+            sat->nchannels = nc;
+            sat->sums.assign(size_t(w + 1) * size_t(h + 1) * size_t(nc), 0.0);
+            std::vector<double> rowsum(nc);
+            const float* p = pixels.data();
+            for (int y = 0; y < h; ++y) {
+                std::fill(rowsum.begin(), rowsum.end(), 0.0);
+                const double* above = sat->at(0, y) + nc;
+                double* out         = sat->at(0, y + 1) + nc;
+                for (int x = 0; x < w; ++x) {
+                    for (int c = 0; c < nc; ++c, ++p) {
+                        rowsum[c] += *p;
+                        *out++ = *above++ + rowsum[c];
+                    }
+                }
+            }
+        }
+    }
+
+    spin_lock lock(subinfo.sat_mutex);
+    subinfo.sat = sat;  // stays empty, and never retried, if we failed
+    return subinfo.sat;
+}
+
+
+
+namespace {
+
+// The prefix sum along one axis of a summed-area table, extended past the
+// [0,size] edges of the table according to the wrap mode, expressed as a
+// weighted sum of prefix sums at positions inside [0,size]. The average of
+// the texels in [a,b) is then (C(b) - C(a)) / (b-a).
+struct SatAxis {
+    float x[6];
+    double w[6];
+    int n = 0;
+
+    void add(double pos, double weight)
+    {
+        x[n] = float(pos);
+        w[n] = weight;
+        ++n;
+    }
+
+    void cumulative(double u, int size, TextureOpt::Wrap wrap, double sign)
+    {
+        if (wrap == TextureOpt::WrapBlack) {
+            add(Imath::clamp(u, 0.0, double(size)), sign);
+        } else if (wrap == TextureOpt::WrapClamp) {
+            // Past an edge, each texel of length adds the edge texel again,
+            // which is the prefix sum across that one texel.
+            if (u < 0.0) {
+                add(1.0, sign * u);
+            } else if (u > size) {
+                add(size, sign * (1.0 + (u - size)));
+                add(size - 1, -sign * (u - size));
+            } else {
+                add(u, sign);
+            }
+        } else if (wrap == TextureOpt::WrapMirror) {
+            double period = 2.0 * size;
+            double q      = std::floor(u / period);
+            double r      = u - q * period;
+            add(size, sign * 2.0 * q);
+            if (r <= size) {
+                add(r, sign);
+            } else {
+                add(size, 2.0 * sign);
+                add(period - r, -sign);
+            }
+        } else {  // the periodic flavors
+            double q = std::floor(u / size);
+            add(size, sign * q);
+            add(u - q * size, sign);
+        }
+    }
+};
+
+
+
+// Average channels [firstchannel, firstchannel+nchannels) of the table
+// over the texel-space box [u0,u1) x [v0,v1), returning the fraction of
+// the box that is inside the image (only less than 1 for black wrap).
+float
+sat_box_average(const SummedAreaTable& sat, double u0, double u1, double v0,
+                double v1, TextureOpt::Wrap swrap, TextureOpt::Wrap twrap,
+                int firstchannel, int nchannels, float* result)
+{
+    SatAxis sx, sy;
+    sx.cumulative(u1, sat.width, swrap, 1.0);
+    sx.cumulative(u0, sat.width, swrap, -1.0);
+    sy.cumulative(v1, sat.height, twrap, 1.0);
+    sy.cumulative(v0, sat.height, twrap, -1.0);
+
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (int j = 0; j < sy.n; ++j) {
+        int y     = std::min(int(sy.x[j]), sat.height - 1);
+        double fy = sy.x[j] - y;
+        for (int i = 0; i < sx.n; ++i) {
+            // Between integer positions the prefix sum is exactly the
+            // bilinear interpolation of its values at the corners.
+            int x             = std::min(int(sx.x[i]), sat.width - 1);
+            double fx         = sx.x[i] - x;
+            double w          = sx.w[i] * sy.w[j];
+            const double* p00 = sat.at(x, y) + firstchannel;
+            const double* p01 = sat.at(x, y + 1) + firstchannel;
+            const double* p10 = p00 + sat.nchannels;
+            const double* p11 = p01 + sat.nchannels;
+            for (int c = 0; c < nchannels; ++c) {
+                double top    = p00[c] + fx * (p10[c] - p00[c]);
+                double bottom = p01[c] + fx * (p11[c] - p01[c]);
+                sum[c] += w * (top + fy * (bottom - top));
+            }
+        }
+    }
+    double invarea = 1.0 / ((u1 - u0) * (v1 - v0));
+    for (int c = 0; c < nchannels; ++c)
+        result[c] = float(sum[c] * invarea);
+
+    float coverage = 1.0f;
+    if (swrap == TextureOpt::WrapBlack)
+        coverage *= float((Imath::clamp(u1, 0.0, double(sat.width))
+                           - Imath::clamp(u0, 0.0, double(sat.width)))
+                          / (u1 - u0));
+    if (twrap == TextureOpt::WrapBlack)
+        coverage *= float((Imath::clamp(v1, 0.0, double(sat.height))
+                           - Imath::clamp(v0, 0.0, double(sat.height)))
+                          / (v1 - v0));
+    return coverage;
+}
+
+}  // namespace
+
+
+
+bool
+TextureSystemImpl::texture_lookup_sat(TextureFile& texturefile,
+                                      PerThreadInfo* thread_info,
+                                      TextureOpt& options, int nchannels_result,
+                                      int actualchannels, float s, float t,
+                                      float dsdx, float dtdx, float dsdy,
+                                      float dtdy, float* result,
+                                      float* dresultds, float* dresultdt)
+{
+    DASSERT((dresultds == NULL) == (dresultdt == NULL));
+
+    // Half-widths of the axis-aligned box that bounds the footprint.
+    float ds = 0.5f * ((fabsf(dsdx) + fabsf(dsdy)) * options.swidth
+                       + options.sblur);
+    float dt = 0.5f * ((fabsf(dtdx) + fabsf(dtdy)) * options.twidth
+                       + options.tblur);
+
+    std::shared_ptr<const SummedAreaTable> sat;
+    const ImageCacheFile::SubimageInfo& subinfo(
+        texturefile.subimageinfo(options.subimage));
+    if (subinfo.full_pixel_range && actualchannels > 0)
+        sat = summed_area_table(texturefile, thread_info, options.subimage);
+
+    // Texel-space center and half-widths at the table's level, with texel
+    // i covering [i,i+1) (compare st_to_texel).
+    float sscale = 0.0f, tscale = 0.0f;
+    double u = 0.0, v = 0.0;
+    if (sat) {
+        if (texturefile.sample_border() == 0) {
+            sscale = float(sat->width);
+            tscale = float(sat->height);
+            u      = double(s) * sscale;
+            v      = double(t) * tscale;
+        } else {
+            sscale = float(std::max(sat->width - 1, 1));
+            tscale = float(std::max(sat->height - 1, 1));
+            u      = double(s) * sscale + 0.5;
+            v      = double(t) * tscale + 0.5;
+        }
+    }
+    // A box smaller than a texel of the table is better served by the
+    // ordinary MIP filtering, at a finer level.
+    if (!sat || (ds * sscale < 0.5f && dt * tscale < 0.5f))
+        return texture_lookup(texturefile, thread_info, options,
+                              nchannels_result, actualchannels, s, t, dsdx,
+                              dtdx, dsdy, dtdy, result, dresultds, dresultdt);
+    double hu = std::max(ds * sscale, 0.5f);
+    double hv = std::max(dt * tscale, 0.5f);
+
+    simd::vbool4 channel_mask = channel_masks[actualchannels];
+    bool use_fill = (nchannels_result > actualchannels && options.fill);
+    auto box      = [&](double cu, double cv) -> vfloat4 {
+        vfloat4 r      = vfloat4::Zero();
+        float coverage = sat_box_average(*sat, cu - hu, cu + hu, cv - hv,
+                                         cv + hv, options.swrap, options.twrap,
+                                         options.firstchannel, actualchannels,
+                                         (float*)&r);
+        if (use_fill)
+            r += blend0not(vfloat4(coverage * options.fill), channel_mask);
+        return r;
+    };
+
+    *(simd::vfloat4*)(result) = box(u, v);
     if (dresultds) {
-        *(simd::vfloat4*)(dresultds) = drds_sum;
-        *(simd::vfloat4*)(dresultdt) = drdt_sum;
+        // The box average is smooth in its center, so central differences
+        // across the box half-width give its derivatives.
+        *(simd::vfloat4*)(dresultds) = (box(u + hu, v) - box(u - hu, v))
+                                       * float(sscale / (2.0 * hu));
+        *(simd::vfloat4*)(dresultdt) = (box(u, v + hv) - box(u, v - hv))
+                                       * float(tscale / (2.0 * hv));
     }
 
-    // Update stats
     ImageCacheStatistics& stats(thread_info->m_stats);
-    stats.aniso_queries += npointson;
-    stats.aniso_probes += npointson * nsamples;
-    if (trueaspect > stats.max_aniso)
-        stats.max_aniso = trueaspect;  // FIXME?
-    stats.closest_interps += closestprobes * nsamples;
-    stats.bilinear_interps += bilinearprobes * nsamples;
-    stats.cubic_interps += bicubicprobes * nsamples;
+    stats.sat_queries += 1;
+    return true;
+}
 
-    return ok;
+
+
+bool
+TextureSystemImpl::sample_ewa(float s, float t, float major, float minor,
+                              float smajor, float tmajor, int miplevel,
+                              TextureFile& texturefile,
+                              PerThreadInfo* thread_info, TextureOpt& options,
+                              int nchannels_result, int actualchannels,
+                              vfloat4* accum_, vfloat4* daccumds_,
+                              vfloat4* daccumdt_, long long& ntexels)
+{
+    bool allok = true;
+    const ImageSpec& spec(texturefile.spec(options.subimage, miplevel));
+    const ImageCacheFile::LevelInfo& levelinfo(
+        texturefile.levelinfo(options.subimage, miplevel));
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    wrap_impl swrap_func         = wrap_functions[(int)options.swrap];
+    wrap_impl twrap_func         = wrap_functions[(int)options.twrap];
+    int firstchannel             = options.firstchannel;
+    int tile_chbegin = 0, tile_chend = spec.nchannels;
+    if (spec.nchannels > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + actualchannels;
+    }
+    TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
+              tile_chend);
+
+    // Center of the ellipse in texel coordinates, where texel centers are
+    // at integers (see st_to_texel), and the st-to-texel scale factors.
+    float sscale, tscale, cx, cy;
+    if (texturefile.sample_border() == 0) {
+        sscale = float(spec.width);
+        tscale = float(spec.height);
+        cx     = s * sscale + (spec.x - 0.5f);
+        cy     = t * tscale + (spec.y - 0.5f);
+    } else {
+        sscale = float(std::max(spec.width - 1, 1));
+        tscale = float(std::max(spec.height - 1, 1));
+        cx     = s * sscale + float(spec.x);
+        cy     = t * tscale + float(spec.y);
+    }
+
+    // The ellipse is the image of the unit disc under the map whose
+    // columns are the semi-axes in texel space, (mx,my) and (nx,ny). Each
+    // is made at least one texel long so the filter can never slip
+    // between texel centers when magnifying.
+    auto axis = [](float len, float x, float y, float& ax, float& ay) {
+        float unit = sqrtf(x * x + y * y);  // texels per unit st
+        float k    = std::max(len * unit, 1.0f) / unit;
+        ax         = k * x;
+        ay         = k * y;
+    };
+    float mx, my, nx, ny;
+    axis(major, smajor * sscale, tmajor * tscale, mx, my);
+    axis(minor, -tmajor * sscale, smajor * tscale, nx, ny);
+    // Inverting that map gives the implicit form of the ellipse,
+    //     Q(dx,dy) = A*dx^2 + B*dx*dy + C*dy^2 < 1
+    float det  = mx * ny - nx * my;
+    float idet = 1.0f / std::max(det * det, 1.0e-12f);
+    float A    = (ny * ny + my * my) * idet;
+    float B    = -2.0f * (nx * ny + mx * my) * idet;
+    float C    = (nx * nx + mx * mx) * idet;
+    float ey   = sqrtf(my * my + ny * ny);  // vertical half-extent
+
+    const float* lut = ewa_weights();
+    float tail       = ewa_falloff / (1.0f - ewa_falloff);
+    vfloat4 accum, daccumdx, daccumdy;
+    accum.clear();
+    daccumdx.clear();
+    daccumdy.clear();
+    float sumw = 0.0f, validw = 0.0f, sumgx = 0.0f, sumgy = 0.0f;
+    int jbegin = (int)ceilf(cy - ey), jend = (int)floorf(cy + ey);
+    for (int j = jbegin; j <= jend; ++j) {
+        // Only visit the span of this row that is inside the ellipse, so
+        // the work is proportional to its area, not its bounding box.
+        float dy   = j - cy;
+        float bdy  = B * dy;
+        float cdy2 = C * dy * dy;
+        float disc = bdy * bdy - 4.0f * A * (cdy2 - 1.0f);
+        if (disc <= 0.0f)
+            continue;
+        float root  = sqrtf(disc);
+        int ibegin  = (int)ceilf(cx + (-bdy - root) / (2.0f * A));
+        int iend    = (int)floorf(cx + (-bdy + root) / (2.0f * A));
+        int ttex    = j;
+        bool tvalid = twrap_func(ttex, spec.y, spec.height);
+        if (!levelinfo.full_pixel_range)
+            tvalid &= (ttex >= spec.y && ttex < (spec.y + spec.height));
+        for (int i = ibegin; i <= iend; ++i) {
+            float dx = i - cx;
+            float q  = (A * dx + bdy) * dx + cdy2;
+            if (q >= 1.0f)
+                continue;
+            float w = lut[std::max(int(q * ewa_lut_size), 0)];
+            // d(weight)/d(center), from the derivative of the Gaussian
+            float gx = 0.0f, gy = 0.0f;
+            if (daccumds_) {
+                float dwdq = ewa_alpha * (w + tail);
+                gx         = dwdq * (2.0f * A * dx + bdy);
+                gy         = dwdq * (B * dx + 2.0f * C * dy);
+            }
+            sumw += w;
+            sumgx += gx;
+            sumgy += gy;
+            int stex    = i;
+            bool svalid = swrap_func(stex, spec.x, spec.width);
+            if (!levelinfo.full_pixel_range)
+                svalid &= (stex >= spec.x && stex < (spec.x + spec.width));
+            if (!(svalid & tvalid))
+                continue;  // black border: counts toward the weight only
+
+            int tile_s = (stex - spec.x) % spec.tile_width;
+            int tile_t = (ttex - spec.y) % spec.tile_height;
+            id.xy(stex - tile_s, ttex - tile_t);
+            bool ok = find_tile(id, thread_info);
+            if (!ok)
+                errorf("%s", m_imagecache->geterror());
+            TileRef& tile(thread_info->tile);
+            if (!tile || !ok) {
+                allok = false;
+                continue;
+            }
+            int offset = id.nchannels() * (tile_t * spec.tile_width + tile_s)
+                         + (firstchannel - id.chbegin());
+            DASSERT((size_t)offset < spec.nchannels * spec.tile_pixels());
+            simd::vfloat4 texel_simd;
+            if (pixeltype == TypeDesc::UINT8) {
+                // special case for 8-bit tiles
+                texel_simd = uchar2float4(tile->bytedata() + offset);
+            } else if (pixeltype == TypeDesc::UINT16) {
+                texel_simd = ushort2float4(tile->ushortdata() + offset);
+            } else if (pixeltype == TypeDesc::HALF) {
+                texel_simd = half2float4(tile->halfdata() + offset);
+            } else {
+                DASSERT(pixeltype == TypeDesc::FLOAT);
+                texel_simd.load(tile->floatdata() + offset);
+            }
+            validw += w;
+            accum += w * texel_simd;
+            if (daccumds_) {
+                daccumdx += gx * texel_simd;
+                daccumdy += gy * texel_simd;
+            }
+            ++ntexels;
+        }
+    }
+
+    if (sumw <= 0.0f) {
+        // Only possible for a degenerate footprint; fall back to a single
+        // bilinear probe rather than return nothing.
+        OIIO_SIMD4_ALIGN float sval[4]   = { s, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float tval[4]   = { t, 0.0f, 0.0f, 0.0f };
+        OIIO_SIMD4_ALIGN float weight[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        return sample_bilinear(1, sval, tval, miplevel, texturefile,
+                               thread_info, options, nchannels_result,
+                               actualchannels, weight, accum_, daccumds_,
+                               daccumdt_);
+    }
+
+    float invw                = 1.0f / sumw;
+    simd::vbool4 channel_mask = channel_masks[actualchannels];
+    accum                     = blend0(accum * invw, channel_mask);
+    if (daccumds_) {
+        // r = sum(w*T)/sum(w), so dr/dc = (sum(g*T) - r*sum(g)) / sum(w)
+        vfloat4 drdx = (daccumdx - accum * sumgx) * invw;
+        vfloat4 drdy = (daccumdy - accum * sumgy) * invw;
+        *daccumds_   = blend0(drdx * sscale, channel_mask);
+        *daccumdt_   = blend0(drdy * tscale, channel_mask);
+    }
+    if (validw > 0.0f && nchannels_result > actualchannels && options.fill) {
+        // Add the fill color, weighted by the part that hit real texels
+        accum += blend0not(vfloat4(validw * invw * options.fill),
+                           channel_mask);
+    }
+    *accum_ = accum;
+    return allok;
 }
 
 
@@ -2074,9 +3975,64 @@ TextureSystemImpl::sample_bilinear(
     const ImageCacheFile::LevelInfo& levelinfo(
         texturefile.levelinfo(options.subimage, miplevel));
     TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
-    wrap_impl swrap_func         = wrap_functions[(int)options.swrap];
-    wrap_impl twrap_func         = wrap_functions[(int)options.twrap];
-    wrap_impl_simd wrap_func     = (swrap_func == twrap_func)
+
+    // Hand the common cases to a kernel compiled for the exact wrap mode,
+    // data type and channel count, so that none of those are tested per
+    // texel. Everything else takes the general path below.
+    if (options.swrap == options.twrap && levelinfo.full_pixel_range
+        && options.envlayout != LayoutLatLong) {
+        int w = -1, d = -1, c = -1;
+        if (options.swrap == TextureOpt::WrapClamp)
+            w = 0;
+        else if (options.swrap == TextureOpt::WrapPeriodic)
+            w = 1;
+        else if (options.swrap == TextureOpt::WrapPeriodicPow2)
+            w = 2;
+        if (pixeltype == TypeDesc::UINT8)
+            d = 0;
+        else if (pixeltype == TypeDesc::UINT16)
+            d = 1;
+        else if (pixeltype == TypeDesc::HALF)
+            d = 2;
+        else if (pixeltype == TypeDesc::FLOAT)
+            d = 3;
+        if (actualchannels == 1)
+            c = 0;
+        else if (actualchannels == 3)
+            c = 1;
+        else if (actualchannels == 4)
+            c = 2;
+        if (w >= 0 && d >= 0 && c >= 0) {
+#define BILINEAR_KERNELS(T, W)                                                 \
+    {                                                                          \
+        &TextureSystemImpl::sample_bilinear_fast<T, W, 1>,                     \
+            &TextureSystemImpl::sample_bilinear_fast<T, W, 3>,                 \
+            &TextureSystemImpl::sample_bilinear_fast<T, W, 4>                  \
+    }
+#define BILINEAR_KERNELS_WRAP(W)                                               \
+    {                                                                          \
+        BILINEAR_KERNELS(unsigned char, W),                                    \
+            BILINEAR_KERNELS(unsigned short, W), BILINEAR_KERNELS(half, W),    \
+            BILINEAR_KERNELS(float, W)                                         \
+    }
+            static const sampler_prototype kernels[3][4][3] = {
+                BILINEAR_KERNELS_WRAP(TextureOpt::WrapClamp),
+                BILINEAR_KERNELS_WRAP(TextureOpt::WrapPeriodic),
+                BILINEAR_KERNELS_WRAP(TextureOpt::WrapPeriodicPow2)
+            };
+#undef BILINEAR_KERNELS_WRAP
+#undef BILINEAR_KERNELS
+            return (this->*kernels[w][d][c])(nsamples, s_, t_, miplevel,
+                                             texturefile, thread_info, options,
+                                             nchannels_result, actualchannels,
+                                             weight_, accum_, daccumds_,
+                                             daccumdt_);
+        }
+    }
+
+    wrap_impl swrap_func     = wrap_functions[(int)options.swrap];
+    wrap_impl twrap_func     = wrap_functions[(int)options.twrap];
+    wrap_impl_simd wrap_func = (swrap_func == twrap_func)
                                    ? wrap_functions_simd[(int)options.swrap]
                                    : NULL;
     simd::vint4 xy(spec.x, spec.y);
@@ -2319,6 +4275,183 @@ TextureSystemImpl::sample_bilinear(
 }
 
 
+template<typename T, int Wrap, int Nchan>
+bool
+TextureSystemImpl::sample_bilinear_fast(
+    int nsamples, const float* s_, const float* t_, int miplevel,
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    int nchannels_result, int /*actualchannels*/, const float* weight_,
+    vfloat4* accum_, vfloat4* daccumds_, vfloat4* daccumdt_)
+{
+    // Same math as sample_bilinear, but clamp and periodic wrap never
+    // produce an invalid texel and there is no crop window or pole, so
+    // all of the "black" bookkeeping is gone. A single channel is
+    // interpolated as scalars rather than as mostly-unused 4-vectors.
+    typedef TexelConvert<T> Convert;
+    const ImageSpec& spec(texturefile.spec(options.subimage, miplevel));
+    simd::vint4 xy(spec.x, spec.y);
+    simd::vint4 widthheight(spec.width, spec.height);
+    simd::vint4 tilewh(spec.tile_width, spec.tile_height);
+    simd::vint4 tilewhmask = tilewh - 1;
+    bool use_fill      = (nchannels_result > Nchan && options.fill);
+    bool tilepow2      = ispow2(spec.tile_width) && ispow2(spec.tile_height);
+    size_t channelsize = texturefile.channelsize(options.subimage);
+    int firstchannel   = options.firstchannel;
+    int tile_chbegin = 0, tile_chend = spec.nchannels;
+    if (spec.nchannels > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + Nchan;
+    }
+    TileID id(texturefile, options.subimage, miplevel, 0, 0, 0, tile_chbegin,
+              tile_chend);
+
+    vfloat4 accum, daccumds, daccumdt;
+    accum.clear();
+    daccumds.clear();
+    daccumdt.clear();
+    float accum1 = 0.0f, daccum1ds = 0.0f, daccum1dt = 0.0f;
+    vfloat4 s_simd, t_simd;
+    vint4 sint_simd, tint_simd;
+    vfloat4 sfrac_simd, tfrac_simd;
+    // Texels in the order [0][0], [0][1], [1][0], [1][1]
+    vfloat4 texel4[4];
+    float texel1[4];
+    auto convert = [&](int k, const unsigned char* p) {
+        if (Nchan == 1)
+            texel1[k] = Convert::load1(p);
+        else
+            texel4[k] = Convert::load4(p);
+    };
+    for (int sample = 0; sample < nsamples; ++sample) {
+        int sample4 = sample & 3;
+        if (sample4 == 0) {
+            s_simd.load(s_ + sample);
+            t_simd.load(t_ + sample);
+            st_to_texel_simd(s_simd, t_simd, texturefile, spec, sint_simd,
+                             tint_simd, sfrac_simd, tfrac_simd);
+        }
+        int sint = sint_simd[sample4], tint = tint_simd[sample4];
+        float sfrac = sfrac_simd[sample4], tfrac = tfrac_simd[sample4];
+        float weight = weight_[sample];
+
+        enum { S0 = 0, S1 = 1, T0 = 2, T1 = 3 };
+        simd::vint4 sttex(sint, sint + 1, tint, tint + 1);
+        if (Wrap == TextureOpt::WrapClamp)
+            wrap_clamp_simd(sttex, xy, widthheight);
+        else if (Wrap == TextureOpt::WrapPeriodicPow2)
+            wrap_periodic_pow2_simd(sttex, xy, widthheight);
+        else
+            wrap_periodic_simd(sttex, xy, widthheight);
+
+        simd::vint4 tile_st = (simd::vint4(simd::shuffle<S0, S0, T0, T0>(sttex))
+                               - xy);
+        if (tilepow2)
+            tile_st &= tilewhmask;
+        else
+            tile_st %= tilewh;
+        bool s_onetile = (tile_st[S0] != tilewhmask[S0])
+                         & (sttex[S0] + 1 == sttex[S1]);
+        bool t_onetile = (tile_st[T0] != tilewhmask[T0])
+                         & (sttex[T0] + 1 == sttex[T1]);
+        if (s_onetile & t_onetile) {
+            // Shortcut if all the texels we need are on the same tile
+            id.xy(sttex[S0] - tile_st[S0], sttex[T0] - tile_st[T0]);
+            bool ok = find_tile(id, thread_info);
+            if (!ok)
+                errorf("%s", m_imagecache->geterror());
+            TileRef& tile(thread_info->tile);
+            if (!tile->valid())
+                return false;
+            int pixelsize = tile->pixelsize();
+            const unsigned char* p
+                = tile->bytedata()
+                  + pixelsize * (tile_st[T0] * spec.tile_width + tile_st[S0])
+                  + channelsize * (firstchannel - id.chbegin());
+            convert(0, p);
+            convert(1, p + pixelsize);
+            p += pixelsize * spec.tile_width;
+            convert(2, p);
+            convert(3, p + pixelsize);
+        } else {
+            simd::vint4 tile_st   = (sttex - xy) % tilewh;
+            simd::vint4 tile_edge = sttex - tile_st;
+            for (int j = 0; j < 2; ++j) {
+                int tile_t = tile_st[T0 + j];
+                for (int i = 0; i < 2; ++i) {
+                    int tile_s = tile_st[S0 + i];
+                    // Only look up a new tile at the start of a row or
+                    // when we just crossed a tile boundary.
+                    if (i == 0 || tile_s == 0) {
+                        id.xy(tile_edge[S0 + i], tile_edge[T0 + j]);
+                        bool ok = find_tile(id, thread_info);
+                        if (!ok)
+                            errorf("%s", m_imagecache->geterror());
+                        if (!thread_info->tile->valid())
+                            return false;
+                        DASSERT(thread_info->tile->id() == id);
+                    }
+                    TileRef& tile(thread_info->tile);
+                    int pixelsize = tile->pixelsize();
+                    int offset    = pixelsize
+                                 * (tile_t * spec.tile_width + tile_s)
+                                 + (firstchannel - id.chbegin()) * channelsize;
+                    convert(2 * j + i, tile->bytedata() + offset);
+                }
+            }
+        }
+
+        if (Nchan == 1) {
+            accum1 += weight
+                      * bilerp(texel1[0], texel1[1], texel1[2], texel1[3],
+                               sfrac, tfrac);
+            if (daccumds_) {
+                daccum1ds += weight * float(spec.width)
+                             * lerp(texel1[1] - texel1[0],
+                                    texel1[3] - texel1[2], tfrac);
+                daccum1dt += weight * float(spec.height)
+                             * lerp(texel1[2] - texel1[0],
+                                    texel1[3] - texel1[1], sfrac);
+            }
+        } else {
+            simd::vfloat4 weight_simd = weight;
+            accum += weight_simd
+                     * bilerp(texel4[0], texel4[1], texel4[2], texel4[3],
+                              sfrac, tfrac);
+            if (daccumds_) {
+                simd::vfloat4 scalex = weight_simd * float(spec.width);
+                simd::vfloat4 scaley = weight_simd * float(spec.height);
+                daccumds += scalex
+                            * lerp(texel4[1] - texel4[0],
+                                   texel4[3] - texel4[2], tfrac);
+                daccumdt += scaley
+                            * lerp(texel4[2] - texel4[0],
+                                   texel4[3] - texel4[1], sfrac);
+            }
+        }
+    }
+    if (Nchan == 1) {
+        accum    = vfloat4(accum1, 0.0f, 0.0f, 0.0f);
+        daccumds = vfloat4(daccum1ds, 0.0f, 0.0f, 0.0f);
+        daccumdt = vfloat4(daccum1dt, 0.0f, 0.0f, 0.0f);
+    }
+
+    simd::vbool4 channel_mask = channel_masks[Nchan];
+    accum                     = blend0(accum, channel_mask);
+    if (use_fill) {
+        // Nothing is ever in the black wrap region, so it's all fill
+        accum += blend0not(vfloat4(options.fill), channel_mask);
+    }
+
+    *accum_ = accum;
+    if (daccumds_) {
+        *daccumds_ = blend0(daccumds, channel_mask);
+        *daccumdt_ = blend0(daccumdt, channel_mask);
+    }
+    return true;
+}
+
+
 namespace {
 
     // Evaluate Bspline weights for both value and derivatives (if dw is not
@@ -2406,6 +4539,36 @@ namespace {
 #endif
     }
 
+    // Evaluate the Bspline weights for the s and t fractions together in
+    // one 8-wide pass, w = [ wx0 wx1 wx2 wx3 wy0 wy1 wy2 wy3 ], and also
+    // their derivatives if dw is not NULL. The arithmetic per lane is the
+    // same as evalBSplineWeights_and_derivs.
+    inline void evalBSplineWeights_st(simd::vfloat8* w, float sfrac,
+                                      float tfrac, simd::vfloat8* dw = NULL)
+    {
+        OIIO_SIMD_FLOAT8_CONST8(A, 0.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.0f, 0.0f,
+                                2.0f / 3.0f, 2.0f / 3.0f, 0.0f);
+        OIIO_SIMD_FLOAT8_CONST8(B, 1.0f / 6.0f, -0.5f, -0.5f, 1.0f / 6.0f,
+                                1.0f / 6.0f, -0.5f, -0.5f, 1.0f / 6.0f);
+        float one_sfrac = 1.0f - sfrac;
+        float one_tfrac = 1.0f - tfrac;
+        simd::vfloat8 ofof(one_sfrac, sfrac, one_sfrac, sfrac, one_tfrac,
+                           tfrac, one_tfrac, tfrac);
+        simd::vfloat8 C(one_sfrac, 2.0f - sfrac, 2.0f - one_sfrac, sfrac,
+                        one_tfrac, 2.0f - tfrac, 2.0f - one_tfrac, tfrac);
+        *w = (*(vfloat8*)&A) + (*(vfloat8*)&B) * ofof * ofof * C;
+        if (dw) {
+            OIIO_SIMD_FLOAT8_CONST8(D, -0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f,
+                                    -0.5f, 0.5f);
+            OIIO_SIMD_FLOAT8_CONST8(E, 1.0f, 3.0f, 3.0f, 1.0f, 1.0f, 3.0f,
+                                    3.0f, 1.0f);
+            OIIO_SIMD_FLOAT8_CONST8(F, 0.0f, 4.0f, 4.0f, 0.0f, 0.0f, 4.0f,
+                                    4.0f, 0.0f);
+            *dw = (*(vfloat8*)&D) * ofof
+                  * ((*(vfloat8*)&E) * ofof - (*(vfloat8*)&F));
+        }
+    }
+
 }  // anonymous namespace
 
 
@@ -2457,6 +4620,10 @@ TextureSystemImpl::sample_bicubic(
     size_t pixelsize                 = channelsize * id.nchannels();
     size_t firstchannel_offset_bytes = channelsize
                                        * (firstchannel - id.chbegin());
+    // For 4-channel texels, each row of the 4x4 footprint is 16 contiguous
+    // values that can be converted with a single wide load.
+    bool rows_contiguous = (pixelsize == 4 * channelsize
+                            && firstchannel_offset_bytes == 0);
     vfloat4 accum, daccumds, daccumdt;
     accum.clear();
     if (daccumds_) {
@@ -2547,7 +4714,25 @@ TextureSystemImpl::sample_bicubic(
             const unsigned char* base = tile->bytedata() + offset
                                         + firstchannel_offset_bytes;
             DASSERT(tile->data());
-            if (pixeltype == TypeDesc::UINT8) {
+            if (rows_contiguous && pixeltype != TypeDesc::FLOAT) {
+                for (int j = 0, j_offset = 0; j < 4;
+                     ++j, j_offset += pixelsize * spec.tile_width) {
+                    const unsigned char* row = base + j_offset;
+                    vfloat16 texels;
+                    if (pixeltype == TypeDesc::UINT8)
+                        texels = vfloat16(row) * (1.0f / 255.0f);
+                    else if (pixeltype == TypeDesc::UINT16)
+                        texels = vfloat16((const unsigned short*)row)
+                                 * (1.0f / 65535.0f);
+                    else
+                        texels = vfloat16((const half*)row);
+                    vfloat8 left = texels.lo(), right = texels.hi();
+                    texel_simd[j][0] = left.lo();
+                    texel_simd[j][1] = left.hi();
+                    texel_simd[j][2] = right.lo();
+                    texel_simd[j][3] = right.hi();
+                }
+            } else if (pixeltype == TypeDesc::UINT8) {
                 for (int j = 0, j_offset = 0; j < 4;
                      ++j, j_offset += pixelsize * spec.tile_width)
                     for (int i = 0, i_offset = j_offset; i < 4;
@@ -2659,14 +4844,14 @@ TextureSystemImpl::sample_bicubic(
         // guarantees that the filtered results will be non-negative for
         // non-negative texel values (which we had trouble with before due to
         // numerical imprecision).
-        vfloat4 wx, dwx;
-        vfloat4 wy, dwy;
+        vfloat8 wxy, dwxy;
+        evalBSplineWeights_st(&wxy, sfrac, tfrac, daccumds_ ? &dwxy : NULL);
+        vfloat4 wx = wxy.lo(), wy = wxy.hi();
+        vfloat4 dwx, dwy;
         if (daccumds_) {
-            evalBSplineWeights_and_derivs(&wx, sfrac, &dwx);
-            evalBSplineWeights_and_derivs(&wy, tfrac, &dwy);
+            dwx = dwxy.lo();
+            dwy = dwxy.hi();
         } else {
-            wx = evalBSplineWeights(vfloat4(sfrac));
-            wy = evalBSplineWeights(vfloat4(tfrac));
 #if (defined(__i386__) && !defined(__x86_64__)) || defined(__aarch64__)
             // Some platforms complain here about these being uninitialized,
             // so initialize them. Don't waste the cycles for platforms that
@@ -2685,21 +4870,13 @@ TextureSystemImpl::sample_bicubic(
         //   float g1x = wx[2] + wx[3]; float h1x = (wx[3] / g1x);
         //   float g0y = wy[0] + wy[1]; float h0y = (wy[1] / g0y);
         //   float g1y = wy[2] + wy[3]; float h1y = (wy[3] / g1y);
-        // But instead, we convolutedly (but quickly!) compute the four g
-        // and four h values using SIMD ops:
-        vfloat4 wx_0213        = simd::shuffle<0, 2, 1, 3>(wx);
-        vfloat4 wx_1302        = simd::shuffle<1, 3, 0, 2>(wx);
-        vfloat4 wx_01_23_01_23 = wx_0213
-                                 + wx_1302;  // wx[0]+wx[1] wx[2]+wx[3] ..
-        vfloat4 wy_0213        = simd::shuffle<0, 2, 1, 3>(wy);
-        vfloat4 wy_1302        = simd::shuffle<1, 3, 0, 2>(wy);
-        vfloat4 wy_01_23_01_23 = wy_0213
-                                 + wy_1302;  // wy[0]+wy[1] wy[2]+wy[3] ..
-        vfloat4 g = AxyBxy(
-            wx_01_23_01_23,
-            wy_01_23_01_23);  // wx[0]+wx[1] wx[2]+wx[3] wy[0]+wy[1] wy[2]+wy[3]
-        vfloat4 wx13_wy13 = AxyBxy(wx_1302, wy_1302);
-        vfloat4 h         = wx13_wy13 / g;  // [ h0x h1x h0y h1y ]
+        // But instead, since the x and y weights are already side by side
+        // in one vfloat8, we get all four g and h values at once from its
+        // even and odd elements:
+        vfloat4 w_even = simd::shuffle<0, 2, 4, 6, 0, 2, 4, 6>(wxy).lo();
+        vfloat4 w_odd  = simd::shuffle<1, 3, 5, 7, 1, 3, 5, 7>(wxy).lo();
+        vfloat4 g      = w_even + w_odd;  // [ g0x g1x g0y g1y ]
+        vfloat4 h      = w_odd / g;       // [ h0x h1x h0y h1y ]
 
         simd::vfloat4 col[4];
         for (int j = 0; j < 4; ++j) {
@@ -2797,6 +4974,296 @@ TextureSystemImpl::sample_bicubic(
 
 
 
+bool
+TextureSystemImpl::sample_aniso_batch(
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    int nchannels_result, int actualchannels, const int* lanes, int nlanes,
+    const float* s, const float* t, const float* smajor, const float* tmajor,
+    const int* nsamples, const float* lineweight, const int* miplevel0,
+    const int* miplevel1, const float* levelblend, const int* naturalsres,
+    const int* naturaltres, vfloat4* result, vfloat4* dresultds,
+    vfloat4* dresultdt)
+{
+    typedef Tex::FloatWide FloatWide;
+    typedef FloatWide::vint_t IntWide;
+    const int W = Tex::BatchWidth;
+
+    const ImageCacheFile::SubimageInfo& subinfo(
+        texturefile.subimageinfo(options.subimage));
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    size_t channelsize           = texturefile.channelsize(options.subimage);
+    int tile_chbegin = 0, tile_chend = subinfo.spec(0).nchannels;
+    if (tile_chend > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend   = options.firstchannel + actualchannels;
+    }
+    size_t pixelsize  = channelsize * (tile_chend - tile_chbegin);
+    size_t chanoffset = channelsize * (options.firstchannel - tile_chbegin);
+    bool use_fill     = (nchannels_result > actualchannels && options.fill);
+    bool closest      = (options.interpmode == TextureOpt::InterpClosest);
+    bool anycubic     = (options.interpmode == TextureOpt::InterpBicubic
+                     || options.interpmode == TextureOpt::InterpSmartBicubic);
+    simd::vbool4 channel_mask = channel_masks[actualchannels];
+
+    // Texels read straight from tiles are summed here, unmasked and
+    // without fill, which is added at the end in proportion to their
+    // weight. Probes left to the samplers go straight into result.
+    vfloat4 accum[W], daccumds[W], daccumdt[W];
+    float inweight[W];
+    for (int l = 0; l < nlanes; ++l) {
+        int i = lanes[l];
+        result[i].clear();
+        accum[i].clear();
+        if (dresultds) {
+            dresultds[i].clear();
+            dresultdt[i].clear();
+            daccumds[i].clear();
+            daccumdt[i].clear();
+        }
+        inweight[i] = 0.0f;
+    }
+
+    // The tile whose data we are reading, kept across lanes and probes:
+    // the lanes come grouped by tile, so each is found once per run.
+    int curlevel = -1, curx = 0, cury = 0;
+    const unsigned char* tiledata = nullptr;
+
+    bool ok             = true;
+    int npointson       = 0;
+    long long probes[3] = { 0, 0, 0 };  // closest, bilinear, bicubic
+    for (int level = 0; level < 2; ++level) {
+        const int* miplevel = level ? miplevel1 : miplevel0;
+        // This level's weight, the mapping of st to texel coordinates, and
+        // the choice of interpolation, per lane.
+        float lweight[W] = {}, sscale[W] = {}, soffset[W] = {};
+        float tscale[W] = {}, toffset[W] = {};
+        bool cubic[W] = {};
+        int nmax      = 0;
+        for (int l = 0; l < nlanes; ++l) {
+            int i      = lanes[l];
+            lweight[i] = level ? levelblend[i] : 1.0f - levelblend[i];
+            if (!lweight[i])  // No contribution from this level
+                continue;
+            int lev = miplevel[i];
+            const ImageSpec& spec(subinfo.spec(lev));
+            if (texturefile.sample_border() == 0) {
+                sscale[i]  = float(spec.width);
+                soffset[i] = spec.x - 0.5f;
+                tscale[i]  = float(spec.height);
+                toffset[i] = spec.y - 0.5f;
+            } else {
+                sscale[i]  = float(spec.width - 1);
+                soffset[i] = float(spec.x);
+                tscale[i]  = float(spec.height - 1);
+                toffset[i] = float(spec.y);
+            }
+            cubic[i] = (options.interpmode == TextureOpt::InterpBicubic
+                        || (options.interpmode
+                                == TextureOpt::InterpSmartBicubic
+                            && (lev == 0 || spec.width < naturalsres[i] / 2
+                                || spec.height < naturaltres[i] / 2)));
+            nmax = std::max(nmax, nsamples[i]);
+            ++npointson;
+            probes[closest ? 0 : (cubic[i] ? 2 : 1)] += nsamples[i];
+        }
+        FloatWide S(s), T(t), Smajor(smajor), Tmajor(tmajor);
+        FloatWide Lweight(lweight), Sscale(sscale), Soffset(soffset);
+        FloatWide Tscale(tscale), Toffset(toffset);
+        FloatWide Invsamples = 1.0f / FloatWide(IntWide(nsamples));
+
+        for (int k = 0; k < nmax; ++k) {
+            // Position, weight, texel coordinates and filter weights of
+            // probe k of all the lanes at once.
+            FloatWide pos = 2.0f * ((k + 0.5f) * Invsamples - 0.5f);
+            FloatWide Sk  = S + pos * Smajor;
+            FloatWide Tk  = T + pos * Tmajor;
+            FloatWide Wk  = FloatWide(lineweight + k * W) * Lweight;
+            IntWide Sint, Tint;
+            FloatWide Sfrac = floorfrac(Sk * Sscale + Soffset, &Sint);
+            FloatWide Tfrac = floorfrac(Tk * Tscale + Toffset, &Tint);
+            FloatWide Sfrac1 = 1.0f - Sfrac, Tfrac1 = 1.0f - Tfrac;
+            float sk[W], tk[W], wk[W], sfrac[W], tfrac[W];
+            int sint[W], tint[W];
+            Sk.store(sk);
+            Tk.store(tk);
+            Wk.store(wk);
+            Sfrac.store(sfrac);
+            Tfrac.store(tfrac);
+            Sint.store(sint);
+            Tint.store(tint);
+            float bilin[4][W];
+            (Sfrac1 * Tfrac1).store(bilin[0]);
+            (Sfrac * Tfrac1).store(bilin[1]);
+            (Sfrac1 * Tfrac).store(bilin[2]);
+            (Sfrac * Tfrac).store(bilin[3]);
+            // Cubic B-spline weights of the four columns and rows, and
+            // their derivatives, as in evalBSplineWeights.
+            float wx[4][W], wy[4][W], dwx[4][W], dwy[4][W];
+            if (anycubic) {
+                const float sixth = 1.0f / 6.0f, twothirds = 2.0f / 3.0f;
+                (sixth * Sfrac1 * Sfrac1 * Sfrac1).store(wx[0]);
+                (twothirds - 0.5f * Sfrac * Sfrac * (2.0f - Sfrac))
+                    .store(wx[1]);
+                (twothirds - 0.5f * Sfrac1 * Sfrac1 * (2.0f - Sfrac1))
+                    .store(wx[2]);
+                (sixth * Sfrac * Sfrac * Sfrac).store(wx[3]);
+                (sixth * Tfrac1 * Tfrac1 * Tfrac1).store(wy[0]);
+                (twothirds - 0.5f * Tfrac * Tfrac * (2.0f - Tfrac))
+                    .store(wy[1]);
+                (twothirds - 0.5f * Tfrac1 * Tfrac1 * (2.0f - Tfrac1))
+                    .store(wy[2]);
+                (sixth * Tfrac * Tfrac * Tfrac).store(wy[3]);
+                if (dresultds) {
+                    (-0.5f * Sfrac1 * Sfrac1).store(dwx[0]);
+                    (0.5f * Sfrac * (3.0f * Sfrac - 4.0f)).store(dwx[1]);
+                    (-0.5f * Sfrac1 * (3.0f * Sfrac1 - 4.0f)).store(dwx[2]);
+                    (0.5f * Sfrac * Sfrac).store(dwx[3]);
+                    (-0.5f * Tfrac1 * Tfrac1).store(dwy[0]);
+                    (0.5f * Tfrac * (3.0f * Tfrac - 4.0f)).store(dwy[1]);
+                    (-0.5f * Tfrac1 * (3.0f * Tfrac1 - 4.0f)).store(dwy[2]);
+                    (0.5f * Tfrac * Tfrac).store(dwy[3]);
+                }
+            }
+
+            for (int l = 0; l < nlanes; ++l) {
+                int i = lanes[l];
+                if (k >= nsamples[i] || !lweight[i])
+                    continue;
+                int lev = miplevel[i];
+                const ImageSpec& spec(subinfo.spec(lev));
+                // Can the texels this probe needs be read straight from
+                // one tile, with no wrapping?
+                int b  = cubic[i] ? 1 : 0;
+                int x0 = sint[i] - b, y0 = tint[i] - b;
+                int n  = 2 + 2 * b;  // footprint is n x n texels
+                int tile_s = x0 - spec.x, tile_t = y0 - spec.y;
+                bool inside = (!closest && tile_s >= 0 && tile_t >= 0
+                               && tile_s + n <= spec.width
+                               && tile_t + n <= spec.height);
+                if (inside) {
+                    tile_s %= spec.tile_width;
+                    tile_t %= spec.tile_height;
+                    inside = (tile_s + n <= spec.tile_width
+                              && tile_t + n <= spec.tile_height);
+                }
+                if (!inside) {
+                    // Near an edge of the image or of a tile, or point
+                    // sampled: the sampler does it, wrap modes and all.
+                    OIIO_SIMD4_ALIGN float sv[4]  = { sk[i], 0.0f, 0.0f, 0.0f };
+                    OIIO_SIMD4_ALIGN float tv[4]  = { tk[i], 0.0f, 0.0f, 0.0f };
+                    OIIO_SIMD4_ALIGN float one[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+                    sampler_prototype sampler;
+                    sampler = &TextureSystemImpl::sample_bilinear;
+                    if (closest)
+                        sampler = &TextureSystemImpl::sample_closest;
+                    else if (cubic[i])
+                        sampler = &TextureSystemImpl::sample_bicubic;
+                    vfloat4 r, drds, drdt;
+                    ok &= (this->*sampler)(1, sv, tv, lev, texturefile,
+                                           thread_info, options,
+                                           nchannels_result, actualchannels,
+                                           one, &r, dresultds ? &drds : NULL,
+                                           dresultds ? &drdt : NULL);
+                    vfloat4 w = wk[i];
+                    result[i] += w * r;
+                    if (dresultds) {
+                        dresultds[i] += w * drds;
+                        dresultdt[i] += w * drdt;
+                    }
+                    curlevel = -1;  // The sampler moved thread_info->tile
+                    continue;
+                }
+
+                int tx = x0 - tile_s, ty = y0 - tile_t;
+                if (lev != curlevel || tx != curx || ty != cury) {
+                    TileID id(texturefile, options.subimage, lev, tx, ty, 0,
+                              tile_chbegin, tile_chend);
+                    if (!find_tile(id, thread_info))
+                        errorf("%s", m_imagecache->geterror());
+                    if (!thread_info->tile->valid())
+                        return false;
+                    tiledata = thread_info->tile->bytedata() + chanoffset;
+                    curlevel = lev;
+                    curx     = tx;
+                    cury     = ty;
+                }
+                size_t rowbytes = pixelsize * spec.tile_width;
+                const unsigned char* p = tiledata
+                                         + pixelsize
+                                               * (tile_t * spec.tile_width
+                                                  + tile_s);
+                vfloat4 w = wk[i];
+                if (!cubic[i]) {
+                    vfloat4 t00 = texel2float4(p, pixeltype);
+                    vfloat4 t01 = texel2float4(p + pixelsize, pixeltype);
+                    vfloat4 t10 = texel2float4(p + rowbytes, pixeltype);
+                    vfloat4 t11 = texel2float4(p + rowbytes + pixelsize,
+                                               pixeltype);
+                    accum[i] += w
+                                * (bilin[0][i] * t00 + bilin[1][i] * t01
+                                   + bilin[2][i] * t10 + bilin[3][i] * t11);
+                    if (dresultds) {
+                        daccumds[i] += (w * float(spec.width))
+                                       * lerp(t01 - t00, t11 - t10, tfrac[i]);
+                        daccumdt[i] += (w * float(spec.height))
+                                       * lerp(t10 - t00, t11 - t01, sfrac[i]);
+                    }
+                } else {
+                    vfloat4 sum = vfloat4::Zero(), ds = vfloat4::Zero();
+                    vfloat4 dt = vfloat4::Zero();
+                    for (int j = 0; j < 4; ++j, p += rowbytes) {
+                        vfloat4 texel[4];
+                        for (int c = 0; c < 4; ++c)
+                            texel[c] = texel2float4(p + c * pixelsize,
+                                                    pixeltype);
+                        vfloat4 row = wx[0][i] * texel[0] + wx[1][i] * texel[1]
+                                      + wx[2][i] * texel[2]
+                                      + wx[3][i] * texel[3];
+                        sum += wy[j][i] * row;
+                        if (dresultds) {
+                            ds += wy[j][i]
+                                  * (dwx[0][i] * texel[0]
+                                     + dwx[1][i] * texel[1]
+                                     + dwx[2][i] * texel[2]
+                                     + dwx[3][i] * texel[3]);
+                            dt += dwy[j][i] * row;
+                        }
+                    }
+                    accum[i] += w * sum;
+                    if (dresultds) {
+                        daccumds[i] += (w * float(spec.width)) * ds;
+                        daccumdt[i] += (w * float(spec.height)) * dt;
+                    }
+                }
+                inweight[i] += wk[i];
+            }
+        }
+    }
+
+    for (int l = 0; l < nlanes; ++l) {
+        int i = lanes[l];
+        result[i] += blend0(accum[i], channel_mask);
+        if (use_fill)
+            result[i] += blend0not(vfloat4(inweight[i] * options.fill),
+                                   channel_mask);
+        if (dresultds) {
+            dresultds[i] += blend0(daccumds[i], channel_mask);
+            dresultdt[i] += blend0(daccumdt[i], channel_mask);
+        }
+    }
+
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    stats.aniso_queries += npointson;
+    stats.aniso_probes += probes[0] + probes[1] + probes[2];
+    stats.closest_interps += probes[0];
+    stats.bilinear_interps += probes[1];
+    stats.cubic_interps += probes[2];
+    return ok;
+}
+
+
+
 void
 TextureSystemImpl::visualize_ellipse(const std::string& name, float dsdx,
                                      float dtdx, float dsdy, float dtdy,
@@ -2819,7 +5286,8 @@ TextureSystemImpl::visualize_ellipse(const std::string& name, float dsdx,
     float aspect      = TextureSystemImpl::anisotropic_aspect(majorlength,
                                                          minorlength, options,
                                                          trueaspect);
-    float* lineweight = ALLOCA(float, 2 * options.anisotropic);
+    float* lineweight = ALLOCA(float, round_to_multiple_of_pow2(
+                                          2 * options.anisotropic, 4));
     float smajor, tmajor, invsamples;
     int nsamples = compute_ellipse_sampling(aspect, theta, majorlength,
                                             minorlength, smajor, tmajor,
@@ -0,0 +1,142 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+
+#include <atomic>
+
+#ifndef _WIN32
+#    include <sys/mman.h>
+#endif
+
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/platform.h>
+
+#include "imagecache_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+
+
+TilePool::~TilePool()
+{
+    for (char* slab : m_slabs)
+        aligned_free(slab);
+}
+
+
+
+TilePool::SizeClass*
+TilePool::sizeclass(size_t size)
+{
+    if (size == 0 || size > max_pooled_bytes)
+        return nullptr;
+    for (auto& sc : m_classes) {
+        size_t s = sc.size.load();
+        if (s == size)
+            return &sc;
+        // Claim an unused class for this size. If we lose the race, the
+        // winner may have claimed it for the same size.
+        if (s == 0 && (sc.size.compare_exchange_strong(s, size) || s == size))
+            return &sc;
+    }
+    return nullptr;  // Too many different tile sizes, don't pool this one
+}
+
+
+
+char*
+TilePool::new_slab()
+{
+    bool huge  = m_hugepages;
+    char* slab = (char*)aligned_malloc(slab_bytes, huge ? slab_bytes : 4096);
+    if (!slab)
+        return nullptr;
+#ifdef MADV_HUGEPAGE
+    if (huge)
+        madvise(slab, slab_bytes, MADV_HUGEPAGE);
+#endif
+    spin_lock lock(m_slabs_mutex);
+    m_slabs.push_back(slab);
+    m_memory += slab_bytes;
+    return slab;
+}
+
+
+
+char*
+TilePool::alloc(size_t size)
+{
+    SizeClass* sc = sizeclass(size);
+    if (!sc)
+        return nullptr;
+    size_t stride = round_to_multiple(size, size_t(64));
+    spin_lock lock(sc->mutex);
+    if (!sc->freelist.empty()) {
+        char* p = sc->freelist.back();
+        sc->freelist.pop_back();
+        m_free_memory -= stride;
+        return p;
+    }
+    if (sc->slab_left < stride) {
+        // Carve out of a fresh slab. Whatever was left at the end of the
+        // old one is too small for this class, and stays unused.
+        sc->slab = new_slab();
+        if (!sc->slab) {
+            sc->slab_left = 0;
+            return nullptr;
+        }
+        sc->slab_left = slab_bytes;
+    }
+    char* p = sc->slab;
+    sc->slab += stride;
+    sc->slab_left -= stride;
+    return p;
+}
+
+
+
+void
+TilePool::free(char* p, size_t size)
+{
+    SizeClass* sc = sizeclass(size);
+    ASSERT(sc && "TilePool::free of a buffer it didn't allocate");
+    spin_lock lock(sc->mutex);
+    sc->freelist.push_back(p);
+    m_free_memory += round_to_multiple(size, size_t(64));
+}
+
+
+}  // end namespace pvt
+
+OIIO_NAMESPACE_END
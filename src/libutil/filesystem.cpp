@@ -29,18 +29,26 @@
 */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include <boost/tokenizer.hpp>
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/platform.h>
 #include <OpenImageIO/refcnt.h>
 #include <OpenImageIO/strutil.h>
+#include <OpenImageIO/thread.h>
 #include <OpenImageIO/ustring.h>
 
 #ifdef _WIN32
@@ -49,6 +57,10 @@
 #    include <io.h>
 #    include <shellapi.h>
 #else
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <sys/stat.h>
+#    include <sys/uio.h>
 #    include <unistd.h>
 #endif
 
@@ -206,15 +218,19 @@ Filesystem::searchpath_split(const std::string& searchpath,
 std::string
 Filesystem::searchpath_find(const std::string& filename_utf8,
                             const std::vector<std::string>& dirs, bool testcwd,
-                            bool recursive)
+                            bool recursive, float cache_ttl)
 {
     const filesystem::path filename(u8path(filename_utf8));
     bool abs = filename.is_absolute();
+    auto isreg = [=](const std::string& f) {
+        return cache_ttl > 0.0f ? cached_is_regular(f, cache_ttl)
+                                : is_regular(f);
+    };
 
     // If it's an absolute filename, or if we want to check "." first,
     // then start by checking filename outright.
     if (testcwd || abs) {
-        if (is_regular(filename_utf8))
+        if (isreg(filename_utf8))
             return filename_utf8;
     }
 
@@ -223,11 +239,21 @@ Filesystem::searchpath_find(const std::string& filename_utf8,
         // std::cerr << "\tPath = '" << d << "'\n";
         const filesystem::path d(u8path(d_utf8));
         filesystem::path f = d / filename;
-        if (is_regular(pathstr(f))) {
+        if (isreg(pathstr(f))) {
             return pathstr(f);
         }
 
-        if (recursive && is_directory(pathstr(d))) {
+        if (recursive && cache_ttl > 0.0f) {
+            std::vector<std::string> subdirs;
+            cached_directory_entries(d_utf8, subdirs, cache_ttl,
+                                     DirEntryDirectories);
+            for (auto& s : subdirs)
+                s = pathstr(d / u8path(s));
+            std::string found = searchpath_find(filename_utf8, subdirs, false,
+                                                true, cache_ttl);
+            if (found.size())
+                return found;
+        } else if (recursive && is_directory(pathstr(d))) {
             std::vector<std::string> subdirs;
             filesystem::directory_iterator end_iter;
             for (filesystem::directory_iterator s(d); s != end_iter; ++s) {
@@ -284,6 +310,214 @@ Filesystem::get_directory_entries(const std::string& dirname,
 
 
 
+namespace {
+
+// A process-wide cache of directory listings. Each listing is read in one
+// pass over the directory, taking the file types from the directory
+// entries themselves where the OS supplies them, and only stat'ing (in
+// parallel, for big directories) the entries whose type it doesn't
+// supply, such as symbolic links.
+struct DirListing {
+    struct Entry {
+        std::string name;
+        bool regular;    // a regular file, or a link to one
+        bool directory;  // a directory, or a link to one
+        bool operator<(const Entry& e) const { return name < e.name; }
+    };
+    std::vector<Entry> entries;  // sorted by name
+    bool ok = false;             // Could it be read at all?
+    std::chrono::steady_clock::time_point when;
+
+    const Entry* find(const std::string& name) const
+    {
+        auto e = std::lower_bound(entries.begin(), entries.end(),
+                                  Entry { name, false, false });
+        return (e != entries.end() && e->name == name) ? &*e : nullptr;
+    }
+};
+
+typedef std::shared_ptr<const DirListing> DirListingRef;
+
+
+
+DirListingRef
+read_directory(const std::string& dirname)
+{
+    std::shared_ptr<DirListing> listing(new DirListing);
+    listing->when = std::chrono::steady_clock::now();
+#ifndef _WIN32
+    DIR* dir = opendir(dirname.size() ? dirname.c_str() : ".");
+    if (!dir)
+        return listing;
+    std::vector<size_t> unknown;  // entries whose type needs a stat
+    while (struct dirent* de = readdir(dir)) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+        DirListing::Entry e { de->d_name, false, false };
+#    ifdef DT_REG
+        if (de->d_type == DT_REG)
+            e.regular = true;
+        else if (de->d_type == DT_DIR)
+            e.directory = true;
+        else if (de->d_type == DT_LNK || de->d_type == DT_UNKNOWN)
+#    endif
+            unknown.push_back(listing->entries.size());
+        listing->entries.push_back(std::move(e));
+    }
+    // Stat relative to the open directory, which spares resolving the
+    // whole path again for every entry.
+    int fd          = dirfd(dir);
+    auto stat_entry = [&](int64_t i) {
+        DirListing::Entry& e(listing->entries[unknown[i]]);
+        struct stat st;
+        if (fstatat(fd, e.name.c_str(), &st, 0) == 0) {
+            e.regular   = S_ISREG(st.st_mode);
+            e.directory = S_ISDIR(st.st_mode);
+        }
+    };
+    // Over a network, each of these is a round trip to the server, so
+    // for more than a few, have several in flight at once.
+    if (unknown.size() > 64)
+        parallel_for(0, int64_t(unknown.size()), stat_entry);
+    else
+        for (size_t i = 0; i < unknown.size(); ++i)
+            stat_entry(int64_t(i));
+    closedir(dir);
+    listing->ok = true;
+#else
+    try {
+        // On Windows, the directory iterator already holds each entry's
+        // attributes, so asking for its status costs nothing more.
+        filesystem::path dirpath(dirname.size() ? u8path(dirname)
+                                                : filesystem::path("."));
+        for (filesystem::directory_iterator s(dirpath);
+             s != filesystem::directory_iterator(); ++s) {
+            auto status = s->status();
+            listing->entries.push_back(
+                { pathstr(s->path().filename()),
+                  filesystem::is_regular_file(status),
+                  filesystem::is_directory(status) });
+        }
+        listing->ok = true;
+    } catch (...) {
+        listing->entries.clear();
+        return listing;
+    }
+#endif
+    std::sort(listing->entries.begin(), listing->entries.end());
+    return listing;
+}
+
+
+
+class DirectoryCache {
+public:
+    DirListingRef get(const std::string& dirname, float ttl)
+    {
+        std::string key = cache_key(dirname);
+        if (ttl > 0.0f) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_listings.find(key);
+            if (found != m_listings.end() && fresh(*found->second, ttl))
+                return found->second;
+        }
+        // Read it without holding the lock, so that lookups in other
+        // directories needn't wait on a slow file system.
+        DirListingRef listing = read_directory(key);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_listings.size() >= max_listings)
+            prune();
+        m_listings[key] = listing;
+        return listing;
+    }
+
+    void clear(const std::string& dirname)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (dirname.empty())
+            m_listings.clear();
+        else
+            m_listings.erase(cache_key(dirname));
+    }
+
+private:
+    enum { max_listings = 4096 };
+    std::mutex m_mutex;
+    std::unordered_map<std::string, DirListingRef> m_listings;
+
+    // "dir" and "dir/" are the same directory
+    static std::string cache_key(std::string dirname)
+    {
+        while (dirname.size() > 1
+               && (dirname.back() == '/' || dirname.back() == '\\'))
+            dirname.pop_back();
+        return dirname;
+    }
+
+    static bool fresh(const DirListing& listing, float ttl)
+    {
+        return std::chrono::steady_clock::now() - listing.when
+               < std::chrono::duration<float>(ttl);
+    }
+
+    // Make room by dropping the listings nobody could still be using. Which
+    // ttl that is isn't known here, so go by the oldest half.
+    void prune()
+    {
+        std::vector<std::chrono::steady_clock::time_point> times;
+        for (auto& l : m_listings)
+            times.push_back(l.second->when);
+        auto mid = times.begin() + times.size() / 2;
+        std::nth_element(times.begin(), mid, times.end());
+        for (auto l = m_listings.begin(); l != m_listings.end();)
+            l = (l->second->when <= *mid) ? m_listings.erase(l) : ++l;
+    }
+};
+
+DirectoryCache directory_cache;
+
+}  // namespace
+
+
+
+bool
+Filesystem::cached_directory_entries(const std::string& dirname,
+                                     std::vector<std::string>& filenames,
+                                     float ttl, int which)
+{
+    filenames.clear();
+    DirListingRef listing = directory_cache.get(dirname, ttl);
+    for (auto& e : listing->entries)
+        if (((which & DirEntryFiles) && e.regular)
+            || ((which & DirEntryDirectories) && e.directory)
+            || ((which & DirEntryOther) && !e.regular && !e.directory))
+            filenames.push_back(e.name);
+    return listing->ok;
+}
+
+
+
+bool
+Filesystem::cached_is_regular(const std::string& path, float ttl)
+{
+    const filesystem::path p(u8path(path));
+    std::string name = pathstr(p.filename());
+    if (name.empty() || name == "." || name == ".." || name == "/")
+        return is_regular(path);
+    auto e = directory_cache.get(pathstr(p.parent_path()), ttl)->find(name);
+    return e && e->regular;
+}
+
+
+
+void
+Filesystem::clear_directory_cache(const std::string& dirname)
+{
+    directory_cache.clear(dirname);
+}
+
+
+
 bool
 Filesystem::path_is_absolute(const std::string& path, bool dot_is_absolute)
 {
@@ -893,20 +1127,39 @@ Filesystem::scan_for_matching_filenames(const std::string& pattern_,
     try {
         regex pattern_re(pattern_re_str);
 
-        filesystem::directory_iterator end_it;
-        for (filesystem::directory_iterator it(u8path(directory)); it != end_it;
-             ++it) {
-            const std::string f = pathstr(it->path());
-            if (is_regular(f)) {
-                match_results<std::string::const_iterator> frame_match;
+        // One pass over the directory gives the names and which are files
+        // (refreshing the shared cache for anyone else looking there).
+        std::vector<std::string> names;
+        cached_directory_entries(directory, names, 0.0f, DirEntryFiles);
+        const filesystem::path dirpath(u8path(directory));
+        std::vector<std::pair<int, std::string>> found(names.size());
+        std::atomic<bool> botched(false);
+        auto match_entry = [&](int64_t i) {
+            std::string f = pathstr(dirpath / u8path(names[i]));
+            match_results<std::string::const_iterator> frame_match;
+            try {
                 if (regex_match(f, frame_match, pattern_re)) {
                     std::string thenumber(frame_match[1].first,
                                           frame_match[1].second);
-                    int frame = Strutil::stoi(thenumber);
-                    matches.push_back(std::make_pair(frame, f));
+                    found[i] = std::make_pair(Strutil::stoi(thenumber),
+                                              std::move(f));
                 }
+            } catch (...) {
+                botched = true;  // Don't let it escape a worker thread
             }
-        }
+        };
+        // Directories holding long sequences can have many thousands of
+        // entries to match.
+        if (names.size() > 1000)
+            parallel_for(0, int64_t(names.size()), match_entry);
+        else
+            for (size_t i = 0; i < names.size(); ++i)
+                match_entry(int64_t(i));
+        if (botched)
+            return false;
+        for (auto& m : found)
+            if (m.second.size())
+                matches.push_back(std::move(m));
 
     } catch (...) {
         // Botched regex. Just fail.
@@ -926,6 +1179,28 @@ Filesystem::scan_for_matching_filenames(const std::string& pattern_,
 
 
 
+bool
+Filesystem::IOProxy::pread_batch(span<ReadRequest> reqs)
+{
+    bool ok = true;
+    for (auto& r : reqs) {
+        r.result = pread(r.buf, r.size, r.offset);
+        ok &= (r.result == r.size);
+    }
+    return ok;
+}
+
+
+
+std::future<bool>
+Filesystem::IOProxy::pread_batch_async(span<ReadRequest> reqs)
+{
+    return background_thread_pool()->push(
+        [this, reqs](int /*id*/) { return pread_batch(reqs); });
+}
+
+
+
 Filesystem::IOFile::IOFile(string_view filename, Mode mode)
     : IOProxy(filename, mode)
 {
@@ -933,7 +1208,7 @@ Filesystem::IOFile::IOFile(string_view filename, Mode mode)
     // which std fopen does not.
     m_file = Filesystem::fopen(m_filename.c_str(), mode == Write ? "wb" : "rb");
     if (!m_file)
-        mode = Closed;
+        m_mode = Closed;
     m_auto_close = true;
     if (mode == Read)
         m_size = Filesystem::file_size(filename);
@@ -1012,6 +1287,70 @@ Filesystem::IOFile::pread(void* buf, size_t size, int64_t offset)
 #endif
 }
 
+bool
+Filesystem::IOFile::pread_batch(span<ReadRequest> reqs)
+{
+    if (!m_file || m_mode != Read)
+        return IOProxy::pread_batch(reqs);  // will fail each request
+
+    // Sort by offset so that requests for adjacent byte ranges (tiles and
+    // chunks are often laid out back to back) can be merged into a single
+    // vectored read.
+    std::vector<ReadRequest*> order(reqs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = &reqs[i];
+    std::sort(order.begin(), order.end(),
+              [](const ReadRequest* a, const ReadRequest* b) {
+                  return a->offset < b->offset;
+              });
+    // Group them into runs [b,e) of exactly abutting requests.
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t b = 0, e = 0; b < order.size(); b = e) {
+        const ReadRequest* last = order[b];
+        for (e = b + 1; e < order.size(); last = order[e++])
+            if (order[e]->offset != last->offset + int64_t(last->size))
+                break;
+        runs.emplace_back(b, e);
+    }
+
+    auto read_run = [&](size_t b, size_t e) {
+#if defined(__linux__) || defined(__FreeBSD__)
+        int fd = fileno(m_file);
+        while (e - b > 1) {
+            size_t n = std::min(e - b, size_t(1024));  // IOV_MAX on Linux
+            std::vector<iovec> iov(n);
+            for (size_t i = 0; i < n; ++i) {
+                iov[i].iov_base = order[b + i]->buf;
+                iov[i].iov_len  = order[b + i]->size;
+            }
+            ssize_t r     = ::preadv(fd, iov.data(), int(n), order[b]->offset);
+            size_t remain = r > 0 ? size_t(r) : 0;
+            for (size_t i = 0; i < n; ++i, ++b) {
+                order[b]->result = std::min(remain, order[b]->size);
+                remain -= order[b]->result;
+            }
+        }
+#endif
+        for (; b < e; ++b)
+            order[b]->result = pread(order[b]->buf, order[b]->size,
+                                     order[b]->offset);
+    };
+    // Independent runs are issued concurrently, so that devices with deep
+    // queues (NVMe, network file systems) see them all at once rather than
+    // one blocking request at a time.
+    if (runs.size() > 1)
+        parallel_for(0, int64_t(runs.size()), [&](int64_t i) {
+            read_run(runs[i].first, runs[i].second);
+        });
+    else if (runs.size() == 1)
+        read_run(runs[0].first, runs[0].second);
+
+    bool ok = true;
+    for (auto& r : reqs)
+        ok &= (r.result == r.size);
+    return ok;
+}
+
 size_t
 Filesystem::IOFile::write(const void* buf, size_t size)
 {
@@ -1098,6 +1437,29 @@ Filesystem::IOVecOutput::pwrite(const void* buf, size_t size, int64_t offset)
 
 
 
+size_t
+Filesystem::IOVecOutput::read(void* buf, size_t size)
+{
+    size = pread(buf, size, m_pos);
+    m_pos += size;
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOVecOutput::pread(void* buf, size_t size, int64_t offset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (offset < 0 || size_t(offset) >= m_buf.size())
+        return 0;
+    size = std::min(size, m_buf.size() - size_t(offset));
+    memcpy(buf, &m_buf[offset], size);
+    return size;
+}
+
+
+
 size_t
 Filesystem::IOMemReader::read(void* buf, size_t size)
 {
@@ -1111,6 +1473,8 @@ size_t
 Filesystem::IOMemReader::pread(void* buf, size_t size, int64_t offset)
 {
     // N.B. No lock necessary
+    if (offset < 0 || size_t(offset) >= size_t(m_buf.size()))
+        return 0;
     if (size + size_t(offset) > size_t(m_buf.size()))
         size = m_buf.size() - size_t(offset);
     memcpy(buf, m_buf.data() + offset, size);
@@ -1118,4 +1482,268 @@ Filesystem::IOMemReader::pread(void* buf, size_t size, int64_t offset)
 }
 
 
+class Filesystem::IORangeReader::Impl {
+public:
+    typedef std::shared_ptr<const std::vector<unsigned char>> BlockRef;
+
+    Impl(int64_t size, Fetcher&& fetch, size_t blocksize, size_t maxblocks,
+         int readahead)
+        : m_fetch(std::move(fetch))
+        , m_size(std::max(size, int64_t(0)))
+        , m_blocksize(std::max(blocksize, size_t(1)))
+        , m_maxblocks(std::max(maxblocks, size_t(1)))
+        , m_readahead(std::max(readahead, 0))
+    {
+    }
+
+    size_t pread(void* buf, size_t size, int64_t offset);
+
+    Fetcher m_fetch;
+    int64_t m_size;
+    size_t m_blocksize;
+    size_t m_maxblocks;
+    int m_readahead;
+    std::atomic<int64_t> m_fetches { 0 };
+
+private:
+    struct Entry {
+        BlockRef data;
+        uint64_t lastuse;
+    };
+    std::mutex m_mutex;  // protects everything below
+    std::map<int64_t, Entry> m_blocks;
+    uint64_t m_clock     = 0;
+    int64_t m_next_block = -1;  // block after the last read, for readahead
+
+    // Size of block b (only the last one may be smaller than m_blocksize).
+    size_t block_bytes(int64_t b) const
+    {
+        int64_t offset = b * int64_t(m_blocksize);
+        return size_t(std::min(int64_t(m_blocksize), m_size - offset));
+    }
+
+    BlockRef fetch_block(int64_t b)
+    {
+        size_t n = block_bytes(b);
+        std::shared_ptr<std::vector<unsigned char>> data(
+            new std::vector<unsigned char>(n));
+        ++m_fetches;
+        data->resize(m_fetch(data->data(), n, b * int64_t(m_blocksize)));
+        return data;
+    }
+};
+
+
+
+size_t
+Filesystem::IORangeReader::Impl::pread(void* buf, size_t size, int64_t offset)
+{
+    if (offset < 0 || offset >= m_size || !size)
+        return 0;
+    size          = size_t(std::min(int64_t(size), m_size - offset));
+    int64_t bsize = int64_t(m_blocksize);
+    int64_t first = offset / bsize;
+    int64_t last  = (offset + int64_t(size) - 1) / bsize;
+    int64_t nblks = (m_size + bsize - 1) / bsize;
+
+    // Find out which blocks we have, and which we must fetch.
+    std::vector<BlockRef> have(size_t(last - first + 1));
+    std::vector<int64_t> missing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A read that picks up where the last one left off is probably
+        // part of a sequential scan, so prefetch the blocks after it.
+        int64_t end = last + 1;
+        if (first <= m_next_block && m_next_block <= last + 1)
+            end = std::min(last + 1 + m_readahead, nblks);
+        m_next_block = last + 1;
+        for (int64_t b = first; b < end; ++b) {
+            auto found = m_blocks.find(b);
+            if (found != m_blocks.end()) {
+                found->second.lastuse = ++m_clock;
+                if (b <= last)
+                    have[size_t(b - first)] = found->second.data;
+            } else {
+                missing.push_back(b);
+            }
+        }
+    }
+
+    // Fetch the missing blocks (including any readahead) all at once.
+    if (missing.size()) {
+        std::vector<BlockRef> fetched(missing.size());
+        if (missing.size() > 1)
+            parallel_for(0, int64_t(missing.size()), [&](int64_t i) {
+                fetched[size_t(i)] = fetch_block(missing[size_t(i)]);
+            });
+        else
+            fetched[0] = fetch_block(missing[0]);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < missing.size(); ++i) {
+            int64_t b = missing[i];
+            if (b <= last)
+                have[size_t(b - first)] = fetched[i];
+            // Short (failed) fetches aren't cached, so they'll be retried.
+            if (fetched[i]->size() == block_bytes(b))
+                m_blocks[b] = Entry { fetched[i], ++m_clock };
+        }
+        // Evict the least recently used blocks until we're within budget.
+        // Anything still being copied below is kept alive by `have`.
+        while (m_blocks.size() > m_maxblocks) {
+            auto lru = m_blocks.begin();
+            for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+                if (it->second.lastuse < lru->second.lastuse)
+                    lru = it;
+            m_blocks.erase(lru);
+        }
+    }
+
+    // Copy out of the blocks, stopping after the first short one.
+    size_t copied = 0;
+    for (int64_t b = first; b <= last; ++b) {
+        const std::vector<unsigned char>& data(*have[size_t(b - first)]);
+        size_t start = size_t(offset + int64_t(copied) - b * bsize);
+        if (start < data.size()) {
+            size_t n = std::min(size - copied, data.size() - start);
+            memcpy((char*)buf + copied, data.data() + start, n);
+            copied += n;
+        }
+        if (data.size() < block_bytes(b))
+            break;
+    }
+    return copied;
+}
+
+
+
+Filesystem::IORangeReader::IORangeReader(string_view name, int64_t size,
+                                         Fetcher fetch, size_t blocksize,
+                                         size_t maxblocks, int readahead)
+    : IOProxy(name, Read)
+    , m_impl(new Impl(size, std::move(fetch), blocksize, maxblocks,
+                      readahead))
+{
+    if (!m_impl->m_fetch)
+        m_mode = Closed;
+}
+
+
+
+Filesystem::IORangeReader::~IORangeReader() {}
+
+
+
+size_t
+Filesystem::IORangeReader::read(void* buf, size_t size)
+{
+    size = pread(buf, size, m_pos);
+    m_pos += size;
+    return size;
+}
+
+
+
+size_t
+Filesystem::IORangeReader::pread(void* buf, size_t size, int64_t offset)
+{
+    if (m_mode != Read)
+        return 0;
+    return m_impl->pread(buf, size, offset);
+}
+
+
+
+size_t
+Filesystem::IORangeReader::size() const
+{
+    return size_t(m_impl->m_size);
+}
+
+
+
+int64_t
+Filesystem::IORangeReader::fetches() const
+{
+    return m_impl->m_fetches;
+}
+
+
+
+static std::mutex url_opener_mutex;
+
+static std::map<std::string, Filesystem::URLOpener>&
+url_openers()
+{
+    static std::map<std::string, Filesystem::URLOpener> openers;
+    return openers;
+}
+
+
+
+// Return the lower-cased scheme of "scheme://rest", or "" if it's not
+// in that form.
+static std::string
+url_scheme(string_view name)
+{
+    size_t colon = name.find("://");
+    if (colon == string_view::npos || colon == 0)
+        return std::string();
+    std::string scheme = name.substr(0, colon);
+    for (char c : scheme)
+        if (!isalnum((unsigned char)c) && c != '+' && c != '-' && c != '.')
+            return std::string();
+    Strutil::to_lower(scheme);
+    return scheme;
+}
+
+
+
+void
+Filesystem::register_url_opener(string_view scheme, URLOpener opener)
+{
+    std::string s = scheme;
+    Strutil::to_lower(s);
+    std::lock_guard<std::mutex> lock(url_opener_mutex);
+    if (opener)
+        url_openers()[s] = opener;
+    else
+        url_openers().erase(s);
+}
+
+
+
+bool
+Filesystem::is_url(string_view name)
+{
+    std::string scheme = url_scheme(name);
+    if (scheme.empty())
+        return false;
+    std::lock_guard<std::mutex> lock(url_opener_mutex);
+    return url_openers().count(scheme) != 0;
+}
+
+
+
+Filesystem::IOProxy*
+Filesystem::open_url(string_view url)
+{
+    URLOpener opener;
+    {
+        std::lock_guard<std::mutex> lock(url_opener_mutex);
+        auto found = url_openers().find(url_scheme(url));
+        if (found == url_openers().end())
+            return nullptr;
+        opener = found->second;
+    }
+    // N.B. call it without the lock held, openers may be slow.
+    IOProxy* io = opener(url);
+    if (io && !io->opened()) {
+        delete io;
+        io = nullptr;
+    }
+    return io;
+}
+
+
+
 OIIO_NAMESPACE_END
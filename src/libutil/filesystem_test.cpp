@@ -507,6 +507,83 @@ test_scan_sequences()
 
 
 
+void
+test_directory_cache()
+{
+    std::cout << "Testing directory cache\n";
+    std::string err;
+    Filesystem::remove_all("dircache", err);
+    Filesystem::create_directory("dircache", err);
+    Filesystem::create_directory("dircache/sub", err);
+    create_test_file("dircache/a.tx");
+    create_test_file("dircache/b.tx");
+    create_test_file("dircache/sub/c.tx");
+
+    std::vector<std::string> names;
+    OIIO_CHECK_ASSERT(Filesystem::cached_directory_entries("dircache", names,
+                                                           1000.0f));
+    OIIO_CHECK_EQUAL(Strutil::join(names, " "), "a.tx b.tx sub");
+    Filesystem::cached_directory_entries("dircache/", names, 1000.0f,
+                                         Filesystem::DirEntryFiles);
+    OIIO_CHECK_EQUAL(Strutil::join(names, " "), "a.tx b.tx");
+    Filesystem::cached_directory_entries("dircache", names, 1000.0f,
+                                         Filesystem::DirEntryDirectories);
+    OIIO_CHECK_EQUAL(Strutil::join(names, " "), "sub");
+    OIIO_CHECK_ASSERT(!Filesystem::cached_directory_entries("nonexistent",
+                                                            names, 1000.0f));
+
+    OIIO_CHECK_ASSERT(Filesystem::cached_is_regular("dircache/a.tx", 1000.0f));
+    OIIO_CHECK_ASSERT(!Filesystem::cached_is_regular("dircache/sub", 1000.0f));
+    OIIO_CHECK_ASSERT(!Filesystem::cached_is_regular("dircache/x.tx", 1000.0f));
+
+    // A file created since the listing isn't seen until the listing is
+    // read again.
+    create_test_file("dircache/x.tx");
+    OIIO_CHECK_ASSERT(!Filesystem::cached_is_regular("dircache/x.tx", 1000.0f));
+    OIIO_CHECK_ASSERT(Filesystem::cached_is_regular("dircache/x.tx", 0.0f));
+    Filesystem::remove("dircache/x.tx", err);
+    OIIO_CHECK_ASSERT(Filesystem::cached_is_regular("dircache/x.tx", 1000.0f));
+    Filesystem::clear_directory_cache("dircache/");
+    OIIO_CHECK_ASSERT(!Filesystem::cached_is_regular("dircache/x.tx", 1000.0f));
+
+    std::vector<std::string> dirs { "dircache" DIRSEP "sub", "dircache" };
+    OIIO_CHECK_EQUAL(Filesystem::searchpath_find("b.tx", dirs, false, false,
+                                                 1000.0f),
+                     "dircache" DIRSEP "b.tx");
+    OIIO_CHECK_EQUAL(Filesystem::searchpath_find("c.tx", dirs, false, false,
+                                                 1000.0f),
+                     "dircache" DIRSEP "sub" DIRSEP "c.tx");
+    OIIO_CHECK_EQUAL(Filesystem::searchpath_find("sub" DIRSEP "c.tx", dirs,
+                                                 false, false, 1000.0f),
+                     "dircache" DIRSEP "sub" DIRSEP "c.tx");
+    dirs = { "dircache" };
+    OIIO_CHECK_EQUAL(Filesystem::searchpath_find("c.tx", dirs, false, true,
+                                                 1000.0f),
+                     "dircache" DIRSEP "sub" DIRSEP "c.tx");
+    OIIO_CHECK_EQUAL(Filesystem::searchpath_find("sub", dirs, false, false,
+                                                 1000.0f),
+                     "");
+
+    // Enough frames for the scan to match them in parallel
+    for (int i = 1; i <= 1200; ++i)
+        create_test_file(Strutil::sprintf("dircache/seq.%04d.exr", i));
+    std::vector<int> numbers;
+    OIIO_CHECK_ASSERT(
+        Filesystem::scan_for_matching_filenames("dircache/seq.%04d.exr",
+                                                numbers, names));
+    OIIO_CHECK_EQUAL(numbers.size(), 1200);
+    OIIO_CHECK_EQUAL(names.size(), 1200);
+    if (names.size() == 1200) {
+        OIIO_CHECK_EQUAL(numbers[0], 1);
+        OIIO_CHECK_EQUAL(numbers[1199], 1200);
+        OIIO_CHECK_EQUAL(names[41], "dircache" DIRSEP "seq.0042.exr");
+    }
+    Filesystem::remove_all("dircache", err);
+    Filesystem::clear_directory_cache();
+}
+
+
+
 void
 test_mem_proxies()
 {
@@ -535,6 +612,127 @@ test_mem_proxies()
 
 
 
+void
+test_pread_batch()
+{
+    std::cout << "Testing batched preads:\n";
+    const char* fn = "pread_batch_test.bin";
+    std::vector<unsigned char> data(10000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (unsigned char)(i * 7 + 3);
+    {
+        Filesystem::IOFile out(fn, Filesystem::IOProxy::Write);
+        out.write(data.data(), data.size());
+    }
+
+    // A mix of abutting requests (which may be merged), scattered ones, a
+    // repeated offset, and one that runs off the end of the file.
+    const int64_t offsets[] = { 100, 0, 40, 5000, 60, 60, 9990 };
+    const size_t sizes[]    = { 900, 40, 20, 123, 40, 7, 100 };
+    const int n             = 7;
+    std::vector<std::vector<unsigned char>> bufs(n);
+    std::vector<Filesystem::IOProxy::ReadRequest> reqs(n);
+    for (int i = 0; i < n; ++i) {
+        bufs[i].resize(sizes[i]);
+        reqs[i] = { bufs[i].data(), sizes[i], offsets[i], 0 };
+    }
+
+    Filesystem::IOFile in(fn, Filesystem::IOProxy::Read);
+    in.seek(17);
+    OIIO_CHECK_ASSERT(!in.pread_batch(reqs));  // last one is short
+    OIIO_CHECK_EQUAL(in.tell(), 17);           // position untouched
+    for (int i = 0; i < n; ++i) {
+        size_t expected = std::min(sizes[i], data.size() - size_t(offsets[i]));
+        OIIO_CHECK_EQUAL(reqs[i].result, expected);
+        OIIO_CHECK_ASSERT(
+            !memcmp(bufs[i].data(), &data[offsets[i]], reqs[i].result));
+    }
+
+    // The same batch, minus the bad request, run asynchronously and
+    // through the generic implementation used by the memory reader.
+    reqs.pop_back();
+    for (auto& r : reqs)
+        r.result = 0;
+    auto f = in.pread_batch_async(reqs);
+    OIIO_CHECK_ASSERT(f.get());
+    Filesystem::IOMemReader mem(data);
+    OIIO_CHECK_ASSERT(mem.pread_batch(reqs));
+    for (size_t i = 0; i < reqs.size(); ++i)
+        OIIO_CHECK_ASSERT(
+            !memcmp(bufs[i].data(), &data[offsets[i]], sizes[i]));
+
+    in.close();
+    Filesystem::remove(fn);
+}
+
+
+
+void
+test_range_reader()
+{
+    std::cout << "Testing block-caching range reader:\n";
+    std::vector<unsigned char> data(1000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (unsigned char)(i * 13 + 1);
+    // Stand-in for a remote fetch, e.g. an HTTP range request.
+    auto fetch = [&](void* buf, size_t size, int64_t offset) -> size_t {
+        size = std::min(size, data.size() - size_t(offset));
+        memcpy(buf, &data[offset], size);
+        return size;
+    };
+
+    // 100-byte blocks, at most 4 cached, read ahead 2.
+    Filesystem::IORangeReader in("remote", int64_t(data.size()), fetch, 100,
+                                 4, 2);
+    OIIO_CHECK_ASSERT(in.opened());
+    OIIO_CHECK_EQUAL(in.size(), data.size());
+    unsigned char buf[400];
+
+    // A read straddling blocks 1-2 fetches just those two.
+    OIIO_CHECK_EQUAL(in.pread(buf, 150, 120), 150);
+    OIIO_CHECK_ASSERT(!memcmp(buf, &data[120], 150));
+    OIIO_CHECK_EQUAL(in.fetches(), 2);
+    // Rereading is served from the cache.
+    OIIO_CHECK_EQUAL(in.pread(buf, 50, 150), 50);
+    OIIO_CHECK_EQUAL(in.fetches(), 2);
+    // Continuing sequentially into block 2 reads ahead blocks 3-4, and
+    // then block 3 reads ahead just block 5, since 4 is already cached.
+    OIIO_CHECK_EQUAL(in.pread(buf, 30, 270), 30);
+    OIIO_CHECK_ASSERT(!memcmp(buf, &data[270], 30));
+    OIIO_CHECK_EQUAL(in.fetches(), 4);
+    OIIO_CHECK_EQUAL(in.pread(buf, 100, 300), 100);
+    OIIO_CHECK_ASSERT(!memcmp(buf, &data[300], 100));
+    OIIO_CHECK_EQUAL(in.fetches(), 5);
+    // Reads are clamped to the end of the source.
+    in.seek(950);
+    OIIO_CHECK_EQUAL(in.read(buf, 100), 50);
+    OIIO_CHECK_ASSERT(!memcmp(buf, &data[950], 50));
+    OIIO_CHECK_EQUAL(in.tell(), 1000);
+    OIIO_CHECK_EQUAL(in.pread(buf, 10, 1000), 0);
+    // Blocks 1-2 were evicted (LRU, 4 blocks max) and are fetched again.
+    int64_t before = in.fetches();
+    OIIO_CHECK_EQUAL(in.pread(buf, 10, 100), 10);
+    OIIO_CHECK_EQUAL(in.fetches(), before + 1);
+
+    // URL openers, by scheme.
+    OIIO_CHECK_ASSERT(!Filesystem::is_url("test://a/b.exr"));
+    Filesystem::register_url_opener("test", [&](string_view) {
+        return new Filesystem::IORangeReader("", int64_t(data.size()), fetch);
+    });
+    OIIO_CHECK_ASSERT(Filesystem::is_url("TEST://a/b.exr"));
+    OIIO_CHECK_ASSERT(!Filesystem::is_url("/a/b.exr"));
+    OIIO_CHECK_ASSERT(!Filesystem::is_url("other://a/b.exr"));
+    std::unique_ptr<Filesystem::IOProxy> io(
+        Filesystem::open_url("test://a/b.exr"));
+    OIIO_CHECK_ASSERT(io && io->read(buf, 400) == 400
+                      && !memcmp(buf, &data[0], 400));
+    Filesystem::register_url_opener("test", nullptr);
+    OIIO_CHECK_ASSERT(!Filesystem::is_url("test://a/b.exr"));
+    OIIO_CHECK_ASSERT(Filesystem::open_url("test://a/b.exr") == nullptr);
+}
+
+
+
 int
 main(int argc, char* argv[])
 {
@@ -543,7 +741,10 @@ main(int argc, char* argv[])
     test_file_status();
     test_frame_sequences();
     test_scan_sequences();
+    test_directory_cache();
     test_mem_proxies();
+    test_pread_batch();
+    test_range_reader();
 
     return unit_test_failures;
 }
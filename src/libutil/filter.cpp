@@ -44,6 +44,7 @@
 
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -1010,4 +1011,36 @@ Filter2D::destroy(Filter2D* filt)
 }
 
 
+
+void
+FilterTable::init(const Filter2D& filter, int resolution)
+{
+    m_filter = &filter;
+    m_x.clear();
+    m_y.clear();
+    float w = filter.width(), h = filter.height();
+    if (!filter.separable() || !(w > 0.0f && h > 0.0f))
+        return;  // operator() will call the filter itself
+    int n = std::max(2, resolution & ~1);  // even, so 0 is a sample
+    m_x.resize(n + 3);
+    m_y.resize(n + 3);
+    for (int i = 0; i <= n; ++i) {
+        float u = float(i) / float(n) - 0.5f;  // -1/2 .. 1/2
+        m_x[i]  = filter.xfilt(u * w);
+        m_y[i]  = filter.yfilt(u * h);
+    }
+    m_x[n + 1] = m_x[0];
+    m_x[n + 2] = m_x[n];
+    m_y[n + 1] = m_y[0];
+    m_y[n + 2] = m_y[n];
+    // The ends for interpolation are the limits from inside the support.
+    m_x[0] = filter.xfilt(std::nextafter(-0.5f * w, 0.0f));
+    m_x[n] = filter.xfilt(std::nextafter(0.5f * w, 0.0f));
+    m_y[0] = filter.yfilt(std::nextafter(-0.5f * h, 0.0f));
+    m_y[n] = filter.yfilt(std::nextafter(0.5f * h, 0.0f));
+    m_xscale   = float(n) / w;
+    m_yscale   = float(n) / h;
+}
+
+
 OIIO_NAMESPACE_END
@@ -86,6 +86,55 @@ getargs(int argc, char* argv[])
 
 
 
+// Check that every 2D filter's FilterTable matches the filter itself,
+// including outside its support, and time the two.
+static void
+test_filter_table(Benchmarker& bench)
+{
+    std::cout << "\nFilterTable vs Filter2D:\n";
+    for (int i = 0, e = Filter2D::num_filters(); i < e; ++i) {
+        FilterDesc fd;
+        Filter2D::get_filterdesc(i, &fd);
+        // Unequal sizes, to catch any mixup of the x and y tables
+        Filter2D* f = Filter2D::create(fd.name, fd.width, 1.5f * fd.width);
+        FilterTable table(*f);
+        OIIO_CHECK_EQUAL(table.tabulated(), fd.separable);
+        float peak = std::max(fabsf(f->xfilt(0.0f)), fabsf(f->yfilt(0.0f)));
+        float maxerr = 0.0f;
+        const int n  = 10000;
+        for (int j = 0; j <= n; ++j) {
+            float x = (float(j) / n - 0.5f) * 2.0f * f->width();
+            float y = (float(j) / n - 0.5f) * 2.0f * f->height();
+            maxerr  = std::max(maxerr, fabsf(table.xfilt(x) - f->xfilt(x)));
+            maxerr  = std::max(maxerr, fabsf(table.yfilt(y) - f->yfilt(y)));
+            maxerr  = std::max(maxerr, fabsf(table(x, 0.5f * y)
+                                             - (*f)(x, 0.5f * y)));
+        }
+        if (verbose)
+            std::cout << "  " << fd.name << " max error " << maxerr / peak
+                      << "\n";
+        OIIO_CHECK_LT(maxerr, 1.0e-5f * peak);
+        // Exactly at the edges, where box is 1 and gaussian is already 0
+        for (float x : { -0.5f * f->width(), 0.5f * f->width() })
+            OIIO_CHECK_EQUAL(table.xfilt(x), f->xfilt(x));
+
+        const size_t ncalls = 100000;
+        bench.work(ncalls);
+        float ninv = f->width() / ncalls;
+        bench(Strutil::sprintf("%s xfilt", fd.name), [=]() {
+            for (size_t i = 0; i < ncalls; ++i)
+                DoNotOptimize(f->xfilt(i * ninv - 0.5f * f->width()));
+        });
+        bench(Strutil::sprintf("%s table", fd.name), [&]() {
+            for (size_t i = 0; i < ncalls; ++i)
+                DoNotOptimize(table.xfilt(i * ninv - 0.5f * f->width()));
+        });
+        Filter2D::destroy(f);
+    }
+}
+
+
+
 int
 main(int argc, char* argv[])
 {
@@ -147,5 +196,7 @@ main(int argc, char* argv[])
 
     graph.write("filters.tif");
 
+    test_filter_table(bench);
+
     return unit_test_failures != 0;
 }
@@ -223,6 +223,63 @@ test_convert_type(double tolerance = 1e-6)
 
 
 
+// The (SIMD) conversion of arrays must give exactly the same values as
+// converting them one at a time.
+template<typename S, typename D>
+void
+test_convert_type_array(const std::vector<S>& svec)
+{
+    std::vector<D> dvec(svec.size());
+    convert_type(svec.data(), dvec.data(), svec.size());
+    int bad = 0;
+    for (size_t i = 0; i < svec.size(); ++i) {
+        D d = convert_type<S, D>(svec[i]);
+        if (memcmp(&d, &dvec[i], sizeof(D)) && bad++ < 5)
+            std::cout << "  convert " << +svec[i] << " -> " << +dvec[i]
+                      << ", expected " << +d << "\n";
+    }
+    OIIO_CHECK_EQUAL(bad, 0);
+}
+
+
+template<typename T>
+std::vector<T>
+all_values()
+{
+    std::vector<T> v;
+    for (long long i = std::numeric_limits<T>::min();
+         i <= std::numeric_limits<T>::max(); ++i)
+        v.push_back(T(i));
+    return v;
+}
+
+
+void
+test_convert_type_arrays()
+{
+    std::cout << "\nconvert arrays the same as single values\n";
+    test_convert_type_array<unsigned char, unsigned short>(
+        all_values<unsigned char>());
+    test_convert_type_array<unsigned short, unsigned char>(
+        all_values<unsigned short>());
+    test_convert_type_array<short, float>(all_values<short>());
+    // Floats, including values out of range, and ties that must round
+    // away from zero.
+    std::vector<float> fvals;
+    for (int i = -70000; i <= 70000; ++i)
+        fvals.push_back(i / 65534.0f);
+    for (int i = -40; i <= 40; ++i)
+        fvals.push_back((i + 0.5f) / 32767.0f);
+    test_convert_type_array<float, short>(fvals);
+    std::vector<unsigned int> uvals;
+    for (unsigned int i = 0; i < 200000; ++i)
+        uvals.push_back(i * 21473u + (i & 1 ? 0xffff0000u : 0u));
+    uvals.push_back(std::numeric_limits<unsigned int>::max());
+    test_convert_type_array<unsigned int, float>(uvals);
+}
+
+
+
 template<typename S, typename D>
 void
 do_convert_type(const std::vector<S>& svec, std::vector<D>& dvec)
@@ -417,6 +474,7 @@ main(int argc, char* argv[])
     test_convert_type<float, unsigned int>();
 
     test_half_convert_accuracy();
+    test_convert_type_arrays();
 
     benchmark_convert_type<unsigned char, float>();
     benchmark_convert_type<float, unsigned char>();
@@ -425,6 +483,11 @@ main(int argc, char* argv[])
     benchmark_convert_type<half, float>();
     benchmark_convert_type<float, half>();
     benchmark_convert_type<float, float>();
+    benchmark_convert_type<short, float>();
+    benchmark_convert_type<float, short>();
+    benchmark_convert_type<unsigned int, float>();
+    benchmark_convert_type<unsigned char, unsigned short>();
+    benchmark_convert_type<unsigned short, unsigned char>();
     // convertion to a type smaller in bytes causes error
     //    std::cout << "round trip convert float/short/float\n";
     //    test_convert_type<float,short> ();
@@ -151,6 +151,66 @@ test_parallel_for_2D()
 
 
 
+void
+test_parallel_for_adaptive()
+{
+    // Very uneven costs, so that stealing has to happen
+    const int length = 1000;
+    std::vector<atomic_int> vals(length);
+    for (auto& v : vals)
+        v = 0;
+    parallel_for_adaptive(0, length, [&](int id, int64_t i) {
+        if (i < 8)
+            Sysutil::usleep(2000);
+        vals[i] += 1;
+    });
+
+    // Verify that every index ran exactly once
+    bool all_one = std::all_of(vals.cbegin(), vals.cend(),
+                               [&](const atomic_int& v) { return v == 1; });
+    OIIO_CHECK_ASSERT(all_one);
+}
+
+
+
+void
+test_parallel_for_ordered()
+{
+    // Uneven costs, so that tasks finish out of order
+    const int length = 200, window = 6;
+    std::vector<int64_t> order;
+    std::vector<atomic_int> vals(length);
+    for (auto& v : vals)
+        v = 0;
+    atomic_int pending(0), most_pending(0);
+    parallel_for_ordered(
+        0, length,
+        [&](int64_t i) {
+            int p = ++pending;
+            for (int m = most_pending; p > m;)
+                most_pending.compare_exchange_weak(m, p);
+            if (i % 7 == 0)
+                Sysutil::usleep(500);
+            vals[i] += 1;
+        },
+        [&](int64_t i) {
+            OIIO_CHECK_EQUAL(vals[i], 1);
+            order.push_back(i);
+            --pending;
+        },
+        4, window);
+
+    // Every index was done once, in order, never more than window ahead
+    OIIO_CHECK_EQUAL(order.size(), size_t(length));
+    bool in_order = true;
+    for (int i = 0; i < int(order.size()); ++i)
+        in_order &= (order[i] == i);
+    OIIO_CHECK_ASSERT(in_order);
+    OIIO_CHECK_ASSERT(most_pending <= window);
+}
+
+
+
 void
 test_thread_pool_recursion()
 {
@@ -213,6 +273,8 @@ main(int argc, char** argv)
 
     test_parallel_for();
     test_parallel_for_2D();
+    test_parallel_for_adaptive();
+    test_parallel_for_ordered();
     time_parallel_for();
     test_thread_pool_recursion();
     test_empty_thread_pool();
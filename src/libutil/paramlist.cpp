@@ -31,6 +31,8 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <unordered_map>
 
 #include <OpenEXR/half.h>
 
@@ -249,6 +251,34 @@ ParamValue::get_float_indexed(int index, float defaultval) const
 
 namespace {  // make an anon namespace
 
+template<typename T>
+inline std::string
+formatValue(const char* formatString, const T& value)
+{
+    return Strutil::sprintf(formatString, value);
+}
+
+// Floating point values are only ever formatted as "%g", which
+// Strutil::to_string does much faster than Strutil::sprintf.
+inline std::string
+formatValue(const char* /*formatString*/, float value)
+{
+    return Strutil::to_string(value);
+}
+
+inline std::string
+formatValue(const char* /*formatString*/, double value)
+{
+    return Strutil::to_string(value);
+}
+
+inline std::string
+formatValue(const char* /*formatString*/, half value)
+{
+    return Strutil::to_string(float(value));
+}
+
+
 template<typename T>
 void
 formatType(const ParamValue& p, const int n, const char* formatString,
@@ -262,7 +292,7 @@ formatType(const ParamValue& p, const int n, const char* formatString,
         for (int c = 0; c < (int)element.aggregate; ++c, ++f) {
             if (c)
                 out += " ";
-            out += Strutil::sprintf(formatString, f[0]);
+            out += formatValue(formatString, f[0]);
         }
     }
 }
@@ -399,23 +429,151 @@ ParamValue::clear_value()
 
 
 
-ParamValueList::const_iterator
-ParamValueList::find(ustring name, TypeDesc type, bool casesensitive) const
-{
-    if (casesensitive) {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (i->name() == name
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
+// The index of a ParamValueList: for each name (case-insensitively), the
+// position of its first entry, and for each entry, the position of the
+// next one with the same name, or -1.
+struct ParamValueList::Index {
+    struct Hash {
+        size_t operator()(string_view s) const
+        {
+            // FNV-1a of the characters, ASCII letters lower-cased like
+            // Strutil::iequals does, so that equal names hash the same.
+            uint64_t h = 14695981039346656037ULL;
+            for (char c : s) {
+                if (c >= 'A' && c <= 'Z')
+                    c += 'a' - 'A';
+                h = (h ^ (unsigned char)c) * 1099511628211ULL;
+            }
+            return size_t(h);
         }
-    } else {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (Strutil::iequals(i->name(), name)
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
+    };
+    struct Equal {
+        bool operator()(string_view a, string_view b) const
+        {
+            return Strutil::iequals(a, b);
+        }
+    };
+
+    Index(const ParamValueList& list)
+        : next(list.size())
+        , data(list.data())
+        , size(list.size())
+    {
+        first.reserve(size);
+        // Backwards, so each chain runs in order of position
+        for (int i = int(size) - 1; i >= 0; --i) {
+            auto f  = first.emplace(list[i].name().string(), i);
+            next[i] = f.second ? -1 : f.first->second;
+            f.first->second = i;
         }
+        for (int i = 0; i < nsamples; ++i)
+            samples[i] = list[sample_pos(i)].name();
+    }
+
+    // Does it still describe the list? Entries appended since it was built
+    // are searched one by one, until there are enough to be worth
+    // rebuilding it. A few names are compared as a check against the list
+    // having been cleared and refilled to the same length.
+    bool current(const ParamValueList& list, size_t min_size) const
+    {
+        if (data != list.data() || size > list.size()
+            || list.size() - size > std::max(min_size, size / 2))
+            return false;
+        for (int i = 0; i < nsamples; ++i)
+            if (list[sample_pos(i)].name() != samples[i])
+                return false;
+        return true;
+    }
+
+    size_t sample_pos(int i) const { return (size - 1) * i / (nsamples - 1); }
+
+    std::unordered_map<string_view, int, Hash, Equal> first;
+    std::vector<int> next;
+    const ParamValue* data;  // The storage of the entries indexed
+    size_t size;             // How many were indexed
+    enum { nsamples = 3 };
+    ustring samples[nsamples];
+    // An index this one replaced, which other threads might still have
+    // been searching.
+    std::unique_ptr<Index> retired;
+};
+
+
+
+const ParamValueList::Index*
+ParamValueList::index() const
+{
+    // Short lists are searched as quickly one by one.
+    const size_t min_size = 16;
+    if (size() < min_size)
+        return nullptr;
+    Index* idx = m_index.load(std::memory_order_acquire);
+    if (idx && idx->current(*this, min_size))
+        return idx;
+    // Other threads may be searching the list at the same time, so
+    // publish the new index atomically, and keep the one it replaces alive
+    // until the list is next changed by its own methods (which may not run
+    // concurrently with searches).
+    std::unique_ptr<Index> fresh(new Index(*this));
+    fresh->retired.reset(idx);
+    if (m_index.compare_exchange_strong(idx, fresh.get(),
+                                        std::memory_order_acq_rel))
+        return fresh.release();
+    fresh->retired.release();  // Another thread got there first
+    return (idx && idx->current(*this, min_size)) ? idx : nullptr;
+}
+
+
+
+void
+ParamValueList::invalidate_index()
+{
+    delete m_index.exchange(nullptr);
+}
+
+
+
+void
+ParamValueList::rebase_index(const ParamValue* olddata)
+{
+    // The entries moved, unchanged, when the storage grew.
+    Index* idx = m_index.load(std::memory_order_relaxed);
+    if (idx && idx->data == olddata)
+        idx->data = data();
+}
+
+
+
+size_t
+ParamValueList::find_pos(string_view name, ustring uname, TypeDesc type,
+                         bool casesensitive) const
+{
+    auto match = [&](const ParamValue& p) {
+        return (casesensitive ? p.name() == uname
+                              : Strutil::iequals(p.name(), name))
+               && (type == TypeDesc::UNKNOWN || type == p.type());
+    };
+    size_t i = 0, n = size();
+    if (const Index* idx = index()) {
+        auto f = idx->first.find(name);
+        if (f != idx->first.end())
+            for (int j = f->second; j >= 0; j = idx->next[j])
+                if (match((*this)[j]))
+                    return size_t(j);
+        i = idx->size;  // Only the ones added since remain
     }
-    return cend();
+    for (; i < n; ++i)
+        if (match((*this)[i]))
+            return i;
+    return n;
+}
+
+
+
+ParamValueList::const_iterator
+ParamValueList::find(ustring name, TypeDesc type, bool casesensitive) const
+{
+    return cbegin() + find_pos(name, name, type, casesensitive);
 }
 
 
@@ -423,16 +581,9 @@ ParamValueList::find(ustring name, TypeDesc type, bool casesensitive) const
 ParamValueList::const_iterator
 ParamValueList::find(string_view name, TypeDesc type, bool casesensitive) const
 {
-    if (casesensitive) {
-        return find(ustring(name), type, casesensitive);
-    } else {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (Strutil::iequals(i->name(), name)
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    }
-    return cend();
+    return cbegin()
+           + find_pos(name, casesensitive ? ustring(name) : ustring(), type,
+                      casesensitive);
 }
 
 
@@ -440,20 +591,7 @@ ParamValueList::find(string_view name, TypeDesc type, bool casesensitive) const
 ParamValueList::iterator
 ParamValueList::find(ustring name, TypeDesc type, bool casesensitive)
 {
-    if (casesensitive) {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (i->name() == name
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    } else {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (Strutil::iequals(i->name(), name)
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    }
-    return end();
+    return begin() + find_pos(name, name, type, casesensitive);
 }
 
 
@@ -461,16 +599,9 @@ ParamValueList::find(ustring name, TypeDesc type, bool casesensitive)
 ParamValueList::iterator
 ParamValueList::find(string_view name, TypeDesc type, bool casesensitive)
 {
-    if (casesensitive) {
-        return find(ustring(name), type, casesensitive);
-    } else {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (Strutil::iequals(i->name(), name)
-                && (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    }
-    return end();
+    return begin()
+           + find_pos(name, casesensitive ? ustring(name) : ustring(), type,
+                      casesensitive);
 }
 
 
@@ -523,8 +654,10 @@ void
 ParamValueList::remove(string_view name, TypeDesc type, bool casesensitive)
 {
     auto p = find(name, type, casesensitive);
-    if (p != end())
+    if (p != end()) {
+        invalidate_index();
         erase(p);
+    }
 }
 
 
@@ -542,10 +675,14 @@ void
 ParamValueList::add_or_replace(const ParamValue& pv, bool casesensitive)
 {
     iterator p = find(pv.name(), pv.type(), casesensitive);
-    if (p != end())
+    if (p != end()) {
         *p = pv;
-    else
+    } else {
+        const ParamValue* olddata = data();
         emplace_back(pv);
+        if (data() != olddata)
+            rebase_index(olddata);
+    }
 }
 
 
@@ -553,10 +690,14 @@ void
 ParamValueList::add_or_replace(ParamValue&& pv, bool casesensitive)
 {
     iterator p = find(pv.name(), pv.type(), casesensitive);
-    if (p != end())
+    if (p != end()) {
         *p = pv;
-    else
+    } else {
+        const ParamValue* olddata = data();
         emplace_back(pv);
+        if (data() != olddata)
+            rebase_index(olddata);
+    }
 }
 
 
@@ -564,6 +705,7 @@ ParamValueList::add_or_replace(ParamValue&& pv, bool casesensitive)
 void
 ParamValueList::sort(bool casesensitive)
 {
+    invalidate_index();
     if (casesensitive)
         std::sort(begin(), end(),
                   [&](const ParamValue& a, const ParamValue& b) -> bool {
@@ -29,7 +29,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include <OpenImageIO/paramlist.h>
+#include <OpenImageIO/strutil.h>
 #include <OpenImageIO/unittest.h>
+#include <algorithm>
 #include <limits>
 
 using namespace OIIO;
@@ -284,6 +286,93 @@ test_paramlist()
 
 
 
+// Long lists are searched through an index of the names, which must agree
+// with a search one entry at a time, however the list changed since.
+static void
+test_paramlist_index()
+{
+    std::cout << "test_paramlist_index\n";
+    const int n = 200;
+    auto name  = [](int i) { return Strutil::sprintf("attr%d", i); };
+    auto upper = [](std::string s) {
+        Strutil::to_upper(s);
+        return s;
+    };
+    auto check = [&](const ParamValueList& pl, const std::string& nm,
+                     TypeDesc type, bool casesensitive) {
+        auto linear = std::find_if(pl.begin(), pl.end(),
+                                   [&](const ParamValue& p) {
+                                       return (casesensitive
+                                                   ? p.name() == nm
+                                                   : Strutil::iequals(p.name(),
+                                                                      nm))
+                                              && (type == TypeDesc::UNKNOWN
+                                                  || p.type() == type);
+                                   });
+        OIIO_CHECK_ASSERT(pl.find(nm, type, casesensitive) == linear);
+        OIIO_CHECK_ASSERT(pl.find(ustring(nm), type, casesensitive)
+                          == linear);
+    };
+    auto check_all = [&](const ParamValueList& pl, int limit) {
+        for (int i = 0; i < limit; ++i) {
+            check(pl, name(i), TypeDesc::UNKNOWN, true);
+            check(pl, upper(name(i)), TypeDesc::UNKNOWN, true);
+            check(pl, upper(name(i)), TypeDesc::UNKNOWN, false);
+            check(pl, name(i), TypeDesc::INT, true);
+            check(pl, name(i), TypeDesc::FLOAT, false);
+        }
+    };
+
+    ParamValueList pl;
+    for (int i = 0; i < n; ++i)
+        pl.emplace_back(name(i), i);
+    // Same names again (one case-folded), with a different type
+    for (int i = 0; i < n; i += 7)
+        pl.emplace_back(i % 2 ? upper(name(i)) : name(i), float(i));
+    check_all(pl, n + 10);
+    OIIO_CHECK_EQUAL(pl.get_int("attr123"), 123);
+    OIIO_CHECK_EQUAL(pl.get_float("ATTR21", 0.0f, false), 21.0f);
+
+    // Entries appended after the index was built
+    for (int i = n; i < n + 50; ++i)
+        pl.grow().init(name(i), TypeDesc::INT, 1, &i);
+    check_all(pl, n + 60);
+    pl.add_or_replace(ParamValue("attr5", 55));
+    OIIO_CHECK_EQUAL(pl.get_int("attr5"), 55);
+
+    // Removal and reordering
+    pl.remove("attr17");
+    pl.remove("ATTR21", TypeDesc::FLOAT, false);
+    check_all(pl, n + 60);
+    pl.sort(false);
+    check_all(pl, n + 60);
+
+    // Copies and moves have their own index
+    ParamValueList copy(pl);
+    check_all(copy, n + 60);
+    ParamValueList moved(std::move(copy));
+    check_all(moved, n + 60);
+    ParamValueList other;
+    other.swap(moved);
+    check_all(other, n + 60);
+    check_all(moved, 10);
+
+    // Cleared and refilled to the same length, with other names
+    pl.clear();
+    for (int i = 0; i < n; ++i)
+        pl.emplace_back(name(n - 1 - i), -i);
+    check_all(pl, n + 10);
+    OIIO_CHECK_EQUAL(pl.get_int("attr0"), 1 - n);
+
+    // Renamed in place, which needs to be announced
+    pl[50].init("renamed", TypeDesc::INT, 1, &n);
+    pl.invalidate_index();
+    check(pl, "renamed", TypeDesc::UNKNOWN, true);
+    check(pl, name(n - 51), TypeDesc::UNKNOWN, true);
+}
+
+
+
 int
 main(int argc, char* argv[])
 {
@@ -291,6 +380,7 @@ main(int argc, char* argv[])
     test_value_types();
     test_from_string();
     test_paramlist();
+    test_paramlist_index();
 
     return unit_test_failures;
 }
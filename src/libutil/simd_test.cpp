@@ -28,6 +28,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // clang-format off
 
+#include <algorithm>
 #include <sstream>
 #include <type_traits>
 
@@ -544,6 +545,7 @@ void test_vint_to_uint16s ()
     test_heading (Strutil::sprintf("test converting %s to uint16", VEC::type_name()));
     VEC ival = VEC::Iota (0xffff0000);
     unsigned short buf[VEC::elements];
+    std::fill (buf, buf+VEC::elements, (unsigned short)0xdead);
     ival.store (buf);
     for (int i = 0; i < VEC::elements; ++i)
         OIIO_CHECK_EQUAL (int(buf[i]), i);
@@ -560,6 +562,7 @@ void test_vint_to_uint8s ()
     test_heading (Strutil::sprintf("test converting %s to uint8", VEC::type_name()));
     VEC ival = VEC::Iota (0xffffff00);
     unsigned char buf[VEC::elements];
+    std::fill (buf, buf+VEC::elements, (unsigned char)0xad);
     ival.store (buf);
     for (int i = 0; i < VEC::elements; ++i)
         OIIO_CHECK_EQUAL (int(buf[i]), i);
@@ -637,6 +640,22 @@ test_gatherscatter()
     benchmark ("gather_mask", [&](const ELEM *d){ VEC v; v.gather_mask (mask, d, indices); return v; }, gather_source.data());
     benchmark ("scatter", [&](ELEM *d){ g.scatter (d, indices); return g; }, scatter_out.data());
     benchmark ("scatter_mask", [&](ELEM *d){ g.scatter_mask (mask, d, indices); return g; }, scatter_out.data());
+
+    // Gathering down a column of a tile, as texture lookups do, masked
+    // to the texels that are valid.
+    const int tilewidth = 64;
+    std::vector<ELEM> tile (tilewidth * tilewidth);
+    for (int i = 0; i < tilewidth * tilewidth; ++i)
+        tile[i] = ELEM(i);
+    auto column = VEC::vint_t::Iota (5, tilewidth);
+    VEC t;
+    t.gather (tile.data(), column);
+    OIIO_CHECK_SIMD_EQUAL (t, VEC::Iota (5, tilewidth));
+    t = ELEM(-1);
+    t.gather_mask (mask, tile.data(), column);
+    OIIO_CHECK_SIMD_EQUAL (t, select (mask, VEC::Iota (5, tilewidth), VEC(ELEM(-1))));
+    benchmark ("gather tile column", [&](const ELEM *d){ VEC v; v.gather (d, column); return v; }, tile.data());
+    benchmark ("gather_mask tile column", [&](const ELEM *d){ VEC v(ELEM(0)); v.gather_mask (mask, d, column); return v; }, tile.data());
 }
 
 
@@ -967,6 +986,16 @@ test_component_access<vbool16>()
     OIIO_CHECK_SIMD_EQUAL (insert<13>(a, 0), VEC(1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1));
     OIIO_CHECK_SIMD_EQUAL (insert<14>(a, 0), VEC(1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1));
     OIIO_CHECK_SIMD_EQUAL (insert<15>(a, 0), VEC(1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0));
+
+    // Conversions
+    VEC alternate (1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0);
+    OIIO_CHECK_SIMD_EQUAL (VEC(vint16(7,0,-1,0,4,0,1,0,9,0,8,0,2,0,3,0)),
+                           alternate);
+    OIIO_CHECK_SIMD_EQUAL (VEC(vbool4(1,0,1,0), vbool4(1,0,1,0),
+                               vbool4(1,0,1,0), vbool4(1,0,1,0)), alternate);
+    OIIO_CHECK_SIMD_EQUAL (VEC(vbool8(1,0,1,0,1,0,1,0),
+                               vbool8(1,0,1,0,1,0,1,0)), alternate);
+    OIIO_CHECK_SIMD_EQUAL (VEC(alternate.lo(), alternate.hi()), alternate);
 }
 
 
@@ -1123,6 +1152,13 @@ void test_bitwise_bool ()
     OIIO_CHECK_SIMD_EQUAL (a | b, ror);
     OIIO_CHECK_SIMD_EQUAL (a ^ b, rxor);
     OIIO_CHECK_SIMD_EQUAL (~a, rnot);
+    OIIO_CHECK_SIMD_EQUAL (a != b, rxor);
+    OIIO_CHECK_SIMD_EQUAL (a == b, ~rxor);
+
+    bool stored[VEC::elements];
+    (a & b).store (stored);
+    for (int i = 0; i < VEC::elements; ++i)
+        OIIO_CHECK_EQUAL (stored[i], AND[i]);
 
     VEC onebit(false); onebit.setcomp(3,true);
     OIIO_CHECK_EQUAL (reduce_or(VEC::False()), false);
@@ -1385,10 +1421,15 @@ test_shift()
     i = VEC::Iota (10, 10);   i >>= 1;
     OIIO_CHECK_SIMD_EQUAL (i, VEC::Iota(5, 5));
 
+    // Rotation
+    OIIO_CHECK_SIMD_EQUAL (rotl32(VEC(int(0x80000001)), 1), VEC(3));
+    OIIO_CHECK_SIMD_EQUAL (rotl32(VEC(0x12345678), 8), VEC(0x34567812));
+
     // Benchmark
     benchmark2 ("operator<<", do_shl<VEC>, i, 2);
     benchmark2 ("operator>>", do_shr<VEC>, i, 2);
     benchmark2 ("srl       ", do_srl<VEC>, i, 2);
+    benchmark2 ("rotl32    ", [](const VEC& a, int b){ return rotl32(a,b); }, i, 2);
 }
 
 
@@ -1969,7 +2010,7 @@ main(int argc, char* argv[])
     test_shuffle16<vint16>();
     test_blend<vint16>();
     test_vint_to_uint16s<vint16>();
-    test_vint_to_uint16s<vint16>();
+    test_vint_to_uint8s<vint16>();
     test_shift<vint16>();
 
     category_heading("vbool4");
@@ -29,9 +29,11 @@
 */
 
 
+#include <cfloat>
 #include <cmath>
 #include <cstdarg>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <locale.h>
@@ -1145,9 +1147,139 @@ Strutil::stoi(string_view str, size_t* pos, int base)
 
 
 
+// Fast path for converting decimal text to floating point, which avoids
+// the C library for the numbers by far the most common in practice. When
+// the significant digits form an integer exactly representable as a
+// double, and so does the power of ten scaling it, a single IEEE multiply
+// or divide gives the correctly rounded result (W. Clinger, "How to Read
+// Floating Point Numbers Accurately", PLDI 1990). Returns false, leaving
+// the conversion to the C library, for anything else: hex, inf/nan, too
+// many digits, large exponents, or text that isn't a number at all.
+//
+// The text is read up to len chars, or up to its terminating 0 if len is
+// npos. On success, used is set to the number of chars consumed, the way
+// strtod's endptr would be.
+#if (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0)                         \
+    && !defined(__FAST_MATH__)
+#    define OIIO_STRTOD_FAST_PATH 1
+#else
+// Excess intermediate precision or reassociated math would break the
+// rounding guarantee.
+#    define OIIO_STRTOD_FAST_PATH 0
+#endif
+
+static bool
+parse_decimal_fast(const char* s, size_t len, double& result, size_t& used)
+{
+#if OIIO_STRTOD_FAST_PATH
+    static const double exact_pow10[]
+        = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* p = s;
+    auto peek     = [&]() -> char {
+        return (len == string_view::npos || size_t(p - s) < len) ? *p : 0;
+    };
+    auto isdigit = [](char c) { return c >= '0' && c <= '9'; };
+
+    char c;
+    while ((c = peek()) == ' ' || (c >= '\t' && c <= '\r'))
+        ++p;
+    bool neg = (c == '-');
+    if (c == '-' || c == '+')
+        ++p;
+    uint64_t mantissa = 0;
+    int ndigits = 0;  // significant digits, i.e., not counting leading 0's
+    int exp10   = 0;
+    bool anydigits = false;
+    for (; isdigit(c = peek()); ++p) {
+        anydigits = true;
+        if (mantissa || c != '0') {
+            if (++ndigits > 19)
+                return false;
+            mantissa = mantissa * 10 + (c - '0');
+        }
+    }
+    if (c == '.') {
+        for (++p; isdigit(c = peek()); ++p) {
+            anydigits = true;
+            if (mantissa || c != '0') {
+                if (++ndigits > 19)
+                    return false;
+                mantissa = mantissa * 10 + (c - '0');
+            }
+            --exp10;
+        }
+    }
+    if (!anydigits || c == 'x' || c == 'X')
+        return false;
+    if (c == 'e' || c == 'E') {
+        // Only an exponent if there are digits, otherwise "1e" is "1".
+        const char* mark = p++;
+        bool expneg      = (peek() == '-');
+        if (peek() == '-' || peek() == '+')
+            ++p;
+        if (isdigit(peek())) {
+            int e = 0;
+            for (; isdigit(c = peek()); ++p)
+                if (e < 10000)
+                    e = e * 10 + (c - '0');
+            exp10 += expneg ? -e : e;
+        } else {
+            p = mark;
+        }
+    }
+
+    double r = 0.0;
+    if (mantissa) {
+        if (mantissa > (uint64_t(1) << 53) || exp10 < -22 || exp10 > 22)
+            return false;
+        r = exp10 < 0 ? double(mantissa) / exact_pow10[-exp10]
+                      : double(mantissa) * exact_pow10[exp10];
+    }
+    result = neg ? -r : r;
+    used   = size_t(p - s);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+static bool
+parse_float_fast(const char* s, size_t len, float& result, size_t& used)
+{
+    double d;
+    if (!parse_decimal_fast(s, len, d, used))
+        return false;
+    // Rounding to the nearest double and then to the nearest float gives
+    // the nearest float, unless the double landed exactly halfway between
+    // two floats. Leave that, and anything beyond the range of normalized
+    // floats, to the C library.
+    double a = std::fabs(d);
+    if (a != 0.0 && (a < FLT_MIN || a > FLT_MAX))
+        return false;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    if ((bits & 0x1fffffff) == 0x10000000)
+        return false;
+    result = float(d);
+    return true;
+}
+
+
+
 float
 Strutil::strtof(const char* nptr, char** endptr)
 {
+    float r;
+    size_t used;
+    if (parse_float_fast(nptr, string_view::npos, r, used)) {
+        if (endptr)
+            *endptr = (char*)nptr + used;
+        return r;
+    }
     // Can use strtod_l on platforms that support it
 #if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)           \
     || defined(__FreeBSD_kernel__) || defined(__GLIBC__)
@@ -1191,6 +1323,13 @@ Strutil::strtof(const char* nptr, char** endptr)
 double
 Strutil::strtod(const char* nptr, char** endptr)
 {
+    double r;
+    size_t used;
+    if (parse_decimal_fast(nptr, string_view::npos, r, used)) {
+        if (endptr)
+            *endptr = (char*)nptr + used;
+        return r;
+    }
     // Can use strtod_l on platforms that support it
 #if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)           \
     || defined(__FreeBSD_kernel__) || defined(__GLIBC__)
@@ -1270,12 +1409,21 @@ Strutil::stof(const std::string& s, size_t* pos)
 float
 Strutil::stof(string_view s, size_t* pos)
 {
-    // string_view can't be counted on to end with a terminating null, so
-    // for safety, create a temporary string. This looks wasteful, but it's
-    // not as bad as you think -- fully compliant C++ >= 11 implementations
-    // will use the "short string optimization", meaning that this string
-    // creation will NOT need an allocation/free for most strings we expect
-    // to hold a text representation of a float.
+    // The usual numbers can be converted right out of the string_view.
+    float r;
+    size_t used;
+    if (parse_float_fast(s.data(), s.size(), r, used)) {
+        if (pos)
+            *pos = used;
+        return r;
+    }
+    // Otherwise it's up to strtod, and a string_view can't be counted on to
+    // end with a terminating null, so for safety, create a temporary
+    // string. This looks wasteful, but it's not as bad as you think --
+    // fully compliant C++ >= 11 implementations will use the "short string
+    // optimization", meaning that this string creation will NOT need an
+    // allocation/free for most strings we expect to hold a text
+    // representation of a float.
     return Strutil::stof(std::string(s).c_str(), pos);
 }
 
@@ -1310,17 +1458,59 @@ Strutil::stod(const std::string& s, size_t* pos)
 double
 Strutil::stod(string_view s, size_t* pos)
 {
-    // string_view can't be counted on to end with a terminating null, so
-    // for safety, create a temporary string. This looks wasteful, but it's
-    // not as bad as you think -- fully compliant C++ >= 11 implementations
-    // will use the "short string optimization", meaning that this string
-    // creation will NOT need an allocation/free for most strings we expect
-    // to hold a text representation of a float.
+    double r;
+    size_t used;
+    if (parse_decimal_fast(s.data(), s.size(), r, used)) {
+        if (pos)
+            *pos = used;
+        return r;
+    }
+    // See stof(string_view)
     return Strutil::stod(std::string(s).c_str(), pos);
 }
 
 
 
+// Format like "%g" in the "C" locale, going straight to the C library
+// rather than through a stream the way Strutil::sprintf would.
+static std::string
+format_g(double value)
+{
+    char buf[32];
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    static locale_t c_loc = newlocale(LC_ALL_MASK, "C", nullptr);
+    snprintf_l(buf, sizeof(buf), c_loc, "%g", value);
+#elif defined(__linux__) || defined(__FreeBSD_kernel__) || defined(__GLIBC__)
+    // No snprintf_l, but switching this thread's locale is cheap.
+    static locale_t c_loc = newlocale(LC_ALL_MASK, "C", nullptr);
+    locale_t oldloc       = uselocale(c_loc);
+    snprintf(buf, sizeof(buf), "%g", value);
+    uselocale(oldloc);
+#elif defined(_WIN32)
+    static _locale_t c_loc = _create_locale(LC_ALL, "C");
+    _snprintf_l(buf, sizeof(buf), "%g", c_loc, value);
+#else
+    return Strutil::sprintf("%g", value);
+#endif
+    return buf;
+}
+
+
+std::string
+Strutil::to_string(float value)
+{
+    return format_g(value);
+}
+
+
+std::string
+Strutil::to_string(double value)
+{
+    return format_g(value);
+}
+
+
+
 bool
 Strutil::string_is_int(string_view s)
 {
@@ -29,7 +29,10 @@
 */
 // clang-format off
 
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <limits>
 
 #include <OpenImageIO/benchmark.h>
 #include <OpenImageIO/strutil.h>
@@ -525,6 +528,90 @@ test_numeric_conversion()
     OIIO_CHECK_EQUAL (Strutil::stof("100000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001E-200"), 1.0f);
     OIIO_CHECK_EQUAL (Strutil::stof("0.00000000000000000001"), 1.0e-20f);
 
+    // Things the fast path must hand off to the C library, or stop short of
+    OIIO_CHECK_EQUAL(Strutil::stof("0x10", &pos), 16.0f);
+    OIIO_CHECK_EQUAL(pos, 4);
+    OIIO_CHECK_EQUAL(Strutil::stof("inf"), std::numeric_limits<float>::infinity());
+    OIIO_CHECK_ASSERT(std::isnan(Strutil::stof("nan")));
+    OIIO_CHECK_EQUAL(Strutil::stof("1e50"), std::numeric_limits<float>::infinity());
+    OIIO_CHECK_EQUAL(Strutil::stof("1e-50"), 0.0f);
+    OIIO_CHECK_EQUAL(Strutil::stof("1e-40"), 1e-40f);  // denormal
+    OIIO_CHECK_EQUAL(Strutil::stof("1e", &pos), 1.0f);
+    OIIO_CHECK_EQUAL(pos, 1);
+    OIIO_CHECK_EQUAL(Strutil::stof("2.5e+x", &pos), 2.5f);
+    OIIO_CHECK_EQUAL(pos, 3);
+    OIIO_CHECK_EQUAL(Strutil::stof(".5", &pos), 0.5f);
+    OIIO_CHECK_EQUAL(pos, 2);
+    OIIO_CHECK_EQUAL(Strutil::stof("5.", &pos), 5.0f);
+    OIIO_CHECK_EQUAL(pos, 2);
+    OIIO_CHECK_EQUAL(Strutil::stof(".", &pos), 0.0f);
+    OIIO_CHECK_EQUAL(pos, 0);
+    OIIO_CHECK_EQUAL(Strutil::stof("-", &pos), 0.0f);
+    OIIO_CHECK_EQUAL(pos, 0);
+    OIIO_CHECK_ASSERT(std::signbit(Strutil::stof("-0.0")));
+    // Halfway between two floats, which must round to even, and a hair
+    // above it
+    OIIO_CHECK_EQUAL(Strutil::stof("16777217"), 16777216.0f);
+    OIIO_CHECK_EQUAL(Strutil::stof("16777217.000000001"), 16777218.0f);
+    OIIO_CHECK_EQUAL(Strutil::stof("1.00000005960464477539062500001"),
+                     1.00000012f);
+    // A string_view that isn't the whole string
+    OIIO_CHECK_EQUAL(Strutil::stof(string_view("1234", 2), &pos), 12.0f);
+    OIIO_CHECK_EQUAL(pos, 2);
+    OIIO_CHECK_EQUAL(Strutil::stof(string_view("1.5e7", 4), &pos), 1.5f);
+    OIIO_CHECK_EQUAL(pos, 3);
+    OIIO_CHECK_EQUAL(Strutil::stod(string_view("0.125", 4), &pos), 0.12);
+    OIIO_CHECK_EQUAL(pos, 4);
+    OIIO_CHECK_EQUAL(Strutil::stof(string_view()), 0.0f);
+
+    OIIO_CHECK_EQUAL(Strutil::stod("123.45"), 123.45);
+    OIIO_CHECK_EQUAL(Strutil::stod("-1.5e-3", &pos), -1.5e-3);
+    OIIO_CHECK_EQUAL(pos, 7);
+    OIIO_CHECK_EQUAL(Strutil::stod("0.1"), 0.1);
+    OIIO_CHECK_EQUAL(Strutil::stod("9007199254740993"), 9007199254740992.0);
+    OIIO_CHECK_EQUAL(Strutil::stod("1.7976931348623157e308"),
+                     std::numeric_limits<double>::max());
+    OIIO_CHECK_EQUAL(Strutil::stod("4.9406564584124654e-324"),
+                     std::numeric_limits<double>::denorm_min());
+
+    // Every float printed with 9 significant digits, and every double with
+    // 17, must read back exactly. Try a good spread of bit patterns, and
+    // also the short decimal numbers that are most common in practice.
+    {
+        uint32_t x = 12345;
+        auto rnd   = [&]() {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return x;
+        };
+        int fbad = 0, dbad = 0, sbad = 0;
+        for (int i = 0; i < 200000; ++i) {
+            uint32_t fbits = rnd();
+            float f;
+            memcpy(&f, &fbits, sizeof(f));
+            if (std::isfinite(f)
+                && Strutil::stof(Strutil::sprintf("%.9g", f)) != f)
+                ++fbad;
+            uint64_t dbits = (uint64_t(rnd()) << 32) | rnd();
+            double d;
+            memcpy(&d, &dbits, sizeof(d));
+            if (std::isfinite(d)
+                && Strutil::stod(Strutil::sprintf("%.17g", d)) != d)
+                ++dbad;
+            std::string shortnum = Strutil::sprintf("%d.%de%d",
+                                                    int(rnd() % 100000),
+                                                    int(rnd() % 1000),
+                                                    int(rnd() % 40) - 20);
+            if (Strutil::stof(shortnum) != std::strtof(shortnum.c_str(), nullptr)
+                || Strutil::stod(shortnum) != std::strtod(shortnum.c_str(), nullptr))
+                ++sbad;
+        }
+        OIIO_CHECK_EQUAL(fbad, 0);
+        OIIO_CHECK_EQUAL(dbad, 0);
+        OIIO_CHECK_EQUAL(sbad, 0);
+    }
+
     // Note: we don't test from_strings<> separately because it's just
     // implemented directly as calls to stoi, stoui, stof.
 
@@ -544,6 +631,10 @@ test_numeric_conversion()
     bench ("Strutil::stof(string) - locale-independent", [&](){ return DoNotOptimize(Strutil::stof(numstring)); });
     bench ("Strutil::stof(char*) - locale-independent", [&](){ return DoNotOptimize(Strutil::stof(numcstr)); });
     bench ("Strutil::stof(string_view) - locale-independent", [&](){ return DoNotOptimize(Strutil::stof(string_view(numstring))); });
+    const char* longcstr = "0.041666667908430099";  // not the fast path
+    bench ("std strtod (long)", [&](){ DoNotOptimize(::strtod(longcstr, nullptr));});
+    bench ("Strutil::stod(char*)", [&](){ return DoNotOptimize(Strutil::stod(numcstr)); });
+    bench ("Strutil::stod(char*) (long)", [&](){ return DoNotOptimize(Strutil::stod(longcstr)); });
     bench ("locale switch (to classic)", [&](){ std::locale::global (std::locale::classic()); });
 }
 
@@ -554,6 +645,9 @@ test_to_string()
 {
     std::cout << "Testing to_string\n";
     OIIO_CHECK_EQUAL(Strutil::to_string(3.14f), "3.14");
+    OIIO_CHECK_EQUAL(Strutil::to_string(3.14), "3.14");
+    OIIO_CHECK_EQUAL(Strutil::to_string(1.0e-7f), "1e-07");
+    OIIO_CHECK_EQUAL(Strutil::to_string(-1234567.0), "-1.23457e+06");
     OIIO_CHECK_EQUAL(Strutil::to_string(42), "42");
     OIIO_CHECK_EQUAL(Strutil::to_string("hi"), "hi");
     OIIO_CHECK_EQUAL(Strutil::to_string(std::string("hello")), "hello");
@@ -829,6 +923,10 @@ test_locale()
     // comma-based locale.
     OIIO_CHECK_EQUAL(Strutil::sprintf("%g", 123.45f), "123.45");
     OIIO_CHECK_EQUAL(Strutil::sprintf("%d", 12345), "12345");
+    OIIO_CHECK_EQUAL(Strutil::to_string(123.45f), "123.45");
+    OIIO_CHECK_EQUAL(Strutil::to_string(123.45), "123.45");
+    OIIO_CHECK_EQUAL(Strutil::stod("123.45"), 123.45);
+    OIIO_CHECK_EQUAL(Strutil::stof("1.2345678901234567890"), 1.23456789f);
     // Verify that Strutil::fmt::format does the right thing, even when in a
     // comma-based locale.
 #if 0
@@ -80,6 +80,7 @@
 #endif
 
 #include <OpenImageIO/dassert.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 
@@ -570,6 +571,36 @@ Sysutil::physical_concurrency()
 
 
 
+std::vector<int>
+Sysutil::numa_node_cpus(int node)
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    std::string cpulist;
+    if (node < 0
+        || !Filesystem::read_text_file(
+               Strutil::sprintf("/sys/devices/system/node/node%d/cpulist",
+                                node),
+               cpulist))
+        return cpus;
+    // The list looks like "0-31,64-95"
+    for (auto& range : Strutil::splits(cpulist, ",")) {
+        auto ends = Strutil::splits(range, "-");
+        if (ends.empty() || ends[0].empty())
+            continue;
+        int first = Strutil::stoi(ends[0]);
+        int last  = ends.size() > 1 ? Strutil::stoi(ends[1]) : first;
+        if (first < 0 || last < first || last >= 65536)
+            continue;
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+
+
 size_t
 Sysutil::max_open_files()
 {
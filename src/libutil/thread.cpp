@@ -48,9 +48,22 @@
 #    include <windows.h>
 #endif
 
+#if defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/resource.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#elif defined(__APPLE__)
+#    include <sys/resource.h>
+#endif
+
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <future>
+#include <map>
 #include <memory>
 
 #include <OpenImageIO/parallel.h>
@@ -116,6 +129,78 @@ private:
 
 OIIO_NAMESPACE_BEGIN
 
+namespace {
+
+// The scheduling priority and CPU affinity of one pool thread, which the
+// thread sets on itself. It remembers how the thread started out, so that
+// lifting a restriction gives back whatever the process had to begin
+// with (say, from taskset). These are only hints: failures are ignored.
+class ThreadPlacement {
+public:
+    void apply(const std::vector<int>& cpus, bool background)
+    {
+        if (!cpus.empty() || m_restricted) {
+#if defined(__linux__)
+            if (!m_restricted)
+                pthread_getaffinity_np(pthread_self(), sizeof(m_original),
+                                       &m_original);
+            cpu_set_t set = m_original;
+            if (!cpus.empty()) {
+                CPU_ZERO(&set);
+                for (int c : cpus)
+                    if (c >= 0 && c < CPU_SETSIZE)
+                        CPU_SET(c, &set);
+            }
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+            DWORD_PTR mask = m_original;
+            if (!cpus.empty()) {
+                mask = 0;
+                for (int c : cpus)
+                    if (c >= 0 && c < int(8 * sizeof(mask)))
+                        mask |= DWORD_PTR(1) << c;
+            }
+            DWORD_PTR prev = mask ? SetThreadAffinityMask(GetCurrentThread(),
+                                                          mask)
+                                  : 0;
+            if (!m_restricted)
+                m_original = prev;
+#endif
+            m_restricted = !cpus.empty();
+        }
+        if (background != m_background) {
+#if defined(__linux__)
+            // Linux keeps a nice value per thread, addressed by its tid
+            id_t tid = id_t(syscall(SYS_gettid));
+            if (background)
+                m_nice = getpriority(PRIO_PROCESS, tid);
+            setpriority(PRIO_PROCESS, tid, background ? 10 : m_nice);
+#elif defined(__APPLE__)
+            setpriority(PRIO_DARWIN_THREAD, 0, background ? PRIO_DARWIN_BG : 0);
+#elif defined(_WIN32)
+            SetThreadPriority(GetCurrentThread(),
+                              background ? THREAD_PRIORITY_BELOW_NORMAL
+                                         : THREAD_PRIORITY_NORMAL);
+#endif
+            m_background = background;
+        }
+    }
+
+private:
+#if defined(__linux__)
+    cpu_set_t m_original;
+    int m_nice = 0;
+#elif defined(_WIN32)
+    DWORD_PTR m_original = 0;
+#endif
+    bool m_restricted = false;
+    bool m_background = false;
+};
+
+}  // namespace
+
+
+
 static int
 threads_default()
 {
@@ -131,6 +216,7 @@ class thread_pool::Impl {
 public:
     Impl(int nThreads = 0, int queueSize = 1024)
         : q(queueSize)
+        , m_deques(new std::unique_ptr<WorkerDeque>[max_deques])
     {
         this->init();
         this->resize(nThreads);
@@ -195,6 +281,14 @@ public:
         std::function<void(int id)>* _f;
         while (this->q.pop(_f))
             delete _f;  // empty the queue
+        for (int i = 0, n = m_ndeques; i < n; ++i) {
+            spin_lock lock(m_deques[i]->mutex);
+            for (auto& t : m_deques[i]->tasks)
+                delete t.first;
+            m_deques[i]->tasks.clear();
+            m_deques[i]->count = 0;
+        }
+        m_npending = 0;
     }
 
     // pops a functional wraper to the original function
@@ -268,9 +362,20 @@ public:
         this->flags.clear();
     }
 
+    // A task pushed by one of our own threads goes on that thread's deque,
+    // anybody else's on the shared queue.
     void push_queue_and_notify(std::function<void(int id)>* f)
     {
-        this->q.push(f);
+        int n = ++m_npending, m = m_max_pending;
+        while (n > m && !m_max_pending.compare_exchange_weak(m, n))
+            ;
+        if (WorkerDeque* d = own_deque()) {
+            spin_lock lock(d->mutex);
+            d->tasks.emplace_back(f, d->pushed++);
+            ++d->count;
+        } else {
+            this->q.push(f);
+        }
         std::unique_lock<std::mutex> lock(this->mutex);
         this->cv.notify_one();
     }
@@ -280,7 +385,7 @@ public:
     bool run_one_task(std::thread::id id)
     {
         std::function<void(int)>* f = nullptr;
-        bool isPop                  = this->q.pop(f);
+        bool isPop                  = pop_task(worker_index(), f);
         if (isPop) {
             DASSERT(f);
             std::unique_ptr<std::function<void(int id)>> func(
@@ -300,6 +405,44 @@ public:
         return p && (*p);
     }
 
+    // Which of our threads is the caller (-1 if none)?
+    int worker_index() const
+    {
+        int* p = m_pool_members.get();
+        return p ? *p - 1 : -1;
+    }
+
+    uint64_t task_mark() const
+    {
+        WorkerDeque* d = own_deque();
+        return d ? d->pushed : 0;
+    }
+
+    // Run the most recent of the tasks that the calling pool thread has
+    // pushed since task_mark() returned mark, if any are still on its
+    // deque. Those are the ones at the back, so it's only a matter of
+    // checking the last one.
+    bool run_task_since(uint64_t mark)
+    {
+        WorkerDeque* d = own_deque();
+        if (!d || !d->count)
+            return false;
+        std::function<void(int)>* f = nullptr;
+        {
+            spin_lock lock(d->mutex);
+            if (d->tasks.empty() || d->tasks.back().second < mark)
+                return false;
+            f = d->tasks.back().first;
+            d->tasks.pop_back();
+            --d->count;
+        }
+        --m_npending;
+        m_tasks_run.fetch_add(1, std::memory_order_relaxed);
+        std::unique_ptr<std::function<void(int id)>> func(f);
+        (*f)(worker_index());
+        return true;
+    }
+
     void register_worker(std::thread::id id)
     {
         spin_lock lock(m_worker_threadids_mutex);
@@ -316,48 +459,219 @@ public:
         return m_worker_threadids[id] != 0;
     }
 
-    size_t jobs_in_queue() const { return q.size(); }
+    size_t jobs_in_queue() const
+    {
+        return size_t(std::max(0, int(m_npending)));
+    }
 
     bool very_busy() const { return jobs_in_queue() > size_t(4 * m_size); }
 
+    void set_name(string_view name)
+    {
+        spin_lock lock(m_settings_mutex);
+        m_name = name;
+    }
+    std::string name() const
+    {
+        spin_lock lock(m_settings_mutex);
+        return m_name;
+    }
+
+    void set_background(bool background)
+    {
+        {
+            spin_lock lock(m_settings_mutex);
+            m_background = background;
+            ++m_settings_gen;
+        }
+        notify_settings();
+    }
+    bool background() const
+    {
+        spin_lock lock(m_settings_mutex);
+        return m_background;
+    }
+
+    void set_affinity(const std::vector<int>& cpus)
+    {
+        {
+            spin_lock lock(m_settings_mutex);
+            m_affinity = cpus;
+            ++m_settings_gen;
+        }
+        notify_settings();
+    }
+    std::vector<int> affinity() const
+    {
+        spin_lock lock(m_settings_mutex);
+        return m_affinity;
+    }
+
+    thread_pool::Stats stats() const
+    {
+        thread_pool::Stats st;
+        st.tasks_run       = m_tasks_run;
+        st.tasks_stolen    = m_tasks_stolen;
+        st.queue_depth     = jobs_in_queue();
+        st.max_queue_depth = size_t(std::max(0, int(m_max_pending)));
+        return st;
+    }
+    void reset_stats()
+    {
+        m_tasks_run    = 0;
+        m_tasks_stolen = 0;
+        m_max_pending  = int(jobs_in_queue());
+    }
+
 private:
     Impl(const Impl&) = delete;
     Impl(Impl&&)      = delete;
     Impl& operator=(const Impl&) = delete;
     Impl& operator=(Impl&&) = delete;
 
+    // Tasks pushed by one pool thread (while running a task of its own).
+    // The owner pushes and pops at the back, so it runs the most recently
+    // pushed (and most cache-friendly) task first; idle threads steal
+    // from the front, taking the oldest, which tends to be the biggest.
+    struct WorkerDeque {
+        spin_mutex mutex;
+        // Each task with its sequence number (see task_mark)
+        std::deque<std::pair<std::function<void(int id)>*, uint64_t>> tasks;
+        std::atomic<int> count { 0 };  // tasks.size(), read without lock
+        uint64_t pushed = 0;  // Tasks ever pushed (only used by the owner)
+        char pad_[OIIO_CACHE_LINE_SIZE];
+    };
+
+    // Pool threads beyond this many share the one queue for their pushes.
+    static const int max_deques = 1024;
+
+    WorkerDeque* own_deque() const
+    {
+        int i = worker_index();
+        return i >= 0 && i < max_deques ? m_deques[i].get() : nullptr;
+    }
+
+    // Get a task for pool thread i (or for a non-pool thread, if i < 0):
+    // its own newest, else the oldest on the shared queue, else the
+    // oldest on another thread's deque.
+    bool pop_task(int i, std::function<void(int id)>*& f)
+    {
+        WorkerDeque* d = i >= 0 && i < max_deques ? m_deques[i].get()
+                                                  : nullptr;
+        bool isPop = false;
+        if (d && d->count) {
+            spin_lock lock(d->mutex);
+            if (!d->tasks.empty()) {
+                f = d->tasks.back().first;
+                d->tasks.pop_back();
+                --d->count;
+                isPop = true;
+            }
+        }
+        if (!isPop)
+            isPop = this->q.pop(f);
+        for (int n = m_ndeques, v = 1; !isPop && v <= n; ++v) {
+            WorkerDeque* victim = m_deques[(i + v + n) % n].get();
+            if (victim == d || !victim->count)
+                continue;
+            spin_lock lock(victim->mutex);
+            if (!victim->tasks.empty()) {
+                f = victim->tasks.front().first;
+                victim->tasks.pop_front();
+                --victim->count;
+                isPop = true;
+                m_tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (isPop) {
+            --m_npending;
+            m_tasks_run.fetch_add(1, std::memory_order_relaxed);
+        }
+        return isPop;
+    }
+
+    // A thread leaving the pool hands any tasks it pushed to the others.
+    void give_away_deque(int i)
+    {
+        WorkerDeque* d = i < max_deques ? m_deques[i].get() : nullptr;
+        if (!d || !d->count)
+            return;
+        {
+            spin_lock lock(d->mutex);
+            for (auto& t : d->tasks)
+                this->q.push(t.first);
+            d->tasks.clear();
+            d->count = 0;
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->cv.notify_all();
+    }
+
+    // Wake the idle threads so that they apply changed settings.
+    void notify_settings()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->cv.notify_all();
+    }
+
+    // Bring the calling pool thread's placement up to date with the
+    // settings, noting which generation of them it has applied.
+    void update_placement(ThreadPlacement& placement, int& settings_gen)
+    {
+        std::vector<int> cpus;
+        bool background;
+        {
+            spin_lock lock(m_settings_mutex);
+            settings_gen = m_settings_gen;
+            cpus         = m_affinity;
+            background   = m_background;
+        }
+        placement.apply(cpus, background);
+    }
+
     void set_thread(int i)
     {
         std::shared_ptr<std::atomic<bool>> flag(
             this->flags[i]);  // a copy of the shared ptr to the flag
+        if (i < max_deques && !m_deques[i]) {
+            m_deques[i].reset(new WorkerDeque);
+            m_ndeques = std::max(int(m_ndeques), i + 1);
+        }
         auto f = [this, i, flag /* a copy of the shared ptr to the flag */]() {
-            this->m_pool_members.reset(new int(1));  // I'm in the pool
+            this->m_pool_members.reset(new int(i + 1));  // I'm in the pool
             register_worker(std::this_thread::get_id());
             std::atomic<bool>& _flag = *flag;
+            ThreadPlacement placement;
+            int settings_gen = 0;  // Defaults need no placement
             std::function<void(int id)>* _f;
-            bool isPop = this->q.pop(_f);
+            bool isPop = pop_task(i, _f);
             while (true) {
+                if (settings_gen != m_settings_gen)
+                    update_placement(placement, settings_gen);
                 while (isPop) {  // if there is anything in the queue
                     std::unique_ptr<std::function<void(int id)>> func(
                         _f);  // at return, delete the function even if an exception occurred
                     (*_f)(i);
                     if (_flag) {
                         // the thread is wanted to stop, return even if the queue is not empty yet
+                        give_away_deque(i);
                         this->m_pool_members
                             .reset();  // I'm no longer in the pool
                         return;
                     } else
-                        isPop = this->q.pop(_f);
+                        isPop = pop_task(i, _f);
                 }
                 // the queue is empty here, wait for the next command
                 std::unique_lock<std::mutex> lock(this->mutex);
                 ++this->nWaiting;
-                this->cv.wait(lock, [this, &_f, &isPop, &_flag]() {
-                    isPop = this->q.pop(_f);
-                    return isPop || this->isDone || _flag;
+                this->cv.wait(lock, [this, i, &_f, &isPop, &_flag,
+                                     &settings_gen]() {
+                    isPop = pop_task(i, _f);
+                    return isPop || this->isDone || _flag
+                           || settings_gen != m_settings_gen;
                 });
                 --this->nWaiting;
-                if (!isPop)
+                if (!isPop && (this->isDone || _flag))
                     break;  // if the queue is empty and this->isDone == true or *flag then return
             }
             this->m_pool_members.reset();  // I'm no longer in the pool
@@ -378,6 +692,9 @@ private:
     std::vector<std::unique_ptr<std::thread>> terminating_threads;
     std::vector<std::shared_ptr<std::atomic<bool>>> flags;
     mutable Queue<std::function<void(int id)>*> q;
+    std::unique_ptr<std::unique_ptr<WorkerDeque>[]> m_deques;  // By thread
+    std::atomic<int> m_ndeques { 0 };   // Deques that have been created
+    std::atomic<int> m_npending { 0 };  // Tasks on the queue and deques
     std::atomic<bool> isDone;
     std::atomic<bool> isStop;
     std::atomic<int> nWaiting;  // how many threads are waiting
@@ -387,6 +704,16 @@ private:
     boost::thread_specific_ptr<int> m_pool_members;  // Who's in the pool
     boost::container::flat_map<std::thread::id, int> m_worker_threadids;
     spin_mutex m_worker_threadids_mutex;
+    // Settings, which each thread applies to itself (see update_placement)
+    mutable spin_mutex m_settings_mutex;
+    std::string m_name;
+    std::vector<int> m_affinity;
+    bool m_background = false;
+    std::atomic<int> m_settings_gen { 0 };  // Bumped by each change
+    // Statistics
+    std::atomic<uint64_t> m_tasks_run { 0 };
+    std::atomic<uint64_t> m_tasks_stolen { 0 };
+    std::atomic<int> m_max_pending { 0 };
 };
 
 
@@ -461,6 +788,22 @@ thread_pool::this_thread_is_in_pool() const
 
 
 
+uint64_t
+thread_pool::task_mark() const
+{
+    return m_impl->task_mark();
+}
+
+
+
+bool
+thread_pool::run_task_since(uint64_t mark)
+{
+    return m_impl->run_task_since(mark);
+}
+
+
+
 void
 thread_pool::register_worker(std::thread::id id)
 {
@@ -488,15 +831,232 @@ thread_pool::very_busy() const
 
 
 
+void
+thread_pool::set_name(string_view name)
+{
+    m_impl->set_name(name);
+}
+
+
+
+std::string
+thread_pool::name() const
+{
+    return m_impl->name();
+}
+
+
+
+void
+thread_pool::set_background(bool background)
+{
+    m_impl->set_background(background);
+}
+
+
+
+bool
+thread_pool::background() const
+{
+    return m_impl->background();
+}
+
+
+
+void
+thread_pool::set_affinity(const std::vector<int>& cpus)
+{
+    m_impl->set_affinity(cpus);
+}
+
+
+
+std::vector<int>
+thread_pool::affinity() const
+{
+    return m_impl->affinity();
+}
+
+
+
+void
+thread_pool::set_numa_node(int node)
+{
+    m_impl->set_affinity(Sysutil::numa_node_cpus(node));
+}
+
+
+
+thread_pool::Stats
+thread_pool::stats() const
+{
+    return m_impl->stats();
+}
+
+
+
+void
+thread_pool::reset_stats()
+{
+    m_impl->reset_stats();
+}
+
+
+
 thread_pool*
 default_thread_pool()
 {
-    static std::unique_ptr<thread_pool> shared_pool(new thread_pool);
+    static std::unique_ptr<thread_pool> shared_pool([]() {
+        thread_pool* pool = new thread_pool;
+        pool->set_name("default");
+        return pool;
+    }());
     return shared_pool.get();
 }
 
 
 
+thread_pool*
+background_thread_pool()
+{
+    static std::unique_ptr<thread_pool> shared_pool([]() {
+        thread_pool* pool = new thread_pool(std::max(2, threads_default() / 4));
+        pool->set_name("background");
+        pool->set_background(true);
+        return pool;
+    }());
+    return shared_pool.get();
+}
+
+
+
+thread_pool*
+named_thread_pool(string_view name, int nthreads)
+{
+    if (name.empty() || name == "default")
+        return default_thread_pool();
+    if (name == "background")
+        return background_thread_pool();
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<thread_pool>> pools;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<thread_pool>& pool(pools[name]);
+    if (!pool) {
+        pool.reset(new thread_pool(nthreads));
+        pool->set_name(name);
+    }
+    return pool.get();
+}
+
+
+
+namespace {
+
+// Each thread that has ever read under an epoch_reclaim::read_guard owns
+// one of these while it lives. They're kept on a list that only grows;
+// a thread that exits gives its record back for another thread to reuse.
+// The padding keeps each on cache lines of its own.
+struct EpochRecord {
+    char pad1_[OIIO_CACHE_LINE_SIZE];
+    std::atomic<uint64_t> epoch { 0 };  // 0 = not reading
+    std::atomic<bool> in_use { true };
+    int depth         = 0;  // read_guard nesting (only touched by owner)
+    EpochRecord* next = nullptr;
+    char pad2_[OIIO_CACHE_LINE_SIZE];
+};
+
+std::atomic<uint64_t> global_epoch { 1 };
+std::atomic<EpochRecord*> epoch_records { nullptr };
+
+
+EpochRecord*
+claim_epoch_record()
+{
+    EpochRecord* head = epoch_records.load(std::memory_order_acquire);
+    for (EpochRecord* r = head; r; r = r->next) {
+        bool free = false;
+        if (!r->in_use.load(std::memory_order_relaxed)
+            && r->in_use.compare_exchange_strong(free, true))
+            return r;
+    }
+    EpochRecord* r = new EpochRecord;
+    r->next        = head;
+    while (!epoch_records.compare_exchange_weak(r->next, r))
+        ;
+    return r;
+}
+
+
+struct ThreadEpochRecord {
+    EpochRecord* record = nullptr;
+    ~ThreadEpochRecord()
+    {
+        if (record)
+            record->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local ThreadEpochRecord thread_epoch_record;
+
+}  // namespace
+
+
+
+epoch_reclaim::read_guard::read_guard()
+{
+    EpochRecord* r = thread_epoch_record.record;
+    if (!r)
+        r = thread_epoch_record.record = claim_epoch_record();
+    m_record = r;
+    if (r->depth++ == 0) {
+        r->epoch.store(global_epoch.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+        // Our epoch must be visible before we look at anything a writer
+        // might unlink, so that a writer checking the records after the
+        // unlink either sees us reading or we see its unlink.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+
+
+epoch_reclaim::read_guard::~read_guard()
+{
+    EpochRecord* r = (EpochRecord*)m_record;
+    if (--r->depth == 0)
+        r->epoch.store(0, std::memory_order_release);
+}
+
+
+
+uint64_t
+epoch_reclaim::retire_epoch()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return global_epoch.load(std::memory_order_relaxed);
+}
+
+
+
+uint64_t
+epoch_reclaim::advance()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t e = global_epoch.load(std::memory_order_relaxed);
+    for (EpochRecord* r = epoch_records.load(std::memory_order_acquire); r;
+         r = r->next) {
+        uint64_t re = r->epoch.load(std::memory_order_acquire);
+        if (re && re != e)
+            return e;  // somebody is still reading in an older epoch
+    }
+    // If the CAS fails, another thread advanced it, and e is updated.
+    if (global_epoch.compare_exchange_strong(e, e + 1))
+        ++e;
+    return e;
+}
+
+
+
 void
 task_set::wait_for_task(size_t taskindex, bool block)
 {
@@ -504,6 +1064,15 @@ task_set::wait_for_task(size_t taskindex, bool block)
     if (taskindex >= m_futures.size())
         return;  // nothing to wait for
     auto& f(m_futures[taskindex]);
+    if (m_pool->this_thread_is_in_pool()) {
+        // Run our own tasks that nobody has taken yet, until this one is
+        // done (or running on another thread).
+        const std::chrono::milliseconds wait_time(0);
+        while (f.wait_for(wait_time) != std::future_status::ready
+               && m_pool->run_task_since(m_mark))
+            ;
+        block = true;
+    }
     if (block || m_pool->is_worker(m_submitter_thread)) {
         // Block on completion of all the task and don't try to do any
         // of the work with the calling thread.
@@ -540,7 +1109,15 @@ task_set::wait(bool block)
 {
     DASSERT(submitter() == std::this_thread::get_id());
     const std::chrono::milliseconds wait_time(0);
-    if (m_pool->is_worker(m_submitter_thread))
+    if (m_pool->this_thread_is_in_pool()) {
+        // A pool thread runs those of its tasks that no other thread has
+        // taken yet, then blocks until the rest are done. It doesn't pick
+        // up anybody else's tasks, which might want a lock that the
+        // caller holds.
+        while (m_pool->run_task_since(m_mark))
+            ;
+        block = true;
+    } else if (m_pool->is_worker(m_submitter_thread))
         block = true;  // don't get into recursive work stealing
     if (block == false) {
         int tries = 0;
@@ -663,4 +1240,144 @@ parallel_for_chunked_2D(
 }
 
 
+
+void
+parallel_for_adaptive(int64_t start, int64_t end,
+                      std::function<void(int id, int64_t index)>&& task,
+                      parallel_options opt)
+{
+    opt.resolve();
+    int64_t n = end - start;
+    if (opt.pool->very_busy())
+        opt.maxthreads = 1;
+    int nworkers = int(std::min(int64_t(opt.maxthreads), n));
+    if (nworkers <= 1) {
+        for (int64_t i = start; i < end; ++i)
+            task(-1, i);
+        return;
+    }
+
+    // Each worker's share is a [begin,end) range: the owner takes from the
+    // front, thieves take from the back. Only one lock is ever held at a
+    // time, and a range only grows while its owner's is empty.
+    struct Share {
+        spin_mutex mutex;
+        int64_t begin, end;
+    };
+    std::unique_ptr<Share[]> shares(new Share[nworkers]);
+    for (int w = 0; w < nworkers; ++w) {
+        shares[w].begin = start + n * w / nworkers;
+        shares[w].end   = start + n * (w + 1) / nworkers;
+    }
+    auto worker = [&](int id, int w) {
+        Share& mine(shares[w]);
+        for (;;) {
+            int64_t i = -1;
+            {
+                spin_lock lock(mine.mutex);
+                if (mine.begin < mine.end)
+                    i = mine.begin++;
+            }
+            if (i >= 0) {
+                task(id, i);
+                continue;
+            }
+            // Out of work: steal half of the biggest remaining share.
+            int victim = -1;
+            int64_t most = 0;
+            for (int v = 0; v < nworkers; ++v) {
+                if (v == w)
+                    continue;
+                spin_lock lock(shares[v].mutex);
+                if (shares[v].end - shares[v].begin > most) {
+                    most   = shares[v].end - shares[v].begin;
+                    victim = v;
+                }
+            }
+            if (victim < 0)
+                return;  // Nothing left anywhere
+            int64_t b, e;
+            {
+                spin_lock lock(shares[victim].mutex);
+                e = shares[victim].end;
+                b = std::max(shares[victim].begin,
+                             e - (e - shares[victim].begin + 1) / 2);
+                shares[victim].end = b;
+            }
+            spin_lock lock(mine.mutex);
+            mine.begin = b;
+            mine.end   = e;
+        }
+    };
+    task_set ts(opt.pool);
+    for (int w = 1; w < nworkers; ++w)
+        ts.push(opt.pool->push([&, w](int id) { worker(id, w); }));
+    worker(-1, 0);
+    ts.wait();
+}
+
+
+
+void
+parallel_for_ordered(int64_t start, int64_t end,
+                     std::function<void(int64_t index)>&& task,
+                     std::function<void(int64_t index)>&& done, int nthreads,
+                     int64_t window)
+{
+    int64_t n = end - start;
+    if (n <= 0)
+        return;
+    if (nthreads <= 0)
+        nthreads = int(Sysutil::hardware_concurrency());
+    nthreads = int(std::min(int64_t(nthreads), n));
+    if (window <= 0)
+        window = 4 * int64_t(nthreads);
+    if (nthreads <= 1) {
+        for (int64_t i = start; i < end; ++i) {
+            task(i);
+            done(i);
+        }
+        return;
+    }
+
+    std::vector<char> finished(size_t(n), 0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int64_t next  = start;  // next index to start
+    int64_t ndone = start;  // indices before this one are done
+    auto worker = [&]() {
+        for (;;) {
+            int64_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock,
+                        [&]() { return next >= end || next < ndone + window; });
+                if (next >= end)
+                    return;
+                i = next++;
+            }
+            task(i);
+            std::lock_guard<std::mutex> lock(mutex);
+            finished[size_t(i - start)] = 1;
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t)
+        threads.emplace_back(worker);
+    for (int64_t i = start; i < end; ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return finished[size_t(i - start)] != 0; });
+        }
+        done(i);
+        std::lock_guard<std::mutex> lock(mutex);
+        ndone = i + 1;
+        cv.notify_all();
+    }
+    for (auto& t : threads)
+        t.join();
+}
+
+
 OIIO_NAMESPACE_END
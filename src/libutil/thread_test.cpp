@@ -35,10 +35,12 @@
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
 #include <OpenImageIO/timer.h>
 #include <OpenImageIO/unittest.h>
+#include <OpenImageIO/unordered_map_concurrent.h>
 #include <OpenImageIO/ustring.h>
 
 using namespace OIIO;
@@ -169,6 +171,168 @@ time_thread_pool()
 
 
 
+// Parallel loops nested inside pool tasks, three deep: pool threads push
+// their subtasks on their own deques and run whatever nobody stole while
+// they wait, so this must neither deadlock nor lose any work.
+static void
+test_nested_parallel()
+{
+    std::cout << "\nTesting nested parallel_for\n";
+    std::atomic<int64_t> total(0);
+    parallel_for(0, 8, [&](int64_t) {
+        parallel_for(0, 16, [&](int64_t) {
+            parallel_for_chunked(0, 1000, 10, [&](int64_t b, int64_t e) {
+                total += e - b;
+            });
+        });
+    });
+    OIIO_CHECK_EQUAL(total, 8 * 16 * 1000);
+
+    // A task_set filled and waited on by a pool thread.
+    thread_pool* pool(default_thread_pool());
+    std::atomic<int> ran(0);
+    auto outer = pool->push([&](int) {
+        task_set tasks(pool);
+        for (int i = 0; i < 100; ++i)
+            tasks.push(pool->push([&](int) { ++ran; }));
+    });
+    outer.wait();
+    OIIO_CHECK_EQUAL(ran, 100);
+}
+
+
+
+static void
+test_named_pools()
+{
+    std::cout << "\nTesting named thread pools\n";
+    thread_pool* pool = named_thread_pool("thread_test", 3);
+    OIIO_CHECK_EQUAL(pool->size(), 3);
+    OIIO_CHECK_EQUAL(pool->name(), "thread_test");
+    OIIO_CHECK_ASSERT(named_thread_pool("thread_test", 7) == pool);
+    OIIO_CHECK_ASSERT(named_thread_pool("default") == default_thread_pool());
+    OIIO_CHECK_ASSERT(named_thread_pool("background")
+                      == background_thread_pool());
+    OIIO_CHECK_ASSERT(background_thread_pool()->background());
+    OIIO_CHECK_ASSERT(!pool->background());
+
+    // Settings changes reach threads that are idle as well as busy ones.
+    pool->set_background(true);
+    pool->set_affinity({ 0 });
+    OIIO_CHECK_EQUAL(pool->affinity().size(), 1);
+    pool->set_affinity({});
+    pool->set_background(false);
+
+    // Work handed to the named pool runs there, not in the default one.
+    pool->reset_stats();
+    std::atomic<int> outside(0);
+    parallel_options opt;
+    opt.pool = pool;
+    parallel_for_chunked(
+        0, 1000, 10,
+        [&](int64_t, int64_t) {
+            if (default_thread_pool()->this_thread_is_in_pool())
+                ++outside;
+        },
+        opt);
+    OIIO_CHECK_EQUAL(outside, 0);
+    thread_pool::Stats stats = pool->stats();
+    OIIO_CHECK_ASSERT(stats.tasks_run <= 100);
+    OIIO_CHECK_ASSERT(stats.max_queue_depth <= 100);
+    OIIO_CHECK_EQUAL(stats.queue_depth, 0);
+    std::cout << "  " << stats.tasks_run << " tasks run by the pool ("
+              << stats.tasks_stolen << " stolen), at most "
+              << stats.max_queue_depth << " waiting\n";
+}
+
+
+
+// Readers retrieve() without locking while writers insert and erase
+// around them, forcing the bins' indices to grow and be replaced. The
+// values are shared_ptrs, so a reader that got hold of an entry after it
+// was freed would find garbage (or crash, or be flagged by a sanitizer).
+static void
+test_unordered_map_concurrent()
+{
+    std::cout << "\nTesting unordered_map_concurrent lock-free retrieve\n";
+    typedef std::shared_ptr<int> IntRef;
+    typedef unordered_map_concurrent<int, IntRef, std::hash<int>,
+                                     std::equal_to<int>, 8,
+                                     std::unordered_map<int, IntRef>>
+        Map;
+    Map map;
+    const int nstable = 1000, nchurn = 2000, nwriters = 4, nreaders = 4;
+    for (int k = 0; k < nstable; ++k)
+        map.insert(k, std::make_shared<int>(k));
+    std::atomic<int> bad(0);
+    std::atomic<bool> done(false);
+    thread_group writers, readers;
+    for (int w = 0; w < nwriters; ++w) {
+        writers.create_thread([&, w]() {
+            for (int round = 0; round < 10; ++round) {
+                for (int k = nstable + w; k < nstable + nchurn; k += nwriters)
+                    map.insert(k, std::make_shared<int>(k));
+                if (round & 1) {
+                    for (int k = nstable + w; k < nstable + nchurn;
+                         k += nwriters)
+                        map.erase(k);
+                } else {
+                    for (size_t b = 0; b < Map::nbins(); ++b)
+                        map.erase_if(b, [=](int k, const IntRef&) {
+                            return k >= nstable && k % nwriters == w;
+                        });
+                }
+            }
+        });
+    }
+    for (int r = 0; r < nreaders; ++r) {
+        readers.create_thread([&, r]() {
+            for (unsigned i = r; !done; i += 7) {
+                int k = int(i % (nstable + nchurn));
+                IntRef v;
+                bool found = map.retrieve(k, v);
+                if ((found && *v != k) || (!found && k < nstable))
+                    ++bad;
+            }
+        });
+    }
+    writers.join_all();
+    done = true;
+    readers.join_all();
+    OIIO_CHECK_EQUAL(bad, 0);
+    OIIO_CHECK_EQUAL(map.size(), size_t(nstable));
+    for (int k = 0; k < nstable + nchurn; ++k) {
+        IntRef v;
+        bool found = map.retrieve(k, v);
+        OIIO_CHECK_EQUAL(found, k < nstable);
+        if (found)
+            OIIO_CHECK_EQUAL(*v, k);
+    }
+
+    // A value erased while a reader might see it is kept until that
+    // reader is gone, and then released by the next insert, without
+    // waiting for another erase.
+    std::weak_ptr<int> erased = map.find(0)->second;
+    std::atomic<int> stage(0);
+    thread_group holder;
+    holder.create_thread([&]() {
+        epoch_reclaim::read_guard guard;
+        stage = 1;
+        while (stage != 2)
+            std::this_thread::yield();
+    });
+    while (stage != 1)
+        std::this_thread::yield();
+    map.erase(0);
+    OIIO_CHECK_ASSERT(!erased.expired());
+    stage = 2;
+    holder.join_all();
+    map.insert(-1, std::make_shared<int>(-1));
+    OIIO_CHECK_ASSERT(erased.expired());
+}
+
+
+
 int
 main(int argc, char** argv)
 {
@@ -186,6 +350,9 @@ main(int argc, char** argv)
 
     time_thread_group();
     time_thread_pool();
+    test_nested_parallel();
+    test_named_pools();
+    test_unordered_map_concurrent();
 
     return unit_test_failures;
 }
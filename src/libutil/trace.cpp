@@ -0,0 +1,260 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/trace.h>
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace Trace {
+std::atomic<int> active(0);
+}
+
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    int64_t begin, end;
+};
+
+
+// The spans recorded by one thread, the most recent `capacity` of them
+// kept in a ring. Only the owning thread writes; count is published with
+// release so that the writer of the trace sees whole events.
+struct ThreadBuffer {
+    ThreadBuffer(int tid, size_t capacity)
+        : events(new Event[capacity])
+        , capacity(capacity)
+        , tid(tid)
+    {
+    }
+    std::unique_ptr<Event[]> events;
+    size_t capacity;
+    std::atomic<uint64_t> count { 0 };
+    int tid;
+};
+
+
+class TraceLog {
+public:
+    TraceLog()
+    {
+        std::string env = Sysutil::getenv("OPENIMAGEIO_TRACE_FILE");
+        if (env.size())
+            start(env);
+    }
+
+    // Write the trace, if there is one under way, at exit.
+    ~TraceLog() { stop(); }
+
+    bool start(string_view filename)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stop_locked();
+        // Make sure we can write there before anything is recorded.
+        OIIO::ofstream out;
+        Filesystem::open(out, filename);
+        if (!out)
+            return false;
+        m_filename = filename;
+        m_epoch    = Trace::now();
+        for (auto& b : m_buffers)
+            b->count = 0;
+        Trace::active = 1;
+        return true;
+    }
+
+    bool stop()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return stop_locked();
+    }
+
+    std::string filename()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_filename;
+    }
+
+    // A new ring buffer for the calling thread. They are never freed, so
+    // the spans of threads that have exited still make it into the trace.
+    ThreadBuffer* new_buffer()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.emplace_back(
+            new ThreadBuffer(int(m_buffers.size()), size_t(buffer_size)));
+        return m_buffers.back().get();
+    }
+
+    std::atomic<int> buffer_size { 65536 };
+
+private:
+    bool stop_locked()
+    {
+        if (!Trace::active)
+            return true;
+        Trace::active = 0;
+        bool ok = write(m_filename);
+        m_filename.clear();
+        return ok;
+    }
+
+    bool write(const std::string& filename)
+    {
+        OIIO::ofstream out;
+        Filesystem::open(out, filename);
+        if (!out)
+            return false;
+        // Times are relative to when tracing started, or to the earliest
+        // span if one was recorded as having begun before that.
+        int64_t origin = m_epoch;
+        for (auto& b : m_buffers) {
+            uint64_t n     = b->count.load(std::memory_order_acquire);
+            uint64_t first = n > b->capacity ? n - b->capacity : 0;
+            for (uint64_t i = first; i < n; ++i)
+                origin = std::min(origin, b->events[i % b->capacity].begin);
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        const char* sep = "";
+        for (auto& b : m_buffers) {
+            out << Strutil::sprintf(
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                sep, b->tid, b->tid);
+            sep = ",\n";
+            uint64_t n     = b->count.load(std::memory_order_acquire);
+            uint64_t first = n > b->capacity ? n - b->capacity : 0;
+            for (uint64_t i = first; i < n; ++i) {
+                const Event& e(b->events[i % b->capacity]);
+                out << Strutil::sprintf(
+                    "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    sep, escape(e.name), escape(e.category), b->tid,
+                    (e.begin - origin) * 1.0e-3, (e.end - e.begin) * 1.0e-3);
+            }
+        }
+        out << "\n]}\n";
+        return bool(out);
+    }
+
+    static std::string escape(const char* s)
+    {
+        std::string r;
+        for (; s && *s; ++s) {
+            if (*s == '"' || *s == '\\')
+                r += '\\';
+            if ((unsigned char)*s >= ' ')
+                r += *s;
+        }
+        return r;
+    }
+
+    std::mutex m_mutex;
+    std::string m_filename;
+    int64_t m_epoch = 0;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+static TraceLog trace_log;
+
+}  // namespace
+
+
+
+bool
+Trace::start(string_view filename)
+{
+    return trace_log.start(filename);
+}
+
+
+
+bool
+Trace::stop()
+{
+    return trace_log.stop();
+}
+
+
+
+std::string
+Trace::filename()
+{
+    return trace_log.filename();
+}
+
+
+
+void
+Trace::buffer_size(int nspans)
+{
+    trace_log.buffer_size = std::max(nspans, 16);
+}
+
+
+
+int
+Trace::buffer_size()
+{
+    return trace_log.buffer_size;
+}
+
+
+
+void
+Trace::record(const char* name, const char* category, int64_t begin,
+              int64_t end)
+{
+    if (!enabled())
+        return;
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+        buffer = trace_log.new_buffer();
+    uint64_t n = buffer->count.load(std::memory_order_relaxed);
+    Event& e(buffer->events[n % buffer->capacity]);
+    e.name     = name;
+    e.category = category;
+    e.begin    = begin;
+    e.end      = end;
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+OIIO_NAMESPACE_END
@@ -0,0 +1,175 @@
+/*
+  Copyright 2019 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/trace.h>
+#include <OpenImageIO/unittest.h>
+#include <OpenImageIO/ustring.h>
+
+using namespace OIIO;
+
+static std::string tracefile = "trace_test.json";
+
+
+
+static size_t
+count(string_view haystack, string_view needle)
+{
+    size_t n = 0;
+    for (size_t p = haystack.find(needle); p != string_view::npos;
+         p = haystack.find(needle, p + needle.size()))
+        ++n;
+    return n;
+}
+
+
+
+static std::string
+trace_contents()
+{
+    std::string contents;
+    OIIO_CHECK_ASSERT(Filesystem::read_text_file(tracefile, contents));
+    return contents;
+}
+
+
+
+static void
+test_off()
+{
+    std::cout << "test tracing off\n";
+    OIIO_CHECK_ASSERT(!Trace::enabled());
+    OIIO_CHECK_EQUAL(Trace::filename(), "");
+    {
+        OIIO_TRACE_SPAN("before_start", "test");
+    }
+    OIIO_CHECK_ASSERT(Trace::start(tracefile));
+    OIIO_CHECK_ASSERT(Trace::enabled());
+    OIIO_CHECK_EQUAL(Trace::filename(), tracefile);
+    OIIO_CHECK_ASSERT(Trace::stop());
+    OIIO_CHECK_ASSERT(!Trace::enabled());
+    {
+        OIIO_TRACE_SPAN("after_stop", "test");
+    }
+    std::string contents = trace_contents();
+    OIIO_CHECK_EQUAL(count(contents, "before_start"), 0);
+    OIIO_CHECK_EQUAL(count(contents, "after_stop"), 0);
+    OIIO_CHECK_ASSERT(Strutil::starts_with(contents, "{"));
+}
+
+
+
+static void
+test_threads()
+{
+    std::cout << "test spans from several threads\n";
+    const int nthreads = 4, nspans = 1000;
+    OIIO_CHECK_ASSERT(Trace::start(tracefile));
+    {
+        OIIO_TRACE_SPAN("main_span", "test");
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthreads; ++t)
+            threads.emplace_back([=]() {
+                for (int i = 0; i < nspans; ++i) {
+                    OIIO_TRACE_SPAN("worker_span", "test");
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+    }
+    OIIO_TRACE_ELAPSED(ustring("elapsed \"quoted\"").c_str(), "test", 0.5);
+    OIIO_CHECK_ASSERT(Trace::stop());
+    std::string contents = trace_contents();
+    OIIO_CHECK_EQUAL(count(contents, "\"main_span\""), 1);
+    OIIO_CHECK_EQUAL(count(contents, "\"worker_span\""), nthreads * nspans);
+    OIIO_CHECK_EQUAL(count(contents, "elapsed \\\"quoted\\\""), 1);
+    OIIO_CHECK_EQUAL(count(contents, "\"dur\":500000."), 1);
+
+    // Starting again forgets the spans of the previous trace.
+    OIIO_CHECK_ASSERT(Trace::start(tracefile));
+    OIIO_CHECK_ASSERT(Trace::stop());
+    OIIO_CHECK_EQUAL(count(trace_contents(), "worker_span"), 0);
+}
+
+
+
+static void
+test_ring()
+{
+    std::cout << "test ring buffer wrap\n";
+    int oldsize = Trace::buffer_size();
+    Trace::buffer_size(16);
+    OIIO_CHECK_ASSERT(Trace::start(tracefile));
+    std::thread thread([]() {
+        for (int i = 0; i < 100; ++i) {
+            OIIO_TRACE_SPAN(ustring::sprintf("ring%d", i), "test");
+        }
+    });
+    thread.join();
+    OIIO_CHECK_ASSERT(Trace::stop());
+    Trace::buffer_size(oldsize);
+    std::string contents = trace_contents();
+    OIIO_CHECK_EQUAL(count(contents, "\"ring"), 16);
+    OIIO_CHECK_EQUAL(count(contents, "\"ring83\""), 0);
+    OIIO_CHECK_EQUAL(count(contents, "\"ring84\""), 1);
+    OIIO_CHECK_EQUAL(count(contents, "\"ring99\""), 1);
+}
+
+
+
+static void
+benchmark_disabled()
+{
+    Benchmarker bench;
+    bench("span, tracing off", []() { OIIO_TRACE_SPAN("bench", "test"); });
+    Trace::start(tracefile);
+    bench("span, tracing on", []() { OIIO_TRACE_SPAN("bench", "test"); });
+    Trace::stop();
+}
+
+
+
+int
+main(int argc, char* argv[])
+{
+    test_off();
+    test_threads();
+    test_ring();
+    benchmark_disabled();
+    Filesystem::remove(tracefile);
+    return unit_test_failures;
+}
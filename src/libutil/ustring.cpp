@@ -28,6 +28,7 @@
   (This is the Modified BSD License)
 */
 
+#include <atomic>
 #include <string>
 
 #include <OpenImageIO/dassert.h>
@@ -62,12 +63,19 @@ typedef null_lock<null_mutex> ustring_write_lock_t;
 
 
 // NOTE: BASE_CAPACITY must be a power of 2
+//
+// Lookups never lock or write shared memory. The table of entries is
+// published through an atomic pointer, and each slot through an atomic
+// store (release) after its TableRep is fully constructed, so a reader
+// that sees a slot's pointer also sees what it points to. Only insert()
+// takes the lock. Growing builds a new table and then publishes it; the
+// old one is never freed (like the pools, ustrings are forever), since
+// readers may still be probing it. A reader that misses on a stale table
+// just falls back on insert(), which looks again under the lock.
 template<unsigned BASE_CAPACITY = 1 << 20, unsigned POOL_SIZE = 4 << 20>
 struct TableRepMap {
     TableRepMap()
-        : mask(BASE_CAPACITY - 1)
-        , entries(static_cast<ustring::TableRep**>(
-              calloc(BASE_CAPACITY, sizeof(ustring::TableRep*))))
+        : table(new_table(BASE_CAPACITY - 1))
         , num_entries(0)
         , pool(static_cast<char*>(malloc(POOL_SIZE)))
         , pool_offset(0)
@@ -101,7 +109,6 @@ struct TableRepMap {
 
     const char* lookup(string_view str, size_t hash)
     {
-        ustring_read_lock_t lock(mutex);
 #if 0
         // NOTE: this simple increment adds a substantial amount of overhead
         // so keep it off by default, unless the user really wants it
@@ -109,73 +116,90 @@ struct TableRepMap {
         // can skew the number of lookups compared to release builds
         ++num_lookups;
 #endif
-        size_t pos = hash & mask, dist = 0;
+        const Table* t = table.load(std::memory_order_acquire);
+        size_t pos = hash & t->mask, dist = 0;
         for (;;) {
-            if (entries[pos] == 0)
+            const ustring::TableRep* e = t->entries[pos].load(
+                std::memory_order_acquire);
+            if (e == 0)
                 return 0;
-            if (entries[pos]->hashed == hash
-                && entries[pos]->length == str.length()
-                && strncmp(entries[pos]->c_str(), str.data(), str.length())
-                       == 0)
-                return entries[pos]->c_str();
+            if (e->hashed == hash && e->length == str.length()
+                && strncmp(e->c_str(), str.data(), str.length()) == 0)
+                return e->c_str();
             ++dist;
-            pos = (pos + dist) & mask;  // quadratic probing
+            pos = (pos + dist) & t->mask;  // quadratic probing
         }
     }
 
     const char* insert(string_view str, size_t hash)
     {
         ustring_write_lock_t lock(mutex);
-        size_t pos = hash & mask, dist = 0;
+        Table* t   = table.load(std::memory_order_relaxed);
+        size_t pos = hash & t->mask, dist = 0;
         for (;;) {
-            if (entries[pos] == 0)
+            const ustring::TableRep* e = t->entries[pos].load(
+                std::memory_order_relaxed);
+            if (e == 0)
                 break;  // found insert pos
-            if (entries[pos]->hashed == hash
-                && entries[pos]->length == str.length()
-                && strncmp(entries[pos]->c_str(), str.data(), str.length())
-                       == 0)
-                return entries[pos]
-                    ->c_str();  // same string is already inserted, return the one that is already in the table
+            if (e->hashed == hash && e->length == str.length()
+                && strncmp(e->c_str(), str.data(), str.length()) == 0)
+                return e->c_str();  // same string is already inserted, return the one that is already in the table
             ++dist;
-            pos = (pos + dist) & mask;  // quadratic probing
+            pos = (pos + dist) & t->mask;  // quadratic probing
         }
 
         ustring::TableRep* rep = make_rep(str, hash);
-        entries[pos]           = rep;
+        t->entries[pos].store(rep, std::memory_order_release);
         ++num_entries;
-        if (2 * num_entries > mask)
+        if (2 * num_entries > t->mask)
             grow();           // maintain 0.5 load factor
         return rep->c_str();  // rep is now in the table
     }
 
 private:
+    struct Table {
+        size_t mask;
+        std::atomic<ustring::TableRep*> entries[1];  // really mask+1 of them
+    };
+
+    static Table* new_table(size_t mask)
+    {
+        // calloc leaves all the entries null
+        Table* t = static_cast<Table*>(
+            calloc(1, sizeof(Table) + mask * sizeof(Table::entries[0])));
+        t->mask = mask;
+        return t;
+    }
+
     void grow()
     {
-        size_t new_mask = mask * 2 + 1;
+        Table* old_table = table.load(std::memory_order_relaxed);
+        size_t new_mask  = old_table->mask * 2 + 1;
 
-        // NOTE: only increment by half because we are doubling the entries and freeing the old
-        memory_usage += (mask + 1) * sizeof(ustring::TableRep*);
+        // NOTE: the old entries are kept for readers still using them
+        memory_usage += (new_mask + 1) * sizeof(ustring::TableRep*);
 
-        ustring::TableRep** new_entries = static_cast<ustring::TableRep**>(
-            calloc(new_mask + 1, sizeof(ustring::TableRep*)));
-        size_t to_copy = num_entries;
+        Table* new_entries = new_table(new_mask);
+        size_t to_copy     = num_entries;
         for (size_t i = 0; to_copy != 0; i++) {
-            if (entries[i] == 0)
+            ustring::TableRep* e = old_table->entries[i].load(
+                std::memory_order_relaxed);
+            if (e == 0)
                 continue;
-            size_t pos = entries[i]->hashed & new_mask, dist = 0;
+            size_t pos = e->hashed & new_mask, dist = 0;
             for (;;) {
-                if (new_entries[pos] == 0)
+                if (new_entries->entries[pos].load(std::memory_order_relaxed)
+                    == 0)
                     break;
                 ++dist;
                 pos = (pos + dist) & new_mask;  // quadratic probing
             }
-            new_entries[pos] = entries[i];
+            new_entries->entries[pos].store(e, std::memory_order_relaxed);
             to_copy--;
         }
 
-        free(entries);
-        entries = new_entries;
-        mask    = new_mask;
+        // Publish the new table only once it's complete.
+        table.store(new_entries, std::memory_order_release);
     }
 
     ustring::TableRep* make_rep(string_view str, size_t hash)
@@ -206,8 +230,7 @@ private:
         return result;
     }
 
-    size_t mask;
-    ustring::TableRep** entries;
+    std::atomic<Table*> table;
     size_t num_entries;
     char* pool;
     size_t pool_offset;
@@ -32,6 +32,7 @@
 #include <cstdio>
 #include <functional>
 #include <iostream>
+#include <vector>
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/benchmark.h>
@@ -71,6 +72,37 @@ create_lotso_ustrings(int iterations)
 
 
 
+// Many threads make the same strings at once, in different orders, while
+// the table grows. Each string must come out as the same unique pointer in
+// every thread, whether it was found by the lock-free lookup or inserted.
+static void
+test_concurrent_unique()
+{
+    const int nstrings = 200000, nthr = 8;
+    std::vector<std::vector<const char*>> results(
+        nthr, std::vector<const char*>(nstrings));
+    thread_group threads;
+    for (int t = 0; t < nthr; ++t) {
+        threads.create_thread([&, t]() {
+            for (int j = 0; j < nstrings; ++j) {
+                int i = (j + t * (nstrings / nthr)) % nstrings;
+                char buf[32];
+                sprintf(buf, "concurrent%d", i);
+                results[t][i] = ustring(buf).c_str();
+            }
+        });
+    }
+    threads.join_all();
+    int mismatches = 0;
+    for (int t = 1; t < nthr; ++t)
+        for (int i = 0; i < nstrings; ++i)
+            mismatches += (results[t][i] != results[0][i]);
+    OIIO_CHECK_EQUAL(mismatches, 0);
+    OIIO_CHECK_ASSERT(ustring("concurrent17").c_str() == results[3][17]);
+}
+
+
+
 static void
 getargs(int argc, char* argv[])
 {
@@ -116,6 +148,8 @@ main(int argc, char* argv[])
 
     std::cout << "hw threads = " << Sysutil::hardware_concurrency() << "\n";
 
+    test_concurrent_unique();
+
     if (wedge) {
         timed_thread_wedge(create_lotso_ustrings, numthreads, iterations,
                            ntrials);
@@ -59,6 +59,7 @@ using namespace OIIO;
 static std::string full_command_line;
 static std::vector<std::string> filenames;
 static std::string outputfilename;
+static std::string batchfilename;
 static bool verbose  = false;
 static bool runstats = false;
 static int nthreads  = 0;  // default: use #cores threads if available
@@ -69,6 +70,7 @@ static bool shadowmode     = false;
 static bool envlatlmode    = false;
 static bool envcubemode    = false;
 static bool lightprobemode = false;
+static bool cubefacesmode  = false;
 static bool bumpslopesmode = false;
 
 
@@ -184,6 +186,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     int tile[3] = { 64, 64, 1 };  // FIXME if we ever support volume MIPmaps
     std::string compression = "zip";
     bool updatemode         = false;
+    bool incremental        = false;
     bool checknan           = false;
     std::string fixnan;  // none, black, box3
     bool set_full_to_pixels        = false;
@@ -200,6 +203,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     bool nomipmap              = false;
     bool prman_metadata        = false;
     bool constant_color_detect = false;
+    bool constant_tiles        = false;
     bool monochrome_detect     = false;
     bool opaque_detect         = false;
     bool compute_average       = true;
@@ -228,8 +232,10 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
                   "--help", &help, "Print help message",
                   "-v", &verbose, "Verbose status messages",
                   "-o %s", &outputfilename, "Output filename",
+                  "--batch %s", &batchfilename, "Convert each file listed (one \"input [output]\" per line) in the given file",
                   "--threads %d", &nthreads, "Number of threads (default: #cores)",
                   "-u", &updatemode, "Update mode",
+                  "--incremental", &incremental, "Recompute only the parts of the MIP levels that changed since the last --incremental run",
                   "--format %s", &fileformatname, "Specify output file format (default: guess from extension)",
                   "--nchannels %d", &nchannels, "Specify the number of output image channels.",
                   "--chnames %s", &channelnames, "Rename channels (comma-separated)",
@@ -269,6 +275,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
                   "--sattrib %L %L", &string_attrib_names, &string_attrib_values, "Sets string metadata attribute (name, value)",
                   "--sansattrib", &sansattrib, "Write command line into Software & ImageHistory but remove --sattrib and --attrib options",
                   "--constant-color-detect", &constant_color_detect, "Create 1-tile textures from constant color inputs",
+                  "--constant-tiles", &constant_tiles, "Record which tiles are all one value, so the ImageCache need not read them",
                   "--monochrome-detect", &monochrome_detect, "Create 1-channel textures from monochrome inputs",
                   "--opaque-detect", &opaque_detect, "Drop alpha channel that is always 1.0",
                   "--no-compute-average %!", &compute_average, "Don't compute and store average color",
@@ -280,6 +287,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
                   "--shadow", &shadowmode, "Create shadow map",
                   "--envlatl", &envlatlmode, "Create lat/long environment map",
                   "--lightprobe", &lightprobemode, "Create lat/long environment map from a light probe",
+                  "--cubefaces", &cubefacesmode, "Create lat/long environment map from the six faces of a cube map (order: px, nx, py, ny, pz, nz)",
                   "--bumpslopes", &bumpslopesmode, "Create a 6 channels bump-map with height, derivatives and square derivatives from an height or a normal map",
                   "--bumpformat %s", &bumpformat, "Specify the interpretation of a 3-channel input image for --bumpslopes: \"height\", \"normal\" or \"auto\" (default).",
 //                  "--envcube", &envcubemode, "Create cubic env map (file order: px, nx, py, ny, pz, nz) (UNIMP)",
@@ -304,19 +312,19 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
         ap.usage();
         exit(EXIT_FAILURE);
     }
-    if (filenames.empty()) {
+    if (filenames.empty() && batchfilename.empty()) {
         ap.briefusage();
         std::cout << "\nFor detailed help: maketx --help\n";
         exit(EXIT_SUCCESS);
     }
 
     int optionsum = ((int)shadowmode + (int)envlatlmode + (int)envcubemode
-                     + (int)lightprobemode)
+                     + (int)lightprobemode + (int)cubefacesmode)
                     + (int)bumpslopesmode;
     if (optionsum > 1) {
         std::cerr
             << "maketx ERROR: At most one of the following options may be set:\n"
-            << "\t--shadow --envlatl --envcube --lightprobe\n";
+            << "\t--shadow --envlatl --envcube --lightprobe --cubefaces\n";
         exit(EXIT_FAILURE);
     }
     if (optionsum == 0)
@@ -331,7 +339,13 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
         exit(EXIT_FAILURE);
     }
 
-    if (filenames.size() != 1) {
+    if (batchfilename.size()) {
+        if (filenames.size() || outputfilename.size()) {
+            std::cerr << "maketx ERROR: --batch takes the input and output "
+                         "filenames from the list file\n";
+            exit(EXIT_FAILURE);
+        }
+    } else if (filenames.size() != 1) {
         std::cerr << "maketx ERROR: requires exactly one input filename\n";
         exit(EXIT_FAILURE);
     }
@@ -382,7 +396,9 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     configspec.attribute("maketx:resize", doresize);
     configspec.attribute("maketx:nomipmap", nomipmap);
     configspec.attribute("maketx:updatemode", updatemode);
+    configspec.attribute("maketx:incremental", incremental);
     configspec.attribute("maketx:constant_color_detect", constant_color_detect);
+    configspec.attribute("maketx:constant_tiles", constant_tiles);
     configspec.attribute("maketx:monochrome_detect", monochrome_detect);
     configspec.attribute("maketx:opaque_detect", opaque_detect);
     configspec.attribute("maketx:compute_average", compute_average);
@@ -483,11 +499,34 @@ main(int argc, char* argv[])
         mode = ImageBufAlgo::MakeTxEnvLatl;
     if (lightprobemode)
         mode = ImageBufAlgo::MakeTxEnvLatlFromLightProbe;
+    if (cubefacesmode)
+        mode = ImageBufAlgo::MakeTxEnvLatlFromCubeFaces;
     if (bumpslopesmode)
         mode = ImageBufAlgo::MakeTxBumpWithSlopes;
 
-    bool ok = ImageBufAlgo::make_texture(mode, filenames[0], outputfilename,
-                                         configspec, &std::cout);
+    bool ok;
+    if (batchfilename.size()) {
+        // One conversion per line: input filename, optional output name
+        std::string list;
+        if (!Filesystem::read_text_file(batchfilename, list)) {
+            std::cerr << "maketx ERROR: Could not read \"" << batchfilename
+                      << "\"\n";
+            return EXIT_FAILURE;
+        }
+        std::vector<std::string> inputs, outputs;
+        for (string_view line : Strutil::splitsv(list, "\n")) {
+            std::vector<std::string> names = Strutil::splits(line);
+            if (names.empty() || names[0][0] == '#')
+                continue;
+            inputs.push_back(names[0]);
+            outputs.push_back(names.size() > 1 ? names[1] : "");
+        }
+        ok = ImageBufAlgo::make_texture_batch(mode, inputs, outputs,
+                                              configspec, &std::cout);
+    } else {
+        ok = ImageBufAlgo::make_texture(mode, filenames[0], outputfilename,
+                                        configspec, &std::cout);
+    }
     if (runstats)
         std::cout << "\n" << ic->getstats();
 
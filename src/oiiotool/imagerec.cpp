@@ -32,6 +32,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -223,6 +224,135 @@ ImageRec::ImageRec(const std::string& name, const ImageSpec& spec,
 
 
 
+ImageRec::ImageRec(const std::string& name, ImageRecRef src, ExprStep step)
+    : m_name(name)
+    , m_elaborated(true)
+    , m_pixels_modified(true)
+    , m_time(src->m_time)
+    , m_imagecache(src->m_imagecache)
+{
+    // Chain onto a deferred source's steps, so that the whole run of ops
+    // is evaluated in one pass over the original pixels.
+    if (src->m_deferred_src) {
+        m_deferred_steps = src->m_deferred_steps;
+        src              = src->m_deferred_src;
+    }
+    m_deferred_steps.push_back(step);
+    m_deferred_src = src;
+    m_subimages.resize(1);
+    m_subimages[0].m_miplevels.emplace_back(new ImageBuf);
+    m_subimages[0].m_specs.resize(1);
+
+    // Learn the spec the result will have by evaluating just one pixel,
+    // so that it's exactly what the full evaluation will produce. A
+    // generated source only knows its spec, it has no pixels yet.
+    ROI srcroi, srcroi_full;
+    if (src->m_generator) {
+        srcroi      = get_roi(*src->spec(0, 0));
+        srcroi_full = get_roi_full(*src->spec(0, 0));
+    } else {
+        const ImageBuf& srcbuf((*src)(0, 0));
+        srcroi      = srcbuf.roi();
+        srcroi_full = srcbuf.roi_full();
+    }
+    ROI roi = srcroi;
+    if (roi.npixels() > 0) {
+        roi.xend = roi.xbegin + 1;
+        roi.yend = roi.ybegin + 1;
+        roi.zend = roi.zbegin + 1;
+        ImageBuf pixel;
+        if (deferred_bands()(pixel, roi)) {
+            ImageSpec& spec(m_subimages[0].m_specs[0]);
+            spec = pixel.spec();
+            set_roi(spec, srcroi);
+            set_roi_full(spec, srcroi_full);
+            return;
+        }
+    }
+    // If that didn't work, compute it all now, so any error is reported.
+    const ImageBuf& ib((*this)(0, 0));
+    m_subimages[0].m_specs[0] = ib.spec();
+    if (ib.has_error())
+        errorf("%s", ib.geterror());
+}
+
+
+
+ImageRec::ImageRec(const std::string& name, const ImageSpec& spec,
+                   Generator generator, ImageCache* imagecache)
+    : m_name(name)
+    , m_elaborated(true)
+    , m_pixels_modified(true)
+    , m_time(std::time(nullptr))
+    , m_imagecache(imagecache)
+    , m_generator(generator)
+{
+    m_subimages.resize(1);
+    m_subimages[0].m_miplevels.emplace_back(new ImageBuf);
+    m_subimages[0].m_specs.push_back(spec);
+}
+
+
+
+ImageBufAlgo::Expr
+ImageRec::deferred_expr() const
+{
+    ASSERT(m_deferred_src);
+    ImageBufAlgo::Expr expr((*m_deferred_src)(0, 0));
+    for (auto& step : m_deferred_steps)
+        step(expr);
+    return expr;
+}
+
+
+
+ImageRec::Generator
+ImageRec::deferred_bands() const
+{
+    if (m_generator)
+        return m_generator;
+    ASSERT(m_deferred_src);
+    if (!m_deferred_src->m_generator) {
+        auto expr = std::make_shared<ImageBufAlgo::Expr>(deferred_expr());
+        return [expr](ImageBuf& dst, ROI roi) { return expr->eval(dst, roi); };
+    }
+    // The source is generated too: make just the band of it that's
+    // needed, and apply the steps to that.
+    return [this](ImageBuf& dst, ROI roi) {
+        const ImageRec& src(*m_deferred_src);
+        if (!src.deferred())  // its pixels have been computed since
+            return deferred_expr().eval(dst, roi);
+        ROI srcroi     = roi;
+        srcroi.chbegin = 0;
+        srcroi.chend   = src.spec(0, 0)->nchannels;
+        ImageBuf band;
+        if (!src.m_generator(band, srcroi)) {
+            dst.errorf("%s", band.geterror());
+            return false;
+        }
+        ImageBufAlgo::Expr expr(band);
+        for (auto& step : m_deferred_steps)
+            step(expr);
+        return expr.eval(dst, roi);
+    };
+}
+
+
+
+void
+ImageRec::materialize() const
+{
+    ImageBuf& ib(*m_subimages[0].m_miplevels[0]);
+    if (m_generator)
+        m_generator(ib, get_roi(m_subimages[0].m_specs[0]));
+    else
+        deferred_expr().eval(ib);  // an error is left in ib for the next op
+    m_deferred_src.reset();
+    m_generator = nullptr;
+}
+
+
+
 bool
 ImageRec::read(ReadPolicy readpolicy, string_view channel_set)
 {
@@ -254,7 +384,7 @@ ImageRec::read(ReadPolicy readpolicy, string_view channel_set)
             // hold a 2048x1536 RGBA float image.  Larger things will
             // simply fall back on ImageCache.
             bool forceread
-                = (s == 0 && m == 0
+                = (s == 0 && m == 0 && !(readpolicy & ReadNoForce)
                    && m_imagecache->imagespec(uname, s, m)->image_bytes()
                           < 50 * 1024 * 1024);
             ImageBufRef ib(
@@ -324,6 +454,7 @@ ImageRec::read(ReadPolicy readpolicy, string_view channel_set)
             allok &= ok;
             // Remove any existing SHA-1 hash from the spec.
             ib->specmod().erase_attribute("oiio:SHA-1");
+            ib->specmod().erase_attribute("oiio:PixelHash");
             std::string desc = ib->spec().get_string_attribute(
                 "ImageDescription");
             if (desc.size()) {
@@ -357,6 +488,28 @@ ImageRec::read(ReadPolicy readpolicy, string_view channel_set)
 }
 
 
+
+void
+ImageRec::share_pixels(const ImageRec& src)
+{
+    DASSERT(!src.deferred());
+    m_subimages.clear();
+    m_subimages.resize(src.subimages());
+    for (int s = 0, subimages = src.subimages(); s < subimages; ++s) {
+        const SubimageRec& srcsub(src.m_subimages[s]);
+        SubimageRec& sub(m_subimages[s]);
+        // ImageBuf copies share local pixel memory until one is written.
+        for (const ImageBufRef& ib : srcsub.m_miplevels)
+            sub.m_miplevels.emplace_back(new ImageBuf(*ib));
+        sub.m_specs           = srcsub.m_specs;
+        sub.m_was_direct_read = srcsub.m_was_direct_read;
+    }
+    m_time       = src.m_time;
+    m_provenance = src.m_provenance;
+    m_elaborated = true;
+}
+
+
 namespace {
 static spin_mutex err_mutex;
 }
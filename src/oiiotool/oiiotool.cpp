@@ -30,15 +30,22 @@
 
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
+#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -56,6 +63,16 @@
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/timer.h>
+#include <OpenImageIO/trace.h>
+
+#ifndef _WIN32
+#    include <cerrno>
+#    include <csignal>
+#    include <cstring>
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
 
 #include "oiiotool.h"
 
@@ -79,7 +96,10 @@ using namespace OiioTool;
 using namespace ImageBufAlgo;
 
 
-static Oiiotool ot;
+// Each thread has its own oiiotool state, so that --parallel-frames can run
+// several frames of a sequence at once. Otherwise, only the main thread's
+// is ever used.
+static thread_local Oiiotool ot;
 
 
 // Macro to fully set up the "action" function that straightforwardly
@@ -133,15 +153,16 @@ static Oiiotool ot;
     }
 
 
-#define BINARY_IMAGE_COLOR_OP(name, impl, defaultval)                          \
+#define BINARY_IMAGE_COLOR_OP(name, impl, exprmethod, defaultval)              \
     static int action_##name(int argc, const char* argv[])                     \
     {                                                                          \
         const int nargs = 2, ninputs = 1;                                      \
         if (ot.postpone_callback(ninputs, action_##name, argc, argv))          \
             return 0;                                                          \
         ASSERT(argc == nargs);                                                 \
-        OiiotoolImageColorOp<IBAbinary_img_col> op(impl, ot, #name, argc,      \
-                                                   argv, ninputs);             \
+        OiiotoolImageColorOp<IBAbinary_img_col> op(impl, exprmethod, ot,       \
+                                                   #name, argc, argv,          \
+                                                   ninputs);                   \
         return op();                                                           \
     }
 
@@ -170,6 +191,7 @@ Oiiotool::clear_options()
     autocc             = false;
     autopremult        = true;
     nativeread         = false;
+    stream             = false;
     cachesize          = 4096;
     autotile           = 0;  // was: 4096
     // FIXME: Turned off autotile by default Jan 2018 after thinking that
@@ -207,6 +229,8 @@ Oiiotool::clear_options()
     m_pending_argc              = 0;
     frame_number                = 0;
     frame_padding               = 0;
+    runstats_json.clear();
+    runstats_trace.clear();
     first_input_dataformat      = TypeUnknown;
     first_input_dataformat_bits = 0;
     first_input_channelformats.clear();
@@ -263,7 +287,7 @@ Oiiotool::read(ImageRecRef img, ReadPolicy readpolicy)
     total_readtime.start();
     if (ot.nativeread)
         readpolicy = ReadPolicy(readpolicy | ReadNative);
-    bool ok = img->read(readpolicy);
+    bool ok = read_shared(*img, readpolicy);
     total_readtime.stop();
     imagecache->getattribute("stat:fileio_time", post_ic_time);
     total_imagecache_readtime += post_ic_time - pre_ic_time;
@@ -298,6 +322,69 @@ Oiiotool::read(ImageRecRef img, ReadPolicy readpolicy)
 
 
 
+bool
+Oiiotool::read_shared(ImageRec& img, ReadPolicy readpolicy,
+                      string_view channel_set)
+{
+    if (img.elaborated())
+        return true;
+    // Everything that affects what the read produces is in the key. The
+    // file name comes first, so that forget_common() can find it.
+    std::string config;
+    if (img.configspec()->extra_attribs.size())
+        config = img.configspec()->serialize(ImageSpec::SerialText);
+    std::string key = Strutil::sprintf(
+        "%s\n%d %d %s %s\n%s", img.name(),
+        (long long)Filesystem::last_write_time(img.name()), int(readpolicy),
+        img.input_dataformat(), channel_set, config);
+    ImageRecRef found = find_common(key);
+    if (found) {
+        img.share_pixels(*found);
+        if (debug)
+            std::cout << "  Sharing pixels of earlier read of " << img.name()
+                      << "\n";
+        return true;
+    }
+    bool ok = img.read(readpolicy, channel_set);
+    if (ok && !img.has_error()) {
+        img.provenance(key);
+        remember_common(key, img);
+    }
+    return ok;
+}
+
+
+
+ImageRecRef
+Oiiotool::find_common(const std::string& key) const
+{
+    auto found = m_common_images.find(key);
+    return found != m_common_images.end() ? found->second : ImageRecRef();
+}
+
+
+
+void
+Oiiotool::remember_common(const std::string& key, const ImageRec& img)
+{
+    ImageRecRef pristine(new ImageRec(img.name(), imagecache));
+    pristine->share_pixels(img);
+    m_common_images[key] = pristine;
+}
+
+
+
+void
+Oiiotool::forget_common(string_view filename)
+{
+    std::string prefix = std::string(filename) + "\n";
+    auto i             = m_common_images.lower_bound(prefix);
+    while (i != m_common_images.end() && Strutil::starts_with(i->first, prefix))
+        i = m_common_images.erase(i);
+}
+
+
+
 bool
 Oiiotool::postpone_callback(int required_images, CallbackFunction func,
                             int argc, const char* argv[])
@@ -336,6 +423,231 @@ Oiiotool::process_pending()
 
 
 
+void
+Oiiotool::finish_outputs(string_view filename) const
+{
+    // Take the ones to finish off the list first, in case finishing one
+    // fails and the error finishes the rest.
+    std::vector<UnfinishedOutput> finishing;
+    for (size_t i = 0; i < unfinished_outputs.size();) {
+        if (filename.empty() || unfinished_outputs[i].filename == filename) {
+            finishing.push_back(std::move(unfinished_outputs[i]));
+            unfinished_outputs.erase(unfinished_outputs.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+    for (auto& output : finishing)
+        output.finish();
+}
+
+
+
+// Per-command statistics are differences of these process-wide counters,
+// taken at the end of each command.
+static const auto oiiotool_start_time = std::chrono::steady_clock::now();
+
+static void
+snapshot_counters(const Oiiotool& ot, Oiiotool::CommandStats& s)
+{
+    using namespace std::chrono;
+    s.start = duration<double>(steady_clock::now() - oiiotool_start_time)
+                  .count();
+    s.cpu           = double(std::clock()) / CLOCKS_PER_SEC;
+    s.bytes_written = ot.bytes_written;
+    s.memory        = Sysutil::memory_used();
+    int misses      = 0;
+    if (ot.imagecache) {
+        ot.imagecache->getattribute("stat:bytes_read", TypeDesc::INT64,
+                                    &s.bytes_read);
+        ot.imagecache->getattribute("stat:find_tile_cache_misses", TypeInt,
+                                    &misses);
+    }
+    s.cache_misses = misses;
+    // The LoggedTimer totals, from the "timing_report" lines of the form
+    // "name  ncalls  time s  (avg ...)".
+    s.functions.clear();
+    ustring report;
+    if (OIIO::getattribute("timing_report", TypeString, &report)) {
+        std::istringstream lines(report.string());
+        lines.imbue(std::locale::classic());
+        std::string line, name;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            fields.imbue(std::locale::classic());
+            int calls;
+            double time;
+            if (fields >> name >> calls >> time)
+                s.functions[name] = std::make_pair(calls, time);
+        }
+    }
+}
+
+
+
+// A small number for each thread, to tell them apart in the trace.
+static int
+thread_index()
+{
+    static std::atomic<int> next(0);
+    static thread_local int index = next++;
+    return index;
+}
+
+
+
+void
+Oiiotool::command_done(string_view command, double time)
+{
+    function_times[command] += time;
+    OIIO_TRACE_ELAPSED(ustring(command).c_str(), "oiiotool", time);
+    close_command_stats(command);
+}
+
+
+
+void
+Oiiotool::start_command_stats()
+{
+    if (m_command_stats_on)
+        return;
+    m_command_stats_on = true;
+    // Have the library's LoggedTimers record, so that each command can be
+    // broken down by the functions it called.
+    int log_times = 0;
+    OIIO::getattribute("log_times", log_times);
+    if (!log_times)
+        OIIO::attribute("log_times", 1);
+    snapshot_counters(*this, m_command_stats_prev);
+    m_command_peak_memory = m_command_stats_prev.memory;
+}
+
+
+
+void
+Oiiotool::stop_command_stats()
+{
+    m_command_stats_on = false;
+    command_stats.clear();
+}
+
+
+
+void
+Oiiotool::close_command_stats(string_view command)
+{
+    if (!m_command_stats_on)
+        return;
+    const CommandStats& prev(m_command_stats_prev);
+    CommandStats now;
+    snapshot_counters(*this, now);
+    CommandStats stats;
+    stats.command       = command;
+    stats.frame         = frame_number;
+    stats.thread        = thread_index();
+    stats.start         = prev.start;
+    stats.wall          = now.start - prev.start;
+    stats.cpu           = now.cpu - prev.cpu;
+    stats.bytes_read    = now.bytes_read - prev.bytes_read;
+    stats.bytes_written = now.bytes_written - prev.bytes_written;
+    stats.cache_misses  = now.cache_misses - prev.cache_misses;
+    stats.memory        = now.memory;
+    size_t peak = std::max(m_command_peak_memory, now.memory);
+    stats.peak_memory = peak > prev.memory ? peak - prev.memory : 0;
+    for (auto& f : now.functions) {
+        auto p     = prev.functions.find(f.first);
+        int calls  = f.second.first;
+        double time = f.second.second;
+        if (p != prev.functions.end()) {
+            calls -= p->second.first;
+            time -= p->second.second;
+        }
+        if (calls > 0)
+            stats.functions[f.first] = std::make_pair(calls, time);
+    }
+    command_stats.push_back(std::move(stats));
+    m_command_stats_prev  = std::move(now);
+    m_command_peak_memory = m_command_stats_prev.memory;
+}
+
+
+
+void
+Oiiotool::write_command_stats() const
+{
+    // The fields of a command's entry that are the same in both files.
+    auto fields = [](const CommandStats& c) {
+        std::string f = Strutil::sprintf(
+            "\"frame\": %d, \"cpu\": %.6f, \"bytes_read\": %lld, "
+            "\"bytes_written\": %lld, \"cache_misses\": %lld, "
+            "\"memory\": %llu, \"peak_memory_delta\": %llu, \"functions\": {",
+            c.frame, c.cpu, c.bytes_read, c.bytes_written, c.cache_misses,
+            (unsigned long long)c.memory, (unsigned long long)c.peak_memory);
+        const char* sep = "";
+        for (auto& fn : c.functions) {
+            f += Strutil::sprintf("%s\"%s\": { \"calls\": %d, \"time\": %.6f }",
+                                  sep, Strutil::escape_chars(fn.first),
+                                  fn.second.first, fn.second.second);
+            sep = ", ";
+        }
+        return f + "}";
+    };
+
+    if (runstats_json.size()) {
+        OIIO::ofstream out;
+        Filesystem::open(out, runstats_json);
+        if (!out) {
+            warningf("--runstats-json", "Could not open \"%s\"",
+                     runstats_json);
+        } else {
+            out << "{\n  \"peak_memory\": " << peak_memory
+                << ",\n  \"commands\": [\n";
+            for (size_t i = 0; i < command_stats.size(); ++i) {
+                const CommandStats& c(command_stats[i]);
+                out << Strutil::sprintf(
+                    "    { \"command\": \"%s\", \"thread\": %d, "
+                    "\"start\": %.6f, \"wall\": %.6f, %s }%s\n",
+                    Strutil::escape_chars(c.command), c.thread, c.start,
+                    c.wall, fields(c),
+                    i + 1 < command_stats.size() ? "," : "");
+            }
+            out << "  ]\n}\n";
+        }
+    }
+
+    if (runstats_trace.size()) {
+        // Chrome's trace event format (for chrome://tracing, Perfetto,
+        // speedscope, ...): a complete ("X") event for each command, and
+        // a counter ("C") event tracking resident memory.
+        OIIO::ofstream out;
+        Filesystem::open(out, runstats_trace);
+        if (!out) {
+            warningf("--runstats-trace", "Could not open \"%s\"",
+                     runstats_trace);
+        } else {
+            out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+            for (size_t i = 0; i < command_stats.size(); ++i) {
+                const CommandStats& c(command_stats[i]);
+                out << Strutil::sprintf(
+                    "  { \"name\": \"%s\", \"cat\": \"oiiotool\", "
+                    "\"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.1f, "
+                    "\"dur\": %.1f, \"args\": { %s } },\n",
+                    Strutil::escape_chars(c.command), c.thread,
+                    c.start * 1.0e6, c.wall * 1.0e6, fields(c));
+                out << Strutil::sprintf(
+                    "  { \"name\": \"memory\", \"ph\": \"C\", \"pid\": 1, "
+                    "\"ts\": %.1f, \"args\": { \"resident\": %llu } }%s\n",
+                    (c.start + c.wall) * 1.0e6,
+                    (unsigned long long)c.memory,
+                    i + 1 < command_stats.size() ? "," : "");
+            }
+            out << "] }\n";
+        }
+    }
+}
+
+
+
 void
 Oiiotool::error(string_view command, string_view explanation) const
 {
@@ -348,6 +660,10 @@ Oiiotool::error(string_view command, string_view explanation) const
     // Repeat the command line, so if oiiotool is being called from a
     // script, it's easy to debug how the command was mangled.
     std::cerr << "Full command line was:\n> " << full_command_line << "\n";
+    // Outputs written before the error are still completed.
+    finish_outputs();
+    if (throw_errors)
+        throw FrameError{ -1 };
     exit(-1);
 }
 
@@ -413,6 +729,20 @@ set_cachesize(int argc, const char* argv[])
 
 
 
+static int
+set_runstats_output(int argc, const char* argv[])
+{
+    ASSERT(argc == 2);
+    if (Strutil::ends_with(argv[0], "json"))
+        ot.runstats_json = argv[1];
+    else
+        ot.runstats_trace = argv[1];
+    ot.start_command_stats();
+    return 0;
+}
+
+
+
 static int
 set_autotile(int argc, const char* argv[])
 {
@@ -1717,7 +2047,7 @@ set_origin(int argc, const char* argv[])
             A->metadata_modified(true);
         }
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -1754,7 +2084,7 @@ set_fullsize(int argc, const char* argv[])
         ibspec.full_height = h;
         A->metadata_modified(true);
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -1791,7 +2121,7 @@ set_full_to_pixels(int argc, const char* argv[])
         }
     }
     A->metadata_modified(true);
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2019,7 +2349,7 @@ action_unmip(int argc, const char* argv[])
 
     ImageRecRef newimg(new ImageRec(*ot.curimg, -1, 0, true, true));
     ot.curimg = newimg;
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2067,7 +2397,7 @@ set_channelnames(int argc, const char* argv[])
             A->update_spec_from_imagebuf(s, m);
         }
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2187,6 +2517,22 @@ action_channels(int argc, const char* argv[])
     else if (chanlist == "RGBA")
         chanlist = "R,G,B,A";
 
+    // Extracting the same channels of the same image again (as when one
+    // input is split several ways) just shares the earlier result.
+    std::string key;
+    if (A->provenance().size())
+        key = Strutil::sprintf("%s\n%s %s %d", A->provenance(), command,
+                               chanlist, int(ot.allsubimages));
+    if (ImageRecRef found = key.size() ? ot.find_common(key) : nullptr) {
+        ImageRecRef R(new ImageRec(A->name(), ot.imagecache));
+        R->share_pixels(*found);
+        R->metadata_modified(true);
+        R->provenance(key);
+        ot.push(R);
+        ot.command_done(command, timer());
+        return 0;
+    }
+
     // Decode the channel set, make the full list of ImageSpec's we'll
     // need to describe the new ImageRec with the altered channels.
     std::vector<int> allmiplevels;
@@ -2234,15 +2580,21 @@ action_channels(int argc, const char* argv[])
                                              (int)channels.size(), &channels[0],
                                              &values[0], &newchannelnames[0],
                                              false);
-            if (!ok)
+            if (!ok) {
                 ot.error(command, (*R)(s, m).geterror());
+                key.clear();
+            }
             // Tricky subtlety: IBA::channels changed the underlying IB,
             // we may need to update the IR's copy of the spec.
             R->update_spec_from_imagebuf(s, m);
         }
     }
+    if (key.size()) {
+        R->provenance(key);
+        ot.remember_common(key, *R);
+    }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2287,7 +2639,7 @@ action_chappend(int argc, const char* argv[])
             R->update_spec_from_imagebuf(s, m);
         }
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2312,7 +2664,7 @@ action_selectmip(int argc, const char* argv[])
 
     ImageRecRef newimg(new ImageRec(*ot.curimg, -1, miplevel, true, true));
     ot.curimg = newimg;
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2362,7 +2714,7 @@ action_select_subimage(int argc, const char* argv[])
 
     ImageRecRef A = ot.pop();
     ot.push(new ImageRec(*A, subimage));
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2383,7 +2735,7 @@ action_subimage_split(int argc, const char* argv[])
     for (int subimage = 0; subimage < A->subimages(); ++subimage)
         ot.push(new ImageRec(*A, subimage));
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2446,7 +2798,7 @@ action_subimage_append(int argc, const char* argv[])
 
     action_subimage_append_n(2, command);
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2462,7 +2814,7 @@ action_subimage_append_all(int argc, const char* argv[])
 
     action_subimage_append_n(int(ot.image_stack.size() + 1), command);
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2507,12 +2859,13 @@ action_colorcount(int argc, const char* argv[])
                                         &colorvalues[0], &eps[0]);
     if (ok) {
         for (int col = 0; col < ncolors; ++col)
-            Strutil::printf("%8d  %s\n", count[col], colorstrings[col]);
+            std::cout << Strutil::sprintf("%8d  %s\n", count[col],
+                                          colorstrings[col]);
     } else {
         ot.error(command, (*ot.curimg)(0, 0).geterror());
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2541,14 +2894,14 @@ action_rangecheck(int argc, const char* argv[])
                                               &highcount, &inrangecount,
                                               &low[0], &high[0]);
     if (ok) {
-        Strutil::printf("%8d  < %s\n", lowcount, lowarg);
-        Strutil::printf("%8d  > %s\n", highcount, higharg);
-        Strutil::printf("%8d  within range\n", inrangecount);
+        std::cout << Strutil::sprintf("%8d  < %s\n", lowcount, lowarg);
+        std::cout << Strutil::sprintf("%8d  > %s\n", highcount, higharg);
+        std::cout << Strutil::sprintf("%8d  within range\n", inrangecount);
     } else {
         ot.error(command, (*ot.curimg)(0, 0).geterror());
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2570,7 +2923,7 @@ action_diff(int argc, const char* argv[])
         ot.errorf(command, "Diff failed");
 
     ot.printed_info = true;  // because taking the diff has output
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2591,7 +2944,7 @@ action_pdiff(int argc, const char* argv[])
     if (ret != DiffErrOK && ret != DiffErrWarn && ret != DiffErrFail)
         ot.errorf(command, "Diff failed");
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2603,12 +2956,12 @@ BINARY_IMAGE2_OP(mul, ImageBufAlgo::mul);
 BINARY_IMAGE2_OP(div, ImageBufAlgo::div);
 BINARY_IMAGE2_OP(absdiff, ImageBufAlgo::absdiff);
 
-BINARY_IMAGE_COLOR_OP(addc, ImageBufAlgo::add, 0);
-BINARY_IMAGE_COLOR_OP(subc, ImageBufAlgo::sub, 0);
-BINARY_IMAGE_COLOR_OP(mulc, ImageBufAlgo::mul, 1);
-BINARY_IMAGE_COLOR_OP(divc, ImageBufAlgo::div, 1);
-BINARY_IMAGE_COLOR_OP(absdiffc, ImageBufAlgo::absdiff, 0);
-BINARY_IMAGE_COLOR_OP(powc, ImageBufAlgo::pow, 1.0f);
+BINARY_IMAGE_COLOR_OP(addc, ImageBufAlgo::add, &ImageBufAlgo::Expr::add, 0);
+BINARY_IMAGE_COLOR_OP(subc, ImageBufAlgo::sub, &ImageBufAlgo::Expr::sub, 0);
+BINARY_IMAGE_COLOR_OP(mulc, ImageBufAlgo::mul, &ImageBufAlgo::Expr::mul, 1);
+BINARY_IMAGE_COLOR_OP(divc, ImageBufAlgo::div, nullptr, 1);
+BINARY_IMAGE_COLOR_OP(absdiffc, ImageBufAlgo::absdiff, nullptr, 0);
+BINARY_IMAGE_COLOR_OP(powc, ImageBufAlgo::pow, &ImageBufAlgo::Expr::pow, 1.0f);
 
 UNARY_IMAGE_OP(abs, ImageBufAlgo::abs);
 
@@ -2624,6 +2977,11 @@ public:
     {
         return ImageBufAlgo::premult(*img[0], *img[1]);
     }
+    virtual bool defer(ImageRec::ExprStep& step)
+    {
+        step = [](ImageBufAlgo::Expr& expr) { expr.premult(); };
+        return true;
+    }
 };
 OP_CUSTOMCLASS(premult, OpPremult, 1);
 
@@ -2645,6 +3003,18 @@ public:
         }
         return ImageBufAlgo::unpremult(*img[0], *img[1]);
     }
+    virtual bool defer(ImageRec::ExprStep& step)
+    {
+        const ImageSpec& spec(*ir[1]->spec());
+        if (spec.get_int_attribute("oiio:UnassociatedAlpha")
+            && spec.alpha_channel >= 0) {
+            ot.warning(
+                opname(),
+                "Image appears to already be unassociated alpha (un-premultiplied color), beware double unpremult.");
+        }
+        step = [](ImageBufAlgo::Expr& expr) { expr.unpremult(); };
+        return true;
+    }
 };
 OP_CUSTOMCLASS(unpremult, OpUnpremult, 1);
 
@@ -2762,7 +3132,7 @@ action_chsum(int argc, const char* argv[])
         R->update_spec_from_imagebuf(s);
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -2839,7 +3209,7 @@ action_reorient(int argc, const char* argv[])
         ot.push(A);
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -2994,12 +3364,29 @@ action_create(int argc, const char* argv[])
     if (ot.curimg)
         ot.image_stack.push_back(ot.curimg);
     ot.curimg = img;
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
 
 
+// Wrap fill, which sets the pixels of dst over roi, as a Generator of
+// (any band of) an image with the given spec.
+static ImageRec::Generator
+band_generator(const ImageSpec& spec, ImageRec::Generator fill)
+{
+    return [spec, fill](ImageBuf& dst, ROI roi) {
+        if (!dst.initialized()) {
+            ImageSpec bandspec = spec;
+            set_roi(bandspec, roi);
+            dst.reset(bandspec);
+        }
+        return fill(dst, roi);
+    };
+}
+
+
+
 static int
 action_pattern(int argc, const char* argv[])
 {
@@ -3022,18 +3409,22 @@ action_pattern(int argc, const char* argv[])
     spec.full_width  = spec.width;
     spec.full_height = spec.height;
     spec.full_depth  = spec.depth;
-    ImageRecRef img(new ImageRec("new", spec, ot.imagecache));
-    ot.push(img);
-    ImageBuf& ib((*img)());
-    bool ok = true;
+
+    // Parse the pattern now, but leave making its pixels to a Generator,
+    // which with --stream is only run a band at a time as it's output.
+    ImageRec::Generator fill;
     if (Strutil::iequals(pattern, "black")) {
-        ok = ImageBufAlgo::zero(ib);
+        fill = [](ImageBuf& dst, ROI roi) {
+            return ImageBufAlgo::zero(dst, roi);
+        };
     } else if (Strutil::istarts_with(pattern, "constant")) {
-        std::vector<float> fill(nchans, 1.0f);
+        std::vector<float> color(nchans, 1.0f);
         std::map<std::string, std::string> options;
         ot.extract_options(options, pattern);
-        Strutil::extract_from_list_string(fill, options["color"]);
-        ok = ImageBufAlgo::fill(ib, &fill[0]);
+        Strutil::extract_from_list_string(color, options["color"]);
+        fill = [color](ImageBuf& dst, ROI roi) {
+            return ImageBufAlgo::fill(dst, &color[0], roi);
+        };
     } else if (Strutil::istarts_with(pattern, "fill")) {
         std::vector<float> topleft(nchans, 1.0f);
         std::vector<float> topright(nchans, 1.0f);
@@ -3041,27 +3432,58 @@ action_pattern(int argc, const char* argv[])
         std::vector<float> bottomright(nchans, 1.0f);
         std::map<std::string, std::string> options;
         ot.extract_options(options, pattern);
+        enum { None, Corners, TopBottom, LeftRight, Color } kind = None;
         if (Strutil::extract_from_list_string(topleft, options["topleft"])
             && Strutil::extract_from_list_string(topright, options["topright"])
             && Strutil::extract_from_list_string(bottomleft,
                                                  options["bottomleft"])
             && Strutil::extract_from_list_string(bottomright,
                                                  options["bottomright"])) {
-            ok = ImageBufAlgo::fill(ib, &topleft[0], &topright[0],
-                                    &bottomleft[0], &bottomright[0]);
+            kind = Corners;
         } else if (Strutil::extract_from_list_string(topleft, options["top"])
                    && Strutil::extract_from_list_string(bottomleft,
                                                         options["bottom"])) {
-            ok = ImageBufAlgo::fill(ib, &topleft[0], &bottomleft[0]);
+            kind = TopBottom;
         } else if (Strutil::extract_from_list_string(topleft, options["left"])
                    && Strutil::extract_from_list_string(topright,
                                                         options["right"])) {
-            ok = ImageBufAlgo::fill(ib, &topleft[0], &topright[0], &topleft[0],
-                                    &topright[0]);
+            kind        = LeftRight;
+            bottomleft  = topleft;
+            bottomright = topright;
         } else if (Strutil::extract_from_list_string(topleft,
                                                      options["color"])) {
-            ok = ImageBufAlgo::fill(ib, &topleft[0]);
+            kind = Color;
         }
+        ROI full = get_roi(spec);
+        fill     = [=](ImageBuf& dst, ROI roi) {
+            // ImageBufAlgo::fill spreads a gradient across the roi it's
+            // given, so for a band of the image, first find the colors at
+            // the band's own top and bottom rows.
+            std::vector<float> tl(topleft), tr(topright);
+            std::vector<float> bl(bottomleft), br(bottomright);
+            if (roi.ybegin != full.ybegin || roi.yend != full.yend) {
+                float h  = std::max(1, full.height() - 1);
+                float v0 = (roi.ybegin - full.ybegin) / h;
+                float v1 = (roi.yend - 1 - full.ybegin) / h;
+                for (int c = 0; c < nchans; ++c) {
+                    tl[c] = lerp(topleft[c], bottomleft[c], v0);
+                    tr[c] = lerp(topright[c], bottomright[c], v0);
+                    bl[c] = lerp(topleft[c], bottomleft[c], v1);
+                    br[c] = lerp(topright[c], bottomright[c], v1);
+                }
+            }
+            switch (kind) {
+            case Corners:
+                return ImageBufAlgo::fill(dst, &tl[0], &tr[0], &bl[0], &br[0],
+                                          roi);
+            case TopBottom: return ImageBufAlgo::fill(dst, &tl[0], &bl[0], roi);
+            case LeftRight:
+                return ImageBufAlgo::fill(dst, &tl[0], &tr[0], &tl[0], &tr[0],
+                                          roi);
+            case Color: return ImageBufAlgo::fill(dst, &tl[0], roi);
+            default: return ImageBufAlgo::zero(dst, roi);
+            }
+        };
     } else if (Strutil::istarts_with(pattern, "checker")) {
         std::map<std::string, std::string> options;
         options["width"]  = "8";
@@ -3075,8 +3497,11 @@ action_pattern(int argc, const char* argv[])
         std::vector<float> color2(nchans, 1.0f);
         Strutil::extract_from_list_string(color1, options["color1"]);
         Strutil::extract_from_list_string(color2, options["color2"]);
-        ok = ImageBufAlgo::checker(ib, width, height, depth, &color1[0],
-                                   &color2[0], 0, 0, 0);
+        fill = [=](ImageBuf& dst, ROI roi) {
+            return ImageBufAlgo::checker(dst, width, height, depth,
+                                         &color1[0], &color2[0], 0, 0, 0,
+                                         roi);
+        };
     } else if (Strutil::istarts_with(pattern, "noise")) {
         std::map<std::string, std::string> options;
         options["type"]    = "gaussian";
@@ -3091,6 +3516,7 @@ action_pattern(int argc, const char* argv[])
         ot.extract_options(options, pattern);
         std::string type = options["type"];
         float A = 0, B = 1;
+        bool ok = true;
         if (type == "gaussian") {
             A = Strutil::from_string<float>(options["mean"]);
             B = Strutil::from_string<float>(options["stddev"]);
@@ -3106,16 +3532,24 @@ action_pattern(int argc, const char* argv[])
         }
         bool mono = Strutil::from_string<int>(options["mono"]);
         int seed  = Strutil::from_string<int>(options["seed"]);
-        ImageBufAlgo::zero(ib);
-        if (ok)
-            ok = ImageBufAlgo::noise(ib, type, A, B, mono, seed);
+        fill      = [=](ImageBuf& dst, ROI roi) {
+            ImageBufAlgo::zero(dst, roi);
+            return !ok
+                   || ImageBufAlgo::noise(dst, type, A, B, mono, seed, roi);
+        };
     } else {
-        ok = ImageBufAlgo::zero(ib);
+        fill = [](ImageBuf& dst, ROI roi) {
+            return ImageBufAlgo::zero(dst, roi);
+        };
         ot.warningf(command, "Unknown pattern \"%s\"", pattern);
     }
-    if (!ok)
-        ot.error(command, ib.geterror());
-    ot.function_times[command] += timer();
+
+    ImageRecRef img(new ImageRec("new", spec, band_generator(spec, fill),
+                                 ot.imagecache));
+    ot.push(img);
+    if (!ot.stream && (*img)().has_error())
+        ot.error(command, (*img)().geterror());
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3159,7 +3593,7 @@ action_capture(int argc, const char* argv[])
     ImageRecRef img(new ImageRec("capture", ib.spec(), ot.imagecache));
     (*img)().copy(ib);
     ot.push(img);
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3215,7 +3649,7 @@ action_crop(int argc, const char* argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3251,7 +3685,7 @@ action_croptofull(int argc, const char* argv[])
             R->update_spec_from_imagebuf(s, 0);
         }
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3300,7 +3734,7 @@ action_trim(int argc, const char* argv[])
             R->update_spec_from_imagebuf(s, 0);
         }
     }
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3335,7 +3769,7 @@ action_cut(int argc, const char* argv[])
 
     ot.push(R);
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3602,7 +4036,7 @@ action_fit(int argc, const char* argv[])
         action_croptofull(1, argv);
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -3693,7 +4127,7 @@ action_pixelaspect(int argc, const char* argv[])
         // Now A,Aspec are for the NEW resized top of stack
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -3887,7 +4321,7 @@ action_fixnan(int argc, const char* argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3913,7 +4347,7 @@ action_fillholes(int argc, const char* argv[])
     if (!ok)
         ot.error(command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -3945,12 +4379,90 @@ action_paste(int argc, const char* argv[])
     bool ok = ImageBufAlgo::paste((*R)(), x, y, 0, 0, (*FG)());
     if (!ok)
         ot.error(command, (*R)().geterror());
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
 
 
+// The cells of a mosaic, from which it is generated a band at a time.
+// A row of cells is prepared (and, if they are to be resized to fit, read
+// and resized, all in parallel) when a band first reaches it, and released
+// when a band no longer needs it, so at most a couple of rows are held.
+struct MosaicCells {
+    std::vector<ImageRecRef> images;  // keeps the inputs alive
+    std::vector<const ImageBuf*> srcs;
+    std::vector<ImageBuf> fitted;  // resized cells, if fitting
+    std::vector<bool> rowready;
+    int ximages = 0, yimages = 0, cellwidth = 0, cellheight = 0, pad = 0;
+    bool fit = false;
+    std::string filtername;
+
+    bool generate(ImageBuf& dst, ROI roi);
+};
+
+
+
+bool
+MosaicCells::generate(ImageBuf& dst, ROI roi)
+{
+    ImageBufAlgo::zero(dst, roi);
+    int rowstep = cellheight + pad;
+    int jbegin  = std::min(roi.ybegin / rowstep, yimages);
+    int jend    = std::min((roi.yend - 1) / rowstep + 1, yimages);
+
+    if (fit) {
+        // Let go of rows this band doesn't touch, and resize the cells of
+        // the rows it does that aren't ready yet.
+        std::vector<int> toprep;
+        for (int j = 0; j < yimages; ++j) {
+            bool needed = (j >= jbegin && j < jend);
+            if (needed && !rowready[j]) {
+                for (int i = 0; i < ximages; ++i)
+                    toprep.push_back(j * ximages + i);
+            } else if (!needed && rowready[j]) {
+                for (int i = 0; i < ximages; ++i)
+                    fitted[j * ximages + i].clear();
+            }
+            rowready[j] = needed;
+        }
+        parallel_for(0, int64_t(toprep.size()), [&](int64_t t) {
+            int k = toprep[t];
+            const ImageBuf& src(*srcs[k]);
+            ImageBufAlgo::fit(fitted[k], src, filtername, 0.0f, false,
+                              ROI(0, cellwidth, 0, cellheight, 0, 1, 0,
+                                  src.nchannels()),
+                              1);
+        });
+        for (int k : toprep)
+            if (fitted[k].has_error()) {
+                dst.errorf("%s", fitted[k].geterror());
+                return false;
+            }
+    }
+
+    // Paste just the part of each cell that falls within the band. The
+    // cells don't overlap, so they can all be pasted at once.
+    int ncells = (jend - jbegin) * ximages;
+    parallel_for(0, int64_t(ncells), [&](int64_t t) {
+        int k = jbegin * ximages + int(t);
+        int i = k % ximages, j = k / ximages;
+        const ImageBuf& src(fit ? fitted[k] : *srcs[k]);
+        ROI srcroi = src.roi();
+        int x = i * (cellwidth + pad), y = j * rowstep;
+        int y0 = std::max(y, roi.ybegin);
+        int y1 = std::min(y + srcroi.height(), roi.yend);
+        if (y0 >= y1)
+            return;
+        srcroi.ybegin += y0 - y;
+        srcroi.yend = srcroi.ybegin + (y1 - y0);
+        ImageBufAlgo::paste(dst, x, y0, 0, 0, src, srcroi, 1);
+    });
+    return !dst.has_error();
+}
+
+
+
 static int
 action_mosaic(int argc, const char* argv[])
 {
@@ -3968,6 +4480,25 @@ action_mosaic(int argc, const char* argv[])
     }
     int nimages = ximages * yimages;
 
+    std::map<std::string, std::string> options;
+    options["pad"] = "0";
+    ot.extract_options(options, command);
+    auto cells        = std::make_shared<MosaicCells>();
+    cells->ximages    = ximages;
+    cells->yimages    = yimages;
+    cells->pad        = Strutil::stoi(options["pad"]);
+    cells->filtername = options["filter"];
+    if (options["fit"].size()) {
+        int x = 0, y = 0;
+        cells->fit = ot.adjust_geometry(command, cells->cellwidth,
+                                        cells->cellheight, x, y,
+                                        options["fit"].c_str());
+        if (!cells->fit || cells->cellwidth < 1 || cells->cellheight < 1) {
+            ot.errorf(command, "Invalid fit size '%s'", options["fit"]);
+            return 0;
+        }
+    }
+
     // Make the matrix complete with placeholder images
     ImageRecRef blank_img;
     while (ot.image_stack_depth() < nimages) {
@@ -3979,41 +4510,48 @@ action_mosaic(int argc, const char* argv[])
         ot.push(blank_img);
     }
 
+    // When streaming, leave the inputs to the ImageCache however small they
+    // are, since there may be very many of them: each is only read as the
+    // bands of the mosaic reach it.
+    ReadPolicy readpolicy = ot.stream ? ReadNoForce : ReadDefault;
     int widest = 0, highest = 0, nchannels = 0;
-    std::vector<ImageRecRef> images(nimages);
+    cells->images.resize(nimages);
+    cells->srcs.resize(nimages);
     for (int i = nimages - 1; i >= 0; --i) {
-        ImageRecRef img = ot.pop();
-        images[i]       = img;
-        ot.read(img);
-        widest    = std::max(widest, img->spec()->full_width);
-        highest   = std::max(highest, img->spec()->full_height);
-        nchannels = std::max(nchannels, img->spec()->nchannels);
-    }
-
-    std::map<std::string, std::string> options;
-    options["pad"] = "0";
-    ot.extract_options(options, command);
-    int pad = Strutil::stoi(options["pad"]);
-
-    ImageSpec Rspec(ximages * widest + (ximages - 1) * pad,
-                    yimages * highest + (yimages - 1) * pad, nchannels,
-                    TypeDesc::FLOAT);
-    ImageRecRef R(new ImageRec("mosaic", Rspec, ot.imagecache));
+        ImageRecRef img  = ot.pop();
+        cells->images[i] = img;
+        ot.read(img, readpolicy);
+        cells->srcs[i] = &(*img)(0);
+        widest         = std::max(widest, img->spec()->full_width);
+        highest        = std::max(highest, img->spec()->full_height);
+        nchannels      = std::max(nchannels, img->spec()->nchannels);
+    }
+    if (cells->fit) {
+        cells->fitted.resize(nimages);
+        cells->rowready.resize(yimages, false);
+    } else {
+        cells->cellwidth  = widest;
+        cells->cellheight = highest;
+    }
+
+    int pad = cells->pad;
+    ImageSpec Rspec(ximages * cells->cellwidth + (ximages - 1) * pad,
+                    yimages * cells->cellheight + (yimages - 1) * pad,
+                    nchannels, TypeDesc::FLOAT);
+    auto generate = [cells](ImageBuf& dst, ROI roi) {
+        return cells->generate(dst, roi);
+    };
+    ImageRecRef R(new ImageRec("mosaic", Rspec,
+                               band_generator(Rspec, generate),
+                               ot.imagecache));
     ot.push(R);
 
-    ImageBufAlgo::zero((*R)());
-    for (int j = 0; j < yimages; ++j) {
-        int y = j * (highest + pad);
-        for (int i = 0; i < ximages; ++i) {
-            int x   = i * (widest + pad);
-            bool ok = ImageBufAlgo::paste((*R)(), x, y, 0, 0,
-                                          (*images[j * ximages + i])(0));
-            if (!ok)
-                ot.error(command, (*R)().geterror());
-        }
-    }
+    // With --stream, the mosaic is only made as it's output, a band at a
+    // time. Otherwise, make it now.
+    if (!ot.stream && (*R)().has_error())
+        ot.error(command, (*R)().geterror());
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -4078,7 +4616,7 @@ action_zover(int argc, const char* argv[])
     bool ok = ImageBufAlgo::zover(Rib, Aib, Bib, z_zeroisinf);
     if (!ok)
         ot.error(command, Rib.geterror());
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 #endif
@@ -4198,7 +4736,7 @@ action_fill(int argc, const char* argv[])
     if (!ok)
         ot.error(command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -4240,7 +4778,7 @@ action_clamp(int argc, const char* argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -4502,7 +5040,7 @@ action_histogram(int argc, const char* argv[])
     if (!ok)
         ot.error(command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.command_done(command, timer());
     return 0;
 }
 
@@ -4540,6 +5078,8 @@ input_file(int argc, const char* argv[])
             ot.process_pending();
             break;
         }
+        // If we're still writing this file, finish it before reading it.
+        ot.finish_outputs(filename);
         Timer timer(ot.enable_function_timing);
         int exists = 1;
         if (ot.input_config_set) {
@@ -4547,6 +5087,7 @@ input_file(int argc, const char* argv[])
             // that information.
             ustring fn(filename);
             ot.imagecache->invalidate(fn);
+            ot.forget_common(filename);
             bool ok = ot.imagecache->add_file(fn, nullptr, &ot.input_config);
             if (!ok) {
                 std::string err = ot.imagecache->geterror();
@@ -4587,7 +5128,7 @@ input_file(int argc, const char* argv[])
         ot.curimg->configspec(ot.input_config);
         ot.curimg->input_dataformat(input_dataformat);
         if (readnow) {
-            ot.curimg->read(ReadNoCache, channel_set);
+            ot.read_shared(*ot.curimg, ReadNoCache, channel_set);
             // If we do not yet have an expected output format, set it based on
             // this image (presumably the first one read.
             if (ot.output_dataformat == TypeDesc::UNKNOWN) {
@@ -4623,7 +5164,7 @@ input_file(int argc, const char* argv[])
                 ot.error("read", error);
             ot.printed_info = true;
         }
-        ot.function_times["input"] += timer();
+        ot.command_done("input", timer());
         if (ot.autoorient) {
             int action_reorient(int argc, const char* argv[]);
             const char* argv[] = { "--reorient" };
@@ -4697,6 +5238,8 @@ prep_texture_config(ImageSpec& configspec,
     configspec.attribute("maketx:constant_color_detect",
                          get_value_override(fileoptions["constant_color_detect"],
                                             0));
+    configspec.attribute("maketx:constant_tiles",
+                         get_value_override(fileoptions["constant_tiles"], 0));
     configspec.attribute("maketx:monochrome_detect",
                          get_value_override(fileoptions["monochrome_detect"],
                                             0));
@@ -4807,6 +5350,10 @@ output_file(int argc, const char* argv[])
         return 0;
     }
 
+    // Finish any earlier outputs first, so at most one is still being
+    // written in the background.
+    ot.finish_outputs();
+
     if (ot.noclobber && Filesystem::exists(filename)) {
         ot.warningf(command, "%s already exists, not overwriting.", filename);
         return 0;
@@ -4977,6 +5524,18 @@ output_file(int argc, const char* argv[])
     // FIXME -- the various automatic transformations above neglect to handle
     // MIPmaps or subimages with full generality.
 
+    // If asked to, the output file gets the time of the input (or its
+    // DateTime metadata).
+    bool adjust_time    = ot.output_adjust_time;
+    std::time_t in_time = 0;
+    if (adjust_time) {
+        std::string metadatatime = ir->spec(0, 0)->get_string_attribute(
+            "DateTime");
+        in_time = ir->time();
+        if (!metadatatime.empty())
+            DateTime_to_time_t(metadatatime.c_str(), in_time);
+    }
+
     bool ok = true;
     if (do_tex || do_latlong || do_bumpslopes) {
         ImageSpec configspec;
@@ -4999,6 +5558,12 @@ output_file(int argc, const char* argv[])
         // N.B. make_texture already internally writes to a temp file and
         // then atomically moves it to the final destination, so we don't
         // need to explicitly do that here.
+        // Make sure to invalidate any IC entries that think they are the
+        // file we just wrote.
+        ot.imagecache->invalidate(ustring(filename));
+        ot.forget_common(filename);
+        if (adjust_time && ok)
+            Filesystem::last_write_time(filename, in_time);
     } else {
         // Non-texture case
         std::vector<ImageSpec> subimagespecs(ir->subimages());
@@ -5031,6 +5596,10 @@ output_file(int argc, const char* argv[])
                                             ".%%%%%%%%.temp" + extension);
         tmpfilename = Filesystem::unique_path(tmpfilename);
 
+        // Write behind: the pixels are queued and written to the file by
+        // another thread, while we go on.
+        out.reset(new AsyncImageOutput(std::move(out)));
+
         // Do the initial open
         ImageOutput::OpenMode mode = ImageOutput::Create;
         if (ir->subimages() > 1 && out->supports("multiimage")) {
@@ -5063,11 +5632,22 @@ output_file(int argc, const char* argv[])
                         break;
                     }
                 }
-                if (!(*ir)(s, m).write(out.get())) {
+                if (ir->deferred()) {
+                    // Compute the pending ops a band at a time, straight
+                    // into the file, so the result (and, if it's cache
+                    // backed, the input) is never held whole in memory.
+                    ImageRec::Generator bands = ir->deferred_bands();
+                    if (!ImageBufAlgo::stream_to_output(out.get(), bands)) {
+                        ot.error(command, OIIO::geterror());
+                        ok = false;
+                        break;
+                    }
+                } else if (!(*ir)(s, m).write(out.get())) {
                     ot.error(command, (*ir)(s, m).geterror());
                     ok = false;
                     break;
                 }
+                ot.bytes_written += out->spec().image_bytes();
                 ot.check_peak_memory();
                 if (mend > 1) {
                     if (out->supports("mipmap")) {
@@ -5091,38 +5671,43 @@ output_file(int argc, const char* argv[])
             }
         }
 
-        if (!out->close()) {
-            ot.error(command, out->geterror());
-            ok = false;
-        }
-        out.reset();  // make extra sure it's cleaned up
-
-        // We wrote to a temporary file, so now atomically move it to the
-        // original desired location.
-        if (ok) {
-            std::string err;
-            ok = Filesystem::rename(tmpfilename, filename, err);
+        // Finishing the file -- waiting for the queued writes, closing it,
+        // and moving it into place -- is put off until the next output,
+        // a read of the same file, or the end, so that it can overlap
+        // with what comes next (such as the next frame of a sequence).
+        std::shared_ptr<ImageOutput> asyncout(std::move(out));
+        std::string cmd(command), finalname(filename);
+        bool wrote_ok = ok;
+        auto finish   = [=]() {
+            bool ok = wrote_ok;
+            if (!asyncout->close()) {
+                ot.error(cmd, asyncout->geterror());
+                ok = false;
+            }
+            // We wrote to a temporary file, so now atomically move it to
+            // the original desired location.
+            if (ok) {
+                std::string err;
+                ok = Filesystem::rename(tmpfilename, finalname, err);
+                if (!ok)
+                    ot.errorf(
+                        cmd,
+                        "oiiotool ERROR: could not move temp file %s to %s: %s",
+                        tmpfilename, finalname, err);
+            }
             if (!ok)
-                ot.errorf(
-                    command,
-                    "oiiotool ERROR: could not move temp file %s to %s: %s",
-                    tmpfilename, filename, err);
-        }
-        if (!ok)
-            Filesystem::remove(tmpfilename);
-    }
-
-    // Make sure to invalidate any IC entries that think they are the
-    // file we just wrote.
-    ot.imagecache->invalidate(ustring(filename));
-
-    if (ot.output_adjust_time && ok) {
-        std::string metadatatime = ir->spec(0, 0)->get_string_attribute(
-            "DateTime");
-        std::time_t in_time = ir->time();
-        if (!metadatatime.empty())
-            DateTime_to_time_t(metadatatime.c_str(), in_time);
-        Filesystem::last_write_time(filename, in_time);
+                Filesystem::remove(tmpfilename);
+            // Make sure to invalidate any IC entries that think they are
+            // the file we just wrote.
+            ot.imagecache->invalidate(ustring(finalname));
+            ot.forget_common(finalname);
+            if (adjust_time && ok)
+                Filesystem::last_write_time(finalname, in_time);
+        };
+        if (ok)
+            ot.unfinished_outputs.push_back({ finalname, finish });
+        else
+            finish();
     }
 
     ot.check_peak_memory();
@@ -5132,14 +5717,15 @@ output_file(int argc, const char* argv[])
     ot.curimg->was_output(true);
     ot.total_writetime.stop();
     double optime = timer();
-    ot.function_times[command] += optime;
+    ot.command_done(command, optime);
     ot.num_outputs += 1;
 
     if (ot.debug)
-        Strutil::printf("    output took %s  (total time %s, mem %s)\n",
-                        Strutil::timeintervalformat(optime, 2),
-                        Strutil::timeintervalformat(ot.total_runtime(), 2),
-                        Strutil::memformat(Sysutil::memory_used()));
+        std::cout << Strutil::sprintf(
+            "    output took %s  (total time %s, mem %s)\n",
+            Strutil::timeintervalformat(optime, 2),
+            Strutil::timeintervalformat(ot.total_runtime(), 2),
+            Strutil::memformat(Sysutil::memory_used()));
     return 0;
 }
 
@@ -5403,6 +5989,18 @@ print_help(ArgParse& ap)
 
 
 
+// Exit with the given status, or if errors are thrown, end just the
+// frame or served command line that's running.
+static void
+exit_or_throw(int status)
+{
+    if (ot.throw_errors)
+        throw Oiiotool::FrameError{ status };
+    exit(status);
+}
+
+
+
 static void
 getargs(int argc, char* argv[])
 {
@@ -5428,6 +6026,8 @@ getargs(int argc, char* argv[])
                 "-a", &ot.allsubimages, "Do operations on all subimages/miplevels",
                 "--debug", &ot.debug, "Debug mode",
                 "--runstats", &ot.runstats, "Print runtime statistics",
+                "--runstats-json %@ %s", set_runstats_output, NULL, "Write statistics of each command to this JSON file",
+                "--runstats-trace %@ %s", set_runstats_output, NULL, "Write a timeline of the commands to this file (Chrome trace format)",
                 "--info %@", set_printinfo, NULL, "Print resolution and basic info on all inputs, detailed metadata if -v is also used (options: format=xml:verbose=1)",
                 "--echo %@ %s", do_echo, NULL, "Echo message to console (options: newline=0)",
                 "--metamatch %s", &ot.printinfo_metamatch,
@@ -5446,6 +6046,10 @@ getargs(int argc, char* argv[])
                 "--noclobber", &ot.noclobber, "", // synonym
                 "--threads %@ %d", set_threads, NULL, "Number of threads (default 0 == #cores)",
                 "--frames %s", NULL, "Frame range for '#' or printf-style wildcards",
+                "--parallel-frames %d", NULL, "Run up to this many frames of a sequence at once (default: 1)",
+                "--prefetch-frames %d", NULL, "Read ahead the inputs of this many upcoming frames of a sequence (default: 1)",
+                "--serve %s", NULL, "As the only argument: run the command lines sent by --client to this socket, in one warm process",
+                "--client %s", NULL, "As the first argument: have the --serve process at this socket run the rest of the command line",
                 "--framepadding %d", &ot.frame_padding, "Frame number padding digits (ignored when using printf-style wildcards)",
                 "--views %s", NULL, "Views for %V/%v wildcards (comma-separated, defaults to left,right)",
                 "--wildcardoff", NULL, "Disable numeric wildcard expansion for subsequent command line arguments",
@@ -5459,6 +6063,7 @@ getargs(int argc, char* argv[])
                 "--native %@", set_native, &ot.nativeread, "Keep native pixel data type (bypass cache if necessary)",
                 "--cache %@ %d", set_cachesize, &ot.cachesize, "ImageCache size (in MB: default=4096)",
                 "--autotile %@ %d", set_autotile, &ot.autotile, "Autotile size for cached images (default=4096)",
+                "--stream", &ot.stream, "Defer pointwise ops, --pattern and --mosaic, and stream their results to output a band at a time",
                 "<SEPARATOR>", "Commands that read images:",
                 "-i %@ %s", input_file, NULL, "Input file (argument: filename) (options: now=, printinfo=, autocc=, type=, ch=)",
                 "--iconfig %@ %s %s", set_input_attribute, NULL, NULL, "Sets input config attribute (name, value) (options: type=...)",
@@ -5555,7 +6160,7 @@ getargs(int argc, char* argv[])
                 "--cut %@ %s", action_cut, NULL, "Cut out the ROI and reposition to the origin (WxH+X+Y or xmin,ymin,xmax,ymax)",
                 "--paste %@ %s", action_paste, NULL, "Paste fg over bg at the given position (e.g., +100+50)",
                 "--mosaic %@ %s", action_mosaic, NULL,
-                        "Assemble images into a mosaic (arg: WxH; options: pad=0)",
+                        "Assemble images into a mosaic (arg: WxH; options: pad=0, fit=WxH, filter=)",
                 "--over %@", action_over, NULL, "'Over' composite of two images",
                 "--zover %@", action_zover, NULL, "Depth composite two images with Z channels (options: zeroisinf=%d)",
                 "--deepmerge %@", action_deepmerge, NULL, "Merge/composite two deep images",
@@ -5671,21 +6276,234 @@ getargs(int argc, char* argv[])
         // Repeat the command line, so if oiiotool is being called from a
         // script, it's easy to debug how the command was mangled.
         std::cerr << "\nFull command line was:\n> " << ot.full_command_line << "\n";
-        exit (EXIT_FAILURE);
+        exit_or_throw (EXIT_FAILURE);
     }
     if (help) {
         print_help (ap);
-        exit (EXIT_SUCCESS);
+        exit_or_throw (EXIT_SUCCESS);
     }
     if (argc <= 1) {
         ap.briefusage ();
         std::cout << "\nFor detailed help: oiiotool --help\n";
-        exit (EXIT_SUCCESS);
+        exit_or_throw (EXIT_SUCCESS);
+    }
+}
+
+
+
+// What the thread running one frame of --parallel-frames writes to
+// std::cout and std::cerr, kept until it can be printed in frame order.
+struct FrameOutput {
+    std::string out, err;
+};
+static thread_local FrameOutput* frame_output = nullptr;
+
+// While frames run in parallel, std::cout and std::cerr write through
+// this, which keeps what a frame's thread writes in that frame's
+// FrameOutput and passes anything else straight through.
+class FrameCaptureBuf : public std::streambuf {
+public:
+    FrameCaptureBuf(std::streambuf* passthrough, bool err)
+        : m_passthrough(passthrough)
+        , m_err(err)
+    {
+    }
+
+protected:
+    int overflow(int c) override
+    {
+        if (c == traits_type::eof())
+            return traits_type::not_eof(c);
+        if (!frame_output)
+            return m_passthrough->sputc(char(c));
+        (m_err ? frame_output->err : frame_output->out).push_back(char(c));
+        return c;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        if (!frame_output)
+            return m_passthrough->sputn(s, n);
+        (m_err ? frame_output->err : frame_output->out).append(s, size_t(n));
+        return n;
+    }
+    int sync() override { return frame_output ? 0 : m_passthrough->pubsync(); }
+
+private:
+    std::streambuf* m_passthrough;
+    bool m_err;
+};
+
+
+
+// Run the nframes frames of a sequence (run_frame(i, argv) running the
+// i-th) on nworkers threads at once. Each thread has its own oiiotool
+// state, but all share the ImageCache and the thread pool that the
+// image operations of every frame use. Console output of each frame is
+// printed whole, in frame order. The first frame (in frame order) that
+// fails ends the run, as it would have running the frames one by one,
+// except that later frames already started are finished first.
+static void
+run_parallel_frames(size_t nworkers, size_t nframes, int argc,
+                    const char** argv,
+                    const std::function<void(size_t i,
+                                             std::vector<const char*>& argv)>&
+                        run_frame)
+{
+    Oiiotool& main_ot(ot);
+    std::vector<FrameOutput> outputs(nframes);
+    std::vector<char> done(nframes, 0), failed(nframes, 0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> next_frame(0);
+    std::atomic<bool> stop(false);
+    size_t running = nworkers;
+
+    auto worker = [&]() {
+        ot.imagecache   = main_ot.imagecache;
+        ot.throw_errors = true;
+        std::vector<const char*> seq_argv(argv, argv + argc + 1);
+        size_t i;
+        while (!stop && (i = next_frame++) < nframes) {
+            frame_output = &outputs[i];
+            bool ok      = true;
+            try {
+                run_frame(i, seq_argv);
+                ot.finish_outputs();  // before the frame counts as done
+            } catch (const Oiiotool::FrameError&) {
+                ok = false;
+                ot.curimg.reset();
+                ot.image_stack.clear();
+                ot.clear_common();
+            }
+            frame_output = nullptr;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& t : ot.function_times)
+                main_ot.function_times[t.first] += t.second;
+            ot.function_times.clear();
+            main_ot.num_outputs += ot.num_outputs;
+            ot.num_outputs = 0;
+            main_ot.command_stats.insert(main_ot.command_stats.end(),
+                                         ot.command_stats.begin(),
+                                         ot.command_stats.end());
+            ot.command_stats.clear();
+            main_ot.runstats_json  = ot.runstats_json;
+            main_ot.runstats_trace = ot.runstats_trace;
+            main_ot.printed_info |= ot.printed_info;
+            main_ot.peak_memory = std::max(main_ot.peak_memory,
+                                           ot.peak_memory);
+            if (ot.return_value != EXIT_SUCCESS)
+                main_ot.return_value = ot.return_value;
+            done[i]   = 1;
+            failed[i] = !ok;
+            if (!ok)
+                stop = true;
+            cv.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        --running;
+        cv.notify_all();
+    };
+
+    std::cout.flush();
+    std::streambuf* coutbuf = std::cout.rdbuf();
+    std::streambuf* cerrbuf = std::cerr.rdbuf();
+    FrameCaptureBuf capture_out(coutbuf, false), capture_err(cerrbuf, true);
+    std::cout.rdbuf(&capture_out);
+    std::cerr.rdbuf(&capture_err);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nworkers; ++t)
+        threads.emplace_back(worker);
+
+    // Print each frame's output as soon as it and all frames before it
+    // are done, up to the first that failed.
+    bool ok = true;
+    for (size_t i = 0; i < nframes && ok; ++i) {
+        FrameOutput output;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return done[i] || !running; });
+            if (!done[i])
+                break;  // never started, after a failed frame
+            std::swap(output, outputs[i]);
+            ok = !failed[i];
+        }
+        std::cout << output.out << std::flush;
+        std::cerr << output.err << std::flush;
+    }
+    for (auto& t : threads)
+        t.join();
+    std::cout.rdbuf(coutbuf);
+    std::cerr.rdbuf(cerrbuf);
+    if (!ok) {
+        main_ot.finish_outputs();
+        exit_or_throw(-1);
     }
 }
 
 
 
+// Reads ahead, on a background thread, the input files of frames of a
+// sequence that are yet to run, so that waiting on storage (perhaps slow
+// network storage) overlaps with the work of the current frame. Files
+// small enough that ImageRec::read will read them whole, bypassing the
+// cache, are read into the OS's file cache. Larger ones have their tiles
+// prefetched into the ImageCache.
+class FramePrefetcher {
+public:
+    FramePrefetcher(ImageCache* imagecache)
+        : m_imagecache(imagecache)
+    {
+    }
+    ~FramePrefetcher() { wait(); }
+
+    // Start reading files, once any earlier batch is done.
+    void start(std::vector<std::string>&& files)
+    {
+        wait();
+        if (files.size())
+            m_thread = std::thread(prefetch, m_imagecache, std::move(files));
+    }
+
+    void wait()
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+private:
+    ImageCache* m_imagecache;
+    std::thread m_thread;
+
+    static void prefetch(ImageCache* imagecache,
+                         std::vector<std::string> files)
+    {
+        const size_t chunksize = 1 << 20;
+        std::unique_ptr<char[]> chunk;
+        for (auto& f : files) {
+            ustring uname(f);
+            const ImageSpec* spec = imagecache->imagespec(uname);
+            if (!spec) {
+                imagecache->geterror();  // the frame itself will report it
+                continue;
+            }
+            if (spec->image_bytes() < 50 * 1024 * 1024) {
+                FILE* file = Filesystem::fopen(f, "rb");
+                if (!file)
+                    continue;
+                if (!chunk)
+                    chunk.reset(new char[chunksize]);
+                while (fread(chunk.get(), 1, chunksize, file) == chunksize)
+                    ;
+                fclose(file);
+            } else if (!imagecache->prefetch_tiles(uname, 0, 0)) {
+                imagecache->geterror();
+            }
+        }
+    }
+};
+
+
+
 // Check if any of the command line arguments contains numeric ranges or
 // wildcards.  If not, just return 'false'.  But if they do, the
 // remainder of processing will happen here (and return 'true').
@@ -5711,7 +6529,9 @@ handle_sequence(int argc, const char** argv)
     std::vector<string_view> views;
     Strutil::split(default_views, views, ",");
 
-    int framepadding = 0;
+    int framepadding    = 0;
+    int parallel_frames = 1;
+    int prefetch_frames = 1;
     std::vector<int> sequence_args;  // Args with sequence numbers
     std::vector<bool> sequence_is_output;
     bool is_sequence = false;
@@ -5742,6 +6562,14 @@ handle_sequence(int argc, const char** argv)
             int f = atoi(argv[++a]);
             if (f >= 1 && f < 10)
                 framepadding = f;
+        } else if ((strarg == "--parallel-frames"
+                    || strarg == "-parallel-frames")
+                   && a < argc - 1) {
+            parallel_frames = std::max(1, atoi(argv[++a]));
+        } else if ((strarg == "--prefetch-frames"
+                    || strarg == "-prefetch-frames")
+                   && a < argc - 1) {
+            prefetch_frames = std::max(0, atoi(argv[++a]));
         } else if ((strarg == "--views" || strarg == "-views")
                    && a < argc - 1) {
             Strutil::split(argv[++a], views, ",");
@@ -5838,8 +6666,7 @@ handle_sequence(int argc, const char** argv)
     // substituting the i-th sequence entry for its respective argument
     // every time.
     // Note: nfilenames really means, number of frame number iterations.
-    std::vector<const char*> seq_argv(argv, argv + argc + 1);
-    for (size_t i = 0; i < nfilenames; ++i) {
+    auto run_frame = [&](size_t i, std::vector<const char*>& seq_argv) {
         if (ot.debug)
             std::cout << "SEQUENCE " << i << "\n";
         for (size_t a : sequence_args) {
@@ -5858,6 +6685,7 @@ handle_sequence(int argc, const char** argv)
         // Clear the stack at the end of each iteration
         ot.curimg.reset();
         ot.image_stack.clear();
+        ot.clear_common();
 
         if (ot.runstats)
             std::cout << "End iteration " << i << ": "
@@ -5866,13 +6694,352 @@ handle_sequence(int argc, const char** argv)
                       << "\n";
         if (ot.debug)
             std::cout << "\n";
+    };
+
+    if (parallel_frames > 1 && nfilenames > 1) {
+        run_parallel_frames(std::min(size_t(parallel_frames), nfilenames),
+                            nfilenames, argc, argv, run_frame);
+        return true;
+    }
+
+    // While each frame runs, read ahead the inputs of the next few. The
+    // sequence arguments that aren't outputs and name existing files are
+    // the inputs.
+    FramePrefetcher prefetcher(ot.imagecache);
+    size_t prefetched = 1;  // frames before this need no more prefetching
+    std::vector<const char*> seq_argv(argv, argv + argc + 1);
+    for (size_t i = 0; i < nfilenames; ++i) {
+        size_t lookahead = std::min(nfilenames, i + 1 + prefetch_frames);
+        std::vector<std::string> files;
+        for (; prefetched < lookahead; ++prefetched) {
+            for (size_t k = 0; k < sequence_args.size(); ++k) {
+                const std::string& f(filenames[sequence_args[k]][prefetched]);
+                if (!sequence_is_output[k] && Filesystem::is_regular(f))
+                    files.push_back(f);
+            }
+        }
+        if (files.size())
+            prefetcher.start(std::move(files));
+        run_frame(i, seq_argv);
+    }
+
+    return true;
+}
+
+
+
+// Run one whole oiiotool command line, returning its exit status.
+static int
+run_command_line(int argc, char* argv[])
+{
+    if (handle_sequence(argc, (const char**)argv)) {
+        // Deal with sequence
+
+    } else {
+        // Not a sequence
+        getargs(argc, argv);
+        ot.process_pending();
+        if (ot.pending_callback())
+            ot.warning(ot.pending_callback_name(), "pending command never executed");
+    }
+    ot.finish_outputs();
+    ot.close_command_stats("(finish outputs)");
+
+    if (!ot.printinfo && !ot.printstats && !ot.dumpdata && !ot.dryrun
+        && !ot.printed_info) {
+        if (ot.curimg && !ot.curimg->was_output()
+            && (ot.curimg->metadata_modified() || ot.curimg->pixels_modified()))
+            ot.warning("",
+                "modified images without outputting them. Did you forget -o?");
+        else if (ot.num_outputs == 0)
+            ot.warning("", "oiiotool produced no output. Did you forget -o?");
+    }
+
+    if (ot.runstats) {
+        double total_time  = ot.total_runtime();
+        double unaccounted = total_time;
+        std::cout << "\n";
+        int threads = -1;
+        OIIO::getattribute("threads", threads);
+        std::cout << "Threads: " << threads << "\n";
+        std::cout << "oiiotool runtime statistics:\n";
+        std::cout << "  Total time: "
+                  << Strutil::timeintervalformat(total_time, 2) << "\n";
+        static const char* timeformat = "      %-12s : %5.2f\n";
+        for (Oiiotool::TimingMap::const_iterator func
+             = ot.function_times.begin();
+             func != ot.function_times.end(); ++func) {
+            double t = func->second;
+            std::cout << Strutil::sprintf(timeformat, func->first, t);
+            unaccounted -= t;
+        }
+        std::cout << Strutil::sprintf(timeformat, "unaccounted",
+                                      std::max(unaccounted, 0.0));
+        ot.check_peak_memory();
+        std::cout << "  Peak memory:    " << Strutil::memformat(ot.peak_memory)
+                  << "\n";
+        std::cout << "  Current memory: "
+                  << Strutil::memformat(Sysutil::memory_used()) << "\n";
+        std::cout << "\n" << ot.imagecache->getstats(2) << "\n";
     }
+    ot.write_command_stats();
+
+    return ot.return_value;
+}
+
+
+
+#ifndef _WIN32
 
+// Write all of len bytes to the socket fd, or return false.
+static bool
+write_all(int fd, const char* data, size_t len)
+{
+    while (len) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= size_t(n);
+    }
     return true;
 }
 
 
 
+// Read from fd, appending to buf, until it holds at least len bytes.
+static bool
+read_until(int fd, std::string& buf, size_t len)
+{
+    char block[65536];
+    while (buf.size() < len) {
+        ssize_t n = ::read(fd, block, sizeof(block));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf.append(block, size_t(n));
+    }
+    return true;
+}
+
+
+
+// Read a message from fd: a line holding the number of strings, then the
+// strings, each terminated by a NUL.
+static bool
+read_strings(int fd, std::vector<std::string>& strings)
+{
+    std::string buf;
+    size_t eol;
+    while ((eol = buf.find('\n')) == std::string::npos)
+        if (!read_until(fd, buf, buf.size() + 1))
+            return false;
+    size_t count = size_t(Strutil::from_string<int>(buf.substr(0, eol)));
+    size_t pos   = eol + 1;
+    strings.clear();
+    while (strings.size() < count) {
+        size_t end;
+        while ((end = buf.find('\0', pos)) == std::string::npos)
+            if (!read_until(fd, buf, buf.size() + 1))
+                return false;
+        strings.emplace_back(buf, pos, end - pos);
+        pos = end + 1;
+    }
+    return true;
+}
+
+
+
+static bool
+write_strings(int fd, const std::vector<std::string>& strings)
+{
+    std::string msg = Strutil::sprintf("%d\n", strings.size());
+    for (auto& str : strings) {
+        msg += str;
+        msg += '\0';
+    }
+    return write_all(fd, msg.data(), msg.size());
+}
+
+
+
+static int
+unix_socket(const std::string& path, sockaddr_un& addr)
+{
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "oiiotool ERROR: socket path too long: " << path << "\n";
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        std::cerr << "oiiotool ERROR: could not create socket: "
+                  << strerror(errno) << "\n";
+    return fd;
+}
+
+
+
+// oiiotool --serve socketpath: listen on a Unix domain socket and run the
+// command lines that clients (oiiotool --client) send, one at a time,
+// all in this one process. Plugins, the OCIO configuration and its color
+// processors, and the ImageCache stay loaded and warm between them. Each
+// request is the client's working directory followed by its command
+// line; the reply is the exit status, then what it wrote to stdout and
+// to stderr.
+static int
+serve(const std::string& socketpath)
+{
+    sockaddr_un addr;
+    int fd = unix_socket(socketpath, addr);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    ::unlink(socketpath.c_str());  // a stale socket from an earlier server
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0
+        || ::listen(fd, SOMAXCONN) < 0) {
+        std::cerr << "oiiotool ERROR: could not listen on " << socketpath
+                  << ": " << strerror(errno) << "\n";
+        ::close(fd);
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);  // a client that goes away isn't fatal
+    std::cout << "oiiotool: serving on " << socketpath << std::endl;
+
+    ot.throw_errors        = true;
+    std::string configname = ot.colorconfig.configname();
+    std::cout.flush();
+    std::streambuf* coutbuf = std::cout.rdbuf();
+    std::streambuf* cerrbuf = std::cerr.rdbuf();
+    FrameCaptureBuf capture_out(coutbuf, false), capture_err(cerrbuf, true);
+    std::cout.rdbuf(&capture_out);
+    std::cerr.rdbuf(&capture_err);
+    for (;;) {
+        int conn = ::accept(fd, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        std::vector<std::string> request;
+        if (!read_strings(conn, request) || request.size() < 2) {
+            ::close(conn);
+            continue;
+        }
+
+        // Start each command line as a fresh oiiotool would, except for
+        // what's worth keeping warm. Files changed since they were cached
+        // are invalidated.
+        ot.clear_options();
+        ot.curimg.reset();
+        ot.image_stack.clear();
+        ot.image_labels.clear();
+        ot.clear_common();
+        ot.function_times.clear();
+        ot.peak_memory  = 0;
+        ot.return_value = EXIT_SUCCESS;
+        ot.num_outputs  = 0;
+        ot.printed_info = false;
+        ot.total_runtime.reset();
+        ot.total_runtime.start();
+        ot.stop_command_stats();
+        ot.bytes_written = 0;
+        if (ot.colorconfig.configname() != configname)
+            ot.colorconfig.reset();
+        ot.imagecache->invalidate_all();
+
+        FrameOutput output;
+        frame_output = &output;
+        int status   = EXIT_SUCCESS;
+        if (::chdir(request[0].c_str()) < 0) {
+            std::cerr << "oiiotool ERROR: could not change to directory "
+                      << request[0] << "\n";
+            status = EXIT_FAILURE;
+        } else {
+            std::vector<char*> argv;
+            for (size_t i = 1; i < request.size(); ++i)
+                argv.push_back(&request[i][0]);
+            argv.push_back(nullptr);
+            try {
+                status = run_command_line(int(argv.size()) - 1, &argv[0]);
+            } catch (const Oiiotool::FrameError& e) {
+                status = e.status;
+                ot.curimg.reset();
+                ot.image_stack.clear();
+            }
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        frame_output = nullptr;
+        write_strings(conn, { Strutil::sprintf("%d", status), output.out,
+                              output.err });
+        ::close(conn);
+    }
+    std::cout.rdbuf(coutbuf);
+    std::cerr.rdbuf(cerrbuf);
+    ::close(fd);
+    return EXIT_FAILURE;
+}
+
+
+
+// oiiotool --client socketpath args...: have the oiiotool --serve at
+// socketpath run the command line "oiiotool args..." in our working
+// directory, and pass on its output and exit status.
+static int
+serve_client(const std::string& socketpath, int argc, const char** argv)
+{
+    sockaddr_un addr;
+    int fd = unix_socket(socketpath, addr);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "oiiotool ERROR: could not connect to " << socketpath
+                  << ": " << strerror(errno) << "\n";
+        ::close(fd);
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> request { Filesystem::current_path(),
+                                       "oiiotool" };
+    request.insert(request.end(), argv, argv + argc);
+    std::vector<std::string> reply;
+    if (!write_strings(fd, request) || !read_strings(fd, reply)
+        || reply.size() != 3) {
+        std::cerr << "oiiotool ERROR: lost connection to " << socketpath
+                  << "\n";
+        ::close(fd);
+        return EXIT_FAILURE;
+    }
+    ::close(fd);
+    std::cout << reply[1] << std::flush;
+    std::cerr << reply[2] << std::flush;
+    return Strutil::from_string<int>(reply[0]);
+}
+
+#else
+
+static int
+serve(const std::string& socketpath)
+{
+    std::cerr << "oiiotool ERROR: --serve is not supported on this platform\n";
+    return EXIT_FAILURE;
+}
+
+static int
+serve_client(const std::string& socketpath, int argc, const char** argv)
+{
+    std::cerr << "oiiotool ERROR: --client is not supported on this platform\n";
+    return EXIT_FAILURE;
+}
+
+#endif
+
+
+
 int
 main(int argc, char* argv[])
 {
@@ -5925,54 +7092,9 @@ main(int argc, char* argv[])
     ot.imagecache->attribute("autoscanline", int(ot.autotile ? 1 : 0));
 
     Filesystem::convert_native_arguments(argc, (const char**)argv);
-    if (handle_sequence(argc, (const char**)argv)) {
-        // Deal with sequence
-
-    } else {
-        // Not a sequence
-        getargs(argc, argv);
-        ot.process_pending();
-        if (ot.pending_callback())
-            ot.warning(ot.pending_callback_name(), "pending command never executed");
-    }
-
-    if (!ot.printinfo && !ot.printstats && !ot.dumpdata && !ot.dryrun
-        && !ot.printed_info) {
-        if (ot.curimg && !ot.curimg->was_output()
-            && (ot.curimg->metadata_modified() || ot.curimg->pixels_modified()))
-            ot.warning("",
-                "modified images without outputting them. Did you forget -o?");
-        else if (ot.num_outputs == 0)
-            ot.warning("", "oiiotool produced no output. Did you forget -o?");
-    }
-
-    if (ot.runstats) {
-        double total_time  = ot.total_runtime();
-        double unaccounted = total_time;
-        std::cout << "\n";
-        int threads = -1;
-        OIIO::getattribute("threads", threads);
-        std::cout << "Threads: " << threads << "\n";
-        std::cout << "oiiotool runtime statistics:\n";
-        std::cout << "  Total time: "
-                  << Strutil::timeintervalformat(total_time, 2) << "\n";
-        static const char* timeformat = "      %-12s : %5.2f\n";
-        for (Oiiotool::TimingMap::const_iterator func
-             = ot.function_times.begin();
-             func != ot.function_times.end(); ++func) {
-            double t = func->second;
-            Strutil::printf(timeformat, func->first, t);
-            unaccounted -= t;
-        }
-        Strutil::printf(timeformat, "unaccounted",
-                                     std::max(unaccounted, 0.0));
-        ot.check_peak_memory();
-        std::cout << "  Peak memory:    " << Strutil::memformat(ot.peak_memory)
-                  << "\n";
-        std::cout << "  Current memory: "
-                  << Strutil::memformat(Sysutil::memory_used()) << "\n";
-        std::cout << "\n" << ot.imagecache->getstats(2) << "\n";
-    }
-
-    return ot.return_value;
+    if (argc >= 3 && !strcmp(argv[1], "--serve"))
+        return serve(argv[2]);
+    if (argc >= 3 && !strcmp(argv[1], "--client"))
+        return serve_client(argv[2], argc - 3, (const char**)argv + 3);
+    return run_command_line(argc, argv);
 }
@@ -31,9 +31,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/timer.h>
 
@@ -58,6 +60,9 @@ enum ReadPolicy {
                             //<   but still subject to format conversion.
     ReadNativeNoCache = 3,  //< No cache, no conversion. Do it all now.
                             //<   You better know what you're doing.
+    ReadNoForce = 4,        //< Never bypass the cache just because the
+                            //<   image is "small" -- for when many images
+                            //<   are needed only a piece at a time.
 };
 
 
@@ -81,6 +86,7 @@ public:
     bool autocc;       // automatically color correct
     bool autopremult;  // auto premult unassociated alpha input
     bool nativeread;   // force native data type reads
+    bool stream;       // defer pointwise ops and stream them to output
     bool printinfo_verbose;
     int cachesize;
     int autotile;
@@ -135,10 +141,46 @@ public:
     bool enable_function_timing = true;
     bool input_config_set       = false;
     bool printed_info           = false;  // printed info at some point
+    // Errors throw FrameError rather than exiting, so that a frame run on
+    // one thread of --parallel-frames, or a command line run by --serve,
+    // can fail without ending the process. It carries the exit status.
+    bool throw_errors = false;
+    struct FrameError {
+        int status;
+    };
     // Remember the first input dataformats we encountered
     TypeDesc first_input_dataformat;
     int first_input_dataformat_bits = 0;
     std::map<std::string, std::string> first_input_channelformats;
+    // Outputs whose pixels may still be being written in the background,
+    // and the function to call to finish each (close it, move it into
+    // place, etc.).
+    struct UnfinishedOutput {
+        std::string filename;
+        std::function<void()> finish;
+    };
+    mutable std::vector<UnfinishedOutput> unfinished_outputs;
+    // Statistics of each command, for --runstats-json/--runstats-trace.
+    // Each covers everything from the end of the command before it.
+    struct CommandStats {
+        std::string command;
+        int frame               = 0;
+        int thread              = 0;    // which thread (--parallel-frames)
+        double start            = 0.0;  // seconds since oiiotool started
+        double wall             = 0.0;
+        double cpu              = 0.0;  // of the whole process
+        long long bytes_read    = 0;    // by the ImageCache
+        long long bytes_written = 0;    // pixel bytes output
+        long long cache_misses  = 0;
+        size_t memory           = 0;  // resident size at the end
+        size_t peak_memory      = 0;  // highest seen during, less at start
+        // Time (and calls) per LoggedTimer, e.g. "IBA::resize"
+        std::map<std::string, std::pair<int, double>> functions;
+    };
+    std::vector<CommandStats> command_stats;
+    std::string runstats_json;    // file for --runstats-json
+    std::string runstats_trace;   // file for --runstats-trace
+    long long bytes_written = 0;  // pixel bytes output so far
 
     Oiiotool();
 
@@ -157,6 +199,23 @@ public:
         return true;
     }
 
+    // Read img, unless the same file was already read the same way during
+    // this command line, in which case img just shares that read's pixels
+    // (copy-on-write) rather than reading them again.
+    bool read_shared(ImageRec& img, ReadPolicy readpolicy,
+                     string_view channel_set = "");
+
+    // Common-subexpression cache: images read so far, and the results of
+    // pure commands on them, keyed by a description of how they were
+    // computed (see ImageRec::provenance()). The cached ImageRecs are kept
+    // pristine; users get copy-on-write shares of them.
+    ImageRecRef find_common(const std::string& key) const;
+    void remember_common(const std::string& key, const ImageRec& img);
+    // Forget everything computed from the named file (it is being
+    // rewritten or reconfigured).
+    void forget_common(string_view filename);
+    void clear_common() { m_common_images.clear(); }
+
     // If required_images are not yet on the stack, then postpone this
     // call by putting it on the 'pending' list and return true.
     // Otherwise (if enough images are on the stack), return false.
@@ -229,6 +288,10 @@ public:
     int extract_options(std::map<std::string, std::string>& options,
                         std::string command);
 
+    // Finish the unfinished outputs -- all of them, or only those writing
+    // the named file.
+    void finish_outputs(string_view filename = string_view()) const;
+
     // Error base case -- single unformatted string.
     void error(string_view command, string_view message = "") const;
     void warning(string_view command, string_view message = "") const;
@@ -251,13 +314,37 @@ public:
     {
         size_t mem  = Sysutil::memory_used();
         peak_memory = std::max(peak_memory, mem);
+        m_command_peak_memory = std::max(m_command_peak_memory, mem);
         return mem;
     }
 
+    // Account the time a command took, for --runstats, and if per-command
+    // statistics are being kept, close its entry.
+    void command_done(string_view command, double time);
+
+    // Start keeping per-command statistics (if not already), or stop and
+    // discard them.
+    void start_command_stats();
+    void stop_command_stats();
+    bool keeping_command_stats() const { return m_command_stats_on; }
+
+    // Close an entry of the per-command statistics for whatever has run
+    // since the last one, under the given name.
+    void close_command_stats(string_view command);
+
+    // Write the per-command statistics to the --runstats-json and
+    // --runstats-trace files.
+    void write_command_stats() const;
+
 private:
     CallbackFunction m_pending_callback;
     int m_pending_argc;
     const char* m_pending_argv[4];
+    // Counters at the end of the last per-command statistics entry
+    bool m_command_stats_on = false;
+    CommandStats m_command_stats_prev;
+    size_t m_command_peak_memory = 0;
+    std::map<std::string, ImageRecRef> m_common_images;
 
     void express_error(const string_view expr, const string_view s,
                        string_view explanation);
@@ -354,6 +441,26 @@ public:
     ImageRec(const std::string& name, const ImageSpec& spec,
              ImageCache* imagecache);
 
+    // A pointwise step of a deferred image: records itself on an Expr.
+    typedef std::function<void(ImageBufAlgo::Expr&)> ExprStep;
+
+    // Initialize a deferred ImageRec: the single image that results from
+    // applying step to src (itself possibly deferred). Its pixels are not
+    // computed until they are first accessed, or until the whole chain of
+    // steps is streamed to an output file by stream_to_output().
+    ImageRec(const std::string& name, ImageRecRef src, ExprStep step);
+
+    // Fills dst over roi (allocating dst to cover roi if it is not yet
+    // initialized), returning false and leaving an error in dst if it
+    // can't. The region may be any band of whole rows of the image.
+    typedef std::function<bool(ImageBuf& dst, ROI roi)> Generator;
+
+    // Initialize a deferred ImageRec with the given spec, whose pixels are
+    // made by generator -- all at once when they are first accessed, or a
+    // band at a time as the image is streamed to an output file.
+    ImageRec(const std::string& name, const ImageSpec& spec,
+             Generator generator, ImageCache* imagecache);
+
     ImageRec(const ImageRec& copy) = delete;  // Disallow copy ctr
 
     enum WinMerge { WinMergeUnion, WinMergeIntersection, WinMergeA, WinMergeB };
@@ -399,15 +506,35 @@ public:
     // ir(subimg,mip) references a specific MIP level of a subimage
     // ir(subimg) references the first MIP level of a subimage
     // ir() references the first MIP level of the first subimage
+    // (If the ImageRec is deferred, this computes its pixels first.)
     ImageBuf& operator()(int subimg = 0, int mip = 0)
     {
+        if (deferred())
+            materialize();
         return *m_subimages[subimg][mip];
     }
     const ImageBuf& operator()(int subimg = 0, int mip = 0) const
     {
+        if (deferred())
+            materialize();
         return *m_subimages[subimg][mip];
     }
 
+    // Is this a deferred image whose pixels have not yet been computed?
+    bool deferred() const
+    {
+        return m_deferred_src != nullptr || m_generator != nullptr;
+    }
+
+    // For a deferred image, the Expr that computes it from its source.
+    // It refers to the source's pixels, so this ImageRec must outlive it.
+    ImageBufAlgo::Expr deferred_expr() const;
+
+    // For a deferred image, a Generator that computes any band of it
+    // without computing the rest (nor, if the source is itself generated,
+    // all of the source). This ImageRec must outlive it.
+    Generator deferred_bands() const;
+
     ImageSpec* spec(int subimg = 0, int mip = 0)
     {
         return subimg < subimages() ? m_subimages[subimg].spec(mip) : NULL;
@@ -419,6 +546,8 @@ public:
 
     const ImageSpec* nativespec(int subimg = 0, int mip = 0) const
     {
+        if (deferred())  // don't compute pixels just to learn this
+            return spec(subimg, mip);
         return subimg < subimages() ? &((*this)(subimg, mip).nativespec())
                                     : nullptr;
     }
@@ -429,32 +558,47 @@ public:
     void metadata_modified(bool mod)
     {
         m_metadata_modified = mod;
-        if (mod)
+        if (mod) {
             was_output(false);
+            m_provenance.clear();
+        }
     }
     bool pixels_modified() const { return m_pixels_modified; }
     void pixels_modified(bool mod)
     {
         m_pixels_modified = mod;
-        if (mod)
+        if (mod) {
             was_output(false);
+            m_provenance.clear();
+        }
     }
 
     std::time_t time() const { return m_time; }
 
+    // Make this ImageRec a copy-on-write share of all the subimages and
+    // MIP levels of src (which must not be deferred).
+    void share_pixels(const ImageRec& src);
+
+    // A description of how this image was computed -- from which file,
+    // read how, and by which pure commands -- or empty if unknown. It is
+    // cleared whenever the pixels or metadata are modified in place.
+    const std::string& provenance() const { return m_provenance; }
+    void provenance(string_view p) { m_provenance = p; }
+
     // Request that any eventual input reads be stored internally in this
     // format. UNKNOWN means to use the usual default logic.
     void input_dataformat(TypeDesc dataformat)
     {
         m_input_dataformat = dataformat;
     }
+    TypeDesc input_dataformat() const { return m_input_dataformat; }
 
     // This should be called if for some reason the underlying
     // ImageBuf's spec may have been modified in place.  We need to
     // update the outer copy held by the SubimageRec.
     void update_spec_from_imagebuf(int subimg = 0, int mip = 0)
     {
-        *m_subimages[subimg].spec(mip) = m_subimages[subimg][mip]->spec();
+        *m_subimages[subimg].spec(mip) = (*this)(subimg, mip).spec();
         metadata_modified(true);
     }
 
@@ -493,9 +637,18 @@ private:
     ImageCache* m_imagecache = nullptr;
     mutable std::string m_err;
     ImageSpec m_configspec;
+    std::string m_provenance;
+    // For a deferred image, its source and the steps to apply to it.
+    mutable ImageRecRef m_deferred_src;
+    std::vector<ExprStep> m_deferred_steps;
+    // For a generated deferred image, what makes its pixels.
+    mutable Generator m_generator;
 
     // Add to the error message
     void append_error(string_view message) const;
+
+    // Compute the pixels of a deferred image.
+    void materialize() const;
 };
 
 
@@ -654,6 +807,14 @@ public:
         option_defaults();  // this can be customized to set up defaults
         ot.extract_options(options, args[0]);
 
+        // With --stream, a pointwise op is just recorded on top of its
+        // input, and evaluated with its neighbors when the pixels are
+        // needed, or a band at a time as the result is written.
+        if (ot.stream && defer_op()) {
+            ot.command_done(opname(), timer());
+            return 0;
+        }
+
         // Read all input images, and reserve (and push) the output image.
         int subimages = compute_subimages();
         if (nimages()) {
@@ -699,12 +860,13 @@ public:
 
         // Add the time we spent to the stats total for this op type.
         double optime = timer();
-        ot.function_times[opname()] += optime;
+        ot.command_done(opname(), optime);
         if (ot.debug) {
-            Strutil::printf("    %s took %s  (total time %s, mem %s)\n",
-                            opname(), Strutil::timeintervalformat(optime, 2),
-                            Strutil::timeintervalformat(ot.total_runtime(), 2),
-                            Strutil::memformat(Sysutil::memory_used()));
+            std::cout << Strutil::sprintf(
+                "    %s took %s  (total time %s, mem %s)\n", opname(),
+                Strutil::timeintervalformat(optime, 2),
+                Strutil::timeintervalformat(ot.total_runtime(), 2),
+                Strutil::memformat(Sysutil::memory_used()));
         }
         return 0;
     }
@@ -725,6 +887,11 @@ public:
     // to defaults. This will be called separate
     virtual void option_defaults() {}
 
+    // Override this for a pointwise op with one input that can be
+    // expressed as an ImageBufAlgo::Expr step: set step and return true if
+    // this invocation can be deferred, or return false to compute it now.
+    virtual bool defer(ImageRec::ExprStep& step) { return false; }
+
     // Default subimage logic: if the global -a flag was set or if this command
     // had ":allsubimages=1" option set, then apply the command to all subimages
     // (of the first input image). Otherwise, we'll only apply the command to
@@ -740,6 +907,25 @@ public:
     string_view opname() const { return m_opname; }
 
 protected:
+    // Push a deferred result instead of computing it, if the op and its
+    // input (a single subimage and MIP level, not deep) allow it.
+    bool defer_op()
+    {
+        if (nimages() != 2 || !ot.read(ir[1]))
+            return false;
+        if (ir[1]->subimages() != 1 || ir[1]->miplevels(0) != 1
+            || ir[1]->spec()->deep)
+            return false;
+        ImageRec::ExprStep step;
+        if (!defer(step))
+            return false;
+        ir[0].reset(new ImageRec(opname(), ir[1], step));
+        ot.push(ir[0]);
+        if (ir[0]->has_error())
+            ot.errorf(opname(), "%s", ir[0]->geterror());
+        return true;
+    }
+
     Oiiotool& ot;
     std::string m_opname;
     int m_nargs;
@@ -807,19 +993,46 @@ public:
         , defaultval(defaultval)
     {
     }
+    typedef ImageBufAlgo::Expr& (ImageBufAlgo::Expr::*ExprMethod)(
+        cspan<float>);
+
+    OiiotoolImageColorOp(IBLIMPL opimpl, ExprMethod exprmethod, Oiiotool& ot,
+                         string_view opname, int argc, const char* argv[],
+                         int ninputs, float defaultval = 0.0f)
+        : OiiotoolImageColorOp(opimpl, ot, opname, argc, argv, ninputs,
+                               defaultval)
+    {
+        this->exprmethod = exprmethod;
+    }
     virtual int impl(ImageBuf** img)
     {
-        int nchans = img[1]->spec().nchannels;
-        std::vector<float> val(nchans, defaultval);
-        int nvals = Strutil::extract_from_list_string(val, args[1]);
-        val.resize(nvals);
-        val.resize(nchans, val.size() == 1 ? val.back() : defaultval);
+        std::vector<float> val = values(img[1]->spec().nchannels);
         return opimpl(*img[0], *img[1], &val[0], ROI(), 0);
     }
+    virtual bool defer(ImageRec::ExprStep& step)
+    {
+        if (!exprmethod)
+            return false;
+        std::vector<float> val = values(ir[1]->spec()->nchannels);
+        ExprMethod method      = exprmethod;
+        step = [=](ImageBufAlgo::Expr& expr) { (expr.*method)(val); };
+        return true;
+    }
 
 protected:
     IBLIMPL opimpl;
+    ExprMethod exprmethod = nullptr;
     float defaultval;
+
+    // The per-channel values from the argument.
+    std::vector<float> values(int nchans)
+    {
+        std::vector<float> val(nchans, defaultval);
+        int nvals = Strutil::extract_from_list_string(val, args[1]);
+        val.resize(nvals);
+        val.resize(nchans, val.size() == 1 ? val.back() : defaultval);
+        return val;
+    }
 };
 
 
@@ -117,28 +117,28 @@ print_nums(int n, const T* val, string_view sep = " ")
         // Ensure uniform printing of NaN and Inf on all platforms
         for (int i = 0; i < n; ++i) {
             if (i)
-                Strutil::printf("%s", sep);
+                std::cout << sep;
             float v = float(val[i]);
             if (isnan(v))
-                Strutil::printf("nan");
+                std::cout << "nan";
             else if (isinf(v))
-                Strutil::printf("inf");
+                std::cout << "inf";
             else
-                Strutil::printf("%.9f", v);
+                std::cout << Strutil::sprintf("%.9f", v);
         }
     } else {
         // not floating point -- print the int values, then float equivalents
         for (int i = 0; i < n; ++i) {
-            Strutil::printf("%s%g", i ? sep : "", val[i]);
+            std::cout << Strutil::sprintf("%s%g", i ? sep : "", val[i]);
         }
-        Strutil::printf(" (");
+        std::cout << " (";
         for (int i = 0; i < n; ++i) {
             if (i)
-                Strutil::printf("%s", sep);
+                std::cout << sep;
             float v = convert_type<T, float>(val[i]);
-            Strutil::printf("%g", v);
+            std::cout << Strutil::sprintf("%g", v);
         }
-        Strutil::printf(")");
+        std::cout << ")";
     }
 }
 
@@ -166,13 +166,14 @@ dump_flat_data(ImageInput* input, const print_info_options& opt)
                         continue;
                 }
                 if (spec.depth > 1 || spec.z != 0)
-                    Strutil::printf("    Pixel (%d, %d, %d): ", x + spec.x,
-                                    y + spec.y, z + spec.z);
+                    std::cout << Strutil::sprintf("    Pixel (%d, %d, %d): ",
+                                                  x + spec.x, y + spec.y,
+                                                  z + spec.z);
                 else
-                    Strutil::printf("    Pixel (%d, %d): ", x + spec.x,
-                                    y + spec.y);
+                    std::cout << Strutil::sprintf("    Pixel (%d, %d): ",
+                                                  x + spec.x, y + spec.y);
                 print_nums(spec.nchannels, ptr);
-                Strutil::printf("\n");
+                std::cout << "\n";
             }
         }
     }
@@ -87,6 +87,7 @@
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
@@ -97,7 +98,10 @@ OIIO_PLUGIN_NAMESPACE_BEGIN
 
 // Custom file input stream, copying code from the class StdIFStream in OpenEXR,
 // which would have been used if we just provided a filename. The difference is
-// that this can handle UTF-8 file paths on all platforms.
+// that this can handle UTF-8 file paths on all platforms. It keeps its own
+// position and reads with pread, so that several streams may read from the
+// same IOProxy at once; proxies that don't implement pread are read the
+// usual way, by seeking.
 class OpenEXRInputStream : public Imf::IStream {
 public:
     OpenEXRInputStream(const char* filename, Filesystem::IOProxy* io)
@@ -110,20 +114,24 @@ public:
     virtual bool read(char c[], int n)
     {
         ASSERT(m_io);
-        if (m_io->read(c, n) != size_t(n))
+        if (m_io->pread(c, n, m_pos) != size_t(n)
+            && (!m_io->seek(m_pos) || m_io->read(c, n) != size_t(n)))
             throw Iex::IoExc("Unexpected end of file.");
+        m_pos += n;
         return n;
     }
-    virtual Imath::Int64 tellg() { return m_io->tell(); }
+    virtual Imath::Int64 tellg() { return m_pos; }
     virtual void seekg(Imath::Int64 pos)
     {
-        if (!m_io->seek(pos))
+        if (pos < 0)
             throw Iex::IoExc("File input failed.");
+        m_pos = pos;
     }
     virtual void clear() {}
 
 private:
     Filesystem::IOProxy* m_io = nullptr;
+    int64_t m_pos             = 0;
 };
 
 
@@ -137,7 +145,8 @@ public:
     {
         return (feature == "arbitrary_metadata"
                 || feature == "exif"    // Because of arbitrary_metadata
-                || feature == "iptc");  // Because of arbitrary_metadata
+                || feature == "iptc"    // Because of arbitrary_metadata
+                || (feature == "concurrent_scanlines" && pread_ok()));
     }
     virtual bool valid_file(const std::string& filename) const override;
     virtual bool open(const std::string& name, ImageSpec& newspec,
@@ -176,6 +185,24 @@ public:
                                         int xend, int ybegin, int yend,
                                         int zbegin, int zend, int chbegin,
                                         int chend, DeepData& deepdata) override;
+    virtual bool read_native_subimages(int n, const int* subimages,
+                                       void** data) override;
+    virtual bool read_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, int chbegin, int chend,
+                                TypeDesc format, void* data, stride_t xstride,
+                                stride_t ystride) override;
+    virtual bool read_tiles(int subimage, int miplevel, int xbegin, int xend,
+                            int ybegin, int yend, int zbegin, int zend,
+                            int chbegin, int chend, TypeDesc format, void* data,
+                            stride_t xstride, stride_t ystride,
+                            stride_t zstride) override;
+
+    // The Imf file we're reading from, so that OpenEXROutput::copy_image
+    // can copy raw compressed chunks out of it.
+    Imf::MultiPartInputFile* input_multipart() const
+    {
+        return m_input_multipart;
+    }
 
 private:
     struct PartInfo {
@@ -250,6 +277,41 @@ private:
     }
 
     bool valid_file(const std::string& filename, Filesystem::IOProxy* io) const;
+
+    // Can several streams read from our IOProxy at once? Only proxies whose
+    // pread works qualify (OpenEXRInputStream falls back to seek+read).
+    bool pread_ok() const
+    {
+        if (!m_io)
+            return false;
+        string_view proxytype = m_io->proxytype();
+        return proxytype == "file" || proxytype == "memreader";
+    }
+
+    // Can scanlines of this subimage and miplevel be read by
+    // read_private_scanlines, without the lock and the shared Imf file?
+    bool private_read_ok(int subimage, int miplevel) const
+    {
+        if (subimage < 0 || subimage >= int(m_parts.size()) || miplevel != 0)
+            return false;
+        const PartInfo& part(m_parts[subimage]);
+        return part.initialized && !part.spec.tile_width && !part.spec.deep
+               && pread_ok();
+    }
+
+    // Read scanlines [ybegin,yend) of part `subimage` into frameBuffer
+    // through a stream and Imf file of its own, so that a thread needn't
+    // wait while another one reads from the shared Imf file.
+    bool read_private_scanlines(int subimage, int ybegin, int yend,
+                                const Imf::FrameBuffer& frameBuffer);
+
+    // Set up frameBuffer to deliver channels [chbegin,chend) of the
+    // given subimage as format (or their native types, if format is
+    // UNKNOWN) with the given strides, pixel (0,0) being at origin.
+    // Return false if format is not one OpenEXR can convert to itself.
+    bool direct_framebuffer(Imf::FrameBuffer& frameBuffer, int subimage,
+                            int chbegin, int chend, TypeDesc format,
+                            char* origin, stride_t xstride, stride_t ystride);
 };
 
 
@@ -360,6 +422,18 @@ set_exr_threads()
     }
 }
 
+
+
+// If in is an OpenEXR reader, return the Imf file behind it, otherwise
+// nullptr. The Imf part to read is in->current_subimage().
+Imf::MultiPartInputFile*
+exr_input_multipart(ImageInput* in)
+{
+    if (!in || strcmp(in->format_name(), "openexr"))
+        return nullptr;
+    return static_cast<OpenEXRInput*>(in)->input_multipart();
+}
+
 }  // namespace pvt
 
 
@@ -1152,7 +1226,27 @@ OpenEXRInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
                                     int yend, int z, int chbegin, int chend,
                                     void* data)
 {
-    lock_guard lock(m_mutex);
+    // If another thread is reading from the shared Imf file (as when
+    // ImageInput::read_image reads chunks in parallel), read this range
+    // through a file of our own rather than waiting for it.
+    std::unique_lock<mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (private_read_ok(subimage, miplevel)) {
+            const ImageSpec& spec(m_parts[subimage].spec);
+            chend = clamp(chend, chbegin + 1, spec.nchannels);
+            stride_t pixelbytes    = spec.pixel_bytes(chbegin, chend, true);
+            stride_t scanlinebytes = spec.width * pixelbytes;
+            char* buf = (char*)data - spec.x * pixelbytes
+                        - ybegin * scanlinebytes;
+            Imf::FrameBuffer frameBuffer;
+            direct_framebuffer(frameBuffer, subimage, chbegin, chend,
+                               TypeDesc::UNKNOWN, buf, pixelbytes,
+                               scanlinebytes);
+            return read_private_scanlines(subimage, ybegin, yend,
+                                          frameBuffer);
+        }
+        lock.lock();
+    }
     if (!seek_subimage(subimage, miplevel))
         return false;
     chend = clamp(chend, chbegin + 1, m_spec.nchannels);
@@ -1331,6 +1425,176 @@ OpenEXRInput::read_native_tiles(int subimage, int miplevel, int xbegin,
 
 
 
+bool
+OpenEXRInput::read_private_scanlines(int subimage, int ybegin, int yend,
+                                     const Imf::FrameBuffer& frameBuffer)
+{
+    try {
+        OpenEXRInputStream stream(m_io->filename().c_str(), m_io);
+        Imf::MultiPartInputFile file(stream);
+        Imf::InputPart in(file, subimage);
+        in.setFrameBuffer(frameBuffer);
+        in.readPixels(ybegin, yend - 1);
+    } catch (const std::exception& e) {
+        error("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {  // catch-all for edge cases or compiler bugs
+        error("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+OpenEXRInput::direct_framebuffer(Imf::FrameBuffer& frameBuffer, int subimage,
+                                 int chbegin, int chend, TypeDesc format,
+                                 char* origin, stride_t xstride,
+                                 stride_t ystride)
+{
+    Imf::PixelType pixeltype;
+    if (format == TypeDesc::HALF)
+        pixeltype = Imf::HALF;
+    else if (format == TypeDesc::FLOAT)
+        pixeltype = Imf::FLOAT;
+    else if (format == TypeDesc::UINT)
+        pixeltype = Imf::UINT;
+    else if (format != TypeDesc::UNKNOWN)
+        return false;
+    const PartInfo& part(m_parts[subimage]);
+    size_t chanoffset = 0;
+    for (int c = chbegin; c < chend; ++c) {
+        bool native = (format == TypeDesc::UNKNOWN);
+        frameBuffer.insert(part.spec.channelnames[c].c_str(),
+                           Imf::Slice(native ? part.pixeltype[c] : pixeltype,
+                                      origin + chanoffset, xstride, ystride));
+        chanoffset += native ? part.spec.channelformat(c).size()
+                             : format.size();
+    }
+    return true;
+}
+
+
+
+bool
+OpenEXRInput::read_scanlines(int subimage, int miplevel, int ybegin, int yend,
+                             int z, int chbegin, int chend, TypeDesc format,
+                             void* data, stride_t xstride, stride_t ystride)
+{
+    // If OpenEXR can deliver the requested type itself, point its frame
+    // buffer straight at the caller's memory and strides, rather than
+    // reading native pixels to be converted and copied by the base class.
+    // As in read_native_scanlines, don't wait for another thread's read.
+    std::unique_lock<mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (private_read_ok(subimage, miplevel)) {
+            ImageSpec spec;
+            spec.copy_dimensions(m_parts[subimage].spec);
+            chend      = clamp(chend, chbegin + 1, spec.nchannels);
+            yend       = std::min(yend, spec.y + spec.height);
+            int nchans = chend - chbegin;
+            if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+                xstride = spec.pixel_bytes(chbegin, chend, true);
+            stride_t zstride = AutoStride;
+            spec.auto_stride(xstride, ystride, zstride, format, nchans,
+                             spec.width, spec.height);
+            char* buf = (char*)data - spec.x * xstride - ybegin * ystride;
+            Imf::FrameBuffer frameBuffer;
+            if (direct_framebuffer(frameBuffer, subimage, chbegin, chend,
+                                   format, buf, xstride, ystride))
+                return read_private_scanlines(subimage, ybegin, yend,
+                                              frameBuffer);
+            return ImageInput::read_scanlines(subimage, miplevel, ybegin,
+                                              yend, z, chbegin, chend, format,
+                                              data, xstride, ystride);
+        }
+        lock.lock();
+    }
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    chend      = clamp(chend, chbegin + 1, m_spec.nchannels);
+    yend       = std::min(yend, m_spec.y + m_spec.height);
+    int nchans = chend - chbegin;
+    if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+        xstride = m_spec.pixel_bytes(chbegin, chend, true);
+    stride_t zstride = AutoStride;
+    m_spec.auto_stride(xstride, ystride, zstride, format, nchans,
+                       m_spec.width, m_spec.height);
+    char* buf = (char*)data - m_spec.x * xstride - ybegin * ystride;
+    Imf::FrameBuffer frameBuffer;
+    if (!m_scanline_input_part
+        || !direct_framebuffer(frameBuffer, m_subimage, chbegin, chend,
+                               format, buf, xstride, ystride))
+        return ImageInput::read_scanlines(subimage, miplevel, ybegin, yend, z,
+                                          chbegin, chend, format, data,
+                                          xstride, ystride);
+    try {
+        m_scanline_input_part->setFrameBuffer(frameBuffer);
+        m_scanline_input_part->readPixels(ybegin, yend - 1);
+    } catch (const std::exception& e) {
+        error("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {  // catch-all for edge cases or compiler bugs
+        error("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+OpenEXRInput::read_tiles(int subimage, int miplevel, int xbegin, int xend,
+                         int ybegin, int yend, int zbegin, int zend,
+                         int chbegin, int chend, TypeDesc format, void* data,
+                         stride_t xstride, stride_t ystride, stride_t zstride)
+{
+    // As for read_scanlines, let OpenEXR deliver pixels directly to the
+    // caller's memory when it can. Tiles at the right and bottom edges are
+    // clipped to the data window, so OpenEXR writes nothing outside the
+    // requested region even when it's not a whole number of tiles.
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    chend = clamp(chend, chbegin + 1, m_spec.nchannels);
+    if (!m_spec.valid_tile_range(xbegin, xend, ybegin, yend, zbegin, zend))
+        return false;
+    int nchans = chend - chbegin;
+    if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+        xstride = m_spec.pixel_bytes(chbegin, chend, true);
+    m_spec.auto_stride(xstride, ystride, zstride, format, nchans,
+                       xend - xbegin, yend - ybegin);
+    char* buf = (char*)data - xbegin * xstride - ybegin * ystride;
+    Imf::FrameBuffer frameBuffer;
+    if (!m_tiled_input_part
+        || !direct_framebuffer(frameBuffer, m_subimage, chbegin, chend,
+                               format, buf, xstride, ystride))
+        return ImageInput::read_tiles(subimage, miplevel, xbegin, xend, ybegin,
+                                      yend, zbegin, zend, chbegin, chend,
+                                      format, data, xstride, ystride,
+                                      zstride);
+    int firstxtile = (xbegin - m_spec.x) / m_spec.tile_width;
+    int firstytile = (ybegin - m_spec.y) / m_spec.tile_height;
+    int nxtiles = (xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width;
+    int nytiles = (yend - ybegin + m_spec.tile_height - 1) / m_spec.tile_height;
+    try {
+        m_tiled_input_part->setFrameBuffer(frameBuffer);
+        m_tiled_input_part->readTiles(firstxtile, firstxtile + nxtiles - 1,
+                                      firstytile, firstytile + nytiles - 1,
+                                      m_miplevel, m_miplevel);
+    } catch (const std::exception& e) {
+        error("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {  // catch-all for edge cases or compiler bugs
+        error("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+    return true;
+}
+
+
+
 bool
 OpenEXRInput::read_native_deep_scanlines(int subimage, int miplevel, int ybegin,
                                          int yend, int z, int chbegin,
@@ -1358,7 +1622,7 @@ OpenEXRInput::read_native_deep_scanlines(int subimage, int miplevel, int ybegin,
                       cspan<TypeDesc>(&channeltypes[chbegin], nchans),
                       m_spec.channelnames);
         std::vector<unsigned int> all_samples(npixels);
-        std::vector<void*> pointerbuf(npixels * nchans);
+        std::vector<void*> pointerbuf;
         Imf::DeepFrameBuffer frameBuffer;
         Imf::Slice countslice(Imf::UINT,
                               (char*)(&all_samples[0] - m_spec.x
@@ -1366,6 +1630,15 @@ OpenEXRInput::read_native_deep_scanlines(int subimage, int miplevel, int ybegin,
                               sizeof(unsigned int),
                               sizeof(unsigned int) * m_spec.width);
         frameBuffer.insertSampleCountSlice(countslice);
+        m_deep_scanline_input_part->setFrameBuffer(frameBuffer);
+
+        // Get the sample counts for each pixel first, so that the whole
+        // data area is allocated just once, at its final size, and the
+        // pointers to every pixel's samples filled in (in parallel) for
+        // the single read of all the requested scanlines.
+        m_deep_scanline_input_part->readPixelSampleCounts(ybegin, yend - 1);
+        deepdata.set_all_samples(all_samples);
+        deepdata.get_pointers(pointerbuf);
 
         for (int c = chbegin; c < chend; ++c) {
             Imf::DeepSlice slice(
@@ -1375,17 +1648,11 @@ OpenEXRInput::read_native_deep_scanlines(int subimage, int miplevel, int ybegin,
                 sizeof(void*) * nchans,  // xstride of pointer array
                 sizeof(void*) * nchans
                     * m_spec.width,      // ystride of pointer array
-                deepdata.samplesize());  // stride of data sample
+                deepdata.samplestride(c - chbegin));  // stride of data sample
             frameBuffer.insert(m_spec.channelnames[c].c_str(), slice);
         }
         m_deep_scanline_input_part->setFrameBuffer(frameBuffer);
 
-        // Get the sample counts for each pixel and compute the total
-        // number of samples and resize the data area appropriately.
-        m_deep_scanline_input_part->readPixelSampleCounts(ybegin, yend - 1);
-        deepdata.set_all_samples(all_samples);
-        deepdata.get_pointers(pointerbuf);
-
         // Read the pixels
         m_deep_scanline_input_part->readPixels(ybegin, yend - 1);
         // deepdata.import_chansamp (pointerbuf);
@@ -1432,22 +1699,12 @@ OpenEXRInput::read_native_deep_tiles(int subimage, int miplevel, int xbegin,
                       cspan<TypeDesc>(&channeltypes[chbegin], nchans),
                       m_spec.channelnames);
         std::vector<unsigned int> all_samples(npixels);
-        std::vector<void*> pointerbuf(npixels * nchans);
+        std::vector<void*> pointerbuf;
         Imf::DeepFrameBuffer frameBuffer;
         Imf::Slice countslice(
             Imf::UINT, (char*)(&all_samples[0] - xbegin - ybegin * width),
             sizeof(unsigned int), sizeof(unsigned int) * width);
         frameBuffer.insertSampleCountSlice(countslice);
-        for (int c = chbegin; c < chend; ++c) {
-            Imf::DeepSlice slice(
-                part.pixeltype[c],
-                (char*)(&pointerbuf[0] + (c - chbegin) - xbegin * nchans
-                        - ybegin * width * nchans),
-                sizeof(void*) * nchans,          // xstride of pointer array
-                sizeof(void*) * nchans * width,  // ystride of pointer array
-                deepdata.samplesize());          // stride of data sample
-            frameBuffer.insert(m_spec.channelnames[c].c_str(), slice);
-        }
         m_deep_tiled_input_part->setFrameBuffer(frameBuffer);
 
         int xtiles = round_to_multiple(width, m_spec.tile_width)
@@ -1458,8 +1715,10 @@ OpenEXRInput::read_native_deep_tiles(int subimage, int miplevel, int xbegin,
         int firstxtile = (xbegin - m_spec.x) / m_spec.tile_width;
         int firstytile = (ybegin - m_spec.y) / m_spec.tile_height;
 
-        // Get the sample counts for each pixel and compute the total
-        // number of samples and resize the data area appropriately.
+        // Get the sample counts for each pixel first, so that the whole
+        // data area is allocated just once, at its final size, and the
+        // pointers to every pixel's samples filled in (in parallel) for
+        // the single read of all the requested tiles.
         m_deep_tiled_input_part->readPixelSampleCounts(firstxtile,
                                                        firstxtile + xtiles - 1,
                                                        firstytile,
@@ -1467,6 +1726,18 @@ OpenEXRInput::read_native_deep_tiles(int subimage, int miplevel, int xbegin,
         deepdata.set_all_samples(all_samples);
         deepdata.get_pointers(pointerbuf);
 
+        for (int c = chbegin; c < chend; ++c) {
+            Imf::DeepSlice slice(
+                part.pixeltype[c],
+                (char*)(&pointerbuf[0] + (c - chbegin) - xbegin * nchans
+                        - ybegin * width * nchans),
+                sizeof(void*) * nchans,          // xstride of pointer array
+                sizeof(void*) * nchans * width,  // ystride of pointer array
+                deepdata.samplestride(c - chbegin));  // stride of data sample
+            frameBuffer.insert(m_spec.channelnames[c].c_str(), slice);
+        }
+        m_deep_tiled_input_part->setFrameBuffer(frameBuffer);
+
         // Read the pixels
         m_deep_tiled_input_part->readTiles(firstxtile, firstxtile + xtiles - 1,
                                            firstytile, firstytile + ytiles - 1,
@@ -1483,4 +1754,80 @@ OpenEXRInput::read_native_deep_tiles(int subimage, int miplevel, int xbegin,
 }
 
 
+
+bool
+OpenEXRInput::read_native_subimages(int n, const int* subimages, void** data)
+{
+    std::string proxytype;
+    {
+        lock_guard lock(m_mutex);
+        if (!m_input_multipart) {
+            error("called OpenEXRInput::read_native_subimages without an "
+                  "open file");
+            return false;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (!seek_subimage(subimages[i], 0))
+                return false;
+            if (m_spec.deep) {
+                error("read_native_subimages does not support deep images");
+                return false;
+            }
+        }
+        proxytype = m_io->proxytype();
+    }
+    // OpenEXR locks a file's stream for the whole of each readPixels or
+    // readTiles, so each part is read through a stream and Imf file of its
+    // own. Those streams pread from our one IOProxy, which lets the parts'
+    // I/O and decompression overlap -- given a proxy whose pread works.
+    if (n < 2 || (proxytype != "file" && proxytype != "memreader"))
+        return ImageInput::read_native_subimages(n, subimages, data);
+
+    std::vector<std::string> errors(n);
+    parallel_for(0, n, [&](int64_t i) {
+        const PartInfo& part(m_parts[subimages[i]]);
+        const ImageSpec& spec(part.spec);
+        size_t pixelbytes    = spec.pixel_bytes(true);
+        size_t scanlinebytes = (size_t)spec.width * pixelbytes;
+        char* buf = (char*)data[i] - spec.x * pixelbytes
+                    - spec.y * scanlinebytes;
+        try {
+            OpenEXRInputStream stream(m_io->filename().c_str(), m_io);
+            Imf::MultiPartInputFile file(stream);
+            Imf::FrameBuffer frameBuffer;
+            size_t chanoffset = 0;
+            for (int c = 0; c < spec.nchannels; ++c) {
+                frameBuffer.insert(spec.channelnames[c].c_str(),
+                                   Imf::Slice(part.pixeltype[c],
+                                              buf + chanoffset, pixelbytes,
+                                              scanlinebytes));
+                chanoffset += spec.channelformat(c).size();
+            }
+            if (spec.tile_width) {
+                Imf::TiledInputPart in(file, subimages[i]);
+                in.setFrameBuffer(frameBuffer);
+                in.readTiles(0, in.numXTiles(0) - 1, 0, in.numYTiles(0) - 1,
+                             0, 0);
+            } else {
+                Imf::InputPart in(file, subimages[i]);
+                in.setFrameBuffer(frameBuffer);
+                in.readPixels(spec.y, spec.y + spec.height - 1);
+            }
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        } catch (...) {  // catch-all for edge cases or compiler bugs
+            errors[i] = "unknown exception";
+        }
+    });
+    for (auto& e : errors) {
+        if (e.size()) {
+            error("Failed OpenEXR read: %s", e);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
 OIIO_PLUGIN_NAMESPACE_END
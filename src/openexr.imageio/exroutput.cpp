@@ -32,6 +32,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -69,10 +70,14 @@
 #include <OpenEXR/ImfDeepScanLineOutputPart.h>
 #include <OpenEXR/ImfDeepTiledOutputPart.h>
 #include <OpenEXR/ImfDoubleAttribute.h>
+#include <OpenEXR/ImfInputPart.h>
+#include <OpenEXR/ImfMultiPartInputFile.h>
 #include <OpenEXR/ImfMultiPartOutputFile.h>
 #include <OpenEXR/ImfOutputPart.h>
 #include <OpenEXR/ImfPartType.h>
 #include <OpenEXR/ImfStringVectorAttribute.h>
+#include <OpenEXR/ImfThreading.h>
+#include <OpenEXR/ImfTiledInputPart.h>
 #include <OpenEXR/ImfTiledOutputPart.h>
 
 #include <OpenImageIO/dassert.h>
@@ -143,6 +148,7 @@ public:
     virtual bool write_deep_tiles(int xbegin, int xend, int ybegin, int yend,
                                   int zbegin, int zend,
                                   const DeepData& deepdata) override;
+    virtual bool copy_image(ImageInput* in) override;
 
 private:
     std::unique_ptr<OpenEXROutputStream>
@@ -170,6 +176,20 @@ private:
     Filesystem::IOProxy* m_io = nullptr;
     std::unique_ptr<Filesystem::IOProxy> m_local_io;
 
+    // Scanlines and tiles are held back until there are enough of them
+    // to hand OpenEXR many chunks at once, which it then compresses in
+    // parallel on its own thread pool.
+    std::vector<unsigned char> m_batch;  ///< Native scanlines not yet written
+    int m_batch_ybegin = 0;              ///< First scanline held in m_batch
+    int m_batch_lines  = 0;              ///< Number of scanlines in m_batch
+    struct TileRow {
+        std::vector<unsigned char> pixels;  // native, padded to whole tiles
+        std::vector<bool> have;             // which tiles have arrived
+        int ntiles = 0;                     // how many tiles have arrived
+    };
+    std::map<int, TileRow> m_tilerows;  ///< Incomplete rows of tiles, by ty
+    imagesize_t m_tilerow_bytes = 0;    ///< Memory held by m_tilerows
+
     // Initialize private members to pre-opened state
     void init(void)
     {
@@ -189,6 +209,11 @@ private:
         m_headers.shrink_to_fit();
         m_io = nullptr;
         m_local_io.reset();
+        m_batch.clear();
+        m_batch.shrink_to_fit();
+        m_batch_lines = 0;
+        m_tilerows.clear();
+        m_tilerow_bytes = 0;
     }
 
     // Set up the header based on the given spec.  Also may doctor the
@@ -209,6 +234,26 @@ private:
     // Helper: if the channel names are nonsensical, fix them to keep the
     // app from shooting itself in the foot.
     void sanity_check_channelnames();
+
+    // Hand native scanlines or tiles straight to OpenEXR. The buf is the
+    // origin of the "virtual framebuffer" for the whole image, as
+    // OpenEXR's frameBuffer.insert() wants it.
+    bool write_native_scanlines(int nscanlines, char* buf);
+    bool write_native_tiles(int xtbegin, int xtend, int ytbegin, int ytend,
+                            char* buf, stride_t widthbytes);
+
+    // How many scanlines to gather before passing them to OpenEXR:
+    // enough whole chunks to keep every OpenEXR thread busy.
+    int batch_scanlines();
+
+    // Copy one native tile into its row, writing the row if that
+    // completes it.
+    bool buffer_tile(int x, int y, int w, int h, const void* data);
+
+    // Write out any held scanlines or tiles.
+    bool flush_scanlines();
+    bool write_tilerow(int ty, const TileRow& row);
+    bool flush_tiles();
 };
 
 
@@ -247,6 +292,8 @@ static std::string format_string("openexr");
 namespace pvt {
 void
 set_exr_threads();
+Imf::MultiPartInputFile*
+exr_input_multipart(ImageInput* in);
 
 // format-specific metadata prefixes
 static std::vector<std::string> format_prefixes;
@@ -392,6 +439,8 @@ OpenEXROutput::open(const std::string& name, const ImageSpec& userspec,
             error("%s not opened properly for subimages", format_name());
             return false;
         }
+        if (!flush_scanlines() || !flush_tiles())
+            return false;
         // Move on to next subimage
         ++m_subimage;
         if (m_subimage >= m_nsubimages) {
@@ -445,6 +494,8 @@ OpenEXROutput::open(const std::string& name, const ImageSpec& userspec,
             error("Cannot append a MIP level if no file has been opened");
             return false;
         }
+        if (!flush_tiles())
+            return false;
         if (m_spec.tile_width && m_levelmode != Imf::ONE_LEVEL) {
             // OpenEXR does not support differing tile sizes on different
             // MIP-map levels.  Reject the open() if not using the original
@@ -933,7 +984,8 @@ OpenEXROutput::put_parameter(const std::string& name, TypeDesc type,
     if (Strutil::istarts_with(xname, "oiio:")) {
         if (Strutil::iequals(xname, "oiio:ConstantColor")
             || Strutil::iequals(xname, "oiio:AverageColor")
-            || Strutil::iequals(xname, "oiio:SHA-1")) {
+            || Strutil::iequals(xname, "oiio:SHA-1")
+            || Strutil::iequals(xname, "oiio:PixelHash")) {
             // let these fall through and get stored as metadata
         } else {
             // Other than the listed exceptions, suppress any other custom
@@ -1284,10 +1336,13 @@ OpenEXROutput::close()
     // trickery.  That's only necessary if it's open(), close(),
     // open(append), close(), ...
 
+    bool ok = flush_scanlines();
+    ok &= flush_tiles();
+
     if (m_levelmode != Imf::ONE_LEVEL) {
         // Leave MIP-map files open, since appending cannot be done via
         // a re-open like it can with TIFF files.
-        return true;
+        return ok;
     }
 
     m_output_scanline.reset();
@@ -1297,36 +1352,99 @@ OpenEXROutput::close()
     m_output_multipart.reset();
     m_output_stream.reset();
 
-    init();       // re-initialize
-    return true;  // How can we fail?
+    init();  // re-initialize
+    return ok;
 }
 
 
 
 bool
-OpenEXROutput::write_scanline(int y, int z, TypeDesc format, const void* data,
-                              stride_t xstride)
+OpenEXROutput::copy_image(ImageInput* in)
 {
-    if (!(m_output_scanline || m_scanline_output_part)) {
-        error("called OpenEXROutput::write_scanline without an open file");
-        return false;
+    // When copying single-level OpenEXR to OpenEXR, let Imf move the
+    // compressed chunks verbatim instead of decompressing and
+    // recompressing every pixel. Imf::copyPixels insists that the data
+    // window, channels, compression, line order and tiling all match,
+    // and throws ArgExc (before writing anything) if they don't, in
+    // which case we take the general path.
+    Imf::MultiPartInputFile* infile = pvt::exr_input_multipart(in);
+    if (infile && m_levelmode == Imf::ONE_LEVEL && !m_spec.deep
+        && !in->spec().deep) {
+        std::lock_guard<ImageInput> inlock(*in);
+        int part = in->current_subimage();
+        try {
+            const Imf::Header& inheader(infile->header(part));
+            bool intiled = inheader.hasTileDescription();
+            if (intiled
+                && inheader.tileDescription().mode != Imf::ONE_LEVEL) {
+                // copyPixels would copy every level at once
+            } else if (m_tiled_output_part && intiled) {
+                Imf::TiledInputPart inpart(*infile, part);
+                m_tiled_output_part->copyPixels(inpart);
+                return true;
+            } else if (m_output_tiled && intiled) {
+                Imf::TiledInputPart inpart(*infile, part);
+                m_output_tiled->copyPixels(inpart);
+                return true;
+            } else if (m_scanline_output_part && !intiled) {
+                Imf::InputPart inpart(*infile, part);
+                m_scanline_output_part->copyPixels(inpart);
+                return true;
+            } else if (m_output_scanline && !intiled) {
+                Imf::InputPart inpart(*infile, part);
+                m_output_scanline->copyPixels(inpart);
+                return true;
+            }
+        } catch (const Iex::ArgExc&) {
+            // Layouts differ -- fall through to decode and re-encode
+        } catch (const std::exception& e) {
+            error("Failed OpenEXR copy: %s", e.what());
+            return false;
+        } catch (...) {  // catch-all for edge cases or compiler bugs
+            error("Failed OpenEXR copy: unknown exception");
+            return false;
+        }
     }
+    return ImageOutput::copy_image(in);
+}
 
-    bool native        = (format == TypeDesc::UNKNOWN);
-    size_t pixel_bytes = m_spec.pixel_bytes(true);  // native
-    if (native && xstride == AutoStride)
-        xstride = (stride_t)pixel_bytes;
-    m_spec.auto_stride(xstride, format, spec().nchannels);
-    data = to_native_scanline(format, data, xstride, m_scratch);
 
-    // Compute where OpenEXR needs to think the full buffers starts.
-    // OpenImageIO requires that 'data' points to where client stored
-    // the bytes to be written, but OpenEXR's frameBuffer.insert() wants
-    // where the address of the "virtual framebuffer" for the whole
-    // image.
-    imagesize_t scanlinebytes = m_spec.scanline_bytes(native);
-    char* buf = (char*)data - m_spec.x * pixel_bytes - y * scanlinebytes;
 
+int
+OpenEXROutput::batch_scanlines()
+{
+    // Scanlines per chunk for each compression method
+    int chunklines = 1;
+    switch (m_headers[m_subimage].compression()) {
+    case Imf::ZIP_COMPRESSION:
+    case Imf::PXR24_COMPRESSION: chunklines = 16; break;
+    case Imf::PIZ_COMPRESSION:
+    case Imf::B44_COMPRESSION:
+    case Imf::B44A_COMPRESSION: chunklines = 32; break;
+#if defined(OPENEXR_VERSION_MAJOR)                                             \
+    && (OPENEXR_VERSION_MAJOR * 10000 + OPENEXR_VERSION_MINOR * 100            \
+        + OPENEXR_VERSION_PATCH)                                               \
+           >= 20200
+    case Imf::DWAA_COMPRESSION: chunklines = 32; break;
+    case Imf::DWAB_COMPRESSION: chunklines = 256; break;
+#endif
+    default: break;
+    }
+    // Two chunks per thread, so no thread goes idle while the next
+    // batch is gathered, but never more than 64 MB at a time.
+    int nthreads            = std::max(1, Imf::globalThreadCount());
+    const imagesize_t limit = 64 * 1024 * 1024;
+    int maxlines = std::max(1, int(limit / m_spec.scanline_bytes(true)));
+    return std::min(chunklines * nthreads * 2, maxlines);
+}
+
+
+
+bool
+OpenEXROutput::write_native_scanlines(int nscanlines, char* buf)
+{
+    size_t pixel_bytes        = m_spec.pixel_bytes(true);
+    imagesize_t scanlinebytes = m_spec.scanline_bytes(true);
     try {
         Imf::FrameBuffer frameBuffer;
         size_t chanoffset = 0;
@@ -1339,12 +1457,12 @@ OpenEXROutput::write_scanline(int y, int z, TypeDesc format, const void* data,
         }
         if (m_output_scanline) {
             m_output_scanline->setFrameBuffer(frameBuffer);
-            m_output_scanline->writePixels(1);
+            m_output_scanline->writePixels(nscanlines);
         } else if (m_scanline_output_part) {
             m_scanline_output_part->setFrameBuffer(frameBuffer);
-            m_scanline_output_part->writePixels(1);
+            m_scanline_output_part->writePixels(nscanlines);
         } else {
-            error("Attempt to write scanline to a non-scanline file.");
+            error("Attempt to write scanlines to a non-scanline file.");
             return false;
         }
     } catch (const std::exception& e) {
@@ -1354,6 +1472,57 @@ OpenEXROutput::write_scanline(int y, int z, TypeDesc format, const void* data,
         error("Failed OpenEXR write: unknown exception");
         return false;
     }
+    return true;
+}
+
+
+
+bool
+OpenEXROutput::flush_scanlines()
+{
+    if (!m_batch_lines)
+        return true;
+    int nscanlines = m_batch_lines;
+    m_batch_lines  = 0;
+    // Compute where OpenEXR needs to think the full buffers starts.
+    char* buf = (char*)m_batch.data() - m_spec.x * m_spec.pixel_bytes(true)
+                - m_batch_ybegin * m_spec.scanline_bytes(true);
+    return write_native_scanlines(nscanlines, buf);
+}
+
+
+
+bool
+OpenEXROutput::write_scanline(int y, int z, TypeDesc format, const void* data,
+                              stride_t xstride)
+{
+    if (!(m_output_scanline || m_scanline_output_part)) {
+        error("called OpenEXROutput::write_scanline without an open file");
+        return false;
+    }
+
+    bool native        = (format == TypeDesc::UNKNOWN);
+    size_t pixel_bytes = m_spec.pixel_bytes(true);  // native
+    if (native && xstride == AutoStride)
+        xstride = (stride_t)pixel_bytes;
+    m_spec.auto_stride(xstride, format, spec().nchannels);
+    data = to_native_scanline(format, data, xstride, m_scratch);
+
+    // A single scanline is less than one chunk for most compression
+    // methods, so OpenEXR could only compress it by itself. Gather
+    // scanlines into a batch and hand them over together instead.
+    size_t scanlinebytes = m_spec.scanline_bytes(true);
+    if (m_batch_lines && y != m_batch_ybegin + m_batch_lines
+        && !flush_scanlines())
+        return false;
+    if (!m_batch_lines)
+        m_batch_ybegin = y;
+    m_batch.resize((m_batch_lines + 1) * scanlinebytes);
+    memcpy(&m_batch[m_batch_lines * scanlinebytes], data, scanlinebytes);
+    ++m_batch_lines;
+    if (m_batch_lines >= batch_scanlines()
+        || y == m_spec.y + m_spec.height - 1)
+        return flush_scanlines();
 
     // FIXME -- can we checkpoint the file?
 
@@ -1382,6 +1551,19 @@ OpenEXROutput::write_scanlines(int ybegin, int yend, int z, TypeDesc format,
     m_spec.auto_stride(xstride, ystride, zstride, format, m_spec.nchannels,
                        m_spec.width, m_spec.height);
 
+    // Too few scanlines to keep OpenEXR's threads busy: add them to the
+    // batch instead.
+    if (yend - ybegin < batch_scanlines()) {
+        for (int y = ybegin; y < yend; ++y) {
+            if (!write_scanline(y, z, format, data, xstride))
+                return false;
+            data = (const char*)data + ystride;
+        }
+        return true;
+    }
+    if (!flush_scanlines())
+        return false;
+
     const imagesize_t limit = 16 * 1024
                               * 1024;  // Allocate 16 MB, or 1 scanline
     int chunk = std::max(1, int(limit / scanlinebytes));
@@ -1401,33 +1583,8 @@ OpenEXROutput::write_scanlines(int ybegin, int yend, int z, TypeDesc format,
         // where the address of the "virtual framebuffer" for the whole
         // image.
         char* buf = (char*)d - m_spec.x * pixel_bytes - ybegin * scanlinebytes;
-        try {
-            Imf::FrameBuffer frameBuffer;
-            size_t chanoffset = 0;
-            for (int c = 0; c < m_spec.nchannels; ++c) {
-                size_t chanbytes = m_spec.channelformat(c).size();
-                frameBuffer.insert(m_spec.channelnames[c].c_str(),
-                                   Imf::Slice(m_pixeltype[c], buf + chanoffset,
-                                              pixel_bytes, scanlinebytes));
-                chanoffset += chanbytes;
-            }
-            if (m_output_scanline) {
-                m_output_scanline->setFrameBuffer(frameBuffer);
-                m_output_scanline->writePixels(nscanlines);
-            } else if (m_scanline_output_part) {
-                m_scanline_output_part->setFrameBuffer(frameBuffer);
-                m_scanline_output_part->writePixels(nscanlines);
-            } else {
-                error("Attempt to write scanlines to a non-scanline file.");
-                return false;
-            }
-        } catch (const std::exception& e) {
-            error("Failed OpenEXR write: %s", e.what());
-            return false;
-        } catch (...) {  // catch-all for edge cases or compiler bugs
-            error("Failed OpenEXR write: unknown exception");
+        if (!write_native_scanlines(nscanlines, buf))
             return false;
-        }
 
         data = (const char*)data + ystride * nscanlines;
     }
@@ -1504,6 +1661,12 @@ OpenEXROutput::write_tiles(int xbegin, int xend, int ybegin, int yend,
     int nxtiles = (xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width;
     int nytiles = (yend - ybegin + m_spec.tile_height - 1) / m_spec.tile_height;
 
+    // A lone tile waits in its row until the row is complete, so that
+    // OpenEXR gets a whole row of tiles to compress at once.
+    if (nxtiles == 1 && nytiles == 1 && zend - zbegin <= 1)
+        return buffer_tile(xbegin, ybegin, xend - xbegin, yend - ybegin,
+                           data);
+
     std::vector<char> padded;
     int width           = nxtiles * m_spec.tile_width;
     int height          = nytiles * m_spec.tile_height;
@@ -1522,7 +1685,18 @@ OpenEXROutput::write_tiles(int xbegin, int xend, int ybegin, int yend,
     }
 
     char* buf = (char*)data - xbegin * pixelbytes - ybegin * widthbytes;
+    return write_native_tiles(firstxtile, firstxtile + nxtiles - 1,
+                              firstytile, firstytile + nytiles - 1, buf,
+                              widthbytes);
+}
 
+
+
+bool
+OpenEXROutput::write_native_tiles(int xtbegin, int xtend, int ytbegin,
+                                  int ytend, char* buf, stride_t widthbytes)
+{
+    size_t pixelbytes = m_spec.pixel_bytes(true);
     try {
         Imf::FrameBuffer frameBuffer;
         size_t chanoffset = 0;
@@ -1535,15 +1709,11 @@ OpenEXROutput::write_tiles(int xbegin, int xend, int ybegin, int yend,
         }
         if (m_output_tiled) {
             m_output_tiled->setFrameBuffer(frameBuffer);
-            m_output_tiled->writeTiles(firstxtile, firstxtile + nxtiles - 1,
-                                       firstytile, firstytile + nytiles - 1,
+            m_output_tiled->writeTiles(xtbegin, xtend, ytbegin, ytend,
                                        m_miplevel, m_miplevel);
         } else if (m_tiled_output_part) {
             m_tiled_output_part->setFrameBuffer(frameBuffer);
-            m_tiled_output_part->writeTiles(firstxtile,
-                                            firstxtile + nxtiles - 1,
-                                            firstytile,
-                                            firstytile + nytiles - 1,
+            m_tiled_output_part->writeTiles(xtbegin, xtend, ytbegin, ytend,
                                             m_miplevel, m_miplevel);
         } else {
             error("Attempt to write tiles for a non-tiled file.");
@@ -1562,6 +1732,91 @@ OpenEXROutput::write_tiles(int xbegin, int xend, int ybegin, int yend,
 
 
 
+bool
+OpenEXROutput::buffer_tile(int x, int y, int w, int h, const void* data)
+{
+    size_t pixelbytes = m_spec.pixel_bytes(true);
+    int tw            = m_spec.tile_width;
+    int th            = m_spec.tile_height;
+    int tx            = (x - m_spec.x) / tw;
+    int ty            = (y - m_spec.y) / th;
+    int nxtiles       = (m_spec.width + tw - 1) / tw;
+    stride_t rowbytes = stride_t(nxtiles) * tw * pixelbytes;
+
+    TileRow& row(m_tilerows[ty]);
+    if (row.have.empty()) {
+        row.pixels.resize(rowbytes * th, 0);
+        row.have.resize(nxtiles, false);
+        m_tilerow_bytes += row.pixels.size();
+    }
+    OIIO::copy_image(m_spec.nchannels, w, h, 1, data, pixelbytes, pixelbytes,
+                     w * pixelbytes, w * h * pixelbytes,
+                     &row.pixels[tx * tw * pixelbytes], pixelbytes, rowbytes,
+                     th * rowbytes);
+    if (!row.have[tx]) {
+        row.have[tx] = true;
+        ++row.ntiles;
+    }
+
+    // Rows go out as soon as they are complete, in whatever order they
+    // complete. OpenEXR itself holds back out-of-order tiles of an
+    // INCREASING_Y file until it can write them in order, and a
+    // RANDOM_Y file takes them as they come.
+    if (row.ntiles == nxtiles) {
+        bool ok = write_tilerow(ty, row);
+        m_tilerows.erase(ty);
+        return ok;
+    }
+    // Tiles arriving in column order would otherwise hold the whole
+    // image here.
+    const imagesize_t limit = 256 * 1024 * 1024;
+    if (m_tilerow_bytes > limit)
+        return flush_tiles();
+    return true;
+}
+
+
+
+bool
+OpenEXROutput::write_tilerow(int ty, const TileRow& row)
+{
+    size_t pixelbytes = m_spec.pixel_bytes(true);
+    int tw            = m_spec.tile_width;
+    int th            = m_spec.tile_height;
+    int nxtiles       = int(row.have.size());
+    stride_t rowbytes = stride_t(nxtiles) * tw * pixelbytes;
+    char* buf = (char*)row.pixels.data() - m_spec.x * pixelbytes
+                - (m_spec.y + ty * th) * rowbytes;
+    m_tilerow_bytes -= row.pixels.size();
+
+    // Write each run of tiles that arrived with a single call
+    bool ok = true;
+    for (int tx = 0; ok && tx < nxtiles; ++tx) {
+        if (!row.have[tx])
+            continue;
+        int txend = tx;
+        while (txend + 1 < nxtiles && row.have[txend + 1])
+            ++txend;
+        ok = write_native_tiles(tx, txend, ty, ty, buf, rowbytes);
+        tx = txend;
+    }
+    return ok;
+}
+
+
+
+bool
+OpenEXROutput::flush_tiles()
+{
+    bool ok = true;
+    for (auto& r : m_tilerows)
+        ok &= write_tilerow(r.first, r.second);
+    m_tilerows.clear();
+    return ok;
+}
+
+
+
 bool
 OpenEXROutput::write_deep_scanlines(int ybegin, int yend, int z,
                                     const DeepData& deepdata)
@@ -1598,7 +1853,7 @@ OpenEXROutput::write_deep_scanlines(int ybegin, int yend, int z,
                 sizeof(void*) * nchans,  // xstride of pointer array
                 sizeof(void*) * nchans
                     * m_spec.width,      // ystride of pointer array
-                deepdata.samplesize());  // stride of data sample
+                deepdata.samplestride(c));  // stride of data sample
             frameBuffer.insert(m_spec.channelnames[c].c_str(), slice);
         }
         m_deep_scanline_output_part->setFrameBuffer(frameBuffer);
@@ -1654,7 +1909,7 @@ OpenEXROutput::write_deep_tiles(int xbegin, int xend, int ybegin, int yend,
                         - ybegin * width * nchans),
                 sizeof(void*) * nchans,          // xstride of pointer array
                 sizeof(void*) * nchans * width,  // ystride of pointer array
-                deepdata.samplesize());          // stride of data sample
+                deepdata.samplestride(c));       // stride of data sample
             frameBuffer.insert(m_spec.channelnames[c].c_str(), slice);
         }
         m_deep_tiled_output_part->setFrameBuffer(frameBuffer);
@@ -106,6 +106,8 @@ public:
                                       void* data) override;
     virtual bool read_native_tile(int subimage, int miplevel, int x, int y,
                                   int z, void* data) override;
+    virtual bool native_tile_constant(int subimage, int miplevel, int x,
+                                      int y, int z, void* value) override;
 
     ImageSpec spec(int subimage, int miplevel) override;
     ImageSpec spec_dimensions(int subimage, int miplevel) override;
@@ -250,17 +252,34 @@ template<typename GridType> struct VDBReader {
         return true;
     }
 
+    // If the tile at (x,y,z) is not a leaf -- so it lies within a tile
+    // of an internal node, or outside everything active, and holds one
+    // value throughout -- store that value and return true. Only the
+    // tree's topology is consulted; nothing is densified.
+    static bool constantTile(const GridType& grid, int x, int y, int z,
+                             ValueType* value)
+    {
+        enum { kOffset = LeafType::DIM / 2 };
+        const openvdb::Coord xyz(x + kOffset, y + kOffset, z + kOffset);
+        typename GridType::ConstAccessor cache = grid.getConstAccessor();
+        if (cache.probeConstLeaf(xyz))
+            return false;
+        *value = cache.getValue(xyz);
+        return true;
+    }
+
     static void fillSpec(const CoordBBox& bounds, const Coord& dim,
                          ImageSpec& spec)
     {
         Vec3i data_min, data_max;
         for (int i = 0; i < 3; ++i) {
-            // Round the block_bounds up to encompass the leaf-node dimension (generally 8)
+            // Round the block_bounds out to whole leaf nodes (generally 8
+            // voxels), so that every tile is exactly one leaf.
             // So a box spanning [-2, -2, -2] -> [2, 2, 2]
-            // is expanded to    [-8, -8, -8] -> [8, 8, 8]
-            data_min[i] = bounds.min()[i] - (bounds.min()[i] % LeafType::DIM);
-            data_max[i] = bounds.max()[i]
-                          + (LeafType::DIM - (bounds.max()[i] % LeafType::DIM));
+            // is expanded to    [-8, -8, -8] -> [7, 7, 7]
+            // (Masking rounds toward -infinity, even for negative values.)
+            data_min[i] = bounds.min()[i] & ~(LeafType::DIM - 1);
+            data_max[i] = bounds.max()[i] | (LeafType::DIM - 1);
         }
         spec.x = data_min.x();
         spec.y = data_min.y();
@@ -516,12 +535,18 @@ OpenVDBInput::open(const std::string& filename, ImageSpec& newspec)
             ImageSpec spec;
             ScalarGrid::Ptr fPtr;
             Vec3fGrid::Ptr v3Ptr;
+            float background[3] = { 0.0f, 0.0f, 0.0f };
             if ((fPtr = gridPtrCast<ScalarGrid>(gridPtr))) {
                 spec = ImageSpec(dim.x(), dim.y(), 1, TypeFloat);
                 VDBReader<ScalarGrid>::fillSpec(bounds, dim, spec);
+                background[0] = fPtr->background();
             } else if ((v3Ptr = gridPtrCast<Vec3fGrid>(gridPtr))) {
                 spec = ImageSpec(dim.x(), dim.y(), 3, TypeFloat);
                 VDBReader<Vec3fGrid>::fillSpec(bounds, dim, spec);
+                const Vec3f bg = v3Ptr->background();
+                background[0]  = bg.x();
+                background[1]  = bg.y();
+                background[2]  = bg.z();
             } else
                 continue;
 
@@ -548,6 +573,13 @@ OpenVDBInput::open(const std::string& filename, ImageSpec& newspec)
                 channelnames.back() = layer.name;
 
             readMetaData(*layer.grid, layer, layerspec);
+
+            // The value of every voxel outside the grid's active tiles.
+            // The ImageCache uses it to recognize tiles that are entirely
+            // empty, so texture3d lookups there need not touch them.
+            layerspec.attribute("oiio:background",
+                                TypeDesc(TypeDesc::FLOAT, layerspec.nchannels),
+                                background);
         }
     } catch (const std::exception& e) {
         init();  // Reset to initial state
@@ -599,6 +631,31 @@ OpenVDBInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
 
 
 
+bool
+OpenVDBInput::native_tile_constant(int subimage, int miplevel, int x, int y,
+                                   int z, void* value)
+{
+    lock_guard lock(vdbMutex());
+    if (!seek_subimage_nolock(subimage, miplevel))
+        return false;
+
+    const layerrecord& lay = m_layers[m_subimage];
+    switch (lay.spec.nchannels) {
+    case 1:
+        return VDBReader<FloatGrid>::constantTile(
+            *gridPtrCast<ScalarGrid>(lay.grid), x, y, z,
+            reinterpret_cast<float*>(value));
+    case 3:
+        return VDBReader<Vec3fGrid>::constantTile(
+            *gridPtrCast<Vec3fGrid>(lay.grid), x, y, z,
+            reinterpret_cast<Vec3f*>(value));
+    default: break;
+    }
+    return false;
+}
+
+
+
 // Obligatory material to make this a recognizeable imageio plugin:
 OIIO_PLUGIN_EXPORTS_BEGIN
 
@@ -133,7 +133,8 @@ get_background(png_structp& sp, png_infop& ip, ImageSpec& spec, int& bit_depth,
 inline void
 read_info(png_structp& sp, png_infop& ip, int& bit_depth, int& color_type,
           int& interlace_type, Imath::Color3f& bg, ImageSpec& spec,
-          bool keep_unassociated_alpha)
+          bool keep_unassociated_alpha,
+          MetadataHint metadata = MetadataHint::Full)
 {
     png_read_info(sp, ip);
 
@@ -222,7 +223,7 @@ read_info(png_structp& sp, png_infop& ip, int& bit_depth, int& color_type,
             else if (Strutil::iequals(text_ptr[i].key, "Title"))
                 spec.attribute("DocumentName", text_ptr[i].text);
             else if (Strutil::iequals(text_ptr[i].key, "XML:com.adobe.xmp"))
-                decode_xmp(text_ptr[i].text, spec);
+                decode_xmp(text_ptr[i].text, spec, metadata);
             else
                 spec.attribute(text_ptr[i].key, text_ptr[i].text);
         }
@@ -624,17 +625,39 @@ write_row(png_structp& sp, png_byte* data)
 
 
 
+/// Writes an arbitrary chunk, e.g. IDAT data that we compressed ourselves.
+///
+inline bool
+write_chunk(png_structp& sp, const char* name, const unsigned char* data,
+            size_t length)
+{
+    if (setjmp(png_jmpbuf(sp))) {
+        //error ("PNG library error");
+        return false;
+    }
+    png_write_chunk(sp, (png_bytep)name, (png_bytep)data, length);
+    return true;
+}
+
+
+
 /// Helper function - finalizes writing the image and destroy the write
-/// struct.
+/// struct. If the caller wrote the IDAT chunks with write_chunk(), libpng
+/// doesn't know about them, so end the file with a bare IEND instead.
 inline void
-finish_image(png_structp& sp, png_infop& ip)
+finish_image(png_structp& sp, png_infop& ip, bool wrote_idat = false)
 {
     // Must call this setjmp in every function that does PNG writes
     if (setjmp(png_jmpbuf(sp))) {
         //error ("PNG library error");
         return;
     }
-    png_write_end(sp, ip);
+    if (wrote_idat) {
+        png_write_chunk(sp, (png_bytep) "IEND", nullptr, 0);
+        png_write_flush(sp);
+    } else {
+        png_write_end(sp, ip);
+    }
     png_destroy_write_struct(&sp, &ip);
     sp = nullptr;
     ip = nullptr;
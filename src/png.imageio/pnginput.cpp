@@ -44,6 +44,10 @@ public:
     PNGInput() { init(); }
     virtual ~PNGInput() { close(); }
     virtual const char* format_name(void) const override { return "png"; }
+    virtual int supports(string_view feature) const override
+    {
+        return (feature == "ioproxy");
+    }
     virtual bool valid_file(const std::string& filename) const override;
     virtual bool open(const std::string& name, ImageSpec& newspec) override;
     virtual bool open(const std::string& name, ImageSpec& newspec,
@@ -59,7 +63,8 @@ public:
 
 private:
     std::string m_filename;            ///< Stash the filename
-    FILE* m_file;                      ///< Open image handle
+    Filesystem::IOProxy* m_io;         ///< Where we read from
+    std::unique_ptr<Filesystem::IOProxy> m_local_io;  ///< Our own file
     png_structp m_png;                 ///< PNG read structure pointer
     png_infop m_info;                  ///< PNG image info structure pointer
     int m_bit_depth;                   ///< PNG bit depth
@@ -70,18 +75,21 @@ private:
     Imath::Color3f m_bg;               ///< Background color
     int m_next_scanline;
     bool m_keep_unassociated_alpha;  ///< Do not convert unassociated alpha
+    MetadataHint m_metadata;         ///< How to treat XMP metadata
 
     /// Reset everything to initial state
     ///
     void init()
     {
         m_subimage = -1;
-        m_file     = NULL;
+        m_io       = nullptr;
         m_png      = NULL;
         m_info     = NULL;
+        m_local_io.reset();
         m_buf.clear();
         m_next_scanline           = 0;
         m_keep_unassociated_alpha = false;
+        m_metadata                = MetadataHint::Full;
     }
 
     /// Helper function: read the image.
@@ -91,6 +99,16 @@ private:
     /// Extract the background color.
     ///
     bool get_background(float* red, float* green, float* blue);
+
+    // Callback for PNG that reads from the IOProxy.
+    static void PngReadCallback(png_structp png_ptr, png_bytep data,
+                                png_size_t length)
+    {
+        Filesystem::IOProxy* p = (Filesystem::IOProxy*)png_get_io_ptr(png_ptr);
+        DASSERT(p);
+        if (p->read(data, length) != length)
+            png_error(png_ptr, "Read error");
+    }
 };
 
 
@@ -139,14 +157,21 @@ PNGInput::open(const std::string& name, ImageSpec& newspec)
     m_filename = name;
     m_subimage = 0;
 
-    m_file = Filesystem::fopen(name, "rb");
-    if (!m_file) {
+    // Unless we were given an IOProxy to read from (by the config), read
+    // from the file through one of our own.
+    if (!m_io) {
+        m_local_io.reset(
+            new Filesystem::IOFile(name, Filesystem::IOProxy::Read));
+        m_io = m_local_io.get();
+    }
+    if (!m_io->opened()) {
         error("Could not open file \"%s\"", name.c_str());
         return false;
     }
+    m_io->seek(0);
 
     unsigned char sig[8];
-    if (fread(sig, 1, sizeof(sig), m_file) != sizeof(sig)) {
+    if (m_io->read(sig, sizeof(sig)) != sizeof(sig)) {
         error("Not a PNG file");
         return false;  // Read failed
     }
@@ -163,12 +188,12 @@ PNGInput::open(const std::string& name, ImageSpec& newspec)
         return false;
     }
 
-    png_init_io(m_png, m_file);
+    png_set_read_fn(m_png, m_io, PngReadCallback);
     png_set_sig_bytes(m_png, 8);  // already read 8 bytes
 
     PNG_pvt::read_info(m_png, m_info, m_bit_depth, m_color_type,
                        m_interlace_type, m_bg, m_spec,
-                       m_keep_unassociated_alpha);
+                       m_keep_unassociated_alpha, m_metadata);
 
     newspec         = spec();
     m_next_scanline = 0;
@@ -185,6 +210,10 @@ PNGInput::open(const std::string& name, ImageSpec& newspec,
     // Check 'config' for any special requests
     if (config.get_int_attribute("oiio:UnassociatedAlpha", 0) == 1)
         m_keep_unassociated_alpha = true;
+    m_metadata              = metadata_hint(config);
+    const ParamValue* param = config.find_attribute("oiio:ioproxy",
+                                                    TypeDesc::PTR);
+    m_io = param ? param->get<Filesystem::IOProxy*>() : nullptr;
     return open(name, newspec);
 }
 
@@ -210,10 +239,6 @@ bool
 PNGInput::close()
 {
     PNG_pvt::destroy_read_struct(m_png, m_info);
-    if (m_file) {
-        fclose(m_file);
-        m_file = NULL;
-    }
 
     init();  // Reset to initial state
     return true;
@@ -277,10 +302,19 @@ PNGInput::read_native_scanline(int subimage, int miplevel, int y, int z,
         // Not an interlaced image -- read just one row
         if (m_next_scanline > y) {
             // User is trying to read an earlier scanline than the one we're
-            // up to.  Easy fix: close the file and re-open.
+            // up to.  Easy fix: close the file and re-open (from the start
+            // of the same IOProxy, if we were given one).
             ImageSpec dummyspec;
-            int subimage = current_subimage();
-            if (!close() || !open(m_filename, dummyspec)
+            int subimage            = current_subimage();
+            Filesystem::IOProxy* io = m_local_io ? nullptr : m_io;
+            bool keep_unassociated  = m_keep_unassociated_alpha;
+            MetadataHint metadata   = m_metadata;
+            if (!close())
+                return false;
+            m_io                      = io;
+            m_keep_unassociated_alpha = keep_unassociated;
+            m_metadata                = metadata;
+            if (!open(m_filename, dummyspec)
                 || !seek_subimage(subimage, miplevel))
                 return false;  // Somehow, the re-open failed
             assert(m_next_scanline == 0 && current_subimage() == subimage);
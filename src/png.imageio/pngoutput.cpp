@@ -36,6 +36,8 @@
 
 #include "png_pvt.h"
 
+#include <OpenImageIO/parallel.h>
+
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -71,6 +73,15 @@ private:
     std::vector<png_text> m_pngtext;
     std::vector<unsigned char> m_tilebuffer;
     Filesystem::IOProxy* m_io = nullptr;
+    int m_zlevel;        ///< zlib compression level
+    int m_zstrategy;     ///< zlib compression strategy
+    int m_filter;        ///< PNG row filter type, or -1 for adaptive
+    bool m_multithread;  ///< Are we filtering and deflating rows ourselves?
+    int m_next_y;        ///< Next row to compress (multithread)
+    uLong m_adler;       ///< Adler-32 of the rows compressed so far
+    std::vector<unsigned char> m_rows;     ///< Rows waiting to be compressed
+    std::vector<unsigned char> m_prevrow;  ///< Raw row just before m_rows
+    std::vector<unsigned char> m_dict;     ///< Last 32KB of filtered data
 
     // Initialize private members to pre-opened state
     void init(void)
@@ -81,9 +92,20 @@ private:
         m_convert_alpha = true;
         m_gamma         = 1.0;
         m_pngtext.clear();
-        m_io = nullptr;
+        m_io          = nullptr;
+        m_multithread = false;
+        m_next_y      = 0;
+        m_adler       = adler32(0, Z_NULL, 0);
+        m_rows.clear();
+        m_prevrow.clear();
+        m_dict.clear();
     }
 
+    // Filter and deflate the buffered rows in parallel and write them as
+    // IDAT data. Unless final, rows that don't fill a whole chunk are left
+    // in m_rows for next time.
+    bool flush_rows(bool final);
+
     // Add a parameter to the output
     bool put_parameter(const std::string& name, TypeDesc type,
                        const void* data);
@@ -125,6 +147,11 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 
+// How much raw row data each parallel deflate task gets.
+static const size_t png_chunk_bytes = 256 * 1024;
+
+
+
 PNGOutput::PNGOutput() { init(); }
 
 
@@ -182,28 +209,38 @@ PNGOutput::open(const std::string& name, const ImageSpec& userspec,
     else
         png_set_write_fn(m_png, m_io, PngWriteCallback, PngFlushCallback);
 
-    png_set_compression_level(
-        m_png, std::max(std::min(m_spec.get_int_attribute(
-                                     "png:compressionLevel",
-                                     6 /* medium speed vs size tradeoff */),
-                                 Z_BEST_COMPRESSION),
-                        Z_NO_COMPRESSION));
     std::string compression = m_spec.get_string_attribute("compression");
+    int zlevel = 6;  // medium speed vs size tradeoff
+    m_zstrategy = Z_DEFAULT_STRATEGY;
+    m_filter    = -1;  // libpng's default: pick the best filter per row
     if (compression.empty()) {
-        png_set_compression_strategy(m_png, Z_DEFAULT_STRATEGY);
+        m_zstrategy = Z_DEFAULT_STRATEGY;
     } else if (Strutil::iequals(compression, "default")) {
-        png_set_compression_strategy(m_png, Z_DEFAULT_STRATEGY);
+        m_zstrategy = Z_DEFAULT_STRATEGY;
     } else if (Strutil::iequals(compression, "filtered")) {
-        png_set_compression_strategy(m_png, Z_FILTERED);
+        m_zstrategy = Z_FILTERED;
     } else if (Strutil::iequals(compression, "huffman")) {
-        png_set_compression_strategy(m_png, Z_HUFFMAN_ONLY);
+        m_zstrategy = Z_HUFFMAN_ONLY;
     } else if (Strutil::iequals(compression, "rle")) {
-        png_set_compression_strategy(m_png, Z_RLE);
+        m_zstrategy = Z_RLE;
     } else if (Strutil::iequals(compression, "fixed")) {
-        png_set_compression_strategy(m_png, Z_FIXED);
+        m_zstrategy = Z_FIXED;
+    } else if (Strutil::iequals(compression, "fast")) {
+        // Favor speed: fastest zlib level, run-length matching only, and
+        // the "sub" filter on every row rather than trying all five.
+        zlevel      = Z_BEST_SPEED;
+        m_zstrategy = Z_RLE;
+        m_filter    = PNG_FILTER_VALUE_SUB;
     } else {
-        png_set_compression_strategy(m_png, Z_DEFAULT_STRATEGY);
+        m_zstrategy = Z_DEFAULT_STRATEGY;
     }
+    m_zlevel = m_spec.get_int_attribute("png:compressionLevel", zlevel);
+    m_zlevel = std::max(std::min(m_zlevel, Z_BEST_COMPRESSION),
+                        Z_NO_COMPRESSION);
+    png_set_compression_level(m_png, m_zlevel);
+    png_set_compression_strategy(m_png, m_zstrategy);
+    if (m_filter == PNG_FILTER_VALUE_SUB)
+        png_set_filter(m_png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
 
     PNG_pvt::write_info(m_png, m_info, m_color_type, m_spec, m_pngtext,
                         m_convert_alpha, m_gamma);
@@ -215,6 +252,19 @@ PNGOutput::open(const std::string& name, const ImageSpec& userspec,
     m_convert_alpha = m_spec.alpha_channel != -1
                       && !m_spec.get_int_attribute("oiio:UnassociatedAlpha", 0);
 
+    // libpng filters and deflates on the calling thread, and that's
+    // nearly all the cost of writing a PNG. For big images we do those
+    // steps ourselves instead: chunks of rows are filtered and deflated in
+    // parallel into separate deflate blocks, each primed with the tail of
+    // the previous chunk as its dictionary and ended with a sync flush, so
+    // they concatenate into one valid zlib stream (as pigz does). libpng
+    // then only writes the IDAT chunks we hand it.
+    m_multithread = m_spec.image_bytes() >= 2 * png_chunk_bytes
+                    && threads() != 1 && default_thread_pool()->size() > 1
+                    && m_spec.get_int_attribute(
+                        "png:multithread",
+                        OIIO::get_int_attribute("png:multithread"));
+
     // If user asked for tiles -- which this format doesn't support, emulate
     // it by buffering the whole image.
     if (m_spec.tile_width && m_spec.tile_height)
@@ -243,7 +293,9 @@ PNGOutput::close()
     }
 
     if (m_png) {
-        PNG_pvt::finish_image(m_png, m_info);
+        if (m_multithread)
+            ok &= flush_rows(true);
+        PNG_pvt::finish_image(m_png, m_info, m_multithread);
     }
 
     if (m_file) {
@@ -322,6 +374,17 @@ PNGOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
     if (littleendian() && m_spec.format == TypeDesc::UINT16)
         swap_endian((unsigned short*)data, m_spec.width * m_spec.nchannels);
 
+    if (m_multithread) {
+        // Buffer rows until there's enough to keep every thread busy
+        size_t rowbytes = m_spec.scanline_bytes();
+        m_rows.insert(m_rows.end(), (unsigned char*)data,
+                      (unsigned char*)data + rowbytes);
+        size_t nthreads = size_t(default_thread_pool()->size());
+        if (m_rows.size() >= nthreads * png_chunk_bytes)
+            return flush_rows(false);
+        return true;
+    }
+
     if (!PNG_pvt::write_row(m_png, (png_byte*)data)) {
         error("PNG library error");
         return false;
@@ -332,6 +395,190 @@ PNGOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
 
 
 
+// Apply PNG filter type `filter` (or, if it's negative, whichever of the
+// five filters gives the smallest sum of absolute residuals, as libpng
+// does) to n bytes of a raw row, given the raw row above it. The filter
+// type byte followed by the n filtered bytes go to out. scratch must have
+// room for 5*n bytes.
+static void
+filter_row(const unsigned char* row, const unsigned char* prior, size_t n,
+           size_t bpp, int filter, unsigned char* out, unsigned char* scratch)
+{
+    int first = filter < 0 ? PNG_FILTER_VALUE_NONE : filter;
+    int last  = filter < 0 ? PNG_FILTER_VALUE_PAETH : filter;
+    int best  = first;
+    size_t bestsum = std::numeric_limits<size_t>::max();
+    for (int f = first; f <= last; ++f) {
+        unsigned char* r = scratch + f * n;
+        for (size_t i = 0; i < n; ++i) {
+            int a = i >= bpp ? row[i - bpp] : 0;  // left
+            int b = prior[i];                     // above
+            int c = i >= bpp ? prior[i - bpp] : 0;  // above left
+            int pred;
+            switch (f) {
+            case PNG_FILTER_VALUE_NONE: pred = 0; break;
+            case PNG_FILTER_VALUE_SUB: pred = a; break;
+            case PNG_FILTER_VALUE_UP: pred = b; break;
+            case PNG_FILTER_VALUE_AVG: pred = (a + b) / 2; break;
+            default: {
+                int p  = a + b - c;
+                int pa = std::abs(p - a), pb = std::abs(p - b);
+                int pc = std::abs(p - c);
+                pred   = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+            }
+            }
+            r[i] = (unsigned char)(row[i] - pred);
+        }
+        if (first == last)
+            break;
+        size_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+            sum += r[i] < 128 ? r[i] : 256 - r[i];
+        if (sum < bestsum) {
+            bestsum = sum;
+            best    = f;
+        }
+    }
+    out[0] = (unsigned char)best;
+    memcpy(out + 1, scratch + best * n, n);
+}
+
+
+
+// Deflate len bytes into out as raw deflate blocks (no zlib header or
+// trailer), using dict as the preset dictionary. Unless last, end with a
+// sync flush so that more blocks may follow in the same stream.
+static bool
+deflate_chunk(const unsigned char* in, size_t len, const unsigned char* dict,
+              size_t dictlen, int level, int strategy, bool last,
+              std::vector<unsigned char>& out)
+{
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+        return false;
+    if (dictlen)
+        deflateSetDictionary(&z, dict, uInt(dictlen));
+    out.resize(deflateBound(&z, uLong(len)) + 16);
+    z.next_in  = (Bytef*)in;
+    z.avail_in = uInt(len);
+    int status;
+    for (;;) {
+        if (z.total_out == out.size())
+            out.resize(2 * out.size());
+        z.next_out  = &out[z.total_out];
+        z.avail_out = uInt(out.size() - z.total_out);
+        status      = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (status == Z_STREAM_END || (status == Z_OK && !last && z.avail_out))
+            break;  // all done
+        if (status != Z_OK && status != Z_BUF_ERROR)
+            break;  // failed
+    }
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return status == (last ? Z_STREAM_END : Z_OK);
+}
+
+
+
+bool
+PNGOutput::flush_rows(bool final)
+{
+    const size_t rowbytes  = m_spec.scanline_bytes();
+    const size_t bpp       = m_spec.pixel_bytes();
+    const int nrows        = int(m_rows.size() / rowbytes);
+    const int chunkrows    = std::max(1, int(png_chunk_bytes / rowbytes));
+    const size_t dictbytes = 32768;  // the deflate window
+    const int dictrows     = int(dictbytes / (rowbytes + 1)) + 1;
+    int nchunks = final ? std::max(1, (nrows + chunkrows - 1) / chunkrows)
+                        : nrows / chunkrows;
+    if (!nchunks)
+        return true;
+    int nused = std::min(nrows, nchunks * chunkrows);
+
+    // The raw row above row i of m_rows (zeros above the first row)
+    std::vector<unsigned char> zeros(m_prevrow.empty() ? rowbytes : 0);
+    auto above = [&](int i) -> const unsigned char* {
+        return i > 0 ? &m_rows[(i - 1) * rowbytes]
+                     : (m_prevrow.size() ? &m_prevrow[0] : &zeros[0]);
+    };
+
+    std::vector<std::vector<unsigned char>> zchunks(nchunks);
+    std::vector<uLong> adlers(nchunks), lengths(nchunks);
+    std::vector<unsigned char> tail;
+    std::atomic<bool> ok(true);
+    parallel_for(0, nchunks, [&](int64_t c) {
+        int ybegin = int(c) * chunkrows;
+        int yend   = std::min(nused, ybegin + chunkrows);
+        // Re-filter enough of the rows before this chunk to serve as its
+        // dictionary (the first chunk uses the tail of the last flush).
+        int dbegin = c ? std::max(0, ybegin - dictrows) : ybegin;
+        std::vector<unsigned char> filtered((yend - dbegin) * (rowbytes + 1));
+        std::vector<unsigned char> scratch(5 * rowbytes);
+        for (int y = dbegin; y < yend; ++y)
+            filter_row(&m_rows[y * rowbytes], above(y), rowbytes, bpp,
+                       m_filter, &filtered[(y - dbegin) * (rowbytes + 1)],
+                       &scratch[0]);
+        const unsigned char* data = filtered.data()
+                                    + (ybegin - dbegin) * (rowbytes + 1);
+        size_t len = (yend - ybegin) * (rowbytes + 1);
+        const unsigned char* dict = c ? filtered.data() : m_dict.data();
+        size_t dictlen = c ? size_t(data - dict) : m_dict.size();
+        if (dictlen > dictbytes) {
+            dict += dictlen - dictbytes;
+            dictlen = dictbytes;
+        }
+        adlers[c]  = adler32(adler32(0, Z_NULL, 0), data, uInt(len));
+        lengths[c] = uLong(len);
+        if (!deflate_chunk(data, len, dict, dictlen, m_zlevel, m_zstrategy,
+                           final && c == nchunks - 1, zchunks[c]))
+            ok = false;
+        if (c == nchunks - 1) {
+            // Save the last 32KB fed to deflate, for the next flush
+            size_t keep = dictbytes - std::min(dictbytes, len);
+            keep        = std::min(dictlen, keep);
+            tail.assign(dict + dictlen - keep, dict + dictlen);
+            tail.insert(tail.end(), data + len - std::min(dictbytes, len),
+                        data + len);
+        }
+    });
+    if (!ok) {
+        error("PNG compression error");
+        return false;
+    }
+
+    // Stitch the pieces into the zlib stream: a header before the first
+    // block, then the blocks, then the Adler-32 of everything at the end.
+    std::vector<unsigned char> idat;
+    if (m_next_y == 0) {
+        idat.push_back(0x78);  // deflate, 32K window
+        idat.push_back(0x9c);  // default level, no dictionary, check bits
+    }
+    for (int c = 0; c < nchunks; ++c) {
+        idat.insert(idat.end(), zchunks[c].begin(), zchunks[c].end());
+        m_adler = adler32_combine(m_adler, adlers[c], z_off_t(lengths[c]));
+    }
+    if (final) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            idat.push_back((unsigned char)(m_adler >> shift));
+    }
+    if (!PNG_pvt::write_chunk(m_png, "IDAT", idat.data(), idat.size())) {
+        error("PNG library error");
+        return false;
+    }
+
+    m_dict.swap(tail);
+    if (nused) {
+        m_prevrow.assign(m_rows.begin() + (nused - 1) * rowbytes,
+                         m_rows.begin() + nused * rowbytes);
+        m_rows.erase(m_rows.begin(), m_rows.begin() + nused * rowbytes);
+    }
+    m_next_y += nused;
+    return true;
+}
+
+
+
 bool
 PNGOutput::write_tile(int x, int y, int z, TypeDesc format, const void* data,
                       stride_t xstride, stride_t ystride, stride_t zstride)
@@ -48,6 +48,8 @@ public:
     virtual int current_subimage(void) const override { return 0; }
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     enum PNMType { P1, P2, P3, P4, P5, P6, Pf, PF };
@@ -60,7 +62,8 @@ private:
     unsigned int m_max_val;
     float m_scaling_factor;
 
-    bool read_file_scanline(void* data, int y);
+    // Read scanlines [ybegin, yend) into data.
+    bool read_file_scanlines(void* data, int ybegin, int yend);
     bool read_file_header();
 };
 
@@ -254,76 +257,87 @@ read_int(std::istream& in, T& dest, char comment = '#')
 
 
 bool
-PNMInput::read_file_scanline(void* data, int y)
+PNMInput::read_file_scanlines(void* data, int ybegin, int yend)
 {
     try {
         std::vector<unsigned char> buf;
         bool good = true;
         if (!m_file)
             return false;
-        int nsamples = m_spec.width * m_spec.nchannels;
+        int nsamples    = m_spec.width * m_spec.nchannels;
+        int nscanlines  = yend - ybegin;
+        bool pfm        = (m_pnm_type == PF || m_pnm_type == Pf);
+        size_t outbytes = m_spec.scanline_bytes();
 
         // PFM files are bottom-to-top, so we need to seek to the right spot
-        if (m_pnm_type == PF || m_pnm_type == Pf) {
-            int file_scanline     = m_spec.height - 1 - (y - m_spec.y);
+        // (the file scanline of yend-1, which comes first in the file)
+        if (pfm) {
+            int file_scanline     = m_spec.height - (yend - m_spec.y);
             std::streampos offset = file_scanline * m_spec.scanline_bytes();
             m_file.seekg(m_header_end_pos + offset, std::ios_base::beg);
         }
 
-        if ((m_pnm_type >= P4 && m_pnm_type <= P6) || m_pnm_type == PF
-            || m_pnm_type == Pf) {
-            int numbytes;
+        // Binary scanlines are contiguous in the file, so read them all
+        // with one read.
+        size_t numbytes = 0;
+        if ((m_pnm_type >= P4 && m_pnm_type <= P6) || pfm) {
             if (m_pnm_type == P4)
                 numbytes = (m_spec.width + 7) / 8;
-            else if (m_pnm_type == PF || m_pnm_type == Pf)
+            else if (pfm)
                 numbytes = m_spec.nchannels * 4 * m_spec.width;
             else
                 numbytes = m_spec.scanline_bytes();
-            buf.resize(numbytes);
-            m_file.read((char*)&buf[0], numbytes);
+            buf.resize(numbytes * nscanlines);
+            m_file.read((char*)&buf[0], buf.size());
             if (!m_file.good())
                 return false;
         }
 
-        switch (m_pnm_type) {
-        //Ascii
-        case P1:
-            good &= ascii_to_raw(m_file, m_current_line, m_pos,
-                                 (unsigned char*)data, nsamples,
-                                 (unsigned char)m_max_val);
-            invert((unsigned char*)data, (unsigned char*)data, nsamples);
-            break;
-        case P2:
-        case P3:
-            if (m_max_val > std::numeric_limits<unsigned char>::max())
-                good &= ascii_to_raw(m_file, m_current_line, m_pos,
-                                     (unsigned short*)data, nsamples,
-                                     (unsigned short)m_max_val);
-            else
+        for (int i = 0; i < nscanlines && good; ++i) {
+            void* out = (char*)data + i * outbytes;
+            unsigned char* in
+                = buf.size() ? &buf[(pfm ? nscanlines - 1 - i : i) * numbytes]
+                             : nullptr;
+            switch (m_pnm_type) {
+            //Ascii
+            case P1:
                 good &= ascii_to_raw(m_file, m_current_line, m_pos,
-                                     (unsigned char*)data, nsamples,
+                                     (unsigned char*)out, nsamples,
                                      (unsigned char)m_max_val);
-            break;
-        //Raw
-        case P4: unpack(&buf[0], (unsigned char*)data, nsamples); break;
-        case P5:
-        case P6:
-            if (m_max_val > std::numeric_limits<unsigned char>::max()) {
-                if (littleendian())
-                    swap_endian((unsigned short*)&buf[0], nsamples);
-                raw_to_raw((unsigned short*)&buf[0], (unsigned short*)data,
-                           nsamples, (unsigned short)m_max_val);
-            } else {
-                raw_to_raw((unsigned char*)&buf[0], (unsigned char*)data,
-                           nsamples, (unsigned char)m_max_val);
+                invert((unsigned char*)out, (unsigned char*)out, nsamples);
+                break;
+            case P2:
+            case P3:
+                if (m_max_val > std::numeric_limits<unsigned char>::max())
+                    good &= ascii_to_raw(m_file, m_current_line, m_pos,
+                                         (unsigned short*)out, nsamples,
+                                         (unsigned short)m_max_val);
+                else
+                    good &= ascii_to_raw(m_file, m_current_line, m_pos,
+                                         (unsigned char*)out, nsamples,
+                                         (unsigned char)m_max_val);
+                break;
+            //Raw
+            case P4: unpack(in, (unsigned char*)out, nsamples); break;
+            case P5:
+            case P6:
+                if (m_max_val > std::numeric_limits<unsigned char>::max()) {
+                    if (littleendian())
+                        swap_endian((unsigned short*)in, nsamples);
+                    raw_to_raw((unsigned short*)in, (unsigned short*)out,
+                               nsamples, (unsigned short)m_max_val);
+                } else {
+                    raw_to_raw(in, (unsigned char*)out, nsamples,
+                               (unsigned char)m_max_val);
+                }
+                break;
+            //Floating point
+            case Pf:
+            case PF:
+                unpack_floats(in, (float*)out, nsamples, m_scaling_factor);
+                break;
+            default: return false;
             }
-            break;
-        //Floating point
-        case Pf:
-        case PF:
-            unpack_floats(&buf[0], (float*)data, nsamples, m_scaling_factor);
-            break;
-        default: return false;
         }
         return good;
 
@@ -476,9 +490,27 @@ PNMInput::read_native_scanline(int subimage, int miplevel, int y, int z,
 
     if (z)
         return false;
-    if (!read_file_scanline(data, y))
+    if (!read_file_scanlines(data, y, y + 1))
         return false;
     return true;
 }
 
+
+
+bool
+PNMInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+
+    if (z)
+        return false;
+    yend = std::min(yend, m_spec.y + m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    return read_file_scanlines(data, ybegin, yend);
+}
+
 OIIO_PLUGIN_NAMESPACE_END
@@ -28,6 +28,7 @@
   (This is the Modified BSD License)
 */
 
+#include <atomic>
 #include <csetjmp>
 #include <fstream>
 #include <functional>
@@ -35,6 +36,7 @@
 #include <memory>
 #include <vector>
 
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/tiffutils.h>
 
 #include "jpeg_memory_src.h"
@@ -62,6 +64,8 @@ public:
     virtual bool seek_subimage(int subimage, int miplevel) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     enum ColorMode {
@@ -149,6 +153,8 @@ private:
 
         std::vector<ChannelInfo> channel_info;
         std::map<int16_t, ChannelInfo*> channel_id_map;
+        //Have the RLE lengths and row positions been read yet?
+        bool channels_loaded = false;
 
         char bm_key[4];
         uint8_t opacity;
@@ -207,6 +213,8 @@ private:
     //psd:RawData config option, indicates that the user wants the raw,
     //unconverted channel data
     bool m_WantRaw;
+    //oiio:metadata config option, how to treat Exif and XMP resources
+    MetadataHint m_metadata;
     TypeDesc m_type_desc;
     //This holds all the ChannelInfos for all subimages
     //Example: m_channels[subimg][channel]
@@ -306,6 +314,15 @@ private:
     //Read a row of channel data
     bool read_channel_row(const ChannelInfo& channel_info, uint32_t row,
                           char* data);
+    //Decode rows [ybegin,yend) of a channel from their packed bytes (as
+    //they're stored contiguously in the file) into data. Doesn't touch the
+    //file, so it may be called from several threads at once.
+    bool decode_channel_rows(const ChannelInfo& channel_info, uint32_t ybegin,
+                             uint32_t yend, const char* packed,
+                             char* data) const;
+    void swap_channel_row(char* data) const;
+    //Convert the rows in m_channel_buffers into one scanline of data
+    bool convert_row(void* data);
 
     // Interleave channels (RRRGGGBBB -> RGBRGBRGB) while copying from
     // m_channel_buffers[0..nchans-1] to dst.
@@ -424,8 +441,8 @@ private:
 
     int read_pascal_string(std::string& s, uint16_t mod_padding);
 
-    bool decompress_packbits(const char* src, char* dst, uint16_t packed_length,
-                             uint16_t unpacked_length);
+    bool decompress_packbits(const char* src, char* dst, uint32_t packed_length,
+                             uint32_t unpacked_length) const;
 
     // These are AdditionalInfo entries that, for PSBs, have an 8-byte length
     static const char* additional_info_psb[];
@@ -615,6 +632,7 @@ PSDInput::open(const std::string& name, ImageSpec& newspec,
 {
     m_WantRaw = config.get_int_attribute("psd:RawData")
                 || config.get_int_attribute("oiio:RawColor");
+    m_metadata = metadata_hint(config);
 
     if (config.get_int_attribute("oiio:UnassociatedAlpha", 0) == 1)
         m_keep_unassociated_alpha = true;
@@ -642,6 +660,16 @@ PSDInput::seek_subimage(int subimage, int miplevel)
     if (subimage < 0 || subimage >= m_subimage_count)
         return false;
 
+    if (subimage > 0) {
+        // Layer channel data is only located when the layer is needed
+        Layer& layer = m_layers[subimage - 1];
+        if (!layer.channels_loaded) {
+            if (!load_layer_channels(layer))
+                return false;
+            layer.channels_loaded = true;
+        }
+    }
+
     m_subimage = subimage;
     m_spec     = m_specs[subimage];
     return true;
@@ -753,6 +781,88 @@ PSDInput::read_native_scanline(int subimage, int miplevel, int y, int z,
         if (!read_channel_row(channel_info, y, &buffer[0]))
             return false;
     }
+    return convert_row(data);
+}
+
+
+
+bool
+PSDInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    yend = std::min(yend, m_spec.y + m_spec.height);
+    if (ybegin < 0 || ybegin >= yend)
+        return ybegin == yend;
+
+    // Read the packed rows of each channel in one go (they're contiguous
+    // in the file), then decompress all the channels in parallel, and
+    // finally convert each scanline as read_native_scanline would.
+    std::vector<ChannelInfo*>& channels = m_channels[m_subimage];
+    int channel_count                   = (int)channels.size();
+    int nrows                           = yend - ybegin;
+    std::vector<std::unique_ptr<char[]>> packed(channel_count);
+    std::vector<std::unique_ptr<char[]>> unpacked(channel_count);
+    for (int c = 0; c < channel_count; ++c) {
+        const ChannelInfo& channel_info = *channels[c];
+        if (uint32_t(yend) > channel_info.row_pos.size())
+            return false;
+        std::streamoff bytes = channel_info.row_pos[yend - 1]
+                               - channel_info.row_pos[ybegin];
+        bytes += channel_info.compression == Compression_RLE
+                     ? channel_info.rle_lengths[yend - 1]
+                     : channel_info.row_length;
+        packed[c].reset(new char[bytes]);
+        unpacked[c].reset(new char[size_t(channel_info.row_length) * nrows]);
+        m_file.seekg(channel_info.row_pos[ybegin]);
+        m_file.read(packed[c].get(), bytes);
+        if (!check_io())
+            return false;
+    }
+    std::atomic<bool> ok(true);
+    parallel_for_chunked(
+        ybegin, yend, 0,
+        [&](int64_t b, int64_t e) {
+            for (int c = 0; c < channel_count; ++c) {
+                const ChannelInfo& channel_info = *channels[c];
+                std::streamoff offset = channel_info.row_pos[b]
+                                        - channel_info.row_pos[ybegin];
+                char* out = unpacked[c].get()
+                            + size_t(channel_info.row_length) * (b - ybegin);
+                if (!decode_channel_rows(channel_info, b, e,
+                                         packed[c].get() + offset, out))
+                    ok = false;
+            }
+        },
+        parallel_options(threads(), Split_Y, 16));
+    if (!ok) {
+        error("\"%s\": corrupt channel data", m_filename.c_str());
+        return false;
+    }
+
+    if (m_channel_buffers.size() < channels.size())
+        m_channel_buffers.resize(channels.size());
+    size_t scanline_bytes = m_spec.scanline_bytes(true);
+    for (int y = 0; y < nrows; ++y) {
+        for (int c = 0; c < channel_count; ++c) {
+            uint32_t row_length = channels[c]->row_length;
+            m_channel_buffers[c].assign(unpacked[c].get() + y * row_length,
+                                        row_length);
+        }
+        if (!convert_row((char*)data + y * scanline_bytes))
+            return false;
+    }
+    return true;
+}
+
+
+
+bool
+PSDInput::convert_row(void* data)
+{
+    int bps = (m_header.depth + 7) / 8;  // bytes per sample
     char* dst = (char*)data;
     if (m_WantRaw || m_header.color_mode == ColorMode_RGB
         || m_header.color_mode == ColorMode_Multichannel
@@ -836,7 +946,6 @@ PSDInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     }
 
     return true;
-#undef DEB
 }
 
 
@@ -849,7 +958,8 @@ PSDInput::init()
     m_subimage       = -1;
     m_subimage_count = 0;
     m_specs.clear();
-    m_WantRaw = false;
+    m_WantRaw  = false;
+    m_metadata = MetadataHint::Full;
     m_layers.clear();
     m_image_data.channel_info.clear();
     m_image_data.transparency = false;
@@ -1202,8 +1312,8 @@ PSDInput::load_resource_1058(uint32_t length)
     if (!m_file.read(&data[0], length))
         return false;
 
-    if (!decode_exif(data, m_composite_attribs)
-        || !decode_exif(data, m_common_attribs)) {
+    if (!decode_exif(data, m_composite_attribs, m_metadata)
+        || !decode_exif(data, m_common_attribs, m_metadata)) {
         error("Failed to decode Exif data");
         return false;
     }
@@ -1229,8 +1339,8 @@ PSDInput::load_resource_1060(uint32_t length)
         return false;
 
     // Store the XMP data for the composite and all other subimages
-    if (!decode_xmp(data, m_composite_attribs)
-        || !decode_xmp(data, m_common_attribs)) {
+    if (!decode_xmp(data, m_composite_attribs, m_metadata)
+        || !decode_xmp(data, m_common_attribs, m_metadata)) {
         error("Failed to decode XMP data");
         return false;
     }
@@ -1400,11 +1510,20 @@ PSDInput::load_layers()
         if (!load_layer(layer))
             return false;
     }
-    for (int16_t layer_nbr = 0; layer_nbr < layer_info.layer_count;
-         ++layer_nbr) {
-        Layer& layer = m_layers[layer_nbr];
-        if (!load_layer_channels(layer))
-            return false;
+    // The channel data of all the layers follows the layer records, one
+    // channel after another. Just note where each channel starts; its RLE
+    // lengths are read by load_layer_channels when the layer is first
+    // seeked to, so reading only the merged image skips them entirely.
+    std::streampos pos = m_file.tellg();
+    for (Layer& layer : m_layers) {
+        for (ChannelInfo& channel_info : layer.channel_info) {
+            channel_info.data_pos = pos;
+            pos += (std::streamoff)channel_info.data_length;
+        }
+    }
+    if (pos > layer_info.end) {
+        error("[Layer Channel] channel data exceeds layer info");
+        return false;
     }
     return true;
 }
@@ -1534,7 +1653,8 @@ PSDInput::load_layer_channels(Layer& layer)
 bool
 PSDInput::load_layer_channel(Layer& layer, ChannelInfo& channel_info)
 {
-    std::streampos start_pos = m_file.tellg();
+    std::streampos start_pos = channel_info.data_pos;
+    m_file.seekg(start_pos);
     if (channel_info.data_length >= 2) {
         read_bige<uint16_t>(channel_info.compression);
         if (!check_io())
@@ -1599,7 +1719,6 @@ PSDInput::load_layer_channel(Layer& layer, ChannelInfo& channel_info)
         return false;
         ;
     }
-    m_file.seekg(channel_info.data_length, std::ios::cur);
     return check_io();
 }
 
@@ -1885,21 +2004,48 @@ PSDInput::read_channel_row(const ChannelInfo& channel_info, uint32_t row,
     if (!check_io())
         return false;
 
+    swap_channel_row(data);
+    return true;
+}
+
+
+
+bool
+PSDInput::decode_channel_rows(const ChannelInfo& channel_info,
+                              uint32_t ybegin, uint32_t yend,
+                              const char* packed, char* data) const
+{
+    for (uint32_t row = ybegin; row < yend; ++row) {
+        switch (channel_info.compression) {
+        case Compression_Raw:
+            std::memcpy(data, packed, channel_info.row_length);
+            packed += channel_info.row_length;
+            break;
+        case Compression_RLE:
+            if (!decompress_packbits(packed, data,
+                                     channel_info.rle_lengths[row],
+                                     channel_info.row_length))
+                return false;
+            packed += channel_info.rle_lengths[row];
+            break;
+        }
+        swap_channel_row(data);
+        data += channel_info.row_length;
+    }
+    return true;
+}
+
+
+
+void
+PSDInput::swap_channel_row(char* data) const
+{
     if (!bigendian()) {
         switch (m_header.depth) {
         case 16: swap_endian((uint16_t*)data, m_spec.width); break;
-        case 32:
-            swap_endian((uint32_t*)data, m_spec.width);
-            // if (row == 131)
-            //     printf ("%x %x %x %x\n",
-            //             ((uint32_t*)data)[0], ((uint32_t*)data)[1],
-            //             ((uint32_t*)data)[2], ((uint32_t*)data)[3]);
-            // convert_type<float,uint32_t> ((float *)&data[0],
-            //                               (uint32_t*)&data[1], m_spec.width);
-            break;
+        case 32: swap_endian((uint32_t*)data, m_spec.width); break;
         }
     }
-    return true;
 }
 
 
@@ -2030,7 +2176,8 @@ PSDInput::read_pascal_string(std::string& s, uint16_t mod_padding)
 
 bool
 PSDInput::decompress_packbits(const char* src, char* dst,
-                              uint16_t packed_length, uint16_t unpacked_length)
+                              uint32_t packed_length,
+                              uint32_t unpacked_length) const
 {
     int32_t src_remaining = packed_length;
     int32_t dst_remaining = unpacked_length;
@@ -28,11 +28,17 @@
   (This is the Modified BSD License)
 */
 
+#include <cstring>
+#include <ctime>
+#include <map>
+
 #include <Ptexture.h>
 
 #include <OpenImageIO/dassert.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/thread.h>
 #include <OpenImageIO/typedesc.h>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -70,6 +76,9 @@ public:
                                       void* data) override;
     virtual bool read_native_tile(int subimage, int miplevel, int x, int y,
                                   int z, void* data) override;
+    virtual bool read_native_tiles(int subimage, int miplevel, int xbegin,
+                                   int xend, int ybegin, int yend, int zbegin,
+                                   int zend, void* data) override;
 
 private:
     PtexTexture* m_ptex;
@@ -78,10 +87,17 @@ private:
     int m_numFaces;
     Ptex::Res m_faceres;
     Ptex::Res m_mipfaceres;
-    Ptex::Res m_tileres;
-    bool m_isTiled;
     bool m_hasMipMaps;
-    int m_ntilesu;
+    ImageSpec m_basespec;  ///< What all faces share: format and metadata
+
+    // Largest tile we present. Faces are powers of two in size, so
+    // tiles of this size or of the whole face divide them exactly.
+    static const int max_tile_res = 64;
+
+    // Copy the pixels [xbegin,xend) x [ybegin,yend) of the current face
+    // and MIP level into data, whose rows are ystride bytes apart.
+    bool read_face_region(int xbegin, int xend, int ybegin, int yend,
+                          char* data, stride_t ystride);
 
     /// Reset everything to initial state
     ///
@@ -122,84 +138,75 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 
+// All PtexInputs share one PtexCache, so many readers of the same file
+// (as the ImageCache makes) share its parsed header and face data.
+static PtexCache*
+shared_ptex_cache()
+{
+    static PtexCache* cache = PtexCache::create(100, 256 * 1024 * 1024,
+                                                true /*premultiply*/);
+    return cache;
+}
+
+// Modification times of the files in the shared cache, so that a file
+// that changed on disk is reread rather than served stale.
+static std::map<std::string, std::time_t> ptex_file_times;
+static spin_mutex ptex_file_times_mutex;
+
+
+
 bool
 PtexInput::open(const std::string& name, ImageSpec& newspec)
 {
+    PtexCache* cache = shared_ptex_cache();
+    {
+        std::time_t t = Filesystem::last_write_time(name);
+        spin_lock lock(ptex_file_times_mutex);
+        auto found = ptex_file_times.find(name);
+        if (found != ptex_file_times.end() && found->second != t)
+            cache->purge(name.c_str());
+        ptex_file_times[name] = t;
+    }
+
     Ptex::String perr;
-    m_ptex = PtexTexture::open(name.c_str(), perr, true /*premultiply*/);
-    if (!perr.empty()) {
+    m_ptex = cache->get(name.c_str(), perr);
+    if (!m_ptex || !perr.empty()) {
         if (m_ptex) {
             m_ptex->release();
             m_ptex = NULL;
         }
-        error("%s", perr.c_str());
+        error("%s", perr.empty() ? "Could not open Ptex file" : perr.c_str());
         return false;
     }
 
     m_numFaces   = m_ptex->numFaces();
     m_hasMipMaps = m_ptex->hasMipMaps();
 
-    bool ok = seek_subimage(0, 0);
-    newspec = spec();
-    return ok;
-}
-
-
-
-bool
-PtexInput::seek_subimage(int subimage, int miplevel)
-{
-    if (m_subimage == subimage && m_miplevel == miplevel)
-        return true;  // Already fine
-
-    if (subimage < 0 || subimage >= m_numFaces)
-        return false;
-    m_subimage                  = subimage;
-    const Ptex::FaceInfo& pface = m_ptex->getFaceInfo(subimage);
-    m_faceres                   = pface.res;
-
-    int nmiplevels = std::max(m_faceres.ulog2, m_faceres.vlog2) + 1;
-    if (miplevel < 0 || miplevel > nmiplevels - 1)
-        return false;
-    m_miplevel   = miplevel;
-    m_mipfaceres = Ptex::Res(std::max(0, m_faceres.ulog2 - miplevel),
-                             std::max(0, m_faceres.vlog2 - miplevel));
-
+    // Everything but the resolution is the same for every face, so work
+    // it out once here rather than on every seek_subimage().
     TypeDesc format = TypeDesc::UNKNOWN;
     switch (m_ptex->dataType()) {
     case Ptex::dt_uint8: format = TypeDesc::UINT8; break;
     case Ptex::dt_uint16: format = TypeDesc::UINT16; break;
     case Ptex::dt_half: format = TypeDesc::HALF; break;
     case Ptex::dt_float: format = TypeDesc::FLOAT; break;
-    default: error("Ptex with unknown data format"); return false;
+    default:
+        error("Ptex with unknown data format");
+        close();
+        return false;
     }
 
-    m_spec = ImageSpec(std::max(1, m_faceres.u() >> miplevel),
-                       std::max(1, m_faceres.v() >> miplevel),
-                       m_ptex->numChannels(), format);
+    m_basespec = ImageSpec(1, 1, m_ptex->numChannels(), format);
 
-    m_spec.alpha_channel = m_ptex->alphaChannel();
+    m_basespec.alpha_channel = m_ptex->alphaChannel();
 
     if (m_ptex->meshType() == Ptex::mt_triangle)
-        m_spec.attribute("ptex:meshType", "triangle");
+        m_basespec.attribute("ptex:meshType", "triangle");
     else
-        m_spec.attribute("ptex:meshType", "quad");
+        m_basespec.attribute("ptex:meshType", "quad");
 
     if (m_ptex->hasEdits())
-        m_spec.attribute("ptex:hasEdits", (int)1);
-
-    PtexFaceData* facedata = m_ptex->getData(m_subimage, m_faceres);
-    m_isTiled              = facedata->isTiled();
-    if (m_isTiled) {
-        m_tileres          = facedata->tileRes();
-        m_spec.tile_width  = m_tileres.u();
-        m_spec.tile_height = m_tileres.v();
-        m_ntilesu          = m_faceres.ntilesu(m_tileres);
-    } else {
-        // Always make it look tiled
-        m_spec.tile_width  = m_spec.width;
-        m_spec.tile_height = m_spec.height;
-    }
+        m_basespec.attribute("ptex:hasEdits", (int)1);
 
     std::string wrapmode;
     if (m_ptex->uBorderMode() == Ptex::m_clamp)
@@ -209,13 +216,13 @@ PtexInput::seek_subimage(int subimage, int miplevel)
     else  // if (m_ptex->uBorderMode() == Ptex::m_periodic)
         wrapmode = "periodic";
     wrapmode += ",";
-    if (m_ptex->uBorderMode() == Ptex::m_clamp)
+    if (m_ptex->vBorderMode() == Ptex::m_clamp)
         wrapmode += "clamp";
-    else if (m_ptex->uBorderMode() == Ptex::m_black)
+    else if (m_ptex->vBorderMode() == Ptex::m_black)
         wrapmode += "black";
-    else  // if (m_ptex->uBorderMode() == Ptex::m_periodic)
+    else  // if (m_ptex->vBorderMode() == Ptex::m_periodic)
         wrapmode += "periodic";
-    m_spec.attribute("wrapmode", wrapmode);
+    m_basespec.attribute("wrapmode", wrapmode);
 
 #define GETMETA(pmeta, key, ptype, basetype, typedesc, value)                  \
     {                                                                          \
@@ -260,12 +267,48 @@ PtexInput::seek_subimage(int subimage, int miplevel)
                 break;
             default: continue;
             }
-            m_spec.attribute(key, typedesc, value);
+            m_basespec.attribute(key, typedesc, value);
         }
         pmeta->release();
     }
 
-    facedata->release();
+    bool ok = seek_subimage(0, 0);
+    newspec = spec();
+    return ok;
+}
+
+
+
+bool
+PtexInput::seek_subimage(int subimage, int miplevel)
+{
+    if (m_subimage == subimage && m_miplevel == miplevel)
+        return true;  // Already fine
+
+    if (subimage < 0 || subimage >= m_numFaces)
+        return false;
+    // Only the face's resolution, which Ptex keeps in memory for every
+    // face, is needed here. No face data is read until pixels are.
+    const Ptex::FaceInfo& pface = m_ptex->getFaceInfo(subimage);
+    int nmiplevels = std::max(pface.res.ulog2, pface.res.vlog2) + 1;
+    if (miplevel < 0 || miplevel > nmiplevels - 1)
+        return false;
+    m_subimage   = subimage;
+    m_miplevel   = miplevel;
+    m_faceres    = pface.res;
+    m_mipfaceres = Ptex::Res(std::max(0, m_faceres.ulog2 - miplevel),
+                             std::max(0, m_faceres.vlog2 - miplevel));
+
+    m_spec             = m_basespec;
+    m_spec.width       = m_mipfaceres.u();
+    m_spec.height      = m_mipfaceres.v();
+    m_spec.full_width  = m_spec.width;
+    m_spec.full_height = m_spec.height;
+    // Always make it look tiled. Ptex's own tiling of a face is only
+    // known once its data is read, so the tiles we present need not
+    // match it; read_face_region() copes with either.
+    m_spec.tile_width  = std::min(m_spec.width, max_tile_res);
+    m_spec.tile_height = std::min(m_spec.height, max_tile_res);
     return true;
 }
 
@@ -289,6 +332,82 @@ PtexInput::read_native_scanline(int subimage, int miplevel, int y, int z,
 
 
 
+// Copy [xbegin,xend) x [ybegin,yend) out of face data f, whose pixel
+// (0,0) is at (fx,fy) and whose rows are fw pixels wide.
+static void
+copy_face_data(PtexFaceData* f, int fx, int fy, int fw, size_t pixelbytes,
+               int xbegin, int xend, int ybegin, int yend, char* data,
+               stride_t ystride)
+{
+    const char* src = (const char*)f->getData();
+    for (int y = ybegin; y < yend; ++y) {
+        char* dst = data + (y - ybegin) * ystride;
+        if (f->isConstant()) {
+            for (int x = xbegin; x < xend; ++x, dst += pixelbytes)
+                memcpy(dst, src, pixelbytes);
+        } else {
+            const char* s = src
+                            + ((y - fy) * size_t(fw) + (xbegin - fx))
+                                  * pixelbytes;
+            memcpy(dst, s, (xend - xbegin) * pixelbytes);
+        }
+    }
+}
+
+
+
+bool
+PtexInput::read_face_region(int xbegin, int xend, int ybegin, int yend,
+                            char* data, stride_t ystride)
+{
+    // One getData() for the whole region, however many of our tiles it
+    // spans, and Ptex's own cache holds on to the face data afterwards.
+    PtexFaceData* facedata = m_ptex->getData(m_subimage, m_mipfaceres);
+    if (!facedata) {
+        error("Could not read Ptex face %d", m_subimage);
+        return false;
+    }
+    size_t pixelbytes = m_spec.pixel_bytes();
+    bool ok           = true;
+    if (facedata->isTiled()) {
+        Ptex::Res tileres = facedata->tileRes();
+        int tw            = tileres.u();
+        int th            = tileres.v();
+        int ntilesu       = m_mipfaceres.ntilesu(tileres);
+        for (int ty = ybegin / th; ok && ty * th < yend; ++ty) {
+            for (int tx = xbegin / tw; tx * tw < xend; ++tx) {
+                PtexFaceData* tile = facedata->getTile(ty * ntilesu + tx);
+                if (!tile || !tile->getData()) {
+                    if (tile)
+                        tile->release();
+                    error("Could not read Ptex face %d", m_subimage);
+                    ok = false;
+                    break;
+                }
+                int x0 = std::max(xbegin, tx * tw);
+                int y0 = std::max(ybegin, ty * th);
+                copy_face_data(tile, tx * tw, ty * th, tw, pixelbytes, x0,
+                               std::min(xend, (tx + 1) * tw), y0,
+                               std::min(yend, (ty + 1) * th),
+                               data + (y0 - ybegin) * ystride
+                                   + (x0 - xbegin) * pixelbytes,
+                               ystride);
+                tile->release();
+            }
+        }
+    } else if (facedata->getData()) {
+        copy_face_data(facedata, 0, 0, m_mipfaceres.u(), pixelbytes, xbegin,
+                       xend, ybegin, yend, data, ystride);
+    } else {
+        error("Could not read Ptex face %d", m_subimage);
+        ok = false;
+    }
+    facedata->release();
+    return ok;
+}
+
+
+
 bool
 PtexInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
                             void* data)
@@ -296,27 +415,27 @@ PtexInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
     lock_guard lock(m_mutex);
     if (!seek_subimage(subimage, miplevel))
         return false;
+    stride_t ystride = m_spec.tile_width * m_spec.pixel_bytes();
+    return read_face_region(x, std::min(x + m_spec.tile_width, m_spec.width),
+                            y, std::min(y + m_spec.tile_height, m_spec.height),
+                            (char*)data, ystride);
+}
 
-    PtexFaceData* facedata = m_ptex->getData(m_subimage, m_mipfaceres);
 
-    PtexFaceData* f = facedata;
-    if (m_isTiled) {
-        int tileno = y / m_spec.tile_height * m_ntilesu + x / m_spec.tile_width;
-        f          = facedata->getTile(tileno);
-    }
 
-    bool ok        = true;
-    void* tiledata = f->getData();
-    if (tiledata) {
-        memcpy(data, tiledata, m_spec.tile_bytes());
-    } else {
-        ok = false;
-    }
-
-    if (m_isTiled)
-        f->release();
-    facedata->release();
-    return ok;
+bool
+PtexInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
+                             int ybegin, int yend, int zbegin, int zend,
+                             void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    if (!m_spec.valid_tile_range(xbegin, xend, ybegin, yend, zbegin, zend))
+        return false;
+    return read_face_region(xbegin, std::min(xend, m_spec.width), ybegin,
+                            std::min(yend, m_spec.height), (char*)data,
+                            (xend - xbegin) * m_spec.pixel_bytes());
 }
 
 
@@ -32,6 +32,7 @@
 
 #include <memory>
 
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/platform.h>
 
 
@@ -152,6 +153,89 @@ ImageBuf_get_pixels(const ImageBuf& buf, TypeDesc format, ROI roi = ROI::All())
 
 
 
+// Describe the pixels of an ImageBuf, in place in its memory, as a buffer
+// indexed [y][x][channel] (or [z][y][x][channel] for volumes) with the
+// ImageBuf's own strides, so that NumPy can use them without a copy.
+py::buffer_info
+ImageBuf_buffer_info(ImageBuf& buf)
+{
+    if (!buf.initialized())
+        throw std::invalid_argument("ImageBuf is not initialized");
+    if (buf.deep())
+        throw std::invalid_argument("Can't view the pixels of a deep image");
+    const ImageSpec& spec(buf.spec());
+    const char* code = python_array_code(spec.format);
+    if (typedesc_from_python_array_code(code[0]) != spec.format)
+        throw std::invalid_argument(Strutil::sprintf(
+            "Can't view pixels of type %s as an array", spec.format));
+    // An ImageCache-backed image must be read into memory first.
+    if (buf.storage() == ImageBuf::IMAGECACHE) {
+        py::gil_scoped_release gil;
+        if (!buf.make_writeable(true))
+            throw std::runtime_error(buf.geterror());
+    }
+    void* pixels = buf.localpixels();  // non-const: unshares the memory
+    if (!pixels)
+        throw std::runtime_error("ImageBuf has no pixels in memory");
+    typedef py::ssize_t ssize;
+    const ssize chansize = ssize(spec.format.size());
+    std::vector<ssize> shape, strides;
+    if (spec.depth > 1) {
+        shape.assign({ spec.depth, spec.height, spec.width, spec.nchannels });
+        strides.assign({ ssize(buf.z_stride()), ssize(buf.scanline_stride()),
+                         ssize(buf.pixel_stride()), chansize });
+    } else {
+        shape.assign({ spec.height, spec.width, spec.nchannels });
+        strides.assign({ ssize(buf.scanline_stride()),
+                         ssize(buf.pixel_stride()), chansize });
+    }
+    return py::buffer_info(pixels, chansize, code, ssize(shape.size()), shape,
+                           strides);
+}
+
+
+
+// Construct an ImageBuf that wraps the memory of a writable Python buffer
+// (such as a NumPy array) indexed [y][x][channel], [z][y][x][channel], or
+// [y][x] for a single channel. Its pixels may be strided, but the channels
+// of each pixel must be contiguous.
+ImageBuf
+ImageBuf_from_buffer(py::buffer& buffer)
+{
+    py::buffer_info info = buffer.request(true /* writable */);
+    TypeDesc format;
+    if (info.format.size())
+        format = typedesc_from_python_array_code(info.format[0]);
+    if (format == TypeUnknown || size_t(info.itemsize) != format.size())
+        throw std::invalid_argument(
+            "ImageBuf: unsupported array data type " + info.format);
+    int z = -1, y, x, c = -1;  // which dimensions are which
+    if (info.ndim == 4)
+        z = 0, y = 1, x = 2, c = 3;
+    else if (info.ndim == 3)
+        y = 0, x = 1, c = 2;
+    else if (info.ndim == 2)
+        y = 0, x = 1;
+    else
+        throw std::invalid_argument(Strutil::sprintf(
+            "ImageBuf: can't wrap an array of %d dimensions", info.ndim));
+    if (c >= 0 && info.shape[c] > 1 && info.strides[c] != info.itemsize)
+        throw std::invalid_argument(
+            "ImageBuf: the channels of the wrapped array must be contiguous");
+    for (auto stride : info.strides)
+        if (stride <= 0)
+            throw std::invalid_argument(
+                "ImageBuf: the strides of the wrapped array must be positive");
+    ImageSpec spec(int(info.shape[x]), int(info.shape[y]),
+                   c >= 0 ? int(info.shape[c]) : 1, format);
+    if (z >= 0)
+        spec.depth = spec.full_depth = int(info.shape[z]);
+    return ImageBuf(spec, info.ptr, info.strides[x], info.strides[y],
+                    z >= 0 ? info.strides[z] : AutoStride);
+}
+
+
+
 void
 ImageBuf_set_deep_value(ImageBuf& buf, int x, int y, int z, int c, int s,
                         float value)
@@ -199,16 +283,63 @@ ImageBuf_set_pixels_buffer(ImageBuf& self, ROI roi, py::buffer& buffer)
 
 
 
+// Read many files at once, each into its own ImageBuf, without holding
+// the GIL. Failed reads still yield an ImageBuf, whose has_error and
+// geterror() explain what went wrong.
+py::list
+ImageBuf_read_images(const std::vector<std::string>& filenames, int nthreads,
+                     bool force, TypeDesc convert)
+{
+    std::vector<std::unique_ptr<ImageBuf>> bufs(filenames.size());
+    {
+        py::gil_scoped_release gil;
+        // The reads run on threads of their own, so they may block on I/O
+        // while the pool stays free for the decoding they do internally.
+        parallel_for_ordered(
+            0, int64_t(filenames.size()),
+            [&](int64_t i) {
+                bufs[i].reset(new ImageBuf(filenames[i]));
+                bufs[i]->read(0, 0, force, convert);
+            },
+            [](int64_t) {}, nthreads);
+    }
+    py::list result;
+    for (auto& buf : bufs)
+        result.append(py::cast(buf.release(),
+                               py::return_value_policy::take_ownership));
+    return result;
+}
+
+
+
 void
 declare_imagebuf(py::module& m)
 {
     using namespace pybind11::literals;
 
-    py::class_<ImageBuf>(m, "ImageBuf")
+    py::class_<ImageBuf>(m, "ImageBuf", py::buffer_protocol())
         .def(py::init<>())
         .def(py::init<const std::string&>())
         .def(py::init<const std::string&, int, int>())
         .def(py::init<const ImageSpec&>())
+        // Wrap the array's memory rather than copying it, so the array
+        // must outlive the ImageBuf.
+        .def(py::init([](py::buffer buffer) {
+                 return ImageBuf_from_buffer(buffer);
+             }),
+             "pixels"_a, py::keep_alive<1, 2>())
+        .def_buffer([](ImageBuf& self) {
+            // Exceptions can't cross the buffer protocol, so an image whose
+            // pixels can't be viewed presents itself as an empty array.
+            try {
+                return ImageBuf_buffer_info(self);
+            } catch (const std::exception&) {
+                static char none = 0;
+                return py::buffer_info(&none, 1, "B", 1,
+                                       std::vector<py::ssize_t> { 0 },
+                                       std::vector<py::ssize_t> { 1 });
+            }
+        })
         .def("clear", &ImageBuf::clear)
         .def("reset",
              [](ImageBuf& self, const std::string& name, int subimage,
@@ -369,6 +500,14 @@ declare_imagebuf(py::module& m)
         .def("get_pixels", &ImageBuf_get_pixels, "format"_a = TypeFloat,
              "roi"_a = ROI::All())
         .def("set_pixels", &ImageBuf_set_pixels_buffer, "roi"_a, "pixels"_a)
+        .def("as_numpy_view",
+             [](py::object self) {
+                 py::buffer_info info
+                     = ImageBuf_buffer_info(self.cast<ImageBuf&>());
+                 // The view keeps the ImageBuf alive
+                 return py::array(py::dtype(info), info.shape, info.strides,
+                                  info.ptr, self);
+             })
 
         .def_property_readonly("deep", &ImageBuf::deep)
         .def("deep_samples", &ImageBuf::deep_samples, "x"_a, "y"_a, "z"_a = 0)
@@ -391,6 +530,9 @@ declare_imagebuf(py::module& m)
 
         // FIXME -- do we want to provide pixel iterators?
         ;
+
+    m.def("read_images", &ImageBuf_read_images, "filenames"_a,
+          "nthreads"_a = 0, "force"_a = true, "convert"_a = TypeUnknown);
 }
 
 }  // namespace PyOpenImageIO
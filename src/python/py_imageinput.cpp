@@ -219,33 +219,55 @@ declare_imageinput(py::module& m)
         .def_static("create",
                     [](const std::string& filename,
                        const std::string& searchpath) -> py::object {
-                        auto in = ImageInput::create(filename, searchpath);
+                        std::unique_ptr<ImageInput> in;
+                        {
+                            py::gil_scoped_release gil;
+                            in = ImageInput::create(filename, searchpath);
+                        }
                         return in ? py::cast(in.release()) : py::none();
                     },
                     "filename"_a, "plugin_searchpath"_a = "")
         .def_static("open",
                     [](const std::string& filename) -> py::object {
-                        auto in = ImageInput::open(filename);
+                        std::unique_ptr<ImageInput> in;
+                        {
+                            py::gil_scoped_release gil;
+                            in = ImageInput::open(filename);
+                        }
                         return in ? py::cast(in.release()) : py::none();
                     },
                     "filename"_a)
         .def_static("open",
                     [](const std::string& filename,
                        const ImageSpec& config) -> py::object {
-                        auto in = ImageInput::open(filename, &config);
+                        std::unique_ptr<ImageInput> in;
+                        {
+                            py::gil_scoped_release gil;
+                            in = ImageInput::open(filename, &config);
+                        }
                         return in ? py::cast(in.release()) : py::none();
                     },
                     "filename"_a, "config"_a)
         .def("format_name", &ImageInput::format_name)
-        .def("valid_file", &ImageInput::valid_file)
-        .def("spec", [](ImageInput& self) { return self.spec(); })
+        .def("valid_file",
+             [](const ImageInput& self, const std::string& filename) {
+                 py::gil_scoped_release gil;
+                 return self.valid_file(filename);
+             })
+        .def("spec",
+             [](ImageInput& self) {
+                 py::gil_scoped_release gil;
+                 return ImageSpec(self.spec());
+             })
         .def("spec",
              [](ImageInput& self, int subimage, int miplevel) {
+                 py::gil_scoped_release gil;
                  return self.spec(subimage, miplevel);
              },
              "subimage"_a, "miplevel"_a = 0)
         .def("spec_dimensions",
              [](ImageInput& self, int subimage, int miplevel) {
+                 py::gil_scoped_release gil;
                  return self.spec_dimensions(subimage, miplevel);
              },
              "subimage"_a, "miplevel"_a = 0)
@@ -253,7 +275,11 @@ declare_imageinput(py::module& m)
              [](const ImageInput& self, const std::string& feature) {
                  return self.supports(feature);
              })
-        .def("close", &ImageInput::close)
+        .def("close",
+             [](ImageInput& self) {
+                 py::gil_scoped_release gil;
+                 return self.close();
+             })
         .def("current_subimage", &ImageInput::current_subimage)
         .def("current_miplevel", &ImageInput::current_miplevel)
         .def("seek_subimage",
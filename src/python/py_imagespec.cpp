@@ -73,7 +73,13 @@ ImageSpec_getattribute_typed(const ImageSpec& spec, const std::string& name,
                              TypeDesc type = TypeUnknown)
 {
     ParamValue tmpparam;
-    const ParamValue* p = spec.find_attribute(name, tmpparam, type);
+    const ParamValue* p;
+    {
+        // Searching a long attribute list, or synthesizing a value into
+        // tmpparam, doesn't need the interpreter.
+        py::gil_scoped_release gil;
+        p = spec.find_attribute(name, tmpparam, type);
+    }
     if (!p)
         return py::none();
     type = p->type();
@@ -205,13 +211,22 @@ declare_imagespec(py::module& m)
         // For now, do not expose auto_stride.  It's not obvious that
         // anybody will want to do pointer work and strides from Python.
 
-        .def("attribute", [](ImageSpec& spec, const std::string& name,
-                             float val) { spec.attribute(name, val); })
-        .def("attribute", [](ImageSpec& spec, const std::string& name,
-                             int val) { spec.attribute(name, val); })
+        .def("attribute",
+             [](ImageSpec& spec, const std::string& name, float val) {
+                 py::gil_scoped_release gil;
+                 spec.attribute(name, val);
+             })
+        .def("attribute",
+             [](ImageSpec& spec, const std::string& name, int val) {
+                 py::gil_scoped_release gil;
+                 spec.attribute(name, val);
+             })
         .def("attribute",
              [](ImageSpec& spec, const std::string& name,
-                const std::string& val) { spec.attribute(name, val); })
+                const std::string& val) {
+                 py::gil_scoped_release gil;
+                 spec.attribute(name, val);
+             })
         .def("attribute",
              [](ImageSpec& spec, const std::string& name, TypeDesc type,
                 const py::tuple& obj) {
@@ -222,29 +237,46 @@ declare_imagespec(py::module& m)
         //     })
         .def("get_int_attribute",
              [](const ImageSpec& spec, const std::string& name, int def) {
+                 py::gil_scoped_release gil;
                  return spec.get_int_attribute(name, def);
              },
              "name"_a, "defaultval"_a = 0)
         .def("get_float_attribute",
              [](const ImageSpec& spec, const std::string& name, float def) {
+                 py::gil_scoped_release gil;
                  return spec.get_float_attribute(name, def);
              },
              "name"_a, "defaultval"_a = 0.0f)
         .def("get_string_attribute",
              [](const ImageSpec& spec, const std::string& name,
                 const std::string& def) {
-                 return PY_STR(
-                     std::string(spec.get_string_attribute(name, def)));
+                 std::string val;
+                 {
+                     py::gil_scoped_release gil;
+                     val = spec.get_string_attribute(name, def);
+                 }
+                 return PY_STR(val);
              },
              "name"_a, "defaultval"_a = "")
         .def("getattribute", &ImageSpec_getattribute_typed, "name"_a,
              "type"_a = TypeUnknown)
-        .def("erase_attribute", &ImageSpec::erase_attribute, "name"_a = "",
+        .def("erase_attribute",
+             [](ImageSpec& spec, const std::string& name, TypeDesc type,
+                bool casesensitive) {
+                 py::gil_scoped_release gil;
+                 spec.erase_attribute(name, type, casesensitive);
+             },
+             "name"_a = "",
              "type"_a = TypeUnknown, "casesensitive"_a = false)
 
         .def_static("metadata_val",
                     [](const ParamValue& p, bool human) {
-                        return PY_STR(ImageSpec::metadata_val(p, human));
+                        std::string val;
+                        {
+                            py::gil_scoped_release gil;
+                            val = ImageSpec::metadata_val(p, human);
+                        }
+                        return PY_STR(val);
                     },
                     "param"_a, "human"_a = false)
         .def("serialize",
@@ -260,12 +292,44 @@ declare_imagespec(py::module& m)
                      verb = ImageSpec::SerialDetailed;
                  else if (Strutil::iequals(verbose, "detailedhuman"))
                      verb = ImageSpec::SerialDetailedHuman;
-                 return PY_STR(spec.serialize(fmt, verb));
+                 std::string str;
+                 {
+                     py::gil_scoped_release gil;
+                     str = spec.serialize(fmt, verb);
+                 }
+                 return PY_STR(str);
              },
              "format"_a = "text", "verbose"_a = "detailed")
         .def("to_xml",
-             [](const ImageSpec& spec) { return PY_STR(spec.to_xml()); })
-        .def("from_xml", &ImageSpec::from_xml)
+             [](const ImageSpec& spec) {
+                 std::string xml;
+                 {
+                     py::gil_scoped_release gil;
+                     xml = spec.to_xml();
+                 }
+                 return PY_STR(xml);
+             })
+        .def("from_xml",
+             [](ImageSpec& spec, const std::string& xml) {
+                 py::gil_scoped_release gil;
+                 spec.from_xml(xml.c_str());
+             })
+        .def("to_binary",
+             [](const ImageSpec& spec) {
+                 std::vector<char> blob;
+                 {
+                     py::gil_scoped_release gil;
+                     spec.to_binary(blob);
+                 }
+                 return py::bytes(blob.data(), blob.size());
+             })
+        .def("from_binary",
+             [](ImageSpec& spec, const py::bytes& data) {
+                 std::string blob = data;
+                 py::gil_scoped_release gil;
+                 return spec.from_binary(
+                     cspan<char>(blob.data(), blob.size()));
+             })
         .def("valid_tile_range", &ImageSpec::valid_tile_range, "xbegin"_a,
              "xend"_a, "ybegin"_a, "yend"_a, "zbegin"_a, "zend"_a)
         .def("copy_dimensions", &ImageSpec::copy_dimensions, "other"_a);
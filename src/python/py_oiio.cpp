@@ -182,6 +182,17 @@ oiio_bufinfo::oiio_bufinfo(const py::buffer_info& pybuf, int nchans, int width,
 
 
 
+// Setting some global attributes (e.g. "threads", "plugin_searchpath")
+// does real work, so don't hold the interpreter hostage while it happens.
+static bool
+oiio_attribute_nogil(const std::string& name, TypeDesc type, const void* val)
+{
+    py::gil_scoped_release gil;
+    return OIIO::attribute(name, type, val);
+}
+
+
+
 bool
 oiio_attribute_typed(const std::string& name, TypeDesc type,
                      const py::tuple& obj)
@@ -190,14 +201,14 @@ oiio_attribute_typed(const std::string& name, TypeDesc type,
         std::vector<int> vals;
         py_to_stdvector(vals, obj);
         if (vals.size() == type.numelements() * type.aggregate)
-            return OIIO::attribute(name, type, &vals[0]);
+            return oiio_attribute_nogil(name, type, &vals[0]);
         return false;
     }
     if (type.basetype == TypeDesc::FLOAT) {
         std::vector<float> vals;
         py_to_stdvector(vals, obj);
         if (vals.size() == type.numelements() * type.aggregate)
-            return OIIO::attribute(name, type, &vals[0]);
+            return oiio_attribute_nogil(name, type, &vals[0]);
         return false;
     }
     if (type.basetype == TypeDesc::STRING) {
@@ -207,7 +218,7 @@ oiio_attribute_typed(const std::string& name, TypeDesc type,
             std::vector<ustring> u;
             for (auto& val : vals)
                 u.emplace_back(val);
-            return OIIO::attribute(name, type, &u[0]);
+            return oiio_attribute_nogil(name, type, &u[0]);
         }
         return false;
     }
@@ -222,7 +233,12 @@ oiio_getattribute_typed(const std::string& name, TypeDesc type = TypeUnknown)
     if (type == TypeDesc::UNKNOWN)
         return py::none();
     char* data = OIIO_ALLOCA(char, type.size());
-    if (!OIIO::getattribute(name, type, data))
+    bool ok;
+    {
+        py::gil_scoped_release gil;
+        ok = OIIO::getattribute(name, type, data);
+    }
+    if (!ok)
         return py::none();
     if (type.basetype == TypeDesc::INT)
         return C_to_val_or_tuple((const int*)data, type);
@@ -255,17 +271,22 @@ OIIO_DECLARE_PYMODULE(OIIO_PYMODULE_NAME)
     declare_imageoutput(m);
     declare_imagebuf(m);
     declare_imagecache(m);
+    declare_texturesystem(m);
 
     declare_imagebufalgo(m);
 
     // Global (OpenImageIO scope) functions and symbols
     m.def("geterror", &OIIO::geterror);
     m.def("attribute", [](const std::string& name, float val) {
+        py::gil_scoped_release gil;
+        OIIO::attribute(name, val);
+    });
+    m.def("attribute", [](const std::string& name, int val) {
+        py::gil_scoped_release gil;
         OIIO::attribute(name, val);
     });
-    m.def("attribute",
-          [](const std::string& name, int val) { OIIO::attribute(name, val); });
     m.def("attribute", [](const std::string& name, const std::string& val) {
+        py::gil_scoped_release gil;
         OIIO::attribute(name, val);
     });
     m.def("attribute",
@@ -275,16 +296,19 @@ OIIO_DECLARE_PYMODULE(OIIO_PYMODULE_NAME)
 
     m.def("get_int_attribute",
           [](const std::string& name, int def) {
+              py::gil_scoped_release gil;
               return OIIO::get_int_attribute(name, def);
           },
           py::arg("name"), py::arg("defaultval") = 0);
     m.def("get_float_attribute",
           [](const std::string& name, float def) {
+              py::gil_scoped_release gil;
               return OIIO::get_float_attribute(name, def);
           },
           py::arg("name"), py::arg("defaultval") = 0.0f);
     m.def("get_string_attribute",
           [](const std::string& name, const std::string& def) {
+              py::gil_scoped_release gil;
               return std::string(OIIO::get_string_attribute(name, def));
           },
           py::arg("name"), py::arg("defaultval") = "");
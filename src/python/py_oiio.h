@@ -86,6 +86,7 @@ void declare_typedesc (py::module& m);
 void declare_roi (py::module& m);
 void declare_deepdata (py::module& m);
 void declare_imagecache (py::module& m);
+void declare_texturesystem (py::module& m);
 void declare_imagebuf (py::module& m);
 void declare_imagebufalgo (py::module& m);
 void declare_paramvalue (py::module& m);
@@ -117,20 +117,30 @@ declare_paramvalue(py::module& m)
         .def("resize", [](ParamValueList& p, size_t s) { return p.resize(s); })
         .def("remove",
              [](ParamValueList& p, const std::string& name, TypeDesc type,
-                bool casesensitive) { p.remove(name, type, casesensitive); },
+                bool casesensitive) {
+                 py::gil_scoped_release gil;
+                 p.remove(name, type, casesensitive);
+             },
              "name"_a, "type"_a = TypeUnknown, "casesensitive"_a = true)
         .def("contains",
              [](ParamValueList& p, const std::string& name, TypeDesc type,
                 bool casesensitive) {
+                 py::gil_scoped_release gil;
                  return p.contains(name, type, casesensitive);
              },
              "name"_a, "type"_a = TypeUnknown, "casesensitive"_a = true)
         .def("add_or_replace",
              [](ParamValueList& p, const ParamValue& pv, bool casesensitive) {
+                 py::gil_scoped_release gil;
                  return p.add_or_replace(pv, casesensitive);
              },
              "value"_a, "casesensitive"_a = true)
-        .def("sort", &ParamValueList::sort, "casesensitive"_a = true);
+        .def("sort",
+             [](ParamValueList& p, bool casesensitive) {
+                 py::gil_scoped_release gil;
+                 p.sort(casesensitive);
+             },
+             "casesensitive"_a = true);
 }
 
 }  // namespace PyOpenImageIO
@@ -0,0 +1,302 @@
+/*
+  Copyright 2009 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#include "py_oiio.h"
+
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/texture.h>
+
+namespace PyOpenImageIO {
+
+typedef py::array_t<float, py::array::c_style | py::array::forcecast>
+    FloatArray;
+
+
+// Make a special wrapper to help with the weirdo way we use create/destroy.
+class TextureSystemWrap {
+public:
+    struct TSDeleter {
+        void operator()(TextureSystem* p) const { TextureSystem::destroy(p); }
+    };
+    std::unique_ptr<TextureSystem, TSDeleter> m_texsys;
+
+    TextureSystemWrap(bool shared = true)
+        : m_texsys(TextureSystem::create(shared))
+    {
+    }
+    TextureSystemWrap(const TextureSystemWrap&) = delete;
+    TextureSystemWrap(TextureSystemWrap&&)      = delete;
+    ~TextureSystemWrap() {}  // will call the deleter on the TS
+    static void destroy(TextureSystemWrap* x, bool teardown = false)
+    {
+        TextureSystem::destroy(x->m_texsys.release(), teardown);
+    }
+    py::object texture(const std::string& filename, const TextureOpt& opt,
+                       const py::object& s, const py::object& t,
+                       const py::object& dsdx, const py::object& dtdx,
+                       const py::object& dsdy, const py::object& dtdy,
+                       int nchannels, bool derivs);
+};
+
+
+
+// Convert obj to a contiguous float array. If n is given, it must hold
+// exactly n values, and None yields n zeroes.
+static FloatArray
+float_array(const py::object& obj, const char* name,
+            size_t n = std::numeric_limits<size_t>::max())
+{
+    bool sized = (n != std::numeric_limits<size_t>::max());
+    if (obj.is_none()) {
+        if (!sized)
+            throw std::invalid_argument(
+                Strutil::sprintf("texture: %s may not be None", name));
+        FloatArray zeros(n);
+        std::fill_n(zeros.mutable_data(), n, 0.0f);
+        return zeros;
+    }
+    FloatArray a = FloatArray::ensure(obj);
+    if (!a)
+        throw std::invalid_argument(
+            Strutil::sprintf("texture: %s is not convertible to a float array",
+                             name));
+    if (sized && size_t(a.size()) != n)
+        throw std::invalid_argument(
+            Strutil::sprintf("texture: %s has %d values, expected %d", name,
+                             a.size(), n));
+    return a;
+}
+
+
+
+py::object
+TextureSystemWrap::texture(const std::string& filename_, const TextureOpt& opt,
+                           const py::object& s_, const py::object& t_,
+                           const py::object& dsdx_, const py::object& dtdx_,
+                           const py::object& dsdy_, const py::object& dtdy_,
+                           int nchannels, bool derivs)
+{
+    if (nchannels < 1)
+        throw std::invalid_argument("texture: nchannels must be at least 1");
+    FloatArray s    = float_array(s_, "s");
+    FloatArray t    = float_array(t_, "t");
+    size_t npoints  = size_t(s.size());
+    if (size_t(t.size()) != npoints)
+        throw std::invalid_argument("texture: s and t differ in size");
+    FloatArray dsdx = float_array(dsdx_, "dsdx", npoints);
+    FloatArray dtdx = float_array(dtdx_, "dtdx", npoints);
+    FloatArray dsdy = float_array(dsdy_, "dsdy", npoints);
+    FloatArray dtdy = float_array(dtdy_, "dtdy", npoints);
+    if (npoints > size_t(std::numeric_limits<int>::max()))
+        throw std::invalid_argument("texture: too many points");
+
+    // Results have the shape of s with a trailing channel axis.
+    std::vector<size_t> shape(s.shape(), s.shape() + s.ndim());
+    shape.push_back(size_t(nchannels));
+    py::array_t<float> result(shape), dresultds, dresultdt;
+    if (derivs) {
+        dresultds = py::array_t<float>(shape);
+        dresultdt = py::array_t<float>(shape);
+    }
+
+    // Grab all the raw pointers while we still hold the GIL. Missing
+    // derivatives were filled with zeroes, meaning point sampling.
+    const float* sp    = s.data();
+    const float* tp    = t.data();
+    const float* dsdxp = dsdx.data();
+    const float* dtdxp = dtdx.data();
+    const float* dsdyp = dsdy.data();
+    const float* dtdyp = dtdy.data();
+    float* rp          = result.mutable_data();
+    float* dsp         = derivs ? dresultds.mutable_data() : nullptr;
+    float* dtp         = derivs ? dresultdt.mutable_data() : nullptr;
+
+    std::atomic<bool> ok(true);
+    {
+        py::gil_scoped_release gil;
+        TextureSystem* ts = m_texsys.get();
+        TextureSystem::TextureHandle* handle
+            = ts->get_texture_handle(ustring(filename_));
+        // Split the points into chunks big enough for texture_coherent to
+        // find tile coherence within each, and spread them over the pool.
+        parallel_for_chunked(
+            0, int64_t(npoints), 4096,
+            [&](int /*id*/, int64_t b, int64_t e) {
+                TextureSystem::Perthread* thread_info
+                    = ts->get_perthread_info();
+                TextureOpt o(opt);
+                size_t rb = size_t(b) * nchannels;
+                if (!ts->texture_coherent(handle, thread_info, o, int(e - b),
+                                          sp + b, tp + b, dsdxp + b,
+                                          dtdxp + b, dsdyp + b, dtdyp + b,
+                                          nchannels, rp + rb,
+                                          dsp ? dsp + rb : nullptr,
+                                          dtp ? dtp + rb : nullptr))
+                    ok = false;
+            });
+    }
+    if (!ok)
+        return py::none();
+    if (derivs)
+        return py::make_tuple(result, dresultds, dresultdt);
+    return result;
+}
+
+
+
+void
+declare_texturesystem(py::module& m)
+{
+    using namespace pybind11::literals;
+
+    py::class_<TextureOpt> textureopt(m, "TextureOpt");
+
+    py::enum_<TextureOpt::Wrap>(textureopt, "Wrap")
+        .value("WrapDefault", TextureOpt::WrapDefault)
+        .value("WrapBlack", TextureOpt::WrapBlack)
+        .value("WrapClamp", TextureOpt::WrapClamp)
+        .value("WrapPeriodic", TextureOpt::WrapPeriodic)
+        .value("WrapMirror", TextureOpt::WrapMirror)
+        .value("WrapPeriodicPow2", TextureOpt::WrapPeriodicPow2)
+        .value("WrapPeriodicSharedBorder",
+               TextureOpt::WrapPeriodicSharedBorder)
+        .export_values();
+
+    py::enum_<TextureOpt::MipMode>(textureopt, "MipMode")
+        .value("MipModeDefault", TextureOpt::MipModeDefault)
+        .value("MipModeNoMIP", TextureOpt::MipModeNoMIP)
+        .value("MipModeOneLevel", TextureOpt::MipModeOneLevel)
+        .value("MipModeTrilinear", TextureOpt::MipModeTrilinear)
+        .value("MipModeAniso", TextureOpt::MipModeAniso)
+        .value("MipModeEWA", TextureOpt::MipModeEWA)
+        .value("MipModeSummedArea", TextureOpt::MipModeSummedArea)
+        .export_values();
+
+    py::enum_<TextureOpt::InterpMode>(textureopt, "InterpMode")
+        .value("InterpClosest", TextureOpt::InterpClosest)
+        .value("InterpBilinear", TextureOpt::InterpBilinear)
+        .value("InterpBicubic", TextureOpt::InterpBicubic)
+        .value("InterpSmartBicubic", TextureOpt::InterpSmartBicubic)
+        .export_values();
+
+    textureopt.def(py::init<>())
+        .def_readwrite("firstchannel", &TextureOpt::firstchannel)
+        .def_readwrite("subimage", &TextureOpt::subimage)
+        .def_property("subimagename",
+                      [](const TextureOpt& o) {
+                          return PY_STR(o.subimagename.string());
+                      },
+                      [](TextureOpt& o, const std::string& name) {
+                          o.subimagename = ustring(name);
+                      })
+        .def_readwrite("swrap", &TextureOpt::swrap)
+        .def_readwrite("twrap", &TextureOpt::twrap)
+        .def_readwrite("mipmode", &TextureOpt::mipmode)
+        .def_readwrite("interpmode", &TextureOpt::interpmode)
+        .def_readwrite("anisotropic", &TextureOpt::anisotropic)
+        .def_readwrite("conservative_filter",
+                       &TextureOpt::conservative_filter)
+        .def_readwrite("sblur", &TextureOpt::sblur)
+        .def_readwrite("tblur", &TextureOpt::tblur)
+        .def_readwrite("swidth", &TextureOpt::swidth)
+        .def_readwrite("twidth", &TextureOpt::twidth)
+        .def_readwrite("fill", &TextureOpt::fill)
+        .def_readwrite("time", &TextureOpt::time)
+        .def_readwrite("bias", &TextureOpt::bias)
+        .def_readwrite("samples", &TextureOpt::samples);
+
+    py::class_<TextureSystemWrap>(m, "TextureSystem")
+        .def(py::init<bool>(), "shared"_a = true)
+        .def_static("destroy", &TextureSystemWrap::destroy, "texsys"_a,
+                    "teardown_imagecache"_a = false)
+
+        .def("attribute",
+             [](TextureSystemWrap& ts, const std::string& name, float val) {
+                 if (ts.m_texsys)
+                     ts.m_texsys->attribute(name, val);
+             })
+        .def("attribute",
+             [](TextureSystemWrap& ts, const std::string& name, int val) {
+                 if (ts.m_texsys)
+                     ts.m_texsys->attribute(name, val);
+             })
+        .def("attribute",
+             [](TextureSystemWrap& ts, const std::string& name,
+                const std::string& val) {
+                 if (ts.m_texsys)
+                     ts.m_texsys->attribute(name, val);
+             })
+        .def("attribute",
+             [](TextureSystemWrap& ts, const std::string& name, TypeDesc type,
+                const py::object& obj) {
+                 if (ts.m_texsys)
+                     attribute_typed(*ts.m_texsys, name, type, obj);
+             })
+        .def("getattribute",
+             [](const TextureSystemWrap& ts, const std::string& name,
+                TypeDesc type) {
+                 return getattribute_typed(*ts.m_texsys, name, type);
+             },
+             "name"_a, "type"_a = TypeUnknown)
+        .def("resolve_filename",
+             [](TextureSystemWrap& ts, const std::string& filename) {
+                 py::gil_scoped_release gil;
+                 return PY_STR(ts.m_texsys->resolve_filename(filename));
+             })
+        .def("texture", &TextureSystemWrap::texture, "filename"_a, "opt"_a,
+             "s"_a, "t"_a, "dsdx"_a = py::none(), "dtdx"_a = py::none(),
+             "dsdy"_a = py::none(), "dtdy"_a = py::none(),
+             "nchannels"_a = 3, "derivs"_a = false)
+
+        .def("geterror",
+             [](TextureSystemWrap& ts) {
+                 return PY_STR(ts.m_texsys->geterror());
+             })
+        .def("getstats",
+             [](TextureSystemWrap& ts, int level) {
+                 py::gil_scoped_release gil;
+                 return PY_STR(ts.m_texsys->getstats(level));
+             },
+             "level"_a = 1)
+        .def("invalidate",
+             [](TextureSystemWrap& ts, const std::string& filename) {
+                 py::gil_scoped_release gil;
+                 ts.m_texsys->invalidate(ustring(filename));
+             },
+             "filename"_a)
+        .def("invalidate_all",
+             [](TextureSystemWrap& ts, bool force) {
+                 py::gil_scoped_release gil;
+                 ts.m_texsys->invalidate_all(force);
+             },
+             "force"_a = false);
+}
+
+}  // namespace PyOpenImageIO
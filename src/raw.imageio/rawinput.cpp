@@ -29,6 +29,8 @@
 */
 
 #include <algorithm>
+#include <csetjmp>
+#include <cstdio>
 #include <ctime> /* time_t, struct tm, gmtime */
 #include <iostream>
 #include <memory>
@@ -57,6 +59,20 @@ template<class T> using auto_ptr = unique_ptr<T>;
 #include <libraw/libraw.h>
 #include <libraw/libraw_version.h>
 
+#ifdef WIN32
+#    undef FAR
+#    define XMD_H
+#endif
+extern "C" {
+#include "jpeglib.h"
+}
+
+// libjpeg 8 and libjpeg-turbo can decode straight from memory, which is
+// what we need for the JPEG previews embedded in most raw files.
+#if defined(MEM_SRCDST_SUPPORTED) || JPEG_LIB_VERSION >= 80
+#    define RAW_JPEG_PREVIEW 1
+#endif
+
 
 // This plugin utilises LibRaw:
 //   http://www.libraw.org/
@@ -91,12 +107,19 @@ private:
     bool m_unpacked = false;
     std::unique_ptr<LibRaw> m_processor;
     libraw_processed_image_t* m_image = nullptr;
+    std::vector<unsigned char> m_preview;  // Decoded embedded preview
     std::string m_filename;
     ImageSpec m_config;  // save config requests
     std::string m_make;
 
     bool do_unpack();
 
+    // Replace the raw image with the camera's embedded preview, if it has
+    // one we can decode.
+    bool open_preview();
+    bool decode_jpeg_preview(const unsigned char* data, size_t size,
+                             int& width, int& height);
+
     // Do the actual open. It expects m_filename and m_config to be set.
     bool open_raw(bool unpack, const std::string& name,
                   const ImageSpec& config);
@@ -356,6 +379,10 @@ RawInput::open(const std::string& name, ImageSpec& newspec,
     // will need to close and re-open with unpack=true if and when we need
     // the actual pixel values.
     bool ok = open_raw(false, m_filename, m_config);
+    // If asked for the embedded preview, that's what we'll present; if
+    // there isn't a usable one, just carry on with the raw image.
+    if (ok && m_config.get_int_attribute("raw:Preview"))
+        open_preview();
     if (ok)
         newspec = m_spec;
     return ok;
@@ -385,6 +412,14 @@ RawInput::open_raw(bool unpack, const std::string& name,
         return false;
     }
 
+    // Half size decoding skips demosaicing altogether, making one RGB pixel
+    // of each 2x2 block of the Bayer pattern. It has to be set before the
+    // sizes are computed. It means nothing for raw:Demosaic "none".
+    if (config.get_int_attribute("raw:HalfSize")
+        && !Strutil::iequals(config.get_string_attribute("raw:Demosaic"),
+                             "none"))
+        m_processor->imgdata.params.half_size = 1;
+
     ASSERT(!m_unpacked);
     if (unpack) {
         if ((ret = m_processor->unpack()) != LIBRAW_SUCCESS) {
@@ -402,6 +437,8 @@ RawInput::open_raw(bool unpack, const std::string& name,
                        TypeDesc::UINT16);
     // Move the exif attribs we already read into the spec we care about
     m_spec.extra_attribs.swap(exifspec.extra_attribs);
+    if (m_processor->imgdata.params.half_size)
+        m_spec.attribute("raw:HalfSize", 1);
 
     // Output 16 bit images
     m_processor->imgdata.params.output_bps = 16;
@@ -1089,6 +1126,7 @@ RawInput::close()
         LibRaw::dcraw_clear_mem(m_image);
         m_image = nullptr;
     }
+    m_preview.clear();
     m_processor.reset();
     m_unpacked = false;
     m_process  = true;
@@ -1113,6 +1151,107 @@ RawInput::do_unpack()
 
 
 
+bool
+RawInput::open_preview()
+{
+    if (m_processor->unpack_thumb() != LIBRAW_SUCCESS)
+        return false;
+    int ret                          = 0;
+    libraw_processed_image_t* thumb = m_processor->dcraw_make_mem_thumb(&ret);
+    if (!thumb)
+        return false;
+    bool ok    = false;
+    int width  = 0;
+    int height = 0;
+    if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->colors == 3
+        && thumb->bits == 8) {
+        width  = thumb->width;
+        height = thumb->height;
+        m_preview.assign(thumb->data, thumb->data + thumb->data_size);
+        ok = true;
+    }
+#ifdef RAW_JPEG_PREVIEW
+    else if (thumb->type == LIBRAW_IMAGE_JPEG) {
+        ok = decode_jpeg_preview(thumb->data, thumb->data_size, width,
+                                 height);
+    }
+#endif
+    LibRaw::dcraw_clear_mem(thumb);
+    if (!ok || m_preview.size() != size_t(width) * height * 3) {
+        m_preview.clear();
+        return false;
+    }
+
+    m_spec.width = m_spec.full_width = width;
+    m_spec.height = m_spec.full_height = height;
+    m_spec.nchannels                   = 3;
+    m_spec.set_format(TypeDesc::UINT8);
+    m_spec.default_channel_names();
+    m_spec.attribute("raw:Preview", 1);
+    m_spec.erase_attribute("raw:HalfSize");
+    // Unlike the raw image, libraw does not reorient the preview, so put
+    // back whatever orientation the camera recorded.
+    m_spec.attribute("Orientation",
+                     m_spec.get_int_attribute("raw:Orientation", 1));
+    return true;
+}
+
+
+
+#ifdef RAW_JPEG_PREVIEW
+namespace {
+struct preview_error_mgr {
+    jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+};
+}  // namespace
+
+static void
+preview_error_exit(j_common_ptr cinfo)
+{
+    preview_error_mgr* mgr = (preview_error_mgr*)cinfo->err;
+    longjmp(mgr->setjmp_buffer, 1);
+}
+#endif
+
+
+
+bool
+RawInput::decode_jpeg_preview(const unsigned char* data, size_t size,
+                              int& width, int& height)
+{
+#ifdef RAW_JPEG_PREVIEW
+    jpeg_decompress_struct cinfo;
+    preview_error_mgr jerr;
+    cinfo.err           = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = preview_error_exit;
+    if (setjmp(jerr.setjmp_buffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char*)data, (unsigned long)size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+    width         = cinfo.output_width;
+    height        = cinfo.output_height;
+    size_t stride = size_t(width) * 3;
+    m_preview.resize(stride * height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = &m_preview[cinfo.output_scanline * stride];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
 bool
 RawInput::process()
 {
@@ -1155,6 +1294,12 @@ RawInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     if (y < 0 || y >= m_spec.height)  // out of range scanline
         return false;
 
+    if (!m_preview.empty()) {
+        memcpy(data, &m_preview[y * m_spec.scanline_bytes(true)],
+               m_spec.scanline_bytes(true));
+        return true;
+    }
+
     if (!m_unpacked)
         do_unpack();
 
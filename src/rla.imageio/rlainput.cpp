@@ -28,15 +28,19 @@
   (This is the Modified BSD License)
 */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <limits>
 
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/typedesc.h>
 
 #include "rla_pvt.h"
@@ -61,22 +65,24 @@ public:
     virtual bool close() override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     std::string m_filename;            ///< Stash the filename
     FILE* m_file;                      ///< Open image handle
     RLAHeader m_rla;                   ///< Wavefront RLA header
-    std::vector<unsigned char> m_buf;  ///< Buffer the image pixels
     int m_subimage;                    ///< Current subimage index
     std::vector<uint32_t> m_sot;       ///< Scanline offsets table
+    int64_t m_filesize;                ///< Size of the whole file
     int m_stride;                      ///< Number of bytes a contig pixel takes
 
     /// Reset everything to initial state
     ///
     void init()
     {
-        m_file = NULL;
-        m_buf.clear();
+        m_file     = NULL;
+        m_filesize = 0;
     }
 
     /// Helper: raw read, with error detection
@@ -111,17 +117,26 @@ private:
     ///
     inline bool read_header();
 
-    /// Helper: read and decode a single channel group consisting of
-    /// channels [first_channel .. first_channel+num_channels-1], which
-    /// all share the same number of significant bits.
+    /// Helper: decode a single channel group consisting of channels
+    /// [first_channel .. first_channel+num_channels-1], which all share
+    /// the same number of significant bits, from the records starting at
+    /// in (and not going past end) into the scanline buf.  Advance in
+    /// past the records consumed.  Return false if they're malformed.
     bool decode_channel_group(int first_channel, short num_channels,
-                              short num_bits, int y);
+                              short num_bits, const char*& in,
+                              const char* end, unsigned char* buf) const;
+
+    /// Helper: decode the whole RLE record of one scanline, which spans
+    /// [in, end) or less, into buf (one native scanline).
+    bool decode_scanline(const char* in, const char* end,
+                         unsigned char* buf) const;
 
     /// Helper: decode a span of n RLE-encoded bytes from encoded[0..elen-1]
     /// into buf[0],buf[stride],buf[2*stride]...buf[(n-1)*stride].
-    /// Return the number of encoded bytes we ate to fill buf.
-    size_t decode_rle_span(unsigned char* buf, int n, int stride,
-                           const char* encoded, size_t elen);
+    /// Return the number of encoded bytes we ate to fill buf, or 0 if
+    /// the record was malformed.
+    static size_t decode_rle_span(unsigned char* buf, int n, int stride,
+                                  const char* encoded, size_t elen);
 
     /// Helper: determine channel TypeDesc
     inline TypeDesc get_channel_typedesc(short chan_type, short chan_bits);
@@ -187,6 +202,7 @@ RLAInput::open(const std::string& name, ImageSpec& newspec)
         error("Could not open file \"%s\"", name.c_str());
         return false;
     }
+    m_filesize = Filesystem::file_size(name);
 
     // set a bogus subimage index so that seek_subimage actually seeks
     m_subimage = 1;
@@ -505,18 +521,15 @@ RLAInput::decode_rle_span(unsigned char* buf, int n, int stride,
                 *buf = encoded[e++];
         }
     }
-    if (n != 0) {
-        error("Read error: malformed RLE record");
-        return 0;
-    }
-    return e;
+    return n == 0 ? e : 0;
 }
 
 
 
 bool
 RLAInput::decode_channel_group(int first_channel, short num_channels,
-                               short num_bits, int y)
+                               short num_bits, const char*& in,
+                               const char* end, unsigned char* buf) const
 {
     // Some preliminaries -- figure out various sizes and offsets
     int chsize;         // size of the channels in this group, in bytes
@@ -539,31 +552,26 @@ RLAInput::decode_channel_group(int first_channel, short num_channels,
             offset += m_spec.channelformats[i].size();
     }
 
-    // Read the big-endian values into the buffer.
     // The channels are simply contatenated together in order.
-    // Each channel starts with a length, from which we know how many
-    // bytes of encoded RLE data to read.  Then there are RLE
+    // Each channel starts with a big-endian length, from which we know
+    // how many bytes of encoded RLE data follow.  Then there are RLE
     // spans for each 8-bit slice of the channel.
-    std::vector<char> encoded;
     for (int c = 0; c < num_channels; ++c) {
-        // Read the length
-        uint16_t length;  // number of encoded bytes
-        if (!read(&length)) {
-            error("Read error: couldn't read RLE record length");
+        if (end - in < 2)
             return false;
-        }
-        // Read the encoded RLE record
-        encoded.resize(length);
-        if (!read(&encoded[0], length)) {
-            error("Read error: couldn't read RLE data span");
+        size_t length = ((unsigned char)in[0] << 8) | (unsigned char)in[1];
+        const char* encoded = in + 2;
+        if (size_t(end - encoded) < length)
             return false;
-        }
+        in = encoded + length;
 
         if (chantype == TypeDesc::FLOAT) {
             // Special case -- float data is just dumped raw, no RLE
+            if (length < m_spec.width * sizeof(float))
+                return false;
             for (int x = 0; x < m_spec.width; ++x)
-                *((float*)&m_buf[offset + c * chsize + x * pixelsize])
-                    = ((float*)&encoded[0])[x];
+                memcpy(&buf[offset + c * chsize + x * pixelsize],
+                       encoded + x * sizeof(float), sizeof(float));
             continue;
         }
 
@@ -572,9 +580,9 @@ RLAInput::decode_channel_group(int first_channel, short num_channels,
         // and strides to decode_rle_span.
         size_t eoffset = 0;
         for (int bytes = 0; bytes < chsize; ++bytes) {
-            size_t e = decode_rle_span(&m_buf[offset + c * chsize + bytes],
+            size_t e = decode_rle_span(&buf[offset + c * chsize + bytes],
                                        m_spec.width, pixelsize,
-                                       &encoded[eoffset], length);
+                                       encoded + eoffset, length - eoffset);
             if (!e)
                 return false;
             eoffset += e;
@@ -586,17 +594,17 @@ RLAInput::decode_channel_group(int first_channel, short num_channels,
     if (littleendian()) {
         if (chsize == 2) {
             if (num_channels == m_spec.nchannels)
-                swap_endian((uint16_t*)&m_buf[0], num_channels * m_spec.width);
+                swap_endian((uint16_t*)&buf[0], num_channels * m_spec.width);
             else
                 for (int x = 0; x < m_spec.width; ++x)
-                    swap_endian((uint16_t*)&m_buf[offset + x * pixelsize],
+                    swap_endian((uint16_t*)&buf[offset + x * pixelsize],
                                 num_channels);
         } else if (chsize == 4 && chantype != TypeDesc::FLOAT) {
             if (num_channels == m_spec.nchannels)
-                swap_endian((uint32_t*)&m_buf[0], num_channels * m_spec.width);
+                swap_endian((uint32_t*)&buf[0], num_channels * m_spec.width);
             else
                 for (int x = 0; x < m_spec.width; ++x)
-                    swap_endian((uint32_t*)&m_buf[offset + x * pixelsize],
+                    swap_endian((uint32_t*)&buf[offset + x * pixelsize],
                                 num_channels);
         }
     }
@@ -610,28 +618,28 @@ RLAInput::decode_channel_group(int first_channel, short num_channels,
     } else if (num_bits == 10) {
         // fast, common case -- use templated hard-code
         for (int x = 0; x < m_spec.width; ++x) {
-            uint16_t* b = (uint16_t*)(&m_buf[offset + x * pixelsize]);
+            uint16_t* b = (uint16_t*)(&buf[offset + x * pixelsize]);
             for (int c = 0; c < num_channels; ++c)
                 b[c] = bit_range_convert<10, 16>(b[c]);
         }
     } else if (num_bits < 8) {
         // rare case, use slow code to make this clause short and simple
         for (int x = 0; x < m_spec.width; ++x) {
-            uint8_t* b = (uint8_t*)&m_buf[offset + x * pixelsize];
+            uint8_t* b = (uint8_t*)&buf[offset + x * pixelsize];
             for (int c = 0; c < num_channels; ++c)
                 b[c] = bit_range_convert(b[c], num_bits, 8);
         }
     } else if (num_bits > 8 && num_bits < 16) {
         // rare case, use slow code to make this clause short and simple
         for (int x = 0; x < m_spec.width; ++x) {
-            uint16_t* b = (uint16_t*)&m_buf[offset + x * pixelsize];
+            uint16_t* b = (uint16_t*)&buf[offset + x * pixelsize];
             for (int c = 0; c < num_channels; ++c)
                 b[c] = bit_range_convert(b[c], num_bits, 16);
         }
     } else if (num_bits > 16 && num_bits < 32) {
         // rare case, use slow code to make this clause short and simple
         for (int x = 0; x < m_spec.width; ++x) {
-            uint32_t* b = (uint32_t*)&m_buf[offset + x * pixelsize];
+            uint32_t* b = (uint32_t*)&buf[offset + x * pixelsize];
             for (int c = 0; c < num_channels; ++c)
                 b[c] = bit_range_convert(b[c], num_bits, 32);
         }
@@ -642,50 +650,108 @@ RLAInput::decode_channel_group(int first_channel, short num_channels,
 
 
 bool
-RLAInput::read_native_scanline(int subimage, int miplevel, int y, int z,
-                               void* data)
+RLAInput::decode_scanline(const char* in, const char* end,
+                          unsigned char* buf) const
 {
-    lock_guard lock(m_mutex);
-    if (!seek_subimage(subimage, miplevel))
-        return false;
-
-    // By convention, RLA images store their images bottom-to-top.
-    y = m_spec.height - (y - m_spec.y) - 1;
-
-    // Seek to scanline start, based on the scanline offset table
-    fseek(m_file, m_sot[y], SEEK_SET);
-
-    // Now decode and interleave the channels.
     // The channels are non-interleaved (i.e. rrrrrgggggbbbbb...).
     // Color first, then matte, then auxiliary channels.  We can't
     // decode all in one shot, though, because the data type and number
     // of significant bits may be may be different for each class of
     // channels, so we deal with them separately and interleave into
     // our buffer as we go.
-    size_t size = m_spec.scanline_bytes(true);
-    m_buf.resize(size);
     if (m_rla.NumOfColorChannels > 0)
         if (!decode_channel_group(0, m_rla.NumOfColorChannels,
-                                  m_rla.NumOfChannelBits, y))
+                                  m_rla.NumOfChannelBits, in, end, buf))
             return false;
     if (m_rla.NumOfMatteChannels > 0)
         if (!decode_channel_group(m_rla.NumOfColorChannels,
                                   m_rla.NumOfMatteChannels,
-                                  m_rla.NumOfMatteBits, y))
+                                  m_rla.NumOfMatteBits, in, end, buf))
             return false;
     if (m_rla.NumOfAuxChannels > 0)
         if (!decode_channel_group(m_rla.NumOfColorChannels
                                       + m_rla.NumOfMatteChannels,
                                   m_rla.NumOfAuxChannels, m_rla.NumOfAuxBits,
-                                  y))
+                                  in, end, buf))
             return false;
-
-    memcpy(data, &m_buf[0], size);
     return true;
 }
 
 
 
+bool
+RLAInput::read_native_scanline(int subimage, int miplevel, int y, int z,
+                               void* data)
+{
+    return read_native_scanlines(subimage, miplevel, y, y + 1, z, data);
+}
+
+
+
+bool
+RLAInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    yend = std::min(yend, m_spec.y + m_spec.height);
+    if (ybegin >= yend)
+        return true;
+
+    // By convention, RLA images store their images bottom-to-top, so
+    // the row for scanline y is m_sot[m_spec.height - (y - m_spec.y) - 1].
+    // The records of the requested scanlines are usually one contiguous
+    // stretch of the file, so find its extent and read it in one go.
+    // A record ends where the next one in the file begins (or at the
+    // next subimage, or the end of the file).
+    int64_t lo = std::numeric_limits<int64_t>::max(), last = 0;
+    for (int y = ybegin; y < yend; ++y) {
+        int64_t off = m_sot[m_spec.height - (y - m_spec.y) - 1];
+        lo          = std::min(lo, off);
+        last        = std::max(last, off);
+    }
+    int64_t hi = m_rla.NextOffset > last ? int64_t(m_rla.NextOffset)
+                                         : m_filesize;
+    for (uint32_t off : m_sot)
+        if (off > last)
+            hi = std::min(hi, int64_t(off));
+    if (lo >= hi) {
+        error("Corrupt scanline offset table");
+        return false;
+    }
+    std::vector<char> encoded(size_t(hi - lo));
+    if (fseek(m_file, lo, SEEK_SET) != 0
+        || ::fread(encoded.data(), 1, encoded.size(), m_file)
+               != encoded.size()) {
+        error("Read error: couldn't read scanlines %d-%d", ybegin, yend - 1);
+        return false;
+    }
+
+    // Each scanline is its own RLE record, so decode them in parallel,
+    // straight into the caller's buffer.
+    const size_t size = m_spec.scanline_bytes(true);
+    std::atomic<bool> ok(true);
+    parallel_for_chunked(
+        ybegin, yend, 0,
+        [&](int64_t b, int64_t e) {
+            for (int64_t y = b; y < e && ok; ++y) {
+                size_t off = m_sot[m_spec.height - (y - m_spec.y) - 1] - lo;
+                if (!decode_scanline(&encoded[off],
+                                     encoded.data() + encoded.size(),
+                                     (unsigned char*)data
+                                         + (y - ybegin) * size))
+                    ok = false;
+            }
+        },
+        parallel_options(threads(), Split_Y, 16));
+    if (!ok)
+        error("Read error: malformed RLE record");
+    return ok;
+}
+
+
+
 inline int
 RLAInput::get_month_number(const char* s)
 {
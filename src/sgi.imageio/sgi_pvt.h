@@ -98,6 +98,8 @@ public:
     virtual bool close(void) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     FILE* m_fd = nullptr;
@@ -128,6 +130,16 @@ private:
     bool uncompress_rle_channel(int scanline_off, int scanline_len,
                                 unsigned char* out);
 
+    // uncompress the RLE data of one channel scanline, rle[0..len-1], to
+    // 'out'. Return false if the data is corrupt (without calling error(),
+    // so it may be used from several threads at once).
+    bool decode_rle_channel(const unsigned char* rle, int len,
+                            unsigned char* out) const;
+
+    // interleave one scanline of the separate channels, channeldata[c]
+    // (in file order and endianness), into 'out' as native pixels.
+    void interleave(const unsigned char* const* channeldata, void* out) const;
+
     /// Helper: read, with error detection
     ///
     bool fread(void* buf, size_t itemsize, size_t nitems)
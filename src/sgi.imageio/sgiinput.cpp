@@ -29,6 +29,10 @@
 */
 #include "sgi_pvt.h"
 #include <OpenImageIO/dassert.h>
+#include <OpenImageIO/parallel.h>
+
+#include <atomic>
+#include <limits>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -179,11 +183,108 @@ SgiInput::read_native_scanline(int subimage, int miplevel, int y, int z,
         }
     }
 
+    std::vector<const unsigned char*> channelptrs(m_spec.nchannels);
+    for (int c = 0; c < m_spec.nchannels; ++c)
+        channelptrs[c] = channeldata[c].data();
+    interleave(channelptrs.data(), data);
+    return true;
+}
+
+
+
+bool
+SgiInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+    ybegin = std::max(ybegin, 0);
+    yend   = std::min(yend, m_spec.height);
+    if (ybegin >= yend)
+        return true;
+
+    // Scanlines are stored bottom-up, one channel after another, so for
+    // each channel the requested scanlines are rows [fybegin, fyend) of
+    // its plane.  Read each channel's stretch of the file in one go.
+    const int bpc = m_sgi_header.bpc, nchannels = m_spec.nchannels;
+    const int fybegin = m_spec.height - yend, fyend = m_spec.height - ybegin;
+    const size_t rowbytes = size_t(m_spec.width) * bpc;
+    const bool rle        = (m_sgi_header.storage == sgi_pvt::RLE);
+    std::vector<std::vector<unsigned char>> chunks(nchannels);
+    std::vector<size_t> chunkstart(nchannels);
+    for (int c = 0; c < nchannels; ++c) {
+        size_t begin, end;
+        if (rle) {
+            // The RLE offset tables let rows sit anywhere, but writers put
+            // a channel's rows in order, so this span is (nearly) dense.
+            begin = std::numeric_limits<size_t>::max();
+            end   = 0;
+            for (int fy = fybegin; fy < fyend; ++fy) {
+                int off = fy + c * m_spec.height;
+                begin   = std::min(begin, size_t(start_tab[off]));
+                end = std::max(end, size_t(start_tab[off]) + length_tab[off]);
+            }
+        } else {
+            begin = sgi_pvt::SGI_HEADER_LEN
+                    + (size_t(c) * m_spec.height + fybegin) * rowbytes;
+            end = begin + size_t(fyend - fybegin) * rowbytes;
+        }
+        chunks[c].resize(end - begin);
+        chunkstart[c] = begin;
+        if (fseek(m_fd, begin, SEEK_SET) != 0
+            || !fread(chunks[c].data(), 1, chunks[c].size()))
+            return false;
+    }
+
+    // With everything in memory, the rows decode independently, so do
+    // them in parallel, straight into the caller's buffer.
+    const size_t outbytes = m_spec.scanline_bytes(true);
+    std::atomic<bool> ok(true);
+    parallel_for_chunked(
+        ybegin, yend, 0,
+        [&](int64_t b, int64_t e) {
+            std::vector<unsigned char> rows(rle ? nchannels * rowbytes : 0);
+            std::vector<const unsigned char*> channelptrs(nchannels);
+            for (int64_t y = b; y < e && ok; ++y) {
+                int fy = m_spec.height - int(y) - 1;
+                for (int c = 0; c < nchannels; ++c) {
+                    if (rle) {
+                        int off = fy + c * m_spec.height;
+                        const unsigned char* in = chunks[c].data()
+                                                  + start_tab[off]
+                                                  - chunkstart[c];
+                        if (!decode_rle_channel(in, length_tab[off],
+                                                &rows[c * rowbytes]))
+                            ok = false;
+                        channelptrs[c] = &rows[c * rowbytes];
+                    } else {
+                        channelptrs[c] = chunks[c].data()
+                                         + (fy - fybegin) * rowbytes;
+                    }
+                }
+                if (ok)
+                    interleave(channelptrs.data(),
+                               (char*)data + (y - ybegin) * outbytes);
+            }
+        },
+        parallel_options(threads(), Split_Y, 16));
+    if (!ok)
+        error("Corrupt RLE data");
+    return ok;
+}
+
+
+
+void
+SgiInput::interleave(const unsigned char* const* channeldata, void* out) const
+{
+    int bpc = m_sgi_header.bpc;
     if (m_spec.nchannels == 1) {
         // If just one channel, no interleaving is necessary, just memcpy
-        memcpy(data, &(channeldata[0][0]), channeldata[0].size());
+        memcpy(out, channeldata[0], m_spec.width * bpc);
     } else {
-        unsigned char* cdata = (unsigned char*)data;
+        unsigned char* cdata = (unsigned char*)out;
         for (int x = 0; x < m_spec.width; ++x) {
             for (int c = 0; c < m_spec.nchannels; ++c) {
                 *cdata++ = channeldata[c][x * bpc];
@@ -195,9 +296,7 @@ SgiInput::read_native_scanline(int subimage, int miplevel, int y, int z,
 
     // Swap endianness if needed
     if (bpc == 2 && littleendian())
-        swap_endian((unsigned short*)data, m_spec.width * m_spec.nchannels);
-
-    return true;
+        swap_endian((unsigned short*)out, m_spec.width * m_spec.nchannels);
 }
 
 
@@ -206,11 +305,24 @@ bool
 SgiInput::uncompress_rle_channel(int scanline_off, int scanline_len,
                                  unsigned char* out)
 {
-    int bpc = m_sgi_header.bpc;
     std::vector<unsigned char> rle_scanline(scanline_len);
     fseek(m_fd, scanline_off, SEEK_SET);
     if (!fread(&rle_scanline[0], 1, scanline_len))
         return false;
+    if (!decode_rle_channel(rle_scanline.data(), scanline_len, out)) {
+        error("Corrupt RLE data");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+SgiInput::decode_rle_channel(const unsigned char* rle_scanline,
+                             int scanline_len, unsigned char* out) const
+{
+    int bpc   = m_sgi_header.bpc;
     int limit = m_spec.width;
     int i     = 0;
     if (bpc == 1) {
@@ -272,12 +384,7 @@ SgiInput::uncompress_rle_channel(int scanline_off, int scanline_len,
             }
         }
     }
-    if (i != scanline_len || limit != 0) {
-        error("Corrupt RLE data");
-        return false;
-    }
-
-    return true;
+    return i == scanline_len && limit == 0;
 }
 
 
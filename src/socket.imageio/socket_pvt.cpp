@@ -35,15 +35,72 @@
 
 
 
+#include <atomic>
+#include <chrono>
+
+#include <OpenImageIO/strutil.h>
+
 #include "socket_pvt.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
 using namespace boost;
 using namespace boost::asio;
+namespace bip = boost::interprocess;
 
 namespace socket_pvt {
 
+SharedRing::~SharedRing()
+{
+    // The reader has its own mapping, which outlives the name.
+    if (m_owner)
+        bip::shared_memory_object::remove(m_name.c_str());
+}
+
+
+
+bool
+SharedRing::create(int slots, size_t slotbytes)
+{
+    static std::atomic<int> counter(0);
+    long long now = std::chrono::steady_clock::now().time_since_epoch().count();
+    m_name        = Strutil::sprintf("oiio_socket_%llx_%p_%d", now,
+                              (const void*)this, counter++);
+    try {
+        bip::shared_memory_object shm(bip::create_only, m_name.c_str(),
+                                      bip::read_write);
+        m_owner = true;
+        shm.truncate(bip::offset_t(slots * slotbytes));
+        m_region = bip::mapped_region(shm, bip::read_write);
+    } catch (const bip::interprocess_exception&) {
+        return false;
+    }
+    m_slots     = slots;
+    m_slotbytes = slotbytes;
+    return true;
+}
+
+
+
+bool
+SharedRing::attach(const std::string& name, int slots, size_t slotbytes)
+{
+    try {
+        bip::shared_memory_object shm(bip::open_only, name.c_str(),
+                                      bip::read_only);
+        m_region = bip::mapped_region(shm, bip::read_only);
+    } catch (const bip::interprocess_exception&) {
+        return false;
+    }
+    if (m_region.get_size() < slots * slotbytes)
+        return false;
+    m_name      = name;
+    m_slots     = slots;
+    m_slotbytes = slotbytes;
+    return true;
+}
+
+
 std::size_t
 socket_write(ip::tcp::socket& s, TypeDesc& type, const void* data, int size)
 {
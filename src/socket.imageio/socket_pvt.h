@@ -51,12 +51,57 @@
 #endif
 
 #include <boost/asio.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
 
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
 using namespace boost::asio;
 
+namespace socket_pvt {
+
+/// A ring of fixed-size slots in a shared memory segment, for moving
+/// pixels between a SocketOutput and a SocketInput on the same host. The
+/// writer converts each scanline or tile straight into the next slot and
+/// sends only the slot number over the socket; the reader copies the
+/// slot out and sends back one byte to say the slot may be reused.
+///
+/// The writer asks for it by opening "host:port?shm=1" (optionally with
+/// "&shmslots=N"), which puts the segment's name and layout in the spec
+/// it sends. The reader answers with a single byte: 1 if it attached to
+/// the segment, 0 if it did not, in which case both sides go on sending
+/// pixels over the socket as before.
+class SharedRing {
+public:
+    SharedRing() {}
+    ~SharedRing();
+
+    /// Create a new segment of slots * slotbytes. Return false if that
+    /// was not possible.
+    bool create(int slots, size_t slotbytes);
+    /// Map an existing segment created by another process.
+    bool attach(const std::string& name, int slots, size_t slotbytes);
+
+    const std::string& name() const { return m_name; }
+    int slots() const { return m_slots; }
+    size_t slotbytes() const { return m_slotbytes; }
+    char* slot(int i) const
+    {
+        return (char*)m_region.get_address() + size_t(i) * m_slotbytes;
+    }
+
+private:
+    std::string m_name;
+    int m_slots        = 0;
+    size_t m_slotbytes = 0;
+    bool m_owner       = false;
+    boost::interprocess::mapped_region m_region;
+};
+
+}  // namespace socket_pvt
+
+
 
 
 class SocketOutput final : public ImageOutput {
@@ -80,9 +125,17 @@ private:
     io_service io;
     ip::tcp::socket socket;
     std::vector<unsigned char> m_scratch;
+    std::unique_ptr<socket_pvt::SharedRing> m_ring;  // if using shared memory
+    int m_ring_next    = 0;  // Next slot to fill
+    int m_ring_credits = 0;  // Slots the reader has handed back
 
     bool connect_to_server(const std::string& name);
     bool send_spec_to_server(const ImageSpec& spec);
+    // Return the next free slot of m_ring, waiting for the reader to
+    // free one if need be.
+    char* next_ring_slot();
+    // Tell the reader that the slot from next_ring_slot() is filled.
+    bool send_ring_slot();
 };
 
 
@@ -107,9 +160,13 @@ private:
     io_service io;
     ip::tcp::socket socket;
     std::shared_ptr<ip::tcp::acceptor> acceptor;
+    std::unique_ptr<socket_pvt::SharedRing> m_ring;  // if using shared memory
 
     bool accept_connection(const std::string& name);
     bool get_spec_from_client(ImageSpec& spec);
+    // Read the next scanline or tile of native pixels, bytes long, by
+    // whichever transport was negotiated.
+    bool read_pixels(void* data, size_t bytes);
 
     friend class SocketOutput;
 };
@@ -120,6 +177,8 @@ const char default_port[] = "10110";
 
 const char default_host[] = "127.0.0.1";
 
+const int default_shm_slots = 8;
+
 std::size_t
 socket_write(ip::tcp::socket& s, TypeDesc& type, const void* data, int size);
 
@@ -28,6 +28,8 @@
   (This is the Modified BSD License)
 */
 
+#include <cstring>
+
 #include <OpenImageIO/imageio.h>
 
 #include "socket_pvt.h"
@@ -120,18 +122,7 @@ SocketInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     lock_guard lock(m_mutex);
     if (!seek_subimage(subimage, miplevel))
         return false;
-    try {
-        boost::asio::read(socket, buffer(reinterpret_cast<char*>(data),
-                                         m_spec.scanline_bytes()));
-    } catch (boost::system::system_error& err) {
-        error("Error while reading: %s", err.what());
-        return false;
-    } catch (...) {
-        error("Error while reading: unknown exception");
-        return false;
-    }
-
-    return true;
+    return read_pixels(data, m_spec.scanline_bytes());
 }
 
 
@@ -143,9 +134,33 @@ SocketInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
     lock_guard lock(m_mutex);
     if (!seek_subimage(subimage, miplevel))
         return false;
+    return read_pixels(data, m_spec.tile_bytes());
+}
+
+
+
+bool
+SocketInput::read_pixels(void* data, size_t bytes)
+{
     try {
-        boost::asio::read(socket, buffer(reinterpret_cast<char*>(data),
-                                         m_spec.tile_bytes()));
+        if (m_ring) {
+            // Just the slot number comes over the socket; once the
+            // pixels are copied out, hand the slot back to the writer.
+            boost::uint32_t slot;
+            boost::asio::read(socket, buffer(reinterpret_cast<char*>(&slot),
+                                             sizeof(slot)));
+            if (slot >= boost::uint32_t(m_ring->slots())) {
+                error("Error while reading: bad shared memory slot %d",
+                      int(slot));
+                return false;
+            }
+            memcpy(data, m_ring->slot(slot), bytes);
+            char credit = 1;
+            boost::asio::write(socket, buffer(&credit, 1));
+        } else {
+            boost::asio::read(socket,
+                              buffer(reinterpret_cast<char*>(data), bytes));
+        }
     } catch (boost::system::system_error& err) {
         error("Error while reading: %s", err.what());
         return false;
@@ -163,6 +178,7 @@ bool
 SocketInput::close()
 {
     socket.close();
+    m_ring.reset();
     return true;
 }
 
@@ -204,16 +220,35 @@ bool
 SocketInput::get_spec_from_client(ImageSpec& spec)
 {
     try {
-        int spec_length;
+        boost::uint32_t spec_length;
 
         boost::asio::read(socket, buffer(reinterpret_cast<char*>(&spec_length),
                                          sizeof(boost::uint32_t)));
 
-        char* spec_xml = new char[spec_length + 1];
-        boost::asio::read(socket, buffer(spec_xml, spec_length));
-
-        spec.from_xml(spec_xml);
-        delete[] spec_xml;
+        std::vector<char> spec_blob(spec_length);
+        boost::asio::read(socket, buffer(spec_blob));
+
+        if (!spec.from_binary(spec_blob)) {
+            error("Received a malformed image spec");
+            return false;
+        }
+
+        // The writer may offer its pixels through shared memory. Say
+        // whether we could attach to it, and keep the details out of
+        // the spec we present.
+        std::string shm_name = spec.get_string_attribute("socket:shm_name");
+        if (shm_name.size()) {
+            int slots        = spec.get_int_attribute("socket:shm_slots");
+            size_t slotbytes = spec.get_int_attribute("socket:shm_slotbytes");
+            m_ring.reset(new socket_pvt::SharedRing);
+            if (slots < 1 || !m_ring->attach(shm_name, slots, slotbytes))
+                m_ring.reset();
+            char accepted = m_ring ? 1 : 0;
+            boost::asio::write(socket, buffer(&accepted, 1));
+            spec.erase_attribute("socket:shm_name");
+            spec.erase_attribute("socket:shm_slots");
+            spec.erase_attribute("socket:shm_slotbytes");
+        }
     } catch (boost::system::system_error& err) {
         error("Error while get_spec_from_client: %s", err.what());
         return false;
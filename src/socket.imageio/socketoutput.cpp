@@ -28,6 +28,8 @@
   (This is the Modified BSD License)
 */
 
+#include <cstring>
+
 #include <OpenImageIO/imageio.h>
 
 #include "socket_pvt.h"
@@ -69,15 +71,102 @@ bool
 SocketOutput::open(const std::string& name, const ImageSpec& newspec,
                    OpenMode mode)
 {
-    if (!(connect_to_server(name) && send_spec_to_server(newspec))) {
+    if (!connect_to_server(name))
         return false;
-    }
 
     m_next_scanline = 0;
     m_spec          = newspec;
     if (m_spec.format == TypeDesc::UNKNOWN)
         m_spec.set_format(TypeDesc::UINT8);  // Default to 8 bit channels
 
+    // If asked to, offer the reader a shared memory ring to take the
+    // pixels through, in place of the socket.
+    std::map<std::string, std::string> rest_args;
+    std::string baseurl;
+    rest_args["shm"]      = "0";
+    rest_args["shmslots"] = Strutil::to_string(socket_pvt::default_shm_slots);
+    Strutil::get_rest_arguments(name, baseurl, rest_args);
+    m_ring.reset();
+    ImageSpec sendspec = newspec;
+    if (Strutil::from_string<int>(rest_args["shm"])) {
+        int slots        = Strutil::from_string<int>(rest_args["shmslots"]);
+        slots            = std::max(1, slots);
+        size_t slotbytes = m_spec.tile_width ? m_spec.tile_bytes()
+                                             : m_spec.scanline_bytes();
+        m_ring.reset(new socket_pvt::SharedRing);
+        if (m_ring->create(slots, slotbytes)) {
+            sendspec.attribute("socket:shm_name", m_ring->name());
+            sendspec.attribute("socket:shm_slots", slots);
+            sendspec.attribute("socket:shm_slotbytes", int(slotbytes));
+        } else {
+            m_ring.reset();
+        }
+    }
+
+    if (!send_spec_to_server(sendspec))
+        return false;
+
+    if (m_ring) {
+        char accepted = 0;
+        try {
+            boost::asio::read(socket, buffer(&accepted, 1));
+        } catch (boost::system::system_error& err) {
+            error("Error while connecting: %s", err.what());
+            return false;
+        } catch (...) {
+            error("Error while connecting: unknown exception");
+            return false;
+        }
+        if (accepted) {
+            m_ring_next    = 0;
+            m_ring_credits = m_ring->slots();
+        } else {
+            m_ring.reset();
+        }
+    }
+
+    return true;
+}
+
+
+
+char*
+SocketOutput::next_ring_slot()
+{
+    if (!m_ring_credits) {
+        char credit;
+        try {
+            boost::asio::read(socket, buffer(&credit, 1));
+        } catch (boost::system::system_error& err) {
+            error("Error while writing: %s", err.what());
+            return nullptr;
+        } catch (...) {
+            error("Error while writing: unknown exception");
+            return nullptr;
+        }
+        ++m_ring_credits;
+    }
+    return m_ring->slot(m_ring_next);
+}
+
+
+
+bool
+SocketOutput::send_ring_slot()
+{
+    boost::uint32_t slot = m_ring_next;
+    try {
+        boost::asio::write(socket, buffer(reinterpret_cast<const char*>(&slot),
+                                          sizeof(slot)));
+    } catch (boost::system::system_error& err) {
+        error("Error while writing: %s", err.what());
+        return false;
+    } catch (...) {
+        error("Error while writing: unknown exception");
+        return false;
+    }
+    --m_ring_credits;
+    m_ring_next = (m_ring_next + 1) % m_ring->slots();
     return true;
 }
 
@@ -87,6 +176,32 @@ bool
 SocketOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
                              stride_t xstride)
 {
+    if (m_ring) {
+        // Convert straight into the shared slot; the socket only
+        // carries the slot number.
+        char* slot = next_ring_slot();
+        if (!slot)
+            return false;
+        if (m_spec.channelformats.empty()) {
+            if (format == TypeDesc::UNKNOWN)
+                format = m_spec.format;
+            if (!convert_image(m_spec.nchannels, m_spec.width, 1, 1, data,
+                               format, xstride, AutoStride, AutoStride, slot,
+                               m_spec.format, AutoStride, AutoStride,
+                               AutoStride)) {
+                error("Error while writing: could not convert pixels");
+                return false;
+            }
+        } else {
+            data = to_native_scanline(format, data, xstride, m_scratch);
+            memcpy(slot, data, m_spec.scanline_bytes());
+        }
+        if (!send_ring_slot())
+            return false;
+        ++m_next_scanline;
+        return true;
+    }
+
     data = to_native_scanline(format, data, xstride, m_scratch);
 
     try {
@@ -110,6 +225,29 @@ bool
 SocketOutput::write_tile(int x, int y, int z, TypeDesc format, const void* data,
                          stride_t xstride, stride_t ystride, stride_t zstride)
 {
+    if (m_ring) {
+        char* slot = next_ring_slot();
+        if (!slot)
+            return false;
+        if (m_spec.channelformats.empty()) {
+            if (format == TypeDesc::UNKNOWN)
+                format = m_spec.format;
+            if (!convert_image(m_spec.nchannels, m_spec.tile_width,
+                               m_spec.tile_height, m_spec.tile_depth, data,
+                               format, xstride, ystride, zstride, slot,
+                               m_spec.format, AutoStride, AutoStride,
+                               AutoStride)) {
+                error("Error while writing: could not convert pixels");
+                return false;
+            }
+        } else {
+            data = to_native_tile(format, data, xstride, ystride, zstride,
+                                  m_scratch);
+            memcpy(slot, data, m_spec.tile_bytes());
+        }
+        return send_ring_slot();
+    }
+
     data = to_native_tile(format, data, xstride, ystride, zstride, m_scratch);
 
     try {
@@ -131,6 +269,7 @@ bool
 SocketOutput::close()
 {
     socket.close();
+    m_ring.reset();
     return true;
 }
 
@@ -147,14 +286,15 @@ SocketOutput::copy_image(ImageInput* in)
 bool
 SocketOutput::send_spec_to_server(const ImageSpec& spec)
 {
-    std::string spec_xml = spec.to_xml();
-    int xml_length       = spec_xml.length();
+    std::vector<char> spec_blob;
+    spec.to_binary(spec_blob);
+    boost::uint32_t blob_length = spec_blob.size();
 
     try {
         boost::asio::write(socket,
-                           buffer(reinterpret_cast<const char*>(&xml_length),
+                           buffer(reinterpret_cast<const char*>(&blob_length),
                                   sizeof(boost::uint32_t)));
-        boost::asio::write(socket, buffer(spec_xml.c_str(), spec_xml.length()));
+        boost::asio::write(socket, buffer(spec_blob));
     } catch (boost::system::system_error& err) {
         error("Error while send_spec_to_server: %s", err.what());
         return false;
@@ -57,6 +57,8 @@ public:
     virtual bool close() override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
     std::string m_filename;            ///< Stash the filename
@@ -816,4 +818,32 @@ TGAInput::read_native_scanline(int subimage, int miplevel, int y, int z,
     return true;
 }
 
+
+
+bool
+TGAInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                int yend, int z, void* data)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+
+    if (m_buf.empty() && !readimg())
+        return false;
+
+    // The whole image is already decoded in m_buf, so this is just a
+    // copy -- one block of it, unless the image is stored bottom-up.
+    yend        = std::min(yend, m_spec.y + m_spec.height);
+    size_t size = spec().scanline_bytes();
+    if (!(m_tga.attr & FLAG_Y_FLIP)) {
+        if (ybegin < yend)
+            memcpy(data, &m_buf[0] + ybegin * size, (yend - ybegin) * size);
+        return true;
+    }
+    for (int y = ybegin; y < yend; ++y)
+        memcpy((char*)data + (y - ybegin) * size,
+               &m_buf[0] + (m_spec.height - y - 1) * size, size);
+    return true;
+}
+
 OIIO_PLUGIN_NAMESPACE_END
@@ -82,6 +82,7 @@ static bool dedup             = true;
 static bool test_construction = false;
 static bool test_gettexels    = false;
 static bool test_getimagespec = false;
+static bool bench_interp      = false;
 static bool filtertest        = false;
 static TextureSystem* texsys  = NULL;
 static std::string searchpath;
@@ -89,6 +90,9 @@ static bool batch        = false;
 static bool nowarp       = false;
 static bool tube         = false;
 static bool use_handle   = false;
+static bool coherent     = false;
+static bool use_lod      = false;
+static bool feedback     = false;
 static float cachesize   = -1;
 static int maxfiles      = -1;
 static int mipmode       = TextureOpt::MipModeDefault;
@@ -111,6 +115,8 @@ static bool test_statquery         = false;
 static bool invalidate_before_iter = true;
 static bool close_before_iter      = false;
 static Imath::M33f xform;
+static std::string json_filename;
+static int udim_vtiles = 2;
 void* dummyptr;
 
 typedef void (*Mapping2D)(const int&, const int&, float&, float&, float&,
@@ -169,12 +175,15 @@ getargs(int argc, const char* argv[])
                   "--anisoaspect %f", &anisoaspect, "Set anisotropic ellipse aspect ratio for threadtimes tests (default: 2.0)",
                   "--anisomax %d", &anisomax,
                       Strutil::sprintf("Set max anisotropy (default: %d)", anisomax).c_str(),
-                  "--mipmode %d", &mipmode, "Set mip mode (default: 0 = aniso)",
+                  "--mipmode %d", &mipmode, "Set mip mode (default: 0 = aniso, 5 = ewa, 8 = summed area)",
                   "--interpmode %d", &interpmode, "Set interp mode (default: 3 = smart bicubic)",
                   "--missing %f %f %f", &missing[0], &missing[1], &missing[2],
                         "Specify missing texture color",
                   "--autotile %d", &autotile, "Set auto-tile size for the image cache",
                   "--automip", &automip, "Set auto-MIPmap for the image cache",
+                  "--feedback", &feedback, "Report the tiles of each MIP level that lookups needed",
+                  "--coherent", &coherent, "Use texture_coherent() for each region of pixels",
+                  "--lod", &use_lod, "Use texture_lod(), with a width made from the derivatives",
                   "--batch", &batch,
                         Strutil::sprintf("Use batched shading, batch size = %d", Tex::BatchWidth).c_str(),
                   "--handle", &use_handle, "Use texture handle rather than name lookup",
@@ -185,6 +194,7 @@ getargs(int argc, const char* argv[])
                   "--ctr", &test_construction, "Test TextureOpt construction time",
                   "--gettexels", &test_gettexels, "Test TextureSystem::get_texels",
                   "--getimagespec", &test_getimagespec, "Test TextureSystem::get_imagespec",
+                  "--benchinterp", &bench_interp, "Benchmark the closest/bilinear/bicubic interpolation kernels",
                   "--offset %f %f %f", &texoffset[0], &texoffset[1], &texoffset[2], "Offset texture coordinates",
                   "--scalest %f %f", &sscale, &tscale, "Scale texture lookups (s, t)",
                   "--cachesize %f", &cachesize, "Set cache size, in MB",
@@ -199,6 +209,8 @@ getargs(int argc, const char* argv[])
                   "--resetstats", &resetstats, "Print and reset statistics on each iteration",
                   "--testhash", &testhash, "Test the tile hashing function",
                   "--threadtimes %d", &threadtimes, "Do thread timings (arg = workload profile)",
+                  "--json %s", &json_filename, "Also write the --threadtimes results, with cache statistics, as JSON to this file",
+                  "--udimvtiles %d", &udim_vtiles, "Rows of 10 UDIM tiles that --threadtimes 12 spreads lookups over (default: 2)",
                   "--trials %d", &ntrials, "Number of trials for timings",
                   "--wedge", &wedge, "Wedge test",
                   "--noinvalidate %!", &invalidate_before_iter, "Don't invalidate the cache before each --threadtimes trial",
@@ -567,6 +579,44 @@ plain_tex_region(ImageBuf& image, ustring filename, Mapping2D mapping,
     TextureOpt opt;
     initialize_opt(opt, nchannels);
 
+    if (coherent) {
+        // Gather all the queries of the region, look them up in one call,
+        // then store them, as a deferred-shading renderer would.
+        int npoints = int(roi.npixels());
+        std::vector<float> st(6 * npoints);
+        float *s = &st[0], *t = s + npoints, *dsdx = t + npoints;
+        float *dtdx = dsdx + npoints, *dsdy = dtdx + npoints;
+        float* dtdy = dsdy + npoints;
+        for (int y = roi.ybegin, i = 0; y < roi.yend; ++y)
+            for (int x = roi.xbegin; x < roi.xend; ++x, ++i)
+                mapping(x, y, s[i], t[i], dsdx[i], dtdx[i], dsdy[i], dtdy[i]);
+        std::vector<float> result(npoints * nchannels);
+        std::vector<float> dresultds(test_derivs ? npoints * nchannels : 0);
+        std::vector<float> dresultdt(test_derivs ? npoints * nchannels : 0);
+        bool ok = texsys->texture_coherent(
+            texture_handle, perthread_info, opt, npoints, s, t, dsdx, dtdx,
+            dsdy, dtdy, nchannels, result.data(),
+            test_derivs ? dresultds.data() : nullptr,
+            test_derivs ? dresultdt.data() : nullptr);
+        if (!ok) {
+            std::string e = texsys->geterror();
+            if (!e.empty())
+                Strutil::fprintf(std::cerr, "ERROR: %s\n", e);
+        }
+        for (auto& r : result)
+            r *= scalefactor;
+        for (int y = roi.ybegin, i = 0; y < roi.yend; ++y) {
+            for (int x = roi.xbegin; x < roi.xend; ++x, ++i) {
+                image.setpixel(x, y, &result[i * nchannels]);
+                if (test_derivs) {
+                    image_ds->setpixel(x, y, &dresultds[i * nchannels]);
+                    image_dt->setpixel(x, y, &dresultdt[i * nchannels]);
+                }
+            }
+        }
+        return;
+    }
+
     float* result    = ALLOCA(float, std::max(3, nchannels));
     float* dresultds = test_derivs ? ALLOCA(float, nchannels) : NULL;
     float* dresultdt = test_derivs ? ALLOCA(float, nchannels) : NULL;
@@ -576,7 +626,14 @@ plain_tex_region(ImageBuf& image, ustring filename, Mapping2D mapping,
 
         // Call the texture system to do the filtering.
         bool ok;
-        if (use_handle)
+        if (use_lod) {
+            // Stand in for a ray cone with the isotropic width that covers
+            // the same area as the derivatives' parallelogram.
+            float width = sqrtf(fabsf(dsdx * dtdy - dtdx * dsdy));
+            ok = texsys->texture_lod(texture_handle, perthread_info, opt, s, t,
+                                     width, nchannels, result, dresultds,
+                                     dresultdt);
+        } else if (use_handle)
             ok = texsys->texture(texture_handle, perthread_info, opt, s, t,
                                  dsdx, dtdx, dsdy, dtdy, nchannels, result,
                                  dresultds, dresultdt);
@@ -1010,6 +1067,60 @@ test_getimagespec_gettexels(ustring filename)
 
 
 
+static void
+benchmark_interp(ustring filename)
+{
+    // Magnified lookups (zero derivatives) of the finest level, so that
+    // each lookup is exactly one probe and the time is dominated by the
+    // interpolation kernel itself: texel gathering and weights.
+    ImageSpec spec;
+    if (!texsys->get_imagespec(filename, 0, spec)) {
+        Strutil::fprintf(std::cerr, "Could not get spec for %s\n", filename);
+        return;
+    }
+    int nchannels = nchannels_override ? nchannels_override : spec.nchannels;
+    nchannels     = std::min(nchannels, 4);
+    TextureOpt opt;
+    initialize_opt(opt, nchannels);
+    opt.mipmode = TextureOpt::MipModeNoMIP;
+    TextureSystem::Perthread* thread_info = texsys->get_perthread_info();
+    TextureSystem::TextureHandle* handle
+        = texsys->get_texture_handle(filename, thread_info);
+
+    // A fixed, well spread out set of lookup points
+    const int npoints = 4096;
+    std::vector<float> s(npoints), t(npoints);
+    for (int i = 0; i < npoints; ++i) {
+        s[i] = fmodf(i * 0.6180339887f, 1.0f);
+        t[i] = (i + 0.5f) / npoints;
+    }
+    float result[4], dresultds[4], dresultdt[4];
+
+    Benchmarker bench;
+    bench.work(npoints);
+    if (iters > 1)
+        bench.iterations(iters);
+    if (ntrials > 1)
+        bench.trials(ntrials);
+    static const char* interpnames[] = { "closest", "bilinear", "bicubic" };
+    for (int derivs = 0; derivs < 2; ++derivs) {
+        for (int m = 0; m < 3; ++m) {
+            opt.interpmode = TextureOpt::InterpMode(m);
+            bench(Strutil::sprintf("%s%s", interpnames[m],
+                                   derivs ? " + derivs" : ""),
+                  [&]() {
+                      for (int i = 0; i < npoints; ++i)
+                          texsys->texture(handle, thread_info, opt, s[i], t[i],
+                                          0.0f, 0.0f, 0.0f, 0.0f, nchannels,
+                                          result, derivs ? dresultds : nullptr,
+                                          derivs ? dresultdt : nullptr);
+                  });
+        }
+    }
+}
+
+
+
 static void
 test_hash()
 {
@@ -1136,8 +1247,20 @@ static const char* workload_names[] = {
     /*6*/ "Coherent access, many files, each thread in different spots",
     /*7*/ "Coherent access, many files, partially overlapping texture sets",
     /*8*/ "Coherent access, many files, partially overlapping texture sets, no extra busy work",
+    /*9*/ "Incoherent access, one file, random texture coordinates",
+    /*10*/ "Coherent screen-space sweep of a warped plane, one file",
+    /*11*/ "Grazing-angle plane, one file, highly anisotropic footprints",
+    /*12*/ "Incoherent access across the tiles of a UDIM file",
+    /*13*/ "Incoherent access, many files, random file per lookup",
     NULL
 };
+// Short names of the workloads, for the --json report
+static const char* workload_keys[] = {
+    "none",          "static_handles", "static",        "coherent",
+    "coherent_offset", "files",        "files_offset",  "files_overlap",
+    "files_overlap_nowork", "incoherent", "screen_sweep", "grazing",
+    "udim",          "many_files",     NULL
+};
 
 
 
@@ -1161,11 +1284,24 @@ do_tex_thread_workout(int iterations, int mythread)
 
     ImageSpec spec0;
     bool ok = texsys->get_imagespec(filenames[0], 0, spec0);
-    if (!ok) {
+    if (!ok && threadtimes == 12) {
+        // A UDIM filename has no spec of its own; size the filter as if
+        // its tiles were 1k.
+        texsys->geterror();
+        spec0 = ImageSpec(1024, 1024, nchannels, TypeDesc::UINT8);
+    } else if (!ok) {
         Strutil::fprintf(std::cerr, "Unexpected error: %s\n",
                          texsys->geterror());
         return;
     }
+    // Per-thread random number stream for the incoherent workloads
+    uint32_t rng = 2891336453u * uint32_t(mythread + 1) + 1u;
+    auto rand01  = [&]() -> float {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return float(rng >> 8) * (1.0f / float(1 << 24));
+    };
     // Compute a filter size that's between the second and third MIP levels.
     float fw   = (1.0f / spec0.width) * 1.5f * 2.0;
     float fh   = (1.0f / spec0.height) * 1.5f * 2.0;
@@ -1182,6 +1318,10 @@ do_tex_thread_workout(int iterations, int mythread)
     for (int i = 0; i < iterations; ++i) {
         pixel   = i;
         bool ok = false;
+        // Workloads that make their own coordinates and derivatives set
+        // own_st and these.
+        bool own_st = false;
+        float sx = dsdx, tx = dtdx, sy = dsdy, ty = dtdy;
         // Several different texture access patterns
         switch (threadtimes) {
         case 1:
@@ -1236,20 +1376,69 @@ do_tex_thread_workout(int iterations, int mythread)
                 pixel += 57557 * mythread;
             }
             break;
+        case 9:
+        case 13:
+            // Workload 9: Random texture coordinates all over one file, as
+            // from secondary rays, so nearly every lookup is to a
+            // different tile than the last.
+            //
+            // Workload 13: The same, but each lookup also picks one of
+            // the files at random.
+            s      = rand01();
+            t      = rand01();
+            own_st = true;
+            if (threadtimes == 13)
+                whichfile = std::min(int(rand01() * nfiles), nfiles - 1);
+            break;
+        case 10: {
+            // Workload 10: Camera-ray access, sweeping scanlines of the
+            // perspective-warped plane that the non-threaded tests
+            // render, each thread starting on a different line.
+            int p = pixel + mythread * output_xres * 7;
+            int x = p % output_xres, y = (p / output_xres) % output_yres;
+            map_warp(x, y, s, t, sx, tx, sy, ty);
+            own_st = true;
+        } break;
+        case 11: {
+            // Workload 11: A plane seen at a grazing angle: footprints are
+            // one texel across but stretch with distance, up to 32:1 at
+            // the horizon, so filtering dominates.
+            int p   = pixel + mythread * output_xres * 7;
+            int x   = p % output_xres, y = (p / output_xres) % output_yres;
+            float v = (y + 0.5f) / output_yres;
+            float z = 1.0f / (1.0f - 0.97f * v);  // distance, 1 to ~33
+            s       = (x + 0.5f) / output_xres;
+            t       = 0.03f * z;
+            sx      = 1.0f / spec0.width;
+            tx      = 0.0f;
+            sy      = 0.0f;
+            ty      = std::min(0.03f * 0.97f * z * z / output_yres, 32.0f * sx);
+            own_st  = true;
+        } break;
+        case 12:
+            // Workload 12: Random coordinates across --udimvtiles rows of
+            // ten UDIM tiles of filenames[0], e.g. "paint.<UDIM>.tx".
+            s      = 10.0f * rand01();
+            t      = std::max(udim_vtiles, 1) * rand01();
+            own_st = true;
+            break;
         default: ASSERT_MSG(0, "Unkonwn thread work pattern %d", threadtimes);
         }
-        if (!ok && spec0.width && spec0.height) {
+        if (!ok && !own_st && spec0.width && spec0.height) {
             s = (((2 * pixel) % spec0.width) + 0.5f) / spec0.width;
             t = (((2 * ((2 * pixel) / spec0.width)) % spec0.height) + 0.5f)
                 / spec0.height;
+            own_st = true;
+        }
+        if (!ok && own_st) {
             if (use_handle)
                 ok = texsys->texture(texture_handles[whichfile], perthread_info,
-                                     opt, s, t, dsdx, dtdx, dsdy, dtdy,
-                                     nchannels, result, dresultds, dresultdt);
+                                     opt, s, t, sx, tx, sy, ty, nchannels,
+                                     result, dresultds, dresultdt);
             else
-                ok = texsys->texture(filenames[whichfile], opt, s, t, dsdx,
-                                     dtdx, dsdy, dtdy, nchannels, result,
-                                     dresultds, dresultdt);
+                ok = texsys->texture(filenames[whichfile], opt, s, t, sx, tx,
+                                     sy, ty, nchannels, result, dresultds,
+                                     dresultdt);
         }
         if (!ok) {
             Strutil::fprintf(std::cerr, "Unexpected error: %s\n",
@@ -1258,7 +1447,7 @@ do_tex_thread_workout(int iterations, int mythread)
         }
         // Do some pointless work, to simulate that in a real app, there
         // would be operations interspersed with texture accesses.
-        if (threadtimes != 8 /* skip on this test */) {
+        if (threadtimes != 8 /* skip on this test */ && threadtimes < 9) {
             for (int j = 0; j < 30; ++j)
                 for (int c = 0; c < nchannels; ++c)
                     result[c] = cosf(result[c]);
@@ -1456,6 +1645,7 @@ main(int argc, const char* argv[])
         texsys->attribute("accept_unmipped", 0);
     texsys->attribute("gray_to_rgb", gray_to_rgb);
     texsys->attribute("flip_t", flip_t);
+    texsys->attribute("feedback", (int)feedback);
 
     if (test_construction) {
         Timer t;
@@ -1491,6 +1681,11 @@ main(int argc, const char* argv[])
         iters = 0;
     }
 
+    if (bench_interp && filenames.size()) {
+        benchmark_interp(filenames[0]);
+        iters = 0;
+    }
+
     if (testhash) {
         test_hash();
     }
@@ -1510,6 +1705,14 @@ main(int argc, const char* argv[])
         // (divided among the threads). If not supplied (iters will be 1),
         // then use a large constant *per thread*.
         const int iterations = iters > 1 ? iters : 2000000;
+        int nworkloads       = 0;
+        while (workload_names[nworkloads])
+            ++nworkloads;
+        if (threadtimes < 0 || threadtimes >= nworkloads) {
+            std::cerr << "testtex: unknown --threadtimes workload "
+                      << threadtimes << "\n";
+            return EXIT_FAILURE;
+        }
         std::cout << "Workload: " << workload_names[threadtimes] << "\n";
         std::cout << "texture cache size = " << cachesize << " MB\n";
         std::cout << "hw threads = " << Sysutil::hardware_concurrency() << "\n";
@@ -1522,11 +1725,14 @@ main(int argc, const char* argv[])
         static int threadcounts[] = { 1,  2,  4,  8,   12,   16,
                                       24, 32, 64, 128, 1024, 1 << 30 };
         float single_thread_time  = 0.0f;
+        std::vector<std::string> json_runs;
         for (int i = 0; threadcounts[i] <= nthreads; ++i) {
             int nt  = wedge ? threadcounts[i] : nthreads;
             int its = iters > 1 ? (std::max(1, iters / nt))
                                 : iterations;  // / nt;
             double range;
+            if (json_filename.size())
+                texsys->reset_stats();
             double t = time_trial(std::bind(launch_tex_threads, nt, its),
                                   ntrials, &range);
             if (nt == 1)
@@ -1537,11 +1743,59 @@ main(int argc, const char* argv[])
                 "%3d     %8.2f   %6.1fx  %6.1f%%    range %.2f\t(%d iters/thread)\n",
                 nt, t, speedup, efficiency * 100.0f, range, its);
             std::cout.flush();
+            if (json_filename.size()) {
+                // Cache statistics are totals over all the trials
+                long long calls = 0, microcache_misses = 0, bytes_read = 0;
+                int misses = 0;
+                texsys->getattribute("stat:find_tile_calls", TypeDesc::INT64,
+                                     &calls);
+                texsys->getattribute("stat:find_tile_microcache_misses",
+                                     TypeDesc::INT64, &microcache_misses);
+                texsys->getattribute("stat:find_tile_cache_misses", TypeInt,
+                                     &misses);
+                texsys->getattribute("stat:bytes_read", TypeDesc::INT64,
+                                     &bytes_read);
+                double hitrate = calls ? 1.0 - double(misses) / calls : 1.0;
+                json_runs.push_back(Strutil::sprintf(
+                    "    { \"threads\": %d, \"iterations_per_thread\": %d, "
+                    "\"time\": %g, \"range\": %g, "
+                    "\"lookups_per_sec\": %g, \"speedup\": %g, "
+                    "\"efficiency\": %g, \"find_tile_calls\": %lld, "
+                    "\"microcache_misses\": %lld, \"cache_misses\": %d, "
+                    "\"cache_hit_rate\": %g, \"bytes_read\": %lld }",
+                    nt, its, t, range, double(nt) * its / t, speedup,
+                    efficiency, calls, microcache_misses, misses, hitrate,
+                    bytes_read));
+            }
             if (!wedge)
                 break;  // don't loop if we're not wedging
         }
         std::cout << "\n";
 
+        if (json_filename.size()) {
+            std::string files;
+            for (auto f : filenames)
+                files += Strutil::sprintf("%s\"%s\"", files.size() ? ", " : "",
+                                          Strutil::escape_chars(f));
+            std::string json = Strutil::sprintf(
+                "{\n  \"workload\": \"%s\",\n  \"description\": \"%s\",\n"
+                "  \"files\": [%s],\n  \"cache_size_mb\": %g,\n"
+                "  \"hw_threads\": %d,\n  \"trials\": %d,\n"
+                "  \"runs\": [\n%s\n  ],\n  \"metrics\": %s}\n",
+                workload_keys[threadtimes], workload_names[threadtimes], files,
+                cachesize, int(Sysutil::hardware_concurrency()), ntrials,
+                Strutil::join(json_runs, ",\n"),
+                Strutil::strip(texsys->getmetrics("json"), "\n"));
+            OIIO::ofstream out;
+            Filesystem::open(out, json_filename);
+            out << json;
+            if (!out.good()) {
+                std::cerr << "testtex: could not write " << json_filename
+                          << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+
     } else if (iters > 0 && filenames.size()) {
         ustring filename(filenames[0]);
         test_gettextureinfo(filenames[0]);
@@ -1632,6 +1886,26 @@ main(int argc, const char* argv[])
         }
     }
 
+    if (feedback) {
+        for (auto filename : filenames) {
+            int nmip = 0;
+            texsys->get_texture_info(filename, 0, ustring("miplevels"),
+                                     TypeInt, &nmip);
+            std::cout << "Tiles needed for " << filename << ":\n";
+            for (int m = 0; m < nmip; ++m) {
+                std::vector<uint64_t> tiles;
+                if (!texsys->get_tile_feedback(filename, 0, m, tiles))
+                    break;
+                int needed = 0;
+                for (auto bits : tiles)
+                    for (; bits; bits &= bits - 1)
+                        ++needed;
+                std::cout << Strutil::sprintf("  MIP level %d: %d\n", m,
+                                              needed);
+            }
+        }
+    }
+
     std::cout << "Memory use: "
               << Strutil::memformat(Sysutil::memory_used(true)) << "\n";
     std::cout << texsys->getstats(verbose ? 2 : 0) << "\n";
@@ -88,6 +88,106 @@ struct TIFF_tag_info {
 
 
 
+// Decode TIFF LZW data -- codes of 9 to 12 bits, most significant bit
+// first, each width starting one code early -- into exactly outsize
+// bytes. Return false if the data is damaged, ends early, or is the
+// old-style LZW of pre-5.0 libtiff, which we leave to libtiff.
+static bool
+lzw_decode(const unsigned char* in, size_t insize, unsigned char* out,
+           size_t outsize)
+{
+    if (insize >= 2 && in[0] == 0 && (in[1] & 1))
+        return false;  // old-style, least significant bit first
+    const int Clear = 256, EOI = 257, maxcodes = 4096;
+    // Each table entry is a previous entry's string plus one byte, so it's
+    // written out last byte first by following the prefixes.
+    std::unique_ptr<uint16_t[]> prefix(new uint16_t[maxcodes]);
+    std::unique_ptr<uint16_t[]> length(new uint16_t[maxcodes]);
+    std::unique_ptr<unsigned char[]> last(new unsigned char[maxcodes]);
+    std::unique_ptr<unsigned char[]> first(new unsigned char[maxcodes]);
+    for (int i = 0; i < 256; ++i) {
+        prefix[i] = 0;
+        length[i] = 1;
+        last[i] = first[i] = (unsigned char)i;
+    }
+    uint32_t bits = 0;
+    int nbuffered = 0, nbits = 9, next = EOI + 1, prev = -1;
+    size_t inpos = 0, pos = 0;
+    while (pos < outsize) {
+        while (nbuffered < nbits) {
+            if (inpos >= insize)
+                return false;
+            bits = (bits << 8) | in[inpos++];
+            nbuffered += 8;
+        }
+        nbuffered -= nbits;
+        int code = (bits >> nbuffered) & ((1 << nbits) - 1);
+        if (code == EOI)
+            break;
+        if (code == Clear) {
+            nbits = 9;
+            next  = EOI + 1;
+            prev  = -1;
+            continue;
+        }
+        if (prev < 0) {
+            if (code > 255)
+                return false;
+            out[pos++] = (unsigned char)code;
+            prev       = code;
+            continue;
+        }
+        if (code > next || (code == next && next == maxcodes))
+            return false;
+        // The new entry is the previous string plus the first byte of this
+        // one -- which, if this is the code being defined, is its own.
+        if (next < maxcodes) {
+            prefix[next] = uint16_t(prev);
+            length[next] = uint16_t(length[prev] + 1);
+            last[next]   = first[code == next ? prev : code];
+            first[next]  = first[prev];
+            if (++next >= (1 << nbits) - 1 && nbits < 12)
+                ++nbits;
+        }
+        size_t end = pos + length[code];
+        int c      = code;
+        for (size_t p = end; p > pos; c = prefix[c])
+            if (--p < outsize)
+                out[p] = last[c];
+        pos  = end;
+        prev = code;
+    }
+    return pos >= outsize;
+}
+
+
+
+// Decode PackBits (run length) data into exactly outsize bytes, returning
+// false if it ends early.
+static bool
+packbits_decode(const unsigned char* in, size_t insize, unsigned char* out,
+                size_t outsize)
+{
+    size_t inpos = 0, pos = 0;
+    while (pos < outsize && inpos < insize) {
+        int n = (signed char)in[inpos++];
+        if (n >= 0) {  // n+1 literal bytes
+            size_t len = std::min(std::min(size_t(n) + 1, insize - inpos),
+                                  outsize - pos);
+            memcpy(out + pos, in + inpos, len);
+            pos += len;
+            inpos += size_t(n) + 1;
+        } else if (n != -128 && inpos < insize) {  // the next byte, 1-n times
+            size_t len = std::min(size_t(1 - n), outsize - pos);
+            memset(out + pos, in[inpos++], len);
+            pos += len;
+        }
+    }
+    return pos == outsize;
+}
+
+
+
 // Note about MIP-maps versus subimages:
 //
 // TIFF files support subimages, but do not explicitly support
@@ -107,6 +207,12 @@ struct TIFF_tag_info {
 
 
 
+TIFF*
+oiio_tiff_open_ioproxy(const std::string& name, const char* mode,
+                       Filesystem::IOProxy* io);
+
+
+
 class TIFFInput final : public ImageInput {
 public:
     TIFFInput();
@@ -115,7 +221,8 @@ public:
     virtual bool valid_file(const std::string& filename) const override;
     virtual int supports(string_view feature) const override
     {
-        return (feature == "exif" || feature == "iptc");
+        return (feature == "exif" || feature == "iptc"
+                || feature == "ioproxy");
         // N.B. No support for arbitrary metadata.
     }
     virtual bool open(const std::string& name, ImageSpec& newspec) override;
@@ -147,6 +254,8 @@ public:
     virtual bool read_native_tiles(int subimage, int miplevel, int xbegin,
                                    int xend, int ybegin, int yend, int zbegin,
                                    int zend, void* data) override;
+    virtual bool native_tile_offset(int subimage, int miplevel, int x, int y,
+                                    int z, imagesize_t& offset) override;
     virtual bool read_scanline(int y, int z, TypeDesc format, void* data,
                                stride_t xstride) override;
     virtual bool read_scanlines(int subimage, int miplevel, int ybegin,
@@ -162,8 +271,13 @@ public:
                             stride_t xstride, stride_t ystride,
                             stride_t zstride) override;
 
+    // The libtiff handle, for TIFFOutput::copy_image to read raw strips
+    // and tiles from.
+    TIFF* tiff_handle() const { return m_tif; }
+
 private:
     TIFF* m_tif;                            ///< libtiff handle
+    Filesystem::IOProxy* m_io;              ///< Caller's proxy, if any
     std::string m_filename;                 ///< Stash the filename
     std::vector<unsigned char> m_scratch;   ///< Scratch space for us to use
     std::vector<unsigned char> m_scratch2;  ///< More scratch
@@ -176,6 +290,7 @@ private:
     bool m_raw_color;                ///< If the image is not RGB, don't
                                      ///<   transform the color.
     bool m_convert_alpha;            ///< Do we need to associate alpha?
+    MetadataHint m_metadata;         ///< How to treat Exif/XMP/IPTC
     bool m_separate;                 ///< Separate planarconfig?
     bool m_testopenconfig;           ///< Debug aid to test open-with-config
     bool m_use_rgba_interface;       ///< Sometimes we punt
@@ -195,11 +310,13 @@ private:
     void init()
     {
         m_tif                     = NULL;
+        m_io                      = nullptr;
         m_subimage                = -1;
         m_emulate_mipmap          = false;
         m_keep_unassociated_alpha = false;
         m_raw_color               = false;
         m_convert_alpha           = false;
+        m_metadata                = MetadataHint::Full;
         m_separate                = false;
         m_inputchannels           = 0;
         m_testopenconfig          = false;
@@ -208,6 +325,22 @@ private:
         m_subimage_specs.clear();
     }
 
+    // Open m_tif from the caller's IOProxy if we were given one,
+    // otherwise from m_filename.
+    void open_tif()
+    {
+        if (m_io) {
+            m_tif = oiio_tiff_open_ioproxy(m_filename, "rm", m_io);
+        } else {
+#ifdef _WIN32
+            std::wstring wfilename = Strutil::utf8_to_utf16(m_filename);
+            m_tif                  = TIFFOpenW(wfilename.c_str(), "rm");
+#else
+            m_tif = TIFFOpen(m_filename.c_str(), "rm");
+#endif
+        }
+    }
+
     void close_tif()
     {
         if (m_tif) {
@@ -389,40 +522,101 @@ private:
             }
     }
 
+    // Can the raw (still compressed) strips or tiles of the current
+    // subimage be decompressed by uncompress_one_strip, without libtiff?
+    // That takes zip, LZW or PackBits compression, contiguous channels,
+    // and either no predictor or the horizontal predictor on integer
+    // samples.
+    bool can_uncompress_raw() const
+    {
+        if ((m_compression != COMPRESSION_ADOBE_DEFLATE
+             && m_compression != COMPRESSION_DEFLATE
+             && m_compression != COMPRESSION_LZW
+             && m_compression != COMPRESSION_PACKBITS)
+            || m_separate)
+            return false;
+        size_t size = m_spec.format.size();
+        if (m_predictor == PREDICTOR_NONE)
+            return size == 1 || size == 2 || size == 4 || size == 8;
+        if (m_predictor == PREDICTOR_HORIZONTAL)
+            return m_spec.format.basetype <= TypeDesc::INT32
+                   && m_spec.format.basetype >= TypeDesc::UINT8;
+        return false;
+    }
+
+    // Room enough for the raw data of a strip or tile that decompresses to
+    // the given size: LZW can expand data by half (12 bit codes for single
+    // bytes), more than zlib or PackBits ever do.
+    static size_t raw_bound(size_t bytes)
+    {
+        return std::max(size_t(compressBound(uLong(bytes))),
+                        bytes + bytes / 2 + 16);
+    }
+
+    // Decompress one raw strip or tile (see can_uncompress_raw), then swap
+    // its bytes if the file's byte order is not ours and undo any
+    // predictor, just as libtiff would have.
     void uncompress_one_strip(void* compressed_buf, unsigned long csize,
                               void* uncompressed_buf, size_t strip_bytes,
                               int channels, int width, int height,
                               int compression, bool* ok)
     {
-        ASSERT (compression == COMPRESSION_ADOBE_DEFLATE /*||
-                compression == COMPRESSION_NONE*/);
-        if (compression == COMPRESSION_NONE) {
-            // just copy if there's no compression
-            memcpy(uncompressed_buf, compressed_buf, csize);
-            if (m_is_byte_swapped && m_spec.format == TypeUInt16)
-                TIFFSwabArrayOfShort((unsigned short*)uncompressed_buf,
-                                     width * height * channels);
-            return;
+        bool decoded;
+        if (compression == COMPRESSION_LZW) {
+            decoded = lzw_decode((const unsigned char*)compressed_buf, csize,
+                                 (unsigned char*)uncompressed_buf,
+                                 strip_bytes);
+        } else if (compression == COMPRESSION_PACKBITS) {
+            decoded = packbits_decode((const unsigned char*)compressed_buf,
+                                      csize, (unsigned char*)uncompressed_buf,
+                                      strip_bytes);
+        } else {
+            ASSERT(compression == COMPRESSION_ADOBE_DEFLATE
+                   || compression == COMPRESSION_DEFLATE);
+            uLong uncompressed_size = (uLong)strip_bytes;
+            auto zok = uncompress((Bytef*)uncompressed_buf,
+                                  &uncompressed_size,
+                                  (const Bytef*)compressed_buf, csize);
+            decoded  = (zok == Z_OK && uncompressed_size == strip_bytes);
         }
-        uLong uncompressed_size = (uLong)strip_bytes;
-        auto zok = uncompress((Bytef*)uncompressed_buf, &uncompressed_size,
-                              (const Bytef*)compressed_buf, csize);
-        if (zok != Z_OK || uncompressed_size != strip_bytes) {
+        if (!decoded) {
             *ok = false;
             return;
         }
-        if (m_is_byte_swapped && m_spec.format == TypeUInt16)
-            TIFFSwabArrayOfShort((unsigned short*)uncompressed_buf,
-                                 width * height * channels);
+        tmsize_t nvals = tmsize_t(width) * height * channels;
+        if (m_is_byte_swapped) {
+            switch (m_spec.format.size()) {
+            case 2:
+                TIFFSwabArrayOfShort((uint16*)uncompressed_buf, nvals);
+                break;
+            case 4:
+                TIFFSwabArrayOfLong((uint32*)uncompressed_buf, nvals);
+                break;
+            case 8:
+                TIFFSwabArrayOfDouble((double*)uncompressed_buf, nvals);
+                break;
+            default: break;
+            }
+        }
         if (m_predictor == PREDICTOR_HORIZONTAL) {
-            if (m_spec.format == TypeUInt8)
+            switch (m_spec.format.size()) {
+            case 1:
                 undo_horizontal_predictor((unsigned char*)uncompressed_buf,
                                           (unsigned char*)uncompressed_buf,
                                           channels, width, height);
-            else if (m_spec.format == TypeUInt16)
+                break;
+            case 2:
                 undo_horizontal_predictor((unsigned short*)uncompressed_buf,
                                           (unsigned short*)uncompressed_buf,
                                           channels, width, height);
+                break;
+            case 4:
+                undo_horizontal_predictor((uint32_t*)uncompressed_buf,
+                                          (uint32_t*)uncompressed_buf,
+                                          channels, width, height);
+                break;
+            default: break;
+            }
         }
     }
 
@@ -504,6 +698,81 @@ oiio_tiff_set_error_handler()
 
 
 
+// If in is a TIFF reader, return its libtiff handle (positioned at the
+// directory of the current subimage), otherwise NULL.
+TIFF*
+oiio_tiff_input_handle(ImageInput* in)
+{
+    if (!in || strcmp(in->format_name(), "tiff"))
+        return NULL;
+    return static_cast<TIFFInput*>(in)->tiff_handle();
+}
+
+
+
+// libtiff client callbacks that route all I/O through a
+// Filesystem::IOProxy. The proxy belongs to the caller, so closing the
+// TIFF does not close it.
+static tsize_t
+tiff_proxy_read(thandle_t h, tdata_t buf, tsize_t size)
+{
+    return tsize_t(((Filesystem::IOProxy*)h)->read(buf, size_t(size)));
+}
+
+static tsize_t
+tiff_proxy_write(thandle_t h, tdata_t buf, tsize_t size)
+{
+    return tsize_t(((Filesystem::IOProxy*)h)->write(buf, size_t(size)));
+}
+
+static toff_t
+tiff_proxy_seek(thandle_t h, toff_t offset, int whence)
+{
+    Filesystem::IOProxy* io = (Filesystem::IOProxy*)h;
+    if (!io->seek(int64_t(offset), whence))
+        return toff_t(-1);
+    return toff_t(io->tell());
+}
+
+static int
+tiff_proxy_close(thandle_t /*h*/)
+{
+    return 0;
+}
+
+static toff_t
+tiff_proxy_size(thandle_t h)
+{
+    return toff_t(((Filesystem::IOProxy*)h)->size());
+}
+
+static int
+tiff_proxy_map(thandle_t, tdata_t*, toff_t*)
+{
+    return 0;  // No memory mapping; libtiff falls back to reads
+}
+
+static void
+tiff_proxy_unmap(thandle_t, tdata_t, toff_t)
+{
+}
+
+
+
+// Open a libtiff handle that reads or writes through io rather than a
+// file on disk. The name is used only for libtiff's error messages.
+TIFF*
+oiio_tiff_open_ioproxy(const std::string& name, const char* mode,
+                       Filesystem::IOProxy* io)
+{
+    io->seek(0);
+    return TIFFClientOpen(name.c_str(), mode, (thandle_t)io, tiff_proxy_read,
+                          tiff_proxy_write, tiff_proxy_seek, tiff_proxy_close,
+                          tiff_proxy_size, tiff_proxy_map, tiff_proxy_unmap);
+}
+
+
+
 struct CompressionCode {
     int code;
     const char* name;
@@ -619,11 +888,16 @@ TIFFInput::open(const std::string& name, ImageSpec& newspec,
         m_keep_unassociated_alpha = true;
     if (config.get_int_attribute("oiio:RawColor", 0) == 1)
         m_raw_color = true;
+    m_metadata = metadata_hint(config);
     // This configuration hint has no function other than as a debugging aid
     // for testing whether configurations are received properly from other
     // OIIO components.
     if (config.get_int_attribute("oiio:DebugOpenConfig!", 0))
         m_testopenconfig = true;
+    // A caller-supplied IOProxy lets us read from memory or elsewhere.
+    const ParamValue* p = config.find_attribute("oiio:ioproxy", TypeDesc::PTR);
+    if (p)
+        m_io = p->get<Filesystem::IOProxy*>();
     return open(name, newspec);
 }
 
@@ -656,12 +930,7 @@ TIFFInput::seek_subimage(int subimage, int miplevel)
     bool read_meta = !(m_emulate_mipmap && m_tif && m_subimage >= 0);
 
     if (!m_tif) {
-#ifdef _WIN32
-        std::wstring wfilename = Strutil::utf8_to_utf16(m_filename);
-        m_tif                  = TIFFOpenW(wfilename.c_str(), "rm");
-#else
-        m_tif = TIFFOpen(m_filename.c_str(), "rm");
-#endif
+        open_tif();
         if (m_tif == NULL) {
             std::string e = oiio_tiff_last_error();
             error("Could not open file: %s", e.length() ? e : m_filename);
@@ -1054,8 +1323,11 @@ TIFFInput::readspec(bool read_meta)
         // Search for an EXIF IFD in the TIFF file, and if found, rummage
         // around for Exif fields.
 #if TIFFLIB_VERSION > 20050912 /* compat with old TIFF libs - skip Exif */
+    // The Exif IFD is read through libtiff rather than as one contiguous
+    // block, so a "lazy" hint reads it as usual and only "none" skips it.
     toff_t exifoffset = 0;
-    if (TIFFGetField(m_tif, TIFFTAG_EXIFIFD, &exifoffset)
+    if (m_metadata != MetadataHint::None
+        && TIFFGetField(m_tif, TIFFTAG_EXIFIFD, &exifoffset)
         && TIFFReadEXIFDirectory(m_tif, exifoffset)) {
         for (const auto& tag : tag_table("Exif"))
             find_tag(tag.tifftag, tag.tifftype, tag.name);
@@ -1071,12 +1343,7 @@ TIFFInput::readspec(bool read_meta)
         // I'm not sure what state TIFFReadEXIFDirectory leaves us.
         // So to be safe, close and re-seek.
         TIFFClose(m_tif);
-#    ifdef _WIN32
-        std::wstring wfilename = Strutil::utf8_to_utf16(m_filename);
-        m_tif                  = TIFFOpenW(wfilename.c_str(), "rm");
-#    else
-        m_tif = TIFFOpen(m_filename.c_str(), "rm");
-#    endif
+        open_tif();
         if (m_subimage)
             TIFFSetDirectory(m_tif, m_subimage);
 
@@ -1101,7 +1368,7 @@ TIFFInput::readspec(bool read_meta)
                                  (uint32*)iptcdata + iptcsize);
         if (TIFFIsByteSwapped(m_tif))
             TIFFSwabArrayOfLong((uint32*)&iptc[0], iptcsize);
-        decode_iptc_iim(&iptc[0], iptcsize * 4, m_spec);
+        decode_iptc_iim(&iptc[0], iptcsize * 4, m_spec, m_metadata);
     }
 #endif
 
@@ -1110,10 +1377,9 @@ TIFFInput::readspec(bool read_meta)
     const void* xmldata = NULL;
     if (TIFFGetField(m_tif, TIFFTAG_XMLPACKET, &xmlsize, &xmldata)) {
         // std::cerr << "Found XML data, size " << xmlsize << "\n";
-        if (xmldata && xmlsize) {
-            std::string xml((const char*)xmldata, xmlsize);
-            decode_xmp(xml, m_spec);
-        }
+        if (xmldata && xmlsize)
+            decode_xmp(string_view((const char*)xmldata, xmlsize), m_spec,
+                       m_metadata);
     }
 
 #if 0
@@ -1169,6 +1435,16 @@ TIFFInput::readspec(bool read_meta)
         desc        = regex_replace(desc, regex(average_pattern), "");
         updatedDesc = true;
     }
+    found = desc.rfind("oiio:ConstantTiles=");
+    if (found != std::string::npos) {
+        size_t begin = desc.find_first_of('=', found) + 1;
+        size_t end   = std::min(desc.find_first_of(' ', begin), desc.size());
+        m_spec.attribute("oiio:ConstantTiles",
+                         string_view(desc.data() + begin, end - begin));
+        end = std::min(desc.find_first_not_of(' ', end), desc.size());
+        desc.erase(found, end - found);
+        updatedDesc = true;
+    }
     found = desc.rfind("oiio:SHA-1=");
     if (found == std::string::npos)  // back compatibility with < 1.5
         found = desc.rfind("SHA-1=");
@@ -1181,6 +1457,16 @@ TIFFInput::readspec(bool read_meta)
         desc = regex_replace(desc, regex("SHA-1=[[:xdigit:]]*[ ]*"), "");
         updatedDesc = true;
     }
+    found = desc.rfind("oiio:PixelHash=");
+    if (found != std::string::npos) {
+        size_t begin  = desc.find_first_of('=', found) + 1;
+        size_t end    = std::min(desc.find_first_of(' ', begin), desc.size());
+        string_view s = string_view(desc.data() + begin, end - begin);
+        m_spec.attribute("oiio:PixelHash", s);
+        desc = regex_replace(
+            desc, regex("oiio:PixelHash=[[:alnum:]]*:[[:xdigit:]]*[ ]*"), "");
+        updatedDesc = true;
+    }
     if (updatedDesc) {
         if (desc.size())
             m_spec.attribute("ImageDescription", desc);
@@ -1643,17 +1929,7 @@ TIFFInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
 
     // Are we reading raw (compressed) strips and doing the decompression
     // ourselves?
-    bool read_raw_strips =
-        // only deflate/zip compression
-        (m_compression
-         == COMPRESSION_ADOBE_DEFLATE /*|| m_compression == COMPRESSION_NONE*/)
-        // only horizontal predictor (or none)
-        && (m_predictor == PREDICTOR_HORIZONTAL
-            || m_predictor == PREDICTOR_NONE)
-        // contig planarconfig only (for now?)
-        && !m_separate
-        // only uint8, uint16
-        && (m_spec.format == TypeUInt8 || m_spec.format == TypeUInt16);
+    bool read_raw_strips = can_uncompress_raw();
 
     // We know we wish to read as strips. But additionally, there are some
     // circumstances in which we want to read RAW strips, and do the
@@ -1665,9 +1941,9 @@ TIFFInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
         nstrips > 1
         // only if we are reading scanlines in order
         && ybegin == m_next_scanline
-        // only if we're threading and don't enter the thread pool recursively!
+        // only if we're threading (from inside a pool task too: a pool
+        // thread runs its own subtasks while it waits for them)
         && pool->size() > 1
-        && !pool->this_thread_is_in_pool()
         // and not if the feature is turned off
         && m_spec.get_int_attribute("tiff:multithread",
                                     OIIO::get_int_attribute("tiff:multithread"));
@@ -1675,6 +1951,7 @@ TIFFInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
     // Make room for, and read the raw (still compressed) strips. As each
     // one is read, kick off the decompress and any other extras, to execute
     // in parallel.
+    void* data_begin = data;  // where to start again if we fall back
     task_set tasks(pool);
     bool ok        = true;  // failed compression will stash a false here
     int y          = ybegin;
@@ -1685,7 +1962,7 @@ TIFFInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
     int stripvals = m_spec.width * stripchans
                     * m_rowsperstrip;  // values in a strip
     imagesize_t strip_bytes = stripvals * m_spec.format.size();
-    size_t cbound           = compressBound((uLong)strip_bytes);
+    size_t cbound           = raw_bound(strip_bytes);
     std::unique_ptr<char[]> compressed_scratch;
     std::unique_ptr<char[]> separate_tmp(
         m_separate ? new char[strip_bytes * nstrips * planes] : nullptr);
@@ -1781,6 +2058,11 @@ TIFFInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
         data = (char*)data + ystride;
     }
     tasks.wait();
+    // Strips we couldn't decode ourselves (such as old-style LZW) are left
+    // to libtiff, a scanline at a time.
+    if (!ok && read_raw_strips)
+        return ImageInput::read_native_scanlines(subimage, miplevel, ybegin,
+                                                 yend, z, data_begin);
     return true;
 }
 
@@ -1884,6 +2166,43 @@ TIFFInput::read_native_tile(int subimage, int miplevel, int x, int y, int z,
 
 
 
+bool
+TIFFInput::native_tile_offset(int subimage, int miplevel, int x, int y, int z,
+                              imagesize_t& offset)
+{
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel) || !TIFFIsTiled(m_tif))
+        return false;
+    // Only when read_native_tile would just copy the bytes of the tile
+    if (m_compression != COMPRESSION_NONE || m_separate || m_use_rgba_interface
+        || m_is_byte_swapped || m_convert_alpha
+        || m_inputchannels != m_spec.nchannels
+        || m_bitspersample != 8 * m_spec.format.size()
+        || !m_spec.channelformats.empty()
+        || !(m_photometric == PHOTOMETRIC_MINISBLACK
+             || m_photometric == PHOTOMETRIC_RGB
+             || (m_photometric == PHOTOMETRIC_SEPARATED && m_raw_color)))
+        return false;
+    ttile_t tile = TIFFComputeTile(m_tif, x - m_spec.x, y - m_spec.y,
+                                   z - m_spec.z, 0);
+    if (tile >= TIFFNumberOfTiles(m_tif))
+        return false;
+#ifdef TIFF_VERSION_BIG
+    uint64_t *offsets = nullptr, *bytecounts = nullptr;
+#else
+    uint32_t *offsets = nullptr, *bytecounts = nullptr;
+#endif
+    if (!TIFFGetField(m_tif, TIFFTAG_TILEOFFSETS, &offsets)
+        || !TIFFGetField(m_tif, TIFFTAG_TILEBYTECOUNTS, &bytecounts)
+        || !offsets || !bytecounts
+        || imagesize_t(bytecounts[tile]) != m_spec.tile_bytes())
+        return false;
+    offset = imagesize_t(offsets[tile]);
+    return true;
+}
+
+
+
 bool
 TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
                              int ybegin, int yend, int zbegin, int zend,
@@ -1904,10 +2223,12 @@ TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
     // covers most real-world cases.
     thread_pool* pool = default_thread_pool();
     ASSERT(m_spec.tile_depth >= 1);
-    size_t ntiles = size_t(
-        (xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width
-        * (yend - ybegin + m_spec.tile_height - 1) / m_spec.tile_height
-        * (zend - zbegin + m_spec.tile_depth - 1) / m_spec.tile_depth);
+    size_t ntiles
+        = size_t((xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width)
+          * size_t((yend - ybegin + m_spec.tile_height - 1)
+                   / m_spec.tile_height)
+          * size_t((zend - zbegin + m_spec.tile_depth - 1)
+                   / m_spec.tile_depth);
     bool parallelize =
         // more than one tile, or no point parallelizing
         ntiles > 1
@@ -1916,18 +2237,13 @@ TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
             && m_photometric != PHOTOMETRIC_PALETTE)
         // no non-multiple-of-8 bits per sample
         && (spec().format.size() * 8 == m_bitspersample)
-        // contig planarconfig only (for now?)
-        && !m_separate
-        // only deflate/zip compression with horizontal predictor
-        && m_compression == COMPRESSION_ADOBE_DEFLATE
-        && m_predictor == PREDICTOR_HORIZONTAL
-        // only uint8, uint16
-        && (m_spec.format == TypeUInt8 || m_spec.format == TypeUInt16)
+        // zip compression and a predictor we can undo ourselves
+        && can_uncompress_raw()
         // No other unusual cases
         && !m_use_rgba_interface
-        // only if we're threading and don't enter the thread pool recursively!
+        // only if we're threading (from inside a pool task too: a pool
+        // thread runs its own subtasks while it waits for them)
         && pool->size() > 1
-        && !pool->this_thread_is_in_pool()
         // and not if the feature is turned off
         && m_spec.get_int_attribute("tiff:multithread",
                                     OIIO::get_int_attribute("tiff:multithread"));
@@ -1950,7 +2266,7 @@ TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
     stride_t zstride       = (yend - ybegin) * ystride;
     imagesize_t tile_bytes = m_spec.tile_bytes(true);
     int tilevals           = m_spec.tile_pixels() * m_spec.nchannels;
-    size_t cbound          = compressBound((uLong)tile_bytes);
+    size_t cbound          = raw_bound(tile_bytes);
     std::unique_ptr<char[]> compressed_scratch(new char[cbound * ntiles]);
     std::unique_ptr<char[]> scratch(new char[tile_bytes * ntiles]);
     task_set tasks(pool);
@@ -1983,9 +2299,13 @@ TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
                                          m_compression, &ok);
                     if (m_photometric == PHOTOMETRIC_MINISWHITE)
                         invert_photometric(tilevals, ubuf);
-                    copy_image(this->m_spec.nchannels, this->m_spec.tile_width,
-                               this->m_spec.tile_height,
-                               this->m_spec.tile_depth, ubuf,
+                    // Tiles at the image's far edges may be partly
+                    // outside the region, so copy only the part within.
+                    copy_image(this->m_spec.nchannels,
+                               std::min(this->m_spec.tile_width, xend - x),
+                               std::min(this->m_spec.tile_height, yend - y),
+                               std::min(this->m_spec.tile_depth, zend - z),
+                               ubuf,
                                size_t(pixel_bytes), pixel_bytes, tileystride,
                                tilezstride,
                                (char*)data + (z - zbegin) * zstride
@@ -1996,7 +2316,14 @@ TIFFInput::read_native_tiles(int subimage, int miplevel, int xbegin, int xend,
             }
         }
     }
-    return ok;
+    // Wait for all the decompression before checking whether it failed.
+    // Data we can't decode ourselves (such as old-style LZW) is left to
+    // libtiff, a tile at a time.
+    tasks.wait();
+    if (!ok)
+        return ImageInput::read_native_tiles(subimage, miplevel, xbegin, xend,
+                                             ybegin, yend, zbegin, zend, data);
+    return true;
 }
 
 
@@ -29,6 +29,7 @@
 */
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -84,6 +85,7 @@ public:
                              const void* data, stride_t xstride = AutoStride,
                              stride_t ystride = AutoStride,
                              stride_t zstride = AutoStride) override;
+    virtual bool copy_image(ImageInput* in) override;
 
 private:
     TIFF* m_tif;
@@ -216,6 +218,11 @@ extern std::string&
 oiio_tiff_last_error();
 extern void
 oiio_tiff_set_error_handler();
+extern TIFF*
+oiio_tiff_input_handle(ImageInput* in);
+extern TIFF*
+oiio_tiff_open_ioproxy(const std::string& name, const char* mode,
+                       Filesystem::IOProxy* io);
 
 
 
@@ -312,6 +319,8 @@ TIFFOutput::supports(string_view feature) const
         return true;
     if (feature == "iptc")
         return true;
+    if (feature == "ioproxy")
+        return true;
     // N.B. TIFF doesn't support arbitrary metadata.
 
     // FIXME: we could support "volumes" and "empty"
@@ -353,13 +362,22 @@ TIFFOutput::open(const std::string& name, const ImageSpec& userspec,
     if (m_spec.depth < 1)
         m_spec.depth = 1;
 
-        // Open the file
+    // Open the file, or write through the caller's IOProxy if we were
+    // given one (appending re-reads what was already written to it).
+    const char* tifmode     = mode == AppendSubimage ? "a" : "w";
+    const ParamValue* param = m_spec.find_attribute("oiio:ioproxy",
+                                                    TypeDesc::PTR);
+    if (param) {
+        m_tif = oiio_tiff_open_ioproxy(name, tifmode,
+                                       param->get<Filesystem::IOProxy*>());
+    } else {
 #ifdef _WIN32
-    std::wstring wname = Strutil::utf8_to_utf16(name);
-    m_tif = TIFFOpenW(wname.c_str(), mode == AppendSubimage ? "a" : "w");
+        std::wstring wname = Strutil::utf8_to_utf16(name);
+        m_tif              = TIFFOpenW(wname.c_str(), tifmode);
 #else
-    m_tif = TIFFOpen(name.c_str(), mode == AppendSubimage ? "a" : "w");
+        m_tif = TIFFOpen(name.c_str(), tifmode);
 #endif
+    }
     if (!m_tif) {
         error("Can't open \"%s\" for output.", name.c_str());
         return false;
@@ -923,6 +941,119 @@ TIFFOutput::close()
 
 
 
+// Do the current directories of a and b have the same value (or default)
+// for a tag?
+template<typename T>
+static bool
+same_tiff_field(TIFF* a, TIFF* b, uint32_t tag)
+{
+    T va = 0, vb = 0;
+    int ha = TIFFGetFieldDefaulted(a, tag, &va);
+    int hb = TIFFGetFieldDefaulted(b, tag, &vb);
+    return ha == hb && va == vb;
+}
+
+
+
+// Are the pixels of the current directories of a and b stored the same
+// way, so that each raw (still compressed) strip or tile of one is also
+// a valid strip or tile of the other?
+static bool
+same_raw_layout(TIFF* a, TIFF* b)
+{
+    uint16_t compression = 0;
+    TIFFGetFieldDefaulted(a, TIFFTAG_COMPRESSION, &compression);
+    // JPEG keeps tables shared by all chunks outside of them
+    if (compression == COMPRESSION_JPEG || compression == COMPRESSION_OJPEG
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_COMPRESSION))
+        return false;
+    // Only the codecs that use a predictor know about the tag
+    if ((compression == COMPRESSION_LZW
+         || compression == COMPRESSION_ADOBE_DEFLATE
+         || compression == COMPRESSION_DEFLATE)
+        && !same_tiff_field<uint16_t>(a, b, TIFFTAG_PREDICTOR))
+        return false;
+    if (TIFFIsTiled(a) != TIFFIsTiled(b)
+        || TIFFIsByteSwapped(a) != TIFFIsByteSwapped(b))
+        return false;
+    if (TIFFIsTiled(a)) {
+        if (!same_tiff_field<uint32_t>(a, b, TIFFTAG_TILEWIDTH)
+            || !same_tiff_field<uint32_t>(a, b, TIFFTAG_TILELENGTH)
+            || !same_tiff_field<uint32_t>(a, b, TIFFTAG_TILEDEPTH))
+            return false;
+    } else if (!same_tiff_field<uint32_t>(a, b, TIFFTAG_ROWSPERSTRIP)) {
+        return false;
+    }
+    if (!same_tiff_field<uint32_t>(a, b, TIFFTAG_IMAGEWIDTH)
+        || !same_tiff_field<uint32_t>(a, b, TIFFTAG_IMAGELENGTH)
+        || !same_tiff_field<uint32_t>(a, b, TIFFTAG_IMAGEDEPTH)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_PLANARCONFIG)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_BITSPERSAMPLE)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_SAMPLESPERPIXEL)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_SAMPLEFORMAT)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_PHOTOMETRIC)
+        || !same_tiff_field<uint16_t>(a, b, TIFFTAG_FILLORDER))
+        return false;
+    uint16_t na = 0, nb = 0;
+    uint16_t *ea = NULL, *eb = NULL;
+    TIFFGetFieldDefaulted(a, TIFFTAG_EXTRASAMPLES, &na, &ea);
+    TIFFGetFieldDefaulted(b, TIFFTAG_EXTRASAMPLES, &nb, &eb);
+    return na == nb && (!na || std::equal(ea, ea + na, eb));
+}
+
+
+
+bool
+TIFFOutput::copy_image(ImageInput* in)
+{
+    // If the input is a TIFF whose current directory is laid out and
+    // compressed exactly as we are about to write, move its strips or
+    // tiles across still compressed instead of decoding and re-encoding
+    // every pixel.
+    TIFF* intif = oiio_tiff_input_handle(in);
+    if (intif && m_tif) {
+        std::lock_guard<ImageInput> inlock(*in);
+        bool tiled = TIFFIsTiled(intif);
+#ifdef TIFF_VERSION_BIG
+        uint64_t* bytecounts = nullptr;
+#else
+        uint32_t* bytecounts = nullptr;
+#endif
+        if (same_raw_layout(intif, m_tif)
+            && TIFFGetField(intif,
+                            tiled ? TIFFTAG_TILEBYTECOUNTS
+                                  : TIFFTAG_STRIPBYTECOUNTS,
+                            &bytecounts)
+            && bytecounts) {
+            uint32_t n = tiled ? TIFFNumberOfTiles(intif)
+                               : TIFFNumberOfStrips(intif);
+            std::vector<unsigned char> raw;
+            for (uint32_t i = 0; i < n; ++i) {
+                tmsize_t size = tmsize_t(bytecounts[i]);
+                if (size <= 0)
+                    continue;  // sparse -- leave it unwritten here too
+                raw.resize(size);
+                size = tiled ? TIFFReadRawTile(intif, i, raw.data(), size)
+                             : TIFFReadRawStrip(intif, i, raw.data(), size);
+                if (size < 0
+                    || (tiled ? TIFFWriteRawTile(m_tif, i, raw.data(), size)
+                              : TIFFWriteRawStrip(m_tif, i, raw.data(), size))
+                           < 0) {
+                    std::string err = oiio_tiff_last_error();
+                    error("Failed copying raw TIFF %s %u: %s",
+                          tiled ? "tile" : "strip", i,
+                          err.size() ? err.c_str() : "unknown error");
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+    return ImageOutput::copy_image(in);
+}
+
+
+
 /// Helper: Convert n pixels from contiguous (RGBRGBRGB) to separate
 /// (RRRGGGBBB) planarconfig.
 void
@@ -1175,9 +1306,9 @@ TIFFOutput::write_scanlines(int ybegin, int yend, int z, TypeDesc format,
         && m_predictor == PREDICTOR_HORIZONTAL
         // only uint8, uint16
         && (m_spec.format == TypeUInt8 || m_spec.format == TypeUInt16)
-        // only if we're threading and don't enter the thread pool recursively!
+        // only if we're threading (from inside a pool task too: a pool
+        // thread runs its own subtasks while it waits for them)
         && pool->size() > 1
-        && !pool->this_thread_is_in_pool()
         // and not if the feature is turned off
         && m_spec.get_int_attribute("tiff:multithread",
                                     OIIO::get_int_attribute("tiff:multithread"));
@@ -1422,9 +1553,9 @@ TIFFOutput::write_tiles(int xbegin, int xend, int ybegin, int yend, int zbegin,
         && m_predictor == PREDICTOR_HORIZONTAL
         // only uint8, uint16
         && (m_spec.format == TypeUInt8 || m_spec.format == TypeUInt16)
-        // only if we're threading and don't enter the thread pool recursively!
+        // only if we're threading (from inside a pool task too: a pool
+        // thread runs its own subtasks while it waits for them)
         && pool->size() > 1
-        && !pool->this_thread_is_in_pool()
         // and not if the feature is turned off
         && m_spec.get_int_attribute("tiff:multithread",
                                     OIIO::get_int_attribute("tiff:multithread"));
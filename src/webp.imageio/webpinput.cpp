@@ -29,6 +29,7 @@
 */
 
 #include <cstdio>
+#include <vector>
 
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
@@ -47,27 +48,51 @@ public:
     virtual ~WebpInput() { close(); }
     virtual const char* format_name() const override { return "webp"; }
     virtual bool open(const std::string& name, ImageSpec& spec) override;
+    virtual bool open(const std::string& name, ImageSpec& spec,
+                      const ImageSpec& config) override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
     virtual bool close() override;
 
 private:
     std::string m_filename;
-    uint8_t* m_decoded_image;
+    std::vector<uint8_t> m_decoded_image;
     uint64_t m_image_size;
     long int m_scanline_size;
     FILE* m_file;
+    WebPIDecoder* m_decoder;  // Incremental decoder into m_decoded_image
+    int m_decoded_rows;       // How many rows are fully decoded so far
+    bool m_native_rgb;        // Decode alpha-less images to 3 channels
 
     void init()
     {
         m_image_size    = 0;
         m_scanline_size = 0;
-        m_decoded_image = NULL;
-        m_file          = NULL;
+        m_decoded_image.clear();
+        m_file         = NULL;
+        m_decoder      = NULL;
+        m_decoded_rows = 0;
+        m_native_rgb   = false;
     }
+
+    // Feed the decoder the next chunk of the file.
+    bool decode_more();
 };
 
 
+bool
+WebpInput::open(const std::string& name, ImageSpec& spec,
+                const ImageSpec& config)
+{
+    m_native_rgb = config.get_int_attribute("webp:rgb", 0) != 0;
+    bool ok      = open(name, spec);
+    if (!ok)
+        m_native_rgb = false;
+    return ok;
+}
+
+
+
 bool
 WebpInput::open(const std::string& name, ImageSpec& spec)
 {
@@ -108,38 +133,56 @@ WebpInput::open(const std::string& name, ImageSpec& spec)
         return false;
     }
 
-    int width = 0, height = 0;
-    if (!WebPGetInfo(&image_header[0], image_header.size(), &width, &height)) {
+    WebPBitstreamFeatures features;
+    if (WebPGetFeatures(&image_header[0], image_header.size(), &features)
+        != VP8_STATUS_OK) {
         error("%s is not a WebP image file", m_filename.c_str());
         close();
         return false;
     }
 
-    // Read actual data and decode.
-    std::vector<uint8_t> encoded_image;
-    encoded_image.resize(m_image_size, 0);
-    fseek(m_file, 0, SEEK_SET);
-    numRead = fread(&encoded_image[0], sizeof(uint8_t), encoded_image.size(),
-                    m_file);
-    if (numRead != encoded_image.size()) {
-        error("Read failure for \"%s\" (expected %d bytes, read %d)",
-              m_filename, encoded_image.size(), numRead);
+    // Images are presented as RGBA unless the "webp:rgb" hint asked for
+    // alpha-less images to be decoded straight to RGB.
+    const bool rgba     = features.has_alpha || !m_native_rgb;
+    const int nchannels = rgba ? 4 : 3;
+    m_scanline_size     = features.width * nchannels;
+    m_spec = ImageSpec(features.width, features.height, nchannels,
+                       TypeDesc::UINT8);
+    spec   = m_spec;
+
+    // Don't decode anything yet. Pixels are decoded incrementally, as the
+    // scanlines asking for them are read, straight into our image buffer.
+    m_decoded_image.resize(m_scanline_size * m_spec.height);
+    m_decoder = WebPINewRGB(rgba ? MODE_RGBA : MODE_RGB,
+                            &m_decoded_image[0], m_decoded_image.size(),
+                            int(m_scanline_size));
+    if (!m_decoder) {
+        error("Couldn't create a WebP decoder for %s", m_filename.c_str());
         close();
         return false;
     }
+    fseek(m_file, 0, SEEK_SET);
+    return true;
+}
 
-    const int CHANNEL_NUM = 4;
-    m_scanline_size       = width * CHANNEL_NUM;
-    m_spec = ImageSpec(width, height, CHANNEL_NUM, TypeDesc::UINT8);
-    spec   = m_spec;
 
-    if (!(m_decoded_image = WebPDecodeRGBA(&encoded_image[0],
-                                           encoded_image.size(), &m_spec.width,
-                                           &m_spec.height))) {
+bool
+WebpInput::decode_more()
+{
+    uint8_t chunk[65536];
+    size_t numRead = fread(chunk, sizeof(uint8_t), sizeof(chunk), m_file);
+    if (numRead == 0) {
+        error("Read failure for \"%s\": file is truncated", m_filename);
+        return false;
+    }
+    VP8StatusCode status = WebPIAppend(m_decoder, chunk, numRead);
+    if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED) {
         error("Couldn't decode %s", m_filename.c_str());
-        close();
         return false;
     }
+    int last_y = 0;
+    WebPIDecGetRGB(m_decoder, &last_y, NULL, NULL, NULL);
+    m_decoded_rows = last_y;
     return true;
 }
 
@@ -148,15 +191,15 @@ bool
 WebpInput::read_native_scanline(int subimage, int miplevel, int y, int z,
                                 void* data)
 {
-    // Not necessary to lock and seek -- no subimages in Webp, and since
-    // the only thing we're doing here is a memcpy, it's already threadsafe.
-    //
-    // lock_guard lock (m_mutex);
-    // if (! seek_subimage (subimage, miplevel))
-    //     return false;
-
-    if (y < 0 || y >= m_spec.width)  // out of range scanline
+    lock_guard lock(m_mutex);
+    if (!seek_subimage(subimage, miplevel))
+        return false;
+
+    if (y < 0 || y >= m_spec.height)  // out of range scanline
         return false;
+    while (m_decoded_rows <= y)
+        if (!decode_more())
+            return false;
     memcpy(data, &m_decoded_image[y * m_scanline_size], m_scanline_size);
     return true;
 }
@@ -169,11 +212,11 @@ WebpInput::close()
         fclose(m_file);
         m_file = NULL;
     }
-    if (m_decoded_image) {
-        free(
-            m_decoded_image);  // this was allocated by WebPDecodeRGB and should be fread by free
-        m_decoded_image = NULL;
+    if (m_decoder) {
+        WebPIDelete(m_decoder);
+        m_decoder = NULL;
     }
+    init();
     return true;
 }
 
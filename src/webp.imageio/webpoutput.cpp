@@ -146,6 +146,9 @@ WebpOutput::open(const std::string& name, const ImageSpec& spec, OpenMode mode)
         compression_quality = *static_cast<const int*>(qual->data());
     }
     m_webp_config.quality = compression_quality;
+    // Let libwebp use extra threads for encoding unless we've been asked
+    // to keep to one.
+    m_webp_config.thread_level = (threads() == 1) ? 0 : 1;
 
     // forcing UINT8 format
     m_spec.set_format(TypeDesc::UINT8);
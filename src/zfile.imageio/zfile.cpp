@@ -28,9 +28,11 @@
   (This is the Modified BSD License)
 */
 
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include "zlib.h"
 
@@ -38,6 +40,7 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/fmath.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/thread.h>
 #include <OpenImageIO/typedesc.h>
@@ -74,6 +77,170 @@ open_gz(const std::string& filename, const char* mode)
     return gz;
 }
 
+
+
+// Compressed zfiles are written as a series of independent gzip members
+// (the header, then bands of scanlines), which is still a valid gzip
+// file. Like BGZF, each member's header carries an extra field giving
+// the member's total size, so that a reader can find every member
+// without inflating any, and then inflate them all in parallel.
+static const unsigned char member_id[2] = { 'O', 'Z' };
+static const size_t member_header_size  = 20;  // fixed part plus extra field
+static const size_t member_trailer_size = 8;   // CRC32 and ISIZE
+
+// Aim for bands of this many uncompressed bytes.
+static const size_t member_target_bytes = 256 * 1024;
+
+
+
+inline unsigned int
+get_le32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+
+
+inline void
+put_le32(unsigned char* p, unsigned int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+
+
+// Deflate n bytes of data into a single gzip member, appended to out.
+bool
+gzip_member(const void* data, size_t n, int level,
+            std::vector<unsigned char>& out)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY)
+        != Z_OK)
+        return false;
+    size_t begin = out.size();
+    out.resize(begin + member_header_size + deflateBound(&zs, uLong(n))
+               + member_trailer_size);
+    unsigned char* m = &out[begin];
+    zs.next_in       = (Bytef*)data;
+    zs.avail_in      = uInt(n);
+    zs.next_out      = m + member_header_size;
+    zs.avail_out     = uInt(out.size() - begin - member_header_size);
+    int err          = deflate(&zs, Z_FINISH);
+    size_t clen      = zs.total_out;
+    deflateEnd(&zs);
+    if (err != Z_STREAM_END)
+        return false;
+
+    size_t total = member_header_size + clen + member_trailer_size;
+    static const unsigned char fixed[12] = {
+        0x1f, 0x8b, 8 /*deflate*/, 4 /*FEXTRA*/, 0, 0, 0, 0, 0, 255, 8, 0
+    };
+    memcpy(m, fixed, sizeof(fixed));
+    m[12] = member_id[0];
+    m[13] = member_id[1];
+    m[14] = 4;
+    m[15] = 0;
+    put_le32(m + 16, (unsigned int)total);
+    put_le32(m + member_header_size + clen,
+             (unsigned int)crc32(0, (const Bytef*)data, uInt(n)));
+    put_le32(m + member_header_size + clen + 4, (unsigned int)n);
+    out.resize(begin + total);
+    return true;
+}
+
+
+
+struct GzipMember {
+    size_t begin, end;  // Byte range of the whole member
+    size_t outsize;     // Uncompressed size
+};
+
+// If every member of the gzip data was written by gzip_member(), so that
+// its size is known, list them and return true.
+bool
+find_gzip_members(const unsigned char* p, size_t size,
+                  std::vector<GzipMember>& members)
+{
+    members.clear();
+    for (size_t pos = 0; pos < size;) {
+        if (size - pos < member_header_size + member_trailer_size
+            || p[pos] != 0x1f || p[pos + 1] != 0x8b || p[pos + 2] != 8
+            || p[pos + 3] != 4 || p[pos + 10] != 8 || p[pos + 11] != 0
+            || p[pos + 12] != member_id[0] || p[pos + 13] != member_id[1])
+            return false;
+        size_t total = get_le32(p + pos + 16);
+        if (total < member_header_size + member_trailer_size
+            || total > size - pos)
+            return false;
+        GzipMember member;
+        member.begin   = pos;
+        member.end     = pos + total;
+        member.outsize = get_le32(p + member.end - 4);
+        members.push_back(member);
+        pos += total;
+    }
+    return !members.empty();
+}
+
+
+
+// Inflate one member found by find_gzip_members() into dst.
+bool
+inflate_member(const unsigned char* p, const GzipMember& member,
+               unsigned char* dst)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return false;
+    zs.next_in   = (Bytef*)p + member.begin + member_header_size;
+    zs.avail_in  = uInt(member.end - member.begin - member_header_size
+                       - member_trailer_size);
+    zs.next_out  = dst;
+    zs.avail_out = uInt(member.outsize);
+    int err      = inflate(&zs, Z_FINISH);
+    bool ok      = (err == Z_STREAM_END && zs.total_out == member.outsize);
+    inflateEnd(&zs);
+    return ok
+           && crc32(0, dst, uInt(member.outsize))
+                  == get_le32(p + member.end - member_trailer_size);
+}
+
+
+
+// Inflate gzip data of any origin -- possibly several concatenated
+// members -- into dst, stopping once dstsize bytes have been produced.
+// Return the number of bytes produced.
+size_t
+inflate_all(const unsigned char* p, size_t size, unsigned char* dst,
+            size_t dstsize)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK)
+        return 0;
+    zs.next_in   = (Bytef*)p;
+    zs.avail_in  = uInt(size);
+    zs.next_out  = dst;
+    zs.avail_out = uInt(dstsize);
+    while (zs.avail_out) {
+        int err = inflate(&zs, Z_NO_FLUSH);
+        if (err == Z_STREAM_END && zs.avail_in)
+            inflateReset(&zs);  // Another member follows
+        else if (err != Z_OK)
+            break;
+    }
+    size_t produced = dstsize - zs.avail_out;  // total_out restarts per member
+    inflateEnd(&zs);
+    return produced;
+}
+
 }  // namespace
 
 
@@ -88,21 +255,24 @@ public:
     virtual bool close() override;
     virtual bool read_native_scanline(int subimage, int miplevel, int y, int z,
                                       void* data) override;
+    virtual bool read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                       int yend, int z, void* data) override;
 
 private:
-    std::string m_filename;  ///< Stash the filename
-    gzFile m_gz;             ///< Handle for compressed files
-    bool m_swab;             ///< swap bytes for other endianness?
-    int m_next_scanline;     ///< Which scanline is the next to be read?
+    std::string m_filename;               ///< Stash the filename
+    bool m_swab;                          ///< swap bytes for other endianness?
+    std::vector<unsigned char> m_pixels;  ///< Header and pixels, once read
 
     // Reset everything to initial state
     void init()
     {
         m_filename.clear();
-        m_gz            = 0;
-        m_swab          = false;
-        m_next_scanline = 0;
+        m_swab = false;
+        std::vector<unsigned char>().swap(m_pixels);
     }
+
+    // Read and decompress the whole file into m_pixels.
+    bool read_pixels();
 };
 
 
@@ -123,17 +293,23 @@ public:
 
 private:
     std::string m_filename;  ///< Stash the filename
-    FILE* m_file;            ///< Open image handle for not compressed
-    gzFile m_gz;             ///< Handle for compressed files
+    FILE* m_file;            ///< Open image handle
+    bool m_compress;         ///< Write gzip members rather than raw data?
     std::vector<unsigned char> m_scratch;
     std::vector<unsigned char> m_tilebuffer;
+    std::vector<unsigned char> m_band;   ///< Scanlines not yet compressed
+    std::vector<unsigned char> m_gzbuf;  ///< Compressed member to write
 
     // Initialize private members to pre-opened state
     void init(void)
     {
-        m_file = nullptr;
-        m_gz   = 0;
+        m_file     = nullptr;
+        m_compress = false;
+        m_band.clear();
     }
+
+    // Write n bytes, as a gzip member if compressing.
+    bool write_bytes(const void* data, size_t n);
 };
 
 
@@ -190,15 +366,18 @@ bool
 ZfileInput::open(const std::string& name, ImageSpec& newspec)
 {
     m_filename = name;
-    m_gz       = open_gz(name, "rb");
-    if (!m_gz) {
+    gzFile gz  = open_gz(name, "rb");
+    if (!gz) {
         error("Could not open file \"%s\"", name);
         return false;
     }
 
+    // Only the header is read here. The pixels are read all at once, on
+    // the first request for any of them.
     ZfileHeader header;
     ASSERT(sizeof(header) == 136);
-    gzread(m_gz, &header, sizeof(header));
+    gzread(gz, &header, sizeof(header));
+    gzclose(gz);
 
     if (header.magic != zfile_magic && header.magic != zfile_magic_endian) {
         error("Not a valid Zfile");
@@ -234,12 +413,64 @@ ZfileInput::open(const std::string& name, ImageSpec& newspec)
 bool
 ZfileInput::close()
 {
-    if (m_gz) {
-        gzclose(m_gz);
-        m_gz = 0;
+    init();  // Reset to initial state
+    return true;
+}
+
+
+
+bool
+ZfileInput::read_pixels()
+{
+    size_t filesize = Filesystem::file_size(m_filename);
+    std::vector<unsigned char> file(filesize);
+    if (!filesize
+        || Filesystem::read_bytes(m_filename, file.data(), filesize)
+               != filesize) {
+        error("Could not read file \"%s\"", m_filename);
+        return false;
     }
 
-    init();  // Reset to initial state
+    // Decompress straight into one buffer holding the header and then
+    // all the pixels, which is what the file's uncompressed bytes are.
+    size_t total = sizeof(ZfileHeader) + m_spec.image_bytes();
+    std::vector<unsigned char> pixels(total);
+    size_t produced = 0;
+    std::vector<GzipMember> members;
+    if (filesize < 2 || file[0] != 0x1f || file[1] != 0x8b) {
+        // Not compressed
+        produced = std::min(filesize, total);
+        memcpy(pixels.data(), file.data(), produced);
+    } else if (find_gzip_members(file.data(), filesize, members)) {
+        // Every member's size is known, so they can all be inflated at
+        // once, each into its place.
+        std::vector<size_t> offsets(members.size());
+        for (size_t i = 0; i < members.size(); ++i) {
+            offsets[i] = produced;
+            produced += members[i].outsize;
+        }
+        if (produced == total) {
+            std::atomic<bool> ok(true);
+            parallel_for(0, int64_t(members.size()), [&](int64_t i) {
+                if (!inflate_member(file.data(), members[i],
+                                    pixels.data() + offsets[i]))
+                    ok = false;
+            });
+            if (!ok)
+                produced = 0;
+        }
+    } else {
+        produced = inflate_all(file.data(), filesize, pixels.data(), total);
+    }
+    if (produced != total) {
+        error("Corrupt or truncated zfile \"%s\"", m_filename);
+        return false;
+    }
+
+    if (m_swab)
+        swap_endian((float*)&pixels[sizeof(ZfileHeader)],
+                    int(m_spec.image_pixels()));
+    m_pixels.swap(pixels);
     return true;
 }
 
@@ -248,28 +479,27 @@ ZfileInput::close()
 bool
 ZfileInput::read_native_scanline(int subimage, int miplevel, int y, int z,
                                  void* data)
+{
+    return read_native_scanlines(subimage, miplevel, y, y + 1, z, data);
+}
+
+
+
+bool
+ZfileInput::read_native_scanlines(int subimage, int miplevel, int ybegin,
+                                  int yend, int z, void* data)
 {
     lock_guard lock(m_mutex);
     if (!seek_subimage(subimage, miplevel))
         return false;
+    if (m_pixels.empty() && !read_pixels())
+        return false;
 
-    if (m_next_scanline > y) {
-        // User is trying to read an earlier scanline than the one we're
-        // up to.  Easy fix: close the file and re-open.
-        ImageSpec dummyspec;
-        int subimage = current_subimage();
-        if (!close() || !open(m_filename, dummyspec)
-            || !seek_subimage(subimage, miplevel))
-            return false;  // Somehow, the re-open failed
-        ASSERT(m_next_scanline == 0 && current_subimage() == subimage);
-    }
-    while (m_next_scanline <= y) {
-        // Keep reading until we're read the scanline we really need
-        gzread(m_gz, data, m_spec.width * sizeof(float));
-        ++m_next_scanline;
-    }
-    if (m_swab)
-        swap_endian((float*)data, m_spec.width);
+    ybegin = clamp(ybegin, 0, m_spec.height);
+    yend   = clamp(yend, ybegin, m_spec.height);
+    memcpy(data,
+           &m_pixels[sizeof(ZfileHeader) + ybegin * m_spec.scanline_bytes()],
+           (yend - ybegin) * m_spec.scanline_bytes());
     return true;
 }
 
@@ -285,7 +515,6 @@ ZfileOutput::open(const std::string& name, const ImageSpec& userspec,
     }
 
     close();  // Close any already-opened file
-    m_gz   = 0;
     m_file = NULL;
     m_spec = userspec;  // Stash the spec
 
@@ -327,27 +556,16 @@ ZfileOutput::open(const std::string& name, const ImageSpec& userspec,
     else
         memcpy(header.worldtoscreen, ident, 16 * sizeof(float));
 
-    if (m_spec.get_string_attribute("compression", "none")
-        != std::string("none")) {
-        m_gz = open_gz(name, "wb");
-    } else {
-        m_file = Filesystem::fopen(name, "wb");
-    }
-    if (!m_file && !m_gz) {
+    m_compress = (m_spec.get_string_attribute("compression", "none")
+                  != std::string("none"));
+    m_file     = Filesystem::fopen(name, "wb");
+    if (!m_file) {
         error("Could not open file \"%s\"", name);
         return false;
     }
 
-    bool b = 0;
-    if (m_gz) {
-        b = gzwrite(m_gz, &header, sizeof(header));
-    } else {
-        b = fwrite(&header, sizeof(header), 1, m_file);
-    }
-    if (!b) {
-        error("Failed write zfile::open (err: %d)", b);
+    if (!write_bytes(&header, sizeof(header)))
         return false;
-    }
 
     // If user asked for tiles -- which this format doesn't support, emulate
     // it by buffering the whole image.this form
@@ -371,9 +589,9 @@ ZfileOutput::close()
         std::vector<unsigned char>().swap(m_tilebuffer);
     }
 
-    if (m_gz) {
-        gzclose(m_gz);
-        m_gz = 0;
+    if (m_band.size()) {
+        ok &= write_bytes(m_band.data(), m_band.size());
+        m_band.clear();
     }
     if (m_file) {
         fclose(m_file);
@@ -400,16 +618,41 @@ ZfileOutput::write_scanline(int y, int z, TypeDesc format, const void* data,
         data = &m_scratch[0];
     }
 
-    if (m_gz)
-        gzwrite(m_gz, data, m_spec.width * sizeof(float));
-    else {
-        size_t b = fwrite(data, sizeof(float), m_spec.width, m_file);
-        if (b != (size_t)m_spec.width) {
-            error("Failed write zfile::open (err: %d)", b);
-            return false;
+    if (m_compress) {
+        // Compress bands of scanlines as separate gzip members, so that
+        // readers can inflate them in parallel.
+        size_t bytes = m_spec.scanline_bytes();
+        m_band.insert(m_band.end(), (const unsigned char*)data,
+                      (const unsigned char*)data + bytes);
+        if (m_band.size() + bytes > member_target_bytes) {
+            bool ok = write_bytes(m_band.data(), m_band.size());
+            m_band.clear();
+            return ok;
         }
+        return true;
     }
+    return write_bytes(data, m_spec.scanline_bytes());
+}
 
+
+
+bool
+ZfileOutput::write_bytes(const void* data, size_t n)
+{
+    if (m_compress) {
+        m_gzbuf.clear();
+        if (!gzip_member(data, n, Z_DEFAULT_COMPRESSION, m_gzbuf)) {
+            error("Failed zfile compression");
+            return false;
+        }
+        data = m_gzbuf.data();
+        n    = m_gzbuf.size();
+    }
+    size_t b = fwrite(data, 1, n, m_file);
+    if (b != n) {
+        error("Failed write zfile (err: %d)", b);
+        return false;
+    }
     return true;
 }
 